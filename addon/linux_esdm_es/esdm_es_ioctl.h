@@ -61,4 +61,92 @@
 /* SCHED ES: read status information */
 #define ESDM_SCHED_STATUS _IOR(ESDMIO, 0x09, char[250])
 
+/* IDs of the entropy sources in the batch read */
+#define ESDM_ES_BATCH_IRQ 0
+#define ESDM_ES_BATCH_SCHED 1
+#define ESDM_ES_BATCH_MAX 2
+
+/* Maximum size of the entropy data of one block in the batch read */
+#define ESDM_ES_BATCH_MAX_E_SIZE 256
+
+/*
+ * struct esdm_es_batch - read the entropy of several ES with one call
+ * @buf: User space buffer receiving the blocks
+ * @es_mask: Bit mask of the ES to read: (1 << ESDM_ES_BATCH_*)
+ * @e_size: Size of the entropy data of one block in bytes, the u32 holding
+ *	    the entropy bits immediately follows the entropy data
+ * @offset: Offset of the block of each ES in @buf
+ *
+ * If the ES delivers more data than @e_size, the entropy data is truncated
+ * and the entropy bits are capped at the truncated size. If it delivers
+ * less data, the remainder of the entropy data is zeroized.
+ */
+struct esdm_es_batch {
+	__u64 buf;
+	__u32 es_mask;
+	__u32 e_size;
+	__u32 offset[ESDM_ES_BATCH_MAX];
+};
+
+/* IRQ and SCHED ES: read entropy values into the given user space layout */
+#define ESDM_ES_ENT_BUF_BATCH _IOW(ESDMIO, 0x0a, struct esdm_es_batch)
+
+/* Number of buckets of the log2 cost histograms */
+#define ESDM_ES_PERF_HIST_BUCKETS 32
+
+/*
+ * Log2 histograms of the cost in cycles summed over all CPUs: bucket 0 counts
+ * the events without measurable cost, bucket i counts the events costing
+ * [2^(i-1), 2^i) cycles. The last bucket also counts all more costly events.
+ */
+struct esdm_es_perf_hist {
+	__u64 hook[ESDM_ES_PERF_HIST_BUCKETS];
+	__u64 compress[ESDM_ES_PERF_HIST_BUCKETS];
+};
+
+/* IRQ ES: read the cost of the interrupt hook and the pool compression */
+#define ESDM_IRQ_PERF_HIST _IOR(ESDMIO, 0x0b, struct esdm_es_perf_hist)
+
+/* Ring of entropy blocks available with mmap(2) */
+#define ESDM_ES_RING_VERSION 1
+#define ESDM_ES_RING_SLOTS 8
+#define ESDM_ES_RING_E_SIZE 64
+
+/*
+ * struct esdm_es_ring_slot - one entropy block in the ring
+ * @seq: Generation of the block shifted left by one, the lowest bit is set
+ *	 while the block is written and 0 means an empty slot
+ * @e_bits: Entropy of the block in bits
+ * @e: Entropy data with the size given by esdm_es_ring.e_size
+ */
+struct esdm_es_ring_slot {
+	__u64 seq;
+	__u32 e_bits;
+	__u32 reserved;
+	__u8 e[ESDM_ES_RING_E_SIZE];
+};
+
+/*
+ * struct esdm_es_ring - read-only ring shared with the ESDM user space
+ * @version: ESDM_ES_RING_VERSION
+ * @slots: Number of slots per ES
+ * @e_size: Size of the entropy data in each slot
+ * @produced: Generation of the last written block of all ES
+ * @slot: Slots of each ES (ESDM_ES_BATCH_*)
+ *
+ * The ring can only be mapped read-only by one process at a time. A block is
+ * only written once; the reader must use a block only if its generation is
+ * newer than the generation of the last block it used. While the ring is
+ * mapped, the kernel fills it with a new block whenever an ES holds its
+ * requested amount of entropy and wakes up poll(2) callers.
+ */
+struct esdm_es_ring {
+	__u32 version;
+	__u32 slots;
+	__u32 e_size;
+	__u32 reserved;
+	__u64 produced;
+	struct esdm_es_ring_slot slot[ESDM_ES_BATCH_MAX][ESDM_ES_RING_SLOTS];
+};
+
 #endif /* _ESDM_ES_IOCTL_H */
@@ -10,10 +10,16 @@
 #include <asm/irq_regs.h>
 #include <asm/ptrace.h>
 #include <crypto/hash.h>
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
+#include <linux/bitops.h>
 #include <linux/esdm_irq.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/random.h>
+#include <linux/workqueue.h>
 
+#include "esdm_es_ioctl.h"
 #include "esdm_es_mgr_cb.h"
 #include "esdm_es_irq.h"
 #include "esdm_es_timer_common.h"
@@ -81,6 +87,27 @@ config ESDM_SWITCHABLE_CONTINUOUS_COMPRESSION
 */
 #undef CONFIG_ESDM_SWITCHABLE_CONTINUOUS_COMPRESSION
 
+/*
+config ESDM_IRQ_DEFERRED_COMPRESSION
+	bool "Defer the continuous compression out of interrupt context"
+	depends on ESDM_IRQ && ESDM_ENABLE_CONTINUOUS_COMPRESSION
+	help
+	  With continuous compression, the per-CPU array holding the
+	  time stamps is hashed into the per-CPU entropy pool when it is
+	  full. This hash is calculated in interrupt context which adds
+	  latency to the interrupt that fills the array.
+
+	  When enabling this option, the full array is copied into a
+	  per-CPU second buffer and the hash operation is performed by
+	  a work item on the same CPU. The interrupt handler only stores
+	  the time stamps. If the work item did not yet process the
+	  previous buffer when the array is full again, the hash is
+	  calculated in interrupt context as without this option.
+
+	  If unsure, say N.
+*/
+#undef CONFIG_ESDM_IRQ_DEFERRED_COMPRESSION
+
 /*
 config ESDM_IRQ_ENTROPY_RATE
 	int "Interrupt Entropy Source Entropy Rate"
@@ -120,6 +147,22 @@ config ESDM_RUNTIME_ES_CONFIG
  */
 #undef CONFIG_ESDM_RUNTIME_ES_CONFIG
 
+/*
+config ESDM_IRQ_PERF_HISTOGRAM
+	bool "Interrupt Entropy Source cost histogram"
+	depends on ESDM_IRQ
+	default y
+	help
+	  Maintain a per-CPU log2 histogram of the cycles spent in the
+	  interrupt hook and in the compression of the per-CPU array
+	  into the entropy pool. Recording an event costs one time
+	  stamp read and a per-CPU counter increment.
+
+	  The histograms are available in the debugfs file
+	  esdm_es_perf/irq and are reported with the ESDM status.
+*/
+#define CONFIG_ESDM_IRQ_PERF_HISTOGRAM
+
 /******************************************************************************/
 
 static void *esdm_irq_hash_state = NULL;
@@ -145,11 +188,16 @@ MODULE_PARM_DESC(
 	"How many interrupts must be collected for obtaining 256 bits of entropy\n");
 #endif
 
-/* Per-CPU array holding concatenated IRQ entropy events */
-static DEFINE_PER_CPU(u32[ESDM_DATA_ARRAY_SIZE], esdm_irq_array)
-	__aligned(ESDM_KCAPI_ALIGN);
+/*
+ * Per-CPU array holding concatenated IRQ entropy events - it is allocated
+ * when the CPU comes online and released when it goes offline.
+ */
+static DEFINE_PER_CPU(u32 *, esdm_irq_array) = NULL;
 static DEFINE_PER_CPU(u32, esdm_irq_array_ptr) = 0;
 static DEFINE_PER_CPU(atomic_t, esdm_irq_array_irqs) = ATOMIC_INIT(0);
+/* Value of esdm_irq_array_ptr when the pool was read last */
+static DEFINE_PER_CPU(u32, esdm_irq_read_ptr) = 0;
+static enum cpuhp_state esdm_irq_cpuhp_state;
 
 /*
  * The entropy collection is performed by executing the following steps:
@@ -169,7 +217,7 @@ static DEFINE_PER_CPU(atomic_t, esdm_irq_array_irqs) = ATOMIC_INIT(0);
  * per CPU between DRNG reseeds is equal to the digest size of the used hash.
  *
  * If continuous compression is disabled, the maximum number of entropy events
- * that can be collected per CPU is equal to ESDM_DATA_ARRAY_SIZE. This amount
+ * that can be collected per CPU is equal to the collection size. This amount
  * of events is converted into an entropy statement which then represents the
  * maximum amount of entropy collectible per CPU between DRNG reseeds.
  */
@@ -211,13 +259,325 @@ static bool esdm_irq_pool_online(int cpu)
 	return per_cpu(esdm_irq_lock_init, cpu);
 }
 
+#ifdef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+/*
+ * First slot of the per-CPU array holding a time stamp that is not yet
+ * health tested. Slots below hold data of the current round that does not
+ * need testing, e.g. full time stamps processed before the GCD is known.
+ * Apart from these, the value is only accessed with esdm_irq_lock held.
+ */
+static DEFINE_PER_CPU(u32, esdm_irq_batch_start) = 1;
+
+static bool esdm_irq_health_batched(void)
+{
+	return esdm_highres_timer();
+}
+
+/*
+ * Health test the slots [start, end) of a per-CPU array and credit the
+ * passing time stamps. The caller must hold esdm_irq_lock of the CPU.
+ */
+static void esdm_irq_batch_test(u32 *array, u32 start, u32 end, int cpu)
+{
+	u32 passed = esdm_health_test_batch(array, start, end, cpu,
+					    esdm_int_es_irq);
+
+	if (passed)
+		atomic_add(passed, per_cpu_ptr(&esdm_irq_array_irqs, cpu));
+}
+
+/* The next slots up to next do not need to be health tested. */
+static void esdm_irq_batch_skip(u32 next)
+{
+	this_cpu_write(esdm_irq_batch_start, next);
+}
+
+#else /* CONFIG_ESDM_HEALTH_TESTS_BATCHED */
+
+static inline bool esdm_irq_health_batched(void)
+{
+	return false;
+}
+
+static inline void esdm_irq_batch_skip(u32 next)
+{
+}
+
+#endif /* CONFIG_ESDM_HEALTH_TESTS_BATCHED */
+
+#ifdef CONFIG_ESDM_IRQ_DEFERRED_COMPRESSION
+/*
+ * Second buffer of the per-CPU array: a full array is copied into it in
+ * interrupt context and compressed into the per-CPU entropy pool by the work
+ * item. The pending flag is guarded by esdm_irq_lock of the CPU.
+ */
+struct esdm_irq_deferred {
+	u32 array[ESDM_DATA_MAX_ARRAY_SIZE] __aligned(ESDM_KCAPI_ALIGN);
+	struct work_struct work;
+	int cpu;
+#ifdef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+	u32 start; /* First slot of the array to health test */
+#endif
+	bool pending;
+};
+static DEFINE_PER_CPU(struct esdm_irq_deferred, esdm_irq_deferred);
+
+#ifdef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+/*
+ * Health test the second buffer of the given CPU unless done already. The
+ * caller must hold esdm_irq_lock of that CPU.
+ */
+static void esdm_irq_deferred_test(int cpu)
+{
+	struct esdm_irq_deferred *deferred =
+		per_cpu_ptr(&esdm_irq_deferred, cpu);
+
+	if (!deferred->pending || !esdm_irq_health_batched())
+		return;
+
+	esdm_irq_batch_test(deferred->array, deferred->start,
+			    esdm_data_num_values, cpu);
+	deferred->start = esdm_data_num_values;
+}
+
+static void esdm_irq_deferred_move_start(struct esdm_irq_deferred *deferred)
+{
+	deferred->start = this_cpu_read(esdm_irq_batch_start);
+	this_cpu_write(esdm_irq_batch_start, 0);
+}
+
+#else /* CONFIG_ESDM_HEALTH_TESTS_BATCHED */
+
+static inline void esdm_irq_deferred_test(int cpu)
+{
+}
+
+static inline void
+esdm_irq_deferred_move_start(struct esdm_irq_deferred *deferred)
+{
+}
+
+#endif /* CONFIG_ESDM_HEALTH_TESTS_BATCHED */
+
+/*
+ * Compress the second buffer of the given CPU into its entropy pool. The
+ * caller must hold esdm_irq_lock of that CPU.
+ */
+static void esdm_irq_deferred_compress(const struct esdm_hash_cb *hash_cb,
+				       struct esdm_irq_deferred *deferred,
+				       int cpu)
+{
+	struct shash_desc *shash =
+		(struct shash_desc *)per_cpu_ptr(esdm_irq_pool, cpu);
+
+	if (!deferred->pending)
+		return;
+
+	esdm_irq_deferred_test(cpu);
+	if (hash_cb->hash_update(shash, (u8 *)deferred->array,
+				 esdm_data_array_bytes()))
+		pr_warn_ratelimited("Hashing of entropy data failed\n");
+
+	memzero_explicit(deferred->array, sizeof(deferred->array));
+	deferred->pending = false;
+}
+
+/*
+ * Move the pending second buffer of the given CPU into the caller's buffer.
+ * The caller must hold esdm_irq_lock of that CPU.
+ */
+static bool esdm_irq_deferred_take(int cpu, u32 *array)
+{
+	struct esdm_irq_deferred *deferred =
+		per_cpu_ptr(&esdm_irq_deferred, cpu);
+
+	if (!deferred->pending)
+		return false;
+
+	esdm_irq_deferred_test(cpu);
+	memcpy(array, deferred->array, esdm_data_array_bytes());
+	memzero_explicit(deferred->array, sizeof(deferred->array));
+	deferred->pending = false;
+
+	return true;
+}
+
+static void esdm_irq_deferred_workfn(struct work_struct *work)
+{
+	struct esdm_irq_deferred *deferred =
+		container_of(work, struct esdm_irq_deferred, work);
+	spinlock_t *lock = per_cpu_ptr(&esdm_irq_lock, deferred->cpu);
+	unsigned long flags, flags2;
+
+	read_lock_irqsave(&esdm_hash_lock, flags);
+	if (esdm_irq_hash_state && esdm_irq_pool_online(deferred->cpu)) {
+		spin_lock_irqsave(lock, flags2);
+		esdm_irq_deferred_compress(esdm_kcapi_hash_cb, deferred,
+					   deferred->cpu);
+		spin_unlock_irqrestore(lock, flags2);
+	}
+	read_unlock_irqrestore(&esdm_hash_lock, flags);
+}
+
+/*
+ * Hand the full per-CPU array to the work item. Returns false if the previous
+ * array is still pending, i.e. the caller must compress it in place. The
+ * caller must hold esdm_irq_lock of the local CPU.
+ */
+static bool esdm_irq_deferred_queue(void)
+{
+	struct esdm_irq_deferred *deferred = this_cpu_ptr(&esdm_irq_deferred);
+
+	if (deferred->pending)
+		return false;
+
+	memcpy(deferred->array, this_cpu_read(esdm_irq_array),
+	       esdm_data_array_bytes());
+	esdm_irq_deferred_move_start(deferred);
+	deferred->pending = true;
+	queue_work_on(smp_processor_id(), system_wq, &deferred->work);
+
+	return true;
+}
+
+static void esdm_irq_deferred_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu (cpu) {
+		struct esdm_irq_deferred *deferred =
+			per_cpu_ptr(&esdm_irq_deferred, cpu);
+
+		INIT_WORK(&deferred->work, esdm_irq_deferred_workfn);
+		deferred->cpu = cpu;
+	}
+}
+
+/* Drop the data handed to the work item of the given CPU */
+static void esdm_irq_deferred_cancel(int cpu)
+{
+	struct esdm_irq_deferred *deferred =
+		per_cpu_ptr(&esdm_irq_deferred, cpu);
+
+	cancel_work_sync(&deferred->work);
+	memzero_explicit(deferred->array, sizeof(deferred->array));
+	deferred->pending = false;
+}
+
+static void esdm_irq_deferred_fini(void)
+{
+	int cpu;
+
+	for_each_possible_cpu (cpu)
+		esdm_irq_deferred_cancel(cpu);
+}
+
+/*
+ * Compress a pending second buffer of the local CPU before the array is
+ * handled in interrupt context to keep the order of the health tests. The
+ * caller must hold esdm_irq_lock of the local CPU.
+ */
+static void esdm_irq_deferred_flush(const struct esdm_hash_cb *hash_cb)
+{
+	esdm_irq_deferred_compress(hash_cb, this_cpu_ptr(&esdm_irq_deferred),
+				   smp_processor_id());
+}
+
+#else /* CONFIG_ESDM_IRQ_DEFERRED_COMPRESSION */
+
+static inline void esdm_irq_deferred_flush(const struct esdm_hash_cb *hash_cb)
+{
+}
+
+static inline void esdm_irq_deferred_test(int cpu)
+{
+}
+
+static inline bool esdm_irq_deferred_take(int cpu, u32 *array)
+{
+	return false;
+}
+
+static inline bool esdm_irq_deferred_queue(void)
+{
+	return false;
+}
+
+static inline void esdm_irq_deferred_init(void)
+{
+}
+
+static inline void esdm_irq_deferred_cancel(int cpu)
+{
+}
+
+static inline void esdm_irq_deferred_fini(void)
+{
+}
+
+#endif /* CONFIG_ESDM_IRQ_DEFERRED_COMPRESSION */
+
+#ifdef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+/*
+ * Health test the full array of the local CPU after a pending second buffer.
+ * The caller must hold esdm_irq_lock of the local CPU.
+ */
+static void esdm_irq_batch_array(const struct esdm_hash_cb *hash_cb)
+{
+	if (!esdm_irq_health_batched())
+		return;
+
+	esdm_irq_deferred_flush(hash_cb);
+	esdm_irq_batch_test(this_cpu_read(esdm_irq_array),
+			    this_cpu_read(esdm_irq_batch_start),
+			    esdm_data_num_values, smp_processor_id());
+	this_cpu_write(esdm_irq_batch_start, 0);
+}
+
+/*
+ * Health test all time stamps of the given CPU received so far before its
+ * pool is read. The caller must hold esdm_irq_lock of that CPU.
+ */
+static void esdm_irq_batch_read(int cpu)
+{
+	u32 *start = per_cpu_ptr(&esdm_irq_batch_start, cpu);
+	/*
+	 * The word holding the current slot may still be written by the
+	 * interrupt handler - it is tested once the array is full.
+	 */
+	u32 end = per_cpu(esdm_irq_array_ptr, cpu) & esdm_data_word_mask() &
+		  ~ESDM_DATA_SLOTS_MASK;
+
+	if (!esdm_irq_health_batched())
+		return;
+
+	esdm_irq_deferred_test(cpu);
+	if (*start < end) {
+		esdm_irq_batch_test(per_cpu(esdm_irq_array, cpu), *start, end,
+				    cpu);
+		*start = end;
+	}
+}
+
+#else /* CONFIG_ESDM_HEALTH_TESTS_BATCHED */
+
+static inline void esdm_irq_batch_array(const struct esdm_hash_cb *hash_cb)
+{
+}
+
+static inline void esdm_irq_batch_read(int cpu)
+{
+}
+
+#endif /* CONFIG_ESDM_HEALTH_TESTS_BATCHED */
+
 static void __init esdm_irq_check_compression_state(void)
 {
 	/* One pool must hold sufficient entropy for disabled compression */
 	if (!esdm_irq_continuous_compression) {
 		u32 max_ent =
 			min_t(u32, esdm_get_digestsize(),
-			      esdm_data_to_entropy(ESDM_DATA_NUM_VALUES,
+			      esdm_data_to_entropy(esdm_data_num_values,
 						   esdm_irq_entropy_bits));
 		if (max_ent < esdm_security_strength()) {
 			pr_warn("Force continuous compression operation to ensure ESDM can hold enough entropy\n");
@@ -266,7 +626,7 @@ static u32 esdm_irq_avail_pool_size(void)
 	int cpu;
 
 	if (!esdm_irq_continuous_compression)
-		max_pool = min_t(u32, max_pool, ESDM_DATA_NUM_VALUES);
+		max_pool = min_t(u32, max_pool, esdm_data_num_values);
 
 	for_each_online_cpu (cpu) {
 		if (esdm_irq_pool_online(cpu))
@@ -292,7 +652,7 @@ static u32 esdm_irq_avail_entropy(u32 __unused)
 	if (!esdm_irq_continuous_compression) {
 		/* Cap to max. number of IRQs the array can hold */
 		digestsize_irqs =
-			min_t(u32, digestsize_irqs, ESDM_DATA_NUM_VALUES);
+			min_t(u32, digestsize_irqs, esdm_data_num_values);
 	}
 
 	for_each_online_cpu (cpu) {
@@ -308,23 +668,68 @@ static u32 esdm_irq_avail_entropy(u32 __unused)
 		esdm_data_to_entropy(irq, esdm_irq_entropy_bits));
 }
 
+/*
+ * Snapshot of one per-CPU pool: the hash state and the not-yet compressed
+ * data are copied while the per-CPU lock is held and compressed afterwards
+ * without the lock and with interrupts enabled. The snapshot of a CPU is only
+ * used while esdm_irq_reader_lock is held.
+ */
+struct esdm_irq_snapshot {
+	u8 pool[ESDM_POOL_SIZE] __aligned(ESDM_KCAPI_ALIGN);
+	u32 array[ESDM_DATA_MAX_ARRAY_SIZE] __aligned(ESDM_KCAPI_ALIGN);
+	u32 deferred[ESDM_DATA_MAX_ARRAY_SIZE] __aligned(ESDM_KCAPI_ALIGN);
+};
+static DEFINE_PER_CPU(struct esdm_irq_snapshot, esdm_irq_snapshot);
+
+/*
+ * Serialize the readers of the per-CPU pools. The lock also guarantees that
+ * the hash state is not released while a reader uses it without holding
+ * esdm_hash_lock.
+ */
+static DEFINE_MUTEX(esdm_irq_reader_lock);
+
+/*
+ * Sparse read: only the pools of CPUs that received interrupts or hold unused
+ * entropy since they were read last are finalized.
+ */
+static bool esdm_irq_pool_stale(int cpu)
+{
+	return !atomic_read_u32(per_cpu_ptr(&esdm_irq_array_irqs, cpu)) &&
+	       READ_ONCE(per_cpu(esdm_irq_array_ptr, cpu)) ==
+		       per_cpu(esdm_irq_read_ptr, cpu);
+}
+
 static u32 esdm_irq_pool_hash_one(const struct esdm_hash_cb *pcpu_hash_cb,
 				  void *pcpu_hash, int cpu, u8 *digest,
 				  u32 *digestsize)
 {
+	struct esdm_irq_snapshot *snap = per_cpu_ptr(&esdm_irq_snapshot, cpu);
 	struct shash_desc *pcpu_shash =
 		(struct shash_desc *)per_cpu_ptr(esdm_irq_pool, cpu);
+	struct shash_desc *snap_shash = (struct shash_desc *)snap->pool;
 	spinlock_t *lock = per_cpu_ptr(&esdm_irq_lock, cpu);
 	unsigned long flags;
 	u32 digestsize_irqs, found_irqs;
+	bool deferred;
+	int ret;
+
+	if (esdm_irq_pool_stale(cpu)) {
+		*digestsize = 0;
+		return 0;
+	}
 
 	/* Lock guarding against reading / writing to per-CPU pool */
 	spin_lock_irqsave(lock, flags);
 
+	per_cpu(esdm_irq_read_ptr, cpu) =
+		READ_ONCE(per_cpu(esdm_irq_array_ptr, cpu));
 	*digestsize = pcpu_hash_cb->hash_digestsize(pcpu_hash);
 	digestsize_irqs =
 		esdm_entropy_to_data(*digestsize << 3, esdm_irq_entropy_bits);
 
+	/* Credit the time stamps not yet health tested */
+	esdm_irq_batch_read(cpu);
+
 	/* Obtain entropy statement like for the entropy pool */
 	found_irqs =
 		atomic_xchg_relaxed(per_cpu_ptr(&esdm_irq_array_irqs, cpu), 0);
@@ -333,22 +738,89 @@ static u32 esdm_irq_pool_hash_one(const struct esdm_hash_cb *pcpu_hash_cb,
 
 	/* Cap to maximum amount of data we can hold in array */
 	if (!esdm_irq_continuous_compression)
-		found_irqs = min_t(u32, found_irqs, ESDM_DATA_NUM_VALUES);
-
-	/* Store all not-yet compressed data in data array into hash, ... */
-	if (pcpu_hash_cb->hash_update(pcpu_shash, (u8 *)per_cpu_ptr(esdm_irq_array, cpu), ESDM_DATA_ARRAY_SIZE * sizeof(u32)) ?:
-		    /* ... get the per-CPU pool digest, ... */
-		    pcpu_hash_cb->hash_final(pcpu_shash, digest) ?:
-		    /* ... re-initialize the hash, ... */
-		    pcpu_hash_cb->hash_init(pcpu_shash, pcpu_hash) ?:
-		    /* ... feed the old hash into the new state. */
-		    pcpu_hash_cb->hash_update(pcpu_shash, digest, *digestsize))
-		found_irqs = 0;
+		found_irqs = min_t(u32, found_irqs, esdm_data_num_values);
+
+	/* Take the per-CPU pool, the data handed to the work item, ... */
+	memcpy(snap->pool, pcpu_shash, sizeof(snap->pool));
+	deferred = esdm_irq_deferred_take(cpu, snap->deferred);
+	/* ... all not-yet compressed data in data array ... */
+	memcpy(snap->array, per_cpu(esdm_irq_array, cpu),
+	       esdm_data_array_bytes());
+	/* ... and swap in a fresh per-CPU pool. */
+	ret = pcpu_hash_cb->hash_init(pcpu_shash, pcpu_hash);
+
+	spin_unlock_irqrestore(lock, flags);
+
+	if (ret)
+		goto err;
+
+	/* Compress the snapshot and get the per-CPU pool digest. */
+	if (deferred) {
+		ret = pcpu_hash_cb->hash_update(snap_shash, (u8 *)snap->deferred,
+						esdm_data_array_bytes());
+		if (ret)
+			goto err;
+	}
+	ret = pcpu_hash_cb->hash_update(snap_shash, (u8 *)snap->array,
+					esdm_data_array_bytes()) ?:
+	      pcpu_hash_cb->hash_final(snap_shash, digest);
+	if (ret)
+		goto err;
 
+	/* Feed the old hash into the new state. */
+	spin_lock_irqsave(lock, flags);
+	ret = pcpu_hash_cb->hash_update(pcpu_shash, digest, *digestsize);
 	spin_unlock_irqrestore(lock, flags);
+	if (ret)
+		goto err;
+
+out:
+	memzero_explicit(snap, sizeof(*snap));
 	return found_irqs;
+
+err:
+	found_irqs = 0;
+	goto out;
+}
+
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+static DEFINE_PER_CPU(struct esdm_pool_hash_slot, esdm_irq_pool_hash_slot);
+
+/* Executed by the CPU owning the pool */
+static u32 esdm_irq_pool_hash_local(const struct esdm_hash_cb *pcpu_hash_cb,
+				    void *pcpu_hash, int cpu, u8 *digest,
+				    u32 *digestsize)
+{
+	*digestsize = 0;
+
+	/* If pool is not online, then no entropy is present. */
+	if (!esdm_irq_pool_online(cpu))
+		return 0;
+
+	return esdm_irq_pool_hash_one(pcpu_hash_cb, pcpu_hash, cpu, digest,
+				      digestsize);
+}
+
+static void esdm_irq_pool_hash_slots_zero(void)
+{
+	int cpu;
+
+	for_each_online_cpu (cpu) {
+		struct esdm_pool_hash_slot *slot =
+			per_cpu_ptr(&esdm_irq_pool_hash_slot, cpu);
+
+		memzero_explicit(slot->digest, sizeof(slot->digest));
+	}
 }
 
+#else /* CONFIG_ESDM_PARALLEL_POOL_HASH */
+
+static inline void esdm_irq_pool_hash_slots_zero(void)
+{
+}
+
+#endif /* CONFIG_ESDM_PARALLEL_POOL_HASH */
+
 /*
  * Hash all per-CPU pools and return the digest to be used as seed data for
  * seeding a DRNG. The caller must guarantee backtracking resistance.
@@ -370,7 +842,7 @@ static void esdm_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 {
 	SHASH_DESC_ON_STACK(shash, NULL);
 	const struct esdm_hash_cb *hash_cb = esdm_kcapi_hash_cb;
-	u8 digest[ESDM_MAX_DIGESTSIZE];
+	u8 digest_buf[ESDM_MAX_DIGESTSIZE], *digest = digest_buf;
 	unsigned long flags;
 	u32 found_irqs, collected_irqs = 0, collected_ent_bits, requested_irqs,
 			returned_ent_bits;
@@ -383,10 +855,16 @@ static void esdm_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 		return;
 	}
 
-	/* Lock guarding replacement of hash */
-	read_lock_irqsave(&esdm_hash_lock, flags);
+	/*
+	 * The hash state cannot be replaced while the reader lock is held -
+	 * esdm_hash_lock is only needed to read the reference.
+	 */
+	mutex_lock(&esdm_irq_reader_lock);
+	cpus_read_lock();
 
+	read_lock_irqsave(&esdm_hash_lock, flags);
 	hash = esdm_irq_hash_state;
+	read_unlock_irqrestore(&esdm_hash_lock, flags);
 	if (!hash)
 		goto out;
 
@@ -400,9 +878,16 @@ static void esdm_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 	requested_irqs = esdm_entropy_to_data(
 		requested_bits + esdm_compress_osr(), esdm_irq_entropy_bits);
 
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+	/* Every CPU compresses its own pool into its digest slot. */
+	esdm_pool_hash_parallel(&esdm_irq_pool_hash_slot,
+				esdm_irq_pool_hash_local, hash_cb, hash);
+#endif
+
 	/*
 	 * Harvest entropy from each per-CPU hash state - even though we may
-	 * have collected sufficient entropy, we will hash all per-CPU pools.
+	 * have collected sufficient entropy, we will hash all per-CPU pools
+	 * that received data since the last read.
 	 */
 	for_each_online_cpu (cpu) {
 		u32 digestsize, pcpu_unused_irqs = 0;
@@ -411,8 +896,19 @@ static void esdm_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 		if (!esdm_irq_pool_online(cpu))
 			continue;
 
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+		{
+			struct esdm_pool_hash_slot *slot =
+				per_cpu_ptr(&esdm_irq_pool_hash_slot, cpu);
+
+			found_irqs = slot->found;
+			digestsize = slot->digestsize;
+			digest = slot->digest;
+		}
+#else
 		found_irqs = esdm_irq_pool_hash_one(hash_cb, hash, cpu, digest,
 						    &digestsize);
+#endif
 
 		/* Inject the digest into the state of all per-CPU pools */
 		ret = hash_cb->hash_update(shash, digest, digestsize);
@@ -432,6 +928,7 @@ static void esdm_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 			found_irqs - pcpu_unused_irqs, cpu, pcpu_unused_irqs);
 	}
 
+	digest = digest_buf;
 	ret = hash_cb->hash_final(shash, digest);
 	if (ret)
 		goto err;
@@ -450,8 +947,10 @@ static void esdm_irq_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 
 out:
 	hash_cb->hash_desc_zero(shash);
-	read_unlock_irqrestore(&esdm_hash_lock, flags);
-	memzero_explicit(digest, sizeof(digest));
+	esdm_irq_pool_hash_slots_zero();
+	cpus_read_unlock();
+	mutex_unlock(&esdm_irq_reader_lock);
+	memzero_explicit(digest_buf, sizeof(digest_buf));
 	return;
 
 err:
@@ -459,6 +958,78 @@ err:
 	goto out;
 }
 
+/********************************** Cost **************************************/
+
+#ifdef CONFIG_ESDM_IRQ_PERF_HISTOGRAM
+
+struct esdm_irq_perf {
+	unsigned long hook[ESDM_ES_PERF_HIST_BUCKETS];
+	unsigned long compress[ESDM_ES_PERF_HIST_BUCKETS];
+};
+static DEFINE_PER_CPU(struct esdm_irq_perf, esdm_irq_perf);
+
+static inline unsigned int esdm_irq_perf_bucket(u32 start)
+{
+	return min_t(unsigned int, fls(random_get_entropy() - start),
+		     ESDM_ES_PERF_HIST_BUCKETS - 1);
+}
+
+static inline u32 esdm_irq_perf_start(void)
+{
+	return random_get_entropy();
+}
+
+static inline void esdm_irq_perf_hook(u32 start)
+{
+	this_cpu_inc(esdm_irq_perf.hook[esdm_irq_perf_bucket(start)]);
+}
+
+static inline void esdm_irq_perf_compress(u32 start)
+{
+	this_cpu_inc(esdm_irq_perf.compress[esdm_irq_perf_bucket(start)]);
+}
+
+int esdm_irq_perf_hist(struct esdm_es_perf_hist *hist)
+{
+	unsigned int i;
+	int cpu;
+
+	memset(hist, 0, sizeof(*hist));
+
+	for_each_possible_cpu(cpu) {
+		struct esdm_irq_perf *perf = per_cpu_ptr(&esdm_irq_perf, cpu);
+
+		for (i = 0; i < ESDM_ES_PERF_HIST_BUCKETS; i++) {
+			hist->hook[i] += READ_ONCE(perf->hook[i]);
+			hist->compress[i] += READ_ONCE(perf->compress[i]);
+		}
+	}
+
+	return 0;
+}
+
+#else /* CONFIG_ESDM_IRQ_PERF_HISTOGRAM */
+
+static inline u32 esdm_irq_perf_start(void)
+{
+	return 0;
+}
+
+static inline void esdm_irq_perf_hook(u32 start)
+{
+}
+
+static inline void esdm_irq_perf_compress(u32 start)
+{
+}
+
+int esdm_irq_perf_hist(struct esdm_es_perf_hist *hist)
+{
+	return -EOPNOTSUPP;
+}
+
+#endif /* CONFIG_ESDM_IRQ_PERF_HISTOGRAM */
+
 /* Compress the esdm_irq_array array into esdm_irq_pool */
 static void esdm_irq_array_compress(void)
 {
@@ -468,6 +1039,7 @@ static void esdm_irq_array_compress(void)
 	spinlock_t *lock = this_cpu_ptr(&esdm_irq_lock);
 	unsigned long flags, flags2;
 	void *hash;
+	u32 start = esdm_irq_perf_start();
 	bool init = false;
 
 	read_lock_irqsave(&esdm_hash_lock, flags);
@@ -490,11 +1062,15 @@ static void esdm_irq_array_compress(void)
 	if (unlikely(init) && hash_cb->hash_init(shash, hash)) {
 		this_cpu_write(esdm_irq_lock_init, false);
 		pr_warn("Initialization of hash failed\n");
-	} else if (esdm_irq_continuous_compression) {
+	} else if (!esdm_irq_continuous_compression) {
+		/* The array is overwritten, only credit its time stamps. */
+		esdm_irq_batch_array(hash_cb);
+	} else if (!esdm_irq_deferred_queue()) {
+		esdm_irq_batch_array(hash_cb);
 		/* Add entire per-CPU data array content into entropy pool. */
 		if (hash_cb->hash_update(shash,
-					 (u8 *)this_cpu_ptr(esdm_irq_array),
-					 ESDM_DATA_ARRAY_SIZE * sizeof(u32)))
+					 (u8 *)this_cpu_read(esdm_irq_array),
+					 esdm_data_array_bytes()))
 			pr_warn_ratelimited("Hashing of entropy data failed\n");
 	}
 
@@ -502,14 +1078,15 @@ static void esdm_irq_array_compress(void)
 
 out:
 	read_unlock_irqrestore(&esdm_hash_lock, flags);
+	esdm_irq_perf_compress(start);
 }
 
 /* Compress data array into hash */
 static void esdm_irq_array_to_hash(u32 ptr)
 {
-	u32 *array = this_cpu_ptr(esdm_irq_array);
+	u32 *array = this_cpu_read(esdm_irq_array);
 
-	if (ptr < ESDM_DATA_WORD_MASK)
+	if (ptr < esdm_data_word_mask())
 		return;
 
 	if (esdm_raw_array_entropy_store(*array)) {
@@ -524,7 +1101,7 @@ static void esdm_irq_array_to_hash(u32 ptr)
 		 */
 		atomic_set(this_cpu_ptr(&esdm_irq_array_irqs), 0);
 
-		for (i = 1; i < ESDM_DATA_ARRAY_SIZE; i++)
+		for (i = 1; i < esdm_data_array_size(); i++)
 			esdm_raw_array_entropy_store(*(array + i));
 	} else {
 		esdm_irq_array_compress();
@@ -538,6 +1115,7 @@ static void esdm_irq_array_to_hash(u32 ptr)
 static void _esdm_irq_array_add_u32(u32 data)
 {
 	/* Increment pointer by number of slots taken for input value */
+	u32 *array = this_cpu_read(esdm_irq_array);
 	u32 pre_ptr, mask,
 		ptr = this_cpu_add_return(esdm_irq_array_ptr,
 					  ESDM_DATA_SLOTS_PER_UINT);
@@ -554,22 +1132,26 @@ static void _esdm_irq_array_add_u32(u32 data)
 	 * the data as otherwise the pointer would immediately wrap when
 	 * injection an u32 word.
 	 */
-	BUILD_BUG_ON(ESDM_DATA_NUM_VALUES <= ESDM_DATA_SLOTS_PER_UINT);
+	BUILD_BUG_ON(ESDM_DATA_MAX_NUM_VALUES <= ESDM_DATA_SLOTS_PER_UINT);
 
 	esdm_data_split_u32(&ptr, &pre_ptr, &mask);
 
 	/* MSB of data go into previous unit */
 	pre_array = esdm_data_idx2array(pre_ptr);
 	/* zeroization of slot to ensure the following OR adds the data */
-	this_cpu_and(esdm_irq_array[pre_array], ~(0xffffffff & ~mask));
-	this_cpu_or(esdm_irq_array[pre_array], data & ~mask);
+	array[pre_array] &= ~(0xffffffff & ~mask);
+	array[pre_array] |= data & ~mask;
 
 	/* Invoke compression as we just filled data array completely */
-	if (unlikely(pre_ptr > ptr))
-		esdm_irq_array_to_hash(ESDM_DATA_WORD_MASK);
+	if (unlikely(pre_ptr > ptr)) {
+		/* The full time stamp is not subject to batched testing */
+		esdm_irq_batch_skip(esdm_data_num_values);
+		esdm_irq_array_to_hash(esdm_data_word_mask());
+	}
 
 	/* LSB of data go into current unit */
-	this_cpu_write(esdm_irq_array[esdm_data_idx2array(ptr)], data & mask);
+	array[esdm_data_idx2array(ptr)] = data & mask;
+	esdm_irq_batch_skip(ptr + 1);
 
 	if (likely(pre_ptr <= ptr))
 		esdm_irq_array_to_hash(ptr);
@@ -578,22 +1160,22 @@ static void _esdm_irq_array_add_u32(u32 data)
 /* Concatenate data of max ESDM_DATA_SLOTSIZE_MASK at the end of time array */
 static void esdm_irq_array_add_slot(u32 data)
 {
+	u32 *array = this_cpu_read(esdm_irq_array);
 	/* Get slot */
-	u32 ptr = this_cpu_inc_return(esdm_irq_array_ptr) & ESDM_DATA_WORD_MASK;
-	unsigned int array = esdm_data_idx2array(ptr);
+	u32 ptr = this_cpu_inc_return(esdm_irq_array_ptr) &
+		  esdm_data_word_mask();
+	unsigned int idx = esdm_data_idx2array(ptr);
 	unsigned int slot = esdm_data_idx2slot(ptr);
 
 	BUILD_BUG_ON(ESDM_DATA_ARRAY_MEMBER_BITS % ESDM_DATA_SLOTSIZE_BITS);
 	/* Ensure consistency of values */
-	BUILD_BUG_ON(ESDM_DATA_ARRAY_MEMBER_BITS != sizeof(esdm_irq_array[0])
-							    << 3);
+	BUILD_BUG_ON(ESDM_DATA_ARRAY_MEMBER_BITS != sizeof(*array) << 3);
 
 	/* zeroization of slot to ensure the following OR adds the data */
-	this_cpu_and(esdm_irq_array[array],
-		     ~(esdm_data_slot_val(0xffffffff & ESDM_DATA_SLOTSIZE_MASK,
-					  slot)));
+	array[idx] &= ~(esdm_data_slot_val(0xffffffff & ESDM_DATA_SLOTSIZE_MASK,
+					   slot));
 	/* Store data into slot */
-	this_cpu_or(esdm_irq_array[array], esdm_data_slot_val(data, slot));
+	array[idx] |= esdm_data_slot_val(data, slot);
 
 	esdm_irq_array_to_hash(ptr);
 }
@@ -615,6 +1197,15 @@ static void esdm_time_process_common(u32 time, void (*add_time)(u32 data))
 	add_time(time);
 }
 
+/* The health tests are applied once the array is full */
+static void esdm_time_process_batched(u32 time)
+{
+	if (esdm_raw_hires_entropy_store(time))
+		return;
+
+	esdm_irq_array_add_slot(time);
+}
+
 /*
  * Batching up of entropy in per-CPU array before injecting into entropy pool.
  */
@@ -626,6 +1217,9 @@ static void esdm_time_process(void)
 		/* When GCD is unknown, we process the full time stamp */
 		esdm_time_process_common(now_time, _esdm_irq_array_add_u32);
 		esdm_gcd_add_value(now_time);
+	} else if (esdm_irq_health_batched()) {
+		esdm_time_process_batched((now_time / esdm_gcd_get()) &
+					  ESDM_DATA_SLOTSIZE_MASK);
 	} else {
 		/* GCD is known and applied */
 		esdm_time_process_common((now_time / esdm_gcd_get()) &
@@ -634,11 +1228,16 @@ static void esdm_time_process(void)
 	}
 
 	esdm_perf_time(now_time);
+	esdm_irq_perf_hook(now_time);
 }
 
 /* Hot code path - Callback for interrupt handler */
 static void esdm_add_interrupt_randomness(int irq)
 {
+	/* The CPU is not yet set up by esdm_irq_cpu_online */
+	if (unlikely(!this_cpu_read(esdm_irq_array)))
+		return;
+
 	if (esdm_highres_timer()) {
 		esdm_time_process();
 	} else {
@@ -679,20 +1278,29 @@ static void esdm_add_interrupt_randomness(int irq)
 static void esdm_irq_es_state(unsigned char *buf, size_t buflen)
 {
 	const struct esdm_hash_cb *hash_cb = esdm_kcapi_hash_cb;
+	unsigned long flags;
+	u32 avail = esdm_irq_avail_entropy(0);
+
+	/* The hash state is not released while the implementation is read */
+	read_lock_irqsave(&esdm_hash_lock, flags);
 
 	/* Assume the esdm_drng_init lock is taken by caller */
 	snprintf(buf, buflen,
 		 " Hash for operating entropy pool: %s\n"
+		 " Hash implementation: %s\n"
 		 " Available entropy: %u\n"
 		 " per-CPU interrupt collection size: %u\n"
 		 " Standards compliance: %s\n"
 		 " High-resolution timer: %s\n"
 		 " Continuous compression: %s\n",
-		 hash_cb->hash_name(), esdm_irq_avail_entropy(0),
-		 ESDM_DATA_NUM_VALUES,
+		 hash_cb->hash_name(),
+		 hash_cb->hash_driver_name(esdm_irq_hash_state), avail,
+		 esdm_data_num_values,
 		 esdm_sp80090b_compliant(esdm_int_es_irq) ? "SP800-90B " : "",
 		 esdm_highres_timer() ? "true" : "false",
 		 esdm_irq_continuous_compression ? "true" : "false");
+
+	read_unlock_irqrestore(&esdm_hash_lock, flags);
 }
 
 static void esdm_irq_set_entropy_rate(u32 rate)
@@ -710,6 +1318,63 @@ struct esdm_es_cb esdm_es_irq = {
 	.set_entropy_rate = esdm_irq_set_entropy_rate,
 };
 
+/****************************** CPU hotplug ***********************************/
+
+/* Allocate the data array of a CPU coming online, executed on that CPU */
+static int esdm_irq_cpu_online(unsigned int cpu)
+{
+	u32 *array = kzalloc_node(esdm_data_array_bytes(), GFP_KERNEL,
+				  cpu_to_node(cpu));
+
+	if (!array)
+		return -ENOMEM;
+
+	/* Same state as when the module is loaded */
+	per_cpu(esdm_irq_array_ptr, cpu) = 0;
+	per_cpu(esdm_irq_read_ptr, cpu) = 0;
+#ifdef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+	per_cpu(esdm_irq_batch_start, cpu) = 1;
+#endif
+
+	/* Publish the array to the interrupt handler */
+	WRITE_ONCE(per_cpu(esdm_irq_array, cpu), array);
+
+	return 0;
+}
+
+/*
+ * Release the data array and the pool of a CPU going offline, executed on that
+ * CPU. The collected data of the CPU is discarded. The readers of the pools
+ * hold cpus_read_lock and thus cannot access the CPU concurrently.
+ */
+static int esdm_irq_cpu_offline(unsigned int cpu)
+{
+	spinlock_t *lock = per_cpu_ptr(&esdm_irq_lock, cpu);
+	unsigned long flags;
+	u32 *array;
+
+	/* The interrupt handler of this CPU either sees the array or NULL */
+	local_irq_save(flags);
+	array = this_cpu_read(esdm_irq_array);
+	this_cpu_write(esdm_irq_array, NULL);
+	local_irq_restore(flags);
+
+	esdm_irq_deferred_cancel(cpu);
+
+	if (esdm_irq_pool_online(cpu)) {
+		spin_lock_irqsave(lock, flags);
+		per_cpu(esdm_irq_lock_init, cpu) = false;
+		memzero_explicit(per_cpu_ptr(esdm_irq_pool, cpu),
+				 ESDM_POOL_SIZE);
+		spin_unlock_irqrestore(lock, flags);
+	}
+
+	atomic_set(per_cpu_ptr(&esdm_irq_array_irqs, cpu), 0);
+	kfree_sensitive(array);
+
+	return 0;
+}
+
 /************************** Registration with Kernel **************************/
 
 /* Initialization state of the module to prevent races with the exit code. */
@@ -750,12 +1415,24 @@ static void esdm_es_irq_set_callbackfn(struct work_struct *work)
 		goto err;
 	}
 
+	esdm_irq_deferred_init();
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "esdm/es_irq:online",
+				esdm_irq_cpu_online, esdm_irq_cpu_offline);
+	if (ret < 0) {
+		pr_warn("could not set up ESDM IRQ ES CPU hotplug (%d)\n", ret);
+		hash_cb->hash_dealloc(tmp_hash_state);
+		goto err;
+	}
+	esdm_irq_cpuhp_state = ret;
+
 	write_lock_irqsave(&esdm_hash_lock, flags);
 	esdm_irq_hash_state = tmp_hash_state;
 	ret = esdm_irq_register(esdm_add_interrupt_randomness);
 	if (ret) {
 		esdm_irq_hash_state = NULL;
 		write_unlock_irqrestore(&esdm_hash_lock, flags);
+		cpuhp_remove_state(esdm_irq_cpuhp_state);
 		hash_cb->hash_dealloc(tmp_hash_state);
 		goto err;
 	}
@@ -803,12 +1480,16 @@ void esdm_es_irq_module_exit(void)
 	 * completes. This guarantees that we do not clash with the waiting
 	 * in the init function.
 	 */
+	mutex_lock(&esdm_irq_reader_lock);
 	write_lock_irqsave(&esdm_hash_lock, flags);
 	tmp_hash_state = esdm_irq_hash_state;
 	esdm_irq_hash_state = NULL;
 	esdm_irq_unregister(esdm_add_interrupt_randomness);
 	write_unlock_irqrestore(&esdm_hash_lock, flags);
+	mutex_unlock(&esdm_irq_reader_lock);
 
+	cpuhp_remove_state(esdm_irq_cpuhp_state);
+	esdm_irq_deferred_fini();
 	hash_cb->hash_dealloc(tmp_hash_state);
 
 	pr_info("ESDM IRQ ES unregistered\n");
@@ -12,6 +12,9 @@ int __init esdm_es_irq_module_init(void);
 
 extern struct esdm_es_cb esdm_es_irq;
 
+struct esdm_es_perf_hist;
+int esdm_irq_perf_hist(struct esdm_es_perf_hist *hist);
+
 void __init esdm_irq_es_init(bool highres_timer);
 void esdm_es_irq_module_exit(void);
 
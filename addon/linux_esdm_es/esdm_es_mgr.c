@@ -11,8 +11,14 @@
 #include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 
 #include "esdm_es_ioctl.h"
 #include "esdm_es_mgr.h"
@@ -36,8 +42,44 @@ MODULE_PARM_DESC(esdm_major, "ESDM major device number");
 
 static struct class *esdm_es_class;
 static struct cdev esdm_cdev;
+static struct dentry *esdm_es_debugfs_root;
 static DEFINE_MUTEX(esdm_cdev_lock);
 
+/* Entropy sources available with the batch read and the ring */
+static bool (*const esdm_es_batch_full[ESDM_ES_BATCH_MAX])(void) = {
+	[ESDM_ES_BATCH_IRQ] = esdm_es_mgr_irq_full,
+	[ESDM_ES_BATCH_SCHED] = esdm_es_mgr_sched_full,
+};
+static void (*const esdm_es_batch_get_ent[ESDM_ES_BATCH_MAX])(
+	struct entropy_buf *eb) = {
+	[ESDM_ES_BATCH_IRQ] = esdm_es_mgr_irq_get_ent,
+	[ESDM_ES_BATCH_SCHED] = esdm_es_mgr_sched_get_ent,
+};
+
+/* Interval in which the ring is refilled while it is mapped */
+#define ESDM_ES_RING_INTERVAL HZ
+
+static struct esdm_es_ring *esdm_es_ring;
+static u32 esdm_es_ring_pos[ESDM_ES_BATCH_MAX];
+static atomic_t esdm_es_ring_mapped = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(esdm_es_ring_wait);
+
+/*
+ * Interval in which the ES are checked for holding their requested amount of
+ * entropy while a process polls the device or asked for SIGIO.
+ */
+#define ESDM_ES_AVAIL_INTERVAL (HZ / 10)
+
+static struct fasync_struct *esdm_es_fasync;
+static unsigned long esdm_es_avail_mask;
+static unsigned long esdm_es_avail_gen;
+
+/* State of one open file of the device */
+struct esdm_cdev_file {
+	unsigned long produced;
+	unsigned long avail_gen;
+};
+
 /********************************** Helper ***********************************/
 
 bool esdm_enforce_panic_on_permanent_health_failure(void)
@@ -54,22 +96,281 @@ void esdm_reset_state(enum esdm_internal_es es)
 	pr_debug("reset ESDM ES %u\n", es);
 }
 
+/* Read the entropy of several ES into the user space layout */
+static long esdm_es_mgr_batch_ioctl(unsigned long arg)
+{
+	struct entropy_buf eb __aligned(ESDM_KCAPI_ALIGN);
+	struct esdm_es_batch batch;
+	u32 i;
+	int ret = 0;
+
+	if (copy_from_user(&batch, (void __user *)arg, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.e_size || batch.e_size > ESDM_ES_BATCH_MAX_E_SIZE ||
+	    batch.es_mask & ~GENMASK(ESDM_ES_BATCH_MAX - 1, 0))
+		return -EINVAL;
+
+	for (i = 0; i < ESDM_ES_BATCH_MAX; i++) {
+		u8 __user *block;
+		u32 e_bits, len;
+
+		if (!(batch.es_mask & BIT(i)))
+			continue;
+
+		block = (u8 __user *)u64_to_user_ptr(batch.buf) +
+			batch.offset[i];
+
+		memset(&eb, 0, sizeof(eb));
+		esdm_es_batch_get_ent[i](&eb);
+
+		len = min_t(u32, batch.e_size, sizeof(eb.e));
+
+		/*
+		 * According to SP800-90B table 1, the truncated hash contains
+		 * the amount of entropy of the original hash capped by the
+		 * truncated size.
+		 */
+		e_bits = eb.e_bits;
+		if (len < sizeof(eb.e))
+			e_bits = min_t(u32, e_bits, len << 3);
+
+		if (copy_to_user(block, eb.e, len) ||
+		    clear_user(block + len, batch.e_size - len) ||
+		    copy_to_user(block + batch.e_size, &e_bits,
+				 sizeof(e_bits))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	memzero_explicit(&eb, sizeof(eb));
+	return ret;
+}
+
+/*********************************** Ring ************************************/
+
+/* Write a new block of the ES into its next slot of the ring */
+static void esdm_es_ring_fill(u32 es, struct entropy_buf *eb)
+{
+	struct esdm_es_ring_slot *slot;
+	u64 gen;
+
+	memset(eb, 0, sizeof(*eb));
+	esdm_es_batch_get_ent[es](eb);
+	if (!eb->e_bits)
+		return;
+
+	slot = &esdm_es_ring->slot[es][esdm_es_ring_pos[es]];
+	esdm_es_ring_pos[es] = (esdm_es_ring_pos[es] + 1) % ESDM_ES_RING_SLOTS;
+	gen = esdm_es_ring->produced + 1;
+
+	WRITE_ONCE(slot->seq, (gen << 1) | 1);
+	smp_wmb();
+	memcpy(slot->e, eb->e, sizeof(eb->e));
+	WRITE_ONCE(slot->e_bits, eb->e_bits);
+	smp_wmb();
+	WRITE_ONCE(slot->seq, gen << 1);
+	WRITE_ONCE(esdm_es_ring->produced, gen);
+}
+
+static void esdm_es_ring_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(esdm_es_ring_work, esdm_es_ring_workfn);
+
+/* Refill the ring from all ES holding their requested amount of entropy */
+static void esdm_es_ring_workfn(struct work_struct *work)
+{
+	struct entropy_buf eb __aligned(ESDM_KCAPI_ALIGN);
+	u64 produced;
+	u32 i;
+
+	mutex_lock(&esdm_cdev_lock);
+
+	produced = esdm_es_ring->produced;
+	for (i = 0; i < ESDM_ES_BATCH_MAX; i++) {
+		if (esdm_es_batch_full[i]())
+			esdm_es_ring_fill(i, &eb);
+	}
+
+	if (produced != esdm_es_ring->produced)
+		wake_up_interruptible(&esdm_es_ring_wait);
+
+	mutex_unlock(&esdm_cdev_lock);
+
+	memzero_explicit(&eb, sizeof(eb));
+
+	if (atomic_read(&esdm_es_ring_mapped))
+		schedule_delayed_work(&esdm_es_ring_work,
+				      ESDM_ES_RING_INTERVAL);
+}
+
+/******************************* Notification ********************************/
+
+static void esdm_es_avail_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(esdm_es_avail_work, esdm_es_avail_workfn);
+
+static bool esdm_es_avail_listeners(void)
+{
+	return wq_has_sleeper(&esdm_es_ring_wait) || READ_ONCE(esdm_es_fasync);
+}
+
+/*
+ * Notify pollers and SIGIO receivers when an ES crosses the threshold of its
+ * requested amount of entropy aggregated over all CPUs. Only the transition
+ * to a full ES is reported, the ES must be drained before it is reported
+ * again.
+ */
+static void esdm_es_avail_workfn(struct work_struct *work)
+{
+	unsigned long mask = 0;
+	u32 i;
+	bool listeners;
+
+	mutex_lock(&esdm_cdev_lock);
+
+	for (i = 0; i < ESDM_ES_BATCH_MAX; i++) {
+		if (esdm_es_batch_full[i]())
+			mask |= BIT(i);
+	}
+
+	if (mask & ~esdm_es_avail_mask) {
+		WRITE_ONCE(esdm_es_avail_gen, esdm_es_avail_gen + 1);
+		wake_up_interruptible(&esdm_es_ring_wait);
+		kill_fasync(&esdm_es_fasync, SIGIO, POLL_IN);
+	}
+
+	/* Report the ES holding entropy again once somebody listens */
+	listeners = esdm_es_avail_listeners();
+	esdm_es_avail_mask = listeners ? mask : 0;
+
+	mutex_unlock(&esdm_cdev_lock);
+
+	if (listeners)
+		schedule_delayed_work(&esdm_es_avail_work,
+				      ESDM_ES_AVAIL_INTERVAL);
+}
+
+/*
+ * Stop filling the ring and zeroize it when it is unmapped. The next process
+ * mapping the ring must not see the blocks of the previous one.
+ */
+static void esdm_es_ring_vm_close(struct vm_area_struct *vma)
+{
+	cancel_delayed_work_sync(&esdm_es_ring_work);
+
+	mutex_lock(&esdm_cdev_lock);
+	memzero_explicit(esdm_es_ring->slot, sizeof(esdm_es_ring->slot));
+	esdm_es_ring->produced = 0;
+	memset(esdm_es_ring_pos, 0, sizeof(esdm_es_ring_pos));
+	mutex_unlock(&esdm_cdev_lock);
+
+	atomic_set(&esdm_es_ring_mapped, 0);
+}
+
+static const struct vm_operations_struct esdm_es_ring_vm_ops = {
+	.close = esdm_es_ring_vm_close,
+};
+
+static int esdm_cdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int ret;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(sizeof(*esdm_es_ring)))
+		return -EINVAL;
+
+	/* The ring is read-only for user space */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	/* Only one process may consume the blocks of the ring */
+	if (atomic_cmpxchg(&esdm_es_ring_mapped, 0, 1))
+		return -EBUSY;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 3, 0)
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND;
+#else
+	vm_flags_mod(vma, VM_DONTCOPY | VM_DONTEXPAND, VM_MAYWRITE);
+#endif
+
+	ret = remap_vmalloc_range(vma, esdm_es_ring, 0);
+	if (ret) {
+		atomic_set(&esdm_es_ring_mapped, 0);
+		return ret;
+	}
+
+	vma->vm_ops = &esdm_es_ring_vm_ops;
+	schedule_delayed_work(&esdm_es_ring_work, 0);
+
+	return 0;
+}
+
+/*
+ * Report new blocks in the ring or ES that reached their requested amount of
+ * entropy since the last time poll(2) reported them to this file.
+ */
+static __poll_t esdm_cdev_poll(struct file *file, poll_table *wait)
+{
+	struct esdm_cdev_file *f = file->private_data;
+	unsigned long produced, avail_gen;
+
+	poll_wait(file, &esdm_es_ring_wait, wait);
+	schedule_delayed_work(&esdm_es_avail_work, 0);
+
+	produced = (unsigned long)READ_ONCE(esdm_es_ring->produced);
+	avail_gen = READ_ONCE(esdm_es_avail_gen);
+	if (produced == f->produced && avail_gen == f->avail_gen)
+		return 0;
+
+	f->produced = produced;
+	f->avail_gen = avail_gen;
+	return EPOLLIN | EPOLLRDNORM;
+}
+
+static int esdm_cdev_fasync(int fd, struct file *file, int on)
+{
+	int ret = fasync_helper(fd, file, on, &esdm_es_fasync);
+
+	if (ret > 0 && on)
+		schedule_delayed_work(&esdm_es_avail_work, 0);
+
+	return ret;
+}
+
 /* Module init: allocate memory, register the device file */
 static int esdm_cdev_open(struct inode *inode, struct file *file)
 {
 	unsigned m = iminor(inode);
-	/* optionally set file->private_data here */
+	struct esdm_cdev_file *f;
+	int ret;
 
 	if (!capable(CAP_SYS_ADMIN))
 		return -EPERM;
 
 	if (m >= ESDM_MAX_MINORS)
 		return -EINVAL;
-	return nonseekable_open(inode, file);
+
+	ret = nonseekable_open(inode, file);
+	if (ret)
+		return ret;
+
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return -ENOMEM;
+
+	/* Only report what happens after the file was opened */
+	f->produced = (unsigned long)READ_ONCE(esdm_es_ring->produced);
+	f->avail_gen = READ_ONCE(esdm_es_avail_gen);
+	file->private_data = f;
+
+	return 0;
 }
 
 static int esdm_cdev_release(struct inode *inode, struct file *file)
 {
+	esdm_cdev_fasync(-1, file, 0);
+	kfree(file->private_data);
 	return 0;
 }
 
@@ -93,6 +394,7 @@ static long esdm_cdev_ioctl(struct file *filp, unsigned int cmd,
 	case ESDM_IRQ_ENT_BUF:
 	case ESDM_IRQ_CONF:
 	case ESDM_IRQ_STATUS:
+	case ESDM_IRQ_PERF_HIST:
 		ret = esdm_es_mgr_irq_ioctl(cmd, arg);
 		break;
 	case ESDM_SCHED_AVAIL_ENTROPY:
@@ -102,6 +404,9 @@ static long esdm_cdev_ioctl(struct file *filp, unsigned int cmd,
 	case ESDM_SCHED_STATUS:
 		ret = esdm_es_mgr_sched_ioctl(cmd, arg);
 		break;
+	case ESDM_ES_ENT_BUF_BATCH:
+		ret = esdm_es_mgr_batch_ioctl(arg);
+		break;
 	default:
 		ret = -ENOIOCTLCMD;
 		break;
@@ -116,6 +421,9 @@ static const struct file_operations esdm_cdev_fops = {
 	.open = esdm_cdev_open,
 	.release = esdm_cdev_release,
 	.unlocked_ioctl = esdm_cdev_ioctl,
+	.mmap = esdm_cdev_mmap,
+	.poll = esdm_cdev_poll,
+	.fasync = esdm_cdev_fasync,
 #if LINUX_VERSION_CODE < KERNEL_VERSION(6, 12, 0)
 	.llseek = no_llseek,
 #endif
@@ -148,6 +456,17 @@ static int __init esdm_es_mgr_dev_init(void)
 	if (ret < 0)
 		goto err;
 
+	BUILD_BUG_ON(sizeof(((struct entropy_buf *)0)->e) >
+		     ESDM_ES_RING_E_SIZE);
+	esdm_es_ring = vmalloc_user(PAGE_ALIGN(sizeof(*esdm_es_ring)));
+	if (!esdm_es_ring) {
+		ret = -ENOMEM;
+		goto err_region;
+	}
+	esdm_es_ring->version = ESDM_ES_RING_VERSION;
+	esdm_es_ring->slots = ESDM_ES_RING_SLOTS;
+	esdm_es_ring->e_size = sizeof(((struct entropy_buf *)0)->e);
+
 	cdev_init(&esdm_cdev, &esdm_cdev_fops);
 	cdev_add(&esdm_cdev, dev, ESDM_MAX_MINORS);
 
@@ -157,6 +476,10 @@ static int __init esdm_es_mgr_dev_init(void)
 		goto err_cdev;
 	}
 
+	/* Failing to create the informational statistics is no error */
+	esdm_es_debugfs_root = debugfs_create_dir("esdm_es_perf", NULL);
+	esdm_es_mgr_irq_debugfs_init(esdm_es_debugfs_root);
+
 	pr_info("ESDM user space interface available (major number %u)\n",
 		esdm_major);
 
@@ -164,6 +487,8 @@ static int __init esdm_es_mgr_dev_init(void)
 
 err_cdev:
 	cdev_del(&esdm_cdev);
+	vfree(esdm_es_ring);
+err_region:
 	unregister_chrdev_region(MKDEV(esdm_major, 0), ESDM_MAX_MINORS);
 err:
 	class_destroy(esdm_es_class);
@@ -184,6 +509,12 @@ static void __exit esdm_es_mgr_dev_fini(void)
 
 	mutex_unlock(&esdm_cdev_lock);
 
+	debugfs_remove_recursive(esdm_es_debugfs_root);
+
+	cancel_delayed_work_sync(&esdm_es_avail_work);
+	cancel_delayed_work_sync(&esdm_es_ring_work);
+	vfree(esdm_es_ring);
+
 	pr_info("ESDM user space interface unavailable\n");
 }
 
@@ -9,6 +9,7 @@
 
 #include <linux/debugfs.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 
 #include "esdm_definitions.h"
 #include "esdm_es_ioctl.h"
@@ -49,7 +50,7 @@ int esdm_es_mgr_irq_ioctl(unsigned int cmd, unsigned long arg)
 
 	case ESDM_IRQ_ENT_BUF:
 		memset(&eb, 0, sizeof(eb));
-		esdm_es_irq.get_ent(&eb, esdm_requested_irq_bits);
+		esdm_es_mgr_irq_get_ent(&eb);
 		if (copy_to_user(argp, &eb, sizeof(eb)))
 			ret = -EFAULT;
 		memzero_explicit(&eb, sizeof(eb));
@@ -86,6 +87,16 @@ int esdm_es_mgr_irq_ioctl(unsigned int cmd, unsigned long arg)
 
 		break;
 
+	case ESDM_IRQ_PERF_HIST: {
+		struct esdm_es_perf_hist hist;
+
+		ret = esdm_irq_perf_hist(&hist);
+		if (!ret && copy_to_user(argp, &hist, sizeof(hist)))
+			ret = -EFAULT;
+
+		break;
+	}
+
 	default:
 		ret = -ENOIOCTLCMD;
 		break;
@@ -94,11 +105,53 @@ int esdm_es_mgr_irq_ioctl(unsigned int cmd, unsigned long arg)
 	return ret;
 }
 
+bool esdm_es_mgr_irq_full(void)
+{
+	return esdm_avail_entropy_irq(esdm_requested_irq_bits) >=
+	       esdm_requested_irq_bits;
+}
+
+void esdm_es_mgr_irq_get_ent(struct entropy_buf *eb)
+{
+	esdm_es_irq.get_ent(eb, esdm_requested_irq_bits);
+}
+
 void esdm_es_mgr_irq_reset(void)
 {
 	esdm_es_irq.reset();
 }
 
+static int esdm_es_mgr_irq_perf_show(struct seq_file *m, void *v)
+{
+	struct esdm_es_perf_hist hist;
+	unsigned int i;
+
+	if (esdm_irq_perf_hist(&hist))
+		return -EOPNOTSUPP;
+
+	seq_puts(m, "cycles below\thook\tcompression\n");
+	for (i = 0; i < ESDM_ES_PERF_HIST_BUCKETS; i++) {
+		if (!hist.hook[i] && !hist.compress[i])
+			continue;
+
+		if (i == ESDM_ES_PERF_HIST_BUCKETS - 1)
+			seq_puts(m, "-");
+		else
+			seq_printf(m, "2^%u", i);
+		seq_printf(m, "\t%llu\t%llu\n", hist.hook[i],
+			   hist.compress[i]);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(esdm_es_mgr_irq_perf);
+
+void esdm_es_mgr_irq_debugfs_init(struct dentry *root)
+{
+	debugfs_create_file("irq", 0400, root, NULL,
+			    &esdm_es_mgr_irq_perf_fops);
+}
+
 int __init esdm_es_mgr_irq_init(void)
 {
 	return esdm_es_irq_module_init();
@@ -7,12 +7,19 @@
 #ifndef _ESDM_ES_MGR_IRQ_H
 #define _ESDM_ES_MGR_IRQ_H
 
+#include "esdm_es_mgr_cb.h"
+
+struct dentry;
+
 #ifdef ESDM_ES_IRQ
 
 int esdm_es_mgr_irq_ioctl(unsigned int cmd, unsigned long arg);
+bool esdm_es_mgr_irq_full(void);
+void esdm_es_mgr_irq_get_ent(struct entropy_buf *eb);
 void esdm_es_mgr_irq_reset(void);
 int __init esdm_es_mgr_irq_init(void);
 void esdm_es_mgr_irq_exit(void);
+void esdm_es_mgr_irq_debugfs_init(struct dentry *root);
 
 #else /* ESDM_ES_IRQ */
 
@@ -21,6 +28,15 @@ static inline int esdm_es_mgr_irq_ioctl(unsigned int cmd, unsigned long arg)
 	return -ENOIOCTLCMD;
 }
 
+static inline bool esdm_es_mgr_irq_full(void)
+{
+	return false;
+}
+
+static inline void esdm_es_mgr_irq_get_ent(struct entropy_buf *eb)
+{
+}
+
 static inline void esdm_es_mgr_irq_reset(void)
 {
 }
@@ -31,6 +47,9 @@ static inline int __init esdm_es_mgr_irq_init(void)
 static inline void esdm_es_mgr_irq_exit(void)
 {
 }
+static inline void esdm_es_mgr_irq_debugfs_init(struct dentry *root)
+{
+}
 
 #endif /* ESDM_ES_IRQ */
 
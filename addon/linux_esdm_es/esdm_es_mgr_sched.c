@@ -49,7 +49,7 @@ int esdm_es_mgr_sched_ioctl(unsigned int cmd, unsigned long arg)
 
 	case ESDM_SCHED_ENT_BUF:
 		memset(&eb, 0, sizeof(eb));
-		esdm_es_sched.get_ent(&eb, esdm_requested_sched_bits);
+		esdm_es_mgr_sched_get_ent(&eb);
 		if (copy_to_user(argp, &eb, sizeof(eb)))
 			ret = -EFAULT;
 		memzero_explicit(&eb, sizeof(eb));
@@ -95,6 +95,17 @@ int esdm_es_mgr_sched_ioctl(unsigned int cmd, unsigned long arg)
 	return ret;
 }
 
+bool esdm_es_mgr_sched_full(void)
+{
+	return esdm_avail_entropy_sched(esdm_requested_sched_bits) >=
+	       esdm_requested_sched_bits;
+}
+
+void esdm_es_mgr_sched_get_ent(struct entropy_buf *eb)
+{
+	esdm_es_sched.get_ent(eb, esdm_requested_sched_bits);
+}
+
 void esdm_es_mgr_sched_reset(void)
 {
 	esdm_es_sched.reset();
@@ -7,9 +7,13 @@
 #ifndef _ESDM_ES_MGR_SCHED_H
 #define _ESDM_ES_MGR_SCHED_H
 
+#include "esdm_es_mgr_cb.h"
+
 #ifdef ESDM_ES_SCHED
 
 int esdm_es_mgr_sched_ioctl(unsigned int cmd, unsigned long arg);
+bool esdm_es_mgr_sched_full(void);
+void esdm_es_mgr_sched_get_ent(struct entropy_buf *eb);
 void esdm_es_mgr_sched_reset(void);
 int __init esdm_es_mgr_sched_init(void);
 void esdm_es_mgr_sched_exit(void);
@@ -21,6 +25,15 @@ static inline int esdm_es_mgr_sched_ioctl(unsigned int cmd, unsigned long arg)
 	return -ENOIOCTLCMD;
 }
 
+static inline bool esdm_es_mgr_sched_full(void)
+{
+	return false;
+}
+
+static inline void esdm_es_mgr_sched_get_ent(struct entropy_buf *eb)
+{
+}
+
 static inline void esdm_es_mgr_sched_reset(void)
 {
 }
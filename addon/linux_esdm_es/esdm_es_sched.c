@@ -10,8 +10,13 @@
 #include <asm/irq_regs.h>
 #include <asm/ptrace.h>
 #include <crypto/hash.h>
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
 #include <linux/esdm_sched.h>
+#include <linux/jump_label.h>
+#include <linux/log2.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/random.h>
 
 #include "esdm_es_mgr_cb.h"
@@ -60,6 +65,25 @@ config ESDM_RUNTIME_ES_CONFIG
  */
 #undef CONFIG_ESDM_RUNTIME_ES_CONFIG
 
+/*
+config ESDM_SCHED_SATURATED_SAMPLING
+	int "Scheduler Entropy Source sampling rate when saturated"
+	depends on ESDM_SCHED
+	range 1 1024
+	default 16
+	help
+	  Once all per-CPU entropy pools hold the maximum amount of
+	  entropy that is credited, only every n-th scheduler event is
+	  processed until the pools are read again. The remaining
+	  events return from the scheduler hook immediately. This
+	  reduces the cost of a context switch while the scheduler
+	  entropy source cannot account for any further entropy.
+
+	  The value must be a power of 2. A value of 1 processes all
+	  scheduler events.
+ */
+#define CONFIG_ESDM_SCHED_SATURATED_SAMPLING 16
+
 /******************************************************************************/
 
 static void *esdm_sched_hash_state = NULL;
@@ -85,11 +109,26 @@ MODULE_PARM_DESC(
 	"How many scheduler-based context switches must be collected for obtaining 256 bits of entropy\n");
 #endif
 
-/* Per-CPU array holding concatenated entropy events */
-static DEFINE_PER_CPU(u32[ESDM_DATA_ARRAY_SIZE], esdm_sched_array)
-	__aligned(ESDM_KCAPI_ALIGN);
+/*
+ * Per-CPU array holding concatenated entropy events - it is allocated when the
+ * CPU comes online and released when it goes offline.
+ */
+static DEFINE_PER_CPU(u32 *, esdm_sched_array) = NULL;
 static DEFINE_PER_CPU(u32, esdm_sched_array_ptr) = 0;
 static DEFINE_PER_CPU(atomic_t, esdm_sched_array_events) = ATOMIC_INIT(0);
+/* Value of esdm_sched_array_ptr when the pool was read last */
+static DEFINE_PER_CPU(u32, esdm_sched_read_ptr) = 0;
+static enum cpuhp_state esdm_sched_cpuhp_state;
+
+/*
+ * The scheduler hook is only processed when the scheduler entropy source is
+ * in use. When all per-CPU pools are saturated, only every
+ * CONFIG_ESDM_SCHED_SATURATED_SAMPLING-th event is processed. Both keys are
+ * only changed from process context.
+ */
+static DEFINE_STATIC_KEY_FALSE(esdm_sched_es_active);
+static DEFINE_STATIC_KEY_FALSE(esdm_sched_es_saturated);
+static DEFINE_PER_CPU(u32, esdm_sched_saturated_events) = 0;
 
 /*
  * Per-CPU entropy pool with compressed entropy event
@@ -109,11 +148,18 @@ static DEFINE_PER_CPU(u8[ESDM_POOL_SIZE], esdm_sched_pool)
 static DEFINE_PER_CPU(spinlock_t, esdm_sched_lock);
 static DEFINE_PER_CPU(bool, esdm_sched_lock_init) = false;
 
+/*
+ * Serialize the readers of the per-CPU pools. The lock also guarantees that
+ * the hash state is not released while a reader uses it without holding
+ * esdm_hash_lock.
+ */
+static DEFINE_MUTEX(esdm_sched_reader_lock);
+
 static void __init esdm_sched_check_compression_state(void)
 {
 	/* One pool should hold sufficient entropy for disabled compression */
 	u32 max_ent = min_t(u32, esdm_get_digestsize(),
-			    esdm_data_to_entropy(ESDM_DATA_NUM_VALUES,
+			    esdm_data_to_entropy(esdm_data_num_values,
 						 esdm_sched_entropy_bits));
 	if (max_ent < esdm_security_strength()) {
 		pr_devel(
@@ -122,6 +168,31 @@ static void __init esdm_sched_check_compression_state(void)
 	}
 }
 
+/*
+ * The scheduler ES is unused when it is credited with no entropy. The raw
+ * entropy and performance tests require all events though.
+ */
+static bool esdm_sched_es_unused(void)
+{
+#if defined(CONFIG_ESDM_RAW_SCHED_HIRES_ENTROPY) ||                   \
+	defined(CONFIG_ESDM_RAW_SCHED_PID_ENTROPY) ||                 \
+	defined(CONFIG_ESDM_RAW_SCHED_START_TIME_ENTROPY) ||          \
+	defined(CONFIG_ESDM_RAW_SCHED_NVCSW_ENTROPY) ||               \
+	defined(CONFIG_ESDM_SCHED_PERF)
+	return false;
+#else
+	return esdm_sched_entropy_bits == ESDM_UINT32_C(4294967295);
+#endif
+}
+
+static void esdm_sched_es_active_set(void)
+{
+	if (esdm_sched_es_unused())
+		static_branch_disable(&esdm_sched_es_active);
+	else
+		static_branch_enable(&esdm_sched_es_active);
+}
+
 void __init esdm_sched_es_init(bool highres_timer)
 {
 	/* Set a minimum number of scheduler events that must be collected */
@@ -145,7 +216,7 @@ void __init esdm_sched_es_init(bool highres_timer)
 static u32 esdm_sched_avail_pool_size(void)
 {
 	u32 max_pool = esdm_get_digestsize(),
-	    max_size = min_t(u32, max_pool, ESDM_DATA_NUM_VALUES);
+	    max_size = min_t(u32, max_pool, esdm_data_num_values);
 	int cpu;
 
 	for_each_online_cpu (cpu)
@@ -159,6 +230,7 @@ static u32 esdm_sched_avail_entropy(u32 __unused)
 {
 	u32 digestsize_events, events = 0;
 	int cpu;
+	bool saturated = true;
 
 	/* Only deliver entropy when SP800-90B self test is completed */
 	if (!esdm_sp80090b_startup_complete_es(esdm_int_es_sched))
@@ -168,12 +240,27 @@ static u32 esdm_sched_avail_entropy(u32 __unused)
 	digestsize_events = esdm_entropy_to_data(esdm_get_digestsize(),
 						 esdm_sched_entropy_bits);
 	/* Cap to max. number of scheduler events the array can hold */
-	digestsize_events = min_t(u32, digestsize_events, ESDM_DATA_NUM_VALUES);
+	digestsize_events = min_t(u32, digestsize_events, esdm_data_num_values);
 
 	for_each_online_cpu (cpu) {
-		events += min_t(u32, digestsize_events,
-				atomic_read_u32(per_cpu_ptr(
-					&esdm_sched_array_events, cpu)));
+		u32 found = atomic_read_u32(
+			per_cpu_ptr(&esdm_sched_array_events, cpu));
+
+		if (found < digestsize_events)
+			saturated = false;
+		events += min_t(u32, digestsize_events, found);
+	}
+
+	/*
+	 * No further entropy is credited: thin out the scheduler events. The
+	 * key is not cleared by esdm_sched_reset as that may be invoked in
+	 * atomic context by the health tests.
+	 */
+	if (saturated != static_key_enabled(&esdm_sched_es_saturated)) {
+		if (saturated)
+			static_branch_enable(&esdm_sched_es_saturated);
+		else
+			static_branch_disable(&esdm_sched_es_saturated);
 	}
 
 	/* Consider oversampling rate */
@@ -196,6 +283,17 @@ static void esdm_sched_reset(void)
 		atomic_set(per_cpu_ptr(&esdm_sched_array_events, cpu), 0);
 }
 
+/*
+ * Sparse read: only the pools of CPUs that received scheduler events or hold
+ * unused entropy since they were read last are finalized.
+ */
+static bool esdm_sched_pool_stale(int cpu)
+{
+	return !atomic_read_u32(per_cpu_ptr(&esdm_sched_array_events, cpu)) &&
+	       READ_ONCE(per_cpu(esdm_sched_array_ptr, cpu)) ==
+		       per_cpu(esdm_sched_read_ptr, cpu);
+}
+
 static u32 esdm_sched_pool_hash_one(const struct esdm_hash_cb *pcpu_hash_cb,
 				    void *pcpu_hash, int cpu, u8 *digest,
 				    u32 *digestsize)
@@ -206,6 +304,12 @@ static u32 esdm_sched_pool_hash_one(const struct esdm_hash_cb *pcpu_hash_cb,
 	unsigned long flags;
 	u32 digestsize_events, found_events;
 
+	*digestsize = 0;
+
+	/* The CPU is not set up by esdm_sched_cpu_online */
+	if (!per_cpu(esdm_sched_array, cpu) || esdm_sched_pool_stale(cpu))
+		return 0;
+
 	if (unlikely(!per_cpu(esdm_sched_lock_init, cpu))) {
 		if (pcpu_hash_cb->hash_init(pcpu_shash, pcpu_hash)) {
 			pr_warn("Initialization of hash failed\n");
@@ -221,6 +325,8 @@ static u32 esdm_sched_pool_hash_one(const struct esdm_hash_cb *pcpu_hash_cb,
 	/* Lock guarding against reading / writing to per-CPU pool */
 	spin_lock_irqsave(lock, flags);
 
+	per_cpu(esdm_sched_read_ptr, cpu) =
+		READ_ONCE(per_cpu(esdm_sched_array_ptr, cpu));
 	*digestsize = pcpu_hash_cb->hash_digestsize(pcpu_hash);
 	digestsize_events =
 		esdm_entropy_to_data(*digestsize << 3, esdm_sched_entropy_bits);
@@ -232,10 +338,10 @@ static u32 esdm_sched_pool_hash_one(const struct esdm_hash_cb *pcpu_hash_cb,
 	found_events = min_t(u32, found_events, digestsize_events);
 
 	/* Cap to maximum amount of data we can hold in array */
-	found_events = min_t(u32, found_events, ESDM_DATA_NUM_VALUES);
+	found_events = min_t(u32, found_events, esdm_data_num_values);
 
 	/* Store all not-yet compressed data in data array into hash, ... */
-	if (pcpu_hash_cb->hash_update(pcpu_shash, (u8 *)per_cpu_ptr(esdm_sched_array, cpu), ESDM_DATA_ARRAY_SIZE * sizeof(u32)) ?:
+	if (pcpu_hash_cb->hash_update(pcpu_shash, (u8 *)per_cpu(esdm_sched_array, cpu), esdm_data_array_bytes()) ?:
 		    /* ... get the per-CPU pool digest, ... */
 		    pcpu_hash_cb->hash_final(pcpu_shash, digest) ?:
 		    /* ... re-initialize the hash, ... */
@@ -248,6 +354,29 @@ static u32 esdm_sched_pool_hash_one(const struct esdm_hash_cb *pcpu_hash_cb,
 	return found_events;
 }
 
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+static DEFINE_PER_CPU(struct esdm_pool_hash_slot, esdm_sched_pool_hash_slot);
+
+static void esdm_sched_pool_hash_slots_zero(void)
+{
+	int cpu;
+
+	for_each_online_cpu (cpu) {
+		struct esdm_pool_hash_slot *slot =
+			per_cpu_ptr(&esdm_sched_pool_hash_slot, cpu);
+
+		memzero_explicit(slot->digest, sizeof(slot->digest));
+	}
+}
+
+#else /* CONFIG_ESDM_PARALLEL_POOL_HASH */
+
+static inline void esdm_sched_pool_hash_slots_zero(void)
+{
+}
+
+#endif /* CONFIG_ESDM_PARALLEL_POOL_HASH */
+
 /*
  * Hash all per-CPU arrays and return the digest to be used as seed data for
  * seeding a DRNG. The caller must guarantee backtracking resistance.
@@ -270,7 +399,7 @@ static void esdm_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 {
 	SHASH_DESC_ON_STACK(shash, NULL);
 	const struct esdm_hash_cb *hash_cb = esdm_kcapi_hash_cb;
-	u8 digest[ESDM_MAX_DIGESTSIZE];
+	u8 digest_buf[ESDM_MAX_DIGESTSIZE], *digest = digest_buf;
 	unsigned long flags;
 	u32 found_events, collected_events = 0, collected_ent_bits,
 			  requested_events, returned_ent_bits;
@@ -283,12 +412,22 @@ static void esdm_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 		return;
 	}
 
-	/* Lock guarding replacement of hash reference */
+	/*
+	 * The hash state cannot be replaced while the reader lock is held -
+	 * esdm_hash_lock is only needed to read the reference.
+	 */
+	mutex_lock(&esdm_sched_reader_lock);
+	cpus_read_lock();
+
 	read_lock_irqsave(&esdm_hash_lock, flags);
 	hash = esdm_sched_hash_state;
+	read_unlock_irqrestore(&esdm_hash_lock, flags);
 	if (!hash)
 		goto out;
 
+	/* The per-CPU pools are drained below - process all events again. */
+	static_branch_disable_cpuslocked(&esdm_sched_es_saturated);
+
 	/* The hash state of filled with all per-CPU pool hashes. */
 	ret = hash_cb->hash_init(shash, hash);
 	if (ret)
@@ -301,13 +440,31 @@ static void esdm_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 
 	/*
 	 * Harvest entropy from each per-CPU hash state - even though we may
-	 * have collected sufficient entropy, we will hash all per-CPU pools.
+	 * have collected sufficient entropy, we will hash all per-CPU pools
+	 * that received data since the last read.
 	 */
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+	/* Every CPU compresses its own pool into its digest slot. */
+	esdm_pool_hash_parallel(&esdm_sched_pool_hash_slot,
+				esdm_sched_pool_hash_one, hash_cb, hash);
+#endif
+
 	for_each_online_cpu (cpu) {
 		u32 digestsize, unused_events = 0;
 
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+		{
+			struct esdm_pool_hash_slot *slot =
+				per_cpu_ptr(&esdm_sched_pool_hash_slot, cpu);
+
+			found_events = slot->found;
+			digestsize = slot->digestsize;
+			digest = slot->digest;
+		}
+#else
 		found_events = esdm_sched_pool_hash_one(hash_cb, hash, cpu,
 							digest, &digestsize);
+#endif
 
 		/* Store all not-yet compressed data in data array into hash */
 		ret = hash_cb->hash_update(shash, digest, digestsize);
@@ -327,6 +484,7 @@ static void esdm_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 			found_events - unused_events, cpu, unused_events);
 	}
 
+	digest = digest_buf;
 	ret = hash_cb->hash_final(shash, digest);
 	if (ret)
 		goto err;
@@ -345,8 +503,10 @@ static void esdm_sched_pool_hash(struct entropy_buf *eb, u32 requested_bits)
 
 out:
 	hash_cb->hash_desc_zero(shash);
-	read_unlock_irqrestore(&esdm_hash_lock, flags);
-	memzero_explicit(digest, sizeof(digest));
+	esdm_sched_pool_hash_slots_zero();
+	cpus_read_unlock();
+	mutex_unlock(&esdm_sched_reader_lock);
+	memzero_explicit(digest_buf, sizeof(digest_buf));
 	return;
 
 err:
@@ -360,6 +520,7 @@ err:
  */
 static void esdm_sched_array_add_u32(u32 data)
 {
+	u32 *array = this_cpu_read(esdm_sched_array);
 	/* Increment pointer by number of slots taken for input value */
 	u32 pre_ptr, mask,
 		ptr = this_cpu_add_return(esdm_sched_array_ptr,
@@ -371,8 +532,8 @@ static void esdm_sched_array_add_u32(u32 data)
 	/* MSB of data go into previous unit */
 	pre_array = esdm_data_idx2array(pre_ptr);
 	/* zeroization of slot to ensure the following OR adds the data */
-	this_cpu_and(esdm_sched_array[pre_array], ~(0xffffffff & ~mask));
-	this_cpu_or(esdm_sched_array[pre_array], data & ~mask);
+	array[pre_array] &= ~(0xffffffff & ~mask);
+	array[pre_array] |= data & ~mask;
 
 	/*
 	 * Continuous compression is not allowed for scheduler noise source,
@@ -380,24 +541,24 @@ static void esdm_sched_array_add_u32(u32 data)
 	 */
 
 	/* LSB of data go into current unit */
-	this_cpu_write(esdm_sched_array[esdm_data_idx2array(ptr)], data & mask);
+	array[esdm_data_idx2array(ptr)] = data & mask;
 }
 
 /* Concatenate data of max ESDM_DATA_SLOTSIZE_MASK at the end of time array */
 static void esdm_sched_array_add_slot(u32 data)
 {
+	u32 *array = this_cpu_read(esdm_sched_array);
 	/* Get slot */
-	u32 ptr =
-		this_cpu_inc_return(esdm_sched_array_ptr) & ESDM_DATA_WORD_MASK;
-	unsigned int array = esdm_data_idx2array(ptr);
+	u32 ptr = this_cpu_inc_return(esdm_sched_array_ptr) &
+		  esdm_data_word_mask();
+	unsigned int idx = esdm_data_idx2array(ptr);
 	unsigned int slot = esdm_data_idx2slot(ptr);
 
 	/* zeroization of slot to ensure the following OR adds the data */
-	this_cpu_and(esdm_sched_array[array],
-		     ~(esdm_data_slot_val(0xffffffff & ESDM_DATA_SLOTSIZE_MASK,
-					  slot)));
+	array[idx] &= ~(esdm_data_slot_val(0xffffffff & ESDM_DATA_SLOTSIZE_MASK,
+					   slot));
 	/* Store data into slot */
-	this_cpu_or(esdm_sched_array[array], esdm_data_slot_val(data, slot));
+	array[idx] |= esdm_data_slot_val(data, slot);
 
 	/*
 	 * Continuous compression is not allowed for scheduler noise source,
@@ -443,6 +604,18 @@ static void esdm_sched_time_process(void)
 
 static void esdm_sched_randomness(const struct task_struct *p, int cpu)
 {
+	if (!static_branch_unlikely(&esdm_sched_es_active))
+		return;
+
+	if (static_branch_unlikely(&esdm_sched_es_saturated) &&
+	    (this_cpu_inc_return(esdm_sched_saturated_events) &
+	     (CONFIG_ESDM_SCHED_SATURATED_SAMPLING - 1)))
+		return;
+
+	/* The CPU is not yet set up by esdm_sched_cpu_online */
+	if (unlikely(!this_cpu_read(esdm_sched_array)))
+		return;
+
 	if (esdm_highres_timer()) {
 		esdm_sched_time_process();
 	} else {
@@ -465,23 +638,36 @@ static void esdm_sched_randomness(const struct task_struct *p, int cpu)
 static void esdm_sched_es_state(unsigned char *buf, size_t buflen)
 {
 	const struct esdm_hash_cb *hash_cb = esdm_kcapi_hash_cb;
+	unsigned long flags;
+	u32 avail = esdm_sched_avail_entropy(0);
+
+	/* The hash state is not released while the implementation is read */
+	read_lock_irqsave(&esdm_hash_lock, flags);
 
 	/* Assume the esdm_drng_init lock is taken by caller */
 	snprintf(buf, buflen,
 		 " Hash for operating entropy pool: %s\n"
+		 " Hash implementation: %s\n"
 		 " Available entropy: %u\n"
 		 " per-CPU scheduler event collection size: %u\n"
 		 " Standards compliance: %s\n"
 		 " High-resolution timer: %s\n",
-		 hash_cb->hash_name(), esdm_sched_avail_entropy(0),
-		 ESDM_DATA_NUM_VALUES,
+		 hash_cb->hash_name(),
+		 hash_cb->hash_driver_name(esdm_sched_hash_state), avail,
+		 esdm_data_num_values,
 		 esdm_sp80090b_compliant(esdm_int_es_sched) ? "SP800-90B " : "",
 		 esdm_highres_timer() ? "true" : "false");
+
+	read_unlock_irqrestore(&esdm_hash_lock, flags);
 }
 
 static void esdm_sched_set_entropy_rate(u32 rate)
 {
 	esdm_sched_entropy_bits = max_t(u32, ESDM_SCHED_ENTROPY_BITS, rate);
+
+	/* The per-CPU cap changed, esdm_sched_avail_entropy re-evaluates it */
+	static_branch_disable(&esdm_sched_es_saturated);
+	esdm_sched_es_active_set();
 }
 
 struct esdm_es_cb esdm_es_sched = {
@@ -494,6 +680,57 @@ struct esdm_es_cb esdm_es_sched = {
 	.set_entropy_rate = esdm_sched_set_entropy_rate,
 };
 
+/****************************** CPU hotplug ***********************************/
+
+/* Allocate the data array of a CPU coming online, executed on that CPU */
+static int esdm_sched_cpu_online(unsigned int cpu)
+{
+	u32 *array = kzalloc_node(esdm_data_array_bytes(), GFP_KERNEL,
+				  cpu_to_node(cpu));
+
+	if (!array)
+		return -ENOMEM;
+
+	per_cpu(esdm_sched_array_ptr, cpu) = 0;
+	per_cpu(esdm_sched_read_ptr, cpu) = 0;
+
+	/* Publish the array to the scheduler hook */
+	WRITE_ONCE(per_cpu(esdm_sched_array, cpu), array);
+
+	return 0;
+}
+
+/*
+ * Release the data array and the pool of a CPU going offline, executed on that
+ * CPU. The collected data of the CPU is discarded. The readers of the pools
+ * hold cpus_read_lock and thus cannot access the CPU concurrently.
+ */
+static int esdm_sched_cpu_offline(unsigned int cpu)
+{
+	spinlock_t *lock = per_cpu_ptr(&esdm_sched_lock, cpu);
+	unsigned long flags;
+	u32 *array;
+
+	/* The scheduler hook of this CPU either sees the array or NULL */
+	local_irq_save(flags);
+	array = this_cpu_read(esdm_sched_array);
+	this_cpu_write(esdm_sched_array, NULL);
+	local_irq_restore(flags);
+
+	if (per_cpu(esdm_sched_lock_init, cpu)) {
+		spin_lock_irqsave(lock, flags);
+		per_cpu(esdm_sched_lock_init, cpu) = false;
+		memzero_explicit(per_cpu_ptr(esdm_sched_pool, cpu),
+				 ESDM_POOL_SIZE);
+		spin_unlock_irqrestore(lock, flags);
+	}
+
+	atomic_set(per_cpu_ptr(&esdm_sched_array_events, cpu), 0);
+	kfree_sensitive(array);
+
+	return 0;
+}
+
 /************************** Registration with Kernel **************************/
 
 int __init esdm_es_sched_module_init(void)
@@ -503,6 +740,8 @@ int __init esdm_es_sched_module_init(void)
 	void *tmp_hash_state;
 	int ret;
 
+	BUILD_BUG_ON(!is_power_of_2(CONFIG_ESDM_SCHED_SATURATED_SAMPLING));
+
 	tmp_hash_state = hash_cb->hash_alloc();
 	if (IS_ERR(tmp_hash_state)) {
 		pr_warn("could not allocate new ESDM pool hash (%ld)\n",
@@ -510,17 +749,30 @@ int __init esdm_es_sched_module_init(void)
 		return PTR_ERR(tmp_hash_state);
 	}
 
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "esdm/es_sched:online",
+				esdm_sched_cpu_online, esdm_sched_cpu_offline);
+	if (ret < 0) {
+		pr_warn("could not set up ESDM Scheduler ES CPU hotplug (%d)\n",
+			ret);
+		hash_cb->hash_dealloc(tmp_hash_state);
+		return ret;
+	}
+	esdm_sched_cpuhp_state = ret;
+
 	write_lock_irqsave(&esdm_hash_lock, flags);
 	esdm_sched_hash_state = tmp_hash_state;
 	ret = esdm_sched_register(esdm_sched_randomness);
 	if (ret) {
 		esdm_sched_hash_state = NULL;
 		write_unlock_irqrestore(&esdm_hash_lock, flags);
+		cpuhp_remove_state(esdm_sched_cpuhp_state);
+		esdm_sched_cpuhp_state = 0;
 		hash_cb->hash_dealloc(esdm_sched_hash_state);
 		return ret;
 	}
 
 	write_unlock_irqrestore(&esdm_hash_lock, flags);
+	esdm_sched_es_active_set();
 	pr_info("ESDM Scheduler ES registered\n");
 
 	return ret;
@@ -531,6 +783,10 @@ void esdm_es_sched_module_exit(void)
 	const struct esdm_hash_cb *hash_cb = esdm_kcapi_hash_cb;
 	unsigned long flags;
 
+	static_branch_disable(&esdm_sched_es_active);
+	static_branch_disable(&esdm_sched_es_saturated);
+
+	mutex_lock(&esdm_sched_reader_lock);
 	write_lock_irqsave(&esdm_hash_lock, flags);
 
 	esdm_sched_unregister(esdm_sched_randomness);
@@ -538,6 +794,13 @@ void esdm_es_sched_module_exit(void)
 	esdm_sched_hash_state = NULL;
 
 	write_unlock_irqrestore(&esdm_hash_lock, flags);
+	mutex_unlock(&esdm_sched_reader_lock);
+
+	/* Not set up if the module initialization failed */
+	if (esdm_sched_cpuhp_state) {
+		cpuhp_remove_state(esdm_sched_cpuhp_state);
+		esdm_sched_cpuhp_state = 0;
+	}
 
 	pr_info("ESDM Scheduler ES unregistered\n");
 }
@@ -8,6 +8,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/gcd.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 
 #include "esdm_es_irq.h"
@@ -18,6 +19,14 @@
 /* Is high-resolution timer present? */
 static bool esdm_highres_timer_val = false;
 
+u32 esdm_data_num_values __read_mostly = ESDM_DATA_MAX_NUM_VALUES;
+
+static u32 collection_size __read_mostly = ESDM_DATA_MAX_NUM_VALUES;
+module_param(collection_size, uint, 0444);
+MODULE_PARM_DESC(
+	collection_size,
+	"Number of events held by each per-CPU entropy collection array (power of 2, at most CONFIG_ESDM_COLLECTION_SIZE)\n");
+
 /* Number of time stamps analyzed to calculate a GCD */
 #define ESDM_GCD_WINDOW_SIZE 100
 static u32 esdm_gcd_history[ESDM_GCD_WINDOW_SIZE];
@@ -118,8 +127,65 @@ bool esdm_highres_timer(void)
 	return esdm_highres_timer_val;
 }
 
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+
+static void esdm_pool_hash_workfn(struct work_struct *work)
+{
+	struct esdm_pool_hash_slot *slot =
+		container_of(work, struct esdm_pool_hash_slot, work);
+
+	slot->found = slot->hash_one(slot->hash_cb, slot->hash, slot->cpu,
+				     slot->digest, &slot->digestsize);
+}
+
+/*
+ * Let every online CPU compress its own pool into its digest slot and wait
+ * for all of them. The caller must prevent CPU hotplug with cpus_read_lock
+ * until it consumed the slots of all online CPUs and must serialize the use of
+ * the slots.
+ */
+void esdm_pool_hash_parallel(struct esdm_pool_hash_slot __percpu *slots,
+			     esdm_pool_hash_one_t hash_one,
+			     const struct esdm_hash_cb *hash_cb, void *hash)
+{
+	int cpu;
+
+	for_each_online_cpu (cpu) {
+		struct esdm_pool_hash_slot *slot = per_cpu_ptr(slots, cpu);
+
+		INIT_WORK(&slot->work, esdm_pool_hash_workfn);
+		slot->hash_one = hash_one;
+		slot->hash_cb = hash_cb;
+		slot->hash = hash;
+		slot->cpu = cpu;
+		slot->found = 0;
+		slot->digestsize = 0;
+		queue_work_on(cpu, system_highpri_wq, &slot->work);
+	}
+
+	for_each_online_cpu (cpu)
+		flush_work(&per_cpu_ptr(slots, cpu)->work);
+}
+
+#endif /* CONFIG_ESDM_PARALLEL_POOL_HASH */
+
+/* Apply the runtime collection size before the entropy sources use it */
+static void __init esdm_data_num_values_init(void)
+{
+	u32 size = clamp_t(u32, collection_size, ESDM_DATA_MIN_NUM_VALUES,
+			   ESDM_DATA_MAX_NUM_VALUES);
+
+	esdm_data_num_values = rounddown_pow_of_two(size);
+	if (esdm_data_num_values != collection_size) {
+		pr_warn("collection size %u not supported, using %u\n",
+			collection_size, esdm_data_num_values);
+	}
+}
+
 int __init esdm_init_time_source(void)
 {
+	esdm_data_num_values_init();
+
 	if ((random_get_entropy() & ESDM_DATA_SLOTSIZE_MASK) ||
 	    (random_get_entropy() & ESDM_DATA_SLOTSIZE_MASK)) {
 		/*
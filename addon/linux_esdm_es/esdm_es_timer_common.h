@@ -30,6 +30,10 @@ choice
 	  The collection size is unrelated to the entropy rate
 	  or the amount of entropy the ESDM can process.
 
+	  The selected size is the maximum: the module parameter
+	  collection_size allows a smaller size to be chosen when
+	  the module is loaded.
+
 	config ESDM_COLLECTION_SIZE_32
 	depends on ESDM_CONTINUOUS_COMPRESSION_ENABLED
 	depends on !ESDM_SWITCHABLE_CONTINUOUS_COMPRESSION
@@ -70,10 +74,33 @@ config ESDM_COLLECTION_SIZE
  */
 #define CONFIG_ESDM_COLLECTION_SIZE 1024
 
+/*
+config ESDM_PARALLEL_POOL_HASH
+	bool "Compress the per-CPU entropy pools in parallel"
+	depends on ESDM_TIMER_COMMON
+	help
+	  When the interrupt or the scheduler entropy source is read,
+	  the per-CPU entropy pools of all CPUs are compressed one
+	  after the other by the reading CPU.
+
+	  When enabling this option, each CPU compresses its own pool
+	  with a work item into a per-CPU digest slot. The reader only
+	  combines the digests which implies that the time to read the
+	  entropy source is largely independent of the number of CPUs.
+
+	  If unsure, say N.
+*/
+#undef CONFIG_ESDM_PARALLEL_POOL_HASH
+
 /******************************************************************************/
 
 /*************************** General ESDM parameter ***************************/
 
+#include <linux/workqueue.h>
+
+#include "esdm_definitions.h"
+#include "esdm_hash_kcapi.h"
+
 /* Helper to concatenate a macro with an integer type */
 #define ESDM_PASTER(x, y) x##y
 #define ESDM_UINT32_C(x) ESDM_PASTER(x, U)
@@ -99,15 +126,43 @@ bool esdm_highres_timer(void);
 	(ESDM_DATA_ARRAY_MEMBER_BITS / ESDM_DATA_SLOTSIZE_BITS)
 
 /*
- * Number of time values to store in the array - in small environments
+ * Maximum number of time values to store in the array - in small environments
  * only one atomic_t variable per CPU is used.
  */
-#define ESDM_DATA_NUM_VALUES (CONFIG_ESDM_COLLECTION_SIZE)
-/* Mask of LSB of time stamp to store */
-#define ESDM_DATA_WORD_MASK (ESDM_DATA_NUM_VALUES - 1)
+#define ESDM_DATA_MAX_NUM_VALUES (CONFIG_ESDM_COLLECTION_SIZE)
+/*
+ * Minimum number of time values selectable at runtime - smaller sizes are
+ * only allowed with continuous compression as enforced by Kconfig.
+ */
+#define ESDM_DATA_MIN_NUM_VALUES min(ESDM_DATA_MAX_NUM_VALUES, 256)
 
 #define ESDM_DATA_SLOTS_MASK (ESDM_DATA_SLOTS_PER_UINT - 1)
-#define ESDM_DATA_ARRAY_SIZE (ESDM_DATA_NUM_VALUES / ESDM_DATA_SLOTS_PER_UINT)
+#define ESDM_DATA_MAX_ARRAY_SIZE                                               \
+	(ESDM_DATA_MAX_NUM_VALUES / ESDM_DATA_SLOTS_PER_UINT)
+
+/*
+ * Number of time values stored in the per-CPU arrays, a power of 2 that is
+ * set once when the module is loaded.
+ */
+extern u32 esdm_data_num_values;
+
+/* Mask of LSB of time stamp to store */
+static inline u32 esdm_data_word_mask(void)
+{
+	return esdm_data_num_values - 1;
+}
+
+/* Number of u32 words of the per-CPU arrays */
+static inline u32 esdm_data_array_size(void)
+{
+	return esdm_data_num_values / ESDM_DATA_SLOTS_PER_UINT;
+}
+
+/* Size of the per-CPU arrays in bytes */
+static inline size_t esdm_data_array_bytes(void)
+{
+	return esdm_data_array_size() * sizeof(u32);
+}
 
 /* Starting bit index of slot */
 static inline unsigned int esdm_data_slot2bitindex(unsigned int slot)
@@ -141,8 +196,8 @@ static inline unsigned int esdm_data_slot_val(unsigned int val,
 static inline void esdm_data_split_u32(u32 *ptr, u32 *pre_ptr, u32 *mask)
 {
 	/* ptr to previous unit */
-	*pre_ptr = (*ptr - ESDM_DATA_SLOTS_PER_UINT) & ESDM_DATA_WORD_MASK;
-	*ptr &= ESDM_DATA_WORD_MASK;
+	*pre_ptr = (*ptr - ESDM_DATA_SLOTS_PER_UINT) & esdm_data_word_mask();
+	*ptr &= esdm_data_word_mask();
 
 	/* mask to split data into the two parts for the two units */
 	*mask = ((1 << (*pre_ptr & (ESDM_DATA_SLOTS_PER_UINT - 1)) *
@@ -150,6 +205,32 @@ static inline void esdm_data_split_u32(u32 *ptr, u32 *pre_ptr, u32 *mask)
 		1;
 }
 
+/*
+ * Compress the pool of one CPU into its digest, returns the number of
+ * entropic events the digest represents.
+ */
+typedef u32 (*esdm_pool_hash_one_t)(const struct esdm_hash_cb *pcpu_hash_cb,
+				    void *pcpu_hash, int cpu, u8 *digest,
+				    u32 *digestsize);
+
+/* Per-CPU digest slot filled by the CPU owning the pool */
+struct esdm_pool_hash_slot {
+	struct work_struct work;
+	esdm_pool_hash_one_t hash_one;
+	const struct esdm_hash_cb *hash_cb;
+	void *hash;
+	int cpu;
+	u32 found;
+	u32 digestsize;
+	u8 digest[ESDM_MAX_DIGESTSIZE];
+};
+
+#ifdef CONFIG_ESDM_PARALLEL_POOL_HASH
+void esdm_pool_hash_parallel(struct esdm_pool_hash_slot __percpu *slots,
+			     esdm_pool_hash_one_t hash_one,
+			     const struct esdm_hash_cb *hash_cb, void *hash);
+#endif
+
 int __init esdm_init_time_source(void);
 
 #endif /* _ESDM_ES_TIMER_COMMON_H */
@@ -9,7 +9,9 @@
 
 #include <crypto/hash.h>
 #include <linux/module.h>
+#include <linux/string.h>
 
+#include "esdm_definitions.h"
 #include "esdm_hash_kcapi.h"
 
 static char *esdm_hash_name = "sha512";
@@ -27,6 +29,13 @@ static const char *esdm_kcapi_hash_name(void)
 	return esdm_hash_name;
 }
 
+static const char *esdm_kcapi_hash_driver_name(void *hash)
+{
+	struct esdm_hash_info *esdm_hash = (struct esdm_hash_info *)hash;
+
+	return esdm_hash ? crypto_shash_driver_name(esdm_hash->tfm) : "none";
+}
+
 static void _esdm_kcapi_hash_free(struct esdm_hash_info *esdm_hash)
 {
 	struct crypto_shash *tfm = esdm_hash->tfm;
@@ -46,12 +55,26 @@ static void *esdm_kcapi_hash_alloc(const char *name)
 		return ERR_PTR(-EINVAL);
 	}
 
+	/*
+	 * The kernel crypto API selects the registered implementation with
+	 * the highest priority, i.e. the accelerated one (AVX2, SHA-NI, ARMv8
+	 * CE, ...) if it is present.
+	 */
 	tfm = crypto_alloc_shash(name, 0, 0);
 	if (IS_ERR(tfm)) {
 		pr_err("could not allocate hash %s\n", name);
 		return ERR_CAST(tfm);
 	}
 
+	/* The per-CPU pools and digest buffers are of fixed size */
+	if (crypto_shash_descsize(tfm) > HASH_MAX_DESCSIZE ||
+	    crypto_shash_digestsize(tfm) > ESDM_MAX_DIGESTSIZE) {
+		pr_err("hash %s exceeds the maximum state or digest size\n",
+		       name);
+		crypto_free_shash(tfm);
+		return ERR_PTR(-EINVAL);
+	}
+
 	ret = sizeof(struct esdm_hash_info);
 	esdm_hash = kmalloc(ret, GFP_KERNEL);
 	if (!esdm_hash) {
@@ -61,7 +84,11 @@ static void *esdm_kcapi_hash_alloc(const char *name)
 
 	esdm_hash->tfm = tfm;
 
-	pr_info("Hash %s allocated\n", name);
+	pr_info("Hash %s allocated with implementation %s\n", name,
+		crypto_shash_driver_name(tfm));
+	if (strstr(crypto_shash_driver_name(tfm), "generic"))
+		pr_info("no accelerated implementation of hash %s available\n",
+			name);
 
 	return esdm_hash;
 }
@@ -114,6 +141,7 @@ static void esdm_kcapi_hash_zero(struct shash_desc *shash)
 
 static const struct esdm_hash_cb _esdm_kcapi_hash_cb = {
 	.hash_name = esdm_kcapi_hash_name,
+	.hash_driver_name = esdm_kcapi_hash_driver_name,
 	.hash_alloc = esdm_kcapi_hash_name_alloc,
 	.hash_dealloc = esdm_kcapi_hash_dealloc,
 	.hash_digestsize = esdm_kcapi_hash_digestsize,
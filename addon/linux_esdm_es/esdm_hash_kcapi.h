@@ -13,6 +13,10 @@
  * struct esdm_hash_cb - cryptographic callback functions defining a hash
  * @hash_name		Name of Hash used for reading entropy pool arbitrary
  *			length
+ * @hash_driver_name	Name of the implementation selected by the kernel
+ *			crypto API for the hash
+ *			hash: is pointer to data structure allocated with
+ *			      hash_alloc
  * @hash_alloc:		Allocate the hash for reading the entropy pool
  *			return: allocated data structure (NULL is success too)
  *				or ERR_PTR on error
@@ -43,6 +47,7 @@
  */
 struct esdm_hash_cb {
 	const char *(*hash_name)(void);
+	const char *(*hash_driver_name)(void *hash);
 	void *(*hash_alloc)(void);
 	void (*hash_dealloc)(void *hash);
 	u32 (*hash_digestsize)(void *hash);
@@ -12,6 +12,7 @@
 
 #include "esdm_es_mgr.h"
 #include "esdm_es_mgr_cb.h"
+#include "esdm_es_timer_common.h"
 #include "esdm_health.h"
 
 /* Stuck Test */
@@ -52,6 +53,7 @@ struct esdm_health_es_state {
 	 ESDM_APT_WINDOW_SIZE)
 	bool sp80090b_startup_done;
 	atomic_t sp80090b_startup_blocks;
+	atomic_t sp80090b_failures; /* Number of startup / runtime failures */
 };
 
 #define ESDM_HEALTH_ES_INIT(x)                                                 \
@@ -60,7 +62,8 @@ struct esdm_health_es_state {
 	x.apt.apt_trigger = ATOMIC_INIT(ESDM_APT_WINDOW_SIZE),                 \
 	x.apt.apt_base_set = false,                                            \
 	x.sp80090b_startup_blocks = ATOMIC_INIT(ESDM_SP80090B_STARTUP_BLOCKS), \
-	x.sp80090b_startup_done = false,
+	x.sp80090b_startup_done = false,                                       \
+	x.sp80090b_failures = ATOMIC_INIT(0),
 
 /* The health test code must operate lock-less */
 struct esdm_health {
@@ -147,6 +150,7 @@ static void esdm_sp80090b_startup_failure(struct esdm_health *health,
 	 */
 	atomic_set(&es_state->sp80090b_startup_blocks,
 		   ESDM_SP80090B_STARTUP_BLOCKS);
+	atomic_inc(&es_state->sp80090b_failures);
 }
 
 /*
@@ -379,16 +383,15 @@ static u32 esdm_delta(u32 prev, u32 next)
  * @return: 0 event occurrence not stuck (good time stamp)
  *	    != 0 event occurrence stuck (reject time stamp)
  */
-static int esdm_irq_stuck(enum esdm_internal_es es, u32 now_time)
+static int esdm_stuck(struct esdm_stuck_test *stuck, u32 now_time)
 {
-	struct esdm_stuck_test *stuck = this_cpu_ptr(esdm_stuck_test_array);
-	u32 delta = esdm_delta(stuck[es].last_time, now_time);
-	u32 delta2 = esdm_delta(stuck[es].last_delta, delta);
-	u32 delta3 = esdm_delta(stuck[es].last_delta2, delta2);
+	u32 delta = esdm_delta(stuck->last_time, now_time);
+	u32 delta2 = esdm_delta(stuck->last_delta, delta);
+	u32 delta3 = esdm_delta(stuck->last_delta2, delta2);
 
-	stuck[es].last_time = now_time;
-	stuck[es].last_delta = delta;
-	stuck[es].last_delta2 = delta2;
+	stuck->last_time = now_time;
+	stuck->last_delta = delta;
+	stuck->last_delta2 = delta2;
 
 	if (!delta || !delta2 || !delta3)
 		return 1;
@@ -396,6 +399,13 @@ static int esdm_irq_stuck(enum esdm_internal_es es, u32 now_time)
 	return 0;
 }
 
+static int esdm_irq_stuck(enum esdm_internal_es es, u32 now_time)
+{
+	struct esdm_stuck_test *stuck = this_cpu_ptr(esdm_stuck_test_array);
+
+	return esdm_stuck(&stuck[es], now_time);
+}
+
 /***************************************************************************
  * Health test interfaces
  ***************************************************************************/
@@ -439,3 +449,261 @@ enum esdm_health_res esdm_health_test(u32 now_time, enum esdm_internal_es es)
 
 	return esdm_health_pass;
 }
+
+#ifdef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+
+/***************************************************************************
+ * Batched health tests
+ *
+ * The time stamps stored in the slots of one array word are spread into the
+ * 16 bit lanes of a u64 which allows the stuck test and the APT comparison to
+ * be performed for all of them at once. As the time stamps have at most
+ * ESDM_DATA_SLOTSIZE_BITS, the first, second and third derivative fit into a
+ * lane without loss, i.e. the results are identical to the per-event test.
+ ***************************************************************************/
+
+#define ESDM_HEALTH_LANE_BITS 16
+#define ESDM_HEALTH_LANE_MASK 0xffffULL
+#define ESDM_HEALTH_LANE_HIGH 0x8000800080008000ULL
+#define ESDM_HEALTH_LANE_LOW 0x7fff7fff7fff7fffULL
+#define ESDM_HEALTH_LANE_ONES 0x0001000100010001ULL
+
+/* Spread the slots of one array word into 16 bit lanes */
+static u64 esdm_health_lanes(u32 word)
+{
+	u64 x = word;
+
+	BUILD_BUG_ON(ESDM_DATA_SLOTS_PER_UINT * ESDM_HEALTH_LANE_BITS !=
+		     sizeof(u64) << 3);
+	BUILD_BUG_ON(ESDM_DATA_SLOTSIZE_BITS != 8);
+
+	x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+	return (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+}
+
+/* Lane-wise subtraction a - b modulo 2^16 */
+static u64 esdm_health_lanes_sub(u64 a, u64 b)
+{
+	return ((a | ESDM_HEALTH_LANE_HIGH) - (b & ESDM_HEALTH_LANE_LOW)) ^
+	       ((a ^ ~b) & ESDM_HEALTH_LANE_HIGH);
+}
+
+/* Return the high bit of every lane that is zero */
+static u64 esdm_health_lanes_zero(u64 x)
+{
+	return ~(((x & ESDM_HEALTH_LANE_LOW) + ESDM_HEALTH_LANE_LOW) | x) &
+	       ESDM_HEALTH_LANE_HIGH;
+}
+
+/* Value of the last lane as (sign-extended) u32 */
+static u32 esdm_health_lanes_last(u64 x)
+{
+	return (u32)(s32)(s16)(x >> (3 * ESDM_HEALTH_LANE_BITS));
+}
+
+static u32 esdm_health_lane(u64 x, unsigned int lane)
+{
+	return (u32)(x >> (lane * ESDM_HEALTH_LANE_BITS)) &
+	       ESDM_DATA_SLOTSIZE_MASK;
+}
+
+static int esdm_health_lane_stuck(u64 stuck_lanes, unsigned int lane)
+{
+	return !!(stuck_lanes & (ESDM_HEALTH_LANE_HIGH &
+				 (ESDM_HEALTH_LANE_MASK
+				  << (lane * ESDM_HEALTH_LANE_BITS))));
+}
+
+/*
+ * The stuck test state can only be continued in lanes if it results from
+ * time stamps in the slot format.
+ */
+static bool esdm_stuck_lanes_usable(const struct esdm_stuck_test *stuck)
+{
+	return stuck->last_time <= ESDM_DATA_SLOTSIZE_MASK &&
+	       (u32)(s32)(s16)stuck->last_delta == stuck->last_delta &&
+	       (u32)(s32)(s16)stuck->last_delta2 == stuck->last_delta2;
+}
+
+/* Stuck test of all lanes - returns the high bit of every stuck lane */
+static u64 esdm_stuck_lanes(struct esdm_stuck_test *stuck, u64 now)
+{
+	u64 delta, delta2, delta3;
+
+	delta = esdm_health_lanes_sub(
+		now, (now << ESDM_HEALTH_LANE_BITS) |
+			     (stuck->last_time & ESDM_HEALTH_LANE_MASK));
+	delta2 = esdm_health_lanes_sub(
+		delta, (delta << ESDM_HEALTH_LANE_BITS) |
+			       (stuck->last_delta & ESDM_HEALTH_LANE_MASK));
+	delta3 = esdm_health_lanes_sub(
+		delta2, (delta2 << ESDM_HEALTH_LANE_BITS) |
+				(stuck->last_delta2 & ESDM_HEALTH_LANE_MASK));
+
+	stuck->last_time = (u32)(now >> (3 * ESDM_HEALTH_LANE_BITS));
+	stuck->last_delta = esdm_health_lanes_last(delta);
+	stuck->last_delta2 = esdm_health_lanes_last(delta2);
+
+	return esdm_health_lanes_zero(delta) | esdm_health_lanes_zero(delta2) |
+	       esdm_health_lanes_zero(delta3);
+}
+
+/* Return the high bit of every lane matching the APT base */
+static u64 esdm_apt_lanes(struct esdm_apt *apt, u64 now)
+{
+	u64 base = (u64)(atomic_read(&apt->apt_base) & ESDM_APT_WORD_MASK);
+
+	return esdm_health_lanes_zero((now ^ (base * ESDM_HEALTH_LANE_ONES)) &
+				      (ESDM_APT_WORD_MASK *
+				       ESDM_HEALTH_LANE_ONES));
+}
+
+static u32 esdm_health_slot(const u32 *array, u32 idx)
+{
+	return (array[esdm_data_idx2array(idx)] >>
+		esdm_data_slot2bitindex(esdm_data_idx2slot(idx))) &
+	       ESDM_DATA_SLOTSIZE_MASK;
+}
+
+static void esdm_health_slot_set(u32 *array, u32 idx, u32 value)
+{
+	u32 *word = &array[esdm_data_idx2array(idx)];
+	unsigned int slot = esdm_data_idx2slot(idx);
+
+	*word &= ~esdm_data_slot_val(ESDM_DATA_SLOTSIZE_MASK, slot);
+	*word |= esdm_data_slot_val(value, slot);
+}
+
+/*
+ * Health test of one time stamp of a batch in the same order as
+ * esdm_health_test - returns true if the time stamp is not stuck.
+ *
+ * A health test failure resets the entropy state of the ES. Like with the
+ * per-event test, only the time stamps following the failure are credited.
+ */
+static bool esdm_health_batch_one(struct esdm_health *health,
+				  enum esdm_internal_es es, u32 value,
+				  int stuck, u32 *passed)
+{
+	atomic_t *failures = &health->es_state[es].sp80090b_failures;
+	int failures_before = atomic_read(failures);
+
+	esdm_apt_insert(health, value, es);
+	esdm_rct(health, es, stuck);
+
+	if (atomic_read(failures) != failures_before)
+		*passed = 0;
+	if (stuck)
+		return false;
+
+	(*passed)++;
+	return true;
+}
+
+/*
+ * Perform the health tests on the time stamps held by the slots [start, end)
+ * of the array of the given CPU. The caller must prevent the concurrent
+ * batch processing of the same CPU.
+ *
+ * When SP800-90B compliance is requested, time stamps failing the stuck test
+ * are removed from the array and the freed slots at the end are zeroized.
+ *
+ * @array: per-CPU collection array
+ * @start: first slot to test
+ * @end: slot after the last slot to test
+ * @cpu: CPU the time stamps were collected on
+ * @es: internal entropy source
+ * @return: number of time stamps passing the health tests
+ */
+u32 esdm_health_test_batch(u32 *array, u32 start, u32 end, int cpu,
+			   enum esdm_internal_es es)
+{
+	struct esdm_health *health = &esdm_health;
+	struct esdm_health_es_state *es_state = &health->es_state[es];
+	struct esdm_stuck_test *stuck =
+		&per_cpu_ptr(esdm_stuck_test_array, cpu)[es];
+	struct esdm_apt *apt = &es_state->apt;
+	bool requested = esdm_sp80090b_health_requested();
+	u32 idx = start, dst = start, passed = 0;
+
+	if (!health->health_test_enabled || start >= end)
+		return (start < end) ? end - start : 0;
+
+	while (idx < end) {
+		u64 now, stuck_lanes;
+		unsigned int lane;
+
+		/* Time stamps not covering an entire word are tested singly */
+		if (esdm_data_idx2slot(idx) ||
+		    idx + ESDM_DATA_SLOTS_PER_UINT > end ||
+		    !esdm_stuck_lanes_usable(stuck)) {
+			u32 value = esdm_health_slot(array, idx);
+
+			if (esdm_health_batch_one(health, es, value,
+						  esdm_stuck(stuck, value),
+						  &passed)) {
+				if (requested && dst != idx)
+					esdm_health_slot_set(array, dst, value);
+				dst++;
+			}
+			idx++;
+			continue;
+		}
+
+		now = esdm_health_lanes(array[esdm_data_idx2array(idx)]);
+		stuck_lanes = esdm_stuck_lanes(stuck, now);
+
+		/*
+		 * Nothing is stuck, no time stamp matches the APT base and
+		 * the APT window does not end: the RCT is reset and the APT
+		 * window advances without any further per-event operation.
+		 */
+		if (!requested ||
+		    (!stuck_lanes && apt->apt_base_set &&
+		     !esdm_apt_lanes(apt, now) &&
+		     atomic_read(&apt->apt_trigger) >
+			     ESDM_DATA_SLOTS_PER_UINT)) {
+			if (requested) {
+				atomic_sub(ESDM_DATA_SLOTS_PER_UINT,
+					   &apt->apt_trigger);
+				esdm_rct_reset(&es_state->rct);
+			}
+			for (lane = 0; lane < ESDM_DATA_SLOTS_PER_UINT;
+			     lane++, idx++) {
+				if (esdm_health_lane_stuck(stuck_lanes, lane))
+					continue;
+				if (requested && dst != idx) {
+					esdm_health_slot_set(
+						array, dst,
+						esdm_health_lane(now, lane));
+				}
+				dst++;
+				passed++;
+			}
+			continue;
+		}
+
+		for (lane = 0; lane < ESDM_DATA_SLOTS_PER_UINT; lane++, idx++) {
+			u32 value = esdm_health_lane(now, lane);
+
+			if (esdm_health_batch_one(
+				    health, es, value,
+				    esdm_health_lane_stuck(stuck_lanes, lane),
+				    &passed)) {
+				if (dst != idx)
+					esdm_health_slot_set(array, dst, value);
+				dst++;
+			}
+		}
+	}
+
+	/* SP800-90B disallows using a failing health test time stamp */
+	if (requested) {
+		for (; dst < end; dst++)
+			esdm_health_slot_set(array, dst, 0);
+	}
+
+	return passed;
+}
+
+#endif /* CONFIG_ESDM_HEALTH_TESTS_BATCHED */
@@ -64,6 +64,31 @@ config ESDM_APT_CUTOFF_PERMANENT
 	int
 	default 371 if !ESDM_APT_BROKEN
 	default 33 if ESDM_APT_BROKEN
+
+config ESDM_HEALTH_TESTS_BATCHED
+	bool "Perform the health tests on batches of time stamps"
+	depends on ESDM_IRQ && ESDM_HEALTH_TESTS
+	help
+	  Per default, the stuck test, the SP800-90B repetition count
+	  test and the SP800-90B adaptive proportion test are applied
+	  to every time stamp in the interrupt handler.
+
+	  When enabling this option, the interrupt entropy source
+	  applies the health tests to the time stamps stored in the
+	  per-CPU collection array once the array is full or the
+	  entropy pool is read. Four time stamps are tested at once
+	  with word-parallel operations. The time stamps are tested
+	  in the order they were received and the test results as
+	  well as the SP800-90B failure handling are identical to the
+	  per-event testing. Time stamps failing the stuck test are
+	  removed from the array before it is compressed when the
+	  SP800-90B compliance is requested. Interrupts are only
+	  credited with entropy once they passed the tests.
+
+	  The batched testing is only applied with a high-resolution
+	  timer once the GCD of the time stamps is known.
+
+	  If unsure, say N.
  */
 
 #define CONFIG_ESDM_RCT_CUTOFF 31
@@ -72,6 +97,8 @@ config ESDM_APT_CUTOFF_PERMANENT
 #define CONFIG_ESDM_APT_CUTOFF 325
 #define CONFIG_ESDM_APT_CUTOFF_PERMANENT 371
 
+#undef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+
 /******************************************************************************/
 
 enum esdm_health_res {
@@ -84,6 +111,10 @@ bool esdm_sp80090b_startup_complete_es(enum esdm_internal_es es);
 bool esdm_sp80090b_compliant(enum esdm_internal_es es);
 
 enum esdm_health_res esdm_health_test(u32 now_time, enum esdm_internal_es es);
+#ifdef CONFIG_ESDM_HEALTH_TESTS_BATCHED
+u32 esdm_health_test_batch(u32 *array, u32 start, u32 end, int cpu,
+			   enum esdm_internal_es es);
+#endif
 void esdm_health_disable(void);
 
 #endif /* _ESDM_HEALTH_H */
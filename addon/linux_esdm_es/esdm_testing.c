@@ -11,6 +11,7 @@
 #include <linux/bug.h>
 #include <linux/debugfs.h>
 #include <linux/module.h>
+#include <linux/relay.h>
 #include <linux/sched.h>
 #include <linux/sched/signal.h>
 #include <linux/slab.h>
@@ -40,6 +41,10 @@ struct esdm_testing {
 	atomic_t esdm_testing_enabled;
 	spinlock_t lock;
 	wait_queue_head_t read_wait;
+#ifdef CONFIG_ESDM_TESTING_RELAY
+	struct rchan *relay;
+	bool relay_enabled;
+#endif
 };
 
 /*************************** Generic Data Handling ****************************/
@@ -93,6 +98,18 @@ static bool esdm_testing_store(struct esdm_testing *data, u32 value, u32 *boot)
 {
 	unsigned long flags;
 
+#ifdef CONFIG_ESDM_TESTING_RELAY
+	/* The relay channel is per-CPU and does not need the lock */
+	if (READ_ONCE(data->relay_enabled)) {
+		struct rchan *relay = READ_ONCE(data->relay);
+
+		if (relay) {
+			relay_write(relay, &value, sizeof(value));
+			return true;
+		}
+	}
+#endif
+
 	if (!atomic_read(&data->esdm_testing_enabled) && (*boot != 1))
 		return false;
 
@@ -260,6 +277,78 @@ static int esdm_testing_extract_user(struct file *file, char __user *buf,
 	return ret;
 }
 
+/******************************* Relay Export *********************************/
+
+#ifdef CONFIG_ESDM_TESTING_RELAY
+
+static struct dentry *
+esdm_testing_relay_create_buf_file(const char *filename, struct dentry *parent,
+				   umode_t mode, struct rchan_buf *buf,
+				   int *is_global)
+{
+	return debugfs_create_file(filename, mode, parent, buf,
+				   &relay_file_operations);
+}
+
+static int esdm_testing_relay_remove_buf_file(struct dentry *dentry)
+{
+	debugfs_remove(dentry);
+	return 0;
+}
+
+static const struct rchan_callbacks esdm_testing_relay_cb = {
+	.create_buf_file = esdm_testing_relay_create_buf_file,
+	.remove_buf_file = esdm_testing_relay_remove_buf_file,
+};
+
+static void esdm_testing_relay_init(struct esdm_testing *data,
+				    const char *name, struct dentry *root)
+{
+	char fname[64];
+
+	snprintf(fname, sizeof(fname), "%s_relay", name);
+	data->relay = relay_open(fname, root,
+				 CONFIG_ESDM_TESTING_RELAY_SUBBUF_SIZE,
+				 CONFIG_ESDM_TESTING_RELAY_SUBBUFS,
+				 &esdm_testing_relay_cb, NULL);
+	if (!data->relay) {
+		pr_warn("ESDM testing relay channel creation failed: %s\n",
+			name);
+		return;
+	}
+
+	snprintf(fname, sizeof(fname), "%s_relay_enable", name);
+	debugfs_create_bool(fname, 0600, root, &data->relay_enabled);
+}
+
+static void esdm_testing_relay_fini(struct esdm_testing *data)
+{
+	struct rchan *relay = data->relay;
+
+	if (!relay)
+		return;
+
+	/* Wait for all writers in interrupt or scheduler context */
+	WRITE_ONCE(data->relay_enabled, false);
+	WRITE_ONCE(data->relay, NULL);
+	synchronize_rcu();
+	relay_close(relay);
+}
+
+#else /* CONFIG_ESDM_TESTING_RELAY */
+
+static inline void esdm_testing_relay_init(struct esdm_testing *data,
+					   const char *name,
+					   struct dentry *root)
+{
+}
+
+static inline void esdm_testing_relay_fini(struct esdm_testing *data)
+{
+}
+
+#endif /* CONFIG_ESDM_TESTING_RELAY */
+
 /************* Raw High-Resolution IRQ Timer Entropy Data Handling ************/
 
 #ifdef CONFIG_ESDM_RAW_HIRES_ENTROPY
@@ -782,6 +871,21 @@ static const struct file_operations esdm_raw_sched_nvcsw_fops = {
  **************************************************************************/
 
 static struct dentry *esdm_raw_debugfs_root = NULL;
+/* Test interfaces registered with debugfs, at most one per test option */
+#define ESDM_TESTING_MAX_IFACES 12
+static struct esdm_testing *esdm_testing_ifaces[ESDM_TESTING_MAX_IFACES];
+static unsigned int esdm_testing_num_ifaces;
+
+static void esdm_testing_create(const char *name, struct esdm_testing *data,
+				const struct file_operations *fops)
+{
+	debugfs_create_file_unsafe(name, 0400, esdm_raw_debugfs_root, NULL,
+				   fops);
+
+	if (esdm_testing_num_ifaces < ARRAY_SIZE(esdm_testing_ifaces))
+		esdm_testing_ifaces[esdm_testing_num_ifaces++] = data;
+	esdm_testing_relay_init(data, name, esdm_raw_debugfs_root);
+}
 
 int __init esdm_test_init(void)
 {
@@ -795,61 +899,52 @@ int __init esdm_test_init(void)
 	}
 
 #ifdef CONFIG_ESDM_RAW_HIRES_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_hires", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_hires_fops);
+	esdm_testing_create("esdm_raw_hires", &esdm_raw_hires,
+			    &esdm_raw_hires_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_JIFFIES_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_jiffies", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_jiffies_fops);
+	esdm_testing_create("esdm_raw_jiffies", &esdm_raw_jiffies,
+			    &esdm_raw_jiffies_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_IRQ_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_irq", 0400, esdm_raw_debugfs_root,
-				   NULL, &esdm_raw_irq_fops);
+	esdm_testing_create("esdm_raw_irq", &esdm_raw_irq, &esdm_raw_irq_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_RETIP_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_retip", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_retip_fops);
+	esdm_testing_create("esdm_raw_retip", &esdm_raw_retip,
+			    &esdm_raw_retip_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_REGS_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_regs", 0400, esdm_raw_debugfs_root,
-				   NULL, &esdm_raw_regs_fops);
+	esdm_testing_create("esdm_raw_regs", &esdm_raw_regs,
+			    &esdm_raw_regs_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_ARRAY
-	debugfs_create_file_unsafe("esdm_raw_array", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_array_fops);
+	esdm_testing_create("esdm_raw_array", &esdm_raw_array,
+			    &esdm_raw_array_fops);
 #endif
 #ifdef CONFIG_ESDM_IRQ_PERF
-	debugfs_create_file_unsafe("esdm_irq_perf", 0400, esdm_raw_debugfs_root,
-				   NULL, &esdm_irq_perf_fops);
+	esdm_testing_create("esdm_irq_perf", &esdm_irq_perf,
+			    &esdm_irq_perf_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_SCHED_HIRES_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_sched_hires", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_sched_hires_fops);
+	esdm_testing_create("esdm_raw_sched_hires", &esdm_raw_sched_hires,
+			    &esdm_raw_sched_hires_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_SCHED_PID_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_sched_pid", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_sched_pid_fops);
+	esdm_testing_create("esdm_raw_sched_pid", &esdm_raw_sched_pid,
+			    &esdm_raw_sched_pid_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_SCHED_START_TIME_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_sched_starttime", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_sched_starttime_fops);
+	esdm_testing_create("esdm_raw_sched_starttime",
+			    &esdm_raw_sched_starttime,
+			    &esdm_raw_sched_starttime_fops);
 #endif
 #ifdef CONFIG_ESDM_RAW_SCHED_NVCSW_ENTROPY
-	debugfs_create_file_unsafe("esdm_raw_sched_nvcsw", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_raw_sched_nvcsw_fops);
+	esdm_testing_create("esdm_raw_sched_nvcsw", &esdm_raw_sched_nvcsw,
+			    &esdm_raw_sched_nvcsw_fops);
 #endif
 #ifdef CONFIG_ESDM_SCHED_PERF
-	debugfs_create_file_unsafe("esdm_sched_perf", 0400,
-				   esdm_raw_debugfs_root, NULL,
-				   &esdm_sched_perf_fops);
+	esdm_testing_create("esdm_sched_perf", &esdm_sched_perf,
+			    &esdm_sched_perf_fops);
 #endif
 
 	return 0;
@@ -857,5 +952,10 @@ int __init esdm_test_init(void)
 
 void __exit esdm_test_exit(void)
 {
+	unsigned int i;
+
+	for (i = 0; i < esdm_testing_num_ifaces; i++)
+		esdm_testing_relay_fini(esdm_testing_ifaces[i]);
+
 	debugfs_remove_recursive(esdm_raw_debugfs_root);
 }
@@ -217,6 +217,37 @@ config ESDM_SCHED_PERF
 	  the esdm_sched_perf debugfs file. Using the option
 	  esdm_testing.boot_sched_perf=1 the performance data of
 	  the first 1000 entropy events since boot can be sampled.
+
+comment "Test Interface Export"
+
+config ESDM_TESTING_RELAY
+	bool "High-volume export of the test data with relay channels"
+	depends on ESDM_TESTING
+	select RELAY
+	help
+	  Every test interface additionally provides a per-CPU relay
+	  channel with the files <name>_relay<cpu> in the debugfs
+	  directory of the module. They can be read or mmap()ed.
+	  Writing 1 to <name>_relay_enable diverts all samples of the
+	  test interface into the relay channel without taking a lock
+	  or waking up a reader. The data of the relay channel is not
+	  subject to the ring buffer size of the read interface and
+	  allows the collection of millions of samples with minimal
+	  perturbation of the measured system.
+
+	  The samples of one CPU are kept in order. When all
+	  sub-buffers of a CPU are full, new samples are dropped
+	  until the reader consumed a sub-buffer.
+
+config ESDM_TESTING_RELAY_SUBBUF_SIZE
+	int "Size of one relay sub-buffer in bytes"
+	depends on ESDM_TESTING_RELAY
+	default 262144
+
+config ESDM_TESTING_RELAY_SUBBUFS
+	int "Number of relay sub-buffers per CPU"
+	depends on ESDM_TESTING_RELAY
+	default 8
 */
 
 #undef CONFIG_ESDM_RAW_HIRES_ENTROPY
@@ -233,6 +264,10 @@ config ESDM_SCHED_PERF
 #undef CONFIG_ESDM_RAW_SCHED_NVCSW_ENTROPY
 #undef CONFIG_ESDM_SCHED_PERF
 
+#undef CONFIG_ESDM_TESTING_RELAY
+#define CONFIG_ESDM_TESTING_RELAY_SUBBUF_SIZE 262144
+#define CONFIG_ESDM_TESTING_RELAY_SUBBUFS 8
+
 /******************************************************************************/
 
 #ifdef CONFIG_ESDM_RAW_HIRES_ENTROPY
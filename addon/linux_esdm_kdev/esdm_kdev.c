@@ -0,0 +1,695 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause
+/*
+ * ESDM kernel device shim: random devices served by a kernel DRNG which is
+ * seeded by the ESDM server
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/bitops.h>
+#include <linux/capability.h>
+#include <linux/cdev.h>
+#include <linux/device.h>
+#include <linux/fs.h>
+#include <linux/jiffies.h>
+#include <linux/local_lock.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
+#include <linux/wait.h>
+
+#include "esdm_kdev_ioctl.h"
+
+static unsigned int esdm_kdev_reseed_interval = 60;
+module_param(esdm_kdev_reseed_interval, uint, 0644);
+MODULE_PARM_DESC(
+	esdm_kdev_reseed_interval,
+	"Seconds after which the kernel DRNG requests a new seed from the ESDM server");
+
+static int esdm_kdev_major = 0;
+module_param(esdm_kdev_major, int, 0);
+MODULE_PARM_DESC(esdm_kdev_major, "ESDM kernel device major device number");
+
+enum esdm_kdev_minor {
+	esdm_kdev_minor_ctl,
+	esdm_kdev_minor_random,
+	esdm_kdev_minor_urandom,
+	ESDM_KDEV_MAX_MINORS,
+};
+
+static const char *const esdm_kdev_names[ESDM_KDEV_MAX_MINORS] = {
+	[esdm_kdev_minor_ctl] = "esdm_kdev",
+	[esdm_kdev_minor_random] = "esdm_kdev_random",
+	[esdm_kdev_minor_urandom] = "esdm_kdev_urandom",
+};
+
+static struct class *esdm_kdev_class;
+static struct cdev esdm_kdev_cdev[ESDM_KDEV_MAX_MINORS];
+
+/************************************ ChaCha20 ********************************/
+
+/*
+ * The ChaCha20 block function is implemented here instead of using the one of
+ * the kernel as its interface changed between the supported kernel versions.
+ */
+#define ESDM_KDEV_CHACHA20_BLOCK_SIZE 64
+#define ESDM_KDEV_CHACHA20_KEY_WORDS 8
+#define ESDM_KDEV_CHACHA20_KEY_SIZE (ESDM_KDEV_CHACHA20_KEY_WORDS * sizeof(u32))
+
+#define ESDM_KDEV_QR(a, b, c, d)                                               \
+	do {                                                                   \
+		a += b;                                                        \
+		d = rol32(d ^ a, 16);                                          \
+		c += d;                                                        \
+		b = rol32(b ^ c, 12);                                          \
+		a += b;                                                        \
+		d = rol32(d ^ a, 8);                                           \
+		c += d;                                                        \
+		b = rol32(b ^ c, 7);                                           \
+	} while (0)
+
+static void esdm_kdev_chacha20_block(const u32 *key, u64 counter, u8 *out)
+{
+	__le32 *out32 = (__le32 *)out;
+	u32 s[16], x[16];
+	unsigned int i;
+
+	/* "expand 32-byte k" */
+	s[0] = 0x61707865;
+	s[1] = 0x3320646e;
+	s[2] = 0x79622d32;
+	s[3] = 0x6b206574;
+	memcpy(&s[4], key, ESDM_KDEV_CHACHA20_KEY_SIZE);
+	s[12] = (u32)counter;
+	s[13] = (u32)(counter >> 32);
+	s[14] = 0;
+	s[15] = 0;
+
+	memcpy(x, s, sizeof(x));
+	for (i = 0; i < 10; i++) {
+		ESDM_KDEV_QR(x[0], x[4], x[8], x[12]);
+		ESDM_KDEV_QR(x[1], x[5], x[9], x[13]);
+		ESDM_KDEV_QR(x[2], x[6], x[10], x[14]);
+		ESDM_KDEV_QR(x[3], x[7], x[11], x[15]);
+		ESDM_KDEV_QR(x[0], x[5], x[10], x[15]);
+		ESDM_KDEV_QR(x[1], x[6], x[11], x[12]);
+		ESDM_KDEV_QR(x[2], x[7], x[8], x[13]);
+		ESDM_KDEV_QR(x[3], x[4], x[9], x[14]);
+	}
+
+	for (i = 0; i < 16; i++)
+		out32[i] = cpu_to_le32(x[i] + s[i]);
+
+	memzero_explicit(x, sizeof(x));
+	memzero_explicit(s, sizeof(s));
+}
+
+/*
+ * Fast key erasure: the first half of a block replaces the key, the second
+ * half is returned to the caller.
+ */
+static void esdm_kdev_key_erasure(u32 *key, u32 *out)
+{
+	u8 block[ESDM_KDEV_CHACHA20_BLOCK_SIZE] __aligned(sizeof(u32));
+
+	esdm_kdev_chacha20_block(key, 0, block);
+	memcpy(key, block, ESDM_KDEV_CHACHA20_KEY_SIZE);
+	if (out)
+		memcpy(out, block + ESDM_KDEV_CHACHA20_KEY_SIZE,
+		       ESDM_KDEV_CHACHA20_KEY_SIZE);
+	memzero_explicit(block, sizeof(block));
+}
+
+/********************************** Kernel DRNG *******************************/
+
+/*
+ * The base DRNG holds the key seeded by the ESDM server. Every CPU derives its
+ * own key from it when the generation of the base DRNG changed. Thus, reads
+ * on different CPUs do not contend on a lock.
+ */
+static struct {
+	u32 key[ESDM_KDEV_CHACHA20_KEY_WORDS];
+	unsigned long generation;
+	unsigned long seeded_at;
+	bool seeded;
+	bool fully_seeded;
+	bool reseed_wanted;
+	u64 reseeds;
+	spinlock_t lock;
+} esdm_kdev_base = {
+	.lock = __SPIN_LOCK_UNLOCKED(esdm_kdev_base.lock),
+};
+
+struct esdm_kdev_crng {
+	u32 key[ESDM_KDEV_CHACHA20_KEY_WORDS];
+	unsigned long generation;
+	local_lock_t lock;
+};
+
+static DEFINE_PER_CPU(struct esdm_kdev_crng, esdm_kdev_crngs) = {
+	.generation = ULONG_MAX,
+	.lock = INIT_LOCAL_LOCK(esdm_kdev_crngs.lock),
+};
+
+static atomic64_t esdm_kdev_read_bytes = ATOMIC64_INIT(0);
+
+/* Readers waiting for the (full) seeding of the DRNG */
+static DECLARE_WAIT_QUEUE_HEAD(esdm_kdev_seed_wait);
+/* ESDM server waiting for a seed request */
+static DECLARE_WAIT_QUEUE_HEAD(esdm_kdev_ctl_wait);
+
+static bool esdm_kdev_ready(bool fully_seeded)
+{
+	return fully_seeded ? READ_ONCE(esdm_kdev_base.fully_seeded) :
+			      READ_ONCE(esdm_kdev_base.seeded);
+}
+
+/* Ask the ESDM server for a new seed */
+static void esdm_kdev_request_seed(void)
+{
+	spin_lock(&esdm_kdev_base.lock);
+	if (esdm_kdev_base.reseed_wanted) {
+		spin_unlock(&esdm_kdev_base.lock);
+		return;
+	}
+	WRITE_ONCE(esdm_kdev_base.reseed_wanted, true);
+	spin_unlock(&esdm_kdev_base.lock);
+
+	wake_up_interruptible_poll(&esdm_kdev_ctl_wait, EPOLLOUT | EPOLLWRNORM);
+}
+
+static void esdm_kdev_check_reseed(void)
+{
+	unsigned long interval = READ_ONCE(esdm_kdev_reseed_interval) * HZ;
+
+	if (READ_ONCE(esdm_kdev_base.reseed_wanted))
+		return;
+
+	if (!READ_ONCE(esdm_kdev_base.seeded) ||
+	    time_after(jiffies, READ_ONCE(esdm_kdev_base.seeded_at) + interval))
+		esdm_kdev_request_seed();
+}
+
+/*
+ * Fold data into the key of the base DRNG. The data is XORed into the key
+ * which is then replaced by ChaCha20 output generated with it. Caller must
+ * hold the base DRNG lock.
+ */
+static void esdm_kdev_mix_locked(const u8 *data, size_t len)
+{
+	u32 in[ESDM_KDEV_CHACHA20_KEY_WORDS];
+	unsigned int i;
+	size_t todo;
+
+	while (len) {
+		todo = min_t(size_t, len, sizeof(in));
+
+		memset(in, 0, sizeof(in));
+		memcpy(in, data, todo);
+		for (i = 0; i < ESDM_KDEV_CHACHA20_KEY_WORDS; i++)
+			esdm_kdev_base.key[i] ^= in[i];
+		esdm_kdev_key_erasure(esdm_kdev_base.key, NULL);
+
+		data += todo;
+		len -= todo;
+	}
+
+	/* Force all CPUs to derive a new key */
+	WRITE_ONCE(esdm_kdev_base.generation, esdm_kdev_base.generation + 1);
+	if (esdm_kdev_base.generation == ULONG_MAX)
+		WRITE_ONCE(esdm_kdev_base.generation, 0);
+
+	memzero_explicit(in, sizeof(in));
+}
+
+static void esdm_kdev_mix(const u8 *data, size_t len)
+{
+	spin_lock(&esdm_kdev_base.lock);
+	esdm_kdev_mix_locked(data, len);
+	spin_unlock(&esdm_kdev_base.lock);
+}
+
+static void esdm_kdev_seed(const u8 *data, size_t len, bool fully_seeded)
+{
+	spin_lock(&esdm_kdev_base.lock);
+	esdm_kdev_mix_locked(data, len);
+	WRITE_ONCE(esdm_kdev_base.seeded_at, jiffies);
+	WRITE_ONCE(esdm_kdev_base.reseed_wanted, false);
+	esdm_kdev_base.reseeds++;
+	WRITE_ONCE(esdm_kdev_base.seeded, true);
+	/* Once fully seeded, the DRNG stays fully seeded */
+	if (fully_seeded)
+		WRITE_ONCE(esdm_kdev_base.fully_seeded, true);
+	spin_unlock(&esdm_kdev_base.lock);
+
+	wake_up_interruptible_all(&esdm_kdev_seed_wait);
+}
+
+/* Generate a key for one read from the DRNG of the current CPU */
+static void esdm_kdev_make_key(u32 *key)
+{
+	struct esdm_kdev_crng *crng;
+
+	esdm_kdev_check_reseed();
+
+	local_lock(&esdm_kdev_crngs.lock);
+	crng = this_cpu_ptr(&esdm_kdev_crngs);
+
+	if (unlikely(crng->generation !=
+		     READ_ONCE(esdm_kdev_base.generation))) {
+		spin_lock(&esdm_kdev_base.lock);
+		esdm_kdev_key_erasure(esdm_kdev_base.key, crng->key);
+		crng->generation = esdm_kdev_base.generation;
+		spin_unlock(&esdm_kdev_base.lock);
+	}
+
+	esdm_kdev_key_erasure(crng->key, key);
+
+	local_unlock(&esdm_kdev_crngs.lock);
+}
+
+/********************************* Random devices *****************************/
+
+static int esdm_kdev_wait(struct file *file, bool fully_seeded)
+{
+	if (esdm_kdev_ready(fully_seeded))
+		return 0;
+
+	esdm_kdev_request_seed();
+
+	if (file->f_flags & O_NONBLOCK)
+		return -EAGAIN;
+
+	return wait_event_interruptible(esdm_kdev_seed_wait,
+					esdm_kdev_ready(fully_seeded));
+}
+
+static ssize_t esdm_kdev_read_internal(struct file *file, char __user *buf,
+				       size_t nbytes, bool fully_seeded)
+{
+	u8 block[ESDM_KDEV_CHACHA20_BLOCK_SIZE] __aligned(sizeof(u32));
+	u32 key[ESDM_KDEV_CHACHA20_KEY_WORDS];
+	u64 counter = 0;
+	ssize_t ret = 0;
+	size_t todo;
+	int err;
+
+	err = esdm_kdev_wait(file, fully_seeded);
+	if (err)
+		return err;
+
+	if (!nbytes)
+		return 0;
+
+	esdm_kdev_make_key(key);
+
+	while (nbytes) {
+		esdm_kdev_chacha20_block(key, counter++, block);
+
+		todo = min_t(size_t, nbytes, sizeof(block));
+		if (copy_to_user(buf + ret, block, todo)) {
+			if (!ret)
+				ret = -EFAULT;
+			break;
+		}
+
+		nbytes -= todo;
+		ret += todo;
+
+		/* Check for signals and reschedule every 4 kBytes */
+		if (nbytes && !(counter % (PAGE_SIZE / sizeof(block)))) {
+			if (signal_pending(current))
+				break;
+			cond_resched();
+		}
+	}
+
+	memzero_explicit(block, sizeof(block));
+	memzero_explicit(key, sizeof(key));
+
+	if (ret > 0)
+		atomic64_add(ret, &esdm_kdev_read_bytes);
+
+	return ret;
+}
+
+static ssize_t esdm_kdev_random_read(struct file *file, char __user *buf,
+				     size_t nbytes, loff_t *ppos)
+{
+	return esdm_kdev_read_internal(file, buf, nbytes, true);
+}
+
+static ssize_t esdm_kdev_urandom_read(struct file *file, char __user *buf,
+				      size_t nbytes, loff_t *ppos)
+{
+	return esdm_kdev_read_internal(file, buf, nbytes, false);
+}
+
+/*
+ * Written data is mixed into the kernel DRNG without being credited with
+ * entropy. It is not forwarded to the ESDM server.
+ */
+static ssize_t esdm_kdev_write(struct file *file, const char __user *buf,
+			       size_t nbytes, loff_t *ppos)
+{
+	u8 chunk[ESDM_KDEV_CHACHA20_KEY_SIZE];
+	ssize_t ret = 0;
+	size_t todo;
+
+	while (nbytes) {
+		todo = min_t(size_t, nbytes, sizeof(chunk));
+		if (copy_from_user(chunk, buf + ret, todo)) {
+			if (!ret)
+				ret = -EFAULT;
+			break;
+		}
+
+		esdm_kdev_mix(chunk, todo);
+
+		nbytes -= todo;
+		ret += todo;
+
+		if (nbytes) {
+			if (signal_pending(current))
+				break;
+			cond_resched();
+		}
+	}
+
+	memzero_explicit(chunk, sizeof(chunk));
+
+	return ret;
+}
+
+static __poll_t esdm_kdev_poll(struct file *file, poll_table *wait)
+{
+	bool fully_seeded = (iminor(file_inode(file)) ==
+			     esdm_kdev_minor_random);
+
+	poll_wait(file, &esdm_kdev_seed_wait, wait);
+
+	if (esdm_kdev_ready(fully_seeded))
+		return EPOLLIN | EPOLLRDNORM | EPOLLOUT | EPOLLWRNORM;
+	return EPOLLOUT | EPOLLWRNORM;
+}
+
+static long esdm_kdev_add_entropy(const int __user *p)
+{
+	u8 chunk[ESDM_KDEV_CHACHA20_KEY_SIZE];
+	size_t todo, len;
+	int ent_count, size;
+	long ret = 0;
+
+	if (get_user(ent_count, p++) || get_user(size, p++))
+		return -EFAULT;
+	if (ent_count < 0 || size < 0)
+		return -EINVAL;
+
+	/* The entropy count is ignored, the ESDM server credits entropy */
+	for (len = (size_t)size; len; len -= todo) {
+		todo = min_t(size_t, len, sizeof(chunk));
+		if (copy_from_user(chunk, p, todo)) {
+			ret = -EFAULT;
+			break;
+		}
+		esdm_kdev_mix(chunk, todo);
+		p = (const int __user *)((const u8 __user *)p + todo);
+	}
+
+	memzero_explicit(chunk, sizeof(chunk));
+
+	return ret;
+}
+
+/* Subset of the random(4) IOCTLs */
+static long esdm_kdev_ioctl(struct file *file, unsigned int cmd,
+			    unsigned long arg)
+{
+	int __user *p = (int __user *)arg;
+
+	switch (cmd) {
+	case RNDGETENTCNT:
+		return put_user(esdm_kdev_ready(true) ? 256 : 0, p);
+	case RNDADDENTROPY:
+		if (!capable(CAP_SYS_ADMIN))
+			return -EPERM;
+		return esdm_kdev_add_entropy(p);
+	case RNDADDTOENTCNT:
+	case RNDZAPENTCNT:
+	case RNDCLEARPOOL:
+		/* The kernel DRNG does not maintain an entropy estimate */
+		if (!capable(CAP_SYS_ADMIN))
+			return -EPERM;
+		return 0;
+	case RNDRESEEDCRNG:
+		if (!capable(CAP_SYS_ADMIN))
+			return -EPERM;
+		esdm_kdev_request_seed();
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct file_operations esdm_kdev_random_fops = {
+	.owner = THIS_MODULE,
+	.read = esdm_kdev_random_read,
+	.write = esdm_kdev_write,
+	.poll = esdm_kdev_poll,
+	.unlocked_ioctl = esdm_kdev_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 12, 0)
+	.llseek = noop_llseek,
+#endif
+};
+
+static const struct file_operations esdm_kdev_urandom_fops = {
+	.owner = THIS_MODULE,
+	.read = esdm_kdev_urandom_read,
+	.write = esdm_kdev_write,
+	.poll = esdm_kdev_poll,
+	.unlocked_ioctl = esdm_kdev_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 12, 0)
+	.llseek = noop_llseek,
+#endif
+};
+
+/********************************* Control device *****************************/
+
+static int esdm_kdev_ctl_open(struct inode *inode, struct file *file)
+{
+	/*
+	 * The IOCTLs are allowed without further restriction, only the
+	 * opening of the device requires CAP_SYS_ADMIN.
+	 */
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	return nonseekable_open(inode, file);
+}
+
+/* The control device is writable when the kernel DRNG wants a new seed */
+static __poll_t esdm_kdev_ctl_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &esdm_kdev_ctl_wait, wait);
+
+	if (READ_ONCE(esdm_kdev_base.reseed_wanted) ||
+	    !READ_ONCE(esdm_kdev_base.seeded))
+		return EPOLLOUT | EPOLLWRNORM;
+	return 0;
+}
+
+static long esdm_kdev_ctl_seed(void __user *arg)
+{
+	struct esdm_kdev_seed seed;
+
+	if (copy_from_user(&seed, arg, sizeof(seed)))
+		return -EFAULT;
+
+	/* Only accept a seed of at least the security strength */
+	if (seed.len < ESDM_KDEV_CHACHA20_KEY_SIZE ||
+	    seed.len > ESDM_KDEV_SEED_MAX ||
+	    seed.flags & ~ESDM_KDEV_SEED_FULLY_SEEDED) {
+		memzero_explicit(&seed, sizeof(seed));
+		return -EINVAL;
+	}
+
+	esdm_kdev_seed(seed.data, seed.len,
+		       !!(seed.flags & ESDM_KDEV_SEED_FULLY_SEEDED));
+	memzero_explicit(&seed, sizeof(seed));
+
+	return 0;
+}
+
+static long esdm_kdev_ctl_status(void __user *arg)
+{
+	struct esdm_kdev_status status = { 0 };
+
+	spin_lock(&esdm_kdev_base.lock);
+	if (esdm_kdev_base.seeded)
+		status.flags |= ESDM_KDEV_STATUS_SEEDED;
+	if (esdm_kdev_base.fully_seeded)
+		status.flags |= ESDM_KDEV_STATUS_FULLY_SEEDED;
+	if (esdm_kdev_base.reseed_wanted)
+		status.flags |= ESDM_KDEV_STATUS_RESEED_WANTED;
+	status.reseeds = esdm_kdev_base.reseeds;
+	spin_unlock(&esdm_kdev_base.lock);
+
+	status.reseed_interval_sec = READ_ONCE(esdm_kdev_reseed_interval);
+	status.read_bytes = (u64)atomic64_read(&esdm_kdev_read_bytes);
+
+	if (copy_to_user(arg, &status, sizeof(status)))
+		return -EFAULT;
+	return 0;
+}
+
+static long esdm_kdev_ctl_ioctl(struct file *file, unsigned int cmd,
+				unsigned long arg)
+{
+	switch (cmd) {
+	case ESDM_KDEV_SEED:
+		return esdm_kdev_ctl_seed((void __user *)arg);
+	case ESDM_KDEV_STATUS:
+		return esdm_kdev_ctl_status((void __user *)arg);
+	default:
+		return -ENOIOCTLCMD;
+	}
+}
+
+static const struct file_operations esdm_kdev_ctl_fops = {
+	.owner = THIS_MODULE,
+	.open = esdm_kdev_ctl_open,
+	.poll = esdm_kdev_ctl_poll,
+	.unlocked_ioctl = esdm_kdev_ctl_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 12, 0)
+	.llseek = no_llseek,
+#endif
+};
+
+static const struct file_operations
+	*const esdm_kdev_fops[ESDM_KDEV_MAX_MINORS] = {
+	[esdm_kdev_minor_ctl] = &esdm_kdev_ctl_fops,
+	[esdm_kdev_minor_random] = &esdm_kdev_random_fops,
+	[esdm_kdev_minor_urandom] = &esdm_kdev_urandom_fops,
+};
+
+/* The random devices are accessible to everybody */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 2, 0)
+static char *esdm_kdev_devnode(struct device *dev, umode_t *mode)
+#else
+static char *esdm_kdev_devnode(const struct device *dev, umode_t *mode)
+#endif
+{
+	if (mode && MINOR(dev->devt) != esdm_kdev_minor_ctl)
+		*mode = 0666;
+	return NULL;
+}
+
+/******************************** Module handling *****************************/
+
+static void esdm_kdev_destroy(unsigned int num)
+{
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		device_destroy(esdm_kdev_class, MKDEV(esdm_kdev_major, i));
+		cdev_del(&esdm_kdev_cdev[i]);
+	}
+}
+
+static int __init esdm_kdev_init(void)
+{
+	struct device *device;
+	unsigned int i;
+	dev_t dev;
+	int ret;
+
+	esdm_kdev_class = class_create(
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 4, 0)
+		THIS_MODULE,
+#endif
+		KBUILD_MODNAME);
+	if (IS_ERR(esdm_kdev_class))
+		return PTR_ERR(esdm_kdev_class);
+	esdm_kdev_class->devnode = esdm_kdev_devnode;
+
+	if (esdm_kdev_major) {
+		dev = MKDEV(esdm_kdev_major, 0);
+		ret = register_chrdev_region(dev, ESDM_KDEV_MAX_MINORS,
+					     KBUILD_MODNAME);
+	} else {
+		ret = alloc_chrdev_region(&dev, 0, ESDM_KDEV_MAX_MINORS,
+					  KBUILD_MODNAME);
+		esdm_kdev_major = MAJOR(dev);
+	}
+
+	if (ret < 0)
+		goto err;
+
+	for (i = 0; i < ESDM_KDEV_MAX_MINORS; i++) {
+		dev = MKDEV(esdm_kdev_major, i);
+
+		cdev_init(&esdm_kdev_cdev[i], esdm_kdev_fops[i]);
+		ret = cdev_add(&esdm_kdev_cdev[i], dev, 1);
+		if (ret)
+			goto err_cdev;
+
+		device = device_create(esdm_kdev_class, NULL, dev, NULL,
+				       esdm_kdev_names[i]);
+		if (IS_ERR(device)) {
+			ret = PTR_ERR(device);
+			cdev_del(&esdm_kdev_cdev[i]);
+			goto err_cdev;
+		}
+	}
+
+	pr_info("ESDM kernel devices available (major number %u)\n",
+		esdm_kdev_major);
+
+	return 0;
+
+err_cdev:
+	esdm_kdev_destroy(i);
+	unregister_chrdev_region(MKDEV(esdm_kdev_major, 0),
+				 ESDM_KDEV_MAX_MINORS);
+err:
+	class_destroy(esdm_kdev_class);
+	return ret;
+}
+
+static void __exit esdm_kdev_fini(void)
+{
+	struct esdm_kdev_crng *crng;
+	int cpu;
+
+	esdm_kdev_destroy(ESDM_KDEV_MAX_MINORS);
+	unregister_chrdev_region(MKDEV(esdm_kdev_major, 0),
+				 ESDM_KDEV_MAX_MINORS);
+	class_destroy(esdm_kdev_class);
+
+	memzero_explicit(&esdm_kdev_base.key, sizeof(esdm_kdev_base.key));
+	for_each_possible_cpu(cpu) {
+		crng = per_cpu_ptr(&esdm_kdev_crngs, cpu);
+		memzero_explicit(crng->key, sizeof(crng->key));
+	}
+
+	pr_info("ESDM kernel devices unavailable\n");
+}
+
+module_init(esdm_kdev_init);
+module_exit(esdm_kdev_fini);
+
+MODULE_LICENSE("Dual BSD/GPL");
+MODULE_AUTHOR("Stephan Mueller <smueller@chronox.de>");
+MODULE_DESCRIPTION("ESDM kernel random devices");
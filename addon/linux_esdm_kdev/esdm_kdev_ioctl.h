@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ */
+
+#ifndef _ESDM_KDEV_IOCTL_H
+#define _ESDM_KDEV_IOCTL_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * This header is shared with the ESDM server which feeds the kernel DRNG,
+ * thus it only uses the user space API types.
+ */
+
+#define ESDMKDEVIO 0xE1
+
+/* Largest seed accepted with one ESDM_KDEV_SEED call */
+#define ESDM_KDEV_SEED_MAX 64
+
+/* The seed was generated by a fully seeded ESDM */
+#define ESDM_KDEV_SEED_FULLY_SEEDED (1U << 0)
+
+struct esdm_kdev_seed {
+	__u32 flags;
+	__u32 len;
+	__u8 data[ESDM_KDEV_SEED_MAX];
+};
+
+/* Seed the kernel DRNG, only available on the control device */
+#define ESDM_KDEV_SEED _IOW(ESDMKDEVIO, 0x00, struct esdm_kdev_seed)
+
+/* Status flags of the kernel DRNG */
+#define ESDM_KDEV_STATUS_SEEDED (1U << 0)
+#define ESDM_KDEV_STATUS_FULLY_SEEDED (1U << 1)
+#define ESDM_KDEV_STATUS_RESEED_WANTED (1U << 2)
+
+struct esdm_kdev_status {
+	__u32 flags;
+	__u32 reseed_interval_sec;
+	__u64 reseeds;
+	__u64 read_bytes;
+};
+
+/* Status of the kernel DRNG, only available on the control device */
+#define ESDM_KDEV_STATUS _IOR(ESDMKDEVIO, 0x01, struct esdm_kdev_status)
+
+#endif /* _ESDM_KDEV_IOCTL_H */
@@ -27,6 +27,7 @@ extern "C" {
 #if defined(__linux__)
 
 #define _GNU_SOURCE
+#include <errno.h>
 #include <sched.h>
 #include <stdint.h>
 
@@ -45,6 +46,41 @@ static inline uint32_t esdm_arch_curr_node(void)
 	return (uint32_t)cpu;
 }
 
+/* CPU affinity of a thread */
+struct esdm_arch_cpu_affinity {
+	cpu_set_t cpus;
+};
+
+/*
+ * Bind the calling thread to the given CPU. The previous affinity is stored in
+ * prev to be restored with esdm_arch_cpu_unpin.
+ */
+static inline int esdm_arch_cpu_pin(uint32_t cpu,
+				    struct esdm_arch_cpu_affinity *prev)
+{
+	cpu_set_t cpus;
+
+	if (cpu >= CPU_SETSIZE)
+		return -EINVAL;
+
+	if (sched_getaffinity(0, sizeof(prev->cpus), &prev->cpus))
+		return -errno;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	if (sched_setaffinity(0, sizeof(cpus), &cpus))
+		return -errno;
+
+	return 0;
+}
+
+/* Restore the affinity obtained with esdm_arch_cpu_pin */
+static inline void
+esdm_arch_cpu_unpin(const struct esdm_arch_cpu_affinity *prev)
+{
+	sched_setaffinity(0, sizeof(prev->cpus), &prev->cpus);
+}
+
 #else /* __linux__ */
 
 #error "Unknown Operating System"
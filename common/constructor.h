@@ -31,6 +31,13 @@ extern "C" {
 #define ESDM_DEFINE_DESTRUCTOR(_func)                                          \
 	static void __attribute__((destructor)) _func(void)
 
+/*
+ * Constructor executed before the regular constructors of the same binary,
+ * e.g. to select the CPU-specific implementations used by the self tests.
+ */
+#define ESDM_DEFINE_CONSTRUCTOR_EARLY(_func)                                   \
+	static void __attribute__((constructor(101))) _func(void)
+
 #else
 
 #error "Constructor / destructor not defined for compiler"
@@ -0,0 +1,129 @@
+/* CPU feature detection
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <pthread.h>
+
+#include "constructor.h"
+#include "cpufeatures.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <cpuid.h>
+
+static unsigned int esdm_cpufeatures_detect(void)
+{
+	unsigned int eax, ebx, ecx, edx, features = 0;
+
+	/* The AVX checks include the OS support for the register state */
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		features |= ESDM_CPU_FEATURE_AVX2;
+	if (__builtin_cpu_supports("avx512f"))
+		features |= ESDM_CPU_FEATURE_AVX512F;
+	if (__builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2"))
+		features |= ESDM_CPU_FEATURE_BMI2;
+	if (__builtin_cpu_supports("aes"))
+		features |= ESDM_CPU_FEATURE_AES;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return features;
+	if (ecx & bit_RDRND)
+		features |= ESDM_CPU_FEATURE_RDRAND;
+	if (ecx & bit_SSSE3)
+		features |= ESDM_CPU_FEATURE_SSSE3;
+	if (ecx & bit_SSE4_1)
+		features |= ESDM_CPU_FEATURE_SSE41;
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return features;
+	if (ebx & bit_RDSEED)
+		features |= ESDM_CPU_FEATURE_RDSEED;
+	if (ebx & bit_SHA)
+		features |= ESDM_CPU_FEATURE_SHA;
+
+	return features;
+}
+
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+
+#include <sys/auxv.h>
+
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+#ifndef HWCAP_SHA3
+#define HWCAP_SHA3 (1 << 17)
+#endif
+#ifndef HWCAP_SHA512
+#define HWCAP_SHA512 (1 << 21)
+#endif
+
+static unsigned int esdm_cpufeatures_detect(void)
+{
+	unsigned long hwcap = getauxval(AT_HWCAP);
+	unsigned int features = 0;
+
+	if (hwcap & HWCAP_AES)
+		features |= ESDM_CPU_FEATURE_ARM_AES;
+	if (hwcap & HWCAP_SHA2)
+		features |= ESDM_CPU_FEATURE_ARM_SHA2;
+	if (hwcap & HWCAP_SHA512)
+		features |= ESDM_CPU_FEATURE_ARM_SHA512;
+	if (hwcap & HWCAP_SHA3)
+		features |= ESDM_CPU_FEATURE_ARM_SHA3;
+
+	return features;
+}
+
+#else
+
+static unsigned int esdm_cpufeatures_detect(void)
+{
+	return 0;
+}
+
+#endif
+
+unsigned int esdm_cpu_features = 0;
+static pthread_once_t esdm_cpufeatures_once = PTHREAD_ONCE_INIT;
+
+static void esdm_cpufeatures_set(void)
+{
+	__atomic_store_n(&esdm_cpu_features,
+			 esdm_cpufeatures_detect() |
+				 ESDM_CPU_FEATURE_INITIALIZED,
+			 __ATOMIC_RELEASE);
+}
+
+void esdm_cpufeatures_init(void)
+{
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_INITIALIZED))
+		return;
+
+	pthread_once(&esdm_cpufeatures_once, esdm_cpufeatures_set);
+}
+
+ESDM_DEFINE_CONSTRUCTOR(esdm_cpufeatures_constructor)
+{
+	esdm_cpufeatures_init();
+}
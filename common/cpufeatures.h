@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include "bool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* x86 */
+#define ESDM_CPU_FEATURE_RDRAND (1U << 0)
+#define ESDM_CPU_FEATURE_RDSEED (1U << 1)
+#define ESDM_CPU_FEATURE_SSSE3 (1U << 2)
+#define ESDM_CPU_FEATURE_SSE41 (1U << 3)
+#define ESDM_CPU_FEATURE_AVX2 (1U << 4)
+#define ESDM_CPU_FEATURE_AVX512F (1U << 5)
+#define ESDM_CPU_FEATURE_BMI2 (1U << 6) /* BMI and BMI2 */
+#define ESDM_CPU_FEATURE_SHA (1U << 7)
+#define ESDM_CPU_FEATURE_AES (1U << 8)
+
+/* ARMv8 */
+#define ESDM_CPU_FEATURE_ARM_SHA2 (1U << 16)
+#define ESDM_CPU_FEATURE_ARM_SHA512 (1U << 17)
+#define ESDM_CPU_FEATURE_ARM_SHA3 (1U << 18)
+#define ESDM_CPU_FEATURE_ARM_AES (1U << 19)
+
+/* Set once the detection completed */
+#define ESDM_CPU_FEATURE_INITIALIZED (1U << 31)
+
+extern unsigned int esdm_cpu_features;
+
+/**
+ * @brief Detect the CPU features
+ *
+ * The detection is performed once, subsequent calls return immediately. The
+ * function is invoked by a constructor and by esdm_init. Users selecting
+ * their implementation in their own constructor must call it as the order
+ * of constructors is not defined.
+ */
+void esdm_cpufeatures_init(void);
+
+/**
+ * @brief Check whether the CPU offers all given features
+ *
+ * The check only reads the result of the detection and is therefore suitable
+ * for hot code paths.
+ *
+ * @param [in] features ESDM_CPU_FEATURE_* flags
+ *
+ * @return true if all features are available
+ */
+static inline bool esdm_cpu_has(unsigned int features)
+{
+	return (esdm_cpu_features & features) == features;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPUFEATURES_H */
@@ -27,15 +27,20 @@
 #include <syslog.h>
 #include <time.h>
 
+#include "bool.h"
 #include "build_bug_on.h"
+#include "config.h"
 #include "constructor.h"
 #include "helper.h"
 #include "esdm_logger.h"
+#include "metrics.h"
+#include "queue.h"
 #include "term_colors.h"
 #include "threading_support.h"
 #include "visibility.h"
 
-static enum esdm_logger_verbosity esdm_logger_verbosity_level = LOGGER_STATUS;
+DSO_PUBLIC
+enum esdm_logger_verbosity esdm_logger_verbosity_level = LOGGER_STATUS;
 static enum esdm_logger_class esdm_logger_class_level = LOGGER_C_ANY;
 
 struct esdm_logger_class_map {
@@ -167,37 +172,24 @@ static void log_syslog(int severity, const char *format, ...)
 	vsyslog(log_prio, format, args);
 }
 
-DSO_PUBLIC
-void _esdm_logger(const enum esdm_logger_verbosity severity,
-		  const enum esdm_logger_class class, const char *file,
-		  const char *func, const uint32_t line, const char *fmt, ...)
+/* Write one log message to the log stream or syslog */
+static void esdm_logger_write(const enum esdm_logger_verbosity severity,
+			      const enum esdm_logger_class class,
+			      const char *thread_name, time_t now,
+			      const char *file, const char *func,
+			      const uint32_t line, const char *msg)
 {
-	time_t now;
 	struct tm now_detail;
-	va_list args;
 	int (*fprintf_color)(FILE *stream, const char *format, ...) = &fprintf;
 	int ret;
-	char msg[4096];
 	char sev[10];
 	char c[30];
-	char thread_name[ESDM_THREAD_MAX_NAMELEN];
-
-	if (!esdm_logger_stream)
-		esdm_logger_stream = stderr;
-
-	if (severity > esdm_logger_verbosity_level)
-		return;
-
-	va_start(args, fmt);
-	vsnprintf(msg, sizeof(msg), fmt, args);
-	va_end(args);
 
 	esdm_logger_severity(severity, sev, sizeof(sev));
 	ret = esdm_logger_class(class, c, sizeof(c));
 	if (ret)
 		return;
 
-	now = time(NULL);
 	localtime_r(&now, &now_detail);
 
 	switch (severity) {
@@ -225,8 +217,6 @@ void _esdm_logger(const enum esdm_logger_verbosity severity,
 		fprintf_color = &fprintf;
 	}
 
-	thread_get_name(thread_name, sizeof(thread_name));
-
 	switch (esdm_logger_verbosity_level) {
 	case LOGGER_DEBUG2:
 	case LOGGER_DEBUG:
@@ -267,8 +257,429 @@ void _esdm_logger(const enum esdm_logger_verbosity severity,
 	}
 }
 
+/*************************** Asynchronous Logging *****************************/
+
+#ifdef CONFIG_ESDM_USE_PTHREAD
+
+/*
+ * Every thread pushes its log records into its own single-producer,
+ * single-consumer ring. A background thread drains all rings to the log
+ * stream or syslog. A record that does not fit into the ring of the thread
+ * is written synchronously by the calling thread.
+ */
+#define ESDM_LOGGER_ASYNC_RECORDS 64
+#define ESDM_LOGGER_ASYNC_MASK (ESDM_LOGGER_ASYNC_RECORDS - 1)
+#define ESDM_LOGGER_ASYNC_MSGLEN 512
+
+/* Interval in which the drainer checks the rings without being woken up */
+#define ESDM_LOGGER_ASYNC_INTERVAL_NS 100000000
+
+struct esdm_logger_record {
+	time_t now;
+	enum esdm_logger_verbosity severity;
+	enum esdm_logger_class class;
+	const char *file;
+	const char *func;
+	uint32_t line;
+	char thread_name[ESDM_THREAD_MAX_NAMELEN];
+	char msg[ESDM_LOGGER_ASYNC_MSGLEN];
+};
+
+struct esdm_logger_ring {
+	struct esdm_logger_ring *next;
+	uint32_t head; /* Written by the owning thread */
+	uint32_t tail; /* Written by the drainer */
+	bool orphaned; /* The owning thread terminated */
+	bool busy; /* The owning thread writes a record */
+	bool name_valid;
+	char thread_name[ESDM_THREAD_MAX_NAMELEN];
+	struct esdm_logger_record rec[ESDM_LOGGER_ASYNC_RECORDS];
+};
+
+static bool esdm_logger_async_enabled = false;
+static bool esdm_logger_async_running = false;
+static bool esdm_logger_async_stop = false;
+static bool esdm_logger_async_sleeping = false;
+static struct esdm_logger_ring *esdm_logger_async_rings = NULL;
+static pthread_mutex_t esdm_logger_async_lock = PTHREAD_MUTEX_INITIALIZER;
+static DECLARE_WAIT_QUEUE(esdm_logger_async_wait);
+static pthread_t esdm_logger_async_thread;
+
+static __thread struct esdm_logger_ring *esdm_logger_async_ring = NULL;
+/* The ring of the thread was released, it logs synchronously from now on */
+static __thread bool esdm_logger_async_exited = false;
+static pthread_key_t esdm_logger_async_key;
+static pthread_once_t esdm_logger_async_once = PTHREAD_ONCE_INIT;
+static bool esdm_logger_async_key_valid = false;
+
+/*
+ * Thread terminates, its ring is released by the drainer once empty. Other
+ * destructors running afterwards must not use the ring any more.
+ */
+static void esdm_logger_async_destructor(void *data)
+{
+	struct esdm_logger_ring *ring = data;
+
+	esdm_logger_async_ring = NULL;
+	esdm_logger_async_exited = true;
+
+	if (ring)
+		__atomic_store_n(&ring->orphaned, true, __ATOMIC_RELEASE);
+}
+
+static void esdm_logger_async_fork_prepare(void)
+{
+	pthread_mutex_lock(&esdm_logger_async_lock);
+}
+
+static void esdm_logger_async_fork_parent(void)
+{
+	pthread_mutex_unlock(&esdm_logger_async_lock);
+}
+
+/*
+ * The child has no drainer and only the forking thread. The records pending
+ * at the time of the fork are written by the parent.
+ */
+static void esdm_logger_async_fork_child(void)
+{
+	struct esdm_logger_ring *ring;
+
+	esdm_logger_async_running = false;
+	esdm_logger_async_stop = false;
+	esdm_logger_async_sleeping = false;
+
+	for (ring = esdm_logger_async_rings; ring; ring = ring->next) {
+		ring->tail = ring->head;
+		if (ring != esdm_logger_async_ring)
+			ring->orphaned = true;
+	}
+
+	/* The child commonly receives a new name */
+	if (esdm_logger_async_ring)
+		esdm_logger_async_ring->name_valid = false;
+
+	pthread_mutex_unlock(&esdm_logger_async_lock);
+}
+
+static void esdm_logger_async_init(void)
+{
+	if (pthread_key_create(&esdm_logger_async_key,
+			       esdm_logger_async_destructor))
+		return;
+
+	if (pthread_atfork(esdm_logger_async_fork_prepare,
+			   esdm_logger_async_fork_parent,
+			   esdm_logger_async_fork_child))
+		return;
+
+	esdm_logger_async_key_valid = true;
+}
+
+static struct esdm_logger_ring *esdm_logger_async_ring_get(void)
+{
+	struct esdm_logger_ring *ring = esdm_logger_async_ring;
+
+	if (ring)
+		return ring;
+	if (esdm_logger_async_exited)
+		return NULL;
+
+	pthread_once(&esdm_logger_async_once, esdm_logger_async_init);
+	if (!esdm_logger_async_key_valid)
+		return NULL;
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+
+	if (pthread_setspecific(esdm_logger_async_key, ring)) {
+		free(ring);
+		return NULL;
+	}
+	esdm_mem_account(esdm_mem_logger, sizeof(*ring));
+
+	pthread_mutex_lock(&esdm_logger_async_lock);
+	ring->next = esdm_logger_async_rings;
+	__atomic_store_n(&esdm_logger_async_rings, ring, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&esdm_logger_async_lock);
+
+	esdm_logger_async_ring = ring;
+	return ring;
+}
+
+/* Write all records of one ring, return true if a record was written */
+static bool esdm_logger_async_drain_ring(struct esdm_logger_ring *ring)
+{
+	uint32_t tail = ring->tail;
+	bool drained = false;
+
+	while (tail != __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+		const struct esdm_logger_record *rec =
+			&ring->rec[tail & ESDM_LOGGER_ASYNC_MASK];
+
+		esdm_logger_write(rec->severity, rec->class, rec->thread_name,
+				  rec->now, rec->file, rec->func, rec->line,
+				  rec->msg);
+
+		tail++;
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+		drained = true;
+	}
+
+	return drained;
+}
+
+/* Write the records of all rings and release the rings of ended threads */
+static bool esdm_logger_async_drain(void)
+{
+	struct esdm_logger_ring *ring, **prev;
+	bool drained = false;
+
+	for (ring = __atomic_load_n(&esdm_logger_async_rings, __ATOMIC_ACQUIRE);
+	     ring; ring = ring->next)
+		drained |= esdm_logger_async_drain_ring(ring);
+
+	pthread_mutex_lock(&esdm_logger_async_lock);
+	prev = &esdm_logger_async_rings;
+	while ((ring = *prev)) {
+		if (__atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE) &&
+		    !esdm_logger_async_drain_ring(ring)) {
+			*prev = ring->next;
+			esdm_mem_account(esdm_mem_logger,
+					 -(int64_t)sizeof(*ring));
+			free(ring);
+			continue;
+		}
+		prev = &ring->next;
+	}
+	pthread_mutex_unlock(&esdm_logger_async_lock);
+
+	return drained;
+}
+
+static bool esdm_logger_async_pending(void)
+{
+	struct esdm_logger_ring *ring;
+
+	for (ring = __atomic_load_n(&esdm_logger_async_rings, __ATOMIC_ACQUIRE);
+	     ring; ring = ring->next) {
+		if (ring->tail != __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+			return true;
+	}
+
+	return false;
+}
+
+static void *esdm_logger_async_drainer(void *unused)
+{
+	static const struct timespec ts = {
+		.tv_sec = 0, .tv_nsec = ESDM_LOGGER_ASYNC_INTERVAL_NS
+	};
+	int ret;
+
+	(void)unused;
+
+	for (;;) {
+		if (esdm_logger_async_drain())
+			continue;
+
+		if (__atomic_load_n(&esdm_logger_async_stop, __ATOMIC_ACQUIRE))
+			break;
+
+		__atomic_store_n(&esdm_logger_async_sleeping, true,
+				 __ATOMIC_SEQ_CST);
+		if (!esdm_logger_async_pending())
+			thread_timedwait_no_event(&esdm_logger_async_wait,
+						  &ts);
+		__atomic_store_n(&esdm_logger_async_sleeping, false,
+				 __ATOMIC_RELAXED);
+	}
+
+	(void)ret;
+	return NULL;
+}
+
+/* The drainer is started on first use in every process */
+static bool esdm_logger_async_start(void)
+{
+	bool running;
+
+	if (__atomic_load_n(&esdm_logger_async_running, __ATOMIC_ACQUIRE))
+		return true;
+
+	pthread_mutex_lock(&esdm_logger_async_lock);
+	running = esdm_logger_async_running;
+	if (!running && !esdm_logger_async_stop &&
+	    !pthread_create(&esdm_logger_async_thread, NULL,
+			    esdm_logger_async_drainer, NULL)) {
+		running = true;
+		__atomic_store_n(&esdm_logger_async_running, true,
+				 __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&esdm_logger_async_lock);
+
+	return running;
+}
+
+/* Stop the drainer after it wrote all pending records */
+static void esdm_logger_async_fini(void)
+{
+	if (!__atomic_load_n(&esdm_logger_async_running, __ATOMIC_ACQUIRE))
+		return;
+
+	pthread_mutex_lock(&esdm_logger_async_lock);
+	__atomic_store_n(&esdm_logger_async_stop, true, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&esdm_logger_async_lock);
+	thread_wake(&esdm_logger_async_wait);
+
+	if (!pthread_equal(pthread_self(), esdm_logger_async_thread))
+		pthread_join(esdm_logger_async_thread, NULL);
+	__atomic_store_n(&esdm_logger_async_running, false, __ATOMIC_RELEASE);
+}
+
+/* Queue the log record, return false if it must be written synchronously */
+static bool esdm_logger_async_push(const enum esdm_logger_verbosity severity,
+				   const enum esdm_logger_class class,
+				   const char *file, const char *func,
+				   const uint32_t line, const char *fmt,
+				   va_list args)
+{
+	struct esdm_logger_ring *ring;
+	struct esdm_logger_record *rec;
+	uint32_t head;
+	int len;
+	bool ret = false;
+
+	if (!__atomic_load_n(&esdm_logger_async_enabled, __ATOMIC_RELAXED))
+		return false;
+
+	ring = esdm_logger_async_ring_get();
+	if (!ring || ring->busy || !esdm_logger_async_start())
+		return false;
+
+	/* A signal handler logging while the thread writes a record */
+	ring->busy = true;
+
+	head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+	    ESDM_LOGGER_ASYNC_RECORDS)
+		goto out;
+
+	rec = &ring->rec[head & ESDM_LOGGER_ASYNC_MASK];
+	len = vsnprintf(rec->msg, sizeof(rec->msg), fmt, args);
+	if (len < 0 || (size_t)len >= sizeof(rec->msg))
+		goto out;
+
+	if (!ring->name_valid) {
+		thread_get_name(ring->thread_name, sizeof(ring->thread_name));
+		ring->name_valid = true;
+	}
+	memcpy(rec->thread_name, ring->thread_name, sizeof(rec->thread_name));
+
+	rec->now = time(NULL);
+	rec->severity = severity;
+	rec->class = class;
+	rec->file = file;
+	rec->func = func;
+	rec->line = line;
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&esdm_logger_async_sleeping, __ATOMIC_SEQ_CST))
+		thread_wake(&esdm_logger_async_wait);
+	ret = true;
+
+out:
+	ring->busy = false;
+	return ret;
+}
+
+DSO_PUBLIC
+void esdm_logger_enable_async(void)
+{
+	__atomic_store_n(&esdm_logger_async_enabled, true, __ATOMIC_RELAXED);
+}
+
+void esdm_logger_thread_name_changed(void)
+{
+	if (esdm_logger_async_ring)
+		esdm_logger_async_ring->name_valid = false;
+}
+
+#else /* CONFIG_ESDM_USE_PTHREAD */
+
+static void esdm_logger_async_fini(void)
+{
+}
+
+static bool esdm_logger_async_push(const enum esdm_logger_verbosity severity,
+				   const enum esdm_logger_class class,
+				   const char *file, const char *func,
+				   const uint32_t line, const char *fmt,
+				   va_list args)
+{
+	(void)severity;
+	(void)class;
+	(void)file;
+	(void)func;
+	(void)line;
+	(void)fmt;
+	(void)args;
+	return false;
+}
+
+DSO_PUBLIC
+void esdm_logger_enable_async(void)
+{
+}
+
+void esdm_logger_thread_name_changed(void)
+{
+}
+
+#endif /* CONFIG_ESDM_USE_PTHREAD */
+
+DSO_PUBLIC
+void _esdm_logger(const enum esdm_logger_verbosity severity,
+		  const enum esdm_logger_class class, const char *file,
+		  const char *func, const uint32_t line, const char *fmt, ...)
+{
+	va_list args;
+	char msg[4096];
+	char thread_name[ESDM_THREAD_MAX_NAMELEN];
+	unsigned int idx;
+	bool queued;
+
+	if (!esdm_logger_stream)
+		esdm_logger_stream = stderr;
+
+	if (severity > esdm_logger_verbosity_level)
+		return;
+
+	if (esdm_logger_class_idx(class, &idx))
+		return;
+
+	va_start(args, fmt);
+	queued = esdm_logger_async_push(severity, class, file, func, line, fmt,
+					args);
+	va_end(args);
+	if (queued)
+		return;
+
+	va_start(args, fmt);
+	vsnprintf(msg, sizeof(msg), fmt, args);
+	va_end(args);
+
+	thread_get_name(thread_name, sizeof(thread_name));
+
+	esdm_logger_write(severity, class, thread_name, time(NULL), file, func,
+			  line, msg);
+}
+
 static void esdm_logger_destructor(void)
 {
+	esdm_logger_async_fini();
+
 	if (esdm_logger_stream && esdm_logger_stream != stderr)
 		fclose(esdm_logger_stream);
 
@@ -52,6 +52,19 @@ enum esdm_logger_class {
 	LOGGER_C_LAST /* This must be last entry */
 };
 
+/*
+ * Most verbose level for which log statements are compiled. With the
+ * debug_logging build option disabled, debug statements are removed entirely.
+ */
+#ifdef ESDM_LOGGER_NO_DEBUG
+#define ESDM_LOGGER_COMPILED_LEVEL LOGGER_VERBOSE
+#else
+#define ESDM_LOGGER_COMPILED_LEVEL LOGGER_DEBUG2
+#endif
+
+/* Current verbosity level - not intended to be accessed directly */
+extern enum esdm_logger_verbosity esdm_logger_verbosity_level;
+
 /* Helper that is not intended to be called directly */
 void _esdm_logger(const enum esdm_logger_verbosity severity,
 		  const enum esdm_logger_class class_, const char *file,
@@ -78,6 +91,10 @@ void _esdm_logger_binary(const enum esdm_logger_verbosity severity,
 #endif
 #define esdm_logger(severity, class_, fmt...)                                  \
 	do {                                                                   \
+		if ((severity) > ESDM_LOGGER_COMPILED_LEVEL ||                 \
+		    __builtin_expect((severity) > esdm_logger_verbosity_level, \
+				     1))                                       \
+			break;                                                 \
 		_Pragma("GCC diagnostic push")                                 \
 			_Pragma("GCC diagnostic ignored \"-Wpedantic\"")       \
 				_esdm_logger(severity, class_, __FILE__,       \
@@ -150,6 +167,18 @@ FILE *esdm_logger_log_stream(void);
  */
 void esdm_logger_enable_syslog(const char *daemon_name);
 
+/**
+ * Enable asynchronous logging: log messages are queued in per-thread rings
+ * and written by a background thread. Messages that do not fit into the
+ * ring are written synchronously.
+ */
+void esdm_logger_enable_async(void);
+
+/**
+ * Internal: invalidate the cached name of the calling thread.
+ */
+void esdm_logger_thread_name_changed(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#ifndef ESDM_PROBES_H
+#define ESDM_PROBES_H
+
+#include "config.h"
+
+/*
+ * Static user space tracepoints (USDT) of the provider "esdm". A probe which
+ * is not attached by a tracer is a single NOP instruction, the arguments are
+ * at most moved into registers. The probes are listed with
+ * "bpftrace -l 'usdt:/usr/bin/esdm-server:esdm:*'".
+ *
+ * rpc_start / rpc_end (privileged service, method index)
+ *	Processing of an RPC request including the response.
+ * drng_get_start (node, PR DRNG, requested bytes)
+ * drng_get_end (node, PR DRNG, generated bytes or -errno)
+ *	Generation of random numbers by a DRNG.
+ * seed_start (node, DRNG type)
+ * seed_end (node, collected entropy bits)
+ *	Seeding of a DRNG from the entropy sources.
+ * es_collect_start (ES name)
+ * es_collect_end (ES name, entropy bits)
+ *	Collection of entropy from one entropy source.
+ * cuse_read_start (requested bytes)
+ * cuse_read_end (requested bytes, 0 or -errno)
+ *	Read request of the CUSE random devices.
+ */
+
+#ifdef ESDM_USDT
+
+#include <sys/sdt.h>
+
+#define ESDM_PROBE1(name, a) DTRACE_PROBE1(esdm, name, a)
+#define ESDM_PROBE2(name, a, b) DTRACE_PROBE2(esdm, name, a, b)
+#define ESDM_PROBE3(name, a, b, c) DTRACE_PROBE3(esdm, name, a, b, c)
+
+#else /* ESDM_USDT */
+
+#define ESDM_PROBE1(name, a)                                                   \
+	do {                                                                   \
+	} while (0)
+#define ESDM_PROBE2(name, a, b)                                                \
+	do {                                                                   \
+	} while (0)
+#define ESDM_PROBE3(name, a, b, c)                                             \
+	do {                                                                   \
+	} while (0)
+
+#endif /* ESDM_USDT */
+
+#endif /* ESDM_PROBES_H */
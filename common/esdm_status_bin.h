@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef ESDM_STATUS_BIN_H
+#define ESDM_STATUS_BIN_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary status of the ESDM as returned by esdm_status_bin and
+ * esdm_rpcc_status_bin. All fields use the byte order of the host.
+ *
+ * Versioning: new fields are only appended. A consumer accepts a structure
+ * with a version equal or larger than the one it was compiled with and
+ * ignores the bytes after the size it knows.
+ */
+#define ESDM_STATUS_BIN_VERSION 1
+
+#define ESDM_STATUS_BIN_ES_MAX 8
+#define ESDM_STATUS_BIN_DRNG_MAX 64
+
+/* Node value of the initial DRNG */
+#define ESDM_STATUS_BIN_NODE_INIT UINT32_MAX
+
+/* Values of esdm_status_bin.flags */
+#define ESDM_STATUS_BIN_MIN_SEEDED (1U << 0)
+#define ESDM_STATUS_BIN_FULLY_SEEDED (1U << 1)
+#define ESDM_STATUS_BIN_OPERATIONAL (1U << 2)
+#define ESDM_STATUS_BIN_FIPS (1U << 3)
+#define ESDM_STATUS_BIN_SP80090C (1U << 4)
+#define ESDM_STATUS_BIN_NTG1 (1U << 5)
+#define ESDM_STATUS_BIN_NTG1_2024 (1U << 6)
+/* Not all DRNG instances fit into the structure */
+#define ESDM_STATUS_BIN_DRNG_TRUNCATED (1U << 7)
+
+struct esdm_status_bin_es {
+	char name[32];
+	uint32_t active;
+	/* Entropy in bits available with the last refresh of the status */
+	uint32_t curr_entropy;
+	uint32_t max_entropy;
+	/* Moving averages of the collections of the ES */
+	uint32_t latency_us;
+	uint32_t avg_bits;
+	uint32_t failures_percent;
+};
+
+struct esdm_status_bin_drng {
+	uint32_t node;
+	uint32_t fully_seeded;
+	uint64_t requests_since_fully_seeded;
+	uint64_t bits_since_fully_seeded;
+	/* Time since the last seeding of the DRNG */
+	uint64_t seeded_age_ms;
+};
+
+struct esdm_status_bin {
+	uint32_t version;
+	/* Size of the structure filled in by the producer */
+	uint32_t size;
+	/* CLOCK_MONOTONIC time of the refresh of the status */
+	uint64_t timestamp_ms;
+	uint32_t flags;
+	uint32_t security_strength;
+	uint32_t entropy_level;
+	uint32_t nodes;
+	uint32_t es_num;
+	uint32_t drng_num;
+	char drng_name[64];
+	struct esdm_status_bin_es es[ESDM_STATUS_BIN_ES_MAX];
+	struct esdm_status_bin_drng drng[ESDM_STATUS_BIN_DRNG_MAX];
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_STATUS_BIN_H */
@@ -0,0 +1,172 @@
+/* Hot path audit of allocations and system calls
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hotpath_audit.h"
+#include "visibility.h"
+
+DSO_PUBLIC __thread struct esdm_audit_cnt esdm_audit_thread_cnt;
+
+/*
+ * Wrapper of a function listed with --wrap in the link arguments defined in
+ * meson.build. The linker redirects the calls to __wrap_<name> and provides
+ * the original function as __real_<name>. The wrappers are exported as the
+ * link arguments apply to all objects, including those of programs linking
+ * a shared library of the ESDM.
+ */
+#define ESDM_AUDIT_WRAP(type, name, params, args, counter)                     \
+	type __real_##name params;                                             \
+	type __wrap_##name params;                                             \
+	DSO_PUBLIC type __wrap_##name params                                   \
+	{                                                                      \
+		esdm_audit_thread_cnt.counter++;                               \
+		return __real_##name args;                                     \
+	}
+
+ESDM_AUDIT_WRAP(void *, malloc, (size_t size), (size), allocs)
+ESDM_AUDIT_WRAP(void *, calloc, (size_t nmemb, size_t size), (nmemb, size),
+		allocs)
+ESDM_AUDIT_WRAP(void *, realloc, (void *ptr, size_t size), (ptr, size),
+		allocs)
+ESDM_AUDIT_WRAP(int, posix_memalign,
+		(void **memptr, size_t alignment, size_t size),
+		(memptr, alignment, size), allocs)
+
+void __real_free(void *ptr);
+void __wrap_free(void *ptr);
+DSO_PUBLIC void __wrap_free(void *ptr)
+{
+	/* free(NULL) is no release */
+	if (ptr)
+		esdm_audit_thread_cnt.frees++;
+	__real_free(ptr);
+}
+
+ESDM_AUDIT_WRAP(ssize_t, read, (int fd, void *buf, size_t count),
+		(fd, buf, count), syscalls)
+/* Calls of read with _FORTIFY_SOURCE and a buffer of a known size */
+ESDM_AUDIT_WRAP(ssize_t, __read_chk,
+		(int fd, void *buf, size_t count, size_t buflen),
+		(fd, buf, count, buflen), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, write, (int fd, const void *buf, size_t count),
+		(fd, buf, count), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, readv, (int fd, const struct iovec *iov, int iovcnt),
+		(fd, iov, iovcnt), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, writev,
+		(int fd, const struct iovec *iov, int iovcnt),
+		(fd, iov, iovcnt), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, recv, (int fd, void *buf, size_t len, int flags),
+		(fd, buf, len, flags), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, __recv_chk,
+		(int fd, void *buf, size_t len, size_t buflen, int flags),
+		(fd, buf, len, buflen, flags), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, recvmsg, (int fd, struct msghdr *msg, int flags),
+		(fd, msg, flags), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, send, (int fd, const void *buf, size_t len, int flags),
+		(fd, buf, len, flags), syscalls)
+ESDM_AUDIT_WRAP(ssize_t, sendmsg,
+		(int fd, const struct msghdr *msg, int flags),
+		(fd, msg, flags), syscalls)
+ESDM_AUDIT_WRAP(int, poll, (struct pollfd *fds, nfds_t nfds, int timeout),
+		(fds, nfds, timeout), syscalls)
+ESDM_AUDIT_WRAP(int, epoll_wait,
+		(int epfd, struct epoll_event *events, int maxevents,
+		 int timeout),
+		(epfd, events, maxevents, timeout), syscalls)
+ESDM_AUDIT_WRAP(int, close, (int fd), (fd), syscalls)
+ESDM_AUDIT_WRAP(int, nanosleep,
+		(const struct timespec *req, struct timespec *rem),
+		(req, rem), syscalls)
+
+static inline void esdm_audit_max(uint64_t *max, uint64_t val)
+{
+	uint64_t old = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+	while (val > old &&
+	       !__atomic_compare_exchange_n(max, &old, val, 1, __ATOMIC_RELAXED,
+					    __ATOMIC_RELAXED))
+		;
+}
+
+void esdm_audit_end(struct esdm_audit_stat *stat,
+		    const struct esdm_audit_cnt *start)
+{
+	uint64_t allocs = esdm_audit_thread_cnt.allocs - start->allocs;
+	uint64_t frees = esdm_audit_thread_cnt.frees - start->frees;
+	uint64_t syscalls = esdm_audit_thread_cnt.syscalls - start->syscalls;
+
+	__atomic_fetch_add(&stat->calls, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stat->allocs, allocs, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stat->frees, frees, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stat->syscalls, syscalls, __ATOMIC_RELAXED);
+	esdm_audit_max(&stat->allocs_max, allocs);
+	esdm_audit_max(&stat->syscalls_max, syscalls);
+}
+
+size_t esdm_audit_report(struct esdm_audit_stat *stat, const char *name,
+			 char *buf, size_t buflen)
+{
+	uint64_t calls = __atomic_load_n(&stat->calls, __ATOMIC_RELAXED);
+	uint64_t allocs, frees, syscalls;
+	int ret;
+
+	if (!buflen)
+		return 0;
+	buf[0] = '\0';
+	if (!calls)
+		return 0;
+
+	/* Averages with two decimal places */
+	allocs = __atomic_load_n(&stat->allocs, __ATOMIC_RELAXED) * 100 / calls;
+	frees = __atomic_load_n(&stat->frees, __ATOMIC_RELAXED) * 100 / calls;
+	syscalls = __atomic_load_n(&stat->syscalls, __ATOMIC_RELAXED) * 100 /
+		   calls;
+
+	ret = snprintf(
+		buf, buflen,
+		" %s: calls %llu allocs %llu.%02llu (max %llu) frees %llu.%02llu syscalls %llu.%02llu (max %llu)\n",
+		name, (unsigned long long)calls,
+		(unsigned long long)(allocs / 100),
+		(unsigned long long)(allocs % 100),
+		(unsigned long long)__atomic_load_n(&stat->allocs_max,
+						    __ATOMIC_RELAXED),
+		(unsigned long long)(frees / 100),
+		(unsigned long long)(frees % 100),
+		(unsigned long long)(syscalls / 100),
+		(unsigned long long)(syscalls % 100),
+		(unsigned long long)__atomic_load_n(&stat->syscalls_max,
+						    __ATOMIC_RELAXED));
+
+	/* Drop the truncated line */
+	if (ret < 0 || (size_t)ret >= buflen) {
+		buf[0] = '\0';
+		return 0;
+	}
+
+	return (size_t)ret;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef HOTPATH_AUDIT_H
+#define HOTPATH_AUDIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hot path audit: the memory allocation functions and the libc wrappers of
+ * the system calls used by the ESDM are wrapped with the linker option
+ * --wrap to count their invocations per thread. A code path takes a snapshot
+ * of the counters of its thread before and after its execution and accounts
+ * the difference to its statistics object. System calls issued inside libc,
+ * e.g. the futex calls of the pthread functions, are not counted.
+ *
+ * @allocs: Number of malloc, calloc, realloc and posix_memalign calls
+ * @frees: Number of free calls
+ * @syscalls: Number of calls of the wrapped system call functions
+ */
+struct esdm_audit_cnt {
+	uint64_t allocs;
+	uint64_t frees;
+	uint64_t syscalls;
+};
+
+/*
+ * Statistics of one code path
+ *
+ * @calls: Number of executions of the code path
+ * @allocs: Accumulated allocations
+ * @frees: Accumulated releases
+ * @syscalls: Accumulated system calls
+ * @allocs_max: Largest number of allocations of one execution
+ * @syscalls_max: Largest number of system calls of one execution
+ */
+struct esdm_audit_stat {
+	uint64_t calls;
+	uint64_t allocs;
+	uint64_t frees;
+	uint64_t syscalls;
+	uint64_t allocs_max;
+	uint64_t syscalls_max;
+};
+
+#ifdef ESDM_HOTPATH_AUDIT
+
+/*
+ * Counters of the calling thread. The symbol is visible to allow the ESDM
+ * library to use the counters of the ESDM server executable.
+ */
+extern __thread struct esdm_audit_cnt esdm_audit_thread_cnt;
+
+static inline void esdm_audit_begin(struct esdm_audit_cnt *start)
+{
+	*start = esdm_audit_thread_cnt;
+}
+
+/**
+ * @brief Account the execution of a code path started with esdm_audit_begin
+ *
+ * @param [in] stat Statistics object of the code path
+ * @param [in] start Snapshot taken with esdm_audit_begin
+ */
+void esdm_audit_end(struct esdm_audit_stat *stat,
+		    const struct esdm_audit_cnt *start);
+
+/**
+ * @brief Print the averages and maxima of the statistics of a code path
+ *
+ * Nothing is printed if the code path was not executed.
+ *
+ * @param [in] stat Statistics object of the code path
+ * @param [in] name Name of the code path
+ * @param [out] buf Buffer the NUL-terminated line is written to
+ * @param [in] buflen Size of the buffer
+ *
+ * @return number of characters written
+ */
+size_t esdm_audit_report(struct esdm_audit_stat *stat, const char *name,
+			 char *buf, size_t buflen);
+
+#else /* ESDM_HOTPATH_AUDIT */
+
+static inline void esdm_audit_begin(struct esdm_audit_cnt *start)
+{
+	(void)start;
+}
+
+static inline void esdm_audit_end(struct esdm_audit_stat *stat,
+				  const struct esdm_audit_cnt *start)
+{
+	(void)stat;
+	(void)start;
+}
+
+static inline size_t esdm_audit_report(struct esdm_audit_stat *stat,
+				       const char *name, char *buf,
+				       size_t buflen)
+{
+	(void)stat;
+	(void)name;
+	if (buflen)
+		buf[0] = '\0';
+	return 0;
+}
+
+#endif /* ESDM_HOTPATH_AUDIT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOTPATH_AUDIT_H */
@@ -0,0 +1,312 @@
+/* Per-thread log-linear latency histograms
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "latency_hist.h"
+
+#ifdef ESDM_LATENCY_STATS
+
+struct esdm_lat_set {
+	struct esdm_lat_set *next;
+	struct esdm_lat_registry *reg;
+	struct esdm_lat_hist hist[];
+};
+
+static unsigned int esdm_lat_bucket(uint64_t ns)
+{
+	unsigned int e;
+
+	if (ns < ESDM_LAT_SUB)
+		return (unsigned int)ns;
+
+	e = 63 - (unsigned int)__builtin_clzll(ns);
+	if (e > ESDM_LAT_MAX_EXP)
+		return ESDM_LAT_BUCKETS - 1;
+
+	return (e - ESDM_LAT_SUB_BITS + 1) * ESDM_LAT_SUB +
+	       (unsigned int)((ns >> (e - ESDM_LAT_SUB_BITS)) &
+			      (ESDM_LAT_SUB - 1));
+}
+
+/* Largest value accounted to the bucket */
+static uint64_t esdm_lat_bucket_value(unsigned int idx)
+{
+	unsigned int shift;
+
+	if (idx < ESDM_LAT_SUB)
+		return idx;
+
+	shift = idx / ESDM_LAT_SUB - 1;
+	return ((uint64_t)(ESDM_LAT_SUB + idx % ESDM_LAT_SUB + 1) << shift) - 1;
+}
+
+static struct esdm_lat_set *esdm_lat_set_alloc(struct esdm_lat_registry *reg)
+{
+	return calloc(1, sizeof(struct esdm_lat_set) +
+				 reg->nhist * sizeof(struct esdm_lat_hist));
+}
+
+/* Caller must hold the registry lock */
+static void esdm_lat_merge(struct esdm_lat_hist *dst, unsigned int nhist,
+			   const struct esdm_lat_hist *src)
+{
+	unsigned int i, j;
+	uint64_t max;
+
+	for (i = 0; i < nhist; i++) {
+		for (j = 0; j < ESDM_LAT_BUCKETS; j++)
+			dst[i].count[j] += __atomic_load_n(&src[i].count[j],
+							   __ATOMIC_RELAXED);
+		max = __atomic_load_n(&src[i].max, __ATOMIC_RELAXED);
+		if (max > dst[i].max)
+			dst[i].max = max;
+		dst[i].sum += __atomic_load_n(&src[i].sum, __ATOMIC_RELAXED);
+	}
+}
+
+static void esdm_lat_thread_exit(void *arg)
+{
+	struct esdm_lat_set *set = arg, **p;
+	struct esdm_lat_registry *reg = set->reg;
+
+	pthread_mutex_lock(&reg->lock);
+
+	for (p = &reg->sets; *p; p = &(*p)->next) {
+		if (*p == set) {
+			*p = set->next;
+			break;
+		}
+	}
+
+	if (!reg->retired)
+		reg->retired = esdm_lat_set_alloc(reg);
+	if (reg->retired)
+		esdm_lat_merge(reg->retired->hist, reg->nhist, set->hist);
+
+	pthread_mutex_unlock(&reg->lock);
+
+	free(set);
+}
+
+/*
+ * pthread_once does not carry an argument - the registries are few and
+ * static, so their keys are created while holding one global lock instead.
+ */
+static pthread_mutex_t esdm_lat_key_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int esdm_lat_key(struct esdm_lat_registry *reg)
+{
+	int ret = 0;
+
+	if (__atomic_load_n(&reg->key_valid, __ATOMIC_ACQUIRE))
+		return 0;
+
+	pthread_mutex_lock(&esdm_lat_key_lock);
+	if (!reg->key_valid) {
+		ret = -pthread_key_create(&reg->key, esdm_lat_thread_exit);
+		if (!ret)
+			__atomic_store_n(&reg->key_valid, 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&esdm_lat_key_lock);
+
+	return ret;
+}
+
+static struct esdm_lat_set *esdm_lat_set_get(struct esdm_lat_registry *reg)
+{
+	struct esdm_lat_set *set;
+
+	if (esdm_lat_key(reg))
+		return NULL;
+
+	set = pthread_getspecific(reg->key);
+	if (set)
+		return set;
+
+	set = esdm_lat_set_alloc(reg);
+	if (!set)
+		return NULL;
+	set->reg = reg;
+
+	if (pthread_setspecific(reg->key, set)) {
+		free(set);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&reg->lock);
+	set->next = reg->sets;
+	reg->sets = set;
+	pthread_mutex_unlock(&reg->lock);
+
+	return set;
+}
+
+void esdm_lat_record(struct esdm_lat_registry *reg, unsigned int idx,
+		     uint64_t ns)
+{
+	struct esdm_lat_set *set;
+	struct esdm_lat_hist *hist;
+	unsigned int bucket;
+
+	if (idx >= reg->nhist)
+		return;
+
+	set = esdm_lat_set_get(reg);
+	if (!set)
+		return;
+
+	/*
+	 * Single writer: a plain increment suffices, the atomic store only
+	 * prevents torn values seen by a concurrent reporter.
+	 */
+	hist = &set->hist[idx];
+	bucket = esdm_lat_bucket(ns);
+	__atomic_store_n(&hist->count[bucket], hist->count[bucket] + 1,
+			 __ATOMIC_RELAXED);
+	if (ns > hist->max)
+		__atomic_store_n(&hist->max, ns, __ATOMIC_RELAXED);
+	__atomic_store_n(&hist->sum, hist->sum + ns, __ATOMIC_RELAXED);
+}
+
+static uint64_t esdm_lat_quantile(const struct esdm_lat_hist *hist,
+				  uint64_t total, unsigned int permille)
+{
+	uint64_t rank = (total * permille + 999) / 1000, sum = 0, val;
+	unsigned int i;
+
+	if (!rank)
+		rank = 1;
+
+	for (i = 0; i < ESDM_LAT_BUCKETS; i++) {
+		sum += hist->count[i];
+		if (sum >= rank)
+			break;
+	}
+
+	if (i >= ESDM_LAT_BUCKETS)
+		i = ESDM_LAT_BUCKETS - 1;
+
+	val = esdm_lat_bucket_value(i);
+	return val < hist->max ? val : hist->max;
+}
+
+/* Aggregate the histogram of all threads, return the number of values */
+static uint64_t esdm_lat_aggregate(struct esdm_lat_registry *reg,
+				   unsigned int idx, struct esdm_lat_hist *hist)
+{
+	struct esdm_lat_set *set;
+	uint64_t total = 0;
+	unsigned int i;
+
+	memset(hist, 0, sizeof(*hist));
+	pthread_mutex_lock(&reg->lock);
+	for (set = reg->sets; set; set = set->next)
+		esdm_lat_merge(hist, 1, &set->hist[idx]);
+	if (reg->retired)
+		esdm_lat_merge(hist, 1, &reg->retired->hist[idx]);
+	pthread_mutex_unlock(&reg->lock);
+
+	for (i = 0; i < ESDM_LAT_BUCKETS; i++)
+		total += hist->count[i];
+
+	return total;
+}
+
+size_t esdm_lat_report(struct esdm_lat_registry *reg, unsigned int idx,
+		       const char *name, char *buf, size_t buflen)
+{
+	struct esdm_lat_hist hist;
+	uint64_t total;
+	int ret;
+
+	if (!buflen || idx >= reg->nhist)
+		return 0;
+	buf[0] = '\0';
+
+	total = esdm_lat_aggregate(reg, idx, &hist);
+	if (!total)
+		return 0;
+
+	ret = snprintf(buf, buflen,
+		       " %s: count %llu p50 %llu p99 %llu p999 %llu max %llu ns\n",
+		       name, (unsigned long long)total,
+		       (unsigned long long)esdm_lat_quantile(&hist, total, 500),
+		       (unsigned long long)esdm_lat_quantile(&hist, total, 990),
+		       (unsigned long long)esdm_lat_quantile(&hist, total, 999),
+		       (unsigned long long)hist.max);
+	if (ret < 0)
+		return 0;
+
+	return ((size_t)ret < buflen) ? (size_t)ret : buflen - 1;
+}
+
+#ifdef ESDM_METRICS
+
+/*
+ * The exposed buckets are spaced by a factor of 4 from 1us to 16s. Their
+ * bounds are powers of two, i.e. they coincide with bucket bounds of the
+ * histogram.
+ */
+#define ESDM_LAT_OM_FIRST_EXP 10
+#define ESDM_LAT_OM_EXP_STEP 2
+
+void esdm_lat_openmetrics(struct esdm_lat_registry *reg, unsigned int idx,
+			  const char *family, const char *labels,
+			  struct esdm_metrics_buf *mb)
+{
+	struct esdm_lat_hist hist;
+	uint64_t total, cum = 0;
+	unsigned int i = 0, exp;
+
+	if (idx >= reg->nhist)
+		return;
+
+	total = esdm_lat_aggregate(reg, idx, &hist);
+	if (!total)
+		return;
+
+	for (exp = ESDM_LAT_OM_FIRST_EXP; exp <= ESDM_LAT_MAX_EXP;
+	     exp += ESDM_LAT_OM_EXP_STEP) {
+		/* Sum up all buckets holding values below 2^exp */
+		for (; i < ESDM_LAT_BUCKETS &&
+		       esdm_lat_bucket_value(i) < (UINT64_C(1) << exp);
+		     i++)
+			cum += hist.count[i];
+
+		esdm_metrics_printf(mb, "%s_bucket{%s,le=\"%.12g\"} %llu\n",
+				    family, labels,
+				    (double)(UINT64_C(1) << exp) / 1e9,
+				    (unsigned long long)cum);
+	}
+
+	esdm_metrics_printf(mb, "%s_bucket{%s,le=\"+Inf\"} %llu\n", family,
+			    labels, (unsigned long long)total);
+	esdm_metrics_printf(mb, "%s_count{%s} %llu\n", family, labels,
+			    (unsigned long long)total);
+	esdm_metrics_printf(mb, "%s_sum{%s} %.9f\n", family, labels,
+			    (double)hist.sum / 1e9);
+}
+
+#endif /* ESDM_METRICS */
+
+#endif /* ESDM_LATENCY_STATS */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "config.h"
+#include "metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Log-linear latency histogram: values below 2^ESDM_LAT_SUB_BITS nanoseconds
+ * have one bucket each, every further power of two is divided into
+ * 2^ESDM_LAT_SUB_BITS buckets. The relative error of a reported value
+ * therefore is at most 12.5%. Values above 2^ESDM_LAT_MAX_EXP nanoseconds
+ * (about 17 seconds) are accounted to the last bucket.
+ */
+#define ESDM_LAT_SUB_BITS 3
+#define ESDM_LAT_SUB (1U << ESDM_LAT_SUB_BITS)
+#define ESDM_LAT_MAX_EXP 34
+#define ESDM_LAT_BUCKETS                                                       \
+	((ESDM_LAT_MAX_EXP - ESDM_LAT_SUB_BITS + 2) * ESDM_LAT_SUB)
+
+struct esdm_lat_hist {
+	uint32_t count[ESDM_LAT_BUCKETS];
+	uint64_t max;
+	uint64_t sum;
+};
+
+struct esdm_lat_set;
+
+/*
+ * A registry maintains one set of histograms per thread. Only the owning
+ * thread updates its set, thus recording a value does not require a lock or
+ * an atomic read-modify-write operation. The sets of terminated threads are
+ * folded into the retired set.
+ */
+struct esdm_lat_registry {
+	unsigned int nhist;
+	int key_valid;
+	pthread_key_t key;
+	pthread_mutex_t lock;
+	struct esdm_lat_set *sets;
+	struct esdm_lat_set *retired;
+};
+
+#define ESDM_LAT_REGISTRY_INIT(_nhist)                                         \
+	{                                                                      \
+		.nhist = (_nhist), .key_valid = 0,                              \
+		.lock = PTHREAD_MUTEX_INITIALIZER, .sets = NULL,               \
+		.retired = NULL,                                               \
+	}
+
+#ifdef ESDM_LATENCY_STATS
+
+static inline uint64_t esdm_lat_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Account one value to a histogram of the calling thread
+ *
+ * @param [in] reg Registry holding the histogram
+ * @param [in] idx Index of the histogram in the registry
+ * @param [in] ns Value in nanoseconds
+ */
+void esdm_lat_record(struct esdm_lat_registry *reg, unsigned int idx,
+		     uint64_t ns);
+
+/**
+ * @brief Print the count, p50, p99, p999 and maximum of a histogram
+ *	  aggregated over all threads
+ *
+ * Nothing is printed if the histogram is empty.
+ *
+ * @param [in] reg Registry holding the histogram
+ * @param [in] idx Index of the histogram in the registry
+ * @param [in] name Name of the histogram
+ * @param [out] buf Buffer the NUL-terminated line is written to
+ * @param [in] buflen Size of the buffer
+ *
+ * @return number of characters written
+ */
+size_t esdm_lat_report(struct esdm_lat_registry *reg, unsigned int idx,
+		       const char *name, char *buf, size_t buflen);
+
+#endif /* ESDM_LATENCY_STATS */
+
+#if defined(ESDM_LATENCY_STATS) && defined(ESDM_METRICS)
+
+/**
+ * @brief Append a histogram in the OpenMetrics text format
+ *
+ * The buckets, the count and the sum of the histogram are written in seconds
+ * as samples of the given metric family, the caller writes the TYPE line of
+ * the family. Nothing is written if the histogram is empty.
+ *
+ * @param [in] reg Registry holding the histogram
+ * @param [in] idx Index of the histogram in the registry
+ * @param [in] family Name of the metric family
+ * @param [in] labels Labels of the samples without braces
+ * @param [in] mb Buffer to append to
+ */
+void esdm_lat_openmetrics(struct esdm_lat_registry *reg, unsigned int idx,
+			  const char *family, const char *labels,
+			  struct esdm_metrics_buf *mb);
+
+#else
+
+static inline void esdm_lat_openmetrics(struct esdm_lat_registry *reg,
+					unsigned int idx, const char *family,
+					const char *labels,
+					struct esdm_metrics_buf *mb)
+{
+	(void)reg;
+	(void)idx;
+	(void)family;
+	(void)labels;
+	(void)mb;
+}
+
+#endif
+
+#ifndef ESDM_LATENCY_STATS
+
+static inline uint64_t esdm_lat_now(void)
+{
+	return 0;
+}
+
+static inline void esdm_lat_record(struct esdm_lat_registry *reg,
+				   unsigned int idx, uint64_t ns)
+{
+	(void)reg;
+	(void)idx;
+	(void)ns;
+}
+
+static inline size_t esdm_lat_report(struct esdm_lat_registry *reg,
+				     unsigned int idx, const char *name,
+				     char *buf, size_t buflen)
+{
+	(void)reg;
+	(void)idx;
+	(void)name;
+	(void)buf;
+	(void)buflen;
+	return 0;
+}
+
+#endif /* ESDM_LATENCY_STATS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_HIST_H */
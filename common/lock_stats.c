@@ -0,0 +1,156 @@
+/* Lock contention profiling
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "helper.h"
+#include "lock_stats.h"
+
+/* Merged call sites reported by the status */
+#define ESDM_LOCK_STATS_REPORT 64
+
+static struct esdm_lock_stat *esdm_lock_stats = NULL;
+
+void esdm_lock_stat_register(struct esdm_lock_stat *stat)
+{
+	struct esdm_lock_stat *head;
+
+	/* Only the first caller links the object */
+	if (__atomic_exchange_n(&stat->registered, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	head = __atomic_load_n(&esdm_lock_stats, __ATOMIC_RELAXED);
+	do {
+		stat->next = head;
+	} while (!__atomic_compare_exchange_n(&esdm_lock_stats, &head, stat, 1,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
+
+static void esdm_lock_stats_merge(struct esdm_lock_stat *dst,
+				  const struct esdm_lock_stat *src)
+{
+	uint64_t val;
+
+	dst->acquired += __atomic_load_n(&src->acquired, __ATOMIC_RELAXED);
+	dst->contended += __atomic_load_n(&src->contended, __ATOMIC_RELAXED);
+	dst->wait_ns += __atomic_load_n(&src->wait_ns, __ATOMIC_RELAXED);
+
+	val = __atomic_load_n(&src->wait_max_ns, __ATOMIC_RELAXED);
+	if (val > dst->wait_max_ns)
+		dst->wait_max_ns = val;
+	val = __atomic_load_n(&src->hold_max_ns, __ATOMIC_RELAXED);
+	if (val > dst->hold_max_ns)
+		dst->hold_max_ns = val;
+}
+
+/* Collect the call sites, merge duplicates and order them by wait time */
+static unsigned int esdm_lock_stats_collect(struct esdm_lock_stat *sites)
+{
+	struct esdm_lock_stat *stat, tmp;
+	unsigned int num = 0, i, j;
+
+	for (stat = __atomic_load_n(&esdm_lock_stats, __ATOMIC_ACQUIRE); stat;
+	     stat = stat->next) {
+		/*
+		 * Locks in static inline functions of a header have one
+		 * object per compilation unit.
+		 */
+		for (i = 0; i < num; i++) {
+			if (sites[i].line == stat->line &&
+			    !strcmp(sites[i].file, stat->file) &&
+			    !strcmp(sites[i].name, stat->name))
+				break;
+		}
+
+		if (i == num) {
+			if (num == ESDM_LOCK_STATS_REPORT)
+				continue;
+
+			memset(&sites[num], 0, sizeof(sites[num]));
+			sites[num].name = stat->name;
+			sites[num].file = stat->file;
+			sites[num].line = stat->line;
+			sites[num].rw = stat->rw;
+			num++;
+		}
+
+		esdm_lock_stats_merge(&sites[i], stat);
+	}
+
+	for (i = 1; i < num; i++) {
+		tmp = sites[i];
+		for (j = i; j > 0 && sites[j - 1].wait_ns < tmp.wait_ns; j--)
+			sites[j] = sites[j - 1];
+		sites[j] = tmp;
+	}
+
+	return num;
+}
+
+void esdm_lock_stats_status(char *buf, size_t buflen)
+{
+	struct esdm_lock_stat sites[ESDM_LOCK_STATS_REPORT];
+	unsigned int num, i;
+	size_t len;
+	int ret;
+
+	if (!buflen)
+		return;
+	buf[0] = '\0';
+
+	num = esdm_lock_stats_collect(sites);
+	if (!num)
+		return;
+
+	ret = snprintf(buf, buflen, "Lock contention:\n");
+	if (ret < 0 || (size_t)ret >= buflen)
+		return;
+	len = (size_t)ret;
+
+	for (i = 0; i < num; i++) {
+		const struct esdm_lock_stat *s = &sites[i];
+		const char *file = strrchr(s->file, '/');
+		char hold[48] = "";
+
+		if (!s->rw) {
+			snprintf(hold, sizeof(hold), " hold max %llu us",
+				 (unsigned long long)(s->hold_max_ns / 1000));
+		}
+
+		ret = snprintf(buf + len, buflen - len,
+			       " %s:%u %s: acquired %llu contended %llu wait %llu us (max %llu us)%s\n",
+			       file ? file + 1 : s->file, s->line, s->name,
+			       (unsigned long long)s->acquired,
+			       (unsigned long long)s->contended,
+			       (unsigned long long)(s->wait_ns / 1000),
+			       (unsigned long long)(s->wait_max_ns / 1000),
+			       hold);
+
+		/* Drop the truncated line */
+		if (ret < 0 || (size_t)ret >= buflen - len) {
+			buf[len] = '\0';
+			return;
+		}
+		len += (size_t)ret;
+	}
+}
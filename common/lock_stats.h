@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#ifndef LOCK_STATS_H
+#define LOCK_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock contention profiling: every call site taking a lock owns one static
+ * statistics object. The first acquisition links the object into a global
+ * list, the status report merges all call sites.
+ *
+ * @name: Lock expression as written at the call site
+ * @file: Source file of the call site
+ * @line: Line of the call site
+ * @rw: Reader/writer lock without hold time accounting
+ * @acquired: Number of acquisitions
+ * @contended: Number of acquisitions which found the lock taken
+ * @wait_ns: Accumulated time spent waiting for the lock
+ * @wait_max_ns: Largest wait time
+ * @hold_max_ns: Largest time the lock was held
+ */
+struct esdm_lock_stat {
+	const char *name;
+	const char *file;
+	unsigned int line;
+	int rw;
+	int registered;
+	struct esdm_lock_stat *next;
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t wait_ns;
+	uint64_t wait_max_ns;
+	uint64_t hold_max_ns;
+};
+
+#ifdef ESDM_LOCK_STATS
+
+#define ESDM_LOCK_STAT_INIT(_name, _rw)                                        \
+	{                                                                      \
+		.name = (_name), .file = __FILE__, .line = __LINE__,           \
+		.rw = (_rw),                                                   \
+	}
+
+void esdm_lock_stat_register(struct esdm_lock_stat *stat);
+
+static inline uint64_t esdm_lock_stat_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void esdm_lock_stat_max(uint64_t *max, uint64_t val)
+{
+	uint64_t old = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+	while (val > old &&
+	       !__atomic_compare_exchange_n(max, &old, val, 1, __ATOMIC_RELAXED,
+					    __ATOMIC_RELAXED))
+		;
+}
+
+/* Account one acquisition, wait_ns is 0 if the lock was free */
+static inline void esdm_lock_stat_acquired(struct esdm_lock_stat *stat,
+					   uint64_t wait_ns, int contended)
+{
+	if (!__atomic_load_n(&stat->registered, __ATOMIC_ACQUIRE))
+		esdm_lock_stat_register(stat);
+
+	__atomic_fetch_add(&stat->acquired, 1, __ATOMIC_RELAXED);
+	if (!contended)
+		return;
+
+	__atomic_fetch_add(&stat->contended, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stat->wait_ns, wait_ns, __ATOMIC_RELAXED);
+	esdm_lock_stat_max(&stat->wait_max_ns, wait_ns);
+}
+
+static inline void esdm_lock_stat_released(struct esdm_lock_stat *stat,
+					   uint64_t hold_ns)
+{
+	esdm_lock_stat_max(&stat->hold_max_ns, hold_ns);
+}
+
+/**
+ * @brief Report the contention of the locks
+ *
+ * The call sites are listed with the largest accumulated wait time first.
+ * Call sites of the same lock expression in the same source line are merged.
+ *
+ * @param [out] buf Buffer to be filled with the NUL-terminated report
+ * @param [in] buflen Size of the buffer
+ */
+void esdm_lock_stats_status(char *buf, size_t buflen);
+
+#else /* ESDM_LOCK_STATS */
+
+static inline void esdm_lock_stats_status(char *buf, size_t buflen)
+{
+	if (buflen)
+		buf[0] = '\0';
+}
+
+#endif /* ESDM_LOCK_STATS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOCK_STATS_H */
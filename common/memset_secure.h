@@ -76,12 +76,59 @@
  * clang -03           |  -  |  -  |  X  |  X
  */
 
+#if defined(__x86_64__) && defined(__SSE2__)
+
+#include <emmintrin.h>
+#include <stdint.h>
+
+/*
+ * Buffers of at least this size are zeroized with non-temporal stores which
+ * bypass the CPU caches: the cleared memory is not used again soon and would
+ * otherwise evict useful data from the caches.
+ */
+#define MEMSET_SECURE_NT_THRESHOLD 32768
+
+static inline void memset_secure_nt_zero(void *s, size_t n)
+{
+	uint8_t *p = (uint8_t *)s;
+	size_t head = (size_t)(-(uintptr_t)p & 15);
+	const __m128i zero = _mm_setzero_si128();
+
+	memset(p, 0, head);
+	p += head;
+	n -= head;
+
+	for (; n >= 64; n -= 64, p += 64) {
+		_mm_stream_si128((__m128i *)p, zero);
+		_mm_stream_si128((__m128i *)(p + 16), zero);
+		_mm_stream_si128((__m128i *)(p + 32), zero);
+		_mm_stream_si128((__m128i *)(p + 48), zero);
+	}
+	memset(p, 0, n);
+
+	/* Order the non-temporal stores before any subsequent store */
+	_mm_sfence();
+}
+
+static inline void memset_secure(void *s, int c, size_t n)
+{
+	if (!c && n >= MEMSET_SECURE_NT_THRESHOLD)
+		memset_secure_nt_zero(s, n);
+	else
+		memset(s, c, n);
+	__asm__ __volatile__("" : : "r"(s) : "memory");
+}
+
+#else /* __x86_64__ && __SSE2__ */
+
 static inline void memset_secure(void *s, int c, size_t n)
 {
 	memset(s, c, n);
 	__asm__ __volatile__("" : : "r"(s) : "memory");
 }
 
+#endif /* __x86_64__ && __SSE2__ */
+
 #if 0
 #include <stdio.h>
 
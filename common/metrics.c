@@ -0,0 +1,152 @@
+/* Per-CPU counters and OpenMetrics text helper
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+
+#include "bool.h"
+#include "metrics.h"
+
+static unsigned int esdm_metrics_shard(void)
+{
+#ifdef __linux__
+	int cpu = sched_getcpu();
+
+	if (cpu >= 0)
+		return (unsigned int)cpu & (ESDM_METRICS_SHARDS - 1);
+#endif
+	{
+		/* Without CPU information, spread the threads over the shards */
+		static unsigned int next = 0;
+		static __thread unsigned int shard = ESDM_METRICS_SHARDS;
+
+		if (shard >= ESDM_METRICS_SHARDS)
+			shard = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED) &
+				(ESDM_METRICS_SHARDS - 1);
+		return shard;
+	}
+}
+
+void esdm_metrics_add(struct esdm_metrics *m, unsigned int idx, uint64_t val)
+{
+	if (idx >= m->n)
+		return;
+
+	/* Threads sharing a CPU may still race, the add must be atomic */
+	__atomic_fetch_add(&m->v[esdm_metrics_shard() * m->stride + idx], val,
+			   __ATOMIC_RELAXED);
+}
+
+uint64_t esdm_metrics_read(const struct esdm_metrics *m, unsigned int idx)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	if (idx >= m->n)
+		return 0;
+
+	for (i = 0; i < ESDM_METRICS_SHARDS; i++)
+		sum += __atomic_load_n(&m->v[i * m->stride + idx],
+				       __ATOMIC_RELAXED);
+
+	return sum;
+}
+
+/* Current and peak memory of each subsystem in bytes */
+struct esdm_mem_ctr {
+	int64_t curr;
+	int64_t peak;
+};
+static struct esdm_mem_ctr esdm_mem[esdm_mem_subsys_num];
+
+void esdm_mem_account(enum esdm_mem_subsys subsys, int64_t bytes)
+{
+	struct esdm_mem_ctr *ctr;
+	int64_t curr, peak;
+
+	if ((unsigned int)subsys >= esdm_mem_subsys_num)
+		return;
+
+	ctr = &esdm_mem[subsys];
+	curr = __atomic_add_fetch(&ctr->curr, bytes, __ATOMIC_RELAXED);
+	peak = __atomic_load_n(&ctr->peak, __ATOMIC_RELAXED);
+	while (curr > peak &&
+	       !__atomic_compare_exchange_n(&ctr->peak, &peak, curr, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+void esdm_mem_metrics(struct esdm_metrics_buf *mb)
+{
+	static const char *const names[esdm_mem_subsys_num] = {
+		[esdm_mem_drng] = "drng",
+		[esdm_mem_es] = "es",
+		[esdm_mem_rpc_conn] = "rpc_connection",
+		[esdm_mem_rpc_buf] = "rpc_buffer",
+		[esdm_mem_logger] = "logger",
+	};
+	unsigned int i;
+
+	esdm_metrics_printf(mb, "# TYPE esdm_memory_bytes gauge\n"
+				"# HELP esdm_memory_bytes Memory allocated "
+				"by the subsystem\n");
+	for (i = 0; i < esdm_mem_subsys_num; i++) {
+		esdm_metrics_printf(
+			mb, "esdm_memory_bytes{subsystem=\"%s\"} %lld\n",
+			names[i],
+			(long long)__atomic_load_n(&esdm_mem[i].curr,
+						   __ATOMIC_RELAXED));
+	}
+
+	esdm_metrics_printf(mb, "# TYPE esdm_memory_peak_bytes gauge\n"
+				"# HELP esdm_memory_peak_bytes Maximum memory "
+				"allocated by the subsystem\n");
+	for (i = 0; i < esdm_mem_subsys_num; i++) {
+		esdm_metrics_printf(
+			mb, "esdm_memory_peak_bytes{subsystem=\"%s\"} %lld\n",
+			names[i],
+			(long long)__atomic_load_n(&esdm_mem[i].peak,
+						   __ATOMIC_RELAXED));
+	}
+}
+
+void esdm_metrics_printf(struct esdm_metrics_buf *mb, const char *fmt, ...)
+{
+	va_list args;
+	int ret;
+
+	if (mb->len + 1 >= mb->size)
+		return;
+
+	va_start(args, fmt);
+	ret = vsnprintf(mb->buf + mb->len, mb->size - mb->len, fmt, args);
+	va_end(args);
+
+	if (ret < 0)
+		return;
+	if ((size_t)ret >= mb->size - mb->len) {
+		/* Drop the truncated line */
+		mb->buf[mb->len] = '\0';
+		mb->size = mb->len;
+		return;
+	}
+	mb->len += (size_t)ret;
+}
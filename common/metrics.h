@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "helper.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Counters which are updated from hot paths. Each counter exists once per
+ * shard, a thread updates the shard of the CPU it executes on. Thus, the
+ * updates of different CPUs never touch the same cache line. Reading a
+ * counter sums up all shards.
+ */
+#define ESDM_METRICS_SHARDS 32
+#define ESDM_METRICS_STRIDE(n) (((n) + 7U) & ~7U)
+
+struct esdm_metrics {
+	unsigned int n;
+	unsigned int stride;
+	uint64_t *v;
+};
+
+/* Buffer receiving the OpenMetrics text exposition */
+struct esdm_metrics_buf {
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+/*
+ * Subsystems whose memory allocations are accounted. Only the memory managed
+ * by the ESDM itself is covered, e.g. the states allocated by the crypto
+ * backends are not included.
+ */
+enum esdm_mem_subsys {
+	esdm_mem_drng, /* DRNG instances and their node table */
+	esdm_mem_es, /* Buffers of the entropy sources */
+	esdm_mem_rpc_conn, /* RPC connection objects */
+	esdm_mem_rpc_buf, /* Per-thread RPC message arenas */
+	esdm_mem_logger, /* Logger ring buffers */
+	esdm_mem_subsys_num,
+};
+
+#ifdef ESDM_METRICS
+
+#define ESDM_METRICS_DEFINE(name, num)                                         \
+	static uint64_t name##_v[ESDM_METRICS_SHARDS *                         \
+				 ESDM_METRICS_STRIDE(num)] __aligned(64);      \
+	static struct esdm_metrics name = {                                    \
+		.n = (num), .stride = ESDM_METRICS_STRIDE(num), .v = name##_v, \
+	}
+
+/**
+ * @brief Add a value to a counter
+ *
+ * @param [in] m Counter set
+ * @param [in] idx Index of the counter in the set
+ * @param [in] val Value to add
+ */
+void esdm_metrics_add(struct esdm_metrics *m, unsigned int idx, uint64_t val);
+
+/**
+ * @brief Read a counter
+ *
+ * @param [in] m Counter set
+ * @param [in] idx Index of the counter in the set
+ *
+ * @return sum of the counter over all shards
+ */
+uint64_t esdm_metrics_read(const struct esdm_metrics *m, unsigned int idx);
+
+/**
+ * @brief Append formatted text to the buffer
+ *
+ * Once the buffer is full, further text is discarded. The buffer is always
+ * NUL-terminated.
+ */
+void esdm_metrics_printf(struct esdm_metrics_buf *mb, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Account allocated or released memory of a subsystem
+ *
+ * @param [in] subsys Subsystem owning the memory
+ * @param [in] bytes Number of allocated bytes, negative for released memory
+ */
+void esdm_mem_account(enum esdm_mem_subsys subsys, int64_t bytes);
+
+/**
+ * @brief Append the current and peak memory of all subsystems to the buffer
+ */
+void esdm_mem_metrics(struct esdm_metrics_buf *mb);
+
+#else /* ESDM_METRICS */
+
+#define ESDM_METRICS_DEFINE(name, num)                                         \
+	static struct esdm_metrics name __attribute__((unused)) = { 0 }
+
+static inline void esdm_metrics_add(struct esdm_metrics *m, unsigned int idx,
+				    uint64_t val)
+{
+	(void)m;
+	(void)idx;
+	(void)val;
+}
+
+static inline void esdm_mem_account(enum esdm_mem_subsys subsys,
+				    int64_t bytes)
+{
+	(void)subsys;
+	(void)bytes;
+}
+
+#endif /* ESDM_METRICS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_H */
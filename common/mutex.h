@@ -23,7 +23,9 @@
 #include <errno.h>
 #include <pthread.h>
 
+#include "config.h"
 #include "esdm_logger.h"
+#include "lock_stats.h"
 
 /**
  * @brief Reader / Writer mutex based on pthread
@@ -102,4 +104,54 @@ static inline void mutex_reader_unlock(mutex_t *mutex)
 	pthread_rwlock_unlock(mutex);
 }
 
+#ifdef ESDM_LOCK_STATS
+
+/*
+ * Profiling mode: the lock is attempted without blocking first to detect the
+ * contention, the wait time is accounted to the call site. The hold time is
+ * not tracked as multiple readers may hold the lock.
+ */
+static inline void mutex_lock_stat(mutex_t *mutex, struct esdm_lock_stat *stat)
+{
+	uint64_t start;
+
+	if (pthread_rwlock_trywrlock(mutex)) {
+		start = esdm_lock_stat_now();
+		mutex_lock(mutex);
+		esdm_lock_stat_acquired(stat, esdm_lock_stat_now() - start, 1);
+	} else {
+		esdm_lock_stat_acquired(stat, 0, 0);
+	}
+}
+
+static inline void mutex_reader_lock_stat(mutex_t *mutex,
+					  struct esdm_lock_stat *stat)
+{
+	uint64_t start;
+
+	if (pthread_rwlock_tryrdlock(mutex)) {
+		start = esdm_lock_stat_now();
+		mutex_reader_lock(mutex);
+		esdm_lock_stat_acquired(stat, esdm_lock_stat_now() - start, 1);
+	} else {
+		esdm_lock_stat_acquired(stat, 0, 0);
+	}
+}
+
+#define mutex_lock(mutex)                                                      \
+	do {                                                                   \
+		static struct esdm_lock_stat esdm_lock_stat_site =             \
+			ESDM_LOCK_STAT_INIT(#mutex, 1);                        \
+		mutex_lock_stat((mutex), &esdm_lock_stat_site);                \
+	} while (0)
+
+#define mutex_reader_lock(mutex)                                               \
+	do {                                                                   \
+		static struct esdm_lock_stat esdm_lock_stat_site =             \
+			ESDM_LOCK_STAT_INIT(#mutex, 1);                        \
+		mutex_reader_lock_stat((mutex), &esdm_lock_stat_site);         \
+	} while (0)
+
+#endif /* ESDM_LOCK_STATS */
+
 #endif /* _MUTEX_PTHREAD_H */
@@ -25,6 +25,8 @@
 #include <time.h>
 
 #include "bool.h"
+#include "config.h"
+#include "lock_stats.h"
 
 /**
  * @brief Reader / Writer mutex based on pthread
@@ -32,10 +34,38 @@
 typedef struct {
 	pthread_mutex_t lock;
 	int ma_used;
+	int spin;
 	pthread_mutexattr_t ma;
+#ifdef ESDM_LOCK_STATS
+	struct esdm_lock_stat *stat; /* Call site holding the lock */
+	uint64_t held_since;
+#endif
 } mutex_w_t;
 
 #define MUTEX_W_UNLOCKED { .lock = PTHREAD_MUTEX_INITIALIZER, .ma_used = 0 }
+
+/*
+ * Adaptive mutex: the lock operation spins for a bounded number of attempts
+ * before the caller is put to sleep. This is intended for locks which are
+ * held only for short periods where sleeping in the kernel costs more than
+ * the critical section itself.
+ */
+#define MUTEX_W_ADAPTIVE_UNLOCKED                                              \
+	{ .lock = PTHREAD_MUTEX_INITIALIZER, .ma_used = 0, .spin = 1 }
+
+/* Number of lock attempts of an adaptive mutex before sleeping */
+#define MUTEX_W_SPIN_LOOPS 100
+
+static inline void mutex_w_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield" ::: "memory");
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
 #define DEFINE_MUTEX_W_UNLOCKED(name) mutex_w_t name = MUTEX_W_UNLOCKED
 
 #define DEFINE_MUTEX_W_LOCKED(name) error "DEFINE_MUTEX_LOCKED not implemented"
@@ -46,6 +76,16 @@ typedef struct {
  */
 static inline void mutex_w_lock(mutex_w_t *mutex)
 {
+	if (mutex->spin) {
+		unsigned int i;
+
+		for (i = 0; i < MUTEX_W_SPIN_LOOPS; i++) {
+			if (!pthread_mutex_trylock(&mutex->lock))
+				return;
+			mutex_w_cpu_relax();
+		}
+	}
+
 	pthread_mutex_lock(&mutex->lock);
 }
 
@@ -55,6 +95,15 @@ static inline void mutex_w_lock(mutex_w_t *mutex)
  */
 static inline void mutex_w_unlock(mutex_w_t *mutex)
 {
+#ifdef ESDM_LOCK_STATS
+	struct esdm_lock_stat *stat = mutex->stat;
+
+	if (stat) {
+		mutex->stat = NULL;
+		esdm_lock_stat_released(stat, esdm_lock_stat_now() -
+						      mutex->held_since);
+	}
+#endif
 	pthread_mutex_unlock(&mutex->lock);
 }
 
@@ -73,12 +122,27 @@ static inline void mutex_w_init(mutex_w_t *mutex, int locked, int robust)
 	if (robust)
 		pthread_mutexattr_setrobust(&mutex->ma, PTHREAD_MUTEX_ROBUST);
 
+	mutex->spin = 0;
 	pthread_mutex_init(&mutex->lock, &mutex->ma);
 
 	if (locked)
 		mutex_w_lock(mutex);
 }
 
+/**
+ * @brief Initialize an adaptive mutex (see MUTEX_W_ADAPTIVE_UNLOCKED)
+ * @param [in] mutex Lock variable to initialize.
+ * @param [in] locked Specify whether the lock shall already be locked (1)
+ *		      or unlocked (0).
+ * @param [in] robust initialize a robust mutex (1) or not (0)
+ */
+static inline void mutex_w_init_adaptive(mutex_w_t *mutex, int locked,
+					 int robust)
+{
+	mutex_w_init(mutex, locked, robust);
+	mutex->spin = 1;
+}
+
 static inline void mutex_w_destroy(mutex_w_t *mutex)
 {
 	pthread_mutex_destroy(&mutex->lock);
@@ -113,4 +177,36 @@ static inline int mutex_w_timedlock(mutex_w_t *mutex,
 	return pthread_mutex_clocklock(&mutex->lock, CLOCK_MONOTONIC, abstime);
 }
 
+#ifdef ESDM_LOCK_STATS
+
+/*
+ * Profiling mode: the lock is attempted without blocking first to detect the
+ * contention, the wait and hold times are accounted to the call site.
+ */
+static inline void mutex_w_lock_stat(mutex_w_t *mutex,
+				     struct esdm_lock_stat *stat)
+{
+	uint64_t start;
+
+	if (pthread_mutex_trylock(&mutex->lock)) {
+		start = esdm_lock_stat_now();
+		mutex_w_lock(mutex);
+		mutex->held_since = esdm_lock_stat_now();
+		esdm_lock_stat_acquired(stat, mutex->held_since - start, 1);
+	} else {
+		mutex->held_since = esdm_lock_stat_now();
+		esdm_lock_stat_acquired(stat, 0, 0);
+	}
+	mutex->stat = stat;
+}
+
+#define mutex_w_lock(mutex)                                                    \
+	do {                                                                   \
+		static struct esdm_lock_stat esdm_lock_stat_site =             \
+			ESDM_LOCK_STAT_INIT(#mutex, 0);                        \
+		mutex_w_lock_stat((mutex), &esdm_lock_stat_site);              \
+	} while (0)
+
+#endif /* ESDM_LOCK_STATS */
+
 #endif /* _MUTEX_W_PTHREAD_H */
@@ -31,6 +31,127 @@ extern int pthread_cond_clockwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
 				  clockid_t clockid,
 				  const struct timespec *abstime);
 
+#if defined(__linux__)
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "bool.h"
+
+/* Not declared by unistd.h with a strict _POSIX_C_SOURCE */
+extern long syscall(long number, ...);
+
+/*
+ * Wait queue based on a futex: the sequence counter is the futex word and is
+ * incremented by every wakeup. The waiter counter allows a wakeup to skip the
+ * system call when nobody sleeps, which makes wakeups from hot paths cheap.
+ *
+ * A waiter registers itself and takes a snapshot of the sequence counter
+ * before it evaluates its wait condition. A wakeup changing the condition
+ * after the snapshot either sees the registered waiter or the futex wait
+ * returns immediately due to the changed sequence counter.
+ */
+struct thread_wait_queue {
+	atomic_t seq;
+	atomic_t waiters;
+};
+
+#define DECLARE_WAIT_QUEUE(name)                                               \
+	struct thread_wait_queue name = {                                      \
+		.seq = ATOMIC_INIT(0),                                         \
+		.waiters = ATOMIC_INIT(0),                                     \
+	}
+
+static inline int thread_wait_prepare(struct thread_wait_queue *queue)
+{
+	atomic_inc(&queue->waiters);
+	return atomic_read(&queue->seq);
+}
+
+/*
+ * Sleep until the sequence counter changes from the snapshot taken with
+ * thread_wait_prepare. The return code is -ETIMEDOUT if the timeout expired
+ * and 0 otherwise, including spurious wakeups.
+ */
+static inline int thread_wait_seq(struct thread_wait_queue *queue, int seq,
+				  const struct timespec *reltime)
+{
+	struct timespec ts, *tsp = NULL;
+	long ret;
+
+	/* The futex rejects a timeout with more than 10^9 nanoseconds */
+	if (reltime) {
+		ts.tv_sec = reltime->tv_sec + reltime->tv_nsec / 1000000000;
+		ts.tv_nsec = reltime->tv_nsec % 1000000000;
+		tsp = &ts;
+	}
+
+	ret = syscall(SYS_futex, (int *)&queue->seq.counter,
+		      FUTEX_WAIT_PRIVATE, seq, tsp, NULL, 0);
+
+	atomic_dec(&queue->waiters);
+
+	if (ret < 0 && errno == ETIMEDOUT)
+		return -ETIMEDOUT;
+	return 0;
+}
+
+static inline void thread_wake_n(struct thread_wait_queue *queue, int n)
+{
+	atomic_inc(&queue->seq);
+	if (atomic_read(&queue->waiters))
+		syscall(SYS_futex, (int *)&queue->seq.counter,
+			FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+#define thread_wait_no_event(queue)                                            \
+	thread_wait_seq(queue, thread_wait_prepare(queue), NULL)
+
+/* Timed wait on event, reltime is the relative time to wait */
+#define thread_timedwait_no_event(queue, reltime)                              \
+	do {                                                                   \
+		ret = thread_wait_seq(queue, thread_wait_prepare(queue),       \
+				      reltime);                                \
+	} while (0)
+
+#define thread_wait_event(queue, condition)                                    \
+	for (;;) {                                                             \
+		int __seq = thread_wait_prepare(queue);                        \
+                                                                               \
+		if (condition) {                                               \
+			atomic_dec(&(queue)->waiters);                         \
+			break;                                                 \
+		}                                                              \
+		thread_wait_seq(queue, __seq, NULL);                           \
+	}
+
+#define thread_timedwait_event(queue, condition, reltime)                      \
+	while (!ret) {                                                         \
+		int __seq = thread_wait_prepare(queue);                        \
+                                                                               \
+		if (condition) {                                               \
+			atomic_dec(&(queue)->waiters);                         \
+			break;                                                 \
+		}                                                              \
+		ret = thread_wait_seq(queue, __seq, reltime);                  \
+	}
+
+static inline bool thread_queue_sleeper(struct thread_wait_queue *queue)
+{
+	return !!atomic_read(&queue->waiters);
+}
+
+#define thread_wake(queue) thread_wake_n(queue, 1)
+
+#define thread_wake_all(queue) thread_wake_n(queue, INT_MAX)
+
+#else /* __linux__ */
+
 struct thread_wait_queue {
 	pthread_cond_t thread_wait_cv;
 	pthread_mutex_t thread_wait_lock;
@@ -96,6 +217,8 @@ static inline bool thread_queue_sleeper(struct thread_wait_queue *queue)
 		pthread_cond_broadcast(&(queue)->thread_wait_cv);              \
 	} while (0);
 
+#endif /* __linux__ */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,199 @@
+/* Secure memory pool for sensitive data
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "esdm_logger.h"
+#include "helper.h"
+#include "memset_secure.h"
+#include "mutex_w.h"
+#include "secure_memory.h"
+
+/*
+ * The secure pool consists of one memory region per size class. Every region
+ * is allocated with mmap when the pool is used for the first time, locked
+ * into memory, excluded from core dumps and enclosed by guard pages. The free
+ * slots of a size class are linked in a free list whose link is stored in the
+ * first bytes of the free slot. Free slots are kept zeroized apart from the
+ * link.
+ *
+ * The pool covers the buffers holding random numbers of the RPC and CUSE
+ * request handling. Requests the pool cannot serve are allocated from the
+ * heap.
+ */
+struct esdm_secure_class {
+	size_t size;
+	unsigned int slots;
+
+	mutex_w_t lock;
+	uint8_t *base;
+	size_t len;
+	void *free_list;
+};
+
+static struct esdm_secure_class esdm_secure_classes[] = {
+	{ .size = 256, .slots = 64, .lock = MUTEX_W_ADAPTIVE_UNLOCKED },
+	{ .size = 4096, .slots = 32, .lock = MUTEX_W_ADAPTIVE_UNLOCKED },
+	{ .size = 65536, .slots = 16, .lock = MUTEX_W_ADAPTIVE_UNLOCKED },
+	{ .size = 131072, .slots = 4, .lock = MUTEX_W_ADAPTIVE_UNLOCKED },
+};
+
+static pthread_once_t esdm_secure_once = PTHREAD_ONCE_INIT;
+
+static void esdm_secure_class_init(struct esdm_secure_class *class,
+				   size_t pagesize)
+{
+	size_t len = class->size * class->slots, i;
+	uint8_t *map;
+
+	len = (len + pagesize - 1) & ~(pagesize - 1);
+
+	/* Guard page before and after the data area */
+	map = mmap(NULL, len + 2 * pagesize, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_ANY,
+			    "Secure memory pool for size %zu not available\n",
+			    class->size);
+		return;
+	}
+
+	if (mprotect(map, pagesize, PROT_NONE) ||
+	    mprotect(map + pagesize + len, pagesize, PROT_NONE)) {
+		munmap(map, len + 2 * pagesize);
+		return;
+	}
+
+#ifdef MADV_DONTDUMP
+	madvise(map + pagesize, len, MADV_DONTDUMP);
+#endif
+
+	/* prevent paging out of the sensitive data to swap space */
+	if (mlock(map + pagesize, len)) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+			    "Secure memory pool for size %zu not locked: %d\n",
+			    class->size, errno);
+	}
+
+	class->base = map + pagesize;
+	class->len = len;
+
+	for (i = class->slots; i > 0; i--) {
+		void **slot = (void **)(class->base + (i - 1) * class->size);
+
+		*slot = class->free_list;
+		class->free_list = slot;
+	}
+}
+
+static void esdm_secure_init(void)
+{
+	long pagesize = sysconf(_SC_PAGESIZE);
+	unsigned int i;
+
+	if (pagesize <= 0)
+		pagesize = 4096;
+
+	for (i = 0; i < ARRAY_SIZE(esdm_secure_classes); i++)
+		esdm_secure_class_init(&esdm_secure_classes[i],
+				       (size_t)pagesize);
+}
+
+static struct esdm_secure_class *esdm_secure_class_of(const void *ptr)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(esdm_secure_classes); i++) {
+		struct esdm_secure_class *class = &esdm_secure_classes[i];
+
+		if ((const uint8_t *)ptr >= class->base &&
+		    (const uint8_t *)ptr < class->base + class->len)
+			return class;
+	}
+
+	return NULL;
+}
+
+void *esdm_secure_pool_alloc(size_t len)
+{
+	unsigned int i;
+
+	pthread_once(&esdm_secure_once, esdm_secure_init);
+
+	for (i = 0; i < ARRAY_SIZE(esdm_secure_classes); i++) {
+		struct esdm_secure_class *class = &esdm_secure_classes[i];
+		void **slot;
+
+		if (len > class->size)
+			continue;
+
+		mutex_w_lock(&class->lock);
+		slot = class->free_list;
+		if (slot)
+			class->free_list = *slot;
+		mutex_w_unlock(&class->lock);
+
+		/* A larger size class may still have a free slot */
+		if (!slot)
+			continue;
+
+		*slot = NULL;
+		return slot;
+	}
+
+	return NULL;
+}
+
+void *esdm_secure_alloc(size_t len)
+{
+	void *ptr = esdm_secure_pool_alloc(len);
+
+	if (ptr)
+		return ptr;
+
+	return calloc(1, len);
+}
+
+void esdm_secure_free(void *ptr, size_t len)
+{
+	struct esdm_secure_class *class;
+	void **slot = ptr;
+
+	if (!ptr)
+		return;
+
+	memset_secure(ptr, 0, len);
+
+	class = esdm_secure_class_of(ptr);
+	if (!class) {
+		free(ptr);
+		return;
+	}
+
+	mutex_w_lock(&class->lock);
+	*slot = class->free_list;
+	class->free_list = slot;
+	mutex_w_unlock(&class->lock);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef SECURE_MEMORY_H
+#define SECURE_MEMORY_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocate zeroized memory for sensitive data from the secure pool
+ *
+ * The secure pool is locked into memory, excluded from core dumps and
+ * surrounded by guard pages. If the pool cannot serve the request, the memory
+ * is allocated from the heap.
+ *
+ * @param [in] len Size of the memory
+ *
+ * @return pointer to the memory, NULL on allocation failure
+ */
+void *esdm_secure_alloc(size_t len);
+
+/**
+ * @brief Allocate zeroized memory for sensitive data only from the secure pool
+ *
+ * @param [in] len Size of the memory
+ *
+ * @return pointer to the memory, NULL if the pool cannot serve the request
+ */
+void *esdm_secure_pool_alloc(size_t len);
+
+/**
+ * @brief Zeroize and release memory obtained with esdm_secure_alloc or
+ *	  esdm_secure_pool_alloc
+ *
+ * @param [in] ptr Memory to release - NULL is allowed
+ * @param [in] len Size of the memory used during allocation
+ */
+void esdm_secure_free(void *ptr, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SECURE_MEMORY_H */
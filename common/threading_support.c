@@ -21,22 +21,116 @@
 #define _GNU_SOURCE
 #include <errno.h>
 #include <limits.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "atomic.h"
+#include "atomic_64.h"
 #include "atomic_bool.h"
 #include "bool.h"
 #include "config.h"
 #include "esdm_logger.h"
+#include "helper.h"
+#include "math_helper.h"
 #include "memset_secure.h"
+#include "metrics.h"
 #include "mutex_w.h"
 #include "ret_checkers.h"
 #include "threading_support.h"
 #include "visibility.h"
 
+#ifdef ESDM_METRICS
+/* Frame of thread_set_name and type of the calling thread */
+static __thread uintptr_t thread_stack_top = 0;
+static __thread unsigned int thread_stack_type = esdm_request_type_last;
+static uint64_t thread_stack_peak[esdm_request_type_last];
+
+static void thread_stack_init(enum esdm_request_type type)
+{
+	if ((unsigned int)type >= esdm_request_type_last)
+		return;
+
+	thread_stack_top = (uintptr_t)__builtin_frame_address(0);
+	thread_stack_type = type;
+}
+
+/* Not inlined to measure the frame of the caller as well */
+DSO_PUBLIC __attribute__((noinline))
+void thread_stack_probe(void)
+{
+	uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+	uint64_t depth, peak;
+
+	/* The stack grows downwards on all supported architectures */
+	if (thread_stack_type >= esdm_request_type_last ||
+	    sp > thread_stack_top)
+		return;
+
+	depth = thread_stack_top - sp;
+	peak = __atomic_load_n(&thread_stack_peak[thread_stack_type],
+			       __ATOMIC_RELAXED);
+	while (depth > peak &&
+	       !__atomic_compare_exchange_n(
+		       &thread_stack_peak[thread_stack_type], &peak, depth,
+		       true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+DSO_PUBLIC
+void thread_stack_metrics(struct esdm_metrics_buf *mb)
+{
+	static const char *const names[esdm_request_type_last] = {
+		[es_monitor] = "es_monitor",
+		[es_kernel_feeder] = "es_kernel_feeder",
+		[es_kdev_feeder] = "es_kdev_feeder",
+		[drng_reseeder] = "drng_reseeder",
+		[es_collector] = "es_collector",
+		[rpc_unpriv_server] = "rpc_unpriv_server",
+		[rpc_priv_server] = "rpc_priv_server",
+		[rpc_handler] = "rpc_handler",
+		[rpc_reactor] = "rpc_reactor",
+		[rpc_vsock_server] = "rpc_vsock_server",
+		[rpc_ring_filler] = "rpc_ring_filler",
+		[rpc_ent_ring_drain] = "rpc_ent_ring_drain",
+		[rpc_metrics] = "rpc_metrics",
+		[rpc_handover] = "rpc_handover",
+		[rpc_park] = "rpc_park",
+		[rpc_config_reload] = "rpc_config_reload",
+		[cuse_poll] = "cuse_poll",
+		[cuse_entropy] = "cuse_entropy",
+	};
+	unsigned int i;
+
+	esdm_metrics_printf(mb, "# TYPE esdm_thread_stack_peak_bytes gauge\n"
+				"# HELP esdm_thread_stack_peak_bytes Estimated "
+				"peak stack use of the thread type\n");
+	for (i = 0; i < esdm_request_type_last; i++) {
+		uint64_t peak = __atomic_load_n(&thread_stack_peak[i],
+						__ATOMIC_RELAXED);
+
+		/* Thread types never probed are not reported */
+		if (!peak)
+			continue;
+		esdm_metrics_printf(
+			mb, "esdm_thread_stack_peak_bytes{thread=\"%s\"} %llu\n",
+			names[i], (unsigned long long)peak);
+	}
+}
+
+#else /* ESDM_METRICS */
+
+static inline void thread_stack_init(enum esdm_request_type type)
+{
+	(void)type;
+}
+
+#endif /* ESDM_METRICS */
+
 #ifdef CONFIG_ESDM_USE_PTHREAD
 
 /**
@@ -50,7 +144,49 @@
  *
  * It is permissible to spawn new threads from different mother threads. When
  * calling thread_wait, only the threads from the caller are waited for.
+ *
+ * If all threads of a thread group are busy, the job is queued instead of
+ * blocking the caller: each thread owns a lock-free bounded job queue. A job
+ * is placed into the queue of one thread of the group selected in a
+ * round-robin fashion. Idle threads first process the jobs of their own queue
+ * and then steal jobs from the queues of the other threads of the group. The
+ * caller only blocks if all queues of the thread group are full. Special
+ * thread groups do not queue jobs.
+ *
+ * Free thread slots are tracked in a bitmap. A caller claims a slot by
+ * atomically clearing its bit instead of probing the lock of every slot of
+ * the thread group. The bitmap is only a hint: the slot lock still
+ * serializes the use of the thread slot, a claimed slot found to be busy is
+ * returned to the bitmap.
+ */
+
+/*
+ * Number of jobs which can be queued per thread - must be a power of 2
+ */
+#define THREADING_QUEUE_DEPTH 16
+
+/*
+ * Queued job - the sequence number synchronizes the producers and
+ * consumers of the queue slot.
  */
+struct thread_job {
+	atomic_t seq;
+	int (*start_routine)(void *);
+	void *data;
+	pthread_t parent;
+};
+
+/*
+ * Bounded multi-producer multi-consumer job queue of one thread
+ */
+struct thread_queue {
+	atomic_t head; /* Next job to be dequeued */
+	atomic_t tail; /* Next free slot to be enqueued */
+	struct thread_job jobs[THREADING_QUEUE_DEPTH];
+};
+
+/* Alignment of the thread structures to prevent false sharing */
+#define THREADING_CACHELINE_SIZE 64
 
 /*
  * Structure for one thread
@@ -71,18 +207,38 @@ struct thread_ctx {
 					 * is ready for pickup? */
 
 	pthread_cond_t worker_cv;
-};
+
+	struct thread_queue queue; /* Jobs queued for this thread */
+	atomic_bool_t idle; /* Is thread looking for or waiting for work? */
+} __aligned(THREADING_CACHELINE_SIZE);
+
+/*
+ * Number of worker thread slots: at least THREADING_MAX_THREADS, but one per
+ * online CPU on larger systems unless set with thread_set_max_threads.
+ * The value is fixed at the first use.
+ */
+#define THREADING_MAX_THREADS_LIMIT 4096
+static uint32_t threads_max = 0;
+static atomic_t threads_max_fixed = ATOMIC_INIT(0);
 
 /*
  * Total number of all threads, including slaves and system threads.
  */
 #define THREADING_REALLY_ALL_THREADS                                           \
-	(THREADING_MAX_THREADS + ESDM_THREAD_MAX_SPECIAL_GROUPS)
+	(threads_max + ESDM_THREAD_MAX_SPECIAL_GROUPS)
 
 /*
- * Array holding the thread state for all slaves and system threads.
+ * Array holding the thread state for all slaves and system threads, allocated
+ * by thread_init.
  */
-static struct thread_ctx threads[THREADING_REALLY_ALL_THREADS];
+static struct thread_ctx *threads = NULL;
+
+/*
+ * Bitmap of the thread slots which can accept a job - a set bit marks a
+ * free slot.
+ */
+#define THREADING_FREE_WORDS ((THREADING_REALLY_ALL_THREADS + 63) / 64)
+static atomic_64_t *threads_free = NULL;
 static uint32_t threads_groups = 0;
 static uint32_t threads_per_threadgroup = 1;
 
@@ -101,6 +257,11 @@ static atomic_bool_t threads_in_cancel = ATOMIC_BOOL_INIT(false);
  */
 static DEFINE_MUTEX_W_UNLOCKED(threads_cleanup);
 
+/* Number of queued jobs not yet picked up by a thread */
+static atomic_t threads_queued = ATOMIC_INIT(0);
+/* Round-robin selector of the queue receiving the next job */
+static atomic_t threads_queue_next = ATOMIC_INIT(0);
+
 /* Waiting helper for the thread_schedule function */
 static pthread_cond_t thread_schedule_cv;
 static pthread_mutex_t thread_schedule_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -109,18 +270,55 @@ static pthread_mutex_t thread_schedule_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t thread_wait_cv;
 static pthread_mutex_t thread_wait_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Idle time in seconds after which a worker thread terminates - the first
+ * thread of each thread group is kept.
+ */
+#define THREADING_IDLE_TIMEOUT_SEC 30
+
+DSO_PUBLIC
+uint32_t thread_max_threads(void)
+{
+	if (atomic_read(&threads_max_fixed))
+		return threads_max;
+
+	if (!threads_max) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads_max = THREADING_MAX_THREADS;
+		if (ncpus > 0 && (unsigned long)ncpus > threads_max)
+			threads_max = min_uint32((uint32_t)ncpus,
+						 THREADING_MAX_THREADS_LIMIT);
+	}
+	atomic_set(&threads_max_fixed, 1);
+
+	return threads_max;
+}
+
+DSO_PUBLIC
+int thread_set_max_threads(uint32_t max_threads)
+{
+	if (atomic_read(&threads_max_fixed))
+		return -EBUSY;
+	if (!max_threads || max_threads > THREADING_MAX_THREADS_LIMIT)
+		return -EINVAL;
+
+	threads_max = max_threads;
+	return 0;
+}
+
 static inline unsigned int thread_get_special_slot(unsigned int thread_group)
 {
-	if (thread_group <= THREADING_MAX_THREADS)
+	if (thread_group <= threads_max)
 		return 0;
 
 	/* Special groups are defined as (uint32_t)-1 and lower */
-	return (THREADING_MAX_THREADS + (UINT_MAX - thread_group));
+	return (threads_max + (UINT_MAX - thread_group));
 }
 
 static inline bool thread_is_special(struct thread_ctx *tctx)
 {
-	return (tctx->thread_num >= THREADING_MAX_THREADS) ? true : false;
+	return (tctx->thread_num >= threads_max) ? true : false;
 }
 
 static inline void thread_block(pthread_cond_t *cv, pthread_mutex_t *lock)
@@ -136,11 +334,231 @@ static inline bool thread_dirty(unsigned int slot)
 	return (atomic_bool_read(&threads[slot].thread_pending));
 }
 
+static inline long long thread_slot_bit(unsigned int slot)
+{
+	return (long long)(1ULL << (slot % 64));
+}
+
+/* Mark the slot as free */
+static inline void thread_slot_release(unsigned int slot)
+{
+	atomic_or_64(&threads_free[slot / 64], thread_slot_bit(slot));
+}
+
+/* Mark the slot as busy */
+static inline void thread_slot_busy(unsigned int slot)
+{
+	atomic_and_64(&threads_free[slot / 64], ~thread_slot_bit(slot));
+}
+
+/* Claim the slot, return false if the slot is not free */
+static bool thread_slot_claim(unsigned int slot)
+{
+	atomic_64_t *word = &threads_free[slot / 64];
+	long long bit = thread_slot_bit(slot), old;
+
+	do {
+		old = atomic_read_64(word);
+		if (!(old & bit))
+			return false;
+	} while (atomic_cmpxchg_64(word, old, old & ~bit) != old);
+
+	return true;
+}
+
+/* Find the first free slot in the range of slots, return upper if none */
+static unsigned int thread_slot_find(unsigned int slot, unsigned int upper)
+{
+	while (slot < upper) {
+		unsigned long long word =
+			(unsigned long long)atomic_read_64(
+				&threads_free[slot / 64]) >>
+			(slot % 64);
+
+		if (word) {
+			slot += (unsigned int)__builtin_ctzll(word);
+			return (slot < upper) ? slot : upper;
+		}
+
+		slot = (slot / 64 + 1) * 64;
+	}
+
+	return upper;
+}
+
+static void thread_queue_init(struct thread_queue *queue)
+{
+	unsigned int i;
+
+	atomic_set(&queue->head, 0);
+	atomic_set(&queue->tail, 0);
+	for (i = 0; i < THREADING_QUEUE_DEPTH; i++)
+		atomic_set(&queue->jobs[i].seq, (int)i);
+}
+
+/* Add a job to the queue, return -EAGAIN if the queue is full */
+static int thread_queue_push(struct thread_queue *queue,
+			     int (*start_routine)(void *), void *tdata)
+{
+	struct thread_job *job;
+	unsigned int pos = (unsigned int)atomic_read(&queue->tail);
+	int diff;
+
+	for (;;) {
+		job = &queue->jobs[pos & (THREADING_QUEUE_DEPTH - 1)];
+		diff = (int)((unsigned int)atomic_read(&job->seq) - pos);
+
+		if (!diff) {
+			/* Slot is free, try to claim it */
+			if ((unsigned int)atomic_cmpxchg(&queue->tail, (int)pos,
+							 (int)(pos + 1)) == pos)
+				break;
+			pos = (unsigned int)atomic_read(&queue->tail);
+		} else if (diff < 0) {
+			/* Slot still holds a job from the previous round */
+			return -EAGAIN;
+		} else {
+			/* Another producer claimed the slot */
+			pos = (unsigned int)atomic_read(&queue->tail);
+		}
+	}
+
+	job->start_routine = start_routine;
+	job->data = tdata;
+	job->parent = pthread_self();
+
+	/* Publish the job to the consumers */
+	atomic_set(&job->seq, (int)(pos + 1));
+
+	return 0;
+}
+
+/* Remove the oldest job from the queue, return false if the queue is empty */
+static bool thread_queue_pop(struct thread_queue *queue, struct thread_job *out)
+{
+	struct thread_job *job;
+	unsigned int pos = (unsigned int)atomic_read(&queue->head);
+	int diff;
+
+	for (;;) {
+		job = &queue->jobs[pos & (THREADING_QUEUE_DEPTH - 1)];
+		diff = (int)((unsigned int)atomic_read(&job->seq) - (pos + 1));
+
+		if (!diff) {
+			/* Slot holds a job, try to claim it */
+			if ((unsigned int)atomic_cmpxchg(&queue->head, (int)pos,
+							 (int)(pos + 1)) == pos)
+				break;
+			pos = (unsigned int)atomic_read(&queue->head);
+		} else if (diff < 0) {
+			/* Queue is empty */
+			return false;
+		} else {
+			/* Another consumer claimed the slot */
+			pos = (unsigned int)atomic_read(&queue->head);
+		}
+	}
+
+	out->start_routine = job->start_routine;
+	out->data = job->data;
+	out->parent = job->parent;
+
+	/* Release the slot to the producers of the next round */
+	atomic_set(&job->seq, (int)(pos + THREADING_QUEUE_DEPTH));
+
+	return true;
+}
+
+/*
+ * Fetch a queued job for the thread: the own queue is served first, then
+ * jobs are stolen from the other threads of the same thread group.
+ */
+static bool thread_queue_get(struct thread_ctx *tctx, struct thread_job *out)
+{
+	unsigned int i, base, offset;
+
+	if (thread_is_special(tctx))
+		return false;
+
+	base = (tctx->thread_num / threads_per_threadgroup) *
+	       threads_per_threadgroup;
+	offset = tctx->thread_num - base;
+
+	for (i = 0; i < threads_per_threadgroup; i++) {
+		unsigned int slot =
+			base + ((offset + i) % threads_per_threadgroup);
+
+		if (thread_queue_pop(&threads[slot].queue, out))
+			return true;
+	}
+
+	return false;
+}
+
+/* Wake up one idle thread of the range of slots to process queued jobs */
+static void thread_queue_kick(unsigned int i, unsigned int upper)
+{
+	for (; i < upper; i++) {
+		/*
+		 * An idle thread holds its lock only while checking for queued
+		 * jobs before it waits. Once the lock is obtained, the thread
+		 * is guaranteed to wait on its condition variable.
+		 */
+		while (atomic_bool_read(&threads[i].idle)) {
+			if (mutex_w_trylock(&threads[i].inuse)) {
+				pthread_cond_broadcast(&threads[i].worker_cv);
+				mutex_w_unlock(&threads[i].inuse);
+				return;
+			}
+			sched_yield();
+		}
+	}
+
+	/*
+	 * All threads are busy, the queue is processed once the first thread
+	 * completes its job.
+	 */
+}
+
+/* Queue the job for one thread of the range of slots */
+static int thread_enqueue(int (*start_routine)(void *), void *tdata,
+			  uint32_t thread_group, unsigned int i,
+			  unsigned int upper, int *ret_ancestor)
+{
+	unsigned int j, slot, num = upper - i;
+	unsigned int start = (unsigned int)atomic_inc(&threads_queue_next);
+
+	/* Account the job before it becomes visible to the consumers */
+	atomic_inc(&threads_queued);
+
+	for (j = 0; j < num; j++) {
+		slot = i + ((start + j) % num);
+
+		if (thread_queue_push(&threads[slot].queue, start_routine,
+				      tdata))
+			continue;
+
+		/* Return code of a queued job is collected by thread_wait */
+		if (ret_ancestor)
+			*ret_ancestor = 0;
+
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_THREADING,
+			    "Job queued for thread %u of thread group %u\n",
+			    slot, thread_group);
+		thread_queue_kick(i, upper);
+		return 0;
+	}
+
+	atomic_dec(&threads_queued);
+	return -EAGAIN;
+}
+
 /* Thread structure cleanup after execution when thread is kept alive. */
 static inline void thread_cleanup(struct thread_ctx *tctx)
 {
 	tctx->data = NULL;
 	tctx->start_routine = NULL;
+	thread_slot_release(tctx->thread_num);
 	pthread_cond_broadcast(&thread_schedule_cv);
 	pthread_cond_broadcast(&thread_wait_cv);
 
@@ -163,14 +581,15 @@ static inline void thread_cleanup_full(struct thread_ctx *tctx)
 int thread_init(uint32_t groups)
 {
 	static uint32_t thread_initialized = 0;
+	uint32_t max_threads = thread_max_threads();
 	unsigned int i;
 	int ret;
 
-	if (groups > (THREADING_MAX_THREADS)) {
+	if (groups > max_threads) {
 		esdm_logger(
 			LOGGER_ERR, LOGGER_C_THREADING,
 			"Number of threads (%u) is less than the number of requested thread groups (%u)\n",
-			THREADING_MAX_THREADS, groups);
+			max_threads, groups);
 		return -EINVAL;
 	}
 
@@ -178,35 +597,123 @@ int thread_init(uint32_t groups)
 		groups = 1;
 
 	if (thread_initialized)
+		return 0;
+
+	/* Prevent false sharing of the thread contexts */
+	ret = -posix_memalign((void **)&threads, THREADING_CACHELINE_SIZE,
+			      THREADING_REALLY_ALL_THREADS *
+				      sizeof(struct thread_ctx));
+	if (ret) {
+		threads = NULL;
 		goto out;
+	}
+	memset(threads, 0,
+	       THREADING_REALLY_ALL_THREADS * sizeof(struct thread_ctx));
+
+	threads_free = calloc(THREADING_FREE_WORDS, sizeof(atomic_64_t));
+	if (!threads_free) {
+		free(threads);
+		threads = NULL;
+		ret = -ENOMEM;
+		goto out;
+	}
 	thread_initialized = 1;
 
 	mutex_w_init(&threads_cleanup, 0, 1);
 
 	CKINT(pthread_attr_init(&pthread_attr));
-	memset(threads, 0, sizeof(threads));
 
 	for (i = 0; i < THREADING_REALLY_ALL_THREADS; i++) {
 		atomic_bool_set_false(&threads[i].thread_pending);
 		mutex_w_init(&threads[i].inuse, false, 1);
 		atomic_bool_set_false(&threads[i].shutdown);
+		atomic_bool_set_false(&threads[i].idle);
+		thread_queue_init(&threads[i].queue);
+		thread_slot_release(i);
 	}
 
 	threads_groups = groups;
-	threads_per_threadgroup = THREADING_MAX_THREADS / threads_groups;
+	threads_per_threadgroup = max_threads / threads_groups;
 
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_THREADING,
 		    "Initialized threading support for %u threads\n",
-		    THREADING_MAX_THREADS);
-	if (threads_per_threadgroup * threads_groups < THREADING_MAX_THREADS) {
+		    max_threads);
+	if (threads_per_threadgroup * threads_groups < max_threads) {
 		esdm_logger(LOGGER_WARN, LOGGER_C_THREADING,
 			    "%u thread slots will never be used\n",
-			    THREADING_MAX_THREADS -
+			    max_threads -
 				    (threads_per_threadgroup * threads_groups));
 	}
 
 out:
-	return 0;
+	return ret;
+}
+
+/*
+ * Terminate an idle worker thread, the slot is then treated as a clean slot
+ * for which thread_schedule spawns a new thread. The termination is skipped
+ * while the cleanup functions execute as they join the threads. The caller
+ * must hold the inuse lock which is released on success.
+ */
+static bool thread_retire(struct thread_ctx *tctx)
+{
+	unsigned int offset = tctx->thread_num % threads_per_threadgroup;
+
+	/*
+	 * Keep one thread per group and error codes not yet collected - a
+	 * clean slot reports a return code of 0 to the parent.
+	 */
+	if (thread_is_special(tctx) || !offset ||
+	    (tctx->scheduled && tctx->ret_ancestor) || tctx->start_routine ||
+	    atomic_bool_read(&tctx->shutdown))
+		return false;
+
+	if (!mutex_w_trylock(&threads_cleanup))
+		return false;
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_THREADING,
+		    "Idle thread %u terminated\n", tctx->thread_num);
+
+	/* The context must not be accessed once the inuse lock is released */
+	pthread_detach(pthread_self());
+	atomic_bool_set_false(&tctx->idle);
+	tctx->scheduled = false;
+	tctx->ret_ancestor = 0;
+	atomic_bool_set_false(&tctx->thread_pending);
+	mutex_w_unlock(&tctx->inuse);
+	mutex_w_unlock(&threads_cleanup);
+
+	return true;
+}
+
+/*
+ * Wait for work with the inuse lock held, return true if the thread
+ * terminated because it was idle for THREADING_IDLE_TIMEOUT_SEC.
+ */
+static bool thread_idle_wait(struct thread_ctx *tctx)
+{
+	struct timespec ts;
+	struct thread_job job;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += THREADING_IDLE_TIMEOUT_SEC;
+
+	if (pthread_cond_timedwait(&tctx->worker_cv, &tctx->inuse.lock,
+				   &ts) != ETIMEDOUT)
+		return false;
+
+	/* A job queued while waiting without a wakeup is processed first */
+	if (thread_queue_get(tctx, &job)) {
+		thread_slot_busy(tctx->thread_num);
+		atomic_dec(&threads_queued);
+		tctx->data = job.data;
+		tctx->parent = job.parent;
+		tctx->scheduled = true;
+		tctx->start_routine = job.start_routine;
+		return false;
+	}
+
+	return thread_retire(tctx);
 }
 
 /* Worker loop of a thread */
@@ -258,9 +765,30 @@ static void *thread_worker(void *arg)
 			mutex_w_unlock(&tctx->inuse);
 			pthread_cond_broadcast(&thread_wait_cv);
 		} else {
+			struct thread_job job;
+
 			/* Idle */
 			/* inuse.lock is locked */
-			pthread_cond_wait(&tctx->worker_cv, &tctx->inuse.lock);
+			atomic_bool_set_true(&tctx->idle);
+
+			/* Pick up a queued job of the thread group */
+			if (thread_queue_get(tctx, &job)) {
+				thread_slot_busy(tctx->thread_num);
+				atomic_bool_set_false(&tctx->idle);
+				atomic_dec(&threads_queued);
+				tctx->data = job.data;
+				tctx->parent = job.parent;
+				tctx->scheduled = true;
+				tctx->start_routine = job.start_routine;
+				esdm_logger(LOGGER_VERBOSE, LOGGER_C_THREADING,
+					    "Thread %u picked up queued job\n",
+					    tctx->thread_num);
+				goto locked;
+			}
+
+			if (thread_idle_wait(tctx))
+				return NULL;
+			atomic_bool_set_false(&tctx->idle);
 			/* inuse.lock is locked */
 			goto locked;
 		}
@@ -300,6 +828,9 @@ void thread_send_signal(uint32_t thread_group, int signal)
 	unsigned int i, upper;
 	unsigned int special_slot = thread_get_special_slot(thread_group);
 
+	if (!threads)
+		return;
+
 	/* Get the range of slots of the thread_group */
 	if (special_slot) {
 		i = special_slot;
@@ -325,9 +856,15 @@ static int thread_schedule(int (*start_routine)(void *), void *tdata,
 			   uint32_t thread_group, int *ret_ancestor)
 {
 	pthread_t self = pthread_self();
-	unsigned int i, upper;
+	unsigned int i, upper, slot;
 	unsigned int special_slot = thread_get_special_slot(thread_group);
 
+	if (!threads) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_THREADING,
+			    "threading support is not initialized\n");
+		return -EINVAL;
+	}
+
 	if (threads_groups < thread_group && !special_slot) {
 		esdm_logger(
 			LOGGER_ERR, LOGGER_C_THREADING,
@@ -345,70 +882,85 @@ static int thread_schedule(int (*start_routine)(void *), void *tdata,
 		upper = (thread_group + 1) * threads_per_threadgroup;
 	}
 
-	for (; i < upper; i++) {
+	for (slot = thread_slot_find(i, upper); slot < upper;
+	     slot = thread_slot_find(slot + 1, upper)) {
 		if (atomic_bool_read(&threads_in_cancel))
 			return -ESHUTDOWN;
 
-		if (mutex_w_trylock(&threads[i].inuse)) {
-			/*
-			 * The thread is currently executing a body of code -
-			 * kick the worker.
-			 */
-			if (threads[i].start_routine ||
-			    atomic_bool_read(&threads[i].shutdown)) {
-				mutex_w_unlock(&threads[i].inuse);
-				pthread_cond_broadcast(&threads[i].worker_cv);
-				continue;
-			}
+		if (!thread_slot_claim(slot))
+			continue;
 
-			/*
-			 * Thread is not being picked up by thread_block of the
-			 * mother thread - kick the worker.
-			 */
-			if (threads[i].scheduled &&
-			    !pthread_equal(threads[i].parent, self)) {
-				mutex_w_unlock(&threads[i].inuse);
-				pthread_cond_broadcast(&threads[i].worker_cv);
-				continue;
-			}
+		if (!mutex_w_trylock(&threads[slot].inuse)) {
+			thread_slot_release(slot);
+			continue;
+		}
 
-			/*
-			 * Create thread as we have a clean slot and all
-			 * existing threads are busy.
-			 */
-			if (!thread_dirty(i)) {
-				int ret = thread_create(&threads[i], i);
+		/*
+		 * The thread is currently executing a body of code - kick the
+		 * worker.
+		 */
+		if (threads[slot].start_routine ||
+		    atomic_bool_read(&threads[slot].shutdown)) {
+			mutex_w_unlock(&threads[slot].inuse);
+			thread_slot_release(slot);
+			pthread_cond_broadcast(&threads[slot].worker_cv);
+			continue;
+		}
 
-				if (ret)
-					return ret;
+		/*
+		 * Thread is not being picked up by thread_block of the mother
+		 * thread - kick the worker.
+		 */
+		if (threads[slot].scheduled &&
+		    !pthread_equal(threads[slot].parent, self)) {
+			mutex_w_unlock(&threads[slot].inuse);
+			thread_slot_release(slot);
+			pthread_cond_broadcast(&threads[slot].worker_cv);
+			continue;
+		}
 
-				esdm_logger(
-					LOGGER_VERBOSE, LOGGER_C_THREADING,
-					"Thread %u for thread group %u allocated\n",
-					i, thread_group);
-			}
+		/*
+		 * Create thread as we have a clean slot and all existing
+		 * threads are busy.
+		 */
+		if (!thread_dirty(slot)) {
+			int ret = thread_create(&threads[slot], slot);
 
-			/* Catch the return code of the ancestor thread */
-			if (ret_ancestor)
-				*ret_ancestor = threads[i].ret_ancestor;
+			if (ret)
+				return ret;
 
-			/*
-			 * Use the thread from the thread pool and schedule
-			 * job.
-			 */
 			esdm_logger(LOGGER_VERBOSE, LOGGER_C_THREADING,
-				    "Thread %u for thread group %u assigned\n",
-				    i, thread_group);
-			threads[i].data = tdata;
-			threads[i].start_routine = start_routine;
-			threads[i].parent = pthread_self();
-			threads[i].scheduled = true;
-			pthread_cond_broadcast(&threads[i].worker_cv);
-			mutex_w_unlock(&threads[i].inuse);
-			pthread_cond_broadcast(&thread_wait_cv);
-
-			return 0;
+				    "Thread %u for thread group %u allocated\n",
+				    slot, thread_group);
 		}
+
+		/* Catch the return code of the ancestor thread */
+		if (ret_ancestor)
+			*ret_ancestor = threads[slot].ret_ancestor;
+
+		/*
+		 * Use the thread from the thread pool and schedule
+		 * job.
+		 */
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_THREADING,
+			    "Thread %u for thread group %u assigned\n", slot,
+			    thread_group);
+		threads[slot].data = tdata;
+		threads[slot].start_routine = start_routine;
+		threads[slot].parent = pthread_self();
+		threads[slot].scheduled = true;
+		pthread_cond_broadcast(&threads[slot].worker_cv);
+		mutex_w_unlock(&threads[slot].inuse);
+		pthread_cond_broadcast(&thread_wait_cv);
+
+		return 0;
+	}
+
+	/* All threads of a regular thread group are busy, queue the job */
+	if (!special_slot) {
+		i = thread_group * threads_per_threadgroup;
+		return thread_enqueue(start_routine, tdata, thread_group, i,
+				      upper, ret_ancestor);
 	}
 
 	return -EAGAIN;
@@ -422,13 +974,13 @@ int thread_wait(void)
 	unsigned int i;
 	pthread_t self = pthread_self();
 	int ret = 0;
-	bool wait = true;
+	bool wait = !!threads;
 
 	while (wait) {
 		wait = false;
 
 		/* Only wait for our children */
-		for (i = 0; i < THREADING_MAX_THREADS; i++) {
+		for (i = 0; i < threads_max; i++) {
 			if (atomic_bool_read(&threads[i].shutdown))
 				return -ESHUTDOWN;
 
@@ -461,6 +1013,13 @@ int thread_wait(void)
 			mutex_w_unlock(&threads[i].inuse);
 		}
 
+		/*
+		 * Queued jobs may originate from the caller - wait until they
+		 * are picked up.
+		 */
+		if (atomic_read(&threads_queued) > 0)
+			wait = true;
+
 		if (wait)
 			thread_block(&thread_wait_cv, &thread_wait_lock);
 	}
@@ -468,6 +1027,32 @@ int thread_wait(void)
 	return ret;
 }
 
+DSO_PUBLIC
+void thread_usage(unsigned int *busy, unsigned int *total,
+		  unsigned int *queued)
+{
+	unsigned int i, used = 0;
+	int q;
+
+	*busy = 0;
+	*total = 0;
+	*queued = 0;
+	if (!threads)
+		return;
+
+	/* The special slots of the system threads are not accounted */
+	for (i = 0; i < threads_max; i++) {
+		if (!(atomic_read_64(&threads_free[i / 64]) &
+		      thread_slot_bit(i)))
+			used++;
+	}
+
+	*busy = used;
+	*total = threads_max;
+	q = atomic_read(&threads_queued);
+	*queued = q > 0 ? (unsigned int)q : 0;
+}
+
 DSO_PUBLIC
 int thread_set_name(enum esdm_request_type type, uint32_t id)
 {
@@ -477,6 +1062,9 @@ int thread_set_name(enum esdm_request_type type, uint32_t id)
 	case es_monitor:
 		snprintf(name, sizeof(name), "ESDM es_monitor");
 		break;
+	case drng_reseeder:
+		snprintf(name, sizeof(name), "ESDM reseeder");
+		break;
 	case rpc_unpriv_server:
 		snprintf(name, sizeof(name), "ESDM unpriv_rpc");
 		break;
@@ -486,17 +1074,55 @@ int thread_set_name(enum esdm_request_type type, uint32_t id)
 	case rpc_handler:
 		snprintf(name, sizeof(name), "ESDM hdl_rpc%u", id);
 		break;
+	case rpc_reactor:
+		snprintf(name, sizeof(name), "ESDM reactor%u", id);
+		break;
+	case rpc_vsock_server:
+		snprintf(name, sizeof(name), "ESDM vsock_rpc");
+		break;
+	case rpc_ring_filler:
+		snprintf(name, sizeof(name), "ESDM ring_fill");
+		break;
+	case rpc_ent_ring_drain:
+		snprintf(name, sizeof(name), "ESDM ent_drain");
+		break;
+	case rpc_metrics:
+		snprintf(name, sizeof(name), "ESDM metrics");
+		break;
+	case rpc_handover:
+		snprintf(name, sizeof(name), "ESDM handover");
+		break;
+	case rpc_park:
+		snprintf(name, sizeof(name), "ESDM park");
+		break;
+	case rpc_config_reload:
+		snprintf(name, sizeof(name), "ESDM cfg_reload");
+		break;
 	case cuse_poll:
 		snprintf(name, sizeof(name), "ESDM cuse_poll");
 		break;
+	case cuse_entropy:
+		snprintf(name, sizeof(name), "ESDM cuse_ent");
+		break;
 	case es_kernel_feeder:
 		snprintf(name, sizeof(name), "ESDM krnl_feed");
 		break;
+	case es_kdev_feeder:
+		snprintf(name, sizeof(name), "ESDM kdev_feed");
+		break;
+	case es_collector:
+		snprintf(name, sizeof(name), "ESDM es_coll%u", id);
+		break;
+	case esdm_request_type_last:
 	default:
 		snprintf(name, sizeof(name), "ESDM %u", id);
 		break;
 	}
 
+	thread_stack_init(type);
+
+esdm_logger_thread_name_changed();
+
 #ifdef __APPLE__
 	return -pthread_setname_np(name);
 #else
@@ -514,9 +1140,12 @@ int thread_get_name(char *name, size_t len)
 static int thread_wait_all(bool system_threads)
 {
 	unsigned int i, upper = system_threads ? THREADING_REALLY_ALL_THREADS :
-						 THREADING_MAX_THREADS;
+						 threads_max;
 	int ret = 0;
 
+	if (!threads)
+		return 0;
+
 	mutex_w_lock(&threads_cleanup);
 
 	/* Ensure that no new thread is spawned. */
@@ -552,9 +1181,12 @@ static int thread_wait_all(bool system_threads)
 static void thread_cancel(bool system_threads)
 {
 	unsigned int i, upper = system_threads ? THREADING_REALLY_ALL_THREADS :
-						 THREADING_MAX_THREADS;
+						 threads_max;
 
 	atomic_bool_set_true(&threads_in_cancel);
+	if (!threads)
+		return;
+
 	mutex_w_lock(&threads_cleanup);
 	/* Ensure that no new thread is spawned. */
 	for (i = 0; i < upper; i++) {
@@ -602,6 +1234,46 @@ int thread_start(int (*start_routine)(void *), void *tdata,
 	return 0;
 }
 
+DSO_PUBLIC
+int thread_trystart(int (*start_routine)(void *), void *tdata,
+		    uint32_t thread_group)
+{
+	return thread_schedule(start_routine, tdata, thread_group, NULL);
+}
+
+DSO_PUBLIC
+int thread_start_timeout(int (*start_routine)(void *), void *tdata,
+			 uint32_t thread_group, unsigned int timeout_ms)
+{
+	struct timespec deadline;
+	int ret;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += (time_t)(timeout_ms / 1000);
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	while (1) {
+		ret = thread_schedule(start_routine, tdata, thread_group, NULL);
+		if (ret != -EAGAIN)
+			return ret;
+
+		/* The deadline also covers a wake-up missed before the wait */
+		pthread_mutex_lock(&thread_schedule_lock);
+		ret = pthread_cond_timedwait(&thread_schedule_cv,
+					     &thread_schedule_lock, &deadline);
+		pthread_mutex_unlock(&thread_schedule_lock);
+		if (ret == ETIMEDOUT)
+			return thread_schedule(start_routine, tdata,
+					       thread_group, NULL);
+	}
+
+	return 0;
+}
+
 void thread_stop_spawning(void)
 {
 	atomic_bool_set_true(&threads_in_cancel);
@@ -631,6 +1303,19 @@ int thread_release(bool force, bool system_threads)
 
 #else /* CONFIG_ESDM_USE_PTHREAD */
 
+DSO_PUBLIC
+uint32_t thread_max_threads(void)
+{
+	return THREADING_MAX_THREADS;
+}
+
+DSO_PUBLIC
+int thread_set_max_threads(uint32_t max_threads)
+{
+	(void)max_threads;
+	return -EOPNOTSUPP;
+}
+
 int thread_init(uint32_t groups)
 {
 	(void)groups;
@@ -659,6 +1344,21 @@ int thread_start(int (*start_routine)(void *), void *tdata,
 	return start_routine(tdata);
 }
 
+DSO_PUBLIC
+int thread_trystart(int (*start_routine)(void *), void *tdata,
+		    uint32_t thread_group)
+{
+	return thread_start(start_routine, tdata, thread_group, NULL);
+}
+
+DSO_PUBLIC
+int thread_start_timeout(int (*start_routine)(void *), void *tdata,
+			 uint32_t thread_group, unsigned int timeout_ms)
+{
+	(void)timeout_ms;
+	return thread_start(start_routine, tdata, thread_group, NULL);
+}
+
 DSO_PUBLIC
 int thread_set_name(enum acvp_request_type type, uint32_t id)
 {
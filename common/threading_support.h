@@ -66,17 +66,59 @@ extern "C" {
 #define ESDM_THREAD_CUSE_POLL_GROUP ((uint32_t)-1)
 #define ESDM_THREAD_ES_MONITOR ((uint32_t)-2)
 #define ESDM_THREAD_RPC_UNPRIV_GROUP ((uint32_t)-3)
-#define ESDM_THREAD_MAX_SPECIAL_GROUPS 3
+#define ESDM_THREAD_DRNG_RESEEDER ((uint32_t)-4)
+#define ESDM_THREAD_CUSE_ENTROPY_GROUP ((uint32_t)-5)
+#define ESDM_THREAD_RPC_PRIV_GROUP ((uint32_t)-6)
+#define ESDM_THREAD_RPC_FAST_GROUP ((uint32_t)-7)
+#define ESDM_THREAD_KDEV_FEEDER ((uint32_t)-8)
+#define ESDM_THREAD_MAX_SPECIAL_GROUPS 8
 
 enum esdm_request_type {
 	es_monitor,
 	es_kernel_feeder,
+	es_kdev_feeder,
+	drng_reseeder,
+	es_collector,
 	rpc_unpriv_server,
 	rpc_priv_server,
 	rpc_handler,
+	rpc_reactor,
+	rpc_vsock_server,
+	rpc_ring_filler,
+	rpc_ent_ring_drain,
+	rpc_metrics,
+	rpc_handover,
+	rpc_park,
+	rpc_config_reload,
 	cuse_poll,
+	cuse_entropy,
+	esdm_request_type_last,
 };
 
+/**
+ * @brief - Number of worker thread slots
+ *
+ * Unless set with thread_set_max_threads, the thread pool provides one slot
+ * per online CPU, but at least THREADING_MAX_THREADS slots. The value is
+ * fixed with the first invocation of this function which is latest performed
+ * by thread_init.
+ *
+ * @return number of worker thread slots
+ */
+uint32_t thread_max_threads(void);
+
+/**
+ * @brief - Set the number of worker thread slots
+ *
+ * Worker threads are only spawned when needed and terminated when idle, i.e.
+ * a slot only consumes memory as long as it is not used.
+ *
+ * @param [in] max_threads Number of slots between 1 and 4096
+ *
+ * @return: 0 on success, -EBUSY if the number is already fixed, < 0 on error
+ */
+int thread_set_max_threads(uint32_t max_threads);
+
 /**
  * @brief - Initializiation of the threading support
  *
@@ -106,9 +148,23 @@ int thread_release(bool force, bool system_threads);
  */
 int thread_wait(void);
 
+/**
+ * @brief - Obtain the occupancy of the thread pool
+ *
+ * @param [out] busy Number of worker thread slots executing a job
+ * @param [out] total Number of worker thread slots
+ * @param [out] queued Number of jobs waiting for a worker thread
+ */
+void thread_usage(unsigned int *busy, unsigned int *total,
+		  unsigned int *queued);
+
 /**
  * @brief - Start a function in a separate thread
  *
+ * If all threads of the thread group are busy, the job is queued and executed
+ * by the next thread of the group becoming idle. The caller only blocks when
+ * the job queues of the thread group are full.
+ *
  * @param [in] start_routine Function that is invoked in thread (the idea is
  *			     that the return code is 0 for success and != 0 for
  *			     error)
@@ -122,6 +178,38 @@ int thread_wait(void);
 int thread_start(int (*start_routine)(void *), void *tdata,
 		 uint32_t thread_group, int *ret_ancestor);
 
+/**
+ * @brief - Start a function in a separate thread without waiting
+ *
+ * Same as thread_start, but if the thread of a special thread group is busy,
+ * the call returns instead of waiting for the thread to become available.
+ *
+ * @param [in] start_routine Function that is invoked in thread
+ * @param [in] tdata Argument supplied to function
+ * @param [in] thread_group Which thread group the thread belongs to.
+ *
+ * @return 0 on success, -EAGAIN if the thread is busy, < 0 on error
+ */
+int thread_trystart(int (*start_routine)(void *), void *tdata,
+		    uint32_t thread_group);
+
+/**
+ * @brief - Start a function in a separate thread with a bounded wait
+ *
+ * Same as thread_start, but the call waits at most the given time for a
+ * thread to become available.
+ *
+ * @param [in] start_routine Function that is invoked in thread
+ * @param [in] tdata Argument supplied to function
+ * @param [in] thread_group Which thread group the thread belongs to.
+ * @param [in] timeout_ms Maximum time to wait in milliseconds
+ *
+ * @return 0 on success, -EAGAIN if no thread became available in time,
+ *	   < 0 on error
+ */
+int thread_start_timeout(int (*start_routine)(void *), void *tdata,
+			 uint32_t thread_group, unsigned int timeout_ms);
+
 #define ESDM_THREAD_MAX_NAMELEN 16
 /**
  * @brief - Give a name to a thread that is used for logging
@@ -129,6 +217,27 @@ int thread_start(int (*start_routine)(void *), void *tdata,
 int thread_set_name(enum esdm_request_type type, uint32_t id);
 int thread_get_name(char *name, size_t len);
 
+struct esdm_metrics_buf;
+#ifdef ESDM_METRICS
+/**
+ * @brief - Record the stack depth of the calling thread
+ *
+ * The depth is measured relative to the frame which invoked thread_set_name
+ * and tracked per thread type as estimate of the peak stack use. Threads
+ * without a name are not tracked.
+ */
+void thread_stack_probe(void);
+
+/**
+ * @brief - Append the peak stack estimates of all thread types to the buffer
+ */
+void thread_stack_metrics(struct esdm_metrics_buf *mb);
+#else
+static inline void thread_stack_probe(void)
+{
+}
+#endif
+
 /**
  * @brief - Send signal to thread group
  *
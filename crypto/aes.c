@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <string.h>
+
+#include "bitshift_be.h"
+#include "bitshift_le.h"
+#include "constructor.h"
+#include "cpufeatures.h"
+#include "lc_aes.h"
+#include "memset_secure.h"
+#include "visibility.h"
+
+/* Number of blocks encrypted interleaved by the CTR implementations */
+#define AES_CTR_PARALLEL 8
+
+static const uint8_t aes_rcon[] = { 0x01, 0x02, 0x04, 0x08,
+				    0x10, 0x20, 0x40 };
+
+/*
+ * Increment the 128 bit big endian counter given as its two halves without
+ * a data dependent branch.
+ */
+static inline void aes_ctr_inc(uint64_t *hi, uint64_t *lo)
+{
+	(*lo)++;
+	*hi += (uint64_t)(*lo == 0);
+}
+
+/*
+ * AES-256 key schedule of FIPS 197 section 5.2 operating on little endian
+ * words - the byte order of the words does not matter as SubWord operates
+ * on the individual bytes.
+ */
+static inline __attribute__((always_inline)) void
+aes256_expand(struct lc_aes_ctx *ctx, const uint8_t key[LC_AES256_KEY_SIZE],
+	      uint32_t (*subword)(uint32_t w))
+{
+	uint32_t w[(LC_AES256_ROUNDS + 1) * 4];
+	unsigned int i;
+
+	for (i = 0; i < 8; i++)
+		w[i] = ptr_to_le32(key + 4 * i);
+
+	for (i = 8; i < (LC_AES256_ROUNDS + 1) * 4; i++) {
+		uint32_t tmp = w[i - 1];
+
+		if (!(i & 7))
+			tmp = subword((tmp >> 8) | (tmp << 24)) ^
+			      aes_rcon[i / 8 - 1];
+		else if ((i & 7) == 4)
+			tmp = subword(tmp);
+
+		w[i] = w[i - 8] ^ tmp;
+	}
+
+	for (i = 0; i < (LC_AES256_ROUNDS + 1) * 4; i++)
+		le32_to_ptr(ctx->rk + 4 * i, w[i]);
+
+	memset_secure(w, 0, sizeof(w));
+}
+
+/******************************************************************
+ * Constant time software implementation
+ ******************************************************************/
+
+#define AES_BYTES_01 0x0101010101010101ULL
+#define AES_BYTES_7F 0x7f7f7f7f7f7f7f7fULL
+
+/* Multiplication by x in GF(2^8) of all eight bytes of the word */
+static inline uint64_t aes_xtime64(uint64_t x)
+{
+	return ((x & AES_BYTES_7F) << 1) ^ (((x >> 7) & AES_BYTES_01) * 0x1b);
+}
+
+/* Byte-wise multiplication in GF(2^8) of two words */
+static inline uint64_t aes_gfmul64(uint64_t a, uint64_t b)
+{
+	uint64_t r = 0;
+	unsigned int i;
+
+	for (i = 0; i < 8; i++) {
+		r ^= a & (((b >> i) & AES_BYTES_01) * 0xff);
+		a = aes_xtime64(a);
+	}
+
+	return r;
+}
+
+/* Rotate all bytes of the word left by n bits */
+static inline uint64_t aes_rotb64(uint64_t x, unsigned int n)
+{
+	uint64_t hi = ((0xffULL << n) & 0xff) * AES_BYTES_01;
+
+	return ((x << n) & hi) | ((x >> (8 - n)) & ~hi);
+}
+
+/*
+ * S-box of eight bytes: the multiplicative inverse is calculated as x^254
+ * without any table lookup or data dependent branch followed by the affine
+ * transformation.
+ */
+static uint64_t aes_sbox64(uint64_t x)
+{
+	uint64_t x2, x3, x12, x15, x240;
+
+	x2 = aes_gfmul64(x, x);
+	x3 = aes_gfmul64(x2, x);
+	x12 = aes_gfmul64(x3, x3);
+	x12 = aes_gfmul64(x12, x12);
+	x15 = aes_gfmul64(x12, x3);
+	x240 = aes_gfmul64(x15, x15);
+	x240 = aes_gfmul64(x240, x240);
+	x240 = aes_gfmul64(x240, x240);
+	x240 = aes_gfmul64(x240, x240);
+	/* x^254 = x^240 * x^12 * x^2 */
+	x = aes_gfmul64(aes_gfmul64(x240, x12), x2);
+
+	return x ^ aes_rotb64(x, 1) ^ aes_rotb64(x, 2) ^ aes_rotb64(x, 3) ^
+	       aes_rotb64(x, 4) ^ (0x63 * AES_BYTES_01);
+}
+
+static uint32_t aes_subword_c(uint32_t w)
+{
+	return (uint32_t)aes_sbox64(w);
+}
+
+static void aes256_setkey_c(struct lc_aes_ctx *ctx,
+			    const uint8_t key[LC_AES256_KEY_SIZE])
+{
+	aes256_expand(ctx, key, aes_subword_c);
+}
+
+static inline uint8_t aes_xtime(uint8_t x)
+{
+	return (uint8_t)((x << 1) ^ (((x >> 7) & 1) * 0x1b));
+}
+
+static void aes_round_c(uint8_t s[LC_AES_BLOCK_SIZE], const uint8_t *rk,
+			int last)
+{
+	uint8_t t[LC_AES_BLOCK_SIZE];
+	unsigned int c, r;
+
+	/* SubBytes */
+	le64_to_ptr(s, aes_sbox64(ptr_to_le64(s)));
+	le64_to_ptr(s + 8, aes_sbox64(ptr_to_le64(s + 8)));
+
+	/* ShiftRows */
+	for (c = 0; c < 4; c++) {
+		for (r = 0; r < 4; r++)
+			t[4 * c + r] = s[4 * ((c + r) & 3) + r];
+	}
+
+	/* MixColumns */
+	for (c = 0; c < 4 && !last; c++) {
+		uint8_t *a = t + 4 * c;
+		uint8_t a0 = a[0], all = a[0] ^ a[1] ^ a[2] ^ a[3];
+
+		a[0] ^= all ^ aes_xtime(a[0] ^ a[1]);
+		a[1] ^= all ^ aes_xtime(a[1] ^ a[2]);
+		a[2] ^= all ^ aes_xtime(a[2] ^ a[3]);
+		a[3] ^= all ^ aes_xtime(a[3] ^ a0);
+	}
+
+	/* AddRoundKey */
+	for (c = 0; c < LC_AES_BLOCK_SIZE; c++)
+		s[c] = t[c] ^ rk[c];
+}
+
+static void aes256_encrypt_c(const struct lc_aes_ctx *ctx,
+			     uint8_t out[LC_AES_BLOCK_SIZE],
+			     const uint8_t in[LC_AES_BLOCK_SIZE])
+{
+	uint8_t s[LC_AES_BLOCK_SIZE];
+	unsigned int i;
+
+	for (i = 0; i < LC_AES_BLOCK_SIZE; i++)
+		s[i] = in[i] ^ ctx->rk[i];
+
+	for (i = 1; i <= LC_AES256_ROUNDS; i++)
+		aes_round_c(s, ctx->rk + i * LC_AES_BLOCK_SIZE,
+			    i == LC_AES256_ROUNDS);
+
+	memcpy(out, s, LC_AES_BLOCK_SIZE);
+	memset_secure(s, 0, sizeof(s));
+}
+
+static void aes256_ctr_c(const struct lc_aes_ctx *ctx,
+			 uint8_t ctr[LC_AES_BLOCK_SIZE], uint8_t *out,
+			 size_t blocks)
+{
+	uint64_t hi = ptr_to_be64(ctr), lo = ptr_to_be64(ctr + 8);
+
+	for (; blocks; blocks--, out += LC_AES_BLOCK_SIZE) {
+		aes_ctr_inc(&hi, &lo);
+		be64_to_ptr(out, hi);
+		be64_to_ptr(out + 8, lo);
+		aes256_encrypt_c(ctx, out, out);
+	}
+
+	be64_to_ptr(ctr, hi);
+	be64_to_ptr(ctr + 8, lo);
+}
+
+static void (*aes256_setkey_impl)(struct lc_aes_ctx *ctx,
+				  const uint8_t key[LC_AES256_KEY_SIZE]) =
+	aes256_setkey_c;
+static void (*aes256_encrypt_impl)(const struct lc_aes_ctx *ctx,
+				   uint8_t out[LC_AES_BLOCK_SIZE],
+				   const uint8_t in[LC_AES_BLOCK_SIZE]) =
+	aes256_encrypt_c;
+static void (*aes256_ctr_impl)(const struct lc_aes_ctx *ctx,
+			       uint8_t ctr[LC_AES_BLOCK_SIZE], uint8_t *out,
+			       size_t blocks) = aes256_ctr_c;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+/******************************************************************
+ * AES-NI implementation
+ ******************************************************************/
+
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+
+/* w[i] ^= w[i - 1] ^ w[i - 2] ^ w[i - 3] for the four words of k */
+static inline __attribute__((always_inline)) AES_NI_TARGET __m128i
+aes_ni_key_prefix(__m128i k)
+{
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+	return _mm_xor_si128(k, _mm_slli_si128(k, 4));
+}
+
+/* Even round key: SubWord(RotWord()) and Rcon of the last word of k3 */
+#define AES_NI_KEY_EVEN(k1, k3, rcon)                                          \
+	k1 = _mm_xor_si128(aes_ni_key_prefix(k1),                              \
+			   _mm_shuffle_epi32(                                  \
+				   _mm_aeskeygenassist_si128(k3, rcon), 0xff))
+
+/* Odd round key: SubWord() of the last word of k1 */
+#define AES_NI_KEY_ODD(k1, k3)                                                 \
+	k3 = _mm_xor_si128(aes_ni_key_prefix(k3),                              \
+			   _mm_shuffle_epi32(                                  \
+				   _mm_aeskeygenassist_si128(k1, 0), 0xaa))
+
+static AES_NI_TARGET void
+aes256_setkey_ni(struct lc_aes_ctx *ctx, const uint8_t key[LC_AES256_KEY_SIZE])
+{
+	__m128i *rk = (__m128i *)ctx->rk;
+	__m128i k1 = _mm_loadu_si128((const __m128i *)key);
+	__m128i k3 = _mm_loadu_si128((const __m128i *)(key + 16));
+
+	rk[0] = k1;
+	rk[1] = k3;
+	AES_NI_KEY_EVEN(k1, k3, 0x01);
+	rk[2] = k1;
+	AES_NI_KEY_ODD(k1, k3);
+	rk[3] = k3;
+	AES_NI_KEY_EVEN(k1, k3, 0x02);
+	rk[4] = k1;
+	AES_NI_KEY_ODD(k1, k3);
+	rk[5] = k3;
+	AES_NI_KEY_EVEN(k1, k3, 0x04);
+	rk[6] = k1;
+	AES_NI_KEY_ODD(k1, k3);
+	rk[7] = k3;
+	AES_NI_KEY_EVEN(k1, k3, 0x08);
+	rk[8] = k1;
+	AES_NI_KEY_ODD(k1, k3);
+	rk[9] = k3;
+	AES_NI_KEY_EVEN(k1, k3, 0x10);
+	rk[10] = k1;
+	AES_NI_KEY_ODD(k1, k3);
+	rk[11] = k3;
+	AES_NI_KEY_EVEN(k1, k3, 0x20);
+	rk[12] = k1;
+	AES_NI_KEY_ODD(k1, k3);
+	rk[13] = k3;
+	AES_NI_KEY_EVEN(k1, k3, 0x40);
+	rk[14] = k1;
+}
+
+static AES_NI_TARGET void aes256_encrypt_ni(const struct lc_aes_ctx *ctx,
+					    uint8_t out[LC_AES_BLOCK_SIZE],
+					    const uint8_t in[LC_AES_BLOCK_SIZE])
+{
+	const __m128i *rk = (const __m128i *)ctx->rk;
+	__m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), rk[0]);
+	unsigned int i;
+
+	for (i = 1; i < LC_AES256_ROUNDS; i++)
+		b = _mm_aesenc_si128(b, rk[i]);
+	b = _mm_aesenclast_si128(b, rk[LC_AES256_ROUNDS]);
+
+	_mm_storeu_si128((__m128i *)out, b);
+}
+
+static AES_NI_TARGET void aes256_ctr_ni(const struct lc_aes_ctx *ctx,
+					uint8_t ctr[LC_AES_BLOCK_SIZE],
+					uint8_t *out, size_t blocks)
+{
+	const __m128i *rk = (const __m128i *)ctx->rk;
+	__m128i b[AES_CTR_PARALLEL];
+	uint64_t hi = ptr_to_be64(ctr), lo = ptr_to_be64(ctr + 8);
+	size_t todo, i, r;
+
+	while (blocks) {
+		todo = blocks < AES_CTR_PARALLEL ? blocks : AES_CTR_PARALLEL;
+
+		for (i = 0; i < todo; i++) {
+			aes_ctr_inc(&hi, &lo);
+			b[i] = _mm_set_epi64x((long long)__builtin_bswap64(lo),
+					      (long long)__builtin_bswap64(hi));
+			b[i] = _mm_xor_si128(b[i], rk[0]);
+		}
+
+		for (r = 1; r < LC_AES256_ROUNDS; r++) {
+			for (i = 0; i < todo; i++)
+				b[i] = _mm_aesenc_si128(b[i], rk[r]);
+		}
+
+		for (i = 0; i < todo; i++) {
+			b[i] = _mm_aesenclast_si128(b[i],
+						    rk[LC_AES256_ROUNDS]);
+			_mm_storeu_si128((__m128i *)out, b[i]);
+			out += LC_AES_BLOCK_SIZE;
+		}
+
+		blocks -= todo;
+	}
+
+	be64_to_ptr(ctr, hi);
+	be64_to_ptr(ctr + 8, lo);
+}
+
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+
+#include <arm_neon.h>
+
+/******************************************************************
+ * ARMv8 cryptographic extensions implementation
+ ******************************************************************/
+
+#define AES_ARMV8_TARGET __attribute__((target("arch=armv8-a+crypto")))
+
+/*
+ * AESE with a zero round key of a vector holding the word in all columns
+ * applies the S-box as ShiftRows has no effect on identical columns.
+ */
+static inline __attribute__((always_inline)) AES_ARMV8_TARGET uint32_t
+aes_subword_armv8(uint32_t w)
+{
+	uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(w));
+
+	v = vaeseq_u8(v, vdupq_n_u8(0));
+	return vgetq_lane_u32(vreinterpretq_u32_u8(v), 0);
+}
+
+static AES_ARMV8_TARGET void
+aes256_setkey_armv8(struct lc_aes_ctx *ctx,
+		    const uint8_t key[LC_AES256_KEY_SIZE])
+{
+	aes256_expand(ctx, key, aes_subword_armv8);
+}
+
+/* AESE performs AddRoundKey first, the last round key is added with EOR */
+static inline __attribute__((always_inline)) AES_ARMV8_TARGET uint8x16_t
+aes256_block_armv8(const uint8x16_t rk[LC_AES256_ROUNDS + 1], uint8x16_t b)
+{
+	unsigned int i;
+
+	for (i = 0; i < LC_AES256_ROUNDS - 1; i++)
+		b = vaesmcq_u8(vaeseq_u8(b, rk[i]));
+	b = vaeseq_u8(b, rk[LC_AES256_ROUNDS - 1]);
+
+	return veorq_u8(b, rk[LC_AES256_ROUNDS]);
+}
+
+static inline __attribute__((always_inline)) AES_ARMV8_TARGET void
+aes256_load_rk_armv8(uint8x16_t rk[LC_AES256_ROUNDS + 1],
+		     const struct lc_aes_ctx *ctx)
+{
+	unsigned int i;
+
+	for (i = 0; i <= LC_AES256_ROUNDS; i++)
+		rk[i] = vld1q_u8(ctx->rk + i * LC_AES_BLOCK_SIZE);
+}
+
+static AES_ARMV8_TARGET void
+aes256_encrypt_armv8(const struct lc_aes_ctx *ctx,
+		     uint8_t out[LC_AES_BLOCK_SIZE],
+		     const uint8_t in[LC_AES_BLOCK_SIZE])
+{
+	uint8x16_t rk[LC_AES256_ROUNDS + 1];
+
+	aes256_load_rk_armv8(rk, ctx);
+	vst1q_u8(out, aes256_block_armv8(rk, vld1q_u8(in)));
+}
+
+static AES_ARMV8_TARGET void aes256_ctr_armv8(const struct lc_aes_ctx *ctx,
+					      uint8_t ctr[LC_AES_BLOCK_SIZE],
+					      uint8_t *out, size_t blocks)
+{
+	uint8x16_t rk[LC_AES256_ROUNDS + 1], b[AES_CTR_PARALLEL];
+	uint64_t hi = ptr_to_be64(ctr), lo = ptr_to_be64(ctr + 8);
+	size_t todo, i, r;
+
+	aes256_load_rk_armv8(rk, ctx);
+
+	while (blocks) {
+		todo = blocks < AES_CTR_PARALLEL ? blocks : AES_CTR_PARALLEL;
+
+		for (i = 0; i < todo; i++) {
+			aes_ctr_inc(&hi, &lo);
+			b[i] = vreinterpretq_u8_u64(vcombine_u64(
+				vcreate_u64(__builtin_bswap64(hi)),
+				vcreate_u64(__builtin_bswap64(lo))));
+		}
+
+		for (r = 0; r < LC_AES256_ROUNDS - 1; r++) {
+			for (i = 0; i < todo; i++)
+				b[i] = vaesmcq_u8(vaeseq_u8(b[i], rk[r]));
+		}
+
+		for (i = 0; i < todo; i++) {
+			b[i] = vaeseq_u8(b[i], rk[LC_AES256_ROUNDS - 1]);
+			vst1q_u8(out, veorq_u8(b[i], rk[LC_AES256_ROUNDS]));
+			out += LC_AES_BLOCK_SIZE;
+		}
+
+		blocks -= todo;
+	}
+
+	be64_to_ptr(ctr, hi);
+	be64_to_ptr(ctr + 8, lo);
+}
+
+#endif
+
+ESDM_DEFINE_CONSTRUCTOR(aes_select)
+{
+	esdm_cpufeatures_init();
+
+#if defined(__x86_64__) && defined(__GNUC__)
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_AES)) {
+		aes256_setkey_impl = aes256_setkey_ni;
+		aes256_encrypt_impl = aes256_encrypt_ni;
+		aes256_ctr_impl = aes256_ctr_ni;
+	}
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_ARM_AES)) {
+		aes256_setkey_impl = aes256_setkey_armv8;
+		aes256_encrypt_impl = aes256_encrypt_armv8;
+		aes256_ctr_impl = aes256_ctr_armv8;
+	}
+#endif
+}
+
+DSO_PUBLIC
+void lc_aes256_setkey(struct lc_aes_ctx *ctx,
+		      const uint8_t key[LC_AES256_KEY_SIZE])
+{
+	aes256_setkey_impl(ctx, key);
+}
+
+DSO_PUBLIC
+void lc_aes256_encrypt(const struct lc_aes_ctx *ctx,
+		       uint8_t out[LC_AES_BLOCK_SIZE],
+		       const uint8_t in[LC_AES_BLOCK_SIZE])
+{
+	aes256_encrypt_impl(ctx, out, in);
+}
+
+DSO_PUBLIC
+void lc_aes256_ctr(const struct lc_aes_ctx *ctx,
+		   uint8_t ctr[LC_AES_BLOCK_SIZE], uint8_t *out, size_t blocks)
+{
+	aes256_ctr_impl(ctx, ctr, out, blocks);
+}
@@ -27,6 +27,19 @@
 #include "math_helper.h"
 #include "visibility.h"
 
+static inline void lc_cc20_drng_inc_nonce(struct lc_sym_state *chacha20_state)
+{
+	/* Deterministic increment of nonce as required in RFC 7539 chapter 4 */
+	chacha20_state->nonce[0]++;
+	if (chacha20_state->nonce[0] == 0) {
+		chacha20_state->nonce[1]++;
+		if (chacha20_state->nonce[1] == 0)
+			chacha20_state->nonce[2]++;
+	}
+
+	/* Leave counter untouched as it is start value is undefined in RFC */
+}
+
 /**
  * Update of the ChaCha20 state by generating one ChaCha20 block which is
  * equal to the state of the ChaCha20. The generated block is XORed into
@@ -52,15 +65,7 @@ static inline void lc_cc20_drng_update(struct lc_chacha20_drng_ctx *cc20_ctx,
 		}
 	}
 
-	/* Deterministic increment of nonce as required in RFC 7539 chapter 4 */
-	chacha20_state->nonce[0]++;
-	if (chacha20_state->nonce[0] == 0) {
-		chacha20_state->nonce[1]++;
-		if (chacha20_state->nonce[1] == 0)
-			chacha20_state->nonce[2]++;
-	}
-
-	/* Leave counter untouched as it is start value is undefined in RFC */
+	lc_cc20_drng_inc_nonce(chacha20_state);
 }
 
 /**
@@ -82,6 +87,10 @@ void lc_cc20_drng_seed(struct lc_chacha20_drng_ctx *cc20_ctx,
 	struct lc_sym_ctx *sym_ctx = &cc20_ctx->cc20;
 	struct lc_sym_state *chacha20_state = sym_ctx->sym_state;
 
+	/* Key stream of the old state must not be handed out after a reseed */
+	memset_secure(cc20_ctx->buf, 0, sizeof(cc20_ctx->buf));
+	cc20_ctx->buf_avail = 0;
+
 	while (inbuflen) {
 		size_t i, todo = min_size(inbuflen, LC_CC20_KEY_SIZE);
 
@@ -115,23 +124,14 @@ void lc_cc20_drng_generate(struct lc_chacha20_drng_ctx *cc20_ctx,
 	struct lc_sym_ctx *sym_ctx = &cc20_ctx->cc20;
 	struct lc_sym_state *chacha20_state = sym_ctx->sym_state;
 	uint32_t aligned_buf[(LC_CC20_BLOCK_SIZE / sizeof(uint32_t))];
+	size_t blocks = outbuflen / LC_CC20_BLOCK_SIZE;
 	size_t used = LC_CC20_BLOCK_SIZE_WORDS;
 	int zeroize_buf = 0;
 
-	while (outbuflen >= LC_CC20_BLOCK_SIZE) {
-		if ((unsigned long)outbuf & (sizeof(aligned_buf[0]) - 1)) {
-			cc20_block(chacha20_state, aligned_buf);
-			memcpy(outbuf, aligned_buf, LC_CC20_BLOCK_SIZE);
-			zeroize_buf = 1;
-		} else {
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-align"
-			cc20_block(chacha20_state, (uint32_t *)outbuf);
-#pragma GCC diagnostic pop
-		}
-
-		outbuf += LC_CC20_BLOCK_SIZE;
-		outbuflen -= LC_CC20_BLOCK_SIZE;
+	if (blocks) {
+		cc20_blocks(chacha20_state, outbuf, blocks);
+		outbuf += blocks * LC_CC20_BLOCK_SIZE;
+		outbuflen -= blocks * LC_CC20_BLOCK_SIZE;
 	}
 
 	if (outbuflen) {
@@ -148,6 +148,91 @@ void lc_cc20_drng_generate(struct lc_chacha20_drng_ctx *cc20_ctx,
 		memset_secure(aligned_buf, 0, sizeof(aligned_buf));
 }
 
+/*
+ * Fast key erasure: one buffer epoch of key stream is generated and its first
+ * part replaces the key before any byte of the epoch is handed out.
+ */
+static void lc_cc20_drng_refill(struct lc_chacha20_drng_ctx *cc20_ctx)
+{
+	struct lc_sym_ctx *sym_ctx = &cc20_ctx->cc20;
+	struct lc_sym_state *chacha20_state = sym_ctx->sym_state;
+	unsigned int i;
+
+	cc20_blocks(chacha20_state, cc20_ctx->buf, LC_CC20_DRNG_BUF_BLOCKS);
+
+	for (i = 0; i < LC_CC20_KEY_SIZE; i++)
+		chacha20_state->key.b[i] ^= cc20_ctx->buf[i];
+	lc_cc20_drng_inc_nonce(chacha20_state);
+
+	memset_secure(cc20_ctx->buf, 0, LC_CC20_KEY_SIZE);
+	cc20_ctx->buf_avail = LC_CC20_DRNG_BUF_SIZE - LC_CC20_KEY_SIZE;
+}
+
+DSO_PUBLIC
+void lc_cc20_drng_generate_buffered(struct lc_chacha20_drng_ctx *cc20_ctx,
+				    uint8_t *outbuf, size_t outbuflen)
+{
+	if (outbuflen >= LC_CC20_DRNG_BUF_MAX_REQ) {
+		lc_cc20_drng_generate(cc20_ctx, outbuf, outbuflen);
+		return;
+	}
+
+	while (outbuflen) {
+		uint8_t *src;
+		size_t todo;
+
+		if (!cc20_ctx->buf_avail)
+			lc_cc20_drng_refill(cc20_ctx);
+
+		todo = min_size(outbuflen, cc20_ctx->buf_avail);
+		src = cc20_ctx->buf + LC_CC20_DRNG_BUF_SIZE -
+		      cc20_ctx->buf_avail;
+
+		memcpy(outbuf, src, todo);
+		memset_secure(src, 0, todo);
+		cc20_ctx->buf_avail -= todo;
+
+		outbuf += todo;
+		outbuflen -= todo;
+	}
+}
+
+DSO_PUBLIC
+void lc_cc20_drng_generate_at(const struct lc_chacha20_drng_ctx *cc20_ctx,
+			      uint32_t block, uint8_t *outbuf, size_t outbuflen)
+{
+	const struct lc_sym_ctx *sym_ctx = &cc20_ctx->cc20;
+	struct lc_sym_state chacha20_state = *sym_ctx->sym_state;
+	uint32_t aligned_buf[(LC_CC20_BLOCK_SIZE / sizeof(uint32_t))];
+	size_t blocks = outbuflen / LC_CC20_BLOCK_SIZE;
+
+	chacha20_state.counter += block;
+
+	if (blocks) {
+		cc20_blocks(&chacha20_state, outbuf, blocks);
+		outbuf += blocks * LC_CC20_BLOCK_SIZE;
+		outbuflen -= blocks * LC_CC20_BLOCK_SIZE;
+	}
+
+	if (outbuflen) {
+		cc20_block(&chacha20_state, aligned_buf);
+		memcpy(outbuf, aligned_buf, outbuflen);
+	}
+
+	memset_secure(aligned_buf, 0, sizeof(aligned_buf));
+	memset_secure(&chacha20_state, 0, sizeof(chacha20_state));
+}
+
+DSO_PUBLIC
+void lc_cc20_drng_rekey(struct lc_chacha20_drng_ctx *cc20_ctx, uint32_t blocks)
+{
+	struct lc_sym_ctx *sym_ctx = &cc20_ctx->cc20;
+	struct lc_sym_state *chacha20_state = sym_ctx->sym_state;
+
+	chacha20_state->counter += blocks;
+	lc_cc20_drng_update(cc20_ctx, NULL, LC_CC20_BLOCK_SIZE_WORDS);
+}
+
 DSO_PUBLIC
 void lc_cc20_drng_zero_free(struct lc_chacha20_drng_ctx *cc20_ctx)
 {
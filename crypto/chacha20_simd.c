@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <string.h>
+
+#include "conv_be_le.h"
+#include "cpufeatures.h"
+#include "lc_chacha20.h"
+#include "lc_chacha20_private.h"
+#include "lc_sym.h"
+#include "memset_secure.h"
+
+#define CC20_ROL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+/* ChaCha20 quarterround according to RFC 7539 section 2.1 */
+#define CC20_QR(a, b, c, d)                                                    \
+	do {                                                                   \
+		a += b;                                                        \
+		d = CC20_ROL(d ^ a, 16);                                       \
+		c += d;                                                        \
+		b = CC20_ROL(b ^ c, 12);                                       \
+		a += b;                                                        \
+		d = CC20_ROL(d ^ a, 8);                                        \
+		c += d;                                                        \
+		b = CC20_ROL(b ^ c, 7);                                        \
+	} while (0)
+
+/*
+ * The kernels use the GCC / clang vector extensions. The compiler maps them
+ * to the SIMD instruction set selected with the target attribute. The
+ * baseline kernel uses 4 lanes which are covered by SSE2 on x86_64 and NEON
+ * on AArch64 without any further selection.
+ */
+#if defined(__GNUC__) &&                                                      \
+	(defined(__x86_64__) || defined(__aarch64__) || defined(__ARM_NEON))
+
+#define CC20_SIMD
+
+#define CC20_LANES 4
+#define CC20_VEC cc20_vec4
+#define CC20_NAME cc20_blocks_4way
+#define CC20_TARGET
+#include "chacha20_simd_kernel.h"
+#undef CC20_LANES
+#undef CC20_VEC
+#undef CC20_NAME
+#undef CC20_TARGET
+
+#if defined(__x86_64__)
+
+#define CC20_SIMD_X86
+
+#define CC20_LANES 8
+#define CC20_VEC cc20_vec8
+#define CC20_NAME cc20_blocks_avx2
+#define CC20_TARGET __attribute__((target("avx2")))
+#include "chacha20_simd_kernel.h"
+#undef CC20_LANES
+#undef CC20_VEC
+#undef CC20_NAME
+#undef CC20_TARGET
+
+#define CC20_LANES 16
+#define CC20_VEC cc20_vec16
+#define CC20_NAME cc20_blocks_avx512
+#define CC20_TARGET __attribute__((target("avx512f")))
+#include "chacha20_simd_kernel.h"
+#undef CC20_LANES
+#undef CC20_VEC
+#undef CC20_NAME
+#undef CC20_TARGET
+
+#endif /* __x86_64__ */
+
+#endif /* __GNUC__ */
+
+/* Generate blocks with the scalar implementation */
+static void cc20_blocks_1way(struct lc_sym_state *state, uint8_t *out,
+			     size_t blocks)
+{
+	uint32_t aligned_buf[LC_CC20_BLOCK_SIZE_WORDS];
+	int zeroize_buf = 0;
+
+	for (; blocks; blocks--, out += LC_CC20_BLOCK_SIZE) {
+		if ((unsigned long)out & (sizeof(aligned_buf[0]) - 1)) {
+			cc20_block(state, aligned_buf);
+			memcpy(out, aligned_buf, LC_CC20_BLOCK_SIZE);
+			zeroize_buf = 1;
+		} else {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-align"
+			cc20_block(state, (uint32_t *)out);
+#pragma GCC diagnostic pop
+		}
+	}
+
+	if (zeroize_buf)
+		memset_secure(aligned_buf, 0, sizeof(aligned_buf));
+}
+
+void cc20_blocks(struct lc_sym_state *state, uint8_t *out, size_t blocks)
+{
+#ifdef CC20_SIMD
+#ifdef CC20_SIMD_X86
+	if (blocks >= 16 && esdm_cpu_has(ESDM_CPU_FEATURE_AVX512F)) {
+		for (; blocks >= 16; blocks -= 16) {
+			cc20_blocks_avx512(state, out);
+			out += 16 * LC_CC20_BLOCK_SIZE;
+		}
+	}
+
+	if (blocks >= 8 && esdm_cpu_has(ESDM_CPU_FEATURE_AVX2)) {
+		for (; blocks >= 8; blocks -= 8) {
+			cc20_blocks_avx2(state, out);
+			out += 8 * LC_CC20_BLOCK_SIZE;
+		}
+	}
+#endif
+
+	for (; blocks >= 4; blocks -= 4) {
+		cc20_blocks_4way(state, out);
+		out += 4 * LC_CC20_BLOCK_SIZE;
+	}
+#endif
+
+	cc20_blocks_1way(state, out, blocks);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/*
+ * Multi-block ChaCha20 kernel template - this file is included by
+ * chacha20_simd.c once per lane count. The including file defines:
+ *
+ * CC20_LANES: number of blocks computed in parallel
+ * CC20_VEC: name of the vector type to define
+ * CC20_NAME: name of the kernel function
+ * CC20_TARGET: function attribute with the instruction set to compile for
+ *
+ * Each vector lane holds the state of one block: the state word i of block
+ * l is found in lane l of ws[i]. This way the ChaCha20 quarterrounds are
+ * applied to all blocks at once without any shuffling of the state.
+ */
+
+typedef uint32_t CC20_VEC
+	__attribute__((vector_size(CC20_LANES * sizeof(uint32_t))));
+
+static CC20_TARGET void CC20_NAME(struct lc_sym_state *state, uint8_t *out)
+{
+	uint32_t *state_w = &state->constants[0];
+	CC20_VEC in[LC_CC20_BLOCK_SIZE_WORDS], ws[LC_CC20_BLOCK_SIZE_WORDS];
+	unsigned int i, l;
+
+	for (i = 0; i < LC_CC20_BLOCK_SIZE_WORDS; i++) {
+		in[i] = (CC20_VEC){ 0 } + state_w[i];
+		ws[i] = in[i];
+	}
+
+	/* Every lane operates on its own block counter */
+	for (l = 0; l < CC20_LANES; l++)
+		in[12][l] += l;
+	ws[12] = in[12];
+
+	for (i = 0; i < 10; i++) {
+		/* Column rounds */
+		CC20_QR(ws[0], ws[4], ws[8], ws[12]);
+		CC20_QR(ws[1], ws[5], ws[9], ws[13]);
+		CC20_QR(ws[2], ws[6], ws[10], ws[14]);
+		CC20_QR(ws[3], ws[7], ws[11], ws[15]);
+
+		/* Diagonal rounds */
+		CC20_QR(ws[0], ws[5], ws[10], ws[15]);
+		CC20_QR(ws[1], ws[6], ws[11], ws[12]);
+		CC20_QR(ws[2], ws[7], ws[8], ws[13]);
+		CC20_QR(ws[3], ws[4], ws[9], ws[14]);
+	}
+
+	for (i = 0; i < LC_CC20_BLOCK_SIZE_WORDS; i++)
+		ws[i] += in[i];
+
+	/* Transpose the lanes into consecutive key stream blocks */
+	for (l = 0; l < CC20_LANES; l++) {
+		for (i = 0; i < LC_CC20_BLOCK_SIZE_WORDS; i++) {
+			uint32_t w = le_bswap32(ws[i][l]);
+
+			memcpy(out, &w, sizeof(w));
+			out += sizeof(w);
+		}
+	}
+
+	state_w[12] += CC20_LANES;
+
+	memset_secure(in, 0, sizeof(in));
+	memset_secure(ws, 0, sizeof(ws));
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitshift_be.h"
+#include "lc_ctr_drbg.h"
+#include "memset_secure.h"
+#include "visibility.h"
+
+/******************************************************************
+ * CTR DRBG callback functions
+ ******************************************************************/
+
+/*
+ * BCC function of 10.3.3 operating on a stream of data. The derivation
+ * function needs seedlen / outlen BCC invocations over the same data which
+ * only differ in the leading IV block, so all of them are calculated in the
+ * same pass.
+ */
+#define LC_DRBG_CTR_BCC_CHAINS (LC_DRBG_CTR_SEEDLEN / LC_DRBG_CTR_BLOCKLEN)
+
+struct drbg_ctr_bcc {
+	struct lc_aes_ctx aes;
+	uint8_t chain[LC_DRBG_CTR_BCC_CHAINS][LC_DRBG_CTR_BLOCKLEN];
+	uint8_t block[LC_DRBG_CTR_BLOCKLEN];
+	size_t fill;
+};
+
+static void drbg_ctr_bcc_update(struct drbg_ctr_bcc *bcc, const uint8_t *in,
+				size_t inlen)
+{
+	unsigned int i, j;
+
+	while (inlen) {
+		size_t todo = LC_DRBG_CTR_BLOCKLEN - bcc->fill;
+
+		if (todo > inlen)
+			todo = inlen;
+
+		memcpy(bcc->block + bcc->fill, in, todo);
+		bcc->fill += todo;
+		in += todo;
+		inlen -= todo;
+
+		if (bcc->fill < LC_DRBG_CTR_BLOCKLEN)
+			break;
+
+		/* 10.3.3 step 4 */
+		for (i = 0; i < LC_DRBG_CTR_BCC_CHAINS; i++) {
+			for (j = 0; j < LC_DRBG_CTR_BLOCKLEN; j++)
+				bcc->chain[i][j] ^= bcc->block[j];
+			lc_aes256_encrypt(&bcc->aes, bcc->chain[i],
+					  bcc->chain[i]);
+		}
+		bcc->fill = 0;
+	}
+}
+
+/* Derivation Function for CTR DRBG as defined in 10.3.2 */
+static void drbg_ctr_df(uint8_t outval[LC_DRBG_CTR_SEEDLEN],
+			const struct lc_drbg_string *in)
+{
+	static const uint8_t zero[LC_DRBG_CTR_BLOCKLEN] = { 0 };
+	struct drbg_ctr_bcc bcc;
+	const struct lc_drbg_string *tmp;
+	uint8_t key[LC_DRBG_CTR_KEYLEN], L_N[8], pad = 0x80;
+	uint8_t *X = bcc.chain[LC_DRBG_CTR_BCC_CHAINS - 1];
+	size_t inlen = 0;
+	unsigned int i;
+
+	for (tmp = in; tmp; tmp = tmp->next)
+		inlen += tmp->len;
+
+	/* 10.3.2 step 2 and 3 - cast is appropriate as inlen < 2^32 */
+	be32_to_ptr(L_N, (uint32_t)inlen);
+	be32_to_ptr(L_N + 4, LC_DRBG_CTR_SEEDLEN);
+
+	/* 10.3.2 step 8 */
+	for (i = 0; i < sizeof(key); i++)
+		key[i] = (uint8_t)i;
+	lc_aes256_setkey(&bcc.aes, key);
+
+	/* 10.3.2 step 9.1 - BCC of the IV block i */
+	memset(bcc.chain, 0, sizeof(bcc.chain));
+	for (i = 0; i < LC_DRBG_CTR_BCC_CHAINS; i++) {
+		be32_to_ptr(bcc.chain[i], i);
+		lc_aes256_encrypt(&bcc.aes, bcc.chain[i], bcc.chain[i]);
+	}
+	bcc.fill = 0;
+
+	/* 10.3.2 step 4 - S = L || N || input_string || 0x80 || padding */
+	drbg_ctr_bcc_update(&bcc, L_N, sizeof(L_N));
+	for (tmp = in; tmp; tmp = tmp->next)
+		drbg_ctr_bcc_update(&bcc, tmp->buf, tmp->len);
+	drbg_ctr_bcc_update(&bcc, &pad, 1);
+	if (bcc.fill)
+		drbg_ctr_bcc_update(&bcc, zero,
+				    LC_DRBG_CTR_BLOCKLEN - bcc.fill);
+
+	/* 10.3.2 step 11 to 15 */
+	lc_aes256_setkey(&bcc.aes, (const uint8_t *)bcc.chain);
+	for (i = 0; i < LC_DRBG_CTR_BCC_CHAINS; i++) {
+		lc_aes256_encrypt(&bcc.aes, X, X);
+		memcpy(outval + i * LC_DRBG_CTR_BLOCKLEN, X,
+		       LC_DRBG_CTR_BLOCKLEN);
+	}
+
+	memset_secure(&bcc, 0, sizeof(bcc));
+}
+
+/* CTR_DRBG_Update as defined in 10.2.1.2 - provided_data NULL means zero */
+static void drbg_ctr_update(struct lc_drbg_ctr_state *drbg,
+			    const uint8_t *provided_data)
+{
+	uint8_t temp[LC_DRBG_CTR_SEEDLEN];
+	unsigned int i;
+
+	/* 10.2.1.2 step 2 */
+	lc_aes256_ctr(&drbg->aes, drbg->V, temp,
+		      LC_DRBG_CTR_SEEDLEN / LC_DRBG_CTR_BLOCKLEN);
+
+	/* 10.2.1.2 step 4 */
+	if (provided_data) {
+		for (i = 0; i < LC_DRBG_CTR_SEEDLEN; i++)
+			temp[i] ^= provided_data[i];
+	}
+
+	/* 10.2.1.2 step 5 and 6 */
+	lc_aes256_setkey(&drbg->aes, temp);
+	memcpy(drbg->V, temp + LC_DRBG_CTR_KEYLEN, LC_DRBG_CTR_BLOCKLEN);
+
+	memset_secure(temp, 0, sizeof(temp));
+}
+
+DSO_PUBLIC
+size_t lc_drbg_ctr_generate(struct lc_drbg_state *drbg, uint8_t *buf,
+			    size_t buflen, struct lc_drbg_string *addtl)
+{
+	struct lc_drbg_ctr_state *drbg_ctr = (struct lc_drbg_ctr_state *)drbg;
+	uint8_t addtl_in[LC_DRBG_CTR_SEEDLEN], last[LC_DRBG_CTR_BLOCKLEN];
+	const uint8_t *provided_data = NULL;
+	size_t full = buflen / LC_DRBG_CTR_BLOCKLEN;
+
+	drbg_ctr->reseed_ctr++;
+
+	/* 10.2.1.5.2 step 2 */
+	if (addtl && addtl->len) {
+		drbg_ctr_df(addtl_in, addtl);
+		drbg_ctr_update(drbg_ctr, addtl_in);
+		provided_data = addtl_in;
+	}
+
+	/* 10.2.1.5.2 step 4 and 5 - the full blocks go directly to buf */
+	if (full) {
+		lc_aes256_ctr(&drbg_ctr->aes, drbg_ctr->V, buf, full);
+		buf += full * LC_DRBG_CTR_BLOCKLEN;
+	}
+	if (buflen % LC_DRBG_CTR_BLOCKLEN) {
+		lc_aes256_ctr(&drbg_ctr->aes, drbg_ctr->V, last, 1);
+		memcpy(buf, last, buflen % LC_DRBG_CTR_BLOCKLEN);
+		memset_secure(last, 0, sizeof(last));
+	}
+
+	/* 10.2.1.5.2 step 6 */
+	drbg_ctr_update(drbg_ctr, provided_data);
+
+	if (provided_data)
+		memset_secure(addtl_in, 0, sizeof(addtl_in));
+
+	return buflen;
+}
+
+DSO_PUBLIC
+void lc_drbg_ctr_seed(struct lc_drbg_state *drbg, struct lc_drbg_string *seed)
+{
+	struct lc_drbg_ctr_state *drbg_ctr = (struct lc_drbg_ctr_state *)drbg;
+	uint8_t seed_material[LC_DRBG_CTR_SEEDLEN];
+
+	/* 10.2.1.3.2 step 3 and 4 for the instantiation */
+	if (!drbg->seeded) {
+		uint8_t key[LC_DRBG_CTR_KEYLEN] = { 0 };
+
+		lc_aes256_setkey(&drbg_ctr->aes, key);
+		memset(drbg_ctr->V, 0, sizeof(drbg_ctr->V));
+	}
+
+	/*
+	 * 10.2.1.3.2 / 10.2.1.4.2 step 2 - the seed list contains
+	 * entropy || nonce || personalization string or entropy || additional
+	 * input
+	 */
+	drbg_ctr_df(seed_material, seed);
+
+	/* 10.2.1.3.2 step 5 / 10.2.1.4.2 step 3 */
+	drbg_ctr_update(drbg_ctr, seed_material);
+
+	/*
+	 * 10.2.1.3.2 step 6 / 10.2.1.4.2 step 4 - set reseed counter to 0
+	 * instead of 1 as the drbg_generate function increments it before the
+	 * generate operation.
+	 */
+	drbg_ctr->reseed_ctr = 0;
+
+	memset_secure(seed_material, 0, sizeof(seed_material));
+}
+
+DSO_PUBLIC
+void lc_drbg_ctr_zero(struct lc_drbg_state *drbg)
+{
+	struct lc_drbg_ctr_state *drbg_ctr = (struct lc_drbg_ctr_state *)drbg;
+
+	drbg_ctr->reseed_ctr = 0;
+	memset_secure(&drbg_ctr->aes, 0, sizeof(drbg_ctr->aes));
+	memset_secure(drbg_ctr->V, 0, sizeof(drbg_ctr->V));
+}
+
+DSO_PUBLIC
+int lc_drbg_ctr_alloc(struct lc_drbg_state **drbg)
+{
+	struct lc_drbg_ctr_state *tmp;
+	int ret = posix_memalign((void *)&tmp,
+				 __alignof__(struct lc_drbg_ctr_state),
+				 sizeof(struct lc_drbg_ctr_state));
+
+	if (ret)
+		return -ret;
+	memset(tmp, 0, sizeof(struct lc_drbg_ctr_state));
+
+	LC_DRBG_CTR_SET_CTX(tmp);
+
+	*drbg = (struct lc_drbg_state *)tmp;
+
+	return 0;
+}
@@ -24,6 +24,7 @@
 
 #include "bitshift_be.h"
 #include "lc_hash_drbg_sha512.h"
+#include "sha2_accel.h"
 #include "visibility.h"
 
 /***************************************************************
@@ -44,37 +45,109 @@ static void drbg_hash(struct lc_drbg_hash_state *drbg, uint8_t *outval,
  ******************************************************************/
 
 /*
- * Increment buffer
+ * Load / store the n <= 8 bytes at p as a big-endian value. The lengths are
+ * compile-time constants for all callers, so the byte loop vanishes.
+ */
+static inline uint64_t drbg_load_be(const uint8_t *p, size_t n)
+{
+	uint64_t val = 0;
+	size_t i;
+
+	if (n == sizeof(uint64_t))
+		return ptr_to_be64(p);
+
+	for (i = 0; i < n; i++)
+		val = (val << 8) | p[i];
+	return val;
+}
+
+static inline void drbg_store_be(uint8_t *p, uint64_t val, size_t n)
+{
+	size_t i;
+
+	if (n == sizeof(uint64_t)) {
+		be64_to_ptr(p, val);
+		return;
+	}
+
+	for (i = n; i > 0; i--) {
+		p[i - 1] = (uint8_t)val;
+		val >>= 8;
+	}
+}
+
+/*
+ * Load the big-endian word of n bytes ending off bytes before the end of buf.
+ * Bytes in front of buf are treated as zero.
+ */
+static inline uint64_t drbg_load_word(const uint8_t *buf, size_t buflen,
+				      size_t off, size_t n)
+{
+	if (off >= buflen)
+		return 0;
+	if (n > buflen - off)
+		n = buflen - off;
+	return drbg_load_be(buf + buflen - off - n, n);
+}
+
+/*
+ * Add buffers as big-endian numbers modulo 2^(8 * dstlen)
  *
- * @dst buffer to increment
+ * @dst buffer to add to
  * @add value to add
+ *
+ * The addition operates on 64-bit words starting with the least significant
+ * one. The carry always propagates through the entire buffer, so the
+ * execution time only depends on the lengths which are public. The function
+ * is always inlined to let the compiler unroll it for the constant lengths.
  */
-static void drbg_add_buf(uint8_t *dst, size_t dstlen, const uint8_t *add,
-			 size_t addlen)
+static inline __attribute__((always_inline)) void
+drbg_add_buf(uint8_t *dst, size_t dstlen, const uint8_t *add, size_t addlen)
 {
-	/* implied: dstlen > addlen */
-	uint8_t *dstptr;
-	const uint8_t *addptr;
-	unsigned int remainder = 0;
-	size_t len = addlen;
-
-	dstptr = dst + (dstlen - 1);
-	addptr = add + (addlen - 1);
-	while (len) {
-		remainder += *dstptr + *addptr;
-		*dstptr = remainder & 0xff;
-		remainder >>= 8;
-		len--;
-		dstptr--;
-		addptr--;
+	/* implied: dstlen >= addlen */
+	uint64_t d, a, carry = 0;
+	size_t off, n;
+	uint8_t *p;
+
+	for (off = 0; off < dstlen; off += n) {
+		n = dstlen - off;
+		if (n > 8)
+			n = 8;
+		p = dst + dstlen - off - n;
+
+		d = drbg_load_be(p, n);
+		a = drbg_load_word(add, addlen, off, n);
+		carry = (uint64_t)__builtin_add_overflow(d, a, &d) +
+			(uint64_t)__builtin_add_overflow(d, carry, &d);
+		drbg_store_be(p, d, n);
 	}
-	len = dstlen - addlen;
-	while (len && remainder > 0) {
-		remainder = *dstptr + 1;
-		*dstptr = remainder & 0xff;
-		remainder >>= 8;
-		len--;
-		dstptr--;
+}
+
+/*
+ * V = V + H + C + reseed_ctr as required by 10.1.1.4 step 5 in one pass over
+ * V. The word-wise carry is at most 3 and is simply added to the next word.
+ */
+static inline __attribute__((always_inline)) void
+drbg_hash_update_v(uint8_t *V, const uint8_t *H, const uint8_t *C,
+		   uint64_t reseed_ctr)
+{
+	uint64_t d, h, c, carry = reseed_ctr;
+	size_t off, n;
+	uint8_t *p;
+
+	for (off = 0; off < LC_DRBG_HASH_STATELEN; off += n) {
+		n = LC_DRBG_HASH_STATELEN - off;
+		if (n > 8)
+			n = 8;
+		p = V + LC_DRBG_HASH_STATELEN - off - n;
+
+		d = drbg_load_be(p, n);
+		h = drbg_load_word(H, LC_DRBG_HASH_BLOCKLEN, off, n);
+		c = drbg_load_word(C, LC_DRBG_HASH_STATELEN, off, n);
+		carry = (uint64_t)__builtin_add_overflow(d, carry, &d) +
+			(uint64_t)__builtin_add_overflow(d, h, &d) +
+			(uint64_t)__builtin_add_overflow(d, c, &d);
+		drbg_store_be(p, d, n);
 	}
 }
 
@@ -189,6 +262,53 @@ static void drbg_hash_process_addtl(struct lc_drbg_hash_state *drbg,
 	memset(drbg->scratchpad, 0, LC_DRBG_HASH_BLOCKLEN);
 }
 
+/*
+ * The data hashed by Hashgen is V plus a counter which fits into one SHA-512
+ * block after padding. All digests are independent of each other which
+ * allows the multi-buffer SHA-512 to calculate them in parallel.
+ */
+#if (LC_DRBG_HASH_BLOCKLEN == LC_SHA512_SIZE_DIGEST) &&                        \
+	(LC_DRBG_HASH_STATELEN + 1 + 16 <= LC_SHA512_SIZE_BLOCK)
+#define LC_DRBG_HASH_MB
+
+static size_t drbg_hash_hashgen_mb(uint8_t *src, uint8_t *buf, size_t buflen)
+{
+	uint8_t blocks[SHA512_MB_MAX_LANES * LC_SHA512_SIZE_BLOCK];
+	uint8_t prefix = DRBG_PREFIX1;
+	size_t i, num, len = 0;
+
+	memset(blocks, 0, sizeof(blocks));
+
+	/* Leave the last block to the caller as it may be a partial one */
+	while (buflen - len > LC_DRBG_HASH_BLOCKLEN) {
+		num = (buflen - len - 1) / LC_DRBG_HASH_BLOCKLEN;
+		if (num > SHA512_MB_MAX_LANES)
+			num = SHA512_MB_MAX_LANES;
+
+		for (i = 0; i < num; i++) {
+			uint8_t *block = blocks + i * LC_SHA512_SIZE_BLOCK;
+
+			/* SHA-512 padding of the V || counter message */
+			memcpy(block, src, LC_DRBG_HASH_STATELEN);
+			block[LC_DRBG_HASH_STATELEN] = 0x80;
+			be64_to_ptr(block + LC_SHA512_SIZE_BLOCK - 8,
+				    LC_DRBG_HASH_STATELEN * 8);
+
+			/* 10.1.1.4 hashgen step 4.3 */
+			drbg_add_buf(src, LC_DRBG_HASH_STATELEN, &prefix, 1);
+		}
+
+		/* 10.1.1.4 step hashgen 4.1 and 4.2 */
+		sha512_mb_blocks(blocks, buf + len, num);
+		len += num * LC_DRBG_HASH_BLOCKLEN;
+	}
+
+	memset_secure(blocks, 0, sizeof(blocks));
+
+	return len;
+}
+#endif
+
 /* Hashgen defined in 10.1.1.4 */
 static size_t drbg_hash_hashgen(struct lc_drbg_hash_state *drbg, uint8_t *buf,
 				size_t buflen)
@@ -203,6 +323,11 @@ static size_t drbg_hash_hashgen(struct lc_drbg_hash_state *drbg, uint8_t *buf,
 	memcpy(src, drbg->V, LC_DRBG_HASH_STATELEN);
 	lc_drbg_string_fill(&data, src, LC_DRBG_HASH_STATELEN);
 
+#ifdef LC_DRBG_HASH_MB
+	if (sha512_mb_blocks && buflen > LC_DRBG_HASH_BLOCKLEN)
+		len = drbg_hash_hashgen_mb(src, buf, buflen);
+#endif
+
 	while (len < buflen) {
 		size_t outlen = 0;
 
@@ -232,7 +357,7 @@ static size_t drbg_hash_generate_internal(struct lc_drbg_hash_state *drbg,
 {
 	struct lc_drbg_string data1, data2;
 	size_t len = 0;
-	uint8_t req[8], prefix = DRBG_PREFIX3;
+	uint8_t prefix = DRBG_PREFIX3;
 
 	drbg->reseed_ctr++;
 
@@ -250,12 +375,8 @@ static size_t drbg_hash_generate_internal(struct lc_drbg_hash_state *drbg,
 	drbg_hash(drbg, drbg->scratchpad, &data1);
 
 	/* 10.1.1.4 step 5 */
-	drbg_add_buf(drbg->V, LC_DRBG_HASH_STATELEN, drbg->scratchpad,
-		     LC_DRBG_HASH_BLOCKLEN);
-	drbg_add_buf(drbg->V, LC_DRBG_HASH_STATELEN, drbg->C,
-		     LC_DRBG_HASH_STATELEN);
-	be64_to_ptr(req, drbg->reseed_ctr);
-	drbg_add_buf(drbg->V, LC_DRBG_HASH_STATELEN, req, sizeof(req));
+	drbg_hash_update_v(drbg->V, drbg->scratchpad, drbg->C,
+			   drbg->reseed_ctr);
 
 	memset(drbg->scratchpad, 0, LC_DRBG_HASH_BLOCKLEN);
 	return len;
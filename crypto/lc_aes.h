@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef LC_AES_H
+#define LC_AES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LC_AES_BLOCK_SIZE 16
+#define LC_AES256_KEY_SIZE 32
+#define LC_AES256_ROUNDS 14
+
+/* Expanded AES-256 encryption key in the byte order of FIPS 197 */
+struct lc_aes_ctx {
+	uint8_t rk[(LC_AES256_ROUNDS + 1) * LC_AES_BLOCK_SIZE];
+} __attribute__((aligned(16)));
+
+/*
+ * AES-256 encryption primitives. They use AES-NI on x86 and the ARMv8
+ * cryptographic extensions on AArch64 when the CPU provides them. The
+ * software fallback is constant time but considerably slower.
+ */
+
+/**
+ * @brief Expand an AES-256 key
+ *
+ * @param [out] ctx AES context to fill
+ * @param [in] key AES-256 key
+ */
+void lc_aes256_setkey(struct lc_aes_ctx *ctx,
+		      const uint8_t key[LC_AES256_KEY_SIZE]);
+
+/**
+ * @brief Encrypt one block
+ *
+ * @param [in] ctx AES context with the expanded key
+ * @param [out] out Ciphertext block
+ * @param [in] in Plaintext block - may be identical to out
+ */
+void lc_aes256_encrypt(const struct lc_aes_ctx *ctx,
+		       uint8_t out[LC_AES_BLOCK_SIZE],
+		       const uint8_t in[LC_AES_BLOCK_SIZE]);
+
+/**
+ * @brief Generate a CTR mode key stream
+ *
+ * For each block, the 128 bit big endian counter is incremented first and
+ * then encrypted as required by the SP800-90A CTR_DRBG. Up to eight blocks
+ * are processed interleaved to keep the AES pipeline busy.
+ *
+ * @param [in] ctx AES context with the expanded key
+ * @param [in,out] ctr Counter block which holds the last used counter value
+ *		       upon return
+ * @param [out] out Buffer of blocks * LC_AES_BLOCK_SIZE bytes for the
+ *		    key stream
+ * @param [in] blocks Number of blocks to generate
+ */
+void lc_aes256_ctr(const struct lc_aes_ctx *ctx,
+		   uint8_t ctr[LC_AES_BLOCK_SIZE], uint8_t *out, size_t blocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LC_AES_H */
@@ -38,6 +38,19 @@ extern const struct lc_sym *lc_chacha20;
  */
 void cc20_block(struct lc_sym_state *state, uint32_t *stream);
 
+/**
+ * @brief ChaCha20 multi-block function
+ *
+ * Generate consecutive ChaCha20 blocks from the state. Where the CPU offers
+ * a SIMD instruction set, multiple blocks are calculated in parallel. The
+ * output is identical to invoking cc20_block for each block.
+ *
+ * @param [in] state ChaCha20 state from which to derive the block output
+ * @param [out] out ChaCha20 key stream output - no alignment is required
+ * @param [in] blocks Number of blocks to generate
+ */
+void cc20_blocks(struct lc_sym_state *state, uint8_t *out, size_t blocks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,8 +28,21 @@
 extern "C" {
 #endif
 
+/*
+ * Size of the key stream buffer used by lc_cc20_drng_generate_buffered in
+ * ChaCha20 blocks of 64 bytes: the first 32 bytes of every buffer epoch
+ * replace the key.
+ */
+#define LC_CC20_DRNG_BUF_BLOCKS 8
+#define LC_CC20_DRNG_BUF_SIZE (LC_CC20_DRNG_BUF_BLOCKS * 64)
+
+/* Requests smaller than this are served from the key stream buffer */
+#define LC_CC20_DRNG_BUF_MAX_REQ (LC_CC20_DRNG_BUF_SIZE / 2)
+
 struct lc_chacha20_drng_ctx {
 	struct lc_sym_ctx cc20;
+	uint8_t buf[LC_CC20_DRNG_BUF_SIZE];
+	size_t buf_avail;
 };
 
 #define LC_CC20_DRNG_STATE_SIZE (LC_SYM_STATE_SIZE(lc_chacha20))
@@ -54,6 +67,8 @@ static inline void lc_cc20_drng_zero(struct lc_chacha20_drng_ctx *cc20_ctx)
 
 	memset_secure((uint8_t *)cc20_ctx + sizeof(struct lc_chacha20_drng_ctx),
 		      0, LC_CC20_DRNG_STATE_SIZE);
+	memset_secure(cc20_ctx->buf, 0, sizeof(cc20_ctx->buf));
+	cc20_ctx->buf_avail = 0;
 	lc_sym_init(sym_ctx);
 }
 
@@ -120,6 +135,27 @@ void lc_cc20_drng_zero_free(struct lc_chacha20_drng_ctx *cc20_ctx);
 void lc_cc20_drng_generate(struct lc_chacha20_drng_ctx *cc20_ctx,
 			   uint8_t *outbuf, size_t outbuflen);
 
+/**
+ * @brief Obtain random numbers for small requests
+ *
+ * @param [in] cc20_ctx allocated ChaCha20 cipher handle
+ * @param [out] outbuf allocated buffer that is to be filled with random numbers
+ * @param [in] outbuflen length of outbuf indicating the size of the random
+ *	number byte string to be generated
+ *
+ * Contrary to lc_cc20_drng_generate, the key is not updated with every
+ * request. Instead, LC_CC20_DRNG_BUF_BLOCKS blocks of key stream are generated
+ * at once and the key is replaced right away from this key stream (fast key
+ * erasure). The requests are served from the remainder of the buffer which
+ * is wiped as it is handed out. Thus, if the DRNG state becomes known after
+ * a request, an attacker cannot deduce the already generated random numbers.
+ *
+ * Requests of LC_CC20_DRNG_BUF_MAX_REQ bytes or more are served by
+ * lc_cc20_drng_generate.
+ */
+void lc_cc20_drng_generate_buffered(struct lc_chacha20_drng_ctx *cc20_ctx,
+				    uint8_t *outbuf, size_t outbuflen);
+
 /**
  * @brief Reseed the ChaCha20 DRNG
  *
@@ -136,6 +172,36 @@ void lc_cc20_drng_generate(struct lc_chacha20_drng_ctx *cc20_ctx,
 void lc_cc20_drng_seed(struct lc_chacha20_drng_ctx *cc20_ctx,
 		       const uint8_t *inbuf, size_t inbuflen);
 
+/**
+ * @brief Obtain random numbers from a reserved range of ChaCha20 blocks
+ *
+ * @param [in] cc20_ctx allocated ChaCha20 cipher handle
+ * @param [in] block first block relative to the current block counter
+ * @param [out] outbuf allocated buffer that is to be filled with random numbers
+ * @param [in] outbuflen length of outbuf indicating the size of the random
+ *	number byte string to be generated
+ *
+ * Contrary to lc_cc20_drng_generate, the DRNG state is not modified. Thus,
+ * the function can be invoked concurrently by callers which reserved disjoint
+ * block ranges. The backtracking resistance is only established with the next
+ * invocation of lc_cc20_drng_rekey.
+ */
+void lc_cc20_drng_generate_at(const struct lc_chacha20_drng_ctx *cc20_ctx,
+			      uint32_t block, uint8_t *outbuf,
+			      size_t outbuflen);
+
+/**
+ * @brief Update the ChaCha20 key after output by lc_cc20_drng_generate_at
+ *
+ * @param [in] cc20_ctx allocated ChaCha20 cipher handle
+ * @param [in] blocks number of blocks handed out with lc_cc20_drng_generate_at
+ *
+ * The key is updated with the block following the handed out blocks to
+ * provide backtracking resistance for the handed out blocks.
+ */
+void lc_cc20_drng_rekey(struct lc_chacha20_drng_ctx *cc20_ctx,
+			uint32_t blocks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef LC_CTR_DRBG_H
+#define LC_CTR_DRBG_H
+
+#include "lc_aes.h"
+#include "lc_drbg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SP800-90A table 3: CTR_DRBG with AES-256 and derivation function */
+#define LC_DRBG_CTR_KEYLEN LC_AES256_KEY_SIZE
+#define LC_DRBG_CTR_BLOCKLEN LC_AES_BLOCK_SIZE
+#define LC_DRBG_CTR_SEEDLEN (LC_DRBG_CTR_KEYLEN + LC_DRBG_CTR_BLOCKLEN)
+
+struct lc_drbg_ctr_state {
+	struct lc_drbg_state drbg;
+	/* Key 10.2.1.1 1b) - kept as expanded AES key */
+	struct lc_aes_ctx aes;
+	uint8_t V[LC_DRBG_CTR_BLOCKLEN]; /* internal state 10.2.1.1 1a) */
+
+	/* Number of RNG requests since last reseed -- 10.2.1.1 1c) */
+	size_t reseed_ctr;
+};
+
+void lc_drbg_ctr_seed(struct lc_drbg_state *drbg, struct lc_drbg_string *seed);
+size_t lc_drbg_ctr_generate(struct lc_drbg_state *drbg, uint8_t *buf,
+			    size_t buflen, struct lc_drbg_string *addtl);
+void lc_drbg_ctr_zero(struct lc_drbg_state *drbg);
+
+#define LC_DRBG_CTR_SET_CTX(name)                                              \
+	_LC_DRBG_SET_CTX((&name->drbg), lc_drbg_ctr_seed,                      \
+			 lc_drbg_ctr_generate, lc_drbg_ctr_zero);              \
+	name->reseed_ctr = 0
+
+/**
+ * @brief Allocate stack memory for the CTR DRBG context
+ *
+ * @param [in] name Name of the stack variable
+ */
+#define LC_DRBG_CTR_CTX_ON_STACK(name)                                         \
+	struct lc_drbg_ctr_state name##_ctr;                                   \
+	struct lc_drbg_ctr_state *name##_ctr_p = &name##_ctr;                  \
+	LC_DRBG_CTR_SET_CTX(name##_ctr_p);                                     \
+	struct lc_drbg_state *name = (struct lc_drbg_state *)name##_ctr_p;     \
+	lc_drbg_ctr_zero(name)
+
+/**
+ * @brief Allocate CTR DRBG context on heap
+ *
+ * @param [out] drbg Allocated CTR DRBG context
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int lc_drbg_ctr_alloc(struct lc_drbg_state **drbg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LC_CTR_DRBG_H */
@@ -23,6 +23,7 @@
 #include "bitshift_be.h"
 #include "lc_sha256.h"
 #include "memset_secure.h"
+#include "sha2_accel.h"
 #include "visibility.h"
 
 struct lc_hash_state {
@@ -31,7 +32,7 @@ struct lc_hash_state {
 	uint8_t partial[LC_SHA256_SIZE_BLOCK];
 };
 
-static const uint32_t sha256_K[] = {
+const uint32_t sha256_K[] = {
 	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
 	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
 	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
@@ -71,8 +72,8 @@ static inline uint32_t ror(uint32_t x, int n)
 #define s0(x) (ror(x, 7) ^ ror(x, 18) ^ (x >> 3))
 #define s1(x) (ror(x, 17) ^ ror(x, 19) ^ (x >> 10))
 
-static inline void sha256_transform(struct lc_hash_state *ctx,
-				    const uint8_t *in)
+static inline void sha256_transform_c(struct lc_hash_state *ctx,
+				      const uint8_t *in)
 {
 	uint32_t W[64], a, b, c, d, e, f, g, h, T1, T2;
 	unsigned int i;
@@ -123,6 +124,18 @@ static inline void sha256_transform(struct lc_hash_state *ctx,
 		W[i] = 0;
 }
 
+static void sha256_transform(struct lc_hash_state *ctx, const uint8_t *in,
+			     size_t blocks)
+{
+	if (sha256_accel_blocks) {
+		sha256_accel_blocks(ctx->H, in, blocks);
+		return;
+	}
+
+	for (; blocks; blocks--, in += LC_SHA256_SIZE_BLOCK)
+		sha256_transform_c(ctx, in);
+}
+
 static void sha256_update(struct lc_hash_state *ctx, const uint8_t *in,
 			  size_t inlen)
 {
@@ -151,13 +164,17 @@ static void sha256_update(struct lc_hash_state *ctx, const uint8_t *in,
 		inlen -= todo;
 		in += todo;
 
-		sha256_transform(ctx, ctx->partial);
+		sha256_transform(ctx, ctx->partial, 1);
 	}
 
 	/* Perform a transformation of full block-size messages */
-	for (; inlen >= LC_SHA256_SIZE_BLOCK;
-	     inlen -= LC_SHA256_SIZE_BLOCK, in += LC_SHA256_SIZE_BLOCK)
-		sha256_transform(ctx, in);
+	if (inlen >= LC_SHA256_SIZE_BLOCK) {
+		size_t blocks = inlen / LC_SHA256_SIZE_BLOCK;
+
+		sha256_transform(ctx, in, blocks);
+		inlen -= blocks * LC_SHA256_SIZE_BLOCK;
+		in += blocks * LC_SHA256_SIZE_BLOCK;
+	}
 
 	/* If we have data left, copy it into the partial block buffer */
 	memcpy(ctx->partial, in, inlen);
@@ -183,7 +200,7 @@ static void sha256_final(struct lc_hash_state *ctx, uint8_t *digest)
 		memset(ctx->partial + partial, 0,
 		       LC_SHA256_SIZE_BLOCK - partial);
 		partial = 0;
-		sha256_transform(ctx, ctx->partial);
+		sha256_transform(ctx, ctx->partial, 1);
 	}
 
 	/* Fill the unused part of the partial buffer with zeros */
@@ -194,7 +211,7 @@ static void sha256_final(struct lc_hash_state *ctx, uint8_t *digest)
 	be64_to_ptr(ctx->partial + (LC_SHA256_SIZE_BLOCK - 8), ctx->msg_len);
 
 	/* Final transformation */
-	sha256_transform(ctx, ctx->partial);
+	sha256_transform(ctx, ctx->partial, 1);
 
 	memset_secure(ctx->partial, 0, LC_SHA256_SIZE_BLOCK);
 
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <string.h>
+
+#include "bitshift_be.h"
+#include "constructor.h"
+#include "cpufeatures.h"
+#include "lc_sha512.h"
+#include "memset_secure.h"
+#include "sha2_accel.h"
+
+void (*sha256_accel_blocks)(uint32_t H[8], const uint8_t *in,
+			    size_t blocks) = NULL;
+void (*sha512_accel_blocks)(uint64_t H[8], const uint8_t *in,
+			    size_t blocks) = NULL;
+void (*sha512_mb_blocks)(const uint8_t *in, uint8_t *digests,
+			 size_t num) = NULL;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+/*
+ * SHA-256 using the Intel SHA extensions. The chaining value is kept in the
+ * ABEF / CDGH register layout expected by SHA256RNDS2 for all blocks.
+ */
+static __attribute__((target("sha,sse4.1,ssse3"))) void
+sha256_blocks_shani(uint32_t H[8], const uint8_t *in, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					    0x0405060700010203ULL);
+	__m128i state0, state1, abef, cdgh, msg, tmp, m[4];
+	unsigned int i;
+
+	tmp = _mm_loadu_si128((const __m128i *)&H[0]);
+	state1 = _mm_loadu_si128((const __m128i *)&H[4]);
+
+	tmp = _mm_shuffle_epi32(tmp, 0xB1); /* CDAB */
+	state1 = _mm_shuffle_epi32(state1, 0x1B); /* EFGH */
+	state0 = _mm_alignr_epi8(tmp, state1, 8); /* ABEF */
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0); /* CDGH */
+
+	for (; blocks; blocks--, in += 64) {
+		abef = state0;
+		cdgh = state1;
+
+		for (i = 0; i < 16; i++) {
+			if (i < 4) {
+				msg = _mm_loadu_si128(
+					(const __m128i *)(in + 16 * i));
+				m[i] = _mm_shuffle_epi8(msg, mask);
+			} else {
+				/* W[t] for the next four rounds */
+				msg = _mm_sha256msg1_epu32(m[i & 3],
+							   m[(i + 1) & 3]);
+				tmp = _mm_alignr_epi8(m[(i + 3) & 3],
+						      m[(i + 2) & 3], 4);
+				msg = _mm_add_epi32(msg, tmp);
+				m[i & 3] = _mm_sha256msg2_epu32(msg,
+								m[(i + 3) & 3]);
+			}
+
+			msg = _mm_add_epi32(m[i & 3],
+					    _mm_loadu_si128((const __m128i *)
+							    &sha256_K[4 * i]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+			msg = _mm_shuffle_epi32(msg, 0x0E);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B); /* FEBA */
+	state1 = _mm_shuffle_epi32(state1, 0xB1); /* DCHG */
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0); /* DCBA */
+	state1 = _mm_alignr_epi8(state1, tmp, 8); /* ABEF */
+
+	_mm_storeu_si128((__m128i *)&H[0], state0);
+	_mm_storeu_si128((__m128i *)&H[4], state1);
+}
+
+static const uint64_t sha512_iv[] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+	0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+#define SHA512_ROR(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define SHA512_CH(x, y, z) ((x & y) ^ (~x & z))
+#define SHA512_MAJ(x, y, z) ((x & y) ^ (x & z) ^ (y & z))
+#define SHA512_S0(x) (SHA512_ROR(x, 28) ^ SHA512_ROR(x, 34) ^ SHA512_ROR(x, 39))
+#define SHA512_S1(x) (SHA512_ROR(x, 14) ^ SHA512_ROR(x, 18) ^ SHA512_ROR(x, 41))
+#define SHA512_s0(x) (SHA512_ROR(x, 1) ^ SHA512_ROR(x, 8) ^ (x >> 7))
+#define SHA512_s1(x) (SHA512_ROR(x, 19) ^ SHA512_ROR(x, 61) ^ (x >> 6))
+
+#define SHA512_MB_LANES 4
+#define SHA512_MB_VEC sha512_vec4
+#define SHA512_MB_NAME sha512_mb_avx2_kernel
+#define SHA512_MB_TARGET __attribute__((target("avx2")))
+#include "sha512_mb_kernel.h"
+#undef SHA512_MB_LANES
+#undef SHA512_MB_VEC
+#undef SHA512_MB_NAME
+#undef SHA512_MB_TARGET
+
+#define SHA512_MB_LANES 8
+#define SHA512_MB_VEC sha512_vec8
+#define SHA512_MB_NAME sha512_mb_avx512_kernel
+#define SHA512_MB_TARGET __attribute__((target("avx512f")))
+#include "sha512_mb_kernel.h"
+#undef SHA512_MB_LANES
+#undef SHA512_MB_VEC
+#undef SHA512_MB_NAME
+#undef SHA512_MB_TARGET
+
+/*
+ * Feed the blocks to the kernel in groups of its lane count. A trailing
+ * partial group is processed from a zero-padded copy.
+ */
+static void sha512_mb_run(void (*kernel)(const uint8_t *in, uint8_t *digests),
+			  size_t lanes, const uint8_t *in, uint8_t *digests,
+			  size_t num)
+{
+	uint8_t blocks[SHA512_MB_MAX_LANES * LC_SHA512_SIZE_BLOCK];
+	uint8_t out[SHA512_MB_MAX_LANES * LC_SHA512_SIZE_DIGEST];
+
+	for (; num >= lanes; num -= lanes) {
+		kernel(in, digests);
+		in += lanes * LC_SHA512_SIZE_BLOCK;
+		digests += lanes * LC_SHA512_SIZE_DIGEST;
+	}
+
+	if (!num)
+		return;
+
+	memcpy(blocks, in, num * LC_SHA512_SIZE_BLOCK);
+	memset(blocks + num * LC_SHA512_SIZE_BLOCK, 0,
+	       (lanes - num) * LC_SHA512_SIZE_BLOCK);
+	kernel(blocks, out);
+	memcpy(digests, out, num * LC_SHA512_SIZE_DIGEST);
+
+	memset_secure(blocks, 0, sizeof(blocks));
+	memset_secure(out, 0, sizeof(out));
+}
+
+static void sha512_mb_avx2(const uint8_t *in, uint8_t *digests, size_t num)
+{
+	sha512_mb_run(sha512_mb_avx2_kernel, 4, in, digests, num);
+}
+
+static void sha512_mb_avx512(const uint8_t *in, uint8_t *digests, size_t num)
+{
+	sha512_mb_run(sha512_mb_avx512_kernel, 8, in, digests, num);
+}
+
+ESDM_DEFINE_CONSTRUCTOR_EARLY(sha2_accel_init)
+{
+	esdm_cpufeatures_init();
+
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_AVX512F))
+		sha512_mb_blocks = sha512_mb_avx512;
+	else if (esdm_cpu_has(ESDM_CPU_FEATURE_AVX2))
+		sha512_mb_blocks = sha512_mb_avx2;
+
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_SHA | ESDM_CPU_FEATURE_SSSE3 |
+			 ESDM_CPU_FEATURE_SSE41))
+		sha256_accel_blocks = sha256_blocks_shani;
+}
+
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+
+#include <arm_neon.h>
+
+/* SHA-256 using the ARMv8 cryptographic extensions */
+static __attribute__((target("arch=armv8-a+crypto"))) void
+sha256_blocks_armv8(uint32_t H[8], const uint8_t *in, size_t blocks)
+{
+	uint32x4_t state0, state1, abcd, efgh, tmp, tmp2, m[4];
+	unsigned int i;
+
+	state0 = vld1q_u32(&H[0]);
+	state1 = vld1q_u32(&H[4]);
+
+	for (; blocks; blocks--, in += 64) {
+		abcd = state0;
+		efgh = state1;
+
+		for (i = 0; i < 4; i++) {
+			m[i] = vreinterpretq_u32_u8(
+				vrev32q_u8(vld1q_u8(in + 16 * i)));
+		}
+
+		for (i = 0; i < 16; i++) {
+			tmp = vaddq_u32(m[i & 3], vld1q_u32(&sha256_K[4 * i]));
+
+			/* W[t] for the rounds 16 steps ahead */
+			if (i < 12) {
+				m[i & 3] = vsha256su1q_u32(
+					vsha256su0q_u32(m[i & 3],
+							m[(i + 1) & 3]),
+					m[(i + 2) & 3], m[(i + 3) & 3]);
+			}
+
+			tmp2 = state0;
+			state0 = vsha256hq_u32(state0, state1, tmp);
+			state1 = vsha256h2q_u32(state1, tmp2, tmp);
+		}
+
+		state0 = vaddq_u32(state0, abcd);
+		state1 = vaddq_u32(state1, efgh);
+	}
+
+	vst1q_u32(&H[0], state0);
+	vst1q_u32(&H[4], state1);
+}
+
+/*
+ * Two SHA-512 rounds using the ARMv8.2 SHA512 instructions. The registers
+ * holding the chaining value rotate their roles with every invocation.
+ */
+#define SHA512_ARMV8_2ROUNDS(p, A, C, E, G)                                    \
+	do {                                                                   \
+		uint64x2_t sum, intermed;                                      \
+                                                                               \
+		if (p >= 8) {                                                  \
+			s[(p)&7] = vsha512su1q_u64(                            \
+				vsha512su0q_u64(s[(p)&7], s[((p) + 1) & 7]),   \
+				s[((p) + 7) & 7],                              \
+				vextq_u64(s[((p) + 4) & 7], s[((p) + 5) & 7],  \
+					  1));                                 \
+		}                                                              \
+		sum = vaddq_u64(s[(p)&7], vld1q_u64(&sha512_K[2 * (p)]));      \
+		sum = vaddq_u64(vextq_u64(sum, sum, 1), G);                    \
+		intermed = vsha512hq_u64(sum, vextq_u64(E, G, 1),              \
+					 vextq_u64(C, E, 1));                  \
+		G = vsha512h2q_u64(intermed, C, A);                            \
+		C = vaddq_u64(C, intermed);                                    \
+	} while (0)
+
+/* SHA-512 using the ARMv8.2 SHA512 extensions */
+static __attribute__((target("arch=armv8.2-a+sha3"))) void
+sha512_blocks_armv8(uint64_t H[8], const uint8_t *in, size_t blocks)
+{
+	uint64x2_t ab, cd, ef, gh, ab_orig, cd_orig, ef_orig, gh_orig, s[8];
+	unsigned int i;
+
+	ab = vld1q_u64(&H[0]);
+	cd = vld1q_u64(&H[2]);
+	ef = vld1q_u64(&H[4]);
+	gh = vld1q_u64(&H[6]);
+
+	for (; blocks; blocks--, in += 128) {
+		ab_orig = ab;
+		cd_orig = cd;
+		ef_orig = ef;
+		gh_orig = gh;
+
+		for (i = 0; i < 8; i++) {
+			s[i] = vreinterpretq_u64_u8(
+				vrev64q_u8(vld1q_u8(in + 16 * i)));
+		}
+
+		for (i = 0; i < 40; i += 4) {
+			SHA512_ARMV8_2ROUNDS(i, ab, cd, ef, gh);
+			SHA512_ARMV8_2ROUNDS(i + 1, gh, ab, cd, ef);
+			SHA512_ARMV8_2ROUNDS(i + 2, ef, gh, ab, cd);
+			SHA512_ARMV8_2ROUNDS(i + 3, cd, ef, gh, ab);
+		}
+
+		ab = vaddq_u64(ab, ab_orig);
+		cd = vaddq_u64(cd, cd_orig);
+		ef = vaddq_u64(ef, ef_orig);
+		gh = vaddq_u64(gh, gh_orig);
+	}
+
+	vst1q_u64(&H[0], ab);
+	vst1q_u64(&H[2], cd);
+	vst1q_u64(&H[4], ef);
+	vst1q_u64(&H[6], gh);
+}
+
+ESDM_DEFINE_CONSTRUCTOR_EARLY(sha2_accel_init)
+{
+	esdm_cpufeatures_init();
+
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_ARM_SHA2))
+		sha256_accel_blocks = sha256_blocks_armv8;
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_ARM_SHA512))
+		sha512_accel_blocks = sha512_blocks_armv8;
+}
+
+#endif
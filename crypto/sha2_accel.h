@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef SHA2_ACCEL_H
+#define SHA2_ACCEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Accelerated SHA-2 block functions: they process the given number of full
+ * input blocks and update the chaining value H. The pointers are set at load
+ * time when the CPU provides the required instructions and are NULL
+ * otherwise which implies that the C implementation is used.
+ */
+extern void (*sha256_accel_blocks)(uint32_t H[8], const uint8_t *in,
+				   size_t blocks);
+extern void (*sha512_accel_blocks)(uint64_t H[8], const uint8_t *in,
+				   size_t blocks);
+
+/*
+ * Multi-buffer SHA-512: calculate the message digests of num independent
+ * messages which each consist of exactly one already padded block. The
+ * blocks are concatenated in the input, the digests in the output. The
+ * pointer is NULL when no SIMD implementation is available.
+ */
+#define SHA512_MB_MAX_LANES 8
+extern void (*sha512_mb_blocks)(const uint8_t *in, uint8_t *digests,
+				size_t num);
+
+/* Round constants of the C implementations */
+extern const uint32_t sha256_K[64];
+extern const uint64_t sha512_K[80];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHA2_ACCEL_H */
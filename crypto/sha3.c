@@ -21,6 +21,8 @@
 
 #include "build_bug_on.h"
 #include "bitshift_le.h"
+#include "constructor.h"
+#include "cpufeatures.h"
 #include "lc_sha3.h"
 #include "memset_secure.h"
 #include "visibility.h"
@@ -46,13 +48,59 @@ static inline uint64_t rol(uint64_t x, int n)
 /*********************************** Keccak ***********************************/
 /* state[x + y*5] */
 #define A(x, y) (x + 5 * y)
-#define RHO_ROL(t) (((t + 1) * (t + 2) / 2) % 64)
 
-static inline void keccakp_theta_rho_pi(uint64_t s[25])
+static const uint64_t keccakp_iota_vals[] = {
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+	0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+	0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+	0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+	0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+	0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+	0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+/* Rotation offsets of the rho step */
+static const uint8_t keccakp_rho_vals[] = {
+	0, 1, 62, 28, 27, 36, 44, 6, 55, 20, 3, 10, 43,
+	25, 39, 41, 45, 15, 21, 8, 18, 2, 61, 56, 14
+};
+
+/*
+ * Lane of the output plane y after theta, rho and pi: the pi step moves the
+ * input lane A(x', x) with x' = (3y + x) mod 5 to the output lane A(x, y).
+ */
+#define KECCAKP_B(s, D, B, x, y)                                               \
+	B[x] = rol(s[A((3 * y + x) % 5, x)] ^ D[(3 * y + x) % 5],              \
+		   keccakp_rho_vals[A((3 * y + x) % 5, x)])
+
+#define KECCAKP_CHI(d, B, x, y)                                                \
+	d[A(x, y)] = B[x] ^ (~B[(x + 1) % 5] & B[(x + 2) % 5])
+
+#define KECCAKP_PLANE(s, d, D, B, y)                                           \
+	do {                                                                   \
+		KECCAKP_B(s, D, B, 0, y);                                      \
+		KECCAKP_B(s, D, B, 1, y);                                      \
+		KECCAKP_B(s, D, B, 2, y);                                      \
+		KECCAKP_B(s, D, B, 3, y);                                      \
+		KECCAKP_B(s, D, B, 4, y);                                      \
+		KECCAKP_CHI(d, B, 0, y);                                       \
+		KECCAKP_CHI(d, B, 1, y);                                       \
+		KECCAKP_CHI(d, B, 2, y);                                       \
+		KECCAKP_CHI(d, B, 3, y);                                       \
+		KECCAKP_CHI(d, B, 4, y);                                       \
+	} while (0)
+
+/*
+ * One Keccak round reading the state s and writing the new state to d. All
+ * steps are merged into one pass over the state which allows the compiler
+ * to keep the lanes in registers.
+ */
+static inline __attribute__((always_inline)) void
+keccakp_round(uint64_t d[25], const uint64_t s[25], unsigned int round)
 {
-	uint64_t C[5], D[5], t;
+	uint64_t B[5], C[5], D[5];
 
-	/* Steps 1 + 2 */
 	C[0] = s[A(0, 0)] ^ s[A(0, 1)] ^ s[A(0, 2)] ^ s[A(0, 3)] ^ s[A(0, 4)];
 	C[1] = s[A(1, 0)] ^ s[A(1, 1)] ^ s[A(1, 2)] ^ s[A(1, 3)] ^ s[A(1, 4)];
 	C[2] = s[A(2, 0)] ^ s[A(2, 1)] ^ s[A(2, 2)] ^ s[A(2, 3)] ^ s[A(2, 4)];
@@ -65,102 +113,157 @@ static inline void keccakp_theta_rho_pi(uint64_t s[25])
 	D[3] = C[2] ^ rol(C[4], 1);
 	D[4] = C[3] ^ rol(C[0], 1);
 
-	/* Step 3 theta and rho and pi */
-	s[A(0, 0)] ^= D[0];
-	t = rol(s[A(4, 4)] ^ D[4], RHO_ROL(11));
-	s[A(4, 4)] = rol(s[A(1, 4)] ^ D[1], RHO_ROL(10));
-	s[A(1, 4)] = rol(s[A(3, 1)] ^ D[3], RHO_ROL(9));
-	s[A(3, 1)] = rol(s[A(1, 3)] ^ D[1], RHO_ROL(8));
-	s[A(1, 3)] = rol(s[A(0, 1)] ^ D[0], RHO_ROL(7));
-	s[A(0, 1)] = rol(s[A(3, 0)] ^ D[3], RHO_ROL(6));
-	s[A(3, 0)] = rol(s[A(3, 3)] ^ D[3], RHO_ROL(5));
-	s[A(3, 3)] = rol(s[A(2, 3)] ^ D[2], RHO_ROL(4));
-	s[A(2, 3)] = rol(s[A(1, 2)] ^ D[1], RHO_ROL(3));
-	s[A(1, 2)] = rol(s[A(2, 1)] ^ D[2], RHO_ROL(2));
-	s[A(2, 1)] = rol(s[A(0, 2)] ^ D[0], RHO_ROL(1));
-	s[A(0, 2)] = rol(s[A(1, 0)] ^ D[1], RHO_ROL(0));
-	s[A(1, 0)] = rol(s[A(1, 1)] ^ D[1], RHO_ROL(23));
-	s[A(1, 1)] = rol(s[A(4, 1)] ^ D[4], RHO_ROL(22));
-	s[A(4, 1)] = rol(s[A(2, 4)] ^ D[2], RHO_ROL(21));
-	s[A(2, 4)] = rol(s[A(4, 2)] ^ D[4], RHO_ROL(20));
-	s[A(4, 2)] = rol(s[A(0, 4)] ^ D[0], RHO_ROL(19));
-	s[A(0, 4)] = rol(s[A(2, 0)] ^ D[2], RHO_ROL(18));
-	s[A(2, 0)] = rol(s[A(2, 2)] ^ D[2], RHO_ROL(17));
-	s[A(2, 2)] = rol(s[A(3, 2)] ^ D[3], RHO_ROL(16));
-	s[A(3, 2)] = rol(s[A(4, 3)] ^ D[4], RHO_ROL(15));
-	s[A(4, 3)] = rol(s[A(3, 4)] ^ D[3], RHO_ROL(14));
-	s[A(3, 4)] = rol(s[A(0, 3)] ^ D[0], RHO_ROL(13));
-	s[A(0, 3)] = rol(s[A(4, 0)] ^ D[4], RHO_ROL(12));
-	s[A(4, 0)] = t;
+	KECCAKP_PLANE(s, d, D, B, 0);
+	KECCAKP_PLANE(s, d, D, B, 1);
+	KECCAKP_PLANE(s, d, D, B, 2);
+	KECCAKP_PLANE(s, d, D, B, 3);
+	KECCAKP_PLANE(s, d, D, B, 4);
+
+	d[A(0, 0)] ^= keccakp_iota_vals[round];
 }
 
-static const uint64_t keccakp_iota_vals[] = {
-	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
-	0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
-	0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
-	0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
-	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
-	0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
-	0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
-	0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
-};
+static inline __attribute__((always_inline)) void
+keccakp_1600_rounds(uint64_t s[25])
+{
+	uint64_t a[25], e[25];
+	unsigned int i, round;
 
-static inline void keccakp_chi_iota(uint64_t s[25], unsigned int round)
+	for (i = 0; i < 25; i++)
+		a[i] = s[i];
+
+	for (round = 0; round < 24; round += 2) {
+		keccakp_round(e, a, round);
+		keccakp_round(a, e, round + 1);
+	}
+
+	for (i = 0; i < 25; i++)
+		s[i] = a[i];
+}
+
+static void keccakp_1600_c(uint64_t s[25])
+{
+	keccakp_1600_rounds(s);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+/* The and-not of chi and the rotations map to ANDN and RORX */
+static __attribute__((target("bmi,bmi2"))) void
+keccakp_1600_bmi(uint64_t s[25])
+{
+	keccakp_1600_rounds(s);
+}
+
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+
+#include <arm_neon.h>
+
+/*
+ * Keccak using the ARMv8.2 SHA3 instructions: EOR3 for the column parity,
+ * RAX1 for the theta effect, XAR for theta and rho, BCAX for chi. Only the
+ * low half of each vector holds a lane.
+ */
+#define KECCAKP_ARMV8_TARGET __attribute__((target("arch=armv8.2-a+sha3")))
+
+#define KECCAKP_XAR(X, x, y, rho)                                              \
+	B[X] = vxarq_u64(a[A(x, y)], D[x], (64 - rho) & 63)
+
+#define KECCAKP_BCAX(d, y)                                                     \
+	do {                                                                   \
+		d[A(0, y)] = vbcaxq_u64(B[0], B[2], B[1]);                     \
+		d[A(1, y)] = vbcaxq_u64(B[1], B[3], B[2]);                     \
+		d[A(2, y)] = vbcaxq_u64(B[2], B[4], B[3]);                     \
+		d[A(3, y)] = vbcaxq_u64(B[3], B[0], B[4]);                     \
+		d[A(4, y)] = vbcaxq_u64(B[4], B[1], B[0]);                     \
+	} while (0)
+
+static inline __attribute__((always_inline)) KECCAKP_ARMV8_TARGET void
+keccakp_round_armv8(uint64x2_t d[25], const uint64x2_t a[25],
+		    unsigned int round)
 {
-	uint64_t t0[5], t1[5];
-
-	t0[0] = s[A(0, 0)];
-	t0[1] = s[A(0, 1)];
-	t0[2] = s[A(0, 2)];
-	t0[3] = s[A(0, 3)];
-	t0[4] = s[A(0, 4)];
-
-	t1[0] = s[A(1, 0)];
-	t1[1] = s[A(1, 1)];
-	t1[2] = s[A(1, 2)];
-	t1[3] = s[A(1, 3)];
-	t1[4] = s[A(1, 4)];
-
-	s[A(0, 0)] ^= ~s[A(1, 0)] & s[A(2, 0)];
-	s[A(0, 0)] ^= keccakp_iota_vals[round];
-	s[A(0, 1)] ^= ~s[A(1, 1)] & s[A(2, 1)];
-	s[A(0, 2)] ^= ~s[A(1, 2)] & s[A(2, 2)];
-	s[A(0, 3)] ^= ~s[A(1, 3)] & s[A(2, 3)];
-	s[A(0, 4)] ^= ~s[A(1, 4)] & s[A(2, 4)];
-
-	s[A(1, 0)] ^= ~s[A(2, 0)] & s[A(3, 0)];
-	s[A(1, 1)] ^= ~s[A(2, 1)] & s[A(3, 1)];
-	s[A(1, 2)] ^= ~s[A(2, 2)] & s[A(3, 2)];
-	s[A(1, 3)] ^= ~s[A(2, 3)] & s[A(3, 3)];
-	s[A(1, 4)] ^= ~s[A(2, 4)] & s[A(3, 4)];
-
-	s[A(2, 0)] ^= ~s[A(3, 0)] & s[A(4, 0)];
-	s[A(2, 1)] ^= ~s[A(3, 1)] & s[A(4, 1)];
-	s[A(2, 2)] ^= ~s[A(3, 2)] & s[A(4, 2)];
-	s[A(2, 3)] ^= ~s[A(3, 3)] & s[A(4, 3)];
-	s[A(2, 4)] ^= ~s[A(3, 4)] & s[A(4, 4)];
-
-	s[A(3, 0)] ^= ~s[A(4, 0)] & t0[0];
-	s[A(3, 1)] ^= ~s[A(4, 1)] & t0[1];
-	s[A(3, 2)] ^= ~s[A(4, 2)] & t0[2];
-	s[A(3, 3)] ^= ~s[A(4, 3)] & t0[3];
-	s[A(3, 4)] ^= ~s[A(4, 4)] & t0[4];
-
-	s[A(4, 0)] ^= ~t0[0] & t1[0];
-	s[A(4, 1)] ^= ~t0[1] & t1[1];
-	s[A(4, 2)] ^= ~t0[2] & t1[2];
-	s[A(4, 3)] ^= ~t0[3] & t1[3];
-	s[A(4, 4)] ^= ~t0[4] & t1[4];
+	uint64x2_t B[5], C[5], D[5];
+	unsigned int x;
+
+	for (x = 0; x < 5; x++) {
+		C[x] = veor3q_u64(veor3q_u64(a[A(x, 0)], a[A(x, 1)],
+					     a[A(x, 2)]),
+				  a[A(x, 3)], a[A(x, 4)]);
+	}
+
+	for (x = 0; x < 5; x++)
+		D[x] = vrax1q_u64(C[(x + 4) % 5], C[(x + 1) % 5]);
+
+	KECCAKP_XAR(0, 0, 0, 0);
+	KECCAKP_XAR(1, 1, 1, 44);
+	KECCAKP_XAR(2, 2, 2, 43);
+	KECCAKP_XAR(3, 3, 3, 21);
+	KECCAKP_XAR(4, 4, 4, 14);
+	KECCAKP_BCAX(d, 0);
+
+	KECCAKP_XAR(0, 3, 0, 28);
+	KECCAKP_XAR(1, 4, 1, 20);
+	KECCAKP_XAR(2, 0, 2, 3);
+	KECCAKP_XAR(3, 1, 3, 45);
+	KECCAKP_XAR(4, 2, 4, 61);
+	KECCAKP_BCAX(d, 1);
+
+	KECCAKP_XAR(0, 1, 0, 1);
+	KECCAKP_XAR(1, 2, 1, 6);
+	KECCAKP_XAR(2, 3, 2, 25);
+	KECCAKP_XAR(3, 4, 3, 8);
+	KECCAKP_XAR(4, 0, 4, 18);
+	KECCAKP_BCAX(d, 2);
+
+	KECCAKP_XAR(0, 4, 0, 27);
+	KECCAKP_XAR(1, 0, 1, 36);
+	KECCAKP_XAR(2, 1, 2, 10);
+	KECCAKP_XAR(3, 2, 3, 15);
+	KECCAKP_XAR(4, 3, 4, 56);
+	KECCAKP_BCAX(d, 3);
+
+	KECCAKP_XAR(0, 2, 0, 62);
+	KECCAKP_XAR(1, 3, 1, 55);
+	KECCAKP_XAR(2, 4, 2, 39);
+	KECCAKP_XAR(3, 0, 3, 41);
+	KECCAKP_XAR(4, 1, 4, 2);
+	KECCAKP_BCAX(d, 4);
+
+	d[A(0, 0)] = veorq_u64(d[A(0, 0)],
+			       vdupq_n_u64(keccakp_iota_vals[round]));
 }
 
-static inline void keccakp_1600(uint64_t s[25])
+static KECCAKP_ARMV8_TARGET void keccakp_1600_armv8(uint64_t s[25])
 {
-	unsigned int round;
+	uint64x2_t a[25], e[25];
+	unsigned int i, round;
+
+	for (i = 0; i < 25; i++)
+		a[i] = vdupq_n_u64(s[i]);
 
-	for (round = 0; round < 24; round++) {
-		keccakp_theta_rho_pi(s);
-		keccakp_chi_iota(s, round);
+	for (round = 0; round < 24; round += 2) {
+		keccakp_round_armv8(e, a, round);
+		keccakp_round_armv8(a, e, round + 1);
 	}
+
+	for (i = 0; i < 25; i++)
+		s[i] = vgetq_lane_u64(a[i], 0);
+}
+
+#endif
+
+static void (*keccakp_1600)(uint64_t s[25]) = keccakp_1600_c;
+
+ESDM_DEFINE_CONSTRUCTOR(keccakp_1600_select)
+{
+	esdm_cpufeatures_init();
+
+#if defined(__x86_64__) && defined(__GNUC__)
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_BMI2))
+		keccakp_1600 = keccakp_1600_bmi;
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+	if (esdm_cpu_has(ESDM_CPU_FEATURE_ARM_SHA3))
+		keccakp_1600 = keccakp_1600_armv8;
+#endif
 }
 
 /*********************************** SHA-3 ************************************/
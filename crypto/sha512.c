@@ -23,6 +23,7 @@
 #include "bitshift_be.h"
 #include "lc_sha512.h"
 #include "memset_secure.h"
+#include "sha2_accel.h"
 #include "visibility.h"
 
 struct lc_hash_state {
@@ -31,7 +32,7 @@ struct lc_hash_state {
 	uint8_t partial[LC_SHA512_SIZE_BLOCK];
 };
 
-static const uint64_t sha512_K[] = {
+const uint64_t sha512_K[] = {
 	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
 	0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
 	0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
@@ -87,8 +88,8 @@ static inline uint64_t ror(uint64_t x, int n)
 #define s0(x) (ror(x, 1) ^ ror(x, 8) ^ (x >> 7))
 #define s1(x) (ror(x, 19) ^ ror(x, 61) ^ (x >> 6))
 
-static inline void sha512_transform(struct lc_hash_state *ctx,
-				    const uint8_t *in)
+static inline void sha512_transform_c(struct lc_hash_state *ctx,
+				      const uint8_t *in)
 {
 	uint64_t W[80], a, b, c, d, e, f, g, h, T1, T2;
 	unsigned int i;
@@ -139,6 +140,18 @@ static inline void sha512_transform(struct lc_hash_state *ctx,
 		W[i] = 0;
 }
 
+static void sha512_transform(struct lc_hash_state *ctx, const uint8_t *in,
+			     size_t blocks)
+{
+	if (sha512_accel_blocks) {
+		sha512_accel_blocks(ctx->H, in, blocks);
+		return;
+	}
+
+	for (; blocks; blocks--, in += LC_SHA512_SIZE_BLOCK)
+		sha512_transform_c(ctx, in);
+}
+
 static void sha512_update(struct lc_hash_state *ctx, const uint8_t *in,
 			  size_t inlen)
 {
@@ -167,13 +180,17 @@ static void sha512_update(struct lc_hash_state *ctx, const uint8_t *in,
 		inlen -= todo;
 		in += todo;
 
-		sha512_transform(ctx, ctx->partial);
+		sha512_transform(ctx, ctx->partial, 1);
 	}
 
 	/* Perform a transformation of full block-size messages */
-	for (; inlen >= LC_SHA512_SIZE_BLOCK;
-	     inlen -= LC_SHA512_SIZE_BLOCK, in += LC_SHA512_SIZE_BLOCK)
-		sha512_transform(ctx, in);
+	if (inlen >= LC_SHA512_SIZE_BLOCK) {
+		size_t blocks = inlen / LC_SHA512_SIZE_BLOCK;
+
+		sha512_transform(ctx, in, blocks);
+		inlen -= blocks * LC_SHA512_SIZE_BLOCK;
+		in += blocks * LC_SHA512_SIZE_BLOCK;
+	}
 
 	/* If we have data left, copy it into the partial block buffer */
 	memcpy(ctx->partial, in, inlen);
@@ -199,7 +216,7 @@ static void sha512_final(struct lc_hash_state *ctx, uint8_t *digest)
 		memset(ctx->partial + partial, 0,
 		       LC_SHA512_SIZE_BLOCK - partial);
 		partial = 0;
-		sha512_transform(ctx, ctx->partial);
+		sha512_transform(ctx, ctx->partial, 1);
 	}
 
 	/* Fill the unused part of the partial buffer with zeros */
@@ -210,7 +227,7 @@ static void sha512_final(struct lc_hash_state *ctx, uint8_t *digest)
 	be64_to_ptr(ctx->partial + (LC_SHA512_SIZE_BLOCK - 8), ctx->msg_len);
 
 	/* Final transformation */
-	sha512_transform(ctx, ctx->partial);
+	sha512_transform(ctx, ctx->partial, 1);
 
 	memset_secure(ctx->partial, 0, LC_SHA512_SIZE_BLOCK);
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/*
+ * Multi-buffer SHA-512 kernel template - this file is included by
+ * sha2_accel.c once per lane count. The including file defines:
+ *
+ * SHA512_MB_LANES: number of messages processed in parallel
+ * SHA512_MB_VEC: name of the vector type to define
+ * SHA512_MB_NAME: name of the kernel function
+ * SHA512_MB_TARGET: function attribute with the instruction set to compile
+ *		     for
+ *
+ * Lane l of every vector processes the message block at
+ * in + l * LC_SHA512_SIZE_BLOCK. The message digest of that block is written
+ * to digests + l * LC_SHA512_SIZE_DIGEST.
+ */
+
+typedef uint64_t SHA512_MB_VEC
+	__attribute__((vector_size(SHA512_MB_LANES * sizeof(uint64_t))));
+
+static SHA512_MB_TARGET void SHA512_MB_NAME(const uint8_t *in,
+					    uint8_t *digests)
+{
+	SHA512_MB_VEC W[16], a, b, c, d, e, f, g, h, T1, T2;
+	unsigned int i, l;
+
+	for (i = 0; i < 16; i++) {
+		for (l = 0; l < SHA512_MB_LANES; l++) {
+			W[i][l] = ptr_to_be64(in + l * LC_SHA512_SIZE_BLOCK +
+					      i * sizeof(uint64_t));
+		}
+	}
+
+	a = (SHA512_MB_VEC){ 0 } + sha512_iv[0];
+	b = (SHA512_MB_VEC){ 0 } + sha512_iv[1];
+	c = (SHA512_MB_VEC){ 0 } + sha512_iv[2];
+	d = (SHA512_MB_VEC){ 0 } + sha512_iv[3];
+	e = (SHA512_MB_VEC){ 0 } + sha512_iv[4];
+	f = (SHA512_MB_VEC){ 0 } + sha512_iv[5];
+	g = (SHA512_MB_VEC){ 0 } + sha512_iv[6];
+	h = (SHA512_MB_VEC){ 0 } + sha512_iv[7];
+
+	for (i = 0; i < 80; i++) {
+		if (i >= 16) {
+			W[i & 15] += SHA512_s1(W[(i - 2) & 15]) +
+				     W[(i - 7) & 15] +
+				     SHA512_s0(W[(i - 15) & 15]);
+		}
+		T1 = h + SHA512_S1(e) + SHA512_CH(e, f, g) + sha512_K[i] +
+		     W[i & 15];
+		T2 = SHA512_S0(a) + SHA512_MAJ(a, b, c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + T1;
+		d = c;
+		c = b;
+		b = a;
+		a = T1 + T2;
+	}
+
+	a += sha512_iv[0];
+	b += sha512_iv[1];
+	c += sha512_iv[2];
+	d += sha512_iv[3];
+	e += sha512_iv[4];
+	f += sha512_iv[5];
+	g += sha512_iv[6];
+	h += sha512_iv[7];
+
+	for (l = 0; l < SHA512_MB_LANES; l++) {
+		be64_to_ptr(digests, a[l]);
+		be64_to_ptr(digests + 8, b[l]);
+		be64_to_ptr(digests + 16, c[l]);
+		be64_to_ptr(digests + 24, d[l]);
+		be64_to_ptr(digests + 32, e[l]);
+		be64_to_ptr(digests + 40, f[l]);
+		be64_to_ptr(digests + 48, g[l]);
+		be64_to_ptr(digests + 56, h[l]);
+		digests += LC_SHA512_SIZE_DIGEST;
+	}
+
+	memset_secure(W, 0, sizeof(W));
+}
@@ -48,4 +48,23 @@ static inline unsigned int cpu_es_multiplier(void)
 
 #endif
 
+#ifndef ESDM_CPU_ES_BULK
+
+#include <stddef.h>
+
+/* Fill the words one by one */
+static inline bool cpu_es_get_bulk(unsigned long *buf, size_t words)
+{
+	size_t i;
+
+	for (i = 0; i < words; i++) {
+		if (!cpu_es_get(&buf[i]))
+			return false;
+	}
+
+	return true;
+}
+
+#endif
+
 #endif /* _CPU_RANDOM */
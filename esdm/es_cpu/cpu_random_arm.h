@@ -22,11 +22,13 @@
 
 #if defined(__aarch64__)
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "bool.h"
 
 #define ESDM_CPU_ES_IMPLEMENTED
+#define ESDM_CPU_ES_BULK
 
 /*
  * https://developer.arm.com/documentation/ddi0595/2021-06/AArch64-Registers/RNDR--Random-Number
@@ -64,6 +66,8 @@
 #define RNDR_INSTR "s3_3_c2_c4_0"
 #define RNDRRS_INSTR "s3_3_c2_c4_1"
 
+#define RNDRRS_RETRY_LOOPS 10
+
 /*
  * Read the feature register ID_AA64ISAR0_EL1
  *
@@ -134,6 +138,27 @@ static inline bool cpu_es_get(unsigned long *buf)
 	return true;
 }
 
+/*
+ * Fill the words with RNDRRS instructions issued back to back. All words
+ * share a retry budget of RNDRRS_RETRY_LOOPS per word.
+ */
+static inline bool cpu_es_get_bulk(unsigned long *buf, size_t words)
+{
+	size_t i = 0, budget = words * RNDRRS_RETRY_LOOPS;
+
+	if (!arm_id_aa64isar0_el1_feature(ARM8_RNDR_FEATURE))
+		return false;
+
+	while (i < words) {
+		if (arm_seed(&buf[i]))
+			i++;
+		else if (!budget--)
+			return false;
+	}
+
+	return true;
+}
+
 static inline unsigned int cpu_es_multiplier(void)
 {
 	return 1;
@@ -22,10 +22,14 @@
 
 #if defined(__x86_64__) || defined(__i386__)
 
+#include <stddef.h>
+
 #include "bool.h"
+#include "cpufeatures.h"
 #include "esdm_logger.h"
 
 #define ESDM_CPU_ES_IMPLEMENTED
+#define ESDM_CPU_ES_BULK
 
 #define RDRAND_RETRY_LOOPS 10
 
@@ -39,72 +43,24 @@
 #define RDSEED_LONG RDSEED_INT
 #endif
 
-#define ECX_RDRAND (1 << 30)
-#define EXT_FEAT_EBX_RDSEED (1 << 18)
-
-#define cpuid_eax(level, a, b, c, d)                                           \
-	__asm__ __volatile__("cpuid\n\t"                                       \
-			     : "=a"(a), "=b"(b), "=c"(c), "=d"(d)              \
-			     : "0"(level))
-
-#define cpuid_eax_ecx(level, count, a, b, c, d)                                \
-	__asm__ __volatile__("cpuid\n\t"                                       \
-			     : "=a"(a), "=b"(b), "=c"(c), "=d"(d)              \
-			     : "0"(level), "2"(count))
-
-static inline int rdseed_available(void)
-{
-	unsigned int eax, ebx, ecx, edx;
-
-	/* Read the maximum leaf */
-	cpuid_eax(0, eax, ebx, ecx, edx);
-
-	/* Only make call if the leaf is present */
-	if (eax >= 7) {
-		/* read advanced features eax = 7, ecx = 0 */
-		cpuid_eax_ecx(7, 0, eax, ebx, ecx, edx);
-
-		return !!(ebx & EXT_FEAT_EBX_RDSEED);
-	}
-	return false;
-}
-
-static inline int rdrand_available(void)
+static inline int cpu_es_x86_rdseed_avail(void)
 {
-	unsigned int eax, ebx, ecx, edx;
-
-	/* Read the maximum leaf */
-	cpuid_eax(0, eax, ebx, ecx, edx);
-
-	/* Only make call if the leaf is present */
-	if (eax >= 1) {
-		cpuid_eax(0x80000000 & 1, eax, ebx, ecx, edx);
-		return !!(ecx & ECX_RDRAND);
-	}
-
-	return false;
+	return esdm_cpu_has(ESDM_CPU_FEATURE_RDSEED);
 }
 
 static inline bool cpu_es_x86_rdseed(unsigned long *buf)
 {
 	unsigned int retry = 0;
 	unsigned char ok;
-	static int rdseed_avail = -1;
 
-	if (rdseed_avail == -1) {
-		rdseed_avail = rdseed_available();
-		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
-			    "RDSEED support %sdetected\n",
-			    rdseed_avail ? "" : "not ");
-	}
-	if (!rdseed_avail)
+	if (!cpu_es_x86_rdseed_avail())
 		return false;
 
 	do {
 		__asm__ __volatile__(RDSEED_LONG "\n\t"
 						 "setc %0"
 				     : "=qm"(ok), "=a"(*buf));
-	} while (!ok && retry++ > RDRAND_RETRY_LOOPS);
+	} while (!ok && retry++ < RDRAND_RETRY_LOOPS);
 
 	return !!ok;
 }
@@ -112,15 +68,8 @@ static inline bool cpu_es_x86_rdseed(unsigned long *buf)
 static inline bool cpu_es_x86_rdrand(unsigned long *buf)
 {
 	int ok;
-	static int rdrand_avail = -1;
 
-	if (rdrand_avail == -1) {
-		rdrand_avail = rdrand_available();
-		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
-			    "RDRAND support %sdetected\n",
-			    rdrand_avail ? "" : "not ");
-	}
-	if (!rdrand_avail)
+	if (!esdm_cpu_has(ESDM_CPU_FEATURE_RDRAND))
 		return false;
 
 	__asm__ __volatile__("1: " RDRAND_LONG "\n\t"
@@ -142,6 +91,36 @@ static inline bool cpu_es_get(unsigned long *buf)
 	return ret;
 }
 
+/*
+ * Fill the words with RDSEED instructions issued back to back. All words share
+ * a retry budget of RDRAND_RETRY_LOOPS per word. Words which RDSEED cannot
+ * deliver within the budget are filled with RDRAND.
+ */
+static inline bool cpu_es_get_bulk(unsigned long *buf, size_t words)
+{
+	size_t i = 0, budget = words * RDRAND_RETRY_LOOPS;
+	unsigned char ok;
+
+	if (cpu_es_x86_rdseed_avail()) {
+		while (i < words) {
+			__asm__ __volatile__(RDSEED_LONG "\n\t"
+							 "setc %0"
+					     : "=qm"(ok), "=a"(buf[i]));
+			if (ok)
+				i++;
+			else if (!budget--)
+				break;
+		}
+	}
+
+	for (; i < words; i++) {
+		if (!cpu_es_x86_rdrand(&buf[i]))
+			return false;
+	}
+
+	return true;
+}
+
 static inline unsigned int cpu_es_multiplier(void)
 {
 	unsigned long v;
@@ -24,6 +24,8 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include "esdm_status_bin.h"
+
 /**
  * @brief esdm_init() - initialize the ESDM library
  *
@@ -61,6 +63,33 @@ int esdm_reinit(void);
  */
 int esdm_init_monitor(void (*priv_init_completion)(void));
 
+/**
+ * @brief esdm_monitor_poll() - perform one pass of the ES monitor
+ *
+ * This call is the cooperative alternative to esdm_init_monitor() for callers
+ * which do not spawn a monitor thread. It polls the entropy sources once,
+ * tries to seed the DRNGs which are not yet fully seeded and returns. The
+ * caller is intended to invoke it periodically, e.g. every second from its
+ * event loop.
+ *
+ * @return: 0 on success, -EAGAIN while the privileged initialization of an
+ *	    entropy source is pending
+ */
+int esdm_monitor_poll(void);
+
+/**
+ * @brief esdm_init_reseeder() - run the DRNG reseeder
+ *
+ * This call is intended to be invoked from a thread. While it runs, a DRNG
+ * requiring a reseed is reseeded by this thread instead of by the thread
+ * requesting random data. This way, the entropy collection does not add to the
+ * latency of requests for random data. The call returns when esdm_fini() is
+ * invoked.
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int esdm_init_reseeder(void);
+
 /**
  * @brief esdm_fini() - finalize the ESDM library and release all resources
  */
@@ -173,10 +202,56 @@ ssize_t esdm_get_random_bytes_pr(uint8_t *buf, size_t nbytes);
  */
 ssize_t esdm_get_random_bytes_pr_noblock(uint8_t *buf, size_t nbytes);
 
+enum esdm_rnd_vec_flags {
+	ESDM_RND_VEC_NORMAL = 0, /**< see esdm_get_random_bytes */
+	ESDM_RND_VEC_FULL = 1, /**< see esdm_get_random_bytes_full */
+	ESDM_RND_VEC_MIN = 2, /**< see esdm_get_random_bytes_min */
+	ESDM_RND_VEC_PR = 3, /**< see esdm_get_random_bytes_pr */
+};
+
+struct esdm_rnd_vec {
+	uint8_t *buf; /**< buffer to store the random bytes */
+	size_t len; /**< size of the buffer */
+	enum esdm_rnd_vec_flags flags; /**< type of random bytes */
+	size_t generated; /**< number of generated bytes set by the ESDM */
+};
+
+/**
+ * @brief esdm_get_random_bytes_vec() - Provider of cryptographic strong
+ * random numbers for a batch of requests.
+ *
+ * All entries except the ones marked with ESDM_RND_VEC_PR are served by the
+ * same DRNG instance where the DRNG lock is only taken once for all entries
+ * that fit into one maximum DRNG request. Before generating random numbers,
+ * the function blocks until the seeding level required by the entry with
+ * the most demanding type is reached where ESDM_RND_VEC_PR entries require a
+ * fully initialized ESDM. The ESDM_RND_VEC_PR entries are served by the
+ * prediction resistance DRNG like esdm_get_random_bytes_pr which implies that
+ * they may be filled only partially or not at all.
+ *
+ * @vec: array of requests
+ * @num: number of entries in vec
+ *
+ * @return: positive number indicates amount of generated bytes of all
+ *	    entries, < 0 on error
+ */
+ssize_t esdm_get_random_bytes_vec(struct esdm_rnd_vec *vec, size_t num);
+
+/**
+ * @brief see esdm_get_random_bytes_vec except that in case of blocking,
+ * it returns -EAGAIN.
+ */
+ssize_t esdm_get_random_bytes_vec_noblock(struct esdm_rnd_vec *vec,
+					  size_t num);
+
+/* Shared with esdm_rpc_client.h - both headers may be included by one user */
+#ifndef ESDM_GET_SEED_FLAGS_DEFINED
+#define ESDM_GET_SEED_FLAGS_DEFINED
 enum esdm_get_seed_flags {
 	ESDM_GET_SEED_NONBLOCK = 0x0001, /**< Do not block the call */
 	ESDM_GET_SEED_FULLY_SEEDED = 0x0002, /**< DRNG is fully seeded */
 };
+#endif
 
 /**
  * @brief esdm_get_seed() - Fill buffer with data from entropy sources
@@ -252,6 +327,31 @@ enum esdm_get_seed_flags {
 ssize_t esdm_get_seed(uint64_t *buf, size_t nbytes,
 		      enum esdm_get_seed_flags flags);
 
+/**
+ * @brief esdm_get_seed_blocks() - Fill multiple independent seed buffers
+ *
+ * This function fills @param num consecutive blocks of @param nbytes each as
+ * documented for esdm_get_seed. Every block is collected independently from
+ * the entropy sources, but all blocks are collected with one acquisition of
+ * the locks of the ESDM.
+ *
+ * With ESDM_GET_SEED_NONBLOCK, the collection ends with the first block for
+ * which no entropy is available. Only the first block can be returned without
+ * entropy.
+ *
+ * @param [out] buf Buffer of @param num * @param nbytes bytes
+ * @param [in] nbytes Size of one block, it must be a multiple of 8 bytes if
+ *		      more than one block is requested
+ * @param [in] num Number of blocks to fill
+ * @param [in] flags Flags field to adjust the behavior
+ *
+ * @return -EINVAL or -EMSGSIZE as documented for esdm_get_seed, -EAGAIN when
+ *	   the call would block, but NONBLOCK is specified, otherwise the number
+ *	   of filled blocks.
+ */
+ssize_t esdm_get_seed_blocks(uint64_t *buf, size_t nbytes, size_t num,
+			     enum esdm_get_seed_flags flags);
+
 /**
  * @brief esdm_status() - Get status information on ESDM
  *
@@ -260,6 +360,33 @@ ssize_t esdm_get_seed(uint64_t *buf, size_t nbytes,
  */
 void esdm_status(char *buf, size_t buflen);
 
+/**
+ * @brief esdm_latency_status() - Get latency percentiles of the DRNG
+ *
+ * The buffer receives an empty string if the ESDM is compiled without the
+ * latency-stats option or if no request was processed yet.
+ *
+ * @param [out] buf Buffer to be filled with the latency information
+ * @param [in] buflen Length of buffer
+ */
+void esdm_latency_status(char *buf, size_t buflen);
+
+/**
+ * @brief esdm_metrics() - Get the ESDM counters in the OpenMetrics format
+ *
+ * The buffer receives the metric families of the DRNG and entropy source
+ * counters without the terminating "# EOF" line, allowing the caller to
+ * append further families. The buffer receives an empty string if the ESDM is
+ * compiled without metrics support. Samples not fitting into the buffer are
+ * discarded.
+ *
+ * @param [out] buf Buffer to be filled with the metrics
+ * @param [in] buflen Length of buffer
+ *
+ * @return length of the string written to the buffer
+ */
+size_t esdm_metrics(char *buf, size_t buflen);
+
 /**
  * @brief esdm_status_machine() - Get status information on ESDM
  *
@@ -271,6 +398,21 @@ struct esdm_status_st {
 };
 void esdm_status_machine(struct esdm_status_st *status);
 
+/**
+ * @brief esdm_status_bin() - Get the binary status of the ESDM
+ *
+ * Contrary to esdm_status, the information is returned in a structure of
+ * fixed size which is cheap to obtain: the status is refreshed at most once
+ * per ESDM_STATUS_BIN_REFRESH_MS, otherwise the cached status is returned.
+ * The state callbacks of the entropy sources are not invoked.
+ *
+ * @param [out] status Buffer to be filled with the status information
+ *
+ * @return: 0 on success, < 0 on error
+ */
+#define ESDM_STATUS_BIN_REFRESH_MS 1000
+int esdm_status_bin(struct esdm_status_bin *status);
+
 /**
  * @brief esdm_version() - Get ESDM version information
  *
@@ -351,6 +493,38 @@ void esdm_pool_set_entropy(uint32_t entropy_bits);
  */
 void esdm_drng_force_reseed(void);
 
+/**
+ * @brief Reseed all DRNGs after a resume from suspend
+ *
+ * If a suspend was signaled before, all DRNGs are reseeded from the entropy
+ * sources in one pass. Generate requests wait for the completion of the pass
+ * for at most ESDM_DRNG_RESUME_GATE_MS milliseconds. Only the first call after
+ * a suspend performs the reseed.
+ *
+ * @return 1 if the DRNGs were reseeded, 0 if no suspend is pending
+ */
+int esdm_drng_resume(void);
+
+/**
+ * @brief Let the calling thread own a DRNG instance
+ *
+ * A thread serving the requests of many consumers, such as an RPC reactor,
+ * allocates its own DRNG. The regular generate requests of the thread are
+ * served from it without taking any lock. The DRNG is seeded from the node
+ * DRNG selected for the thread and inherits its seeding level, thus it is
+ * only used while that node DRNG is fully seeded. In NTG.1 mode, the owned
+ * DRNG is not used. Requests with prediction resistance always use the PR
+ * DRNGs.
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_drng_thread_own(void);
+
+/**
+ * @brief Release the DRNG instance owned by the calling thread
+ */
+void esdm_drng_thread_release(void);
+
 /**
  * @brief Indicator whether the ESDM is operational
  *
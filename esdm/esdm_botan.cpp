@@ -21,11 +21,17 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <cassert>
 #include <botan/hash.h>
 #include <botan/exceptn.h>
+#ifdef ESDM_BOTAN_DRNG_CHACHA20
+#include <botan/chacha_rng.h>
+#else
 #include <botan/hmac_drbg.h>
+#endif
 
+#include "config.h"
 #include "esdm_crypto.h"
 #include "esdm_botan.h"
 #include "esdm_logger.h"
@@ -44,20 +50,33 @@ static uint32_t esdm_botan_hash_digestsize(void *hash)
 	return 512 / 8;
 }
 
+/*
+ * Looking up the hash by name is expensive. Thus, a prototype object is
+ * created once and the hash contexts are copies of it. The prototype is never
+ * updated.
+ */
+static std::unique_ptr<Botan::HashFunction> esdm_botan_hash_prototype;
+static std::once_flag esdm_botan_hash_prototype_once;
+
+static std::unique_ptr<Botan::HashFunction> esdm_botan_hash_create(void)
+{
+	std::call_once(esdm_botan_hash_prototype_once, []() {
+		esdm_botan_hash_prototype =
+			Botan::HashFunction::create(DEFAULT_BOTAN_HASH);
+	});
+
+	if (esdm_botan_hash_prototype)
+		return esdm_botan_hash_prototype->copy_state();
+
+	return Botan::HashFunction::create_or_throw(DEFAULT_BOTAN_HASH);
+}
+
 static int esdm_botan_hash_init(void *hash)
 {
 	struct esdm_botan_hash_ctx *ctx =
 		reinterpret_cast<esdm_botan_hash_ctx *>(hash);
 
-	try {
-		ctx->hash_fn = Botan::HashFunction::create_or_throw(
-			DEFAULT_BOTAN_HASH);
-	} catch (const Botan::Lookup_Error &ex) {
-		esdm_logger(LOGGER_ERR, LOGGER_C_MD,
-			    "Botan::HashFunction::create() failed %s\n",
-			    ex.what());
-		return -EFAULT;
-	}
+	ctx->hash_fn->clear();
 
 	return 0;
 }
@@ -92,6 +111,16 @@ static int esdm_botan_hash_alloc(void **hash)
 	if (!tmp)
 		return -ENOMEM;
 
+	try {
+		tmp->hash_fn = esdm_botan_hash_create();
+	} catch (const Botan::Exception &ex) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_MD,
+			    "Botan::HashFunction::create() failed %s\n",
+			    ex.what());
+		delete tmp;
+		return -EFAULT;
+	}
+
 	*ctx = tmp;
 
 	return 0;
@@ -113,7 +142,11 @@ static const char *esdm_botan_hash_name(void)
 
 static void esdm_botan_hash_desc_zero(void *hash)
 {
-	(void)hash;
+	struct esdm_botan_hash_ctx *ctx =
+		reinterpret_cast<esdm_botan_hash_ctx *>(hash);
+
+	if (ctx && ctx->hash_fn)
+		ctx->hash_fn->clear();
 }
 
 static int esdm_botan_hash_selftest(void)
@@ -157,8 +190,14 @@ const struct esdm_hash_cb esdm_botan_hash_cb = {
 	.hash_dealloc = esdm_botan_hash_dealloc,
 };
 
+#ifdef ESDM_BOTAN_DRNG_CHACHA20
+typedef Botan::ChaCha_RNG esdm_botan_drng_t;
+#else
+typedef Botan::HMAC_DRBG esdm_botan_drng_t;
+#endif
+
 struct esdm_botan_drng_state {
-	std::unique_ptr<Botan::HMAC_DRBG> drbg;
+	std::unique_ptr<esdm_botan_drng_t> drbg;
 };
 
 static int esdm_botan_drbg_seed(void *drng, const uint8_t *inbuf,
@@ -178,7 +217,13 @@ static ssize_t esdm_botan_drbg_generate(void *drng, uint8_t *outbuf,
 	struct esdm_botan_drng_state *state =
 		reinterpret_cast<esdm_botan_drng_state *>(drng);
 
-	state->drbg->randomize(outbuf, outbuflen);
+	try {
+		state->drbg->randomize(outbuf, outbuflen);
+	} catch (const Botan::Exception &ex) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_DRNG,
+			    "Botan DRNG generate failed %s\n", ex.what());
+		return -EFAULT;
+	}
 
 	return (ssize_t)outbuflen;
 }
@@ -201,7 +246,11 @@ static int esdm_botan_drbg_alloc(void **drng, uint32_t sec_strength)
 	if (!state)
 		return -ENOMEM;
 
+#ifdef ESDM_BOTAN_DRNG_CHACHA20
+	state->drbg.reset(new Botan::ChaCha_RNG());
+#else
 	state->drbg.reset(new Botan::HMAC_DRBG("SHA-512"));
+#endif
 
 	*drng = state;
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY, "DRBG core allocated\n");
@@ -229,9 +278,69 @@ static void esdm_botan_drbg_dealloc(void *drng)
 
 static const char *esdm_botan_drbg_name(void)
 {
+#ifdef ESDM_BOTAN_DRNG_CHACHA20
+	return "Botan ChaCha20 DRNG";
+#else
 	return "Botan SP800-90A DRBG";
+#endif
 }
 
+#ifdef ESDM_BOTAN_DRNG_CHACHA20
+
+/*
+ * No known-answer vectors exist for the Botan ChaCha RNG: verify that two
+ * instances seeded identically are deterministic and that a reseed changes
+ * the output.
+ */
+static int esdm_botan_drbg_selftest(void)
+{
+	static const uint8_t seed[] = {
+		0xBF, 0x26, 0x84, 0xC8, 0xA6, 0x9E, 0x68, 0x6E, 0xAE, 0x68,
+		0x25, 0x1F, 0x33, 0x26, 0xBA, 0x4F, 0xB0, 0x82, 0x05, 0x0C,
+		0x08, 0xCF, 0x26, 0x3D, 0xA6, 0x62, 0x3F, 0x4F, 0x4C, 0x44,
+		0x7F, 0x71
+	};
+	uint8_t act1[64], act2[sizeof(act1)], act3[sizeof(act1)];
+	void *drng1 = NULL, *drng2 = NULL;
+	int ret;
+
+	CKINT(esdm_botan_drbg_alloc(&drng1, 256));
+	CKINT(esdm_botan_drbg_alloc(&drng2, 256));
+	CKINT(esdm_botan_drbg_seed(drng1, seed, sizeof(seed)));
+	CKINT(esdm_botan_drbg_seed(drng2, seed, sizeof(seed)));
+
+	if (esdm_botan_drbg_generate(drng1, act1, sizeof(act1)) !=
+		    sizeof(act1) ||
+	    esdm_botan_drbg_generate(drng2, act2, sizeof(act2)) !=
+		    sizeof(act2)) {
+		ret = -EFAULT;
+		goto out;
+	}
+	if (memcmp(act1, act2, sizeof(act1))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	CKINT(esdm_botan_drbg_seed(drng2, seed, sizeof(seed)));
+	if (esdm_botan_drbg_generate(drng1, act2, sizeof(act2)) !=
+		    sizeof(act2) ||
+	    esdm_botan_drbg_generate(drng2, act3, sizeof(act3)) !=
+		    sizeof(act3)) {
+		ret = -EFAULT;
+		goto out;
+	}
+	if (!memcmp(act1, act2, sizeof(act1)) ||
+	    !memcmp(act2, act3, sizeof(act2)))
+		ret = -EFAULT;
+
+out:
+	esdm_botan_drbg_dealloc(drng1);
+	esdm_botan_drbg_dealloc(drng2);
+	return ret;
+}
+
+#else /* ESDM_BOTAN_DRNG_CHACHA20 */
+
 static int esdm_botan_drbg_selftest(void)
 {
 	static const uint8_t ent_nonce[] = {
@@ -289,6 +398,8 @@ out:
 	return ret;
 }
 
+#endif /* ESDM_BOTAN_DRNG_CHACHA20 */
+
 const struct esdm_drng_cb esdm_botan_drbg_cb = {
 	.drng_name = esdm_botan_drbg_name,
 	.drng_selftest = esdm_botan_drbg_selftest,
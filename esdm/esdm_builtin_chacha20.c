@@ -20,35 +20,94 @@
  */
 
 #include <errno.h>
+#include <stdlib.h>
 
+#include "atomic.h"
 #include "conv_be_le.h"
 #include "esdm_crypto.h"
 #include "lc_chacha20_drng.h"
 #include "lc_chacha20_private.h"
 #include "esdm_builtin_chacha20.h"
 #include "esdm_logger.h"
+#include "mutex.h"
 
-static int esdm_chacha20_seed(void *drng, const uint8_t *inbuf, size_t inbuflen)
+/*
+ * Number of ChaCha20 blocks handed out with one key: generate operations
+ * reserve a range of blocks and generate them concurrently. The thread finding
+ * the blocks exhausted updates the key which provides the backtracking
+ * resistance for all blocks handed out with the previous key.
+ */
+#define ESDM_CC20_EPOCH_BLOCKS 1024
+
+struct esdm_chacha20 {
+	struct lc_chacha20_drng_ctx *cc20;
+	/* Reader: generate, writer: seed and key update */
+	mutex_t lock;
+	/* Next block to be handed out with the current key */
+	atomic_t next_block;
+};
+
+int esdm_chacha20_seed(void *drng, const uint8_t *inbuf, size_t inbuflen)
 {
-	struct lc_chacha20_drng_ctx *cc20 = (struct lc_chacha20_drng_ctx *)drng;
+	struct esdm_chacha20 *state = (struct esdm_chacha20 *)drng;
+
+	mutex_lock(&state->lock);
+	if (atomic_read(&state->next_block))
+		lc_cc20_drng_rekey(state->cc20,
+				   (uint32_t)atomic_read(&state->next_block));
+	lc_cc20_drng_seed(state->cc20, inbuf, inbuflen);
+	atomic_set(&state->next_block, 0);
+	mutex_unlock(&state->lock);
 
-	lc_cc20_drng_seed(cc20, inbuf, inbuflen);
 	return 0;
 }
 
-static ssize_t esdm_chacha20_generate(void *drng, uint8_t *outbuf,
-				      size_t outbuflen)
+ssize_t esdm_chacha20_generate(void *drng, uint8_t *outbuf, size_t outbuflen)
 {
-	struct lc_chacha20_drng_ctx *cc20 = (struct lc_chacha20_drng_ctx *)drng;
+	struct esdm_chacha20 *state = (struct esdm_chacha20 *)drng;
+	uint32_t blocks = (uint32_t)((outbuflen + LC_CC20_BLOCK_SIZE - 1) /
+				     LC_CC20_BLOCK_SIZE);
+
+	/* Requests larger than the epoch are served by the entire state */
+	if (blocks > ESDM_CC20_EPOCH_BLOCKS) {
+		mutex_lock(&state->lock);
+		lc_cc20_drng_rekey(state->cc20,
+				   (uint32_t)atomic_read(&state->next_block));
+		lc_cc20_drng_generate(state->cc20, outbuf, outbuflen);
+		atomic_set(&state->next_block, 0);
+		mutex_unlock(&state->lock);
+
+		return (ssize_t)outbuflen;
+	}
+
+	while (1) {
+		uint32_t end;
+
+		mutex_reader_lock(&state->lock);
+		end = (uint32_t)atomic_add(&state->next_block, (int)blocks);
+		if (end <= ESDM_CC20_EPOCH_BLOCKS) {
+			lc_cc20_drng_generate_at(state->cc20, end - blocks,
+						 outbuf, outbuflen);
+			mutex_reader_unlock(&state->lock);
 
-	lc_cc20_drng_generate(cc20, outbuf, outbuflen);
-	return (int)outbuflen;
+			return (ssize_t)outbuflen;
+		}
+		mutex_reader_unlock(&state->lock);
+
+		/* The blocks are exhausted, update the key unless done so */
+		mutex_lock(&state->lock);
+		if (atomic_read(&state->next_block) > ESDM_CC20_EPOCH_BLOCKS) {
+			lc_cc20_drng_rekey(state->cc20, ESDM_CC20_EPOCH_BLOCKS);
+			atomic_set(&state->next_block, 0);
+		}
+		mutex_unlock(&state->lock);
+	}
 }
 
 static int esdm_chacha20_alloc(void **drng, uint32_t sec_strength)
 {
-	struct lc_chacha20_drng_ctx **cc20 =
-		(struct lc_chacha20_drng_ctx **)drng;
+	struct esdm_chacha20 *state;
+	int ret;
 
 	if (sec_strength > LC_CC20_KEY_SIZE) {
 		esdm_logger(
@@ -63,14 +122,33 @@ static int esdm_chacha20_alloc(void **drng, uint32_t sec_strength)
 			"Security strength of ChaCha20 DRNG (%u bits) higher than requested by ESDM (%u bits)\n",
 			LC_CC20_KEY_SIZE * 8, sec_strength * 8);
 
-	return lc_cc20_drng_alloc(cc20);
+	state = calloc(1, sizeof(struct esdm_chacha20));
+	if (!state)
+		return -ENOMEM;
+
+	ret = lc_cc20_drng_alloc(&state->cc20);
+	if (ret) {
+		free(state);
+		return ret;
+	}
+
+	mutex_init(&state->lock, 0);
+	atomic_set(&state->next_block, 0);
+	*drng = state;
+
+	return 0;
 }
 
 static void esdm_chacha20_dealloc(void *drng)
 {
-	struct lc_chacha20_drng_ctx *cc20 = (struct lc_chacha20_drng_ctx *)drng;
+	struct esdm_chacha20 *state = (struct esdm_chacha20 *)drng;
+
+	if (!state)
+		return;
 
-	lc_cc20_drng_zero_free(cc20);
+	lc_cc20_drng_zero_free(state->cc20);
+	mutex_destroy(&state->lock);
+	free(state);
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
 		    "ChaCha20 core zeroized and freed\n");
 }
@@ -170,6 +248,11 @@ static int esdm_chacha20_drng_selftest(void)
 	/* Generate with zero state */
 	chacha20_state->counter = 0;
 
+	/* Generate from a reserved block range with zero state */
+	lc_cc20_drng_generate_at(cc20_ctx, 0, outbuf, sizeof(expected_block));
+	if (memcmp(outbuf, expected_block, sizeof(expected_block)))
+		return -EFAULT;
+
 	lc_cc20_drng_generate(cc20_ctx, outbuf, sizeof(expected_block));
 	if (memcmp(outbuf, expected_block, sizeof(expected_block)))
 		return -EFAULT;
@@ -205,4 +288,5 @@ const struct esdm_drng_cb esdm_builtin_chacha20_cb = {
 	.drng_dealloc = esdm_chacha20_dealloc,
 	.drng_seed = esdm_chacha20_seed,
 	.drng_generate = esdm_chacha20_generate,
+	.drng_concurrent = true,
 };
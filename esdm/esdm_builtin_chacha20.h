@@ -22,6 +22,12 @@
 #ifndef _ESDM_BUILTIN_CHACHA20_H
 #define _ESDM_BUILTIN_CHACHA20_H
 
+#include "esdm_crypto.h"
+
 extern const struct esdm_drng_cb esdm_builtin_chacha20_cb;
 
+/* Called directly with ESDM_CRYPTO_STATIC_DISPATCH */
+int esdm_chacha20_seed(void *drng, const uint8_t *inbuf, size_t inbuflen);
+ssize_t esdm_chacha20_generate(void *drng, uint8_t *outbuf, size_t outbuflen);
+
 #endif /* _ESDM_BUILTIN_CHACHA20_H */
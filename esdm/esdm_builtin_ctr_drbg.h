@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef _ESDM_BUILTIN_CTR_DRBG_H
+#define _ESDM_BUILTIN_CTR_DRBG_H
+
+#include "esdm_crypto.h"
+
+extern const struct esdm_drng_cb esdm_builtin_ctr_drbg_cb;
+
+/* Called directly with ESDM_CRYPTO_STATIC_DISPATCH */
+int esdm_ctr_drbg_seed(void *drng, const uint8_t *inbuf, size_t inbuflen);
+ssize_t esdm_ctr_drbg_generate(void *drng, uint8_t *outbuf, size_t outbuflen);
+
+#endif /* _ESDM_BUILTIN_CTR_DRBG_H */
@@ -26,16 +26,14 @@
 #include "esdm_builtin_hash_drbg.h"
 #include "esdm_logger.h"
 
-static int esdm_hash_drbg_seed(void *drng, const uint8_t *inbuf,
-			       size_t inbuflen)
+int esdm_hash_drbg_seed(void *drng, const uint8_t *inbuf, size_t inbuflen)
 {
 	struct lc_drbg_state *drbg = (struct lc_drbg_state *)drng;
 
 	return lc_drbg_seed(drbg, inbuf, inbuflen, NULL, 0);
 }
 
-static ssize_t esdm_hash_drbg_generate(void *drng, uint8_t *outbuf,
-				       size_t outbuflen)
+ssize_t esdm_hash_drbg_generate(void *drng, uint8_t *outbuf, size_t outbuflen)
 {
 	struct lc_drbg_state *drbg = (struct lc_drbg_state *)drng;
 
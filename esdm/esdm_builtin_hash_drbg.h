@@ -22,6 +22,12 @@
 #ifndef _ESDM_BUILTIN_HASH_DRBG_H
 #define _ESDM_BUILTIN_HASH_DRBG_H
 
+#include "esdm_crypto.h"
+
 extern const struct esdm_drng_cb esdm_builtin_hash_drbg_cb;
 
+/* Called directly with ESDM_CRYPTO_STATIC_DISPATCH */
+int esdm_hash_drbg_seed(void *drng, const uint8_t *inbuf, size_t inbuflen);
+ssize_t esdm_hash_drbg_generate(void *drng, uint8_t *outbuf, size_t outbuflen);
+
 #endif /* _ESDM_BUILTIN_HASH_DRBG_H */
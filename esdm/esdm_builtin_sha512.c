@@ -35,7 +35,7 @@ static uint32_t esdm_sha512_hash_digestsize(void *hash)
 	return (uint32_t)lc_hash_digestsize(hash_ctx);
 }
 
-static int esdm_sha512_hash_init(void *hash)
+int esdm_sha512_hash_init(void *hash)
 {
 	struct lc_hash_ctx *hash_ctx = (struct lc_hash_ctx *)hash;
 
@@ -51,8 +51,7 @@ static int esdm_sha512_hash_init(void *hash)
 	return 0;
 }
 
-static int esdm_sha512_hash_update(void *hash, const uint8_t *inbuf,
-				   size_t inbuflen)
+int esdm_sha512_hash_update(void *hash, const uint8_t *inbuf, size_t inbuflen)
 {
 	struct lc_hash_ctx *hash_ctx = (struct lc_hash_ctx *)hash;
 
@@ -60,7 +59,7 @@ static int esdm_sha512_hash_update(void *hash, const uint8_t *inbuf,
 	return 0;
 }
 
-static int esdm_sha512_hash_final(void *hash, uint8_t *digest)
+int esdm_sha512_hash_final(void *hash, uint8_t *digest)
 {
 	struct lc_hash_ctx *hash_ctx = (struct lc_hash_ctx *)hash;
 
@@ -22,6 +22,13 @@
 #ifndef _ESDM_BUILTIN_SHA512_H
 #define _ESDM_BUILTIN_SHA512_H
 
+#include "esdm_crypto.h"
+
 extern const struct esdm_hash_cb esdm_builtin_sha512_cb;
 
+/* Called directly with ESDM_CRYPTO_STATIC_DISPATCH */
+int esdm_sha512_hash_init(void *hash);
+int esdm_sha512_hash_update(void *hash, const uint8_t *inbuf, size_t inbuflen);
+int esdm_sha512_hash_final(void *hash, uint8_t *digest);
+
 #endif /* _ESDM_BUILTIN_SHA512_H */
@@ -18,6 +18,8 @@
  * DAMAGE.
  */
 
+#include <errno.h>
+
 #include "build_bug_on.h"
 #include "config.h"
 #include "esdm_config.h"
@@ -29,6 +31,7 @@
 #include "fips.h"
 #include "helper.h"
 #include "esdm_logger.h"
+#include "mutex.h"
 #include "visibility.h"
 
 struct esdm_config {
@@ -39,9 +42,23 @@ struct esdm_config {
 	uint32_t esdm_es_sched_entropy_rate_bits;
 	uint32_t esdm_es_hwrand_entropy_rate_bits;
 	uint32_t esdm_es_jent_kernel_entropy_rate_bits;
+	uint32_t esdm_es_upstream_entropy_rate_bits;
+	uint32_t esdm_es_synth_entropy_rate_bits;
+	uint32_t esdm_es_synth_latency_us;
+	uint32_t esdm_es_synth_seed;
 	uint32_t esdm_drng_max_wo_reseed;
 	uint32_t esdm_drng_max_wo_reseed_bits;
 	uint32_t esdm_max_nodes;
+	uint32_t esdm_drng_max_reqsize;
+	uint32_t esdm_drng_small_reqsize;
+	bool esdm_drng_cpu_affine;
+	bool esdm_drng_autotune;
+	bool esdm_cpu_class_placement;
+	uint32_t esdm_shard;
+	uint32_t esdm_shards;
+	const char *esdm_seed_file;
+	bool esdm_seed_file_credit;
+	uint32_t esdm_es_collect_timeout_ms;
 	enum esdm_config_force_fips force_fips;
 
 	bool esdm_es_irq_retry;
@@ -93,6 +110,19 @@ static struct esdm_config esdm_config = {
 	*/
 	.esdm_es_jent_kernel_entropy_rate_bits = ESDM_JENT_KERNEL_ENTROPY_RATE,
 
+	/*
+	 * See documentation of ESDM_UPSTREAM_ENTROPY_RATE
+	 */
+	.esdm_es_upstream_entropy_rate_bits = ESDM_UPSTREAM_ENTROPY_RATE,
+
+	/*
+	 * See documentation of ESDM_SYNTH_ENTROPY_RATE, ESDM_SYNTH_LATENCY_US
+	 * and ESDM_SYNTH_SEED
+	 */
+	.esdm_es_synth_entropy_rate_bits = ESDM_SYNTH_ENTROPY_RATE,
+	.esdm_es_synth_latency_us = ESDM_SYNTH_LATENCY_US,
+	.esdm_es_synth_seed = ESDM_SYNTH_SEED,
+
 	/*
 	 * See documentation of ESDM_DRNG_MAX_WITHOUT_RESEED.
 	 */
@@ -104,9 +134,41 @@ static struct esdm_config esdm_config = {
 	.esdm_drng_max_wo_reseed_bits = ESDM_DRNG_MAX_RESEED_BITS,
 
 	/*
-	 * Upper limit of DRNG nodes
+	 * Upper limit of DRNG nodes - the tiny footprint operates one DRNG
 	 */
+#ifdef ESDM_TINY_FOOTPRINT
+	.esdm_max_nodes = 1,
+#else
 	.esdm_max_nodes = UINT32_MAX,
+#endif
+
+	/* DRNG request size - 0 selects the size suitable for the DRNG */
+	.esdm_drng_max_reqsize = 0,
+
+	/* One DRNG per node serves requests of all sizes */
+	.esdm_drng_small_reqsize = 0,
+
+	/* Keep the thread on its CPU while generating from the node DRNG */
+	.esdm_drng_cpu_affine = false,
+
+	/* Use the DRNG selected at compile time */
+	.esdm_drng_autotune = false,
+
+	/* Do not bind threads to a class of CPU cores */
+	.esdm_cpu_class_placement = false,
+
+	/* No shard of a sharded ESDM server */
+	.esdm_shard = 0,
+	.esdm_shards = 0,
+
+	/* Seed file - the empty string disables it */
+	.esdm_seed_file = ESDM_SEED_FILE,
+
+	/* Do not credit entropy to the seed file */
+	.esdm_seed_file_credit = false,
+
+	/* Collect the entropy sources one after another */
+	.esdm_es_collect_timeout_ms = 0,
 
 	/* Shall the FIPS mode be forcefully set/unset? */
 	.force_fips = esdm_config_force_fips_unset,
@@ -117,10 +179,88 @@ static struct esdm_config esdm_config = {
 	/* Retry to access the Sched ES during initialization */
 	.esdm_es_sched_retry = false,
 
-	/* Enable the Jitter RNG buffer filling */
+	/* Enable the Jitter RNG buffer filling unless no threads are wanted */
+#ifdef ESDM_TINY_FOOTPRINT
+	.esdm_jent_entropy_async_enable = false,
+#else
 	.esdm_jent_entropy_async_enable = true,
+#endif
 };
 
+/*
+ * A reconfiguration builds the complete snapshot first and only then copies it
+ * into the published snapshot while the sequence count is odd. Readers never
+ * use a snapshot copied while the sequence count changed.
+ */
+static DEFINE_MUTEX_UNLOCKED(esdm_config_snap_lock);
+static bool esdm_config_initialized = false;
+struct esdm_config_snapshot_seq esdm_config_snap = { .seq = 0 };
+
+static int esdm_config_fips_calc(void)
+{
+	/* FIPS 140 mode can only be set with FIPS-140 compile time option */
+#ifdef ESDM_FIPS140
+	if (esdm_config.force_fips == esdm_config_force_fips_unset)
+		return fips_enabled();
+	return (esdm_config.force_fips >= esdm_config_force_fips_enabled);
+#else
+	return false;
+#endif
+}
+
+static int esdm_config_sp80090c_calc(void)
+{
+	/* SP800-90C mode can only be set with SP800-90C compile-time option */
+#ifdef ESDM_OVERSAMPLE_ENTROPY_SOURCES
+	if (esdm_config.force_fips == esdm_config_force_fips_unset)
+		return fips_enabled();
+
+	/* SP800-90C is always enabled if FIPS-140 mode is enabled */
+	return (esdm_config.force_fips >= esdm_config_force_sp80090c_enabled);
+#else
+	return false;
+#endif
+}
+
+/* Publish a snapshot of the current configuration */
+void esdm_config_snapshot_publish(void)
+{
+	struct esdm_config_snapshot snap = { 0 };
+	uint32_t seq;
+
+	mutex_lock(&esdm_config_snap_lock);
+
+	snap.max_nodes = esdm_config.esdm_max_nodes;
+	snap.drng_max_reqsize = esdm_config.esdm_drng_max_reqsize;
+	snap.drng_small_reqsize = esdm_config.esdm_drng_small_reqsize;
+	snap.drng_max_wo_reseed = esdm_config.esdm_drng_max_wo_reseed;
+	snap.drng_max_wo_reseed_bits = esdm_config.esdm_drng_max_wo_reseed_bits;
+	snap.drng_cpu_affine = esdm_config.esdm_drng_cpu_affine;
+	snap.jent_async_enabled = esdm_config.esdm_jent_entropy_async_enable;
+#ifdef ESDM_AIS2031_NTG1_SEEDING_STRATEGY
+	snap.ntg1_2024_compliant = true;
+#endif
+
+	/* Do not derive the settings of the system before the initialization */
+	snap.derived = esdm_config_initialized;
+	if (snap.derived) {
+		snap.online_nodes = min_uint32(esdm_online_nodes(),
+					       esdm_config.esdm_max_nodes);
+		snap.fips_enabled = !!esdm_config_fips_calc();
+		snap.sp80090c_compliant = !!esdm_config_sp80090c_calc();
+	}
+
+	seq = __atomic_load_n(&esdm_config_snap.seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&esdm_config_snap.seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(&esdm_config_snap.snap, &snap, sizeof(snap));
+
+	__atomic_store_n(&esdm_config_snap.seq, seq + 2, __ATOMIC_RELEASE);
+
+	mutex_unlock(&esdm_config_snap_lock);
+}
+
 static uint32_t esdm_config_entropy_rate_max(uint32_t val)
 {
 	return min_uint32(ESDM_DRNG_SECURITY_STRENGTH_BITS, val);
@@ -157,13 +297,29 @@ void esdm_config_es_jent_entropy_rate_set(uint32_t ent)
 DSO_PUBLIC
 uint32_t esdm_config_es_jent_async_enabled(void)
 {
-	return esdm_config.esdm_jent_entropy_async_enable;
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.jent_async_enabled;
 }
 
 DSO_PUBLIC
 void esdm_config_es_jent_async_enabled_set(int setting)
 {
 	esdm_config.esdm_jent_entropy_async_enable = !!setting;
+	esdm_config_snapshot_publish();
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_es_collect_timeout(void)
+{
+	return esdm_config.esdm_es_collect_timeout_ms;
+}
+
+DSO_PUBLIC
+void esdm_config_es_collect_timeout_set(uint32_t ms)
+{
+	esdm_config.esdm_es_collect_timeout_ms = ms;
 }
 
 DSO_PUBLIC
@@ -281,42 +437,249 @@ void esdm_config_es_jent_kernel_entropy_rate_set(uint32_t ent)
 	esdm_es_add_entropy();
 }
 
+DSO_PUBLIC
+uint32_t esdm_config_es_upstream_entropy_rate(void)
+{
+	return esdm_config.esdm_es_upstream_entropy_rate_bits;
+}
+
+DSO_PUBLIC
+void esdm_config_es_upstream_entropy_rate_set(uint32_t ent)
+{
+	uint32_t val = esdm_config_entropy_rate_max(ent);
+
+	esdm_config.esdm_es_upstream_entropy_rate_bits = val;
+	esdm_es_add_entropy();
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_es_synth_entropy_rate(void)
+{
+	return esdm_config.esdm_es_synth_entropy_rate_bits;
+}
+
+DSO_PUBLIC
+void esdm_config_es_synth_entropy_rate_set(uint32_t ent)
+{
+	uint32_t val = esdm_config_entropy_rate_max(ent);
+
+	esdm_config.esdm_es_synth_entropy_rate_bits = val;
+	esdm_es_add_entropy();
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_es_synth_latency_us(void)
+{
+	return esdm_config.esdm_es_synth_latency_us;
+}
+
+DSO_PUBLIC
+void esdm_config_es_synth_latency_us_set(uint32_t latency_us)
+{
+	esdm_config.esdm_es_synth_latency_us = latency_us;
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_es_synth_seed(void)
+{
+	return esdm_config.esdm_es_synth_seed;
+}
+
+DSO_PUBLIC
+void esdm_config_es_synth_seed_set(uint32_t seed)
+{
+	esdm_config.esdm_es_synth_seed = seed;
+}
+
 DSO_PUBLIC
 uint32_t esdm_config_drng_max_wo_reseed(void)
 {
+	struct esdm_config_snapshot snap;
+
 	/* If DRNG operated without proper reseed for too long, block ESDM */
 	BUILD_BUG_ON(ESDM_DRNG_MAX_WITHOUT_RESEED < ESDM_DRNG_RESEED_THRESH);
-	return esdm_config.esdm_drng_max_wo_reseed;
+	esdm_config_snapshot(&snap);
+	return snap.drng_max_wo_reseed;
 }
 
 DSO_PUBLIC
 uint32_t esdm_config_drng_max_wo_reseed_bits(void)
 {
+	struct esdm_config_snapshot snap;
+
 	/* If DRNG operated without proper reseed for too long, block ESDM */
 	BUILD_BUG_ON(ESDM_DRNG_MAX_RESEED_BITS < ESDM_DRNG_RESEED_THRESH_BITS);
-	return esdm_config.esdm_drng_max_wo_reseed_bits;
+	esdm_config_snapshot(&snap);
+	return snap.drng_max_wo_reseed_bits;
 }
 
 DSO_PUBLIC
 uint32_t esdm_config_max_nodes(void)
 {
-	return esdm_config.esdm_max_nodes;
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.max_nodes;
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_drng_max_reqsize(void)
+{
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.drng_max_reqsize;
+}
+
+DSO_PUBLIC
+void esdm_config_drng_max_reqsize_set(uint32_t val)
+{
+	if (val) {
+		val = max_uint32(val, ESDM_DRNG_SECURITY_STRENGTH_BYTES);
+		val = min_uint32(val, ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	}
+	esdm_config.esdm_drng_max_reqsize = val;
+	esdm_config_snapshot_publish();
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_drng_small_reqsize(void)
+{
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.drng_small_reqsize;
+}
+
+DSO_PUBLIC
+void esdm_config_drng_small_reqsize_set(uint32_t val)
+{
+#ifdef ESDM_TINY_FOOTPRINT
+	/* The tiny footprint does not allocate a second DRNG instance */
+	(void)val;
+#else
+	esdm_config.esdm_drng_small_reqsize =
+		min_uint32(val, ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	esdm_config_snapshot_publish();
+#endif
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_drng_cpu_affine(void)
+{
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.drng_cpu_affine;
+}
+
+DSO_PUBLIC
+void esdm_config_drng_cpu_affine_set(int setting)
+{
+	esdm_config.esdm_drng_cpu_affine = !!setting;
+	esdm_config_snapshot_publish();
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_drng_autotune(void)
+{
+	return esdm_config.esdm_drng_autotune;
+}
+
+DSO_PUBLIC
+void esdm_config_drng_autotune_set(int setting)
+{
+	esdm_config.esdm_drng_autotune = !!setting;
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_cpu_class_placement(void)
+{
+	return esdm_config.esdm_cpu_class_placement;
+}
+
+DSO_PUBLIC
+void esdm_config_cpu_class_placement_set(int setting)
+{
+	esdm_config.esdm_cpu_class_placement = !!setting;
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_shard(void)
+{
+	return esdm_config.esdm_shard;
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_shards(void)
+{
+	return esdm_config.esdm_shards;
+}
+
+DSO_PUBLIC
+int esdm_config_shard_set(uint32_t shard, uint32_t shards)
+{
+	if (!shards || shard >= shards)
+		return -EINVAL;
+
+	esdm_config.esdm_shard = shard;
+	esdm_config.esdm_shards = shards;
+
+	/* One DRNG instance for each CPU of the block served by the shard */
+#ifndef ESDM_TINY_FOOTPRINT
+	esdm_config.esdm_max_nodes =
+		max_uint32((esdm_online_nodes() + shards - 1) / shards, 1);
+#endif
+
+	/* The seed file belongs to the ESDM server seeding the shards */
+	esdm_config.esdm_seed_file = "";
+
+	esdm_config_snapshot_publish();
+
+	return 0;
+}
+
+DSO_PUBLIC
+const char *esdm_config_seed_file(void)
+{
+	return esdm_config.esdm_seed_file;
+}
+
+DSO_PUBLIC
+void esdm_config_seed_file_set(const char *path)
+{
+	esdm_config.esdm_seed_file = path ? path : "";
+}
+
+DSO_PUBLIC
+uint32_t esdm_config_seed_file_credit(void)
+{
+	return esdm_config.esdm_seed_file_credit;
+}
+
+DSO_PUBLIC
+void esdm_config_seed_file_credit_set(int setting)
+{
+	esdm_config.esdm_seed_file_credit = !!setting;
 }
 
 #ifdef ESDM_TESTMODE
 void esdm_config_drng_max_wo_reseed_set(uint32_t val)
 {
 	esdm_config.esdm_drng_max_wo_reseed = val;
+	esdm_config_snapshot_publish();
 }
 
 void esdm_config_drng_max_wo_reseed_bits_set(uint32_t val)
 {
 	esdm_config.esdm_drng_max_wo_reseed_bits = val;
+	esdm_config_snapshot_publish();
 }
 
 void esdm_config_max_nodes_set(uint32_t val)
 {
 	esdm_config.esdm_max_nodes = val;
+	esdm_config_snapshot_publish();
 }
 #endif
 
@@ -326,46 +689,65 @@ DSO_PUBLIC
 void esdm_config_force_fips_set(enum esdm_config_force_fips val)
 {
 	esdm_config.force_fips = val;
+	esdm_config_snapshot_publish();
 }
 
 DSO_PUBLIC
 int esdm_config_fips_enabled(void)
 {
-	/* FIPS 140 mode can only be set with FIPS-140 compile time option */
-#ifdef ESDM_FIPS140
-	if (esdm_config.force_fips == esdm_config_force_fips_unset)
-		return fips_enabled();
-	return (esdm_config.force_fips >= esdm_config_force_fips_enabled);
-#else
-	return false;
-#endif
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.derived ? snap.fips_enabled : esdm_config_fips_calc();
 }
 
 DSO_PUBLIC
 int esdm_config_sp80090c_compliant(void)
 {
-	/* SP800-90C mode can only be set with SP800-90C compile-time option */
-#ifdef ESDM_OVERSAMPLE_ENTROPY_SOURCES
-	if (esdm_config.force_fips == esdm_config_force_fips_unset)
-		return fips_enabled();
+	struct esdm_config_snapshot snap;
 
-	/* SP800-90C is always enabled if FIPS-140 mode is enabled */
-	return (esdm_config.force_fips >= esdm_config_force_sp80090c_enabled);
-#else
-	return false;
-#endif
+	esdm_config_snapshot(&snap);
+	return snap.derived ? snap.sp80090c_compliant :
+			      esdm_config_sp80090c_calc();
 }
 
 DSO_PUBLIC
 uint32_t esdm_config_online_nodes(void)
 {
-	return min_uint32(esdm_online_nodes(), esdm_config_max_nodes());
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	if (snap.derived)
+		return snap.online_nodes;
+	return min_uint32(esdm_online_nodes(), snap.max_nodes);
 }
 
+/* CPU of the client whose request is served by the thread */
+static __thread uint32_t esdm_config_cpu = ESDM_CONFIG_CPU_HINT_NONE;
+
 DSO_PUBLIC
 uint32_t esdm_config_curr_node(void)
 {
-	return esdm_curr_node() % esdm_config_max_nodes();
+	struct esdm_config_snapshot snap;
+	uint32_t max_nodes;
+
+	esdm_config_snapshot(&snap);
+	max_nodes = snap.max_nodes;
+
+	if (esdm_config_cpu != ESDM_CONFIG_CPU_HINT_NONE)
+		return esdm_config_cpu % max_nodes;
+
+	return esdm_curr_node() % max_nodes;
+}
+
+DSO_PUBLIC
+void esdm_config_cpu_hint(uint32_t cpu)
+{
+	/* Same limitation as applied to the current CPU by esdm_curr_node */
+	if (cpu >= esdm_online_nodes())
+		cpu = ESDM_CONFIG_CPU_HINT_NONE;
+
+	esdm_config_cpu = cpu;
 }
 
 int esdm_config_init(void)
@@ -400,6 +782,16 @@ int esdm_config_init(void)
 		esdm_config_entropy_rate_max(
 			esdm_config.esdm_es_hwrand_entropy_rate_bits);
 	complete_entropy_rate += esdm_config.esdm_es_hwrand_entropy_rate_bits;
+	esdm_config.esdm_es_upstream_entropy_rate_bits =
+		esdm_config_entropy_rate_max(
+			esdm_config.esdm_es_upstream_entropy_rate_bits);
+	complete_entropy_rate += esdm_config.esdm_es_upstream_entropy_rate_bits;
+#ifdef ESDM_ES_SYNTH
+	esdm_config.esdm_es_synth_entropy_rate_bits =
+		esdm_config_entropy_rate_max(
+			esdm_config.esdm_es_synth_entropy_rate_bits);
+	complete_entropy_rate += esdm_config.esdm_es_synth_entropy_rate_bits;
+#endif
 
 	if (!complete_entropy_rate) {
 		esdm_logger_status(
@@ -407,6 +799,9 @@ int esdm_config_init(void)
 			"All entropy sources managed by ESDM collectively cannot satisfy seed requirement - ensure to use an external entropy provider to fill up auxiliary pool!\n");
 	}
 
+	esdm_config_initialized = true;
+	esdm_config_snapshot_publish();
+
 	return 0;
 }
 
@@ -63,6 +63,27 @@ uint32_t esdm_config_es_jent_async_enabled(void);
  */
 void esdm_config_es_jent_async_enabled_set(int setting);
 
+/**
+ * @brief ES manager configuration: get the entropy source collection timeout
+ *
+ * @return Timeout in milliseconds, 0 if the entropy sources are collected one
+ *	   after another
+ */
+uint32_t esdm_config_es_collect_timeout(void);
+
+/**
+ * @brief ES manager configuration: collect the entropy sources in parallel
+ *
+ * When filling the seed buffer, each entropy source is collected by its own
+ * thread and the seed buffer is filled with the data of all entropy sources
+ * which delivered before the timeout. An entropy source which misses the
+ * timeout contributes no data and no entropy.
+ *
+ * @param [in] ms Timeout in milliseconds, 0 collects the entropy sources one
+ *		  after another
+ */
+void esdm_config_es_collect_timeout_set(uint32_t ms);
+
 /**
  * @brief JENT ES configuration: get the entropy rate
  *
@@ -198,6 +219,74 @@ void esdm_config_es_jent_kernel_entropy_rate_set(uint32_t ent);
  */
 uint32_t esdm_config_es_jent_kernel_entropy_rate(void);
 
+/**
+ * @brief Upstream ESDM ES configuration: set the entropy rate
+ *
+ * NOTE: The ESDM ensures that the entropy rate cannot be set to a value larger
+ *	 than the security strength of the the applied DRNG.
+ *
+ * @param [in] ent Entropy rate in bits.
+ */
+void esdm_config_es_upstream_entropy_rate_set(uint32_t ent);
+
+/**
+ * @brief Upstream ESDM ES configuration: get the entropy rate
+ *
+ * @return Entropy rate in bits
+ */
+uint32_t esdm_config_es_upstream_entropy_rate(void);
+
+/**
+ * @brief Synthetic ES configuration: set the entropy rate
+ *
+ * The synthetic ES is only available in test mode builds.
+ *
+ * NOTE: The ESDM ensures that the entropy rate cannot be set to a value larger
+ *	 than the security strength of the the applied DRNG.
+ *
+ * @param [in] ent Entropy rate in bits.
+ */
+void esdm_config_es_synth_entropy_rate_set(uint32_t ent);
+
+/**
+ * @brief Synthetic ES configuration: get the entropy rate
+ *
+ * @return Entropy rate in bits
+ */
+uint32_t esdm_config_es_synth_entropy_rate(void);
+
+/**
+ * @brief Synthetic ES configuration: set the latency of one collection
+ *
+ * @param [in] latency_us Time in microseconds the ES waits before it delivers
+ *			  its data
+ */
+void esdm_config_es_synth_latency_us_set(uint32_t latency_us);
+
+/**
+ * @brief Synthetic ES configuration: get the latency of one collection
+ *
+ * @return Latency in microseconds
+ */
+uint32_t esdm_config_es_synth_latency_us(void);
+
+/**
+ * @brief Synthetic ES configuration: set the seed of the data stream
+ *
+ * The synthetic ES delivers a deterministic data stream derived from the
+ * seed. Setting the seed restarts the data stream with the next collection.
+ *
+ * @param [in] seed Seed of the data stream
+ */
+void esdm_config_es_synth_seed_set(uint32_t seed);
+
+/**
+ * @brief Synthetic ES configuration: get the seed of the data stream
+ *
+ * @return Seed of the data stream
+ */
+uint32_t esdm_config_es_synth_seed(void);
+
 /**
  * @brief DRNG Manager configuration: get maximum value without successful
  *	  reseed (number of requests)
@@ -236,6 +325,185 @@ uint32_t esdm_config_drng_max_wo_reseed_bits(void);
  */
 uint32_t esdm_config_max_nodes(void);
 
+/**
+ * @brief DRNG Manager configuration: get the maximum DRNG request size
+ *
+ * Requests for random numbers are split into requests of this size to the
+ * DRNG. The DRNG may be reseeded between them.
+ *
+ * @return Request size in bytes, 0 if the size is selected during the
+ *	   self test of the DRNG to limit the per-request overhead.
+ */
+uint32_t esdm_config_drng_max_reqsize(void);
+
+/**
+ * @brief DRNG Manager configuration: set the maximum DRNG request size
+ *
+ * @param [in] val Request size in bytes (at least the DRNG security strength
+ *		   and at most 1<<16 bytes as defined by SP800-90A), 0
+ *		   selects the size during the self test of the DRNG.
+ */
+void esdm_config_drng_max_reqsize_set(uint32_t val);
+
+/**
+ * @brief DRNG Manager configuration: get the size limit of small requests
+ *
+ * @return Size in bytes up to which requests are served by the low-latency
+ *	   DRNG, 0 if no low-latency DRNG is used.
+ */
+uint32_t esdm_config_drng_small_reqsize(void);
+
+/**
+ * @brief DRNG Manager configuration: set the size limit of small requests
+ *
+ * When set, the DRNG implementations compiled into the ESDM are measured
+ * for requests of the given size during the initialization of the DRNG
+ * manager. If one is faster than the DRNG serving the bulk requests, each
+ * DRNG instance is accompanied by a low-latency DRNG instance of that
+ * implementation which serves the requests of up to the given size. In FIPS
+ * or SP800-90C mode, only the SP800-90A DRBGs are considered. This setting
+ * must be applied before esdm_init. It is ignored by the tiny footprint
+ * build.
+ *
+ * @param [in] val Request size in bytes (at most 1<<16 bytes), 0 disables
+ *		   the low-latency DRNG.
+ */
+void esdm_config_drng_small_reqsize_set(uint32_t val);
+
+/**
+ * @brief DRNG Manager configuration: is the caller bound to its CPU while
+ *	  generating random numbers?
+ *
+ * @return Boolean indicating whether the caller is bound to its CPU
+ */
+uint32_t esdm_config_drng_cpu_affine(void);
+
+/**
+ * @brief DRNG Manager configuration: bind the caller to its CPU while
+ *	  generating random numbers
+ *
+ * With multiple DRNG instances, the caller uses the DRNG instance of the CPU
+ * it executes on. When enabled, the caller is bound to this CPU until the
+ * random numbers are generated. This prevents a migration to a CPU of another
+ * NUMA node while using the DRNG instance allocated on the NUMA node of the
+ * original CPU.
+ *
+ * @param [in] setting Boolean to enable the behavior
+ */
+void esdm_config_drng_cpu_affine_set(int setting);
+
+/**
+ * @brief DRNG Manager configuration: is the DRNG selected at startup?
+ *
+ * @return Boolean indicating whether the DRNG is selected at startup
+ */
+uint32_t esdm_config_drng_autotune(void);
+
+/**
+ * @brief DRNG Manager configuration: select the fastest DRNG at startup
+ *
+ * When enabled, all DRNG implementations compiled into the ESDM are measured
+ * during the initialization of the DRNG manager and the fastest is used
+ * instead of the DRNG selected at compile time. In FIPS or SP800-90C mode,
+ * only the SP800-90A DRBGs are considered. This setting must be applied
+ * before esdm_init.
+ *
+ * @param [in] setting Boolean to enable the behavior
+ */
+void esdm_config_drng_autotune_set(int setting);
+
+/**
+ * @brief Thread placement configuration: are threads bound to a class of CPU
+ *	  cores?
+ *
+ * @return Boolean indicating whether the threads are bound to a core class
+ */
+uint32_t esdm_config_cpu_class_placement(void);
+
+/**
+ * @brief Thread placement configuration: bind threads to a class of CPU cores
+ *
+ * On hybrid CPUs with performance and efficiency cores, the RPC handlers are
+ * bound to the performance cores and the entropy source collection is bound
+ * to the efficiency cores. The Jitter RNG instances are pinned to individual
+ * CPUs of one class to provide the same timing behavior as covered by the
+ * SP800-90B assessment. Without a hybrid CPU the setting has no effect.
+ *
+ * @param [in] setting Boolean to enable the behavior
+ */
+void esdm_config_cpu_class_placement_set(int setting);
+
+/**
+ * @brief Sharding configuration: get the shard number
+ *
+ * @return Number of the shard, only valid if esdm_config_shards is not 0
+ */
+uint32_t esdm_config_shard(void);
+
+/**
+ * @brief Sharding configuration: get the number of shards
+ *
+ * @return Number of shards, 0 if the ESDM is no shard of a sharded server
+ */
+uint32_t esdm_config_shards(void);
+
+/**
+ * @brief Sharding configuration: operate as one shard of a sharded server
+ *
+ * The CPUs are split into the given number of contiguous blocks, the shard
+ * operates one DRNG instance for each CPU of one block. The shard does not
+ * publish the status shared memory segment and does not use the seed file as
+ * both belong to the ESDM server on the default sockets which seeds the
+ * shards. This setting must be applied before esdm_init.
+ *
+ * @param [in] shard Number of the shard, must be smaller than shards
+ * @param [in] shards Number of shards
+ *
+ * @return 0 on success, -EINVAL on invalid values
+ */
+int esdm_config_shard_set(uint32_t shard, uint32_t shards);
+
+/**
+ * @brief Seed file configuration: get the path of the seed file
+ *
+ * @return Path of the seed file, an empty string if the seed file is disabled
+ */
+const char *esdm_config_seed_file(void);
+
+/**
+ * @brief Seed file configuration: set the path of the seed file
+ *
+ * During esdm_init, the content of the seed file is inserted into the
+ * auxiliary pool and the file is rotated. During esdm_fini, new seed material
+ * generated by the DRNG is written to it. The file is created if it does not
+ * exist, an existing file must be a regular file owned by the caller which is
+ * not accessible by others. This setting must be applied before esdm_init.
+ *
+ * @param [in] path Path of the seed file which must remain valid until
+ *		    esdm_fini, NULL or an empty string disables the seed file
+ */
+void esdm_config_seed_file_set(const char *path);
+
+/**
+ * @brief Seed file configuration: is entropy credited to the seed file
+ *
+ * @return Boolean indicating whether entropy is credited
+ */
+uint32_t esdm_config_seed_file_credit(void);
+
+/**
+ * @brief Seed file configuration: credit entropy to the seed file
+ *
+ * When enabled, the content of the seed file is credited with
+ * ESDM_DRNG_SECURITY_STRENGTH_BITS of entropy. The content is never credited
+ * in FIPS or SP800-90C mode. Only enable this setting if the seed file cannot
+ * be read by others and is never restored from a copy, e.g. a system image
+ * or a backup.
+ *
+ * @param [in] setting Boolean to enable the behavior
+ */
+void esdm_config_seed_file_credit_set(int setting);
+
 /* FIPS mode enforcement */
 enum esdm_config_force_fips {
 	/** Default: no FIPS enforcement is set, ESDM checks environment */
@@ -289,6 +557,53 @@ uint32_t esdm_config_online_nodes(void);
  */
 uint32_t esdm_config_curr_node(void);
 
+/* No CPU hint is set for the current thread */
+#define ESDM_CONFIG_CPU_HINT_NONE UINT32_MAX
+
+/**
+ * @brief DRNG Manager configuration: Set the CPU of the current request
+ *
+ * A request received from a client is served by a thread whose CPU is
+ * unrelated to the one of the client. With the hint, esdm_config_curr_node
+ * selects the DRNG instance of the CPU of the client for the calling thread
+ * until the hint is cleared.
+ *
+ * @param cpu CPU of the client or ESDM_CONFIG_CPU_HINT_NONE to clear the hint -
+ *	      a CPU which is not online is ignored
+ */
+void esdm_config_cpu_hint(uint32_t cpu);
+
+/**
+ * @brief Runtime reconfiguration: change one setting by name
+ *
+ * Only settings which take effect while the ESDM operates can be changed:
+ * the entropy rates of the entropy sources (es_*_entropy_rate),
+ * es_jent_async_enabled, es_collect_timeout, drng_max_reqsize,
+ * drng_small_reqsize, drng_cpu_affine, write_wakeup_bits and
+ * min_reseed_secs. Boolean settings treat any non-zero value as true.
+ *
+ * @param [in] name Name of the setting
+ * @param [in] value New value of the setting
+ *
+ * @return 0 on success, -EINVAL for an unknown setting
+ */
+int esdm_config_set(const char *name, uint32_t value);
+
+/**
+ * @brief Runtime reconfiguration: apply the settings of a file
+ *
+ * The file contains one "name = value" line per setting using the names of
+ * esdm_config_set, values are decimal or hexadecimal with 0x prefix, and
+ * everything after a # is a comment. The file is validated completely before
+ * any setting is applied, so a malformed file leaves the configuration
+ * unchanged.
+ *
+ * @param [in] path Path of the configuration file
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_config_file_load(const char *path);
+
 int esdm_config_init(void);
 int esdm_config_reinit(void);
 
@@ -20,7 +20,78 @@
 #ifndef _ESDM_CONFIG_INTERNAL
 #define _ESDM_CONFIG_INTERNAL
 
+#include <string.h>
+
+#include "bool.h"
 #include "config.h"
+#include "esdm_definitions.h"
+#include "helper.h"
+#include "mutex_w.h"
+
+/*
+ * Read-mostly snapshot of the settings and derived values used by the hot
+ * paths. A reader obtains a consistent copy of the snapshot, a
+ * reconfiguration publishes a completely rebuilt snapshot.
+ */
+struct esdm_config_snapshot {
+	uint32_t max_nodes;
+	/*
+	 * The following derived values are only valid once esdm_config_init
+	 * completed: online_nodes, fips_enabled and sp80090c_compliant
+	 */
+	bool derived;
+	uint32_t online_nodes; /* min(esdm_online_nodes(), max_nodes) */
+	uint32_t drng_max_reqsize;
+	uint32_t drng_small_reqsize;
+	uint32_t drng_max_wo_reseed;
+	uint32_t drng_max_wo_reseed_bits;
+	bool drng_cpu_affine;
+	bool jent_async_enabled;
+	bool fips_enabled;
+	bool sp80090c_compliant;
+	bool ntg1_2024_compliant;
+};
+
+/*
+ * The published snapshot is guarded by a sequence count: it is odd while the
+ * snapshot is rewritten and zero until the first snapshot is published.
+ */
+struct esdm_config_snapshot_seq {
+	uint32_t seq;
+	struct esdm_config_snapshot snap;
+} __aligned(ESDM_CACHELINE_SIZE);
+
+extern struct esdm_config_snapshot_seq esdm_config_snap;
+void esdm_config_snapshot_publish(void);
+
+/*
+ * Obtain a copy of the current configuration snapshot - the first call
+ * publishes the initial snapshot. The copy is retried if a reconfiguration
+ * rewrote the snapshot while it was copied.
+ */
+static inline void esdm_config_snapshot(struct esdm_config_snapshot *snap)
+{
+	uint32_t seq;
+
+	for (;;) {
+		seq = __atomic_load_n(&esdm_config_snap.seq, __ATOMIC_ACQUIRE);
+		if (!seq) {
+			esdm_config_snapshot_publish();
+			continue;
+		}
+		if (seq & 1) {
+			mutex_w_cpu_relax();
+			continue;
+		}
+
+		memcpy(snap, &esdm_config_snap.snap, sizeof(*snap));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&esdm_config_snap.seq, __ATOMIC_RELAXED) ==
+		    seq)
+			return;
+	}
+}
 
 /* Initialization */
 int esdm_config_init(void);
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esdm.h"
+#include "esdm_config.h"
+#include "esdm_logger.h"
+#include "helper.h"
+#include "visibility.h"
+
+/*
+ * Runtime reconfiguration: the settings which take effect the next time they
+ * are used and thus can be changed while the ESDM operates. Settings which
+ * size the DRNG nodes or threads allocated during esdm_init, like the
+ * maximum number of nodes, are not part of this list.
+ */
+struct esdm_config_setting {
+	const char *name;
+	void (*set)(uint32_t val);
+};
+
+#define ESDM_CONFIG_SETTING_U32(name, setter)                                  \
+	static void esdm_config_set_##name(uint32_t val)                       \
+	{                                                                      \
+		setter(val);                                                   \
+	}
+
+#define ESDM_CONFIG_SETTING_BOOL(name, setter)                                 \
+	static void esdm_config_set_##name(uint32_t val)                       \
+	{                                                                      \
+		setter(!!val);                                                 \
+	}
+
+ESDM_CONFIG_SETTING_U32(es_cpu_entropy_rate,
+			esdm_config_es_cpu_entropy_rate_set)
+ESDM_CONFIG_SETTING_U32(es_jent_entropy_rate,
+			esdm_config_es_jent_entropy_rate_set)
+ESDM_CONFIG_SETTING_BOOL(es_jent_async_enabled,
+			 esdm_config_es_jent_async_enabled_set)
+ESDM_CONFIG_SETTING_U32(es_irq_entropy_rate,
+			esdm_config_es_irq_entropy_rate_set)
+ESDM_CONFIG_SETTING_U32(es_krng_entropy_rate,
+			esdm_config_es_krng_entropy_rate_set)
+ESDM_CONFIG_SETTING_U32(es_sched_entropy_rate,
+			esdm_config_es_sched_entropy_rate_set)
+ESDM_CONFIG_SETTING_U32(es_hwrand_entropy_rate,
+			esdm_config_es_hwrand_entropy_rate_set)
+ESDM_CONFIG_SETTING_U32(es_jent_kernel_entropy_rate,
+			esdm_config_es_jent_kernel_entropy_rate_set)
+ESDM_CONFIG_SETTING_U32(es_upstream_entropy_rate,
+			esdm_config_es_upstream_entropy_rate_set)
+ESDM_CONFIG_SETTING_U32(es_collect_timeout, esdm_config_es_collect_timeout_set)
+ESDM_CONFIG_SETTING_U32(drng_max_reqsize, esdm_config_drng_max_reqsize_set)
+ESDM_CONFIG_SETTING_U32(drng_small_reqsize, esdm_config_drng_small_reqsize_set)
+ESDM_CONFIG_SETTING_BOOL(drng_cpu_affine, esdm_config_drng_cpu_affine_set)
+ESDM_CONFIG_SETTING_U32(write_wakeup_bits, esdm_set_write_wakeup_bits)
+ESDM_CONFIG_SETTING_U32(min_reseed_secs, esdm_set_reseed_max_time)
+
+#define ESDM_CONFIG_SETTING(name) { #name, esdm_config_set_##name }
+
+static const struct esdm_config_setting esdm_config_settings[] = {
+	ESDM_CONFIG_SETTING(es_cpu_entropy_rate),
+	ESDM_CONFIG_SETTING(es_jent_entropy_rate),
+	ESDM_CONFIG_SETTING(es_jent_async_enabled),
+	ESDM_CONFIG_SETTING(es_irq_entropy_rate),
+	ESDM_CONFIG_SETTING(es_krng_entropy_rate),
+	ESDM_CONFIG_SETTING(es_sched_entropy_rate),
+	ESDM_CONFIG_SETTING(es_hwrand_entropy_rate),
+	ESDM_CONFIG_SETTING(es_jent_kernel_entropy_rate),
+	ESDM_CONFIG_SETTING(es_upstream_entropy_rate),
+	ESDM_CONFIG_SETTING(es_collect_timeout),
+	ESDM_CONFIG_SETTING(drng_max_reqsize),
+	ESDM_CONFIG_SETTING(drng_small_reqsize),
+	ESDM_CONFIG_SETTING(drng_cpu_affine),
+	ESDM_CONFIG_SETTING(write_wakeup_bits),
+	ESDM_CONFIG_SETTING(min_reseed_secs),
+};
+
+static const struct esdm_config_setting *
+esdm_config_setting_find(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(esdm_config_settings); i++) {
+		if (!strcmp(esdm_config_settings[i].name, name))
+			return &esdm_config_settings[i];
+	}
+
+	return NULL;
+}
+
+DSO_PUBLIC
+int esdm_config_set(const char *name, uint32_t value)
+{
+	const struct esdm_config_setting *setting;
+
+	if (!name)
+		return -EINVAL;
+
+	setting = esdm_config_setting_find(name);
+	if (!setting) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_ANY,
+			    "Configuration setting %s unknown or not changeable at runtime\n",
+			    name);
+		return -EINVAL;
+	}
+
+	setting->set(value);
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+		    "Configuration setting %s set to %u\n", name, value);
+
+	return 0;
+}
+
+/* Maximum number of settings a configuration file may contain */
+#define ESDM_CONFIG_FILE_MAX_SETTINGS 64
+
+struct esdm_config_file_entry {
+	const struct esdm_config_setting *setting;
+	uint32_t value;
+};
+
+static char *esdm_config_file_trim(char *str)
+{
+	char *end;
+
+	while (*str == ' ' || *str == '\t')
+		str++;
+
+	end = str + strlen(str);
+	while (end > str && (end[-1] == ' ' || end[-1] == '\t' ||
+			     end[-1] == '\n' || end[-1] == '\r'))
+		end--;
+	*end = '\0';
+
+	return str;
+}
+
+/*
+ * Parse one "name = value" line. Returns 1 if the line contains a setting,
+ * 0 for empty and comment lines, and -EINVAL for malformed lines.
+ */
+static int esdm_config_file_parse(char *line,
+				  struct esdm_config_file_entry *entry)
+{
+	char *name, *value, *end, *comment;
+	unsigned long val;
+
+	comment = strchr(line, '#');
+	if (comment)
+		*comment = '\0';
+
+	name = esdm_config_file_trim(line);
+	if (!*name)
+		return 0;
+
+	value = strchr(name, '=');
+	if (!value)
+		return -EINVAL;
+	*value = '\0';
+	value = esdm_config_file_trim(value + 1);
+	name = esdm_config_file_trim(name);
+
+	entry->setting = esdm_config_setting_find(name);
+	if (!entry->setting)
+		return -EINVAL;
+
+	errno = 0;
+	val = strtoul(value, &end, 0);
+	if (!*value || *end || errno || val > UINT32_MAX)
+		return -EINVAL;
+	entry->value = (uint32_t)val;
+
+	return 1;
+}
+
+DSO_PUBLIC
+int esdm_config_file_load(const char *path)
+{
+	struct esdm_config_file_entry entries[ESDM_CONFIG_FILE_MAX_SETTINGS];
+	struct esdm_config_file_entry entry;
+	char line[256];
+	FILE *file;
+	unsigned int i, num = 0, lineno = 0;
+	int ret = 0;
+
+	if (!path)
+		return -EINVAL;
+
+	file = fopen(path, "r");
+	if (!file) {
+		ret = -errno;
+		esdm_logger(LOGGER_ERR, LOGGER_C_ANY,
+			    "Cannot open configuration file %s: %s\n", path,
+			    strerror(errno));
+		return ret;
+	}
+
+	/*
+	 * Stage the complete file first so that a malformed file leaves the
+	 * current configuration untouched.
+	 */
+	while (fgets(line, sizeof(line), file)) {
+		lineno++;
+
+		ret = esdm_config_file_parse(line, &entry);
+		if (ret < 0)
+			break;
+		if (!ret)
+			continue;
+
+		if (num >= ESDM_CONFIG_FILE_MAX_SETTINGS) {
+			ret = -E2BIG;
+			break;
+		}
+		entries[num++] = entry;
+		ret = 0;
+	}
+
+	if (!ret && ferror(file))
+		ret = -EIO;
+	fclose(file);
+
+	if (ret) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_ANY,
+			    "Configuration file %s rejected at line %u, no setting applied\n",
+			    path, lineno);
+		return ret;
+	}
+
+	for (i = 0; i < num; i++)
+		esdm_config_set(entries[i].setting->name, entries[i].value);
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+		    "Configuration file %s loaded with %u settings\n", path, num);
+
+	return 0;
+}
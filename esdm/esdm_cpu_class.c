@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "arch.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bool.h"
+#include "esdm_config.h"
+#include "esdm_cpu_class.h"
+#include "esdm_logger.h"
+#include "visibility.h"
+
+/* CPU sets of the core classes, only valid if hybrid is true */
+static struct {
+	cpu_set_t cpus[esdm_cpu_class_efficiency + 1];
+	uint32_t num[esdm_cpu_class_efficiency + 1];
+	bool hybrid;
+} esdm_cpu_class;
+
+static pthread_once_t esdm_cpu_class_once = PTHREAD_ONCE_INIT;
+
+/* Parse a CPU list like "0-7,16-23" as found in sysfs */
+static int esdm_cpu_class_read_list(const char *path, cpu_set_t *cpus)
+{
+	char buf[1024], *p, *end;
+	unsigned long first, last;
+	FILE *f;
+
+	CPU_ZERO(cpus);
+
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+	p = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (!p)
+		return -EINVAL;
+
+	while (*p && *p != '\n') {
+		first = strtoul(p, &end, 10);
+		if (end == p)
+			return -EINVAL;
+		last = first;
+		p = end;
+
+		if (*p == '-') {
+			p++;
+			last = strtoul(p, &end, 10);
+			if (end == p || last < first)
+				return -EINVAL;
+			p = end;
+		}
+
+		for (; first <= last && first < CPU_SETSIZE; first++)
+			CPU_SET(first, cpus);
+
+		if (*p == ',')
+			p++;
+	}
+
+	return 0;
+}
+
+/* Intel hybrid CPUs register a PMU for the P-cores and one for the E-cores */
+static bool esdm_cpu_class_detect_intel(void)
+{
+	if (esdm_cpu_class_read_list(
+		    "/sys/devices/cpu_core/cpus",
+		    &esdm_cpu_class.cpus[esdm_cpu_class_performance]))
+		return false;
+	if (esdm_cpu_class_read_list(
+		    "/sys/devices/cpu_atom/cpus",
+		    &esdm_cpu_class.cpus[esdm_cpu_class_efficiency]))
+		return false;
+
+	return true;
+}
+
+/*
+ * ARM big.LITTLE CPUs report the relative capacity of each CPU: the CPUs with
+ * the largest capacity are the performance cores, all others are the
+ * efficiency cores.
+ */
+static bool esdm_cpu_class_detect_capacity(void)
+{
+	unsigned int capacity[CPU_SETSIZE], max = 0;
+	char path[80];
+	long cpus = sysconf(_SC_NPROCESSORS_CONF);
+	unsigned int i;
+	FILE *f;
+
+	if (cpus <= 0)
+		return false;
+	if (cpus > CPU_SETSIZE)
+		cpus = CPU_SETSIZE;
+
+	for (i = 0; i < (unsigned int)cpus; i++) {
+		capacity[i] = 0;
+
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%u/cpu_capacity", i);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		if (fscanf(f, "%u", &capacity[i]) != 1)
+			capacity[i] = 0;
+		fclose(f);
+
+		if (capacity[i] > max)
+			max = capacity[i];
+	}
+
+	if (!max)
+		return false;
+
+	CPU_ZERO(&esdm_cpu_class.cpus[esdm_cpu_class_performance]);
+	CPU_ZERO(&esdm_cpu_class.cpus[esdm_cpu_class_efficiency]);
+	for (i = 0; i < (unsigned int)cpus; i++) {
+		if (!capacity[i])
+			continue;
+		CPU_SET(i, &esdm_cpu_class.cpus[capacity[i] == max ?
+					      esdm_cpu_class_performance :
+					      esdm_cpu_class_efficiency]);
+	}
+
+	return true;
+}
+
+static void esdm_cpu_class_detect(void)
+{
+	cpu_set_t *all = &esdm_cpu_class.cpus[esdm_cpu_class_any];
+	int i;
+
+	if (sched_getaffinity(0, sizeof(*all), all))
+		return;
+	esdm_cpu_class.num[esdm_cpu_class_any] = (uint32_t)CPU_COUNT(all);
+
+	if (!esdm_cpu_class_detect_intel() && !esdm_cpu_class_detect_capacity())
+		return;
+
+	/* Only use the CPUs the process may execute on */
+	for (i = esdm_cpu_class_performance; i <= esdm_cpu_class_efficiency;
+	     i++) {
+		CPU_AND(&esdm_cpu_class.cpus[i], &esdm_cpu_class.cpus[i], all);
+		esdm_cpu_class.num[i] =
+			(uint32_t)CPU_COUNT(&esdm_cpu_class.cpus[i]);
+		if (!esdm_cpu_class.num[i])
+			return;
+	}
+
+	esdm_cpu_class.hybrid = true;
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+		    "Hybrid CPU with %u performance and %u efficiency cores\n",
+		    esdm_cpu_class.num[esdm_cpu_class_performance],
+		    esdm_cpu_class.num[esdm_cpu_class_efficiency]);
+}
+
+static bool esdm_cpu_class_enabled(void)
+{
+	if (!esdm_config_cpu_class_placement())
+		return false;
+
+	pthread_once(&esdm_cpu_class_once, esdm_cpu_class_detect);
+
+	return esdm_cpu_class.hybrid;
+}
+
+DSO_PUBLIC
+int esdm_cpu_class_bind(enum esdm_cpu_class cpu_class)
+{
+	if (cpu_class > esdm_cpu_class_efficiency)
+		return -EINVAL;
+	if (!esdm_cpu_class_enabled())
+		return 0;
+
+	if (sched_setaffinity(0, sizeof(cpu_set_t),
+			      &esdm_cpu_class.cpus[cpu_class]))
+		return -errno;
+
+	return 0;
+}
+
+int esdm_cpu_class_pin(enum esdm_cpu_class cpu_class, uint32_t index,
+		       struct esdm_arch_cpu_affinity *prev)
+{
+	const cpu_set_t *cpus;
+	uint32_t i;
+
+	if (cpu_class > esdm_cpu_class_efficiency)
+		return -EINVAL;
+	if (!esdm_cpu_class_enabled())
+		return -EOPNOTSUPP;
+
+	cpus = &esdm_cpu_class.cpus[cpu_class];
+	index %= esdm_cpu_class.num[cpu_class];
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (!CPU_ISSET(i, cpus))
+			continue;
+		if (!index)
+			return esdm_arch_cpu_pin(i, prev);
+		index--;
+	}
+
+	return -EFAULT;
+}
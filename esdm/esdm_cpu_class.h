@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef _ESDM_CPU_CLASS_H
+#define _ESDM_CPU_CLASS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct esdm_arch_cpu_affinity;
+
+/*
+ * Classes of CPU cores of a hybrid CPU, i.e. the P-cores and E-cores of Intel
+ * CPUs or the big and LITTLE cores of ARM CPUs.
+ */
+enum esdm_cpu_class {
+	esdm_cpu_class_any,
+	esdm_cpu_class_performance,
+	esdm_cpu_class_efficiency,
+};
+
+/**
+ * @brief Bind the calling thread to all CPUs of the given class
+ *
+ * The call is a noop unless esdm_config_cpu_class_placement is enabled and
+ * the system has a hybrid CPU. The class esdm_cpu_class_any binds the thread
+ * to all CPUs the process may use.
+ *
+ * @param [in] cpu_class Class of CPU cores
+ *
+ * @return 0 on success or when no binding is applied, < 0 on error
+ */
+int esdm_cpu_class_bind(enum esdm_cpu_class cpu_class);
+
+/**
+ * @brief Bind the calling thread to one CPU of the given class
+ *
+ * The CPU is selected with index modulo the number of CPUs of the class. The
+ * previous affinity is stored in prev to be restored with
+ * esdm_arch_cpu_unpin.
+ *
+ * @param [in] cpu_class Class of CPU cores
+ * @param [in] index Index of the CPU within the class
+ * @param [out] prev Affinity of the caller before the call
+ *
+ * @return 0 on success, -EOPNOTSUPP if the placement is disabled or the
+ *	   CPU is not hybrid, < 0 on error
+ */
+int esdm_cpu_class_pin(enum esdm_cpu_class cpu_class, uint32_t index,
+		       struct esdm_arch_cpu_affinity *prev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESDM_CPU_CLASS_H */
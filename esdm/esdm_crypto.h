@@ -23,6 +23,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include "bool.h"
+
 /* Definitions for cryptographic backends */
 
 /*
@@ -38,6 +40,9 @@
  *			return: >= 0 on success, < 0 on error
  * @drng_generate:	Generate random numbers from the DRNG with arbitrary
  *			length
+ * @drng_concurrent:	drng_generate may be invoked concurrently for the same
+ *			DRNG, i.e. it does not need to be serialized with the
+ *			DRNG lock. drng_seed is still serialized.
  */
 struct esdm_drng_cb {
 	const char *(*drng_name)(void);
@@ -46,6 +51,7 @@ struct esdm_drng_cb {
 	void (*drng_dealloc)(void *drng);
 	int (*drng_seed)(void *drng, const uint8_t *inbuf, size_t inbuflen);
 	ssize_t (*drng_generate)(void *drng, uint8_t *outbuf, size_t outbuflen);
+	bool drng_concurrent;
 };
 
 /*
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2022 - 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef _ESDM_CRYPTO_DISPATCH_H
+#define _ESDM_CRYPTO_DISPATCH_H
+
+#include "config.h"
+#include "esdm_crypto.h"
+
+/*
+ * Invocation of the DRNG and hash operations on the generate and the entropy
+ * collection paths.
+ *
+ * With ESDM_CRYPTO_STATIC_DISPATCH, exactly one builtin DRNG and hash are
+ * compiled in and the callbacks of all instances always point to them. The
+ * operations are then called directly instead of through the callback
+ * structures which allows the compiler to inline them with link-time
+ * optimization. The callbacks are still used for all other operations.
+ */
+#ifdef ESDM_CRYPTO_STATIC_DISPATCH
+
+#include "esdm_builtin_chacha20.h"
+#include "esdm_builtin_ctr_drbg.h"
+#include "esdm_builtin_hash_drbg.h"
+#include "esdm_builtin_sha512.h"
+
+#if defined(ESDM_DRNG_HASH_DRBG)
+#define ESDM_STATIC_DRNG(op) esdm_hash_drbg_##op
+#elif defined(ESDM_DRNG_CHACHA20)
+#define ESDM_STATIC_DRNG(op) esdm_chacha20_##op
+#elif defined(ESDM_DRNG_CTR_DRBG)
+#define ESDM_STATIC_DRNG(op) esdm_ctr_drbg_##op
+#else
+#error "Static dispatch requires a builtin DRNG"
+#endif
+
+#if !defined(ESDM_HASH_SHA512) && !defined(ESDM_HASH_SHA3_512)
+#error "Static dispatch requires a builtin hash"
+#endif
+
+static inline int esdm_drng_cb_seed(const struct esdm_drng_cb *drng_cb,
+				    void *drng, const uint8_t *inbuf,
+				    size_t inbuflen)
+{
+	(void)drng_cb;
+	return ESDM_STATIC_DRNG(seed)(drng, inbuf, inbuflen);
+}
+
+static inline ssize_t esdm_drng_cb_generate(const struct esdm_drng_cb *drng_cb,
+					    void *drng, uint8_t *outbuf,
+					    size_t outbuflen)
+{
+	(void)drng_cb;
+	return ESDM_STATIC_DRNG(generate)(drng, outbuf, outbuflen);
+}
+
+static inline int esdm_hash_cb_init(const struct esdm_hash_cb *hash_cb,
+				    void *hash)
+{
+	(void)hash_cb;
+	return esdm_sha512_hash_init(hash);
+}
+
+static inline int esdm_hash_cb_update(const struct esdm_hash_cb *hash_cb,
+				      void *hash, const uint8_t *inbuf,
+				      size_t inbuflen)
+{
+	(void)hash_cb;
+	return esdm_sha512_hash_update(hash, inbuf, inbuflen);
+}
+
+static inline int esdm_hash_cb_final(const struct esdm_hash_cb *hash_cb,
+				     void *hash, uint8_t *digest)
+{
+	(void)hash_cb;
+	return esdm_sha512_hash_final(hash, digest);
+}
+
+#else /* ESDM_CRYPTO_STATIC_DISPATCH */
+
+static inline int esdm_drng_cb_seed(const struct esdm_drng_cb *drng_cb,
+				    void *drng, const uint8_t *inbuf,
+				    size_t inbuflen)
+{
+	return drng_cb->drng_seed(drng, inbuf, inbuflen);
+}
+
+static inline ssize_t esdm_drng_cb_generate(const struct esdm_drng_cb *drng_cb,
+					    void *drng, uint8_t *outbuf,
+					    size_t outbuflen)
+{
+	return drng_cb->drng_generate(drng, outbuf, outbuflen);
+}
+
+static inline int esdm_hash_cb_init(const struct esdm_hash_cb *hash_cb,
+				    void *hash)
+{
+	return hash_cb->hash_init(hash);
+}
+
+static inline int esdm_hash_cb_update(const struct esdm_hash_cb *hash_cb,
+				      void *hash, const uint8_t *inbuf,
+				      size_t inbuflen)
+{
+	return hash_cb->hash_update(hash, inbuf, inbuflen);
+}
+
+static inline int esdm_hash_cb_final(const struct esdm_hash_cb *hash_cb,
+				     void *hash, uint8_t *digest)
+{
+	return hash_cb->hash_final(hash, digest);
+}
+
+#endif /* ESDM_CRYPTO_STATIC_DISPATCH */
+
+#endif /* _ESDM_CRYPTO_DISPATCH_H */
@@ -41,9 +41,25 @@
  * SP800-90A defines a maximum request size of 1<<16 bytes. The given value is
  * considered a safer margin.
  *
+ * The value is the smallest size considered when selecting the request size
+ * for the used DRNG at runtime. The selection can be overridden with
+ * esdm_config_drng_max_reqsize_set() up to ESDM_DRNG_MAX_REQSIZE_LIMIT.
+ *
  * This value is allowed to be changed.
  */
 #define ESDM_DRNG_MAX_REQSIZE (1 << 12)
+#define ESDM_DRNG_MAX_REQSIZE_LIMIT (1 << 16)
+
+/*
+ * Requests of up to ESDM_DRNG_COMBINE_REQSIZE bytes for a DRNG that is
+ * currently in use are combined: the thread holding the DRNG lock serves up
+ * to ESDM_DRNG_COMBINE_SLOTS waiting requests with one generate operation.
+ * The product of both values MUST NOT be larger than ESDM_DRNG_MAX_REQSIZE.
+ *
+ * This value is allowed to be changed.
+ */
+#define ESDM_DRNG_COMBINE_REQSIZE 256
+#define ESDM_DRNG_COMBINE_SLOTS 16
 
 /*
  * SP800-90A defines a maximum number of requests between reseeds of 2^48.
@@ -55,6 +71,35 @@
  */
 #define ESDM_DRNG_RESEED_THRESH (1 << 20)
 
+/*
+ * Number of generate operations of one request accounted against
+ * ESDM_DRNG_RESEED_THRESH with one atomic operation. The operations of a batch
+ * are accounted before they are performed, i.e. the reseed is triggered at most
+ * ESDM_DRNG_RESEED_BATCH - 1 operations early, but never late.
+ *
+ * This value is allowed to be changed.
+ */
+#define ESDM_DRNG_RESEED_BATCH 16
+
+/*
+ * Percentage of the reseed thresholds - ESDM_DRNG_RESEED_THRESH generate
+ * operations and the maximum reseed interval - after which the reseeder
+ * thread reseeds a DRNG ahead of time when the entropy pool is idle and holds
+ * enough entropy. A value of 0 disables the early reseed.
+ *
+ * This value is allowed to be changed.
+ */
+#define ESDM_DRNG_EARLY_RESEED_PERCENT 80
+
+/*
+ * Maximum time in milliseconds a generate request waits for the reseed of all
+ * DRNGs after a resume from suspend. A request waiting longer is served from
+ * the DRNG state before the suspend.
+ *
+ * This value is allowed to be changed.
+ */
+#define ESDM_DRNG_RESUME_GATE_MS 500
+
 /*
  * Maximum DRNG generation operations without reseed having full entropy
  * This value defines the absolute maximum value of DRNG generation operations
@@ -111,6 +156,14 @@
 /* Alignmask that is intended to be identical to CRYPTO_MINALIGN */
 #define ESDM_KCAPI_ALIGN 8
 
+/*
+ * Size of a CPU cache line. Data written by different threads is placed into
+ * separate cache lines of this size to prevent false sharing.
+ *
+ * This value is allowed to be changed.
+ */
+#define ESDM_CACHELINE_SIZE 64
+
 /*
  * This definition must provide a buffer that is equal to SHASH_DESC_ON_STACK
  * as it will be casted into a struct hash_ctx.
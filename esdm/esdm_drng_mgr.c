@@ -22,6 +22,8 @@
 #define _POSIX_C_SOURCE 200112L
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "build_bug_on.h"
@@ -29,9 +31,12 @@
 #include "esdm.h"
 #include "esdm_builtin_hash_drbg.h"
 #include "esdm_builtin_chacha20.h"
+#include "esdm_builtin_ctr_drbg.h"
 #include "esdm_builtin_sha512.h"
 #include "esdm_config.h"
+#include "esdm_config_internal.h"
 #include "esdm_crypto.h"
+#include "esdm_crypto_dispatch.h"
 #include "esdm_drng_atomic.h"
 #include "esdm_drng_mgr.h"
 #include "esdm_es_aux.h"
@@ -40,10 +45,18 @@
 #include "esdm_gnutls.h"
 #include "esdm_leancrypto.h"
 #include "esdm_node.h"
+#include "esdm_probes.h"
 #include "esdm_openssl.h"
+#include "esdm_shm_status.h"
+#include "esdm_startup.h"
 #include "helper.h"
+#include "hotpath_audit.h"
+#include "latency_hist.h"
+#include "memset_secure.h"
+#include "metrics.h"
 #include "queue.h"
 #include "ret_checkers.h"
+#include "threading_support.h"
 #include "visibility.h"
 
 /*
@@ -94,6 +107,8 @@ const struct esdm_drng_cb *esdm_default_drng_cb =
 	&esdm_botan_drbg_cb;
 #elif defined(ESDM_DRNG_CHACHA20)
 	&esdm_builtin_chacha20_cb;
+#elif defined(ESDM_DRNG_CTR_DRBG)
+	&esdm_builtin_ctr_drbg_cb;
 #elif defined(ESDM_GNUTLS)
 	&esdm_gnutls_drbg_cb;
 #elif defined(ESDM_LEANCRYPTO)
@@ -108,17 +123,85 @@ const struct esdm_drng_cb *esdm_default_drng_cb =
 static struct esdm_drng esdm_drng_init = { ESDM_DRNG_STATE_INIT(
 	esdm_drng_init, NULL, NULL, ESDM_DEFAULT_HASH_CB) };
 
-/* Prediction-resistance DRNG: only deliver as much data as received entropy */
-static struct esdm_drng esdm_drng_pr = { ESDM_DRNG_STATE_INIT(
-	esdm_drng_pr, NULL, NULL, ESDM_DEFAULT_HASH_CB) };
+/*
+ * Prediction-resistance DRNGs: only deliver as much data as received entropy.
+ * Concurrent requests are spread over the instances.
+ */
+static struct esdm_drng esdm_drng_pr[ESDM_DRNG_PR_INSTANCES] = {
+	[0 ... ESDM_DRNG_PR_INSTANCES - 1] = { ESDM_DRNG_STATE_INIT(
+		esdm_drng_pr, NULL, NULL, ESDM_DEFAULT_HASH_CB) }
+};
+static atomic_t esdm_drng_pr_next = ATOMIC_INIT(0);
+
+/* DRNG implementation of the low-latency DRNGs - NULL if none are used */
+static const struct esdm_drng_cb *esdm_drng_small_cb;
+
+#define for_each_pr_drng(i) for (i = 0; i < ESDM_DRNG_PR_INSTANCES; i++)
 
 /* Wait queue to wait until the ESDM is initialized - can freely be used */
 DECLARE_WAIT_QUEUE(esdm_init_wait);
 
 static atomic_t esdm_drng_mgr_terminate = ATOMIC_INIT(0);
 
+/* DRNG request size selected during the self test */
+static uint32_t esdm_drng_reqsize_auto = ESDM_DRNG_MAX_REQSIZE;
+
+/* Background reseeding of the DRNGs */
+static DECLARE_WAIT_QUEUE(esdm_reseed_wait);
+static atomic_t esdm_reseeder_active = ATOMIC_INIT(0);
+static atomic_t esdm_reseed_requested = ATOMIC_INIT(0);
+
+/*
+ * DRNG owned by the calling thread (see esdm_drng_thread_own) - the epoch is
+ * advanced by all events which invalidate the seed of the owned DRNGs.
+ */
+static __thread struct esdm_drng *esdm_drng_owned;
+static __thread int esdm_drng_owned_epoch;
+static atomic_t esdm_drng_epoch = ATOMIC_INIT(0);
+
 /********************************** Helper ************************************/
 
+static bool esdm_drng_is_pr(const struct esdm_drng *drng)
+{
+	return drng >= esdm_drng_pr &&
+	       drng < esdm_drng_pr + ESDM_DRNG_PR_INSTANCES;
+}
+
+/*
+ * Counters of each DRNG: the node DRNGs are accounted individually, nodes
+ * beyond ESDM_DRNG_METRICS_NODES share the last slot, all PR DRNGs share one
+ * slot.
+ */
+enum esdm_drng_metric {
+	esdm_drng_m_bytes,
+	esdm_drng_m_reseed_entropy,
+	esdm_drng_m_reseed_forced,
+	esdm_drng_m_reseed_parent,
+	esdm_drng_m_reseed_pr,
+	esdm_drng_m_lock_contended,
+	esdm_drng_m_num,
+};
+
+#define ESDM_DRNG_METRICS_NODES 16
+#define ESDM_DRNG_METRICS_PR ESDM_DRNG_METRICS_NODES
+
+ESDM_METRICS_DEFINE(esdm_drng_metrics_ctr,
+		    (ESDM_DRNG_METRICS_NODES + 1) * esdm_drng_m_num);
+
+static inline void esdm_drng_metric(const struct esdm_drng *drng,
+				    enum esdm_drng_metric metric, uint64_t val)
+{
+	unsigned int slot;
+
+	if (esdm_drng_is_pr(drng))
+		slot = ESDM_DRNG_METRICS_PR;
+	else
+		slot = min_uint32(drng->node, ESDM_DRNG_METRICS_NODES - 1);
+
+	esdm_metrics_add(&esdm_drng_metrics_ctr,
+			 slot * esdm_drng_m_num + metric, val);
+}
+
 bool esdm_get_available(void)
 {
 	return (atomic_read(&esdm_avail) == 2);
@@ -141,6 +224,21 @@ struct esdm_drng *esdm_drng_node_instance(void)
 	return esdm_drng_init_instance();
 }
 
+/*
+ * Time base of the reseed interval: the reseed checks performed for every
+ * generate operation only require a resolution of seconds. The coarse clock
+ * is read from the data the kernel publishes in the vDSO without accessing a
+ * hardware clock source.
+ */
+static void esdm_drng_time(struct timespec *ts)
+{
+#ifdef CLOCK_MONOTONIC_COARSE
+	if (!clock_gettime(CLOCK_MONOTONIC_COARSE, ts))
+		return;
+#endif
+	clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
 /*
  * Reset the DRNG by clearing all meta data, but leave the state (which implies)
  * the state is credited with zero entropy, but is used to have a state other
@@ -152,7 +250,7 @@ void esdm_drng_reset(struct esdm_drng *drng)
 	atomic_set(&drng->requests, 1);
 	atomic_set(&drng->requests_since_fully_seeded, 0);
 	atomic_set(&drng->request_bits_since_fully_seeded, 0);
-	clock_gettime(CLOCK_MONOTONIC, &drng->last_seeded);
+	esdm_drng_time(&drng->last_seeded);
 	drng->fully_seeded = false;
 	/* Do not set force, as this flag is used for the emergency reseeding */
 	drng->force_reseed = false;
@@ -188,62 +286,457 @@ static void esdm_drng_dealloc_common(struct esdm_drng *drng)
 
 	/* This only works with a robust mutex */
 	mutex_w_lock(&drng->lock);
+	mutex_lock(&drng->state_lock);
 	drng_cb = drng->drng_cb;
 	drng_cb->drng_dealloc(drng->drng);
 	drng->drng = NULL;
+	mutex_unlock(&drng->state_lock);
 	mutex_w_unlock(&drng->lock);
 }
 
-static int esdm_drng_mgr_selftest(void)
+/*
+ * The hash and the DRNG self tests are independent of each other and run on
+ * their own threads concurrently with the initialization of the entropy
+ * sources. No random number is delivered before both passed.
+ */
+enum esdm_drng_selftest_state {
+	esdm_drng_selftest_idle,
+	esdm_drng_selftest_running,
+	esdm_drng_selftest_passed,
+};
+
+struct esdm_drng_selftest {
+	const char *name;
+	int (*selftest)(void);
+	pthread_t tid;
+	bool started;
+	int ret;
+};
+
+static struct esdm_drng_selftest esdm_drng_selftests[2];
+/* enum esdm_drng_selftest_state or negative error of the failed self test */
+static atomic_t esdm_drng_selftest_result =
+	ATOMIC_INIT(esdm_drng_selftest_idle);
+static DEFINE_MUTEX_W_UNLOCKED(esdm_drng_selftest_lock);
+
+static void *esdm_drng_selftest_thread(void *arg)
+{
+	struct esdm_drng_selftest *test = arg;
+
+	if (test->selftest) {
+		test->ret = test->selftest();
+	} else {
+		esdm_logger(LOGGER_WARN, LOGGER_C_DRNG, "%s self test missing\n",
+			    test->name);
+		test->ret = 0;
+	}
+
+	return NULL;
+}
+
+/* Start the self tests of the current crypto implementations */
+static void esdm_drng_mgr_selftest_start(void)
 {
 	struct esdm_drng *drng = esdm_drng_node_instance();
-	const struct esdm_hash_cb *hash_cb;
-	const struct esdm_drng_cb *drng_cb;
-	int ret = 0;
+	unsigned int i;
 
-	/* Perform selftest of current crypto implementations */
-	mutex_reader_lock(&drng->hash_lock);
-	hash_cb = drng->hash_cb;
-	if (hash_cb->hash_selftest)
-		ret = hash_cb->hash_selftest();
-	else
-		esdm_logger(LOGGER_WARN, LOGGER_C_DRNG,
-			    "Hash self test missing\n");
-	mutex_reader_unlock(&drng->hash_lock);
-	CKINT_LOG(ret, "Hash self test failed: %d\n", ret);
-	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
-		    "Hash self test passed successfully\n");
+	mutex_w_lock(&esdm_drng_selftest_lock);
+	if (atomic_read(&esdm_drng_selftest_result) ==
+	    esdm_drng_selftest_running)
+		goto out;
+
+	esdm_startup_begin(esdm_startup_selftest);
+
+	esdm_drng_selftests[0].name = "Hash";
+	esdm_drng_selftests[0].selftest = esdm_drng_hash_cb(drng)->hash_selftest;
 
 	mutex_w_lock(&drng->lock);
-	drng_cb = drng->drng_cb;
-	if (drng_cb->drng_selftest)
-		ret = drng_cb->drng_selftest();
-	else
-		esdm_logger(LOGGER_WARN, LOGGER_C_DRNG,
-			    "DRNG self test missing\n");
+	esdm_drng_selftests[1].name = "DRNG";
+	esdm_drng_selftests[1].selftest = drng->drng_cb->drng_selftest;
 	mutex_w_unlock(&drng->lock);
-	CKINT_LOG(ret, "DRNG self test failed: %d\n", ret);
-	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
-		    "DRNG self test passed successfully\n");
+
+	for (i = 0; i < ARRAY_SIZE(esdm_drng_selftests); i++) {
+		struct esdm_drng_selftest *test = &esdm_drng_selftests[i];
+
+		test->started = !pthread_create(&test->tid, NULL,
+						esdm_drng_selftest_thread, test);
+
+		/* Without a thread, the self test is performed inline */
+		if (!test->started)
+			esdm_drng_selftest_thread(test);
+	}
+
+	atomic_set(&esdm_drng_selftest_result, esdm_drng_selftest_running);
 
 out:
+	mutex_w_unlock(&esdm_drng_selftest_lock);
 	esdm_drng_put_instances();
-	return ret;
 }
 
-int esdm_drng_mgr_reinitialize(void)
+int esdm_drng_mgr_selftest_wait(void)
 {
-	int ret;
+	unsigned int i;
+	int ret = atomic_read(&esdm_drng_selftest_result);
+
+	if (ret != esdm_drng_selftest_running)
+		return (ret < 0) ? ret : 0;
+
+	mutex_w_lock(&esdm_drng_selftest_lock);
+	ret = atomic_read(&esdm_drng_selftest_result);
+	if (ret != esdm_drng_selftest_running)
+		goto out;
+
+	ret = 0;
+	for (i = 0; i < ARRAY_SIZE(esdm_drng_selftests); i++) {
+		struct esdm_drng_selftest *test = &esdm_drng_selftests[i];
+
+		if (test->started)
+			pthread_join(test->tid, NULL);
+		test->started = false;
+
+		if (test->ret) {
+			esdm_logger(LOGGER_ERR, LOGGER_C_DRNG,
+				    "%s self test failed: %d\n", test->name,
+				    test->ret);
+			if (!ret)
+				ret = test->ret;
+		} else {
+			esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+				    "%s self test passed successfully\n",
+				    test->name);
+		}
+	}
 
-	CKINT(esdm_drng_mgr_selftest());
+	atomic_set(&esdm_drng_selftest_result,
+		   ret ? ret : esdm_drng_selftest_passed);
+	esdm_startup_end(esdm_startup_selftest);
 
 out:
-	return ret;
+	mutex_w_unlock(&esdm_drng_selftest_lock);
+	return (ret < 0) ? ret : 0;
+}
+
+static uint64_t esdm_drng_reqsize_time(const struct esdm_drng_cb *drng_cb,
+					void *drng, uint8_t *buf,
+					uint32_t reqsize)
+{
+	struct timespec start, end;
+	uint32_t i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < ESDM_DRNG_MAX_REQSIZE_LIMIT; i += reqsize)
+		drng_cb->drng_generate(drng, buf, reqsize);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL +
+	       (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+}
+
+/*
+ * Select the DRNG request size: each request to the DRNG is followed by its
+ * state update and, in esdm_drng_get, by the check for a reseed. The smallest
+ * request size is selected where this overhead takes at most 1/16th of the
+ * time compared to requests with the SP800-90A maximum size.
+ */
+static void esdm_drng_reqsize_tune(const struct esdm_drng_cb *drng_cb)
+{
+	static const uint8_t seed[ESDM_DRNG_SECURITY_STRENGTH_BYTES] = { 0 };
+	uint8_t *buf;
+	void *drng = NULL;
+	uint64_t limit_time;
+	uint32_t reqsize;
+
+	buf = malloc(ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	if (!buf)
+		return;
+
+	/* The DRNG instance only serves the measurement, its data is dropped */
+	if (drng_cb->drng_alloc(&drng, ESDM_DRNG_SECURITY_STRENGTH_BYTES))
+		goto out;
+	if (drng_cb->drng_seed(drng, seed, sizeof(seed)) < 0)
+		goto out;
+
+	limit_time = esdm_drng_reqsize_time(drng_cb, drng, buf,
+					    ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	limit_time += limit_time >> 4;
+
+	for (reqsize = ESDM_DRNG_MAX_REQSIZE;
+	     reqsize < ESDM_DRNG_MAX_REQSIZE_LIMIT; reqsize <<= 1) {
+		if (esdm_drng_reqsize_time(drng_cb, drng, buf, reqsize) <=
+		    limit_time)
+			break;
+	}
+
+	esdm_drng_reqsize_auto = reqsize;
+	esdm_logger(esdm_config_drng_autotune() ? LOGGER_STATUS : LOGGER_DEBUG,
+		    LOGGER_C_DRNG,
+		    "DRNG request size %u bytes selected for %s\n", reqsize,
+		    drng_cb->drng_name());
+
+out:
+	if (drng)
+		drng_cb->drng_dealloc(drng);
+	memset_secure(buf, 0, ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	free(buf);
+}
+
+/*
+ * DRNG implementations considered by the automatic selection. The ChaCha20
+ * DRNG is no SP800-90A DRBG and therefore only considered outside of the FIPS
+ * and SP800-90C modes.
+ */
+static const struct esdm_drng_autotune_cand {
+	const struct esdm_drng_cb *drng_cb;
+	bool sp80090a;
+} esdm_drng_autotune_cands[] = {
+#ifdef ESDM_DRNG_HASH_DRBG
+	{ &esdm_builtin_hash_drbg_cb, true },
+#endif
+#ifdef ESDM_DRNG_CTR_DRBG
+	{ &esdm_builtin_ctr_drbg_cb, true },
+#endif
+#ifdef ESDM_DRNG_CHACHA20
+	{ &esdm_builtin_chacha20_cb, false },
+#endif
+	{ NULL, false }
+};
+
+/* Best of several runs to reduce the noise of the measurement */
+#define ESDM_DRNG_AUTOTUNE_RUNS 4
+
+static uint64_t esdm_drng_autotune_time(const struct esdm_drng_cb *drng_cb,
+					uint8_t *buf, uint32_t reqsize)
+{
+	static const uint8_t seed[ESDM_DRNG_SECURITY_STRENGTH_BYTES] = { 0 };
+	void *drng = NULL;
+	uint64_t best = UINT64_MAX, time;
+	unsigned int i;
+
+	if (drng_cb->drng_alloc(&drng, ESDM_DRNG_SECURITY_STRENGTH_BYTES))
+		return UINT64_MAX;
+	if (drng_cb->drng_seed(drng, seed, sizeof(seed)) < 0)
+		goto out;
+
+	for (i = 0; i < ESDM_DRNG_AUTOTUNE_RUNS; i++) {
+		time = esdm_drng_reqsize_time(drng_cb, drng, buf, reqsize);
+		if (time < best)
+			best = time;
+	}
+
+out:
+	drng_cb->drng_dealloc(drng);
+	return best;
+}
+
+/*
+ * Select the fastest DRNG implementation on the given hardware. The request
+ * size for the selected DRNG is chosen afterwards by esdm_drng_reqsize_tune.
+ */
+static void esdm_drng_autotune(void)
+{
+	const struct esdm_drng_autotune_cand *cand;
+	const struct esdm_drng_cb *best_cb = esdm_default_drng_cb;
+	bool approved_only = esdm_config_fips_enabled() ||
+			     esdm_sp80090c_compliant();
+	uint64_t best = UINT64_MAX, time;
+	uint8_t *buf;
+
+	buf = malloc(ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	if (!buf)
+		return;
+
+	for (cand = esdm_drng_autotune_cands; cand->drng_cb; cand++) {
+		if (approved_only && !cand->sp80090a)
+			continue;
+
+		time = esdm_drng_autotune_time(cand->drng_cb, buf,
+					       ESDM_DRNG_MAX_REQSIZE);
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+			    "DRNG %s: %llu ns for %u bytes\n",
+			    cand->drng_cb->drng_name(),
+			    (unsigned long long)time,
+			    ESDM_DRNG_MAX_REQSIZE_LIMIT);
+		if (time < best) {
+			best = time;
+			best_cb = cand->drng_cb;
+		}
+	}
+
+	memset_secure(buf, 0, ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	free(buf);
+
+	if (best_cb != esdm_default_drng_cb) {
+		esdm_logger_status(LOGGER_C_DRNG,
+				   "DRNG %s selected instead of %s\n",
+				   best_cb->drng_name(),
+				   esdm_default_drng_cb->drng_name());
+		esdm_default_drng_cb = best_cb;
+	} else {
+		esdm_logger_status(LOGGER_C_DRNG,
+				   "DRNG %s selected by default is fastest\n",
+				   best_cb->drng_name());
+	}
+}
+
+/*
+ * Select the DRNG serving the requests of at most
+ * esdm_config_drng_small_reqsize bytes: the per-request overhead of the DRNG
+ * dominates small requests, a different DRNG implementation than the one used
+ * for bulk requests may serve them faster. The low-latency DRNGs are only
+ * allocated if such a DRNG exists.
+ */
+static void esdm_drng_small_autotune(void)
+{
+	const struct esdm_drng_autotune_cand *cand;
+	const struct esdm_drng_cb *best_cb = esdm_default_drng_cb;
+	uint32_t reqsize = esdm_config_drng_small_reqsize();
+	bool approved_only = esdm_config_fips_enabled() ||
+			     esdm_sp80090c_compliant();
+	uint64_t best, time;
+	uint8_t *buf;
+
+	esdm_drng_small_cb = NULL;
+	if (!reqsize)
+		return;
+
+	buf = malloc(ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	if (!buf)
+		return;
+
+	best = esdm_drng_autotune_time(esdm_default_drng_cb, buf, reqsize);
+	for (cand = esdm_drng_autotune_cands; cand->drng_cb; cand++) {
+		if (cand->drng_cb == esdm_default_drng_cb ||
+		    (approved_only && !cand->sp80090a))
+			continue;
+
+		time = esdm_drng_autotune_time(cand->drng_cb, buf, reqsize);
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+			    "DRNG %s: %llu ns for %u bytes in %u byte requests\n",
+			    cand->drng_cb->drng_name(),
+			    (unsigned long long)time,
+			    ESDM_DRNG_MAX_REQSIZE_LIMIT, reqsize);
+		if (time < best) {
+			best = time;
+			best_cb = cand->drng_cb;
+		}
+	}
+
+	memset_secure(buf, 0, ESDM_DRNG_MAX_REQSIZE_LIMIT);
+	free(buf);
+
+	if (best_cb == esdm_default_drng_cb) {
+		esdm_logger_status(LOGGER_C_DRNG,
+				   "DRNG %s serves requests of all sizes\n",
+				   best_cb->drng_name());
+		return;
+	}
+
+	esdm_logger_status(LOGGER_C_DRNG,
+			   "DRNG %s serves requests of up to %u bytes\n",
+			   best_cb->drng_name(), reqsize);
+	esdm_drng_small_cb = best_cb;
+}
+
+/*
+ * Allocate the low-latency DRNG accompanying the given DRNG. It is seeded
+ * from the given DRNG and thus from the same entropy source data, in NTG.1
+ * mode directly from the entropy sources. Each instance enforces its own
+ * reseed and disable thresholds.
+ */
+int esdm_drng_small_alloc(struct esdm_drng *drng)
+{
+	struct esdm_drng *small;
+	int ret;
+
+	if (!esdm_drng_small_cb || drng->small)
+		return 0;
+
+	/* Prevent false sharing with neighboring allocations */
+	if (posix_memalign((void *)&small, ESDM_CACHELINE_SIZE,
+			   sizeof(struct esdm_drng)))
+		return -ENOMEM;
+	memset(small, 0, sizeof(struct esdm_drng));
+
+	ret = esdm_drng_alloc_common(small, esdm_drng_small_cb);
+	if (ret) {
+		free(small);
+		return ret;
+	}
+	esdm_mem_account(esdm_mem_drng, sizeof(struct esdm_drng));
+
+	small->hash_cb = esdm_drng_hash_cb(drng);
+	small->node = drng->node;
+	small->parent = drng;
+
+	mutex_w_init_adaptive(&small->lock, 0, 1);
+	mutex_init(&small->hash_lock, 0);
+	mutex_init(&small->state_lock, 0);
+
+	drng->small = small;
+
+	return 0;
+}
+
+void esdm_drng_small_dealloc(struct esdm_drng *drng)
+{
+	struct esdm_drng *small = drng->small;
+
+	if (!small)
+		return;
+
+	drng->small = NULL;
+	esdm_drng_dealloc_common(small);
+	free(small);
+	esdm_mem_account(esdm_mem_drng, -(int64_t)sizeof(struct esdm_drng));
+}
+
+/*
+ * Use the low-latency DRNG for small requests once it is fully seeded, the
+ * DRNG it is seeded from serves the requests until then.
+ */
+static struct esdm_drng *esdm_drng_small_select(struct esdm_drng *drng,
+						size_t len)
+{
+	struct esdm_drng *small = drng->small;
+	struct esdm_config_snapshot snap;
+
+	if (!small || !small->fully_seeded)
+		return drng;
+
+	esdm_config_snapshot(&snap);
+	if (len > snap.drng_small_reqsize)
+		return drng;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+		    "Using low-latency DRNG instance on node %u\n",
+		    small->node);
+
+	return small;
+}
+
+/* Size of one request to the DRNG */
+static uint32_t esdm_drng_reqsize(void)
+{
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.drng_max_reqsize ? snap.drng_max_reqsize :
+				       esdm_drng_reqsize_auto;
+}
+
+int esdm_drng_mgr_reinitialize(void)
+{
+	/* Rerun the self tests once a previous run completed */
+	esdm_drng_mgr_selftest_wait();
+	esdm_drng_mgr_selftest_start();
+
+	return esdm_drng_mgr_selftest_wait();
 }
 
 /* Initialize the default DRNG during start time and perform its seeding */
 int esdm_drng_mgr_initialize(void)
 {
+	unsigned int i;
 	int ret;
 
 	/*
@@ -253,19 +746,35 @@ int esdm_drng_mgr_initialize(void)
 	if (atomic_cmpxchg(&esdm_avail, 0, 1) != 0)
 		return 0;
 
-	/* Initialize the PR DRNG inside init lock as it guards esdm_avail. */
-	mutex_w_init(&esdm_drng_pr.lock, 1, 1);
-	ret = esdm_drng_alloc_common(&esdm_drng_pr, esdm_default_drng_cb);
-	mutex_w_unlock(&esdm_drng_pr.lock);
+	/* The DRNG must be selected before any instance is allocated */
+	if (esdm_config_drng_autotune())
+		esdm_drng_autotune();
+	esdm_drng_small_autotune();
+
+	/* Initialize the PR DRNGs inside init lock as it guards esdm_avail. */
+	for_each_pr_drng (i) {
+		mutex_w_init_adaptive(&esdm_drng_pr[i].lock, 1, 1);
+		ret = esdm_drng_alloc_common(&esdm_drng_pr[i],
+					     esdm_default_drng_cb);
+		mutex_w_unlock(&esdm_drng_pr[i].lock);
+		if (ret)
+			break;
+	}
 
 	if (!ret) {
 		esdm_logger(LOGGER_VERBOSE, LOGGER_C_DRNG,
-			    "DRNG with prediction resistance allocated\n");
-		mutex_w_init(&esdm_drng_init.lock, 1, 1);
+			    "%u DRNGs with prediction resistance allocated\n",
+			    ESDM_DRNG_PR_INSTANCES);
+		mutex_w_init_adaptive(&esdm_drng_init.lock, 1, 1);
 		ret = esdm_drng_alloc_common(&esdm_drng_init,
 					     esdm_default_drng_cb);
 		mutex_w_unlock(&esdm_drng_init.lock);
 		if (!ret) {
+			/* Without it, the DRNG serves the small requests */
+			if (esdm_drng_small_alloc(&esdm_drng_init))
+				esdm_logger(
+					LOGGER_WARN, LOGGER_C_DRNG,
+					"low-latency DRNG allocation failed\n");
 			atomic_set(&esdm_avail, 2);
 			esdm_logger(
 				LOGGER_VERBOSE, LOGGER_C_DRNG,
@@ -278,7 +787,9 @@ int esdm_drng_mgr_initialize(void)
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
 		    "ESDM for general use is available\n");
 
-	CKINT(esdm_drng_mgr_selftest());
+	esdm_drng_mgr_selftest_start();
+
+	esdm_drng_reqsize_tune(esdm_default_drng_cb);
 
 out:
 	if (ret) {
@@ -289,9 +800,14 @@ out:
 
 void esdm_drng_mgr_finalize(void)
 {
+	unsigned int i;
+
 	atomic_set(&esdm_drng_mgr_terminate, 1);
+	thread_wake_all(&esdm_reseed_wait);
+	esdm_drng_small_dealloc(esdm_drng_init_instance());
 	esdm_drng_dealloc_common(esdm_drng_init_instance());
-	esdm_drng_dealloc_common(&esdm_drng_pr);
+	for_each_pr_drng (i)
+		esdm_drng_dealloc_common(&esdm_drng_pr[i]);
 }
 
 DSO_PUBLIC
@@ -315,13 +831,10 @@ int esdm_ntg1_compliant(void)
 DSO_PUBLIC
 int esdm_ntg1_2024_compliant(void)
 {
-	return
-#ifdef ESDM_AIS2031_NTG1_SEEDING_STRATEGY
-		true
-#else
-		false
-#endif
-		;
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	return snap.ntg1_2024_compliant;
 }
 
 DSO_PUBLIC
@@ -338,6 +851,101 @@ void esdm_set_reseed_max_time(uint32_t seconds)
 
 	/* We allow at most 1h reseed time */
 	esdm_drng_reseed_max_time = min_uint32(seconds, 60 * 60);
+	esdm_shm_status_set_proc_values();
+}
+
+/***************************** Hash context cache *****************************/
+
+/*
+ * Per-thread cache of one preallocated hash context: the entropy source
+ * conditioning would otherwise allocate and free a hash context for every
+ * reseed if the hash callbacks require heap allocation. The context is
+ * released when the thread terminates or the hash callbacks change.
+ */
+struct esdm_hash_ctx_cache {
+	const struct esdm_hash_cb *hash_cb;
+	void *ctx;
+	bool in_use;
+};
+
+static __thread struct esdm_hash_ctx_cache esdm_hash_ctx_cache;
+static pthread_key_t esdm_hash_ctx_cache_key;
+static pthread_once_t esdm_hash_ctx_cache_once = PTHREAD_ONCE_INIT;
+static bool esdm_hash_ctx_cache_key_valid = false;
+
+static void esdm_hash_ctx_cache_release(struct esdm_hash_ctx_cache *cache)
+{
+	if (cache->ctx)
+		cache->hash_cb->hash_dealloc(cache->ctx);
+	cache->ctx = NULL;
+	cache->hash_cb = NULL;
+}
+
+/* Thread terminates */
+static void esdm_hash_ctx_cache_destructor(void *data)
+{
+	struct esdm_hash_ctx_cache *cache = data;
+
+	if (cache)
+		esdm_hash_ctx_cache_release(cache);
+}
+
+static void esdm_hash_ctx_cache_init(void)
+{
+	if (!pthread_key_create(&esdm_hash_ctx_cache_key,
+				esdm_hash_ctx_cache_destructor))
+		esdm_hash_ctx_cache_key_valid = true;
+}
+
+/*
+ * Obtain a hash context for the given callbacks which must be returned with
+ * esdm_hash_ctx_put. The context is NULL if the callbacks do not require an
+ * allocation. A nested request is served with a new allocation.
+ */
+int esdm_hash_ctx_get(const struct esdm_hash_cb *hash_cb, void **ctx)
+{
+	struct esdm_hash_ctx_cache *cache = &esdm_hash_ctx_cache;
+	int ret;
+
+	*ctx = NULL;
+	if (!hash_cb->hash_alloc)
+		return 0;
+
+	pthread_once(&esdm_hash_ctx_cache_once, esdm_hash_ctx_cache_init);
+	if (!esdm_hash_ctx_cache_key_valid || cache->in_use)
+		return hash_cb->hash_alloc(ctx);
+
+	if (cache->hash_cb != hash_cb) {
+		esdm_hash_ctx_cache_release(cache);
+
+		/* Ensure the context is released when the thread terminates */
+		ret = -pthread_setspecific(esdm_hash_ctx_cache_key, cache);
+		if (ret)
+			goto out;
+		CKINT(hash_cb->hash_alloc(&cache->ctx));
+		cache->hash_cb = hash_cb;
+	}
+
+	cache->in_use = true;
+	*ctx = cache->ctx;
+
+out:
+	return ret;
+}
+
+/* Zeroize the hash context and return it to the cache */
+void esdm_hash_ctx_put(const struct esdm_hash_cb *hash_cb, void *ctx)
+{
+	struct esdm_hash_ctx_cache *cache = &esdm_hash_ctx_cache;
+
+	if (!ctx)
+		return;
+
+	hash_cb->hash_desc_zero(ctx);
+	if (cache->in_use && cache->ctx == ctx)
+		cache->in_use = false;
+	else
+		hash_cb->hash_dealloc(ctx);
 }
 
 /************************* Random Number Generation ***************************/
@@ -359,8 +967,7 @@ static time_t esdm_time_after_now(struct timespec *timeout)
 {
 	struct timespec curr;
 
-	if (clock_gettime(CLOCK_MONOTONIC, &curr) == -1)
-		return 0;
+	esdm_drng_time(&curr);
 
 	return esdm_time_after(&curr, timeout) ?
 		       (curr.tv_sec - timeout->tv_sec) :
@@ -372,13 +979,14 @@ void esdm_drng_inject(struct esdm_drng *drng, const uint8_t *inbuf,
 		      size_t inbuflen, bool fully_seeded, const char *drng_type)
 {
 	BUILD_BUG_ON(ESDM_DRNG_RESEED_THRESH > INT_MAX);
+	thread_stack_probe();
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
 		    "seeding %s DRNG with %zu bytes\n", drng_type, inbuflen);
 
 	if (!drng->drng)
 		return;
 
-	if (drng->drng_cb->drng_seed(drng->drng, inbuf, inbuflen) < 0) {
+	if (esdm_drng_cb_seed(drng->drng_cb, drng->drng, inbuf, inbuflen) < 0) {
 		esdm_logger(LOGGER_WARN, LOGGER_C_DRNG,
 			    "seeding of %s DRNG failed\n", drng_type);
 		drng->force_reseed = true;
@@ -401,7 +1009,7 @@ void esdm_drng_inject(struct esdm_drng *drng, const uint8_t *inbuf,
 		} else
 			atomic_add(&drng->requests_since_fully_seeded, gc);
 
-		clock_gettime(CLOCK_MONOTONIC, &drng->last_seeded);
+		esdm_drng_time(&drng->last_seeded);
 		atomic_set(&drng->requests, ESDM_DRNG_RESEED_THRESH);
 		drng->force_reseed = false;
 
@@ -412,6 +1020,10 @@ void esdm_drng_inject(struct esdm_drng *drng, const uint8_t *inbuf,
 					    "%s DRNG fully seeded\n",
 					    drng_type);
 		}
+
+		/* Notify client-side DRNGs to obtain a new seed */
+		if (fully_seeded)
+			esdm_shm_status_new_generation();
 	}
 }
 
@@ -439,6 +1051,8 @@ static uint32_t esdm_drng_seed_es_nolock(struct esdm_drng *drng, bool init_ops,
 	 */
 	memset(&seedbuf, 0, sizeof(seedbuf));
 
+	ESDM_PROBE2(seed_start, drng->node, drng_type);
+
 	do {
 		/* Count the number of ES which delivered entropy */
 		num_es_delivered = 0;
@@ -497,26 +1111,189 @@ static uint32_t esdm_drng_seed_es_nolock(struct esdm_drng *drng, bool init_ops,
 
 	memset_secure(&seedbuf, 0, sizeof(seedbuf));
 
+	ESDM_PROBE2(seed_end, drng->node, collected_entropy);
+
 	return collected_entropy;
 }
 
-static void esdm_drng_seed_es(struct esdm_drng *drng)
+/*
+ * Seed the DRNG from the entropy sources. The entropy is collected into a
+ * shadow DRNG which starts with a seed from the current DRNG state and which is
+ * swapped in once it is seeded. The DRNG lock is only held for obtaining the
+ * current state and for the swap, i.e. generate operations on the DRNG do not
+ * wait for the entropy collection.
+ *
+ * If keep_lock is true, the function returns with the DRNG lock held which
+ * allows the caller to use the injected entropy before any other caller.
+ * The function returns the entropy injected into the DRNG in bits.
+ */
+static uint32_t esdm_drng_seed_es_shadow(struct esdm_drng *drng,
+					 bool keep_lock)
 {
-	mutex_w_lock(&drng->lock);
-	esdm_drng_seed_es_nolock(drng, true, "regular");
-	mutex_w_unlock(&drng->lock);
-}
+	struct esdm_drng shadow;
+	uint8_t chain[ESDM_DRNG_SECURITY_STRENGTH_BYTES]
+		__aligned(ESDM_KCAPI_ALIGN);
+	const struct esdm_drng_cb *drng_cb = drng->drng_cb;
+	void *prev;
+	uint32_t collected_entropy = 0;
+	int requests;
+	ssize_t ret;
+	bool locked = false;
 
-static void esdm_drng_seed(struct esdm_drng *drng)
-{
-	BUILD_BUG_ON(ESDM_MIN_SEED_ENTROPY_BITS >
-		     ESDM_DRNG_SECURITY_STRENGTH_BITS);
+	memset(&shadow, 0, sizeof(shadow));
 
-	/* (Re-)Seed DRNG */
-	esdm_drng_seed_es(drng);
-	/* (Re-)Seed atomic DRNG from regular DRNG */
-	esdm_drng_atomic_seed_drng(drng);
-}
+	if (!drng_cb ||
+	    drng_cb->drng_alloc(&shadow.drng,
+				ESDM_DRNG_SECURITY_STRENGTH_BYTES)) {
+		/* Seed the DRNG itself */
+		mutex_w_lock(&drng->lock);
+		collected_entropy =
+			esdm_drng_seed_es_nolock(drng, true, "regular");
+		if (!keep_lock)
+			mutex_w_unlock(&drng->lock);
+		return collected_entropy;
+	}
+	shadow.drng_cb = drng_cb;
+
+	mutex_w_lock(&drng->lock);
+	if (!drng->drng || drng->drng_cb != drng_cb) {
+		locked = true;
+		goto out;
+	}
+	ret = esdm_drng_cb_generate(drng_cb, drng->drng, chain, sizeof(chain));
+	requests = atomic_read(&drng->requests);
+	atomic_set(&shadow.requests, requests);
+	atomic_set(&shadow.requests_since_fully_seeded,
+		   atomic_read(&drng->requests_since_fully_seeded));
+	atomic_set(&shadow.request_bits_since_fully_seeded,
+		   atomic_read(&drng->request_bits_since_fully_seeded));
+	shadow.fully_seeded = drng->fully_seeded;
+	shadow.force_reseed = drng->force_reseed;
+	mutex_w_unlock(&drng->lock);
+
+	if (ret != (ssize_t)sizeof(chain) ||
+	    esdm_drng_cb_seed(drng_cb, shadow.drng, chain, sizeof(chain)) < 0) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_DRNG,
+			    "initializing shadow DRNG failed\n");
+		drng->force_reseed = true;
+		goto out;
+	}
+
+	collected_entropy = esdm_drng_seed_es_nolock(&shadow, true, "regular");
+
+	mutex_w_lock(&drng->lock);
+	locked = true;
+	if (!drng->drng || drng->drng_cb != drng_cb) {
+		collected_entropy = 0;
+		goto out;
+	}
+
+	/* Swap in the shadow DRNG, the previous state is released below */
+	mutex_lock(&drng->state_lock);
+	prev = drng->drng;
+	drng->drng = shadow.drng;
+	shadow.drng = prev;
+	mutex_unlock(&drng->state_lock);
+
+	/* Account the generate operations during the entropy collection */
+	if (atomic_read(&shadow.requests_since_fully_seeded)) {
+		atomic_add(&shadow.requests_since_fully_seeded,
+			   requests - atomic_read(&drng->requests));
+	}
+	atomic_set(&drng->requests_since_fully_seeded,
+		   atomic_read(&shadow.requests_since_fully_seeded));
+	if (!atomic_read(&shadow.request_bits_since_fully_seeded))
+		atomic_set(&drng->request_bits_since_fully_seeded, 0);
+	atomic_set(&drng->requests, atomic_read(&shadow.requests));
+	drng->last_seeded = shadow.last_seeded;
+	drng->fully_seeded = shadow.fully_seeded;
+	drng->force_reseed = shadow.force_reseed;
+
+out:
+	if (keep_lock && !locked)
+		mutex_w_lock(&drng->lock);
+	else if (!keep_lock && locked)
+		mutex_w_unlock(&drng->lock);
+
+	drng_cb->drng_dealloc(shadow.drng);
+	memset_secure(chain, 0, sizeof(chain));
+	return collected_entropy;
+}
+
+static void esdm_drng_seed_es(struct esdm_drng *drng)
+{
+	esdm_drng_seed_es_shadow(drng, false);
+}
+
+/* Is the DRNG seeded from its parent DRNG instead of the entropy sources? */
+static bool esdm_drng_seeded_from_parent(struct esdm_drng *drng)
+{
+	/* NTG.1 requires each DRNG to be seeded from the entropy sources */
+	return drng->parent && !esdm_ntg1_2024_compliant();
+}
+
+/*
+ * Seed the DRNG from its parent DRNG. The seed inherits the seeding level of
+ * the parent which is seeded from the entropy sources first, if needed.
+ */
+static void esdm_drng_seed_parent(struct esdm_drng *drng)
+{
+	struct esdm_drng *parent = drng->parent;
+	uint8_t seed[ESDM_DRNG_INIT_SEED_SIZE_BYTES] __aligned(ESDM_KCAPI_ALIGN);
+	ssize_t ret;
+	bool fully_seeded;
+
+	if (!parent->fully_seeded || parent->force_reseed)
+		esdm_drng_seed_es(parent);
+
+	mutex_w_lock(&parent->lock);
+	ret = esdm_drng_cb_generate(parent->drng_cb, parent->drng, seed,
+				    sizeof(seed));
+	fully_seeded = parent->fully_seeded;
+	mutex_w_unlock(&parent->lock);
+
+	if (ret != (ssize_t)sizeof(seed)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_DRNG,
+			    "getting seed from parent DRNG failed (%zd)\n",
+			    ret);
+		drng->force_reseed = true;
+		goto out;
+	}
+
+	atomic_add(&parent->request_bits_since_fully_seeded,
+		   (int)sizeof(seed) << 3);
+
+	mutex_w_lock(&drng->lock);
+	esdm_drng_inject(drng, seed, sizeof(seed), fully_seeded, "leaf");
+	mutex_w_unlock(&drng->lock);
+
+out:
+	memset_secure(seed, 0, sizeof(seed));
+}
+
+static void esdm_drng_seed(struct esdm_drng *drng)
+{
+	BUILD_BUG_ON(ESDM_MIN_SEED_ENTROPY_BITS >
+		     ESDM_DRNG_SECURITY_STRENGTH_BITS);
+
+	/* (Re-)Seed DRNG */
+	if (esdm_drng_seeded_from_parent(drng)) {
+		esdm_drng_metric(drng, esdm_drng_m_reseed_parent, 1);
+		esdm_drng_seed_parent(drng);
+	} else {
+		esdm_drng_metric(drng, drng->force_reseed ?
+					       esdm_drng_m_reseed_forced :
+					       esdm_drng_m_reseed_entropy,
+				 1);
+		esdm_drng_seed_es(drng);
+	}
+	/* (Re-)Seed atomic DRNG from regular DRNG */
+	esdm_drng_atomic_seed_drng(drng);
+
+	/* (Re-)Seed the low-latency DRNG from the DRNG */
+	if (drng->small && drng->fully_seeded)
+		esdm_drng_seed(drng->small);
+}
 
 static void esdm_drng_seed_work_one(struct esdm_drng *drng, uint32_t node)
 {
@@ -525,22 +1302,31 @@ static void esdm_drng_seed_work_one(struct esdm_drng *drng, uint32_t node)
 		    node);
 	esdm_drng_seed(drng);
 	if (drng->fully_seeded) {
-		/* Prevent reseed storm */
-		drng->last_seeded.tv_sec += node * 60;
+		/*
+		 * Prevent reseed storm: the DRNGs seeded together are due for
+		 * their next reseed spread evenly over the reseed interval.
+		 */
+		drng->last_seeded.tv_sec +=
+			(time_t)(((uint64_t)node * esdm_drng_reseed_max_time) /
+				 max_uint32(esdm_config_online_nodes(), 1));
 	}
 }
 
 /**
- * @brief Seeding of one not yet fully seeded DRNG
+ * @brief Seeding of the not yet fully seeded DRNGs
  *
- * Perform the seeding of a DRNG. The code seeds one DRNG that is currently
- * not (fully) seeded. The logic picks the DRNG to be seeded.
+ * Perform the seeding of the DRNGs that are currently not (fully) seeded. All
+ * node DRNGs are seeded in one pass as long as the entropy sources deliver
+ * enough entropy to fully seed them. The pass stops at the first DRNG which
+ * cannot be fully seeded, the remaining ones are seeded with the next trigger.
+ * Of the prediction resistance DRNGs, one DRNG is seeded per invocation.
  *
  * @param [in] force Apply the forced seeding operation.
  */
 static void __esdm_drng_seed_work(bool force)
 {
 	struct esdm_drng **esdm_drng;
+	unsigned int i;
 
 	/*
 	 * If the DRNG is not yet initialized, let us try to seed the atomic
@@ -572,15 +1358,19 @@ static void __esdm_drng_seed_work(bool force)
 		for_each_online_node (node) {
 			struct esdm_drng *drng = esdm_drng[node];
 
-			if (!drng)
+			if (!drng || drng->fully_seeded)
 				continue;
 
-			if (drng && !drng->fully_seeded) {
-				/* return code does not matter */
-				drng->force_reseed |= force;
-				esdm_drng_seed_work_one(drng, node);
+			/* return code does not matter */
+			drng->force_reseed |= force;
+			esdm_drng_seed_work_one(drng, node);
+
+			/*
+			 * Entropy sources are exhausted, seed the remaining
+			 * DRNGs with the next trigger.
+			 */
+			if (!drng->fully_seeded)
 				goto out;
-			}
 		}
 	} else {
 		if (!esdm_drng_init.fully_seeded) {
@@ -590,10 +1380,12 @@ static void __esdm_drng_seed_work(bool force)
 		}
 	}
 
-	if (!esdm_drng_pr.fully_seeded) {
-		esdm_drng_pr.force_reseed |= force;
-		esdm_drng_seed_work_one(&esdm_drng_pr, 0);
-		goto out;
+	for_each_pr_drng (i) {
+		if (!esdm_drng_pr[i].fully_seeded) {
+			esdm_drng_pr[i].force_reseed |= force;
+			esdm_drng_seed_work_one(&esdm_drng_pr[i], 0);
+			goto out;
+		}
 	}
 
 	esdm_pool_all_nodes_seeded(true);
@@ -621,13 +1413,17 @@ void esdm_drng_seed_work(void)
  */
 static bool esdm_drng_check_disable_threshold(struct esdm_drng *drng)
 {
-	bool request_limit_reached =
+	struct esdm_config_snapshot snap;
+	bool request_limit_reached, bit_limit_reached;
+
+	esdm_config_snapshot(&snap);
+	request_limit_reached =
 		atomic_read_u32(&drng->requests_since_fully_seeded) >=
-		esdm_config_drng_max_wo_reseed();
-	bool bit_limit_reached =
-		(esdm_config_drng_max_wo_reseed_bits() != UINT32_MAX) &&
+		snap.drng_max_wo_reseed;
+	bit_limit_reached =
+		(snap.drng_max_wo_reseed_bits != UINT32_MAX) &&
 		(atomic_read_u32(&drng->request_bits_since_fully_seeded) >=
-		 esdm_config_drng_max_wo_reseed_bits());
+		 snap.drng_max_wo_reseed_bits);
 
 	return request_limit_reached || bit_limit_reached;
 }
@@ -646,6 +1442,9 @@ void esdm_drng_force_reseed(void)
 	 */
 	if (!esdm_drng || esdm_drng_check_disable_threshold(&esdm_drng_init)) {
 		esdm_drng_init.force_reseed = esdm_drng_init.fully_seeded;
+		if (esdm_drng_init.small)
+			esdm_drng_init.small->force_reseed =
+				esdm_drng_init.small->fully_seeded;
 		esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
 			    "force reseed of initial DRNG\n");
 		goto out;
@@ -658,6 +1457,8 @@ void esdm_drng_force_reseed(void)
 			continue;
 
 		drng->force_reseed = drng->fully_seeded;
+		if (drng->small)
+			drng->small->force_reseed = drng->small->fully_seeded;
 		esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
 			    "force reseed of DRNG on CPU %u\n", node);
 	}
@@ -665,10 +1466,24 @@ void esdm_drng_force_reseed(void)
 	esdm_drng_atomic_force_reseed();
 
 out:
+	/* Thread-owned and client-side DRNGs shall reseed as well */
+	atomic_inc(&esdm_drng_epoch);
+	esdm_shm_status_new_generation();
 	esdm_drng_put_instances();
 }
 
-static bool esdm_drng_must_reseed(struct esdm_drng *drng)
+static void esdm_drng_reseeder_wakeup(void)
+{
+	atomic_set(&esdm_reseed_requested, 1);
+	thread_wake_all(&esdm_reseed_wait);
+}
+
+/*
+ * Account the given number of generate operations and check whether the DRNG
+ * requires a reseed. The operations are accounted in batches, a value of zero
+ * only checks the remaining reseed conditions.
+ */
+static bool esdm_drng_must_reseed(struct esdm_drng *drng, uint32_t ops)
 {
 	struct timespec check_time = drng->last_seeded;
 	bool request_bits_since_fully_seeded_reached =
@@ -676,28 +1491,823 @@ static bool esdm_drng_must_reseed(struct esdm_drng *drng)
 		(atomic_read_u32(&drng->request_bits_since_fully_seeded) >=
 		 ESDM_DRNG_RESEED_THRESH_BITS);
 
+	if (ops) {
+		int left = atomic_sub(&drng->requests, (int)ops);
+
+		/* Trigger once when the threshold is crossed */
+		if (left <= 0 && left + (int)ops > 0)
+			return true;
+	}
+
 	check_time.tv_sec += esdm_drng_reseed_max_time;
-	return (atomic_dec_and_test(&drng->requests) || drng->force_reseed ||
-		request_bits_since_fully_seeded_reached ||
+	return (drng->force_reseed || request_bits_since_fully_seeded_reached ||
 		esdm_time_after_now(&check_time));
 }
 
-/**
- * @brief Get random data out of the DRNG which is reseeded frequently.
+static void esdm_drng_reseed_if_needed(struct esdm_drng *drng, uint32_t ops)
+{
+	if (!esdm_drng_must_reseed(drng, ops))
+		return;
+
+	/* Let the reseeder perform the reseed in the background */
+	if (atomic_read(&esdm_reseeder_active)) {
+		if (!atomic_cmpxchg(&drng->reseed_pending, 0, 1))
+			esdm_drng_reseeder_wakeup();
+		return;
+	}
+
+	if (!esdm_pool_trylock()) {
+		/*
+		 * Entropy pool cannot be locked, try to reseed next time, but
+		 * continue to generate random bits.
+		 */
+		drng->force_reseed = true;
+	} else {
+		/* Perform synchronous reseed */
+		esdm_drng_seed(drng);
+		esdm_pool_unlock();
+	}
+}
+
+static void esdm_drng_reseed_pending(struct esdm_drng *drng)
+{
+	/* The low-latency DRNG requests its reseeds on its own */
+	if (drng->small)
+		esdm_drng_reseed_pending(drng->small);
+
+	if (atomic_cmpxchg(&drng->reseed_pending, 1, 0) != 1)
+		return;
+
+	esdm_pool_lock();
+	esdm_drng_seed(drng);
+	esdm_pool_unlock();
+}
+
+#if (ESDM_DRNG_EARLY_RESEED_PERCENT > 0)
+
+/*
+ * Early reseed: a DRNG approaching its reseed thresholds is reseeded by the
+ * reseeder thread so that the reseed does not fall on a generate request.
+ */
+static bool esdm_drng_early_reseed_due(struct esdm_drng *drng)
+{
+	struct timespec check_time = drng->last_seeded;
+
+	BUILD_BUG_ON(ESDM_DRNG_EARLY_RESEED_PERCENT > 100);
+
+	/* Not fully seeded DRNGs are served by the regular seeding */
+	if (!drng->fully_seeded || drng->force_reseed ||
+	    atomic_read(&drng->reseed_pending))
+		return false;
+
+	if (atomic_read(&drng->requests) <=
+	    (int)(((uint64_t)ESDM_DRNG_RESEED_THRESH *
+		   (100 - ESDM_DRNG_EARLY_RESEED_PERCENT)) /
+		  100))
+		return true;
+
+	check_time.tv_sec +=
+		(time_t)(((uint64_t)esdm_drng_reseed_max_time *
+			  ESDM_DRNG_EARLY_RESEED_PERCENT) /
+			 100);
+	return esdm_time_after_now(&check_time) > 0;
+}
+
+/*
+ * Check one node DRNG per invocation for an early reseed, the nodes are
+ * visited in turn to spread the reseeds over the reseeder passes.
+ */
+static void esdm_drng_early_reseed(struct esdm_drng **esdm_drng)
+{
+	static uint32_t esdm_early_reseed_node;
+	struct esdm_drng *drng;
+	uint32_t node;
+
+	if (!esdm_drng) {
+		drng = &esdm_drng_init;
+		node = 0;
+	} else {
+		node = esdm_early_reseed_node++ %
+		       max_uint32(esdm_config_online_nodes(), 1);
+		drng = esdm_drng[node];
+		if (!drng)
+			return;
+	}
+
+	if (!esdm_drng_early_reseed_due(drng))
+		return;
+
+	/* Leave the entropy to live requests if the pool is busy or drained */
+	if (esdm_avail_entropy() < esdm_security_strength())
+		return;
+	if (!esdm_pool_trylock())
+		return;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+		    "early reseed of DRNG on node %u\n", node);
+	esdm_drng_seed(drng);
+	esdm_pool_unlock();
+}
+
+/* Jitter of the reseeder pass interval of 1s +/- 250ms */
+static void esdm_drng_early_reseed_jitter(struct timespec *ts)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ts->tv_sec = 0;
+	ts->tv_nsec = 750000000L + (now.tv_nsec % 500000000L);
+}
+
+#else /* ESDM_DRNG_EARLY_RESEED_PERCENT */
+
+static inline void esdm_drng_early_reseed(struct esdm_drng **esdm_drng)
+{
+	(void)esdm_drng;
+}
+
+static inline void esdm_drng_early_reseed_jitter(struct timespec *ts)
+{
+	(void)ts;
+}
+
+#endif /* ESDM_DRNG_EARLY_RESEED_PERCENT */
+
+/*
+ * Seed the PR DRNG from a block of an entropy source credited with full
+ * entropy without accessing the other entropy sources, see
+ * esdm_fill_seed_buffer_full. The function returns the entropy injected into
+ * the DRNG in bits or 0 if no such block is available.
  *
- * @param [in] drng DRNG instance
- * @param [in] outbuf buffer for storing random data
- * @param [in] outbuflen length of outbuf
+ * The caller must hold the DRNG lock.
+ */
+static uint32_t esdm_drng_pr_full_seed(struct esdm_drng *drng)
+{
+	struct entropy_buf seedbuf __aligned(ESDM_KCAPI_ALIGN);
+	uint32_t ent_bits;
+
+	/* The entropy of the other entropy sources is zero */
+	memset(&seedbuf, 0, sizeof(seedbuf));
+
+	if (!esdm_fill_seed_buffer_full(
+		    &seedbuf, esdm_get_seed_entropy_osr(drng->fully_seeded)))
+		return 0;
+
+	ent_bits = esdm_entropy_rate_eb(&seedbuf);
+	esdm_drng_inject(drng, (uint8_t *)&seedbuf, sizeof(seedbuf),
+			 esdm_fully_seeded(drng->fully_seeded, ent_bits,
+					   &seedbuf),
+			 "full entropy");
+	memset_secure(&seedbuf, 0, sizeof(seedbuf));
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+		    "PR DRNG seeded from full entropy source with %u bits\n",
+		    ent_bits);
+
+	return ent_bits;
+}
+
+#if (ESDM_DRNG_PR_PREFETCH_BLOCKS > 0)
+
+/*
+ * Seed blocks for the prediction resistance DRNGs filled by the reseeder. A
+ * block holds the complete seed buffer of all entropy sources and is used for
+ * exactly one reseed of a PR DRNG.
+ */
+static struct entropy_buf esdm_pr_prefetch[ESDM_DRNG_PR_PREFETCH_BLOCKS]
+	__aligned(ESDM_KCAPI_ALIGN);
+
+enum esdm_pr_prefetch_state {
+	esdm_pr_prefetch_empty,
+	esdm_pr_prefetch_filling,
+	esdm_pr_prefetch_filled,
+	esdm_pr_prefetch_reading,
+};
+static volatile enum esdm_pr_prefetch_state
+	esdm_pr_prefetch_set[ESDM_DRNG_PR_PREFETCH_BLOCKS];
+
+static atomic_t esdm_pr_prefetch_next = ATOMIC_INIT(0);
+
+/* Fill the empty seed blocks - called by the reseeder */
+static void esdm_drng_pr_prefetch_fill(void)
+{
+	unsigned int i;
+
+	/*
+	 * Until the ESDM is fully seeded, the PR DRNGs shall use the entropy
+	 * collected at the time of the request.
+	 */
+	if (!esdm_state_fully_seeded())
+		return;
+
+	for (i = 0; i < ESDM_DRNG_PR_PREFETCH_BLOCKS; i++) {
+		struct entropy_buf *eb = &esdm_pr_prefetch[i];
+		uint32_t ent_bits;
+
+		if (__sync_val_compare_and_swap(&esdm_pr_prefetch_set[i],
+						esdm_pr_prefetch_empty,
+						esdm_pr_prefetch_filling) !=
+		    esdm_pr_prefetch_empty)
+			continue;
+
+		/* A PR DRNG is never fully seeded when it requests a seed */
+		esdm_pool_lock();
+		esdm_fill_seed_buffer(eb, esdm_get_seed_entropy_osr(false),
+				      false);
+		esdm_pool_unlock();
+
+		ent_bits = esdm_entropy_rate_eb(eb);
+		if (!ent_bits) {
+			/* The ES are depleted, try again later */
+			esdm_pr_prefetch_set[i] = esdm_pr_prefetch_empty;
+			break;
+		}
+
+		esdm_pr_prefetch_set[i] = esdm_pr_prefetch_filled;
+
+		esdm_logger(
+			LOGGER_DEBUG, LOGGER_C_DRNG,
+			"PR DRNG seed block %u filled with %u bits of entropy\n",
+			i, ent_bits);
+	}
+}
+
+/*
+ * Seed the PR DRNG from a pre-fetched seed block. The function returns the
+ * entropy injected into the DRNG in bits or 0 if no block is filled.
  *
- * @return
- * * < 0 in error case (DRNG generation or update failed)
- * * >=0 returning the returned number of bytes
+ * The caller must hold the DRNG lock.
  */
-static ssize_t esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
-			     size_t outbuflen)
+static uint32_t esdm_drng_pr_prefetch_seed(struct esdm_drng *drng)
+{
+	unsigned int i, slot,
+		start = (unsigned int)atomic_inc(&esdm_pr_prefetch_next);
+	uint32_t ent_bits;
+
+	for (i = 0; i < ESDM_DRNG_PR_PREFETCH_BLOCKS; i++) {
+		slot = (start + i) % ESDM_DRNG_PR_PREFETCH_BLOCKS;
+
+		if (__sync_val_compare_and_swap(&esdm_pr_prefetch_set[slot],
+						esdm_pr_prefetch_filled,
+						esdm_pr_prefetch_reading) ==
+		    esdm_pr_prefetch_filled)
+			break;
+	}
+
+	if (i == ESDM_DRNG_PR_PREFETCH_BLOCKS) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+			    "PR DRNG seed blocks exhausted\n");
+		if (atomic_read(&esdm_reseeder_active))
+			esdm_drng_reseeder_wakeup();
+		return 0;
+	}
+
+	ent_bits = esdm_entropy_rate_eb(&esdm_pr_prefetch[slot]);
+	esdm_drng_inject(drng, (uint8_t *)&esdm_pr_prefetch[slot],
+			 sizeof(struct entropy_buf),
+			 esdm_fully_seeded(drng->fully_seeded, ent_bits,
+					   &esdm_pr_prefetch[slot]),
+			 "prefetched");
+
+	memset_secure(&esdm_pr_prefetch[slot], 0, sizeof(struct entropy_buf));
+	esdm_pr_prefetch_set[slot] = esdm_pr_prefetch_empty;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+		    "PR DRNG seeded from seed block %u\n", slot);
+
+	/* Let the reseeder refill the block */
+	esdm_drng_reseeder_wakeup();
+
+	return ent_bits;
+}
+
+/* Wipe the filled seed blocks when the reseeder stops */
+static void esdm_drng_pr_prefetch_fini(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ESDM_DRNG_PR_PREFETCH_BLOCKS; i++) {
+		if (__sync_val_compare_and_swap(&esdm_pr_prefetch_set[i],
+						esdm_pr_prefetch_filled,
+						esdm_pr_prefetch_reading) !=
+		    esdm_pr_prefetch_filled)
+			continue;
+
+		memset_secure(&esdm_pr_prefetch[i], 0,
+			      sizeof(struct entropy_buf));
+		esdm_pr_prefetch_set[i] = esdm_pr_prefetch_empty;
+	}
+}
+
+#else /* ESDM_DRNG_PR_PREFETCH_BLOCKS */
+
+static inline void esdm_drng_pr_prefetch_fill(void)
+{
+}
+
+static inline uint32_t esdm_drng_pr_prefetch_seed(struct esdm_drng *drng)
+{
+	(void)drng;
+	return 0;
+}
+
+static inline void esdm_drng_pr_prefetch_fini(void)
+{
+}
+
+#endif /* ESDM_DRNG_PR_PREFETCH_BLOCKS */
+
+/*
+ * Reseeder loop serving the reseed requests of esdm_drng_reseed_if_needed and
+ * performing the early reseeds
+ */
+int esdm_drng_mgr_reseeder(void)
+{
+	struct timespec ts = { .tv_sec = 1, .tv_nsec = 0 };
+
+	atomic_set(&esdm_reseeder_active, 1);
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG, "DRNG reseeder started\n");
+
+	while (!atomic_read(&esdm_drng_mgr_terminate)) {
+		struct esdm_drng **esdm_drng;
+		uint32_t node;
+		int ret = 0;
+
+		atomic_set(&esdm_reseed_requested, 0);
+
+		esdm_drng = esdm_drng_get_instances();
+		if (esdm_drng) {
+			for_each_online_node (node) {
+				if (esdm_drng[node])
+					esdm_drng_reseed_pending(
+						esdm_drng[node]);
+			}
+		} else {
+			esdm_drng_reseed_pending(&esdm_drng_init);
+		}
+		esdm_drng_early_reseed(esdm_drng);
+		esdm_drng_put_instances();
+
+		esdm_drng_pr_prefetch_fill();
+		esdm_drng_early_reseed_jitter(&ts);
+
+		/* The timeout covers a wakeup before waiting */
+		thread_timedwait_event(
+			&esdm_reseed_wait,
+			(atomic_read(&esdm_reseed_requested) ||
+			 atomic_read(&esdm_drng_mgr_terminate)),
+			&ts);
+	}
+
+	atomic_set(&esdm_reseeder_active, 0);
+	esdm_drng_pr_prefetch_fini();
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG, "DRNG reseeder stopped\n");
+
+	return 0;
+}
+
+/*
+ * Resume handling: the suspend signal marks the DRNG states as stale. The
+ * first resume notification afterwards reseeds all DRNGs in one pass while
+ * the generate requests wait for the pass to complete.
+ */
+static atomic_t esdm_drng_suspended = ATOMIC_INIT(0);
+static atomic_t esdm_drng_resume_active = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE(esdm_drng_resume_wait);
+
+/* Called from the suspend signal handler */
+void esdm_drng_suspend(void)
+{
+	atomic_set(&esdm_drng_suspended, 1);
+}
+
+static void esdm_drng_resume_seed(struct esdm_drng *drng)
+{
+	drng->force_reseed = drng->fully_seeded;
+	esdm_drng_seed(drng);
+}
+
+DSO_PUBLIC
+int esdm_drng_resume(void)
+{
+	struct esdm_drng **esdm_drng;
+	struct timespec start, end;
+	uint32_t node;
+
+	if (atomic_cmpxchg(&esdm_drng_suspended, 1, 0) != 1)
+		return 0;
+
+	/* Before the initial seeding, the regular seeding applies */
+	if (!esdm_get_available())
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	atomic_set(&esdm_drng_resume_active, 1);
+	esdm_pool_lock();
+
+	/* Entropy pre-fetched before the suspend must not be used */
+	esdm_drng_pr_prefetch_fini();
+
+	/*
+	 * The node DRNGs are seeded in ascending order, i.e. a parent DRNG is
+	 * seeded from the entropy sources before its leaves are seeded from
+	 * it. The atomic DRNG is seeded along with the DRNG it is linked to.
+	 * The PR DRNGs are seeded from the entropy sources with every request
+	 * and need no reseed.
+	 */
+	esdm_drng = esdm_drng_get_instances();
+	if (esdm_drng) {
+		for_each_online_node (node) {
+			if (esdm_drng[node])
+				esdm_drng_resume_seed(esdm_drng[node]);
+		}
+	} else {
+		esdm_drng_resume_seed(&esdm_drng_init);
+	}
+	esdm_drng_put_instances();
+
+	esdm_pool_unlock();
+	atomic_set(&esdm_drng_resume_active, 0);
+	thread_wake_all(&esdm_drng_resume_wait);
+
+	/* Thread-owned and client-side DRNGs shall reseed as well */
+	atomic_inc(&esdm_drng_epoch);
+	esdm_shm_status_new_generation();
+
+	/* Let the reseeder refill the seed blocks of the PR DRNGs */
+	if (atomic_read(&esdm_reseeder_active))
+		esdm_drng_reseeder_wakeup();
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_DRNG,
+		    "all DRNGs reseeded after resume in %lld us\n",
+		    (long long)(end.tv_sec - start.tv_sec) * 1000000LL +
+			    (end.tv_nsec - start.tv_nsec) / 1000);
+
+	return 1;
+}
+
+/* Wait for the reseed after a resume, at most ESDM_DRNG_RESUME_GATE_MS */
+static void esdm_drng_resume_gate(void)
+{
+	struct timespec ts = {
+		.tv_sec = ESDM_DRNG_RESUME_GATE_MS / 1000,
+		.tv_nsec = (ESDM_DRNG_RESUME_GATE_MS % 1000) * 1000000L
+	};
+	int ret = 0;
+
+	if (!atomic_read(&esdm_drng_resume_active))
+		return;
+
+	thread_timedwait_event(&esdm_drng_resume_wait,
+			       !atomic_read(&esdm_drng_resume_active), &ts);
+}
+
+/*
+ * Combining of small requests: a thread which cannot obtain the DRNG lock
+ * publishes its request in a free slot. The lock holder serves all published
+ * requests with one generate operation and hands out disjoint slices of the
+ * output. This saves both, the lock handoffs and the per-call overhead of the
+ * DRNG, such as the state update after each generate operation.
+ *
+ * The slices of one generate operation are as independent from each other as
+ * the consecutive output of the DRNG is.
+ */
+enum esdm_drng_combine_state {
+	esdm_drng_combine_free,
+	esdm_drng_combine_reserved,
+	esdm_drng_combine_pending,
+	esdm_drng_combine_serving,
+	esdm_drng_combine_done,
+};
+
+/* Number of polls of a published request before blocking on the lock */
+#define ESDM_DRNG_COMBINE_SPINS 64
+
+/* Serve the published requests - the caller must hold the DRNG lock */
+static void esdm_drng_combine_serve(struct esdm_drng *drng)
+{
+	struct esdm_drng_combine_req *served[ESDM_DRNG_COMBINE_SLOTS];
+	uint8_t buf[ESDM_DRNG_COMBINE_SLOTS * ESDM_DRNG_COMBINE_REQSIZE];
+	uint32_t i, num = 0, len = 0, offset = 0;
+	ssize_t ret;
+
+	BUILD_BUG_ON(ESDM_DRNG_COMBINE_SLOTS * ESDM_DRNG_COMBINE_REQSIZE >
+		     ESDM_DRNG_MAX_REQSIZE);
+
+	for (i = 0; i < ESDM_DRNG_COMBINE_SLOTS; i++) {
+		struct esdm_drng_combine_req *req = &drng->combine[i];
+
+		if (atomic_cmpxchg(&req->state, esdm_drng_combine_pending,
+				   esdm_drng_combine_serving) !=
+		    esdm_drng_combine_pending)
+			continue;
+
+		served[num++] = req;
+		len += req->len;
+	}
+
+	if (!num)
+		return;
+
+	ret = esdm_drng_cb_generate(drng->drng_cb, drng->drng, buf, len);
+	if (ret == (ssize_t)len) {
+		atomic_add(&drng->request_bits_since_fully_seeded,
+			   (int)len << 3);
+	} else {
+		esdm_logger(LOGGER_WARN, LOGGER_C_DRNG,
+			    "getting random data from DRNG failed (%zd)\n",
+			    ret);
+	}
+
+	for (i = 0; i < num; i++) {
+		struct esdm_drng_combine_req *req = served[i];
+
+		if (ret == (ssize_t)len) {
+			memcpy(req->buf, buf + offset, req->len);
+			req->ret = req->len;
+			offset += req->len;
+		} else {
+			req->ret = -EFAULT;
+		}
+
+		/* Hand over the result to the waiting thread */
+		atomic_set(&req->state, esdm_drng_combine_done);
+	}
+
+	memset_secure(buf, 0, len);
+}
+
+/*
+ * Publish a request and wait for it to be served. If the request is not served
+ * by another thread, false is returned with the DRNG lock held.
+ */
+static bool esdm_drng_combine_wait(struct esdm_drng *drng, uint8_t *outbuf,
+				   uint32_t len, ssize_t *ret)
+{
+	struct esdm_drng_combine_req *req = NULL;
+	unsigned int i;
+	bool locked = false;
+
+	/* Fast path: the DRNG is not in use */
+	if (mutex_w_trylock(&drng->lock))
+		return false;
+	esdm_drng_metric(drng, esdm_drng_m_lock_contended, 1);
+
+	for (i = 0; i < ESDM_DRNG_COMBINE_SLOTS; i++) {
+		if (atomic_cmpxchg(&drng->combine[i].state,
+				   esdm_drng_combine_free,
+				   esdm_drng_combine_reserved) ==
+		    esdm_drng_combine_free) {
+			req = &drng->combine[i];
+			break;
+		}
+	}
+
+	/* All slots are in use */
+	if (!req) {
+		mutex_w_lock(&drng->lock);
+		return false;
+	}
+
+	req->buf = outbuf;
+	req->len = len;
+	req->ret = 0;
+	atomic_set(&req->state, esdm_drng_combine_pending);
+
+	for (i = 0; !locked; i++) {
+		if (atomic_read(&req->state) == esdm_drng_combine_done)
+			break;
+
+		if (i < ESDM_DRNG_COMBINE_SPINS) {
+			if (!mutex_w_trylock(&drng->lock)) {
+				sched_yield();
+				continue;
+			}
+		} else {
+			mutex_w_lock(&drng->lock);
+		}
+
+		/*
+		 * With the lock held, no other thread serves requests: the
+		 * request is either still pending or already served.
+		 */
+		if (atomic_cmpxchg(&req->state, esdm_drng_combine_pending,
+				   esdm_drng_combine_free) ==
+		    esdm_drng_combine_pending)
+			return false;
+
+		locked = true;
+	}
+
+	if (locked)
+		mutex_w_unlock(&drng->lock);
+
+	*ret = req->ret;
+	atomic_set(&req->state, esdm_drng_combine_free);
+
+	return true;
+}
+
+enum esdm_drng_lat_stage {
+	esdm_drng_lat_lock_wait,
+	esdm_drng_lat_generate,
+	esdm_drng_lat_num,
+};
+
+static struct esdm_lat_registry esdm_drng_lat =
+	ESDM_LAT_REGISTRY_INIT(esdm_drng_lat_num);
+
+void esdm_drng_lat_status(char *buf, size_t buflen)
+{
+	static const char *const names[esdm_drng_lat_num] = {
+		[esdm_drng_lat_lock_wait] = "lock wait",
+		[esdm_drng_lat_generate] = "generate",
+	};
+	size_t len = 0, hdr;
+	unsigned int i;
+
+	if (!buflen)
+		return;
+
+	hdr = (size_t)snprintf(buf, buflen, "DRNG latency:\n");
+	if (hdr >= buflen)
+		return;
+
+	for (i = 0; i < esdm_drng_lat_num; i++)
+		len += esdm_lat_report(&esdm_drng_lat, i, names[i],
+				       buf + hdr + len, buflen - hdr - len);
+
+	/* Do not print the header if nothing was recorded */
+	if (!len)
+		buf[0] = '\0';
+}
+
+static void esdm_drng_status_bin_one(struct esdm_drng *drng, uint32_t node,
+				     struct timespec *now,
+				     struct esdm_status_bin_drng *drng_bin)
+{
+	struct timespec seeded = drng->last_seeded;
+	uint64_t age_ms = 0;
+
+	if (esdm_time_after(now, &seeded)) {
+		age_ms = (uint64_t)((int64_t)(now->tv_sec - seeded.tv_sec) *
+					    1000 +
+				    (now->tv_nsec - seeded.tv_nsec) / 1000000);
+	}
+
+	drng_bin->node = node;
+	drng_bin->fully_seeded = drng->fully_seeded;
+	drng_bin->requests_since_fully_seeded =
+		atomic_read_u32(&drng->requests_since_fully_seeded);
+	drng_bin->bits_since_fully_seeded =
+		atomic_read_u32(&drng->request_bits_since_fully_seeded);
+	drng_bin->seeded_age_ms = age_ms;
+}
+
+/* Fill the DRNG entries of the binary status */
+void esdm_drng_status_bin(struct esdm_status_bin *status)
+{
+	struct esdm_drng **esdm_drng = esdm_drng_get_instances();
+	struct timespec now;
+	uint32_t node;
+
+	esdm_drng_time(&now);
+
+	status->drng_num = 1;
+	esdm_drng_status_bin_one(&esdm_drng_init, ESDM_STATUS_BIN_NODE_INIT,
+				 &now, &status->drng[0]);
+
+	if (!esdm_drng)
+		goto out;
+
+	for_each_online_node (node) {
+		struct esdm_drng *drng = esdm_drng[node];
+
+		if (!drng || drng == &esdm_drng_init)
+			continue;
+
+		if (status->drng_num >= ESDM_STATUS_BIN_DRNG_MAX) {
+			status->flags |= ESDM_STATUS_BIN_DRNG_TRUNCATED;
+			break;
+		}
+
+		esdm_drng_status_bin_one(drng, node, &now,
+					 &status->drng[status->drng_num++]);
+	}
+
+out:
+	esdm_drng_put_instances();
+}
+
+#ifdef ESDM_METRICS
+
+static void esdm_drng_metrics_family(struct esdm_metrics_buf *mb,
+				     const char *family, const char *help,
+				     enum esdm_drng_metric first,
+				     enum esdm_drng_metric last,
+				     const char *const *reasons)
+{
+	unsigned int slot, m;
+
+	esdm_metrics_printf(mb, "# TYPE %s counter\n# HELP %s %s\n", family,
+			    family, help);
+
+	for (slot = 0; slot <= ESDM_DRNG_METRICS_PR; slot++) {
+		char drng[16];
+
+		if (slot == ESDM_DRNG_METRICS_PR)
+			snprintf(drng, sizeof(drng), "pr");
+		else if (slot < esdm_config_online_nodes())
+			snprintf(drng, sizeof(drng), "node%u", slot);
+		else
+			continue;
+
+		for (m = first; m <= last; m++) {
+			uint64_t val = esdm_metrics_read(
+				&esdm_drng_metrics_ctr,
+				slot * esdm_drng_m_num + m);
+
+			if (reasons) {
+				esdm_metrics_printf(
+					mb,
+					"%s_total{drng=\"%s\",reason=\"%s\"} %llu\n",
+					family, drng, reasons[m - first],
+					(unsigned long long)val);
+			} else {
+				esdm_metrics_printf(mb,
+						    "%s_total{drng=\"%s\"} %llu\n",
+						    family, drng,
+						    (unsigned long long)val);
+			}
+		}
+	}
+}
+
+void esdm_drng_metrics(struct esdm_metrics_buf *mb)
+{
+	static const char *const reasons[] = { "entropy", "forced", "parent",
+					       "pr" };
+	static const char *const lat_names[esdm_drng_lat_num] = {
+		[esdm_drng_lat_lock_wait] = "stage=\"lock_wait\"",
+		[esdm_drng_lat_generate] = "stage=\"generate\"",
+	};
+	unsigned int i;
+
+	esdm_drng_metrics_family(mb, "esdm_drng_generated_bytes",
+				 "Random bytes generated by the DRNG",
+				 esdm_drng_m_bytes, esdm_drng_m_bytes, NULL);
+	esdm_drng_metrics_family(mb, "esdm_drng_reseeds",
+				 "Reseed operations of the DRNG",
+				 esdm_drng_m_reseed_entropy,
+				 esdm_drng_m_reseed_pr, reasons);
+	esdm_drng_metrics_family(mb, "esdm_drng_lock_contended",
+				 "Generate requests finding the DRNG locked",
+				 esdm_drng_m_lock_contended,
+				 esdm_drng_m_lock_contended, NULL);
+
+#ifdef ESDM_LATENCY_STATS
+	esdm_metrics_printf(mb, "# TYPE esdm_drng_latency_seconds histogram\n"
+				"# HELP esdm_drng_latency_seconds Latency of "
+				"the DRNG operations\n");
+	for (i = 0; i < esdm_drng_lat_num; i++)
+		esdm_lat_openmetrics(&esdm_drng_lat, i,
+				     "esdm_drng_latency_seconds", lat_names[i],
+				     mb);
+#else
+	(void)lat_names;
+	(void)i;
+#endif
+}
+
+#endif /* ESDM_METRICS */
+
+/* Allocations and system calls of the generate requests */
+static struct esdm_audit_stat esdm_drng_audit;
+
+void esdm_drng_audit_status(char *buf, size_t buflen)
+{
+	size_t hdr;
+
+	if (!buflen)
+		return;
+
+	hdr = (size_t)snprintf(buf, buflen, "DRNG hot path audit:\n");
+	if (hdr >= buflen)
+		return;
+
+	/* Do not print the header if nothing was recorded */
+	if (!esdm_audit_report(&esdm_drng_audit, "esdm_drng_get", buf + hdr,
+			       buflen - hdr))
+		buf[0] = '\0';
+}
+
+static ssize_t __esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
+			       size_t outbuflen)
 {
 	ssize_t processed = 0;
-	bool pr = (drng == &esdm_drng_pr) ? true : false;
+	uint32_t batch = 0;
+	bool pr = esdm_drng_is_pr(drng);
 
 	if (!outbuf || !outbuflen)
 		return 0;
@@ -720,27 +2330,48 @@ static ssize_t esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
 
 	/* Loop to collect random bits for the caller. */
 	while (outbuflen) {
-		uint32_t todo =
-			min_uint32((uint32_t)outbuflen, ESDM_DRNG_MAX_REQSIZE);
+		uint32_t reqsize = esdm_drng_reqsize(), ops = 0;
+		uint32_t todo = min_uint32((uint32_t)outbuflen, reqsize);
 		ssize_t ret;
+		uint64_t lat;
+		bool concurrent;
 
 		/* In normal operation, check whether to reseed */
-		if (!pr && esdm_drng_must_reseed(drng)) {
-			if (!esdm_pool_trylock()) {
-				/*
-				 * Entropy pool cannot be locked, try to reseed
-				 * next time, but continue to generate random
-				 * bits.
-				 */
-				drng->force_reseed = true;
-			} else {
-				/* Perform synchronous reseed */
-				esdm_drng_seed(drng);
-				esdm_pool_unlock();
+		if (!pr) {
+			/* Account the next generate operations in one batch */
+			if (!batch) {
+				ops = (uint32_t)min_size(
+					(outbuflen + reqsize - 1) / reqsize,
+					ESDM_DRNG_RESEED_BATCH);
+				batch = ops;
 			}
+			batch--;
+			esdm_drng_reseed_if_needed(drng, ops);
 		}
 
-		mutex_w_lock(&drng->lock);
+		concurrent = !pr && drng->drng_cb->drng_concurrent;
+
+		lat = esdm_lat_now();
+		if (concurrent) {
+			/* The DRNG handles concurrent generate operations */
+			mutex_reader_lock(&drng->state_lock);
+		} else if (!pr && todo <= ESDM_DRNG_COMBINE_REQSIZE) {
+			/* Small requests are combined while the DRNG is used */
+			if (esdm_drng_combine_wait(drng, outbuf + processed,
+						   todo, &ret)) {
+				if (ret <= 0)
+					return -EFAULT;
+
+				processed += ret;
+				outbuflen -= (size_t)ret;
+				continue;
+			}
+		} else if (!mutex_w_trylock(&drng->lock)) {
+			esdm_drng_metric(drng, esdm_drng_m_lock_contended, 1);
+			mutex_w_lock(&drng->lock);
+		}
+		esdm_lat_record(&esdm_drng_lat, esdm_drng_lat_lock_wait,
+				esdm_lat_now() - lat);
 
 		/*
 		 * Handle prediction resistance requests.
@@ -756,16 +2387,28 @@ static ssize_t esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
 		if (pr) {
 			/* If async reseed did not deliver entropy, try now */
 			if (!drng->fully_seeded) {
-				uint32_t collected_ent_bits;
+				uint32_t collected_ent_bits =
+					esdm_drng_pr_prefetch_seed(drng);
+
+				if (!collected_ent_bits)
+					collected_ent_bits =
+						esdm_drng_pr_full_seed(drng);
+				if (collected_ent_bits)
+					goto pr_seeded;
+
+				/*
+				 * The entropy is collected without holding the
+				 * DRNG lock, it is re-acquired for injecting
+				 * the seed and held for the generate operation.
+				 */
+				mutex_w_unlock(&drng->lock);
 
 				/* If we cannot get the pool lock, try again. */
-				if (!esdm_pool_trylock()) {
-					mutex_w_unlock(&drng->lock);
+				if (!esdm_pool_trylock())
 					continue;
-				}
 
-				collected_ent_bits = esdm_drng_seed_es_nolock(
-					drng, true, "regular");
+				collected_ent_bits =
+					esdm_drng_seed_es_shadow(drng, true);
 
 				esdm_pool_unlock();
 
@@ -775,6 +2418,9 @@ static ssize_t esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
 					goto out;
 				}
 
+pr_seeded:
+				esdm_drng_metric(drng, esdm_drng_m_reseed_pr, 1);
+
 				/* If no new entropy was received, stop now. */
 				todo = min_uint32(todo,
 						  collected_ent_bits >> 3);
@@ -785,9 +2431,22 @@ static ssize_t esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
 		}
 
 		/* Now, generate random bits from the properly seeded DRNG. */
-		ret = drng->drng_cb->drng_generate(drng->drng,
-						   outbuf + processed, todo);
-		mutex_w_unlock(&drng->lock);
+		lat = esdm_lat_now();
+		ret = esdm_drng_cb_generate(drng->drng_cb, drng->drng,
+					    outbuf + processed, todo);
+		esdm_lat_record(&esdm_drng_lat, esdm_drng_lat_generate,
+				esdm_lat_now() - lat);
+
+		if (concurrent) {
+			mutex_reader_unlock(&drng->state_lock);
+		} else {
+			/* Serve the small requests which waited for the lock */
+			if (!pr)
+				esdm_drng_combine_serve(drng);
+
+			mutex_w_unlock(&drng->lock);
+		}
+
 		if (ret <= 0) {
 			esdm_logger(
 				LOGGER_WARN, LOGGER_C_DRNG,
@@ -797,6 +2456,7 @@ static ssize_t esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
 		}
 		atomic_add(&drng->request_bits_since_fully_seeded,
 			   (int)ret << 3);
+		esdm_drng_metric(drng, esdm_drng_m_bytes, (uint64_t)ret);
 		processed += ret;
 		outbuflen -= (size_t)ret;
 
@@ -812,18 +2472,69 @@ out:
 	return processed;
 }
 
-static ssize_t esdm_drng_get_sleep(uint8_t *outbuf, size_t outbuflen, bool pr)
+/**
+ * @brief Get random data out of the DRNG which is reseeded frequently.
+ *
+ * @param [in] drng DRNG instance
+ * @param [in] outbuf buffer for storing random data
+ * @param [in] outbuflen length of outbuf
+ *
+ * @return
+ * * < 0 in error case (DRNG generation or update failed)
+ * * >=0 returning the returned number of bytes
+ */
+static ssize_t esdm_drng_get(struct esdm_drng *drng, uint8_t *outbuf,
+			     size_t outbuflen)
+{
+	struct esdm_audit_cnt audit;
+	ssize_t ret;
+
+	esdm_audit_begin(&audit);
+	ret = __esdm_drng_get(drng, outbuf, outbuflen);
+	esdm_audit_end(&esdm_drng_audit, &audit);
+
+	return ret;
+}
+
+/*
+ * Select a PR DRNG: starting with the next instance in round-robin order, the
+ * first fully seeded one is used as it can serve the request without waiting
+ * for the entropy sources.
+ */
+static struct esdm_drng *esdm_drng_pr_select(void)
+{
+	unsigned int i, start = (unsigned int)atomic_inc(&esdm_drng_pr_next);
+
+	for_each_pr_drng (i) {
+		unsigned int idx = (start + i) % ESDM_DRNG_PR_INSTANCES;
+
+		if (esdm_drng_pr[idx].fully_seeded) {
+			start = idx;
+			break;
+		}
+	}
+
+	start %= ESDM_DRNG_PR_INSTANCES;
+	esdm_logger(
+		LOGGER_DEBUG, LOGGER_C_DRNG,
+		"Using prediction resistance DRNG instance %u to service generate request\n",
+		start);
+
+	return &esdm_drng_pr[start];
+}
+
+/*
+ * Select the DRNG instance to service a generate request - the caller must
+ * hold the DRNG instances.
+ */
+static struct esdm_drng *esdm_drng_select(struct esdm_drng **esdm_drng,
+					  bool pr)
 {
-	struct esdm_drng **esdm_drng = esdm_drng_get_instances();
 	struct esdm_drng *drng = &esdm_drng_init;
 	uint32_t node = esdm_config_curr_node();
-	ssize_t ret;
 
 	if (pr) {
-		esdm_logger(
-			LOGGER_DEBUG, LOGGER_C_DRNG,
-			"Using prediction resistance DRNG instance to service generate request\n");
-		drng = &esdm_drng_pr;
+		drng = esdm_drng_pr_select();
 	} else if (esdm_drng && esdm_drng[node] &&
 		   esdm_drng[node]->fully_seeded) {
 		esdm_logger(
@@ -837,22 +2548,285 @@ static ssize_t esdm_drng_get_sleep(uint8_t *outbuf, size_t outbuflen, bool pr)
 			"Using DRNG instance on node 0 to service generate request\n");
 	}
 
+	return drng;
+}
+
+/*
+ * Seed the thread-owned DRNG from the node DRNG serving the thread. The node
+ * DRNG is only valid while the caller holds the DRNG instances, thus it is
+ * not retained as parent.
+ */
+static void esdm_drng_owned_seed(struct esdm_drng *drng,
+				 struct esdm_drng *parent)
+{
+	if (!esdm_pool_trylock()) {
+		/* Try to reseed next time, see esdm_drng_reseed_if_needed */
+		drng->force_reseed = true;
+		return;
+	}
+
+	drng->node = parent->node;
+	drng->parent = parent;
+	esdm_drng_metric(drng, esdm_drng_m_reseed_parent, 1);
+	esdm_drng_seed_parent(drng);
+	drng->parent = NULL;
+	esdm_pool_unlock();
+}
+
+/*
+ * Generate random data from the DRNG owned by the calling thread. As no other
+ * thread uses the DRNG, neither the reseed nor the generate operation take
+ * the DRNG lock. Global events only advance the epoch which resets the DRNG
+ * and causes its reseed with the next request.
+ *
+ * @return -EAGAIN if the request must be served by the shared DRNGs,
+ *	   otherwise as esdm_drng_get
+ */
+static ssize_t esdm_drng_owned_get(struct esdm_drng *parent, uint8_t *outbuf,
+				   size_t outbuflen)
+{
+	struct esdm_drng *drng = esdm_drng_owned;
+	ssize_t processed = 0;
+	uint32_t batch = 0;
+	int epoch;
+
+	/* NTG.1 requires each DRNG to be seeded from the entropy sources */
+	if (!drng || !parent->fully_seeded || esdm_ntg1_2024_compliant())
+		return -EAGAIN;
+	if (!outbuf || !outbuflen)
+		return 0;
+
+	epoch = atomic_read(&esdm_drng_epoch);
+	if (epoch != esdm_drng_owned_epoch ||
+	    esdm_drng_check_disable_threshold(drng)) {
+		esdm_drng_owned_epoch = epoch;
+		esdm_drng_reset(drng);
+	}
+
+	if (!drng->fully_seeded) {
+		esdm_drng_owned_seed(drng, parent);
+		if (!drng->fully_seeded)
+			return -EAGAIN;
+	}
+
+	outbuflen = min_size(outbuflen, SSIZE_MAX);
+
+	while (outbuflen) {
+		uint32_t reqsize = esdm_drng_reqsize(), ops = 0;
+		uint32_t todo = min_uint32((uint32_t)outbuflen, reqsize);
+		ssize_t ret;
+		uint64_t lat;
+
+		/* Account the next generate operations in one batch */
+		if (!batch) {
+			ops = (uint32_t)min_size(
+				(outbuflen + reqsize - 1) / reqsize,
+				ESDM_DRNG_RESEED_BATCH);
+			batch = ops;
+		}
+		batch--;
+		if (esdm_drng_must_reseed(drng, ops))
+			esdm_drng_owned_seed(drng, parent);
+
+		lat = esdm_lat_now();
+		ret = esdm_drng_cb_generate(drng->drng_cb, drng->drng,
+					    outbuf + processed, todo);
+		esdm_lat_record(&esdm_drng_lat, esdm_drng_lat_generate,
+				esdm_lat_now() - lat);
+		if (ret <= 0) {
+			esdm_logger(
+				LOGGER_WARN, LOGGER_C_DRNG,
+				"getting random data from owned DRNG failed (%zd)\n",
+				ret);
+			return -EFAULT;
+		}
+
+		atomic_add(&drng->request_bits_since_fully_seeded,
+			   (int)ret << 3);
+		esdm_drng_metric(drng, esdm_drng_m_bytes, (uint64_t)ret);
+		processed += ret;
+		outbuflen -= (size_t)ret;
+	}
+
+	return processed;
+}
+
+DSO_PUBLIC
+int esdm_drng_thread_own(void)
+{
+	struct esdm_drng *drng;
+	int ret;
+
+	if (esdm_drng_owned)
+		return 0;
+
+	CKINT(esdm_drng_mgr_initialize());
+
+	/* Prevent false sharing with the DRNGs of other threads */
+	if (posix_memalign((void *)&drng, ESDM_CACHELINE_SIZE,
+			   sizeof(struct esdm_drng)))
+		return -ENOMEM;
+	memset(drng, 0, sizeof(struct esdm_drng));
+
+	ret = esdm_drng_alloc_common(drng, esdm_drng_init.drng_cb);
+	if (ret) {
+		free(drng);
+		goto out;
+	}
+	esdm_mem_account(esdm_mem_drng, sizeof(struct esdm_drng));
+
+	drng->hash_cb = esdm_drng_hash_cb(&esdm_drng_init);
+
+	mutex_w_init_adaptive(&drng->lock, 0, 1);
+	mutex_init(&drng->hash_lock, 0);
+	mutex_init(&drng->state_lock, 0);
+
+	esdm_drng_owned_epoch = atomic_read(&esdm_drng_epoch);
+	esdm_drng_owned = drng;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_DRNG,
+		    "DRNG owned by the current thread allocated\n");
+
+out:
+	return ret;
+}
+
+DSO_PUBLIC
+void esdm_drng_thread_release(void)
+{
+	struct esdm_drng *drng = esdm_drng_owned;
+
+	if (!drng)
+		return;
+
+	esdm_drng_owned = NULL;
+	esdm_drng_dealloc_common(drng);
+	free(drng);
+	esdm_mem_account(esdm_mem_drng, -(int64_t)sizeof(struct esdm_drng));
+}
+
+static ssize_t esdm_drng_get_sleep(uint8_t *outbuf, size_t outbuflen, bool pr)
+{
+	struct esdm_drng **esdm_drng = esdm_drng_get_instances();
+	bool pinned = !pr && esdm_node_cpu_pin();
+	struct esdm_drng *drng = esdm_drng_select(esdm_drng, pr);
+	ssize_t ret;
+
 	CKINT(esdm_drng_mgr_initialize());
-	CKINT(esdm_drng_get(drng, outbuf, outbuflen));
+	CKINT(esdm_drng_mgr_selftest_wait());
+	esdm_drng_resume_gate();
+
+	if (!pr) {
+		ret = esdm_drng_owned_get(drng, outbuf, outbuflen);
+		if (ret != -EAGAIN)
+			goto out;
+
+		drng = esdm_drng_small_select(drng, outbuflen);
+	}
+
+	ESDM_PROBE3(drng_get_start, drng->node, pr, outbuflen);
+	ret = esdm_drng_get(drng, outbuf, outbuflen);
+	ESDM_PROBE3(drng_get_end, drng->node, pr, ret);
 
 out:
+	esdm_node_cpu_unpin(pinned);
 	esdm_drng_put_instances();
 	return ret;
 }
 
+/**
+ * @brief Get random data for a batch of requests out of the DRNG
+ *
+ * All entries not destined for the PR DRNG are generated. Multiple entries
+ * are generated with one lock acquisition of the DRNG as long as they fit
+ * into one maximum DRNG request.
+ *
+ * @param [in] drng DRNG instance
+ * @param [in] vec array of requests
+ * @param [in] num number of entries in vec
+ *
+ * @return
+ * * < 0 in error case (DRNG generation or update failed)
+ * * >=0 returning the returned number of bytes
+ */
+static ssize_t esdm_drng_get_vec(struct esdm_drng *drng,
+				 struct esdm_rnd_vec *vec, size_t num)
+{
+	ssize_t processed = 0;
+	size_t i = 0;
+
+	if (!esdm_get_available())
+		return -EOPNOTSUPP;
+
+	/* See esdm_drng_get */
+	if (esdm_drng_check_disable_threshold(drng))
+		esdm_unset_fully_seeded(drng);
+
+	while (i < num) {
+		uint32_t budget = esdm_drng_reqsize();
+
+		esdm_drng_reseed_if_needed(drng, 1);
+
+		mutex_w_lock(&drng->lock);
+		while (i < num && budget) {
+			struct esdm_rnd_vec *v = &vec[i];
+			uint32_t todo;
+			ssize_t ret;
+
+			if (v->flags == ESDM_RND_VEC_PR || !v->buf ||
+			    v->generated >= v->len) {
+				i++;
+				continue;
+			}
+
+			todo = (uint32_t)min_size(v->len - v->generated,
+						  budget);
+			ret = esdm_drng_cb_generate(drng->drng_cb, drng->drng,
+						    v->buf + v->generated,
+						    todo);
+			if (ret <= 0) {
+				mutex_w_unlock(&drng->lock);
+				esdm_logger(
+					LOGGER_WARN, LOGGER_C_DRNG,
+					"getting random data from DRNG failed (%zd)\n",
+					ret);
+				return -EFAULT;
+			}
+
+			atomic_add(&drng->request_bits_since_fully_seeded,
+				   (int)ret << 3);
+			v->generated += (size_t)ret;
+			budget -= (uint32_t)ret;
+			processed += ret;
+		}
+		mutex_w_unlock(&drng->lock);
+	}
+
+	return processed;
+}
+
+static void esdm_drng_reset_small(struct esdm_drng *drng)
+{
+	struct esdm_drng *small = drng->small;
+
+	if (!small)
+		return;
+
+	mutex_w_lock(&small->lock);
+	esdm_drng_reset(small);
+	mutex_w_unlock(&small->lock);
+}
+
 /*
  * Reset ESDM such that all existing entropy is gone.
  */
 void esdm_reset(void)
 {
 	struct esdm_drng **esdm_drng = esdm_drng_get_instances();
+	unsigned int i;
 
 	if (!esdm_drng) {
+		esdm_drng_reset_small(&esdm_drng_init);
 		mutex_w_lock(&esdm_drng_init.lock);
 		esdm_drng_reset(&esdm_drng_init);
 		mutex_w_unlock(&esdm_drng_init.lock);
@@ -864,6 +2838,7 @@ void esdm_reset(void)
 
 			if (!drng)
 				continue;
+			esdm_drng_reset_small(drng);
 			mutex_w_lock(&drng->lock);
 			esdm_drng_reset(drng);
 			mutex_w_unlock(&drng->lock);
@@ -872,11 +2847,14 @@ void esdm_reset(void)
 
 	esdm_drng_put_instances();
 
-	mutex_w_lock(&esdm_drng_pr.lock);
-	esdm_drng_reset(&esdm_drng_pr);
-	mutex_w_unlock(&esdm_drng_pr.lock);
+	for_each_pr_drng (i) {
+		mutex_w_lock(&esdm_drng_pr[i].lock);
+		esdm_drng_reset(&esdm_drng_pr[i]);
+		mutex_w_unlock(&esdm_drng_pr[i].lock);
+	}
 
 	esdm_drng_atomic_reset();
+	atomic_inc(&esdm_drng_epoch);
 	esdm_set_entropy_thresh(ESDM_FULL_SEED_ENTROPY_BITS);
 
 	esdm_reset_state();
@@ -962,18 +2940,23 @@ static int esdm_drng_sleep_while_non_min_seeded(unsigned int nonblock)
 }
 
 DSO_PUBLIC
-ssize_t esdm_get_seed(uint64_t *buf, size_t nbytes,
-		      enum esdm_get_seed_flags flags)
+ssize_t esdm_get_seed_blocks(uint64_t *buf, size_t nbytes, size_t num,
+			     enum esdm_get_seed_flags flags)
 {
 	static DEFINE_MUTEX_W_UNLOCKED(esdm_get_seed_lock);
-	struct entropy_buf *eb = (struct entropy_buf *)(buf + 2);
+	struct entropy_buf *eb;
 	uint64_t buflen = sizeof(struct entropy_buf) + 2 * sizeof(uint64_t);
-	uint64_t collected_bits = 0;
+	uint64_t collected_bits = 0, *block;
+	size_t filled = 0;
 	int ret;
 
 	/* Ensure buffer is aligned as required */
 	BUILD_BUG_ON(sizeof(buflen) < ESDM_KCAPI_ALIGN);
-	if (nbytes < sizeof(buflen))
+	if (nbytes < sizeof(buflen) || !num)
+		return -EINVAL;
+
+	/* Every block must be aligned as the first one */
+	if (num > 1 && nbytes % sizeof(uint64_t))
 		return -EINVAL;
 
 	/* Write buffer size into first word */
@@ -991,50 +2974,86 @@ ssize_t esdm_get_seed(uint64_t *buf, size_t nbytes,
 	CKINT(esdm_drng_sleep_while_not_all_nodes_seeded(
 		flags & ESDM_GET_SEED_NONBLOCK));
 
-	/* Try to get the pool lock and sleep on it to get it. */
+	/*
+	 * Try to get the pool lock and sleep on it to get it. All blocks are
+	 * collected with one acquisition of the locks.
+	 */
 	esdm_pool_lock();
 
-	/* If an ESDM DRNG becomes unseeded, give this DRNG precedence. */
-	if (!esdm_pool_all_nodes_seeded_get()) {
-		esdm_pool_unlock();
-		buflen = 0;
-		goto out;
-	}
+	for (filled = 0; filled < num; filled++) {
+		block = buf + filled * (nbytes / sizeof(uint64_t));
+		eb = (struct entropy_buf *)(block + 2);
 
-	/*
-	 * Try to get seed data - a rarely used busyloop is cheaper than a wait
-	 * queue that is constantly woken up by the hot code path of
-	 * esdm_init_ops.
-	 */
-	for (;;) {
-		esdm_fill_seed_buffer(
-			eb,
-			esdm_get_seed_entropy_osr(flags &
-						  ESDM_GET_SEED_FULLY_SEEDED),
-			false);
-		collected_bits = esdm_entropy_rate_eb(eb);
-
-		/* Break the collection loop if we got entropy, ... */
-		if (collected_bits ||
-		    /* ... a DRNG becomes unseeded, give DRNG precedence, ... */
-		    !esdm_pool_all_nodes_seeded_get() ||
-		    /* ... when the DRNG manager terminates, or ... */
-		    atomic_read(&esdm_drng_mgr_terminate) ||
-		    /* ... if the caller does not want a blocking behavior. */
-		    (flags & ESDM_GET_SEED_NONBLOCK))
+		/*
+		 * If an ESDM DRNG becomes unseeded, give this DRNG
+		 * precedence.
+		 */
+		if (!esdm_pool_all_nodes_seeded_get())
+			break;
+
+		/*
+		 * Try to get seed data - a rarely used busyloop is cheaper
+		 * than a wait queue that is constantly woken up by the hot
+		 * code path of esdm_init_ops.
+		 */
+		for (;;) {
+			esdm_fill_seed_buffer(
+				eb,
+				esdm_get_seed_entropy_osr(
+					flags & ESDM_GET_SEED_FULLY_SEEDED),
+				false);
+			collected_bits = esdm_entropy_rate_eb(eb);
+
+			/* Break the collection loop if we got entropy, ... */
+			if (collected_bits ||
+			    /* ... a DRNG becomes unseeded, ... */
+			    !esdm_pool_all_nodes_seeded_get() ||
+			    /* ... when the DRNG manager terminates, or ... */
+			    atomic_read(&esdm_drng_mgr_terminate) ||
+			    /* ... if the caller does not want to block. */
+			    (flags & ESDM_GET_SEED_NONBLOCK))
+				break;
+
+			nanosleep(&poll_ts, NULL);
+		}
+
+		/*
+		 * Only the first block may be returned without entropy, the
+		 * batch ends with the first block without entropy.
+		 */
+		if (!collected_bits && filled) {
+			memset_secure(eb, 0, sizeof(*eb));
 			break;
+		}
+
+		/* Write buffer size and entropy size into the first words */
+		block[0] = buflen;
+		block[1] = collected_bits;
 
-		nanosleep(&poll_ts, NULL);
+		if (!collected_bits) {
+			filled++;
+			break;
+		}
 	}
 
 	esdm_pool_unlock();
 
-	/* Write collected entropy size into second word */
-	buf[1] = collected_bits;
-
 out:
 	mutex_w_unlock(&esdm_get_seed_lock);
-	return ret ? ret : (ssize_t)buflen;
+	return ret ? ret : (ssize_t)filled;
+}
+
+DSO_PUBLIC
+ssize_t esdm_get_seed(uint64_t *buf, size_t nbytes,
+		      enum esdm_get_seed_flags flags)
+{
+	ssize_t ret = esdm_get_seed_blocks(buf, nbytes, 1, flags);
+
+	/* No block is returned if a DRNG became unseeded */
+	if (ret <= 0)
+		return ret;
+
+	return (ssize_t)buf[0];
 }
 
 DSO_PUBLIC
@@ -1119,3 +3138,99 @@ ssize_t esdm_get_random_bytes(uint8_t *buf, size_t nbytes)
 {
 	return esdm_drng_get_sleep(buf, (uint32_t)nbytes, false);
 }
+
+static ssize_t esdm_get_random_bytes_vec_common(struct esdm_rnd_vec *vec,
+						size_t num,
+						unsigned int nonblock)
+{
+	struct esdm_drng **esdm_drng;
+	enum esdm_rnd_vec_flags level = ESDM_RND_VEC_NORMAL;
+	ssize_t ret, processed;
+	size_t i;
+	bool pr = false, pinned;
+
+	if (!vec)
+		return -EINVAL;
+
+	for (i = 0; i < num; i++) {
+		vec[i].generated = 0;
+
+		switch (vec[i].flags) {
+		case ESDM_RND_VEC_FULL:
+			level = ESDM_RND_VEC_FULL;
+			break;
+		case ESDM_RND_VEC_MIN:
+			if (level == ESDM_RND_VEC_NORMAL)
+				level = ESDM_RND_VEC_MIN;
+			break;
+		case ESDM_RND_VEC_PR:
+			/* The PR DRNG requires a fully initialized ESDM */
+			level = ESDM_RND_VEC_FULL;
+			pr = true;
+			break;
+		case ESDM_RND_VEC_NORMAL:
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	/* Wait for the seeding level required by the most demanding entry */
+	if (level == ESDM_RND_VEC_FULL)
+		ret = esdm_drng_sleep_while_nonoperational(nonblock);
+	else if (level == ESDM_RND_VEC_MIN)
+		ret = esdm_drng_sleep_while_non_min_seeded(nonblock);
+	else
+		ret = 0;
+	if (ret)
+		return ret;
+
+	esdm_drng = esdm_drng_get_instances();
+	pinned = esdm_node_cpu_pin();
+	CKINT(esdm_drng_mgr_initialize());
+	CKINT(esdm_drng_mgr_selftest_wait());
+	esdm_drng_resume_gate();
+	CKINT(esdm_drng_get_vec(esdm_drng_select(esdm_drng, false), vec, num));
+	processed = ret;
+	esdm_node_cpu_unpin(pinned);
+	esdm_drng_put_instances();
+
+	if (!pr)
+		return processed;
+
+	/*
+	 * The PR entries are served one by one as they are limited by the
+	 * entropy available from the entropy sources. A failure, e.g. when
+	 * another PR request is in flight, only leaves the entry unfilled.
+	 */
+	for (i = 0; i < num; i++) {
+		if (vec[i].flags != ESDM_RND_VEC_PR || !vec[i].buf)
+			continue;
+
+		ret = esdm_get_random_bytes_pr(vec[i].buf, vec[i].len);
+		if (ret > 0) {
+			vec[i].generated = (size_t)ret;
+			processed += ret;
+		}
+	}
+
+	return processed;
+
+out:
+	esdm_node_cpu_unpin(pinned);
+	esdm_drng_put_instances();
+	return ret;
+}
+
+DSO_PUBLIC
+ssize_t esdm_get_random_bytes_vec(struct esdm_rnd_vec *vec, size_t num)
+{
+	return esdm_get_random_bytes_vec_common(vec, num, 0);
+}
+
+DSO_PUBLIC
+ssize_t esdm_get_random_bytes_vec_noblock(struct esdm_rnd_vec *vec,
+					  size_t num)
+{
+	return esdm_get_random_bytes_vec_common(vec, num, 1);
+}
@@ -26,8 +26,11 @@
 #include "bool.h"
 #include "config.h"
 #include "esdm.h"
+#include "esdm_builtin_sha512.h"
 #include "esdm_crypto.h"
 #include "esdm_definitions.h"
+#include "helper.h"
+#include "metrics.h"
 #include "mutex.h"
 #include "mutex_w.h"
 
@@ -36,12 +39,39 @@ extern mutex_w_t esdm_crypto_cb_update;
 extern const struct esdm_drng_cb *esdm_default_drng_cb;
 extern const struct esdm_hash_cb *esdm_default_hash_cb;
 
-/* DRNG state handle */
+/* Request waiting to be served by the current holder of the DRNG lock */
+struct esdm_drng_combine_req {
+	atomic_t state;
+	uint32_t len;
+	uint8_t *buf;
+	ssize_t ret;
+} __aligned(ESDM_CACHELINE_SIZE);
+
+/*
+ * DRNG state handle
+ *
+ * The members are grouped by their writers into separate cache lines: the
+ * read-mostly callbacks, the seeding state written by the seeding operation,
+ * the counters written by every generate operation as well as each lock.
+ * Instances must be allocated with ESDM_CACHELINE_SIZE alignment.
+ */
 struct esdm_drng {
+	/* Read-mostly: only changed when replacing the crypto callbacks */
 	void *drng; /* DRNG handle */
 	const struct esdm_drng_cb *drng_cb; /* DRNG callbacks */
 	const struct esdm_hash_cb *hash_cb; /* Hash callbacks */
-	atomic_t requests; /* Number of DRNG requests */
+	/* DRNG providing the seed - NULL when seeded from entropy sources */
+	struct esdm_drng *parent;
+	/* Node served by the DRNG, used to label its metrics */
+	uint32_t node;
+	/*
+	 * Low-latency DRNG seeded from this DRNG and serving the requests of
+	 * at most esdm_config_drng_small_reqsize bytes - NULL if unused
+	 */
+	struct esdm_drng *small;
+
+	/* Written by every generate operation: number of DRNG requests */
+	atomic_t requests __aligned(ESDM_CACHELINE_SIZE);
 	atomic_t requests_since_fully_seeded; /* Number DRNG requests since
 						 * last fully seeded
 						 */
@@ -54,13 +84,30 @@ struct esdm_drng {
 	 */
 	atomic_t request_bits_since_fully_seeded;
 
-	struct timespec last_seeded; /* Last time it was seeded */
+	/* Written by the seeding operation: last time it was seeded */
+	struct timespec last_seeded __aligned(ESDM_CACHELINE_SIZE);
 	bool fully_seeded; /* Is DRNG fully seeded? */
 	bool force_reseed; /* Force a reseed */
+	atomic_t reseed_pending; /* Reseed requested from the reseeder */
 
-	mutex_t hash_lock; /* Lock hash_cb replacement */
-	/* Lock write operations on DRNG state, DRNG replacement of drng_cb */
-	mutex_w_t lock; /* Non-atomic DRNG operation */
+	/*
+	 * Serialize hash_cb replacement - readers obtain hash_cb without a lock
+	 * with esdm_drng_hash_cb()
+	 */
+	mutex_t hash_lock __aligned(ESDM_CACHELINE_SIZE);
+	/*
+	 * Lock write operations on DRNG state, DRNG replacement of drng_cb -
+	 * non-atomic DRNG operation
+	 */
+	mutex_w_t lock __aligned(ESDM_CACHELINE_SIZE);
+	/*
+	 * Lock replacement of the DRNG state against generate operations which
+	 * do not take the DRNG lock (see drng_concurrent)
+	 */
+	mutex_t state_lock __aligned(ESDM_CACHELINE_SIZE);
+
+	/* Small requests waiting for the DRNG lock */
+	struct esdm_drng_combine_req combine[ESDM_DRNG_COMBINE_SLOTS];
 };
 
 #define ESDM_DRNG_STATE_INIT(x, d, d_cb, h_cb)                                 \
@@ -69,9 +116,32 @@ struct esdm_drng {
 	.requests_since_fully_seeded = ATOMIC_INIT(0),                         \
 	.request_bits_since_fully_seeded = ATOMIC_INIT(0),                     \
 	.last_seeded = { 0 }, .fully_seeded = false, .force_reseed = true,     \
-	.hash_lock = MUTEX_UNLOCKED
+	.hash_lock = MUTEX_UNLOCKED, .state_lock = MUTEX_UNLOCKED
+
+/*
+ * Obtain the hash callbacks of the DRNG. The hash callbacks are static
+ * structures which are never released. Thus, a reader only needs to see a
+ * completely published pointer, but it does not need to prevent its
+ * replacement while using the old callbacks. A replacement must publish the
+ * new pointer with a release store while holding the hash_lock. State
+ * allocated with the old callbacks must be protected by the lock of its owner.
+ */
+static inline const struct esdm_hash_cb *
+esdm_drng_hash_cb(const struct esdm_drng *drng)
+{
+#ifdef ESDM_CRYPTO_STATIC_DISPATCH
+	/* The builtin hash is never replaced */
+	(void)drng;
+	return &esdm_builtin_sha512_cb;
+#else
+	return __atomic_load_n(&drng->hash_cb, __ATOMIC_ACQUIRE);
+#endif
+}
 
 struct esdm_drng *esdm_drng_init_instance(void);
+int esdm_drng_small_alloc(struct esdm_drng *drng);
+void esdm_drng_small_dealloc(struct esdm_drng *drng);
+int esdm_drng_mgr_reseeder(void);
 struct esdm_drng *esdm_drng_node_instance(void);
 
 void esdm_reset(void);
@@ -79,6 +149,8 @@ int esdm_drng_alloc_common(struct esdm_drng *drng,
 			   const struct esdm_drng_cb *crypto_cb);
 int esdm_drng_mgr_reinitialize(void);
 int esdm_drng_mgr_initialize(void);
+int esdm_drng_mgr_selftest_wait(void);
+void esdm_drng_suspend(void);
 void esdm_drng_mgr_finalize(void);
 bool esdm_get_available(void);
 void esdm_drng_reset(struct esdm_drng *drng);
@@ -88,6 +160,12 @@ void esdm_drng_inject(struct esdm_drng *drng, const uint8_t *inbuf,
 void esdm_drng_seed_work(void);
 void esdm_force_fully_seeded(void);
 void esdm_force_fully_seeded_all_drbgs(void);
+int esdm_hash_ctx_get(const struct esdm_hash_cb *hash_cb, void **ctx);
+void esdm_hash_ctx_put(const struct esdm_hash_cb *hash_cb, void *ctx);
+void esdm_drng_lat_status(char *buf, size_t buflen);
+void esdm_drng_audit_status(char *buf, size_t buflen);
+void esdm_drng_status_bin(struct esdm_status_bin *status);
+void esdm_drng_metrics(struct esdm_metrics_buf *mb);
 
 static inline uint32_t esdm_compress_osr(void)
 {
@@ -25,6 +25,7 @@
 #include "config.h"
 #include "esdm.h"
 #include "esdm_crypto.h"
+#include "esdm_crypto_dispatch.h"
 #include "esdm_es_aux.h"
 #include "esdm_es_mgr.h"
 #include "esdm_shm_status.h"
@@ -59,18 +60,61 @@ static struct esdm_pool esdm_pool __aligned(ESDM_KCAPI_ALIGN) = {
 	.aux_entropy_bits = ATOMIC_INIT(0),
 	.digestsize = ATOMIC_INIT(ESDM_MAX_DIGESTSIZE),
 	.initialized = false,
-	.lock = MUTEX_W_UNLOCKED,
+	.lock = MUTEX_W_ADAPTIVE_UNLOCKED,
 };
 
+/*
+ * Shards of the auxiliary pool
+ *
+ * Writers insert their data into the shard of the CPU they execute on. Each
+ * shard has its own hash state, entropy counter and lock so that writers on
+ * different CPUs do not contend for the aux pool lock. The shards are folded
+ * into the aux pool when the aux pool is read.
+ *
+ * Small inserts are collected in the staging buffer of the shard and hashed
+ * in one batch once the buffer is full or the shard is folded. The entropy of
+ * staged data is credited at insertion time.
+ */
+#define ESDM_AUX_STAGING_SIZE 1024
+
+struct esdm_pool_shard {
+	void *aux_pool; /* Shard: digest state */
+	const struct esdm_hash_cb *hash_cb; /* Hash used for the digest state */
+	atomic_t aux_entropy_bits;
+	bool initialized; /* Digest state holds data not yet folded */
+	uint32_t staged; /* Bytes in the staging buffer */
+	uint8_t staging[ESDM_AUX_STAGING_SIZE];
+
+	/* Serialize update and folding of the shard */
+	mutex_w_t lock;
+} __aligned(ESDM_CACHELINE_SIZE);
+
+static struct esdm_pool_shard esdm_pool_shards[ESDM_AUX_POOL_SHARDS];
+static atomic_t esdm_pool_shards_ready = ATOMIC_INIT(0);
+
 /********************************** Helper ***********************************/
 
+/* Entropy in bits present in all shards */
+static uint32_t esdm_aux_shards_entropy(void)
+{
+	uint32_t i, ent_bits = 0;
+
+	for (i = 0; i < ESDM_AUX_POOL_SHARDS; i++) {
+		ent_bits += atomic_read_u32(
+			&esdm_pool_shards[i].aux_entropy_bits);
+	}
+
+	return ent_bits;
+}
+
 /* Entropy in bits present in aux pool */
 static uint32_t esdm_aux_avail_entropy(uint32_t __unused u)
 {
 	/* Cap available entropy with max entropy */
 	uint32_t avail_bits =
 		min_uint32(esdm_get_digestsize(),
-			   atomic_read_u32(&esdm_pool.aux_entropy_bits));
+			   atomic_read_u32(&esdm_pool.aux_entropy_bits) +
+				   esdm_aux_shards_entropy());
 
 	/* Consider oversampling rate due to aux pool conditioning */
 	return esdm_reduce_by_osr(avail_bits);
@@ -113,6 +157,60 @@ static void esdm_init_wakeup_bits(void)
 	esdm_write_wakeup_bits = digestsize;
 }
 
+/* Allocate the digest states of the shards - caller must hold the pool lock */
+static int esdm_aux_shards_init(const struct esdm_hash_cb *hash_cb)
+{
+	static bool locks_initialized = false;
+	uint32_t i;
+	int ret = 0;
+
+	if (!locks_initialized) {
+		for (i = 0; i < ESDM_AUX_POOL_SHARDS; i++)
+			mutex_w_init(&esdm_pool_shards[i].lock, 0, 0);
+		locks_initialized = true;
+	}
+
+	for (i = 0; i < ESDM_AUX_POOL_SHARDS; i++) {
+		struct esdm_pool_shard *shard = &esdm_pool_shards[i];
+
+		mutex_w_lock(&shard->lock);
+		if (!shard->aux_pool && hash_cb->hash_alloc)
+			ret = hash_cb->hash_alloc(&shard->aux_pool);
+		shard->hash_cb = hash_cb;
+		shard->initialized = false;
+		mutex_w_unlock(&shard->lock);
+
+		if (ret)
+			return ret;
+	}
+
+	atomic_set(&esdm_pool_shards_ready, 1);
+	return 0;
+}
+
+/* Release the digest states of the shards - caller must hold the pool lock */
+static void esdm_aux_shards_fini(void)
+{
+	uint32_t i;
+
+	if (!atomic_xchg(&esdm_pool_shards_ready, 0))
+		return;
+
+	for (i = 0; i < ESDM_AUX_POOL_SHARDS; i++) {
+		struct esdm_pool_shard *shard = &esdm_pool_shards[i];
+
+		mutex_w_lock(&shard->lock);
+		if (shard->aux_pool && shard->hash_cb->hash_dealloc)
+			shard->hash_cb->hash_dealloc(shard->aux_pool);
+		shard->aux_pool = NULL;
+		shard->initialized = false;
+		memset_secure(shard->staging, 0, shard->staged);
+		shard->staged = 0;
+		atomic_set(&shard->aux_entropy_bits, 0);
+		mutex_w_unlock(&shard->lock);
+	}
+}
+
 static int esdm_aux_init(void)
 {
 	struct esdm_drng *drng = esdm_drng_init_instance();
@@ -120,10 +218,11 @@ static int esdm_aux_init(void)
 	const struct esdm_hash_cb *hash_cb;
 	int ret = 0;
 
-	mutex_lock(&drng->hash_lock);
-	hash_cb = drng->hash_cb;
+	mutex_w_lock(&pool->lock);
+	hash_cb = esdm_drng_hash_cb(drng);
 	if (hash_cb->hash_alloc)
 		CKINT(hash_cb->hash_alloc(&pool->aux_pool));
+	CKINT(esdm_aux_shards_init(hash_cb));
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY, "Aux ES hash allocated\n");
 	pool->initialized = false;
 
@@ -136,7 +235,7 @@ static int esdm_aux_init(void)
 	esdm_shm_status_set_need_entropy();
 
 out:
-	mutex_unlock(&drng->hash_lock);
+	mutex_w_unlock(&pool->lock);
 	return ret;
 }
 
@@ -146,13 +245,14 @@ static void esdm_aux_fini(void)
 	struct esdm_pool *pool = &esdm_pool;
 	const struct esdm_hash_cb *hash_cb;
 
-	mutex_lock(&drng->hash_lock);
-	hash_cb = drng->hash_cb;
+	mutex_w_lock(&pool->lock);
+	esdm_aux_shards_fini();
+	hash_cb = esdm_drng_hash_cb(drng);
 	if (hash_cb->hash_dealloc)
 		hash_cb->hash_dealloc(pool->aux_pool);
 	pool->aux_pool = NULL;
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY, "Aux ES hash deallocated\n");
-	mutex_unlock(&drng->hash_lock);
+	mutex_w_unlock(&pool->lock);
 }
 
 /* Obtain the digest size provided by the used hash in bits */
@@ -166,6 +266,19 @@ uint32_t esdm_get_digestsize(void)
 DSO_PUBLIC
 void esdm_pool_set_entropy(uint32_t entropy_bits)
 {
+	uint32_t i;
+
+	/*
+	 * The new value covers the data in all shards - the shard lock
+	 * serializes the reset with the accounting of an insert.
+	 */
+	for (i = 0; i < ESDM_AUX_POOL_SHARDS; i++) {
+		struct esdm_pool_shard *shard = &esdm_pool_shards[i];
+
+		mutex_w_lock(&shard->lock);
+		atomic_set(&shard->aux_entropy_bits, 0);
+		mutex_w_unlock(&shard->lock);
+	}
 	atomic_set(&esdm_pool.aux_entropy_bits, (int)entropy_bits);
 
 	/*
@@ -180,6 +293,156 @@ static void esdm_aux_reset(void)
 	esdm_pool_set_entropy(0);
 }
 
+/*
+ * Insert data into auxiliary pool by using the hash update function. Caller
+ * must hold the pool lock.
+ */
+static int esdm_aux_pool_insert_locked(const struct esdm_hash_cb *hash_cb,
+				       const uint8_t *inbuf, size_t inbuflen,
+				       uint32_t entropy_bits)
+{
+	struct esdm_pool *pool = &esdm_pool;
+	struct hash_ctx *shash = (struct hash_ctx *)pool->aux_pool;
+	int ret;
+
+	entropy_bits = min_uint32(entropy_bits, (uint32_t)(inbuflen << 3));
+
+	if (!pool->initialized) {
+		ret = esdm_hash_cb_init(hash_cb, shash);
+		if (ret)
+			goto out;
+		pool->initialized = true;
+	}
+
+	ret = esdm_hash_cb_update(hash_cb, shash, inbuf, inbuflen);
+	if (ret)
+		goto out;
+
+	/*
+	 * Cap the available entropy to the hash output size compliant to
+	 * SP800-90B section 3.1.5.1 table 1.
+	 */
+	entropy_bits += atomic_read_u32(&pool->aux_entropy_bits);
+	atomic_set(&pool->aux_entropy_bits,
+		   (int)min_uint32(entropy_bits,
+				   hash_cb->hash_digestsize(shash) << 3));
+	esdm_shm_status_set_need_entropy();
+
+out:
+	return ret;
+}
+
+/*
+ * Hash the staging buffer of the shard into its digest state and wipe it.
+ * Caller must hold the shard lock.
+ */
+static int esdm_aux_shard_flush(struct esdm_pool_shard *shard)
+{
+	const struct esdm_hash_cb *hash_cb = shard->hash_cb;
+	int ret = 0;
+
+	if (!shard->staged)
+		return 0;
+
+	if (!shard->initialized) {
+		CKINT(esdm_hash_cb_init(hash_cb, shard->aux_pool));
+		shard->initialized = true;
+	}
+
+	CKINT(esdm_hash_cb_update(hash_cb, shard->aux_pool, shard->staging,
+				  shard->staged));
+
+out:
+	/* Do not credit entropy to data that was not hashed */
+	if (ret)
+		atomic_set(&shard->aux_entropy_bits, 0);
+	memset_secure(shard->staging, 0, shard->staged);
+	shard->staged = 0;
+	return ret;
+}
+
+/*
+ * Fold all shards into the aux pool using the given hash for the aux pool.
+ * Caller must hold the pool lock.
+ */
+static int esdm_aux_shards_fold(const struct esdm_hash_cb *hash_cb)
+{
+	uint8_t digest[ESDM_MAX_DIGESTSIZE];
+	uint32_t i, ent_bits, digestsize;
+	int ret = 0;
+
+	if (!atomic_read(&esdm_pool_shards_ready))
+		return 0;
+
+	for (i = 0; i < ESDM_AUX_POOL_SHARDS; i++) {
+		struct esdm_pool_shard *shard = &esdm_pool_shards[i];
+
+		mutex_w_lock(&shard->lock);
+		ret = esdm_aux_shard_flush(shard);
+		if (ret || !shard->initialized) {
+			mutex_w_unlock(&shard->lock);
+			if (ret)
+				break;
+			continue;
+		}
+
+		digestsize = shard->hash_cb->hash_digestsize(shard->aux_pool);
+		ret = esdm_hash_cb_final(shard->hash_cb, shard->aux_pool,
+					 digest);
+		shard->initialized = false;
+		ent_bits = (uint32_t)atomic_xchg(&shard->aux_entropy_bits, 0);
+		mutex_w_unlock(&shard->lock);
+
+		if (ret)
+			break;
+
+		ret = esdm_aux_pool_insert_locked(hash_cb, digest, digestsize,
+						  ent_bits);
+		if (ret)
+			break;
+	}
+
+	memset_secure(digest, 0, sizeof(digest));
+	return ret;
+}
+
+/*
+ * Re-allocate the digest states of all shards with the new hash. Data
+ * inserted since the last folding is dropped. Caller must hold the pool lock.
+ */
+static int esdm_aux_shards_switch_hash(const struct esdm_hash_cb *new_cb)
+{
+	uint32_t i;
+	int ret = 0;
+
+	if (!atomic_read(&esdm_pool_shards_ready))
+		return 0;
+
+	for (i = 0; i < ESDM_AUX_POOL_SHARDS; i++) {
+		struct esdm_pool_shard *shard = &esdm_pool_shards[i];
+		void *nhash = NULL;
+
+		mutex_w_lock(&shard->lock);
+		ret = new_cb->hash_alloc(&nhash);
+		if (!ret) {
+			if (shard->aux_pool)
+				shard->hash_cb->hash_dealloc(shard->aux_pool);
+			shard->aux_pool = nhash;
+			shard->hash_cb = new_cb;
+			shard->initialized = false;
+			memset_secure(shard->staging, 0, shard->staged);
+			shard->staged = 0;
+			atomic_set(&shard->aux_entropy_bits, 0);
+		}
+		mutex_w_unlock(&shard->lock);
+
+		if (ret)
+			break;
+	}
+
+	return ret;
+}
+
 /*
  * Replace old with new hash for auxiliary pool handling
  *
@@ -201,13 +464,18 @@ static int esdm_aux_switch_hash(struct esdm_drng *drng, int __unused u,
 	uint8_t digest[ESDM_MAX_DIGESTSIZE];
 	int ret;
 
-	if (!pool->initialized)
-		return 0;
-
 	/* We only switch if the processed DRNG is the initial DRNG. */
 	if (init_drng != drng)
 		return 0;
 
+	/* Fold the shards with the old digest and switch them ... */
+	CKINT(esdm_aux_shards_fold(old_cb));
+	CKINT(esdm_aux_shards_switch_hash(new_cb));
+
+	/* ... before switching the aux pool itself. */
+	if (!pool->initialized)
+		return 0;
+
 	CKINT(new_cb->hash_alloc(&nhash));
 
 	/* Get the aux pool hash with old digest ... */
@@ -238,42 +506,65 @@ out:
 	return ret;
 }
 
-/* Insert data into auxiliary pool by using the hash update function. */
-static int esdm_aux_pool_insert_locked(const uint8_t *inbuf, size_t inbuflen,
-				       uint32_t entropy_bits)
+/*
+ * Insert data into the shard of the current CPU.
+ *
+ * @return 0 on success, -EAGAIN if the shards are not allocated, other error
+ *	   code on hash failures.
+ */
+static int esdm_aux_shard_insert(const uint8_t *inbuf, size_t inbuflen,
+				 uint32_t entropy_bits)
 {
-	struct esdm_pool *pool = &esdm_pool;
-	struct hash_ctx *shash = (struct hash_ctx *)pool->aux_pool;
-	struct esdm_drng *drng = esdm_drng_init_instance();
+	struct esdm_pool_shard *shard =
+		&esdm_pool_shards[esdm_curr_node() % ESDM_AUX_POOL_SHARDS];
 	const struct esdm_hash_cb *hash_cb;
-	int ret;
+	int ret = 0;
+
+	if (!atomic_read(&esdm_pool_shards_ready))
+		return -EAGAIN;
 
 	entropy_bits = min_uint32(entropy_bits, (uint32_t)(inbuflen << 3));
 
-	mutex_reader_lock(&drng->hash_lock);
-	hash_cb = drng->hash_cb;
+	mutex_w_lock(&shard->lock);
 
-	if (!pool->initialized) {
-		ret = hash_cb->hash_init(shash);
-		if (ret)
-			goto out;
-		pool->initialized = true;
+	if (!shard->aux_pool) {
+		ret = -EAGAIN;
+		goto out;
 	}
 
-	ret = hash_cb->hash_update(shash, inbuf, inbuflen);
-	if (ret)
-		goto out;
+	hash_cb = shard->hash_cb;
+
+	/* Make room in the staging buffer */
+	if (shard->staged + inbuflen > sizeof(shard->staging))
+		CKINT(esdm_aux_shard_flush(shard));
+
+	if (inbuflen < sizeof(shard->staging)) {
+		/* Stage small inserts ... */
+		memcpy(shard->staging + shard->staged, inbuf, inbuflen);
+		shard->staged += (uint32_t)inbuflen;
+	} else {
+		/* ... and hash large inserts right away */
+		if (!shard->initialized) {
+			CKINT(esdm_hash_cb_init(hash_cb, shard->aux_pool));
+			shard->initialized = true;
+		}
+
+		CKINT(esdm_hash_cb_update(hash_cb, shard->aux_pool, inbuf,
+					  inbuflen));
+	}
 
 	/*
 	 * Cap the available entropy to the hash output size compliant to
 	 * SP800-90B section 3.1.5.1 table 1.
 	 */
-	entropy_bits += atomic_read_u32(&pool->aux_entropy_bits);
-	esdm_pool_set_entropy(
-		min_uint32(entropy_bits, hash_cb->hash_digestsize(shash) << 3));
+	entropy_bits += atomic_read_u32(&shard->aux_entropy_bits);
+	atomic_set(&shard->aux_entropy_bits,
+		   (int)min_uint32(entropy_bits,
+				   hash_cb->hash_digestsize(shard->aux_pool)
+					   << 3));
 
 out:
-	mutex_reader_unlock(&drng->hash_lock);
+	mutex_w_unlock(&shard->lock);
 	return ret;
 }
 
@@ -284,9 +575,14 @@ int esdm_pool_insert_aux(const uint8_t *inbuf, size_t inbuflen,
 	struct esdm_pool *pool = &esdm_pool;
 	int ret;
 
-	mutex_w_lock(&pool->lock);
-	ret = esdm_aux_pool_insert_locked(inbuf, inbuflen, entropy_bits);
-	mutex_w_unlock(&pool->lock);
+	ret = esdm_aux_shard_insert(inbuf, inbuflen, entropy_bits);
+	if (ret == -EAGAIN) {
+		mutex_w_lock(&pool->lock);
+		ret = esdm_aux_pool_insert_locked(
+			esdm_drng_hash_cb(esdm_drng_init_instance()), inbuf,
+			inbuflen, entropy_bits);
+		mutex_w_unlock(&pool->lock);
+	}
 
 	/*
 	 * As the DRNG is newly seeded, maybe the need entropy flag can be
@@ -317,12 +613,15 @@ static uint32_t esdm_aux_get_pool(uint8_t *outbuf, uint32_t requested_bits)
 		requested_bits_osr;
 	uint8_t aux_output[ESDM_MAX_DIGESTSIZE];
 
-	if (!pool->initialized)
-		return 0;
+	hash_cb = esdm_drng_hash_cb(drng);
 
-	mutex_reader_lock(&drng->hash_lock);
+	/* Combine the data of all shards in the aux pool */
+	if (esdm_aux_shards_fold(hash_cb))
+		esdm_logger(LOGGER_WARN, LOGGER_C_ES,
+			    "Folding aux pool shards failed\n");
 
-	hash_cb = drng->hash_cb;
+	if (!pool->initialized)
+		return 0;
 	digestsize = hash_cb->hash_digestsize(shash);
 	digestsize_bits = digestsize << 3;
 
@@ -357,13 +656,13 @@ static uint32_t esdm_aux_get_pool(uint8_t *outbuf, uint32_t requested_bits)
 		returned_ent_bits, collected_ent_bits, unused_bits);
 
 	/* Get the digest for the aux pool to be returned to the caller ... */
-	if (hash_cb->hash_final(shash, aux_output) ||
+	if (esdm_hash_cb_final(hash_cb, shash, aux_output) ||
 	    /*
 	     * ... and re-initialize the aux state. Do not add the aux pool
 	     * digest for backward secrecy as it will be added with the
 	     * insertion of the complete seed buffer after it has been filled.
 	     */
-	    hash_cb->hash_init(shash)) {
+	    esdm_hash_cb_init(hash_cb, shash)) {
 		returned_ent_bits = 0;
 	} else {
 		/*
@@ -374,7 +673,6 @@ static uint32_t esdm_aux_get_pool(uint8_t *outbuf, uint32_t requested_bits)
 		memcpy(outbuf, aux_output, requested_bits >> 3);
 	}
 
-	mutex_reader_unlock(&drng->hash_lock);
 	memset_secure(aux_output, 0, digestsize);
 	return returned_ent_bits;
 }
@@ -390,8 +688,9 @@ static void esdm_aux_get_backtrack(struct entropy_es *eb_es,
 	eb_es->e_bits = esdm_aux_get_pool(eb_es->e, requested_bits);
 
 	/* Mix the extracted data back into pool for backtracking resistance */
-	if (esdm_aux_pool_insert_locked((uint8_t *)eb_es,
-					sizeof(struct entropy_es), 0))
+	if (esdm_aux_pool_insert_locked(
+		    esdm_drng_hash_cb(esdm_drng_init_instance()),
+		    (uint8_t *)eb_es, sizeof(struct entropy_es), 0))
 		esdm_logger(LOGGER_WARN, LOGGER_C_ES,
 			    "Backtracking resistance operation failed\n");
 
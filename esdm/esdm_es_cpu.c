@@ -36,6 +36,9 @@
 
 static uint32_t esdm_cpu_data_multiplier = 0;
 
+/* Number of words drawn from the CPU for one hash update when compressing */
+#define ESDM_CPU_BULK_WORDS 64
+
 static int esdm_cpu_init(void)
 {
 	esdm_cpu_data_multiplier = 0;
@@ -53,28 +56,31 @@ static uint32_t esdm_cpu_poolsize(void)
 	return esdm_cpu_entropylevel(esdm_security_strength());
 }
 
-static uint32_t esdm_get_cpu_data(uint8_t *outbuf, uint32_t requested_bits)
+/* Number of words needed to hold the given number of bytes */
+static inline size_t esdm_cpu_words(uint32_t bytes)
 {
-	uint32_t i;
+	return (bytes + sizeof(unsigned long) - 1) / sizeof(unsigned long);
+}
 
+static uint32_t esdm_get_cpu_data(uint8_t *outbuf, uint32_t requested_bits)
+{
 	/* operate on full blocks */
 	BUILD_BUG_ON(ESDM_DRNG_SECURITY_STRENGTH_BYTES % sizeof(unsigned long));
 	BUILD_BUG_ON(ESDM_SEED_BUFFER_INIT_ADD_BITS % sizeof(unsigned long));
 	/* ensure we have aligned buffers */
 	BUILD_BUG_ON(ESDM_KCAPI_ALIGN % sizeof(unsigned long));
 
-	for (i = 0; i < (requested_bits >> 3); i += sizeof(unsigned long)) {
-		/*
-		 * The cast is appropriate as the thread local heap is aligned
-		 * to ESDM_KCAPI_ALIGN bits
-		 */
+	/*
+	 * The cast is appropriate as the thread local heap is aligned
+	 * to ESDM_KCAPI_ALIGN bits
+	 */
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-align"
-		if (!cpu_es_get((unsigned long *)(outbuf + i))) {
+	if (!cpu_es_get_bulk((unsigned long *)outbuf,
+			     esdm_cpu_words(requested_bits >> 3))) {
 #pragma GCC diagnostic pop
-			esdm_config_es_cpu_entropy_rate_set(0);
-			return 0;
-		}
+		esdm_config_es_cpu_entropy_rate_set(0);
+		return 0;
 	}
 
 	return requested_bits;
@@ -94,19 +100,17 @@ static uint32_t esdm_get_cpu_data_compress(uint8_t *outbuf,
 	void *shash = NULL;
 	bool shash_free = true;
 #endif
+	unsigned long chunk[ESDM_CPU_BULK_WORDS];
 	const struct esdm_hash_cb *hash_cb;
 	struct esdm_drng *drng = esdm_drng_node_instance();
-	uint32_t ent_bits = 0, i, partial_bits = 0, digestsize, digestsize_bits,
+	uint32_t ent_bits = 0, len, remaining, digestsize, digestsize_bits,
 		 full_bits;
 
-	mutex_reader_lock(&drng->hash_lock);
-	hash_cb = drng->hash_cb;
+	hash_cb = esdm_drng_hash_cb(drng);
 
 	if (shash_free) {
-		if (hash_cb->hash_alloc) {
-			if (hash_cb->hash_alloc((void **)&shash))
-				goto err;
-		}
+		if (esdm_hash_ctx_get(hash_cb, (void **)&shash))
+			goto err;
 	}
 
 	digestsize = hash_cb->hash_digestsize(shash);
@@ -115,34 +119,26 @@ static uint32_t esdm_get_cpu_data_compress(uint8_t *outbuf,
 	esdm_cap_requested(digestsize_bits, requested_bits);
 	full_bits = requested_bits * multiplier;
 
-	/* Calculate oversampling for SP800-90C */
-	if (esdm_sp80090c_compliant()) {
-		/* Complete amount of bits to be pulled */
+	/* Oversample the CPU entropy source for SP800-90C */
+	if (esdm_sp80090c_compliant())
 		full_bits += ESDM_OVERSAMPLE_ES_BITS * multiplier;
-		/* Full blocks that will be pulled */
-		multiplier = full_bits / requested_bits;
-		/* Partial block in bits to be pulled */
-		partial_bits = full_bits - (multiplier * requested_bits);
-	}
 
 	if (hash_cb->hash_init(shash))
 		goto out;
 
-	/* Hash all data from the CPU entropy source */
-	for (i = 0; i < multiplier; i++) {
-		ent_bits = esdm_get_cpu_data(outbuf, requested_bits);
-		if (!ent_bits)
+	/* Hash all data from the CPU entropy source in chunks */
+	for (remaining = full_bits >> 3; remaining; remaining -= len) {
+		len = min_uint32(remaining, sizeof(chunk));
+
+		if (!cpu_es_get_bulk(chunk, esdm_cpu_words(len))) {
+			esdm_config_es_cpu_entropy_rate_set(0);
 			goto out;
+		}
 
-		if (hash_cb->hash_update(shash, outbuf, ent_bits >> 3))
+		if (hash_cb->hash_update(shash, (uint8_t *)chunk, len))
 			goto err;
 	}
 
-	/* Hash partial block, if applicable */
-	ent_bits = esdm_get_cpu_data(outbuf, partial_bits);
-	if (ent_bits && hash_cb->hash_update(shash, outbuf, ent_bits >> 3))
-		goto err;
-
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
 		    "pulled %u bits from CPU RNG entropy source\n", full_bits);
 	ent_bits = requested_bits;
@@ -163,11 +159,11 @@ static uint32_t esdm_get_cpu_data_compress(uint8_t *outbuf,
 	}
 
 out:
-	if (shash)
+	memset_secure(chunk, 0, sizeof(chunk));
+	if (shash_free)
+		esdm_hash_ctx_put(hash_cb, shash);
+	else
 		hash_cb->hash_desc_zero(shash);
-	if (shash_free && shash)
-		hash_cb->hash_dealloc(shash);
-	mutex_reader_unlock(&drng->hash_lock);
 	esdm_drng_put_instances();
 	return ent_bits;
 
@@ -21,96 +21,352 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+#include "atomic.h"
 #include "build_bug_on.h"
 #include "esdm_config.h"
 #include "esdm_crypto.h"
 #include "esdm_definitions.h"
 #include "esdm_es_aux.h"
 #include "esdm_es_hwrand.h"
+#include "esdm_es_mgr.h"
 #include "esdm_node.h"
 #include "helper.h"
+#include "math_helper.h"
+#include "memset_secure.h"
 #include "mutex.h"
 
 #define ESDM_ES_HWRAND_AVAIL "/sys/devices/virtual/misc/hw_random/rng_available"
 #define ESDM_ES_HWRAND_IF "/dev/hwrng"
 
-static int esdm_hwrand_fd = -1;
+/* Maximum number of devices listed in ESDM_HWRAND_DEVICES */
+#define ESDM_HWRAND_DEVICES_MAX 4
+/* Size of one read from a device by the prefetch thread */
+#define ESDM_HWRAND_PREFETCH_BLOCK 512
+
+struct esdm_hwrand_dev {
+	char path[128];
+	int fd;
+#if (ESDM_HWRAND_PREFETCH_SIZE > 0)
+	/* Ring of prefetched data: @fill bytes starting at @head */
+	uint8_t ring[ESDM_HWRAND_PREFETCH_SIZE];
+	size_t head;
+	size_t fill;
+	pthread_mutex_t lock;
+	pthread_cond_t space;
+	pthread_t thread;
+	bool thread_started;
+#endif
+};
+
+static struct esdm_hwrand_dev esdm_hwrand_devs[ESDM_HWRAND_DEVICES_MAX];
+static unsigned int esdm_hwrand_devs_num = 0;
+
+#if (ESDM_HWRAND_PREFETCH_SIZE > 0)
+
+static atomic_t esdm_hwrand_prefetch_terminate = ATOMIC_INIT(0);
+
+/*
+ * Prefetch thread reading one device in large blocks into its ring. The
+ * thread only accepts a cancellation while it waits for the device to deliver
+ * data which allows terminating it even if the device blocks.
+ */
+static void *esdm_hwrand_prefetch(void *arg)
+{
+	struct esdm_hwrand_dev *dev = arg;
+	uint8_t block[ESDM_HWRAND_PREFETCH_BLOCK] __aligned(sizeof(uint64_t));
+	size_t tail, first;
+	int ret, state;
+
+	BUILD_BUG_ON(ESDM_HWRAND_PREFETCH_SIZE < ESDM_HWRAND_PREFETCH_BLOCK);
+
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+
+	for (;;) {
+		pthread_mutex_lock(&dev->lock);
+		while (!atomic_read(&esdm_hwrand_prefetch_terminate) &&
+		       dev->fill + sizeof(block) > sizeof(dev->ring))
+			pthread_cond_wait(&dev->space, &dev->lock);
+		pthread_mutex_unlock(&dev->lock);
+
+		if (atomic_read(&esdm_hwrand_prefetch_terminate))
+			break;
+
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &state);
+		ret = esdm_safe_read(dev->fd, block, sizeof(block));
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+		if (ret) {
+			esdm_logger(LOGGER_WARN, LOGGER_C_ES,
+				    "Reading %s failed, stopping its prefetch: %s\n",
+				    dev->path, strerror(-ret));
+			break;
+		}
+
+		pthread_mutex_lock(&dev->lock);
+		tail = (dev->head + dev->fill) % sizeof(dev->ring);
+		first = min_size(sizeof(block), sizeof(dev->ring) - tail);
+		memcpy(dev->ring + tail, block, first);
+		memcpy(dev->ring, block + first, sizeof(block) - first);
+		dev->fill += sizeof(block);
+		pthread_mutex_unlock(&dev->lock);
+
+		memset_secure(block, 0, sizeof(block));
+
+		/* Data is available for a reseed */
+		esdm_es_add_entropy();
+	}
+
+	memset_secure(block, 0, sizeof(block));
+	return NULL;
+}
+
+/* Take up to buflen bytes of prefetched data from the ring and erase them */
+static size_t esdm_hwrand_dev_get(struct esdm_hwrand_dev *dev, uint8_t *buf,
+				  size_t buflen)
+{
+	size_t len, first;
+
+	pthread_mutex_lock(&dev->lock);
+	len = min_size(buflen, dev->fill);
+	first = min_size(len, sizeof(dev->ring) - dev->head);
+	memcpy(buf, dev->ring + dev->head, first);
+	memset_secure(dev->ring + dev->head, 0, first);
+	memcpy(buf + first, dev->ring, len - first);
+	memset_secure(dev->ring, 0, len - first);
+	dev->head = (dev->head + len) % sizeof(dev->ring);
+	dev->fill -= len;
+	pthread_cond_signal(&dev->space);
+	pthread_mutex_unlock(&dev->lock);
+
+	return len;
+}
+
+static size_t esdm_hwrand_dev_avail(struct esdm_hwrand_dev *dev)
+{
+	size_t fill;
+
+	pthread_mutex_lock(&dev->lock);
+	fill = dev->fill;
+	pthread_mutex_unlock(&dev->lock);
+
+	return fill;
+}
+
+static void esdm_hwrand_dev_start(struct esdm_hwrand_dev *dev)
+{
+	dev->head = 0;
+	dev->fill = 0;
+	pthread_mutex_init(&dev->lock, NULL);
+	pthread_cond_init(&dev->space, NULL);
+	dev->thread_started =
+		!pthread_create(&dev->thread, NULL, esdm_hwrand_prefetch, dev);
+	if (!dev->thread_started) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_ES,
+			    "Starting the prefetch thread for %s failed\n",
+			    dev->path);
+	}
+}
+
+static void esdm_hwrand_dev_stop(struct esdm_hwrand_dev *dev)
+{
+	if (dev->thread_started) {
+		pthread_mutex_lock(&dev->lock);
+		pthread_cond_signal(&dev->space);
+		pthread_mutex_unlock(&dev->lock);
+
+		/* Interrupt a read blocked by the device */
+		pthread_cancel(dev->thread);
+		pthread_join(dev->thread, NULL);
+		dev->thread_started = false;
+	}
+
+	memset_secure(dev->ring, 0, sizeof(dev->ring));
+	dev->head = 0;
+	dev->fill = 0;
+	pthread_cond_destroy(&dev->space);
+	pthread_mutex_destroy(&dev->lock);
+}
+
+#else /* ESDM_HWRAND_PREFETCH_SIZE */
+
+/* Read the device synchronously */
+static size_t esdm_hwrand_dev_get(struct esdm_hwrand_dev *dev, uint8_t *buf,
+				  size_t buflen)
+{
+	return esdm_safe_read(dev->fd, buf, buflen) ? 0 : buflen;
+}
+
+static inline size_t esdm_hwrand_dev_avail(struct esdm_hwrand_dev *dev)
+{
+	(void)dev;
+	return SIZE_MAX;
+}
+
+static inline void esdm_hwrand_dev_start(struct esdm_hwrand_dev *dev)
+{
+	(void)dev;
+}
+
+static inline void esdm_hwrand_dev_stop(struct esdm_hwrand_dev *dev)
+{
+	(void)dev;
+}
+
+#endif /* ESDM_HWRAND_PREFETCH_SIZE */
 
 static void esdm_hwrand_finalize(void)
 {
-	if (esdm_hwrand_fd >= 0)
-		close(esdm_hwrand_fd);
-	esdm_hwrand_fd = -1;
+	unsigned int i;
+
+#if (ESDM_HWRAND_PREFETCH_SIZE > 0)
+	atomic_set(&esdm_hwrand_prefetch_terminate, 1);
+#endif
+
+	for (i = 0; i < esdm_hwrand_devs_num; i++) {
+		struct esdm_hwrand_dev *dev = &esdm_hwrand_devs[i];
+
+		esdm_hwrand_dev_stop(dev);
+		close(dev->fd);
+		dev->fd = -1;
+	}
+	esdm_hwrand_devs_num = 0;
 }
 
-static int esdm_hwrand_init(void)
+/* /dev/hwrng is only usable if the kernel has an RNG-provider for it */
+static bool esdm_hwrand_backed(const char *path)
 {
 	char buf[1];
-	size_t buflen = 1;
+	bool ret = true;
 	int fd;
 
-	/* Allow the init function to be called multiple times */
-	esdm_hwrand_finalize();
-
-	esdm_hwrand_fd = open(ESDM_ES_HWRAND_IF, O_RDONLY);
-	if (esdm_hwrand_fd < 0) {
-		esdm_logger(
-			LOGGER_WARN, LOGGER_C_ES,
-			"Disabling /dev/hwrng-based entropy source as device not present, error opening %s: %s\n",
-			ESDM_ES_HWRAND_IF, strerror(errno));
-		return 0;
-	}
+	if (strcmp(path, ESDM_ES_HWRAND_IF))
+		return true;
 
-	/* Check the presence of RNG-providers */
 	fd = open(ESDM_ES_HWRAND_AVAIL, O_RDONLY);
 	if (fd >= 0) {
-		if (esdm_safe_read(fd, (uint8_t *)buf, buflen) &&
+		if (esdm_safe_read(fd, (uint8_t *)buf, sizeof(buf)) &&
 		    buf[0] == '\n') {
 			esdm_logger(
 				LOGGER_WARN, LOGGER_C_ES,
 				"Disabling /dev/hwrng-based entropy source as it has no backing device\n");
-			close(esdm_hwrand_fd);
-			esdm_hwrand_fd = -1;
+			ret = false;
 		}
 		close(fd);
 	}
 
+	return ret;
+}
+
+static int esdm_hwrand_init(void)
+{
+	char devices[] = ESDM_HWRAND_DEVICES, *saveptr = NULL, *path;
+	struct esdm_hwrand_dev *dev;
+
+	/* Allow the init function to be called multiple times */
+	esdm_hwrand_finalize();
+
+#if (ESDM_HWRAND_PREFETCH_SIZE > 0)
+	atomic_set(&esdm_hwrand_prefetch_terminate, 0);
+#endif
+
+	for (path = strtok_r(devices, ",", &saveptr);
+	     path && esdm_hwrand_devs_num < ESDM_HWRAND_DEVICES_MAX;
+	     path = strtok_r(NULL, ",", &saveptr)) {
+		dev = &esdm_hwrand_devs[esdm_hwrand_devs_num];
+
+		dev->fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (dev->fd < 0) {
+			esdm_logger(
+				LOGGER_WARN, LOGGER_C_ES,
+				"Disabling hardware RNG %s as device not present: %s\n",
+				path, strerror(errno));
+			continue;
+		}
+
+		if (!esdm_hwrand_backed(path)) {
+			close(dev->fd);
+			dev->fd = -1;
+			continue;
+		}
+
+		snprintf(dev->path, sizeof(dev->path), "%s", path);
+		esdm_hwrand_dev_start(dev);
+		esdm_hwrand_devs_num++;
+
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+			    "Hardware RNG %s used as entropy source\n", path);
+	}
+
 	return 0;
 }
 
+/* Amount of data in bits which can be obtained without waiting */
+static uint32_t esdm_hwrand_avail_bits(uint32_t requested_bits)
+{
+	size_t avail = 0;
+	unsigned int i;
+
+	for (i = 0; i < esdm_hwrand_devs_num; i++) {
+		avail += esdm_hwrand_dev_avail(&esdm_hwrand_devs[i]);
+		if (avail >= (requested_bits >> 3))
+			return requested_bits;
+	}
+
+	return (uint32_t)(avail << 3);
+}
+
 static uint32_t esdm_hwrand_entropylevel(uint32_t requested_bits)
 {
-	if (esdm_hwrand_fd < 0)
+	if (!esdm_hwrand_devs_num)
 		return 0;
 
 	return esdm_fast_noise_entropylevel(
-		esdm_config_es_hwrand_entropy_rate(), requested_bits);
+		esdm_config_es_hwrand_entropy_rate(),
+		esdm_hwrand_avail_bits(requested_bits));
 }
 
 static uint32_t esdm_hwrand_poolsize(void)
 {
-	if (esdm_hwrand_fd < 0)
+	if (!esdm_hwrand_devs_num)
 		return 0;
 
-	return esdm_hwrand_entropylevel(esdm_security_strength());
+	return esdm_fast_noise_entropylevel(
+		esdm_config_es_hwrand_entropy_rate(), esdm_security_strength());
 }
 
+/*
+ * Combine the data of all devices: each call starts with another device and
+ * takes data from the next devices as long as the request is not satisfied.
+ */
 static void esdm_hwrand_get(struct entropy_es *eb_es, uint32_t requested_bits,
 			    bool __unused unsused)
 {
-	if (esdm_hwrand_fd < 0)
+	static atomic_t esdm_hwrand_next = ATOMIC_INIT(0);
+	size_t want = requested_bits >> 3, got = 0;
+	unsigned int i, start;
+
+	if (!esdm_hwrand_devs_num)
 		goto err;
 
-	if (esdm_safe_read(esdm_hwrand_fd, eb_es->e, requested_bits >> 3))
+	start = (unsigned int)atomic_inc(&esdm_hwrand_next);
+	for (i = 0; i < esdm_hwrand_devs_num && got < want; i++) {
+		got += esdm_hwrand_dev_get(
+			&esdm_hwrand_devs[(start + i) % esdm_hwrand_devs_num],
+			eb_es->e + got, want - got);
+	}
+
+	if (!got)
 		goto err;
 
-	eb_es->e_bits = esdm_hwrand_entropylevel(requested_bits);
+	eb_es->e_bits = esdm_fast_noise_entropylevel(
+		esdm_config_es_hwrand_entropy_rate(), (uint32_t)(got << 3));
 	esdm_logger(
 		LOGGER_DEBUG, LOGGER_C_ES,
-		"obtained %u bits of entropy from /dev/hwrng RNG entropy source\n",
+		"obtained %u bits of entropy from hardware RNG entropy source\n",
 		eb_es->e_bits);
 
 	return;
@@ -130,9 +386,17 @@ static void esdm_hwrand_es_state(char *buf, size_t buflen)
 
 static bool esdm_hwrand_active(void)
 {
-	return (esdm_hwrand_fd != -1);
+	return !!esdm_hwrand_devs_num;
 }
 
+/* The prefetch rings take the place of the blocks filled by the ES monitor */
+#if (ESDM_HWRAND_ASYNC_BLOCKS > 0) && (ESDM_HWRAND_PREFETCH_SIZE == 0)
+DEFINE_ESDM_ES_ASYNC(esdm_hwrand_async, ESDM_HWRAND_ASYNC_BLOCKS);
+#define ESDM_HWRAND_ASYNC (&esdm_hwrand_async)
+#else
+#define ESDM_HWRAND_ASYNC NULL
+#endif
+
 struct esdm_es_cb esdm_es_hwrand = {
 	.name = "LinuxHWRand",
 	.init = esdm_hwrand_init,
@@ -145,4 +409,5 @@ struct esdm_es_cb esdm_es_hwrand = {
 	.reset = NULL,
 	.active = esdm_hwrand_active,
 	.switch_hash = NULL,
+	.async = ESDM_HWRAND_ASYNC,
 };
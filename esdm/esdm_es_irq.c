@@ -37,6 +37,10 @@
 
 static int esdm_irq_entropy_fd = -1;
 static uint32_t esdm_irq_requested_bits_set = 0;
+/* Entropy rate in events last configured with the kernel, 0 if none */
+static uint32_t esdm_irq_rate_events_set = 0;
+static struct esdm_kernel_ent_cache esdm_irq_ent_cache =
+	ESDM_KERNEL_ENT_CACHE_INIT;
 static enum esdm_es_data_size esdm_irq_data_size = esdm_es_data_equal;
 
 static void esdm_irq_finalize(void)
@@ -44,6 +48,7 @@ static void esdm_irq_finalize(void)
 	if (esdm_irq_entropy_fd >= 0)
 		close(esdm_irq_entropy_fd);
 	esdm_irq_entropy_fd = -1;
+	esdm_irq_rate_events_set = 0;
 }
 
 bool esdm_irq_enabled(void)
@@ -82,22 +87,23 @@ static int esdm_irq_set_entropy_rate(uint32_t requested_bits)
 			     ESDM_DRNG_SECURITY_STRENGTH_BITS / entropy[1];
 	}
 
+	/* The kernel already uses this configuration */
+	if (!entropy[0] && entropy[1] == esdm_irq_rate_events_set)
+		return 0;
+
 	/* Set current entropy rate */
 	ret = ioctl(esdm_irq_entropy_fd, ESDM_IRQ_CONF, &entropy);
 	if (ret < 0)
 		return -EINVAL;
 
 	esdm_irq_requested_bits_set = requested_bits;
+	esdm_irq_rate_events_set = entropy[1];
+	esdm_kernel_entropylevel_invalidate();
 	return 0;
 }
 
-static uint32_t esdm_irq_entropylevel(uint32_t requested_bits)
+static uint32_t esdm_irq_entropylevel_read(bool refresh)
 {
-	uint32_t entropy;
-	int ret;
-
-	(void)requested_bits;
-
 	/*
 	 * Note, due to esdm_config_es_sched_entropy_rate_set, IRQ and Sched ES
 	 * together are not allowed to deliver entropy.
@@ -111,11 +117,16 @@ static uint32_t esdm_irq_entropylevel(uint32_t requested_bits)
 		return 0;
 
 	/* Read entropy level */
-	ret = ioctl(esdm_irq_entropy_fd, ESDM_IRQ_AVAIL_ENTROPY, &entropy);
-	if (ret < 0)
-		return 0;
+	return esdm_kernel_entropylevel(&esdm_irq_ent_cache,
+					esdm_irq_entropy_fd,
+					ESDM_IRQ_AVAIL_ENTROPY, refresh);
+}
 
-	return entropy;
+static uint32_t esdm_irq_entropylevel(uint32_t requested_bits)
+{
+	(void)requested_bits;
+
+	return esdm_irq_entropylevel_read(false);
 }
 
 static int esdm_irq_initialize(void)
@@ -212,7 +223,8 @@ static int esdm_irq_seed_monitor(void)
 	if (esdm_irq_entropy_fd < 0)
 		return 0;
 
-	ent = esdm_irq_entropylevel(esdm_security_strength());
+	/* The monitor always obtains the current entropy level */
+	ent = esdm_irq_entropylevel_read(true);
 
 	if (!esdm_config_es_irq_entropy_rate())
 		return 0;
@@ -271,6 +283,64 @@ err:
 	eb_es->e_bits = 0;
 }
 
+/* Prepare the batch read of the interrupt ES with the kernel */
+static int esdm_irq_kernel_batch(uint32_t requested_bits)
+{
+	if (esdm_irq_entropy_fd < 0)
+		return -1;
+
+	esdm_irq_set_requested_bits(requested_bits);
+
+	return esdm_irq_entropy_fd;
+}
+
+/* Bucket of the log2 histogram below which pct percent of the events are */
+static unsigned int esdm_irq_perf_percentile(const uint64_t *hist,
+					     uint64_t total, unsigned int pct)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < ESDM_ES_PERF_HIST_BUCKETS - 1; i++) {
+		sum += hist[i];
+		if (sum * 100 >= total * pct)
+			break;
+	}
+
+	return i;
+}
+
+static void esdm_irq_perf_state_one(char *buf, size_t buflen,
+				    const char *name, const uint64_t *hist)
+{
+	uint64_t total = 0;
+	size_t len = strlen(buf);
+	unsigned int i;
+
+	for (i = 0; i < ESDM_ES_PERF_HIST_BUCKETS; i++)
+		total += hist[i];
+
+	if (!total || len >= buflen)
+		return;
+
+	snprintf(buf + len, buflen - len,
+		 " %s cost (cycles): p50 < 2^%u, p99 < 2^%u\n", name,
+		 esdm_irq_perf_percentile(hist, total, 50),
+		 esdm_irq_perf_percentile(hist, total, 99));
+}
+
+/* Append the cost of the kernel interrupt hook if the kernel records it */
+static void esdm_irq_perf_state(char *buf, size_t buflen)
+{
+	struct esdm_es_perf_hist hist;
+
+	if (ioctl(esdm_irq_entropy_fd, ESDM_IRQ_PERF_HIST, &hist) < 0)
+		return;
+
+	esdm_irq_perf_state_one(buf, buflen, "Interrupt hook", hist.hook);
+	esdm_irq_perf_state_one(buf, buflen, "Compression", hist.compress);
+}
+
 static void esdm_irq_es_state(char *buf, size_t buflen)
 {
 	char status[250], *status_p = (buflen < sizeof(status)) ? status : buf;
@@ -290,6 +360,9 @@ static void esdm_irq_es_state(char *buf, size_t buflen)
 			snprintf(buf, buflen, "%s", status_p);
 #pragma GCC diagnostic pop
 		}
+
+		if (ret >= 0)
+			esdm_irq_perf_state(buf, buflen);
 	} else {
 		snprintf(buf, buflen, " disabled - missing kernel support\n");
 	}
@@ -305,6 +378,10 @@ static void esdm_irq_reset(void)
 	if (esdm_irq_entropy_fd >= 0) {
 		int ret = ioctl(esdm_irq_entropy_fd, ESDM_IRQ_CONF, reset);
 
+		/* Configure the entropy rate again with the next request */
+		esdm_irq_rate_events_set = 0;
+		esdm_kernel_entropylevel_invalidate();
+
 		if (ret < 0) {
 			esdm_logger(
 				LOGGER_ERR, LOGGER_C_ES,
@@ -318,6 +395,13 @@ static bool esdm_irq_active(void)
 	return esdm_config_es_irq_retry() || (esdm_irq_entropy_fd != -1);
 }
 
+#if (ESDM_IRQ_ASYNC_BLOCKS > 0)
+DEFINE_ESDM_ES_ASYNC(esdm_irq_async, ESDM_IRQ_ASYNC_BLOCKS);
+#define ESDM_IRQ_ASYNC (&esdm_irq_async)
+#else
+#define ESDM_IRQ_ASYNC NULL
+#endif
+
 struct esdm_es_cb esdm_es_irq = {
 	.name = "Interrupt",
 	.init = esdm_irq_initialize,
@@ -330,4 +414,7 @@ struct esdm_es_cb esdm_es_irq = {
 	.reset = esdm_irq_reset,
 	.active = esdm_irq_active,
 	.switch_hash = NULL,
+	.async = ESDM_IRQ_ASYNC,
+	.kernel_batch = esdm_irq_kernel_batch,
+	.kernel_batch_id = ESDM_ES_BATCH_IRQ,
 };
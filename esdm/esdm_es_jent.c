@@ -19,18 +19,22 @@
  * DAMAGE.
  */
 
+#include "arch.h"
 #include <jitterentropy.h>
+#include <pthread.h>
 
 #include "atomic.h"
 #include "build_bug_on.h"
 #include "config.h"
 #include "esdm_config.h"
+#include "esdm_cpu_class.h"
 #include "esdm_definitions.h"
 #include "esdm_es_aux.h"
 #include "esdm_es_jent.h"
 #include "esdm_es_mgr.h"
 #include "helper.h"
 #include "esdm_logger.h"
+#include "metrics.h"
 #include "ret_checkers.h"
 
 /*
@@ -64,7 +68,8 @@ enum esdm_jent_async_state {
 static volatile enum esdm_jent_async_state
 	esdm_jent_async_set[ESDM_JENT_ENTROPY_BLOCKS];
 
-static struct rand_data *esdm_jent_state_thread = NULL;
+/* Jitter RNG instances filling the entropy buffer in parallel */
+static struct rand_data *esdm_jent_state_thread[ESDM_JENT_ASYNC_INSTANCES];
 #endif
 
 static uint32_t esdm_jent_entropylevel(uint32_t requested_bits)
@@ -125,16 +130,11 @@ err:
 
 #if (ESDM_JENT_ENTROPY_BLOCKS != 0)
 
-static int esdm_jent_async_monitor(void)
+/* Fill the empty slots with the given Jitter RNG instance */
+static void esdm_jent_async_fill(unsigned int instance)
 {
 	unsigned int i, requested_bits = esdm_get_seed_entropy_osr(true);
 
-	if (!esdm_config_es_jent_async_enabled())
-		return 0;
-
-	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
-		    "Jitter RNG block filling started\n");
-
 	for (i = 0; i < ESDM_JENT_ENTROPY_BLOCKS; i++) {
 		if (__sync_val_compare_and_swap(&esdm_jent_async_set[i],
 						buffer_empty,
@@ -145,16 +145,69 @@ static int esdm_jent_async_monitor(void)
 		 * Always gather entropy data including
 		 * potential oversampling factor.
 		 */
-		esdm_jent_get(esdm_jent_state_thread, &esdm_jent_async[i],
-			      requested_bits, false);
+		esdm_jent_get(esdm_jent_state_thread[instance],
+			      &esdm_jent_async[i], requested_bits, false);
 
 		esdm_jent_async_set[i] = buffer_filled;
 
 		esdm_logger(
 			LOGGER_DEBUG, LOGGER_C_ES,
-			"Jitter RNG ES monitor: filled slot %u with %u bits of entropy\n",
-			i, requested_bits);
+			"Jitter RNG ES monitor: instance %u filled slot %u with %u bits of entropy\n",
+			instance, i, requested_bits);
 	}
+}
+
+#if (ESDM_JENT_ASYNC_INSTANCES > 1)
+/*
+ * Additional Jitter RNG instance filling the slots in parallel to the ES
+ * monitor. It is bound to its own CPU to not compete with the other instances.
+ * With the core class placement, the CPU is an efficiency core to keep the
+ * timing of all instances within one class of cores.
+ */
+static void *esdm_jent_async_worker(void *arg)
+{
+	struct esdm_arch_cpu_affinity prev;
+	unsigned int instance = (unsigned int)(uintptr_t)arg;
+
+	if (esdm_cpu_class_pin(esdm_cpu_class_efficiency, instance, &prev))
+		esdm_arch_cpu_pin(instance % esdm_online_nodes(), &prev);
+	esdm_jent_async_fill(instance);
+
+	return NULL;
+}
+#endif
+
+static int esdm_jent_async_monitor(void)
+{
+#if (ESDM_JENT_ASYNC_INSTANCES > 1)
+	pthread_t workers[ESDM_JENT_ASYNC_INSTANCES];
+	bool started[ESDM_JENT_ASYNC_INSTANCES] = { false };
+	unsigned int i;
+#endif
+
+	if (!esdm_config_es_jent_async_enabled())
+		return 0;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+		    "Jitter RNG block filling started\n");
+
+#if (ESDM_JENT_ASYNC_INSTANCES > 1)
+	for (i = 1; i < ESDM_JENT_ASYNC_INSTANCES; i++) {
+		started[i] = !pthread_create(&workers[i], NULL,
+					     esdm_jent_async_worker,
+					     (void *)(uintptr_t)i);
+	}
+#endif
+
+	/* The ES monitor operates the first instance */
+	esdm_jent_async_fill(0);
+
+#if (ESDM_JENT_ASYNC_INSTANCES > 1)
+	for (i = 1; i < ESDM_JENT_ASYNC_INSTANCES; i++) {
+		if (started[i])
+			pthread_join(workers[i], NULL);
+	}
+#endif
 
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
 		    "Jitter RNG block filling completed\n");
@@ -235,8 +288,11 @@ static int esdm_jent_async_init(void)
 	for (i = 0; i < ESDM_JENT_ENTROPY_BLOCKS; i++)
 		esdm_jent_async_set[i] = buffer_empty;
 
-	esdm_jent_state_thread = jent_entropy_collector_alloc(0, 0);
-	CKNULL(esdm_jent_state_thread, -EFAULT);
+	for (i = 0; i < ESDM_JENT_ASYNC_INSTANCES; i++) {
+		esdm_jent_state_thread[i] = jent_entropy_collector_alloc(0, 0);
+		CKNULL(esdm_jent_state_thread[i], -EFAULT);
+	}
+	esdm_mem_account(esdm_mem_es, sizeof(esdm_jent_async));
 
 out:
 	return ret;
@@ -244,11 +300,16 @@ out:
 
 static void esdm_jent_async_fini(void)
 {
-	jent_entropy_collector_free(esdm_jent_state_thread);
-	esdm_jent_state_thread = NULL;
+	unsigned int i;
+
+	for (i = 0; i < ESDM_JENT_ASYNC_INSTANCES; i++) {
+		jent_entropy_collector_free(esdm_jent_state_thread[i]);
+		esdm_jent_state_thread[i] = NULL;
+	}
 
 	/* Reset state */
 	memset_secure(esdm_jent_async, 0, sizeof(esdm_jent_async));
+	esdm_mem_account(esdm_mem_es, -(int64_t)sizeof(esdm_jent_async));
 }
 
 #else
@@ -294,6 +355,13 @@ static int esdm_jent_initialize(void)
 	/* Allow the init function to be called multiple times */
 	esdm_jent_finalize();
 
+	/* Skip the startup tests of a Jitter RNG disabled at startup */
+	if (!esdm_config_es_jent_entropy_rate()) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ES,
+			    "Jitter RNG disabled, not initialized\n");
+		return 0;
+	}
+
 	mutex_w_init(&esdm_jent_lock, 1, 1);
 
 	CKINT(jent_entropy_init());
@@ -21,21 +21,69 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <kcapi.h>
 
+#include "atomic.h"
+#include "build_bug_on.h"
+#include "config.h"
 #include "esdm_config.h"
 #include "esdm_es_aux.h"
 #include "esdm_es_jent_kernel.h"
+#include "esdm_es_mgr.h"
 #include "helper.h"
+#include "memset_secure.h"
 #include "mutex.h"
 
 static struct kcapi_handle *jent_rng = NULL;
 static DEFINE_MUTEX_UNLOCKED(jent_rng_mutex);
 
+#if (ESDM_JENT_KERNEL_ENTROPY_BLOCKS != 0)
+/* Entropy buffer filled from the kernel - must be power of 2 */
+#define ESDM_JENT_KERNEL_ENTROPY_BLOCKS_MASK                                   \
+	(ESDM_JENT_KERNEL_ENTROPY_BLOCKS - 1)
+
+static struct entropy_es esdm_jent_kernel_async
+	[ESDM_JENT_KERNEL_ENTROPY_BLOCKS] __aligned(sizeof(uint64_t));
+
+enum esdm_jent_kernel_async_state {
+	buffer_empty,
+	buffer_filling,
+	buffer_filled,
+	buffer_reading,
+};
+static volatile enum esdm_jent_kernel_async_state
+	esdm_jent_kernel_async_set[ESDM_JENT_KERNEL_ENTROPY_BLOCKS];
+
+/*
+ * AF_ALG handles filling the entropy buffer in parallel - each handle has its
+ * own instance of the kernel Jitter RNG
+ */
+static struct kcapi_handle
+	*jent_rng_async[ESDM_JENT_KERNEL_ASYNC_INSTANCES] = { NULL };
+#endif
+
 static void esdm_jent_kernel_finalize_locked(void)
 {
+#if (ESDM_JENT_KERNEL_ENTROPY_BLOCKS != 0)
+	unsigned int i;
+
+	for (i = 0; i < ESDM_JENT_KERNEL_ASYNC_INSTANCES; i++) {
+		if (jent_rng_async[i]) {
+			kcapi_rng_destroy(jent_rng_async[i]);
+			jent_rng_async[i] = NULL;
+		}
+	}
+
+	memset_secure(esdm_jent_kernel_async, 0,
+		      sizeof(esdm_jent_kernel_async));
+	for (i = 0; i < ESDM_JENT_KERNEL_ENTROPY_BLOCKS; i++)
+		esdm_jent_kernel_async_set[i] = buffer_empty;
+#endif
+
 	if (jent_rng == NULL)
 		return;
 
@@ -65,8 +113,26 @@ static int esdm_jent_kernel_init(void)
 			LOGGER_WARN, LOGGER_C_ES,
 			"Disabling kernel-based jitter entropy source as it is not present, error: %s\n",
 			strerror(errno));
+		jent_rng = NULL;
 	}
 
+#if (ESDM_JENT_KERNEL_ENTROPY_BLOCKS != 0)
+	if (jent_rng) {
+		unsigned int i;
+
+		for (i = 0; i < ESDM_JENT_KERNEL_ASYNC_INSTANCES; i++) {
+			if (kcapi_rng_init(&jent_rng_async[i],
+					   "jitterentropy_rng", 0)) {
+				esdm_logger(
+					LOGGER_WARN, LOGGER_C_ES,
+					"Allocation of kernel-based jitter RNG instance %u for the entropy buffer failed\n",
+					i);
+				jent_rng_async[i] = NULL;
+			}
+		}
+	}
+#endif
+
 	mutex_unlock(&jent_rng_mutex);
 
 	return 0;
@@ -89,32 +155,186 @@ static uint32_t esdm_jent_kernel_poolsize(void)
 	return esdm_jent_kernel_entropylevel(esdm_security_strength());
 }
 
-static void esdm_jent_kernel_get(struct entropy_es *eb_es,
-				 uint32_t requested_bits, bool __unused unsused)
+/* Read from the given handle - caller must hold the jent_rng_mutex */
+static void esdm_jent_kernel_read(struct kcapi_handle *handle,
+				  struct entropy_es *eb_es,
+				  uint32_t requested_bits)
 {
-	mutex_reader_lock(&jent_rng_mutex);
-
-	if (jent_rng == NULL)
+	if (handle == NULL)
 		goto err;
 
-	if (kcapi_rng_generate(jent_rng, eb_es->e, requested_bits >> 3) < 0)
+	if (kcapi_rng_generate(handle, eb_es->e, requested_bits >> 3) < 0)
 		goto err;
 
 	eb_es->e_bits = esdm_jent_kernel_entropylevel(requested_bits);
 	esdm_logger(
 		LOGGER_DEBUG, LOGGER_C_ES,
-		"obtained %u bits of entropy from kernel-based jitter RNG entropy source\n",
-		eb_es->e_bits);
-
-	mutex_reader_unlock(&jent_rng_mutex);
+		"obtained %u bits of entropy from %ssynchronous kernel-based jitter RNG entropy source\n",
+		eb_es->e_bits, (handle == jent_rng) ? "" : "a");
 
 	return;
 
 err:
-	mutex_reader_unlock(&jent_rng_mutex);
 	eb_es->e_bits = 0;
 }
 
+static void esdm_jent_kernel_get_sync(struct entropy_es *eb_es,
+				      uint32_t requested_bits)
+{
+	mutex_reader_lock(&jent_rng_mutex);
+	esdm_jent_kernel_read(jent_rng, eb_es, requested_bits);
+	mutex_reader_unlock(&jent_rng_mutex);
+}
+
+#if (ESDM_JENT_KERNEL_ENTROPY_BLOCKS != 0)
+
+/* Fill the empty slots with the given AF_ALG handle */
+static void esdm_jent_kernel_async_fill(unsigned int instance)
+{
+	unsigned int i, requested_bits = esdm_get_seed_entropy_osr(true);
+
+	mutex_reader_lock(&jent_rng_mutex);
+
+	for (i = 0; i < ESDM_JENT_KERNEL_ENTROPY_BLOCKS; i++) {
+		if (!jent_rng_async[instance])
+			break;
+
+		if (__sync_val_compare_and_swap(&esdm_jent_kernel_async_set[i],
+						buffer_empty,
+						buffer_filling) != buffer_empty)
+			continue;
+
+		/*
+		 * Always gather entropy data including
+		 * potential oversampling factor.
+		 */
+		esdm_jent_kernel_read(jent_rng_async[instance],
+				      &esdm_jent_kernel_async[i],
+				      requested_bits);
+
+		if (!esdm_jent_kernel_async[i].e_bits) {
+			/* The kernel failed, try again later */
+			esdm_jent_kernel_async_set[i] = buffer_empty;
+			break;
+		}
+
+		esdm_jent_kernel_async_set[i] = buffer_filled;
+
+		esdm_logger(
+			LOGGER_DEBUG, LOGGER_C_ES,
+			"Kernel jitter RNG ES monitor: instance %u filled slot %u with %u bits of entropy\n",
+			instance, i, requested_bits);
+	}
+
+	mutex_reader_unlock(&jent_rng_mutex);
+}
+
+#if (ESDM_JENT_KERNEL_ASYNC_INSTANCES > 1)
+static void *esdm_jent_kernel_async_worker(void *arg)
+{
+	esdm_jent_kernel_async_fill((unsigned int)(uintptr_t)arg);
+	return NULL;
+}
+#endif
+
+static int esdm_jent_kernel_async_monitor(void)
+{
+#if (ESDM_JENT_KERNEL_ASYNC_INSTANCES > 1)
+	pthread_t workers[ESDM_JENT_KERNEL_ASYNC_INSTANCES];
+	bool started[ESDM_JENT_KERNEL_ASYNC_INSTANCES] = { false };
+	unsigned int i;
+#endif
+
+	if (jent_rng == NULL)
+		return 0;
+
+#if (ESDM_JENT_KERNEL_ASYNC_INSTANCES > 1)
+	for (i = 1; i < ESDM_JENT_KERNEL_ASYNC_INSTANCES; i++) {
+		started[i] = !pthread_create(&workers[i], NULL,
+					     esdm_jent_kernel_async_worker,
+					     (void *)(uintptr_t)i);
+	}
+#endif
+
+	/* The ES monitor operates the first instance */
+	esdm_jent_kernel_async_fill(0);
+
+#if (ESDM_JENT_KERNEL_ASYNC_INSTANCES > 1)
+	for (i = 1; i < ESDM_JENT_KERNEL_ASYNC_INSTANCES; i++) {
+		if (started[i])
+			pthread_join(workers[i], NULL);
+	}
+#endif
+
+	return 0;
+}
+
+static void esdm_jent_kernel_async_get(struct entropy_es *eb_es,
+				       uint32_t requested_bits)
+{
+	static atomic_t idx = ATOMIC_INIT(-1);
+	unsigned int slot;
+
+	/* ESDM_JENT_KERNEL_ENTROPY_BLOCKS must be a power of 2 */
+	BUILD_BUG_ON(ESDM_JENT_KERNEL_ENTROPY_BLOCKS &
+		     (ESDM_JENT_KERNEL_ENTROPY_BLOCKS - 1));
+	slot = ((unsigned int)atomic_inc(&idx)) &
+	       ESDM_JENT_KERNEL_ENTROPY_BLOCKS_MASK;
+
+	if (__sync_val_compare_and_swap(&esdm_jent_kernel_async_set[slot],
+					buffer_filled,
+					buffer_reading) != buffer_filled) {
+		esdm_logger(
+			LOGGER_DEBUG, LOGGER_C_ES,
+			"Kernel jitter RNG ES monitor: buffer slot %u exhausted\n",
+			slot);
+
+		esdm_jent_kernel_get_sync(eb_es, requested_bits);
+		esdm_es_mgr_monitor_wakeup();
+		return;
+	}
+
+	memcpy(eb_es->e, esdm_jent_kernel_async[slot].e,
+	       ESDM_DRNG_INIT_SEED_SIZE_BYTES);
+	eb_es->e_bits = esdm_jent_kernel_async[slot].e_bits;
+
+	esdm_logger(
+		LOGGER_DEBUG, LOGGER_C_ES,
+		"obtained %u bits of entropy from kernel-based jitter RNG buffer slot %u\n",
+		eb_es->e_bits, slot);
+
+	memset_secure(&esdm_jent_kernel_async[slot], 0,
+		      sizeof(struct entropy_es));
+
+	esdm_jent_kernel_async_set[slot] = buffer_empty;
+
+	if (!(slot % (ESDM_JENT_KERNEL_ENTROPY_BLOCKS / 4)) && slot)
+		esdm_es_mgr_monitor_wakeup();
+}
+
+static void esdm_jent_kernel_get(struct entropy_es *eb_es,
+				 uint32_t requested_bits, bool __unused unsused)
+{
+	if (requested_bits == esdm_get_seed_entropy_osr(true))
+		esdm_jent_kernel_async_get(eb_es, requested_bits);
+	else
+		esdm_jent_kernel_get_sync(eb_es, requested_bits);
+}
+
+#define ESDM_JENT_KERNEL_MONITOR esdm_jent_kernel_async_monitor
+
+#else /* ESDM_JENT_KERNEL_ENTROPY_BLOCKS */
+
+static void esdm_jent_kernel_get(struct entropy_es *eb_es,
+				 uint32_t requested_bits, bool __unused unsused)
+{
+	esdm_jent_kernel_get_sync(eb_es, requested_bits);
+}
+
+#define ESDM_JENT_KERNEL_MONITOR NULL
+
+#endif /* ESDM_JENT_KERNEL_ENTROPY_BLOCKS */
+
 static void esdm_jent_kernel_es_state(char *buf, size_t buflen)
 {
 	/* Assume the esdm_drng_init lock is taken by caller */
@@ -134,7 +354,7 @@ struct esdm_es_cb esdm_es_jent_kernel = {
 	.name = "KernelJitterRNG",
 	.init = esdm_jent_kernel_init,
 	.fini = esdm_jent_kernel_finalize,
-	.monitor_es = NULL,
+	.monitor_es = ESDM_JENT_KERNEL_MONITOR,
 	.get_ent = esdm_jent_kernel_get,
 	.curr_entropy = esdm_jent_kernel_entropylevel,
 	.max_entropy = esdm_jent_kernel_poolsize,
@@ -265,6 +265,13 @@ static bool esdm_krng_active(void)
 	return true;
 }
 
+#if (ESDM_KERNEL_RNG_ASYNC_BLOCKS > 0)
+DEFINE_ESDM_ES_ASYNC(esdm_krng_async, ESDM_KERNEL_RNG_ASYNC_BLOCKS);
+#define ESDM_KRNG_ASYNC (&esdm_krng_async)
+#else
+#define ESDM_KRNG_ASYNC NULL
+#endif
+
 struct esdm_es_cb esdm_es_krng = {
 	.name = "KernelRNG",
 	.init = esdm_krng_init,
@@ -277,4 +284,5 @@ struct esdm_es_cb esdm_es_krng = {
 	.reset = NULL,
 	.active = esdm_krng_active,
 	.switch_hash = NULL,
+	.async = ESDM_KRNG_ASYNC,
 };
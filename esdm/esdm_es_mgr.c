@@ -22,13 +22,17 @@
 #define _POSIX_C_SOURCE 200112L
 #include <errno.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "build_bug_on.h"
 #include "es_cpu/cpu_random.h"
 #include "esdm.h"
+#include "esdm_config.h"
 #include "esdm_drng_mgr.h"
 #include "esdm_es_aux.h"
 #include "esdm_es_cpu.h"
@@ -37,17 +41,23 @@
 #include "esdm_es_jent.h"
 #include "esdm_es_jent_kernel.h"
 #include "esdm_es_krng.h"
+#include "esdm_es_upstream.h"
 #include "esdm_es_mgr.h"
+#include "esdm_probes.h"
 #include "esdm_es_sched.h"
+#include "esdm_es_synth.h"
 #include "esdm_interface_dev_common.h"
 #include "esdm_shm_status.h"
+#include "esdm_startup.h"
 #include "helper.h"
 #include "esdm_logger.h"
 #include "memset_secure.h"
+#include "metrics.h"
 #include "mutex_w.h"
 #include "queue.h"
 #include "ret_checkers.h"
 #include "test_pertubation.h"
+#include "threading_support.h"
 #include "visibility.h"
 
 struct esdm_state {
@@ -115,28 +125,377 @@ struct esdm_es_cb *esdm_es[] = {
 #endif
 #ifdef ESDM_ES_JENT_KERNEL
 	&esdm_es_jent_kernel,
+#endif
+#ifdef ESDM_ES_UPSTREAM
+	&esdm_es_upstream,
+#endif
+#ifdef ESDM_ES_SYNTH
+	&esdm_es_synth,
 #endif
 	&esdm_es_aux
 };
 
+/****************************** ES statistics *********************************/
+
+/* Weight of a new sample in the moving averages: 1 / 2^ESDM_ES_STATS_SHIFT */
+#define ESDM_ES_STATS_SHIFT 3
+
+/* Fixed-point scale of the failure rate */
+#define ESDM_ES_FAILURE_SCALE 256
+
+/* An ES with a larger average collection latency in microseconds is slow */
+#define ESDM_ES_SLOW_US 1000
+
+/*
+ * struct esdm_es_stats - moving averages of the collections from an ES
+ * @latency_us: Collection latency in microseconds
+ * @bits: Delivered entropy in bits
+ * @failures: Rate of collections delivering no entropy, scaled by
+ *	      ESDM_ES_FAILURE_SCALE
+ * @samples: Number of collections
+ *
+ * The averages are updated without a lock: concurrent collections of the same
+ * ES only happen with the parallel collection and a lost update merely skews
+ * the average.
+ */
+struct esdm_es_stats {
+	atomic_t latency_us;
+	atomic_t bits;
+	atomic_t failures;
+	atomic_t samples;
+};
+
+static struct esdm_es_stats esdm_es_stats[esdm_ext_es_last];
+
+static void esdm_es_stats_ema(atomic_t *avg, uint32_t sample, bool first)
+{
+	uint32_t old = atomic_read_u32(avg);
+
+	if (!first) {
+		sample = old - (old >> ESDM_ES_STATS_SHIFT) +
+			 (sample >> ESDM_ES_STATS_SHIFT);
+	}
+	atomic_set(avg, (int)sample);
+}
+
+/* Collect entropy from the ES and account the collection */
+static void esdm_es_get_ent_stats(unsigned int i, struct entropy_es *eb_es,
+				  uint32_t requested_bits, bool fully_seeded)
+{
+	struct esdm_es_stats *stats = &esdm_es_stats[i];
+	struct timespec start, end;
+	uint64_t latency_us;
+	bool first;
+
+	ESDM_PROBE1(es_collect_start, esdm_es[i]->name);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	esdm_es[i]->get_ent(eb_es, requested_bits, fully_seeded);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ESDM_PROBE2(es_collect_end, esdm_es[i]->name, eb_es->e_bits);
+
+	latency_us = ((uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL +
+		      (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec) /
+		     1000;
+
+	first = atomic_inc(&stats->samples) == 1;
+	esdm_es_stats_ema(&stats->latency_us,
+			  (uint32_t)min_uint64(latency_us, UINT32_MAX), first);
+	esdm_es_stats_ema(&stats->bits, eb_es->e_bits, first);
+	esdm_es_stats_ema(&stats->failures,
+			  eb_es->e_bits ? 0 : ESDM_ES_FAILURE_SCALE, first);
+}
+
+/* Is the collection from the ES slow or unreliable? */
+static bool esdm_es_stats_slow(unsigned int i)
+{
+	struct esdm_es_stats *stats = &esdm_es_stats[i];
+
+	return atomic_read_u32(&stats->latency_us) > ESDM_ES_SLOW_US ||
+	       atomic_read_u32(&stats->failures) > ESDM_ES_FAILURE_SCALE / 2;
+}
+
+/*
+ * Order the ES by the expected cost of their collection: reliable ES first,
+ * each group ordered by the average latency.
+ */
+static void esdm_es_stats_order(unsigned int order[esdm_ext_es_last])
+{
+	uint64_t key[esdm_ext_es_last];
+	unsigned int i, j;
+
+	for_each_esdm_es (i) {
+		struct esdm_es_stats *stats = &esdm_es_stats[i];
+		uint64_t k = atomic_read_u32(&stats->latency_us);
+
+		if (atomic_read_u32(&stats->failures) >
+		    ESDM_ES_FAILURE_SCALE / 2)
+			k |= UINT64_C(1) << 32;
+
+		/* Insertion sort keeping the ES order for equal keys */
+		for (j = i; j > 0 && key[j - 1] > k; j--) {
+			key[j] = key[j - 1];
+			order[j] = order[j - 1];
+		}
+		key[j] = k;
+		order[j] = i;
+	}
+}
+
+void esdm_es_stats_state(unsigned int i, char *buf, size_t buflen)
+{
+	struct esdm_es_stats *stats = &esdm_es_stats[i];
+
+	snprintf(buf, buflen,
+		 " Collection latency (average): %u us\n"
+		 " Delivered entropy (average): %u bits\n"
+		 " Collections without entropy: %u%%\n",
+		 atomic_read_u32(&stats->latency_us),
+		 atomic_read_u32(&stats->bits),
+		 atomic_read_u32(&stats->failures) * 100 /
+			 ESDM_ES_FAILURE_SCALE);
+}
+
+/****************************** ES async buffer *******************************/
+
+/* Fill the empty blocks of the ES async buffer - called by the ES monitor */
+static void esdm_es_async_fill(struct esdm_es_cb *es)
+{
+	struct esdm_es_async *async = es->async;
+	uint32_t i, requested_bits = esdm_get_seed_entropy_osr(true);
+
+	if (!async || !esdm_state.esdm_fully_seeded || !es->active())
+		return;
+
+	for (i = 0; i < async->blocks_num; i++) {
+		uint32_t ent_bits;
+
+		if (__sync_val_compare_and_swap(&async->state[i],
+						esdm_es_async_empty,
+						esdm_es_async_filling) !=
+		    esdm_es_async_empty)
+			continue;
+
+		es->get_ent(&async->blocks[i], requested_bits, true);
+
+		ent_bits = async->blocks[i].e_bits;
+		if (!ent_bits) {
+			/* The ES is depleted, try again later */
+			async->state[i] = esdm_es_async_empty;
+			break;
+		}
+
+		atomic_add(&async->entropy_bits, (int)ent_bits);
+		async->state[i] = esdm_es_async_filled;
+
+		esdm_logger(
+			LOGGER_DEBUG, LOGGER_C_ES,
+			"%s ES monitor: filled slot %u with %u bits of entropy\n",
+			es->name, i, ent_bits);
+	}
+}
+
+/* Obtain a filled block from the ES async buffer */
+static bool esdm_es_async_get(struct esdm_es_cb *es, struct entropy_es *eb_es,
+			      uint32_t requested_bits, bool fully_seeded)
+{
+	struct esdm_es_async *async = es->async;
+	uint32_t i, slot, start;
+
+	/* The blocks are only used for the requests they are filled for */
+	if (!async || !fully_seeded ||
+	    requested_bits != esdm_get_seed_entropy_osr(true))
+		return false;
+
+	start = (uint32_t)atomic_inc(&async->idx);
+	for (i = 0; i < async->blocks_num; i++) {
+		slot = (start + i) % async->blocks_num;
+
+		if (__sync_val_compare_and_swap(&async->state[slot],
+						esdm_es_async_filled,
+						esdm_es_async_reading) ==
+		    esdm_es_async_filled)
+			break;
+	}
+
+	if (i == async->blocks_num) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+			    "%s ES monitor: buffer exhausted\n", es->name);
+		esdm_es_mgr_monitor_wakeup();
+		return false;
+	}
+
+	memcpy(eb_es, &async->blocks[slot], sizeof(struct entropy_es));
+	atomic_add(&async->entropy_bits, -(int)eb_es->e_bits);
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+		    "%s ES monitor: used slot %u with %u bits of entropy\n",
+		    es->name, slot, eb_es->e_bits);
+
+	memset_secure(&async->blocks[slot], 0, sizeof(struct entropy_es));
+	async->state[slot] = esdm_es_async_empty;
+
+	/* Let the ES monitor refill the block */
+	esdm_es_mgr_monitor_wakeup();
+
+	return true;
+}
+
+/* Drop the filled blocks of the ES async buffer */
+static void esdm_es_async_reset(struct esdm_es_cb *es)
+{
+	struct esdm_es_async *async = es->async;
+	uint32_t i;
+
+	if (!async)
+		return;
+
+	for (i = 0; i < async->blocks_num; i++) {
+		if (__sync_val_compare_and_swap(&async->state[i],
+						esdm_es_async_filled,
+						esdm_es_async_reading) !=
+		    esdm_es_async_filled)
+			continue;
+
+		atomic_add(&async->entropy_bits, -(int)async->blocks[i].e_bits);
+		memset_secure(&async->blocks[i], 0, sizeof(struct entropy_es));
+		async->state[i] = esdm_es_async_empty;
+	}
+}
+
+/* Entropy delivered by each ES for seeding */
+enum esdm_es_metric {
+	esdm_es_m_bits,
+	esdm_es_m_collections,
+	esdm_es_m_num,
+};
+
+ESDM_METRICS_DEFINE(esdm_es_metrics_ctr, esdm_ext_es_last * esdm_es_m_num);
+
+/* Fetch entropy from the ES, preferably from its async buffer */
+static void esdm_es_get_ent(unsigned int i, struct entropy_es *eb_es,
+			    uint32_t requested_bits, bool fully_seeded)
+{
+	if (!esdm_es_async_get(esdm_es[i], eb_es, requested_bits,
+			       fully_seeded))
+		esdm_es_get_ent_stats(i, eb_es, requested_bits, fully_seeded);
+
+	esdm_metrics_add(&esdm_es_metrics_ctr,
+			 i * esdm_es_m_num + esdm_es_m_bits, eb_es->e_bits);
+	esdm_metrics_add(&esdm_es_metrics_ctr,
+			 i * esdm_es_m_num + esdm_es_m_collections, 1);
+}
+
+#ifdef ESDM_METRICS
+void esdm_es_metrics(struct esdm_metrics_buf *mb)
+{
+	unsigned int i;
+
+	esdm_metrics_printf(mb, "# TYPE esdm_es_entropy_bits counter\n"
+				"# HELP esdm_es_entropy_bits Entropy delivered "
+				"by the entropy source\n");
+	for_each_esdm_es (i) {
+		esdm_metrics_printf(
+			mb, "esdm_es_entropy_bits_total{source=\"%s\"} %llu\n",
+			esdm_es[i]->name,
+			(unsigned long long)esdm_metrics_read(
+				&esdm_es_metrics_ctr,
+				i * esdm_es_m_num + esdm_es_m_bits));
+	}
+
+	esdm_metrics_printf(mb, "# TYPE esdm_es_collections counter\n"
+				"# HELP esdm_es_collections Entropy "
+				"collections from the entropy source\n");
+	for_each_esdm_es (i) {
+		esdm_metrics_printf(
+			mb, "esdm_es_collections_total{source=\"%s\"} %llu\n",
+			esdm_es[i]->name,
+			(unsigned long long)esdm_metrics_read(
+				&esdm_es_metrics_ctr,
+				i * esdm_es_m_num + esdm_es_m_collections));
+	}
+}
+#endif
+
+/* Currently available entropy of the ES including its async buffer */
+static uint32_t esdm_es_curr_entropy(struct esdm_es_cb *es,
+				     uint32_t requested_bits)
+{
+	uint32_t ent = es->curr_entropy(requested_bits);
+
+	if (es->async)
+		ent += atomic_read_u32(&es->async->entropy_bits);
+	return ent;
+}
+
 /******************************** ES monitor **********************************/
 
+/* An event arrived which the cooperative ES monitor did not process yet */
+static atomic_t esdm_monitor_event = ATOMIC_INIT(1);
+
 /* Restart the ES monitor if it is sleeping */
 void esdm_es_mgr_monitor_wakeup(void)
 {
+	atomic_set(&esdm_monitor_event, 1);
 	thread_wake_all(&esdm_monitor_wait);
 }
 
+/*
+ * Interval of checking the entropy sources while not all DRNGs are seeded. The
+ * interval doubles with every check not interrupted by an event up to the
+ * maximum. An event restores the minimum interval.
+ */
+#define ESDM_ES_MONITOR_MIN_INTERVAL_NS (UINT64_C(1) << 29)
+#define ESDM_ES_MONITOR_MAX_INTERVAL_NS (UINT64_C(1) << 33)
+
+/*
+ * One pass of the ES monitor polling all entropy sources.
+ *
+ * @param [out] priv_init_complete false while an entropy source requires the
+ *				   privileged initialization to proceed
+ *
+ * @return 0 if no entropy source needs to be polled again, != 0 otherwise
+ */
+static int esdm_es_mgr_monitor_pass(bool *priv_init_complete)
+{
+	unsigned int j;
+	int ret = 0;
+
+	*priv_init_complete = true;
+
+	for_each_esdm_es (j) {
+		if (esdm_es[j]->monitor_es) {
+			int rc = esdm_es[j]->monitor_es();
+
+			/*
+			 * If the caller returns -EAGAIN, it blocks the
+			 * initialization process as it requires root
+			 * privileges until completed.
+			 */
+			if (rc == -EAGAIN)
+				*priv_init_complete = false;
+
+			ret |= rc;
+		}
+
+		esdm_es_async_fill(esdm_es[j]);
+	}
+
+	/* The entropy level of the polled ES may have changed */
+	esdm_shm_status_refresh();
+
+	return ret;
+}
+
 /* ES monitor worker loop */
 int esdm_es_mgr_monitor_initialize(void (*priv_init_completion)(void))
 {
-	struct timespec ts = { .tv_sec = 0, .tv_nsec = 1U << 29 };
+	uint64_t interval = ESDM_ES_MONITOR_MIN_INTERVAL_NS;
 	unsigned int i, avail = 0;
 	bool priv_init_completed = false;
 
 	for_each_esdm_es (i) {
 		if (esdm_es[i]->active())
-			avail += !!esdm_es[i]->monitor_es;
+			avail += esdm_es[i]->monitor_es || esdm_es[i]->async;
 	}
 
 	if (!avail) {
@@ -153,25 +512,8 @@ int esdm_es_mgr_monitor_initialize(void (*priv_init_completion)(void))
 		    "Full entropy monitor started\n");
 
 	while (!atomic_read(&esdm_es_mgr_terminate)) {
-		unsigned int j;
-		int ret = 0;
-		bool priv_init_complete = true;
-
-		for_each_esdm_es (j) {
-			if (esdm_es[j]->monitor_es) {
-				int rc = esdm_es[j]->monitor_es();
-
-				/*
-				 * If the caller returns -EAGAIN, it blocks
-				 * the initialization process as it requires
-				 * root privileges until completed.
-				 */
-				if (rc == -EAGAIN)
-					priv_init_complete = false;
-
-				ret |= rc;
-			}
-		}
+		bool priv_init_complete;
+		int ret = esdm_es_mgr_monitor_pass(&priv_init_complete);
 
 		if (priv_init_complete && priv_init_completion) {
 			priv_init_completion();
@@ -179,9 +521,29 @@ int esdm_es_mgr_monitor_initialize(void (*priv_init_completion)(void))
 		}
 
 		if (!ret && esdm_pool_all_nodes_seeded_get()) {
+			/* Nothing to poll for, sleep until an event arrives */
 			thread_wait_no_event(&esdm_monitor_wait);
+			interval = ESDM_ES_MONITOR_MIN_INTERVAL_NS;
 		} else {
-			nanosleep(&ts, NULL);
+			struct timespec ts = {
+				.tv_sec = (time_t)(interval / 1000000000),
+				.tv_nsec = (long)(interval % 1000000000)
+			};
+
+			ret = 0;
+			thread_timedwait_no_event(&esdm_monitor_wait, &ts);
+
+			/*
+			 * Back off while no event arrives, but keep checking
+			 * quickly while the privileged initialization is
+			 * pending.
+			 */
+			if (ret == -ETIMEDOUT && priv_init_complete)
+				interval = min_uint64(
+					interval << 1,
+					ESDM_ES_MONITOR_MAX_INTERVAL_NS);
+			else
+				interval = ESDM_ES_MONITOR_MIN_INTERVAL_NS;
 		}
 	}
 
@@ -192,6 +554,37 @@ int esdm_es_mgr_monitor_initialize(void (*priv_init_completion)(void))
 	return 0;
 }
 
+/*
+ * ES monitor operated by the caller instead of a separate thread: the caller
+ * invokes it periodically, e.g. from its event loop. Unless all DRNGs are
+ * seeded, each pass also tries to seed them with the synchronous entropy
+ * sources. Once all DRNGs are seeded and no entropy source needs to be polled,
+ * a pass is only performed after an event arrived.
+ */
+int esdm_es_mgr_monitor_poll(void)
+{
+	static atomic_t esdm_monitor_poll_again = ATOMIC_INIT(1);
+	bool priv_init_complete;
+	int ret;
+
+	if (atomic_read(&esdm_es_mgr_terminate))
+		return 0;
+
+	if (!atomic_xchg(&esdm_monitor_event, 0) &&
+	    !atomic_read(&esdm_monitor_poll_again) &&
+	    esdm_pool_all_nodes_seeded_get())
+		return 0;
+
+	ret = esdm_es_mgr_monitor_pass(&priv_init_complete);
+	atomic_set(&esdm_monitor_poll_again, !!ret);
+
+	/* No blocking caller may be present to collect the synchronous ES */
+	if (priv_init_complete)
+		esdm_force_fully_seeded();
+
+	return priv_init_complete ? 0 : -EAGAIN;
+}
+
 /******************************** Read Helper *********************************/
 
 /**
@@ -231,6 +624,7 @@ void esdm_kernel_read(struct entropy_es *eb_es, int fd, unsigned int ioctl_cmd,
 	}
 
 	ret = ioctl(fd, ioctl_cmd, buf);
+	esdm_kernel_entropylevel_invalidate();
 	if (ret < 0) {
 		esdm_logger(LOGGER_WARN, LOGGER_C_ES,
 			    "failed to obtain entropy from ES %s, error %d\n",
@@ -283,6 +677,263 @@ err:
 	eb_es->e_bits = 0;
 }
 
+#if defined(ESDM_ES_IRQ) || defined(ESDM_ES_SCHED)
+
+/* The kernel ES device does not support the batch IOCTL */
+static atomic_t esdm_kernel_batch_unsupported = ATOMIC_INIT(0);
+
+/* Ring of entropy blocks shared with the kernel ES device */
+static const struct esdm_es_ring *esdm_kernel_ring = NULL;
+static bool esdm_kernel_ring_unavailable = false;
+static uint64_t esdm_kernel_ring_used[ESDM_ES_BATCH_MAX];
+static DEFINE_MUTEX_W_UNLOCKED(esdm_kernel_ring_lock);
+
+/* Map the ring of the kernel ES device - caller must hold the ring lock */
+static const struct esdm_es_ring *esdm_kernel_ring_get(int fd)
+{
+	const struct esdm_es_ring *ring;
+	void *map;
+
+	if (esdm_kernel_ring || esdm_kernel_ring_unavailable)
+		return esdm_kernel_ring;
+
+	map = mmap(NULL, sizeof(struct esdm_es_ring), PROT_READ, MAP_SHARED,
+		   fd, 0);
+	if (map == MAP_FAILED) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ES,
+			    "Kernel ES ring not available: %d\n", errno);
+		esdm_kernel_ring_unavailable = true;
+		return NULL;
+	}
+
+	ring = map;
+	if (ring->version != ESDM_ES_RING_VERSION ||
+	    ring->slots != ESDM_ES_RING_SLOTS ||
+	    ring->e_size > ESDM_ES_RING_E_SIZE) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_ES,
+			    "Kernel ES ring has unknown layout\n");
+		munmap(map, sizeof(struct esdm_es_ring));
+		esdm_kernel_ring_unavailable = true;
+		return NULL;
+	}
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ES, "Kernel ES ring mapped\n");
+	esdm_kernel_ring = ring;
+	return ring;
+}
+
+/**
+ * Take the newest block of a kernel ES from the ring that is newer than the
+ * last block used.
+ *
+ * @param [in] fd file descriptor to the kernel ES device
+ * @param [in] id ID of the ES in the ring
+ * @param [out] eb_es entropy buffer to be filled
+ * @param [in] requested_bits Amount of requested bits
+ *
+ * @return true if a block was taken, false otherwise
+ */
+static bool esdm_kernel_ring_read(int fd, uint32_t id,
+				  struct entropy_es *eb_es,
+				  uint32_t requested_bits)
+{
+	const struct esdm_es_ring *ring;
+	const struct esdm_es_ring_slot *slot = NULL;
+	struct esdm_es_ring_slot copy;
+	uint64_t seq = 0;
+	uint32_t i, len;
+	bool ret = false;
+
+	mutex_w_lock(&esdm_kernel_ring_lock);
+
+	ring = esdm_kernel_ring_get(fd);
+	if (!ring)
+		goto out;
+
+	for (i = 0; i < ESDM_ES_RING_SLOTS; i++) {
+		uint64_t s = __atomic_load_n(&ring->slot[id][i].seq,
+					     __ATOMIC_ACQUIRE);
+
+		if ((s & 1) || (s >> 1) <= esdm_kernel_ring_used[id] ||
+		    s <= seq)
+			continue;
+
+		seq = s;
+		slot = &ring->slot[id][i];
+	}
+
+	if (!slot)
+		goto out;
+
+	memcpy(&copy, slot, sizeof(copy));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	/* The kernel overwrote the block while it was copied */
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+		goto out;
+
+	/* The block was filled with fewer requested bits */
+	if (copy.e_bits < requested_bits)
+		goto out;
+
+	esdm_kernel_ring_used[id] = seq >> 1;
+
+	len = min_uint32(ring->e_size, sizeof(eb_es->e));
+	memcpy(eb_es->e, copy.e, len);
+	memset(eb_es->e + len, 0, sizeof(eb_es->e) - len);
+
+	/*
+	 * According to SP800-90B table 1, the truncated hash contains the
+	 * amount of entropy of the original hash capped by the truncated size.
+	 */
+	eb_es->e_bits = copy.e_bits;
+	if (len < ring->e_size)
+		eb_es->e_bits = min_uint32(eb_es->e_bits, len << 3);
+	ret = true;
+
+out:
+	mutex_w_unlock(&esdm_kernel_ring_lock);
+	memset_secure(&copy, 0, sizeof(copy));
+	return ret;
+}
+
+/* Drop all blocks currently in the ring of the kernel ES device */
+static void esdm_kernel_ring_reset(void)
+{
+	uint32_t i;
+
+	mutex_w_lock(&esdm_kernel_ring_lock);
+	if (esdm_kernel_ring) {
+		for (i = 0; i < ESDM_ES_BATCH_MAX; i++) {
+			esdm_kernel_ring_used[i] = __atomic_load_n(
+				&esdm_kernel_ring->produced, __ATOMIC_ACQUIRE);
+		}
+	}
+	mutex_w_unlock(&esdm_kernel_ring_lock);
+}
+
+/* Unmap the ring of the kernel ES device */
+static void esdm_kernel_ring_fini(void)
+{
+	mutex_w_lock(&esdm_kernel_ring_lock);
+	if (esdm_kernel_ring) {
+		munmap((void *)esdm_kernel_ring, sizeof(struct esdm_es_ring));
+		esdm_kernel_ring = NULL;
+	}
+	esdm_kernel_ring_unavailable = false;
+	memset(esdm_kernel_ring_used, 0, sizeof(esdm_kernel_ring_used));
+	mutex_w_unlock(&esdm_kernel_ring_lock);
+}
+
+/**
+ * Read all kernel entropy sources directly into the seed buffer: take the
+ * blocks the kernel already placed in the shared ring and read the remaining
+ * ES with one IOCTL.
+ *
+ * @param [out] eb seed buffer to be filled
+ * @param [in] requested_bits Amount of requested bits
+ * @param [in/out] done ES whose block is already filled; the ES read by the
+ *			batch are marked
+ */
+static void esdm_kernel_read_batch(struct entropy_buf *eb,
+				   uint32_t requested_bits,
+				   bool done[esdm_ext_es_last])
+{
+	struct esdm_es_batch batch = { 0 };
+	bool batched[esdm_ext_es_last] = { false };
+	uint32_t i;
+	int fd = -1, ret;
+
+	if (atomic_read(&esdm_kernel_batch_unsupported))
+		return;
+
+	batch.buf = (uint64_t)(uintptr_t)eb->entropy_es;
+	batch.e_size = sizeof(eb->entropy_es[0].e);
+
+	for_each_esdm_es (i) {
+		struct esdm_es_cb *es = esdm_es[i];
+		int es_fd;
+
+		if (done[i] || !es->kernel_batch)
+			continue;
+
+		es_fd = es->kernel_batch(requested_bits);
+		if (es_fd < 0)
+			continue;
+
+		if (esdm_kernel_ring_read(es_fd, es->kernel_batch_id,
+					  &eb->entropy_es[i], requested_bits)) {
+			done[i] = true;
+			esdm_logger(
+				LOGGER_DEBUG, LOGGER_C_ES,
+				"obtained %u bits of entropy from ES %s ring\n",
+				eb->entropy_es[i].e_bits, es->name);
+			continue;
+		}
+
+		fd = es_fd;
+		batched[i] = true;
+		batch.es_mask |= UINT32_C(1) << es->kernel_batch_id;
+		batch.offset[es->kernel_batch_id] =
+			(uint32_t)(i * sizeof(struct entropy_es));
+	}
+
+	if (fd < 0)
+		return;
+
+	ret = ioctl(fd, ESDM_ES_ENT_BUF_BATCH, &batch);
+	esdm_kernel_entropylevel_invalidate();
+	if (ret < 0) {
+		if (errno == ENOTTY) {
+			esdm_logger(
+				LOGGER_VERBOSE, LOGGER_C_ES,
+				"Kernel ES do not support batch reads, reading them one by one\n");
+			atomic_set(&esdm_kernel_batch_unsupported, 1);
+			return;
+		}
+
+		esdm_logger(LOGGER_WARN, LOGGER_C_ES,
+			    "failed to obtain entropy from kernel ES: %d\n",
+			    errno);
+
+		for_each_esdm_es (i) {
+			if (batched[i])
+				eb->entropy_es[i].e_bits = 0;
+		}
+	}
+
+	for_each_esdm_es (i) {
+		if (!batched[i])
+			continue;
+
+		done[i] = true;
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+			    "obtained %u bits of entropy from ES %s\n",
+			    eb->entropy_es[i].e_bits, esdm_es[i]->name);
+	}
+}
+
+#else /* ESDM_ES_IRQ || ESDM_ES_SCHED */
+
+static void esdm_kernel_read_batch(struct entropy_buf *eb,
+				   uint32_t requested_bits,
+				   bool done[esdm_ext_es_last])
+{
+	(void)eb;
+	(void)requested_bits;
+	(void)done;
+}
+
+static void esdm_kernel_ring_reset(void)
+{
+}
+
+static void esdm_kernel_ring_fini(void)
+{
+}
+
+#endif /* ESDM_ES_IRQ || ESDM_ES_SCHED */
+
 /**
  * Common service function to set the requested amount of bits with the kernel
  * entropy sources.
@@ -305,6 +956,7 @@ void esdm_kernel_set_requested_bits(uint32_t *configured_bits,
 		ret = ioctl(fd, ioctl_cmd, &data);
 		if (ret >= 0) {
 			*configured_bits = requested_bits;
+			esdm_kernel_entropylevel_invalidate();
 			esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
 				    "Set requested %u bits with kernel\n",
 				    requested_bits);
@@ -317,6 +969,75 @@ void esdm_kernel_set_requested_bits(uint32_t *configured_bits,
 	}
 }
 
+/*
+ * Lifetime of a cached kernel ES entropy level. The entropy level of the
+ * kernel ES grows with the events the kernel collects. Reading the entropy
+ * or reconfiguring an ES invalidates the cached value immediately.
+ */
+#define ESDM_KERNEL_ENT_CACHE_NS (UINT64_C(1) << 26)
+
+/* Generation of the kernel ES entropy levels */
+static atomic_t esdm_kernel_ent_gen = ATOMIC_INIT(0);
+
+void esdm_kernel_entropylevel_invalidate(void)
+{
+	atomic_inc(&esdm_kernel_ent_gen);
+}
+
+/* The coarse clock is read from the vDSO without a system call */
+static uint64_t esdm_kernel_ent_now_ns(void)
+{
+	struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_COARSE
+	if (clock_gettime(CLOCK_MONOTONIC_COARSE, &ts))
+#endif
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Common service function to obtain the entropy level of the kernel entropy
+ * sources.
+ *
+ * @param [in] cache Cached entropy level of the entropy source
+ * @param [in] fd file descriptor to the entropy source
+ * @param [in] ioctl_cmd IOCTL command to read the entropy level
+ * @param [in] refresh Read the entropy level from the kernel even if the
+ *		       cached value is still valid
+ *
+ * @return entropy level in bits
+ */
+uint32_t esdm_kernel_entropylevel(struct esdm_kernel_ent_cache *cache, int fd,
+				  unsigned int ioctl_cmd, bool refresh)
+{
+	uint64_t now = esdm_kernel_ent_now_ns();
+	uint32_t entropy;
+	int gen = atomic_read(&esdm_kernel_ent_gen);
+
+	if (fd < 0)
+		return 0;
+
+	if (!refresh && atomic_read(&cache->gen) == gen &&
+	    now < (uint64_t)atomic_read_64(&cache->expiry_ns))
+		return (uint32_t)atomic_read(&cache->ent);
+
+	if (ioctl(fd, ioctl_cmd, &entropy) < 0)
+		return 0;
+
+	/*
+	 * The generation is read before the kernel is asked: an invalidation
+	 * during the read causes the next caller to read the level again.
+	 */
+	atomic_set(&cache->ent, (int)entropy);
+	atomic_set(&cache->gen, gen);
+	atomic_set_64(&cache->expiry_ns,
+		      (long long)(now + ESDM_KERNEL_ENT_CACHE_NS));
+
+	return entropy;
+}
+
 /********************************** Helper ***********************************/
 
 void esdm_debug_report_seedlevel(const char *name)
@@ -368,11 +1089,14 @@ void esdm_reset_state(void)
 	for_each_esdm_es (i) {
 		if (esdm_es[i]->reset)
 			esdm_es[i]->reset();
+		esdm_es_async_reset(esdm_es[i]);
 	}
+	esdm_kernel_ring_reset();
 	esdm_state.esdm_operational = false;
 	esdm_state.esdm_fully_seeded = false;
 	esdm_state.esdm_min_seeded = false;
 	esdm_state.all_online_nodes_seeded = false;
+	esdm_shm_status_set_seed_values();
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES, "reset ESDM\n");
 
 	/* Start the entropy monitor */
@@ -383,8 +1107,11 @@ void esdm_reset_state(void)
 void esdm_pool_all_nodes_seeded(bool set)
 {
 	esdm_state.all_online_nodes_seeded = set;
-	if (set)
+	esdm_shm_status_set_seed_values();
+	if (set) {
+		esdm_startup_event(esdm_startup_all_nodes_seeded);
 		thread_wake_all(&esdm_init_wait);
+	}
 }
 
 bool esdm_pool_all_nodes_seeded_get(void)
@@ -415,6 +1142,7 @@ int esdm_state_operational(void)
 
 static void esdm_init_wakeup(void)
 {
+	esdm_shm_status_set_seed_values();
 	thread_wake_all(&esdm_init_wait);
 }
 
@@ -442,7 +1170,8 @@ bool esdm_fully_seeded(bool fully_seeded, uint32_t collected_entropy,
 
 		for_each_esdm_es (i) {
 			result += (eb ? eb->entropy_es[i].e_bits :
-					esdm_es[i]->curr_entropy(ent_thresh)) >=
+					esdm_es_curr_entropy(esdm_es[i],
+							     ent_thresh)) >=
 				  ESDM_AIS2031_NPTRNG_MIN_ENTROPY;
 		}
 
@@ -452,6 +1181,17 @@ bool esdm_fully_seeded(bool fully_seeded, uint32_t collected_entropy,
 	return (collected_entropy >= esdm_get_seed_entropy_osr(fully_seeded));
 }
 
+/* Entropy collected in the seed buffer */
+static uint32_t esdm_collected_entropy(const struct entropy_buf *eb)
+{
+	uint32_t i, collected_entropy = 0;
+
+	for_each_esdm_es (i)
+		collected_entropy += eb->entropy_es[i].e_bits;
+
+	return collected_entropy;
+}
+
 uint32_t esdm_entropy_rate_eb(struct entropy_buf *eb)
 {
 	uint32_t i, collected_entropy = 0;
@@ -516,10 +1256,27 @@ uint32_t esdm_avail_entropy(void)
 
 	BUILD_BUG_ON(ARRAY_SIZE(esdm_es) != esdm_ext_es_last);
 	for_each_esdm_es (i)
-		ent += esdm_es[i]->curr_entropy(ent_thresh);
+		ent += esdm_es_curr_entropy(esdm_es[i], ent_thresh);
 	return ent;
 }
 
+/* Fill the binary status of the ES i - the ES state callback is not used */
+void esdm_es_status_bin(unsigned int i, struct esdm_status_bin_es *es_bin)
+{
+	struct esdm_es_stats *stats = &esdm_es_stats[i];
+	struct esdm_es_cb *es = esdm_es[i];
+
+	snprintf(es_bin->name, sizeof(es_bin->name), "%s", es->name);
+	es_bin->active = es->active();
+	es_bin->curr_entropy =
+		esdm_es_curr_entropy(es, esdm_avail_entropy_thresh());
+	es_bin->max_entropy = es->max_entropy();
+	es_bin->latency_us = atomic_read_u32(&stats->latency_us);
+	es_bin->avg_bits = atomic_read_u32(&stats->bits);
+	es_bin->failures_percent =
+		atomic_read_u32(&stats->failures) * 100 / ESDM_ES_FAILURE_SCALE;
+}
+
 DSO_PUBLIC
 uint32_t esdm_avail_entropy_aux(void)
 {
@@ -548,6 +1305,7 @@ void esdm_set_write_wakeup_bits(uint32_t val)
 
 	esdm_write_wakeup_bits =
 		min_uint32(val, esdm_reduce_by_osr(esdm_get_digestsize()));
+	esdm_shm_status_set_proc_values();
 }
 
 static uint32_t esdm_init_entropy_level(bool fully_seeded)
@@ -588,7 +1346,8 @@ void esdm_init_ops(struct entropy_buf *eb)
 		uint32_t ent_thresh = esdm_avail_entropy_thresh();
 
 		for_each_esdm_es (i)
-			seed_bits += esdm_es[i]->curr_entropy(ent_thresh);
+			seed_bits +=
+				esdm_es_curr_entropy(esdm_es[i], ent_thresh);
 	}
 
 	/* DRNG is seeded with full security strength */
@@ -600,6 +1359,8 @@ void esdm_init_ops(struct entropy_buf *eb)
 		state->esdm_fully_seeded = true;
 		esdm_set_operational();
 		state->esdm_min_seeded = true;
+		esdm_startup_event(esdm_startup_min_seeded);
+		esdm_startup_event(esdm_startup_fully_seeded);
 		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ES,
 			    "ESDM fully seeded with %u bits of entropy\n",
 			    seed_bits);
@@ -608,6 +1369,7 @@ void esdm_init_ops(struct entropy_buf *eb)
 		/* DRNG is seeded with at least 128 bits of entropy */
 		if (seed_bits >= ESDM_MIN_SEED_ENTROPY_BITS) {
 			state->esdm_min_seeded = true;
+			esdm_startup_event(esdm_startup_min_seeded);
 			esdm_logger(
 				LOGGER_VERBOSE, LOGGER_C_ES,
 				"ESDM minimally seeded with %u bits of entropy\n",
@@ -650,22 +1412,36 @@ out:
 	return ret;
 }
 
-static int esdm_es_mgr_init_es(struct esdm_es_cb *esdm_es_one)
+static int esdm_es_mgr_init_es(unsigned int idx)
 {
+	struct esdm_es_cb *esdm_es_one = esdm_es[idx];
+	uint64_t begin;
 	int ret = 0;
 
 	if (esdm_es_one->init) {
 		esdm_logger(LOGGER_DEBUG, LOGGER_C_ES, "Initialize ES %s\n",
 			    esdm_es_one->name);
+		begin = esdm_startup_now();
 		CKINT_LOG(esdm_es_one->init(),
 			  "Initialization of ES %s failed: %d",
 			  esdm_es_one->name, ret);
+		esdm_startup_es_init(idx, begin);
 	}
 
 out:
 	return ret;
 }
 
+/* Size of the buffer of the ES monitor holding the blocks of the ES */
+static int64_t esdm_es_async_bytes(const struct esdm_es_cb *es)
+{
+	if (!es->async)
+		return 0;
+
+	return (int64_t)es->async->blocks_num *
+	       (int64_t)(sizeof(struct entropy_es) + sizeof(*es->async->state));
+}
+
 int esdm_es_mgr_initialize(void)
 {
 	struct seed {
@@ -684,16 +1460,19 @@ int esdm_es_mgr_initialize(void)
 	esdm_set_entropy_thresh(esdm_init_entropy_level(false));
 
 	/* Initialize the auxiliary pool first */
-	CKINT(esdm_es_mgr_init_es(esdm_es[esdm_ext_es_aux]));
+	CKINT(esdm_es_mgr_init_es(esdm_ext_es_aux));
 
 	/* Initialize the entropy sources */
 	for_each_esdm_es (i) {
 		if (i == esdm_ext_es_aux)
 			continue;
 
-		CKINT(esdm_es_mgr_init_es(esdm_es[i]));
+		CKINT(esdm_es_mgr_init_es(i));
 	}
 
+	for_each_esdm_es (i)
+		esdm_mem_account(esdm_mem_es, esdm_es_async_bytes(esdm_es[i]));
+
 	seed.time = time(NULL);
 
 	for (i = 0; i < ARRAY_SIZE(seed.data); i++) {
@@ -708,7 +1487,9 @@ int esdm_es_mgr_initialize(void)
 
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ES,
 		    "Force fully seeding of all DRBGs\n");
+	esdm_startup_begin(esdm_startup_initial_seed);
 	esdm_force_fully_seeded_all_drbgs();
+	esdm_startup_end(esdm_startup_initial_seed);
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ES, "All DRBGs fully seeded\n");
 
 out:
@@ -723,9 +1504,12 @@ void esdm_es_mgr_finalize(void)
 	esdm_es_mgr_monitor_wakeup();
 
 	for_each_esdm_es (i) {
+		esdm_es_async_reset(esdm_es[i]);
+		esdm_mem_account(esdm_mem_es, -esdm_es_async_bytes(esdm_es[i]));
 		if (esdm_es[i]->fini)
 			esdm_es[i]->fini();
 	}
+	esdm_kernel_ring_fini();
 }
 
 bool esdm_es_reseed_wanted(void)
@@ -763,6 +1547,170 @@ void esdm_es_add_entropy(void)
 	esdm_drng_seed_work();
 }
 
+/*
+ * Parallel collection of the entropy sources: each entropy source is collected
+ * by its own thread into the collection. The collection is released by the
+ * last of the caller and the collector threads as a collector missing the
+ * timeout still writes into it.
+ */
+struct esdm_es_collect;
+
+struct esdm_es_collector {
+	struct esdm_es_collect *coll;
+	unsigned int es;
+};
+
+struct esdm_es_collect {
+	struct entropy_es entropy_es[esdm_ext_es_last];
+	struct esdm_es_collector collector[esdm_ext_es_last];
+	bool done[esdm_ext_es_last];
+	uint32_t requested_bits;
+	bool fully_seeded;
+	unsigned int pending;
+	unsigned int refcnt;
+	pthread_mutex_t lock;
+	pthread_cond_t cv;
+};
+
+/* An ES is not collected again while a collector missing the timeout runs */
+static atomic_t esdm_es_collect_busy[esdm_ext_es_last] = {
+	[0 ... esdm_ext_es_last - 1] = ATOMIC_INIT(0)
+};
+
+static void esdm_es_collect_put(struct esdm_es_collect *coll)
+{
+	bool release;
+
+	pthread_mutex_lock(&coll->lock);
+	release = !--coll->refcnt;
+	pthread_mutex_unlock(&coll->lock);
+
+	if (!release)
+		return;
+
+	pthread_mutex_destroy(&coll->lock);
+	pthread_cond_destroy(&coll->cv);
+	memset_secure(coll, 0, sizeof(*coll));
+	free(coll);
+	esdm_mem_account(esdm_mem_es, -(int64_t)sizeof(*coll));
+}
+
+static void esdm_es_collect_one(struct esdm_es_collect *coll, unsigned int i)
+{
+	esdm_es_get_ent(i, &coll->entropy_es[i], coll->requested_bits,
+			coll->fully_seeded);
+	atomic_set(&esdm_es_collect_busy[i], 0);
+}
+
+static int esdm_es_collector_thread(void *arg)
+{
+	struct esdm_es_collector *collector = arg;
+	struct esdm_es_collect *coll = collector->coll;
+
+	thread_set_name(es_collector, collector->es);
+
+	esdm_es_collect_one(coll, collector->es);
+
+	pthread_mutex_lock(&coll->lock);
+	coll->done[collector->es] = true;
+	coll->pending--;
+	pthread_cond_signal(&coll->cv);
+	pthread_mutex_unlock(&coll->lock);
+
+	esdm_es_collect_put(coll);
+
+	return 0;
+}
+
+static int esdm_fill_seed_buffer_parallel(struct entropy_buf *eb,
+					  uint32_t requested_bits,
+					  bool fully_seeded, uint32_t timeout_ms)
+{
+	struct esdm_es_collect *coll;
+	struct timespec deadline;
+	unsigned int i;
+
+	coll = calloc(1, sizeof(*coll));
+	if (!coll)
+		return -ENOMEM;
+	esdm_mem_account(esdm_mem_es, sizeof(*coll));
+
+	pthread_mutex_init(&coll->lock, NULL);
+	pthread_cond_init(&coll->cv, NULL);
+	coll->requested_bits = requested_bits;
+	coll->fully_seeded = fully_seeded;
+	coll->refcnt = 1;
+
+	for_each_esdm_es (i) {
+		coll->collector[i].coll = coll;
+		coll->collector[i].es = i;
+
+		if (atomic_cmpxchg(&esdm_es_collect_busy[i], 0, 1)) {
+			esdm_logger(
+				LOGGER_DEBUG, LOGGER_C_ES,
+				"ES %s still collecting for previous request\n",
+				esdm_es[i]->name);
+			continue;
+		}
+
+		pthread_mutex_lock(&coll->lock);
+		coll->pending++;
+		coll->refcnt++;
+		pthread_mutex_unlock(&coll->lock);
+
+		if (!thread_trystart(esdm_es_collector_thread,
+				     &coll->collector[i], 0))
+			continue;
+
+		/* No thread available, collect the ES synchronously */
+		pthread_mutex_lock(&coll->lock);
+		coll->pending--;
+		coll->refcnt--;
+		pthread_mutex_unlock(&coll->lock);
+
+		esdm_es_collect_one(coll, i);
+
+		pthread_mutex_lock(&coll->lock);
+		coll->done[i] = true;
+		pthread_mutex_unlock(&coll->lock);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&coll->lock);
+	while (coll->pending) {
+		if (pthread_cond_clockwait(&coll->cv, &coll->lock,
+					   CLOCK_MONOTONIC, &deadline))
+			break;
+	}
+
+	for_each_esdm_es (i) {
+		if (coll->done[i]) {
+			memcpy(&eb->entropy_es[i], &coll->entropy_es[i],
+			       sizeof(struct entropy_es));
+		} else {
+			/* Do not leave data of a previous seeding behind */
+			memset_secure(eb->entropy_es[i].e, 0,
+				      sizeof(eb->entropy_es[i].e));
+			eb->entropy_es[i].e_bits = 0;
+			esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+				    "ES %s missed the collection timeout\n",
+				    esdm_es[i]->name);
+		}
+	}
+	pthread_mutex_unlock(&coll->lock);
+
+	esdm_es_collect_put(coll);
+
+	return 0;
+}
+
 /* Fill the seed buffer with data from the noise sources */
 void esdm_fill_seed_buffer(struct entropy_buf *eb, uint32_t requested_bits,
 			   bool force)
@@ -771,6 +1719,9 @@ void esdm_fill_seed_buffer(struct entropy_buf *eb, uint32_t requested_bits,
 	uint32_t i, req_ent = esdm_sp80090c_compliant() ?
 				      esdm_security_strength() :
 				      ESDM_MIN_SEED_ENTROPY_BITS;
+	uint32_t timeout_ms;
+	unsigned int j, order[esdm_ext_es_last];
+	bool done[esdm_ext_es_last], adaptive;
 
 	/* Guarantee that requested bits is a multiple of bytes */
 	BUILD_BUG_ON(ESDM_DRNG_SECURITY_STRENGTH_BITS % 8);
@@ -791,12 +1742,110 @@ void esdm_fill_seed_buffer(struct entropy_buf *eb, uint32_t requested_bits,
 		goto wakeup;
 	}
 
-	/* Concatenate the output of the entropy sources. */
+	/* Collect all entropy sources at once, if enabled. */
+	timeout_ms = esdm_config_es_collect_timeout();
+	if (timeout_ms &&
+	    !esdm_fill_seed_buffer_parallel(eb, requested_bits,
+					    state->esdm_fully_seeded,
+					    timeout_ms))
+		goto wakeup;
+
+	/* Use the blocks pre-collected by the ES monitor first. */
 	for_each_esdm_es (i) {
-		esdm_es[i]->get_ent(&eb->entropy_es[i], requested_bits,
-				    state->esdm_fully_seeded);
+		done[i] = esdm_es_async_get(esdm_es[i], &eb->entropy_es[i],
+					    requested_bits,
+					    state->esdm_fully_seeded);
+	}
+
+	/* Read the kernel entropy sources with one system call. */
+	esdm_kernel_read_batch(eb, requested_bits, done);
+
+	for_each_esdm_es (i) {
+		if (!done[i])
+			eb->entropy_es[i].e_bits = 0;
+	}
+
+	/*
+	 * Concatenate the output of the remaining entropy sources, the fast
+	 * and reliable ones first. For a regular reseed, slow entropy sources
+	 * are skipped once the collected entropy satisfies the seeding
+	 * requirement including the AIS 20/31 NTG.1 rules, and the ES monitor
+	 * is woken to pre-collect them for later reseeds.
+	 */
+	adaptive = !force && state->esdm_fully_seeded;
+	esdm_es_stats_order(order);
+	for (j = 0; j < esdm_ext_es_last; j++) {
+		i = order[j];
+		if (done[i])
+			continue;
+
+		if (adaptive && esdm_es_stats_slow(i) &&
+		    esdm_fully_seeded(true, esdm_collected_entropy(eb), eb)) {
+			esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+				    "skipping slow ES %s\n", esdm_es[i]->name);
+			if (esdm_es[i]->async)
+				esdm_es_mgr_monitor_wakeup();
+			continue;
+		}
+
+		esdm_es_get_ent_stats(i, &eb->entropy_es[i], requested_bits,
+				      state->esdm_fully_seeded);
 	}
 
 wakeup:
 	esdm_writer_wakeup();
 }
+
+/*
+ * Fill the seed buffer with one block pre-collected by the ES monitor from an
+ * entropy source which is credited with full entropy. Such a block alone
+ * satisfies the seeding requirement, the other entropy sources are not
+ * accessed. The function returns false if no such block is available.
+ *
+ * The caller must have cleared the seed buffer.
+ */
+bool esdm_fill_seed_buffer_full(struct entropy_buf *eb,
+				uint32_t requested_bits)
+{
+	unsigned int i;
+
+	/*
+	 * The blocks are collected for the reseed of a fully seeded DRNG, i.e.
+	 * without the SP800-90C oversampling. AIS 20/31 NTG.1 requires the
+	 * contribution of two entropy sources.
+	 */
+	if (!esdm_state.esdm_fully_seeded ||
+	    requested_bits != esdm_get_seed_entropy_osr(true) ||
+	    esdm_ntg1_2024_compliant())
+		return false;
+
+	for_each_esdm_es (i) {
+		struct esdm_es_cb *es = esdm_es[i];
+		struct entropy_es *eb_es = &eb->entropy_es[i];
+
+		/* Each bit of data of the entropy source is credited */
+		if (!es->async || !es->active() ||
+		    es->curr_entropy(requested_bits) < requested_bits)
+			continue;
+
+		if (!esdm_es_async_get(es, eb_es, requested_bits, true))
+			continue;
+
+		esdm_metrics_add(&esdm_es_metrics_ctr,
+				 i * esdm_es_m_num + esdm_es_m_bits,
+				 eb_es->e_bits);
+		esdm_metrics_add(&esdm_es_metrics_ctr,
+				 i * esdm_es_m_num + esdm_es_m_collections, 1);
+
+		if (eb_es->e_bits >= requested_bits) {
+			eb->now = time(NULL);
+			esdm_writer_wakeup();
+			return true;
+		}
+
+		/* The entropy rate changed since the block was collected */
+		memset_secure(eb_es, 0, sizeof(*eb_es));
+	}
+
+	return false;
+}
@@ -8,6 +8,8 @@
 
 #include "bool.h"
 #include "esdm_es_mgr_cb.h"
+#include "esdm_status_bin.h"
+#include "metrics.h"
 
 /*************************** General ESDM parameter ***************************/
 
@@ -42,12 +44,20 @@ uint32_t esdm_entropy_rate_eb(struct entropy_buf *eb);
 void esdm_unset_fully_seeded(struct esdm_drng *drng);
 void esdm_fill_seed_buffer(struct entropy_buf *eb, uint32_t requested_bits,
 			   bool force);
+bool esdm_fill_seed_buffer_full(struct entropy_buf *eb,
+				uint32_t requested_bits);
 void esdm_init_ops(struct entropy_buf *eb);
 
 int esdm_es_mgr_reinitialize(void);
 int esdm_es_mgr_initialize(void);
 int esdm_es_mgr_monitor_initialize(void (*priv_init_completion)(void));
 void esdm_es_mgr_monitor_wakeup(void);
+int esdm_es_mgr_monitor_poll(void);
+void esdm_es_stats_state(unsigned int i, char *buf, size_t buflen);
+void esdm_es_status_bin(unsigned int i, struct esdm_status_bin_es *es_bin);
+
+/* Append the ES counters in the OpenMetrics text format */
+void esdm_es_metrics(struct esdm_metrics_buf *mb);
 void esdm_es_mgr_finalize(void);
 
 #endif /* _ESDM_ES_MGR_H */
@@ -26,6 +26,8 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include "atomic.h"
+#include "atomic_64.h"
 #include "bool.h"
 #include "config.h"
 #include "esdm.h"
@@ -58,6 +60,12 @@ enum esdm_external_es {
 #endif
 #ifdef ESDM_ES_JENT_KERNEL
 	esdm_ext_es_jent_kernel, /* Linux jitterentropy in kernel */
+#endif
+#ifdef ESDM_ES_UPSTREAM
+	esdm_ext_es_upstream, /* ESDM server of the system */
+#endif
+#ifdef ESDM_ES_SYNTH
+	esdm_ext_es_synth, /* Synthetic ES of the test mode */
 #endif
 	esdm_ext_es_aux, /* MUST BE LAST ES! */
 	esdm_ext_es_last /* MUST be the last entry */
@@ -93,6 +101,45 @@ struct entropy_buf {
 	time_t now;
 };
 
+enum esdm_es_async_state {
+	esdm_es_async_empty,
+	esdm_es_async_filling,
+	esdm_es_async_filled,
+	esdm_es_async_reading,
+};
+
+/*
+ * struct esdm_es_async - buffer of blocks pre-collected from an entropy source
+ * @blocks: Entropy blocks
+ * @state: State of each block
+ * @blocks_num: Number of blocks
+ * @idx: Index of the last used block
+ * @entropy_bits: Entropy held in the filled blocks
+ *
+ * The ES monitor fills the blocks with the get_ent callback of the entropy
+ * source once the ESDM is fully seeded. The seed buffer is filled from the
+ * filled blocks and only falls back to get_ent if no block is filled. Use
+ * DEFINE_ESDM_ES_ASYNC to define the buffer for an entropy source.
+ */
+struct esdm_es_async {
+	struct entropy_es *blocks;
+	volatile enum esdm_es_async_state *state;
+	uint32_t blocks_num;
+	atomic_t idx;
+	atomic_t entropy_bits;
+};
+
+#define DEFINE_ESDM_ES_ASYNC(name, num)                                        \
+	static struct entropy_es name##_blocks[num];                           \
+	static volatile enum esdm_es_async_state name##_state[num];            \
+	static struct esdm_es_async name = {                                   \
+		.blocks = name##_blocks,                                       \
+		.state = name##_state,                                         \
+		.blocks_num = num,                                             \
+		.idx = ATOMIC_INIT(0),                                         \
+		.entropy_bits = ATOMIC_INIT(0),                                \
+	}
+
 /*
  * struct esdm_es_cb - callback defining an entropy source
  * @name: Name of the entropy source.
@@ -111,6 +158,12 @@ struct entropy_buf {
  * @active: Is ES active.
  * @switch_hash: callback to switch from an old hash callback definition to
  *		 a new one. This callback may be NULL.
+ * @async: Buffer of blocks pre-collected by the ES monitor - may be NULL
+ * @kernel_batch: Prepare reading the ES with the batch IOCTL of the kernel ES
+ *		  device. Return the file descriptor of the device or a
+ *		  negative value if the ES cannot be read that way. This
+ *		  callback may be NULL.
+ * @kernel_batch_id: ID of the ES in the batch IOCTL (ESDM_ES_BATCH_*)
  */
 struct esdm_es_cb {
 	const char *name;
@@ -127,6 +180,9 @@ struct esdm_es_cb {
 	int (*switch_hash)(struct esdm_drng *drng, int node,
 			   const struct esdm_hash_cb *new_cb,
 			   const struct esdm_hash_cb *old_cb);
+	struct esdm_es_async *async;
+	int (*kernel_batch)(uint32_t requested_bits);
+	uint32_t kernel_batch_id;
 };
 
 /* Reseed is desired */
@@ -139,11 +195,101 @@ void esdm_es_add_entropy(void);
 void esdm_kernel_read(struct entropy_es *eb_es, int fd, unsigned int ioctl_cmd,
 		      enum esdm_es_data_size data_size, const char *name);
 
+#if defined(ESDM_ES_IRQ) || defined(ESDM_ES_SCHED)
+
+#include <linux/ioctl.h>
+
+#define ESDMIO 0xE0
+
+/* IDs of the kernel entropy sources in the batch read */
+#define ESDM_ES_BATCH_IRQ 0
+#define ESDM_ES_BATCH_SCHED 1
+#define ESDM_ES_BATCH_MAX 2
+
+/*
+ * Batch read of the kernel entropy sources: the kernel writes the entropy
+ * block of each ES selected in es_mask with e_size bytes of entropy data
+ * followed by the entropy bits to buf + offset[ESDM_ES_BATCH_*].
+ */
+struct esdm_es_batch {
+	uint64_t buf;
+	uint32_t es_mask;
+	uint32_t e_size;
+	uint32_t offset[ESDM_ES_BATCH_MAX];
+};
+
+/* IRQ and SCHED ES: read entropy values into the given layout */
+#define ESDM_ES_ENT_BUF_BATCH _IOW(ESDMIO, 0x0a, struct esdm_es_batch)
+
+/*
+ * Log2 histograms of the cost in cycles summed over all CPUs: bucket 0 counts
+ * the events without measurable cost, bucket i counts the events costing
+ * [2^(i-1), 2^i) cycles. The last bucket also counts all more costly events.
+ */
+#define ESDM_ES_PERF_HIST_BUCKETS 32
+
+struct esdm_es_perf_hist {
+	uint64_t hook[ESDM_ES_PERF_HIST_BUCKETS];
+	uint64_t compress[ESDM_ES_PERF_HIST_BUCKETS];
+};
+
+/* IRQ ES: read the cost of the interrupt hook and the pool compression */
+#define ESDM_IRQ_PERF_HIST _IOR(ESDMIO, 0x0b, struct esdm_es_perf_hist)
+
+/*
+ * Read-only ring of entropy blocks the kernel fills while it is mapped. A
+ * slot holds a valid block if the lowest bit of seq is clear and seq is not
+ * 0. The generation of the block is seq >> 1.
+ */
+#define ESDM_ES_RING_VERSION 1
+#define ESDM_ES_RING_SLOTS 8
+#define ESDM_ES_RING_E_SIZE 64
+
+struct esdm_es_ring_slot {
+	uint64_t seq;
+	uint32_t e_bits;
+	uint32_t reserved;
+	uint8_t e[ESDM_ES_RING_E_SIZE];
+};
+
+struct esdm_es_ring {
+	uint32_t version;
+	uint32_t slots;
+	uint32_t e_size;
+	uint32_t reserved;
+	uint64_t produced;
+	struct esdm_es_ring_slot slot[ESDM_ES_BATCH_MAX][ESDM_ES_RING_SLOTS];
+};
+
+#endif /* ESDM_ES_IRQ || ESDM_ES_SCHED */
+
 /* Set the requested bit size */
 void esdm_kernel_set_requested_bits(uint32_t *configured_bits,
 				    uint32_t requested_bits, int fd,
 				    unsigned int ioctl_cmd);
 
+/*
+ * Cached entropy level of a kernel entropy source: the value read from the
+ * kernel is used until it expires or one of the kernel ES was read or
+ * reconfigured.
+ */
+struct esdm_kernel_ent_cache {
+	atomic_t ent;
+	atomic_t gen;
+	atomic_64_t expiry_ns;
+};
+
+#define ESDM_KERNEL_ENT_CACHE_INIT                                             \
+	{ .ent = ATOMIC_INIT(0), .gen = ATOMIC_INIT(-1),                       \
+	  .expiry_ns = ATOMIC_64_INIT(0) }
+
+/* Read the entropy level of a kernel ES, use the cached value if possible */
+uint32_t esdm_kernel_entropylevel(struct esdm_kernel_ent_cache *cache, int fd,
+				  unsigned int ioctl_cmd, bool refresh);
+
+/* Invalidate the cached entropy levels of all kernel ES */
+void esdm_kernel_entropylevel_invalidate(void);
+
 /* Cap to maximum entropy that can ever be generated with given hash */
 #define esdm_cap_requested(__digestsize_bits, __requested_bits)                                           \
 	do {                                                                                              \
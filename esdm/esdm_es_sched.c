@@ -36,6 +36,10 @@
 
 static int esdm_sched_entropy_fd = -1;
 static uint32_t esdm_sched_requested_bits_set = 0;
+/* Entropy rate in events last configured with the kernel, 0 if none */
+static uint32_t esdm_sched_rate_events_set = 0;
+static struct esdm_kernel_ent_cache esdm_sched_ent_cache =
+	ESDM_KERNEL_ENT_CACHE_INIT;
 static enum esdm_es_data_size esdm_sched_data_size = esdm_es_data_equal;
 
 static void esdm_sched_finalize(void)
@@ -43,6 +47,7 @@ static void esdm_sched_finalize(void)
 	if (esdm_sched_entropy_fd >= 0)
 		close(esdm_sched_entropy_fd);
 	esdm_sched_entropy_fd = -1;
+	esdm_sched_rate_events_set = 0;
 }
 
 bool esdm_sched_enabled(void)
@@ -82,22 +87,23 @@ static int esdm_sched_set_entropy_rate(uint32_t requested_bits)
 			     ESDM_DRNG_SECURITY_STRENGTH_BITS / entropy[1];
 	}
 
+	/* The kernel already uses this configuration */
+	if (!entropy[0] && entropy[1] == esdm_sched_rate_events_set)
+		return 0;
+
 	/* Set current entropy rate */
 	ret = ioctl(esdm_sched_entropy_fd, ESDM_SCHED_CONF, &entropy);
 	if (ret < 0)
 		return -EINVAL;
 
 	esdm_sched_requested_bits_set = requested_bits;
+	esdm_sched_rate_events_set = entropy[1];
+	esdm_kernel_entropylevel_invalidate();
 	return 0;
 }
 
-static uint32_t esdm_sched_entropylevel(uint32_t requested_bits)
+static uint32_t esdm_sched_entropylevel_read(bool refresh)
 {
-	uint32_t entropy;
-	int ret;
-
-	(void)requested_bits;
-
 	/*
 	 * Note, due to esdm_config_es_sched_entropy_rate_set, IRQ and Sched ES
 	 * together are not allowed to deliver entropy.
@@ -111,11 +117,16 @@ static uint32_t esdm_sched_entropylevel(uint32_t requested_bits)
 		return 0;
 
 	/* Read entropy level */
-	ret = ioctl(esdm_sched_entropy_fd, ESDM_SCHED_AVAIL_ENTROPY, &entropy);
-	if (ret < 0)
-		return 0;
+	return esdm_kernel_entropylevel(&esdm_sched_ent_cache,
+					esdm_sched_entropy_fd,
+					ESDM_SCHED_AVAIL_ENTROPY, refresh);
+}
 
-	return entropy;
+static uint32_t esdm_sched_entropylevel(uint32_t requested_bits)
+{
+	(void)requested_bits;
+
+	return esdm_sched_entropylevel_read(false);
 }
 
 static int esdm_sched_initialize(void)
@@ -203,7 +214,8 @@ static int esdm_sched_seed_monitor(void)
 	if (esdm_sched_entropy_fd < 0)
 		return 0;
 
-	ent = esdm_sched_entropylevel(esdm_security_strength());
+	/* The monitor always obtains the current entropy level */
+	ent = esdm_sched_entropylevel_read(true);
 
 	if (!esdm_config_es_sched_entropy_rate())
 		return 0;
@@ -262,6 +274,17 @@ err:
 	eb_es->e_bits = 0;
 }
 
+/* Prepare the batch read of the scheduler ES with the kernel */
+static int esdm_sched_kernel_batch(uint32_t requested_bits)
+{
+	if (esdm_sched_entropy_fd < 0)
+		return -1;
+
+	esdm_sched_set_requested_bits(requested_bits);
+
+	return esdm_sched_entropy_fd;
+}
+
 static void esdm_sched_es_state(char *buf, size_t buflen)
 {
 	char status[250], *status_p = (buflen < sizeof(status)) ? status : buf;
@@ -296,6 +319,10 @@ static void esdm_sched_reset(void)
 	if (esdm_sched_entropy_fd >= 0) {
 		int ret = ioctl(esdm_sched_entropy_fd, ESDM_SCHED_CONF, reset);
 
+		/* Configure the entropy rate again with the next request */
+		esdm_sched_rate_events_set = 0;
+		esdm_kernel_entropylevel_invalidate();
+
 		if (ret < 0) {
 			esdm_logger(
 				LOGGER_ERR, LOGGER_C_ES,
@@ -309,6 +336,13 @@ static bool esdm_sched_active(void)
 	return esdm_config_es_sched_retry() || (esdm_sched_entropy_fd != -1);
 }
 
+#if (ESDM_SCHED_ASYNC_BLOCKS > 0)
+DEFINE_ESDM_ES_ASYNC(esdm_sched_async, ESDM_SCHED_ASYNC_BLOCKS);
+#define ESDM_SCHED_ASYNC (&esdm_sched_async)
+#else
+#define ESDM_SCHED_ASYNC NULL
+#endif
+
 struct esdm_es_cb esdm_es_sched = {
 	.name = "Scheduler",
 	.init = esdm_sched_initialize,
@@ -321,4 +355,7 @@ struct esdm_es_cb esdm_es_sched = {
 	.reset = esdm_sched_reset,
 	.active = esdm_sched_active,
 	.switch_hash = NULL,
+	.async = ESDM_SCHED_ASYNC,
+	.kernel_batch = esdm_sched_kernel_batch,
+	.kernel_batch_id = ESDM_ES_BATCH_SCHED,
 };
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "esdm_config.h"
+#include "esdm_es_aux.h"
+#include "esdm_es_synth.h"
+#include "esdm_logger.h"
+#include "mutex.h"
+
+/*
+ * Synthetic entropy source for reproducible performance measurements: the ES
+ * delivers a deterministic data stream derived from a seed after a configured
+ * latency and claims the configured entropy rate for it. It does NOT deliver
+ * any entropy and is therefore only available in test mode builds.
+ */
+
+static DEFINE_MUTEX_UNLOCKED(esdm_synth_lock);
+static uint64_t esdm_synth_state;
+static uint32_t esdm_synth_seed;
+static bool esdm_synth_seeded;
+static uint64_t esdm_synth_collections;
+
+/* SplitMix64 generator of the data stream */
+static uint64_t esdm_synth_next(void)
+{
+	uint64_t z = (esdm_synth_state += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static void esdm_synth_fill(uint8_t *buf, size_t buflen)
+{
+	uint32_t seed = esdm_config_es_synth_seed();
+	uint64_t val;
+	size_t todo;
+
+	mutex_lock(&esdm_synth_lock);
+
+	/* Restart the data stream with a new seed */
+	if (!esdm_synth_seeded || seed != esdm_synth_seed) {
+		esdm_synth_seed = seed;
+		esdm_synth_state = seed;
+		esdm_synth_seeded = true;
+	}
+
+	while (buflen) {
+		val = esdm_synth_next();
+		todo = buflen < sizeof(val) ? buflen : sizeof(val);
+		memcpy(buf, &val, todo);
+		buf += todo;
+		buflen -= todo;
+	}
+	esdm_synth_collections++;
+
+	mutex_unlock(&esdm_synth_lock);
+}
+
+static void esdm_synth_delay(void)
+{
+	uint32_t latency_us = esdm_config_es_synth_latency_us();
+	struct timespec ts = {
+		.tv_sec = latency_us / 1000000,
+		.tv_nsec = (long)(latency_us % 1000000) * 1000,
+	};
+
+	if (!latency_us)
+		return;
+
+	while (nanosleep(&ts, &ts) && errno == EINTR)
+		;
+}
+
+static int esdm_synth_init(void)
+{
+	esdm_logger(
+		LOGGER_WARN, LOGGER_C_ES,
+		"Synthetic entropy source enabled - it does not deliver entropy, use for testing only!\n");
+
+	mutex_lock(&esdm_synth_lock);
+	esdm_synth_seeded = false;
+	esdm_synth_collections = 0;
+	mutex_unlock(&esdm_synth_lock);
+
+	return 0;
+}
+
+static uint32_t esdm_synth_entropylevel(uint32_t requested_bits)
+{
+	return esdm_fast_noise_entropylevel(
+		esdm_config_es_synth_entropy_rate(), requested_bits);
+}
+
+static uint32_t esdm_synth_poolsize(void)
+{
+	return esdm_synth_entropylevel(esdm_security_strength());
+}
+
+/*
+ * esdm_synth_get() - Get the synthetic data
+ *
+ * @eb: entropy buffer to store entropy
+ * @requested_bits: requested entropy in bits
+ */
+static void esdm_synth_get(struct entropy_es *eb_es, uint32_t requested_bits,
+			   bool __unused unused)
+{
+	esdm_synth_delay();
+	esdm_synth_fill(eb_es->e, requested_bits >> 3);
+	eb_es->e_bits = esdm_synth_entropylevel(requested_bits);
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+		    "obtained %u bits of entropy from synthetic noise source\n",
+		    eb_es->e_bits);
+}
+
+static void esdm_synth_es_state(char *buf, size_t buflen)
+{
+	uint64_t collections;
+
+	mutex_reader_lock(&esdm_synth_lock);
+	collections = esdm_synth_collections;
+	mutex_reader_unlock(&esdm_synth_lock);
+
+	snprintf(buf, buflen,
+		 " Available entropy: %u\n"
+		 " Entropy Rate per 256 data bits: %u\n"
+		 " Latency: %u us\n"
+		 " Seed: %u\n"
+		 " Collections: %llu\n",
+		 esdm_synth_poolsize(), esdm_synth_entropylevel(256),
+		 esdm_config_es_synth_latency_us(), esdm_config_es_synth_seed(),
+		 (unsigned long long)collections);
+}
+
+static bool esdm_synth_active(void)
+{
+	return true;
+}
+
+struct esdm_es_cb esdm_es_synth = {
+	.name = "Synthetic",
+	.init = esdm_synth_init,
+	.fini = NULL,
+	.monitor_es = NULL,
+	.get_ent = esdm_synth_get,
+	.curr_entropy = esdm_synth_entropylevel,
+	.max_entropy = esdm_synth_poolsize,
+	.state = esdm_synth_es_state,
+	.reset = NULL,
+	.active = esdm_synth_active,
+	.switch_hash = NULL,
+	.async = NULL,
+};
@@ -0,0 +1,242 @@
+/*
+ * ESDM Fast Entropy Source: Upstream ESDM server
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdio.h>
+
+#include "atomic.h"
+#include "esdm_config.h"
+#include "esdm_crypto.h"
+#include "esdm_definitions.h"
+#include "esdm_drng_mgr.h"
+#include "esdm_es_aux.h"
+#include "esdm_es_upstream.h"
+#include "esdm_node.h"
+#include "esdm_rpc_client.h"
+#include "helper.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+
+/*
+ * The embedded mode: the application runs the DRNG manager of the ESDM
+ * in-process while all entropy is obtained from the ESDM server of the
+ * system. Each reseed of a DRNG requests one seed buffer from the server which
+ * is compressed with the conditioning hash of the DRNG. Random numbers are
+ * generated without any IPC.
+ */
+
+/* Upper limit of the seed buffer delivered by the ESDM server */
+#define ESDM_UPSTREAM_SEED_WORDS 512
+
+static atomic_t esdm_upstream_available = ATOMIC_INIT(0);
+
+static int esdm_upstream_init(void)
+{
+	int ret;
+
+	/*
+	 * Without an entropy rate, e.g. in an ESDM server which is no shard,
+	 * the server is not contacted at all.
+	 */
+	if (!esdm_config_es_upstream_entropy_rate()) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ES,
+			    "Upstream ESDM entropy source disabled\n");
+		atomic_set(&esdm_upstream_available, 0);
+		return 0;
+	}
+
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret) {
+		esdm_logger(
+			LOGGER_WARN, LOGGER_C_ES,
+			"Disabling upstream ESDM entropy source as the RPC client cannot be initialized, error: %d\n",
+			ret);
+		atomic_set(&esdm_upstream_available, 0);
+		return 0;
+	}
+
+	atomic_set(&esdm_upstream_available, 1);
+
+	return 0;
+}
+
+static void esdm_upstream_finalize(void)
+{
+	if (!atomic_xchg(&esdm_upstream_available, 0))
+		return;
+
+	esdm_rpcc_fini_unpriv_service();
+}
+
+static uint32_t esdm_upstream_entropylevel(uint32_t requested_bits)
+{
+	if (!atomic_read(&esdm_upstream_available))
+		return 0;
+
+	return esdm_fast_noise_entropylevel(
+		esdm_config_es_upstream_entropy_rate(), requested_bits);
+}
+
+static uint32_t esdm_upstream_poolsize(void)
+{
+	return esdm_upstream_entropylevel(esdm_security_strength());
+}
+
+/* Compress the seed buffer into the output buffer */
+static int esdm_upstream_compress(uint8_t *outbuf, uint32_t *requested_bits,
+				  const uint8_t *seed, size_t seedlen)
+{
+#if defined(ESDM_HASH_SHA512)
+	LC_HASH_CTX_ON_STACK(shash, lc_sha512);
+	bool shash_free = false;
+#elif defined(ESDM_HASH_SHA3_512)
+	LC_HASH_CTX_ON_STACK(shash, lc_sha3_512);
+	bool shash_free = false;
+#else
+	void *shash = NULL;
+	bool shash_free = true;
+#endif
+	const struct esdm_hash_cb *hash_cb;
+	struct esdm_drng *drng = esdm_drng_node_instance();
+	uint32_t digestsize_bits;
+	int ret;
+
+	hash_cb = esdm_drng_hash_cb(drng);
+
+	if (shash_free) {
+		ret = esdm_hash_ctx_get(hash_cb, (void **)&shash);
+		if (ret)
+			goto out;
+	}
+
+	digestsize_bits = hash_cb->hash_digestsize(shash) << 3;
+	/* Cap to maximum entropy that can ever be generated with given hash */
+	esdm_cap_requested(digestsize_bits, *requested_bits);
+
+	ret = hash_cb->hash_init(shash);
+	if (ret)
+		goto out;
+	ret = hash_cb->hash_update(shash, seed, seedlen);
+	if (ret)
+		goto out;
+
+	/* Generate the compressed data to be returned to the caller */
+	if (*requested_bits < digestsize_bits) {
+		uint8_t digest[ESDM_MAX_DIGESTSIZE];
+
+		ret = hash_cb->hash_final(shash, digest);
+		if (!ret)
+			memcpy(outbuf, digest, *requested_bits >> 3);
+		memset_secure(digest, 0, sizeof(digest));
+	} else {
+		ret = hash_cb->hash_final(shash, outbuf);
+	}
+
+out:
+	if (shash_free)
+		esdm_hash_ctx_put(hash_cb, shash);
+	else
+		hash_cb->hash_desc_zero(shash);
+	esdm_drng_put_instances();
+	return ret;
+}
+
+/*
+ * esdm_upstream_get() - Get the entropy from the upstream ESDM server
+ *
+ * @eb: entropy buffer to store entropy
+ * @requested_bits: requested entropy in bits
+ * @fully_seeded: the DRNG to be seeded is fully seeded
+ */
+static void esdm_upstream_get(struct entropy_es *eb_es, uint32_t requested_bits,
+			      bool fully_seeded)
+{
+	/* seedlen, entropy_rate, seed data - see esdm_get_seed */
+	uint64_t seed[ESDM_UPSTREAM_SEED_WORDS];
+	uint32_t ent_bits = 0;
+	ssize_t ret;
+
+	if (!atomic_read(&esdm_upstream_available))
+		goto out;
+
+	/* Do not stall the seeding while the server is not yet seeded */
+	ret = esdm_rpcc_get_seed((uint8_t *)seed, sizeof(seed),
+				 ESDM_GET_SEED_NONBLOCK |
+					 (fully_seeded ?
+						  ESDM_GET_SEED_FULLY_SEEDED :
+						  0));
+	if (ret < 0) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+			    "upstream ESDM server did not deliver a seed: %zd\n",
+			    ret);
+		goto out;
+	}
+
+	if ((size_t)ret < 2 * sizeof(uint64_t) ||
+	    seed[0] > (size_t)ret - 2 * sizeof(uint64_t))
+		goto out;
+
+	if (esdm_upstream_compress(eb_es->e, &requested_bits,
+				   (uint8_t *)&seed[2], (size_t)seed[0]))
+		goto out;
+
+	/* The server states the entropy of the complete seed buffer */
+	ent_bits = (uint32_t)min_uint64(
+		esdm_upstream_entropylevel(requested_bits), seed[1]);
+
+out:
+	memset_secure(seed, 0, sizeof(seed));
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_ES,
+		    "obtained %u bits of entropy from upstream ESDM entropy source\n",
+		    ent_bits);
+	eb_es->e_bits = ent_bits;
+}
+
+static void esdm_upstream_es_state(char *buf, size_t buflen)
+{
+	const struct esdm_drng *esdm_drng_init = esdm_drng_init_instance();
+
+	/* Assume the esdm_drng_init lock is taken by caller */
+	snprintf(buf, buflen,
+		 " Hash for compressing data: %s\n"
+		 " Available entropy: %u\n"
+		 " Entropy Rate per 256 data bits: %u\n",
+		 esdm_drng_init->hash_cb->hash_name(), esdm_upstream_poolsize(),
+		 esdm_upstream_entropylevel(256));
+}
+
+static bool esdm_upstream_active(void)
+{
+	return !!atomic_read(&esdm_upstream_available);
+}
+
+struct esdm_es_cb esdm_es_upstream = {
+	.name = "UpstreamESDM",
+	.init = esdm_upstream_init,
+	.fini = esdm_upstream_finalize,
+	.monitor_es = NULL,
+	.get_ent = esdm_upstream_get,
+	.curr_entropy = esdm_upstream_entropylevel,
+	.max_entropy = esdm_upstream_poolsize,
+	.state = esdm_upstream_es_state,
+	.reset = NULL,
+	.active = esdm_upstream_active,
+	.switch_hash = NULL,
+};
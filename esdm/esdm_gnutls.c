@@ -21,12 +21,14 @@
 #include <gnutls/gnutls.h>
 #include <gnutls/crypto.h>
 #include <nettle/aes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "esdm_crypto.h"
 #include "esdm_gnutls.h"
 #include "esdm_logger.h"
+#include "math_helper.h"
 
 #define ESDM_GNUTLS_HASH GNUTLS_DIG_SHA512
 
@@ -59,11 +61,50 @@ static int esdm_gnutls_hash_final(void *hash, uint8_t *digest)
 	return 0;
 }
 
+/*
+ * gnutls_hash_init resolves the algorithm and allocates the context with every
+ * call. Contexts are therefore cloned from a template handle which is never
+ * updated and thus may be copied by all threads concurrently.
+ */
+#if GNUTLS_VERSION_NUMBER >= 0x030609
+static gnutls_hash_hd_t esdm_gnutls_hash_template = NULL;
+static pthread_once_t esdm_gnutls_hash_template_once = PTHREAD_ONCE_INIT;
+
+static void esdm_gnutls_hash_template_init(void)
+{
+	if (gnutls_hash_init(&esdm_gnutls_hash_template, ESDM_GNUTLS_HASH) < 0)
+		esdm_gnutls_hash_template = NULL;
+}
+
+static gnutls_hash_hd_t esdm_gnutls_hash_clone(void)
+{
+	pthread_once(&esdm_gnutls_hash_template_once,
+		     esdm_gnutls_hash_template_init);
+	if (!esdm_gnutls_hash_template)
+		return NULL;
+
+	/* NULL if the hash implementation does not support copying */
+	return gnutls_hash_copy(esdm_gnutls_hash_template);
+}
+#else
+static inline gnutls_hash_hd_t esdm_gnutls_hash_clone(void)
+{
+	return NULL;
+}
+#endif
+
 static int esdm_gnutls_hash_alloc(void **ctx)
 {
 	gnutls_hash_hd_t *hd = (gnutls_hash_hd_t *)ctx;
 
-	gnutls_hash_init(hd, ESDM_GNUTLS_HASH);
+	*hd = esdm_gnutls_hash_clone();
+	if (*hd)
+		return 0;
+
+	if (gnutls_hash_init(hd, ESDM_GNUTLS_HASH) < 0) {
+		*hd = NULL;
+		return -EFAULT;
+	}
 	return 0;
 }
 
@@ -101,7 +142,8 @@ static int esdm_gnutls_hash_selftest(void)
 	uint8_t act[sizeof(exp_512)];
 	int ret = 0;
 
-	esdm_gnutls_hash_alloc(&hd);
+	if (esdm_gnutls_hash_alloc(&hd))
+		return -EFAULT;
 	esdm_gnutls_hash_update(hd, msg_512, 3);
 	esdm_gnutls_hash_final(hd, act);
 	esdm_gnutls_hash_dealloc(hd);
@@ -161,15 +203,27 @@ static int esdm_gnutls_drbg_seed(void *drng, const uint8_t *inbuf,
 		       -EFAULT;
 }
 
+/* Maximum request size of drbg_aes_generate (MAX_DRBG_OUT of GnuTLS) */
+#define ESDM_GNUTLS_DRBG_MAX_REQSIZE (1U << 16)
+
 static ssize_t esdm_gnutls_drbg_generate(void *drng, uint8_t *outbuf,
 					 size_t outbuflen)
 {
 	struct drbg_aes_ctx *drbg = (struct drbg_aes_ctx *)drng;
+	size_t len = outbuflen;
 
-	return drbg_aes_generate(drbg, (unsigned int)outbuflen, outbuf, 0,
-				 NULL) ?
-		       (ssize_t)outbuflen :
-		       -EFAULT;
+	/* Serve the request with as few generate operations as possible */
+	while (len) {
+		unsigned int todo = (unsigned int)min_size(
+			len, ESDM_GNUTLS_DRBG_MAX_REQSIZE);
+
+		if (!drbg_aes_generate(drbg, todo, outbuf, 0, NULL))
+			return -EFAULT;
+		outbuf += todo;
+		len -= todo;
+	}
+
+	return (ssize_t)outbuflen;
 }
 
 static int esdm_gnutls_drbg_alloc(void **drng, uint32_t sec_strength)
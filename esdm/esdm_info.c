@@ -17,7 +17,9 @@
  * DAMAGE.
  */
 
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "esdm_config.h"
 #include "esdm.h"
@@ -26,9 +28,13 @@
 #include "esdm_es_irq.h"
 #include "esdm_es_mgr.h"
 #include "esdm_es_sched.h"
+#include "esdm_startup.h"
 #include "esdm_info.h"
 #include "esdm_logger.h"
+#include "metrics.h"
+#include "mutex_w.h"
 #include "test_pertubation.h"
+#include "threading_support.h"
 #include "visibility.h"
 
 static unsigned int esdm_nodes = 1;
@@ -51,6 +57,39 @@ void esdm_version(char *buf, size_t buflen)
 	snprintf(buf, buflen, "%slibrary version: %s\n", TESTMODE_STR, VERSION);
 }
 
+DSO_PUBLIC
+void esdm_latency_status(char *buf, size_t buflen)
+{
+	if (!buf || !buflen)
+		return;
+
+	buf[0] = '\0';
+	esdm_drng_lat_status(buf, buflen);
+}
+
+DSO_PUBLIC
+size_t esdm_metrics(char *buf, size_t buflen)
+{
+#ifdef ESDM_METRICS
+	struct esdm_metrics_buf mb = { .buf = buf, .len = 0, .size = buflen };
+
+	if (!buf || !buflen)
+		return 0;
+
+	buf[0] = '\0';
+	esdm_drng_metrics(&mb);
+	esdm_es_metrics(&mb);
+	esdm_mem_metrics(&mb);
+	thread_stack_metrics(&mb);
+
+	return mb.len;
+#else
+	if (buf && buflen)
+		buf[0] = '\0';
+	return 0;
+#endif
+}
+
 DSO_PUBLIC
 void esdm_status(char *buf, size_t buflen)
 {
@@ -95,7 +134,19 @@ void esdm_status(char *buf, size_t buflen)
 
 		len = esdm_remaining_buf_len(buf, buflen);
 		esdm_es[i]->state(buf + len, buflen - len);
+
+		len = esdm_remaining_buf_len(buf, buflen);
+		esdm_es_stats_state(i, buf + len, buflen - len);
 	}
+
+	len = esdm_remaining_buf_len(buf, buflen);
+	esdm_latency_status(buf + len, buflen - len);
+
+	len = esdm_remaining_buf_len(buf, buflen);
+	esdm_drng_audit_status(buf + len, buflen - len);
+
+	len = esdm_remaining_buf_len(buf, buflen);
+	esdm_startup_status(buf + len, buflen - len);
 }
 
 DSO_PUBLIC
@@ -104,3 +155,71 @@ void esdm_status_machine(struct esdm_status_st *status)
 	status->es_irq_enabled = esdm_irq_enabled();
 	status->es_sched_enabled = esdm_sched_enabled();
 }
+
+static void esdm_status_bin_refresh(struct esdm_status_bin *status,
+				    uint64_t now_ms)
+{
+	struct esdm_drng *drng = esdm_drng_init_instance();
+	uint32_t i;
+
+	memset(status, 0, sizeof(*status));
+	status->version = ESDM_STATUS_BIN_VERSION;
+	status->size = sizeof(*status);
+	status->timestamp_ms = now_ms;
+
+	if (esdm_state_min_seeded())
+		status->flags |= ESDM_STATUS_BIN_MIN_SEEDED;
+	if (esdm_state_fully_seeded())
+		status->flags |= ESDM_STATUS_BIN_FULLY_SEEDED;
+	if (esdm_state_operational())
+		status->flags |= ESDM_STATUS_BIN_OPERATIONAL;
+	if (esdm_config_fips_enabled())
+		status->flags |= ESDM_STATUS_BIN_FIPS;
+	if (esdm_sp80090c_compliant())
+		status->flags |= ESDM_STATUS_BIN_SP80090C;
+	if (esdm_ntg1_compliant())
+		status->flags |= ESDM_STATUS_BIN_NTG1;
+	if (esdm_ntg1_2024_compliant())
+		status->flags |= ESDM_STATUS_BIN_NTG1_2024;
+
+	status->security_strength = esdm_security_strength();
+	status->nodes = esdm_nodes;
+	snprintf(status->drng_name, sizeof(status->drng_name), "%s",
+		 drng->drng_cb->drng_name());
+
+	for_each_esdm_es (i) {
+		if (i >= ESDM_STATUS_BIN_ES_MAX)
+			break;
+
+		esdm_es_status_bin(i, &status->es[i]);
+		status->entropy_level += status->es[i].curr_entropy;
+		status->es_num++;
+	}
+
+	esdm_drng_status_bin(status);
+}
+
+DSO_PUBLIC
+int esdm_status_bin(struct esdm_status_bin *status)
+{
+	static DEFINE_MUTEX_W_UNLOCKED(esdm_status_bin_lock);
+	static struct esdm_status_bin esdm_status_bin_cache;
+	struct timespec ts;
+	uint64_t now_ms;
+
+	if (!status)
+		return -EINVAL;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now_ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+
+	mutex_w_lock(&esdm_status_bin_lock);
+	if (!esdm_status_bin_cache.version ||
+	    now_ms - esdm_status_bin_cache.timestamp_ms >=
+		    ESDM_STATUS_BIN_REFRESH_MS)
+		esdm_status_bin_refresh(&esdm_status_bin_cache, now_ms);
+	memcpy(status, &esdm_status_bin_cache, sizeof(*status));
+	mutex_w_unlock(&esdm_status_bin_lock);
+
+	return 0;
+}
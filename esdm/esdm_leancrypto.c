@@ -22,12 +22,24 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "config.h"
 #include "esdm_crypto.h"
 #include "esdm_leancrypto.h"
 #include "esdm_logger.h"
 
 #define ESDM_LEANCRYPTO_HASH lc_sha3_512
 
+#if defined(ESDM_LEANCRYPTO_DRNG_CHACHA20)
+#define ESDM_LEANCRYPTO_DRNG_ALLOC lc_cc20_drng_alloc
+#define ESDM_LEANCRYPTO_DRNG_NAME "ChaCha20 DRNG"
+#elif defined(ESDM_LEANCRYPTO_DRNG_HASH_DRBG)
+#define ESDM_LEANCRYPTO_DRNG_ALLOC lc_drbg_hash_alloc
+#define ESDM_LEANCRYPTO_DRNG_NAME "SP800-90A Hash DRBG"
+#else
+#define ESDM_LEANCRYPTO_DRNG_ALLOC lc_xdrbg256_drng_alloc
+#define ESDM_LEANCRYPTO_DRNG_NAME "XDRBG"
+#endif
+
 static uint32_t esdm_leancrypto_hash_digestsize(void *hash)
 {
 	struct lc_hash_ctx *hash_ctx = hash;
@@ -81,7 +93,9 @@ static const char *esdm_leancrypto_hash_name(void)
 
 static void esdm_leancrypto_hash_desc_zero(void *hash)
 {
-	(void)hash;
+	struct lc_hash_ctx *hash_ctx = hash;
+
+	lc_hash_zero(hash_ctx);
 }
 
 static int esdm_leancrypto_hash_selftest(void)
@@ -124,14 +138,15 @@ static ssize_t esdm_leancrypto_drbg_generate(void *drng, uint8_t *outbuf,
 static int esdm_leancrypto_drbg_alloc(void **drng, uint32_t sec_strength)
 {
 	struct lc_rng_ctx **ctx = (struct lc_rng_ctx **)drng;
-	int ret = lc_xdrbg256_drng_alloc(ctx);
+	int ret = ESDM_LEANCRYPTO_DRNG_ALLOC(ctx);
 
 	(void)sec_strength;
 
 	if (ret)
 		return ret;
 
-	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY, "XDRBG allocated\n");
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+		    ESDM_LEANCRYPTO_DRNG_NAME " allocated\n");
 
 	return 0;
 }
@@ -141,12 +156,19 @@ static void esdm_leancrypto_drbg_dealloc(void *drng)
 	struct lc_rng_ctx *ctx = drng;
 
 	lc_rng_zero_free(ctx);
-	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY, "XDRBG zeroized and freed\n");
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+		    ESDM_LEANCRYPTO_DRNG_NAME " zeroized and freed\n");
 }
 
 static const char *esdm_leancrypto_drbg_name(void)
 {
+#if defined(ESDM_LEANCRYPTO_DRNG_CHACHA20)
+	return "Leancrypto ChaCha20 DRNG";
+#elif defined(ESDM_LEANCRYPTO_DRNG_HASH_DRBG)
+	return "Leancrypto SP800-90A Hash DRBG with SHA2-512 core";
+#else
 	return "Leancrypto XDRBG with SHAKE256 core";
+#endif
 }
 
 static int esdm_leancrypto_drbg_selftest(void)
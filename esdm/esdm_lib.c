@@ -18,12 +18,16 @@
  */
 
 #include "config.h"
+#include "cpufeatures.h"
 #include "esdm.h"
 #include "esdm_config_internal.h"
+#include "esdm_cpu_class.h"
 #include "esdm_crypto.h"
 #include "esdm_es_mgr.h"
 #include "esdm_node.h"
+#include "esdm_seed_file.h"
 #include "esdm_shm_status.h"
+#include "esdm_startup.h"
 #include "ret_checkers.h"
 #include "visibility.h"
 
@@ -32,6 +36,11 @@ int esdm_init(void)
 {
 	int ret = 0;
 
+	esdm_startup_begin(esdm_startup_esdm_init);
+
+	/* Select the accelerated implementations before any use */
+	esdm_cpufeatures_init();
+
 #ifdef ESDM_OVERSAMPLE_ENTROPY_SOURCES
 	/* Enable oversampling of entropy sources if selected at compile time */
 	if (!esdm_config_sp80090c_compliant())
@@ -39,23 +48,41 @@ int esdm_init(void)
 #endif
 
 	/* Initialize configuration subsystem */
+	esdm_startup_begin(esdm_startup_config);
 	CKINT(esdm_config_init());
+	esdm_startup_end(esdm_startup_config);
 
 	/*
 	 * Initialize the DRNG manager: the DRNG should be ready before the
 	 * entropy manager as the entropy manager may try to immediately
 	 * seed the DRNG.
 	 */
+	esdm_startup_begin(esdm_startup_drng_mgr);
 	CKINT(esdm_drng_mgr_initialize());
+	esdm_startup_end(esdm_startup_drng_mgr);
 
 	/* Initialize the entropy source manager */
+	esdm_startup_begin(esdm_startup_es_mgr);
 	CKINT(esdm_es_mgr_initialize());
+	esdm_startup_end(esdm_startup_es_mgr);
+
+	/* The self tests ran concurrently and must pass before any service */
+	CKINT(esdm_drng_mgr_selftest_wait());
+
+	/* Insert the seed file content persisted by the previous instance */
+	esdm_seed_file_init();
 
 	/* Initialize all nodes */
+	esdm_startup_begin(esdm_startup_nodes);
 	esdm_drngs_node_alloc();
+	esdm_startup_end(esdm_startup_nodes);
 
 	/* Initialize the status ESDM shared memory segment */
+	esdm_startup_begin(esdm_startup_shm_status);
 	CKINT(esdm_shm_status_init());
+	esdm_startup_end(esdm_startup_shm_status);
+
+	esdm_startup_end(esdm_startup_esdm_init);
 
 out:
 	return ret;
@@ -85,6 +112,9 @@ out:
 DSO_PUBLIC
 void esdm_fini(void)
 {
+	/* Persist seed material for the next start */
+	esdm_seed_file_fini();
+
 	/* Clear up the SHM information */
 	esdm_shm_status_exit();
 
@@ -101,5 +131,20 @@ void esdm_fini(void)
 DSO_PUBLIC
 int esdm_init_monitor(void (*priv_init_completion)(void))
 {
+	/* The entropy source collection is background work */
+	esdm_cpu_class_bind(esdm_cpu_class_efficiency);
+
 	return esdm_es_mgr_monitor_initialize(priv_init_completion);
 }
+
+DSO_PUBLIC
+int esdm_monitor_poll(void)
+{
+	return esdm_es_mgr_monitor_poll();
+}
+
+DSO_PUBLIC
+int esdm_init_reseeder(void)
+{
+	return esdm_drng_mgr_reseeder();
+}
@@ -19,9 +19,13 @@
  * DAMAGE.
  */
 
+#include "arch.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "atomic.h"
+#include "esdm_config_internal.h"
 #include "esdm_crypto.h"
 #include "esdm_drng_mgr.h"
 #include "esdm_es_irq.h"
@@ -29,6 +33,7 @@
 #include "esdm_info.h"
 #include "esdm_node.h"
 #include "esdm_logger.h"
+#include "metrics.h"
 #include "mutex.h"
 
 static struct esdm_drng **esdm_drng = NULL;
@@ -53,6 +58,99 @@ void esdm_drng_put_instances(void)
 	//mutex_reader_unlock(&esdm_node_cleanup_lock);
 }
 
+/* Affinity of the caller before it was bound to its CPU */
+static __thread struct esdm_arch_cpu_affinity esdm_node_prev_affinity;
+
+bool esdm_node_cpu_pin(void)
+{
+	struct esdm_config_snapshot snap;
+
+	esdm_config_snapshot(&snap);
+	if (!snap.drng_cpu_affine || !esdm_drng || !snap.derived ||
+	    snap.online_nodes < 2)
+		return false;
+
+	return !esdm_arch_cpu_pin(esdm_arch_curr_node(),
+				  &esdm_node_prev_affinity);
+}
+
+void esdm_node_cpu_unpin(bool pinned)
+{
+	if (pinned)
+		esdm_arch_cpu_unpin(&esdm_node_prev_affinity);
+}
+
+#ifdef ESDM_NODE_HIERARCHY
+
+#ifdef ESDM_LINUX
+/*
+ * Get the CPU package of the CPU with the same number as the node. The node
+ * DRNG serves the CPUs whose number modulo the number of nodes is the node
+ * number. Thus, this CPU is one of the CPUs served by the node.
+ */
+static uint32_t esdm_node_package(uint32_t node)
+{
+	char path[80];
+	FILE *f;
+	unsigned int package = 0;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%u/topology/physical_package_id",
+		 node);
+
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+
+	if (fscanf(f, "%u", &package) != 1)
+		package = 0;
+	fclose(f);
+
+	return package;
+}
+#else /* ESDM_LINUX */
+static uint32_t esdm_node_package(uint32_t node)
+{
+	(void)node;
+	return 0;
+}
+#endif /* ESDM_LINUX */
+
+/*
+ * Link the node DRNG to its parent: the first node DRNG of the CPU package is
+ * seeded from the entropy sources, all others are seeded from the first one.
+ */
+static void esdm_drngs_node_link(struct esdm_drng **drngs, uint32_t *packages,
+				 uint32_t node)
+{
+	uint32_t i;
+
+	packages[node] = esdm_node_package(node);
+
+	for (i = 0; i < node; i++) {
+		if (packages[i] != packages[node] || drngs[i]->parent)
+			continue;
+
+		drngs[node]->parent = drngs[i];
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+			    "DRNG for node %u seeded from node %u (package %u)\n",
+			    node, i, packages[node]);
+		return;
+	}
+}
+
+#else /* ESDM_NODE_HIERARCHY */
+
+static void esdm_drngs_node_link(struct esdm_drng **drngs, uint32_t *packages,
+				 uint32_t node)
+{
+	(void)drngs;
+	(void)packages;
+	(void)node;
+}
+
+#endif /* ESDM_NODE_HIERARCHY */
+
 static void esdm_drngs_node_dealloc(struct esdm_drng **drngs)
 {
 	struct esdm_drng *esdm_drng_init = esdm_drng_init_instance();
@@ -68,14 +166,22 @@ static void esdm_drngs_node_dealloc(struct esdm_drng **drngs)
 			continue;
 
 		if (drng) {
+			esdm_drng_small_dealloc(drng);
 			mutex_w_lock(&drng->lock);
+			mutex_lock(&drng->state_lock);
 			drng->drng_cb->drng_dealloc(drng->drng);
+			mutex_unlock(&drng->state_lock);
 			mutex_w_unlock(&drng->lock);
 			free(drng);
+			esdm_mem_account(esdm_mem_drng,
+					 -(int64_t)sizeof(struct esdm_drng));
 			drngs[node] = NULL;
 		}
 	}
 	free(drngs);
+	esdm_mem_account(esdm_mem_drng,
+			 -(int64_t)(esdm_config_online_nodes() *
+				    sizeof(struct esdm_drng *)));
 }
 
 /* Allocate the data structures for the per-node DRNGs */
@@ -83,6 +189,7 @@ void esdm_drngs_node_alloc(void)
 {
 	struct esdm_drng **drngs;
 	struct esdm_drng *esdm_drng_init = esdm_drng_init_instance();
+	uint32_t *packages = NULL;
 	uint32_t node;
 	bool init_drng_used = false;
 
@@ -96,36 +203,75 @@ void esdm_drngs_node_alloc(void)
 	if (esdm_drng_mgr_initialize())
 		goto unlock;
 
+	packages = calloc(esdm_config_online_nodes(), sizeof(uint32_t));
+	if (!packages)
+		goto unlock;
+
 	drngs = calloc(esdm_config_online_nodes(), sizeof(struct esdm_drng *));
 	if (!drngs)
 		goto unlock;
+	esdm_mem_account(esdm_mem_drng, esdm_config_online_nodes() *
+						sizeof(struct esdm_drng *));
 
 	for_each_online_node (node) {
+		struct esdm_arch_cpu_affinity prev;
 		struct esdm_drng *drng;
+		bool pinned;
+		int ret;
 
 		if (!init_drng_used) {
 			drngs[node] = esdm_drng_init;
+			esdm_drngs_node_link(drngs, packages, node);
 			init_drng_used = true;
 			continue;
 		}
 
-		drng = calloc(1, sizeof(struct esdm_drng));
+		/*
+		 * Allocate the DRNG while executing on a CPU served by the node
+		 * DRNG: newly mapped memory is placed on the NUMA node of the
+		 * CPU touching it first. The node DRNG serves the CPU with the
+		 * same number as the node.
+		 */
+		pinned = !esdm_arch_cpu_pin(node, &prev);
 
-		if (esdm_drng_alloc_common(drng, esdm_drng_init->drng_cb)) {
+		/* Prevent false sharing with neighboring allocations */
+		if (posix_memalign((void *)&drng, ESDM_CACHELINE_SIZE,
+				   sizeof(struct esdm_drng))) {
+			if (pinned)
+				esdm_arch_cpu_unpin(&prev);
+			goto err;
+		}
+		memset(drng, 0, sizeof(struct esdm_drng));
+
+		ret = esdm_drng_alloc_common(drng, esdm_drng_init->drng_cb);
+		if (pinned)
+			esdm_arch_cpu_unpin(&prev);
+		if (ret) {
 			free(drng);
 			goto err;
 		}
+		esdm_mem_account(esdm_mem_drng, sizeof(struct esdm_drng));
 
 		drng->hash_cb = esdm_drng_init->hash_cb;
+		drng->node = node;
 
-		mutex_w_init(&drng->lock, 0, 1);
+		mutex_w_init_adaptive(&drng->lock, 0, 1);
 		mutex_init(&drng->hash_lock, 0);
+		mutex_init(&drng->state_lock, 0);
+
+		/* Without it, the node DRNG serves the small requests */
+		if (esdm_drng_small_alloc(drng))
+			esdm_logger(LOGGER_WARN, LOGGER_C_ANY,
+				    "low-latency DRNG allocation for node %u failed\n",
+				    node);
 
 		/*
 		 * No reseeding of node DRNGs from previous DRNGs as this
-		 * would complicate the code. Let it simply reseed.
+		 * would complicate the code. Let it simply reseed - either
+		 * from the entropy sources or from its parent DRNG.
 		 */
 		drngs[node] = drng;
+		esdm_drngs_node_link(drngs, packages, node);
 
 		esdm_pool_inc_node_node();
 		esdm_logger(
@@ -145,6 +291,7 @@ err:
 	esdm_drngs_node_dealloc(drngs);
 
 unlock:
+	free(packages);
 	mutex_w_unlock(&esdm_crypto_cb_update);
 }
 
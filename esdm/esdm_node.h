@@ -22,6 +22,7 @@
 
 #include <stddef.h>
 
+#include "bool.h"
 #include "config.h"
 #include "esdm_config.h"
 
@@ -31,6 +32,14 @@ void esdm_drng_put_instances(void);
 void esdm_drngs_node_alloc(void);
 void esdm_node_fini(void);
 
+/*
+ * Bind the caller to its current CPU to use the DRNG instance of this CPU
+ * until esdm_node_cpu_unpin is called, if enabled with
+ * esdm_config_drng_cpu_affine_set. Returns true if the caller was bound.
+ */
+bool esdm_node_cpu_pin(void);
+void esdm_node_cpu_unpin(bool pinned);
+
 #define for_each_online_node(cpu)                                              \
 	for (cpu = 0; cpu < esdm_config_online_nodes(); cpu++)
 
@@ -48,6 +57,14 @@ static inline void esdm_drngs_node_alloc(void)
 static inline void esdm_node_fini(void)
 {
 }
+static inline bool esdm_node_cpu_pin(void)
+{
+	return false;
+}
+static inline void esdm_node_cpu_unpin(bool pinned)
+{
+	(void)pinned;
+}
 
 #define for_each_online_node(cpu) for (cpu = 0; cpu < 1; cpu++)
 
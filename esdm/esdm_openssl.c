@@ -31,22 +31,48 @@
 #include "esdm_logger.h"
 #include "ret_checkers.h"
 
-#define ESDM_OPENSSL_HASH (EVP_sha3_512())
+/*
+ * The message digest is fetched once and kept for the lifetime of the process
+ * as EVP_sha3_512() implies a fetch for every EVP_DigestInit. If the explicit
+ * fetch fails, the implicit fetch is used.
+ */
+static EVP_MD *esdm_openssl_md = NULL;
+
+static const EVP_MD *esdm_openssl_hash_md(void)
+{
+	EVP_MD *md = __atomic_load_n(&esdm_openssl_md, __ATOMIC_ACQUIRE);
+	EVP_MD *prev = NULL;
+
+	if (md)
+		return md;
+
+	md = EVP_MD_fetch(NULL, "SHA3-512", NULL);
+	if (!md)
+		return EVP_sha3_512();
+
+	if (!__atomic_compare_exchange_n(&esdm_openssl_md, &prev, md, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		EVP_MD_free(md);
+		md = prev;
+	}
+
+	return md;
+}
 
 static uint32_t esdm_openssl_hash_digestsize(void *hash)
 {
 	(void)hash;
-	return (uint32_t)EVP_MD_size(ESDM_OPENSSL_HASH);
+	return (uint32_t)EVP_MD_size(esdm_openssl_hash_md());
 }
 
 static int esdm_openssl_hash_init(void *hash)
 {
 	EVP_MD_CTX *ctx = hash;
-	int ret = EVP_DigestInit(ctx, ESDM_OPENSSL_HASH);
+	int ret = EVP_DigestInit_ex2(ctx, esdm_openssl_hash_md(), NULL);
 
 	if (ret != 1) {
 		esdm_logger(LOGGER_ERR, LOGGER_C_MD,
-			    "EVP_DigestInit() failed %s\n",
+			    "EVP_DigestInit_ex2() failed %s\n",
 			    ERR_error_string(ERR_get_error(), NULL));
 		return -EFAULT;
 	}
@@ -74,11 +100,12 @@ static int esdm_openssl_hash_final(void *hash, uint8_t *digest)
 {
 	EVP_MD_CTX *ctx = hash;
 	unsigned int maclen = 0;
-	int ret = EVP_DigestFinal(ctx, digest, &maclen);
+	/* Keep the digest state allocated for the next hash_init */
+	int ret = EVP_DigestFinal_ex(ctx, digest, &maclen);
 
 	if (ret != 1) {
 		esdm_logger(LOGGER_ERR, LOGGER_C_MD,
-			    "EVP_DigestFinal() failed %s\n",
+			    "EVP_DigestFinal_ex() failed %s\n",
 			    ERR_error_string(ERR_get_error(), NULL));
 		return -EFAULT;
 	}
@@ -112,9 +139,13 @@ static const char *esdm_openssl_hash_name(void)
 	return "OpenSSL SHA3-512";
 }
 
+/* Reinitialization wipes the digest state without releasing it */
 static void esdm_openssl_hash_desc_zero(void *hash)
 {
-	(void)hash;
+	EVP_MD_CTX *ctx = hash;
+
+	if (ctx && EVP_MD_CTX_get0_md(ctx))
+		EVP_DigestInit_ex2(ctx, NULL, NULL);
 }
 
 static int esdm_openssl_hash_selftest(void)
@@ -158,6 +189,32 @@ const struct esdm_hash_cb esdm_openssl_hash_cb = {
 	.hash_dealloc = esdm_openssl_hash_dealloc,
 };
 
+/* The DRBG implementations are fetched once like the message digest */
+static EVP_RAND *esdm_openssl_seed_rand = NULL;
+static EVP_RAND *esdm_openssl_drbg_rand = NULL;
+
+static EVP_RAND *esdm_openssl_rand(EVP_RAND **cache, const char *name,
+				   const char *properties)
+{
+	EVP_RAND *rand = __atomic_load_n(cache, __ATOMIC_ACQUIRE);
+	EVP_RAND *prev = NULL;
+
+	if (rand)
+		return rand;
+
+	rand = EVP_RAND_fetch(NULL, name, properties);
+	if (!rand)
+		return NULL;
+
+	if (!__atomic_compare_exchange_n(cache, &prev, rand, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		EVP_RAND_free(rand);
+		rand = prev;
+	}
+
+	return rand;
+}
+
 struct esdm_openssl_drng_state {
 	EVP_RAND_CTX *drbg, *seed_source;
 	unsigned int strength;
@@ -249,10 +306,12 @@ esdm_openssl_drbg_dealloc_internal(struct esdm_openssl_drng_state *state)
 
 static int esdm_openssl_drbg_alloc(void **drng, uint32_t sec_strength)
 {
-	OSSL_PARAM params[3];
+	OSSL_PARAM params[5];
 	struct esdm_openssl_drng_state *state =
 		calloc(1, sizeof(struct esdm_openssl_drng_state));
-	EVP_RAND *rand = NULL;
+	EVP_RAND *rand;
+	unsigned int reseed_requests = 0;
+	time_t reseed_time = 0;
 	int df = 1;
 	int ret = 0;
 
@@ -263,13 +322,11 @@ static int esdm_openssl_drbg_alloc(void **drng, uint32_t sec_strength)
 
 	state->strength = 256;
 
-	rand = EVP_RAND_fetch(NULL, "TEST-RAND", "-fips");
+	rand = esdm_openssl_rand(&esdm_openssl_seed_rand, "TEST-RAND", "-fips");
 	CKNULL(rand, -ENOMEM);
 
 	state->seed_source = EVP_RAND_CTX_new(rand, NULL);
 	CKNULL(state->seed_source, -ENOMEM);
-	EVP_RAND_free(rand);
-	rand = NULL;
 
 	params[0] = OSSL_PARAM_construct_uint(OSSL_RAND_PARAM_STRENGTH,
 					      &state->strength);
@@ -279,16 +336,25 @@ static int esdm_openssl_drbg_alloc(void **drng, uint32_t sec_strength)
 		goto out;
 	}
 
-	rand = EVP_RAND_fetch(NULL, "HASH-DRBG", NULL);
+	rand = esdm_openssl_rand(&esdm_openssl_drbg_rand, "HASH-DRBG", NULL);
 	CKNULL(rand, -ENOMEM);
 	state->drbg = EVP_RAND_CTX_new(rand, state->seed_source);
 	CKNULL(state->drbg, -ENOMEM);
 	state->strength = EVP_RAND_get_strength(state->drbg);
 
+	/*
+	 * The ESDM governs the reseeding: the DRBG shall neither track its own
+	 * reseed limits for every request nor reseed from the seed source
+	 * which only holds the last seed provided by the ESDM.
+	 */
 	params[0] = OSSL_PARAM_construct_int(OSSL_DRBG_PARAM_USE_DF, &df);
 	params[1] = OSSL_PARAM_construct_utf8_string(OSSL_DRBG_PARAM_DIGEST,
 						     "SHA512", 6);
-	params[2] = OSSL_PARAM_construct_end();
+	params[2] = OSSL_PARAM_construct_uint(OSSL_DRBG_PARAM_RESEED_REQUESTS,
+					      &reseed_requests);
+	params[3] = OSSL_PARAM_construct_time_t(
+		OSSL_DRBG_PARAM_RESEED_TIME_INTERVAL, &reseed_time);
+	params[4] = OSSL_PARAM_construct_end();
 	if (!EVP_RAND_CTX_set_params(state->drbg, params)) {
 		ret = -EFAULT;
 		goto out;
@@ -298,8 +364,6 @@ static int esdm_openssl_drbg_alloc(void **drng, uint32_t sec_strength)
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY, "DRBG core allocated\n");
 
 out:
-	if (rand)
-		EVP_RAND_free(rand);
 	if (ret)
 		esdm_openssl_drbg_dealloc_internal(state);
 
@@ -0,0 +1,170 @@
+/* Persistent seed file
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esdm.h"
+#include "esdm_config.h"
+#include "esdm_definitions.h"
+#include "esdm_es_mgr_cb.h"
+#include "esdm_logger.h"
+#include "esdm_seed_file.h"
+#include "memset_secure.h"
+#include "visibility.h"
+
+static int esdm_seed_file_fd = -1;
+
+/* Open the seed file and ensure that it is not accessible by others */
+static int esdm_seed_file_open(const char *path)
+{
+	struct stat sb;
+	int fd, ret = 0;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW,
+		  S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		ret = -errno;
+		esdm_logger(LOGGER_WARN, LOGGER_C_ANY,
+			    "Cannot open seed file %s: %s\n", path,
+			    strerror(errno));
+		return ret;
+	}
+
+	if (fstat(fd, &sb)) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (!S_ISREG(sb.st_mode) || sb.st_uid != geteuid() ||
+	    (sb.st_mode & (S_IRWXG | S_IRWXO))) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_ANY,
+			    "Seed file %s is not a regular file only accessible by its owner, ignoring it\n",
+			    path);
+		ret = -EPERM;
+	}
+
+out:
+	if (ret) {
+		close(fd);
+		return ret;
+	}
+	return fd;
+}
+
+/*
+ * Replace the content of the seed file. Seed material is only stored if the
+ * ESDM is fully seeded, otherwise the seed file is emptied to never use its
+ * previous content again.
+ */
+static void esdm_seed_file_write(void)
+{
+	uint8_t seed[ESDM_SEED_FILE_BYTES];
+	size_t len = sizeof(seed);
+
+	if (esdm_get_random_bytes_full_noblock(seed, sizeof(seed)) !=
+	    (ssize_t)sizeof(seed)) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+			    "ESDM not fully seeded, seed file emptied\n");
+		len = 0;
+	}
+
+	if ((len && pwrite(esdm_seed_file_fd, seed, len, 0) != (ssize_t)len) ||
+	    ftruncate(esdm_seed_file_fd, (off_t)len) ||
+	    fdatasync(esdm_seed_file_fd)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_ANY,
+			    "Writing seed file failed: %s\n", strerror(errno));
+	}
+
+	memset_secure(seed, 0, sizeof(seed));
+}
+
+void esdm_seed_file_init(void)
+{
+	uint8_t seed[ESDM_SEED_FILE_BYTES];
+	const char *path = esdm_config_seed_file();
+	uint32_t credit = 0;
+	ssize_t len;
+	int fd;
+
+	if (!path || !path[0] || esdm_seed_file_fd >= 0)
+		return;
+
+	fd = esdm_seed_file_open(path);
+	if (fd < 0)
+		return;
+	esdm_seed_file_fd = fd;
+
+	len = pread(fd, seed, sizeof(seed), 0);
+	if (len != (ssize_t)sizeof(seed)) {
+		/* A new or truncated seed file does not hold seed material */
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+			    "Seed file %s does not contain seed material\n",
+			    path);
+		goto rotate;
+	}
+
+	/* Policy: never credit entropy in FIPS or SP800-90C mode */
+	if (esdm_config_seed_file_credit() &&
+	    !esdm_config_sp80090c_compliant())
+		credit = ESDM_DRNG_SECURITY_STRENGTH_BITS;
+
+	if (esdm_pool_insert_aux(seed, sizeof(seed), credit)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_ANY,
+			    "Inserting content of seed file %s failed\n", path);
+		goto rotate;
+	}
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_ANY,
+		    "Seed file %s inserted with %u bits of entropy\n", path,
+		    credit);
+
+	/* Mix the seed into the DRNGs before the seed file is rotated */
+	if (credit)
+		esdm_es_add_entropy();
+	esdm_drng_force_reseed();
+
+rotate:
+	memset_secure(seed, 0, sizeof(seed));
+	esdm_seed_file_write();
+}
+
+DSO_PUBLIC
+void esdm_seed_file_release(void)
+{
+	if (esdm_seed_file_fd < 0)
+		return;
+
+	close(esdm_seed_file_fd);
+	esdm_seed_file_fd = -1;
+}
+
+void esdm_seed_file_fini(void)
+{
+	if (esdm_seed_file_fd < 0)
+		return;
+
+	esdm_seed_file_write();
+	esdm_seed_file_release();
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#ifndef _ESDM_SEED_FILE_H
+#define _ESDM_SEED_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Size of the seed file: twice the security strength of the DRNG, the content
+ * is credited with at most ESDM_DRNG_SECURITY_STRENGTH_BITS.
+ */
+#define ESDM_SEED_FILE_BYTES 64
+
+/*
+ * Open the seed file configured with esdm_config_seed_file_set, insert its
+ * content into the auxiliary pool and rotate it. The file descriptor is kept
+ * open to allow writing the seed file after the privileges are dropped.
+ */
+void esdm_seed_file_init(void);
+
+/* Write new seed material to the seed file and close it */
+void esdm_seed_file_fini(void);
+
+/*
+ * Close the seed file without writing it. A process which forked the process
+ * continuing to serve random numbers must relinquish the seed file as its DRNG
+ * states are a copy of the states of the child.
+ */
+void esdm_seed_file_release(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESDM_SEED_FILE_H */
@@ -26,16 +26,22 @@
 #include <stdint.h>
 #include <string.h>
 #include <sys/shm.h>
+#include <time.h>
 
+#include "atomic_64.h"
 #include "esdm.h"
 #include "esdm_config.h"
+#include "esdm_drng_mgr.h"
 #include "esdm_es_mgr.h"
 #include "esdm_interface_dev_common.h"
 #include "esdm_rpc_server.h"
 #include "esdm_rpc_service.h"
+#include "esdm_shm_event.h"
 #include "esdm_shm_status.h"
 #include "helper.h"
 #include "esdm_logger.h"
+#include "mutex_w.h"
+#include "queue.h"
 #include "ret_checkers.h"
 
 static struct esdm_shm_status *esdm_shm_status = NULL;
@@ -72,10 +78,25 @@ static void _esdm_shm_status_up(sem_t *sem)
 
 static void esdm_shm_status_up(void)
 {
+	if (esdm_shm_status)
+		esdm_shm_event_signal(&esdm_shm_status->status_event);
+
 	_esdm_shm_status_up(esdm_semid_random);
 	_esdm_shm_status_up(esdm_semid_urandom);
 }
 
+static void esdm_shm_status_seed_up(void)
+{
+	if (esdm_shm_status)
+		esdm_shm_event_signal(&esdm_shm_status->seed_event);
+}
+
+static void esdm_shm_status_need_entropy_up(void)
+{
+	if (esdm_shm_status)
+		esdm_shm_event_signal(&esdm_shm_status->need_entropy_event);
+}
+
 /*
  * NOTE:
  * This function wakes up all potential waiters on any semaphore. When adding
@@ -86,42 +107,258 @@ static void esdm_shm_status_up(void)
 static void esdm_shm_wake_all(void)
 {
 	esdm_shm_status_up();
+	esdm_shm_status_seed_up();
+	esdm_shm_status_need_entropy_up();
 	_esdm_shm_status_up(esdm_semid_need_entropy_level);
 }
 
+/*
+ * Implement a kind of level-triggered semaphore - i.e. it fires as long as
+ * entropy is required.
+ */
+static void esdm_shm_status_need_entropy_level_up(void)
+{
+	if (atomic_bool_read(&esdm_shm_status->need_entropy))
+		_esdm_shm_status_up(esdm_semid_need_entropy_level);
+}
+
+/*
+ * The status text is expensive to generate and rarely read. It is generated
+ * at startup and regenerated lazily by the ES monitor after the operational
+ * state changed, as the state change may be signaled with locks held.
+ */
+static atomic_bool_t esdm_shm_status_info_stale = ATOMIC_BOOL_INIT(false);
+
+static void esdm_shm_status_set_info(void)
+{
+	static DEFINE_MUTEX_W_UNLOCKED(esdm_shm_status_info_lock);
+	struct esdm_shm_status *status = esdm_shm_status;
+	char info[ESDM_SHM_STATUS_INFO_SIZE];
+
+	if (!status)
+		return;
+
+	esdm_status(info, sizeof(info));
+
+	mutex_w_lock(&esdm_shm_status_info_lock);
+	/* Odd version: update in progress */
+	atomic_inc(&status->info_version);
+	memcpy(status->info, info, sizeof(status->info));
+	status->infolen = strlen(status->info);
+	atomic_inc(&status->info_version);
+	mutex_w_unlock(&esdm_shm_status_info_lock);
+}
+
+static DEFINE_MUTEX_W_UNLOCKED(esdm_shm_status_seed_lock);
+
+static void esdm_shm_status_write_seed_values(uint32_t seed_state,
+					      uint32_t ent_lvl)
+{
+	struct esdm_shm_status *status = esdm_shm_status;
+
+	bool changed;
+
+	mutex_w_lock(&esdm_shm_status_seed_lock);
+	changed = status->seed_state != seed_state;
+	if (changed || status->ent_lvl != ent_lvl) {
+		/* Odd version: update in progress */
+		atomic_inc(&status->seed_version);
+		status->seed_state = seed_state;
+		status->ent_lvl = ent_lvl;
+		atomic_inc(&status->seed_version);
+	}
+	mutex_w_unlock(&esdm_shm_status_seed_lock);
+
+	/* Waiters for a seed state are not woken by entropy level changes */
+	if (changed)
+		esdm_shm_status_seed_up();
+}
+
+static void (*esdm_shm_status_seed_notify)(void) = NULL;
+static atomic_t esdm_shm_status_seed_last = ATOMIC_INIT(0);
+
+void esdm_shm_status_seed_notifier(void (*notify)(void))
+{
+	esdm_shm_status_seed_notify = notify;
+}
+
+uint32_t esdm_shm_status_seed_state(void)
+{
+	uint32_t seed_state = ESDM_SHM_SEED_VALID;
+
+	/* The min seeded flag is only set after the fully seeded flag */
+	if (esdm_state_min_seeded() || esdm_state_fully_seeded())
+		seed_state |= ESDM_SHM_SEED_MIN_SEEDED;
+	if (esdm_state_fully_seeded())
+		seed_state |= ESDM_SHM_SEED_FULLY_SEEDED;
+	if (esdm_pool_all_nodes_seeded_get())
+		seed_state |= ESDM_SHM_SEED_ALL_NODES_SEEDED;
+	if (esdm_state_operational())
+		seed_state |= ESDM_SHM_SEED_OPERATIONAL;
+
+	return seed_state;
+}
+
+static bool esdm_shm_status_seed_reached(uint32_t states)
+{
+	return (esdm_shm_status_seed_state() & states) == states;
+}
+
+int esdm_shm_status_seed_wait(uint32_t states, struct timespec *ts)
+{
+	int ret = 0;
+
+	thread_timedwait_event(&esdm_init_wait,
+			       esdm_shm_status_seed_reached(states), ts);
+
+	return esdm_shm_status_seed_reached(states) ? 0 : -ETIMEDOUT;
+}
+
+/*
+ * Publish the seed state and the entropy level. The seed_version is only
+ * changed when a value changes. The seed state notifier is informed even
+ * without a status segment.
+ */
+void esdm_shm_status_set_seed_values(void)
+{
+	uint32_t seed_state = esdm_shm_status_seed_state();
+
+	if ((uint32_t)atomic_xchg(&esdm_shm_status_seed_last,
+				  (int)seed_state) != seed_state &&
+	    esdm_shm_status_seed_notify)
+		esdm_shm_status_seed_notify();
+
+	if (!esdm_shm_status)
+		return;
+
+	esdm_shm_status_write_seed_values(seed_state, esdm_avail_entropy());
+}
+
 void esdm_shm_status_set_operational(bool enabled)
 {
 	if (!esdm_shm_status)
 		return;
 
+	esdm_shm_status_set_seed_values();
+
 	if (atomic_bool_read(&esdm_shm_status->operational) != enabled) {
 		atomic_bool_set(&esdm_shm_status->operational, enabled);
 		esdm_shm_status_up();
+		atomic_bool_set(&esdm_shm_status_info_stale, true);
 	}
 }
 
+void esdm_shm_status_refresh(void)
+{
+	esdm_shm_status_set_seed_values();
+
+	/* Catch up on an update suppressed within the need entropy window */
+	if (esdm_shm_status)
+		esdm_shm_status_need_entropy_level_up();
+
+	if (atomic_bool_cmpxchg(&esdm_shm_status_info_stale, true, false))
+		esdm_shm_status_set_info();
+}
+
+/*
+ * Publish the values of the /proc/sys/kernel/random files. The proc_version
+ * is only changed when a value changes, allowing readers to cache them.
+ */
+void esdm_shm_status_set_proc_values(void)
+{
+	static DEFINE_MUTEX_W_UNLOCKED(esdm_shm_status_proc_lock);
+	struct esdm_shm_status *status = esdm_shm_status;
+	uint32_t entropy_avail, poolsize, write_wakeup_thresh, min_reseed_secs;
+
+	if (!status)
+		return;
+
+	entropy_avail = esdm_avail_entropy_aux();
+	poolsize = esdm_avail_poolsize_aux();
+	write_wakeup_thresh = esdm_get_write_wakeup_bits();
+	min_reseed_secs = esdm_get_reseed_max_time();
+
+	mutex_w_lock(&esdm_shm_status_proc_lock);
+	if (status->entropy_avail != entropy_avail ||
+	    status->poolsize != poolsize ||
+	    status->write_wakeup_thresh != write_wakeup_thresh ||
+	    status->min_reseed_secs != min_reseed_secs) {
+		/* Odd version: update in progress */
+		atomic_inc(&status->proc_version);
+		status->entropy_avail = entropy_avail;
+		status->poolsize = poolsize;
+		status->write_wakeup_thresh = write_wakeup_thresh;
+		status->min_reseed_secs = min_reseed_secs;
+		atomic_inc(&status->proc_version);
+	}
+	mutex_w_unlock(&esdm_shm_status_proc_lock);
+}
+
+/*
+ * The need entropy state is evaluated with every insertion into the aux pool.
+ * A transition of the need entropy flag is published right away and wakes
+ * the waiters once (edge-triggered). Without a transition, the entropy level
+ * and the level-triggered semaphore are only updated once per
+ * ESDM_SHM_STATUS_NEED_ENTROPY_WINDOW_NS, i.e. a burst of insertions results
+ * in one update. The ES monitor publishes the final state with
+ * esdm_shm_status_refresh.
+ */
+#define ESDM_SHM_STATUS_NEED_ENTROPY_WINDOW_NS 10000000ULL
+
+static atomic_64_t esdm_shm_status_need_entropy_last = ATOMIC_64_INIT(0);
+
+static uint64_t esdm_shm_status_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 void esdm_shm_status_set_need_entropy(void)
 {
+	uint64_t now, last;
 	bool new, curr;
 
 	if (!esdm_shm_status)
 		return;
 
 	curr = atomic_bool_read(&esdm_shm_status->need_entropy);
-
 	new = esdm_need_entropy();
+	now = esdm_shm_status_now_ns();
+
+	if (curr != new) {
+		/* Only one caller publishes the transition */
+		if (!atomic_bool_cmpxchg(&esdm_shm_status->need_entropy, curr,
+					 new))
+			return;
+	} else {
+		last = (uint64_t)atomic_read_64(
+			&esdm_shm_status_need_entropy_last);
+		if (now - last < ESDM_SHM_STATUS_NEED_ENTROPY_WINDOW_NS)
+			return;
+	}
+	atomic_set_64(&esdm_shm_status_need_entropy_last, (long long)now);
+
+	/* The entropy level changed */
+	esdm_shm_status_set_proc_values();
+	esdm_shm_status_set_seed_values();
 
 	if (curr != new) {
-		atomic_bool_set(&esdm_shm_status->need_entropy, new);
 		esdm_shm_status_up();
+		if (new)
+			esdm_shm_status_need_entropy_up();
 	}
 
-	/*
-	 * Implement a kind of level-triggered semaphore - i.e. it fires
-	 * as long as entropy is required.
-	 */
-	if (new)
-		_esdm_shm_status_up(esdm_semid_need_entropy_level);
+	esdm_shm_status_need_entropy_level_up();
+}
+
+void esdm_shm_status_new_generation(void)
+{
+	if (!esdm_shm_status)
+		return;
+
+	atomic_inc_64(&esdm_shm_status->rng_generation);
 }
 
 static void esdm_shm_status_set_suspend(void)
@@ -131,12 +368,19 @@ static void esdm_shm_status_set_suspend(void)
 
 	atomic_bool_set(&esdm_shm_status->suspend_trigger, true);
 
+	/* Client-side DRNGs must not continue with their state after resume */
+	esdm_shm_status_new_generation();
+
 	/* Wake up all waiters */
 	esdm_shm_wake_all();
 }
 
 static void esdm_shm_status_server_exit(void)
 {
+	/* Clients must not answer from the seed state of a stopped server */
+	if (esdm_shm_status)
+		esdm_shm_status_write_seed_values(0, 0);
+
 	/* The exit notification is the same as the suspend notification */
 	esdm_shm_status_set_suspend();
 }
@@ -146,6 +390,7 @@ static void esdm_shm_status_signal_suspend(int sig)
 	(void)sig;
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_SERVER, "Suspend signal received\n");
 
+	esdm_drng_suspend();
 	esdm_shm_status_set_suspend();
 }
 
@@ -312,8 +557,15 @@ static int esdm_shm_status_create_shm(void)
 
 int esdm_shm_status_init(void)
 {
-	int ret = esdm_shm_status_create_shm();
+	int ret;
+
+	/* The ESDM server seeding the shards publishes the status */
+	if (esdm_config_shards()) {
+		esdm_shm_status_install_signal_suspend();
+		return 0;
+	}
 
+	ret = esdm_shm_status_create_shm();
 	if (ret)
 		return ret;
 
@@ -338,15 +590,21 @@ int esdm_shm_status_init(void)
 		return ret;
 	}
 
-	esdm_status(esdm_shm_status->info, sizeof(esdm_shm_status->info));
-	esdm_shm_status->infolen = strlen(esdm_shm_status->info);
+	esdm_shm_status_set_info();
 	esdm_shm_status->unpriv_threads = esdm_config_online_nodes();
+	esdm_shm_status_set_proc_values();
 
 	esdm_shm_status_set_operational(esdm_state_operational());
 	esdm_shm_status_set_need_entropy();
 	esdm_shm_status_install_signal_suspend();
 	atomic_bool_set(&esdm_shm_status->suspend_trigger, false);
 
+	/*
+	 * The segment may survive a restart of the server, the DRNG states of
+	 * the new server instance start a new generation.
+	 */
+	esdm_shm_status_new_generation();
+
 	return 0;
 }
 
@@ -20,6 +20,9 @@
 #ifndef ESDM_SHM_STATUS_H
 #define ESDM_SHM_STATUS_H
 
+#include <stdint.h>
+#include <time.h>
+
 #include "bool.h"
 
 #ifdef __cplusplus
@@ -28,6 +31,29 @@ extern "C" {
 
 void esdm_shm_status_set_operational(bool enabled);
 void esdm_shm_status_set_need_entropy(void);
+void esdm_shm_status_new_generation(void);
+void esdm_shm_status_set_proc_values(void);
+void esdm_shm_status_set_seed_values(void);
+void esdm_shm_status_refresh(void);
+
+/*
+ * Current seed state as ESDM_SHM_SEED_* flags, independent of the presence of
+ * the status segment.
+ */
+uint32_t esdm_shm_status_seed_state(void);
+
+/*
+ * Block the calling thread until all ESDM_SHM_SEED_* flags given with states
+ * are set or the timeout expired. Returns 0 or -ETIMEDOUT.
+ */
+int esdm_shm_status_seed_wait(uint32_t states, struct timespec *ts);
+
+/*
+ * Register a callback invoked after every change of the seed state. The
+ * callback may be invoked with locks held and therefore must not block or
+ * call into the ESDM.
+ */
+void esdm_shm_status_seed_notifier(void (*notify)(void));
 
 int esdm_shm_status_init(void);
 void esdm_shm_status_exit(void);
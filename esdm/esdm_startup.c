@@ -0,0 +1,233 @@
+/* Startup phase timing
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bool.h"
+#include "esdm_es_mgr.h"
+#include "esdm_startup.h"
+#include "math_helper.h"
+#include "visibility.h"
+
+struct esdm_startup_time {
+	uint64_t begin;
+	uint64_t end;
+};
+
+static struct esdm_startup_time esdm_startup_phases[esdm_startup_last];
+static struct esdm_startup_time esdm_startup_es[esdm_ext_es_last];
+
+static const char *esdm_startup_names[esdm_startup_last] = {
+	[esdm_startup_fips_integrity] = "FIPS integrity check",
+	[esdm_startup_esdm_init] = "ESDM initialization",
+	[esdm_startup_config] = " configuration",
+	[esdm_startup_drng_mgr] = " DRNG manager",
+	[esdm_startup_selftest] = " crypto self tests",
+	[esdm_startup_es_mgr] = " ES manager",
+	[esdm_startup_initial_seed] = "  initial seeding of DRNGs",
+	[esdm_startup_nodes] = " DRNG node allocation",
+	[esdm_startup_shm_status] = " status shared memory",
+	[esdm_startup_rpc_server] = "RPC server initialization",
+	[esdm_startup_drop_privileges] = " privilege drop",
+	[esdm_startup_min_seeded] = "minimally seeded",
+	[esdm_startup_fully_seeded] = "fully seeded",
+	[esdm_startup_all_nodes_seeded] = "all DRNG nodes seeded",
+};
+
+uint64_t esdm_startup_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_BOOTTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void esdm_startup_set(uint64_t *val, uint64_t ns)
+{
+	uint64_t unset = 0;
+
+	__atomic_compare_exchange_n(val, &unset, ns, false, __ATOMIC_RELAXED,
+				    __ATOMIC_RELAXED);
+}
+
+DSO_PUBLIC
+void esdm_startup_begin(enum esdm_startup_phase phase)
+{
+	if (phase >= esdm_startup_last)
+		return;
+
+	esdm_startup_set(&esdm_startup_phases[phase].begin,
+			 esdm_startup_now());
+}
+
+DSO_PUBLIC
+void esdm_startup_end(enum esdm_startup_phase phase)
+{
+	if (phase >= esdm_startup_last ||
+	    !__atomic_load_n(&esdm_startup_phases[phase].begin,
+			     __ATOMIC_RELAXED))
+		return;
+
+	esdm_startup_set(&esdm_startup_phases[phase].end, esdm_startup_now());
+}
+
+void esdm_startup_event(enum esdm_startup_phase phase)
+{
+	uint64_t now = esdm_startup_now();
+
+	if (phase >= esdm_startup_last)
+		return;
+
+	esdm_startup_set(&esdm_startup_phases[phase].begin, now);
+	esdm_startup_set(&esdm_startup_phases[phase].end, now);
+}
+
+void esdm_startup_es_init(unsigned int es, uint64_t begin_ns)
+{
+	if (es >= esdm_ext_es_last)
+		return;
+
+	esdm_startup_set(&esdm_startup_es[es].begin, begin_ns);
+	esdm_startup_set(&esdm_startup_es[es].end, esdm_startup_now());
+}
+
+/*
+ * Start of the process in nanoseconds since boot as recorded by the kernel,
+ * i.e. including the time spent in the dynamic loader and the constructors.
+ */
+static uint64_t esdm_startup_process_start(void)
+{
+	static uint64_t start = 0;
+	unsigned long long ticks;
+	char buf[1024], *p;
+	unsigned int field;
+	long hz;
+	FILE *f;
+
+	if (start)
+		return start;
+
+	f = fopen("/proc/self/stat", "r");
+	if (!f)
+		return 0;
+	p = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (!p)
+		return 0;
+
+	/* The process name may contain spaces, start after it */
+	p = strrchr(buf, ')');
+	if (!p)
+		return 0;
+
+	/* The start time is the 20th field after the process name */
+	for (field = 0; field < 20 && p; field++)
+		p = strchr(p + 1, ' ');
+	hz = sysconf(_SC_CLK_TCK);
+	if (!p || hz <= 0 || sscanf(p, "%llu", &ticks) != 1)
+		return 0;
+
+	start = (uint64_t)ticks * (1000000000ULL / (uint64_t)hz);
+	return start;
+}
+
+static size_t esdm_startup_line(char *buf, size_t buflen, const char *name,
+				const struct esdm_startup_time *t,
+				uint64_t start)
+{
+	uint64_t begin = __atomic_load_n(&t->begin, __ATOMIC_RELAXED),
+		 end = __atomic_load_n(&t->end, __ATOMIC_RELAXED);
+	int ret;
+
+	if (!begin || !end || !buflen)
+		return 0;
+
+	ret = snprintf(buf, buflen, " %s: %.3f ms (started at %.3f ms)\n",
+		       name, (double)(end - begin) / 1e6,
+		       begin > start ? (double)(begin - start) / 1e6 : 0.0);
+	if (ret < 0)
+		return 0;
+
+	return ((size_t)ret < buflen) ? (size_t)ret : buflen - 1;
+}
+
+DSO_PUBLIC
+void esdm_startup_status(char *buf, size_t buflen)
+{
+	uint64_t start = esdm_startup_process_start(), end;
+	size_t len;
+	unsigned int i, es;
+	char name[64];
+	int ret;
+
+	if (!buf || !buflen)
+		return;
+
+	/* Without the process start, report relative to the first phase */
+	if (!start) {
+		start = UINT64_MAX;
+		for (i = 0; i < esdm_startup_last; i++) {
+			end = esdm_startup_phases[i].begin;
+			if (end && end < start)
+				start = end;
+		}
+	}
+
+	ret = snprintf(buf, buflen, "Startup phases:\n");
+	len = (ret < 0) ? 0 : min_size((size_t)ret, buflen - 1);
+
+	for (i = 0; i < esdm_startup_min_seeded; i++) {
+		len += esdm_startup_line(buf + len, buflen - len,
+					 esdm_startup_names[i],
+					 &esdm_startup_phases[i], start);
+
+		/* The ES are initialized as part of the ES manager */
+		if (i != esdm_startup_es_mgr)
+			continue;
+
+		for (es = 0; es < esdm_ext_es_last; es++) {
+			snprintf(name, sizeof(name), "  ES %s",
+				 esdm_es[es]->name);
+			len += esdm_startup_line(buf + len, buflen - len, name,
+						 &esdm_startup_es[es], start);
+		}
+	}
+
+	for (; i < esdm_startup_last; i++) {
+		end = __atomic_load_n(&esdm_startup_phases[i].end,
+				      __ATOMIC_RELAXED);
+		if (!end || buflen - len <= 1)
+			continue;
+
+		ret = snprintf(buf + len, buflen - len,
+			       " %s: after %.3f ms (%.3f ms since boot)\n",
+			       esdm_startup_names[i],
+			       end > start ? (double)(end - start) / 1e6 : 0.0,
+			       (double)end / 1e6);
+		if (ret > 0)
+			len += min_size((size_t)ret, buflen - len - 1);
+	}
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef _ESDM_STARTUP_H
+#define _ESDM_STARTUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Phases on the startup path of the ESDM. A phase covers the time between
+ * esdm_startup_begin and esdm_startup_end, a milestone is the point in time
+ * recorded with esdm_startup_event. Only the first completion of a phase or
+ * milestone is retained.
+ */
+enum esdm_startup_phase {
+	esdm_startup_fips_integrity,
+	esdm_startup_esdm_init,
+	esdm_startup_config,
+	esdm_startup_drng_mgr,
+	esdm_startup_selftest,
+	esdm_startup_es_mgr,
+	esdm_startup_initial_seed,
+	esdm_startup_nodes,
+	esdm_startup_shm_status,
+	esdm_startup_rpc_server,
+	esdm_startup_drop_privileges,
+	esdm_startup_min_seeded,
+	esdm_startup_fully_seeded,
+	esdm_startup_all_nodes_seeded,
+	esdm_startup_last /* This must be last entry */
+};
+
+void esdm_startup_begin(enum esdm_startup_phase phase);
+void esdm_startup_end(enum esdm_startup_phase phase);
+void esdm_startup_event(enum esdm_startup_phase phase);
+
+/* Duration of the initialization of the entropy source with index es */
+void esdm_startup_es_init(unsigned int es, uint64_t begin_ns);
+
+/* Current time in nanoseconds since boot */
+uint64_t esdm_startup_now(void);
+
+/**
+ * @brief Print the duration of the startup phases and the time until the
+ *	  milestones were reached
+ *
+ * All times are given relative to the start of the process, the milestones
+ * are also given relative to the boot of the system. Phases or milestones
+ * not yet reached are omitted.
+ *
+ * @param [out] buf Buffer the NUL-terminated report is written to
+ * @param [in] buflen Size of the buffer
+ */
+void esdm_startup_status(char *buf, size_t buflen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESDM_STARTUP_H */
@@ -24,6 +24,7 @@
 
 #include "constructor.h"
 #include "esdm_config.h"
+#include "esdm_startup.h"
 #include "fips.h"
 #include "lc_hmac.h"
 #include "lc_sha256.h"
@@ -80,9 +81,11 @@ static void fips_post(void)
 	if (ret)
 		exit(-ret);
 
+	esdm_startup_begin(esdm_startup_fips_integrity);
 	ret = fips_post_integrity(NULL);
 	if (ret)
 		exit(-ret);
+	esdm_startup_end(esdm_startup_fips_integrity);
 }
 
 bool fips_enabled(void)
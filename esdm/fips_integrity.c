@@ -152,6 +152,13 @@ static int mmap_file(const char *filename, uint8_t **memory, uint32_t *size)
 			ret = -ENOMEM;
 			goto out;
 		}
+
+		/*
+		 * The file is read once from the start to the end: let the
+		 * kernel read ahead aggressively while the HMAC is calculated.
+		 */
+		madvise(*memory, (size_t)sb.st_size, MADV_SEQUENTIAL);
+		madvise(*memory, (size_t)sb.st_size, MADV_WILLNEED);
 	}
 out:
 	close(fd);
@@ -165,6 +172,7 @@ static int process_checkfile(const char *checkfile, const char *targetfile)
 	int ret = 0, checked_any = 0;
 	uint32_t size = 0;
 	uint8_t *memblock = NULL;
+	uint8_t calculated[LC_SHA_MAX_SIZE_DIGEST];
 	int create_checkfile = 0;
 
 	/*
@@ -197,20 +205,19 @@ static int process_checkfile(const char *checkfile, const char *targetfile)
 	if (ret)
 		goto out;
 
+	/* The MAC of the file is compared with every line of the checkfile */
+	lc_hmac_init(hmac_ctx, (uint8_t *)fipscheck_hmackey,
+		     sizeof(fipscheck_hmackey) - 1);
+	lc_hmac_update(hmac_ctx, memblock, size);
+	lc_hmac_final(hmac_ctx, calculated);
+
 	if (create_checkfile) {
 		char *hexhash = NULL;
 		size_t hexhashlen = 0;
-		uint8_t calculated[LC_SHA_MAX_SIZE_DIGEST];
 		size_t written;
 
-		lc_hmac_init(hmac_ctx, (uint8_t *)fipscheck_hmackey,
-			     sizeof(fipscheck_hmackey) - 1);
-		lc_hmac_update(hmac_ctx, memblock, size);
-		lc_hmac_final(hmac_ctx, calculated);
-
 		ret = bin2hex_alloc(calculated, lc_hmac_macsize(hmac_ctx),
 				    &hexhash, &hexhashlen);
-		lc_hmac_zero(hmac_ctx);
 		if (ret)
 			goto out;
 
@@ -236,7 +243,6 @@ static int process_checkfile(const char *checkfile, const char *targetfile)
 		size_t hexhashlen = 0; // length of hash hex value
 		size_t linelen = strlen(buf);
 		size_t i;
-		unsigned char calculated[LC_SHA_MAX_SIZE_DIGEST];
 
 		if (linelen == 0)
 			break;
@@ -264,11 +270,6 @@ static int process_checkfile(const char *checkfile, const char *targetfile)
 		if (ret < 0)
 			goto out;
 
-		lc_hmac_init(hmac_ctx, (uint8_t *)fipscheck_hmackey,
-			     sizeof(fipscheck_hmackey) - 1);
-		lc_hmac_update(hmac_ctx, memblock, size);
-		lc_hmac_final(hmac_ctx, calculated);
-
 		if (lc_hmac_macsize(hmac_ctx) != binhashlen) {
 			fprintf(stderr, FIPS_INTEGRITY_LOGGER_PREFIX
 				"Calculated MAC length has unexpected length - integrity violation\n");
@@ -277,7 +278,7 @@ static int process_checkfile(const char *checkfile, const char *targetfile)
 			goto out;
 		}
 
-		if (memcmp(calculated, binhash, sizeof(calculated))) {
+		if (memcmp(calculated, binhash, binhashlen)) {
 			fprintf(stderr, FIPS_INTEGRITY_LOGGER_PREFIX
 				"Message mismatch - integrity violation\n");
 			free(binhash);
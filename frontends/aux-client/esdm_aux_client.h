@@ -21,6 +21,9 @@
 #define ESDM_AUX_CLIENT_H
 
 #include <semaphore.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,6 +56,11 @@ void esdm_aux_fini_wait_for_need_entropy(void);
  * The API is a wrapper around sem_clockwait([1]) including the purpose of the
  * @param ts as well as the return code and the errno.
  *
+ * On Linux, the call sleeps on the need entropy event of the shared memory
+ * status segment instead of the semaphore. It is only woken when the ESDM
+ * server starts to need entropy, the semantics of @param ts, the return code
+ * and the errno are retained.
+ *
  * @param [in] ts See [1]
  *
  * @return See [1]
@@ -61,6 +69,73 @@ void esdm_aux_fini_wait_for_need_entropy(void);
  */
 int esdm_aux_timedwait_for_need_entropy(struct timespec *ts);
 
+struct esdm_aux_feeder;
+
+/**
+ * @brief Allocate a feeder for a continuous stream of entropic data
+ *
+ * The feeder is intended for entropy sources delivering large amounts of data,
+ * e.g. hardware TRNGs. The data written to the feeder is collected into
+ * batches which are inserted into the auxiliary pool of the ESDM server with
+ * pipelined RPC requests. A batch is only sent when the ESDM server needs
+ * entropy, i.e. the feeder blocks the writer otherwise.
+ *
+ * The caller must have initialized the privileged RPC service with
+ * esdm_rpcc_init_priv_service and the semaphore with
+ * esdm_aux_init_wait_for_need_entropy. A feeder must not be used by multiple
+ * threads concurrently.
+ *
+ * @param [out] feeder Feeder allocated by the function
+ * @param [in] entropy_bits Entropy rate of the data: entropy_bits bits of
+ *			    entropy are contained in data_bits bits of data
+ * @param [in] data_bits See entropy_bits
+ * @param [in] batch_size Size of a batch in bytes, 0 selects the default
+ *			  which fills the RPC pipeline with full messages
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int esdm_aux_feeder_alloc(struct esdm_aux_feeder **feeder,
+			  uint32_t entropy_bits, uint32_t data_bits,
+			  size_t batch_size);
+
+/**
+ * @brief Release a feeder and zeroize the data not yet sent
+ *
+ * @param [in] feeder Feeder allocated with esdm_aux_feeder_alloc
+ */
+void esdm_aux_feeder_free(struct esdm_aux_feeder *feeder);
+
+/**
+ * @brief Write data of the entropy source to the feeder
+ *
+ * Whenever a batch is full, it is sent to the ESDM server. If the ESDM server
+ * does not need entropy, the call blocks until it does or the timeout
+ * expires.
+ *
+ * @param [in] feeder Feeder allocated with esdm_aux_feeder_alloc
+ * @param [in] buf Data of the entropy source
+ * @param [in] buflen Length of the data
+ * @param [in] ts Absolute timeout based on CLOCK_MONOTONIC as defined for
+ *		  esdm_aux_timedwait_for_need_entropy, NULL waits without limit
+ *
+ * @return: number of bytes consumed, < 0 on error if no byte was consumed
+ *	    (-ETIMEDOUT means the ESDM server did not need entropy within the
+ *	    timeout)
+ */
+ssize_t esdm_aux_feeder_write(struct esdm_aux_feeder *feeder,
+			      const uint8_t *buf, size_t buflen,
+			      struct timespec *ts);
+
+/**
+ * @brief Send the partially filled batch to the ESDM server
+ *
+ * @param [in] feeder Feeder allocated with esdm_aux_feeder_alloc
+ * @param [in] ts See esdm_aux_feeder_write
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int esdm_aux_feeder_flush(struct esdm_aux_feeder *feeder, struct timespec *ts);
+
 #ifdef __cplusplus
 }
 #endif
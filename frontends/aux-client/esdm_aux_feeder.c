@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "esdm_aux_client.h"
+#include "esdm_rpc_client.h"
+#include "esdm_rpc_service.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+/*
+ * Default batch: one submission fills the RPC pipeline with full messages
+ * which the ESDM server inserts into the auxiliary pool one at a time.
+ */
+#define ESDM_AUX_FEEDER_BATCH_SIZE                                             \
+	(ESDM_CLIENT_PIPELINE_DEPTH * ESDM_RPC_MAX_DATA)
+
+/* Upper bound of the batch keeping the entropy of one batch in 32 bits */
+#define ESDM_AUX_FEEDER_MAX_BATCH_SIZE (1UL << 26)
+
+struct esdm_aux_feeder {
+	/* Entropy rate of the data: entropy_bits per data_bits */
+	uint32_t entropy_bits;
+	uint32_t data_bits;
+
+	size_t batch_size;
+	size_t batch_len;
+	uint8_t *batch;
+};
+
+/*
+ * Backpressure: block until the ESDM server needs entropy. A NULL timeout
+ * waits without any limit.
+ */
+static int esdm_aux_feeder_wait(struct timespec *ts)
+{
+	struct timespec tmp;
+
+	if (ts) {
+		if (esdm_aux_timedwait_for_need_entropy(ts))
+			return -errno;
+		return 0;
+	}
+
+	for (;;) {
+		clock_gettime(CLOCK_MONOTONIC, &tmp);
+		tmp.tv_sec++;
+		if (!esdm_aux_timedwait_for_need_entropy(&tmp))
+			return 0;
+		if (errno != ETIMEDOUT && errno != EINTR)
+			return -errno;
+	}
+}
+
+/* Send the collected data as one batch */
+static int esdm_aux_feeder_submit(struct esdm_aux_feeder *feeder,
+				  struct timespec *ts)
+{
+	uint64_t entropy;
+	int ret;
+
+	if (!feeder->batch_len)
+		return 0;
+
+	CKINT(esdm_aux_feeder_wait(ts));
+
+	entropy = ((uint64_t)feeder->batch_len << 3) * feeder->entropy_bits /
+		  feeder->data_bits;
+	CKINT(esdm_rpcc_rnd_add_entropy(feeder->batch, feeder->batch_len,
+					(uint32_t)entropy));
+
+	memset_secure(feeder->batch, 0, feeder->batch_len);
+	feeder->batch_len = 0;
+
+out:
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_aux_feeder_alloc(struct esdm_aux_feeder **feeder,
+			  uint32_t entropy_bits, uint32_t data_bits,
+			  size_t batch_size)
+{
+	struct esdm_aux_feeder *f;
+	int ret = 0;
+
+	CKNULL(feeder, -EINVAL);
+	if (!data_bits || entropy_bits > data_bits ||
+	    batch_size > ESDM_AUX_FEEDER_MAX_BATCH_SIZE)
+		return -EINVAL;
+
+	if (!batch_size)
+		batch_size = ESDM_AUX_FEEDER_BATCH_SIZE;
+
+	f = calloc(1, sizeof(*f));
+	CKNULL(f, -ENOMEM);
+
+	f->batch = malloc(batch_size);
+	if (!f->batch) {
+		free(f);
+		return -ENOMEM;
+	}
+
+	f->entropy_bits = entropy_bits;
+	f->data_bits = data_bits;
+	f->batch_size = batch_size;
+	*feeder = f;
+
+out:
+	return ret;
+}
+
+DSO_PUBLIC
+void esdm_aux_feeder_free(struct esdm_aux_feeder *feeder)
+{
+	if (!feeder)
+		return;
+
+	memset_secure(feeder->batch, 0, feeder->batch_size);
+	free(feeder->batch);
+	free(feeder);
+}
+
+DSO_PUBLIC
+ssize_t esdm_aux_feeder_write(struct esdm_aux_feeder *feeder,
+			      const uint8_t *buf, size_t buflen,
+			      struct timespec *ts)
+{
+	size_t consumed = 0;
+	int ret = 0;
+
+	CKNULL(feeder, -EINVAL);
+	CKNULL(buf, -EINVAL);
+
+	for (;;) {
+		size_t todo;
+
+		/* A full batch is sent before more data is accepted */
+		if (feeder->batch_len == feeder->batch_size) {
+			ret = esdm_aux_feeder_submit(feeder, ts);
+			if (ret)
+				break;
+		}
+
+		if (consumed == buflen)
+			break;
+
+		todo = min_size(buflen - consumed,
+				feeder->batch_size - feeder->batch_len);
+		memcpy(feeder->batch + feeder->batch_len, buf + consumed,
+		       todo);
+		feeder->batch_len += todo;
+		consumed += todo;
+	}
+
+	/*
+	 * The data copied into a batch that could not be submitted is kept
+	 * for the next attempt - it is reported as consumed.
+	 */
+	if (consumed)
+		return (ssize_t)consumed;
+
+out:
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_aux_feeder_flush(struct esdm_aux_feeder *feeder, struct timespec *ts)
+{
+	if (!feeder)
+		return -EINVAL;
+
+	return esdm_aux_feeder_submit(feeder, ts);
+}
@@ -28,6 +28,7 @@
 #include "esdm_aux_client.h"
 #include "esdm_logger.h"
 #include "esdm_rpc_service.h"
+#include "esdm_shm_event.h"
 #include "ret_checkers.h"
 #include "visibility.h"
 
@@ -43,11 +44,14 @@ static int esdm_cuse_shm_status_avail(void)
 		   esdm_cuse_shm_status->version == ESDM_SHM_STATUS_VERSION);
 
 	if (ret && !initialized) {
+		char info[ESDM_SHM_STATUS_INFO_SIZE];
+
 		initialized = 1;
+		esdm_shm_status_info(esdm_cuse_shm_status, info, sizeof(info));
 		esdm_logger(
 			LOGGER_DEBUG, LOGGER_C_CUSE,
 			"A client started detected ESDM server with properties:\n%s\n",
-			esdm_cuse_shm_status->info);
+			info);
 	}
 
 	return ret;
@@ -140,6 +144,7 @@ static sem_t *esdm_semid_need_entropy_level = SEM_FAILED;
 static int esdm_cuse_shm_status_down(struct timespec *ts)
 {
 	struct timespec ts_init = { .tv_sec = 1, .tv_nsec = 0 };
+	int seen, ret;
 
 	if (esdm_semid_need_entropy_level == SEM_FAILED) {
 		esdm_logger(LOGGER_ERR, LOGGER_C_ANY, "Cannot use semaphore\n");
@@ -155,9 +160,20 @@ static int esdm_cuse_shm_status_down(struct timespec *ts)
 	 * If the ESDM server already indicates it needs entropy, return
 	 * immediately.
 	 */
+	seen = atomic_read(&esdm_cuse_shm_status->need_entropy_event);
 	if (atomic_bool_read(&esdm_cuse_shm_status->need_entropy))
 		return 0;
 
+	/* Only wake up when the ESDM starts to need entropy */
+	ret = esdm_shm_event_wait(&esdm_cuse_shm_status->need_entropy_event,
+				  seen, ts);
+	if (ret != -EOPNOTSUPP) {
+		if (!ret)
+			return 0;
+		errno = -ret;
+		return -1;
+	}
+
 	/*
 	 * sem_timedwait uses CLOCK_REALTIME, which is subject to
 	 * clock adjustments, use sem_clockwait instead here.
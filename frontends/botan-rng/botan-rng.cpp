@@ -17,6 +17,10 @@
  * DAMAGE.
  */
 
+#include <botan/chacha_rng.h>
+#include <memory>
+#include <unistd.h>
+
 #include "botan-rng.hpp"
 #include "esdm_rpc_client.h"
 #include "visibility.h"
@@ -24,9 +28,40 @@
 std::mutex ESDM_RNG::m_init_lock;
 std::size_t ESDM_RNG::m_ref_cnt = 0;
 
+// size of the seed obtained from ESDM for the ChaCha_RNG of a thread
+static constexpr size_t esdm_rng_derived_seed_size = 64;
+
+// maximum number of bytes generated by the ChaCha_RNG of a thread before it
+// obtains a new seed from ESDM
+static constexpr size_t esdm_rng_derived_max_bytes = 1 << 20;
+
+// state of the derived mode, shared by all ESDM_RNG instances of a thread
+// so that no lock is needed
+struct esdm_rng_derived_state {
+	std::unique_ptr<Botan::ChaCha_RNG> rng;
+
+	// seed was obtained for this process
+	pid_t pid = 0;
+
+	// generation of the ESDM DRNG state the seed was obtained from
+	uint64_t generation = 0;
+
+	// bytes generated since the last seed
+	size_t bytes = 0;
+};
+
+static thread_local esdm_rng_derived_state esdm_rng_derived;
+
 DSO_PUBLIC
 ESDM_RNG::ESDM_RNG(bool prediction_resistance)
+	: ESDM_RNG(prediction_resistance, false)
+{
+}
+
+DSO_PUBLIC
+ESDM_RNG::ESDM_RNG(bool prediction_resistance, bool derived)
 	: m_prediction_resistance(prediction_resistance)
+	, m_derived(derived && !prediction_resistance)
 {
 	std::lock_guard lg(m_init_lock);
 
@@ -57,6 +92,8 @@ std::string ESDM_RNG::name() const
 {
 	if (m_prediction_resistance) {
 		return "esdm_pr";
+	} else if (m_derived) {
+		return "esdm_derived";
 	} else {
 		return "esdm_full";
 	}
@@ -77,17 +114,62 @@ bool ESDM_RNG::accepts_input() const
 	return true;
 }
 
-// the ESDM RNG does not hold any state outside ESDM, that should be cleared
-// here
+// the direct mode does not hold any state outside ESDM, the derived mode
+// drops the ChaCha_RNG of the calling thread
 DSO_PUBLIC
 void ESDM_RNG::clear()
 {
+	if (m_derived)
+		esdm_rng_derived.rng.reset();
+}
+
+// the ChaCha_RNG of the thread obtains a new seed from ESDM when the ESDM
+// server announces a new generation of its DRNG state, after fork and after
+// esdm_rng_derived_max_bytes were generated
+void ESDM_RNG::fill_bytes_derived(std::span<uint8_t> out,
+				  std::span<const uint8_t> in)
+{
+	esdm_rng_derived_state &state = esdm_rng_derived;
+	uint64_t generation = esdm_rpcc_rng_generation();
+	pid_t pid = getpid();
+
+	if (!state.rng || state.pid != pid || state.generation != generation ||
+	    state.bytes + out.size() > esdm_rng_derived_max_bytes) {
+		Botan::secure_vector<uint8_t> seed(esdm_rng_derived_seed_size);
+		ssize_t ret = 0;
+
+		esdm_invoke(esdm_rpcc_get_random_bytes_full(seed.data(),
+							    seed.size()));
+		if (ret != static_cast<ssize_t>(seed.size())) {
+			state.rng.reset();
+			throw Botan::System_Error(
+				"Fetching seed from ESDM failed");
+		}
+
+		if (state.rng)
+			state.rng->initialize_with(seed);
+		else
+			state.rng = std::make_unique<Botan::ChaCha_RNG>(seed);
+
+		state.pid = pid;
+		state.generation = generation;
+		state.bytes = 0;
+	}
+
+	// additional input is mixed into the local state only
+	state.rng->randomize_with_input(out, in);
+	state.bytes += out.size();
 }
 
 DSO_PUBLIC
 void ESDM_RNG::fill_bytes_with_input(std::span<uint8_t> out,
 				     std::span<const uint8_t> in)
 {
+	if (m_derived) {
+		fill_bytes_derived(out, in);
+		return;
+	}
+
 	if (in.size() > 0) {
 		ssize_t ret = 0;
 		// we take additional input, but do not account entropy for it
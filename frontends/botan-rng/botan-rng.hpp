@@ -29,6 +29,11 @@ public:
 	// do not introduce multiple classes
 	ESDM_RNG(bool prediction_resistance);
 
+	// derived mode: random bytes and additional input are processed by a
+	// ChaCha_RNG per thread which is seeded from ESDM, the prediction
+	// resistance mode always uses the ESDM server directly
+	ESDM_RNG(bool prediction_resistance, bool derived);
+
 	~ESDM_RNG();
 
 	std::string name() const override;
@@ -44,8 +49,13 @@ protected:
 							   std::span<const uint8_t> in) override;
 
 private:
+	void fill_bytes_derived(std::span<uint8_t> out,
+				std::span<const uint8_t> in);
+
 	const bool m_prediction_resistance;
 
+	const bool m_derived;
+
 	// ESDM rpc client locks concurrent accesses, but initialization should be
 	// only done once
 	static std::mutex m_init_lock;
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include <cerrno>
+#include <mutex>
+#include <pthread.h>
+#include <system_error>
+
+#include "esdm-cpp.hpp"
+#include "esdm_rpc_client.h"
+#include "visibility.h"
+
+namespace esdm
+{
+
+namespace detail
+{
+DSO_PUBLIC std::atomic<unsigned int> fork_generation{ 0 };
+} // namespace detail
+
+namespace
+{
+
+// ESDM rpc client locks concurrent accesses, but initialization should be
+// only done once
+std::mutex service_lock;
+
+// counts the users of the unprivileged service in order to perform init and
+// fini on the first/last one
+std::size_t service_ref_cnt = 0;
+
+std::once_flag fork_once;
+
+void fork_child()
+{
+	detail::fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void service_get()
+{
+	std::lock_guard lg(service_lock);
+
+	std::call_once(fork_once,
+		       [] { pthread_atfork(nullptr, nullptr, fork_child); });
+
+	if (service_ref_cnt == 0) {
+		int ret = esdm_rpcc_init_unpriv_service(nullptr);
+
+		if (ret != 0) {
+			throw std::system_error(
+				-ret, std::generic_category(),
+				"unable to initialize ESDM unprivileged service");
+		}
+	}
+	++service_ref_cnt;
+}
+
+void service_put()
+{
+	std::lock_guard lg(service_lock);
+
+	if (service_ref_cnt == 1)
+		esdm_rpcc_fini_unpriv_service();
+	--service_ref_cnt;
+}
+
+// keeps the service available for the free functions until exit
+struct service_ref {
+	service_ref()
+	{
+		service_get();
+	}
+
+	~service_ref()
+	{
+		service_put();
+	}
+};
+
+void service_ensure()
+{
+	static service_ref ref;
+}
+
+void check(ssize_t ret, std::size_t len, const char *what)
+{
+	if (ret == static_cast<ssize_t>(len))
+		return;
+
+	throw std::system_error(ret < 0 ? static_cast<int>(-ret) : EIO,
+				std::generic_category(), what);
+}
+
+} // namespace
+
+DSO_PUBLIC
+void fill(std::span<std::uint8_t> out)
+{
+	ssize_t ret = 0;
+
+	if (out.empty())
+		return;
+
+	service_ensure();
+	esdm_invoke(esdm_rpcc_get_random_bytes_full(out.data(), out.size()));
+	check(ret, out.size(), "Fetching random bytes from ESDM failed");
+}
+
+DSO_PUBLIC
+void fill_pr(std::span<std::uint8_t> out)
+{
+	ssize_t ret = 0;
+
+	if (out.empty())
+		return;
+
+	service_ensure();
+	esdm_invoke(esdm_rpcc_get_random_bytes_pr(out.data(), out.size()));
+	check(ret, out.size(), "Fetching random bytes from ESDM failed");
+}
+
+DSO_PUBLIC
+engine::engine()
+{
+	service_get();
+}
+
+DSO_PUBLIC
+engine::~engine()
+{
+	clear();
+	service_put();
+}
+
+DSO_PUBLIC
+void engine::clear()
+{
+	std::memset(m_buf.data(), 0, m_buf.size());
+	m_avail = 0;
+}
+
+// the buffer is refilled completely, remaining bytes are dropped, also when
+// the engine was inherited from the parent process
+DSO_PUBLIC
+void engine::refill()
+{
+	ssize_t ret = 0;
+
+	clear();
+	m_fork_generation =
+		detail::fork_generation.load(std::memory_order_relaxed);
+
+	esdm_invoke(esdm_rpcc_get_random_bytes_full(m_buf.data(),
+						    m_buf.size()));
+	check(ret, m_buf.size(), "Fetching random bytes from ESDM failed");
+	m_avail = m_buf.size();
+}
+
+DSO_PUBLIC
+void engine::fill(std::span<std::uint8_t> out)
+{
+	if (out.size() >= buffer_size) {
+		ssize_t ret = 0;
+
+		esdm_invoke(esdm_rpcc_get_random_bytes_full(out.data(),
+							    out.size()));
+		check(ret, out.size(), "Fetching random bytes from ESDM failed");
+		return;
+	}
+
+	take(out.data(), out.size());
+}
+
+DSO_PUBLIC
+engine &engine::instance()
+{
+	static thread_local engine e;
+
+	return e;
+}
+
+} // namespace esdm
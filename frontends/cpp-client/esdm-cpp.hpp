@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#ifndef ESDM_CPP_HPP
+#define ESDM_CPP_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+
+namespace esdm
+{
+
+// Random bytes from the fully seeded DRNG of the ESDM server, the request is
+// sent to the server without buffering
+void fill(std::span<std::uint8_t> out);
+
+// Random bytes from the DRNG of the ESDM server with prediction resistance
+void fill_pr(std::span<std::uint8_t> out);
+
+namespace detail
+{
+// incremented in the child process after fork, buffered data is dropped
+extern std::atomic<unsigned int> fork_generation;
+} // namespace detail
+
+// UniformRandomBitGenerator drawing from a buffer which is refilled with one
+// request to the ESDM server, e.g. for std::uniform_int_distribution. An
+// engine must only be used by one thread at a time, instance() provides an
+// engine per thread.
+class engine {
+public:
+	using result_type = std::uint64_t;
+
+	// number of bytes obtained from the ESDM server with one request
+	static constexpr std::size_t buffer_size = 4096;
+
+	engine();
+	~engine();
+
+	engine(const engine &) = delete;
+	engine &operator=(const engine &) = delete;
+
+	static constexpr result_type min()
+	{
+		return 0;
+	}
+
+	static constexpr result_type max()
+	{
+		return std::numeric_limits<result_type>::max();
+	}
+
+	result_type operator()()
+	{
+		result_type val;
+
+		take(&val, sizeof(val));
+		return val;
+	}
+
+	// requests of at least buffer_size bytes bypass the buffer
+	void fill(std::span<std::uint8_t> out);
+
+	// compile-time sized fill served from the buffer
+	template <std::size_t N> std::array<std::uint8_t, N> fill()
+	{
+		static_assert(N > 0 && N <= buffer_size,
+			      "fill<N>() is limited to the buffer size");
+		std::array<std::uint8_t, N> out;
+
+		take(out.data(), N);
+		return out;
+	}
+
+	// wipe the buffered random bytes
+	void clear();
+
+	// engine of the calling thread
+	static engine &instance();
+
+private:
+	void take(void *out, std::size_t len)
+	{
+		if (m_avail < len ||
+		    m_fork_generation != detail::fork_generation.load(
+						 std::memory_order_relaxed))
+			refill();
+
+		std::uint8_t *p = m_buf.data() + buffer_size - m_avail;
+
+		std::memcpy(out, p, len);
+		// consumed bytes must not remain in memory
+		std::memset(p, 0, len);
+		m_avail -= len;
+	}
+
+	void refill();
+
+	std::array<std::uint8_t, buffer_size> m_buf;
+	std::size_t m_avail = 0;
+	unsigned int m_fork_generation = 0;
+};
+
+} // namespace esdm
+
+#endif /* ESDM_CPP_HPP */
@@ -21,23 +21,26 @@
 #include <errno.h>
 #include <linux/random.h>
 #include <poll.h>
+#include <pthread.h>
 #include <semaphore.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/mount.h>
 #include <sys/shm.h>
 #include <time.h>
 #include <unistd.h>
 
-#include "atomic_64.h"
 #include "bool.h"
 #include "cuse_device.h"
 #include "cuse_helper.h"
 #include "esdm_rpc_client.h"
 #include "esdm_rpc_service.h"
+#include "esdm_shm_event.h"
 #include "helper.h"
 #include "linux_support.h"
 #include "esdm_logger.h"
+#include "esdm_probes.h"
 #include "math_helper.h"
 #include "memset_secure.h"
 #include "mutex.h"
@@ -45,6 +48,7 @@
 #include "privileges.h"
 #include "queue.h"
 #include "ret_checkers.h"
+#include "secure_memory.h"
 #include "threading_support.h"
 
 /******************************************************************************
@@ -59,7 +63,6 @@ static char *mount_dst = NULL;
  ******************************************************************************/
 
 static struct esdm_shm_status *esdm_cuse_shm_status = NULL;
-static atomic_64_t next_fh = ATOMIC_64_INIT(1);
 
 static int esdm_cuse_shm_status_avail(void)
 {
@@ -68,11 +71,14 @@ static int esdm_cuse_shm_status_avail(void)
 		   esdm_cuse_shm_status->version == ESDM_SHM_STATUS_VERSION);
 
 	if (ret && !initialized) {
+		char info[ESDM_SHM_STATUS_INFO_SIZE];
+
 		initialized = 1;
+		esdm_shm_status_info(esdm_cuse_shm_status, info, sizeof(info));
 		esdm_logger_status(
 			LOGGER_C_CUSE,
 			"CUSE client started detected ESDM server with properties:\n%s\n",
-			esdm_cuse_shm_status->info);
+			info);
 	}
 
 	return ret;
@@ -164,6 +170,9 @@ static atomic_bool_t esdm_cuse_poll_thread_shutdown = ATOMIC_BOOL_INIT(false);
 static sem_t *esdm_cuse_semid = SEM_FAILED;
 static const char *esdm_sem_name = NULL;
 
+/* Status event observed before the status flags were evaluated */
+static int esdm_cuse_status_seen = 0;
+
 static void esdm_cuse_shm_status_down(void)
 {
 	struct timespec ts = { .tv_sec = 1, .tv_nsec = 0 };
@@ -182,6 +191,11 @@ static void esdm_cuse_shm_status_down(void)
 	if (atomic_bool_read(&esdm_cuse_poll_thread_shutdown))
 		return;
 
+	/* Only a change of the status flags wakes the poll checker */
+	if (esdm_shm_event_wait(&esdm_cuse_shm_status->status_event,
+				esdm_cuse_status_seen, NULL) != -EOPNOTSUPP)
+		return;
+
 	if (sem_wait(esdm_cuse_semid))
 		esdm_logger(LOGGER_ERR, LOGGER_C_CUSE,
 			    "Cannot use semaphore\n");
@@ -234,13 +248,17 @@ err:
  ******************************************************************************/
 
 static DECLARE_WAIT_QUEUE(esdm_cuse_poll_checker_wait);
+static DECLARE_WAIT_QUEUE(esdm_cuse_entropy_wait);
 
 static void esdm_cuse_term(void)
 {
 	atomic_bool_set(&esdm_cuse_poll_thread_shutdown, true);
 	thread_wake_all(&esdm_cuse_poll_checker_wait);
+	thread_wake_all(&esdm_cuse_entropy_wait);
 	if (esdm_cuse_semid != SEM_FAILED)
 		sem_post(esdm_cuse_semid);
+	if (esdm_cuse_shm_status)
+		esdm_shm_event_wake(&esdm_cuse_shm_status->status_event);
 
 	thread_stop_spawning();
 
@@ -438,12 +456,414 @@ static void esdm_cuse_unpriv_call_end(void)
 	mutex_reader_unlock(&esdm_cuse_priv);
 }
 
+/******************************************************************************
+ * Batching of RNDADDENTROPY submissions
+ ******************************************************************************/
+
+/*
+ * Entropy feeders submit RNDADDENTROPY at a high rate. The submissions are
+ * collected and forwarded to the ESDM with one RPC call once the batch holds
+ * ESDM_CUSE_ENTROPY_BATCH_BITS of entropy, once the buffer is full, or at the
+ * latest ESDM_CUSE_ENTROPY_BATCH_INTERVAL_NS after the first submission.
+ *
+ * Each submission is credited with at most 8 bits per byte it contributes,
+ * just like the kernel does. Thus, the batch never claims more entropy than
+ * its individual submissions, and the ESDM receives the sum of their
+ * credits.
+ */
+#define ESDM_CUSE_ENTROPY_BATCH_SIZE 4096
+#define ESDM_CUSE_ENTROPY_BATCH_BITS 256
+#define ESDM_CUSE_ENTROPY_BATCH_INTERVAL_NS 10000000
+
+/* The batch has the layout of struct rand_pool_info for the kernel fallback */
+static union {
+	struct rand_pool_info rpi;
+	uint8_t raw[sizeof(struct rand_pool_info) +
+		    ESDM_CUSE_ENTROPY_BATCH_SIZE];
+} esdm_cuse_entropy_batch;
+static size_t esdm_cuse_entropy_batch_len = 0;
+static uint32_t esdm_cuse_entropy_batch_bits = 0;
+static int esdm_cuse_entropy_backend_fd = -1;
+static atomic_bool_t esdm_cuse_entropy_pending = ATOMIC_BOOL_INIT(false);
+static atomic_bool_t esdm_cuse_entropy_batching = ATOMIC_BOOL_INIT(false);
+static DEFINE_MUTEX_W_UNLOCKED(esdm_cuse_entropy_lock);
+
+/* Caller must hold esdm_cuse_entropy_lock */
+static void esdm_cuse_entropy_flush_locked(void)
+{
+	struct rand_pool_info *rpi = &esdm_cuse_entropy_batch.rpi;
+	ssize_t ret;
+
+	if (!esdm_cuse_entropy_batch_len)
+		return;
+
+	/* Only callers with privileges submit data to the batch */
+	mutex_lock(&esdm_cuse_priv);
+	raise_privilege_transient(0, 0);
+
+	esdm_invoke(esdm_rpcc_rnd_add_entropy_int(
+		(const uint8_t *)rpi->buf, esdm_cuse_entropy_batch_len,
+		esdm_cuse_entropy_batch_bits, NULL));
+
+	/* In case of an error, update the kernel */
+	if (ret && esdm_cuse_entropy_backend_fd >= 0) {
+		rpi->entropy_count = (int)esdm_cuse_entropy_batch_bits;
+		rpi->buf_size = (int)esdm_cuse_entropy_batch_len;
+		if (ioctl(esdm_cuse_entropy_backend_fd, RNDADDENTROPY, rpi) ==
+		    -1)
+			ret = -errno;
+		else
+			ret = 0;
+	}
+
+	drop_privileges_transient(esdm_cuse_unprivileged_user);
+	mutex_unlock(&esdm_cuse_priv);
+
+	if (ret) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_CUSE,
+			    "Forwarding %zu bytes of entropy failed: %zd\n",
+			    esdm_cuse_entropy_batch_len, ret);
+	}
+
+	memset_secure(&esdm_cuse_entropy_batch, 0,
+		      sizeof(esdm_cuse_entropy_batch));
+	esdm_cuse_entropy_batch_len = 0;
+	esdm_cuse_entropy_batch_bits = 0;
+	atomic_bool_set_false(&esdm_cuse_entropy_pending);
+}
+
+static void esdm_cuse_entropy_flush(void)
+{
+	if (!atomic_bool_read(&esdm_cuse_entropy_pending))
+		return;
+
+	mutex_w_lock(&esdm_cuse_entropy_lock);
+	esdm_cuse_entropy_flush_locked();
+	mutex_w_unlock(&esdm_cuse_entropy_lock);
+}
+
+/* Discard all pending submissions */
+static void esdm_cuse_entropy_discard(void)
+{
+	mutex_w_lock(&esdm_cuse_entropy_lock);
+	memset_secure(&esdm_cuse_entropy_batch, 0,
+		      sizeof(esdm_cuse_entropy_batch));
+	esdm_cuse_entropy_batch_len = 0;
+	esdm_cuse_entropy_batch_bits = 0;
+	atomic_bool_set_false(&esdm_cuse_entropy_pending);
+	mutex_w_unlock(&esdm_cuse_entropy_lock);
+}
+
+/*
+ * Add the data to the batch, returns false if the data must be forwarded
+ * directly.
+ */
+static bool esdm_cuse_entropy_add(int backend_fd, const uint8_t *buf,
+				  size_t buflen, uint32_t entropy_bits)
+{
+	uint8_t *batch = (uint8_t *)esdm_cuse_entropy_batch.rpi.buf;
+	bool wake;
+
+	if (!atomic_bool_read(&esdm_cuse_entropy_batching) ||
+	    buflen > ESDM_CUSE_ENTROPY_BATCH_SIZE)
+		return false;
+
+	if (entropy_bits > (buflen << 3))
+		entropy_bits = (uint32_t)(buflen << 3);
+
+	mutex_w_lock(&esdm_cuse_entropy_lock);
+	if (esdm_cuse_entropy_batch_len + buflen > ESDM_CUSE_ENTROPY_BATCH_SIZE)
+		esdm_cuse_entropy_flush_locked();
+
+	memcpy(batch + esdm_cuse_entropy_batch_len, buf, buflen);
+	esdm_cuse_entropy_batch_len += buflen;
+	esdm_cuse_entropy_batch_bits += entropy_bits;
+	esdm_cuse_entropy_backend_fd = backend_fd;
+
+	wake = !atomic_bool_read(&esdm_cuse_entropy_pending);
+	atomic_bool_set_true(&esdm_cuse_entropy_pending);
+
+	if (esdm_cuse_entropy_batch_bits >= ESDM_CUSE_ENTROPY_BATCH_BITS) {
+		esdm_cuse_entropy_flush_locked();
+		wake = false;
+	}
+	mutex_w_unlock(&esdm_cuse_entropy_lock);
+
+	if (wake)
+		thread_wake(&esdm_cuse_entropy_wait);
+
+	return true;
+}
+
+/******************************************************************************
+ * Batching of writes
+ ******************************************************************************/
+
+/*
+ * Writes to the device are not credited with entropy and the ESDM only mixes
+ * them into its auxiliary pool. Feeders writing small chunks are collected
+ * and forwarded to the ESDM with one RPC call once the buffer is full or at
+ * the latest ESDM_CUSE_ENTROPY_BATCH_INTERVAL_NS after the first write. The
+ * write is completed to the caller once its data is in the batch.
+ */
+#define ESDM_CUSE_WRITE_BATCH_SIZE 4096
+
+static uint8_t esdm_cuse_write_batch[ESDM_CUSE_WRITE_BATCH_SIZE];
+static size_t esdm_cuse_write_batch_len = 0;
+static int esdm_cuse_write_backend_fd = -1;
+static atomic_bool_t esdm_cuse_write_pending = ATOMIC_BOOL_INIT(false);
+static DEFINE_MUTEX_W_UNLOCKED(esdm_cuse_write_lock);
+
+/* Caller must hold esdm_cuse_write_lock */
+static void esdm_cuse_write_flush_locked(void)
+{
+	size_t written = 0;
+	ssize_t ret;
+
+	if (!esdm_cuse_write_batch_len)
+		return;
+
+	esdm_cuse_unpriv_call_start();
+	esdm_invoke(esdm_rpcc_write_data_int(esdm_cuse_write_batch,
+					     esdm_cuse_write_batch_len, NULL));
+	esdm_cuse_unpriv_call_end();
+
+	/* In case of an error, update the kernel */
+	if (ret && esdm_cuse_write_backend_fd >= 0) {
+		do {
+			ret = write(esdm_cuse_write_backend_fd,
+				    esdm_cuse_write_batch + written,
+				    esdm_cuse_write_batch_len - written);
+			if (ret > 0)
+				written += (size_t)ret;
+		} while (ret > 0 && written < esdm_cuse_write_batch_len);
+		if (ret > 0)
+			ret = 0;
+	}
+
+	if (ret) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_CUSE,
+			    "Forwarding %zu bytes of written data failed: %zd\n",
+			    esdm_cuse_write_batch_len, ret);
+	}
+
+	memset_secure(esdm_cuse_write_batch, 0, esdm_cuse_write_batch_len);
+	esdm_cuse_write_batch_len = 0;
+	atomic_bool_set_false(&esdm_cuse_write_pending);
+}
+
+static void esdm_cuse_write_flush(void)
+{
+	if (!atomic_bool_read(&esdm_cuse_write_pending))
+		return;
+
+	mutex_w_lock(&esdm_cuse_write_lock);
+	esdm_cuse_write_flush_locked();
+	mutex_w_unlock(&esdm_cuse_write_lock);
+}
+
+/* Discard all pending writes */
+static void esdm_cuse_write_discard(void)
+{
+	mutex_w_lock(&esdm_cuse_write_lock);
+	memset_secure(esdm_cuse_write_batch, 0, esdm_cuse_write_batch_len);
+	esdm_cuse_write_batch_len = 0;
+	atomic_bool_set_false(&esdm_cuse_write_pending);
+	mutex_w_unlock(&esdm_cuse_write_lock);
+}
+
+/*
+ * Add the data to the batch, returns false if the data must be forwarded
+ * directly.
+ */
+static bool esdm_cuse_write_add(int backend_fd, const uint8_t *buf,
+				size_t buflen)
+{
+	bool wake;
+
+	/* The batching is performed by the entropy batch flusher */
+	if (!atomic_bool_read(&esdm_cuse_entropy_batching) ||
+	    buflen > ESDM_CUSE_WRITE_BATCH_SIZE)
+		return false;
+
+	mutex_w_lock(&esdm_cuse_write_lock);
+	if (esdm_cuse_write_batch_len + buflen > ESDM_CUSE_WRITE_BATCH_SIZE)
+		esdm_cuse_write_flush_locked();
+
+	memcpy(esdm_cuse_write_batch + esdm_cuse_write_batch_len, buf, buflen);
+	esdm_cuse_write_batch_len += buflen;
+	esdm_cuse_write_backend_fd = backend_fd;
+
+	wake = !atomic_bool_read(&esdm_cuse_write_pending);
+	atomic_bool_set_true(&esdm_cuse_write_pending);
+
+	if (esdm_cuse_write_batch_len >= ESDM_CUSE_WRITE_BATCH_SIZE) {
+		esdm_cuse_write_flush_locked();
+		wake = false;
+	}
+	mutex_w_unlock(&esdm_cuse_write_lock);
+
+	if (wake)
+		thread_wake(&esdm_cuse_entropy_wait);
+
+	return true;
+}
+
+/* Entropy and write batch flusher executed in separate thread */
+static int esdm_cuse_entropy_flusher(void __unused *unused)
+{
+	static const struct timespec interval = {
+		.tv_sec = 0, .tv_nsec = ESDM_CUSE_ENTROPY_BATCH_INTERVAL_NS
+	};
+	/* Catch a missed wakeup without polling at the batch interval */
+	static const struct timespec idle = { .tv_sec = 1, .tv_nsec = 0 };
+	int ret;
+
+	thread_set_name(cuse_entropy, 0);
+
+	atomic_bool_set_true(&esdm_cuse_entropy_batching);
+
+	while (!atomic_bool_read(&esdm_cuse_poll_thread_shutdown)) {
+		ret = 0;
+		thread_timedwait_event(
+			&esdm_cuse_entropy_wait,
+			(atomic_bool_read(&esdm_cuse_entropy_pending) ||
+			 atomic_bool_read(&esdm_cuse_write_pending) ||
+			 atomic_bool_read(&esdm_cuse_poll_thread_shutdown)),
+			&idle);
+		if (!atomic_bool_read(&esdm_cuse_entropy_pending) &&
+		    !atomic_bool_read(&esdm_cuse_write_pending))
+			continue;
+
+		/* Collect further submissions for the batch interval */
+		nanosleep(&interval, NULL);
+		esdm_cuse_entropy_flush();
+		esdm_cuse_write_flush();
+	}
+
+	atomic_bool_set_false(&esdm_cuse_entropy_batching);
+	esdm_cuse_entropy_flush();
+	esdm_cuse_write_flush();
+
+	return 0;
+}
+
+/******************************************************************************
+ * Per-thread read buffer
+ ******************************************************************************/
+
+/*
+ * Each worker thread keeps a page-aligned and locked buffer for the read
+ * requests which is sized to the maximum fuse request. The buffer is erased
+ * after each use and released when the thread terminates.
+ */
+#define ESDM_CUSE_READ_BUFFER_SIZE 131072
+
+struct esdm_cuse_read_buffer {
+	uint8_t *buf;
+	size_t len;
+};
+
+static __thread struct esdm_cuse_read_buffer esdm_cuse_read_buffer;
+static pthread_once_t esdm_cuse_read_buffer_once = PTHREAD_ONCE_INIT;
+static pthread_key_t esdm_cuse_read_buffer_key;
+static bool esdm_cuse_read_buffer_key_valid = false;
+
+static void esdm_cuse_read_buffer_release(struct esdm_cuse_read_buffer *rbuf)
+{
+	if (!rbuf->buf)
+		return;
+
+	munlock(rbuf->buf, rbuf->len);
+	free(rbuf->buf);
+	rbuf->buf = NULL;
+	rbuf->len = 0;
+}
+
+/* Thread terminates */
+static void esdm_cuse_read_buffer_destructor(void *data)
+{
+	struct esdm_cuse_read_buffer *rbuf = data;
+
+	if (rbuf)
+		esdm_cuse_read_buffer_release(rbuf);
+}
+
+static void esdm_cuse_read_buffer_init(void)
+{
+	if (!pthread_key_create(&esdm_cuse_read_buffer_key,
+				esdm_cuse_read_buffer_destructor))
+		esdm_cuse_read_buffer_key_valid = true;
+}
+
+/*
+ * Get the read buffer of the current thread holding at least size bytes,
+ * returns NULL if no buffer is available.
+ */
+static uint8_t *esdm_cuse_read_buffer_get(size_t size)
+{
+	struct esdm_cuse_read_buffer *rbuf = &esdm_cuse_read_buffer;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	size_t len = (size > ESDM_CUSE_READ_BUFFER_SIZE) ?
+			     size :
+			     ESDM_CUSE_READ_BUFFER_SIZE;
+	void *tmp;
+
+	if (rbuf->len >= size)
+		return rbuf->buf;
+
+	pthread_once(&esdm_cuse_read_buffer_once, esdm_cuse_read_buffer_init);
+	if (!esdm_cuse_read_buffer_key_valid)
+		return NULL;
+
+	if (pagesize <= 0)
+		pagesize = 4096;
+	len = (len + (size_t)pagesize - 1) & ~((size_t)pagesize - 1);
+
+	esdm_cuse_read_buffer_release(rbuf);
+
+	/* Ensure the buffer is released when the thread terminates */
+	if (pthread_setspecific(esdm_cuse_read_buffer_key, rbuf))
+		return NULL;
+
+	if (posix_memalign(&tmp, (size_t)pagesize, len))
+		return NULL;
+
+	/* prevent paging out of the random numbers to swap space */
+	if (mlock(tmp, len) && errno != EPERM && errno != EAGAIN &&
+	    errno != ENOMEM) {
+		free(tmp);
+		return NULL;
+	}
+
+	rbuf->buf = tmp;
+	rbuf->len = len;
+
+	return rbuf->buf;
+}
+
 /******************************************************************************
  * CUSE callback handler
  ******************************************************************************/
+
+/* State of an open file, referenced by fi->fh */
+struct esdm_cuse_file {
+	/* Pending poll handle, protected by esdm_cuse_ph_lock */
+	struct fuse_pollhandle *ph;
+	uint32_t poll_events;
+	unsigned int poll_type;
+	size_t poll_idx;
+};
 void esdm_cuse_open(fuse_req_t req, struct fuse_file_info *fi)
 {
-	fi->fh = (uint64_t)atomic_inc_64(&next_fh);
+	struct esdm_cuse_file *file = calloc(1, sizeof(*file));
+
+	if (!file) {
+		fuse_reply_err(req, ENOMEM);
+		return;
+	}
+
+	fi->fh = (uint64_t)(uintptr_t)file;
 	fuse_reply_open(req, fi);
 }
 
@@ -456,6 +876,15 @@ static int esdm_cuse_interrupt(void *data)
 	return !!fuse_req_interrupted(req);
 }
 
+/* FUSE notifies the interruption of a request, wake up the pending RPC */
+static void esdm_cuse_interrupt_notify(fuse_req_t req, void *data)
+{
+	(void)req;
+	(void)data;
+
+	esdm_rpcc_interrupt();
+}
+
 void esdm_cuse_read_internal(fuse_req_t req, size_t size, off_t off,
 			     struct fuse_file_info *fi, get_func_t get,
 			     int fallback_fd)
@@ -466,14 +895,24 @@ void esdm_cuse_read_internal(fuse_req_t req, size_t size, off_t off,
 
 	(void)off;
 
+	ESDM_PROBE1(cuse_read_start, size);
+
+	fuse_req_interrupt_func(req, esdm_cuse_interrupt_notify, NULL);
+
 	/*
 	 * size is limited by fuse to its maximum request size, mostly
 	 * 131072 byte
 	 */
 	if (size > sizeof(tmpbuf_s)) {
-		tmpbuf = calloc(1, size);
-		CKNULL(tmpbuf, -ENOMEM);
-		tmpbuf_p = tmpbuf;
+		uint8_t *rbuf = esdm_cuse_read_buffer_get(size);
+
+		if (rbuf) {
+			tmpbuf_p = rbuf;
+		} else {
+			tmpbuf = esdm_secure_alloc(size);
+			CKNULL(tmpbuf, -ENOMEM);
+			tmpbuf_p = tmpbuf;
+		}
 	}
 
 	fallback_fd = esdm_test_fallback_fd(fallback_fd);
@@ -487,8 +926,8 @@ void esdm_cuse_read_internal(fuse_req_t req, size_t size, off_t off,
 	 * them up.
 	 */
 	while (read_bytes < size) {
-		size_t todo =
-			min_size(ESDM_RPC_MAX_MSG_SIZE, size - read_bytes);
+		size_t todo = min_size(ESDM_RPC_MAX_NEGOTIATED_DATA,
+				       size - read_bytes);
 
 		esdm_cuse_unpriv_call_start();
 		esdm_invoke(get(tmpbuf_p + read_bytes, todo, req));
@@ -517,14 +956,17 @@ void esdm_cuse_read_internal(fuse_req_t req, size_t size, off_t off,
 
 out:
 	if (tmpbuf) {
-		memset_secure(tmpbuf, 0, size);
-		free(tmpbuf);
+		esdm_secure_free(tmpbuf, size);
+	} else if (tmpbuf_p != tmpbuf_s) {
+		memset_secure(tmpbuf_p, 0, size);
 	} else {
 		memset_secure(tmpbuf_s, 0, sizeof(tmpbuf_s));
 	}
 
 	if (ret < 0)
 		fuse_reply_err(req, (int)-ret);
+
+	ESDM_PROBE2(cuse_read_end, size, ret < 0 ? ret : 0);
 }
 
 void esdm_cuse_write_internal(fuse_req_t req, const char *buf, size_t size,
@@ -539,6 +981,15 @@ void esdm_cuse_write_internal(fuse_req_t req, const char *buf, size_t size,
 
 	fallback_fd = esdm_test_fallback_fd(fallback_fd);
 
+	/* Small writes are forwarded with the next batch */
+	if (esdm_cuse_write_add(fallback_fd, (const uint8_t *)buf, size)) {
+		written = size;
+		ret = 0;
+		goto out;
+	}
+
+	fuse_req_interrupt_func(req, esdm_cuse_interrupt_notify, NULL);
+
 	while (written < size) {
 		size_t todo = min_size(ESDM_RPC_MAX_MSG_SIZE, size - written);
 
@@ -603,6 +1054,9 @@ void esdm_cuse_ioctl(int backend_fd, fuse_req_t req, unsigned long cmd,
 
 			fuse_reply_ioctl_retry(req, NULL, 0, &iov, 1);
 		} else {
+			/* Account the pending entropy submissions */
+			esdm_cuse_entropy_flush();
+
 			esdm_cuse_unpriv_call_start();
 			esdm_invoke(esdm_rpcc_rnd_get_ent_cnt_int(
 				&ent_count_bits, req));
@@ -665,6 +1119,8 @@ void esdm_cuse_ioctl(int backend_fd, fuse_req_t req, unsigned long cmd,
 						     (size_t)rpi->buf_size };
 
 			fuse_reply_ioctl_retry(req, &iov, 1, NULL, 0);
+		} else if (rpi->entropy_count < 0) {
+			fuse_reply_err(req, EINVAL);
 		} else {
 			/*
 			 * This operation requires privileges. Thus, raise the
@@ -674,6 +1130,15 @@ void esdm_cuse_ioctl(int backend_fd, fuse_req_t req, unsigned long cmd,
 				fuse_reply_err(req, EPERM);
 				return;
 			}
+
+			if (esdm_cuse_entropy_add(
+				    backend_fd, (const uint8_t *)rpi->buf,
+				    (size_t)rpi->buf_size,
+				    (uint32_t)rpi->entropy_count)) {
+				fuse_reply_ioctl(req, 0, NULL, 0);
+				return;
+			}
+
 			esdm_cuse_raise_privilege_transient(req);
 
 			esdm_invoke(esdm_rpcc_rnd_add_entropy_int(
@@ -706,6 +1171,8 @@ void esdm_cuse_ioctl(int backend_fd, fuse_req_t req, unsigned long cmd,
 			fuse_reply_err(req, EPERM);
 			return;
 		}
+		esdm_cuse_entropy_discard();
+		esdm_cuse_write_discard();
 		esdm_cuse_raise_privilege_transient(req);
 		esdm_invoke(esdm_rpcc_rnd_clear_pool_int(req));
 		if (!ret) {
@@ -728,6 +1195,8 @@ void esdm_cuse_ioctl(int backend_fd, fuse_req_t req, unsigned long cmd,
 			fuse_reply_err(req, EPERM);
 			return;
 		}
+		esdm_cuse_entropy_flush();
+		esdm_cuse_write_flush();
 		esdm_cuse_raise_privilege_transient(req);
 		esdm_invoke(esdm_rpcc_rnd_reseed_crng_int(req));
 		if (!ret) {
@@ -743,17 +1212,20 @@ void esdm_cuse_ioctl(int backend_fd, fuse_req_t req, unsigned long cmd,
 		break;
 
 	/* ESDM-specific IOCTL: get ESDM information */
-	case 42:
-		if (out_bufsz < esdm_cuse_shm_status->infolen) {
-			struct iovec iov = { arg,
-					     esdm_cuse_shm_status->infolen };
+	case 42: {
+		char info[ESDM_SHM_STATUS_INFO_SIZE];
+		size_t infolen = esdm_shm_status_info(esdm_cuse_shm_status,
+						      info, sizeof(info));
+
+		if (out_bufsz < infolen) {
+			struct iovec iov = { arg, infolen };
 
 			fuse_reply_ioctl_retry(req, NULL, 0, &iov, 1);
 		} else {
-			fuse_reply_ioctl(req, 0, esdm_cuse_shm_status->info,
-					 esdm_cuse_shm_status->infolen);
+			fuse_reply_ioctl(req, 0, info, infolen);
 		}
 		break;
+	}
 
 	/* ESDM-specific IOCTL: Reseed kernel directly */
 	case 43:
@@ -805,20 +1277,31 @@ void esdm_cuse_ioctl(int backend_fd, fuse_req_t req, unsigned long cmd,
  * Poll system call handler
  ******************************************************************************/
 
-#define ESDM_CUSE_MAX_PH 16
-struct esdm_cuse_poll {
-	uint64_t fh;
-	struct fuse_pollhandle *ph;
-	uint32_t poll_events;
+#define ESDM_POLL_READER (POLLIN | POLLRDNORM)
+#define ESDM_POLL_WRITER (POLLOUT | POLLWRNORM)
+
+/*
+ * Pending poll handles are kept in one list per event type. A status change
+ * only walks the list of the event which became available.
+ */
+enum esdm_cuse_poll_type {
+	esdm_cuse_poll_reader,
+	esdm_cuse_poll_writer,
+	esdm_cuse_poll_reader_writer,
+	esdm_cuse_poll_types,
+};
+
+#define ESDM_CUSE_POLL_LIST_INIT_SIZE 16
+struct esdm_cuse_poll_list {
+	struct esdm_cuse_file **files;
+	size_t num;
+	size_t size;
 };
-static struct esdm_cuse_poll esdm_cuse_polls[ESDM_CUSE_MAX_PH];
+static struct esdm_cuse_poll_list esdm_cuse_poll_lists[esdm_cuse_poll_types];
 static DEFINE_MUTEX_W_UNLOCKED(esdm_cuse_ph_lock);
 
 static void esdm_cuse_get_pollmask(unsigned int *outmask)
 {
-#define ESDM_POLL_READER (POLLIN | POLLRDNORM)
-#define ESDM_POLL_WRITER (POLLOUT | POLLWRNORM)
-
 	*outmask = 0;
 
 	if (atomic_bool_read(&esdm_cuse_shm_status->operational))
@@ -844,6 +1327,99 @@ static void esdm_cuse_set_pollmask(unsigned int request_events,
 	*outmask &= request_events;
 }
 
+static enum esdm_cuse_poll_type esdm_cuse_poll_type(uint32_t poll_events)
+{
+	bool reader = !!(poll_events & ESDM_POLL_READER);
+	bool writer = !!(poll_events & ESDM_POLL_WRITER);
+
+	if (reader && writer)
+		return esdm_cuse_poll_reader_writer;
+	if (writer)
+		return esdm_cuse_poll_writer;
+	return esdm_cuse_poll_reader;
+}
+
+/* Caller must hold esdm_cuse_ph_lock */
+static int esdm_cuse_poll_add(struct esdm_cuse_file *file,
+			      struct fuse_pollhandle *ph, uint32_t poll_events)
+{
+	enum esdm_cuse_poll_type type = esdm_cuse_poll_type(poll_events);
+	struct esdm_cuse_poll_list *list = &esdm_cuse_poll_lists[type];
+
+	if (list->num == list->size) {
+		size_t size = list->size ? list->size * 2 :
+					   ESDM_CUSE_POLL_LIST_INIT_SIZE;
+		struct esdm_cuse_file **tmp =
+			realloc(list->files, size * sizeof(*tmp));
+
+		if (!tmp)
+			return -ENOMEM;
+		list->files = tmp;
+		list->size = size;
+	}
+
+	file->ph = ph;
+	file->poll_events = poll_events;
+	file->poll_type = type;
+	file->poll_idx = list->num;
+	list->files[list->num++] = file;
+
+	return 0;
+}
+
+/*
+ * Remove the pending poll handle of the file from its list and return it.
+ * Caller must hold esdm_cuse_ph_lock.
+ */
+static struct fuse_pollhandle *esdm_cuse_poll_del(struct esdm_cuse_file *file)
+{
+	struct esdm_cuse_poll_list *list;
+	struct fuse_pollhandle *ph = file->ph;
+
+	if (!ph)
+		return NULL;
+
+	list = &esdm_cuse_poll_lists[file->poll_type];
+	list->num--;
+	if (file->poll_idx != list->num) {
+		list->files[file->poll_idx] = list->files[list->num];
+		list->files[file->poll_idx]->poll_idx = file->poll_idx;
+	}
+
+	file->ph = NULL;
+	file->poll_events = 0;
+
+	return ph;
+}
+
+/*
+ * Notify all pollers of the given list whose requested events are reported
+ * by sysmask. Caller must hold esdm_cuse_ph_lock.
+ */
+static void esdm_cuse_poll_notify(enum esdm_cuse_poll_type type,
+				  unsigned int sysmask)
+{
+	struct esdm_cuse_poll_list *list = &esdm_cuse_poll_lists[type];
+	size_t i = 0;
+
+	while (i < list->num) {
+		struct esdm_cuse_file *file = list->files[i];
+		struct fuse_pollhandle *ph;
+		unsigned int mask = sysmask;
+
+		esdm_cuse_set_pollmask(file->poll_events, &mask);
+		if (!mask) {
+			i++;
+			continue;
+		}
+
+		/* The last entry of the list moves to index i */
+		ph = esdm_cuse_poll_del(file);
+		fuse_notify_poll(ph);
+		fuse_pollhandle_destroy(ph);
+	}
+}
+
 /* when extending this function, always check and return error
  * codes first, as they may originate from an interrupted poll/select
  * which causes many bogus events if answered with notify_poll or reply_poll
@@ -851,12 +1427,13 @@ static void esdm_cuse_set_pollmask(unsigned int request_events,
 void esdm_cuse_poll(fuse_req_t req, struct fuse_file_info *fi,
 		    struct fuse_pollhandle *ph)
 {
-	unsigned int i, mask;
-	int err_code;
+	struct esdm_cuse_file *file = (struct esdm_cuse_file *)(uintptr_t)fi->fh;
+	struct fuse_pollhandle *old_ph;
+	unsigned int mask;
 
 	if (!fi->poll_events) {
-		err_code = EINVAL;
-		goto err;
+		fuse_reply_err(req, EINVAL);
+		return;
 	}
 
 	/*
@@ -867,87 +1444,65 @@ void esdm_cuse_poll(fuse_req_t req, struct fuse_file_info *fi,
 	esdm_cuse_set_pollmask(fi->poll_events, &mask);
 	fuse_reply_poll(req, mask);
 
+	if (!ph)
+		return;
+
 	/* cleanup first, as we may have an interrupted poll/select */
 	mutex_w_lock(&esdm_cuse_ph_lock);
-	for (i = 0; i < ESDM_CUSE_MAX_PH; i++) {
-		if (esdm_cuse_polls[i].fh == fi->fh) {
-			if (esdm_cuse_polls[i].ph) {
-				fuse_pollhandle_destroy(esdm_cuse_polls[i].ph);
-			}
-			esdm_cuse_polls[i].fh = 0;
-			esdm_cuse_polls[i].ph = NULL;
-			esdm_cuse_polls[i].poll_events = 0;
-		}
-
-		if (esdm_cuse_polls[i].ph)
-			continue;
+	old_ph = esdm_cuse_poll_del(file);
+	if (old_ph)
+		fuse_pollhandle_destroy(old_ph);
 
-		if (mask) {
-			fuse_notify_poll(ph);
-			fuse_pollhandle_destroy(ph);
-			break;
-		}
-
-		esdm_cuse_polls[i].fh = fi->fh;
-		esdm_cuse_polls[i].ph = ph;
-		esdm_cuse_polls[i].poll_events = fi->poll_events;
-		break;
+	/*
+	 * If the handle cannot be queued, wake the caller immediately so that
+	 * it polls again instead of waiting forever.
+	 */
+	if (mask || esdm_cuse_poll_add(file, ph, fi->poll_events)) {
+		fuse_notify_poll(ph);
+		fuse_pollhandle_destroy(ph);
 	}
 	mutex_w_unlock(&esdm_cuse_ph_lock);
+}
 
-	if (i == ESDM_CUSE_MAX_PH) {
-		err_code = EBUSY;
-		goto err;
-	}
+static bool esdm_cuse_poll_pending(void)
+{
+	unsigned int i;
 
-	return;
+	for (i = 0; i < esdm_cuse_poll_types; i++) {
+		if (esdm_cuse_poll_lists[i].num)
+			return true;
+	}
 
-err:
-	fuse_reply_err(req, err_code);
+	return false;
 }
 
 /* Poll checker handler executed in separate thread */
 static int esdm_cuse_poll_checker(void __unused *unused)
 {
-	unsigned int i;
-
 	thread_set_name(cuse_poll, 0);
 
-	/* Clean out the poll status */
-	for (i = 0; i < ESDM_CUSE_MAX_PH; i++) {
-		esdm_cuse_polls[i].fh = 0;
-		esdm_cuse_polls[i].ph = NULL;
-		esdm_cuse_polls[i].poll_events = 0;
-	}
 	thread_wake_all(&esdm_cuse_poll_checker_wait);
 
 	while (!atomic_bool_read(&esdm_cuse_poll_thread_shutdown)) {
-		unsigned int sysmask, mask;
-		bool sysmask_set = false;
+		unsigned int sysmask;
 
-		mutex_w_lock(&esdm_cuse_ph_lock);
-		for (i = 0; i < ESDM_CUSE_MAX_PH; i++) {
-			if (!esdm_cuse_polls[i].ph)
-				continue;
-
-			/* Get the mask once for this loop */
-			if (!sysmask_set) {
-				esdm_cuse_get_pollmask(&sysmask);
-				sysmask_set = true;
-			}
-
-			mask = sysmask;
-			esdm_cuse_set_pollmask(esdm_cuse_polls[i].poll_events,
-					       &mask);
+		if (esdm_cuse_shm_status)
+			esdm_cuse_status_seen = atomic_read(
+				&esdm_cuse_shm_status->status_event);
 
-			if (!mask)
-				continue;
-
-			fuse_notify_poll(esdm_cuse_polls[i].ph);
-			fuse_pollhandle_destroy(esdm_cuse_polls[i].ph);
-			esdm_cuse_polls[i].fh = 0;
-			esdm_cuse_polls[i].ph = NULL;
-			esdm_cuse_polls[i].poll_events = 0;
+		mutex_w_lock(&esdm_cuse_ph_lock);
+		if (esdm_cuse_poll_pending()) {
+			esdm_cuse_get_pollmask(&sysmask);
+
+			if (sysmask & ESDM_POLL_READER)
+				esdm_cuse_poll_notify(esdm_cuse_poll_reader,
+						      sysmask);
+			if (sysmask & ESDM_POLL_WRITER)
+				esdm_cuse_poll_notify(esdm_cuse_poll_writer,
+						      sysmask);
+			if (sysmask)
+				esdm_cuse_poll_notify(
+					esdm_cuse_poll_reader_writer, sysmask);
 		}
 		mutex_w_unlock(&esdm_cuse_ph_lock);
 
@@ -959,20 +1514,21 @@ static int esdm_cuse_poll_checker(void __unused *unused)
 
 void esdm_cuse_release(fuse_req_t req, struct fuse_file_info *fi)
 {
-	unsigned int i;
+	struct esdm_cuse_file *file = (struct esdm_cuse_file *)(uintptr_t)fi->fh;
+	struct fuse_pollhandle *ph;
 
-	mutex_w_lock(&esdm_cuse_ph_lock);
-	for (i = 0; i < ESDM_CUSE_MAX_PH; i++) {
-		if (esdm_cuse_polls[i].fh == fi->fh) {
-			fuse_notify_poll(esdm_cuse_polls[i].ph);
-			fuse_pollhandle_destroy(esdm_cuse_polls[i].ph);
-
-			esdm_cuse_polls[i].fh = 0;
-			esdm_cuse_polls[i].ph = NULL;
-			esdm_cuse_polls[i].poll_events = 0;
+	if (file) {
+		mutex_w_lock(&esdm_cuse_ph_lock);
+		ph = esdm_cuse_poll_del(file);
+		if (ph) {
+			fuse_notify_poll(ph);
+			fuse_pollhandle_destroy(ph);
 		}
+		mutex_w_unlock(&esdm_cuse_ph_lock);
+
+		free(file);
+		fi->fh = 0;
 	}
-	mutex_w_unlock(&esdm_cuse_ph_lock);
 
 	fuse_reply_err(req, 0);
 }
@@ -1011,6 +1567,13 @@ void esdm_cuse_init_done(void *userdata)
 	/* Wait until thread is fully initialized */
 	thread_wait_no_event(&esdm_cuse_poll_checker_wait);
 
+	/* Without the flusher, entropy submissions are forwarded directly */
+	if (thread_start(esdm_cuse_entropy_flusher, NULL,
+			 ESDM_THREAD_CUSE_ENTROPY_GROUP, NULL)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_CUSE,
+			    "Starting entropy batch thread failed\n");
+	}
+
 	return;
 
 out:
@@ -1024,6 +1587,7 @@ struct esdm_cuse_param {
 	char *dev_name;
 	char *username;
 	unsigned int verbosity;
+	unsigned int threads;
 	int is_help;
 	int disable_fallback;
 	int syslog;
@@ -1041,6 +1605,8 @@ static const char *usage =
 	"    --name=NAME|-n NAME     device name (mandatory)\n"
 	"    --verbosity=NUM|-v NUM  verbosity level\n"
 	"    --username=USER|-v USER unprivileged user name (default: \"nobody\")\n"
+	"    --threads=NUM|-t NUM    number of worker threads kept for the\n"
+	"                            multi-threaded operation (default: libfuse)\n"
 	"    -d   -o debug           enable debug output (implies -f)\n"
 	"    -f                      foreground operation\n"
 	"    -s                      disable multi-threaded operation\n"
@@ -1063,6 +1629,8 @@ static const struct fuse_opt esdm_cuse_opts[] = {
 	ESDM_CUSE_OPT("--verbosity=%u", verbosity),
 	ESDM_CUSE_OPT("-u %s", username),
 	ESDM_CUSE_OPT("--username %s", username),
+	ESDM_CUSE_OPT("-t %u", threads),
+	ESDM_CUSE_OPT("--threads=%u", threads),
 #ifdef ESDM_TESTMODE
 	ESDM_CUSE_OPT("--disable_fallback=%d", disable_fallback),
 #endif
@@ -1095,16 +1663,44 @@ static int esdm_cuse_process_arg(void *data, const char *arg, int key,
 	}
 }
 
+/*
+ * Process the CUSE requests. In multi-threaded mode, every worker thread
+ * obtains its own /dev/cuse file descriptor and its own connection to the
+ * ESDM server. Thus, parallel readers neither queue on one FUSE channel nor
+ * on one RPC connection.
+ */
+static int esdm_cuse_session_loop(struct fuse_session *se, int multithreaded,
+				  unsigned int threads)
+{
+	struct fuse_loop_config config = { .clone_fd = 1,
+					   .max_idle_threads = 10 };
+
+	if (!multithreaded)
+		return fuse_session_loop(se);
+
+	if (threads)
+		config.max_idle_threads = threads;
+
+	esdm_rpcc_set_thread_bound_connections(true);
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_CUSE,
+		    "Starting multi-threaded session loop with %u workers\n",
+		    config.max_idle_threads);
+
+	return fuse_session_loop_mt(se, &config);
+}
+
 int main_common(const char *_devname, const char *target, const char *semname,
 		const struct cuse_lowlevel_ops *clop, int argc, char **argv)
 {
 	struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
-	struct esdm_cuse_param param = { 0, 0, NULL, NULL, 1, 0, 0, 0 };
+	struct esdm_cuse_param param = { 0, 0, NULL, NULL, 1, 0, 0, 0, 0 };
+	struct fuse_session *se;
 	char dev_name[128] = "DEVNAME=";
 	char devname[20];
 	const char *dev_info_argv[] = { dev_name };
 	struct cuse_info ci;
-	int ret = 1;
+	int multithreaded, ret = 1;
 
 	if (fuse_opt_parse(&args, &param, esdm_cuse_opts,
 			   esdm_cuse_process_arg)) {
@@ -1186,7 +1782,16 @@ int main_common(const char *_devname, const char *target, const char *semname,
 	ci.flags = CUSE_UNRESTRICTED_IOCTL;
 
 	esdm_cuse_install_sig_handler();
-	ret = cuse_lowlevel_main(args.argc, args.argv, &ci, clop, NULL);
+	se = cuse_lowlevel_setup(args.argc, args.argv, &ci, clop,
+				 &multithreaded, NULL);
+	if (!se) {
+		ret = 1;
+		goto out;
+	}
+
+	ret = esdm_cuse_session_loop(se, multithreaded, param.threads);
+	cuse_lowlevel_teardown(se);
+	ret = (ret == -1) ? 1 : 0;
 
 out:
 	esdm_cuse_term();
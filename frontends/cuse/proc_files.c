@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/shm.h>
 #include <unistd.h>
 
 #include "binhexbin.h"
@@ -36,6 +37,7 @@
 #include "esdm_rpc_service.h"
 #include "helper.h"
 #include "esdm_logger.h"
+#include "mutex_w.h"
 #include "privileges.h"
 #include "ret_checkers.h"
 #include "selinux.h"
@@ -147,13 +149,110 @@ static int esdm_proc_uuid(struct esdm_proc_file *file)
 	return 0;
 }
 
+/*
+ * The values of the proc files are taken from the status shared memory
+ * segment of the server. They are cached and only refreshed when the server
+ * changes the proc_version of the segment. If the segment is not available,
+ * the values are obtained with RPC calls.
+ */
+enum esdm_proc_shm_value {
+	esdm_proc_shm_entropy_avail,
+	esdm_proc_shm_poolsize,
+	esdm_proc_shm_write_wakeup_thresh,
+	esdm_proc_shm_min_reseed_secs,
+	esdm_proc_shm_values,
+};
+
+static struct esdm_shm_status *esdm_proc_shm_status = NULL;
+static uint32_t esdm_proc_shm_cache[esdm_proc_shm_values];
+static int esdm_proc_shm_cache_version = -1;
+static DEFINE_MUTEX_W_UNLOCKED(esdm_proc_shm_lock);
+
+static void esdm_proc_shm_status_close(void)
+{
+	if (esdm_proc_shm_status) {
+		shmdt(esdm_proc_shm_status);
+		esdm_proc_shm_status = NULL;
+	}
+}
+
+/* Caller must hold esdm_proc_shm_lock */
+static bool esdm_proc_shm_status_avail(void)
+{
+	key_t key;
+	void *tmp;
+	int shmid;
+
+	if (esdm_proc_shm_status) {
+		if (esdm_proc_shm_status->version == ESDM_SHM_STATUS_VERSION)
+			return true;
+
+		/* The server was replaced by an incompatible one */
+		esdm_proc_shm_status_close();
+		esdm_proc_shm_cache_version = -1;
+	}
+
+	/* The segment is created by the server, never by us */
+	key = esdm_ftok(ESDM_SHM_NAME, ESDM_SHM_STATUS);
+	shmid = shmget(key, sizeof(struct esdm_shm_status), 0);
+	if (shmid < 0)
+		return false;
+
+	tmp = shmat(shmid, NULL, SHM_RDONLY);
+	if (tmp == (void *)-1)
+		return false;
+	esdm_proc_shm_status = tmp;
+
+	if (esdm_proc_shm_status->version != ESDM_SHM_STATUS_VERSION) {
+		esdm_proc_shm_status_close();
+		return false;
+	}
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_CUSE,
+		    "ESDM shared memory segment attached for proc values\n");
+
+	return true;
+}
+
+static int esdm_proc_shm_value(enum esdm_proc_shm_value type, uint32_t *val)
+{
+	int ret = 0;
+
+	mutex_w_lock(&esdm_proc_shm_lock);
+	if (!esdm_proc_shm_status_avail()) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	/* Refresh the cached values only if the server changed them */
+	if (atomic_read(&esdm_proc_shm_status->proc_version) !=
+	    esdm_proc_shm_cache_version) {
+		esdm_proc_shm_cache_version = esdm_shm_status_proc_values(
+			esdm_proc_shm_status, esdm_proc_shm_cache);
+	}
+
+	*val = esdm_proc_shm_cache[type];
+
+out:
+	mutex_w_unlock(&esdm_proc_shm_lock);
+	return ret;
+}
+
 static int esdm_proc_data(struct esdm_proc_file *file,
+			  enum esdm_proc_shm_value type,
 			  int (*content)(unsigned int *entcnt))
 {
 	unsigned int val = 0;
+	uint32_t shm_val;
 	int ret;
 
-	esdm_invoke(content(&val));
+	if (!esdm_proc_shm_value(type, &shm_val)) {
+		val = shm_val;
+		ret = 0;
+	} else {
+		esdm_invoke(content(&val));
+	}
+
 	if (ret) {
 		esdm_proc_empty_file(file);
 	} else {
@@ -166,17 +265,20 @@ static int esdm_proc_data(struct esdm_proc_file *file,
 
 static int esdm_proc_poolsize(struct esdm_proc_file *file)
 {
-	return esdm_proc_data(file, esdm_rpcc_get_poolsize);
+	return esdm_proc_data(file, esdm_proc_shm_poolsize,
+			      esdm_rpcc_get_poolsize);
 }
 
 static int esdm_proc_get_ent(struct esdm_proc_file *file)
 {
-	return esdm_proc_data(file, esdm_rpcc_rnd_get_ent_cnt);
+	return esdm_proc_data(file, esdm_proc_shm_entropy_avail,
+			      esdm_rpcc_rnd_get_ent_cnt);
 }
 
 static int esdm_proc_get_write_wakeup_thresh(struct esdm_proc_file *file)
 {
-	return esdm_proc_data(file, esdm_rpcc_get_write_wakeup_thresh);
+	return esdm_proc_data(file, esdm_proc_shm_write_wakeup_thresh,
+			      esdm_rpcc_get_write_wakeup_thresh);
 }
 
 static int esdm_proc_set_write_wakeup_thresh(struct esdm_proc_file *file,
@@ -200,7 +302,8 @@ static int esdm_proc_set_write_wakeup_thresh(struct esdm_proc_file *file,
 
 static int esdm_proc_get_min_reseed_secs(struct esdm_proc_file *file)
 {
-	return esdm_proc_data(file, esdm_rpcc_get_min_reseed_secs);
+	return esdm_proc_data(file, esdm_proc_shm_min_reseed_secs,
+			      esdm_rpcc_get_min_reseed_secs);
 }
 
 static int esdm_proc_set_min_reseed_secs(struct esdm_proc_file *file,
@@ -310,6 +413,7 @@ static void esdm_proc_term(void)
 {
 	esdm_rpcc_fini_priv_service();
 	esdm_rpcc_fini_unpriv_service();
+	esdm_proc_shm_status_close();
 }
 
 static int esdm_proc_pre_init(void)
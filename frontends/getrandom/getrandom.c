@@ -19,8 +19,16 @@
 
 #define _GNU_SOURCE
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/random.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 
@@ -29,6 +37,7 @@
 #include "config.h"
 #include "constructor.h"
 #include "esdm_rpc_client.h"
+#include "memset_secure.h"
 #include "mutex.h"
 #include "visibility.h"
 
@@ -53,24 +62,282 @@
 static atomic_bool_t is_initialized = ATOMIC_BOOL_INIT(false);
 static DEFINE_MUTEX_UNLOCKED(getrandom_mutex);
 
+#if ESDM_GETRANDOM_BUFFER_SIZE > 0
+
+/*
+ * Per-thread buffer of random numbers: small requests are served from the
+ * buffer which is refilled with one RPC call once it is exhausted. Consumed
+ * random numbers are erased immediately. The buffer is erased when the
+ * thread terminates and in the child after a fork.
+ */
+#define ESDM_GETRANDOM_BUFFER_MAX_REQ 256
+
+struct esdm_getrandom_buffer {
+	uint8_t buf[ESDM_GETRANDOM_BUFFER_SIZE];
+	size_t avail;
+};
+
+static __thread struct esdm_getrandom_buffer esdm_getrandom_buffer;
+static __thread bool esdm_getrandom_buffer_registered = false;
+static pthread_key_t esdm_getrandom_buffer_key;
+static bool esdm_getrandom_buffer_key_valid = false;
+
+static void esdm_getrandom_buffer_clear(struct esdm_getrandom_buffer *rbuf)
+{
+	memset_secure(rbuf->buf, 0, sizeof(rbuf->buf));
+	rbuf->avail = 0;
+}
+
+/* Thread terminates */
+static void esdm_getrandom_buffer_destructor(void *data)
+{
+	struct esdm_getrandom_buffer *rbuf = data;
+
+	if (rbuf)
+		esdm_getrandom_buffer_clear(rbuf);
+}
+
+/* The child must never return the random numbers of the parent */
+static void esdm_getrandom_buffer_atfork_child(void)
+{
+	esdm_getrandom_buffer_clear(&esdm_getrandom_buffer);
+}
+
+static void esdm_getrandom_buffer_init(void)
+{
+	if (pthread_key_create(&esdm_getrandom_buffer_key,
+			       esdm_getrandom_buffer_destructor))
+		return;
+
+	if (pthread_atfork(NULL, NULL, esdm_getrandom_buffer_atfork_child)) {
+		pthread_key_delete(esdm_getrandom_buffer_key);
+		return;
+	}
+
+	esdm_getrandom_buffer_key_valid = true;
+}
+
+/*
+ * Serve the request from the buffer, returns false if the request must be
+ * processed with an RPC call.
+ */
+static bool esdm_getrandom_buffer_get(void *buffer, size_t length)
+{
+	struct esdm_getrandom_buffer *rbuf = &esdm_getrandom_buffer;
+	ssize_t ret;
+
+	if (!esdm_getrandom_buffer_key_valid ||
+	    length > ESDM_GETRANDOM_BUFFER_MAX_REQ)
+		return false;
+
+	/* Ensure the buffer is erased when the thread terminates */
+	if (!esdm_getrandom_buffer_registered) {
+		if (pthread_setspecific(esdm_getrandom_buffer_key, rbuf))
+			return false;
+		esdm_getrandom_buffer_registered = true;
+	}
+
+	if (rbuf->avail < length) {
+		esdm_getrandom_buffer_clear(rbuf);
+		esdm_invoke(esdm_rpcc_get_random_bytes_full(rbuf->buf,
+							    sizeof(rbuf->buf)));
+		if (ret < (ssize_t)length)
+			return false;
+		rbuf->avail = (size_t)ret;
+	}
+
+	/* Consume the random numbers from the end of the buffer */
+	rbuf->avail -= length;
+	memcpy(buffer, rbuf->buf + rbuf->avail, length);
+	memset_secure(rbuf->buf + rbuf->avail, 0, length);
+
+	return true;
+}
+
+#else /* ESDM_GETRANDOM_BUFFER_SIZE */
+
+static void esdm_getrandom_buffer_init(void)
+{
+}
+
+static bool esdm_getrandom_buffer_get(void *buffer, size_t length)
+{
+	(void)buffer;
+	(void)length;
+	return false;
+}
+
+#endif /* ESDM_GETRANDOM_BUFFER_SIZE */
+
+#if defined(ESDM_GETRANDOM_LEASE) && defined(ESDM_DRNG_LEASE)
+
+/*
+ * Per-thread DRNG seeded with a lease from the ESDM server: all regular
+ * requests are served without RPC call. The lease renews itself when it
+ * expires, after a fork or when the ESDM server announces a new generation
+ * of its DRNG state. If the caller is not permitted to lease a seed, the
+ * thread uses the RPC calls.
+ */
+static __thread struct esdm_rpcc_drng_lease *esdm_getrandom_lease = NULL;
+static __thread bool esdm_getrandom_lease_unavail = false;
+static pthread_key_t esdm_getrandom_lease_key;
+static bool esdm_getrandom_lease_key_valid = false;
+
+/* Thread terminates */
+static void esdm_getrandom_lease_destructor(void *data)
+{
+	esdm_rpcc_lease_drng_free(data);
+}
+
+static void esdm_getrandom_lease_init(void)
+{
+	if (pthread_key_create(&esdm_getrandom_lease_key,
+			       esdm_getrandom_lease_destructor))
+		return;
+
+	esdm_getrandom_lease_key_valid = true;
+}
+
+/*
+ * Serve the request from the leased DRNG, returns false if the request must
+ * be processed with an RPC call.
+ */
+static bool esdm_getrandom_lease_get(void *buffer, size_t length)
+{
+	ssize_t ret;
+
+	if (!esdm_getrandom_lease_key_valid || esdm_getrandom_lease_unavail)
+		return false;
+
+	if (!esdm_getrandom_lease) {
+		struct esdm_rpcc_drng_lease *lease;
+
+		if (esdm_rpcc_lease_drng(&lease)) {
+			esdm_getrandom_lease_unavail = true;
+			return false;
+		}
+
+		if (pthread_setspecific(esdm_getrandom_lease_key, lease)) {
+			esdm_rpcc_lease_drng_free(lease);
+			esdm_getrandom_lease_unavail = true;
+			return false;
+		}
+
+		esdm_getrandom_lease = lease;
+	}
+
+	ret = esdm_rpcc_lease_get_random_bytes(esdm_getrandom_lease, buffer,
+					       length);
+
+	return (ret == (ssize_t)length);
+}
+
+#else /* ESDM_GETRANDOM_LEASE && ESDM_DRNG_LEASE */
+
+static void esdm_getrandom_lease_init(void)
+{
+}
+
+static bool esdm_getrandom_lease_get(void *buffer, size_t length)
+{
+	(void)buffer;
+	(void)length;
+	return false;
+}
+
+#endif /* ESDM_GETRANDOM_LEASE && ESDM_DRNG_LEASE */
+
 static void esdm_getrandom_lib_init(void)
 {
 	mutex_lock(&getrandom_mutex);
 
+	if (atomic_bool_read(&is_initialized))
+		goto out;
+
+	esdm_getrandom_buffer_init();
+	esdm_getrandom_lease_init();
+
 #if ESDM_GETRANDOM_NUM_NODES > 0
-	esdm_rpcc_set_max_online_nodes(ESDM_GETRANDOM_NUM_NODES);
+	esdm_rpcc_set_connection_pool_size(ESDM_GETRANDOM_NUM_NODES);
 #endif
 
 	/* Return code irrelevant due to fallback in functions below */
 	esdm_rpcc_init_unpriv_service(NULL);
 
 	atomic_bool_set_true(&is_initialized);
+
+out:
 	mutex_unlock(&getrandom_mutex);
 }
 
+/* Upper bound of the histogram bucket holding the 99th percentile */
+static uint64_t
+esdm_getrandom_stats_p99(const struct esdm_rpcc_stats_method *m)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < ESDM_RPCC_STATS_LAT_BUCKETS - 1; i++) {
+		sum += m->latency_hist[i];
+		if (sum * 100 >= m->latency_count * 99)
+			break;
+	}
+
+	return 1ULL << (10 + i);
+}
+
+/*
+ * Print the client statistics to stderr if requested with the environment
+ * variable ESDM_GETRANDOM_STATS.
+ */
+static void esdm_getrandom_stats_dump(void)
+{
+	struct esdm_rpcc_stats *stats;
+	unsigned int i;
+
+#ifdef HAVE_SECURE_GETENV
+	if (!secure_getenv("ESDM_GETRANDOM_STATS"))
+#else
+	if (!getenv("ESDM_GETRANDOM_STATS"))
+#endif
+		return;
+
+	stats = malloc(sizeof(*stats));
+	if (!stats)
+		return;
+
+	if (esdm_rpcc_get_stats(stats))
+		goto out;
+
+	fprintf(stderr,
+		"ESDM getrandom statistics of process %d:\n"
+		"connects: %" PRIu64 ", connect failures: %" PRIu64
+		", failovers: %" PRIu64 ", retries: %" PRIu64
+		", fallbacks: %" PRIu64 "\n",
+		(int)getpid(), stats->connects, stats->connect_failures,
+		stats->failovers, stats->retries, stats->fallbacks);
+
+	for (i = 0; i < stats->method_num; i++) {
+		const struct esdm_rpcc_stats_method *m = &stats->method[i];
+
+		fprintf(stderr,
+			"%s: calls %" PRIu64 ", errors %" PRIu64
+			", avg latency %" PRIu64 " ns, p99 latency < %" PRIu64
+			" ns\n",
+			m->name, m->calls, m->errors,
+			m->latency_count ? m->latency_sum_ns / m->latency_count :
+					   0,
+			m->latency_count ? esdm_getrandom_stats_p99(m) : 0);
+	}
+
+out:
+	free(stats);
+}
+
 ESDM_DEFINE_DESTRUCTOR(esdm_getrandom_lib_exit);
 static void esdm_getrandom_lib_exit(void)
 {
+	esdm_getrandom_stats_dump();
 	esdm_rpcc_fini_unpriv_service();
 }
 
@@ -81,6 +348,25 @@ ssize_t __real_getrandom(void *__buffer, size_t __length, unsigned int __flags)
 	return syscall(__NR_getrandom, __buffer, __length, __flags);
 }
 
+/*
+ * A non-blocking request for cryptographically strong random numbers fails
+ * while the ESDM server is not fully seeded. If the status segment of the
+ * server says so, the request fails without an RPC call. Without the status
+ * segment, the RPC calls below decide.
+ */
+static bool esdm_getrandom_would_block(unsigned int flags)
+{
+	bool fully_seeded;
+
+	if (!(flags & GRND_NONBLOCK) || (flags & (GRND_INSECURE | GRND_SEED)))
+		return false;
+
+	if (esdm_rpcc_seed_state_cached(NULL, &fully_seeded))
+		return false;
+
+	return !fully_seeded;
+}
+
 static ssize_t getrandom_common(void *buffer, size_t length, unsigned int flags)
 {
 	ssize_t ret;
@@ -110,6 +396,20 @@ static ssize_t getrandom_common(void *buffer, size_t length, unsigned int flags)
 		esdm_getrandom_lib_init();
 	}
 
+	if (esdm_getrandom_would_block(flags)) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	/*
+	 * Regular random numbers are generated with the leased DRNG, small
+	 * requests use the buffer.
+	 */
+	if (!(flags & (GRND_RANDOM | GRND_SEED | GRND_FULLY_SEEDED)) &&
+	    (esdm_getrandom_lease_get(buffer, length) ||
+	     esdm_getrandom_buffer_get(buffer, length)))
+		return (ssize_t)length;
+
 	if (flags & GRND_INSECURE) {
 		esdm_invoke(esdm_rpcc_get_random_bytes(buffer, length));
 	} else if (flags & GRND_RANDOM) {
@@ -134,6 +434,7 @@ static ssize_t getrandom_common(void *buffer, size_t length, unsigned int flags)
 	if (ret >= 0)
 		return ret;
 
+	esdm_rpcc_stats_fallback();
 	return syscall(__NR_getrandom, buffer, length, flags);
 }
 
@@ -172,9 +473,16 @@ static int getentropy_common(void *buffer, size_t length)
 		esdm_getrandom_lib_init();
 	}
 
+	if (esdm_getrandom_lease_get(buffer, length) ||
+	    esdm_getrandom_buffer_get(buffer, length))
+		return 0;
+
 	esdm_invoke(esdm_rpcc_get_random_bytes_full(buffer, length));
 	if (ret < 0) {
-		ssize_t rc = syscall(__NR_getrandom, buffer, length, 0);
+		ssize_t rc;
+
+		esdm_rpcc_stats_fallback();
+		rc = syscall(__NR_getrandom, buffer, length, 0);
 
 		/* Kernel returned an error */
 		if (rc < 0) {
@@ -204,3 +512,230 @@ int getentropy(void *buffer, size_t length)
 {
 	return getentropy_common(buffer, length);
 }
+
+#ifdef ESDM_GETRANDOM_DEVFILES
+
+/*
+ * Interception of the random device files: file descriptors of /dev/random
+ * and /dev/urandom opened with open(2) or openat(2) are recorded and reads
+ * from them are served like getrandom(2) calls, i.e. with the per-thread
+ * buffer or the leased DRNG if available.
+ *
+ * The file descriptor always refers to the real device file. As the file
+ * descriptor may be closed by functions not covered here (e.g. fclose after
+ * fdopen), every read verifies that the file descriptor still refers to the
+ * recorded device. Otherwise, the read is forwarded to the kernel.
+ */
+#define ESDM_GETRANDOM_DEVFILES_MAX_FD 4096
+
+enum esdm_getrandom_devfile_type {
+	esdm_getrandom_devfile_none,
+	esdm_getrandom_devfile_random,
+	esdm_getrandom_devfile_urandom,
+};
+
+struct esdm_getrandom_devfile {
+	uint64_t dev;
+	uint64_t ino;
+	unsigned int flags;
+	unsigned int type;
+};
+
+static struct esdm_getrandom_devfile
+	esdm_getrandom_devfiles[ESDM_GETRANDOM_DEVFILES_MAX_FD];
+
+static void esdm_getrandom_devfile_track(int fd, const char *path, int oflag)
+{
+	struct esdm_getrandom_devfile *df;
+	struct stat sb;
+	unsigned int type, flags;
+
+	if (fd < 0 || fd >= ESDM_GETRANDOM_DEVFILES_MAX_FD || !path)
+		return;
+
+	df = &esdm_getrandom_devfiles[fd];
+	__atomic_store_n(&df->type, esdm_getrandom_devfile_none,
+			 __ATOMIC_RELEASE);
+
+	if (!strcmp(path, "/dev/urandom")) {
+		/* Behave like the CUSE /dev/urandom */
+		type = esdm_getrandom_devfile_urandom;
+		flags = GRND_INSECURE;
+	} else if (!strcmp(path, "/dev/random")) {
+		type = esdm_getrandom_devfile_random;
+		flags = (oflag & O_NONBLOCK) ? GRND_NONBLOCK : 0;
+	} else {
+		return;
+	}
+
+	if ((oflag & O_ACCMODE) == O_WRONLY || fstat(fd, &sb) ||
+	    !S_ISCHR(sb.st_mode))
+		return;
+
+	/* O_SYNC requests prediction resistance as with the CUSE devices */
+	if (oflag & O_SYNC)
+		flags = GRND_RANDOM | ((oflag & O_NONBLOCK) ? GRND_NONBLOCK : 0);
+
+	__atomic_store_n(&df->dev, (uint64_t)sb.st_rdev, __ATOMIC_RELAXED);
+	__atomic_store_n(&df->ino, (uint64_t)sb.st_ino, __ATOMIC_RELAXED);
+	__atomic_store_n(&df->flags, flags, __ATOMIC_RELAXED);
+	__atomic_store_n(&df->type, type, __ATOMIC_RELEASE);
+}
+
+static void esdm_getrandom_devfile_untrack(int fd)
+{
+	if (fd < 0 || fd >= ESDM_GETRANDOM_DEVFILES_MAX_FD)
+		return;
+
+	__atomic_store_n(&esdm_getrandom_devfiles[fd].type,
+			 esdm_getrandom_devfile_none, __ATOMIC_RELEASE);
+}
+
+/*
+ * Return the getrandom flags to serve a read from the file descriptor, or
+ * false if the read must be processed by the kernel.
+ */
+static bool esdm_getrandom_devfile_flags(int fd, unsigned int *flags)
+{
+	struct esdm_getrandom_devfile *df;
+	struct stat sb;
+
+	if (fd < 0 || fd >= ESDM_GETRANDOM_DEVFILES_MAX_FD)
+		return false;
+
+	df = &esdm_getrandom_devfiles[fd];
+	if (__atomic_load_n(&df->type, __ATOMIC_ACQUIRE) ==
+	    esdm_getrandom_devfile_none)
+		return false;
+
+	if (fstat(fd, &sb) ||
+	    (uint64_t)sb.st_rdev !=
+		    __atomic_load_n(&df->dev, __ATOMIC_RELAXED) ||
+	    (uint64_t)sb.st_ino !=
+		    __atomic_load_n(&df->ino, __ATOMIC_RELAXED)) {
+		esdm_getrandom_devfile_untrack(fd);
+		return false;
+	}
+
+	*flags = __atomic_load_n(&df->flags, __ATOMIC_RELAXED);
+	return true;
+}
+
+static int esdm_getrandom_devfile_open(int dirfd, const char *path, int oflag,
+				       mode_t mode)
+{
+	int fd = (int)syscall(__NR_openat, dirfd, path, oflag, mode);
+
+	esdm_getrandom_devfile_track(fd, path, oflag);
+	return fd;
+}
+
+/* The mode is only present if a file may be created */
+#define ESDM_GETRANDOM_OPEN_MODE(mode, oflag)                                  \
+	do {                                                                   \
+		if ((oflag) & (O_CREAT | O_TMPFILE)) {                        \
+			va_list ap;                                            \
+                                                                               \
+			va_start(ap, oflag);                                   \
+			mode = (mode_t)va_arg(ap, int);                        \
+			va_end(ap);                                            \
+		}                                                              \
+	} while (0)
+
+DSO_PUBLIC
+int open(const char *path, int oflag, ...)
+{
+	mode_t mode = 0;
+
+	ESDM_GETRANDOM_OPEN_MODE(mode, oflag);
+	return esdm_getrandom_devfile_open(AT_FDCWD, path, oflag, mode);
+}
+
+DSO_PUBLIC
+int open64(const char *path, int oflag, ...)
+{
+	mode_t mode = 0;
+
+	ESDM_GETRANDOM_OPEN_MODE(mode, oflag);
+	return esdm_getrandom_devfile_open(AT_FDCWD, path, oflag | O_LARGEFILE,
+					   mode);
+}
+
+DSO_PUBLIC
+int openat(int dirfd, const char *path, int oflag, ...)
+{
+	mode_t mode = 0;
+
+	ESDM_GETRANDOM_OPEN_MODE(mode, oflag);
+	return esdm_getrandom_devfile_open(dirfd, path, oflag, mode);
+}
+
+DSO_PUBLIC
+int openat64(int dirfd, const char *path, int oflag, ...)
+{
+	mode_t mode = 0;
+
+	ESDM_GETRANDOM_OPEN_MODE(mode, oflag);
+	return esdm_getrandom_devfile_open(dirfd, path, oflag | O_LARGEFILE,
+					   mode);
+}
+
+/* Variants used with _FORTIFY_SOURCE if no mode is given */
+int __open_2(const char *path, int oflag);
+DSO_PUBLIC
+int __open_2(const char *path, int oflag)
+{
+	return esdm_getrandom_devfile_open(AT_FDCWD, path, oflag, 0);
+}
+
+int __open64_2(const char *path, int oflag);
+DSO_PUBLIC
+int __open64_2(const char *path, int oflag)
+{
+	return esdm_getrandom_devfile_open(AT_FDCWD, path, oflag | O_LARGEFILE,
+					   0);
+}
+
+int __openat_2(int dirfd, const char *path, int oflag);
+DSO_PUBLIC
+int __openat_2(int dirfd, const char *path, int oflag)
+{
+	return esdm_getrandom_devfile_open(dirfd, path, oflag, 0);
+}
+
+int __openat64_2(int dirfd, const char *path, int oflag);
+DSO_PUBLIC
+int __openat64_2(int dirfd, const char *path, int oflag)
+{
+	return esdm_getrandom_devfile_open(dirfd, path, oflag | O_LARGEFILE, 0);
+}
+
+DSO_PUBLIC
+ssize_t read(int fd, void *buf, size_t count)
+{
+	unsigned int flags;
+
+	if (!esdm_getrandom_devfile_flags(fd, &flags))
+		return syscall(__NR_read, fd, buf, count);
+
+	return getrandom_common(buf, count, flags);
+}
+
+ssize_t __read_chk(int fd, void *buf, size_t count, size_t buflen);
+DSO_PUBLIC
+ssize_t __read_chk(int fd, void *buf, size_t count, size_t buflen)
+{
+	if (count > buflen)
+		abort();
+
+	return read(fd, buf, count);
+}
+
+DSO_PUBLIC
+int close(int fd)
+{
+	esdm_getrandom_devfile_untrack(fd);
+	return (int)syscall(__NR_close, fd);
+}
+
+#endif /* ESDM_GETRANDOM_DEVFILES */
@@ -22,9 +22,12 @@
 #include <openssl/crypto.h>
 #include <openssl/evp.h>
 #include <openssl/params.h>
+#include <pthread.h>
 #include <string.h>
+#include <time.h>
 
 #include "common.h"
+#include "config.h"
 #include "esdm_rpc_client.h"
 #include "helper.h"
 #include "math_helper.h"
@@ -34,6 +37,441 @@
  * RAND specific provider functions *
  ************************************/
 
+#if defined(ESDM_OPENSSL_PROVIDER_LEASE) && defined(ESDM_DRNG_LEASE)
+
+/*
+ * Each RAND context owns a DRNG seeded with a lease from the ESDM server: all
+ * regular generate requests are served without RPC call. The lease renews
+ * itself when it expires, after a fork or when the ESDM server announces a
+ * new generation of its DRNG state. A context shared between threads has one
+ * lease per thread (see esdm_rand_state_get). If the caller is not permitted
+ * to lease a seed, the context uses the RPC calls.
+ */
+static int esdm_rand_lease_get(struct esdm_rand_state *state,
+			       unsigned char *out, size_t outlen)
+{
+	ssize_t ret;
+
+	if (!state || state->lease_unavail)
+		return 0;
+
+	if (!state->lease && esdm_rpcc_lease_drng(&state->lease)) {
+		state->lease = NULL;
+		state->lease_unavail = 1;
+		return 0;
+	}
+
+	ret = esdm_rpcc_lease_get_random_bytes(state->lease, out, outlen);
+
+	return (ret == (ssize_t)outlen);
+}
+
+static void esdm_rand_lease_free(struct esdm_rand_state *state)
+{
+	esdm_rpcc_lease_drng_free(state->lease);
+	state->lease = NULL;
+}
+
+#else /* ESDM_OPENSSL_PROVIDER_LEASE && ESDM_DRNG_LEASE */
+
+static int esdm_rand_lease_get(struct esdm_rand_state *state __unused,
+			       unsigned char *out __unused,
+			       size_t outlen __unused)
+{
+	return 0;
+}
+
+static void esdm_rand_lease_free(struct esdm_rand_state *state __unused)
+{
+}
+
+#endif /* ESDM_OPENSSL_PROVIDER_LEASE && ESDM_DRNG_LEASE */
+
+/*
+ * Seed data as returned by esdm_rpcc_get_seed, the buffer should be large
+ * enough for the entropy from all active sources.
+ */
+#define ENTROPY_BUFFER_SIZE 2048
+struct esdm_seed_buffer {
+	uint64_t len;
+	uint64_t entropy_bits;
+	uint8_t buf[ENTROPY_BUFFER_SIZE];
+} __attribute__((__packed__));
+
+static int esdm_rand_seed_fetch(struct esdm_seed_buffer *seed_buffer,
+				unsigned int flags)
+{
+	ssize_t ret;
+
+	esdm_invoke(esdm_rpcc_get_seed((uint8_t *)seed_buffer,
+				       sizeof(*seed_buffer), flags));
+	if (ret <= 0)
+		return ret ? (int)ret : -ENODATA;
+
+	if (seed_buffer->len > sizeof(seed_buffer->buf)) {
+		OPENSSL_cleanse(seed_buffer, sizeof(*seed_buffer));
+		return -EMSGSIZE;
+	}
+
+	return 0;
+}
+
+#if ESDM_OPENSSL_SEED_SRC_CACHE > 0
+
+/*
+ * Cache of seed blocks shared by all contexts: a thread refills it in the
+ * background with batched GetSeed requests of up to ESDM_SEED_CACHE_BATCH
+ * blocks such that instantiating or reseeding a DRBG usually does not wait for
+ * the entropy sources. Every block is handed out once and erased immediately.
+ * The child of a fork discards all blocks of the parent.
+ */
+static struct {
+	struct esdm_seed_buffer slot[ESDM_OPENSSL_SEED_SRC_CACHE];
+	unsigned int avail;
+	unsigned int users;
+	int shutdown;
+	int running;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} esdm_seed_cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+static pthread_once_t esdm_seed_cache_once = PTHREAD_ONCE_INIT;
+
+/* Time to wait before retrying when the ESDM cannot deliver a seed */
+#define ESDM_SEED_CACHE_RETRY_SEC 1
+
+/* Maximum number of seed blocks obtained with one request */
+#define ESDM_SEED_CACHE_BATCH                                                  \
+	(ESDM_OPENSSL_SEED_SRC_CACHE < 8 ? ESDM_OPENSSL_SEED_SRC_CACHE : 8)
+
+static int esdm_seed_cache_fetch(struct esdm_seed_buffer *seed_buffer,
+				 unsigned int num)
+{
+	unsigned int i;
+	ssize_t ret;
+
+	esdm_invoke(esdm_rpcc_get_seed_blocks((uint8_t *)seed_buffer,
+					      sizeof(*seed_buffer), num,
+					      ESDM_GET_SEED_NONBLOCK));
+	if (ret <= 0)
+		return ret ? (int)ret : -ENODATA;
+
+	for (i = 0; i < (unsigned int)ret; i++) {
+		if (seed_buffer[i].len > sizeof(seed_buffer[i].buf)) {
+			OPENSSL_cleanse(seed_buffer,
+					num * sizeof(*seed_buffer));
+			return -EMSGSIZE;
+		}
+	}
+
+	return (int)ret;
+}
+
+static void *esdm_seed_cache_refill(void *arg __unused)
+{
+	struct esdm_seed_buffer *seed_buffer = OPENSSL_secure_zalloc(
+		ESDM_SEED_CACHE_BATCH * sizeof(struct esdm_seed_buffer));
+	struct timespec ts;
+	unsigned int num;
+	int ret;
+
+	if (!seed_buffer)
+		return NULL;
+
+	pthread_mutex_lock(&esdm_seed_cache.lock);
+	while (!esdm_seed_cache.shutdown) {
+		if (esdm_seed_cache.avail >= ESDM_OPENSSL_SEED_SRC_CACHE) {
+			pthread_cond_wait(&esdm_seed_cache.cond,
+					  &esdm_seed_cache.lock);
+			continue;
+		}
+		num = ESDM_OPENSSL_SEED_SRC_CACHE - esdm_seed_cache.avail;
+		if (num > ESDM_SEED_CACHE_BATCH)
+			num = ESDM_SEED_CACHE_BATCH;
+		pthread_mutex_unlock(&esdm_seed_cache.lock);
+
+		/* Do not block the termination of the provider */
+		ret = esdm_seed_cache_fetch(seed_buffer, num);
+
+		pthread_mutex_lock(&esdm_seed_cache.lock);
+		if (ret < 0) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec += ESDM_SEED_CACHE_RETRY_SEC;
+			pthread_cond_timedwait(&esdm_seed_cache.cond,
+					       &esdm_seed_cache.lock, &ts);
+			continue;
+		}
+
+		/* Only this thread adds blocks, i.e. all blocks fit */
+		num = (unsigned int)ret;
+		memcpy(&esdm_seed_cache.slot[esdm_seed_cache.avail],
+		       seed_buffer, num * sizeof(*seed_buffer));
+		esdm_seed_cache.avail += num;
+		OPENSSL_cleanse(seed_buffer, num * sizeof(*seed_buffer));
+	}
+	pthread_mutex_unlock(&esdm_seed_cache.lock);
+
+	OPENSSL_secure_clear_free(seed_buffer,
+				  ESDM_SEED_CACHE_BATCH *
+					  sizeof(struct esdm_seed_buffer));
+
+	return NULL;
+}
+
+/* Caller must hold the cache lock */
+static void esdm_seed_cache_clear(void)
+{
+	OPENSSL_cleanse(esdm_seed_cache.slot, sizeof(esdm_seed_cache.slot));
+	esdm_seed_cache.avail = 0;
+}
+
+static void esdm_seed_cache_atfork_prepare(void)
+{
+	pthread_mutex_lock(&esdm_seed_cache.lock);
+}
+
+static void esdm_seed_cache_atfork_parent(void)
+{
+	pthread_mutex_unlock(&esdm_seed_cache.lock);
+}
+
+/* The refill thread does not exist in the child, it is restarted on demand */
+static void esdm_seed_cache_atfork_child(void)
+{
+	esdm_seed_cache_clear();
+	esdm_seed_cache.running = 0;
+	pthread_mutex_unlock(&esdm_seed_cache.lock);
+}
+
+static void esdm_seed_cache_register_atfork(void)
+{
+	pthread_atfork(esdm_seed_cache_atfork_prepare,
+		       esdm_seed_cache_atfork_parent,
+		       esdm_seed_cache_atfork_child);
+}
+
+/* Caller must hold the cache lock */
+static void esdm_seed_cache_start(void)
+{
+	if (esdm_seed_cache.running || esdm_seed_cache.shutdown ||
+	    !esdm_seed_cache.users)
+		return;
+
+	if (!pthread_create(&esdm_seed_cache.thread, NULL,
+			    esdm_seed_cache_refill, NULL))
+		esdm_seed_cache.running = 1;
+}
+
+static void esdm_seed_cache_init(void)
+{
+	pthread_once(&esdm_seed_cache_once, esdm_seed_cache_register_atfork);
+
+	pthread_mutex_lock(&esdm_seed_cache.lock);
+	esdm_seed_cache.users++;
+	esdm_seed_cache.shutdown = 0;
+	esdm_seed_cache_start();
+	pthread_mutex_unlock(&esdm_seed_cache.lock);
+}
+
+static void esdm_seed_cache_fini(void)
+{
+	int running;
+
+	pthread_mutex_lock(&esdm_seed_cache.lock);
+	if (!esdm_seed_cache.users || --esdm_seed_cache.users) {
+		pthread_mutex_unlock(&esdm_seed_cache.lock);
+		return;
+	}
+
+	esdm_seed_cache.shutdown = 1;
+	running = esdm_seed_cache.running;
+	pthread_cond_broadcast(&esdm_seed_cache.cond);
+	pthread_mutex_unlock(&esdm_seed_cache.lock);
+
+	if (running)
+		pthread_join(esdm_seed_cache.thread, NULL);
+
+	pthread_mutex_lock(&esdm_seed_cache.lock);
+	esdm_seed_cache.running = 0;
+	esdm_seed_cache_clear();
+	pthread_mutex_unlock(&esdm_seed_cache.lock);
+}
+
+/* Take one seed block from the cache, returns 0 if the cache is empty */
+static int esdm_seed_cache_get(struct esdm_seed_buffer *seed_buffer)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&esdm_seed_cache.lock);
+	if (esdm_seed_cache.avail) {
+		struct esdm_seed_buffer *slot =
+			&esdm_seed_cache.slot[--esdm_seed_cache.avail];
+
+		memcpy(seed_buffer, slot, sizeof(*seed_buffer));
+		OPENSSL_cleanse(slot, sizeof(*slot));
+		ret = 1;
+	}
+
+	/* Refill the consumed block or restart the thread after a fork */
+	esdm_seed_cache_start();
+	pthread_cond_signal(&esdm_seed_cache.cond);
+	pthread_mutex_unlock(&esdm_seed_cache.lock);
+
+	return ret;
+}
+
+#else /* ESDM_OPENSSL_SEED_SRC_CACHE */
+
+static void esdm_seed_cache_init(void)
+{
+}
+
+static void esdm_seed_cache_fini(void)
+{
+}
+
+static int esdm_seed_cache_get(struct esdm_seed_buffer *seed_buffer __unused)
+{
+	return 0;
+}
+
+#endif /* ESDM_OPENSSL_SEED_SRC_CACHE */
+
+/*
+ * Additional input is not accounted with entropy and ESDM only mixes it into
+ * its auxiliary pool, i.e. it affects the output only after the next reseed of
+ * the ESDM DRNGs. Hence, it is collected in the context and sent to the ESDM
+ * server with one RPC when the buffer is full, at reseed and when the context
+ * is released instead of issuing one RPC for each generate request.
+ */
+static int esdm_rand_addin_flush(struct esdm_rand_state *state)
+{
+	int ret;
+
+	if (!state->addin_len)
+		return 0;
+
+	esdm_invoke(esdm_rpcc_write_data(state->addin, state->addin_len));
+	OPENSSL_cleanse(state->addin, state->addin_len);
+	state->addin_len = 0;
+
+	return ret;
+}
+
+static int esdm_rand_addin_add(struct esdm_rand_state *state,
+			       const unsigned char *addin, size_t addin_len)
+{
+	int ret;
+
+	if (!addin || !addin_len)
+		return 0;
+
+	if (state->addin_len + addin_len > sizeof(state->addin)) {
+		ret = esdm_rand_addin_flush(state);
+		if (ret)
+			return ret;
+	}
+
+	if (addin_len > sizeof(state->addin)) {
+		esdm_invoke(esdm_rpcc_write_data(addin, addin_len));
+		return ret;
+	}
+
+	memcpy(state->addin + state->addin_len, addin, addin_len);
+	state->addin_len += addin_len;
+
+	return 0;
+}
+
+static void esdm_rand_state_release(struct esdm_rand_state *state)
+{
+	esdm_rand_addin_flush(state);
+	esdm_rand_lease_free(state);
+}
+
+/*
+ * OpenSSL enables the locking of a context which it shares between threads,
+ * e.g. its public and private DRBG. Instead of serializing all threads on a
+ * lock, the mutable state of shared contexts is kept per thread: a thread uses
+ * one state for all shared contexts. The state is released when the thread
+ * terminates. As the RPC connections are bound to the threads as well, the
+ * threads do not contend for any resource of the provider.
+ */
+static pthread_key_t esdm_rand_state_key;
+static pthread_mutex_t esdm_rand_state_key_lock = PTHREAD_MUTEX_INITIALIZER;
+static int esdm_rand_state_key_valid = 0;
+
+static void esdm_rand_state_destructor(void *data)
+{
+	struct esdm_rand_state *state = data;
+
+	if (!state)
+		return;
+
+	esdm_rand_state_release(state);
+	OPENSSL_secure_clear_free(state, sizeof(struct esdm_rand_state));
+}
+
+static int esdm_rand_state_key_init(void)
+{
+	int valid;
+
+	pthread_mutex_lock(&esdm_rand_state_key_lock);
+	if (!esdm_rand_state_key_valid)
+		esdm_rand_state_key_valid =
+			!pthread_key_create(&esdm_rand_state_key,
+					    esdm_rand_state_destructor);
+	valid = esdm_rand_state_key_valid;
+	pthread_mutex_unlock(&esdm_rand_state_key_lock);
+
+	return valid;
+}
+
+static struct esdm_rand_state *esdm_rand_state_get(void *ctx)
+{
+	struct esdm_rand_ctx *rand = ctx;
+	struct esdm_rand_state *state;
+
+	if (!rand)
+		return NULL;
+	if (!rand->shared)
+		return &rand->state;
+
+	state = pthread_getspecific(esdm_rand_state_key);
+	if (state)
+		return state;
+
+	state = OPENSSL_secure_zalloc(sizeof(struct esdm_rand_state));
+	if (!state)
+		return NULL;
+	if (pthread_setspecific(esdm_rand_state_key, state)) {
+		OPENSSL_secure_clear_free(state, sizeof(struct esdm_rand_state));
+		return NULL;
+	}
+
+	return state;
+}
+
+/*
+ * Release the state of the calling thread, e.g. the main thread. The states of
+ * other threads still alive are released without destructor as the provider
+ * may be unloaded, i.e. they leak.
+ */
+static void esdm_rand_state_fini(void)
+{
+	pthread_mutex_lock(&esdm_rand_state_key_lock);
+	if (esdm_rand_state_key_valid) {
+		esdm_rand_state_destructor(
+			pthread_getspecific(esdm_rand_state_key));
+		pthread_key_delete(esdm_rand_state_key);
+		esdm_rand_state_key_valid = 0;
+	}
+	pthread_mutex_unlock(&esdm_rand_state_key_lock);
+}
+
 /* Context management */
 static OSSL_FUNC_rand_newctx_fn esdm_rand_newctx;
 static OSSL_FUNC_rand_freectx_fn esdm_rand_freectx;
@@ -49,8 +487,6 @@ static OSSL_FUNC_rand_clear_seed_fn esdm_rand_clear_seed;
 static OSSL_FUNC_rand_verify_zeroization_fn esdm_rand_verify_zeroization;
 /* Context Locking */
 static OSSL_FUNC_rand_enable_locking_fn esdm_rand_enable_locking;
-static OSSL_FUNC_rand_lock_fn esdm_rand_lock;
-static OSSL_FUNC_rand_unlock_fn esdm_rand_unlock;
 /* RAND parameter descriptors */
 static OSSL_FUNC_rand_gettable_ctx_params_fn esdm_rand_gettable_ctx_params;
 /* RAND parameters */
@@ -82,7 +518,7 @@ static void esdm_rand_freectx(void *ctx)
 	if (rand == NULL)
 		return;
 
-	CRYPTO_THREAD_lock_free(rand->lock);
+	esdm_rand_state_release(&rand->state);
 	OPENSSL_secure_clear_free(rand, sizeof(struct esdm_rand_ctx));
 }
 
@@ -96,29 +532,33 @@ static int esdm_rand_instantiate(void *ctx __unused,
 	return 1;
 }
 
-static int esdm_rand_uninstantiate(void *ctx __unused)
+static int esdm_rand_uninstantiate(void *ctx)
 {
+	struct esdm_rand_state *state = esdm_rand_state_get(ctx);
+
+	if (state)
+		esdm_rand_state_release(state);
 	return 1;
 }
 
-static int esdm_rand_generate(void *ctx __unused, unsigned char *out,
+static int esdm_rand_generate(void *ctx, unsigned char *out,
 			      size_t outlen, unsigned int strength __unused,
 			      int prediction_resistance,
 			      const unsigned char *addin, size_t addin_len)
 {
+	struct esdm_rand_state *state = esdm_rand_state_get(ctx);
 	ssize_t ret;
 
-	if (!out)
+	if (!out || !state)
 		goto err;
 
-	if (addin && addin_len > 0) {
-		esdm_invoke(esdm_rpcc_write_data(addin, addin_len));
-		if (ret != 0)
-			goto err;
-	}
+	if (esdm_rand_addin_add(state, addin, addin_len))
+		goto err;
 
 	if (prediction_resistance) {
 		esdm_invoke(esdm_rpcc_get_random_bytes_pr(out, outlen));
+	} else if (esdm_rand_lease_get(state, out, outlen)) {
+		return 1;
 	} else {
 		esdm_invoke(esdm_rpcc_get_random_bytes_full(out, outlen));
 	}
@@ -131,18 +571,19 @@ err:
 	return 0;
 }
 
-static int esdm_rand_reseed(void *ctx __unused,
-			    int prediction_resistance __unused,
+static int esdm_rand_reseed(void *ctx, int prediction_resistance __unused,
 			    const unsigned char *ent, size_t ent_len,
 			    const unsigned char *addin, size_t addin_len)
 {
-	ssize_t ret;
+	struct esdm_rand_state *state = esdm_rand_state_get(ctx);
+
+	if (!state)
+		return 0;
 
 	/* unaccounted writing of additional data does no harm */
-	if (ent && ent_len > 0)
-		esdm_invoke(esdm_rpcc_write_data(ent, ent_len));
-	if (addin && addin_len > 0)
-		esdm_invoke(esdm_rpcc_write_data(addin, addin_len));
+	esdm_rand_addin_add(state, ent, ent_len);
+	esdm_rand_addin_add(state, addin, addin_len);
+	esdm_rand_addin_flush(state);
 
 	return 1;
 }
@@ -164,51 +605,44 @@ static size_t esdm_rand_nonce(void *ctx __unused, unsigned char *out,
 		return 0;
 }
 
-static size_t esdm_rand_get_seed(void *ctx __unused, unsigned char **buffer,
-				 int entropy_bits, size_t min_len __unused,
-				 size_t max_len __unused,
+static size_t esdm_rand_get_seed(void *ctx, unsigned char **buffer,
+				 int entropy_bits, size_t min_len,
+				 size_t max_len,
 				 int prediction_resistance __unused,
 				 const unsigned char *addin, size_t addin_len)
 {
-#define ENTROPY_BUFFER_SIZE 2048
-	struct esdm_seed_buffer {
-		uint64_t len;
-		uint64_t entropy_bits;
-		/* should be large enough for entropy from all active sources */
-		uint8_t buf[ENTROPY_BUFFER_SIZE];
-	} __attribute__((__packed__));
-	size_t seed_buffer_size = sizeof(struct esdm_seed_buffer);
+	struct esdm_rand_state *state = esdm_rand_state_get(ctx);
 	struct esdm_seed_buffer *seed_buffer = NULL;
-	ssize_t ret;
 
 	if (ENTROPY_BUFFER_SIZE < min_len)
 		goto err;
 	if (ENTROPY_BUFFER_SIZE >= max_len)
 		goto err;
 
-	if (addin && addin_len > 0) {
-		esdm_invoke(esdm_rpcc_write_data(addin, addin_len));
-		if (ret != 0)
-			goto err;
-	}
+	if (!state || esdm_rand_addin_add(state, addin, addin_len))
+		goto err;
 
-	seed_buffer = OPENSSL_secure_zalloc(ENTROPY_BUFFER_SIZE);
-	esdm_invoke(esdm_rpcc_get_seed((uint8_t *)seed_buffer,
-				       ENTROPY_BUFFER_SIZE, 0));
-	if (ret <= 0)
+	seed_buffer = OPENSSL_secure_zalloc(sizeof(struct esdm_seed_buffer));
+	if (!seed_buffer)
+		goto err;
+
+	if (!esdm_seed_cache_get(seed_buffer) &&
+	    esdm_rand_seed_fetch(seed_buffer, 0))
 		goto err;
 
 	if (seed_buffer->entropy_bits < (uint64_t)entropy_bits)
 		goto err;
 
 	*buffer = OPENSSL_secure_zalloc(ENTROPY_BUFFER_SIZE);
+	if (!*buffer)
+		goto err;
 	memcpy(*buffer, seed_buffer->buf, ENTROPY_BUFFER_SIZE);
-	OPENSSL_secure_clear_free(seed_buffer, ENTROPY_BUFFER_SIZE);
+	OPENSSL_secure_clear_free(seed_buffer, sizeof(struct esdm_seed_buffer));
 
 	return ENTROPY_BUFFER_SIZE;
 
 err:
-	OPENSSL_secure_clear_free(seed_buffer, seed_buffer_size);
+	OPENSSL_secure_clear_free(seed_buffer, sizeof(struct esdm_seed_buffer));
 	*buffer = NULL;
 	return 0;
 }
@@ -224,30 +658,19 @@ static int esdm_rand_verify_zeroization(void *ctx __unused)
 	return 1;
 }
 
+/*
+ * A shared context needs no lock as its state is per thread. Without lock and
+ * unlock functions, OpenSSL does not serialize the access to the context.
+ */
 static int esdm_rand_enable_locking(void *ctx)
 {
 	struct esdm_rand_ctx *rand = ctx;
 
-	rand->lock = CRYPTO_THREAD_lock_new();
-	return 1;
-}
-
-static int esdm_rand_lock(void *ctx)
-{
-	struct esdm_rand_ctx *rand = ctx;
-
-	if (rand == NULL || rand->lock == NULL)
-		return 1;
-	return CRYPTO_THREAD_write_lock(rand->lock);
-}
-
-static void esdm_rand_unlock(void *ctx)
-{
-	struct esdm_rand_ctx *rand = ctx;
+	if (!rand || !esdm_rand_state_key_init())
+		return 0;
 
-	if (rand == NULL || rand->lock == NULL)
-		return;
-	CRYPTO_THREAD_unlock(rand->lock);
+	rand->shared = 1;
+	return 1;
 }
 
 static const OSSL_PARAM *esdm_rand_gettable_ctx_params(void *ctx __unused,
@@ -302,8 +725,6 @@ const OSSL_DISPATCH esdm_rand_functions[] = {
 	/* Context Locking */
 	{ OSSL_FUNC_RAND_ENABLE_LOCKING,
 	  (void (*)(void))esdm_rand_enable_locking },
-	{ OSSL_FUNC_RAND_LOCK, (void (*)(void))esdm_rand_lock },
-	{ OSSL_FUNC_RAND_UNLOCK, (void (*)(void))esdm_rand_unlock },
 	/* RAND parameter descriptors */
 	{ OSSL_FUNC_RAND_GETTABLE_CTX_PARAMS,
 	  (void (*)(void))esdm_rand_gettable_ctx_params },
@@ -399,6 +820,8 @@ static void esdm_teardown(void *provctx)
 	struct esdm_provider_ctx *cprov = provctx;
 
 	OPENSSL_secure_clear_free(cprov, sizeof(struct esdm_provider_ctx));
+	esdm_seed_cache_fini();
+	esdm_rand_state_fini();
 	esdm_rpcc_fini_unpriv_service();
 }
 
@@ -429,6 +852,9 @@ DSO_PUBLIC int OSSL_provider_init(const OSSL_CORE_HANDLE *handle,
 
 	esdm_rpcc_init_unpriv_service(NULL);
 
+	/* Threads of OpenSSL do not contend for a connection */
+	esdm_rpcc_set_thread_bound_connections(true);
+
 	cprov->core = handle;
 	if ((cprov->libctx = OSSL_LIB_CTX_new_child(handle, in)) == NULL)
 		goto err;
@@ -436,6 +862,9 @@ DSO_PUBLIC int OSSL_provider_init(const OSSL_CORE_HANDLE *handle,
 	*out = esdm_dispatch_table;
 	*provctx = cprov;
 
+	/* Start collecting seed blocks before the first DRBG is instantiated */
+	esdm_seed_cache_init();
+
 	return 1;
 
 err:
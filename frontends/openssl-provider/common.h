@@ -35,9 +35,29 @@ struct esdm_provider_ctx {
 	OSSL_LIB_CTX *libctx;
 };
 
+/*
+ * Additional input collected from generate requests before it is sent to the
+ * ESDM server with one write_data RPC.
+ */
+#define ESDM_RAND_ADDIN_BUFFER_SIZE 1024
+
+struct esdm_rpcc_drng_lease;
+
+/* Mutable state of a RAND context */
+struct esdm_rand_state {
+	/* Local DRNG seeded by the ESDM server, NULL if not yet leased */
+	struct esdm_rpcc_drng_lease *lease;
+	/* The ESDM server refused the lease, RPC calls are used */
+	int lease_unavail;
+	size_t addin_len;
+	uint8_t addin[ESDM_RAND_ADDIN_BUFFER_SIZE];
+};
+
 struct esdm_rand_ctx {
 	const OSSL_CORE_HANDLE *core;
-	CRYPTO_RWLOCK *lock;
+	/* The context is shared between threads, each thread has its state */
+	int shared;
+	struct esdm_rand_state state;
 };
 
 extern const OSSL_DISPATCH esdm_rand_functions[];
@@ -26,11 +26,14 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "config.h"
 #include "esdm.h"
 #include "esdm_config.h"
 #include "esdm_rpc_server.h"
+#include "esdm_rpc_server_handover.h"
 #include "esdm_logger.h"
 #include "ret_checkers.h"
+#include "threading_support.h"
 
 static unsigned int verbosity = 0;
 static unsigned int foreground = 0;
@@ -38,6 +41,9 @@ static unsigned int foreground = 0;
 static char *pidfile = NULL;
 static int pidfile_fd = -1;
 static const char *username = NULL;
+static uint32_t shard = 0, shards = 0;
+static char *config_file = NULL;
+static unsigned int initramfs = 0;
 
 /*******************************************************************
  * General helper functions
@@ -73,9 +79,95 @@ static void usage(void)
 		"\t   --jent_block_disable\tDisable Jitter RNG block collection\n");
 	fprintf(stderr,
 		"\t-S --syslog\tLog to syslog instead of stdout/stderr\n");
+	fprintf(stderr,
+		"\t   --drng_max_reqsize\tMaximum DRNG request size in bytes\n");
+	fprintf(stderr,
+		"\t\t\t\t(default: selected for DRNG during self test)\n");
+	fprintf(stderr,
+		"\t   --drng_cpu_affine\tBind callers to their CPU while using\n");
+	fprintf(stderr, "\t\t\t\tthe DRNG instance of the CPU\n");
+	fprintf(stderr,
+		"\t   --es_collect_timeout\tCollect the entropy sources in parallel\n");
+	fprintf(stderr,
+		"\t\t\t\twith the given timeout in milliseconds\n");
+	fprintf(stderr,
+		"\t   --async_log\tWrite log messages from a background thread\n");
+	fprintf(stderr,
+		"\t   --drng_autotune\tSelect the fastest DRNG and its request\n");
+	fprintf(stderr, "\t\t\t\tsize at startup\n");
+	fprintf(stderr,
+		"\t   --seed_file\tPath of the seed file persisting seed\n");
+	fprintf(stderr, "\t\t\t\tmaterial across restarts\n");
+	fprintf(stderr,
+		"\t   --seed_file_credit\tCredit entropy to the seed file\n");
+	fprintf(stderr,
+		"\t   --handover[=PID]\tTake over the sockets and a seed from\n");
+	fprintf(stderr,
+		"\t\t\t\tthe running server (with the given PID)\n");
+	fprintf(stderr, "\t\t\t\twhich then terminates\n");
+	fprintf(stderr,
+		"\t   --drng_small_reqsize\tServe requests up to this size in\n");
+	fprintf(stderr,
+		"\t\t\t\tbytes from the fastest DRNG for them\n");
+	fprintf(stderr,
+		"\t   --max_threads\tNumber of worker threads and DRNG instances\n");
+	fprintf(stderr,
+		"\t\t\t\t(default: number of CPUs, at least %u)\n",
+		THREADING_MAX_THREADS);
+	fprintf(stderr,
+		"\t   --cpu_class_placement\tBind RPC handlers to performance\n");
+	fprintf(stderr,
+		"\t\t\t\tcores and entropy sources to efficiency cores\n");
+	fprintf(stderr,
+		"\t   --shards\tNumber of shards of a sharded server, each\n");
+	fprintf(stderr,
+		"\t\t\t\tserving a block of CPUs on its own sockets\n");
+	fprintf(stderr,
+		"\t   --shard\tShard number served by this server instance\n");
+	fprintf(stderr,
+		"\t   --config\tConfiguration file applied at startup and\n");
+	fprintf(stderr,
+		"\t\t\t\tagain with SIGHUP, it must be readable by\n");
+	fprintf(stderr, "\t\t\t\tthe unprivileged user\n");
+	fprintf(stderr,
+		"\t   --initramfs\tEarly boot server with the fast entropy\n");
+	fprintf(stderr,
+		"\t\t\t\tsources only, surviving the switch to the\n");
+	fprintf(stderr,
+		"\t\t\t\troot file system until the regular server\n");
+	fprintf(stderr, "\t\t\t\ttakes over with --handover\n");
 	exit(1);
 }
 
+/*
+ * The initramfs server starts before the root file system is available: only
+ * the entropy sources which deliver right away are used, the Jitter RNG with
+ * its startup tests and the sources depending on the kernel module are not
+ * initialized. The user database may be absent, the privileges are dropped to
+ * the numeric ID of the overflow user unless a user is given.
+ *
+ * A leading '@' of argv[0] marks the process as a root storage daemon which
+ * systemd does not kill when switching to the root file system. The regular
+ * server then takes over the sockets and a seed with --handover, after
+ * which this server terminates.
+ */
+static void initramfs_init(char *argv0)
+{
+	esdm_config_es_jent_entropy_rate_set(0);
+	esdm_config_es_jent_async_enabled_set(0);
+	esdm_config_es_jent_kernel_entropy_rate_set(0);
+	esdm_config_es_irq_entropy_rate_set(0);
+	esdm_config_es_irq_retry_set(0);
+	esdm_config_es_sched_entropy_rate_set(0);
+	esdm_config_es_sched_retry_set(0);
+
+	if (!username)
+		username = "65534";
+
+	if (argv0 && argv0[0])
+		argv0[0] = '@';
+}
+
 static void parse_opts(int argc, char *argv[])
 {
 	int c = 0;
@@ -94,6 +186,27 @@ static void parse_opts(int argc, char *argv[])
 						{ "jent_block_disable", 0, 0,
 						  0 },
 						{ "syslog", 0, 0, 0 },
+						{ "drng_max_reqsize", 1, 0,
+						  0 },
+						{ "drng_cpu_affine", 0, 0,
+						  0 },
+						{ "es_collect_timeout", 1, 0,
+						  0 },
+						{ "async_log", 0, 0, 0 },
+						{ "drng_autotune", 0, 0, 0 },
+						{ "seed_file", 1, 0, 0 },
+						{ "seed_file_credit", 0, 0,
+						  0 },
+						{ "handover", 2, 0, 0 },
+						{ "drng_small_reqsize", 1, 0,
+						  0 },
+						{ "max_threads", 1, 0, 0 },
+						{ "cpu_class_placement", 0, 0,
+						  0 },
+						{ "shards", 1, 0, 0 },
+						{ "shard", 1, 0, 0 },
+						{ "config", 1, 0, 0 },
+						{ "initramfs", 0, 0, 0 },
 						{ 0, 0, 0, 0 } };
 		c = getopt_long(argc, argv, "hvp:u:fisS", opts, &opt_index);
 		if (-1 == c)
@@ -147,6 +260,77 @@ static void parse_opts(int argc, char *argv[])
 				esdm_logger_enable_syslog("esdm-server");
 				break;
 
+			case 10:
+				/* drng_max_reqsize */
+				esdm_config_drng_max_reqsize_set(
+					(uint32_t)strtoul(optarg, NULL, 10));
+				break;
+			case 11:
+				/* drng_cpu_affine */
+				esdm_config_drng_cpu_affine_set(1);
+				break;
+			case 12:
+				/* es_collect_timeout */
+				esdm_config_es_collect_timeout_set(
+					(uint32_t)strtoul(optarg, NULL, 10));
+				break;
+			case 13:
+				/* async_log */
+				esdm_logger_enable_async();
+				break;
+			case 14:
+				/* drng_autotune */
+				esdm_config_drng_autotune_set(1);
+				break;
+			case 15:
+				/* seed_file */
+				esdm_config_seed_file_set(optarg);
+				break;
+			case 16:
+				/* seed_file_credit */
+				esdm_config_seed_file_credit_set(1);
+				break;
+			case 17:
+				/* handover, optionally with the PID */
+				esdm_rpcs_handover_request(
+					optarg ? (pid_t)atoi(optarg) : 0);
+				break;
+			case 18:
+				/* drng_small_reqsize */
+				esdm_config_drng_small_reqsize_set(
+					(uint32_t)strtoul(optarg, NULL, 10));
+				break;
+			case 19:
+				/* max_threads */
+				if (thread_set_max_threads((uint32_t)strtoul(
+					    optarg, NULL, 10)))
+					usage();
+				break;
+			case 20:
+				/* cpu_class_placement */
+				esdm_config_cpu_class_placement_set(1);
+				break;
+			case 21:
+				/* shards */
+				shards = (uint32_t)strtoul(optarg, NULL, 10);
+				break;
+			case 22:
+				/* shard */
+				shard = (uint32_t)strtoul(optarg, NULL, 10);
+				break;
+			case 23:
+				/* config */
+				free(config_file);
+				/* The daemon changes its working directory */
+				config_file = realpath(optarg, NULL);
+				if (!config_file)
+					usage();
+				break;
+			case 24:
+				/* initramfs */
+				initramfs = 1;
+				break;
+
 			default:
 				usage();
 			}
@@ -183,6 +367,18 @@ static void parse_opts(int argc, char *argv[])
 			usage();
 		}
 	}
+
+	if (shards && esdm_config_shard_set(shard, shards))
+		usage();
+
+#ifdef ESDM_ES_UPSTREAM
+	/* Only a shard is seeded by the ESDM server on the default sockets */
+	if (!shards || initramfs)
+		esdm_config_es_upstream_entropy_rate_set(0);
+#endif
+
+	if (initramfs)
+		initramfs_init(argv[0]);
 }
 
 /*******************************************************************
@@ -195,6 +391,10 @@ static int daemon_init(void)
 
 	esdm_logger(LOGGER_VERBOSE, LOGGER_C_SERVER, "Starting ESDM server\n");
 	CKINT(esdm_init());
+	if (config_file) {
+		CKINT(esdm_config_file_load(config_file));
+		esdm_rpc_server_config_file_set(config_file);
+	}
 	CKINT(esdm_rpc_server_init(username));
 
 out:
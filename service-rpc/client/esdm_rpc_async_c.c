@@ -0,0 +1,513 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_protocol.h"
+#include "esdm_rpc_service.h"
+#include "math_helper.h"
+#include "esdm_logger.h"
+#include "memset_secure.h"
+#include "ptr_err.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+/*
+ * Asynchronous operation: the requests are sent on a dedicated connection with
+ * a non-blocking socket which keeps a pipeline active. The responses are
+ * received when the application signals that the file descriptor is readable.
+ *
+ * The file descriptor handed to the application never changes: when the
+ * connection is established, the socket is duplicated onto it. When the
+ * server closes the connection, the read end of a pipe which never becomes
+ * readable is duplicated onto it until the next request re-establishes the
+ * connection.
+ *
+ * With io_uring support, the requests and responses are exchanged via a
+ * private ring instead, see esdm_rpc_uring_c.c. The file descriptor handed to
+ * the application is the one of the ring which becomes readable with
+ * completions. It can be watched with poll(2) or an IORING_OP_POLL_ADD
+ * operation on the ring of the application. If the kernel does not offer
+ * io_uring, the socket is used.
+ */
+
+enum esdm_rpcc_async_state {
+	esdm_rpcc_async_req_free,
+	esdm_rpcc_async_req_submitting,
+	esdm_rpcc_async_req_pending,
+	esdm_rpcc_async_req_completed,
+};
+
+struct esdm_rpcc_async_req {
+	enum esdm_rpcc_async_state state;
+	ssize_t ret;
+	uint8_t *buf;
+	size_t buflen;
+	esdm_rpcc_async_cb_t cb;
+	void *cb_data;
+};
+
+struct esdm_rpcc_async {
+	esdm_rpc_client_connection_t *rpc_conn;
+	struct esdm_rpcc_pipeline pipeline;
+	struct esdm_rpcc_async_req req[ESDM_CLIENT_PIPELINE_DEPTH];
+
+	/* File descriptor provided to the application */
+	int fd;
+	/* Pipe which never becomes readable */
+	int idle_fd[2];
+	bool connected;
+
+#ifdef ESDM_RPCC_IO_URING
+	struct esdm_rpcc_uring *uring;
+#endif
+};
+
+static void esdm_rpcc_async_cb(const GetRandomBytesResponse *response,
+			       void *closure_data)
+{
+	struct esdm_rpcc_async_req *req =
+		(struct esdm_rpcc_async_req *)closure_data;
+
+	/* The callback of the caller is invoked in esdm_rpcc_process */
+	req->state = (req->state == esdm_rpcc_async_req_submitting) ?
+			     esdm_rpcc_async_req_free :
+			     esdm_rpcc_async_req_completed;
+
+	if (!response) {
+		req->ret = -EFAULT;
+		return;
+	} else if (IS_ERR(response)) {
+		req->ret = PTR_ERR(response);
+		return;
+	}
+
+	if (response->ret < 0) {
+		req->ret = response->ret;
+		return;
+	}
+
+	req->ret = (ssize_t)min_size(response->randval.len, req->buflen);
+	memcpy(req->buf, response->randval.data, (size_t)req->ret);
+
+	/* Zeroization of response is handled in esdm_rpc_client_read_handler */
+}
+
+#ifdef ESDM_RPCC_IO_URING
+
+/* Complete the in-flight operations of the ring and close the socket */
+static void esdm_rpcc_async_uring_detach(struct esdm_rpcc_async *async)
+{
+	esdm_rpc_client_connection_t *rpc_conn = async->rpc_conn;
+
+	if (!async->connected)
+		return;
+
+	shutdown(rpc_conn->fd, SHUT_RDWR);
+	esdm_rpcc_uring_drain(async->uring);
+	close(rpc_conn->fd);
+	rpc_conn->fd = -1;
+	rpc_conn->uring = NULL;
+	async->connected = false;
+}
+
+#endif /* ESDM_RPCC_IO_URING */
+
+/* Fail all outstanding requests and detach the socket */
+static void esdm_rpcc_async_disconnect(struct esdm_rpcc_async *async,
+				       ssize_t error)
+{
+	unsigned int i;
+
+	for (i = 0; i < ESDM_CLIENT_PIPELINE_DEPTH; i++) {
+		if (async->req[i].state != esdm_rpcc_async_req_pending)
+			continue;
+
+		async->req[i].ret = error;
+		async->req[i].state = esdm_rpcc_async_req_completed;
+	}
+
+#ifdef ESDM_RPCC_IO_URING
+	if (async->uring) {
+		esdm_rpcc_async_uring_detach(async);
+		esdm_rpcc_pipeline_start(async->rpc_conn, &async->pipeline);
+		return;
+	}
+#endif
+
+	/* Closes the socket as well */
+	dup2(async->idle_fd[0], async->fd);
+	async->rpc_conn->fd = -1;
+	async->connected = false;
+	esdm_rpcc_pipeline_start(async->rpc_conn, &async->pipeline);
+}
+
+#ifdef ESDM_RPCC_IO_URING
+
+static void esdm_rpcc_async_uring_process(struct esdm_rpcc_async *async)
+{
+	struct esdm_rpcc_uring *ring = async->uring;
+	int ret;
+
+	if (!async->connected)
+		return;
+
+	/* Deliver all completely received responses */
+	ret = esdm_rpcc_uring_reap(ring);
+	while (!ret) {
+		ret = esdm_rpcc_uring_frame(ring);
+		if (ret <= 0)
+			break;
+
+		ret = esdm_rpcc_pipeline_receive(async->rpc_conn);
+
+		/* A stale response without outstanding request is dropped */
+		if (ret == -ENODATA)
+			esdm_rpcc_uring_skip(ring);
+		if (ret == -ENODATA || ret == -EAGAIN)
+			ret = 0;
+	}
+
+	/* Send the requests queued meanwhile and re-arm the receive */
+	if (!ret)
+		ret = esdm_rpcc_uring_submit(ring, async->rpc_conn->fd);
+
+	if (ret && ret != -EAGAIN) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Asynchronous io_uring operation failed: %d\n",
+			    ret);
+		esdm_rpcc_async_disconnect(async, ret);
+	}
+}
+
+#endif /* ESDM_RPCC_IO_URING */
+
+#ifdef ESDM_RPCC_IO_URING
+
+static int esdm_rpcc_async_uring_submit(struct esdm_rpcc_async *async,
+					struct esdm_rpcc_async_req *req,
+					GetRandomBytesRequest *msg)
+{
+	int ret;
+
+	req->state = esdm_rpcc_async_req_submitting;
+	req->ret = 0;
+	unpriv_access__rpc_get_random_bytes(&async->rpc_conn->service, msg,
+					    esdm_rpcc_async_cb, req);
+
+	/* The closure is only invoked for a failed submission */
+	if (req->state != esdm_rpcc_async_req_submitting) {
+		esdm_rpcc_async_disconnect(async, req->ret);
+		return (int)req->ret;
+	}
+	req->state = esdm_rpcc_async_req_pending;
+
+	/* Nothing is entered while the previous send is in flight */
+	ret = esdm_rpcc_uring_submit(async->uring, async->rpc_conn->fd);
+	if (ret && ret != -EAGAIN) {
+		esdm_rpcc_async_disconnect(async, ret);
+
+		/* The callback is not invoked for the failed submission */
+		req->state = esdm_rpcc_async_req_free;
+		return ret;
+	}
+
+	return 0;
+}
+
+#endif /* ESDM_RPCC_IO_URING */
+
+static int esdm_rpcc_async_connect(struct esdm_rpcc_async *async)
+{
+	esdm_rpc_client_connection_t *rpc_conn = async->rpc_conn;
+	int ret;
+
+	if (async->connected)
+		return 0;
+
+	/* The connection must not close the file descriptor of the caller */
+	rpc_conn->fd = -1;
+	ret = esdm_rpcc_connect(rpc_conn);
+	if (ret) {
+		if (rpc_conn->fd >= 0)
+			close(rpc_conn->fd);
+		rpc_conn->fd = -1;
+		return ret;
+	}
+
+	set_fd_nonblocking(rpc_conn->fd);
+
+#ifdef ESDM_RPCC_IO_URING
+	/* The socket is only accessed via the ring */
+	if (async->uring) {
+		rpc_conn->uring = async->uring;
+		async->connected = true;
+		return 0;
+	}
+#endif
+
+	if (dup2(rpc_conn->fd, async->fd) < 0) {
+		ret = -errno;
+		close(rpc_conn->fd);
+		rpc_conn->fd = -1;
+		return ret;
+	}
+	close(rpc_conn->fd);
+	rpc_conn->fd = async->fd;
+	async->connected = true;
+
+	return 0;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_async_alloc(struct esdm_rpcc_async **async)
+{
+	struct esdm_rpcc_async *a;
+	int ret;
+
+	CKNULL(async, -EINVAL);
+
+	a = calloc(1, sizeof(*a));
+	CKNULL(a, -ENOMEM);
+	a->fd = -1;
+	a->idle_fd[0] = -1;
+	a->idle_fd[1] = -1;
+
+	CKINT(esdm_rpcc_alloc_unpriv_conn(&a->rpc_conn, NULL));
+
+	/* The event loop of the caller must never be interrupted */
+	a->rpc_conn->interrupt_func = NULL;
+	a->rpc_conn->nonblocking = true;
+
+#ifdef ESDM_RPCC_IO_URING
+	/* Without io_uring offered by the kernel, the socket is used */
+	if (!esdm_rpcc_uring_alloc(&a->uring)) {
+		esdm_rpcc_pipeline_start(a->rpc_conn, &a->pipeline);
+		*async = a;
+		return 0;
+	}
+	a->uring = NULL;
+#endif
+
+	if (pipe2(a->idle_fd, O_CLOEXEC) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	a->fd = fcntl(a->idle_fd[0], F_DUPFD_CLOEXEC, 0);
+	if (a->fd < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	esdm_rpcc_pipeline_start(a->rpc_conn, &a->pipeline);
+	*async = a;
+
+out:
+	if (ret)
+		esdm_rpcc_async_free(a);
+	return ret;
+}
+
+DSO_PUBLIC
+void esdm_rpcc_async_free(struct esdm_rpcc_async *async)
+{
+	if (!async)
+		return;
+
+#ifdef ESDM_RPCC_IO_URING
+	if (async->uring) {
+		esdm_rpcc_async_uring_detach(async);
+		esdm_rpcc_uring_free(async->uring);
+	}
+#endif
+
+	if (async->rpc_conn) {
+		/* The file descriptor is closed below */
+		async->rpc_conn->fd = -1;
+		esdm_rpcc_free_unpriv_conn(async->rpc_conn);
+	}
+
+	if (async->fd >= 0)
+		close(async->fd);
+	if (async->idle_fd[0] >= 0)
+		close(async->idle_fd[0]);
+	if (async->idle_fd[1] >= 0)
+		close(async->idle_fd[1]);
+
+	memset_secure(async, 0, sizeof(*async));
+	free(async);
+}
+
+DSO_PUBLIC
+int esdm_rpcc_async_fd(struct esdm_rpcc_async *async)
+{
+	if (!async)
+		return -EINVAL;
+
+#ifdef ESDM_RPCC_IO_URING
+	if (async->uring)
+		return esdm_rpcc_uring_fd(async->uring);
+#endif
+
+	return async->fd;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_get_random_bytes_async(struct esdm_rpcc_async *async,
+				     uint8_t *buf, size_t buflen,
+				     esdm_rpcc_async_cb_t cb, void *cb_data)
+{
+	GetRandomBytesRequest msg = GET_RANDOM_BYTES_REQUEST__INIT;
+	struct esdm_rpcc_async_req *req = NULL;
+	struct pollfd pfd;
+	unsigned int i, attempts = 0;
+	int ret = 0;
+
+	CKNULL(async, -EINVAL);
+	CKNULL(buf, -EINVAL);
+	CKNULL(cb, -EINVAL);
+	if (!buflen || buflen > ESDM_RPC_MAX_DATA)
+		return -EINVAL;
+
+	for (i = 0; i < ESDM_CLIENT_PIPELINE_DEPTH; i++) {
+		if (async->req[i].state == esdm_rpcc_async_req_free) {
+			req = &async->req[i];
+			break;
+		}
+	}
+	if (!req)
+		return -EBUSY;
+
+	msg.len = buflen;
+	req->buf = buf;
+	req->buflen = buflen;
+	req->cb = cb;
+	req->cb_data = cb_data;
+
+	do {
+		CKINT(esdm_rpcc_async_connect(async));
+
+#ifdef ESDM_RPCC_IO_URING
+		if (async->uring) {
+			ret = esdm_rpcc_async_uring_submit(async, req, &msg);
+			break;
+		}
+#endif
+
+		/* Do not block on a full socket buffer */
+		pfd.fd = async->fd;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 0) < 0) {
+			ret = -errno;
+			goto out;
+		}
+		if (!(pfd.revents & POLLOUT))
+			return -EAGAIN;
+
+		req->state = esdm_rpcc_async_req_submitting;
+		req->ret = 0;
+		unpriv_access__rpc_get_random_bytes(&async->rpc_conn->service,
+						    &msg, esdm_rpcc_async_cb,
+						    req);
+
+		/* The closure is only invoked for a failed submission */
+		if (req->state == esdm_rpcc_async_req_submitting) {
+			req->state = esdm_rpcc_async_req_pending;
+			return 0;
+		}
+
+		ret = (int)req->ret;
+
+		/* The server closed the connection, reconnect once */
+		if (ret == -EPIPE)
+			esdm_rpcc_async_disconnect(async, -EPIPE);
+	} while (ret == -EPIPE && !attempts++);
+
+out:
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_process(struct esdm_rpcc_async *async)
+{
+	struct esdm_rpcc_async_req *req;
+	unsigned int i;
+	int ret, completed = 0;
+	uint8_t tmp;
+
+	CKNULL(async, -EINVAL);
+
+#ifdef ESDM_RPCC_IO_URING
+	if (async->uring)
+		esdm_rpcc_async_uring_process(async);
+	else
+#endif
+	if (async->connected) {
+		/* Receive all available responses */
+		do {
+			ret = esdm_rpcc_pipeline_receive(async->rpc_conn);
+		} while (!ret);
+
+		if (ret == -ENODATA) {
+			/*
+			 * No request is outstanding - the peer closing the
+			 * connection, e.g. due to inactivity, is the only
+			 * expected event. A stale response is discarded.
+			 */
+			ssize_t rc = recv(async->fd, &tmp, sizeof(tmp),
+					  MSG_DONTWAIT);
+
+			if (rc == 0 ||
+			    (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+				esdm_rpcc_async_disconnect(async, -EPIPE);
+		} else if (ret != -EAGAIN) {
+			esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+				    "Asynchronous receive failed: %d\n", ret);
+			esdm_rpcc_async_disconnect(async, ret);
+		}
+	}
+
+	/* Invoke the callbacks outside of the connection lock */
+	for (i = 0; i < ESDM_CLIENT_PIPELINE_DEPTH; i++) {
+		req = &async->req[i];
+
+		if (req->state != esdm_rpcc_async_req_completed)
+			continue;
+
+		req->state = esdm_rpcc_async_req_free;
+		completed++;
+		req->cb(req->ret, req->buf, req->cb_data);
+	}
+
+	ret = completed;
+
+out:
+	return ret;
+}
@@ -19,7 +19,11 @@
  */
 
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
@@ -30,6 +34,7 @@
 #include "buffer.h"
 #include "config.h"
 #include "atomic.h"
+#include "atomic_64.h"
 #include "conv_be_le.h"
 #include "esdm_rpc_client_internal.h"
 #include "esdm_rpc_protocol.h"
@@ -44,11 +49,64 @@
 #include "test_pertubation.h"
 #include "visibility.h"
 
+#ifdef ESDM_LINUX
+#define ESDM_RPCC_VSOCK
+#include <linux/vm_sockets.h>
+#include <sys/eventfd.h>
+#endif
+
 struct esdm_rpcc_write_buf {
 	ProtobufCBuffer base;
 	esdm_rpc_client_connection_t *rpc_conn;
 };
 
+/*
+ * Each connection owns an event file descriptor which is polled together with
+ * the socket. A write to it by esdm_rpcc_interrupt wakes up a caller waiting
+ * for the server so that the interrupt function is consulted immediately. The
+ * event file descriptor is only available on Linux, otherwise the interrupt
+ * function is consulted when the deadline of the wait passed.
+ */
+static void esdm_rpcc_wake_init(esdm_rpc_client_connection_t *rpc_conn)
+{
+#ifdef ESDM_LINUX
+	rpc_conn->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#else
+	rpc_conn->wake_fd = -1;
+#endif
+}
+
+static void esdm_rpcc_wake_fini(esdm_rpc_client_connection_t *rpc_conn)
+{
+	if (rpc_conn->wake_fd >= 0) {
+		close(rpc_conn->wake_fd);
+		rpc_conn->wake_fd = -1;
+	}
+}
+
+static void esdm_rpcc_wake(esdm_rpc_client_connection_t *rpc_conn)
+{
+	uint64_t val = 1;
+	ssize_t ret;
+
+	if (rpc_conn->wake_fd < 0)
+		return;
+
+	/* An overflowing counter means that a wake up is pending anyway */
+	ret = write(rpc_conn->wake_fd, &val, sizeof(val));
+	(void)ret;
+}
+
+static void esdm_rpcc_wake_drain(esdm_rpc_client_connection_t *rpc_conn)
+{
+	uint64_t val;
+	ssize_t ret;
+
+	/* The counter is reset with one read */
+	ret = read(rpc_conn->wake_fd, &val, sizeof(val));
+	(void)ret;
+}
+
 static void esdm_fini_proto_service(esdm_rpc_client_connection_t *rpc_conn)
 {
 	ProtobufCService *service;
@@ -60,6 +118,7 @@ static void esdm_fini_proto_service(esdm_rpc_client_connection_t *rpc_conn)
 		close(rpc_conn->fd);
 		rpc_conn->fd = -1;
 	}
+	esdm_rpcc_wake_fini(rpc_conn);
 
 	service = &rpc_conn->service;
 	if (service->descriptor) {
@@ -67,58 +126,226 @@ static void esdm_fini_proto_service(esdm_rpc_client_connection_t *rpc_conn)
 		service->descriptor = NULL;
 	}
 
+	if (rpc_conn->rx_buf) {
+		free(rpc_conn->rx_buf);
+		rpc_conn->rx_buf = NULL;
+	}
+	rpc_conn->rx_buf_size = 0;
+
 	mutex_w_destroy(&rpc_conn->lock);
 	mutex_w_destroy(&rpc_conn->ref_cnt);
 }
 
-static int esdm_connect_proto_service(esdm_rpc_client_connection_t *rpc_conn)
+/*
+ * Connection health shared by all connections of the process: after a failed
+ * connection attempt, further attempts are rejected immediately until the
+ * backoff time expired. The backoff grows exponentially with each failed
+ * attempt and is randomized so that the clients do not reconnect at the same
+ * time when the server restarts. Once the backoff expired, only one caller
+ * probes the server while all others continue to be rejected.
+ *
+ * The health is tracked separately for the primary server endpoint and the
+ * fallback endpoint of the unprivileged interface.
+ */
+#define ESDM_CLIENT_BACKOFF_MAX (1ULL << (ESDM_CLIENT_BACKOFF_MAX_EXPONENT))
+#define ESDM_CLIENT_BACKOFF_STEPS                                              \
+	((ESDM_CLIENT_BACKOFF_MAX_EXPONENT) -                                  \
+	 (ESDM_CLIENT_CONNECT_TIMEOUT_EXPONENT))
+
+struct esdm_rpcc_health {
+	atomic_t failures;
+	atomic_64_t retry_ns;
+};
+
+static struct esdm_rpcc_health esdm_rpcc_health[esdm_rpcc_endpoint_num] = {
+	[esdm_rpcc_endpoint_primary] = { .failures = ATOMIC_INIT(0),
+					 .retry_ns = ATOMIC_64_INIT(0) },
+	[esdm_rpcc_endpoint_fallback] = { .failures = ATOMIC_INIT(0),
+					  .retry_ns = ATOMIC_64_INIT(0) },
+};
+
+static uint64_t esdm_rpcc_now_ns(void)
 {
-	const char *socketname = rpc_conn->socketname;
-	struct timespec ts = {
-		.tv_sec = 0,
-		.tv_nsec = 1U << (ESDM_CLIENT_CONNECT_TIMEOUT_EXPONENT)
-	};
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* The jitter does not require a cryptographically strong random number */
+static uint64_t esdm_rpcc_jitter(uint64_t backoff)
+{
+	static __thread uint64_t state = 0;
+
+	if (!state)
+		state = esdm_rpcc_now_ns() ^ (uint64_t)(uintptr_t)&state;
+
+	/* xorshift64 */
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+
+	/* Randomize the backoff within [backoff / 2, backoff] */
+	return backoff / 2 + state % (backoff / 2 + 1);
+}
+
+/*
+ * Check whether a connection attempt is allowed. If the server is known to be
+ * unavailable, only one caller is allowed to probe it after the backoff time.
+ */
+static bool esdm_rpcc_conn_allowed(struct esdm_rpcc_health *health)
+{
+	long long retry_ns;
+	uint64_t now;
+
+	if (!atomic_read(&health->failures))
+		return true;
+
+	retry_ns = atomic_read_64(&health->retry_ns);
+	now = esdm_rpcc_now_ns();
+	if (now < (uint64_t)retry_ns)
+		return false;
+
+	/* Claim the probe - other callers are rejected during the probe */
+	return atomic_cmpxchg_64(&health->retry_ns, retry_ns,
+				 (long long)(now + (ESDM_CLIENT_BACKOFF_MAX))) ==
+	       retry_ns;
+}
+
+static void esdm_rpcc_conn_failed(struct esdm_rpcc_health *health)
+{
+	uint64_t backoff = ESDM_CLIENT_BACKOFF_MAX;
+	int failures = atomic_inc(&health->failures);
+
+	/* Exponential backoff starting with the connect timeout */
+	if (failures > 0 && failures <= ESDM_CLIENT_BACKOFF_STEPS)
+		backoff = 1ULL << ((ESDM_CLIENT_CONNECT_TIMEOUT_EXPONENT) +
+				   failures - 1);
+
+	atomic_set_64(&health->retry_ns, (long long)(esdm_rpcc_now_ns() +
+						     esdm_rpcc_jitter(backoff)));
+}
+
+static void esdm_rpcc_conn_succeeded(struct esdm_rpcc_health *health,
+				     const char *socketname)
+{
+	if (!atomic_read(&health->failures))
+		return;
+
+	atomic_set(&health->failures, 0);
+	atomic_set_64(&health->retry_ns, 0);
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+		    "ESDM server interface %s available again\n", socketname);
+}
+
+static void esdm_rpcc_health_reset(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < esdm_rpcc_endpoint_num; i++) {
+		atomic_set(&esdm_rpcc_health[i].failures, 0);
+		atomic_set_64(&esdm_rpcc_health[i].retry_ns, 0);
+	}
+}
+
+static bool esdm_rpcc_has_fallback(esdm_rpc_client_connection_t *rpc_conn)
+{
+	return rpc_conn->fallback_socketname[0] != '\0';
+}
+
+/*
+ * Connect to one endpoint of the connection. The fallback endpoint is always
+ * a Unix domain socket.
+ *
+ * @return file descriptor of the connected socket on success, < 0 on error
+ */
+static int esdm_rpcc_connect_endpoint(esdm_rpc_client_connection_t *rpc_conn,
+				      unsigned int endpoint)
+{
+	struct esdm_rpcc_health *health = &esdm_rpcc_health[endpoint];
+	const char *socketname = (endpoint == esdm_rpcc_endpoint_fallback) ?
+					 rpc_conn->fallback_socketname :
+					 rpc_conn->socketname;
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = 0 };
 	struct timeval tv = {
 		.tv_sec = 0,
 		.tv_usec = (1U << (ESDM_CLIENT_RX_TX_TIMEOUT_EXPONENT)) >> 10
 	};
+#ifndef ESDM_RPC_ABSTRACT_SOCKET
 	struct stat statbuf;
-	struct sockaddr_un addr;
-	unsigned int attempts = 0;
-	int errsv;
-
-	if (rpc_conn->fd >= 0) {
-		close(rpc_conn->fd);
-		rpc_conn->fd = -1;
+#endif
+	union {
+		struct sockaddr sa;
+		struct sockaddr_un un;
+#ifdef ESDM_RPCC_VSOCK
+		struct sockaddr_vm vm;
+#endif
+	} addr;
+	socklen_t addr_len;
+	unsigned int attempts = 0, max_attempts = ESDM_CLIENT_RECONNECT_ATTEMPTS;
+	int fd, errsv;
+
+	/* The server is known to be unavailable - let the caller fall back */
+	if (!esdm_rpcc_conn_allowed(health)) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "ESDM server interface %s unavailable, backing off\n",
+			    socketname);
+		return -ECONNREFUSED;
 	}
 
-	/* Does the path exist? */
-	if (stat(socketname, &statbuf) == -1) {
-		errsv = errno;
-
-		if (errsv == ENOENT) {
-			esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
-				    "ESDM server interface %s not available\n",
-				    socketname);
-		}
+	/*
+	 * A probe of an unavailable server is only attempted once. With a
+	 * fallback endpoint, the primary endpoint is not waited for either but
+	 * the fallback is used right away.
+	 */
+	if (atomic_read(&health->failures) ||
+	    (endpoint == esdm_rpcc_endpoint_primary &&
+	     esdm_rpcc_has_fallback(rpc_conn)))
+		max_attempts = 1;
+
+	if (endpoint == esdm_rpcc_endpoint_primary && rpc_conn->vsock_port) {
+#ifdef ESDM_RPCC_VSOCK
+		/* Connect to the ESDM server of the host */
+		memset(&addr.vm, 0, sizeof(addr.vm));
+		addr.vm.svm_family = AF_VSOCK;
+		addr.vm.svm_cid = rpc_conn->vsock_cid;
+		addr.vm.svm_port = rpc_conn->vsock_port;
+		addr_len = sizeof(addr.vm);
+
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Attempting to access ESDM server at vsock %u:%u\n",
+			    rpc_conn->vsock_cid, rpc_conn->vsock_port);
+#else
+		return -EOPNOTSUPP;
+#endif
+	} else {
+#ifndef ESDM_RPC_ABSTRACT_SOCKET
+		/* Does the path exist? */
+		if (stat(socketname, &statbuf) == -1) {
+			errsv = errno;
 
-		return -errsv;
-	}
+			if (errsv == ENOENT) {
+				esdm_logger(
+					LOGGER_DEBUG, LOGGER_C_RPC,
+					"ESDM server interface %s not available\n",
+					socketname);
+			}
 
-	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
-		    "Attempting to access ESDM server interface %s\n",
-		    socketname);
+			esdm_rpcc_conn_failed(health);
+			return -errsv;
+		}
+#endif
 
-	/* Connect to the Unix domain socket */
-	addr.sun_family = AF_UNIX;
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Attempting to access ESDM server interface %s\n",
+			    socketname);
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstringop-truncation"
-	strncpy(addr.sun_path, socketname, sizeof(addr.sun_path));
-#pragma GCC diagnostic pop
+		/* Connect to the Unix domain socket */
+		addr_len = esdm_rpc_unix_addr(&addr.un, socketname);
+	}
 
-	rpc_conn->fd = socket(addr.sun_family, SOCK_SEQPACKET, 0);
-	if (rpc_conn->fd < 0) {
+	fd = socket(addr.sa.sa_family, SOCK_SEQPACKET, 0);
+	if (fd < 0) {
 		errsv = errno;
 
 		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
@@ -127,25 +354,28 @@ static int esdm_connect_proto_service(esdm_rpc_client_connection_t *rpc_conn)
 	}
 
 	/* Set timeout on socket */
-	if (setsockopt(rpc_conn->fd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv,
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv,
 		       sizeof(tv)) < 0 ||
-	    setsockopt(rpc_conn->fd, SOL_SOCKET, SO_SNDTIMEO, (const char *)&tv,
+	    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const char *)&tv,
 		       sizeof(tv)) < 0) {
 		errsv = errno;
 
 		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
 			    "Error setting timeout on socket: %s\n",
 			    strerror(errsv));
+		close(fd);
 		return -errsv;
 	}
 
 	do {
 		/* If we have another attempt, try to wait a bit */
-		if (attempts)
+		if (attempts) {
+			ts.tv_nsec = (long)esdm_rpcc_jitter(
+				1U << (ESDM_CLIENT_CONNECT_TIMEOUT_EXPONENT));
 			nanosleep(&ts, NULL);
+		}
 
-		if (connect(rpc_conn->fd, (struct sockaddr *)&addr,
-			    sizeof(addr)) < 0) {
+		if (connect(fd, &addr.sa, addr_len) < 0) {
 			errsv = errno;
 
 			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
@@ -155,28 +385,209 @@ static int esdm_connect_proto_service(esdm_rpc_client_connection_t *rpc_conn)
 		} else {
 			errsv = 0;
 		}
-	} while (attempts < (ESDM_CLIENT_RECONNECT_ATTEMPTS) &&
+	} while (attempts < max_attempts &&
 		 (errsv == EAGAIN || errsv == ECONNREFUSED || errsv == EINTR));
 
 	if (errsv) {
 		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
 			    "Connection attempt using socket %s failed\n",
 			    socketname);
+		esdm_rpcc_conn_failed(health);
+		close(fd);
+		return -errsv;
+	}
+
+	esdm_rpcc_conn_succeeded(health, socketname);
+	return fd;
+}
+
+/* Use the new socket for the connection */
+static void esdm_rpcc_set_fd(esdm_rpc_client_connection_t *rpc_conn, int fd,
+			     unsigned int endpoint)
+{
+	if (rpc_conn->fd >= 0)
+		close(rpc_conn->fd);
+	rpc_conn->fd = fd;
+	rpc_conn->endpoint = endpoint;
+
+	/* A new connection starts with the default message size */
+	rpc_conn->max_msg_size = 0;
+	rpc_conn->fast_wire = false;
+	rpc_conn->cpu_hint = false;
+}
+
+static int esdm_connect_proto_service(esdm_rpc_client_connection_t *rpc_conn)
+{
+	unsigned int endpoint = esdm_rpcc_endpoint_primary;
+	int fd;
+
+	esdm_rpcc_set_fd(rpc_conn, -1, endpoint);
+
+	fd = esdm_rpcc_connect_endpoint(rpc_conn, endpoint);
+	if (fd < 0 && esdm_rpcc_has_fallback(rpc_conn)) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Failing over to ESDM server interface %s\n",
+			    rpc_conn->fallback_socketname);
+		endpoint = esdm_rpcc_endpoint_fallback;
+		fd = esdm_rpcc_connect_endpoint(rpc_conn, endpoint);
 	}
+	esdm_rpcc_stats_connect(endpoint, fd < 0 ? fd : 0);
+	if (fd < 0)
+		return fd;
+
+	esdm_rpcc_set_fd(rpc_conn, fd, endpoint);
+	return 0;
+}
+
+/*
+ * A connection served by the fallback endpoint returns to the primary endpoint
+ * once it is available again. The primary endpoint is probed by at most one
+ * caller per backoff period, all other callers continue to use the fallback
+ * without delay. The caller must hold the connection.
+ */
+static void esdm_rpcc_reprobe_primary(esdm_rpc_client_connection_t *rpc_conn)
+{
+	int fd;
+
+	if (rpc_conn->endpoint != esdm_rpcc_endpoint_fallback ||
+	    rpc_conn->fd < 0 || rpc_conn->pipeline)
+		return;
+
+	fd = esdm_rpcc_connect_endpoint(rpc_conn, esdm_rpcc_endpoint_primary);
+	if (fd < 0)
+		return;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Returning to ESDM server interface %s\n",
+		    rpc_conn->vsock_port ? "vsock" : rpc_conn->socketname);
+	esdm_rpcc_set_fd(rpc_conn, fd, esdm_rpcc_endpoint_primary);
+}
+
+/*
+ * An overloaded server answers a new connection with TOO_MANY_PENDING and
+ * closes it. The client backs off from the endpoint as after a failed
+ * connection attempt, the next request uses the fallback endpoint during the
+ * backoff if there is one. The caller must hold the connection.
+ */
+static void esdm_rpcc_shed(esdm_rpc_client_connection_t *rpc_conn)
+{
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+		    "ESDM server overloaded, backing off\n");
+	esdm_rpcc_conn_failed(&esdm_rpcc_health[rpc_conn->endpoint]);
+	esdm_rpcc_set_fd(rpc_conn, -1, rpc_conn->endpoint);
+}
 
-	return -errsv;
+/* Did the server reject the connection before the request was sent? */
+static bool esdm_rpcc_shed_pending(esdm_rpc_client_connection_t *rpc_conn)
+{
+	struct esdm_rpc_proto_sc_header header;
+	ssize_t ret = recv(rpc_conn->fd, &header, sizeof(header),
+			   MSG_PEEK | MSG_DONTWAIT);
+
+	return ret == (ssize_t)sizeof(header) &&
+	       le_bswap32(header.status_code) ==
+		       PROTOBUF_C_RPC_STATUS_CODE_TOO_MANY_PENDING;
+}
+
+/* Deadline of one RPC send or receive operation */
+static uint64_t esdm_rpcc_deadline(void)
+{
+	return esdm_rpcc_now_ns() +
+	       (1ULL << (ESDM_CLIENT_RX_TX_TIMEOUT_EXPONENT));
+}
+
+static bool esdm_rpcc_interrupted(esdm_rpc_client_connection_t *rpc_conn)
+{
+	return rpc_conn->interrupt_func &&
+	       rpc_conn->interrupt_func(rpc_conn->interrupt_data);
+}
+
+/*
+ * Wait until the socket of the connection is ready for the given events. The
+ * wait ends when the deadline passed or when the caller shall be interrupted.
+ * A wake up by esdm_rpcc_interrupt for which the interrupt function does not
+ * request an interruption continues the wait.
+ *
+ * @return 0 if the socket is ready, -ETIMEDOUT if the deadline passed, -EINTR
+ *	   if the caller shall be interrupted, other error otherwise
+ */
+static int esdm_rpcc_wait(esdm_rpc_client_connection_t *rpc_conn,
+			  short events, uint64_t deadline)
+{
+	struct pollfd fds[2] = {
+		{ .fd = rpc_conn->fd, .events = events },
+		{ .fd = rpc_conn->wake_fd, .events = POLLIN },
+	};
+	nfds_t nfds = (rpc_conn->wake_fd >= 0) ? 2 : 1;
+	uint64_t now;
+	int ret;
+
+	for (;;) {
+		now = esdm_rpcc_now_ns();
+		if (now >= deadline)
+			return -ETIMEDOUT;
+
+		/* Round up to not wake up before the deadline */
+		ret = poll(fds, nfds,
+			   (int)((deadline - now + 999999) / 1000000));
+		if (ret < 0) {
+			if (errno != EINTR)
+				return -errno;
+			if (esdm_rpcc_interrupted(rpc_conn))
+				return -EINTR;
+			continue;
+		}
+		if (!ret)
+			return -ETIMEDOUT;
+
+		if (nfds > 1 && fds[1].revents) {
+			esdm_rpcc_wake_drain(rpc_conn);
+			if (esdm_rpcc_interrupted(rpc_conn))
+				return -EINTR;
+		}
+
+		/* Errors of the socket are reported by the subsequent I/O */
+		if (fds[0].revents)
+			return 0;
+	}
 }
 
 static int esdm_rpc_client_write_data_fd(esdm_rpc_client_connection_t *rpc_conn,
 					 const uint8_t *data, size_t len)
 {
+	uint64_t deadline = esdm_rpcc_deadline();
 	size_t written = 0;
 	ssize_t ret;
 
 	if (rpc_conn->fd < 0)
 		return -EINVAL;
 
+#ifdef ESDM_RPCC_IO_URING
+	/* The request is sent with the next submission of the ring */
+	if (rpc_conn->uring)
+		return esdm_rpcc_uring_queue(rpc_conn->uring, data, len);
+#endif
+
 	do {
+		/*
+		 * Wait for the socket instead of blocking in write so that an
+		 * interruption is noticed while the server does not accept
+		 * data. After the deadline passed without an interruption, the
+		 * write is tried again.
+		 */
+		if (!rpc_conn->nonblocking) {
+			int rc = esdm_rpcc_wait(rpc_conn, POLLOUT, deadline);
+
+			if (rc == -EINTR)
+				return -EAGAIN;
+			if (rc == -ETIMEDOUT) {
+				deadline = esdm_rpcc_deadline();
+				continue;
+			}
+			if (rc)
+				return rc;
+		}
+
 		ret = write(rpc_conn->fd, data, len);
 		if (ret < 0) {
 			int errsv = errno;
@@ -184,20 +595,26 @@ static int esdm_rpc_client_write_data_fd(esdm_rpc_client_connection_t *rpc_conn,
 			/*
 			 * EPIPE is due to the server was restarted -> reconnect
 			 * EAGAIN/EWOULDBLOCK is due to the socket
-			 * timeout -> call write again
+			 * timeout -> wait again
 			 */
 			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				/* The caller of a non-blocking socket retries */
+				if (rpc_conn->nonblocking)
+					return -EAGAIN;
+
 				/* Does the caller wants us to interrupt? */
-				if (rpc_conn->interrupt_func &&
-				    rpc_conn->interrupt_func(
-					    rpc_conn->interrupt_data)) {
+				if (esdm_rpcc_interrupted(rpc_conn))
 					return -EAGAIN;
-				}
 
 				continue;
 			}
 
-			if (errsv == EPIPE) {
+			/* The caller of a non-blocking socket reconnects */
+			if (errsv == EPIPE && !rpc_conn->nonblocking) {
+				/* The read handler processes the rejection */
+				if (esdm_rpcc_shed_pending(rpc_conn))
+					return 0;
+
 				esdm_logger(
 					LOGGER_DEBUG, LOGGER_C_RPC,
 					"Connection to server needs to be re-established\n");
@@ -238,15 +655,16 @@ static int esdm_rpc_client_write_data_fd(esdm_rpc_client_connection_t *rpc_conn,
  * - one more copy of entire data required to linearize all data
  */
 static int esdm_rpc_client_pack(const ProtobufCMessage *message,
-				unsigned int method_index,
+				unsigned int method_index, uint32_t request_id,
 				esdm_rpc_client_connection_t *rpc_conn)
 {
 #define ESDM_RPCC_BUF_WRITE_HEADER_SZ (sizeof(struct esdm_rpc_proto_cs_header))
 
+	struct esdm_rpc_arena *arena = esdm_rpc_arena_get();
 	size_t message_length;
 	int ret;
-	uint8_t *data_buf_alloc = NULL;
 	uint8_t *data_buf;
+	bool reset = false;
 	struct esdm_rpc_proto_cs_header *cs_header;
 	struct esdm_rpc_write_data_buf tmp = {
 		.dst_written = 0,
@@ -261,17 +679,21 @@ static int esdm_rpc_client_pack(const ProtobufCMessage *message,
 		return -EFAULT;
 	}
 
-	data_buf_alloc = malloc(ESDM_RPCC_BUF_WRITE_HEADER_SZ + message_length +
-				sizeof(uint64_t) - 1);
-	CKNULL(data_buf_alloc, -ENOMEM);
-
-	data_buf = ALIGN_PTR_8(data_buf_alloc, sizeof(uint64_t));
+	/*
+	 * The arena is reset after the write unless it also holds the
+	 * unpacked request which is cleared by the caller.
+	 */
+	CKNULL(arena, -ENOMEM);
+	reset = esdm_rpc_arena_empty(arena);
+	data_buf = esdm_rpc_arena_alloc(
+		arena, ESDM_RPCC_BUF_WRITE_HEADER_SZ + message_length);
+	CKNULL(data_buf, -ENOMEM);
 	tmp.dst_buf = (data_buf + ESDM_RPCC_BUF_WRITE_HEADER_SZ);
 
 	cs_header = (struct esdm_rpc_proto_cs_header *)data_buf;
 	cs_header->method_index = le_bswap32(method_index);
 	cs_header->message_length = le_bswap32(message_length);
-	cs_header->request_id = le_bswap32(0);
+	cs_header->request_id = le_bswap32(request_id);
 
 	esdm_logger(
 		LOGGER_DEBUG, LOGGER_C_RPC,
@@ -293,13 +715,8 @@ static int esdm_rpc_client_pack(const ProtobufCMessage *message,
 		  "Submission of message data failed with error %d\n", ret);
 
 out:
-	/*
-	 * Zeroization not needed, as data will go out through unprotected
-	 * channel anyway. If the data is not already protected, there is a
-	 * bigger problem.
-	 */
-	if (data_buf_alloc)
-		free(data_buf_alloc);
+	if (reset)
+		esdm_rpc_arena_reset(arena);
 	return ret;
 }
 
@@ -325,7 +742,7 @@ static void esdm_rpc_client_append_data(ProtobufCBuffer *buffer, size_t len,
  * - no additional memory required
  */
 static int esdm_rpc_client_pack(const ProtobufCMessage *message,
-				unsigned int method_index,
+				unsigned int method_index, uint32_t request_id,
 				esdm_rpc_client_connection_t *rpc_conn)
 {
 	struct esdm_rpc_proto_cs_header cs_header;
@@ -339,7 +756,7 @@ static int esdm_rpc_client_pack(const ProtobufCMessage *message,
 
 	cs_header.method_index = le_bswap32(method_index);
 	cs_header.message_length = le_bswap32(message_length);
-	cs_header.request_id = le_bswap32(0);
+	cs_header.request_id = le_bswap32(request_id);
 
 	esdm_logger(
 		LOGGER_DEBUG, LOGGER_C_RPC,
@@ -364,51 +781,229 @@ out:
 
 #endif /* ESDM_RPCC_BUF_WRITE */
 
+/* Report an error to the oldest request which has not received an answer */
+static void esdm_rpc_client_entry_fail(struct esdm_rpcc_pipeline_entry *entries,
+				       uint32_t num, long error)
+{
+	uint32_t i;
+
+	for (i = 0; i < num; i++) {
+		if (entries[i].done)
+			continue;
+
+		entries[i].done = true;
+		entries[i].closure(ERR_PTR(error), entries[i].closure_data);
+		return;
+	}
+}
+
+/*
+ * Receive one response for the requests with the request IDs
+ * [first_id, first_id + num). Responses with other request IDs are stale
+ * answers, e.g. for requests which timed out, and are discarded.
+ */
+#ifdef ESDM_RPC_PASS_FDS
+
+/* Close all received file descriptors not taken over by a closure. */
+static void esdm_rpc_client_close_fds(esdm_rpc_client_connection_t *rpc_conn)
+{
+	unsigned int i;
+
+	for (i = 0; i < rpc_conn->num_recv_fds; i++) {
+		if (rpc_conn->recv_fds[i] >= 0)
+			close(rpc_conn->recv_fds[i]);
+	}
+	rpc_conn->num_recv_fds = 0;
+}
+
+int esdm_rpcc_take_fd(esdm_rpc_client_connection_t *rpc_conn,
+		      unsigned int idx)
+{
+	int fd;
+
+	if (idx >= rpc_conn->num_recv_fds)
+		return -EINVAL;
+
+	fd = rpc_conn->recv_fds[idx];
+	rpc_conn->recv_fds[idx] = -1;
+	return fd;
+}
+
+/* Read data and collect file descriptors passed by the server. */
+static ssize_t esdm_rpc_client_read(esdm_rpc_client_connection_t *rpc_conn,
+				    uint8_t *buf, size_t len)
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * ESDM_RPCC_RECV_FDS_MAX)];
+		struct cmsghdr align;
+	} control;
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	struct msghdr msg = { 0 };
+	struct cmsghdr *cmsg;
+	ssize_t ret;
+
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ret = recvmsg(rpc_conn->fd, &msg, MSG_CMSG_CLOEXEC);
+	if (ret <= 0)
+		return ret;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		size_t i, num;
+
+		if (cmsg->cmsg_level != SOL_SOCKET ||
+		    cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (i = 0; i < num; i++) {
+			int fd;
+
+			memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int),
+			       sizeof(fd));
+			if (rpc_conn->num_recv_fds < ESDM_RPCC_RECV_FDS_MAX)
+				rpc_conn->recv_fds[rpc_conn->num_recv_fds++] =
+					fd;
+			else
+				close(fd);
+		}
+	}
+
+	return ret;
+}
+
+#else /* ESDM_RPC_PASS_FDS */
+
+static inline void
+esdm_rpc_client_close_fds(esdm_rpc_client_connection_t *rpc_conn)
+{
+	(void)rpc_conn;
+}
+
+static ssize_t esdm_rpc_client_read(esdm_rpc_client_connection_t *rpc_conn,
+				    uint8_t *buf, size_t len)
+{
+	return read(rpc_conn->fd, buf, len);
+}
+
+#endif /* ESDM_RPC_PASS_FDS */
+
+int esdm_rpcc_rx_buf_alloc(esdm_rpc_client_connection_t *rpc_conn,
+			   uint32_t max_msg_size)
+{
+	uint8_t *rx_buf;
+
+	if (rpc_conn->rx_buf_size >= max_msg_size)
+		return 0;
+
+	/* malloc guarantees the 64 bit alignment required for the header */
+	rx_buf = malloc(max_msg_size + sizeof(struct esdm_rpc_proto_sc));
+	if (!rx_buf)
+		return -ENOMEM;
+
+	/* The buffer is cleared after each use */
+	free(rpc_conn->rx_buf);
+	rpc_conn->rx_buf = rx_buf;
+	rpc_conn->rx_buf_size = max_msg_size;
+
+	return 0;
+}
+
 static int
 esdm_rpc_client_read_handler(esdm_rpc_client_connection_t *rpc_conn,
-			     const ProtobufCMessageDescriptor *message_desc,
-			     ProtobufCClosure closure, void *closure_data)
+			     uint32_t first_id, uint32_t num,
+			     struct esdm_rpcc_pipeline_entry *entries)
 {
 	ProtobufCAllocator esdm_rpc_client_allocator = {
 		.alloc = &esdm_rpc_alloc,
 		.free = &esdm_rpc_free,
 		.allocator_data = NULL,
 	};
-	BUFFER_INIT(tls);
+	struct esdm_rpc_arena *arena = esdm_rpc_arena_get();
 	struct esdm_rpc_proto_sc *received_data;
 	struct esdm_rpc_proto_sc_header *header = NULL;
-	uint8_t buf[ESDM_RPC_MAX_MSG_SIZE + sizeof(*received_data)] __aligned(
-		sizeof(uint64_t));
-	uint8_t unpacked[ESDM_RPC_MAX_MSG_SIZE + 128] __aligned(
-		sizeof(uint64_t));
-	size_t total_received = 0;
+	uint8_t *buf;
+	size_t buflen, total_received = 0;
 	ssize_t received;
-	uint32_t data_to_fetch = 0;
+	uint32_t data_to_fetch = 0, max_msg_size = ESDM_RPC_MAX_MSG_SIZE;
 	int ret = 0;
-	uint8_t *buf_p = buf;
+	uint8_t *buf_p;
+	uint64_t deadline;
 	bool interrupted = false;
 
 	if (rpc_conn->fd < 0)
 		return -EINVAL;
+	if (!arena)
+		return -ENOMEM;
+
+	if (rpc_conn->max_msg_size)
+		max_msg_size = rpc_conn->max_msg_size;
 
-	tls.buf = unpacked;
-	tls.len = sizeof(unpacked);
-	esdm_rpc_client_allocator.allocator_data = &tls;
+	/*
+	 * The receive buffer is kept with the connection instead of the
+	 * stack: it is allocated with the first response and reused for all
+	 * subsequent responses. The response is unpacked into the arena of
+	 * the thread.
+	 */
+	ret = esdm_rpcc_rx_buf_alloc(rpc_conn, max_msg_size);
+	if (ret)
+		return ret;
+
+	buf = rpc_conn->rx_buf;
+	buflen = max_msg_size + sizeof(*received_data);
+	buf_p = buf;
+
+	esdm_rpc_client_allocator.allocator_data = arena;
 
 	/* The cast is appropriate as the buffer is aligned to 64 bits. */
 	received_data = (struct esdm_rpc_proto_sc *)buf;
 
+read_next:
+	/* Each response must arrive within the deadline */
+	deadline = esdm_rpcc_deadline();
+
 	/* Read the data into the local buffer storage */
 	do {
-		received =
-			read(rpc_conn->fd, buf_p, sizeof(buf) - total_received);
+		/*
+		 * Wait for the response instead of blocking in read so that an
+		 * interruption is noticed while the response is outstanding.
+		 */
+		if (!rpc_conn->nonblocking) {
+			ret = esdm_rpcc_wait(rpc_conn, POLLIN, deadline);
+			if (ret == -EINTR) {
+				ret = 0;
+				interrupted = true;
+				break;
+			}
+
+			/*
+			 * Handle a deadline passed without an interruption like
+			 * a read timeout below.
+			 */
+			if (ret == -ETIMEDOUT) {
+				ret = EAGAIN;
+				goto out;
+			}
+			if (ret)
+				break;
+		}
+
+#ifdef ESDM_RPCC_IO_URING
+		if (rpc_conn->uring)
+			received = esdm_rpcc_uring_read(
+				rpc_conn->uring, buf_p, buflen - total_received);
+		else
+#endif
+			received = esdm_rpc_client_read(
+				rpc_conn, buf_p, buflen - total_received);
 		if (received < 0) {
 			/* Handle a read timeout due to SO_RCVTIMEO */
 			if (errno == EAGAIN || errno == EWOULDBLOCK) {
 				/* Does the caller wants us to interrupt? */
-				if (rpc_conn->interrupt_func &&
-				    rpc_conn->interrupt_func(
-					    rpc_conn->interrupt_data)) {
+				if (esdm_rpcc_interrupted(rpc_conn)) {
 					interrupted = true;
 					break;
 				}
@@ -456,8 +1051,8 @@ esdm_rpc_client_read_handler(esdm_rpc_client_connection_t *rpc_conn,
 			 * Truncate the buffer length if client specified
 			 * too much buffer data.
 			 */
-			if (header->message_length > ESDM_RPC_MAX_MSG_SIZE)
-				header->message_length = ESDM_RPC_MAX_MSG_SIZE;
+			if (header->message_length > max_msg_size)
+				header->message_length = max_msg_size;
 
 			/* How much data are we expecting to fetch? */
 			data_to_fetch = header->message_length;
@@ -477,20 +1072,48 @@ esdm_rpc_client_read_handler(esdm_rpc_client_connection_t *rpc_conn,
 		if (total_received >= data_to_fetch)
 			break;
 
-	} while (total_received < sizeof(buf));
+	} while (total_received < buflen);
+
+	/* The server is overloaded and did not process any request */
+	if (header && header->status_code ==
+			      PROTOBUF_C_RPC_STATUS_CODE_TOO_MANY_PENDING) {
+		esdm_rpcc_shed(rpc_conn);
+		esdm_rpc_client_entry_fail(entries, num, -EBUSY);
+		goto out;
+	}
+
+	/* Discard responses not belonging to any outstanding request */
+	if (header && ((header->request_id - first_id) >= num ||
+		       entries[header->request_id - first_id].done)) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Discarding stale response with request ID %u\n",
+			    header->request_id);
+		memset_secure(buf, 0, total_received);
+		esdm_rpc_client_close_fds(rpc_conn);
+		total_received = 0;
+		data_to_fetch = 0;
+		buf_p = buf;
+		header = NULL;
+		goto read_next;
+	}
 
 	if (header &&
 	    header->status_code == PROTOBUF_C_RPC_STATUS_CODE_SUCCESS) {
+		struct esdm_rpcc_pipeline_entry *entry =
+			&entries[header->request_id - first_id];
+
 		/*
 		 * We now have a filled buffer that has a header and received
 		 * as much data as the header defined. We also start the
 		 * processing of data which returns it to the caller.
 		 */
 		ProtobufCMessage *msg = protobuf_c_message_unpack(
-			message_desc, &esdm_rpc_client_allocator,
+			entry->desc, &esdm_rpc_client_allocator,
 			header->message_length, received_data->data);
+
+		entry->done = true;
 		if (msg) {
-			closure(msg, closure_data);
+			entry->closure(msg, entry->closure_data);
 			protobuf_c_message_free_unpacked(
 				msg, &esdm_rpc_client_allocator);
 			esdm_logger(
@@ -500,33 +1123,80 @@ esdm_rpc_client_read_handler(esdm_rpc_client_connection_t *rpc_conn,
 		} else {
 			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
 				    "Response message not found\n");
-			msg = ERR_PTR(-EFAULT);
-			closure(msg, closure_data);
+			entry->closure(ERR_PTR(-EFAULT), entry->closure_data);
 		}
-	} else if (interrupted) {
-		ProtobufCMessage *msg;
+	} else if (header) {
+		struct esdm_rpcc_pipeline_entry *entry =
+			&entries[header->request_id - first_id];
 
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+			    "Server returned with an error\n");
+		entry->done = true;
+		entry->closure(ERR_PTR(-EINTR), entry->closure_data);
+	} else if (interrupted) {
 		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
 			    "Request interrupted\n");
-		msg = ERR_PTR(-EINTR);
-		closure(msg, closure_data);
+		esdm_rpc_client_entry_fail(entries, num, -EINTR);
 	} else {
-		ProtobufCMessage *msg;
-
 		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
 			    "Server returned with an error\n");
-		msg = ERR_PTR(-EINTR);
-		closure(msg, closure_data);
+		esdm_rpc_client_entry_fail(entries, num, -EINTR);
 	}
 
 out:
+	esdm_rpc_client_close_fds(rpc_conn);
 	memset_secure(buf, 0, total_received);
-	memset_secure(tls.buf, 0, tls.consumed);
+	esdm_rpc_arena_reset(arena);
 	return ret;
 }
 
-static void esdm_client_invoke(ProtobufCService *service,
-			       unsigned int method_index,
+/*
+ * Pipelined operation: only send the request and record the closure that is
+ * invoked when the response is received with esdm_rpcc_pipeline_complete.
+ */
+static void esdm_client_invoke_pipeline(esdm_rpc_client_connection_t *rpc_conn,
+					unsigned int method_index,
+					const ProtobufCMessage *input,
+					struct esdm_rpcc_pipeline_entry *entry)
+{
+	struct esdm_rpcc_pipeline *pipeline = rpc_conn->pipeline;
+	uint32_t request_id;
+	int ret;
+
+	if (pipeline->num >= ESDM_CLIENT_PIPELINE_DEPTH) {
+		entry->closure(ERR_PTR(-EBUSY), entry->closure_data);
+		return;
+	}
+
+	if (rpc_conn->fd == -1)
+		CKINT(esdm_connect_proto_service(rpc_conn));
+
+	request_id = ++rpc_conn->request_id;
+
+	/* Request IDs of one pipeline must be consecutive */
+	if (!pipeline->num)
+		pipeline->first_id = request_id;
+
+	CKINT_LOG(esdm_rpc_client_pack(input, method_index, request_id,
+				       rpc_conn),
+		  "Sending of data failed: %d\n", ret);
+
+	pipeline->entry[pipeline->num] = *entry;
+	pipeline->num++;
+	esdm_rpcc_stats_call(rpc_conn->service.descriptor, method_index, 0, 0);
+
+	return;
+
+out:
+	/* The request was not sent, do not consume the request ID */
+	rpc_conn->request_id--;
+	esdm_rpcc_stats_call(rpc_conn->service.descriptor, method_index, 0,
+			     ret);
+	entry->closure(ERR_PTR(ret), entry->closure_data);
+}
+
+static void esdm_client_invoke(ProtobufCService *service,
+			       unsigned int method_index,
 			       const ProtobufCMessage *input,
 			       ProtobufCClosure closure, void *closure_data)
 {
@@ -534,10 +1204,26 @@ static void esdm_client_invoke(ProtobufCService *service,
 	const ProtobufCMethodDescriptor *method = desc->methods + method_index;
 	esdm_rpc_client_connection_t *rpc_conn =
 		(esdm_rpc_client_connection_t *)service;
+	struct esdm_rpcc_pipeline_entry entry = {
+		.desc = method->output,
+		.closure = closure,
+		.closure_data = closure_data,
+		.done = false,
+	};
+	uint64_t start;
+	uint32_t request_id;
 	int ret;
 
 	mutex_w_lock(&rpc_conn->lock);
 
+	if (rpc_conn->pipeline) {
+		esdm_client_invoke_pipeline(rpc_conn, method_index, input,
+					    &entry);
+		mutex_w_unlock(&rpc_conn->lock);
+		return;
+	}
+
+	start = esdm_rpcc_stats_start();
 	do {
 		/*
 		 * Connect to the server if we do not have a connection,
@@ -546,18 +1232,286 @@ static void esdm_client_invoke(ProtobufCService *service,
 		if (rpc_conn->fd == -1)
 			CKINT(esdm_connect_proto_service(rpc_conn));
 
+		/*
+		 * Each (re-)submission uses a new request ID which implies
+		 * that a late answer to a timed out request is discarded.
+		 */
+		request_id = ++rpc_conn->request_id;
+
 		/* Pack the protobuf-c data and send it over the wire */
-		CKINT_LOG(esdm_rpc_client_pack(input, method_index, rpc_conn),
+		CKINT_LOG(esdm_rpc_client_pack(input, method_index, request_id,
+					       rpc_conn),
 			  "Sending of data failed: %d\n", ret);
 
 		/* Receive data */
-		CKINT_LOG(esdm_rpc_client_read_handler(rpc_conn, method->output,
-						       closure, closure_data),
+		CKINT_LOG(esdm_rpc_client_read_handler(rpc_conn, request_id, 1,
+						       &entry),
 			  "Receiving of data failed: %d\n", ret);
+		if (ret == EAGAIN)
+			esdm_rpcc_stats_retry();
+	} while (ret == EAGAIN);
+
+out:
+	esdm_rpcc_stats_call(desc, method_index, start, ret);
+	mutex_w_unlock(&rpc_conn->lock);
+}
+
+void esdm_rpcc_pipeline_start(esdm_rpc_client_connection_t *rpc_conn,
+			      struct esdm_rpcc_pipeline *pipeline)
+{
+	pipeline->num = 0;
+	pipeline->first_id = 0;
+
+	mutex_w_lock(&rpc_conn->lock);
+	rpc_conn->pipeline = pipeline;
+	mutex_w_unlock(&rpc_conn->lock);
+}
+
+int esdm_rpcc_pipeline_complete(esdm_rpc_client_connection_t *rpc_conn)
+{
+	struct esdm_rpcc_pipeline *pipeline;
+	uint32_t i;
+	int ret = 0;
+
+	mutex_w_lock(&rpc_conn->lock);
+
+	pipeline = rpc_conn->pipeline;
+	rpc_conn->pipeline = NULL;
+	CKNULL(pipeline, -EINVAL);
+
+	/*
+	 * The server processes the requests of one connection in order,
+	 * but the request ID based matching does not rely on it. Each
+	 * successful call of the read handler completes one request.
+	 */
+	for (i = 0; i < pipeline->num; i++) {
+		ret = esdm_rpc_client_read_handler(rpc_conn,
+						   pipeline->first_id,
+						   pipeline->num,
+						   pipeline->entry);
+		if (ret)
+			break;
+	}
+
+	/* A timeout is not resubmitted here, report it to the caller */
+	if (ret == EAGAIN)
+		ret = -ETIMEDOUT;
+
+	/* Ensure that every closure is invoked */
+	for (i = 0; i < pipeline->num; i++) {
+		if (!pipeline->entry[i].done) {
+			pipeline->entry[i].done = true;
+			pipeline->entry[i].closure(
+				ERR_PTR(ret ? ret : -EFAULT),
+				pipeline->entry[i].closure_data);
+		}
+	}
+
+out:
+	mutex_w_unlock(&rpc_conn->lock);
+	return ret;
+}
+
+int esdm_rpcc_pipeline_receive(esdm_rpc_client_connection_t *rpc_conn)
+{
+	struct esdm_rpcc_pipeline *pipeline;
+	int ret;
+
+	mutex_w_lock(&rpc_conn->lock);
+
+	pipeline = rpc_conn->pipeline;
+	if (!pipeline || !pipeline->num) {
+		ret = -ENODATA;
+		goto out;
+	}
+
+	ret = esdm_rpc_client_read_handler(rpc_conn, pipeline->first_id,
+					   pipeline->num, pipeline->entry);
+	if (ret == EAGAIN)
+		ret = -EAGAIN;
+
+	/* Drop the completed requests from the head of the pipeline */
+	while (pipeline->num && pipeline->entry[0].done) {
+		pipeline->num--;
+		pipeline->first_id++;
+		memmove(&pipeline->entry[0], &pipeline->entry[1],
+			pipeline->num * sizeof(pipeline->entry[0]));
+	}
+
+out:
+	mutex_w_unlock(&rpc_conn->lock);
+	return ret;
+}
+
+int esdm_rpcc_connect(esdm_rpc_client_connection_t *rpc_conn)
+{
+	int ret;
+
+	mutex_w_lock(&rpc_conn->lock);
+	ret = esdm_connect_proto_service(rpc_conn);
+	mutex_w_unlock(&rpc_conn->lock);
+
+	return ret;
+}
+
+/*
+ * Receive the response to a compact request: the header is read into the
+ * header buffer, the random bytes directly into the caller's buffer which
+ * avoids a copy through the receive buffer.
+ */
+static int esdm_rpcc_fast_read(esdm_rpc_client_connection_t *rpc_conn,
+			       uint32_t method, struct esdm_rpc_fast_sc *rsp,
+			       uint8_t *buf, size_t buflen)
+{
+	struct iovec iov[2];
+	struct msghdr msg = { 0 };
+	size_t total = 0, expected = sizeof(*rsp);
+	ssize_t received;
+	bool header = false;
+
+	do {
+		if (total < sizeof(*rsp)) {
+			iov[0].iov_base = (uint8_t *)rsp + total;
+			iov[0].iov_len = sizeof(*rsp) - total;
+			iov[1].iov_base = buf;
+			iov[1].iov_len = buflen;
+			msg.msg_iovlen = 2;
+		} else {
+			iov[0].iov_base = buf + total - sizeof(*rsp);
+			iov[0].iov_len = expected - total;
+			msg.msg_iovlen = 1;
+		}
+		msg.msg_iov = iov;
+
+		received = recvmsg(rpc_conn->fd, &msg, 0);
+		if (received < 0)
+			return -errno;
+		if (received == 0)
+			return -EPIPE;
+		total += (size_t)received;
+
+		if (!header && total >= sizeof(*rsp)) {
+			header = true;
+			rsp->status = le_bswap32(rsp->status);
+			rsp->method = le_bswap32(rsp->method);
+			rsp->length = le_bswap32(rsp->length);
+
+			if (rsp->method != (ESDM_RPC_FAST_MAGIC | method) ||
+			    rsp->length > buflen)
+				return -EFAULT;
+			expected += rsp->length;
+		}
+	} while (total < expected);
+
+	return (total == expected) ? 0 : -EFAULT;
+}
+
+int esdm_rpcc_fast_call(esdm_rpc_client_connection_t *rpc_conn,
+			uint32_t method, uint8_t *buf, size_t buflen,
+			ssize_t *status)
+{
+	struct esdm_rpc_fast_cs req;
+	struct esdm_rpc_fast_sc rsp;
+	uint64_t start;
+	int ret = -EOPNOTSUPP;
+
+	mutex_w_lock(&rpc_conn->lock);
+
+	if (!rpc_conn->fast_wire || rpc_conn->pipeline || rpc_conn->fd < 0 ||
+	    buflen > UINT32_MAX)
+		goto out;
+
+	start = esdm_rpcc_stats_start();
+
+	req.method = le_bswap32(ESDM_RPC_FAST_MAGIC | method);
+	req.flags = 0;
+	if (rpc_conn->cpu_hint)
+		req.flags = le_bswap32(
+			ESDM_RPC_FAST_FLAG_CPU |
+			(esdm_curr_node() & ESDM_RPC_FAST_CPU_MASK));
+	req.length = le_bswap32((uint32_t)buflen);
+
+	/* The request is smaller than any socket buffer */
+	if (write(rpc_conn->fd, &req, sizeof(req)) != sizeof(req)) {
+		ret = -errno;
+		goto reset;
+	}
+
+	ret = esdm_rpcc_fast_read(rpc_conn, method, &rsp, buf, buflen);
+	if (ret)
+		goto reset;
+
+	/* A positive status of a request for random bytes is their length */
+	if (buflen && (int32_t)rsp.status > 0 && rsp.length != rsp.status) {
+		ret = -EFAULT;
+		goto reset;
+	}
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Client received compact response: status %d, length %u\n",
+		    (int32_t)rsp.status, rsp.length);
+
+	*status = (int32_t)rsp.status;
+	esdm_rpcc_stats_fast_call(method, start, 0);
+	goto out;
+
+reset:
+	/*
+	 * A failed or timed out request leaves the connection in an unknown
+	 * state: close it and let the caller use the regular request which
+	 * re-establishes the connection.
+	 */
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Compact request failed: %d, closing connection\n", ret);
+	memset_secure(buf, 0, buflen);
+	close(rpc_conn->fd);
+	rpc_conn->fd = -1;
+	rpc_conn->max_msg_size = 0;
+	rpc_conn->fast_wire = false;
+	rpc_conn->cpu_hint = false;
+	ret = -EOPNOTSUPP;
+	esdm_rpcc_stats_fast_call(method, start, ret);
+
+out:
+	mutex_w_unlock(&rpc_conn->lock);
+	return ret;
+}
+
+int esdm_rpcc_pipeline_stream(esdm_rpc_client_connection_t *rpc_conn,
+			      struct esdm_rpcc_pipeline *pipeline)
+{
+	struct esdm_rpcc_pipeline_entry *entry = &pipeline->entry[0];
+	int ret = 0;
+
+	mutex_w_lock(&rpc_conn->lock);
+
+	rpc_conn->pipeline = NULL;
+	if (pipeline->num != 1) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Every response of the stream completes the request anew */
+	entry->done = false;
+
+	/*
+	 * A timeout only implies that the server did not yet send the next
+	 * response - a stream request is never resubmitted.
+	 */
+	do {
+		ret = esdm_rpc_client_read_handler(rpc_conn, pipeline->first_id,
+						   1, entry);
 	} while (ret == EAGAIN);
 
+	if (!entry->done) {
+		entry->done = true;
+		entry->closure(ERR_PTR(ret ? ret : -EFAULT),
+			       entry->closure_data);
+	}
+
 out:
 	mutex_w_unlock(&rpc_conn->lock);
+	return ret;
 }
 
 static void esdm_client_destroy(ProtobufCService *service)
@@ -573,9 +1527,16 @@ static void esdm_client_destroy(ProtobufCService *service)
 	mutex_w_unlock(&rpc_conn->lock);
 }
 
+/* Transport of the unprivileged interface */
+static uint32_t esdm_rpcc_vsock_cid = 0;
+static uint32_t esdm_rpcc_vsock_port = 0;
+static char esdm_rpcc_fallback_socketname[FILENAME_MAX] = { 0 };
+static uint32_t esdm_rpcc_shards = 0;
+
 static int esdm_init_proto_service(const ProtobufCServiceDescriptor *descriptor,
 				   const char *socketname,
 				   esdm_rpcc_interrupt_func_t interrupt_func,
+				   uint32_t node, uint32_t nodes,
 				   esdm_rpc_client_connection_t *rpc_conn)
 {
 	ProtobufCService *service;
@@ -586,7 +1547,38 @@ static int esdm_init_proto_service(const ProtobufCServiceDescriptor *descriptor,
 
 	strncpy(rpc_conn->socketname, socketname, sizeof(rpc_conn->socketname));
 	rpc_conn->socketname[sizeof(rpc_conn->socketname) - 1] = '\0';
+
+	/* Only the unprivileged interface is offered on the vsock transport */
+	if (descriptor == &unpriv_access__descriptor) {
+		rpc_conn->vsock_cid = esdm_rpcc_vsock_cid;
+		rpc_conn->vsock_port = esdm_rpcc_vsock_port;
+		memcpy(rpc_conn->fallback_socketname,
+		       esdm_rpcc_fallback_socketname,
+		       sizeof(rpc_conn->fallback_socketname));
+	} else {
+		rpc_conn->vsock_cid = 0;
+		rpc_conn->vsock_port = 0;
+		rpc_conn->fallback_socketname[0] = '\0';
+	}
+	rpc_conn->endpoint = esdm_rpcc_endpoint_primary;
 	rpc_conn->interrupt_func = interrupt_func;
+	esdm_rpcc_wake_init(rpc_conn);
+
+	/*
+	 * The ESDM server seeding the shards serves the requests while the
+	 * shard is unavailable.
+	 */
+	if (descriptor == &unpriv_access__descriptor && esdm_rpcc_shards &&
+	    !rpc_conn->vsock_port) {
+		esdm_rpc_shard_socket(rpc_conn->socketname,
+				      sizeof(rpc_conn->socketname), socketname,
+				      esdm_rpc_shard_of_node(node, nodes,
+							     esdm_rpcc_shards));
+		if (!esdm_rpcc_has_fallback(rpc_conn))
+			snprintf(rpc_conn->fallback_socketname,
+				 sizeof(rpc_conn->fallback_socketname), "%s",
+				 socketname);
+	}
 
 	service->descriptor = descriptor;
 	service->invoke = esdm_client_invoke;
@@ -594,6 +1586,18 @@ static int esdm_init_proto_service(const ProtobufCServiceDescriptor *descriptor,
 
 	mutex_w_init(&rpc_conn->ref_cnt, 0, 1);
 	rpc_conn->fd = -1;
+	rpc_conn->request_id = 0;
+	rpc_conn->pipeline = NULL;
+	rpc_conn->nonblocking = false;
+	rpc_conn->max_msg_size = 0;
+	rpc_conn->negotiate_unsupported = false;
+	rpc_conn->fast_wire = false;
+	rpc_conn->cpu_hint = false;
+	rpc_conn->rx_buf = NULL;
+	rpc_conn->rx_buf_size = 0;
+#ifdef ESDM_RPC_PASS_FDS
+	rpc_conn->num_recv_fds = 0;
+#endif
 	mutex_w_init(&rpc_conn->lock, 0, 1);
 	atomic_set(&rpc_conn->state, esdm_rpcc_initialized);
 
@@ -605,6 +1609,7 @@ out:
  * General service handlers
  ******************************************************************************/
 static uint32_t esdm_rpcc_max_nodes = UINT32_MAX;
+static uint32_t esdm_rpcc_pool_size = 0;
 
 DSO_PUBLIC
 int esdm_rpcc_set_max_online_nodes(uint32_t nodes)
@@ -613,14 +1618,136 @@ int esdm_rpcc_set_max_online_nodes(uint32_t nodes)
 	return 0;
 }
 
-static uint32_t esdm_rpcc_get_online_nodes(void)
+DSO_PUBLIC
+int esdm_rpcc_set_connection_pool_size(uint32_t conns)
+{
+	esdm_rpcc_pool_size = conns;
+	return 0;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_set_vsock_transport(uint32_t cid, uint32_t port)
+{
+#ifdef ESDM_RPCC_VSOCK
+	esdm_rpcc_vsock_cid = cid;
+	esdm_rpcc_vsock_port = port;
+	return 0;
+#else
+	(void)cid;
+	(void)port;
+	return -EOPNOTSUPP;
+#endif
+}
+
+DSO_PUBLIC
+int esdm_rpcc_set_shards(uint32_t shards)
+{
+	esdm_rpcc_shards = shards;
+	return 0;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_set_fallback_unpriv_socket(const char *socketname)
+{
+	if (!socketname) {
+		esdm_rpcc_fallback_socketname[0] = '\0';
+		return 0;
+	}
+
+	if (strlen(socketname) >= sizeof(esdm_rpcc_fallback_socketname))
+		return -ENAMETOOLONG;
+
+	strncpy(esdm_rpcc_fallback_socketname, socketname,
+		sizeof(esdm_rpcc_fallback_socketname));
+	return 0;
+}
+
+bool esdm_rpcc_local_transport(void)
 {
-	return (min_uint32(esdm_rpcc_max_nodes, esdm_online_nodes()));
+	return !esdm_rpcc_vsock_port;
 }
 
-static uint32_t esdm_rpcc_curr_node(void)
+/* Number of connections to be allocated for one service */
+static uint32_t esdm_rpcc_get_pool_size(void)
 {
-	return (esdm_curr_node() % esdm_rpcc_max_nodes);
+	uint32_t conns = esdm_rpcc_pool_size;
+
+	if (!conns)
+		conns = esdm_online_nodes();
+
+	return max_uint32(min_uint32(esdm_rpcc_max_nodes, conns), 1);
+}
+
+/*
+ * Fork handling: a child process inherits the connections of its parent.
+ * Using the same socket in both processes interleaves their requests and
+ * responses. Thus, the child drops all inherited connections which are
+ * re-established lazily with its first request.
+ *
+ * The atfork handler covers fork(3). The marker residing in a page mapped
+ * with MADV_WIPEONFORK reads as zero in a child which was created without
+ * invoking the atfork handlers, e.g. with a raw clone(2). In this case, the
+ * inherited file descriptors are not closed as the child may have reused
+ * their numbers already.
+ */
+enum {
+	esdm_rpcc_fork_wiped,
+	esdm_rpcc_fork_resetting,
+	esdm_rpcc_fork_valid,
+};
+static atomic_t *esdm_rpcc_fork_marker = NULL;
+static pthread_once_t esdm_rpcc_fork_once = PTHREAD_ONCE_INIT;
+
+static void esdm_rpcc_fork_reset(bool close_fds);
+
+static void esdm_rpcc_fork_atfork_child(void)
+{
+	esdm_rpcc_fork_reset(true);
+	if (esdm_rpcc_fork_marker)
+		atomic_set(esdm_rpcc_fork_marker, esdm_rpcc_fork_valid);
+}
+
+static void esdm_rpcc_fork_init(void)
+{
+#ifdef MADV_WIPEONFORK
+	long pagesize = sysconf(_SC_PAGESIZE);
+	void *page;
+
+	page = mmap(NULL, (size_t)pagesize, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (page != MAP_FAILED) {
+		if (madvise(page, (size_t)pagesize, MADV_WIPEONFORK)) {
+			munmap(page, (size_t)pagesize);
+		} else {
+			esdm_rpcc_fork_marker = page;
+			atomic_set(esdm_rpcc_fork_marker, esdm_rpcc_fork_valid);
+		}
+	}
+#endif
+
+	pthread_atfork(NULL, NULL, esdm_rpcc_fork_atfork_child);
+}
+
+/* Detect a child process which did not invoke the atfork handlers */
+static void esdm_rpcc_fork_check(void)
+{
+	atomic_t *marker = esdm_rpcc_fork_marker;
+
+	if (!marker || atomic_read(marker) == esdm_rpcc_fork_valid)
+		return;
+
+	if (atomic_cmpxchg(marker, esdm_rpcc_fork_wiped,
+			   esdm_rpcc_fork_resetting) == esdm_rpcc_fork_wiped) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Inherited connections dropped in child process\n");
+		esdm_rpcc_fork_reset(false);
+		atomic_set(marker, esdm_rpcc_fork_valid);
+		return;
+	}
+
+	/* Another thread resets the connections */
+	while (atomic_read(marker) != esdm_rpcc_fork_valid)
+		sched_yield();
 }
 
 static void esdm_rpcc_fini_service(esdm_rpc_client_connection_t **rpc_conn,
@@ -678,9 +1805,11 @@ static int esdm_rpcc_init_service(const ProtobufCServiceDescriptor *descriptor,
 				  uint32_t *num_conn)
 {
 	esdm_rpc_client_connection_t *tmp = *rpc_conn, *tmp_p;
-	uint32_t i = 0, nodes = esdm_rpcc_get_online_nodes();
+	uint32_t i = 0, nodes = esdm_rpcc_get_pool_size();
 	int ret = 0;
 
+	pthread_once(&esdm_rpcc_fork_once, esdm_rpcc_fork_init);
+
 	/*
 	 * It is a legitimate scenario that this function is called twice for
 	 * one connection as follows: if the libesdm_getrandom is preloaded, the
@@ -729,7 +1858,7 @@ static int esdm_rpcc_init_service(const ProtobufCServiceDescriptor *descriptor,
 
 	for (i = 0, tmp_p = tmp; i < nodes; i++, tmp_p++) {
 		CKINT(esdm_init_proto_service(descriptor, socketname,
-					      interrupt_func, tmp_p));
+					      interrupt_func, i, nodes, tmp_p));
 	}
 
 	CKINT(esdm_test_shm_status_init());
@@ -764,22 +1893,38 @@ static int esdm_rpcc_get_service(esdm_rpc_client_connection_t *rpc_conn_array,
 				 void *int_data)
 {
 	esdm_rpc_client_connection_t *rpc_conn_p;
-	/* Protection against client programming errors */
-	uint32_t node = min_uint32(esdm_rpcc_curr_node(), num_conn);
+	uint32_t i, home;
 	int ret = 0;
 
 	CKNULL(rpc_conn_array, -EFAULT);
 	CKNULL(ret_rpc_conn, -EFAULT);
+	if (!num_conn)
+		return -EFAULT;
+
+	esdm_rpcc_fork_check();
 
-	rpc_conn_p = rpc_conn_array + node;
+	/*
+	 * Each connection handle has only one caller at one given time which
+	 * holds the ref_cnt lock. The home connection is derived from the
+	 * current CPU to keep the connection cache-local. If it is busy, take
+	 * any idle connection. The probing does not block.
+	 */
+	home = esdm_curr_node() % num_conn;
+	for (i = 0; i < num_conn; i++) {
+		rpc_conn_p = rpc_conn_array + ((home + i) % num_conn);
+		if (mutex_w_trylock(&rpc_conn_p->ref_cnt))
+			goto locked;
+	}
 
 	/*
-	 * Wait until the previous call completed - each connection handle is
-	 * has only one caller at one given time. Lock the ref_cnt if we
-	 * obtained the connection handle.
+	 * All connections are busy - wait until the previous call on the home
+	 * connection completed.
 	 */
+	rpc_conn_p = rpc_conn_array + home;
 	mutex_w_lock(&rpc_conn_p->ref_cnt);
 
+locked:
+
 	if (atomic_read(&rpc_conn_p->state) != esdm_rpcc_initialized) {
 		mutex_w_unlock(&rpc_conn_p->ref_cnt);
 
@@ -791,6 +1936,7 @@ static int esdm_rpcc_get_service(esdm_rpc_client_connection_t *rpc_conn_array,
 
 	*ret_rpc_conn = rpc_conn_p;
 	rpc_conn_p->interrupt_data = int_data;
+	esdm_rpcc_reprobe_primary(rpc_conn_p);
 
 out:
 	return ret;
@@ -810,10 +1956,155 @@ static void esdm_rpcc_put_service(esdm_rpc_client_connection_t *rpc_conn)
 static esdm_rpc_client_connection_t *unpriv_rpc_conn = NULL;
 static uint32_t unpriv_rpc_conn_num = 0;
 
+/*
+ * Thread-bound connections: when enabled, a thread obtains its own
+ * connection with the first request which is used for all subsequent
+ * requests of the thread. The connection is released when the thread
+ * terminates. All thread-bound connections are linked in a list allowing
+ * esdm_rpcc_fini_unpriv_service to terminate them. A terminated connection
+ * is released by its thread with the next request or when the thread exits.
+ */
+static bool esdm_rpcc_tls_enabled = false;
+static __thread esdm_rpc_client_connection_t *esdm_rpcc_tls_conn = NULL;
+static esdm_rpc_client_connection_t *esdm_rpcc_tls_list = NULL;
+static DEFINE_MUTEX_W_UNLOCKED(esdm_rpcc_tls_list_lock);
+static pthread_key_t esdm_rpcc_tls_key;
+static pthread_once_t esdm_rpcc_tls_once = PTHREAD_ONCE_INIT;
+static int esdm_rpcc_tls_key_ret = 0;
+
+static void esdm_rpcc_tls_release(esdm_rpc_client_connection_t *rpc_conn)
+{
+	mutex_w_lock(&esdm_rpcc_tls_list_lock);
+	if (rpc_conn->tls_prev)
+		rpc_conn->tls_prev->tls_next = rpc_conn->tls_next;
+	else
+		esdm_rpcc_tls_list = rpc_conn->tls_next;
+	if (rpc_conn->tls_next)
+		rpc_conn->tls_next->tls_prev = rpc_conn->tls_prev;
+	mutex_w_unlock(&esdm_rpcc_tls_list_lock);
+
+	esdm_rpcc_free_unpriv_conn(rpc_conn);
+}
+
+/* Destructor invoked when a thread owning a connection terminates */
+static void esdm_rpcc_tls_destructor(void *data)
+{
+	esdm_rpc_client_connection_t *rpc_conn = data;
+
+	if (!rpc_conn)
+		return;
+
+	esdm_rpcc_tls_conn = NULL;
+	esdm_rpcc_tls_release(rpc_conn);
+}
+
+static void esdm_rpcc_tls_key_init(void)
+{
+	esdm_rpcc_tls_key_ret = -pthread_key_create(&esdm_rpcc_tls_key,
+						    esdm_rpcc_tls_destructor);
+}
+
+/* Terminate all thread-bound connections */
+static void esdm_rpcc_tls_fini(void)
+{
+	esdm_rpc_client_connection_t *rpc_conn;
+	struct timespec abstime;
+	int lock_res;
+
+	mutex_w_lock(&esdm_rpcc_tls_list_lock);
+	for (rpc_conn = esdm_rpcc_tls_list; rpc_conn;
+	     rpc_conn = rpc_conn->tls_next) {
+		atomic_set(&rpc_conn->state, esdm_rpcc_in_termination);
+
+		/* Wait for an ongoing request of the owning thread */
+		clock_gettime(CLOCK_MONOTONIC, &abstime);
+		abstime.tv_sec += 1;
+		lock_res = mutex_w_timedlock(&rpc_conn->ref_cnt, &abstime);
+
+		/* The memory is released by the owning thread */
+		esdm_client_destroy(&rpc_conn->service);
+
+		if (lock_res == 0)
+			mutex_w_unlock(&rpc_conn->ref_cnt);
+	}
+	mutex_w_unlock(&esdm_rpcc_tls_list_lock);
+}
+
+static int esdm_rpcc_get_tls_service(esdm_rpc_client_connection_t **rpc_conn,
+				     void *int_data)
+{
+	esdm_rpc_client_connection_t *tmp;
+	int ret;
+
+	esdm_rpcc_fork_check();
+	tmp = esdm_rpcc_tls_conn;
+
+	/* Drop a connection terminated by esdm_rpcc_fini_unpriv_service */
+	if (tmp && atomic_read(&tmp->state) != esdm_rpcc_initialized) {
+		esdm_rpcc_tls_conn = NULL;
+		pthread_setspecific(esdm_rpcc_tls_key, NULL);
+		esdm_rpcc_tls_release(tmp);
+		tmp = NULL;
+	}
+
+	if (!tmp) {
+		/* Thread-bound connections require an initialized service */
+		CKNULL(unpriv_rpc_conn, -EFAULT);
+
+		CKINT(pthread_once(&esdm_rpcc_tls_once,
+				   esdm_rpcc_tls_key_init));
+		CKINT(esdm_rpcc_tls_key_ret);
+
+		CKINT(esdm_rpcc_alloc_unpriv_conn(&tmp, int_data));
+		ret = -pthread_setspecific(esdm_rpcc_tls_key, tmp);
+		if (ret) {
+			esdm_rpcc_free_unpriv_conn(tmp);
+			goto out;
+		}
+
+		mutex_w_lock(&esdm_rpcc_tls_list_lock);
+		tmp->tls_next = esdm_rpcc_tls_list;
+		if (esdm_rpcc_tls_list)
+			esdm_rpcc_tls_list->tls_prev = tmp;
+		esdm_rpcc_tls_list = tmp;
+		mutex_w_unlock(&esdm_rpcc_tls_list_lock);
+
+		esdm_rpcc_tls_conn = tmp;
+	}
+
+	/*
+	 * The lock is only contended by esdm_rpcc_fini_unpriv_service, it
+	 * allows the termination to wait for an ongoing request.
+	 */
+	mutex_w_lock(&tmp->ref_cnt);
+	if (atomic_read(&tmp->state) != esdm_rpcc_initialized) {
+		mutex_w_unlock(&tmp->ref_cnt);
+		*rpc_conn = NULL;
+		return -ESHUTDOWN;
+	}
+
+	tmp->interrupt_data = int_data;
+	esdm_rpcc_reprobe_primary(tmp);
+	*rpc_conn = tmp;
+
+out:
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_set_thread_bound_connections(bool enable)
+{
+	esdm_rpcc_tls_enabled = enable;
+	return 0;
+}
+
 DSO_PUBLIC
 int esdm_rpcc_get_unpriv_service(esdm_rpc_client_connection_t **rpc_conn,
 				 void *int_data)
 {
+	if (esdm_rpcc_tls_enabled)
+		return esdm_rpcc_get_tls_service(rpc_conn, int_data);
+
 	return esdm_rpcc_get_service(unpriv_rpc_conn, unpriv_rpc_conn_num,
 				     rpc_conn, int_data);
 }
@@ -835,9 +2126,50 @@ int esdm_rpcc_init_unpriv_service(esdm_rpcc_interrupt_func_t interrupt_func)
 DSO_PUBLIC
 void esdm_rpcc_fini_unpriv_service(void)
 {
+	esdm_rpcc_ring_fini();
+	esdm_rpcc_tls_fini();
 	esdm_rpcc_fini_service(&unpriv_rpc_conn, &unpriv_rpc_conn_num);
 }
 
+int esdm_rpcc_alloc_unpriv_conn(esdm_rpc_client_connection_t **rpc_conn,
+				void *int_data)
+{
+	esdm_rpc_client_connection_t *tmp;
+	esdm_rpcc_interrupt_func_t interrupt_func = NULL;
+	int ret;
+
+	if (unpriv_rpc_conn)
+		interrupt_func = unpriv_rpc_conn->interrupt_func;
+
+	tmp = calloc(1, sizeof(*tmp));
+	CKNULL(tmp, -ENOMEM);
+
+	ret = esdm_init_proto_service(&unpriv_access__descriptor,
+				      ESDM_RPC_UNPRIV_SOCKET, interrupt_func,
+				      esdm_curr_node(), esdm_online_nodes(),
+				      tmp);
+	if (ret) {
+		free(tmp);
+		goto out;
+	}
+
+	tmp->interrupt_data = int_data;
+	esdm_rpcc_reprobe_primary(tmp);
+	*rpc_conn = tmp;
+
+out:
+	return ret;
+}
+
+void esdm_rpcc_free_unpriv_conn(esdm_rpc_client_connection_t *rpc_conn)
+{
+	if (!rpc_conn)
+		return;
+
+	esdm_fini_proto_service(rpc_conn);
+	free(rpc_conn);
+}
+
 /******************************************************************************
  * Privileged connection
  ******************************************************************************/
@@ -869,5 +2201,90 @@ int esdm_rpcc_init_priv_service(esdm_rpcc_interrupt_func_t interrupt_func)
 DSO_PUBLIC
 void esdm_rpcc_fini_priv_service(void)
 {
+	esdm_rpcc_ent_ring_fini();
 	esdm_rpcc_fini_service(&priv_rpc_conn, &priv_rpc_conn_num);
 }
+
+/******************************************************************************
+ * Interruption of waiting callers
+ ******************************************************************************/
+DSO_PUBLIC
+void esdm_rpcc_interrupt(void)
+{
+	esdm_rpc_client_connection_t *rpc_conn;
+	uint32_t i;
+
+	for (i = 0, rpc_conn = unpriv_rpc_conn;
+	     rpc_conn && i < unpriv_rpc_conn_num; i++, rpc_conn++)
+		esdm_rpcc_wake(rpc_conn);
+	for (i = 0, rpc_conn = priv_rpc_conn;
+	     rpc_conn && i < priv_rpc_conn_num; i++, rpc_conn++)
+		esdm_rpcc_wake(rpc_conn);
+
+	mutex_w_lock(&esdm_rpcc_tls_list_lock);
+	for (rpc_conn = esdm_rpcc_tls_list; rpc_conn;
+	     rpc_conn = rpc_conn->tls_next)
+		esdm_rpcc_wake(rpc_conn);
+	mutex_w_unlock(&esdm_rpcc_tls_list_lock);
+}
+
+/******************************************************************************
+ * Fork handling
+ ******************************************************************************/
+static void esdm_rpcc_fork_reset_conn(esdm_rpc_client_connection_t *rpc_conn,
+				      bool close_fd)
+{
+	/* A thread of the parent may have held the locks while forking */
+	mutex_w_init(&rpc_conn->lock, 0, 1);
+	mutex_w_init(&rpc_conn->ref_cnt, 0, 1);
+
+	if (close_fd && rpc_conn->fd >= 0)
+		close(rpc_conn->fd);
+	rpc_conn->fd = -1;
+	rpc_conn->endpoint = esdm_rpcc_endpoint_primary;
+
+	/* A wake up of the parent must not interrupt the child */
+	if (close_fd)
+		esdm_rpcc_wake_fini(rpc_conn);
+	esdm_rpcc_wake_init(rpc_conn);
+	rpc_conn->request_id = 0;
+	rpc_conn->pipeline = NULL;
+	rpc_conn->max_msg_size = 0;
+	rpc_conn->negotiate_unsupported = false;
+	rpc_conn->fast_wire = false;
+	rpc_conn->cpu_hint = false;
+#ifdef ESDM_RPC_PASS_FDS
+	rpc_conn->num_recv_fds = 0;
+#endif
+
+	/* The child must never see the random numbers of the parent */
+	if (rpc_conn->rx_buf)
+		memset_secure(rpc_conn->rx_buf, 0, rpc_conn->rx_buf_size);
+}
+
+static void esdm_rpcc_fork_reset(bool close_fds)
+{
+	esdm_rpc_client_connection_t *rpc_conn, *next;
+	uint32_t i;
+
+	for (i = 0; unpriv_rpc_conn && i < unpriv_rpc_conn_num; i++)
+		esdm_rpcc_fork_reset_conn(unpriv_rpc_conn + i, close_fds);
+	for (i = 0; priv_rpc_conn && i < priv_rpc_conn_num; i++)
+		esdm_rpcc_fork_reset_conn(priv_rpc_conn + i, close_fds);
+
+	mutex_w_init(&esdm_rpcc_tls_list_lock, 0, 0);
+	for (rpc_conn = esdm_rpcc_tls_list; rpc_conn; rpc_conn = next) {
+		next = rpc_conn->tls_next;
+		esdm_rpcc_fork_reset_conn(rpc_conn, close_fds);
+
+		/*
+		 * Only the forking thread exists in a child created by fork(3),
+		 * the connections of all other threads are unreachable.
+		 */
+		if (close_fds && rpc_conn != esdm_rpcc_tls_conn)
+			esdm_rpcc_tls_release(rpc_conn);
+	}
+
+	/* Failures seen by the parent do not apply to the new connections */
+	esdm_rpcc_health_reset();
+}
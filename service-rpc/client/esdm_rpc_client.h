@@ -28,6 +28,8 @@
 #include <time.h>
 #include <errno.h>
 
+#include "esdm_status_bin.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -73,6 +75,128 @@ typedef struct esdm_rpc_client_connection esdm_rpc_client_connection_t;
  */
 int esdm_rpcc_set_max_online_nodes(uint32_t nodes);
 
+/**
+ * @brief Set number of connections per service
+ *
+ * By default, the number of connections allocated during initialization of
+ * the services with esdm_rpcc_init_unpriv_service and
+ * esdm_rpcc_init_priv_service is the number of CPUs. This call sets the
+ * number of connections independently of the number of CPUs. The limit set
+ * with esdm_rpcc_set_max_online_nodes still applies.
+ *
+ * A request uses the connection associated with the current CPU. If that
+ * connection is busy, any idle connection is used. Only when all connections
+ * are busy, the request waits. Thus, a small number of connections still
+ * allows parallel requests from multiple threads.
+ *
+ * @param [in] conns Number of connections, 0 selects the number of CPUs
+ *
+ * @return 0 on success, 0 < on error
+ */
+int esdm_rpcc_set_connection_pool_size(uint32_t conns);
+
+/**
+ * @brief Bind unprivileged connections to threads
+ *
+ * When enabled, esdm_rpcc_get_unpriv_service provides each thread with its
+ * own connection which is created with the first request of the thread and
+ * used for all its subsequent requests. Thus, requests of different threads
+ * never contend for a connection. The connection is released when the
+ * thread terminates. esdm_rpcc_fini_unpriv_service terminates all
+ * thread-bound connections.
+ *
+ * The unprivileged service must be initialized with
+ * esdm_rpcc_init_unpriv_service before thread-bound connections can be
+ * obtained.
+ *
+ * @param [in] enable Enable (true) or disable (false) thread-bound connections
+ *
+ * @return 0 on success, 0 < on error
+ */
+int esdm_rpcc_set_thread_bound_connections(bool enable);
+
+/**
+ * @brief Use a vsock transport for the unprivileged interface
+ *
+ * A virtual machine guest can obtain random numbers from the ESDM server of
+ * its host if the server offers its unprivileged interface on a vsock port.
+ * The transport applies to all unprivileged connections created after this
+ * call, i.e. it should be set before esdm_rpcc_init_unpriv_service.
+ *
+ * Services which pass file descriptors, like the shared memory random ring,
+ * are not available with this transport - the calls transparently use
+ * regular RPC requests instead.
+ *
+ * @param [in] cid Context ID of the ESDM server - 2 (VMADDR_CID_HOST) refers
+ *		   to the host
+ * @param [in] port vsock port of the ESDM server, 0 selects the Unix domain
+ *		    socket again
+ *
+ * @return 0 on success, 0 < on error
+ */
+int esdm_rpcc_set_vsock_transport(uint32_t cid, uint32_t port);
+
+/**
+ * @brief Use a fallback Unix domain socket for the unprivileged interface
+ *
+ * If the primary endpoint of the unprivileged interface (the regular Unix
+ * domain socket or the vsock transport) refuses the connection or is
+ * unavailable, the connection is established with the fallback socket
+ * instead, e.g. a second ESDM server instance. The failover happens without
+ * the reconnect delay. The health of each endpoint is tracked separately: a
+ * connection served by the fallback returns to the primary endpoint once it
+ * is available again, which is probed after its backoff time expired.
+ *
+ * The fallback applies to all unprivileged connections created after this
+ * call, i.e. it should be set before esdm_rpcc_init_unpriv_service.
+ *
+ * @param [in] socketname Path of the fallback socket, NULL disables the
+ *			  fallback
+ *
+ * @return 0 on success, 0 < on error
+ */
+int esdm_rpcc_set_fallback_unpriv_socket(const char *socketname);
+
+/**
+ * @brief Use the shards of a sharded ESDM server
+ *
+ * A sharded server consists of the ESDM server on the default sockets which
+ * holds the entropy sources and the given number of shard servers started
+ * with the --shard and --shards options. Each shard serves a contiguous block
+ * of the CPUs with its own DRNG instances and is seeded by the ESDM server.
+ * The unprivileged connections of the callers on the CPUs of one block are
+ * established with the shard serving it. While a shard is unavailable, its
+ * connections use the ESDM server on the default socket unless a fallback
+ * socket is configured with esdm_rpcc_set_fallback_unpriv_socket. The
+ * privileged interface is always served by the ESDM server on the default
+ * socket.
+ *
+ * The setting applies to all unprivileged connections created after this
+ * call, i.e. it should be set before esdm_rpcc_init_unpriv_service. It has no
+ * effect for the vsock transport.
+ *
+ * @param [in] shards Number of shards, 0 disables the use of shards
+ *
+ * @return 0 on success, 0 < on error
+ */
+int esdm_rpcc_set_shards(uint32_t shards);
+
+/**
+ * @brief Wake up the callers waiting for the ESDM server
+ *
+ * A caller waiting for the server to accept a request or to deliver a
+ * response consults its interrupt function (see esdm_rpcc_interrupt_func_t)
+ * when woken up. If it requests an interruption, the call returns -EINTR,
+ * otherwise the caller continues to wait. Without this call, the interrupt
+ * function is consulted when the rx/tx timeout passed. The call is intended
+ * to be invoked by another thread of the consuming application when it raises
+ * an interruption. It must not be invoked from a signal handler.
+ *
+ * All connections of the unprivileged and privileged connection pools as
+ * well as the thread-bound connections are woken up.
+ */
+void esdm_rpcc_interrupt(void);
+
 /******************************************************************************
  * Unprivileged ESDM interface
  ******************************************************************************/
@@ -193,11 +317,38 @@ int esdm_rpcc_status(char *buf, size_t buflen);
  */
 int esdm_rpcc_status_int(char *buf, size_t buflen, void *int_data);
 
+/**
+ * @brief RPC-version of esdm_status_bin
+ *
+ * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
+ * can be invoked by any user. Contrary to esdm_rpcc_status, the server returns
+ * a cached binary status which is cheap to obtain and does not need to be
+ * parsed. See esdm_status_bin.h for the versioning of the structure.
+ *
+ * @param [out] status Buffer to be filled with the status information
+ *
+ * @return: 0 on success, < 0 on error (-EINTR means connection was interrupted
+ *	    and the caller may try again, -EPROTO means the server returned an
+ *	    unsupported status version)
+ */
+int esdm_rpcc_status_bin(struct esdm_status_bin *status);
+
+/**
+ * @brief See esdm_rpcc_status_bin
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+int esdm_rpcc_status_bin_int(struct esdm_status_bin *status, void *int_data);
+
 /**
  * @brief RPC-version of esdm_avail_entropy
  *
  * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
  * can be invoked by any user.
+ * If the shared memory status segment of the local ESDM server is available,
+ * the call is answered from it without an RPC call.
  *
  * @param [out] entlvl overall available entropy in ESDM server
  *
@@ -220,6 +371,8 @@ int esdm_rpcc_get_ent_lvl_int(unsigned int *entlvl, void *int_data);
  *
  * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
  * can be invoked by any user.
+ * If the shared memory status segment of the local ESDM server is available,
+ * the call is answered from it without an RPC call.
  *
  * @param [out] min_seeded true, if ESDM server is minimally seeded
  *
@@ -242,6 +395,8 @@ int esdm_rpcc_is_min_seeded_int(bool *min_seeded, void *int_data);
  *
  * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
  * can be invoked by any user.
+ * If the shared memory status segment of the local ESDM server is available,
+ * the call is answered from it without an RPC call.
  *
  * @param [out] fully_seeded true, if ESDM server is fully seeded
  *
@@ -259,6 +414,41 @@ int esdm_rpcc_is_fully_seeded(bool *fully_seeded);
  */
 int esdm_rpcc_is_fully_seeded_int(bool *fully_seeded, void *int_data);
 
+/* Seed states of esdm_rpcc_wait_seed_state */
+#define ESDM_RPCC_SEED_MIN_SEEDED (1U << 0)
+#define ESDM_RPCC_SEED_FULLY_SEEDED (1U << 1)
+#define ESDM_RPCC_SEED_ALL_NODES_SEEDED (1U << 2)
+#define ESDM_RPCC_SEED_OPERATIONAL (1U << 3)
+
+/**
+ * @brief Wait until the ESDM reached seed states
+ *
+ * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
+ * can be invoked by any user. It replaces polling loops around
+ * esdm_rpcc_is_min_seeded and esdm_rpcc_is_fully_seeded: the server answers
+ * the request when the states are reached without occupying a thread while
+ * waiting. If the status segment of the local ESDM server is available, the
+ * caller sleeps on it without any RPC call.
+ *
+ * @param [in] states ESDM_RPCC_SEED_* flags which must all be reached
+ * @param [in] ts Maximum time to wait, NULL to wait forever
+ *
+ * @return: 0 when the states are reached, -ETIMEDOUT if the timeout expired,
+ *	    < 0 on error (-EINTR means connection was interrupted and the caller
+ *	    may try again)
+ */
+int esdm_rpcc_wait_seed_state(uint32_t states, const struct timespec *ts);
+
+/**
+ * @brief See esdm_rpcc_wait_seed_state
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+int esdm_rpcc_wait_seed_state_int(uint32_t states, const struct timespec *ts,
+				  void *int_data);
+
 /**
  * @brief RPC-version of esdm_get_random_bytes_full
  *
@@ -314,6 +504,91 @@ ssize_t esdm_rpcc_get_random_bytes_full_timeout_int(uint8_t *buf, size_t buflen,
 						    struct timespec *ts,
 						    void *int_data);
 
+/**
+ * @brief Obtain the generation of the DRNG state of the ESDM server
+ *
+ * The ESDM server increments the generation in its shared memory status
+ * segment when client-side DRNGs must obtain a new seed, e.g. after a forced
+ * reseed or a suspend/resume cycle. A client-side DRNG compares the
+ * generation it was seeded with to the returned value before generating
+ * random numbers. The call does not perform an RPC call.
+ *
+ * @return: generation counter, 0 if the status segment is not available
+ */
+uint64_t esdm_rpcc_rng_generation(void);
+
+/**
+ * @brief Obtain the seed state of the ESDM server without an RPC call
+ *
+ * The seed state is read from the shared memory status segment of the local
+ * ESDM server. Callers use it to avoid requests which are known to block.
+ *
+ * @param [out] min_seeded true, if ESDM server is minimally seeded
+ * @param [out] fully_seeded true, if ESDM server is fully seeded
+ *
+ * @return: 0 on success, < 0 if the seed state is not available
+ */
+int esdm_rpcc_seed_state_cached(bool *min_seeded, bool *fully_seeded);
+
+struct esdm_rpcc_drng_lease;
+
+/**
+ * @brief Lease a seed from the ESDM server for a local DRNG
+ *
+ * This call uses the unprivileged RPC endpoint of the ESDM server. Depending
+ * on the configuration of the ESDM server, only privileged callers may obtain
+ * a lease.
+ *
+ * The function instantiates a ChaCha20 DRNG in the address space of the caller
+ * which is seeded from the fully seeded DRNG of the ESDM server. The lease is
+ * bounded by a number of requests, a number of generated bytes and a time
+ * provided by the server. Once a bound is reached or the caller forked, a new
+ * seed is obtained automatically. Random numbers are then generated with
+ * esdm_rpcc_lease_get_random_bytes without any RPC call.
+ *
+ * This function blocks until the ESDM is fully seeded.
+ *
+ * A lease must not be used by multiple threads concurrently.
+ *
+ * @param [out] lease Lease allocated by the function
+ *
+ * @return: 0 on success, < 0 on error (-EPERM means the caller is not
+ *	    permitted to lease a seed, -EOPNOTSUPP means the ESDM server does
+ *	    not support the lease of seeds)
+ */
+int esdm_rpcc_lease_drng(struct esdm_rpcc_drng_lease **lease);
+
+/**
+ * @brief See esdm_rpcc_lease_drng
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service - it is also
+ * used for the automatic renewal of the lease.
+ */
+int esdm_rpcc_lease_drng_int(struct esdm_rpcc_drng_lease **lease,
+			     void *int_data);
+
+/**
+ * @brief Generate random numbers with the local DRNG of a lease
+ *
+ * @param [in] lease Lease obtained with esdm_rpcc_lease_drng
+ * @param [out] buf Buffer to be filled with random bits.
+ * @param [in] buflen Size of the buffer to be filled.
+ *
+ * @return: read data length on success, < 0 on error (the lease could not be
+ *	    renewed)
+ */
+ssize_t esdm_rpcc_lease_get_random_bytes(struct esdm_rpcc_drng_lease *lease,
+					 uint8_t *buf, size_t buflen);
+
+/**
+ * @brief Release a lease and zeroize the local DRNG
+ *
+ * @param [in] lease Lease obtained with esdm_rpcc_lease_drng
+ */
+void esdm_rpcc_lease_drng_free(struct esdm_rpcc_drng_lease *lease);
+
 /**
  * @brief RPC-version of esdm_get_random_bytes_min
  *
@@ -370,6 +645,53 @@ ssize_t esdm_rpcc_get_random_bytes_pr(uint8_t *buf, size_t buflen);
 ssize_t esdm_rpcc_get_random_bytes_pr_int(uint8_t *buf, size_t buflen,
 					  void *int_data);
 
+enum esdm_rpcc_rnd_flags {
+	ESDM_RPCC_RND_NORMAL = 0, /**< see esdm_rpcc_get_random_bytes */
+	ESDM_RPCC_RND_FULL = 1, /**< see esdm_rpcc_get_random_bytes_full */
+	ESDM_RPCC_RND_MIN = 2, /**< see esdm_rpcc_get_random_bytes_min */
+	ESDM_RPCC_RND_PR = 3, /**< see esdm_rpcc_get_random_bytes_pr */
+};
+
+struct esdm_rpcc_rnd_iovec {
+	void *iov_base; /**< Buffer to be filled with random bits */
+	size_t iov_len; /**< Size of the buffer to be filled */
+	enum esdm_rpcc_rnd_flags flags; /**< Type of random bits */
+};
+
+/**
+ * @brief RPC-version of esdm_get_random_bytes_vec
+ *
+ * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
+ * can be invoked by any user.
+ *
+ * The function fills a batch of buffers where each buffer is filled as if
+ * the RPC function referenced by its flags was invoked. Entries are
+ * combined into as few RPC calls as possible which implies that many small
+ * requests are served with one round trip to the ESDM server.
+ *
+ * This function blocks until the seeding level required by the most
+ * demanding entry is reached.
+ *
+ * @param [in] iov Array of buffers to be filled with random bits.
+ * @param [in] iovcnt Number of entries in iov.
+ *
+ * @return: read data length of all entries on success, < 0 on error (-EINTR
+ *	    means connection was interrupted and the caller may try again)
+ */
+ssize_t esdm_rpcc_get_random_bytes_vec(const struct esdm_rpcc_rnd_iovec *iov,
+				       size_t iovcnt);
+
+/**
+ * @brief See esdm_rpcc_get_random_bytes_vec
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+ssize_t
+esdm_rpcc_get_random_bytes_vec_int(const struct esdm_rpcc_rnd_iovec *iov,
+				   size_t iovcnt, void *int_data);
+
 /**
  * @brief RPC-version of esdm_get_random_bytes
  *
@@ -397,10 +719,163 @@ ssize_t esdm_rpcc_get_random_bytes(uint8_t *buf, size_t buflen);
 ssize_t esdm_rpcc_get_random_bytes_int(uint8_t *buf, size_t buflen,
 				       void *int_data);
 
+struct esdm_rpcc_random_stream;
+
+/**
+ * @brief Open a stream of random bytes from the ESDM server
+ *
+ * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
+ * can be invoked by any user.
+ *
+ * The server pushes the random bytes generated with esdm_get_random_bytes in
+ * frames over a dedicated connection without waiting for a request per frame.
+ * The stream is flow controlled by the consumption of the caller: the caller
+ * must read the stream without pausing for longer than the send timeout of
+ * the server, otherwise the server terminates the stream.
+ *
+ * A stream must not be used by multiple threads concurrently.
+ *
+ * @param [out] stream Stream allocated by the function
+ * @param [in] len Number of random bytes to stream - 0 streams random bytes
+ *		   until the stream is closed
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int esdm_rpcc_random_stream_open(struct esdm_rpcc_random_stream **stream,
+				 uint64_t len);
+
+/**
+ * @brief See esdm_rpcc_random_stream_open
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+int esdm_rpcc_random_stream_open_int(struct esdm_rpcc_random_stream **stream,
+				     uint64_t len, void *int_data);
+
+/**
+ * @brief Read random bytes from a stream
+ *
+ * @param [in] stream Stream opened with esdm_rpcc_random_stream_open
+ * @param [out] buf Buffer to be filled with random bits.
+ * @param [in] buflen Size of the buffer to be filled.
+ *
+ * @return: read data length on success, 0 at the end of the stream, < 0 on
+ *	    error
+ */
+ssize_t esdm_rpcc_random_stream_read(struct esdm_rpcc_random_stream *stream,
+				     uint8_t *buf, size_t buflen);
+
+/**
+ * @brief Close a stream and release its resources
+ *
+ * @param [in] stream Stream opened with esdm_rpcc_random_stream_open
+ */
+void esdm_rpcc_random_stream_close(struct esdm_rpcc_random_stream *stream);
+
+struct esdm_rpcc_async;
+
+/**
+ * @brief Callback invoked for a completed asynchronous request
+ *
+ * @param [in] ret read data length on success, < 0 on error
+ * @param [in] buf Buffer provided with the request
+ * @param [in] cb_data Data provided with the request
+ */
+typedef void (*esdm_rpcc_async_cb_t)(ssize_t ret, uint8_t *buf, void *cb_data);
+
+/**
+ * @brief Allocate a context for asynchronous requests
+ *
+ * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
+ * can be invoked by any user.
+ *
+ * The context maintains a dedicated connection to the ESDM server which is
+ * never blocking. It allows an event loop to submit requests and to process
+ * the responses once the file descriptor obtained with esdm_rpcc_async_fd is
+ * readable. The interrupt function registered with
+ * esdm_rpcc_init_unpriv_service is not used.
+ *
+ * A context must not be used by multiple threads concurrently.
+ *
+ * @param [out] async Context allocated by the function
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int esdm_rpcc_async_alloc(struct esdm_rpcc_async **async);
+
+/**
+ * @brief Release a context for asynchronous requests
+ *
+ * Outstanding requests are discarded without invoking their callbacks.
+ *
+ * @param [in] async Context allocated with esdm_rpcc_async_alloc
+ */
+void esdm_rpcc_async_free(struct esdm_rpcc_async *async);
+
+/**
+ * @brief Obtain the file descriptor to be watched for readability
+ *
+ * The file descriptor remains the same for the lifetime of the context even
+ * when the connection to the server is re-established. It must not be read
+ * or closed by the caller.
+ *
+ * If the library is compiled with the client-io-uring option, the file
+ * descriptor refers to the private io_uring instance of the context. It can be
+ * watched with poll(2) like a socket or with an IORING_OP_POLL_ADD operation
+ * on the io_uring instance of the application.
+ *
+ * @param [in] async Context allocated with esdm_rpcc_async_alloc
+ *
+ * @return: file descriptor on success, < 0 on error
+ */
+int esdm_rpcc_async_fd(struct esdm_rpcc_async *async);
+
+/**
+ * @brief Asynchronous RPC-version of esdm_get_random_bytes
+ *
+ * The request is sent to the ESDM server without waiting for the response.
+ * The callback is invoked by esdm_rpcc_process once the response is received
+ * and buf is filled. The caller must keep buf available until then.
+ *
+ * @param [in] async Context allocated with esdm_rpcc_async_alloc
+ * @param [out] buf Buffer to be filled with random bits.
+ * @param [in] buflen Size of the buffer to be filled - at most
+ *		      ESDM_RPC_MAX_DATA bytes.
+ * @param [in] cb Callback invoked when the request is completed
+ * @param [in] cb_data Data handed to the callback
+ *
+ * @return: 0 on success, -EBUSY when the maximum number of outstanding requests
+ *	    is reached, -EAGAIN when the connection cannot accept a request
+ *	    right now, < 0 on other errors - the callback is only invoked for a
+ *	    successfully submitted request
+ */
+int esdm_rpcc_get_random_bytes_async(struct esdm_rpcc_async *async,
+				     uint8_t *buf, size_t buflen,
+				     esdm_rpcc_async_cb_t cb, void *cb_data);
+
+/**
+ * @brief Process the responses received for asynchronous requests
+ *
+ * The function never blocks. It should be called once the file descriptor
+ * obtained with esdm_rpcc_async_fd is readable. The callbacks of all completed
+ * requests are invoked from within this function.
+ *
+ * @param [in] async Context allocated with esdm_rpcc_async_alloc
+ *
+ * @return: number of completed requests on success, < 0 on error
+ */
+int esdm_rpcc_process(struct esdm_rpcc_async *async);
+
+/* Shared with esdm.h - both headers may be included by one user */
+#ifndef ESDM_GET_SEED_FLAGS_DEFINED
+#define ESDM_GET_SEED_FLAGS_DEFINED
 enum esdm_get_seed_flags {
 	ESDM_GET_SEED_NONBLOCK = 0x0001, /**< Do not block the call */
 	ESDM_GET_SEED_FULLY_SEEDED = 0x0002, /**< DRNG is fully seeded */
 };
+#endif
 
 /**
  * @brief RPC-version of esdm_get_seed
@@ -429,6 +904,40 @@ ssize_t esdm_rpcc_get_seed(uint8_t *buf, size_t buflen, unsigned int flags);
 ssize_t esdm_rpcc_get_seed_int(uint8_t *buf, size_t buflen, unsigned int flags,
 			       void *int_data);
 
+/**
+ * @brief RPC-version of esdm_get_seed_blocks
+ *
+ * This call uses the unprivileged RPC endpoint of the ESDM server. It therefore
+ * can be invoked by any user.
+ *
+ * The buffer is filled with @param num independent seed blocks, each as
+ * returned by esdm_rpcc_get_seed for a buffer of @param blocklen bytes. The
+ * server collects the blocks in one request as far as they fit into one
+ * response. See esdm_get_seed_blocks for details.
+ *
+ * @param [out] buf Buffer of @param num * @param blocklen bytes
+ * @param [in] blocklen Size of one block, a multiple of 8 bytes
+ * @param [in] num Number of blocks to fill
+ * @param [in] flags Flags information, with ESDM_GET_SEED_NONBLOCK only the
+ *		     blocks available with one request are returned
+ *
+ * @return: number of filled blocks on success, < 0 on error (-EINTR means
+ *	    connection was interrupted and the caller may try again)
+ */
+ssize_t esdm_rpcc_get_seed_blocks(uint8_t *buf, size_t blocklen, size_t num,
+				  unsigned int flags);
+
+/**
+ * @brief See esdm_rpcc_get_seed_blocks
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+ssize_t esdm_rpcc_get_seed_blocks_int(uint8_t *buf, size_t blocklen,
+				      size_t num, unsigned int flags,
+				      void *int_data);
+
 /**
  * @brief RPC-version of writing data into ESDM auxiliary pool
  *
@@ -525,6 +1034,57 @@ int esdm_rpcc_rnd_add_entropy_int(const uint8_t *entropy_buf,
 				  size_t entropy_buf_len, uint32_t entropy_cnt,
 				  void *int_data);
 
+/**
+ * @brief Inject entropy via the shared memory entropy ring
+ *
+ * This call uses the privileged RPC endpoint of the ESDM server to set up a
+ * shared memory ring with the first invocation. The data is copied together
+ * with the entropy value into the ring without any RPC call or system call.
+ * The ESDM server drains the ring in batches into the auxiliary pool and
+ * erases the consumed data from the ring. It is intended for feeders
+ * delivering data at a high rate, like a hardware TRNG daemon.
+ *
+ * Contrary to esdm_rpcc_rnd_add_entropy, the entropy is not yet credited
+ * when the call returns. The server drains the ring at the latest after
+ * 100 ms, esdm_rpcc_rnd_add_entropy_ring_flush requests the draining right
+ * away.
+ *
+ * If the server does not provide an entropy ring, the ring is full or the
+ * buffer is larger than a quarter of the ring, the call transparently uses
+ * esdm_rpcc_rnd_add_entropy.
+ *
+ * The ring is released with esdm_rpcc_fini_priv_service after the server
+ * inserted the remaining data.
+ *
+ * @param [in] entropy_buf Buffer with the data to be inserted
+ * @param [in] entropy_buf_len Size of the buffer
+ * @param [in] entropy_cnt Entropy of the data in bits
+ *
+ * @return: 0 on success, < 0 on error (-EINTR means connection was interrupted
+ *	    and the caller may try again)
+ */
+int esdm_rpcc_rnd_add_entropy_ring(const uint8_t *entropy_buf,
+				   size_t entropy_buf_len,
+				   uint32_t entropy_cnt);
+
+/**
+ * @brief See esdm_rpcc_rnd_add_entropy_ring
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+int esdm_rpcc_rnd_add_entropy_ring_int(const uint8_t *entropy_buf,
+				       size_t entropy_buf_len,
+				       uint32_t entropy_cnt, void *int_data);
+
+/**
+ * @brief Request the ESDM server to drain the entropy ring right away
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int esdm_rpcc_rnd_add_entropy_ring_flush(void);
+
 /**
  * @brief RNDCLEARPOOL / RNDZAPENTCNT IOCTL
  *
@@ -582,6 +1142,9 @@ int esdm_rpcc_rnd_reseed_crng_int(void *int_data);
  *
  * The call returns the poolsize of the ESDM that can be filled by callers
  *
+ * If the shared memory status segment of the local ESDM server is available,
+ * the call is answered from it without an RPC call.
+ *
  * See random(4) for documentation.
  *
  * @return: 0 on success, < 0 on error (-EINTR means connection was interrupted
@@ -684,11 +1247,127 @@ int esdm_rpcc_set_min_reseed_secs(unsigned int seconds);
  */
 int esdm_rpcc_set_min_reseed_secs_int(unsigned int seconds, void *int_data);
 
+/**
+ * @brief Obtain the latency statistics of the ESDM server
+ *
+ * The statistics list the p50, p99 and p999 latencies of the processing
+ * stages of RPC requests, of each RPC method and of the DRNG. This call uses
+ * the privileged RPC endpoint of the ESDM server and requires the server to
+ * be compiled with the latency-stats option.
+ *
+ * @param [out] buf Buffer to be filled with human-readable latency
+ *		    information. The string will be NULL-terminated.
+ * @param [in] buflen Size of the buffer provided by the caller.
+ *
+ * @return: 0 on success, -EOPNOTSUPP if the server does not record latencies,
+ *	    < 0 on other errors (-EINTR means connection was interrupted and
+ *	    the caller may try again)
+ */
+int esdm_rpcc_get_latency_stats(char *buf, size_t buflen);
+
+/**
+ * @brief See esdm_rpcc_get_latency_stats
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+int esdm_rpcc_get_latency_stats_int(char *buf, size_t buflen, void *int_data);
+
+/*
+ * Latency histogram of the client statistics: bucket 0 counts the calls
+ * completed within 1 microsecond (2^10 ns), bucket n the calls completed
+ * within 2^(10 + n) ns. The last bucket counts all slower calls.
+ */
+#define ESDM_RPCC_STATS_LAT_BUCKETS 24
+#define ESDM_RPCC_STATS_METHODS_MAX 64
+
+struct esdm_rpcc_stats_method {
+	/* Service and method name, e.g. "UnprivAccess.RpcGetRandomBytes" */
+	char name[64];
+	uint64_t calls;
+	/* Calls which failed in the client or on the transport */
+	uint64_t errors;
+	/* Calls which waited for the response, pipelined calls are excluded */
+	uint64_t latency_count;
+	uint64_t latency_sum_ns;
+	uint64_t latency_hist[ESDM_RPCC_STATS_LAT_BUCKETS];
+};
+
+struct esdm_rpcc_stats {
+	/* Connections established with esdm_connect_proto_service */
+	uint64_t connects;
+	/* Failed or rejected connection attempts */
+	uint64_t connect_failures;
+	/* Connections established with the fallback endpoint */
+	uint64_t failovers;
+	/* Requests resubmitted after a timeout (EAGAIN) */
+	uint64_t retries;
+	/* Fallbacks of the callers reported with esdm_rpcc_stats_fallback */
+	uint64_t fallbacks;
+	/* Number of entries in method, only methods with calls are listed */
+	uint32_t method_num;
+	struct esdm_rpcc_stats_method method[ESDM_RPCC_STATS_METHODS_MAX];
+};
+
+/**
+ * @brief Obtain the statistics of the client library for this process
+ *
+ * The statistics cover all connections of the process. They are updated
+ * without a lock, thus a snapshot taken while RPC calls are in flight is not
+ * necessarily consistent between the individual counters. This call requires
+ * the client library to be compiled with the client-stats option.
+ *
+ * @param [out] stats Statistics filled in by the call
+ *
+ * @return: 0 on success, -EOPNOTSUPP if the statistics are not recorded,
+ *	    < 0 on other errors
+ */
+int esdm_rpcc_get_stats(struct esdm_rpcc_stats *stats);
+
+/**
+ * @brief Account a fallback of the caller to another random number source
+ *
+ * A caller which obtains random numbers elsewhere because the ESDM server is
+ * unavailable reports this with this call so that the fallbacks show up in
+ * the statistics of esdm_rpcc_get_stats.
+ */
+void esdm_rpcc_stats_fallback(void);
+
+/**
+ * @brief Change a configuration setting of the ESDM server at runtime
+ *
+ * The setting takes effect without a restart of the server. Only the
+ * performance-related settings documented with esdm_config_set can be
+ * changed. This call uses the privileged RPC endpoint of the ESDM server.
+ *
+ * @param [in] name Name of the setting, e.g. "drng_max_reqsize"
+ * @param [in] value New value of the setting
+ *
+ * @return: 0 on success, -EINVAL for an unknown setting, < 0 on other errors
+ *	    (-EINTR means connection was interrupted and the caller may try
+ *	    again)
+ */
+int esdm_rpcc_set_config(const char *name, uint32_t value);
+
+/**
+ * @brief See esdm_rpcc_set_config
+ *
+ * The function allows specifying an interrupt callback data structure that
+ * is used when invoking the interrupt check function registered with
+ * esdm_rpcc_init_priv_service / esdm_rpcc_init_unpriv_service
+ */
+int esdm_rpcc_set_config_int(const char *name, uint32_t value, void *int_data);
+
 /**
  * @brief Invoke a function up to 5 times if EINTR was returned
  *
  * This macro is intended to be used with the RPC calls above to repeat a call
  * when the connection cannot be initially established.
+ *
+ * A call returning -EBUSY is not repeated: the server rejected the connection
+ * as it is overloaded and the client backs off from it for a while. The
+ * caller should use a fallback or try again later.
  */
 #define esdm_invoke(x)                                                         \
 	do {                                                                   \
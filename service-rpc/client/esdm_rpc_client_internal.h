@@ -23,6 +23,9 @@
 #include "esdm_rpc_client.h"
 
 #include "atomic.h"
+#include "bool.h"
+#include "config.h"
+#include "esdm_rpc_service.h"
 #include "mutex_w.h"
 #include "queue.h"
 
@@ -30,6 +33,24 @@
 extern "C" {
 #endif
 
+/* One outstanding request waiting for its response */
+struct esdm_rpcc_pipeline_entry {
+	const ProtobufCMessageDescriptor *desc;
+	ProtobufCClosure closure;
+	void *closure_data;
+	bool done;
+};
+
+/*
+ * Requests are sent with consecutive request IDs starting at first_id. The
+ * response with request ID first_id + n is delivered to entry[n].
+ */
+struct esdm_rpcc_pipeline {
+	struct esdm_rpcc_pipeline_entry entry[ESDM_CLIENT_PIPELINE_DEPTH];
+	uint32_t first_id;
+	uint32_t num;
+};
+
 enum {
 	esdm_rpcc_uninitialized,
 	esdm_rpcc_in_initialization,
@@ -37,9 +58,25 @@ enum {
 	esdm_rpcc_in_termination,
 };
 
+/* Server endpoints a connection can be established with */
+enum {
+	esdm_rpcc_endpoint_primary,
+	esdm_rpcc_endpoint_fallback,
+	esdm_rpcc_endpoint_num,
+};
+
+/* Maximum number of file descriptors received with one response */
+#define ESDM_RPCC_RECV_FDS_MAX 2
+
 struct esdm_rpc_client_connection {
 	ProtobufCService service;
 	char socketname[FILENAME_MAX];
+	/* vsock address of the server, Unix domain socket if port is 0 */
+	uint32_t vsock_cid, vsock_port;
+	/* Unix domain socket used if the primary endpoint fails, "" if none */
+	char fallback_socketname[FILENAME_MAX];
+	/* Endpoint the file descriptor is connected to */
+	unsigned int endpoint;
 	int fd;
 
 	/*
@@ -48,12 +85,484 @@ struct esdm_rpc_client_connection {
 	 */
 	esdm_rpcc_interrupt_func_t interrupt_func;
 	void *interrupt_data;
+	/* Event file descriptor waking up a wait on fd, -1 if unavailable */
+	int wake_fd;
+
+	/* Request ID of the last request sent on this connection */
+	uint32_t request_id;
+	/* Pipeline collecting the outstanding requests, NULL if unused */
+	struct esdm_rpcc_pipeline *pipeline;
+	/* Writes on a non-blocking socket are not retried */
+	bool nonblocking;
+
+	/*
+	 * Maximum response message size negotiated on the current connection
+	 * (0 if not negotiated).
+	 */
+	uint32_t max_msg_size;
+	bool negotiate_unsupported;
+	/* The server accepts the compact wire format on the connection */
+	bool fast_wire;
+	/* Compact requests carry the CPU of the caller */
+	bool cpu_hint;
+
+	/* Receive buffer for responses of up to rx_buf_size bytes */
+	uint8_t *rx_buf;
+	uint32_t rx_buf_size;
+
+#ifdef ESDM_RPC_PASS_FDS
+	/* File descriptors received with the response currently processed */
+	int recv_fds[ESDM_RPCC_RECV_FDS_MAX];
+	unsigned int num_recv_fds;
+#endif
+
+#ifdef ESDM_RPCC_IO_URING
+	/* Requests and responses are exchanged via the ring, NULL if unused */
+	struct esdm_rpcc_uring *uring;
+#endif
+
+	/* List of thread-bound connections */
+	struct esdm_rpc_client_connection *tls_prev, *tls_next;
 
 	mutex_w_t lock;
 	mutex_w_t ref_cnt;
 	atomic_t state;
 };
 
+/**
+ * @brief Allocate the receive buffer of a connection
+ *
+ * The buffer is only re-allocated if it is too small for the requested
+ * message size.
+ *
+ * @param [in] rpc_conn Connection handle
+ * @param [in] max_msg_size Maximum message size to be received
+ *
+ * @return: 0 on success, < 0 on error
+ */
+int esdm_rpcc_rx_buf_alloc(esdm_rpc_client_connection_t *rpc_conn,
+			   uint32_t max_msg_size);
+
+/**
+ * @brief Start collecting requests in a pipeline
+ *
+ * All RPC calls invoked on the connection after this call only send the
+ * request without waiting for the response. At most ESDM_CLIENT_PIPELINE_DEPTH
+ * requests can be outstanding. The closure of a request is invoked when
+ * calling esdm_rpcc_pipeline_complete.
+ *
+ * The caller must hold the connection via esdm_rpcc_get_*_service.
+ *
+ * @param [in] rpc_conn Connection handle
+ * @param [in] pipeline Pipeline context maintained by the caller
+ */
+void esdm_rpcc_pipeline_start(esdm_rpc_client_connection_t *rpc_conn,
+			      struct esdm_rpcc_pipeline *pipeline);
+
+/**
+ * @brief Receive the responses for all outstanding requests of the pipeline
+ *
+ * Every closure of the pipelined requests is invoked exactly once, either
+ * with the response or with an error pointer. The connection returns to
+ * the synchronous operation mode.
+ *
+ * @param [in] rpc_conn Connection handle
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpcc_pipeline_complete(esdm_rpc_client_connection_t *rpc_conn);
+
+/**
+ * @brief Receive the next response of a streaming request
+ *
+ * A streaming request is sent as the only request of a pipeline. The server
+ * answers it with a sequence of responses. Each call receives one of them and
+ * invokes the closure of the request with it. The connection returns to the
+ * synchronous operation mode with the first call.
+ *
+ * @param [in] rpc_conn Connection handle
+ * @param [in] pipeline Pipeline holding the streaming request
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpcc_pipeline_stream(esdm_rpc_client_connection_t *rpc_conn,
+			      struct esdm_rpcc_pipeline *pipeline);
+
+/**
+ * @brief Receive one response for the outstanding requests of the pipeline
+ *
+ * This call is intended for a connection with a non-blocking socket which
+ * keeps the pipeline active: the closure of the request is invoked with the
+ * response if one is available. Completed requests are removed from the head
+ * of the pipeline which allows new requests to be added.
+ *
+ * @param [in] rpc_conn Connection handle
+ *
+ * @return 0 on success, -EAGAIN if no response is available, -ENODATA if no
+ *	   request is outstanding, < 0 on error
+ */
+int esdm_rpcc_pipeline_receive(esdm_rpc_client_connection_t *rpc_conn);
+
+/**
+ * @brief (Re-)establish the connection to the server
+ *
+ * @param [in] rpc_conn Connection handle
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpcc_connect(esdm_rpc_client_connection_t *rpc_conn);
+
+/**
+ * @brief Allocate a dedicated connection to the unprivileged interface
+ *
+ * The connection is not shared with other callers which allows it to be used
+ * for long-running operations like a stream. It uses the interrupt function
+ * registered with esdm_rpcc_init_unpriv_service.
+ *
+ * @param [out] rpc_conn Connection handle allocated by the function
+ * @param [in] int_data Interrupt callback data
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpcc_alloc_unpriv_conn(esdm_rpc_client_connection_t **rpc_conn,
+				void *int_data);
+
+/**
+ * @brief Release a connection allocated with esdm_rpcc_alloc_unpriv_conn
+ *
+ * @param [in] rpc_conn Connection handle
+ */
+void esdm_rpcc_free_unpriv_conn(esdm_rpc_client_connection_t *rpc_conn);
+
+/**
+ * @brief Negotiate a larger response message size for the connection
+ *
+ * Large requests for random bytes are served with fewer round trips once
+ * a larger message size is negotiated. The negotiation is performed at most
+ * once per connection. If the server does not support it, the default
+ * message size is used.
+ *
+ * The caller must hold a reference to the connection.
+ *
+ * @param [in] rpc_conn Connection handle
+ */
+void esdm_rpcc_negotiate(esdm_rpc_client_connection_t *rpc_conn);
+
+/**
+ * @brief Invoke a method using the compact wire format
+ *
+ * The compact wire format is only used after it was negotiated with
+ * esdm_rpcc_negotiate on the connection. If it cannot be used or the request
+ * fails, the caller must send the regular protobuf request instead.
+ *
+ * The caller must hold a reference to the connection.
+ *
+ * @param [in] rpc_conn Connection handle
+ * @param [in] method Method, see enum esdm_rpc_fast_method
+ * @param [out] buf Buffer receiving the random bytes of the response
+ * @param [in] buflen Number of requested random bytes
+ * @param [out] status Status of the response
+ *
+ * @return 0 on success, -EOPNOTSUPP if the regular request must be used
+ */
+int esdm_rpcc_fast_call(esdm_rpc_client_connection_t *rpc_conn,
+			uint32_t method, uint8_t *buf, size_t buflen,
+			ssize_t *status);
+
+/**
+ * @brief Is the unprivileged interface served by the local ESDM server?
+ *
+ * @return true if the Unix domain socket transport is used
+ */
+bool esdm_rpcc_local_transport(void);
+
+/**
+ * @brief Read the seed state from the status segment of the server
+ *
+ * @param [out] seed_state ESDM_SHM_SEED_* flags
+ * @param [out] ent_lvl Entropy level of all entropy sources
+ *
+ * @return 0 on success, < 0 if the caller must use the RPC call
+ */
+int esdm_rpcc_shm_seed_values(uint32_t *seed_state, uint32_t *ent_lvl);
+
+/**
+ * @brief Sleep on the status segment of the server until seed states are set
+ *
+ * @param [in] states ESDM_SHM_SEED_* flags which must all be set
+ * @param [in] abstime Absolute CLOCK_MONOTONIC timeout, NULL to wait forever
+ *
+ * @return 0 when the states are set, -ETIMEDOUT if the timeout expired,
+ *	   -EINTR if interrupted by a signal, -EOPNOTSUPP if the caller must
+ *	   use the RPC call
+ */
+int esdm_rpcc_shm_seed_wait(uint32_t states, const struct timespec *abstime);
+
+/**
+ * @brief Read the pool size from the status segment of the server
+ *
+ * @param [out] poolsize Pool size as reported by RpcGetPoolsize
+ *
+ * @return 0 on success, < 0 if the caller must use the RPC call
+ */
+int esdm_rpcc_shm_poolsize(uint32_t *poolsize);
+
+#ifdef ESDM_RPC_PASS_FDS
+
+/**
+ * @brief Take over a file descriptor received with the current response
+ *
+ * This call is only allowed in a response closure. File descriptors which
+ * were not taken over by the closure are closed after the closure returns.
+ *
+ * @param [in] rpc_conn Connection handle
+ * @param [in] idx Index of the file descriptor in the response
+ *
+ * @return file descriptor >= 0 on success, < 0 on error
+ */
+int esdm_rpcc_take_fd(esdm_rpc_client_connection_t *rpc_conn,
+		      unsigned int idx);
+
+#endif /* ESDM_RPC_PASS_FDS */
+
+#ifdef ESDM_RPC_RING
+
+/**
+ * @brief Obtain random data from the shared memory ring
+ *
+ * The ring is set up with the first call using the given connection. The
+ * request is either fully served from the ring or not at all.
+ *
+ * The caller must hold the connection via esdm_rpcc_get_unpriv_service.
+ *
+ * @param [in] rpc_conn Connection handle
+ * @param [out] buf Buffer to be filled with random data
+ * @param [in] buflen Size of the buffer
+ *
+ * @return number of bytes copied into the buffer (either 0 or buflen)
+ */
+size_t esdm_rpcc_ring_get(esdm_rpc_client_connection_t *rpc_conn,
+			  uint8_t *buf, size_t buflen);
+
+/**
+ * @brief Release the shared memory ring
+ */
+void esdm_rpcc_ring_fini(void);
+
+#else /* ESDM_RPC_RING */
+
+static inline size_t esdm_rpcc_ring_get(esdm_rpc_client_connection_t *rpc_conn,
+					uint8_t *buf, size_t buflen)
+{
+	(void)rpc_conn;
+	(void)buf;
+	(void)buflen;
+	return 0;
+}
+
+static inline void esdm_rpcc_ring_fini(void)
+{
+}
+
+#endif /* ESDM_RPC_RING */
+
+/**
+ * @brief Insert the pending data and release the shared memory entropy ring
+ */
+void esdm_rpcc_ent_ring_fini(void);
+
+#ifdef ESDM_RPCC_IO_URING
+
+struct esdm_rpcc_uring;
+
+/**
+ * @brief Allocate a private io_uring instance
+ *
+ * @param [out] ring Instance allocated by the function
+ *
+ * @return 0 on success, < 0 on error, e.g. when the kernel does not offer
+ *	   io_uring
+ */
+int esdm_rpcc_uring_alloc(struct esdm_rpcc_uring **ring);
+
+/**
+ * @brief Release an io_uring instance
+ *
+ * No operation must be in flight, see esdm_rpcc_uring_drain.
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ */
+void esdm_rpcc_uring_free(struct esdm_rpcc_uring *ring);
+
+/**
+ * @brief File descriptor of the ring which is readable with completions
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ *
+ * @return file descriptor
+ */
+int esdm_rpcc_uring_fd(struct esdm_rpcc_uring *ring);
+
+/**
+ * @brief Queue request data to be sent with the next submission
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ * @param [in] data Data to be sent
+ * @param [in] len Length of the data
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpcc_uring_queue(struct esdm_rpcc_uring *ring, const uint8_t *data,
+			  size_t len);
+
+/**
+ * @brief Submit the queued requests and re-arm the receive operation
+ *
+ * The system call is only performed if an operation is added, i.e. requests
+ * queued while the previous send is in flight are submitted together after
+ * its completion.
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ * @param [in] sockfd Socket connected to the server
+ *
+ * @return 0 on success, -EAGAIN if the kernel cannot accept the submission
+ *	   right now, < 0 on other errors
+ */
+int esdm_rpcc_uring_submit(struct esdm_rpcc_uring *ring, int sockfd);
+
+/**
+ * @brief Process the completions of the ring without a system call
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ *
+ * @return 0 on success, -EPIPE when the server closed the connection, < 0 on
+ *	   other errors
+ */
+int esdm_rpcc_uring_reap(struct esdm_rpcc_uring *ring);
+
+/**
+ * @brief Check for a completely received response
+ *
+ * A response is only handed to the read handler with esdm_rpcc_uring_read once
+ * it is received completely.
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ *
+ * @return 1 if a response is available, 0 if not, < 0 on error
+ */
+int esdm_rpcc_uring_frame(struct esdm_rpcc_uring *ring);
+
+/**
+ * @brief Read the data of the current response
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ * @param [out] buf Buffer to be filled
+ * @param [in] len Size of the buffer
+ *
+ * @return number of bytes read, -1 with errno set to EAGAIN if the current
+ *	   response is consumed
+ */
+ssize_t esdm_rpcc_uring_read(struct esdm_rpcc_uring *ring, uint8_t *buf,
+			     size_t len);
+
+/**
+ * @brief Discard the current response
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ */
+void esdm_rpcc_uring_skip(struct esdm_rpcc_uring *ring);
+
+/**
+ * @brief Wait for the in-flight operations and clear all buffered data
+ *
+ * The caller must shut down the socket first.
+ *
+ * @param [in] ring Instance allocated with esdm_rpcc_uring_alloc
+ */
+void esdm_rpcc_uring_drain(struct esdm_rpcc_uring *ring);
+
+#endif /* ESDM_RPCC_IO_URING */
+
+#ifdef ESDM_RPCC_STATS
+
+/**
+ * @brief Start time of an RPC call for esdm_rpcc_stats_call
+ *
+ * @return CLOCK_MONOTONIC time in nanoseconds
+ */
+uint64_t esdm_rpcc_stats_start(void);
+
+/**
+ * @brief Account one call of an RPC method
+ *
+ * @param [in] desc Descriptor of the service the method belongs to
+ * @param [in] method_index Index of the method in the service descriptor
+ * @param [in] start Start time of the call, 0 if the call was sent without
+ *		     waiting for the response
+ * @param [in] ret Result of the transport, < 0 on error
+ */
+void esdm_rpcc_stats_call(const ProtobufCServiceDescriptor *desc,
+			  unsigned int method_index, uint64_t start, int ret);
+
+/**
+ * @brief Account one call of a compact wire format method
+ *
+ * @param [in] method Method of the compact wire format
+ * @param [in] start Start time of the call
+ * @param [in] ret Result of the transport, < 0 on error
+ */
+void esdm_rpcc_stats_fast_call(uint32_t method, uint64_t start, int ret);
+
+/**
+ * @brief Account one connection attempt
+ *
+ * @param [in] endpoint Endpoint the connection was attempted with
+ * @param [in] ret 0 if the connection was established, < 0 otherwise
+ */
+void esdm_rpcc_stats_connect(unsigned int endpoint, int ret);
+
+/**
+ * @brief Account the resubmission of a timed out request
+ */
+void esdm_rpcc_stats_retry(void);
+
+#else /* ESDM_RPCC_STATS */
+
+static inline uint64_t esdm_rpcc_stats_start(void)
+{
+	return 0;
+}
+
+static inline void esdm_rpcc_stats_call(const ProtobufCServiceDescriptor *desc,
+					unsigned int method_index,
+					uint64_t start, int ret)
+{
+	(void)desc;
+	(void)method_index;
+	(void)start;
+	(void)ret;
+}
+
+static inline void esdm_rpcc_stats_fast_call(uint32_t method, uint64_t start,
+					     int ret)
+{
+	(void)method;
+	(void)start;
+	(void)ret;
+}
+
+static inline void esdm_rpcc_stats_connect(unsigned int endpoint, int ret)
+{
+	(void)endpoint;
+	(void)ret;
+}
+
+static inline void esdm_rpcc_stats_retry(void)
+{
+}
+
+#endif /* ESDM_RPCC_STATS */
+
 /* Sleep time for poll operations */
 static const struct timespec esdm_client_poll_ts = { .tv_sec = 1,
 						     .tv_nsec = 0 };
@@ -51,14 +51,32 @@ int esdm_rpcc_get_ent_lvl_int(unsigned int *entlvl, void *int_data)
 	GetEntLvlRequest msg = GET_ENT_LVL_REQUEST__INIT;
 	esdm_rpc_client_connection_t *rpc_conn = NULL;
 	struct esdm_get_ent_lvl_buf buffer;
+	uint32_t seed_state, ent_lvl;
+	ssize_t status;
 	int ret = 0;
 
+	/* Answer from the status segment of the server if possible */
+	if (!esdm_rpcc_shm_seed_values(&seed_state, &ent_lvl)) {
+		if (entlvl)
+			*entlvl = ent_lvl;
+		return 0;
+	}
+
 	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
 
 	buffer.ret = -ETIMEDOUT;
 
-	unpriv_access__rpc_get_ent_lvl(&rpc_conn->service, &msg,
-				       esdm_rpcc_get_ent_lvl_cb, &buffer);
+	/* Use the compact wire format if the server offers it */
+	esdm_rpcc_negotiate(rpc_conn);
+	if (!esdm_rpcc_fast_call(rpc_conn, esdm_rpc_fast_get_ent_lvl, NULL, 0,
+				 &status)) {
+		buffer.ret = (status < 0) ? (int)status : 0;
+		buffer.entlvl = (status < 0) ? 0 : (unsigned int)status;
+	} else {
+		unpriv_access__rpc_get_ent_lvl(&rpc_conn->service, &msg,
+					       esdm_rpcc_get_ent_lvl_cb,
+					       &buffer);
+	}
 
 	ret = buffer.ret;
 	if (entlvl)
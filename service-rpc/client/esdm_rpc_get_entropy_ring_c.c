@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esdm_rpc_client.h"
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "mutex_w.h"
+#include "ptr_err.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+#ifdef ESDM_RPC_ENT_RING
+
+struct esdm_rpcc_ent_ring {
+	struct esdm_rpc_ring *ring;
+	size_t maplen;
+	uint32_t size;
+	int ctrl_fd;
+	/* Client-side copy of the head counter */
+	uint64_t head;
+	/* Tail value at which the last drain request was sent */
+	uint64_t drain_tail;
+	bool drain_sent;
+	/* The server does not provide a ring */
+	bool unavailable;
+};
+
+static struct esdm_rpcc_ent_ring esdm_rpcc_ent_ring = { .ctrl_fd = -1 };
+static DEFINE_MUTEX_W_UNLOCKED(esdm_rpcc_ent_ring_lock);
+static pthread_once_t esdm_rpcc_ent_ring_once = PTHREAD_ONCE_INIT;
+
+struct esdm_get_entropy_ring_buf {
+	esdm_rpc_client_connection_t *rpc_conn;
+	int ret;
+	uint32_t size;
+	int mem_fd;
+	int ctrl_fd;
+};
+
+static void
+esdm_rpcc_get_entropy_ring_cb(const GetEntropyRingResponse *response,
+			      void *closure_data)
+{
+	struct esdm_get_entropy_ring_buf *buffer =
+		(struct esdm_get_entropy_ring_buf *)closure_data;
+
+	esdm_rpcc_error_check(response, buffer);
+
+	buffer->ret = response->ret;
+	if (response->ret < 0)
+		return;
+
+	buffer->size = response->size;
+	buffer->mem_fd = esdm_rpcc_take_fd(buffer->rpc_conn, 0);
+	buffer->ctrl_fd = esdm_rpcc_take_fd(buffer->rpc_conn, 1);
+}
+
+/*
+ * Closing the control socket lets the server insert the data still present
+ * in the ring before it releases the ring.
+ *
+ * Caller must hold esdm_rpcc_ent_ring_lock.
+ */
+static void esdm_rpcc_ent_ring_release(struct esdm_rpcc_ent_ring *r)
+{
+	if (r->ring)
+		munmap(r->ring, r->maplen);
+	if (r->ctrl_fd >= 0)
+		close(r->ctrl_fd);
+
+	r->ring = NULL;
+	r->maplen = 0;
+	r->size = 0;
+	r->ctrl_fd = -1;
+	r->head = 0;
+	r->drain_tail = 0;
+	r->drain_sent = false;
+}
+
+/*
+ * The mapping is not inherited by a child due to MADV_DONTFORK. The child
+ * must not share the control socket with its parent either.
+ */
+static void esdm_rpcc_ent_ring_atfork_child(void)
+{
+	mutex_w_init(&esdm_rpcc_ent_ring_lock, 0, 0);
+	esdm_rpcc_ent_ring.ring = NULL;
+	esdm_rpcc_ent_ring_release(&esdm_rpcc_ent_ring);
+	esdm_rpcc_ent_ring.unavailable = false;
+}
+
+static void esdm_rpcc_ent_ring_register_atfork(void)
+{
+	pthread_atfork(NULL, NULL, esdm_rpcc_ent_ring_atfork_child);
+}
+
+/* Caller must hold esdm_rpcc_ent_ring_lock */
+static int esdm_rpcc_ent_ring_setup(struct esdm_rpcc_ent_ring *r,
+				    void *int_data)
+{
+	GetEntropyRingRequest msg = GET_ENTROPY_RING_REQUEST__INIT;
+	esdm_rpc_client_connection_t *rpc_conn = NULL;
+	struct esdm_get_entropy_ring_buf buffer = { .ret = -ETIMEDOUT,
+						    .mem_fd = -1,
+						    .ctrl_fd = -1 };
+	struct esdm_rpc_ring *ring;
+	struct stat sb;
+	size_t maplen;
+	int ret = 0;
+
+	pthread_once(&esdm_rpcc_ent_ring_once,
+		     esdm_rpcc_ent_ring_register_atfork);
+
+	CKINT(esdm_rpcc_get_priv_service(&rpc_conn, int_data));
+
+	buffer.rpc_conn = rpc_conn;
+	msg.size = ESDM_RPC_ENT_RING_SIZE;
+	priv_access__rpc_get_entropy_ring(&rpc_conn->service, &msg,
+					  esdm_rpcc_get_entropy_ring_cb,
+					  &buffer);
+	if (buffer.ret < 0) {
+		ret = buffer.ret;
+		goto out;
+	}
+
+	if (buffer.mem_fd < 0 || buffer.ctrl_fd < 0 ||
+	    buffer.size < ESDM_RPC_ENT_RING_MIN_SIZE ||
+	    (buffer.size & (buffer.size - 1))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	if (fstat(buffer.mem_fd, &sb) < 0) {
+		ret = -errno;
+		goto out;
+	}
+	maplen = sizeof(struct esdm_rpc_ring) + buffer.size;
+	if (sb.st_size < 0 || (size_t)sb.st_size < maplen) {
+		ret = -EFAULT;
+		goto out;
+	}
+	maplen = (size_t)sb.st_size;
+
+	ring = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    buffer.mem_fd, 0);
+	if (ring == MAP_FAILED) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (ring->magic != ESDM_RPC_ENT_RING_MAGIC ||
+	    ring->size != buffer.size) {
+		munmap(ring, maplen);
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* Entropy must not be duplicated into a child */
+	madvise(ring, maplen, MADV_DONTFORK);
+
+	r->ring = ring;
+	r->maplen = maplen;
+	r->size = buffer.size;
+	r->ctrl_fd = buffer.ctrl_fd;
+	r->head = 0;
+	r->drain_tail = 0;
+	r->drain_sent = false;
+	buffer.ctrl_fd = -1;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Entropy ring with %u bytes available\n", r->size);
+
+out:
+	esdm_rpcc_put_priv_service(rpc_conn);
+	/* The mapping keeps the memory file alive */
+	if (buffer.mem_fd >= 0)
+		close(buffer.mem_fd);
+	if (buffer.ctrl_fd >= 0)
+		close(buffer.ctrl_fd);
+	return ret;
+}
+
+/* Caller must hold esdm_rpcc_ent_ring_lock */
+static void esdm_rpcc_ent_ring_drain(struct esdm_rpcc_ent_ring *r,
+				     uint64_t tail)
+{
+	uint8_t req = 0;
+
+	/* Only one drain request until the server consumed data */
+	if (r->drain_sent && r->drain_tail == tail)
+		return;
+
+	if (send(r->ctrl_fd, &req, sizeof(req), MSG_DONTWAIT | MSG_NOSIGNAL) <
+	    0) {
+		/* Server is gone, a new ring is set up with the next call */
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			esdm_rpcc_ent_ring_release(r);
+		return;
+	}
+
+	r->drain_tail = tail;
+	r->drain_sent = true;
+}
+
+/*
+ * Write one record into the ring.
+ *
+ * Caller must hold esdm_rpcc_ent_ring_lock.
+ *
+ * Return: true if the record was written, false if the ring has no space
+ */
+static bool esdm_rpcc_ent_ring_write(struct esdm_rpcc_ent_ring *r,
+				     const uint8_t *buf, uint32_t len,
+				     uint32_t entropy_bits)
+{
+	struct esdm_rpc_ring *ring = r->ring;
+	struct esdm_rpc_ent_record rec = { .len = len,
+					   .entropy_bits = entropy_bits };
+	uint64_t tail = (uint64_t)atomic_read_64(&ring->tail);
+	uint64_t reclen, pad = 0;
+	uint32_t offset = (uint32_t)(r->head & (r->size - 1));
+
+	if (tail > r->head || r->head - tail > r->size) {
+		esdm_rpcc_ent_ring_release(r);
+		return false;
+	}
+
+	reclen = (sizeof(rec) + len + ESDM_RPC_ENT_RING_ALIGN - 1) &
+		 ~(uint64_t)(ESDM_RPC_ENT_RING_ALIGN - 1);
+
+	/* A record never wraps, the rest of the data area is skipped */
+	if (reclen > r->size - offset)
+		pad = r->size - offset;
+
+	if (pad + reclen > r->size - (r->head - tail)) {
+		/* Full, let the server drain the ring to free space */
+		esdm_rpcc_ent_ring_drain(r, tail);
+		return false;
+	}
+
+	if (pad) {
+		struct esdm_rpc_ent_record padrec = {
+			.len = 0, .entropy_bits = ESDM_RPC_ENT_RING_PAD
+		};
+
+		memcpy(ring->data + offset, &padrec, sizeof(padrec));
+		r->head += pad;
+		offset = 0;
+	}
+
+	memcpy(ring->data + offset, &rec, sizeof(rec));
+	memcpy(ring->data + offset + sizeof(rec), buf, len);
+	r->head += reclen;
+
+	/* Publish the record after it is written */
+	atomic_set_64(&ring->head, (long long)r->head);
+
+	/* Request an early drain to keep space for the following records */
+	if (r->head - tail >= r->size / 2)
+		esdm_rpcc_ent_ring_drain(r, tail);
+
+	return true;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_rnd_add_entropy_ring_int(const uint8_t *entropy_buf,
+				       size_t entropy_buf_len,
+				       uint32_t entropy_cnt, void *int_data)
+{
+	struct esdm_rpcc_ent_ring *r = &esdm_rpcc_ent_ring;
+	bool written = false;
+
+	if (!entropy_buf)
+		return -EINVAL;
+
+	/* Records must leave space for others, large buffers use the RPC */
+	if (!entropy_buf_len || entropy_buf_len > ESDM_RPC_ENT_RING_SIZE / 4)
+		goto rpc;
+
+	mutex_w_lock(&esdm_rpcc_ent_ring_lock);
+
+	if (!r->ring && !r->unavailable &&
+	    esdm_rpcc_ent_ring_setup(r, int_data)) {
+		/* Do not try again with a server without rings */
+		r->unavailable = true;
+	}
+
+	if (r->ring)
+		written = esdm_rpcc_ent_ring_write(r, entropy_buf,
+						   (uint32_t)entropy_buf_len,
+						   entropy_cnt);
+
+	mutex_w_unlock(&esdm_rpcc_ent_ring_lock);
+
+	if (written)
+		return 0;
+
+rpc:
+	return esdm_rpcc_rnd_add_entropy_int(entropy_buf, entropy_buf_len,
+					     entropy_cnt, int_data);
+}
+
+DSO_PUBLIC
+int esdm_rpcc_rnd_add_entropy_ring_flush(void)
+{
+	struct esdm_rpcc_ent_ring *r = &esdm_rpcc_ent_ring;
+
+	mutex_w_lock(&esdm_rpcc_ent_ring_lock);
+	if (r->ring) {
+		uint64_t tail = (uint64_t)atomic_read_64(&r->ring->tail);
+
+		if (tail != r->head) {
+			/* Force the request even if one is pending */
+			r->drain_sent = false;
+			esdm_rpcc_ent_ring_drain(r, tail);
+		}
+	}
+	mutex_w_unlock(&esdm_rpcc_ent_ring_lock);
+
+	return 0;
+}
+
+void esdm_rpcc_ent_ring_fini(void)
+{
+	mutex_w_lock(&esdm_rpcc_ent_ring_lock);
+	esdm_rpcc_ent_ring_release(&esdm_rpcc_ent_ring);
+	esdm_rpcc_ent_ring.unavailable = false;
+	mutex_w_unlock(&esdm_rpcc_ent_ring_lock);
+}
+
+#else /* ESDM_RPC_ENT_RING */
+
+DSO_PUBLIC
+int esdm_rpcc_rnd_add_entropy_ring_int(const uint8_t *entropy_buf,
+				       size_t entropy_buf_len,
+				       uint32_t entropy_cnt, void *int_data)
+{
+	return esdm_rpcc_rnd_add_entropy_int(entropy_buf, entropy_buf_len,
+					     entropy_cnt, int_data);
+}
+
+DSO_PUBLIC
+int esdm_rpcc_rnd_add_entropy_ring_flush(void)
+{
+	return 0;
+}
+
+void esdm_rpcc_ent_ring_fini(void)
+{
+}
+
+#endif /* ESDM_RPC_ENT_RING */
+
+DSO_PUBLIC
+int esdm_rpcc_rnd_add_entropy_ring(const uint8_t *entropy_buf,
+				   size_t entropy_buf_len, uint32_t entropy_cnt)
+{
+	return esdm_rpcc_rnd_add_entropy_ring_int(entropy_buf, entropy_buf_len,
+						  entropy_cnt, NULL);
+}
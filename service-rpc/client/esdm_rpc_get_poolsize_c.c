@@ -51,8 +51,16 @@ int esdm_rpcc_get_poolsize_int(unsigned int *poolsize, void *int_data)
 	GetPoolsizeRequest msg = GET_POOLSIZE_REQUEST__INIT;
 	esdm_rpc_client_connection_t *rpc_conn = NULL;
 	struct esdm_poolsize_buf buffer;
+	uint32_t shm_poolsize;
 	int ret = 0;
 
+	/* Answer from the status segment of the server if possible */
+	if (!esdm_rpcc_shm_poolsize(&shm_poolsize)) {
+		if (poolsize)
+			*poolsize = shm_poolsize;
+		return 0;
+	}
+
 	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
 
 	buffer.ret = -ETIMEDOUT;
@@ -57,6 +57,66 @@ esdm_rpcc_get_random_bytes_cb(const GetRandomBytesResponse *response,
 	/* Zeroization of response is handled in esdm_rpc_client_read_handler */
 }
 
+#if (ESDM_CLIENT_PIPELINE_DEPTH > 1)
+/*
+ * Obtain as many full chunks of maxbuflen as possible with up to
+ * ESDM_CLIENT_PIPELINE_DEPTH outstanding requests on the connection.
+ *
+ * Returns the number of bytes filled or an error. In case of an error, the
+ * caller may continue with the synchronous operation.
+ */
+static ssize_t
+esdm_rpcc_get_random_bytes_pipeline(esdm_rpc_client_connection_t *rpc_conn,
+				    uint8_t *buf, size_t buflen,
+				    size_t maxbuflen)
+{
+	GetRandomBytesRequest msg = GET_RANDOM_BYTES_REQUEST__INIT;
+	struct esdm_get_random_bytes_buf buffer[ESDM_CLIENT_PIPELINE_DEPTH];
+	struct esdm_rpcc_pipeline pipeline;
+	size_t filled = 0;
+	uint32_t i, num;
+	ssize_t ret = 0;
+
+	msg.len = maxbuflen;
+
+	while (buflen - filled >= maxbuflen) {
+		num = (uint32_t)min_size(ESDM_CLIENT_PIPELINE_DEPTH,
+					 (buflen - filled) / maxbuflen);
+
+		esdm_rpcc_pipeline_start(rpc_conn, &pipeline);
+		for (i = 0; i < num; i++) {
+			buffer[i].ret = -ETIMEDOUT;
+			buffer[i].buf = buf + filled + i * maxbuflen;
+			buffer[i].buflen = maxbuflen;
+
+			unpriv_access__rpc_get_random_bytes(
+				&rpc_conn->service, &msg,
+				esdm_rpcc_get_random_bytes_cb, &buffer[i]);
+		}
+		CKINT(esdm_rpcc_pipeline_complete(rpc_conn));
+
+		/* Only accept complete chunks to not leave holes */
+		for (i = 0; i < num; i++) {
+			if (buffer[i].ret < 0) {
+				ret = buffer[i].ret;
+				goto out;
+			}
+			if ((size_t)buffer[i].ret != maxbuflen) {
+				ret = -EFAULT;
+				goto out;
+			}
+		}
+
+		esdm_test_shm_status_add_rpc_client_written(num * maxbuflen);
+		filled += num * maxbuflen;
+	}
+
+out:
+	/* Chunks delivered before the error are still usable */
+	return filled ? (ssize_t)filled : ret;
+}
+#endif
+
 DSO_PUBLIC
 ssize_t esdm_rpcc_get_random_bytes_int(uint8_t *buf, size_t buflen,
 				       void *int_data)
@@ -69,6 +129,20 @@ ssize_t esdm_rpcc_get_random_bytes_int(uint8_t *buf, size_t buflen,
 
 	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
 
+	/*
+	 * Small requests are served from the shared memory ring without an
+	 * RPC call. The data is not accounted for in the test pertubation
+	 * support as it bypasses the RPC data path.
+	 */
+	if (esdm_rpcc_ring_get(rpc_conn, buf, buflen))
+		goto out;
+
+	/*
+	 * Large requests are served with fewer round trips, all requests
+	 * without protobuf-c if the server offers the compact wire format.
+	 */
+	esdm_rpcc_negotiate(rpc_conn);
+
 	while (buflen) {
 		buffer.ret = -ETIMEDOUT;
 		buffer.buf = buf;
@@ -76,12 +150,32 @@ ssize_t esdm_rpcc_get_random_bytes_int(uint8_t *buf, size_t buflen,
 
 		msg.len = min_size(maxbuflen, buflen);
 
-		unpriv_access__rpc_get_random_bytes(
-			&rpc_conn->service, &msg, esdm_rpcc_get_random_bytes_cb,
-			&buffer);
+		if (esdm_rpcc_fast_call(rpc_conn,
+					esdm_rpc_fast_get_random_bytes, buf,
+					msg.len, &buffer.ret))
+			unpriv_access__rpc_get_random_bytes(
+				&rpc_conn->service, &msg,
+				esdm_rpcc_get_random_bytes_cb, &buffer);
 
 		if (buffer.ret < -255) {
 			maxbuflen = (size_t)(-buffer.ret);
+
+#if (ESDM_CLIENT_PIPELINE_DEPTH > 1)
+			/*
+			 * The request must be split into multiple chunks -
+			 * send them with multiple outstanding requests. Any
+			 * remainder is handled synchronously.
+			 */
+			if (buflen > maxbuflen) {
+				ret = esdm_rpcc_get_random_bytes_pipeline(
+					rpc_conn, buf, buflen, maxbuflen);
+				if (ret > 0) {
+					buflen -= (size_t)ret;
+					buf += ret;
+				}
+				ret = 0;
+			}
+#endif
 			continue;
 		} else if (buffer.ret < 0) {
 			ret = buffer.ret;
@@ -69,6 +69,12 @@ ssize_t esdm_rpcc_get_random_bytes_full_int(uint8_t *buf, size_t buflen,
 
 	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
 
+	/*
+	 * Large requests are served with fewer round trips, all requests
+	 * without protobuf-c if the server offers the compact wire format.
+	 */
+	esdm_rpcc_negotiate(rpc_conn);
+
 	while (buflen) {
 		buffer.ret = -ETIMEDOUT;
 		buffer.buf = buf;
@@ -76,9 +82,12 @@ ssize_t esdm_rpcc_get_random_bytes_full_int(uint8_t *buf, size_t buflen,
 
 		msg.len = min_size(maxbuflen, buflen);
 
-		unpriv_access__rpc_get_random_bytes_full(
-			&rpc_conn->service, &msg,
-			esdm_rpcc_get_random_bytes_full_cb, &buffer);
+		if (esdm_rpcc_fast_call(rpc_conn,
+					esdm_rpc_fast_get_random_bytes_full,
+					buf, msg.len, &buffer.ret))
+			unpriv_access__rpc_get_random_bytes_full(
+				&rpc_conn->service, &msg,
+				esdm_rpcc_get_random_bytes_full_cb, &buffer);
 
 		if (buffer.ret < -255) {
 			maxbuflen = (size_t)(-buffer.ret);
@@ -94,6 +94,10 @@ ssize_t esdm_rpcc_get_random_bytes_full_timeout_int(uint8_t *buf, size_t buflen,
 		timeout.tv_nsec = timeout.tv_nsec % 1000000000;
 	}
 
+	/* Large requests are served with fewer round trips */
+	if (buflen > ESDM_RPC_MAX_DATA)
+		esdm_rpcc_negotiate(rpc_conn);
+
 	while (buflen) {
 		buffer.ret = -ETIMEDOUT;
 		buffer.buf = buf;
@@ -69,6 +69,10 @@ ssize_t esdm_rpcc_get_random_bytes_min_int(uint8_t *buf, size_t buflen,
 
 	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
 
+	/* Large requests are served with fewer round trips */
+	if (buflen > ESDM_RPC_MAX_DATA)
+		esdm_rpcc_negotiate(rpc_conn);
+
 	while (buflen) {
 		buffer.ret = -ETIMEDOUT;
 		buffer.buf = buf;
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "math_helper.h"
+#include "esdm_logger.h"
+#include "ptr_err.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+struct esdm_get_random_bytes_vec_buf {
+	ssize_t ret;
+	size_t num;
+	uint8_t *buf[ESDM_RPC_VEC_MAX];
+	uint32_t len[ESDM_RPC_VEC_MAX];
+	uint32_t flags[ESDM_RPC_VEC_MAX];
+	size_t received[ESDM_RPC_VEC_MAX];
+};
+
+static void
+esdm_rpcc_get_random_bytes_vec_cb(const GetRandomBytesVecResponse *response,
+				  void *closure_data)
+{
+	struct esdm_get_random_bytes_vec_buf *buffer =
+		(struct esdm_get_random_bytes_vec_buf *)closure_data;
+	size_t i, total = 0;
+
+	esdm_rpcc_error_check(response, buffer);
+
+	if (response->ret < 0) {
+		buffer->ret = response->ret;
+		return;
+	}
+
+	for (i = 0; i < min_size(response->n_randval, buffer->num); i++) {
+		size_t len = min_size(response->randval[i].len, buffer->len[i]);
+
+		memcpy(buffer->buf[i], response->randval[i].data, len);
+		buffer->received[i] = len;
+		total += len;
+	}
+
+	buffer->ret = (ssize_t)total;
+
+	/* Zeroization of response is handled in esdm_rpc_client_read_handler */
+}
+
+/*
+ * Complete an entry the server did not fill entirely, e.g. a PR entry that
+ * was limited by the available entropy.
+ */
+static ssize_t esdm_rpcc_get_random_bytes_vec_fill(uint8_t *buf, size_t buflen,
+						   uint32_t flags,
+						   void *int_data)
+{
+	switch (flags) {
+	case ESDM_RPCC_RND_FULL:
+		return esdm_rpcc_get_random_bytes_full_int(buf, buflen,
+							   int_data);
+	case ESDM_RPCC_RND_MIN:
+		return esdm_rpcc_get_random_bytes_min_int(buf, buflen,
+							  int_data);
+	case ESDM_RPCC_RND_PR:
+		return esdm_rpcc_get_random_bytes_pr_int(buf, buflen, int_data);
+	case ESDM_RPCC_RND_NORMAL:
+	default:
+		return esdm_rpcc_get_random_bytes_int(buf, buflen, int_data);
+	}
+}
+
+DSO_PUBLIC
+ssize_t
+esdm_rpcc_get_random_bytes_vec_int(const struct esdm_rpcc_rnd_iovec *iov,
+				   size_t iovcnt, void *int_data)
+{
+	GetRandomBytesVecRequest msg = GET_RANDOM_BYTES_VEC_REQUEST__INIT;
+	esdm_rpc_client_connection_t *rpc_conn = NULL;
+	struct esdm_get_random_bytes_vec_buf buffer;
+	size_t i, cur = 0, offset = 0, total = 0;
+	ssize_t ret = 0;
+
+	if (!iov && iovcnt)
+		return -EINVAL;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (iov[i].flags > ESDM_RPCC_RND_PR ||
+		    (!iov[i].iov_base && iov[i].iov_len))
+			return -EINVAL;
+		total += iov[i].iov_len;
+	}
+
+	while (cur < iovcnt) {
+		size_t budget = ESDM_RPC_VEC_MAX_DATA;
+
+		/*
+		 * Collect as many entries as fit into one request - an entry
+		 * exceeding the remaining space is split across requests.
+		 */
+		buffer.num = 0;
+		while (cur < iovcnt && budget && buffer.num < ESDM_RPC_VEC_MAX) {
+			size_t todo = min_size(iov[cur].iov_len - offset,
+					       budget);
+
+			if (todo) {
+				buffer.buf[buffer.num] =
+					(uint8_t *)iov[cur].iov_base + offset;
+				buffer.len[buffer.num] = (uint32_t)todo;
+				buffer.flags[buffer.num] =
+					(uint32_t)iov[cur].flags;
+				buffer.received[buffer.num] = 0;
+				buffer.num++;
+				budget -= todo;
+				offset += todo;
+			}
+
+			if (offset >= iov[cur].iov_len) {
+				cur++;
+				offset = 0;
+			}
+		}
+
+		if (!buffer.num)
+			break;
+
+		msg.n_len = buffer.num;
+		msg.len = buffer.len;
+		msg.n_flags = buffer.num;
+		msg.flags = buffer.flags;
+
+		CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
+		for (;;) {
+			buffer.ret = -ETIMEDOUT;
+
+			unpriv_access__rpc_get_random_bytes_vec(
+				&rpc_conn->service, &msg,
+				esdm_rpcc_get_random_bytes_vec_cb, &buffer);
+
+			if (buffer.ret != -EAGAIN)
+				break;
+			nanosleep(&esdm_client_poll_ts, NULL);
+		}
+		esdm_rpcc_put_unpriv_service(rpc_conn);
+		rpc_conn = NULL;
+
+		if (buffer.ret < 0) {
+			ret = buffer.ret;
+			goto out;
+		}
+
+		esdm_test_shm_status_add_rpc_client_written((size_t)buffer.ret);
+
+		for (i = 0; i < buffer.num; i++) {
+			if (buffer.received[i] >= buffer.len[i])
+				continue;
+
+			CKINT(esdm_rpcc_get_random_bytes_vec_fill(
+				buffer.buf[i] + buffer.received[i],
+				buffer.len[i] - buffer.received[i],
+				buffer.flags[i], int_data));
+		}
+	}
+
+out:
+	return (ret < 0) ? ret : (ssize_t)total;
+}
+
+DSO_PUBLIC
+ssize_t esdm_rpcc_get_random_bytes_vec(const struct esdm_rpcc_rnd_iovec *iov,
+				       size_t iovcnt)
+{
+	return esdm_rpcc_get_random_bytes_vec_int(iov, iovcnt, NULL);
+}
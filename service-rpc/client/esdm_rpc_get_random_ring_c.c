@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+#include "mutex_w.h"
+#include "ptr_err.h"
+
+struct esdm_rpcc_ring {
+	struct esdm_rpc_ring *ring;
+	size_t maplen;
+	uint32_t size;
+	int ctrl_fd;
+	/* Head value at which the last refill request was sent */
+	uint64_t refill_head;
+	/* The server does not provide a ring */
+	bool unavailable;
+};
+
+static struct esdm_rpcc_ring esdm_rpcc_ring = { .ctrl_fd = -1 };
+static DEFINE_MUTEX_W_UNLOCKED(esdm_rpcc_ring_lock);
+static pthread_once_t esdm_rpcc_ring_once = PTHREAD_ONCE_INIT;
+
+struct esdm_get_random_ring_buf {
+	esdm_rpc_client_connection_t *rpc_conn;
+	int ret;
+	uint32_t size;
+	int mem_fd;
+	int ctrl_fd;
+};
+
+static void esdm_rpcc_get_random_ring_cb(const GetRandomRingResponse *response,
+					 void *closure_data)
+{
+	struct esdm_get_random_ring_buf *buffer =
+		(struct esdm_get_random_ring_buf *)closure_data;
+
+	esdm_rpcc_error_check(response, buffer);
+
+	buffer->ret = response->ret;
+	if (response->ret < 0)
+		return;
+
+	buffer->size = response->size;
+	buffer->mem_fd = esdm_rpcc_take_fd(buffer->rpc_conn, 0);
+	buffer->ctrl_fd = esdm_rpcc_take_fd(buffer->rpc_conn, 1);
+}
+
+/* Caller must hold esdm_rpcc_ring_lock */
+static void esdm_rpcc_ring_release(struct esdm_rpcc_ring *r)
+{
+	if (r->ring)
+		munmap(r->ring, r->maplen);
+	if (r->ctrl_fd >= 0)
+		close(r->ctrl_fd);
+
+	r->ring = NULL;
+	r->maplen = 0;
+	r->size = 0;
+	r->ctrl_fd = -1;
+	r->refill_head = 0;
+}
+
+/*
+ * The mapping is not inherited by a child due to MADV_DONTFORK. The child
+ * must not share the control socket with its parent either.
+ */
+static void esdm_rpcc_ring_atfork_child(void)
+{
+	mutex_w_init(&esdm_rpcc_ring_lock, 0, 0);
+	esdm_rpcc_ring.ring = NULL;
+	esdm_rpcc_ring_release(&esdm_rpcc_ring);
+	esdm_rpcc_ring.unavailable = false;
+}
+
+static void esdm_rpcc_ring_register_atfork(void)
+{
+	pthread_atfork(NULL, NULL, esdm_rpcc_ring_atfork_child);
+}
+
+/* Caller must hold esdm_rpcc_ring_lock */
+static int esdm_rpcc_ring_setup(esdm_rpc_client_connection_t *rpc_conn,
+				struct esdm_rpcc_ring *r)
+{
+	GetRandomRingRequest msg = GET_RANDOM_RING_REQUEST__INIT;
+	struct esdm_get_random_ring_buf buffer = { .rpc_conn = rpc_conn,
+						   .ret = -ETIMEDOUT,
+						   .mem_fd = -1,
+						   .ctrl_fd = -1 };
+	struct esdm_rpc_ring *ring;
+	struct stat sb;
+	size_t maplen;
+	int ret = 0;
+
+	pthread_once(&esdm_rpcc_ring_once, esdm_rpcc_ring_register_atfork);
+
+	msg.size = ESDM_RPC_RING_SIZE;
+	unpriv_access__rpc_get_random_ring(&rpc_conn->service, &msg,
+					   esdm_rpcc_get_random_ring_cb,
+					   &buffer);
+	if (buffer.ret < 0) {
+		ret = buffer.ret;
+		goto out;
+	}
+
+	if (buffer.mem_fd < 0 || buffer.ctrl_fd < 0 ||
+	    buffer.size < ESDM_RPC_RING_MIN_SIZE ||
+	    (buffer.size & (buffer.size - 1))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* The server may round the memory file up to its (huge) page size */
+	if (fstat(buffer.mem_fd, &sb) < 0) {
+		ret = -errno;
+		goto out;
+	}
+	maplen = sizeof(struct esdm_rpc_ring) + buffer.size;
+	if (sb.st_size < 0 || (size_t)sb.st_size < maplen) {
+		ret = -EFAULT;
+		goto out;
+	}
+	maplen = (size_t)sb.st_size;
+
+	ring = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    buffer.mem_fd, 0);
+	if (ring == MAP_FAILED) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (ring->magic != ESDM_RPC_RING_MAGIC || ring->size != buffer.size) {
+		munmap(ring, maplen);
+		ret = -EFAULT;
+		goto out;
+	}
+
+	/* Random data must not be duplicated into a child */
+	madvise(ring, maplen, MADV_DONTFORK);
+
+	r->ring = ring;
+	r->maplen = maplen;
+	r->size = buffer.size;
+	r->ctrl_fd = buffer.ctrl_fd;
+	r->refill_head = 0;
+	buffer.ctrl_fd = -1;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Random ring with %u bytes available\n", r->size);
+
+out:
+	/* The mapping keeps the memory file alive */
+	if (buffer.mem_fd >= 0)
+		close(buffer.mem_fd);
+	if (buffer.ctrl_fd >= 0)
+		close(buffer.ctrl_fd);
+	return ret;
+}
+
+/* Caller must hold esdm_rpcc_ring_lock */
+static void esdm_rpcc_ring_refill(struct esdm_rpcc_ring *r, uint64_t head)
+{
+	uint8_t req = 0;
+
+	/* Only one refill request per data provided by the server */
+	if (r->refill_head == head)
+		return;
+
+	if (send(r->ctrl_fd, &req, sizeof(req), MSG_DONTWAIT | MSG_NOSIGNAL) <
+	    0) {
+		/* The server is gone, a new ring is set up with the next call */
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			esdm_rpcc_ring_release(r);
+		return;
+	}
+
+	r->refill_head = head;
+}
+
+size_t esdm_rpcc_ring_get(esdm_rpc_client_connection_t *rpc_conn,
+			  uint8_t *buf, size_t buflen)
+{
+	struct esdm_rpcc_ring *r = &esdm_rpcc_ring;
+	struct esdm_rpc_ring *ring;
+	uint64_t head, tail, avail;
+	size_t copied = 0;
+	uint32_t mask;
+
+	if (!buflen || buflen > ESDM_RPC_RING_SIZE / 2)
+		return 0;
+
+	mutex_w_lock(&esdm_rpcc_ring_lock);
+
+	if (!r->ring) {
+		if (r->unavailable)
+			goto out;
+
+		if (esdm_rpcc_ring_setup(rpc_conn, r)) {
+			/* Do not try again with a server without rings */
+			r->unavailable = true;
+			goto out;
+		}
+	}
+
+	ring = r->ring;
+	mask = r->size - 1;
+	head = (uint64_t)atomic_read_64(&ring->head);
+	tail = (uint64_t)atomic_read_64(&ring->tail);
+
+	if (tail > head || head - tail > r->size) {
+		esdm_rpcc_ring_release(r);
+		goto out;
+	}
+
+	avail = head - tail;
+	if (avail >= buflen) {
+		while (copied < buflen) {
+			uint32_t offset = (uint32_t)(tail & mask);
+			size_t todo = min_size(buflen - copied,
+					       r->size - offset);
+
+			memcpy(buf + copied, ring->data + offset, todo);
+			/* Random data must only be used once */
+			memset_secure(ring->data + offset, 0, todo);
+
+			copied += todo;
+			tail += todo;
+		}
+
+		/* Hand the consumed space back to the server */
+		atomic_set_64(&ring->tail, (long long)tail);
+		avail -= buflen;
+	}
+
+	if (avail < r->size / 2)
+		esdm_rpcc_ring_refill(r, head);
+
+out:
+	mutex_w_unlock(&esdm_rpcc_ring_lock);
+	return copied;
+}
+
+void esdm_rpcc_ring_fini(void)
+{
+	mutex_w_lock(&esdm_rpcc_ring_lock);
+	esdm_rpcc_ring_release(&esdm_rpcc_ring);
+	esdm_rpcc_ring.unavailable = false;
+	mutex_w_unlock(&esdm_rpcc_ring_lock);
+}
+
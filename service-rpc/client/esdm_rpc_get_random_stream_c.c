@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+#include "ptr_err.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+/* Receive state for one frame of the stream */
+struct esdm_get_random_stream_buf {
+	struct esdm_rpcc_random_stream *stream;
+	ssize_t ret;
+	uint8_t *buf;
+	size_t buflen;
+};
+
+struct esdm_rpcc_random_stream {
+	esdm_rpc_client_connection_t *rpc_conn;
+	struct esdm_rpcc_pipeline pipeline;
+	struct esdm_get_random_stream_buf buffer;
+
+	/* Part of the last frame not yet consumed by the caller */
+	uint8_t frame[ESDM_RPC_MAX_DATA];
+	size_t frame_len;
+	size_t frame_off;
+
+	/* The server terminated the stream */
+	bool eos;
+};
+
+static void
+esdm_rpcc_get_random_stream_cb(const GetRandomStreamResponse *response,
+			       void *closure_data)
+{
+	struct esdm_get_random_stream_buf *buffer =
+		(struct esdm_get_random_stream_buf *)closure_data;
+	struct esdm_rpcc_random_stream *stream = buffer->stream;
+	size_t len;
+
+	esdm_rpcc_error_check(response, buffer);
+
+	if (response->ret <= 0) {
+		buffer->ret = response->ret;
+		stream->eos = true;
+		return;
+	}
+
+	len = min_size(response->randval.len, ESDM_RPC_MAX_DATA);
+
+	/* Copy the frame directly into the caller's buffer if possible */
+	if (len <= buffer->buflen) {
+		memcpy(buffer->buf, response->randval.data, len);
+		buffer->ret = (ssize_t)len;
+	} else {
+		memcpy(stream->frame, response->randval.data, len);
+		stream->frame_len = len;
+		stream->frame_off = 0;
+		buffer->ret = 0;
+	}
+
+	/* Zeroization of response is handled in esdm_rpc_client_read_handler */
+}
+
+DSO_PUBLIC
+int esdm_rpcc_random_stream_open_int(struct esdm_rpcc_random_stream **stream,
+				     uint64_t len, void *int_data)
+{
+	GetRandomStreamRequest msg = GET_RANDOM_STREAM_REQUEST__INIT;
+	struct esdm_rpcc_random_stream *s;
+	int ret;
+
+	CKNULL(stream, -EINVAL);
+
+	s = calloc(1, sizeof(*s));
+	CKNULL(s, -ENOMEM);
+	s->buffer.stream = s;
+
+	CKINT(esdm_rpcc_alloc_unpriv_conn(&s->rpc_conn, int_data));
+
+	msg.len = len;
+	msg.frame_size = 0;
+
+	/*
+	 * The request is only sent - the responses are received with
+	 * esdm_rpcc_random_stream_read.
+	 */
+	s->buffer.ret = 0;
+	esdm_rpcc_pipeline_start(s->rpc_conn, &s->pipeline);
+	unpriv_access__rpc_get_random_stream(&s->rpc_conn->service, &msg,
+					     esdm_rpcc_get_random_stream_cb,
+					     &s->buffer);
+	if (s->buffer.ret < 0) {
+		ret = (int)s->buffer.ret;
+		goto out;
+	}
+
+	*stream = s;
+	s = NULL;
+
+out:
+	if (s)
+		esdm_rpcc_random_stream_close(s);
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_random_stream_open(struct esdm_rpcc_random_stream **stream,
+				 uint64_t len)
+{
+	return esdm_rpcc_random_stream_open_int(stream, len, NULL);
+}
+
+DSO_PUBLIC
+ssize_t esdm_rpcc_random_stream_read(struct esdm_rpcc_random_stream *stream,
+				     uint8_t *buf, size_t buflen)
+{
+	struct esdm_get_random_stream_buf *buffer;
+	size_t filled = 0, todo;
+	ssize_t ret = 0;
+
+	CKNULL(stream, -EINVAL);
+	buffer = &stream->buffer;
+
+	while (filled < buflen) {
+		/* Serve the remainder of the last frame first */
+		if (stream->frame_off < stream->frame_len) {
+			todo = min_size(stream->frame_len - stream->frame_off,
+					buflen - filled);
+			memcpy(buf + filled, stream->frame + stream->frame_off,
+			       todo);
+			memset_secure(stream->frame + stream->frame_off, 0,
+				      todo);
+			stream->frame_off += todo;
+			filled += todo;
+			continue;
+		}
+
+		if (stream->eos)
+			break;
+
+		buffer->ret = -ETIMEDOUT;
+		buffer->buf = buf + filled;
+		buffer->buflen = buflen - filled;
+
+		esdm_rpcc_pipeline_stream(stream->rpc_conn, &stream->pipeline);
+		if (buffer->ret < 0) {
+			ret = buffer->ret;
+			stream->eos = true;
+			break;
+		}
+		if (stream->eos)
+			break;
+
+		esdm_test_shm_status_add_rpc_client_written(
+			buffer->ret ? (size_t)buffer->ret : stream->frame_len);
+		filled += (size_t)buffer->ret;
+	}
+
+out:
+	/* Data delivered before an error is still usable */
+	return filled ? (ssize_t)filled : ret;
+}
+
+DSO_PUBLIC
+void esdm_rpcc_random_stream_close(struct esdm_rpcc_random_stream *stream)
+{
+	if (!stream)
+		return;
+
+	/* Closing the connection terminates the stream on the server side */
+	esdm_rpcc_free_unpriv_conn(stream->rpc_conn);
+	memset_secure(stream->frame, 0, sizeof(stream->frame));
+	free(stream);
+}
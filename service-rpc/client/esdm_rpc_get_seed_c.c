@@ -100,3 +100,108 @@ ssize_t esdm_rpcc_get_seed(uint8_t *buf, size_t buflen, unsigned int flags)
 {
 	return esdm_rpcc_get_seed_int(buf, buflen, flags, NULL);
 }
+
+struct esdm_get_seed_blocks_buf {
+	ssize_t ret;
+	uint8_t *buf;
+	size_t blocklen;
+	size_t num;
+};
+
+static void esdm_rpcc_get_seed_blocks_cb(const GetSeedResponse *response,
+					 void *closure_data)
+{
+	struct esdm_get_seed_blocks_buf *buffer =
+		(struct esdm_get_seed_blocks_buf *)closure_data;
+	size_t i, num, stride;
+
+	esdm_rpcc_error_check(response, buffer);
+
+	buffer->ret = response->ret;
+	if (response->ret <= 0) {
+		/* -EMSGSIZE reports the required size in the first word */
+		memcpy(buffer->buf, response->randval.data,
+		       min_size(response->randval.len, buffer->blocklen));
+		buffer->num = 0;
+		return;
+	}
+
+	/* A server without batching returns one block */
+	num = min_size(response->num ? response->num : 1, buffer->num);
+	stride = response->randval.len / (response->num ? response->num : 1);
+	for (i = 0; i < num; i++) {
+		memcpy(buffer->buf + i * buffer->blocklen,
+		       response->randval.data + i * stride,
+		       min_size(stride, buffer->blocklen));
+	}
+	buffer->num = num;
+
+	/* Zeroization of response is handled in esdm_rpc_client_read_handler */
+}
+
+DSO_PUBLIC
+ssize_t esdm_rpcc_get_seed_blocks_int(uint8_t *buf, size_t blocklen,
+				      size_t num, unsigned int flags,
+				      void *int_data)
+{
+	GetSeedRequest msg = GET_SEED_REQUEST__INIT;
+	esdm_rpc_client_connection_t *rpc_conn = NULL;
+	struct esdm_get_seed_blocks_buf buffer;
+	size_t filled = 0;
+	ssize_t ret = 0;
+	int noblock = flags & ESDM_GET_SEED_NONBLOCK;
+
+	CKNULL(num, -EINVAL);
+	if (num > 1 && blocklen % sizeof(uint64_t))
+		return -EINVAL;
+
+	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
+
+	msg.len = blocklen;
+	msg.flags = flags;
+
+	/* Large batches are served with fewer round trips */
+	if (num > 1)
+		esdm_rpcc_negotiate(rpc_conn);
+
+	while (filled < num) {
+		buffer.ret = -ETIMEDOUT;
+		buffer.buf = buf + filled * blocklen;
+		buffer.blocklen = blocklen;
+		buffer.num = min_size(num - filled, UINT32_MAX);
+
+		msg.num = (uint32_t)buffer.num;
+
+		unpriv_access__rpc_get_seed(&rpc_conn->service, &msg,
+					    esdm_rpcc_get_seed_blocks_cb,
+					    &buffer);
+
+		ret = buffer.ret;
+		if (ret == -EAGAIN && !noblock) {
+			/* See esdm_rpcc_get_seed_int */
+			nanosleep(&esdm_client_poll_ts, NULL);
+			continue;
+		}
+		if (ret < 0)
+			break;
+
+		esdm_test_shm_status_add_rpc_client_written(buffer.num *
+							    blocklen);
+		filled += buffer.num;
+		if (noblock || !buffer.num)
+			break;
+	}
+
+out:
+	esdm_rpcc_put_unpriv_service(rpc_conn);
+	if (filled)
+		return (ssize_t)filled;
+	return ret < 0 ? ret : 0;
+}
+
+DSO_PUBLIC
+ssize_t esdm_rpcc_get_seed_blocks(uint8_t *buf, size_t blocklen, size_t num,
+				  unsigned int flags)
+{
+	return esdm_rpcc_get_seed_blocks_int(buf, blocklen, num, flags, NULL);
+}
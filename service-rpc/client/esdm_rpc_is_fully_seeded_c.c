@@ -52,15 +52,33 @@ int esdm_rpcc_is_fully_seeded_int(bool *fully_seeded, void *int_data)
 	IsFullySeededRequest msg = IS_FULLY_SEEDED_REQUEST__INIT;
 	esdm_rpc_client_connection_t *rpc_conn = NULL;
 	struct esdm_is_fully_seeded_buf buffer;
+	uint32_t seed_state, ent_lvl;
+	ssize_t status;
 	int ret = 0;
 
+	/* Answer from the status segment of the server if possible */
+	if (!esdm_rpcc_shm_seed_values(&seed_state, &ent_lvl)) {
+		if (fully_seeded)
+			*fully_seeded =
+				!!(seed_state & ESDM_SHM_SEED_FULLY_SEEDED);
+		return 0;
+	}
+
 	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
 
 	buffer.ret = -ETIMEDOUT;
 
-	unpriv_access__rpc_is_fully_seeded(&rpc_conn->service, &msg,
-					   esdm_rpcc_is_fully_seeded_cb,
-					   &buffer);
+	/* Use the compact wire format if the server offers it */
+	esdm_rpcc_negotiate(rpc_conn);
+	if (!esdm_rpcc_fast_call(rpc_conn, esdm_rpc_fast_is_fully_seeded, NULL,
+				 0, &status)) {
+		buffer.ret = (status < 0) ? (int)status : 0;
+		buffer.fully_seeded = status > 0;
+	} else {
+		unpriv_access__rpc_is_fully_seeded(
+			&rpc_conn->service, &msg, esdm_rpcc_is_fully_seeded_cb,
+			&buffer);
+	}
 
 	ret = buffer.ret;
 	if (fully_seeded)
@@ -52,8 +52,16 @@ int esdm_rpcc_is_min_seeded_int(bool *min_seeded, void *int_data)
 	IsMinSeededRequest msg = IS_MIN_SEEDED_REQUEST__INIT;
 	esdm_rpc_client_connection_t *rpc_conn = NULL;
 	struct esdm_is_min_seeded_buf buffer;
+	uint32_t seed_state, ent_lvl;
 	int ret = 0;
 
+	/* Answer from the status segment of the server if possible */
+	if (!esdm_rpcc_shm_seed_values(&seed_state, &ent_lvl)) {
+		if (min_seeded)
+			*min_seeded = !!(seed_state & ESDM_SHM_SEED_MIN_SEEDED);
+		return 0;
+	}
+
 	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
 
 	buffer.ret = -ETIMEDOUT;
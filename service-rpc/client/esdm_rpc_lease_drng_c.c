@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "lc_chacha20_drng.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+#include "ptr_err.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+/*
+ * Maximum number of bytes generated with one invocation of the local DRNG -
+ * every chunk counts as one request against the bound of the lease.
+ */
+#define ESDM_RPCC_LEASE_MAX_REQSIZE 4096
+
+struct esdm_rpcc_drng_lease {
+	struct lc_chacha20_drng_ctx *drng;
+
+	/* Bounds of the lease as provided by the server */
+	uint64_t max_bytes;
+	uint32_t max_requests;
+	struct timespec expiry;
+
+	/* Usage of the lease */
+	uint64_t bytes;
+	uint32_t requests;
+
+	/* Process which obtained the lease */
+	pid_t pid;
+
+	/* Generation of the ESDM DRNG state the seed was obtained from */
+	uint64_t generation;
+
+	void *int_data;
+};
+
+struct esdm_get_lease_seed_buf {
+	int ret;
+	struct esdm_rpcc_drng_lease *lease;
+};
+
+static void esdm_rpcc_get_lease_seed_cb(const GetLeaseSeedResponse *response,
+					void *closure_data)
+{
+	struct esdm_get_lease_seed_buf *buffer =
+		(struct esdm_get_lease_seed_buf *)closure_data;
+	struct esdm_rpcc_drng_lease *lease = buffer->lease;
+
+	esdm_rpcc_error_check(response, buffer);
+
+	if (response->ret < 0) {
+		buffer->ret = response->ret;
+		return;
+	}
+
+	if (response->seed.len < ESDM_RPC_LEASE_SEED_MIN_LEN) {
+		buffer->ret = -EPROTO;
+		return;
+	}
+
+	/* Replace the entire DRNG state with the new seed */
+	lc_cc20_drng_zero(lease->drng);
+	lc_cc20_drng_seed(lease->drng, response->seed.data, response->seed.len);
+
+	lease->max_requests = response->max_requests;
+	lease->max_bytes = response->max_bytes;
+	clock_gettime(CLOCK_MONOTONIC, &lease->expiry);
+	lease->expiry.tv_sec += (time_t)response->max_secs;
+	lease->requests = 0;
+	lease->bytes = 0;
+	lease->pid = getpid();
+
+	buffer->ret = 0;
+
+	/* Zeroization of response is handled in esdm_rpc_client_read_handler */
+}
+
+/* Obtain a new seed from the ESDM server and reseed the local DRNG */
+static int esdm_rpcc_lease_seed(struct esdm_rpcc_drng_lease *lease)
+{
+	GetLeaseSeedRequest msg = GET_LEASE_SEED_REQUEST__INIT;
+	esdm_rpc_client_connection_t *rpc_conn = NULL;
+	struct esdm_get_lease_seed_buf buffer;
+	/*
+	 * Fetch the generation before the seed: a concurrent change of the
+	 * generation implies that the seed is renewed with the next request.
+	 */
+	uint64_t generation = esdm_rpcc_rng_generation();
+	int ret;
+
+	/* A stale lease must never be used again */
+	lease->max_requests = 0;
+
+	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, lease->int_data));
+
+	msg.len = ESDM_RPC_LEASE_SEED_MIN_LEN;
+	buffer.lease = lease;
+
+	for (;;) {
+		buffer.ret = -ETIMEDOUT;
+
+		unpriv_access__rpc_get_lease_seed(&rpc_conn->service, &msg,
+						  esdm_rpcc_get_lease_seed_cb,
+						  &buffer);
+
+		/* Wait until the ESDM is fully seeded */
+		if (buffer.ret != -EAGAIN)
+			break;
+		nanosleep(&esdm_client_poll_ts, NULL);
+	}
+
+	ret = buffer.ret;
+	if (!ret)
+		lease->generation = generation;
+
+out:
+	esdm_rpcc_put_unpriv_service(rpc_conn);
+	return ret;
+}
+
+/* Is a new seed needed before the next request can be served? */
+static int esdm_rpcc_lease_expired(struct esdm_rpcc_drng_lease *lease,
+				   size_t todo)
+{
+	struct timespec now;
+
+	/* A child process must not generate the same data as its parent */
+	if (lease->pid != getpid())
+		return 1;
+
+	/* The DRNG state of the ESDM server changed */
+	if (lease->generation != esdm_rpcc_rng_generation())
+		return 1;
+
+	if (lease->requests >= lease->max_requests)
+		return 1;
+
+	/* A maximum number of bytes of zero implies no limit */
+	if (lease->max_bytes && lease->bytes + todo > lease->max_bytes)
+		return 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec > lease->expiry.tv_sec ||
+	    (now.tv_sec == lease->expiry.tv_sec &&
+	     now.tv_nsec >= lease->expiry.tv_nsec))
+		return 1;
+
+	return 0;
+}
+
+DSO_PUBLIC
+ssize_t esdm_rpcc_lease_get_random_bytes(struct esdm_rpcc_drng_lease *lease,
+					 uint8_t *buf, size_t buflen)
+{
+	size_t orig_buflen = buflen;
+	int ret = 0;
+
+	CKNULL(lease, -EINVAL);
+	CKNULL(buf, -EINVAL);
+
+	while (buflen) {
+		size_t todo = min_size(buflen, ESDM_RPCC_LEASE_MAX_REQSIZE);
+
+		if (esdm_rpcc_lease_expired(lease, todo)) {
+			CKINT(esdm_rpcc_lease_seed(lease));
+		}
+
+		lc_cc20_drng_generate_buffered(lease->drng, buf, todo);
+		lease->requests++;
+		lease->bytes += todo;
+
+		buflen -= todo;
+		buf += todo;
+	}
+
+out:
+	return (ret < 0) ? ret : (ssize_t)orig_buflen;
+}
+
+DSO_PUBLIC
+void esdm_rpcc_lease_drng_free(struct esdm_rpcc_drng_lease *lease)
+{
+	if (!lease)
+		return;
+
+	lc_cc20_drng_zero_free(lease->drng);
+	memset_secure(lease, 0, sizeof(*lease));
+	free(lease);
+}
+
+DSO_PUBLIC
+int esdm_rpcc_lease_drng_int(struct esdm_rpcc_drng_lease **lease,
+			     void *int_data)
+{
+	struct esdm_rpcc_drng_lease *l;
+	int ret;
+
+	CKNULL(lease, -EINVAL);
+
+	l = calloc(1, sizeof(*l));
+	CKNULL(l, -ENOMEM);
+
+	l->int_data = int_data;
+	ret = lc_cc20_drng_alloc(&l->drng);
+	if (ret) {
+		free(l);
+		goto out;
+	}
+
+	ret = esdm_rpcc_lease_seed(l);
+	if (ret) {
+		esdm_rpcc_lease_drng_free(l);
+		goto out;
+	}
+
+	*lease = l;
+
+out:
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_lease_drng(struct esdm_rpcc_drng_lease **lease)
+{
+	return esdm_rpcc_lease_drng_int(lease, NULL);
+}
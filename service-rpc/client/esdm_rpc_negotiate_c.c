@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "helper.h"
+#include "math_helper.h"
+#include "ptr_err.h"
+
+struct esdm_negotiate_buf {
+	esdm_rpc_client_connection_t *rpc_conn;
+	int ret;
+};
+
+/*
+ * The callback is invoked with the connection lock held which serializes the
+ * allocation of the receive buffers with all other operations on the
+ * connection.
+ */
+static void esdm_rpcc_negotiate_cb(const NegotiateResponse *response,
+				   void *closure_data)
+{
+	struct esdm_negotiate_buf *buffer =
+		(struct esdm_negotiate_buf *)closure_data;
+	esdm_rpc_client_connection_t *rpc_conn = buffer->rpc_conn;
+	uint32_t max_msg_size;
+
+	esdm_rpcc_error_check(response, buffer);
+
+	buffer->ret = response->ret;
+	if (response->ret < 0)
+		return;
+
+	rpc_conn->fast_wire =
+		response->version >= ESDM_RPC_PROTO_VERSION_FAST_WIRE;
+	rpc_conn->cpu_hint =
+		response->version >= ESDM_RPC_PROTO_VERSION_CPU_HINT &&
+		esdm_rpcc_local_transport();
+
+	max_msg_size = min_uint32(response->max_msg_size,
+				  ESDM_RPC_MAX_NEGOTIATED_MSG_SIZE);
+	if (max_msg_size <= ESDM_RPC_MAX_MSG_SIZE)
+		return;
+
+	/*
+	 * The receive buffers are in use while this callback is invoked, they
+	 * are enlarged when receiving the next response.
+	 */
+	rpc_conn->max_msg_size = max_msg_size;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Negotiated protocol version %u with message size %u\n",
+		    response->version, max_msg_size);
+}
+
+void esdm_rpcc_negotiate(esdm_rpc_client_connection_t *rpc_conn)
+{
+	NegotiateRequest msg = NEGOTIATE_REQUEST__INIT;
+	struct esdm_negotiate_buf buffer;
+
+	if (rpc_conn->max_msg_size || rpc_conn->negotiate_unsupported)
+		return;
+
+	msg.version = ESDM_RPC_PROTO_VERSION;
+	msg.max_msg_size = ESDM_RPC_MAX_NEGOTIATED_MSG_SIZE;
+
+	/* The server selects its DRNG instance by the CPU of the caller */
+	if (esdm_rpcc_local_transport())
+		msg.cpu = esdm_curr_node() + 1;
+
+	buffer.rpc_conn = rpc_conn;
+	buffer.ret = -ETIMEDOUT;
+
+	unpriv_access__rpc_negotiate(&rpc_conn->service, &msg,
+				     esdm_rpcc_negotiate_cb, &buffer);
+
+	/*
+	 * A server not knowing the request closes the connection. Do not
+	 * try again, the default message size is always usable.
+	 */
+	if (buffer.ret < 0) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Protocol negotiation failed: %d\n", buffer.ret);
+		rpc_conn->negotiate_unsupported = true;
+	}
+}
@@ -24,6 +24,7 @@
 #include "esdm_rpc_client_internal.h"
 #include "esdm_rpc_service.h"
 #include "helper.h"
+#include "math_helper.h"
 #include "esdm_logger.h"
 #include "ptr_err.h"
 #include "ret_checkers.h"
@@ -43,6 +44,74 @@ static void esdm_rpcc_rnd_add_entropy_cb(const RndAddEntropyResponse *response,
 	buffer->ret = response->ret;
 }
 
+/*
+ * Entropy credited to the next chunk of todo bytes out of the remaining len
+ * bytes: the sum over all chunks is exactly the entropy of the entire buffer.
+ */
+static uint32_t esdm_rpcc_rnd_add_entropy_chunk_cnt(uint32_t entropy_cnt,
+						    size_t todo, size_t len)
+{
+	return (uint32_t)(((uint64_t)entropy_cnt * todo) / len);
+}
+
+#if (ESDM_CLIENT_PIPELINE_DEPTH > 1)
+/*
+ * Send up to ESDM_CLIENT_PIPELINE_DEPTH chunks of the buffer with outstanding
+ * requests on the connection. The buffer pointer, its length and the entropy
+ * are advanced by the chunks the server accepted.
+ */
+static int
+esdm_rpcc_rnd_add_entropy_pipeline(esdm_rpc_client_connection_t *rpc_conn,
+				   const uint8_t **entropy_buf,
+				   size_t *entropy_buf_len,
+				   uint32_t *entropy_cnt)
+{
+	RndAddEntropyRequest msg = RND_ADD_ENTROPY_REQUEST__INIT;
+	struct esdm_rnd_add_entropy_buf buffer[ESDM_CLIENT_PIPELINE_DEPTH];
+	struct esdm_rpcc_pipeline pipeline;
+	const uint8_t *buf = *entropy_buf;
+	size_t len = *entropy_buf_len;
+	uint32_t i, num, ent = *entropy_cnt;
+	int ret;
+
+	esdm_rpcc_pipeline_start(rpc_conn, &pipeline);
+	for (num = 0; num < ESDM_CLIENT_PIPELINE_DEPTH && len; num++) {
+		size_t todo = min_size(len, ESDM_RPC_MAX_DATA);
+
+		buffer[num].ret = -ETIMEDOUT;
+
+		//TODO unconstify
+		msg.randval.data = (uint8_t *)buf;
+		msg.randval.len = todo;
+		msg.entcnt = esdm_rpcc_rnd_add_entropy_chunk_cnt(ent, todo,
+								 len);
+
+		priv_access__rpc_rnd_add_entropy(&rpc_conn->service, &msg,
+						 esdm_rpcc_rnd_add_entropy_cb,
+						 &buffer[num]);
+
+		ent -= msg.entcnt;
+		len -= todo;
+		buf += todo;
+	}
+	CKINT(esdm_rpcc_pipeline_complete(rpc_conn));
+
+	for (i = 0; i < num; i++) {
+		if (buffer[i].ret) {
+			ret = buffer[i].ret;
+			goto out;
+		}
+	}
+
+	*entropy_buf = buf;
+	*entropy_buf_len = len;
+	*entropy_cnt = ent;
+
+out:
+	return ret;
+}
+#endif
+
 DSO_PUBLIC
 int esdm_rpcc_rnd_add_entropy_int(const uint8_t *entropy_buf,
 				  size_t entropy_buf_len, uint32_t entropy_cnt,
@@ -55,16 +124,45 @@ int esdm_rpcc_rnd_add_entropy_int(const uint8_t *entropy_buf,
 
 	CKINT(esdm_rpcc_get_priv_service(&rpc_conn, int_data));
 
-	buffer.ret = -ETIMEDOUT;
+	/*
+	 * Buffers larger than one RPC message are sent in chunks, each chunk
+	 * credited with its share of the entropy.
+	 */
+	do {
+		size_t todo = min_size(entropy_buf_len, ESDM_RPC_MAX_DATA);
+
+#if (ESDM_CLIENT_PIPELINE_DEPTH > 1)
+		if (entropy_buf_len > ESDM_RPC_MAX_DATA) {
+			CKINT(esdm_rpcc_rnd_add_entropy_pipeline(
+				rpc_conn, &entropy_buf, &entropy_buf_len,
+				&entropy_cnt));
+			continue;
+		}
+#endif
+
+		buffer.ret = -ETIMEDOUT;
+
+		//TODO unconstify
+		msg.randval.data = (uint8_t *)entropy_buf;
+		msg.randval.len = todo;
+		if (entropy_buf_len) {
+			msg.entcnt = esdm_rpcc_rnd_add_entropy_chunk_cnt(
+				entropy_cnt, todo, entropy_buf_len);
+		} else {
+			msg.entcnt = entropy_cnt;
+		}
 
-	//TODO unconstify
-	msg.randval.data = (uint8_t *)entropy_buf;
-	msg.randval.len = entropy_buf_len;
-	msg.entcnt = entropy_cnt;
+		priv_access__rpc_rnd_add_entropy(&rpc_conn->service, &msg,
+						 esdm_rpcc_rnd_add_entropy_cb,
+						 &buffer);
+		ret = buffer.ret;
+		if (ret)
+			goto out;
 
-	priv_access__rpc_rnd_add_entropy(&rpc_conn->service, &msg,
-					 esdm_rpcc_rnd_add_entropy_cb, &buffer);
-	ret = buffer.ret;
+		entropy_cnt -= msg.entcnt;
+		entropy_buf_len -= todo;
+		entropy_buf += todo;
+	} while (entropy_buf_len);
 
 out:
 	esdm_rpcc_put_priv_service(rpc_conn);
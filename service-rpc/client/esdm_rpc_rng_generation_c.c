@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+
+#include "esdm_rpc_client.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "esdm_shm_event.h"
+#include "visibility.h"
+
+/*
+ * The shared memory status segment of the ESDM server announces the
+ * generation of its DRNG state. Client-side DRNGs obtain a new seed when the
+ * generation changes, e.g. after a forced reseed or a suspend/resume cycle.
+ * If the segment is not available, the generation is always zero.
+ *
+ * The segment also carries the seed state and the values of the
+ * /proc/sys/kernel/random files which answer the status queries without an
+ * RPC call.
+ */
+static const struct esdm_shm_status *esdm_rpcc_rng_generation_shm = NULL;
+static pthread_once_t esdm_rpcc_rng_generation_once = PTHREAD_ONCE_INIT;
+
+static void esdm_rpcc_rng_generation_attach(void)
+{
+	key_t key = esdm_ftok(ESDM_SHM_NAME, ESDM_SHM_STATUS);
+	const struct esdm_shm_status *tmp;
+	int shmid;
+
+	shmid = shmget(key, sizeof(struct esdm_shm_status), 0);
+	if (shmid < 0)
+		return;
+
+	tmp = shmat(shmid, NULL, SHM_RDONLY);
+	if (tmp == (void *)-1)
+		return;
+
+	if (tmp->version != ESDM_SHM_STATUS_VERSION) {
+		shmdt(tmp);
+		return;
+	}
+
+	esdm_rpcc_rng_generation_shm = tmp;
+}
+
+DSO_PUBLIC
+uint64_t esdm_rpcc_rng_generation(void)
+{
+	pthread_once(&esdm_rpcc_rng_generation_once,
+		     esdm_rpcc_rng_generation_attach);
+
+	if (!esdm_rpcc_rng_generation_shm)
+		return 0;
+
+	return (uint64_t)atomic_read_64(
+		&esdm_rpcc_rng_generation_shm->rng_generation);
+}
+
+/* The segment describes the server only if the local transport is used */
+static const struct esdm_shm_status *esdm_rpcc_shm_status(void)
+{
+	if (!esdm_rpcc_local_transport())
+		return NULL;
+
+	pthread_once(&esdm_rpcc_rng_generation_once,
+		     esdm_rpcc_rng_generation_attach);
+
+	return esdm_rpcc_rng_generation_shm;
+}
+
+int esdm_rpcc_shm_seed_values(uint32_t *seed_state, uint32_t *ent_lvl)
+{
+	const struct esdm_shm_status *status = esdm_rpcc_shm_status();
+	int ret;
+
+	if (!status)
+		return -EOPNOTSUPP;
+
+	ret = esdm_shm_status_seed_values(status, seed_state, ent_lvl);
+	if (ret)
+		return ret;
+
+	return (*seed_state & ESDM_SHM_SEED_VALID) ? 0 : -EOPNOTSUPP;
+}
+
+int esdm_rpcc_shm_seed_wait(uint32_t states, const struct timespec *abstime)
+{
+	const struct esdm_shm_status *status = esdm_rpcc_shm_status();
+	uint32_t seed_state, ent_lvl;
+	int seen, ret;
+
+	if (!status)
+		return -EOPNOTSUPP;
+
+	for (;;) {
+		/* Snapshot the event before evaluating the state */
+		seen = atomic_read(&status->seed_event);
+
+		ret = esdm_rpcc_shm_seed_values(&seed_state, &ent_lvl);
+		if (ret)
+			return ret == -EAGAIN ? -EOPNOTSUPP : ret;
+		if ((seed_state & states) == states)
+			return 0;
+
+		ret = esdm_shm_event_wait(&status->seed_event, seen, abstime);
+		if (ret)
+			return ret;
+	}
+}
+
+DSO_PUBLIC
+int esdm_rpcc_seed_state_cached(bool *min_seeded, bool *fully_seeded)
+{
+	uint32_t seed_state, ent_lvl;
+	int ret = esdm_rpcc_shm_seed_values(&seed_state, &ent_lvl);
+
+	if (ret)
+		return ret;
+
+	if (min_seeded)
+		*min_seeded = !!(seed_state & ESDM_SHM_SEED_MIN_SEEDED);
+	if (fully_seeded)
+		*fully_seeded = !!(seed_state & ESDM_SHM_SEED_FULLY_SEEDED);
+
+	return 0;
+}
+
+int esdm_rpcc_shm_poolsize(uint32_t *poolsize)
+{
+	const struct esdm_shm_status *status = esdm_rpcc_shm_status();
+	uint32_t values[4], seed_state, ent_lvl;
+	int ret;
+
+	/* The proc values are only current while the seed state is valid */
+	ret = esdm_rpcc_shm_seed_values(&seed_state, &ent_lvl);
+	if (ret)
+		return ret;
+
+	esdm_shm_status_proc_values(status, values);
+	*poolsize = values[1];
+
+	return 0;
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "atomic_64.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_protocol.h"
+#include "esdm_rpc_service.h"
+#include "helper.h"
+#include "math_helper.h"
+#include "visibility.h"
+
+#ifdef ESDM_RPCC_STATS
+
+/* Groups of methods with their own method index */
+enum {
+	esdm_rpcc_stats_unpriv,
+	esdm_rpcc_stats_priv,
+	esdm_rpcc_stats_fast,
+	esdm_rpcc_stats_group_num,
+};
+
+/* Methods per group, methods with a larger index are not accounted */
+#define ESDM_RPCC_STATS_GROUP_METHODS 32
+
+struct esdm_rpcc_stats_ctr {
+	atomic_64_t calls;
+	atomic_64_t errors;
+	atomic_64_t latency_count;
+	atomic_64_t latency_sum_ns;
+	atomic_64_t latency_hist[ESDM_RPCC_STATS_LAT_BUCKETS];
+};
+
+/*
+ * The counters are shared by all threads of the process and only updated
+ * with atomic operations - recording never blocks a caller.
+ */
+static struct esdm_rpcc_stats_ctr
+	esdm_rpcc_stats_ctr[esdm_rpcc_stats_group_num]
+			   [ESDM_RPCC_STATS_GROUP_METHODS];
+static atomic_64_t esdm_rpcc_stats_connects = ATOMIC_64_INIT(0);
+static atomic_64_t esdm_rpcc_stats_connect_failures = ATOMIC_64_INIT(0);
+static atomic_64_t esdm_rpcc_stats_failovers = ATOMIC_64_INIT(0);
+static atomic_64_t esdm_rpcc_stats_retries = ATOMIC_64_INIT(0);
+static atomic_64_t esdm_rpcc_stats_fallbacks = ATOMIC_64_INIT(0);
+
+/* Names of the compact wire format methods */
+static const char *const esdm_rpcc_stats_fast_methods[] = {
+	[esdm_rpc_fast_get_random_bytes] = "RpcGetRandomBytes",
+	[esdm_rpc_fast_get_random_bytes_full] = "RpcGetRandomBytesFull",
+	[esdm_rpc_fast_is_fully_seeded] = "RpcIsFullySeeded",
+	[esdm_rpc_fast_get_ent_lvl] = "RpcGetEntLvl",
+};
+
+uint64_t esdm_rpcc_stats_start(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned int esdm_rpcc_stats_bucket(uint64_t ns)
+{
+	unsigned int bucket;
+
+	if (ns < (1ULL << 10))
+		return 0;
+
+	bucket = (unsigned int)(64 - __builtin_clzll(ns)) - 10;
+	return min_uint32(bucket, ESDM_RPCC_STATS_LAT_BUCKETS - 1);
+}
+
+static void esdm_rpcc_stats_account(unsigned int group, unsigned int idx,
+				    uint64_t start, int ret)
+{
+	struct esdm_rpcc_stats_ctr *ctr;
+	uint64_t ns;
+
+	if (idx >= ESDM_RPCC_STATS_GROUP_METHODS)
+		return;
+
+	ctr = &esdm_rpcc_stats_ctr[group][idx];
+	atomic_inc_64(&ctr->calls);
+	if (ret < 0)
+		atomic_inc_64(&ctr->errors);
+
+	if (!start)
+		return;
+
+	ns = esdm_rpcc_stats_start() - start;
+	atomic_inc_64(&ctr->latency_count);
+	atomic_add_64(&ctr->latency_sum_ns, (long long)ns);
+	atomic_inc_64(&ctr->latency_hist[esdm_rpcc_stats_bucket(ns)]);
+}
+
+void esdm_rpcc_stats_call(const ProtobufCServiceDescriptor *desc,
+			  unsigned int method_index, uint64_t start, int ret)
+{
+	esdm_rpcc_stats_account((desc == &priv_access__descriptor) ?
+					esdm_rpcc_stats_priv :
+					esdm_rpcc_stats_unpriv,
+				method_index, start, ret);
+}
+
+void esdm_rpcc_stats_fast_call(uint32_t method, uint64_t start, int ret)
+{
+	esdm_rpcc_stats_account(esdm_rpcc_stats_fast, method, start, ret);
+}
+
+void esdm_rpcc_stats_connect(unsigned int endpoint, int ret)
+{
+	if (ret < 0) {
+		atomic_inc_64(&esdm_rpcc_stats_connect_failures);
+		return;
+	}
+
+	atomic_inc_64(&esdm_rpcc_stats_connects);
+	if (endpoint == esdm_rpcc_endpoint_fallback)
+		atomic_inc_64(&esdm_rpcc_stats_failovers);
+}
+
+void esdm_rpcc_stats_retry(void)
+{
+	atomic_inc_64(&esdm_rpcc_stats_retries);
+}
+
+static uint64_t esdm_rpcc_stats_read(const atomic_64_t *v)
+{
+	return (uint64_t)atomic_read_64(v);
+}
+
+static const char *esdm_rpcc_stats_name(unsigned int group, unsigned int idx,
+					const char **service)
+{
+	const ProtobufCServiceDescriptor *desc;
+
+	if (group == esdm_rpcc_stats_fast) {
+		*service = "Fast";
+		if (idx >= ARRAY_SIZE(esdm_rpcc_stats_fast_methods))
+			return NULL;
+		return esdm_rpcc_stats_fast_methods[idx];
+	}
+
+	desc = (group == esdm_rpcc_stats_priv) ? &priv_access__descriptor :
+						 &unpriv_access__descriptor;
+	*service = desc->name;
+	if (idx >= desc->n_methods)
+		return NULL;
+	return desc->methods[idx].name;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_get_stats(struct esdm_rpcc_stats *stats)
+{
+	unsigned int group, idx, i;
+
+	if (!stats)
+		return -EINVAL;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->connects = esdm_rpcc_stats_read(&esdm_rpcc_stats_connects);
+	stats->connect_failures =
+		esdm_rpcc_stats_read(&esdm_rpcc_stats_connect_failures);
+	stats->failovers = esdm_rpcc_stats_read(&esdm_rpcc_stats_failovers);
+	stats->retries = esdm_rpcc_stats_read(&esdm_rpcc_stats_retries);
+	stats->fallbacks = esdm_rpcc_stats_read(&esdm_rpcc_stats_fallbacks);
+
+	for (group = 0; group < esdm_rpcc_stats_group_num; group++) {
+		for (idx = 0; idx < ESDM_RPCC_STATS_GROUP_METHODS; idx++) {
+			struct esdm_rpcc_stats_ctr *ctr =
+				&esdm_rpcc_stats_ctr[group][idx];
+			struct esdm_rpcc_stats_method *m;
+			const char *service, *name;
+			uint64_t calls = esdm_rpcc_stats_read(&ctr->calls);
+
+			if (!calls)
+				continue;
+			if (stats->method_num >= ESDM_RPCC_STATS_METHODS_MAX)
+				return 0;
+
+			name = esdm_rpcc_stats_name(group, idx, &service);
+			m = &stats->method[stats->method_num++];
+			if (name)
+				snprintf(m->name, sizeof(m->name), "%s.%s",
+					 service, name);
+			else
+				snprintf(m->name, sizeof(m->name), "%s.%u",
+					 service, idx);
+
+			m->calls = calls;
+			m->errors = esdm_rpcc_stats_read(&ctr->errors);
+			m->latency_count =
+				esdm_rpcc_stats_read(&ctr->latency_count);
+			m->latency_sum_ns =
+				esdm_rpcc_stats_read(&ctr->latency_sum_ns);
+			for (i = 0; i < ESDM_RPCC_STATS_LAT_BUCKETS; i++)
+				m->latency_hist[i] = esdm_rpcc_stats_read(
+					&ctr->latency_hist[i]);
+		}
+	}
+
+	return 0;
+}
+
+DSO_PUBLIC
+void esdm_rpcc_stats_fallback(void)
+{
+	atomic_inc_64(&esdm_rpcc_stats_fallbacks);
+}
+
+#else /* ESDM_RPCC_STATS */
+
+DSO_PUBLIC
+int esdm_rpcc_get_stats(struct esdm_rpcc_stats *stats)
+{
+	(void)stats;
+	return -EOPNOTSUPP;
+}
+
+DSO_PUBLIC
+void esdm_rpcc_stats_fallback(void)
+{
+}
+
+#endif /* ESDM_RPCC_STATS */
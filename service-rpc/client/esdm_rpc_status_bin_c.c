@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "esdm_status_bin.h"
+#include "math_helper.h"
+#include "ptr_err.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+struct esdm_get_status_bin_buf {
+	int ret;
+	struct esdm_status_bin *status;
+};
+
+static void esdm_rpcc_status_bin_cb(const StatusBinResponse *response,
+				    void *closure_data)
+{
+	struct esdm_get_status_bin_buf *buffer =
+		(struct esdm_get_status_bin_buf *)closure_data;
+	size_t len;
+
+	esdm_rpcc_error_check(response, buffer);
+	buffer->ret = response->ret;
+	if (response->ret < 0)
+		return;
+
+	/*
+	 * A newer server may return a larger structure which is truncated to
+	 * the requested size.
+	 */
+	len = min_size(response->status.len, sizeof(*buffer->status));
+	memset(buffer->status, 0, sizeof(*buffer->status));
+	if (response->status.data)
+		memcpy(buffer->status, response->status.data, len);
+
+	if (len < 2 * sizeof(uint32_t) ||
+	    buffer->status->version < ESDM_STATUS_BIN_VERSION) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Binary status of unsupported version received\n");
+		buffer->ret = -EPROTO;
+	}
+}
+
+DSO_PUBLIC
+int esdm_rpcc_status_bin_int(struct esdm_status_bin *status, void *int_data)
+{
+	StatusBinRequest msg = STATUS_BIN_REQUEST__INIT;
+	esdm_rpc_client_connection_t *rpc_conn = NULL;
+	struct esdm_get_status_bin_buf buffer = {
+		.ret = -ETIMEDOUT,
+		.status = status,
+	};
+	int ret;
+
+	CKNULL(status, -EINVAL);
+
+	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
+
+	msg.maxlen = sizeof(*status);
+	unpriv_access__rpc_status_bin(&rpc_conn->service, &msg,
+				      esdm_rpcc_status_bin_cb, &buffer);
+
+	ret = buffer.ret;
+
+out:
+	esdm_rpcc_put_unpriv_service(rpc_conn);
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_status_bin(struct esdm_status_bin *status)
+{
+	return esdm_rpcc_status_bin_int(status, NULL);
+}
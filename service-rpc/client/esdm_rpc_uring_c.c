@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "conv_be_le.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_protocol.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+#include "ret_checkers.h"
+
+/*
+ * Private io_uring instance of an asynchronous context: the requests are
+ * collected in the transmit buffer and sent with one SEND operation. A RECV
+ * operation into the receive buffer is kept armed as long as the connection
+ * exists. With the first submission both are submitted as linked operations.
+ *
+ * Only one SEND and one RECV are in flight at any time. Requests added while
+ * a SEND is in flight are sent with the submission following its completion
+ * which is performed together with re-arming the RECV. Under load, one
+ * io_uring_enter therefore covers many requests and responses. The
+ * completions are reaped from the shared memory without a system call.
+ */
+
+/* A few entries suffice for one SEND and one RECV */
+#define ESDM_RPCC_URING_ENTRIES 4
+
+/* Holds the requests of a full pipeline */
+#define ESDM_RPCC_URING_TX_SIZE 4096
+
+#define ESDM_RPCC_URING_SEND 1
+#define ESDM_RPCC_URING_RECV 2
+
+struct esdm_rpcc_uring {
+	int fd;
+
+	/* Submission queue */
+	void *sq_ptr;
+	size_t sq_len;
+	unsigned int *sq_tail, *sq_mask;
+	struct io_uring_sqe *sqes;
+	size_t sqes_len;
+	/* Tail including the entries not yet published to the kernel */
+	unsigned int sq_local;
+	unsigned int to_submit;
+
+	/* Completion queue */
+	void *cq_ptr;
+	size_t cq_len;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	bool send_busy, recv_busy;
+	int error;
+
+	/* Requests not yet sent, the first tx_len bytes are valid */
+	uint8_t tx[ESDM_RPCC_URING_TX_SIZE];
+	size_t tx_len;
+
+	/* Received responses, the bytes from rx_pos to rx_len are unread */
+	uint8_t *rx;
+	size_t rx_size, rx_len, rx_pos, rx_frame_end;
+};
+
+static int esdm_rpcc_uring_setup(unsigned int entries,
+				 struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int esdm_rpcc_uring_enter(int fd, unsigned int to_submit,
+				 unsigned int min_complete, unsigned int flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+			    flags, NULL, 0);
+}
+
+static struct io_uring_sqe *esdm_rpcc_uring_sqe(struct esdm_rpcc_uring *ring)
+{
+	struct io_uring_sqe *sqe =
+		&ring->sqes[ring->sq_local++ & *ring->sq_mask];
+
+	memset(sqe, 0, sizeof(*sqe));
+	ring->to_submit++;
+
+	return sqe;
+}
+
+/* Compact the receive buffer so that the next RECV has the most room */
+static void esdm_rpcc_uring_rx_compact(struct esdm_rpcc_uring *ring)
+{
+	size_t unread = ring->rx_len - ring->rx_pos;
+
+	if (!ring->rx_pos)
+		return;
+
+	memmove(ring->rx, ring->rx + ring->rx_pos, unread);
+	memset_secure(ring->rx + unread, 0, ring->rx_pos);
+	ring->rx_len = unread;
+	ring->rx_pos = 0;
+	ring->rx_frame_end = 0;
+}
+
+int esdm_rpcc_uring_queue(struct esdm_rpcc_uring *ring, const uint8_t *data,
+			  size_t len)
+{
+	if (len > sizeof(ring->tx) - ring->tx_len) {
+		/* A partial request corrupts the stream, drop it */
+		ring->error = -EMSGSIZE;
+		return -EMSGSIZE;
+	}
+
+	memcpy(ring->tx + ring->tx_len, data, len);
+	ring->tx_len += len;
+
+	return 0;
+}
+
+int esdm_rpcc_uring_submit(struct esdm_rpcc_uring *ring, int sockfd)
+{
+	struct io_uring_sqe *sqe;
+	int ret;
+
+	if (ring->error)
+		return ring->error;
+
+	if (!ring->send_busy && ring->tx_len) {
+		sqe = esdm_rpcc_uring_sqe(ring);
+		sqe->opcode = IORING_OP_SEND;
+		sqe->fd = sockfd;
+		sqe->addr = (uint64_t)(uintptr_t)ring->tx;
+		sqe->len = (uint32_t)ring->tx_len;
+		sqe->msg_flags = MSG_NOSIGNAL;
+		sqe->user_data = ESDM_RPCC_URING_SEND;
+
+		/* Receive the response only after the request is sent */
+		if (!ring->recv_busy)
+			sqe->flags = IOSQE_IO_LINK;
+		ring->send_busy = true;
+	}
+
+	if (!ring->recv_busy)
+		esdm_rpcc_uring_rx_compact(ring);
+
+	if (!ring->recv_busy && ring->rx_len < ring->rx_size) {
+		sqe = esdm_rpcc_uring_sqe(ring);
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = sockfd;
+		sqe->addr = (uint64_t)(uintptr_t)(ring->rx + ring->rx_len);
+		sqe->len = (uint32_t)(ring->rx_size - ring->rx_len);
+		sqe->user_data = ESDM_RPCC_URING_RECV;
+		ring->recv_busy = true;
+	}
+
+	if (!ring->to_submit)
+		return 0;
+
+	/* The kernel reads the entries only after the tail is updated */
+	__atomic_store_n(ring->sq_tail, ring->sq_local, __ATOMIC_RELEASE);
+
+	do {
+		ret = esdm_rpcc_uring_enter(ring->fd, ring->to_submit, 0, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0) {
+		ret = -errno;
+
+		/* The entries remain queued for the next submission */
+		if (ret == -EAGAIN || ret == -EBUSY)
+			return -EAGAIN;
+		return ret;
+	}
+
+	ring->to_submit -= (unsigned int)min_uint64((uint64_t)ret,
+						    ring->to_submit);
+
+	return 0;
+}
+
+int esdm_rpcc_uring_reap(struct esdm_rpcc_uring *ring)
+{
+	unsigned int head = *ring->cq_head;
+	unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		int res = cqe->res;
+
+		if (cqe->user_data == ESDM_RPCC_URING_SEND) {
+			ring->send_busy = false;
+			if (res < 0) {
+				ring->error = res;
+				continue;
+			}
+
+			/* Keep the unsent part of a short send */
+			ring->tx_len -= (size_t)res;
+			memmove(ring->tx, ring->tx + res, ring->tx_len);
+		} else if (cqe->user_data == ESDM_RPCC_URING_RECV) {
+			ring->recv_busy = false;
+
+			/*
+			 * A RECV canceled by a failed linked SEND is only
+			 * re-armed, the SEND completion reports the error.
+			 */
+			if (res > 0) {
+				ring->rx_len += (size_t)res;
+			} else if (!res) {
+				/* The server closed the connection */
+				ring->error = -EPIPE;
+			} else if (res != -ECANCELED) {
+				ring->error = res;
+			}
+		}
+	}
+
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+	return ring->error;
+}
+
+int esdm_rpcc_uring_frame(struct esdm_rpcc_uring *ring)
+{
+	struct esdm_rpc_proto_sc_header header;
+	size_t unread = ring->rx_len - ring->rx_pos, frame;
+
+	if (ring->rx_frame_end > ring->rx_pos)
+		return 1;
+	if (unread < sizeof(header))
+		return 0;
+
+	memcpy(&header, ring->rx + ring->rx_pos, sizeof(header));
+	frame = sizeof(header) + le_bswap32(header.message_length);
+	if (frame > ring->rx_size) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Response of %zu bytes exceeds the receive buffer\n",
+			    frame);
+		ring->error = -EMSGSIZE;
+		return -EMSGSIZE;
+	}
+	if (unread < frame)
+		return 0;
+
+	ring->rx_frame_end = ring->rx_pos + frame;
+
+	return 1;
+}
+
+ssize_t esdm_rpcc_uring_read(struct esdm_rpcc_uring *ring, uint8_t *buf,
+			     size_t len)
+{
+	/* Only the current response is handed out */
+	if (ring->rx_frame_end <= ring->rx_pos) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	len = min_size(len, ring->rx_frame_end - ring->rx_pos);
+	memcpy(buf, ring->rx + ring->rx_pos, len);
+	ring->rx_pos += len;
+
+	return (ssize_t)len;
+}
+
+void esdm_rpcc_uring_skip(struct esdm_rpcc_uring *ring)
+{
+	if (ring->rx_frame_end > ring->rx_pos)
+		ring->rx_pos = ring->rx_frame_end;
+}
+
+void esdm_rpcc_uring_drain(struct esdm_rpcc_uring *ring)
+{
+	/*
+	 * The caller shut down the socket which completes the in-flight
+	 * operations right away. The buffers must not be reused before.
+	 */
+	while (ring->send_busy || ring->recv_busy) {
+		if (esdm_rpcc_uring_enter(ring->fd, ring->to_submit, 1,
+					  IORING_ENTER_GETEVENTS) < 0 &&
+		    errno != EINTR) {
+			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+				    "Waiting for io_uring completions failed: %s\n",
+				    strerror(errno));
+			return;
+		}
+		ring->to_submit = 0;
+		esdm_rpcc_uring_reap(ring);
+	}
+
+	memset_secure(ring->tx, 0, ring->tx_len);
+	memset_secure(ring->rx, 0, ring->rx_len);
+	ring->tx_len = 0;
+	ring->rx_len = 0;
+	ring->rx_pos = 0;
+	ring->rx_frame_end = 0;
+	ring->error = 0;
+}
+
+int esdm_rpcc_uring_fd(struct esdm_rpcc_uring *ring)
+{
+	return ring->fd;
+}
+
+int esdm_rpcc_uring_alloc(struct esdm_rpcc_uring **ring)
+{
+	struct io_uring_params p = { 0 };
+	struct esdm_rpcc_uring *r;
+	int ret = 0;
+
+	r = calloc(1, sizeof(*r));
+	CKNULL(r, -ENOMEM);
+	r->fd = -1;
+	r->sq_ptr = MAP_FAILED;
+	r->cq_ptr = MAP_FAILED;
+	r->sqes = MAP_FAILED;
+
+	r->rx_size = ESDM_RPC_MAX_MSG_SIZE + sizeof(struct esdm_rpc_proto_sc);
+	r->rx = malloc(r->rx_size);
+	CKNULL(r->rx, -ENOMEM);
+
+	r->fd = esdm_rpcc_uring_setup(ESDM_RPCC_URING_ENTRIES, &p);
+	if (r->fd < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	/* SEND and RECV are available with the kernels offering fast poll */
+	if (!(p.features & IORING_FEAT_FAST_POLL)) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		r->sq_len = r->cq_len = max_size(r->sq_len, r->cq_len);
+
+	r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ptr = r->sq_ptr;
+	} else {
+		r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_POPULATE, r->fd,
+				 IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED) {
+			ret = -errno;
+			goto out;
+		}
+	}
+
+	r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		ret = -errno;
+		goto out;
+	}
+
+	r->sq_tail = (unsigned int *)((uint8_t *)r->sq_ptr + p.sq_off.tail);
+	r->sq_local = *r->sq_tail;
+	r->sq_mask = (unsigned int *)((uint8_t *)r->sq_ptr + p.sq_off.ring_mask);
+	r->cq_head = (unsigned int *)((uint8_t *)r->cq_ptr + p.cq_off.head);
+	r->cq_tail = (unsigned int *)((uint8_t *)r->cq_ptr + p.cq_off.tail);
+	r->cq_mask = (unsigned int *)((uint8_t *)r->cq_ptr + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)((uint8_t *)r->cq_ptr + p.cq_off.cqes);
+
+	/* Each slot of the submission queue refers to the same entry */
+	{
+		unsigned int *array = (unsigned int *)((uint8_t *)r->sq_ptr +
+						       p.sq_off.array);
+		unsigned int i;
+
+		for (i = 0; i < p.sq_entries; i++)
+			array[i] = i;
+	}
+
+	*ring = r;
+
+out:
+	if (ret) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "io_uring cannot be used: %d\n", ret);
+		esdm_rpcc_uring_free(r);
+	}
+	return ret;
+}
+
+void esdm_rpcc_uring_free(struct esdm_rpcc_uring *ring)
+{
+	if (!ring)
+		return;
+
+	if (ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqes_len);
+	if (ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_len);
+	if (ring->sq_ptr != MAP_FAILED)
+		munmap(ring->sq_ptr, ring->sq_len);
+	if (ring->fd >= 0)
+		close(ring->fd);
+
+	if (ring->rx) {
+		memset_secure(ring->rx, 0, ring->rx_size);
+		free(ring->rx);
+	}
+
+	memset_secure(ring, 0, sizeof(*ring));
+	free(ring);
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include "config.h"
+#include "esdm_rpc_client_helper.h"
+#include "esdm_rpc_client_internal.h"
+#include "esdm_rpc_service.h"
+#include "math_helper.h"
+#include "esdm_logger.h"
+#include "ptr_err.h"
+#include "ret_checkers.h"
+#include "visibility.h"
+
+/*
+ * The server must answer one wait request before the client considers the
+ * request lost and resubmits it. Longer waits are split into requests waiting
+ * at most half of the receive timeout. The server answers a request as soon
+ * as the states are reached, i.e. the split does not add latency.
+ */
+#define ESDM_RPCC_WAIT_SEED_SLICE_MS                                           \
+	((1ULL << ((ESDM_CLIENT_RX_TX_TIMEOUT_EXPONENT) - 1)) / 1000000ULL + 1)
+
+struct esdm_wait_seed_state_buf {
+	int ret;
+	bool answered;
+};
+
+static void
+esdm_rpcc_wait_seed_state_cb(const WaitSeedStateResponse *response,
+			     void *closure_data)
+{
+	struct esdm_wait_seed_state_buf *buffer =
+		(struct esdm_wait_seed_state_buf *)closure_data;
+
+	esdm_rpcc_error_check(response, buffer);
+	buffer->ret = response->ret;
+	buffer->answered = true;
+}
+
+static uint64_t esdm_rpcc_wait_seed_state_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_wait_seed_state_int(uint32_t states, const struct timespec *ts,
+				  void *int_data)
+{
+	WaitSeedStateRequest msg = WAIT_SEED_STATE_REQUEST__INIT;
+	esdm_rpc_client_connection_t *rpc_conn = NULL;
+	struct esdm_wait_seed_state_buf buffer;
+	struct timespec abstime, *abstimep = NULL;
+	uint64_t now, slice, deadline = 0;
+	int ret;
+
+	if (ts) {
+		now = esdm_rpcc_wait_seed_state_now_ns();
+		deadline = now + (uint64_t)ts->tv_sec * 1000000000ULL +
+			   (uint64_t)ts->tv_nsec;
+		abstime.tv_sec = (time_t)(deadline / 1000000000ULL);
+		abstime.tv_nsec = (long)(deadline % 1000000000ULL);
+		abstimep = &abstime;
+	}
+
+	/* Sleep on the status segment of the server if possible */
+	ret = esdm_rpcc_shm_seed_wait(states, abstimep);
+	if (ret != -EOPNOTSUPP)
+		return ret;
+
+	CKINT(esdm_rpcc_get_unpriv_service(&rpc_conn, int_data));
+
+	msg.states = states;
+	for (;;) {
+		slice = ESDM_RPCC_WAIT_SEED_SLICE_MS;
+		if (deadline) {
+			now = esdm_rpcc_wait_seed_state_now_ns();
+			if (now >= deadline) {
+				ret = -ETIMEDOUT;
+				goto out;
+			}
+
+			/* Round up to not return before the deadline */
+			slice = min_uint64(slice,
+					   (deadline - now + 999999) / 1000000);
+		}
+
+		buffer.ret = -ETIMEDOUT;
+		buffer.answered = false;
+		msg.timeout_ms = (uint32_t)slice;
+
+		unpriv_access__rpc_wait_seed_state(&rpc_conn->service, &msg,
+						   esdm_rpcc_wait_seed_state_cb,
+						   &buffer);
+
+		/* Only a wait expired on the server continues the loop */
+		if (!buffer.answered || buffer.ret != -ETIMEDOUT) {
+			ret = buffer.ret;
+			goto out;
+		}
+	}
+
+out:
+	esdm_rpcc_put_unpriv_service(rpc_conn);
+	return ret;
+}
+
+DSO_PUBLIC
+int esdm_rpcc_wait_seed_state(uint32_t states, const struct timespec *ts)
+{
+	return esdm_rpcc_wait_seed_state_int(states, ts, NULL);
+}
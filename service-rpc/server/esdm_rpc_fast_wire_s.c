@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+
+#include "esdm.h"
+#include "esdm_config.h"
+#include "esdm_rpc_protocol.h"
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_service.h"
+#include "helper.h"
+
+/* RPC methods served by the compact wire format methods */
+static const char *const esdm_rpc_fast_wire_methods[] = {
+	[esdm_rpc_fast_get_random_bytes] = "RpcGetRandomBytes",
+	[esdm_rpc_fast_get_random_bytes_full] = "RpcGetRandomBytesFull",
+	[esdm_rpc_fast_is_fully_seeded] = "RpcIsFullySeeded",
+	[esdm_rpc_fast_get_ent_lvl] = "RpcGetEntLvl",
+};
+
+const char *esdm_rpc_fast_wire_method(uint32_t method)
+{
+	if (method >= ARRAY_SIZE(esdm_rpc_fast_wire_methods))
+		return NULL;
+	return esdm_rpc_fast_wire_methods[method];
+}
+
+/* Same semantics as esdm_rpc_get_random_bytes(_full) */
+static int esdm_rpc_fast_wire_random(void *closure_data, uint32_t method,
+				     uint32_t len)
+{
+	uint8_t rndval_s[ESDM_RPC_MAX_DATA], *rndval;
+	size_t maxlen = esdm_rpc_server_max_data(closure_data);
+	ssize_t ret;
+	int err;
+
+	if (len > maxlen)
+		return esdm_rpc_server_send_fast(closure_data,
+						 -(int32_t)maxlen, NULL, 0);
+
+	rndval = esdm_rpc_server_randval_alloc(rndval_s, sizeof(rndval_s),
+					       len);
+	if (!rndval)
+		return esdm_rpc_server_send_fast(closure_data, -ENOMEM, NULL,
+						 0);
+
+	if (method == esdm_rpc_fast_get_random_bytes)
+		ret = esdm_get_random_bytes(rndval, len);
+	else
+		ret = esdm_get_random_bytes_full_noblock(rndval, len);
+
+	if (ret > 0) {
+		esdm_test_shm_status_add_rpc_server_written((size_t)ret);
+		err = esdm_rpc_server_send_fast(closure_data, (int32_t)ret,
+						rndval, (size_t)ret);
+	} else {
+		err = esdm_rpc_server_send_fast(closure_data,
+						ret ? (int32_t)ret : -EFAULT,
+						NULL, 0);
+	}
+
+	esdm_rpc_server_randval_free(rndval, rndval_s, len);
+	return err;
+}
+
+int esdm_rpc_fast_wire(void *closure_data,
+		       const struct esdm_rpc_fast_cs *request)
+{
+	uint32_t method = request->method & ~ESDM_RPC_FAST_MAGIC_MASK;
+	uint32_t flags = request->flags;
+
+	/* The CPU of the client overrides the hint of the connection */
+	if (flags & ESDM_RPC_FAST_FLAG_CPU) {
+		if (esdm_rpc_server_local_peer(closure_data))
+			esdm_config_cpu_hint(flags & ESDM_RPC_FAST_CPU_MASK);
+		flags &= ~(ESDM_RPC_FAST_FLAG_CPU | ESDM_RPC_FAST_CPU_MASK);
+	}
+
+	/* Reserved flags are rejected to allow a later definition */
+	if (flags)
+		return esdm_rpc_server_send_fast(closure_data, -EINVAL, NULL,
+						 0);
+
+	switch (method) {
+	case esdm_rpc_fast_get_random_bytes:
+	case esdm_rpc_fast_get_random_bytes_full:
+		return esdm_rpc_fast_wire_random(closure_data, method,
+						 request->length);
+	case esdm_rpc_fast_is_fully_seeded:
+		return esdm_rpc_server_send_fast(
+			closure_data, esdm_state_fully_seeded() ? 1 : 0, NULL,
+			0);
+	case esdm_rpc_fast_get_ent_lvl:
+		return esdm_rpc_server_send_fast(
+			closure_data, (int32_t)esdm_avail_entropy(), NULL, 0);
+	default:
+		return -EINVAL;
+	}
+}
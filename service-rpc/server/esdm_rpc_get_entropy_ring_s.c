@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_server_ent_ring.h"
+#include "esdm_rpc_service.h"
+#include "esdm_logger.h"
+#include "priv_access.pb-c.h"
+
+void esdm_rpc_get_entropy_ring(PrivAccess_Service *service,
+			       const GetEntropyRingRequest *request,
+			       GetEntropyRingResponse_Closure closure,
+			       void *closure_data)
+{
+	GetEntropyRingResponse response = GET_ENTROPY_RING_RESPONSE__INIT;
+	int fds[2] = { -1, -1 };
+	(void)service;
+
+	if (request == NULL) {
+		response.ret = -EINVAL;
+		closure(&response, closure_data);
+		return;
+	}
+
+	if (!esdm_rpc_client_is_privileged(closure_data)) {
+		response.ret = -EPERM;
+		closure(&response, closure_data);
+		return;
+	}
+
+	response.ret = esdm_rpcs_ent_ring_alloc(request->size, &fds[0], &fds[1],
+						&response.size);
+	if (!response.ret)
+		response.ret = esdm_rpc_server_pass_fds(closure_data, fds, 2);
+
+	if (response.ret) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Entropy ring not provided: %d\n", response.ret);
+		response.size = 0;
+	}
+
+	closure(&response, closure_data);
+
+	/* The client received its own copies of the file descriptors */
+	if (fds[0] >= 0)
+		close(fds[0]);
+	if (fds[1] >= 0)
+		close(fds[1]);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "esdm.h"
+#include "esdm_definitions.h"
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_service.h"
+#include "memset_secure.h"
+#include "unpriv_access.pb-c.h"
+
+void esdm_rpc_get_lease_seed(UnprivAccess_Service *service,
+			     const GetLeaseSeedRequest *request,
+			     GetLeaseSeedResponse_Closure closure,
+			     void *closure_data)
+{
+	GetLeaseSeedResponse response = GET_LEASE_SEED_RESPONSE__INIT;
+	uint8_t seed[ESDM_RPC_LEASE_SEED_MAX_LEN];
+#ifdef ESDM_DRNG_LEASE
+	ssize_t ret;
+#endif
+	(void)service;
+
+	if (request == NULL || request->len < ESDM_RPC_LEASE_SEED_MIN_LEN ||
+	    request->len > sizeof(seed)) {
+		response.ret = -EINVAL;
+		closure(&response, closure_data);
+		return;
+	}
+
+#ifdef ESDM_DRNG_LEASE
+#ifndef ESDM_DRNG_LEASE_UNPRIV
+	if (!esdm_rpc_client_is_privileged(closure_data)) {
+		response.ret = -EPERM;
+		closure(&response, closure_data);
+		return;
+	}
+#endif
+
+	/*
+	 * The seed is only handed out from a fully seeded DRNG. If the ESDM
+	 * is not yet fully seeded, -EAGAIN is returned and the caller has to
+	 * try again.
+	 */
+	ret = esdm_get_random_bytes_full_noblock(seed, request->len);
+	if (ret == (ssize_t)request->len) {
+		esdm_test_shm_status_add_rpc_server_written((size_t)ret);
+		response.seed.data = seed;
+		response.seed.len = request->len;
+
+		/*
+		 * The lease is bounded by the same thresholds which trigger
+		 * a reseed of the ESDM DRNGs.
+		 */
+		response.max_requests = ESDM_DRNG_RESEED_THRESH;
+		response.max_bytes = (ESDM_DRNG_RESEED_THRESH_BITS ==
+				      UINT32_MAX) ?
+					     0 :
+					     (ESDM_DRNG_RESEED_THRESH_BITS >> 3);
+		response.max_secs = esdm_get_reseed_max_time();
+		response.ret = 0;
+	} else {
+		response.ret = (ret < 0) ? (int32_t)ret : -EAGAIN;
+	}
+#else
+	response.ret = -EOPNOTSUPP;
+#endif
+
+	closure(&response, closure_data);
+
+	memset_secure(seed, 0, sizeof(seed));
+}
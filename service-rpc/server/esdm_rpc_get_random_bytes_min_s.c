@@ -17,8 +17,11 @@
  * DAMAGE.
  */
 
+#include <errno.h>
+
 #include "esdm.h"
 #include "esdm_rpc_protocol.h"
+#include "esdm_rpc_server.h"
 #include "esdm_rpc_service.h"
 #include "memset_secure.h"
 #include "unpriv_access.pb-c.h"
@@ -30,13 +33,22 @@ void esdm_rpc_get_random_bytes_min(UnprivAccess_Service *service,
 {
 	GetRandomBytesMinResponse response =
 		GET_RANDOM_BYTES_MIN_RESPONSE__INIT;
-	uint8_t rndval[ESDM_RPC_MAX_DATA];
+	uint8_t rndval_s[ESDM_RPC_MAX_DATA], *rndval;
+	size_t maxlen = esdm_rpc_server_max_data(closure_data);
 	(void)service;
 
-	if (request == NULL || request->len > sizeof(rndval)) {
-		response.ret = -(int32_t)sizeof(rndval);
+	if (request == NULL || request->len > maxlen) {
+		response.ret = -(int32_t)maxlen;
 		closure(&response, closure_data);
 	} else {
+		rndval = esdm_rpc_server_randval_alloc(
+			rndval_s, sizeof(rndval_s), request->len);
+		if (!rndval) {
+			response.ret = -ENOMEM;
+			closure(&response, closure_data);
+			return;
+		}
+
 		response.ret = (int)esdm_get_random_bytes_min_noblock(
 			rndval, request->len);
 
@@ -46,8 +58,14 @@ void esdm_rpc_get_random_bytes_min(UnprivAccess_Service *service,
 			response.randval.data = rndval;
 			response.randval.len = (size_t)response.ret;
 		}
-		closure(&response, closure_data);
 
-		memset_secure(rndval, 0, sizeof(rndval));
+		/* Send the random bytes without copying them again */
+		if (response.ret <= 0 ||
+		    esdm_rpc_server_send_randval(closure_data, rndval,
+						 (size_t)response.ret) ==
+			    -EOPNOTSUPP)
+			closure(&response, closure_data);
+
+		esdm_rpc_server_randval_free(rndval, rndval_s, request->len);
 	}
 }
@@ -23,6 +23,7 @@
 #include "esdm.h"
 #include "esdm_rpc_protocol.h"
 #include "esdm_rpc_server.h"
+#include "esdm_rpc_server_throttle.h"
 #include "esdm_rpc_service.h"
 #include "helper.h"
 #include "esdm_logger.h"
@@ -42,6 +43,10 @@ void esdm_rpc_get_random_bytes_pr(UnprivAccess_Service *service,
 	if (request == NULL || request->len > sizeof(rndval)) {
 		response.ret = -(int32_t)sizeof(rndval);
 		closure(&response, closure_data);
+	} else if (esdm_rpcs_throttle(closure_data, request->len)) {
+		/* The client retries after its poll interval */
+		response.ret = -EAGAIN;
+		closure(&response, closure_data);
 	} else {
 		response.ret =
 			(int)esdm_get_random_bytes_pr(rndval, request->len);
@@ -52,8 +57,14 @@ void esdm_rpc_get_random_bytes_pr(UnprivAccess_Service *service,
 			response.randval.data = rndval;
 			response.randval.len = (size_t)response.ret;
 		}
-		closure(&response, closure_data);
 
-		memset_secure(rndval, 0, sizeof(rndval));
+		/* Send the random bytes without copying them again */
+		if (response.ret <= 0 ||
+		    esdm_rpc_server_send_randval(closure_data, rndval,
+						 (size_t)response.ret) ==
+			    -EOPNOTSUPP)
+			closure(&response, closure_data);
+
+		memset_secure(rndval, 0, request->len);
 	}
 }
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+
+#include "esdm.h"
+#include "esdm_rpc_protocol.h"
+#include "esdm_rpc_server_throttle.h"
+#include "esdm_rpc_service.h"
+#include "memset_secure.h"
+#include "unpriv_access.pb-c.h"
+
+void esdm_rpc_get_random_bytes_vec(UnprivAccess_Service *service,
+				   const GetRandomBytesVecRequest *request,
+				   GetRandomBytesVecResponse_Closure closure,
+				   void *closure_data)
+{
+	GetRandomBytesVecResponse response = GET_RANDOM_BYTES_VEC_RESPONSE__INIT;
+	ProtobufCBinaryData randval[ESDM_RPC_VEC_MAX];
+	struct esdm_rnd_vec vec[ESDM_RPC_VEC_MAX];
+	uint8_t rndval[ESDM_RPC_VEC_MAX_DATA];
+	size_t i, total = 0, pr = 0;
+	(void)service;
+
+	if (request == NULL || !request->n_len ||
+	    request->n_len > ESDM_RPC_VEC_MAX ||
+	    request->n_len != request->n_flags) {
+		response.ret = -EINVAL;
+		closure(&response, closure_data);
+		return;
+	}
+
+	for (i = 0; i < request->n_len; i++) {
+		if (request->len[i] > sizeof(rndval) - total) {
+			response.ret = -EINVAL;
+			closure(&response, closure_data);
+			return;
+		}
+
+		vec[i].buf = rndval + total;
+		vec[i].len = request->len[i];
+		vec[i].flags = (enum esdm_rnd_vec_flags)request->flags[i];
+		total += request->len[i];
+		if (vec[i].flags == ESDM_RND_VEC_PR)
+			pr += request->len[i];
+	}
+
+	/* Only the entries served by the PR DRNG are throttled */
+	if (pr && esdm_rpcs_throttle(closure_data, pr)) {
+		response.ret = -EAGAIN;
+		closure(&response, closure_data);
+		return;
+	}
+
+	response.ret = esdm_get_random_bytes_vec_noblock(vec, request->n_len);
+
+	if (response.ret >= 0) {
+		esdm_test_shm_status_add_rpc_server_written(
+			(size_t)response.ret);
+
+		for (i = 0; i < request->n_len; i++) {
+			randval[i].data = vec[i].buf;
+			randval[i].len = vec[i].generated;
+		}
+		response.randval = randval;
+		response.n_randval = request->n_len;
+	}
+	closure(&response, closure_data);
+
+	memset_secure(rndval, 0, total);
+}
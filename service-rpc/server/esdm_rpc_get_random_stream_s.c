@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_service.h"
+#include "unpriv_access.pb-c.h"
+
+void esdm_rpc_get_random_stream(UnprivAccess_Service *service,
+				const GetRandomStreamRequest *request,
+				GetRandomStreamResponse_Closure closure,
+				void *closure_data)
+{
+	GetRandomStreamResponse response = GET_RANDOM_STREAM_RESPONSE__INIT;
+	(void)service;
+
+	if (request == NULL) {
+		response.ret = -EINVAL;
+		closure(&response, closure_data);
+		return;
+	}
+
+	/*
+	 * The frames of the stream are sent by the connection handler after
+	 * this function returned.
+	 */
+	response.ret = esdm_rpc_server_stream_start(
+		closure_data, request->len, request->frame_size);
+	if (response.ret < 0)
+		closure(&response, closure_data);
+}
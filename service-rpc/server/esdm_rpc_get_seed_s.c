@@ -23,13 +23,75 @@
 #include "esdm.h"
 #include "esdm_rpc_protocol.h"
 #include "esdm_rpc_server.h"
+#include "esdm_rpc_server_throttle.h"
 #include "esdm_rpc_service.h"
 #include "helper.h"
+#include "math_helper.h"
 #include "esdm_logger.h"
 #include "memset_secure.h"
 #include "threading_support.h"
 #include "unpriv_access.pb-c.h"
 
+/*
+ * A batch of seed blocks is returned with the blocks placed at the size of
+ * one seed instead of the buffer size of the caller. The size is reported by
+ * esdm_get_seed for a buffer of one word.
+ */
+static size_t esdm_rpc_get_seed_stride(const GetSeedRequest *request)
+{
+	uint64_t seedlen;
+
+	if (esdm_get_seed(&seedlen, sizeof(seedlen), 0) != -EMSGSIZE ||
+	    request->len < seedlen)
+		return (size_t)request->len;
+
+	return (size_t)((seedlen + sizeof(uint64_t) - 1) &
+			~(uint64_t)(sizeof(uint64_t) - 1));
+}
+
+static void esdm_rpc_get_seed_blocks(const GetSeedRequest *request,
+				     uint64_t *rndval, size_t rndvallen,
+				     GetSeedResponse_Closure closure,
+				     void *closure_data)
+{
+	GetSeedResponse response = GET_SEED_RESPONSE__INIT;
+	size_t stride = esdm_rpc_get_seed_stride(request), num = 1;
+	ssize_t ret;
+
+	/* Only aligned blocks can be batched, otherwise one block is sent */
+	if (stride >= sizeof(uint64_t) && !(stride % sizeof(uint64_t)))
+		num = max_size(min_size(request->num, rndvallen / stride), 1);
+
+	if (esdm_rpcs_throttle(closure_data, num * stride)) {
+		/* A blocking client retries after its poll interval */
+		response.ret = -EAGAIN;
+		closure(&response, closure_data);
+		return;
+	}
+
+	memset(rndval, 0, num * stride);
+	ret = esdm_get_seed_blocks(rndval, stride, num,
+				   request->flags | ESDM_GET_SEED_NONBLOCK);
+	if (ret > 0) {
+		esdm_test_shm_status_add_rpc_server_written((size_t)ret *
+							    rndval[0]);
+		response.ret = (int64_t)rndval[0];
+		response.num = (uint32_t)ret;
+		response.randval.data = (uint8_t *)rndval;
+		response.randval.len = (size_t)ret * stride;
+	} else if (ret == -EMSGSIZE) {
+		response.ret = ret;
+		response.randval.data = (uint8_t *)rndval;
+		response.randval.len = sizeof(uint64_t);
+	} else {
+		response.ret = ret;
+	}
+
+	closure(&response, closure_data);
+
+	memset_secure(rndval, 0, num * stride);
+}
+
 void esdm_rpc_get_seed(UnprivAccess_Service *service,
 		       const GetSeedRequest *request,
 		       GetSeedResponse_Closure closure, void *closure_data)
@@ -41,6 +103,13 @@ void esdm_rpc_get_seed(UnprivAccess_Service *service,
 	if (request == NULL || request->len > sizeof(rndval)) {
 		response.ret = -(int32_t)sizeof(rndval);
 		closure(&response, closure_data);
+	} else if (request->num > 1) {
+		esdm_rpc_get_seed_blocks(request, rndval, sizeof(rndval),
+					 closure, closure_data);
+	} else if (esdm_rpcs_throttle(closure_data, request->len)) {
+		/* A blocking client retries after its poll interval */
+		response.ret = -EAGAIN;
+		closure(&response, closure_data);
 	} else {
 		/* TODO: make 280 dependent on output size */
 		memset(rndval, 0, 280);
@@ -59,6 +128,7 @@ void esdm_rpc_get_seed(UnprivAccess_Service *service,
 
 		closure(&response, closure_data);
 
-		memset_secure(rndval, 0, sizeof(rndval));
+		/* esdm_get_seed only writes into the requested length */
+		memset_secure(rndval, 0, request->len);
 	}
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+
+#include "config.h"
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_service.h"
+#include "math_helper.h"
+#include "unpriv_access.pb-c.h"
+
+/* The tiny footprint server keeps every response within the default size */
+#ifdef ESDM_TINY_FOOTPRINT
+#define ESDM_RPCS_MAX_NEGOTIATED_MSG_SIZE ESDM_RPC_MAX_MSG_SIZE
+#else
+#define ESDM_RPCS_MAX_NEGOTIATED_MSG_SIZE ESDM_RPC_MAX_NEGOTIATED_MSG_SIZE
+#endif
+
+void esdm_rpc_negotiate(UnprivAccess_Service *service,
+			const NegotiateRequest *request,
+			NegotiateResponse_Closure closure, void *closure_data)
+{
+	NegotiateResponse response = NEGOTIATE_RESPONSE__INIT;
+	uint32_t size;
+	(void)service;
+
+	if (request == NULL || !request->version) {
+		response.ret = -EINVAL;
+		closure(&response, closure_data);
+		return;
+	}
+
+	/* The default message size is always applicable */
+	size = min_uint32(request->max_msg_size,
+			  ESDM_RPCS_MAX_NEGOTIATED_MSG_SIZE);
+	if (size < ESDM_RPC_MAX_MSG_SIZE)
+		size = ESDM_RPC_MAX_MSG_SIZE;
+
+	response.ret = esdm_rpc_server_set_max_msg_size(closure_data, size);
+	response.version =
+		min_uint32(request->version, ESDM_RPC_PROTO_VERSION);
+	response.max_msg_size = size;
+
+	/* A hint the server cannot use is ignored */
+	if (response.version >= ESDM_RPC_PROTO_VERSION_CPU_HINT &&
+	    request->cpu)
+		esdm_rpc_server_set_cpu_hint(closure_data, request->cpu - 1);
+
+	/* Only report the compact wire format if it can be used */
+	if (response.version >= ESDM_RPC_PROTO_VERSION_FAST_WIRE &&
+	    esdm_rpc_server_set_fast_wire(closure_data))
+		response.version = ESDM_RPC_PROTO_VERSION_FAST_WIRE - 1;
+
+	closure(&response, closure_data);
+}
@@ -20,54 +20,214 @@
 #define _GNU_SOURCE
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <protobuf-c/protobuf-c.h>
+#include <pthread.h>
 #include <semaphore.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/shm.h>
-#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "atomic.h"
+#include "atomic_64.h"
 #include "conv_be_le.h"
 #include "config.h"
 #include "esdm.h"
 #include "esdm_config.h"
+#include "esdm_cpu_class.h"
+#include "esdm_definitions.h"
+#include "esdm_probes.h"
 #include "esdm_rpc_protocol.h"
 #include "esdm_rpc_protocol_helper.h"
 #include "esdm_rpc_server.h"
+#include "esdm_rpc_server_ent_ring.h"
+#include "esdm_rpc_server_handover.h"
+#include "esdm_rpc_server_kdev.h"
 #include "esdm_rpc_server_linux.h"
+#include "esdm_rpc_server_metrics.h"
+#include "esdm_rpc_server_reload.h"
+#include "esdm_rpc_server_ring.h"
+#include "esdm_rpc_server_throttle.h"
 #include "esdm_rpc_service.h"
+#include "esdm_seed_file.h"
+#include "esdm_shm_status.h"
+#include "esdm_startup.h"
 #include "helper.h"
+#include "hotpath_audit.h"
+#include "latency_hist.h"
 #include "linux_support.h"
+#include "lock_stats.h"
 #include "esdm_logger.h"
+#include "math_helper.h"
 #include "memset_secure.h"
+#include "metrics.h"
+#include "mutex_w.h"
 #include "privileges.h"
 #include "ret_checkers.h"
 #include "queue.h"
+#include "secure_memory.h"
 #include "threading_support.h"
 
+#ifdef ESDM_LINUX
+/* The single-threaded server has no thread serving parked connections */
+#ifndef ESDM_TINY_FOOTPRINT
+#define ESDM_RPCS_PARKING
+#endif
+#define ESDM_RPCS_BATCH_IO
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+/* The worker loop waits for the exit event besides incoming connections */
+#if !defined(ESDM_WORKERLOOP_TERM_ON_SIGNAL) && !defined(ESDM_TINY_FOOTPRINT)
+#define ESDM_RPCS_EXIT_EVENT
+#endif
+
+#if defined(ESDM_LINUX) &&                                                     \
+	((ESDM_RPCS_REACTOR_THREADS > 0) || defined(ESDM_TINY_FOOTPRINT))
+#define ESDM_RPCS_REACTOR
+#endif
+
+#if defined(ESDM_LINUX) && (ESDM_RPC_VSOCK_PORT > 0)
+#define ESDM_RPCS_VSOCK
+#include <linux/vm_sockets.h>
+#endif
+
 struct esdm_rpcs {
 	ProtobufCService *service;
 	int server_listening_fd;
+	/* Listening socket was passed by the service manager */
+	bool activated;
+	/* Only connections of privileged users are accepted */
+	bool privileged_only;
+	/* Peers are not on the local system, e.g. virtual machine guests */
+	bool remote;
 };
 
+/* Maximum number of file descriptors passed with one response */
+#define ESDM_RPCS_PASS_FDS_MAX 2
+
+/* Size of a buffer receiving one request */
+#define ESDM_RPCS_RX_BUF_SIZE                                                  \
+	(ESDM_RPC_MAX_MSG_SIZE + sizeof(struct esdm_rpc_proto_cs))
+
+struct esdm_rpcs_batch;
+struct esdm_rpcs_tx;
+
 struct esdm_rpcs_connection {
 	struct esdm_rpcs *proto;
 	int child_fd;
 	ProtobufCAllocator *rpc_allocator;
 	uint32_t method_index;
 	uint32_t request_id;
+	/* Negotiated maximum response message size, 0 for the default */
+	uint32_t max_msg_size;
+	/* Requests in the compact wire format are accepted */
+	bool fast_wire;
+	/* CPU of the client plus one, 0 if unknown */
+	uint32_t cpu_hint;
+	/* Random byte stream pushed after the request was processed */
+	uint64_t stream_remaining;
+	uint32_t stream_frame_size;
+	bool stream_active;
+	bool stream_unbounded;
+	/* File descriptors passed with the next response */
+	int pass_fds[ESDM_RPCS_PASS_FDS_MAX];
+	unsigned int num_pass_fds;
+	/* Latency accounting of the current request */
+	uint64_t lat_send;
+	uint64_t lat_closure;
+	/* The connection sent a request other than a status query */
+	bool bulk;
+#ifdef ESDM_RPCS_BATCH_IO
+	/* Every request arrived in one record, receive several at once */
+	bool batch_rx;
+	/* A request spanning several records was received */
+	bool batch_off;
+	/* Batch of the thread while a batch of requests is processed */
+	struct esdm_rpcs_batch *batch;
+#endif
+#if defined(ESDM_RPCS_PARKING) || defined(ESDM_RPCS_REACTOR)
+	/* Reactor or parking list and idle tracking */
+	struct esdm_rpcs_connection *prev, *next;
+	time_t last_activity;
+#endif
+	/* The handler thread may park the request until the ESDM is seeded */
+	bool seed_wait_allowed;
+	/* The request waits for the seeding or is resumed after it */
+	bool seed_wait_pending;
+	bool seed_wait_resume;
+	/* ESDM_SHM_SEED_* flags the request waits for */
+	uint32_t seed_wait_states;
+	uint64_t seed_wait_len;
+	uint64_t seed_wait_deadline_ns;
+#ifdef ESDM_RPCS_REACTOR
+	/* The connection is served by a reactor with a non-blocking socket */
+	bool nonblock;
+	/* The reactor waits for space in the socket instead of requests */
+	bool epoll_out;
+	/* Request received so far and its size once the header is received */
+	size_t rx_len;
+	size_t rx_fetch;
+	uint64_t rx_lat_start;
+	bool rx_fast;
+#ifdef ESDM_TINY_FOOTPRINT
+	/* Buffer holding a partially received request */
+	uint8_t *rx_partial;
+#endif
+	/* Response frames not yet accepted by the socket */
+	struct esdm_rpcs_tx *tx_head, *tx_tail;
+#endif
+
+	/*
+	 * Members below are retained when a connection object is recycled:
+	 * the freelist link of the connection pool and the buffer used by
+	 * esdm_rpcs_read which is cleared after each request.
+	 */
+	uint32_t pool_next;
+#ifndef ESDM_TINY_FOOTPRINT
+	uint8_t rx_buf[ESDM_RPCS_RX_BUF_SIZE] __aligned(sizeof(uint64_t));
+#endif
 };
 
+#ifdef ESDM_TINY_FOOTPRINT
+/*
+ * The only thread of the server processes one request after another. Only a
+ * request which is not received with one read obtains a buffer of its own.
+ */
+static uint8_t esdm_rpcs_rx_buf[ESDM_RPCS_RX_BUF_SIZE]
+	__aligned(sizeof(uint64_t));
+
+static inline uint8_t *
+esdm_rpcs_conn_rx_buf(struct esdm_rpcs_connection *rpc_conn)
+{
+#ifdef ESDM_RPCS_REACTOR
+	if (rpc_conn->rx_partial)
+		return rpc_conn->rx_partial;
+#else
+	(void)rpc_conn;
+#endif
+	return esdm_rpcs_rx_buf;
+}
+#else
+static inline uint8_t *
+esdm_rpcs_conn_rx_buf(struct esdm_rpcs_connection *rpc_conn)
+{
+	return rpc_conn->rx_buf;
+}
+#endif
+
 struct esdm_rpcs_write_buf {
 	ProtobufCBuffer base;
 	struct esdm_rpcs_connection *rpc_conn;
@@ -87,473 +247,3558 @@ static DECLARE_WAIT_QUEUE(esdm_rpc_thread_init_wait);
 static pid_t server_pid = -1;
 static atomic_t server_exit = ATOMIC_INIT(0);
 
-/* Remove a potentially left-over old Unix Domain socket. */
-static void esdm_rpcs_stale_socket(const char *path, struct sockaddr *addr,
-				   unsigned addr_len)
+/* Names of the Unix domain sockets, a shard appends its number */
+static char esdm_rpcs_unpriv_socket[FILENAME_MAX];
+static char esdm_rpcs_priv_socket[FILENAME_MAX];
+
+static void esdm_rpcs_socket_names_init(void)
 {
-	struct stat statbuf;
-	int fd;
+	if (esdm_config_shards()) {
+		esdm_rpc_shard_socket(esdm_rpcs_unpriv_socket,
+				      sizeof(esdm_rpcs_unpriv_socket),
+				      ESDM_RPC_UNPRIV_SOCKET,
+				      esdm_config_shard());
+		esdm_rpc_shard_socket(esdm_rpcs_priv_socket,
+				      sizeof(esdm_rpcs_priv_socket),
+				      ESDM_RPC_PRIV_SOCKET, esdm_config_shard());
+		return;
+	}
 
-	if (stat(path, &statbuf) < 0)
+	snprintf(esdm_rpcs_unpriv_socket, sizeof(esdm_rpcs_unpriv_socket),
+		 "%s", ESDM_RPC_UNPRIV_SOCKET);
+	snprintf(esdm_rpcs_priv_socket, sizeof(esdm_rpcs_priv_socket), "%s",
+		 ESDM_RPC_PRIV_SOCKET);
+}
+
+/*
+ * Socket activation: the service manager passes the listening sockets as
+ * file descriptors starting with 3, see sd_listen_fds(3). The sockets are
+ * matched with the RPC interfaces by their addresses.
+ */
+#define ESDM_RPCS_LISTEN_FDS_START 3
+#define ESDM_RPCS_LISTEN_FDS_MAX 16
+static int esdm_rpcs_listen_fds = 0;
+
+/* Obtain the number of sockets passed by the service manager */
+static void esdm_rpcs_listen_fds_init(void)
+{
+	const char *env = getenv("LISTEN_PID");
+	unsigned long val;
+	char *end;
+
+	if (!env)
 		return;
-	if (!S_ISSOCK(statbuf.st_mode))
+	val = strtoul(env, &end, 10);
+	if (*end || (pid_t)val != getpid())
 		return;
 
-	fd = socket(PF_UNIX, SOCK_SEQPACKET, 0);
-	if (fd < 0)
+	env = getenv("LISTEN_FDS");
+	if (!env)
 		return;
-	set_fd_nonblocking(fd);
-	if (connect(fd, addr, addr_len) < 0) {
-		if (errno == EINPROGRESS) {
-			close(fd);
-			return;
-		}
-	} else {
-		close(fd);
+	val = strtoul(env, &end, 10);
+	if (*end || !val || val > ESDM_RPCS_LISTEN_FDS_MAX)
 		return;
-	}
 
-	/* ok, we should delete the stale socket */
-	close(fd);
-	unlink(path);
+	esdm_rpcs_listen_fds = (int)val;
+
+	/* The sockets are not meant for any child process */
+	unsetenv("LISTEN_PID");
+	unsetenv("LISTEN_FDS");
+	unsetenv("LISTEN_FDNAMES");
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Service manager passed %d sockets\n", esdm_rpcs_listen_fds);
 }
 
-/* Write data into an RPC connection. */
-static int esdm_rpcs_write_data(struct esdm_rpcs_connection *rpc_conn,
-				const uint8_t *data, size_t len)
+/* Is the passed socket the listening socket for the interface? */
+static bool esdm_rpcs_listen_fd_match(int fd, const char *name,
+				      const struct sockaddr_un *expected)
 {
-	size_t written = 0;
-	ssize_t ret;
-
-	if (rpc_conn->child_fd < 0)
-		return -EINVAL;
+	struct sockaddr_un addr;
+	socklen_t addr_len;
+	int type;
+
+	memset(&addr, 0, sizeof(addr));
+	addr_len = sizeof(addr);
+	if (getsockname(fd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+	    addr.sun_family != AF_UNIX)
+		return false;
 
-	do {
-		ret = write(rpc_conn->child_fd, data, len);
-		if (ret < 0) {
-			int errsv = errno;
+	/* Both addresses are zero-padded */
+	if (memcmp(addr.sun_path, expected->sun_path, sizeof(addr.sun_path)))
+		return false;
 
-			esdm_logger(
-				LOGGER_VERBOSE, LOGGER_C_RPC,
-				"Writting of data to file descriptor %d failed: %s\n",
-				rpc_conn->child_fd, strerror(errsv));
+	addr_len = sizeof(type);
+	if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &addr_len) < 0 ||
+	    type != SOCK_SEQPACKET) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Passed socket for %s is no sequential packet socket\n",
+			    name);
+		return false;
+	}
 
-			if (errsv == EPIPE) {
-				close(rpc_conn->child_fd);
-				rpc_conn->child_fd = -1;
-			}
+	return true;
+}
 
-			return -errsv;
-		}
+/* Return the socket passed by the service manager or -1 if none */
+static int esdm_rpcs_activated_fd(const char *name)
+{
+	struct sockaddr_un expected;
+	int fd;
 
-		written += (size_t)ret;
-	} while (written < len);
+	esdm_rpc_unix_addr(&expected, name);
 
-	esdm_logger(LOGGER_DEBUG2, LOGGER_C_ANY, "%zu bytes written\n", len);
+	for (fd = ESDM_RPCS_LISTEN_FDS_START;
+	     fd < ESDM_RPCS_LISTEN_FDS_START + esdm_rpcs_listen_fds; fd++) {
+		if (esdm_rpcs_listen_fd_match(fd, name, &expected))
+			return fd;
+	}
 
-	return 0;
+	return -1;
 }
 
-#ifdef ESDM_RPCS_BUF_WRITE
-
 /*
- * Implementation of packing data and sending it out. Properties:
- *
- * - one call to write data out to the file descriptor
- *
- * - one more copy of entire data required to linearize all data
+ * Return the listening socket passed by the service manager or handed over
+ * by the previous server for the interface or -1 if none
  */
-static int esdm_rpcs_pack_internal(const ProtobufCMessage *message,
-				   struct esdm_rpcs_connection *rpc_conn)
+static int esdm_rpcs_listen_fd(const char *name)
 {
-#define ESDM_RPCS_BUF_WRITE_HEADER_SZ (sizeof(struct esdm_rpc_proto_sc_header))
+	struct sockaddr_un expected;
+	unsigned int i;
+	int fd = esdm_rpcs_activated_fd(name);
 
-	size_t message_length;
-	int ret;
-	uint8_t *data_buf_alloc = NULL;
-	uint8_t *data_buf;
-	struct esdm_rpc_proto_sc_header *sc_header;
-	struct esdm_rpc_write_data_buf tmp = {
-		.dst_written = 0,
-	};
+	if (fd >= 0)
+		return fd;
 
-	tmp.base.append = esdm_rpc_append_data;
+	esdm_rpc_unix_addr(&expected, name);
 
-	message_length = protobuf_c_message_get_packed_size(message);
-	if (message_length > ESDM_RPC_MAX_MSG_SIZE) {
-		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
-			    "Unexpected message length: %zu\n", message_length);
-		return -EFAULT;
+	for (i = 0; (fd = esdm_rpcs_handover_fd(i)) >= 0; i++) {
+		if (esdm_rpcs_listen_fd_match(fd, name, &expected))
+			return fd;
 	}
 
-	data_buf_alloc = malloc(ESDM_RPCS_BUF_WRITE_HEADER_SZ + message_length +
-				sizeof(uint64_t) - 1);
-	CKNULL(data_buf_alloc, -ENOMEM);
+	return -1;
+}
 
-	data_buf = ALIGN_PTR_8(data_buf_alloc, sizeof(uint64_t));
-	tmp.dst_buf = (data_buf + ESDM_RPCS_BUF_WRITE_HEADER_SZ);
+#ifndef ESDM_RPC_ABSTRACT_SOCKET
+/* Does a server accept connections on the Unix Domain socket? */
+static bool esdm_rpcs_socket_in_use(struct sockaddr *addr, unsigned addr_len)
+{
+	bool in_use = true;
+	int fd;
 
-	sc_header = (struct esdm_rpc_proto_sc_header *)data_buf;
-	sc_header->status_code = le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_SUCCESS);
-	sc_header->method_index = le_bswap32(rpc_conn->method_index);
-	sc_header->message_length = le_bswap32(message_length);
-	sc_header->request_id = le_bswap32(rpc_conn->request_id);
+	fd = socket(PF_UNIX, SOCK_SEQPACKET, 0);
+	if (fd < 0)
+		return true;
+	set_fd_nonblocking(fd);
+	if (connect(fd, addr, addr_len) < 0 && errno != EINPROGRESS &&
+	    errno != EAGAIN)
+		in_use = false;
+	close(fd);
 
-	esdm_logger(
-		LOGGER_DEBUG, LOGGER_C_RPC,
-		"Server sending: server status %u, message length %u, message index %u, request ID %u\n",
-		sc_header->status_code, sc_header->message_length,
-		sc_header->method_index, sc_header->request_id);
+	return in_use;
+}
 
-	if (protobuf_c_message_pack_to_buffer(message, &tmp.base) !=
-	    message_length) {
-		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
-			    "Short write of data to file descriptor\n");
-		ret = -EFAULT;
-		goto out;
-	}
+/* Remove a potentially left-over old Unix Domain socket. */
+static void esdm_rpcs_stale_socket(const char *path, struct sockaddr *addr,
+				   unsigned addr_len)
+{
+	struct stat statbuf;
 
-	CKINT_LOG(esdm_rpcs_write_data(rpc_conn, data_buf,
-				       ESDM_RPCS_BUF_WRITE_HEADER_SZ +
-					       message_length),
-		  "Submission of message data failed with error %d\n", ret);
+	if (stat(path, &statbuf) < 0)
+		return;
+	if (!S_ISSOCK(statbuf.st_mode))
+		return;
 
-out:
-	/*
-	 * Zeroization not needed, as data will go out through unprotected
-	 * channel anyway. If the data is not already protected, there is a
-	 * bigger problem.
-	 */
-	if (data_buf_alloc)
-		free(data_buf_alloc);
-	return ret;
+	if (esdm_rpcs_socket_in_use(addr, addr_len))
+		return;
+
+	/* ok, we should delete the stale socket */
+	unlink(path);
 }
+#endif
 
-#else /* ESDM_RPCS_BUF_WRITE */
 
-/* Write out data from a ProtobufC buffer. */
-static void esdm_rpcs_append_data(ProtobufCBuffer *buffer, size_t len,
-				  const uint8_t *data)
+/* Send one frame together with file descriptors. */
+static ssize_t esdm_rpcs_sendmsg_fds(int fd, const uint8_t *data, size_t len,
+				     const int *fds, unsigned int num)
 {
-	struct esdm_rpcs_write_buf *buf = (struct esdm_rpcs_write_buf *)buffer;
-	int ret = esdm_rpcs_write_data(buf->rpc_conn, data, len);
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * ESDM_RPCS_PASS_FDS_MAX)];
+		struct cmsghdr align;
+	} control;
+	struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+	struct msghdr msg = { 0 };
+	struct cmsghdr *cmsg;
+	size_t fdlen = sizeof(int) * num;
+
+	memset(&control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = CMSG_SPACE(fdlen);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(fdlen);
+	memcpy(CMSG_DATA(cmsg), fds, fdlen);
+
+	return sendmsg(fd, &msg, 0);
+}
 
-	if (ret < 0)
-		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
-			    "Submission of payload data failed with error %d\n",
-			    ret);
+/* Write data together with the pending file descriptors to pass. */
+static ssize_t esdm_rpcs_write_fds(struct esdm_rpcs_connection *rpc_conn,
+				   const uint8_t *data, size_t len)
+{
+	ssize_t ret = esdm_rpcs_sendmsg_fds(rpc_conn->child_fd, data, len,
+					    rpc_conn->pass_fds,
+					    rpc_conn->num_pass_fds);
+
+	/* The file descriptors are only sent once */
+	if (ret >= 0)
+		rpc_conn->num_pass_fds = 0;
+
+	return ret;
 }
 
+#ifdef ESDM_RPCS_BATCH_IO
+
 /*
- * Implementation of packing data and sending it out. Properties:
- *
- * - multiple calls to write data out to the file descriptor
+ * Batched I/O for pipelining clients: the requests queued in the socket are
+ * received with one recvmmsg call. The responses to them are collected in the
+ * batch of the thread and sent with one sendmmsg call once all requests are
+ * processed. A response which does not fit into a slot, passes file
+ * descriptors or belongs to a request whose handler may block is sent
+ * directly after all collected responses.
  *
- * - no additional memory required
+ * Only connections whose requests arrived in exactly one record so far are
+ * received in batches as each record of a batch must hold one request.
+ * MSG_ZEROCOPY is not supported for Unix domain and vsock sockets, large
+ * responses are already sent from the buffer of the caller.
  */
-static int esdm_rpcs_pack_internal(const ProtobufCMessage *message,
-				   struct esdm_rpcs_connection *rpc_conn)
-{
-	struct esdm_rpc_proto_sc_header sc_header;
-	struct esdm_rpcs_write_buf tmp = { 0 };
-	size_t message_length;
-	int ret;
+#define ESDM_RPCS_BATCH_MAX 8
+#define ESDM_RPCS_BATCH_TX_SLOT 4096
 
-	message_length = protobuf_c_message_get_packed_size(message);
-	tmp.base.append = esdm_rpcs_append_data;
-	tmp.rpc_conn = rpc_conn;
-
-	sc_header.status_code = le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_SUCCESS);
-	sc_header.method_index = le_bswap32(rpc_conn->method_index);
-	sc_header.message_length = le_bswap32(message_length);
-	sc_header.request_id = le_bswap32(rpc_conn->request_id);
+struct esdm_rpcs_batch {
+	struct mmsghdr msgs[ESDM_RPCS_BATCH_MAX];
+	struct iovec iov[ESDM_RPCS_BATCH_MAX];
 
-	esdm_logger(
-		LOGGER_DEBUG, LOGGER_C_RPC,
-		"Server sending: server status %u, message length %u, message index %u, request ID %u\n",
-		sc_header.status_code, sc_header.message_length,
-		sc_header.method_index, sc_header.request_id);
+	/* Requests received together with the first one */
+	size_t rx_len[ESDM_RPCS_BATCH_MAX - 1];
+	unsigned int rx_num;
+	bool rx_trunc;
 
-	CKINT_LOG(esdm_rpcs_write_data(rpc_conn, (uint8_t *)&sc_header,
-				       sizeof(sc_header)),
-		  "Submission of header data failed with error %d\n", ret);
+	/* Collected responses */
+	size_t tx_len[ESDM_RPCS_BATCH_MAX];
+	unsigned int tx_num;
 
-	if (protobuf_c_message_pack_to_buffer(message, &tmp.base) !=
-	    message_length) {
-		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
-			    "Short write of data to file descriptor\n");
-		ret = -EFAULT;
-	}
+	uint8_t rx[ESDM_RPCS_BATCH_MAX - 1][ESDM_RPCS_RX_BUF_SIZE]
+		__aligned(sizeof(uint64_t));
+	uint8_t tx[ESDM_RPCS_BATCH_MAX][ESDM_RPCS_BATCH_TX_SLOT];
+};
 
-out:
-	return ret;
-}
+static atomic_t esdm_rpcs_batch_rx = ATOMIC_INIT(0);
+static atomic_t esdm_rpcs_batch_tx = ATOMIC_INIT(0);
 
-#endif /* ESDM_RPCS_BUF_WRITE */
+static __thread struct esdm_rpcs_batch *esdm_rpcs_batch_thread = NULL;
+static pthread_key_t esdm_rpcs_batch_key;
+static pthread_once_t esdm_rpcs_batch_once = PTHREAD_ONCE_INIT;
+static int esdm_rpcs_batch_key_ret = 0;
 
-/* Pack the message into a ProtobufC structure and write it to the receiver. */
-static int esdm_rpcs_pack(const ProtobufCMessage *message,
-			  struct esdm_rpcs_connection *rpc_conn)
+/* The slots are cleared after each use */
+static void esdm_rpcs_batch_destructor(void *data)
 {
-	struct esdm_rpc_proto_sc_header sc_header;
-
-	if (!protobuf_c_message_check(message)) {
-		sc_header.status_code =
-			le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_SERVICE_FAILED);
-		sc_header.method_index = le_bswap32(rpc_conn->method_index);
-		sc_header.message_length = 0;
-		sc_header.request_id = le_bswap32(rpc_conn->request_id);
-		return esdm_rpcs_write_data(rpc_conn, (uint8_t *)&sc_header,
-					    sizeof(sc_header));
-	}
+	free(data);
+}
 
-	return esdm_rpcs_pack_internal(message, rpc_conn);
+static void esdm_rpcs_batch_key_init(void)
+{
+	esdm_rpcs_batch_key_ret = -pthread_key_create(
+		&esdm_rpcs_batch_key, esdm_rpcs_batch_destructor);
 }
 
-/* Is the calling RPC client a privileged user? */
-bool esdm_rpc_client_is_privileged(void *closure_data)
+/*
+ * The batch is only touched as far as requests and responses are received
+ * and collected, the memory of unused slots is never faulted in.
+ */
+static struct esdm_rpcs_batch *esdm_rpcs_batch_get(void)
 {
-	struct esdm_rpcs_connection *rpc_conn = closure_data;
-	struct ucred cred;
-	socklen_t len = sizeof(cred);
+	struct esdm_rpcs_batch *batch = esdm_rpcs_batch_thread;
 
-	if (getsockopt(rpc_conn->child_fd, SOL_SOCKET, SO_PEERCRED, &cred,
-		       &len) < 0)
-		return false;
+	if (batch)
+		return batch;
 
-	if (cred.uid == 0) {
-		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
-			    "Remote client is privileged\n");
-		return true;
+	pthread_once(&esdm_rpcs_batch_once, esdm_rpcs_batch_key_init);
+	if (esdm_rpcs_batch_key_ret)
+		return NULL;
+
+	batch = calloc(1, sizeof(*batch));
+	if (!batch)
+		return NULL;
+
+	if (pthread_setspecific(esdm_rpcs_batch_key, batch)) {
+		free(batch);
+		return NULL;
 	}
 
-	esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
-		    "Remote client is not privileged\n");
-	return false;
+	esdm_rpcs_batch_thread = batch;
+	return batch;
 }
 
-static void esdm_rpcs_response_closure(const ProtobufCMessage *message,
-				       void *closure_data)
+/* Send all collected responses. */
+static int esdm_rpcs_batch_flush(struct esdm_rpcs_connection *rpc_conn)
+{
+	struct esdm_rpcs_batch *batch = rpc_conn->batch;
+	unsigned int i, sent = 0;
+	int num, ret = 0;
+
+	if (!batch || !batch->tx_num)
+		return 0;
+
+	for (i = 0; i < batch->tx_num; i++) {
+		batch->iov[i].iov_base = batch->tx[i];
+		batch->iov[i].iov_len = batch->tx_len[i];
+		memset(&batch->msgs[i], 0, sizeof(batch->msgs[i]));
+		batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+		batch->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (sent < batch->tx_num) {
+		if (rpc_conn->child_fd < 0) {
+			ret = -EINVAL;
+			break;
+		}
+
+		num = sendmmsg(rpc_conn->child_fd, batch->msgs + sent,
+			       batch->tx_num - sent, 0);
+		if (num < 0) {
+			ret = -errno;
+
+			esdm_logger(
+				LOGGER_VERBOSE, LOGGER_C_RPC,
+				"Writting of data to file descriptor %d failed: %s\n",
+				rpc_conn->child_fd, strerror(-ret));
+
+			if (ret == -EPIPE) {
+				close(rpc_conn->child_fd);
+				rpc_conn->child_fd = -1;
+			}
+			break;
+		}
+		sent += (unsigned int)num;
+	}
+
+	esdm_logger(LOGGER_DEBUG2, LOGGER_C_ANY, "%u responses written\n",
+		    sent);
+	atomic_add(&esdm_rpcs_batch_tx, (int)sent);
+
+	for (i = 0; i < batch->tx_num; i++)
+		memset_secure(batch->tx[i], 0, batch->tx_len[i]);
+	batch->tx_num = 0;
+
+	return ret;
+}
+
+/*
+ * Collect a response frame consisting of a header and data. Returns 1 if the
+ * frame is collected, 0 if the caller must send it directly, < 0 on error.
+ */
+static int esdm_rpcs_batch_queue(struct esdm_rpcs_connection *rpc_conn,
+				 const void *hdr, size_t hdrlen,
+				 const uint8_t *data, size_t len)
+{
+	struct esdm_rpcs_batch *batch = rpc_conn->batch;
+	uint8_t *slot;
+	int ret;
+
+	if (!batch)
+		return 0;
+
+	/* Keep the order of the responses */
+	if (rpc_conn->num_pass_fds || hdrlen + len > ESDM_RPCS_BATCH_TX_SLOT)
+		return esdm_rpcs_batch_flush(rpc_conn);
+
+	if (batch->tx_num >= ESDM_RPCS_BATCH_MAX) {
+		ret = esdm_rpcs_batch_flush(rpc_conn);
+		if (ret)
+			return ret;
+	}
+
+	slot = batch->tx[batch->tx_num];
+	if (hdrlen)
+		memcpy(slot, hdr, hdrlen);
+	if (len)
+		memcpy(slot + hdrlen, data, len);
+	batch->tx_len[batch->tx_num++] = hdrlen + len;
+
+	return 1;
+}
+
+/*
+ * Receive the first record of a request. If the connection qualifies, all
+ * further requests queued in the socket are received with the same call.
+ */
+static ssize_t esdm_rpcs_recv(struct esdm_rpcs_connection *rpc_conn,
+			      uint8_t *buf, size_t len, bool first)
+{
+	struct esdm_rpcs_batch *batch;
+	unsigned int i;
+	int num;
+
+	if (!first || !rpc_conn->batch_rx)
+		return read(rpc_conn->child_fd, buf, len);
+
+	batch = esdm_rpcs_batch_get();
+	if (!batch)
+		return read(rpc_conn->child_fd, buf, len);
+
+	for (i = 0; i < ESDM_RPCS_BATCH_MAX; i++) {
+		batch->iov[i].iov_base = i ? batch->rx[i - 1] : buf;
+		batch->iov[i].iov_len = i ? ESDM_RPCS_RX_BUF_SIZE : len;
+		memset(&batch->msgs[i], 0, sizeof(batch->msgs[i]));
+		batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+		batch->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* Only wait for the first request */
+	num = recvmmsg(rpc_conn->child_fd, batch->msgs, ESDM_RPCS_BATCH_MAX,
+		       MSG_WAITFORONE, NULL);
+	if (num <= 0)
+		return num;
+
+	/* The message headers are reused for sending the responses */
+	batch->rx_trunc = false;
+	for (i = 1; i < (unsigned int)num; i++) {
+		batch->rx_len[i - 1] = batch->msgs[i].msg_len;
+		if (batch->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+			batch->rx_trunc = true;
+	}
+	batch->rx_num = (unsigned int)num - 1;
+
+	if (batch->rx_num) {
+		rpc_conn->batch = batch;
+		atomic_add(&esdm_rpcs_batch_rx, num);
+	}
+
+	return (ssize_t)batch->msgs[0].msg_len;
+}
+
+/* Methods of the unprivileged interface whose handlers never block */
+static const char *const esdm_rpcs_batch_methods[] = {
+	"RpcStatus",
+	"RpcStatusBin",
+	"RpcGetEntLvl",
+	"RpcIsMinSeeded",
+	"RpcIsFullySeeded",
+	"RpcRndGetEntCnt",
+	"RpcGetPoolsize",
+	"RpcGetWriteWakeupThresh",
+	"RpcGetMinReseedSecs",
+	"RpcGetRandomBytes",
+	"RpcGetRandomBytesFull",
+	"RpcGetRandomBytesMin",
+	"RpcGetRandomBytesVec",
+};
+
+/* May the response of the request be collected with the preceding ones? */
+static bool esdm_rpcs_batch_method(struct esdm_rpcs_connection *rpc_conn,
+				   const struct esdm_rpc_proto_cs_header *header,
+				   bool fast)
+{
+	const ProtobufCServiceDescriptor *desc =
+		rpc_conn->proto->service->descriptor;
+	unsigned int i;
+
+	if (fast)
+		return true;
+	if (desc != &unpriv_access__descriptor ||
+	    header->method_index >= desc->n_methods)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(esdm_rpcs_batch_methods); i++) {
+		if (!strcmp(desc->methods[header->method_index].name,
+			    esdm_rpcs_batch_methods[i]))
+			return true;
+	}
+
+	return false;
+}
+
+/* Are requests received together with the current one pending? */
+static bool esdm_rpcs_batched(struct esdm_rpcs_connection *rpc_conn)
+{
+	return !!rpc_conn->batch;
+}
+
+/*
+ * Batched receiving is enabled once a request arrived in one record and stays
+ * disabled after a request spanning several records.
+ */
+static void esdm_rpcs_batch_allow(struct esdm_rpcs_connection *rpc_conn,
+				  bool single)
+{
+	if (!single)
+		rpc_conn->batch_off = true;
+	rpc_conn->batch_rx = !rpc_conn->batch_off;
+}
+
+static void esdm_rpcs_batch_status(char *buf, size_t buflen)
+{
+	snprintf(buf, buflen,
+		 " Batched requests received / responses sent: %d / %d\n",
+		 atomic_read(&esdm_rpcs_batch_rx),
+		 atomic_read(&esdm_rpcs_batch_tx));
+}
+
+#else /* ESDM_RPCS_BATCH_IO */
+
+static inline int esdm_rpcs_batch_flush(struct esdm_rpcs_connection *rpc_conn)
+{
+	(void)rpc_conn;
+	return 0;
+}
+
+static inline int esdm_rpcs_batch_queue(struct esdm_rpcs_connection *rpc_conn,
+					const void *hdr, size_t hdrlen,
+					const uint8_t *data, size_t len)
+{
+	(void)rpc_conn;
+	(void)hdr;
+	(void)hdrlen;
+	(void)data;
+	(void)len;
+	return 0;
+}
+
+static inline ssize_t esdm_rpcs_recv(struct esdm_rpcs_connection *rpc_conn,
+				     uint8_t *buf, size_t len, bool first)
+{
+	(void)first;
+	return read(rpc_conn->child_fd, buf, len);
+}
+
+static inline bool esdm_rpcs_batched(struct esdm_rpcs_connection *rpc_conn)
+{
+	(void)rpc_conn;
+	return false;
+}
+
+static inline void esdm_rpcs_batch_allow(struct esdm_rpcs_connection *rpc_conn,
+					 bool single)
+{
+	(void)rpc_conn;
+	(void)single;
+}
+
+static inline void esdm_rpcs_batch_status(char *buf, size_t buflen)
+{
+	(void)buf;
+	(void)buflen;
+}
+
+#endif /* ESDM_RPCS_BATCH_IO */
+
+/* Maximum size of a response message on the RPC connection. */
+static size_t esdm_rpcs_max_msg_size(struct esdm_rpcs_connection *rpc_conn)
+{
+	return rpc_conn->max_msg_size ? rpc_conn->max_msg_size :
+					ESDM_RPC_MAX_MSG_SIZE;
+}
+
+#ifdef ESDM_RPCS_REACTOR
+
+/*
+ * A frame which the non-blocking socket of a reactor connection cannot take
+ * right now is queued with the connection and sent by the reactor once the
+ * socket has space again. The file descriptors passed with the frame are
+ * duplicated as the caller may close them after the response is written.
+ */
+struct esdm_rpcs_tx {
+	struct esdm_rpcs_tx *next;
+	size_t len;
+	int fds[ESDM_RPCS_PASS_FDS_MAX];
+	unsigned int num_fds;
+	uint8_t data[];
+};
+
+static bool esdm_rpcs_tx_pending(struct esdm_rpcs_connection *rpc_conn)
+{
+	return !!rpc_conn->tx_head;
+}
+
+static void esdm_rpcs_tx_free(struct esdm_rpcs_tx *tx)
+{
+	unsigned int i;
+
+	for (i = 0; i < tx->num_fds; i++)
+		close(tx->fds[i]);
+	memset_secure(tx->data, 0, tx->len);
+	esdm_mem_account(esdm_mem_rpc_buf, -(int64_t)(sizeof(*tx) + tx->len));
+	free(tx);
+}
+
+static int esdm_rpcs_tx_queue(struct esdm_rpcs_connection *rpc_conn,
+			      const uint8_t *data, size_t len)
+{
+	struct esdm_rpcs_tx *tx = malloc(sizeof(*tx) + len);
+	unsigned int i;
+
+	if (!tx)
+		return -ENOMEM;
+	esdm_mem_account(esdm_mem_rpc_buf, (int64_t)(sizeof(*tx) + len));
+
+	tx->next = NULL;
+	tx->len = len;
+	tx->num_fds = 0;
+	memcpy(tx->data, data, len);
+
+	for (i = 0; i < rpc_conn->num_pass_fds; i++) {
+		tx->fds[i] = fcntl(rpc_conn->pass_fds[i], F_DUPFD_CLOEXEC, 0);
+		if (tx->fds[i] < 0) {
+			int errsv = errno;
+
+			esdm_rpcs_tx_free(tx);
+			return -errsv;
+		}
+		tx->num_fds++;
+	}
+	rpc_conn->num_pass_fds = 0;
+
+	if (rpc_conn->tx_tail)
+		rpc_conn->tx_tail->next = tx;
+	else
+		rpc_conn->tx_head = tx;
+	rpc_conn->tx_tail = tx;
+
+	return 0;
+}
+
+/*
+ * Send the queued frames. Returns 0 if all frames are sent, 1 if the socket
+ * cannot take further frames right now, < 0 on error.
+ */
+static int esdm_rpcs_tx_flush(struct esdm_rpcs_connection *rpc_conn)
+{
+	struct esdm_rpcs_tx *tx;
+	ssize_t ret;
+
+	while ((tx = rpc_conn->tx_head)) {
+		if (tx->num_fds)
+			ret = esdm_rpcs_sendmsg_fds(rpc_conn->child_fd,
+						    tx->data, tx->len, tx->fds,
+						    tx->num_fds);
+		else
+			ret = write(rpc_conn->child_fd, tx->data, tx->len);
+		if (ret < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 1;
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		rpc_conn->tx_head = tx->next;
+		esdm_rpcs_tx_free(tx);
+	}
+	rpc_conn->tx_tail = NULL;
+
+	return 0;
+}
+
+/*
+ * Queue the frame if the socket of a reactor connection is full or if frames
+ * are queued already which must be sent first. Returns 1 if the frame is
+ * queued, 0 if the caller must send it directly, < 0 on error.
+ */
+static int esdm_rpcs_tx_defer(struct esdm_rpcs_connection *rpc_conn,
+			      const uint8_t *data, size_t len, bool full)
+{
+	int ret;
+
+	if (!rpc_conn->nonblock || (!full && !esdm_rpcs_tx_pending(rpc_conn)))
+		return 0;
+
+	ret = esdm_rpcs_tx_queue(rpc_conn, data, len);
+	return ret ? ret : 1;
+}
+
+/* Release the partially received request and the queued frames */
+static void esdm_rpcs_io_release(struct esdm_rpcs_connection *rpc_conn)
+{
+	struct esdm_rpcs_tx *tx;
+
+	memset_secure(esdm_rpcs_conn_rx_buf(rpc_conn), 0, rpc_conn->rx_len);
+#ifdef ESDM_TINY_FOOTPRINT
+	if (rpc_conn->rx_partial) {
+		free(rpc_conn->rx_partial);
+		rpc_conn->rx_partial = NULL;
+		esdm_mem_account(esdm_mem_rpc_buf,
+				 -(int64_t)ESDM_RPCS_RX_BUF_SIZE);
+	}
+#endif
+	rpc_conn->rx_len = 0;
+	rpc_conn->rx_fetch = 0;
+
+	while ((tx = rpc_conn->tx_head)) {
+		rpc_conn->tx_head = tx->next;
+		esdm_rpcs_tx_free(tx);
+	}
+	rpc_conn->tx_tail = NULL;
+}
+
+#else /* ESDM_RPCS_REACTOR */
+
+static inline int esdm_rpcs_tx_defer(struct esdm_rpcs_connection *rpc_conn,
+				     const uint8_t *data, size_t len,
+				     bool full)
+{
+	(void)rpc_conn;
+	(void)data;
+	(void)len;
+	(void)full;
+	return 0;
+}
+
+static inline void esdm_rpcs_io_release(struct esdm_rpcs_connection *rpc_conn)
+{
+	(void)rpc_conn;
+}
+
+#endif /* ESDM_RPCS_REACTOR */
+
+/* Write one frame, returns the number of bytes written or < 0 on error */
+static ssize_t esdm_rpcs_write_frame(struct esdm_rpcs_connection *rpc_conn,
+				     const uint8_t *data, size_t len)
+{
+	ssize_t ret;
+	int deferred;
+
+	/* Keep the order of the frames queued for a reactor */
+	deferred = esdm_rpcs_tx_defer(rpc_conn, data, len, false);
+	if (deferred)
+		return (deferred < 0) ? deferred : (ssize_t)len;
+
+	if (rpc_conn->num_pass_fds)
+		ret = esdm_rpcs_write_fds(rpc_conn, data, len);
+	else
+		ret = write(rpc_conn->child_fd, data, len);
+	if (ret >= 0)
+		return ret;
+
+	ret = -errno;
+
+	/* The socket of a reactor connection has no space for the frame */
+	if (ret == -EAGAIN || ret == -EWOULDBLOCK) {
+		deferred = esdm_rpcs_tx_defer(rpc_conn, data, len, true);
+		if (deferred)
+			return (deferred < 0) ? deferred : (ssize_t)len;
+	}
+
+	return ret;
+}
+
+/*
+ * Write data into an RPC connection. The data is sent in frames of at most
+ * ESDM_RPC_MAX_MSG_SIZE bytes which the receiver reassembles.
+ */
+static int esdm_rpcs_write_data(struct esdm_rpcs_connection *rpc_conn,
+				const uint8_t *data, size_t len)
+{
+	uint64_t lat = esdm_lat_now();
+	size_t written = 0, todo;
+	ssize_t ret;
+
+	if (rpc_conn->child_fd < 0)
+		return -EINVAL;
+
+	ret = esdm_rpcs_batch_queue(rpc_conn, NULL, 0, data, len);
+	if (ret)
+		return (ret < 0) ? (int)ret : 0;
+
+	do {
+		todo = min_size(len - written, ESDM_RPC_MAX_MSG_SIZE);
+
+		ret = esdm_rpcs_write_frame(rpc_conn, data + written, todo);
+		if (ret < 0) {
+			int errsv = (int)-ret;
+
+			esdm_logger(
+				LOGGER_VERBOSE, LOGGER_C_RPC,
+				"Writting of data to file descriptor %d failed: %s\n",
+				rpc_conn->child_fd, strerror(errsv));
+
+			if (errsv == EPIPE) {
+				close(rpc_conn->child_fd);
+				rpc_conn->child_fd = -1;
+			}
+
+			return -errsv;
+		}
+
+		written += (size_t)ret;
+	} while (written < len);
+
+	rpc_conn->lat_send += esdm_lat_now() - lat;
+
+	esdm_logger(LOGGER_DEBUG2, LOGGER_C_ANY, "%zu bytes written\n", len);
+
+	return 0;
+}
+
+#ifdef ESDM_RPCS_BUF_WRITE
+
+/*
+ * Implementation of packing data and sending it out. Properties:
+ *
+ * - one call to write data out to the file descriptor
+ *
+ * - one more copy of entire data required to linearize all data
+ */
+static int esdm_rpcs_pack_internal(const ProtobufCMessage *message,
+				   struct esdm_rpcs_connection *rpc_conn)
+{
+#define ESDM_RPCS_BUF_WRITE_HEADER_SZ (sizeof(struct esdm_rpc_proto_sc_header))
+
+	struct esdm_rpc_arena *arena = esdm_rpc_arena_get();
+	size_t message_length;
+	int ret;
+	uint8_t *data_buf;
+	bool reset = false;
+	struct esdm_rpc_proto_sc_header *sc_header;
+	struct esdm_rpc_write_data_buf tmp = {
+		.dst_written = 0,
+	};
+
+	tmp.base.append = esdm_rpc_append_data;
+
+	message_length = protobuf_c_message_get_packed_size(message);
+	if (message_length > esdm_rpcs_max_msg_size(rpc_conn)) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
+			    "Unexpected message length: %zu\n", message_length);
+		return -EFAULT;
+	}
+
+	/*
+	 * The arena is reset after the write unless it also holds the
+	 * unpacked request which is cleared by the caller.
+	 */
+	CKNULL(arena, -ENOMEM);
+	reset = esdm_rpc_arena_empty(arena);
+	data_buf = esdm_rpc_arena_alloc(
+		arena, ESDM_RPCS_BUF_WRITE_HEADER_SZ + message_length);
+	CKNULL(data_buf, -ENOMEM);
+	tmp.dst_buf = (data_buf + ESDM_RPCS_BUF_WRITE_HEADER_SZ);
+
+	sc_header = (struct esdm_rpc_proto_sc_header *)data_buf;
+	sc_header->status_code = le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_SUCCESS);
+	sc_header->method_index = le_bswap32(rpc_conn->method_index);
+	sc_header->message_length = le_bswap32(message_length);
+	sc_header->request_id = le_bswap32(rpc_conn->request_id);
+
+	esdm_logger(
+		LOGGER_DEBUG, LOGGER_C_RPC,
+		"Server sending: server status %u, message length %u, message index %u, request ID %u\n",
+		sc_header->status_code, sc_header->message_length,
+		sc_header->method_index, sc_header->request_id);
+
+	if (protobuf_c_message_pack_to_buffer(message, &tmp.base) !=
+	    message_length) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+			    "Short write of data to file descriptor\n");
+		ret = -EFAULT;
+		goto out;
+	}
+
+	CKINT_LOG(esdm_rpcs_write_data(rpc_conn, data_buf,
+				       ESDM_RPCS_BUF_WRITE_HEADER_SZ +
+					       message_length),
+		  "Submission of message data failed with error %d\n", ret);
+
+out:
+	if (reset)
+		esdm_rpc_arena_reset(arena);
+	return ret;
+}
+
+#else /* ESDM_RPCS_BUF_WRITE */
+
+/* Write out data from a ProtobufC buffer. */
+static void esdm_rpcs_append_data(ProtobufCBuffer *buffer, size_t len,
+				  const uint8_t *data)
+{
+	struct esdm_rpcs_write_buf *buf = (struct esdm_rpcs_write_buf *)buffer;
+	int ret = esdm_rpcs_write_data(buf->rpc_conn, data, len);
+
+	if (ret < 0)
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Submission of payload data failed with error %d\n",
+			    ret);
+}
+
+/*
+ * Implementation of packing data and sending it out. Properties:
+ *
+ * - multiple calls to write data out to the file descriptor
+ *
+ * - no additional memory required
+ */
+static int esdm_rpcs_pack_internal(const ProtobufCMessage *message,
+				   struct esdm_rpcs_connection *rpc_conn)
+{
+	struct esdm_rpc_proto_sc_header sc_header;
+	struct esdm_rpcs_write_buf tmp = { 0 };
+	size_t message_length;
+	int ret;
+
+	message_length = protobuf_c_message_get_packed_size(message);
+	tmp.base.append = esdm_rpcs_append_data;
+	tmp.rpc_conn = rpc_conn;
+
+	sc_header.status_code = le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_SUCCESS);
+	sc_header.method_index = le_bswap32(rpc_conn->method_index);
+	sc_header.message_length = le_bswap32(message_length);
+	sc_header.request_id = le_bswap32(rpc_conn->request_id);
+
+	esdm_logger(
+		LOGGER_DEBUG, LOGGER_C_RPC,
+		"Server sending: server status %u, message length %u, message index %u, request ID %u\n",
+		sc_header.status_code, sc_header.message_length,
+		sc_header.method_index, sc_header.request_id);
+
+	CKINT_LOG(esdm_rpcs_write_data(rpc_conn, (uint8_t *)&sc_header,
+				       sizeof(sc_header)),
+		  "Submission of header data failed with error %d\n", ret);
+
+	if (protobuf_c_message_pack_to_buffer(message, &tmp.base) !=
+	    message_length) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+			    "Short write of data to file descriptor\n");
+		ret = -EFAULT;
+	}
+
+out:
+	return ret;
+}
+
+#endif /* ESDM_RPCS_BUF_WRITE */
+
+/* Pack the message into a ProtobufC structure and write it to the receiver. */
+static int esdm_rpcs_pack(const ProtobufCMessage *message,
+			  struct esdm_rpcs_connection *rpc_conn)
+{
+	struct esdm_rpc_proto_sc_header sc_header;
+
+	/* The response buffers of the handler are still on the stack */
+	thread_stack_probe();
+
+	if (!protobuf_c_message_check(message)) {
+		sc_header.status_code =
+			le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_SERVICE_FAILED);
+		sc_header.method_index = le_bswap32(rpc_conn->method_index);
+		sc_header.message_length = 0;
+		sc_header.request_id = le_bswap32(rpc_conn->request_id);
+		return esdm_rpcs_write_data(rpc_conn, (uint8_t *)&sc_header,
+					    sizeof(sc_header));
+	}
+
+	return esdm_rpcs_pack_internal(message, rpc_conn);
+}
+
+int esdm_rpc_client_uid(void *closure_data, uid_t *uid)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(rpc_conn->child_fd, SOL_SOCKET, SO_PEERCRED, &cred,
+		       &len) < 0)
+		return -errno;
+
+	*uid = cred.uid;
+	return 0;
+}
+
+/* Is the calling RPC client a privileged user? */
+bool esdm_rpc_client_is_privileged(void *closure_data)
+{
+	uid_t uid;
+
+	if (esdm_rpc_client_uid(closure_data, &uid))
+		return false;
+
+	if (uid == 0) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
+			    "Remote client is privileged\n");
+		return true;
+	}
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
+		    "Remote client is not privileged\n");
+	return false;
+}
+
+int esdm_rpc_server_pass_fds(void *closure_data, const int *fds,
+			     unsigned int num)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+
+	if (num > ESDM_RPCS_PASS_FDS_MAX)
+		return -EINVAL;
+
+	/* File descriptors can only be passed to local peers */
+	if (rpc_conn->proto->remote)
+		return -EOPNOTSUPP;
+
+	memcpy(rpc_conn->pass_fds, fds, sizeof(int) * num);
+	rpc_conn->num_pass_fds = num;
+
+	return 0;
+}
+
+int esdm_rpc_server_set_max_msg_size(void *closure_data, uint32_t size)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+
+	if (size < ESDM_RPC_MAX_MSG_SIZE ||
+	    size > ESDM_RPC_MAX_NEGOTIATED_MSG_SIZE)
+		return -EINVAL;
+
+	rpc_conn->max_msg_size = size;
+
+	return 0;
+}
+
+size_t esdm_rpc_server_max_data(void *closure_data)
 {
 	struct esdm_rpcs_connection *rpc_conn = closure_data;
+
+	return esdm_rpcs_max_msg_size(rpc_conn) -
+	       sizeof(struct esdm_rpc_proto_sc_header);
+}
+
+uint8_t *esdm_rpc_server_randval_alloc(uint8_t *buf, size_t buflen,
+				       size_t len)
+{
+	uint8_t *randval = esdm_secure_pool_alloc(len);
+
+	if (randval)
+		return randval;
+	if (len <= buflen)
+		return buf;
+
+	return esdm_secure_alloc(len);
+}
+
+void esdm_rpc_server_randval_free(uint8_t *randval, uint8_t *buf, size_t len)
+{
+	if (randval == buf)
+		memset_secure(randval, 0, len);
+	else
+		esdm_secure_free(randval, len);
+}
+
+/*
+ * Maximum size of the protobuf data preceding the random bytes: tag and
+ * varint of the return code plus tag and varint of the length of the bytes
+ * field.
+ */
+#define ESDM_RPCS_RANDVAL_PREFIX_MAX (1 + 10 + 1 + 10)
+
+/* Encode an unsigned value as protobuf varint. */
+static size_t esdm_rpcs_encode_varint(uint8_t *out, uint64_t val)
+{
+	size_t i = 0;
+
+	while (val >= 0x80) {
+		out[i++] = (uint8_t)(val | 0x80);
+		val >>= 7;
+	}
+	out[i++] = (uint8_t)val;
+
+	return i;
+}
+
+/*
+ * Send a response header together with the caller's buffer. The first frame
+ * holds the header and as much data as fits, the remainder of a large
+ * response is sent with subsequent frames.
+ */
+static int esdm_rpcs_write_hdr_data(struct esdm_rpcs_connection *rpc_conn,
+				    const void *hdr, size_t hdrlen,
+				    const uint8_t *data, size_t len)
+{
+	struct iovec iov[2];
+	struct msghdr msg = { 0 };
+	size_t first;
+	ssize_t ret;
+
+	if (rpc_conn->child_fd < 0)
+		return -EINVAL;
+
+	ret = esdm_rpcs_batch_queue(rpc_conn, hdr, hdrlen, data, len);
+	if (ret)
+		return (ret < 0) ? (int)ret : 0;
+
+	iov[0].iov_base = (void *)hdr;
+	iov[0].iov_len = hdrlen;
+	first = min_size(len, ESDM_RPC_MAX_MSG_SIZE - hdrlen);
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = first;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+
+	/* A SOCK_SEQPACKET socket sends the record entirely or not at all */
+	ret = sendmsg(rpc_conn->child_fd, &msg, 0);
+	if (ret < 0) {
+		int errsv = errno;
+
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+			    "Writting of data to file descriptor %d failed: %s\n",
+			    rpc_conn->child_fd, strerror(errsv));
+
+		if (errsv == EPIPE) {
+			close(rpc_conn->child_fd);
+			rpc_conn->child_fd = -1;
+		}
+
+		return -errsv;
+	}
+
+	if ((size_t)ret != hdrlen + first) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+			    "Short write of data to file descriptor\n");
+		return -EFAULT;
+	}
+
+	if (first < len)
+		return esdm_rpcs_write_data(rpc_conn, data + first,
+					    len - first);
+
+	esdm_logger(LOGGER_DEBUG2, LOGGER_C_ANY, "%zu bytes written\n",
+		    (size_t)ret);
+
+	return 0;
+}
+
+int esdm_rpc_server_send_randval(void *closure_data, const uint8_t *randval,
+				 size_t len)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+	struct {
+		struct esdm_rpc_proto_sc_header sc_header;
+		uint8_t pb[ESDM_RPCS_RANDVAL_PREFIX_MAX];
+	} __attribute__((packed)) hdr;
+	size_t pblen = 0, message_length;
+
+	/* File descriptors are only passed with the regular path */
+	if (!len || len > esdm_rpc_server_max_data(closure_data) ||
+	    rpc_conn->num_pass_fds)
+		return -EOPNOTSUPP;
+
+	if (rpc_conn->child_fd < 0)
+		return -EINVAL;
+
+	/*
+	 * Encode the message as protobuf-c would do: field 1 (ret) as varint
+	 * followed by field 2 (randval) as length-delimited data.
+	 */
+	hdr.pb[pblen++] = (1 << 3) | 0;
+	pblen += esdm_rpcs_encode_varint(hdr.pb + pblen, len);
+	hdr.pb[pblen++] = (2 << 3) | 2;
+	pblen += esdm_rpcs_encode_varint(hdr.pb + pblen, len);
+	message_length = pblen + len;
+
+	hdr.sc_header.status_code =
+		le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_SUCCESS);
+	hdr.sc_header.method_index = le_bswap32(rpc_conn->method_index);
+	hdr.sc_header.message_length = le_bswap32((uint32_t)message_length);
+	hdr.sc_header.request_id = le_bswap32(rpc_conn->request_id);
+
+	esdm_logger(
+		LOGGER_DEBUG, LOGGER_C_RPC,
+		"Server sending random data: message length %zu, message index %u, request ID %u\n",
+		message_length, rpc_conn->method_index, rpc_conn->request_id);
+
+	return esdm_rpcs_write_hdr_data(rpc_conn, &hdr,
+					sizeof(hdr.sc_header) + pblen, randval,
+					len);
+}
+
+int esdm_rpc_server_set_fast_wire(void *closure_data)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+
+	if (rpc_conn->proto->service->descriptor != &unpriv_access__descriptor)
+		return -EOPNOTSUPP;
+
+	rpc_conn->fast_wire = true;
+
+	return 0;
+}
+
+bool esdm_rpc_server_local_peer(void *closure_data)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+
+	/* The CPU of a virtual machine guest is unrelated to the host */
+	return !rpc_conn->proto->remote;
+}
+
+int esdm_rpc_server_set_cpu_hint(void *closure_data, uint32_t cpu)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+
+	if (!esdm_rpc_server_local_peer(closure_data))
+		return -EOPNOTSUPP;
+
+	rpc_conn->cpu_hint = cpu + 1;
+
+	return 0;
+}
+
+int esdm_rpc_server_send_fast(void *closure_data, int32_t status,
+			      const uint8_t *data, size_t len)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+	struct esdm_rpc_fast_sc hdr;
+	uint64_t lat = esdm_lat_now();
+	int ret;
+
+	if (len > esdm_rpc_server_max_data(closure_data))
+		return -EINVAL;
+
+	hdr.status = le_bswap32((uint32_t)status);
+	hdr.method = le_bswap32(rpc_conn->request_id);
+	hdr.flags = 0;
+	hdr.length = le_bswap32((uint32_t)len);
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Server sending compact response: status %d, length %zu\n",
+		    status, len);
+
+	ret = esdm_rpcs_write_hdr_data(rpc_conn, &hdr, sizeof(hdr), data, len);
+	rpc_conn->lat_send = esdm_lat_now() - lat;
+
+	return ret;
+}
+
+/*
+ * Frames of a random byte stream are a multiple of the maximum request size of
+ * the DRNG and fit into one message frame.
+ */
+#define ESDM_RPCS_STREAM_FRAME_MAX                                             \
+	(((ESDM_RPC_MAX_DATA - ESDM_RPCS_RANDVAL_PREFIX_MAX) /                 \
+	  ESDM_DRNG_MAX_REQSIZE) *                                             \
+	 ESDM_DRNG_MAX_REQSIZE)
+
+int esdm_rpc_server_stream_start(void *closure_data, uint64_t len,
+				 uint32_t frame_size)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+
+	if (!frame_size || frame_size > ESDM_RPCS_STREAM_FRAME_MAX)
+		frame_size = ESDM_RPCS_STREAM_FRAME_MAX;
+
+	rpc_conn->stream_remaining = len;
+	rpc_conn->stream_unbounded = !len;
+	rpc_conn->stream_frame_size = frame_size;
+	rpc_conn->stream_active = true;
+
+	return 0;
+}
+
+/* Terminate a random byte stream with a frame holding the return code. */
+static int esdm_rpcs_stream_end(struct esdm_rpcs_connection *rpc_conn,
+				int64_t code)
+{
+	GetRandomStreamResponse response = GET_RANDOM_STREAM_RESPONSE__INIT;
+
+	rpc_conn->stream_active = false;
+	response.ret = code;
+
+	return esdm_rpcs_pack(&response.base, rpc_conn);
+}
+
+/*
+ * Send the next frame of a random byte stream. A blocking write into the
+ * socket implies that the stream is flow controlled by the consumption of the
+ * client. A client not consuming the data within the send timeout severs the
+ * connection. A reactor sends the next frame only once the socket has space
+ * again and the idle time replaces the send timeout.
+ */
+static int esdm_rpcs_stream_frame(struct esdm_rpcs_connection *rpc_conn)
+{
+	uint8_t rndval[ESDM_RPCS_STREAM_FRAME_MAX];
+	size_t todo = rpc_conn->stream_frame_size;
+	ssize_t ret;
+
+	if (!rpc_conn->stream_unbounded)
+		todo = (size_t)min_uint64(todo, rpc_conn->stream_remaining);
+	if (!todo)
+		return esdm_rpcs_stream_end(rpc_conn, 0);
+
+	if (atomic_read(&server_exit))
+		return esdm_rpcs_stream_end(rpc_conn, -ESHUTDOWN);
+
+	ret = esdm_get_random_bytes(rndval, todo);
+	if (ret <= 0) {
+		ret = esdm_rpcs_stream_end(rpc_conn, ret ? ret : -EFAULT);
+		goto out;
+	}
+
+	esdm_test_shm_status_add_rpc_server_written((size_t)ret);
+	if (!rpc_conn->stream_unbounded)
+		rpc_conn->stream_remaining -= (size_t)ret;
+
+	ret = esdm_rpc_server_send_randval(rpc_conn, rndval, (size_t)ret);
+
+out:
+	memset_secure(rndval, 0, todo);
+	return (int)ret;
+}
+
+/*
+ * Latency histograms of the processing stages of a request followed by one
+ * histogram per RPC method covering the entire request processing.
+ */
+enum esdm_rpcs_lat_stage {
+	esdm_rpcs_lat_recv,
+	esdm_rpcs_lat_unpack,
+	esdm_rpcs_lat_handler,
+	esdm_rpcs_lat_pack,
+	esdm_rpcs_lat_send,
+	esdm_rpcs_lat_stages,
+};
+
+#define ESDM_RPCS_LAT_METHODS 32
+#define ESDM_RPCS_LAT_UNPRIV esdm_rpcs_lat_stages
+#define ESDM_RPCS_LAT_PRIV (ESDM_RPCS_LAT_UNPRIV + ESDM_RPCS_LAT_METHODS)
+
+static struct esdm_lat_registry esdm_rpcs_lat = ESDM_LAT_REGISTRY_INIT(
+	ESDM_RPCS_LAT_PRIV + ESDM_RPCS_LAT_METHODS);
+
+/* Processed requests per RPC method, the priv methods follow the unpriv ones */
+ESDM_METRICS_DEFINE(esdm_rpcs_requests, 2 * ESDM_RPCS_LAT_METHODS);
+
+static unsigned int esdm_rpcs_lat_method(struct esdm_rpcs_connection *rpc_conn)
+{
+	if (rpc_conn->method_index >= ESDM_RPCS_LAT_METHODS)
+		return UINT_MAX;
+
+	if (rpc_conn->proto->service->descriptor == &priv_access__descriptor)
+		return ESDM_RPCS_LAT_PRIV + rpc_conn->method_index;
+	return ESDM_RPCS_LAT_UNPRIV + rpc_conn->method_index;
+}
+
+static size_t esdm_rpcs_lat_methods(const ProtobufCServiceDescriptor *desc,
+				    unsigned int base, char *buf,
+				    size_t buflen)
+{
+	size_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < desc->n_methods && i < ESDM_RPCS_LAT_METHODS; i++)
+		len += esdm_lat_report(&esdm_rpcs_lat, base + i,
+				       desc->methods[i].name, buf + len,
+				       buflen - len);
+
+	return len;
+}
+
+static void esdm_rpcs_lat_status(char *buf, size_t buflen)
+{
+	static const char *const names[esdm_rpcs_lat_stages] = {
+		[esdm_rpcs_lat_recv] = "receive",
+		[esdm_rpcs_lat_unpack] = "unpack",
+		[esdm_rpcs_lat_handler] = "handler",
+		[esdm_rpcs_lat_pack] = "pack",
+		[esdm_rpcs_lat_send] = "send",
+	};
+	size_t len = 0, hdr;
+	unsigned int i;
+
+	if (!buflen)
+		return;
+
+	hdr = (size_t)snprintf(buf, buflen, "RPC latency:\n");
+	if (hdr >= buflen)
+		return;
+
+	for (i = 0; i < esdm_rpcs_lat_stages; i++)
+		len += esdm_lat_report(&esdm_rpcs_lat, i, names[i],
+				       buf + hdr + len, buflen - hdr - len);
+	len += esdm_rpcs_lat_methods(&unpriv_access__descriptor,
+				     ESDM_RPCS_LAT_UNPRIV, buf + hdr + len,
+				     buflen - hdr - len);
+	len += esdm_rpcs_lat_methods(&priv_access__descriptor,
+				     ESDM_RPCS_LAT_PRIV, buf + hdr + len,
+				     buflen - hdr - len);
+
+	/* Do not print the header if nothing was recorded */
+	if (!len)
+		buf[0] = '\0';
+}
+
+/*
+ * Allocations and system calls per RPC method from the complete reception of
+ * a request until its response is sent, the priv methods follow the unpriv
+ * ones.
+ */
+static struct esdm_audit_stat esdm_rpcs_audit[2 * ESDM_RPCS_LAT_METHODS];
+
+static size_t esdm_rpcs_audit_methods(const ProtobufCServiceDescriptor *desc,
+				      struct esdm_audit_stat *stats, char *buf,
+				      size_t buflen)
+{
+	size_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < desc->n_methods && i < ESDM_RPCS_LAT_METHODS; i++)
+		len += esdm_audit_report(&stats[i], desc->methods[i].name,
+					 buf + len, buflen - len);
+
+	return len;
+}
+
+static void esdm_rpcs_audit_status(char *buf, size_t buflen)
+{
+	size_t len = 0, hdr;
+
+	if (!buflen)
+		return;
+
+	hdr = (size_t)snprintf(buf, buflen, "RPC hot path audit:\n");
+	if (hdr >= buflen)
+		return;
+
+	len += esdm_rpcs_audit_methods(&unpriv_access__descriptor,
+				       esdm_rpcs_audit, buf + hdr + len,
+				       buflen - hdr - len);
+	len += esdm_rpcs_audit_methods(&priv_access__descriptor,
+				       esdm_rpcs_audit + ESDM_RPCS_LAT_METHODS,
+				       buf + hdr + len, buflen - hdr - len);
+
+	/* Do not print the header if nothing was recorded */
+	if (!len)
+		buf[0] = '\0';
+}
+
+static void esdm_rpcs_response_closure(const ProtobufCMessage *message,
+				       void *closure_data)
+{
+	struct esdm_rpcs_connection *rpc_conn = closure_data;
+	uint64_t lat = esdm_lat_now();
+	int ret;
+
+	rpc_conn->lat_send = 0;
+	CKINT_LOG(esdm_rpcs_pack(message, rpc_conn),
+		  "Failed to serialize response: %d\n", ret);
+
+out:
+	/* Packing is accounted without the time spent writing the data */
+	rpc_conn->lat_closure = esdm_lat_now() - lat;
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_pack,
+			rpc_conn->lat_closure - rpc_conn->lat_send);
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_send,
+			rpc_conn->lat_send);
+
+	/* Never pass file descriptors with a later response */
+	rpc_conn->num_pass_fds = 0;
+	return;
+}
+
+/* Unpack the received data and invoke the intended ProtobufC handler. */
+static int esdm_rpcs_unpack(struct esdm_rpcs_connection *rpc_conn,
+			    struct esdm_rpc_proto_cs *received_data,
+			    uint64_t lat_start)
+{
+	const ProtobufCMessageDescriptor *desc;
+	struct esdm_rpcs *proto = rpc_conn->proto;
+	ProtobufCService *service = proto->service;
+	ProtobufCMessage *message = NULL;
+	struct esdm_rpc_proto_cs_header *header = &received_data->header;
+	uint32_t method_index = header->method_index;
+	uint64_t lat;
+	int ret;
+
+	CKINT(esdm_rpc_proto_get_descriptor(service, received_data, &desc));
+	lat = esdm_lat_now();
+	message = protobuf_c_message_unpack(desc, rpc_conn->rpc_allocator,
+					    header->message_length,
+					    received_data->data);
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_unpack,
+			esdm_lat_now() - lat);
+
+	CKNULL(message, -ENOMEM);
+
+	rpc_conn->method_index = method_index;
+	rpc_conn->request_id = header->request_id;
+
+	/* Invoke the RPC call */
+	rpc_conn->lat_closure = 0;
+	ESDM_PROBE2(rpc_start, service->descriptor == &priv_access__descriptor,
+		    method_index);
+	lat = esdm_lat_now();
+	service->invoke(service, method_index, message,
+			esdm_rpcs_response_closure, rpc_conn);
+	lat = esdm_lat_now() - lat;
+	ESDM_PROBE2(rpc_end, service->descriptor == &priv_access__descriptor,
+		    method_index);
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_handler,
+			lat - rpc_conn->lat_closure);
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_method(rpc_conn),
+			esdm_lat_now() - lat_start);
+	esdm_metrics_add(&esdm_rpcs_requests,
+			 esdm_rpcs_lat_method(rpc_conn) - ESDM_RPCS_LAT_UNPRIV,
+			 1);
+
+out:
+	if (message)
+		protobuf_c_message_free_unpacked(message,
+						 rpc_conn->rpc_allocator);
+
+	/* Pick up the error from esdm_rpcs_write_data */
+	if (rpc_conn->child_fd == -1)
+		ret = -EPIPE;
+
+	return ret;
+}
+
+/* Process a request in the compact wire format bypassing protobuf-c. */
+static int esdm_rpcs_fast_wire(struct esdm_rpcs_connection *rpc_conn,
+			       const struct esdm_rpc_fast_cs *request,
+			       uint64_t lat_start)
+{
+	const ProtobufCServiceDescriptor *desc =
+		rpc_conn->proto->service->descriptor;
+	const ProtobufCMethodDescriptor *method;
+	const char *name;
+	uint64_t lat;
+	int ret;
+
+	name = esdm_rpc_fast_wire_method(request->method &
+					 ~ESDM_RPC_FAST_MAGIC_MASK);
+	CKNULL(name, -EINVAL);
+	method = protobuf_c_service_descriptor_get_method_by_name(desc, name);
+	CKNULL(method, -EINVAL);
+
+	/*
+	 * The request is accounted to the RPC method it replaces. The compact
+	 * response echoes the method in place of the request ID.
+	 */
+	rpc_conn->method_index = (uint32_t)(method - desc->methods);
+	rpc_conn->request_id = request->method;
+
+	rpc_conn->lat_send = 0;
+	ESDM_PROBE2(rpc_start, false, rpc_conn->method_index);
+	lat = esdm_lat_now();
+	ret = esdm_rpc_fast_wire(rpc_conn, request);
+	lat = esdm_lat_now() - lat;
+	ESDM_PROBE2(rpc_end, false, rpc_conn->method_index);
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_handler,
+			lat - rpc_conn->lat_send);
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_send,
+			rpc_conn->lat_send);
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_method(rpc_conn),
+			esdm_lat_now() - lat_start);
+	esdm_metrics_add(&esdm_rpcs_requests,
+			 esdm_rpcs_lat_method(rpc_conn) - ESDM_RPCS_LAT_UNPRIV,
+			 1);
+
+out:
+	/* Pick up the error from esdm_rpcs_write_data */
+	if (rpc_conn->child_fd == -1)
+		ret = -EPIPE;
+
+	return ret;
+}
+
+/*
+ * Convert the header of a received request to host byte order. Returns the
+ * size of the entire request.
+ */
+static size_t esdm_rpcs_header(struct esdm_rpcs_connection *rpc_conn,
+			       struct esdm_rpc_proto_cs_header *header,
+			       bool *fast)
+{
+	/* Convert incoming data to LE */
+	header->message_length = le_bswap32(header->message_length);
+	header->method_index = le_bswap32(header->method_index);
+	header->request_id = le_bswap32(header->request_id);
+
+	esdm_logger(
+		LOGGER_DEBUG, LOGGER_C_RPC,
+		"Server received: message length %u, message index %u, request ID %u\n",
+		header->message_length, header->method_index,
+		header->request_id);
+
+	/* A compact request consists of the header only */
+	if (rpc_conn->fast_wire &&
+	    (header->method_index & ESDM_RPC_FAST_MAGIC_MASK) ==
+		    ESDM_RPC_FAST_MAGIC) {
+		*fast = true;
+		return sizeof(struct esdm_rpc_proto_cs);
+	}
+
+	/* Truncate the buffer length if client specified too much data. */
+	if (header->message_length > ESDM_RPC_MAX_MSG_SIZE)
+		header->message_length = ESDM_RPC_MAX_MSG_SIZE;
+
+	return header->message_length + sizeof(struct esdm_rpc_proto_cs);
+}
+
+/* Process a completely received request and send the answer. */
+static int esdm_rpcs_process(struct esdm_rpcs_connection *rpc_conn,
+			     struct esdm_rpc_proto_cs *received_data, bool fast,
+			     uint64_t lat_start)
+{
+	struct esdm_audit_cnt audit;
+	unsigned int method;
+	int ret;
+
+	esdm_lat_record(&esdm_rpcs_lat, esdm_rpcs_lat_recv,
+			esdm_lat_now() - lat_start);
+
+	esdm_audit_begin(&audit);
+
+	/* Serve the request with the DRNG instance of the CPU of the client */
+	if (rpc_conn->cpu_hint)
+		esdm_config_cpu_hint(rpc_conn->cpu_hint - 1);
+
+	/* The header fields were converted in place and hold the request */
+	if (fast)
+		ret = esdm_rpcs_fast_wire(
+			rpc_conn, (struct esdm_rpc_fast_cs *)received_data,
+			lat_start);
+	else
+		ret = esdm_rpcs_unpack(rpc_conn, received_data, lat_start);
+
+	esdm_config_cpu_hint(ESDM_CONFIG_CPU_HINT_NONE);
+
+	/* A failed request may not have set the method */
+	method = esdm_rpcs_lat_method(rpc_conn) - ESDM_RPCS_LAT_UNPRIV;
+	if (!ret && method < ARRAY_SIZE(esdm_rpcs_audit))
+		esdm_audit_end(&esdm_rpcs_audit[method], &audit);
+
+	return ret;
+}
+
+#ifdef ESDM_RPCS_BATCH_IO
+
+/*
+ * Process the requests received together with the first one and send the
+ * collected responses. All received requests are cleared, also after an
+ * error.
+ */
+static int esdm_rpcs_batch_process(struct esdm_rpcs_connection *rpc_conn,
+				   struct esdm_rpc_arena *arena, int ret)
+{
+	struct esdm_rpcs_batch *batch = rpc_conn->batch;
+	struct esdm_rpc_proto_cs *received_data;
+	unsigned int i;
+	bool fast;
+
+	if (!batch)
+		return ret;
+
+	if (batch->rx_trunc)
+		ret = -EINVAL;
+
+	for (i = 0; i < batch->rx_num; i++) {
+		/* The cast is appropriate as the slot is aligned to 64 bits */
+		received_data = (struct esdm_rpc_proto_cs *)batch->rx[i];
+		fast = false;
+
+		if (ret)
+			goto next;
+
+		/* Each record must hold an entire request */
+		if (batch->rx_len[i] < sizeof(*received_data) ||
+		    batch->rx_len[i] < esdm_rpcs_header(rpc_conn,
+							 &received_data->header,
+							 &fast)) {
+			ret = -EINVAL;
+			goto next;
+		}
+
+		/* Do not delay the collected responses by a blocking call */
+		if (!esdm_rpcs_batch_method(rpc_conn, &received_data->header,
+					    fast)) {
+			ret = esdm_rpcs_batch_flush(rpc_conn);
+			if (ret)
+				goto next;
+		}
+
+		ret = esdm_rpcs_process(rpc_conn, received_data, fast,
+					esdm_lat_now());
+
+	next:
+		memset_secure(batch->rx[i], 0, batch->rx_len[i]);
+		esdm_rpc_arena_reset(arena);
+	}
+	batch->rx_num = 0;
+
+	if (!ret)
+		ret = esdm_rpcs_batch_flush(rpc_conn);
+	else
+		esdm_rpcs_batch_flush(rpc_conn);
+	rpc_conn->batch = NULL;
+
+	return ret;
+}
+
+#else /* ESDM_RPCS_BATCH_IO */
+
+static inline int
+esdm_rpcs_batch_process(struct esdm_rpcs_connection *rpc_conn,
+			struct esdm_rpc_arena *arena, int ret)
+{
+	(void)rpc_conn;
+	(void)arena;
+	return ret;
+}
+
+#endif /* ESDM_RPCS_BATCH_IO */
+
+/*
+ * Process the request received into the buffer of the connection. The request
+ * is unpacked into the arena of the thread to avoid mallocs and large stack
+ * frames.
+ */
+static int esdm_rpcs_serve(struct esdm_rpcs_connection *rpc_conn,
+			   struct esdm_rpc_arena *arena, size_t total_received,
+			   bool fast, uint64_t lat_start)
+{
+	ProtobufCAllocator esdm_rpc_allocator = {
+		.alloc = &esdm_rpc_alloc,
+		.free = &esdm_rpc_free,
+		.allocator_data = arena,
+	};
+	uint8_t *buf = esdm_rpcs_conn_rx_buf(rpc_conn);
+	int ret;
+
+	/* Prepare the allocator to use the arena. */
+	rpc_conn->rpc_allocator = &esdm_rpc_allocator;
+
+	/*
+	 * We now have a filled buffer that has a header and received
+	 * as much data as the header defined. We also start the
+	 * processing of data and the subsequent submission of the answer here.
+	 * The cast is appropriate as the buffer is aligned to 64 bits.
+	 */
+	ret = esdm_rpcs_process(rpc_conn, (struct esdm_rpc_proto_cs *)buf, fast,
+				lat_start);
+
+	/* Clear the memory after processing one request. */
+	memset_secure(buf, 0, total_received);
+	esdm_rpc_arena_reset(arena);
+
+	/* Process the requests received together with the first one */
+	return esdm_rpcs_batch_process(rpc_conn, arena, ret);
+}
+
+#ifdef ESDM_RPCS_REACTOR
+
+/* Has the reactor completely received a request not processed yet? */
+static bool esdm_rpcs_rx_complete(struct esdm_rpcs_connection *rpc_conn)
+{
+	return rpc_conn->rx_fetch && rpc_conn->rx_len >= rpc_conn->rx_fetch;
+}
+
+/* Process the request received by the reactor */
+static int esdm_rpcs_serve_received(struct esdm_rpcs_connection *rpc_conn,
+				    struct esdm_rpc_arena *arena)
+{
+	size_t total_received = rpc_conn->rx_len;
+	int ret;
+
+	rpc_conn->rx_len = 0;
+	rpc_conn->rx_fetch = 0;
+
+	ret = esdm_rpcs_serve(rpc_conn, arena, total_received,
+			      rpc_conn->rx_fast, rpc_conn->rx_lat_start);
+
+#ifdef ESDM_TINY_FOOTPRINT
+	/* The request was completely received into its own buffer */
+	if (rpc_conn->rx_partial) {
+		free(rpc_conn->rx_partial);
+		rpc_conn->rx_partial = NULL;
+		esdm_mem_account(esdm_mem_rpc_buf,
+				 -(int64_t)ESDM_RPCS_RX_BUF_SIZE);
+	}
+#endif
+
+	return ret;
+}
+
+#else /* ESDM_RPCS_REACTOR */
+
+static inline bool
+esdm_rpcs_rx_complete(struct esdm_rpcs_connection *rpc_conn)
+{
+	(void)rpc_conn;
+	return false;
+}
+
+static inline int
+esdm_rpcs_serve_received(struct esdm_rpcs_connection *rpc_conn,
+			 struct esdm_rpc_arena *arena)
+{
+	(void)rpc_conn;
+	(void)arena;
+	return -EINVAL;
+}
+
+#endif /* ESDM_RPCS_REACTOR */
+
+/* Read data from the RPC connection into the buffer of the connection. */
+static int esdm_rpcs_read(struct esdm_rpcs_connection *rpc_conn)
+{
+	struct esdm_rpc_arena *arena = esdm_rpc_arena_get();
+	struct esdm_rpc_proto_cs *received_data;
+	uint8_t *buf = esdm_rpcs_conn_rx_buf(rpc_conn);
+	size_t total_received = 0, data_to_fetch = 0;
+	ssize_t received = 0;
+	uint64_t lat_start = 0;
+	int ret;
+	uint8_t *buf_p = buf;
+	bool fast = false;
+
+	if (rpc_conn->child_fd < 0)
+		return -EINVAL;
+	if (!arena)
+		return -ENOMEM;
+
+	/* A request received by a reactor is processed right away */
+	if (esdm_rpcs_rx_complete(rpc_conn))
+		return esdm_rpcs_serve_received(rpc_conn, arena);
+
+	/* The cast is appropriate as the buffer is aligned to 64 bits. */
+	received_data = (struct esdm_rpc_proto_cs *)buf;
+
+	/* Read the data into the thread-local storage */
+	do {
+		/* Subsequent records were received as further requests */
+		if (total_received && esdm_rpcs_batched(rpc_conn)) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		received = esdm_rpcs_recv(rpc_conn, buf_p,
+					  ESDM_RPCS_RX_BUF_SIZE - total_received,
+					  !total_received);
+		if (received < 0) {
+			ret = -errno;
+			goto out;
+		}
+
+		/* Received EOF */
+		if (received == 0) {
+			ret = -EAGAIN;
+			goto out;
+		}
+
+		/* Waiting for the first data of a request is not accounted */
+		if (!total_received)
+			lat_start = esdm_lat_now();
+		total_received += (size_t)received;
+		buf_p += (size_t)received;
+
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
+			    "Reading %zd bytes, already consumed %zu bytes\n",
+			    received, total_received);
+
+		/* We insist on having at least a header received. */
+		if (total_received < sizeof(*received_data))
+			continue;
+
+		/* Header is received, analyze it. */
+		if (!data_to_fetch)
+			data_to_fetch = esdm_rpcs_header(
+				rpc_conn, &received_data->header, &fast);
+
+		/* Now, we received enough and can stop the reading */
+		if (total_received >= data_to_fetch)
+			break;
+
+	} while (total_received < ESDM_RPCS_RX_BUF_SIZE);
+
+	/* If we have received insufficient data, bail out now. */
+	if (total_received < sizeof(*received_data) ||
+	    total_received < data_to_fetch) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	esdm_rpcs_batch_allow(rpc_conn, total_received == (size_t)received);
+
+	return esdm_rpcs_serve(rpc_conn, arena, total_received, fast,
+			       lat_start);
+
+out:
+	/* Clear the memory after processing one request. */
+	memset_secure(buf, 0, total_received);
+	esdm_rpc_arena_reset(arena);
+
+	/* Process the requests received together with the first one */
+	return esdm_rpcs_batch_process(rpc_conn, arena, ret);
+}
+
+/*
+ * Pool of connection objects which are recycled instead of being freed. The
+ * free objects are linked with a lock-free freelist: the lower 32 bits of the
+ * head hold the index of the first free object plus one (0 marks an empty
+ * list), the upper 32 bits hold a generation count protecting against the
+ * ABA problem. Objects never used so far are handed out in order. If the pool
+ * is exhausted, objects are allocated from the heap.
+ */
+#define ESDM_RPCS_POOL_SIZE THREADING_MAX_THREADS
+#define ESDM_RPCS_POOL_IDX_MASK 0xffffffffULL
+
+static struct esdm_rpcs_connection esdm_rpcs_pool[ESDM_RPCS_POOL_SIZE];
+static atomic_64_t esdm_rpcs_pool_head = ATOMIC_64_INIT(0);
+static atomic_t esdm_rpcs_pool_fresh = ATOMIC_INIT(0);
+static atomic_t esdm_rpcs_pool_in_use = ATOMIC_INIT(0);
+static atomic_t esdm_rpcs_pool_heap = ATOMIC_INIT(0);
+static atomic_t esdm_rpcs_pool_recycled = ATOMIC_INIT(0);
+/* Connections parked while their client is idle */
+static atomic_t esdm_rpcs_parked_num = ATOMIC_INIT(0);
+/* Requests parked until the ESDM is operational */
+static atomic_t esdm_rpcs_seed_wait_num = ATOMIC_INIT(0);
+#if (ESDM_RPCS_ADMISSION_TIMEOUT > 0)
+/* New connections rejected while the server is overloaded */
+static atomic_t esdm_rpcs_shed_num = ATOMIC_INIT(0);
+#endif
+
+static bool esdm_rpcs_pool_owns(struct esdm_rpcs_connection *rpc_conn)
+{
+	return ((uintptr_t)rpc_conn >= (uintptr_t)esdm_rpcs_pool &&
+		(uintptr_t)rpc_conn <
+			(uintptr_t)(esdm_rpcs_pool + ESDM_RPCS_POOL_SIZE));
+}
+
+/* Obtain a zeroized connection object. */
+static struct esdm_rpcs_connection *esdm_rpcs_alloc_conn(void)
+{
+	struct esdm_rpcs_connection *rpc_conn;
+	uint64_t head, new, old;
+	uint32_t idx;
+	int fresh;
+
+	/* Recycle a released object */
+	head = (uint64_t)atomic_read_64(&esdm_rpcs_pool_head);
+	while (head & ESDM_RPCS_POOL_IDX_MASK) {
+		idx = (uint32_t)(head & ESDM_RPCS_POOL_IDX_MASK) - 1;
+		new = (((head >> 32) + 1) << 32) | esdm_rpcs_pool[idx].pool_next;
+		old = (uint64_t)atomic_cmpxchg_64(&esdm_rpcs_pool_head,
+						  (long long)head,
+						  (long long)new);
+		if (old == head) {
+			atomic_inc(&esdm_rpcs_pool_recycled);
+			rpc_conn = &esdm_rpcs_pool[idx];
+			goto out;
+		}
+		head = old;
+	}
+
+	/* Hand out an object never used before */
+	if (atomic_read(&esdm_rpcs_pool_fresh) < ESDM_RPCS_POOL_SIZE) {
+		fresh = atomic_inc(&esdm_rpcs_pool_fresh);
+		if (fresh <= ESDM_RPCS_POOL_SIZE) {
+			/* The pool object is used from now on */
+			esdm_mem_account(esdm_mem_rpc_conn,
+					 sizeof(struct esdm_rpcs_connection));
+			rpc_conn = &esdm_rpcs_pool[fresh - 1];
+			goto out;
+		}
+	}
+
+	/* The pool is exhausted */
+	rpc_conn = calloc(1, sizeof(struct esdm_rpcs_connection));
+	if (rpc_conn) {
+		atomic_inc(&esdm_rpcs_pool_heap);
+		esdm_mem_account(esdm_mem_rpc_conn,
+				 sizeof(struct esdm_rpcs_connection));
+	}
+	return rpc_conn;
+
+out:
+	atomic_inc(&esdm_rpcs_pool_in_use);
+	return rpc_conn;
+}
+
+static void esdm_rpcs_release_conn(struct esdm_rpcs_connection *rpc_conn)
+{
+	uint64_t head, new, old;
+	uint32_t idx;
+
+	if (!rpc_conn)
+		return;
+	if (rpc_conn->child_fd >= 0)
+		close(rpc_conn->child_fd);
+	esdm_rpcs_io_release(rpc_conn);
+
+	if (!esdm_rpcs_pool_owns(rpc_conn)) {
+		atomic_dec(&esdm_rpcs_pool_heap);
+		free(rpc_conn);
+		esdm_mem_account(esdm_mem_rpc_conn,
+				 -(int64_t)sizeof(struct esdm_rpcs_connection));
+		return;
+	}
+
+	/* Reset the connection state, the buffers are already cleared */
+	memset(rpc_conn, 0, offsetof(struct esdm_rpcs_connection, pool_next));
+	idx = (uint32_t)(rpc_conn - esdm_rpcs_pool);
+
+	head = (uint64_t)atomic_read_64(&esdm_rpcs_pool_head);
+	for (;;) {
+		rpc_conn->pool_next = (uint32_t)(head & ESDM_RPCS_POOL_IDX_MASK);
+		new = (((head >> 32) + 1) << 32) | (idx + 1);
+		old = (uint64_t)atomic_cmpxchg_64(&esdm_rpcs_pool_head,
+						  (long long)head,
+						  (long long)new);
+		if (old == head)
+			break;
+		head = old;
+	}
+
+	atomic_dec(&esdm_rpcs_pool_in_use);
+}
+
+unsigned int esdm_rpc_server_connections(void)
+{
+	return (unsigned int)(atomic_read(&esdm_rpcs_pool_in_use) +
+			      atomic_read(&esdm_rpcs_pool_heap));
+}
+
+void esdm_rpc_server_status(char *buf, size_t buflen)
+{
+	snprintf(buf, buflen,
+		 "RPC connection pool size: %u\n"
+		 " Pool objects in use: %d\n"
+		 " Pool objects recycled: %d\n"
+		 " Heap allocated objects in use: %d\n"
+		 " Parked idle connections: %d\n"
+		 " Requests waiting for seeding: %d\n",
+		 ESDM_RPCS_POOL_SIZE, atomic_read(&esdm_rpcs_pool_in_use),
+		 atomic_read(&esdm_rpcs_pool_recycled),
+		 atomic_read(&esdm_rpcs_pool_heap),
+		 atomic_read(&esdm_rpcs_parked_num),
+		 atomic_read(&esdm_rpcs_seed_wait_num));
+#if (ESDM_RPCS_ADMISSION_TIMEOUT > 0)
+	snprintf(buf + strlen(buf), buflen - strlen(buf),
+		 " Connections shed due to overload: %d\n",
+		 atomic_read(&esdm_rpcs_shed_num));
+#endif
+
+	esdm_rpcs_batch_status(buf + strlen(buf), buflen - strlen(buf));
+	esdm_rpcs_throttle_status(buf + strlen(buf), buflen - strlen(buf));
+
+	/* The DRNG latency is part of esdm_status */
+	esdm_rpcs_lat_status(buf + strlen(buf), buflen - strlen(buf));
+	esdm_lock_stats_status(buf + strlen(buf), buflen - strlen(buf));
+	esdm_rpcs_audit_status(buf + strlen(buf), buflen - strlen(buf));
+}
+
+void esdm_rpc_server_latency_status(char *buf, size_t buflen)
+{
+	size_t len;
+
+	if (!buflen)
+		return;
+	buf[0] = '\0';
+
+	esdm_rpcs_lat_status(buf, buflen);
+	len = strlen(buf);
+	esdm_latency_status(buf + len, buflen - len);
+}
+
+#ifdef ESDM_METRICS
+
+static void esdm_rpcs_metrics_methods(struct esdm_metrics_buf *mb,
+				      const ProtobufCServiceDescriptor *desc,
+				      const char *service, unsigned int base)
+{
+	unsigned int i;
+
+	for (i = 0; i < desc->n_methods && i < ESDM_RPCS_LAT_METHODS; i++) {
+		esdm_metrics_printf(
+			mb,
+			"esdm_rpc_requests_total{service=\"%s\",method=\"%s\"} %llu\n",
+			service, desc->methods[i].name,
+			(unsigned long long)esdm_metrics_read(
+				&esdm_rpcs_requests,
+				base - ESDM_RPCS_LAT_UNPRIV + i));
+	}
+}
+
+#ifdef ESDM_LATENCY_STATS
+static void esdm_rpcs_metrics_lat(struct esdm_metrics_buf *mb,
+				  const ProtobufCServiceDescriptor *desc,
+				  const char *service, unsigned int base)
+{
+	char labels[128];
+	unsigned int i;
+
+	for (i = 0; i < desc->n_methods && i < ESDM_RPCS_LAT_METHODS; i++) {
+		snprintf(labels, sizeof(labels),
+			 "service=\"%s\",method=\"%s\"", service,
+			 desc->methods[i].name);
+		esdm_lat_openmetrics(&esdm_rpcs_lat, base + i,
+				     "esdm_rpc_method_latency_seconds", labels,
+				     mb);
+	}
+}
+#endif
+
+size_t esdm_rpc_server_metrics(char *buf, size_t buflen)
+{
+	static const char *const stages[esdm_rpcs_lat_stages] = {
+		[esdm_rpcs_lat_recv] = "stage=\"receive\"",
+		[esdm_rpcs_lat_unpack] = "stage=\"unpack\"",
+		[esdm_rpcs_lat_handler] = "stage=\"handler\"",
+		[esdm_rpcs_lat_pack] = "stage=\"pack\"",
+		[esdm_rpcs_lat_send] = "stage=\"send\"",
+	};
+	struct esdm_metrics_buf mb = { .buf = buf, .len = 0, .size = buflen };
+	unsigned int busy, total, queued, i;
+
+	if (!buflen)
+		return 0;
+	buf[0] = '\0';
+
+	esdm_metrics_printf(&mb, "# TYPE esdm_rpc_requests counter\n"
+				 "# HELP esdm_rpc_requests Processed RPC "
+				 "requests\n");
+	esdm_rpcs_metrics_methods(&mb, &unpriv_access__descriptor, "unpriv",
+				  ESDM_RPCS_LAT_UNPRIV);
+	esdm_rpcs_metrics_methods(&mb, &priv_access__descriptor, "priv",
+				  ESDM_RPCS_LAT_PRIV);
+
+	thread_usage(&busy, &total, &queued);
+	esdm_metrics_printf(&mb,
+			    "# TYPE esdm_thread_pool_threads gauge\n"
+			    "esdm_thread_pool_threads %u\n"
+			    "# TYPE esdm_thread_pool_busy_threads gauge\n"
+			    "esdm_thread_pool_busy_threads %u\n"
+			    "# TYPE esdm_thread_pool_queued_jobs gauge\n"
+			    "esdm_thread_pool_queued_jobs %u\n"
+			    "# TYPE esdm_rpc_connections gauge\n"
+			    "esdm_rpc_connections %d\n",
+			    total, busy, queued,
+			    atomic_read(&esdm_rpcs_pool_in_use));
+#if (ESDM_RPCS_ADMISSION_TIMEOUT > 0)
+	esdm_metrics_printf(&mb,
+			    "# TYPE esdm_rpc_shed_connections counter\n"
+			    "# HELP esdm_rpc_shed_connections Connections "
+			    "rejected while the server is overloaded\n"
+			    "esdm_rpc_shed_connections_total %d\n",
+			    atomic_read(&esdm_rpcs_shed_num));
+#endif
+	esdm_rpcs_throttle_metrics(&mb);
+
+#ifdef ESDM_LATENCY_STATS
+	esdm_metrics_printf(&mb,
+			    "# TYPE esdm_rpc_stage_latency_seconds histogram\n"
+			    "# HELP esdm_rpc_stage_latency_seconds Latency of "
+			    "the RPC processing stages\n");
+	for (i = 0; i < esdm_rpcs_lat_stages; i++)
+		esdm_lat_openmetrics(&esdm_rpcs_lat, i,
+				     "esdm_rpc_stage_latency_seconds",
+				     stages[i], &mb);
+
+	esdm_metrics_printf(
+		&mb, "# TYPE esdm_rpc_method_latency_seconds histogram\n"
+		     "# HELP esdm_rpc_method_latency_seconds Latency of the "
+		     "RPC requests\n");
+	esdm_rpcs_metrics_lat(&mb, &unpriv_access__descriptor, "unpriv",
+			      ESDM_RPCS_LAT_UNPRIV);
+	esdm_rpcs_metrics_lat(&mb, &priv_access__descriptor, "priv",
+			      ESDM_RPCS_LAT_PRIV);
+#else
+	(void)stages;
+	(void)i;
+#endif
+
+	/* DRNG and ES counters of the ESDM library */
+	if (mb.len < mb.size)
+		mb.len += esdm_metrics(buf + mb.len, mb.size - mb.len);
+
+	esdm_metrics_printf(&mb, "# EOF\n");
+
+	return mb.len;
+}
+
+#endif /* ESDM_METRICS */
+
+#if defined(ESDM_RPCS_PARKING) || defined(ESDM_RPCS_REACTOR)
+/* Time base of the idle tracking of the parked and reactor connections */
+static time_t esdm_rpcs_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+#endif
+
+#ifdef ESDM_RPCS_PARKING
+
+/*
+ * Parking of idle connections: once a client has no further request pending,
+ * its connection is added to a shared epoll set and the handler thread
+ * returns to the thread pool. The parking thread dispatches the connection
+ * to a handler again when the next request arrives. Thus, persistent but idle
+ * connections do not occupy a thread.
+ */
+#define ESDM_RPCS_PARK_EVENTS 64
+/* Idle time in seconds after which a parked connection is closed */
+#define ESDM_RPCS_PARK_IDLE_SEC 30
+/* Beyond this number of parked connections, the handler keeps waiting */
+#define ESDM_RPCS_PARK_MAX ((int)(4 * thread_max_threads()))
+
+static struct esdm_rpcs_connection *esdm_rpcs_parked = NULL;
+static DEFINE_MUTEX_W_UNLOCKED(esdm_rpcs_park_lock);
+static int esdm_rpcs_park_epfd = -1;
+
+/*
+ * Requests for random bytes from a fully seeded ESDM which arrive before the
+ * ESDM is operational and requests waiting for a seed state are parked with
+ * their connection on the seed wait list instead of blocking a thread. The
+ * ESDM notifies the parking thread of every seed state change with the
+ * esdm_rpcs_seed_wait_efd event FD. The parking thread then dispatches the
+ * connections whose seed states are reached or whose timeout expired to a
+ * handler again. Without the event FD, the seed state is checked every
+ * ESDM_RPCS_SEED_WAIT_POLL_MS while requests are waiting.
+ */
+#define ESDM_RPCS_SEED_WAIT_POLL_MS 50
+
+static struct esdm_rpcs_connection *esdm_rpcs_seed_waiters = NULL;
+static int esdm_rpcs_seed_wait_efd = -1;
+
+static int esdm_rpcs_dispatch(struct esdm_rpcs_connection *rpc_conn);
+
+/* Caller must hold esdm_rpcs_park_lock */
+static void esdm_rpcs_park_unlink(struct esdm_rpcs_connection *rpc_conn)
+{
+	if (rpc_conn->prev)
+		rpc_conn->prev->next = rpc_conn->next;
+	else
+		esdm_rpcs_parked = rpc_conn->next;
+	if (rpc_conn->next)
+		rpc_conn->next->prev = rpc_conn->prev;
+	rpc_conn->prev = NULL;
+	rpc_conn->next = NULL;
+	atomic_dec(&esdm_rpcs_parked_num);
+}
+
+/*
+ * Park the connection if the client has no request pending. After a
+ * successful parking, the caller must not touch the connection any more.
+ */
+static bool esdm_rpcs_park(struct esdm_rpcs_connection *rpc_conn)
+{
+	struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP |
+					    EPOLLONESHOT,
+				  .data.ptr = rpc_conn };
+	uint8_t peek;
+	bool parked = false;
+
+	if (esdm_rpcs_park_epfd < 0 ||
+	    atomic_read(&esdm_rpcs_parked_num) >= ESDM_RPCS_PARK_MAX ||
+	    esdm_rpcs_rx_complete(rpc_conn))
+		return false;
+
+	/* A pending request or EOF is processed right away */
+	if (recv(rpc_conn->child_fd, &peek, 1, MSG_PEEK | MSG_DONTWAIT) >= 0 ||
+	    (errno != EAGAIN && errno != EWOULDBLOCK))
+		return false;
+
+	/*
+	 * The lock serializes the registration with the parking thread which
+	 * may receive the event of the connection right away.
+	 */
+	mutex_w_lock(&esdm_rpcs_park_lock);
+	if (!epoll_ctl(esdm_rpcs_park_epfd, EPOLL_CTL_ADD, rpc_conn->child_fd,
+		       &ev)) {
+		rpc_conn->last_activity = esdm_rpcs_now();
+		rpc_conn->prev = NULL;
+		rpc_conn->next = esdm_rpcs_parked;
+		if (esdm_rpcs_parked)
+			esdm_rpcs_parked->prev = rpc_conn;
+		esdm_rpcs_parked = rpc_conn;
+		atomic_inc(&esdm_rpcs_parked_num);
+		parked = true;
+	}
+	mutex_w_unlock(&esdm_rpcs_park_lock);
+
+	return parked;
+}
+
+/* Take the connection off the parking, the caller must hold the lock */
+static void esdm_rpcs_unpark(struct esdm_rpcs_connection *rpc_conn)
+{
+	epoll_ctl(esdm_rpcs_park_epfd, EPOLL_CTL_DEL, rpc_conn->child_fd,
+		  NULL);
+	esdm_rpcs_park_unlink(rpc_conn);
+}
+
+/* Close the parked connections which are idle for too long */
+static void esdm_rpcs_park_idle(time_t now, bool all)
+{
+	struct esdm_rpcs_connection *rpc_conn, *next;
+
+	mutex_w_lock(&esdm_rpcs_park_lock);
+	for (rpc_conn = esdm_rpcs_parked; rpc_conn; rpc_conn = next) {
+		next = rpc_conn->next;
+		if (!all &&
+		    now - rpc_conn->last_activity < ESDM_RPCS_PARK_IDLE_SEC)
+			continue;
+
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Closing parked connection for FD %d\n",
+			    rpc_conn->child_fd);
+		esdm_rpcs_unpark(rpc_conn);
+		esdm_rpcs_release_conn(rpc_conn);
+	}
+	mutex_w_unlock(&esdm_rpcs_park_lock);
+}
+
+static uint64_t esdm_rpcs_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Invoked by the ESDM with every seed state change */
+static void esdm_rpcs_seed_wait_notify(void)
+{
+	uint64_t val = 1;
+	ssize_t ret;
+
+	if (esdm_rpcs_seed_wait_efd < 0)
+		return;
+
+	ret = write(esdm_rpcs_seed_wait_efd, &val, sizeof(val));
+	(void)ret;
+}
+
+static int esdm_rpcs_seed_wait_prepare(struct esdm_rpcs_connection *rpc_conn,
+				       uint32_t states, uint64_t len,
+				       const struct timespec *ts)
+{
+	if (!rpc_conn || !ts || !rpc_conn->seed_wait_allowed ||
+	    esdm_rpcs_park_epfd < 0 || esdm_rpcs_batched(rpc_conn) ||
+	    atomic_read(&esdm_rpcs_seed_wait_num) >= ESDM_RPCS_PARK_MAX)
+		return -EOPNOTSUPP;
+
+	/* A request without timeout does not wait */
+	if (ts->tv_sec <= 0 && ts->tv_nsec <= 0)
+		return -EOPNOTSUPP;
+
+	rpc_conn->seed_wait_states = states;
+	rpc_conn->seed_wait_len = len;
+	rpc_conn->seed_wait_deadline_ns =
+		esdm_rpcs_now_ns() + (uint64_t)ts->tv_sec * 1000000000ULL +
+		(uint64_t)ts->tv_nsec;
+	rpc_conn->seed_wait_pending = true;
+
+	return 0;
+}
+
+int esdm_rpc_server_seed_wait(void *closure_data, uint64_t len,
+			      const struct timespec *ts)
+{
+	return esdm_rpcs_seed_wait_prepare(closure_data,
+					   ESDM_SHM_SEED_OPERATIONAL, len, ts);
+}
+
+int esdm_rpc_server_seed_state_wait(void *closure_data, uint32_t states,
+				    const struct timespec *ts)
+{
+	return esdm_rpcs_seed_wait_prepare(closure_data, states, 0, ts);
+}
+
+/*
+ * Put the connection on the seed wait list if its request waits for the
+ * seeding. After a successful parking, the caller must not touch the
+ * connection any more.
+ */
+static bool esdm_rpcs_seed_wait_park(struct esdm_rpcs_connection *rpc_conn)
+{
+	if (!rpc_conn->seed_wait_pending)
+		return false;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Request on FD %d waits for the ESDM to be seeded\n",
+		    rpc_conn->child_fd);
+
+	mutex_w_lock(&esdm_rpcs_park_lock);
+	rpc_conn->prev = NULL;
+	rpc_conn->next = esdm_rpcs_seed_waiters;
+	if (esdm_rpcs_seed_waiters)
+		esdm_rpcs_seed_waiters->prev = rpc_conn;
+	esdm_rpcs_seed_waiters = rpc_conn;
+	atomic_inc(&esdm_rpcs_seed_wait_num);
+	mutex_w_unlock(&esdm_rpcs_park_lock);
+
+	/* Catch a seed state change since the handler checked the state */
+	esdm_rpcs_seed_wait_notify();
+
+	return true;
+}
+
+/*
+ * Answer the parked request: the request is processed again without timeout
+ * which generates the random bytes or reports the seed state if the ESDM
+ * reached the state now and otherwise behaves like an expired timeout.
+ */
+static int esdm_rpcs_seed_wait_resume(struct esdm_rpcs_connection *rpc_conn)
+{
+	ProtobufCService *service = rpc_conn->proto->service;
+	const ProtobufCMethodDescriptor *method =
+		&service->descriptor->methods[rpc_conn->method_index];
+	GetRandomBytesFullTimeoutRequest request =
+		GET_RANDOM_BYTES_FULL_TIMEOUT_REQUEST__INIT;
+	WaitSeedStateRequest state_request = WAIT_SEED_STATE_REQUEST__INIT;
+
+	rpc_conn->seed_wait_resume = false;
+
+	if (method->input == &wait_seed_state_request__descriptor) {
+		state_request.states = rpc_conn->seed_wait_states;
+		service->invoke(service, rpc_conn->method_index,
+				&state_request.base,
+				esdm_rpcs_response_closure, rpc_conn);
+	} else {
+		request.len = rpc_conn->seed_wait_len;
+		service->invoke(service, rpc_conn->method_index, &request.base,
+				esdm_rpcs_response_closure, rpc_conn);
+	}
+
+	/* Pick up the error from esdm_rpcs_write_data */
+	return (rpc_conn->child_fd == -1) ? -EPIPE : 0;
+}
+
+/*
+ * Dispatch the parked requests if the ESDM reached their seed states or their
+ * timeout expired, all requests are dispatched at termination. The function
+ * returns the earliest deadline of the requests which continue to wait or 0
+ * if no request waits.
+ */
+static uint64_t esdm_rpcs_seed_wait_check(bool all)
+{
+	struct esdm_rpcs_connection *rpc_conn, *next, *ready = NULL;
+	uint64_t now, deadline = 0;
+	uint32_t seed_state;
+
+	if (!atomic_read(&esdm_rpcs_seed_wait_num))
+		return 0;
+
+	seed_state = esdm_shm_status_seed_state();
+	now = esdm_rpcs_now_ns();
+
+	mutex_w_lock(&esdm_rpcs_park_lock);
+	for (rpc_conn = esdm_rpcs_seed_waiters; rpc_conn; rpc_conn = next) {
+		next = rpc_conn->next;
+		if (!all && now < rpc_conn->seed_wait_deadline_ns &&
+		    (seed_state & rpc_conn->seed_wait_states) !=
+			    rpc_conn->seed_wait_states) {
+			if (!deadline ||
+			    rpc_conn->seed_wait_deadline_ns < deadline)
+				deadline = rpc_conn->seed_wait_deadline_ns;
+			continue;
+		}
+
+		if (rpc_conn->prev)
+			rpc_conn->prev->next = rpc_conn->next;
+		else
+			esdm_rpcs_seed_waiters = rpc_conn->next;
+		if (rpc_conn->next)
+			rpc_conn->next->prev = rpc_conn->prev;
+		atomic_dec(&esdm_rpcs_seed_wait_num);
+
+		rpc_conn->prev = NULL;
+		rpc_conn->next = ready;
+		ready = rpc_conn;
+	}
+	mutex_w_unlock(&esdm_rpcs_park_lock);
+
+	for (rpc_conn = ready; rpc_conn; rpc_conn = next) {
+		next = rpc_conn->next;
+		rpc_conn->next = NULL;
+		rpc_conn->seed_wait_pending = false;
+		rpc_conn->seed_wait_resume = true;
+
+		if (esdm_rpcs_dispatch(rpc_conn))
+			esdm_rpcs_release_conn(rpc_conn);
+	}
+
+	return deadline;
+}
+
+/* Time in milliseconds until the parking thread must check the waiters */
+static int esdm_rpcs_seed_wait_timeout(uint64_t deadline)
+{
+	uint64_t now;
+
+	if (!deadline)
+		return 1000;
+	if (esdm_rpcs_seed_wait_efd < 0)
+		return ESDM_RPCS_SEED_WAIT_POLL_MS;
+
+	now = esdm_rpcs_now_ns();
+	if (deadline <= now)
+		return 0;
+
+	/* Round up to not wake up before the deadline */
+	return (int)min_uint64((deadline - now + 999999) / 1000000, 1000);
+}
+
+static int esdm_rpcs_park_workerloop(void *args)
+{
+	struct epoll_event events[ESDM_RPCS_PARK_EVENTS];
+	time_t now, last_sweep = 0;
+	int i, nfds, timeout = 1000;
+
+	(void)args;
+
+	thread_set_name(rpc_park, 0);
+
+	while (atomic_read(&server_exit) == 0) {
+		nfds = epoll_wait(esdm_rpcs_park_epfd, events,
+				  ESDM_RPCS_PARK_EVENTS, timeout);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
+
+			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+				    "Parking: epoll_wait failed: %s\n",
+				    strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < nfds; i++) {
+			struct esdm_rpcs_connection *rpc_conn =
+				events[i].data.ptr;
+
+			/* Seed state change, handled below */
+			if (!rpc_conn) {
+				uint64_t val;
+				ssize_t ret;
+
+				ret = read(esdm_rpcs_seed_wait_efd, &val,
+					   sizeof(val));
+				(void)ret;
+				continue;
+			}
+
+			mutex_w_lock(&esdm_rpcs_park_lock);
+			esdm_rpcs_unpark(rpc_conn);
+			mutex_w_unlock(&esdm_rpcs_park_lock);
+
+			/* Peer is gone without any pending request */
+			if (!(events[i].events & EPOLLIN) ||
+			    esdm_rpcs_dispatch(rpc_conn))
+				esdm_rpcs_release_conn(rpc_conn);
+		}
+
+		timeout = esdm_rpcs_seed_wait_timeout(
+			esdm_rpcs_seed_wait_check(false));
+
+		now = esdm_rpcs_now();
+		if (now != last_sweep) {
+			esdm_rpcs_park_idle(now, false);
+			last_sweep = now;
+		}
+	}
+
+	esdm_rpcs_park_idle(0, true);
+	esdm_rpcs_seed_wait_check(true);
+
+	return 0;
+}
+
+/* Without the event FD, the parking thread polls the seed state */
+static void esdm_rpcs_seed_wait_start(void)
+{
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+
+	esdm_rpcs_seed_wait_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (esdm_rpcs_seed_wait_efd < 0) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Creating seed state event FD failed: %s\n",
+			    strerror(errno));
+		return;
+	}
+
+	if (epoll_ctl(esdm_rpcs_park_epfd, EPOLL_CTL_ADD,
+		      esdm_rpcs_seed_wait_efd, &ev)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Adding seed state event FD failed: %s\n",
+			    strerror(errno));
+		close(esdm_rpcs_seed_wait_efd);
+		esdm_rpcs_seed_wait_efd = -1;
+		return;
+	}
+
+	esdm_shm_status_seed_notifier(esdm_rpcs_seed_wait_notify);
+}
+
+static void esdm_rpcs_park_start(void)
+{
+	esdm_rpcs_park_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (esdm_rpcs_park_epfd < 0) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Creating parking epoll set failed: %s\n",
+			    strerror(errno));
+		return;
+	}
+
+	esdm_rpcs_seed_wait_start();
+
+	if (thread_start(esdm_rpcs_park_workerloop, NULL, 0, NULL)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Starting parking thread failed\n");
+		esdm_shm_status_seed_notifier(NULL);
+		if (esdm_rpcs_seed_wait_efd >= 0) {
+			close(esdm_rpcs_seed_wait_efd);
+			esdm_rpcs_seed_wait_efd = -1;
+		}
+		close(esdm_rpcs_park_epfd);
+		esdm_rpcs_park_epfd = -1;
+	}
+}
+
+#else /* ESDM_RPCS_PARKING */
+
+static inline bool esdm_rpcs_park(struct esdm_rpcs_connection *rpc_conn)
+{
+	(void)rpc_conn;
+	return false;
+}
+
+int esdm_rpc_server_seed_wait(void *closure_data, uint64_t len,
+			      const struct timespec *ts)
+{
+	(void)closure_data;
+	(void)len;
+	(void)ts;
+	return -EOPNOTSUPP;
+}
+
+int esdm_rpc_server_seed_state_wait(void *closure_data, uint32_t states,
+				    const struct timespec *ts)
+{
+	(void)closure_data;
+	(void)states;
+	(void)ts;
+	return -EOPNOTSUPP;
+}
+
+static inline bool
+esdm_rpcs_seed_wait_park(struct esdm_rpcs_connection *rpc_conn)
+{
+	(void)rpc_conn;
+	return false;
+}
+
+static inline int
+esdm_rpcs_seed_wait_resume(struct esdm_rpcs_connection *rpc_conn)
+{
+	(void)rpc_conn;
+	return 0;
+}
+
+static inline void esdm_rpcs_park_start(void)
+{
+}
+
+#endif /* ESDM_RPCS_PARKING */
+
+#ifndef ESDM_TINY_FOOTPRINT
+
+/* Thread main for receiving a new connection and process it. */
+static int esdm_rpcs_handler(void *args)
+{
+	struct esdm_rpcs_connection *rpc_conn = args;
+	int ret = 0;
+
+	thread_set_name(rpc_handler, (uint32_t)rpc_conn->child_fd);
+	esdm_cpu_class_bind(esdm_cpu_class_performance);
+	rpc_conn->seed_wait_allowed = true;
+
+	/*
+	 * Loop reusing the existing connection. When an error is received,
+	 * the communication is considered to be severed and the child FD can
+	 * be released. A connection handed over from the fast lane may have
+	 * a random byte stream pending.
+	 */
+	do {
+		/* Answer the request which waited for the seeding */
+		if (rpc_conn->seed_wait_resume)
+			ret = esdm_rpcs_seed_wait_resume(rpc_conn);
+
+		/* Push the frames of a random byte stream */
+		while (!ret && rpc_conn->stream_active)
+			ret = esdm_rpcs_stream_frame(rpc_conn);
+		if (ret)
+			break;
+
+		/* Release the thread while the client is idle */
+		if (esdm_rpcs_park(rpc_conn))
+			return 0;
+
+		ret = esdm_rpcs_read(rpc_conn);
+
+		/* Release the thread while the request waits for the seeding */
+		if (!ret && esdm_rpcs_seed_wait_park(rpc_conn))
+			return 0;
+	} while (!ret);
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Closing incoming connection for FD %d\n",
+		    rpc_conn->child_fd);
+	esdm_rpcs_release_conn(rpc_conn);
+	return 0;
+}
+
+/*
+ * Priority lanes: the privileged interface and the cheap status queries of
+ * the unprivileged interface are served by reserved threads which are not
+ * occupied by the bulk generate requests. A privileged connection stays on
+ * its reserved thread. An unprivileged connection starts on the fast lane
+ * and moves to the thread pool with its first request which is not a status
+ * query. If the reserved thread is busy, the connection is served by the
+ * thread pool right away.
+ */
+static const char *const esdm_rpcs_fast_methods[] = {
+	"RpcStatus",
+	"RpcStatusBin",
+	"RpcGetEntLvl",
+	"RpcIsMinSeeded",
+	"RpcIsFullySeeded",
+	"RpcRndGetEntCnt",
+	"RpcGetPoolsize",
+	"RpcGetWriteWakeupThresh",
+	"RpcGetMinReseedSecs",
+	"RpcNegotiate",
+};
+
+/* Was the last request of the connection a cheap status query? */
+static bool esdm_rpcs_fast_method(struct esdm_rpcs_connection *rpc_conn)
+{
+	const ProtobufCServiceDescriptor *desc =
+		rpc_conn->proto->service->descriptor;
+	unsigned int i;
+
+	if (rpc_conn->stream_active ||
+	    rpc_conn->method_index >= desc->n_methods)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(esdm_rpcs_fast_methods); i++) {
+		if (!strcmp(desc->methods[rpc_conn->method_index].name,
+			    esdm_rpcs_fast_methods[i]))
+			return true;
+	}
+
+	return false;
+}
+
+/* Fast lane thread main serving a connection as long as it queries status */
+static int esdm_rpcs_fast_handler(void *args)
+{
+	struct esdm_rpcs_connection *rpc_conn = args;
+	int ret;
+
+	thread_set_name(rpc_handler, (uint32_t)rpc_conn->child_fd);
+	esdm_cpu_class_bind(esdm_cpu_class_performance);
+	rpc_conn->seed_wait_allowed = true;
+
+	do {
+		/* Answer the request which waited for the seeding */
+		if (rpc_conn->seed_wait_resume) {
+			ret = esdm_rpcs_seed_wait_resume(rpc_conn);
+			if (ret)
+				break;
+		}
+
+		/* Release the fast lane while the client is idle */
+		if (esdm_rpcs_park(rpc_conn))
+			return 0;
+
+		ret = esdm_rpcs_read(rpc_conn);
+		if (ret)
+			break;
+
+		/* Release the fast lane while the request waits for seeding */
+		if (esdm_rpcs_seed_wait_park(rpc_conn))
+			return 0;
+
+		if (esdm_rpcs_fast_method(rpc_conn))
+			continue;
+
+		/* Hand the connection over to the thread pool */
+		rpc_conn->bulk = true;
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Moving connection for FD %d to the thread pool\n",
+			    rpc_conn->child_fd);
+		ret = thread_start(esdm_rpcs_handler, rpc_conn, 0, NULL);
+		if (!ret)
+			return 0;
+	} while (!ret);
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Closing incoming connection for FD %d\n",
+		    rpc_conn->child_fd);
+	esdm_rpcs_release_conn(rpc_conn);
+	return 0;
+}
+
+static int esdm_rpcs_dispatch(struct esdm_rpcs_connection *rpc_conn)
+{
+	if (rpc_conn->proto->privileged_only) {
+		if (!thread_trystart(esdm_rpcs_handler, rpc_conn,
+				     ESDM_THREAD_RPC_PRIV_GROUP))
+			return 0;
+	} else if (!rpc_conn->bulk &&
+		   !thread_trystart(esdm_rpcs_fast_handler, rpc_conn,
+				    ESDM_THREAD_RPC_FAST_GROUP)) {
+		return 0;
+	}
+
+	return thread_start(esdm_rpcs_handler, rpc_conn, 0, NULL);
+}
+
+#if (ESDM_RPCS_ADMISSION_TIMEOUT > 0)
+
+/*
+ * Admission control of new connections on the unprivileged interface: if no
+ * handler thread becomes available within the admission timeout, the server
+ * is overloaded. While overloaded, new connections are answered right away
+ * with PROTOBUF_C_RPC_STATUS_CODE_TOO_MANY_PENDING and closed instead of
+ * letting them wait for a handler until the client times out. The overload
+ * ends with the first new connection obtaining a handler without waiting.
+ * Admitted connections, e.g. parked ones, are never shed.
+ */
+static atomic_t esdm_rpcs_overloaded = ATOMIC_INIT(0);
+
+static void esdm_rpcs_shed(struct esdm_rpcs_connection *rpc_conn)
+{
+	struct esdm_rpc_proto_sc_header sc_header = { 0 };
+	ssize_t ret;
+
+	/* The header is not bound to a request as none was read yet */
+	sc_header.status_code =
+		le_bswap32(PROTOBUF_C_RPC_STATUS_CODE_TOO_MANY_PENDING);
+	ret = send(rpc_conn->child_fd, &sc_header, sizeof(sc_header),
+		   MSG_NOSIGNAL | MSG_DONTWAIT);
+	(void)ret;
+
+	atomic_inc(&esdm_rpcs_shed_num);
+}
+
+static int esdm_rpcs_admit(struct esdm_rpcs_connection *rpc_conn)
+{
 	int ret;
 
-	CKINT_LOG(esdm_rpcs_pack(message, rpc_conn),
-		  "Failed to serialize response: %d\n", ret);
+	if (rpc_conn->proto->privileged_only) {
+		ret = esdm_rpcs_dispatch(rpc_conn);
+		goto out;
+	}
+
+	ret = thread_trystart(esdm_rpcs_fast_handler, rpc_conn,
+			      ESDM_THREAD_RPC_FAST_GROUP);
+	if (ret)
+		ret = thread_trystart(esdm_rpcs_handler, rpc_conn, 0);
+
+	if (ret == -EAGAIN && !atomic_read(&esdm_rpcs_overloaded)) {
+		ret = thread_start_timeout(esdm_rpcs_handler, rpc_conn, 0,
+					   ESDM_RPCS_ADMISSION_TIMEOUT);
+		if (ret == -EAGAIN) {
+			atomic_set(&esdm_rpcs_overloaded, 1);
+			esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+				    "ESDM server overloaded, shedding new connections\n");
+		}
+	}
+
+	if (ret == -EAGAIN) {
+		esdm_rpcs_shed(rpc_conn);
+		return ret;
+	}
+
+	if (!ret && atomic_xchg(&esdm_rpcs_overloaded, 0)) {
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+			    "ESDM server no longer overloaded\n");
+	}
+
+out:
+	if (ret) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Starting new thread for incoming connection failed\n");
+	}
+	return ret;
+}
+
+#else /* ESDM_RPCS_ADMISSION_TIMEOUT */
+
+static int esdm_rpcs_admit(struct esdm_rpcs_connection *rpc_conn)
+{
+	int ret = esdm_rpcs_dispatch(rpc_conn);
+
+	if (ret) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Starting new thread for incoming connection failed\n");
+	}
+
+	return ret;
+}
+
+#endif /* ESDM_RPCS_ADMISSION_TIMEOUT */
+
+#endif /* ESDM_TINY_FOOTPRINT */
+
+/*
+ * Setting the socket timeouts implies that a client cannot block the thread
+ * processing its request by leaving a partially sent request in the socket.
+ */
+static int esdm_rpcs_set_timeout(struct esdm_rpcs_connection *rpc_conn)
+{
+	/*
+	 * The reason for using a timeout here is to only wait for a
+	 * given amount of time for activity on the FD. After the
+	 * timeout, the file descriptor is closed. If an attacker
+	 * starts connections, he could leave them open and thus
+	 * starve other callers. By timing out on a read the server
+	 * tries to avert such attack scenarios. This is the price
+	 * to pay for not using malloc and a thread-local storage
+	 * buffer.
+	 */
+	struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+
+	if (setsockopt(rpc_conn->child_fd, SOL_SOCKET, SO_RCVTIMEO,
+		       (const char *)&tv, sizeof(tv)) < 0 ||
+	    setsockopt(rpc_conn->child_fd, SOL_SOCKET, SO_SNDTIMEO,
+		       (const char *)&tv, sizeof(tv)) < 0) {
+		int errsv = errno;
 
-out:
-	return;
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Error setting timeout on socket: %s\n",
+			    strerror(errsv));
+		return -errsv;
+	}
+
+	return 0;
 }
 
-/* Unpack the received data and invoke the intended ProtobufC handler. */
-static int esdm_rpcs_unpack(struct esdm_rpcs_connection *rpc_conn,
-			    struct esdm_rpc_proto_cs *received_data)
+#ifdef ESDM_RPCS_REACTOR
+
+/*
+ * Event-driven RPC server: A reactor waits for activity on the listening
+ * socket and all connections it owns with epoll. The connections use
+ * non-blocking sockets: a request is received as far as the peer sent it and
+ * is only processed once it is complete, a response frame the socket cannot
+ * take right now is queued until the socket has space again. A connection
+ * leaving a partial request or not consuming its responses is closed after
+ * the idle time. Requests which may wait for the seeding or for entropy are
+ * handed to the thread pool with their connection, so that the processing of
+ * a request does not block the reactor. The single thread of the tiny
+ * footprint has no thread pool and serves them itself.
+ *
+ * All reactors of one interface share the listening socket. The
+ * EPOLLEXCLUSIVE flag ensures that only one reactor is woken up for a new
+ * connection. Note, SO_REUSEPORT is not applicable to Unix domain sockets
+ * which implies that a separate listener per reactor is not possible.
+ */
+#define ESDM_RPCS_REACTOR_EVENTS 64
+/* Idle time in seconds after which a connection is closed */
+#define ESDM_RPCS_REACTOR_IDLE_SEC 2
+
+struct esdm_rpcs_reactor {
+	struct esdm_rpcs *proto;
+	/* Privileged interface served by the reactor as well, if any */
+	struct esdm_rpcs *priv_proto;
+	struct esdm_rpcs_connection *conns;
+	/* Invoked about once a second in the context of the reactor */
+	void (*tick)(void);
+	int epoll_fd;
+	uint32_t id;
+};
+
+static void esdm_rpcs_reactor_unlink(struct esdm_rpcs_reactor *reactor,
+				     struct esdm_rpcs_connection *rpc_conn)
 {
-	const ProtobufCMessageDescriptor *desc;
-	struct esdm_rpcs *proto = rpc_conn->proto;
-	ProtobufCService *service = proto->service;
-	ProtobufCMessage *message = NULL;
-	struct esdm_rpc_proto_cs_header *header = &received_data->header;
-	uint32_t method_index = header->method_index;
-	int ret;
+	if (rpc_conn->prev)
+		rpc_conn->prev->next = rpc_conn->next;
+	else
+		reactor->conns = rpc_conn->next;
+	if (rpc_conn->next)
+		rpc_conn->next->prev = rpc_conn->prev;
+	rpc_conn->prev = NULL;
+	rpc_conn->next = NULL;
+}
 
-	CKINT(esdm_rpc_proto_get_descriptor(service, received_data, &desc));
-	message = protobuf_c_message_unpack(desc, rpc_conn->rpc_allocator,
-					    header->message_length,
-					    received_data->data);
+/* Remove a connection from the reactor and release it. */
+static void esdm_rpcs_reactor_del(struct esdm_rpcs_reactor *reactor,
+				  struct esdm_rpcs_connection *rpc_conn)
+{
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Reactor %u: closing incoming connection for FD %d\n",
+		    reactor->id, rpc_conn->child_fd);
 
-	CKNULL(message, -ENOMEM);
+	esdm_rpcs_reactor_unlink(reactor, rpc_conn);
 
-	rpc_conn->method_index = method_index;
-	rpc_conn->request_id = header->request_id;
+	/* Closing the FD implicitly removes it from the epoll set. */
+	esdm_rpcs_release_conn(rpc_conn);
+}
 
-	/* Invoke the RPC call */
-	service->invoke(service, method_index, message,
-			esdm_rpcs_response_closure, rpc_conn);
+/*
+ * Wait for further requests or - while response frames are queued or a random
+ * byte stream is pushed - for space in the socket to send the next frame.
+ */
+static int esdm_rpcs_reactor_mod(struct esdm_rpcs_reactor *reactor,
+				 struct esdm_rpcs_connection *rpc_conn)
+{
+	struct epoll_event ev;
+	bool out = rpc_conn->stream_active || esdm_rpcs_tx_pending(rpc_conn);
 
-out:
-	if (message)
-		protobuf_c_message_free_unpacked(message,
-						 rpc_conn->rpc_allocator);
+	if (out == rpc_conn->epoll_out)
+		return 0;
 
-	/* Pick up the error from esdm_rpcs_write_data */
-	if (rpc_conn->child_fd == -1)
-		ret = -EPIPE;
+	ev.events = (out ? EPOLLOUT : EPOLLIN) | EPOLLRDHUP;
+	ev.data.ptr = rpc_conn;
 
-	return ret;
+	if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, rpc_conn->child_fd,
+		      &ev) < 0)
+		return -errno;
+
+	rpc_conn->epoll_out = out;
+	return 0;
 }
 
-/* Read data from the RPC connection into a local buffer. */
-static int esdm_rpcs_read(struct esdm_rpcs_connection *rpc_conn)
+/*
+ * Receive the records of a request which are available. Returns 1 if the
+ * request is complete, 0 if the reactor waits for further records, < 0 on
+ * error or EOF.
+ */
+static int esdm_rpcs_reactor_recv(struct esdm_rpcs_connection *rpc_conn)
 {
-	/* Read the data into a stack buffer to avoid mallocs. */
-	ProtobufCAllocator esdm_rpc_allocator = {
-		.alloc = &esdm_rpc_alloc,
-		.free = &esdm_rpc_free,
-		.allocator_data = NULL,
-	};
-	BUFFER_INIT(tls);
-	struct esdm_rpc_proto_cs *received_data;
-	uint8_t buf[ESDM_RPC_MAX_MSG_SIZE + sizeof(*received_data)] __aligned(
-		sizeof(uint64_t));
-	uint8_t unpacked[ESDM_RPC_MAX_MSG_SIZE + 128] __aligned(
-		sizeof(uint64_t));
-	size_t total_received = 0;
+	uint8_t *buf = esdm_rpcs_conn_rx_buf(rpc_conn);
+	/* The cast is appropriate as the buffer is aligned to 64 bits. */
+	struct esdm_rpc_proto_cs *received_data =
+		(struct esdm_rpc_proto_cs *)buf;
 	ssize_t received;
-	uint32_t data_to_fetch = 0;
-	int ret;
-	uint8_t *buf_p = buf;
 
-	if (rpc_conn->child_fd < 0)
-		return -EINVAL;
+	for (;;) {
+		received = read(rpc_conn->child_fd, buf + rpc_conn->rx_len,
+				ESDM_RPCS_RX_BUF_SIZE - rpc_conn->rx_len);
+		if (received < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			return -errno;
+		}
 
-	thread_set_name(rpc_handler, (uint32_t)rpc_conn->child_fd);
+		/* Received EOF */
+		if (received == 0)
+			return -EPIPE;
 
-	/* Prepare the allocator to use the stack buffer. */
-	tls.buf = unpacked;
-	tls.len = sizeof(unpacked);
-	esdm_rpc_allocator.allocator_data = &tls;
-	rpc_conn->rpc_allocator = &esdm_rpc_allocator;
+		/* Waiting for the first data of a request is not accounted */
+		if (!rpc_conn->rx_len)
+			rpc_conn->rx_lat_start = esdm_lat_now();
+		rpc_conn->rx_len += (size_t)received;
+
+		/* We insist on having at least a header received. */
+		if (rpc_conn->rx_len >= sizeof(*received_data)) {
+			/* Header is received, analyze it. */
+			if (!rpc_conn->rx_fetch)
+				rpc_conn->rx_fetch = esdm_rpcs_header(
+					rpc_conn, &received_data->header,
+					&rpc_conn->rx_fast);
+
+			if (rpc_conn->rx_len >= rpc_conn->rx_fetch)
+				return 1;
+		}
 
+		if (rpc_conn->rx_len >= ESDM_RPCS_RX_BUF_SIZE)
+			return -EINVAL;
+	}
+
+#ifdef ESDM_TINY_FOOTPRINT
+	/* The shared buffer is needed for the next request of any connection */
+	if (rpc_conn->rx_len && !rpc_conn->rx_partial) {
+		uint8_t *partial = malloc(ESDM_RPCS_RX_BUF_SIZE);
+
+		if (!partial)
+			return -ENOMEM;
+		esdm_mem_account(esdm_mem_rpc_buf, ESDM_RPCS_RX_BUF_SIZE);
+
+		memcpy(partial, buf, rpc_conn->rx_len);
+		memset_secure(buf, 0, rpc_conn->rx_len);
+		rpc_conn->rx_partial = partial;
+	}
+#endif
+
+	return 0;
+}
+
+#ifndef ESDM_TINY_FOOTPRINT
+
+/* Methods whose handlers may wait for the seeding or for entropy */
+static const char *const esdm_rpcs_blocking_methods[] = {
+	"RpcGetRandomBytesFullTimeout",
+	"RpcGetRandomBytesPr",
+	"RpcWaitSeedState",
+};
+
+/* May the processing of the received request block the reactor? */
+static bool esdm_rpcs_reactor_may_block(struct esdm_rpcs_connection *rpc_conn)
+{
+	const ProtobufCServiceDescriptor *desc =
+		rpc_conn->proto->service->descriptor;
 	/* The cast is appropriate as the buffer is aligned to 64 bits. */
-	received_data = (struct esdm_rpc_proto_cs *)buf;
+	const struct esdm_rpc_proto_cs *received_data =
+		(const struct esdm_rpc_proto_cs *)esdm_rpcs_conn_rx_buf(
+			rpc_conn);
+	uint32_t method_index = received_data->header.method_index;
+	unsigned int i;
+
+	/* A compact request is always served without blocking */
+	if (rpc_conn->rx_fast || method_index >= desc->n_methods)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(esdm_rpcs_blocking_methods); i++) {
+		if (!strcmp(desc->methods[method_index].name,
+			    esdm_rpcs_blocking_methods[i]))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Hand the connection with its received request over to the thread pool. The
+ * handler thread may park the request until the ESDM is seeded and serves the
+ * connection from then on with a blocking socket.
+ */
+static void esdm_rpcs_reactor_handoff(struct esdm_rpcs_reactor *reactor,
+				      struct esdm_rpcs_connection *rpc_conn)
+{
+	int flags;
+
+	epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, rpc_conn->child_fd, NULL);
+	esdm_rpcs_reactor_unlink(reactor, rpc_conn);
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Reactor %u: moving connection for FD %d to the thread pool\n",
+		    reactor->id, rpc_conn->child_fd);
+
+	flags = fcntl(rpc_conn->child_fd, F_GETFL);
+	if (flags < 0 ||
+	    fcntl(rpc_conn->child_fd, F_SETFL, flags & ~O_NONBLOCK) < 0 ||
+	    esdm_rpcs_set_timeout(rpc_conn))
+		goto err;
+
+	rpc_conn->nonblock = false;
+	rpc_conn->epoll_out = false;
+	rpc_conn->bulk = true;
+	if (!thread_start(esdm_rpcs_handler, rpc_conn, 0, NULL))
+		return;
+
+err:
+	esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+		    "Reactor %u: handing over connection for FD %d failed\n",
+		    reactor->id, rpc_conn->child_fd);
+	esdm_rpcs_release_conn(rpc_conn);
+}
+
+#endif /* ESDM_TINY_FOOTPRINT */
+
+/*
+ * Serve an event of a connection: queued response frames are sent first,
+ * then one frame of a random byte stream or the next request is processed.
+ * Returns 1 if the connection left the reactor, 0 if it stays with the
+ * reactor, < 0 if it must be closed.
+ */
+static int esdm_rpcs_reactor_event(struct esdm_rpcs_reactor *reactor,
+				   struct esdm_rpcs_connection *rpc_conn,
+				   uint32_t events)
+{
+	int ret;
+
+	if (rpc_conn->epoll_out) {
+		if (!(events & EPOLLOUT) || (events & EPOLLRDHUP))
+			return -EPIPE;
+
+		ret = esdm_rpcs_tx_flush(rpc_conn);
+		if (ret)
+			return (ret < 0) ? ret : 0;
+
+		/*
+		 * Only one frame of a random byte stream is sent per event to
+		 * serve all connections of the reactor.
+		 */
+		if (rpc_conn->stream_active) {
+			ret = esdm_rpcs_stream_frame(rpc_conn);
+			if (ret)
+				return ret;
+		}
+
+		return esdm_rpcs_reactor_mod(reactor, rpc_conn);
+	}
+
+	/* Peer is gone without any pending request */
+	if (!(events & EPOLLIN))
+		return -EPIPE;
+
+	ret = esdm_rpcs_reactor_recv(rpc_conn);
+	if (ret <= 0)
+		return ret;
+
+#ifndef ESDM_TINY_FOOTPRINT
+	if (esdm_rpcs_reactor_may_block(rpc_conn)) {
+		esdm_rpcs_reactor_handoff(reactor, rpc_conn);
+		return 1;
+	}
+#endif
+
+	/*
+	 * The same processing as for the thread-per-connection model. Any
+	 * error severs the connection.
+	 */
+	ret = esdm_rpcs_read(rpc_conn);
+	if (ret)
+		return ret;
+
+	return esdm_rpcs_reactor_mod(reactor, rpc_conn);
+}
+
+/* Accept all pending connections and add them to the reactor. */
+static void esdm_rpcs_reactor_accept(struct esdm_rpcs_reactor *reactor,
+				     struct esdm_rpcs *proto, time_t now)
+{
+	struct esdm_rpcs_connection *rpc_conn;
+	struct epoll_event ev;
+	int fd;
+
+	for (;;) {
+		fd = accept4(proto->server_listening_fd, NULL, NULL,
+			     SOCK_CLOEXEC | SOCK_NONBLOCK);
+		if (fd < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK &&
+			    errno != EINTR) {
+				esdm_logger(
+					LOGGER_WARN, LOGGER_C_ANY,
+					"Accepting incoming connections failed: %s\n",
+					strerror(errno));
+			}
+			return;
+		}
+
+		rpc_conn = esdm_rpcs_alloc_conn();
+		if (!rpc_conn) {
+			close(fd);
+			return;
+		}
+
+		rpc_conn->proto = proto;
+		rpc_conn->child_fd = fd;
+		rpc_conn->nonblock = true;
+
+		if (proto->privileged_only &&
+		    !esdm_rpc_client_is_privileged(rpc_conn)) {
+			esdm_logger(
+				LOGGER_WARN, LOGGER_C_RPC,
+				"Rejecting unprivileged caller on privileged interface\n");
+			esdm_rpcs_release_conn(rpc_conn);
+			continue;
+		}
+
+		ev.events = EPOLLIN | EPOLLRDHUP;
+		ev.data.ptr = rpc_conn;
+		if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+				    "Adding connection to reactor failed: %s\n",
+				    strerror(errno));
+			esdm_rpcs_release_conn(rpc_conn);
+			continue;
+		}
+
+		rpc_conn->last_activity = now;
+		rpc_conn->next = reactor->conns;
+		if (reactor->conns)
+			reactor->conns->prev = rpc_conn;
+		reactor->conns = rpc_conn;
+
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Reactor %u: processing new connection for FD %d\n",
+			    reactor->id, fd);
+	}
+}
+
+/* Close all connections which were idle for too long. */
+static void esdm_rpcs_reactor_idle(struct esdm_rpcs_reactor *reactor,
+				   time_t now)
+{
+	struct esdm_rpcs_connection *rpc_conn = reactor->conns, *next;
+
+	while (rpc_conn) {
+		next = rpc_conn->next;
+		if (now - rpc_conn->last_activity >= ESDM_RPCS_REACTOR_IDLE_SEC)
+			esdm_rpcs_reactor_del(reactor, rpc_conn);
+		rpc_conn = next;
+	}
+}
+
+/* Add a listening socket to the reactor, it is marked with its interface */
+static int esdm_rpcs_reactor_listen(struct esdm_rpcs_reactor *reactor,
+				    struct esdm_rpcs *proto)
+{
+	struct epoll_event ev = { .events = EPOLLIN | EPOLLEXCLUSIVE,
+				  .data.ptr = proto };
+	int ret;
+
+	if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD,
+		      proto->server_listening_fd, &ev) < 0) {
+		ret = -errno;
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Adding listener to reactor %u failed: %s\n",
+			    reactor->id, strerror(-ret));
+		return ret;
+	}
+
+	return 0;
+}
+
+/* Reactor main loop serving all connections of one reactor. */
+static int esdm_rpcs_reactor_loop(struct esdm_rpcs_reactor *reactor)
+{
+	struct epoll_event events[ESDM_RPCS_REACTOR_EVENTS];
+	time_t now, last_sweep = 0;
+	int i, nfds, ret = 0;
+
+	thread_set_name(rpc_reactor, reactor->id);
+	esdm_cpu_class_bind(esdm_cpu_class_performance);
+
+#ifdef ESDM_RPCS_REACTOR_DRNG
+	/* Without it, the shared DRNGs serve the connections of the reactor */
+	if (esdm_drng_thread_own())
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Reactor %u: allocating its DRNG failed\n",
+			    reactor->id);
+#endif
+
+	reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (reactor->epoll_fd < 0) {
+		ret = -errno;
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Creating reactor %u failed: %s\n", reactor->id,
+			    strerror(-ret));
+		goto out_drng;
+	}
+
+	CKINT(esdm_rpcs_reactor_listen(reactor, reactor->proto));
+	if (reactor->priv_proto)
+		CKINT(esdm_rpcs_reactor_listen(reactor, reactor->priv_proto));
+
+	while (atomic_read(&server_exit) == 0) {
+		/*
+		 * Wake up regularly to check for server_exit and to close
+		 * idle connections.
+		 */
+		nfds = epoll_wait(reactor->epoll_fd, events,
+				  ESDM_RPCS_REACTOR_EVENTS, 1000);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
 
-	/* Read the data into the thread-local storage */
-	do {
-		received = read(rpc_conn->child_fd, buf_p,
-				sizeof(buf) - total_received);
-		if (received < 0) {
 			ret = -errno;
+			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+				    "Reactor %u: epoll_wait failed: %s\n",
+				    reactor->id, strerror(-ret));
 			goto out;
 		}
 
-		/* Received EOF */
-		if (received == 0) {
-			ret = -EAGAIN;
-			goto out;
+		now = esdm_rpcs_now();
+
+		for (i = 0; i < nfds; i++) {
+			struct esdm_rpcs_connection *rpc_conn;
+			void *ptr = events[i].data.ptr;
+
+			/* Listeners are marked with their interface */
+			if (ptr == reactor->proto || ptr == reactor->priv_proto) {
+				esdm_rpcs_reactor_accept(reactor, ptr, now);
+				continue;
+			}
+
+			rpc_conn = ptr;
+
+			ret = esdm_rpcs_reactor_event(reactor, rpc_conn,
+						      events[i].events);
+			if (ret < 0)
+				esdm_rpcs_reactor_del(reactor, rpc_conn);
+			else if (!ret)
+				rpc_conn->last_activity = now;
 		}
 
-		total_received += (size_t)received;
-		buf_p += (size_t)received;
+		if (now != last_sweep) {
+			esdm_rpcs_reactor_idle(reactor, now);
+			if (reactor->tick)
+				reactor->tick();
+			last_sweep = now;
+		}
+	}
 
-		esdm_logger(LOGGER_DEBUG, LOGGER_C_ANY,
-			    "Reading %zd bytes, already consumed %zu bytes\n",
-			    received, total_received);
+out:
+	while (reactor->conns)
+		esdm_rpcs_reactor_del(reactor, reactor->conns);
+	close(reactor->epoll_fd);
+	reactor->epoll_fd = -1;
+out_drng:
+#ifdef ESDM_RPCS_REACTOR_DRNG
+	esdm_drng_thread_release();
+#endif
+	return ret;
+}
 
-		/* We insist on having at least a header received. */
-		if (total_received < sizeof(*received_data))
-			continue;
+static int esdm_rpcs_reactor_thread(void *args)
+{
+	struct esdm_rpcs_reactor *reactor = args;
+	int ret = esdm_rpcs_reactor_loop(reactor);
 
-		/* Header is received, analyze it. */
-		if (!data_to_fetch) {
-			struct esdm_rpc_proto_cs_header *header =
-				&received_data->header;
+	free(reactor);
+	return ret;
+}
+
+/*
+ * Event-driven ESDM RPC server worker: the current thread operates one
+ * reactor and spawns the remaining reactors.
+ */
+static int esdm_rpcs_workerloop_reactor(struct esdm_rpcs *proto,
+					uint32_t reactors)
+{
+	struct esdm_rpcs_reactor reactor = { .proto = proto,
+					     .epoll_fd = -1,
+					     .id = 0 };
+	uint32_t i;
+
+	if (proto->server_listening_fd < 0)
+		return -EINVAL;
+	if (!proto->service)
+		return -EINVAL;
+
+	/* Reactors must never block on accept() */
+	set_fd_nonblocking(proto->server_listening_fd);
+
+	for (i = 1; i < reactors; i++) {
+		struct esdm_rpcs_reactor *r = calloc(1, sizeof(*r));
+
+		if (!r)
+			break;
+
+		r->proto = proto;
+		r->epoll_fd = -1;
+		r->id = i;
+		if (thread_start(esdm_rpcs_reactor_thread, r, 0, NULL)) {
+			esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+				    "Starting reactor thread %u failed\n", i);
+			free(r);
+			break;
+		}
+	}
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+		    "Event-driven RPC server with %u reactors started\n", i);
+
+	return esdm_rpcs_reactor_loop(&reactor);
+}
+
+#endif /* ESDM_RPCS_REACTOR */
+
+#ifdef ESDM_RPCS_EXIT_EVENT
+
+/*
+ * Event signalled when the server terminates. It is never consumed and thus
+ * wakes up all worker loops waiting for it together with their listening
+ * socket. Without it, the worker loops check server_exit every second.
+ */
+static int esdm_rpcs_exit_fd = -1;
+
+static void esdm_rpcs_exit_event_init(void)
+{
+#ifdef ESDM_LINUX
+	esdm_rpcs_exit_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (esdm_rpcs_exit_fd < 0) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Creating exit event failed: %s\n",
+			    strerror(errno));
+	}
+#endif
+}
+
+/* Signal the exit event - this call is async-signal-safe */
+static void esdm_rpcs_exit_event_signal(void)
+{
+	uint64_t val = 1;
+	int fd = esdm_rpcs_exit_fd;
 
-			/* Convert incoming data to LE */
-			header->message_length =
-				le_bswap32(header->message_length);
-			header->method_index = le_bswap32(header->method_index);
-			header->request_id = le_bswap32(header->request_id);
+	if (fd >= 0 && write(fd, &val, sizeof(val)) < 0)
+		return;
+}
 
-			esdm_logger(
-				LOGGER_DEBUG, LOGGER_C_RPC,
-				"Server received: message length %u, message index %u, request ID %u\n",
-				header->message_length, header->method_index,
-				header->request_id);
-
-			/*
-			 * Truncate the buffer length if client specified
-			 * too much buffer data.
-			 */
-			if (header->message_length > ESDM_RPC_MAX_MSG_SIZE)
-				header->message_length = ESDM_RPC_MAX_MSG_SIZE;
-
-			/* How much data are we expecting to fetch? */
-			data_to_fetch = header->message_length;
-
-			/* If we are not expecting anything, simply stop now */
-			if (!data_to_fetch)
-				break;
+/*
+ * Wait for an incoming connection or the termination of the server.
+ *
+ * @return 1 if a connection is pending, 0 if the server shall exit, < 0 on
+ *	   error
+ */
+static int esdm_rpcs_wait_conn(struct esdm_rpcs *proto)
+{
+	struct pollfd pfd[2] = {
+		{ .fd = proto->server_listening_fd, .events = POLLIN },
+		/* A negative file descriptor is ignored by poll(2) */
+		{ .fd = esdm_rpcs_exit_fd, .events = POLLIN },
+	};
+	int ret;
 
-			/*
-			 * To allow comparison with total_received, let us
-			 * add the header length to the data to fetch value.
-			 */
-			data_to_fetch += sizeof(*received_data);
+	for (;;) {
+		ret = poll(pfd, 2, esdm_rpcs_exit_fd < 0 ? 1000 : -1);
+		if (ret < 0 && errno != EINTR) {
+			ret = -errno;
+			esdm_logger(LOGGER_ERR, LOGGER_C_ANY,
+				    "Poll returned with error %s\n",
+				    strerror(-ret));
+			return ret;
 		}
 
-		/* Now, we received enough and can stop the reading */
-		if (total_received >= data_to_fetch)
-			break;
-
-	} while (total_received < sizeof(buf));
+		if (atomic_read(&server_exit))
+			return 0;
 
-	/* If we have received insufficient data, bail out now. */
-	if (total_received < sizeof(*received_data) ||
-	    total_received < data_to_fetch) {
-		ret = -EINVAL;
-		goto out;
+		if (ret > 0 && pfd[0].revents)
+			return 1;
 	}
-
-	/*
-	 * We now have a filled buffer that has a header and received
-	 * as much data as the header defined. We also start the
-	 * processing of data and the subsequent submission of the answer here.
-	 */
-	CKINT(esdm_rpcs_unpack(rpc_conn, received_data));
-
-out:
-	/* Clear the memory after processing one request. */
-	memset_secure(buf, 0, total_received);
-	memset_secure(tls.buf, 0, tls.consumed);
-	return ret;
 }
 
-static void esdm_rpcs_release_conn(struct esdm_rpcs_connection *rpc_conn)
+#else /* ESDM_RPCS_EXIT_EVENT */
+
+static inline void esdm_rpcs_exit_event_init(void)
 {
-	if (!rpc_conn)
-		return;
-	if (rpc_conn->child_fd >= 0)
-		close(rpc_conn->child_fd);
-	free(rpc_conn);
 }
 
-/* Thread main for receiving a new connection and process it. */
-static int esdm_rpcs_handler(void *args)
+static inline void esdm_rpcs_exit_event_signal(void)
 {
-	struct esdm_rpcs_connection *rpc_conn = args;
-	int ret;
+}
 
-	/*
-	 * Loop reusing the existing connection. When an error is received,
-	 * the communication is considered to be severed and the child FD can
-	 * be released.
-	 */
-	do {
-		ret = esdm_rpcs_read(rpc_conn);
-	} while (!ret);
+#endif /* ESDM_RPCS_EXIT_EVENT */
 
-	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
-		    "Closing incoming connection for FD %d\n",
-		    rpc_conn->child_fd);
-	esdm_rpcs_release_conn(rpc_conn);
-	return 0;
-}
+#ifndef ESDM_TINY_FOOTPRINT
 
 /* The ESDM RPC server main worker loop. */
 static int esdm_rpcs_workerloop(struct esdm_rpcs *proto)
 {
-	/*
-	 * The reason for using a timeout here is to only wait for a
-	 * given amount of time for activity on the FD. After the
-	 * timeout, the file descriptor is closed. If an attacker
-	 * starts connections, he could leave them open and thus
-	 * starve other callers. By timing out on a read the server
-	 * tries to avert such attack scenarios. This is the price
-	 * to pay for not using malloc and a thread-local storage
-	 * buffer.
-	 */
-	struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
 	struct esdm_rpcs_connection *rpc_conn = NULL;
 	struct sockaddr addr;
 	socklen_t addr_len = sizeof(addr);
@@ -573,12 +3818,10 @@ static int esdm_rpcs_workerloop(struct esdm_rpcs *proto)
 		/*
 		 * Allocate the memory for the thread invocation. This is done
 		 * before the accept() call as now we should have time but
-		 * after the accept() call, we want to be fast.
-		 *
-		 * Note, valgrind will report this buffer as leaked. We accept
-		 * this leak of one block.
+		 * after the accept() call, we want to be fast. Usually, the
+		 * object is taken from the connection pool.
 		 */
-		rpc_conn = calloc(1, sizeof(struct esdm_rpcs_connection));
+		rpc_conn = esdm_rpcs_alloc_conn();
 		if (!rpc_conn) {
 			/* If we are out of memory, terminate our server */
 			if (errno == ENOMEM)
@@ -604,39 +3847,12 @@ static int esdm_rpcs_workerloop(struct esdm_rpcs *proto)
 		 * accept's errno for EINTR and then terminate the loop,
 		 * because other signals than SIGTERM can be received that
 		 * should not immediately terminate the worker loop, undefine
-		 * this macro to use a timer-based wakeup to check for the
-		 * status of server_exit.
+		 * this macro to wait for the exit event together with the
+		 * incoming connections.
 		 */
-#ifndef ESDM_WORKERLOOP_TERM_ON_SIGNAL
-		for (;;) {
-			struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
-			fd_set fds;
-			int sret;
-
-			FD_ZERO(&fds);
-			FD_SET(proto->server_listening_fd, &fds);
-
-			sret = select(proto->server_listening_fd + 1, &fds,
-				      NULL, NULL, &timeout);
-
-			/* error */
-			if (sret == -1 && errno != EINTR) {
-				esdm_logger(LOGGER_ERR, LOGGER_C_ANY,
-					    "Select returned with error %s\n",
-					    strerror(errno));
-				goto out;
-			}
-
-			/* activity */
-			if (sret > 0)
-				break;
-
-			/* timeout - yet server shall exit */
-			if (atomic_read(&server_exit))
-				goto out;
-
-			/* timeout - simply retry */
-		}
+#ifdef ESDM_RPCS_EXIT_EVENT
+		if (esdm_rpcs_wait_conn(proto) <= 0)
+			goto out;
 #endif
 
 		/* Wait for incoming connection */
@@ -663,15 +3879,17 @@ static int esdm_rpcs_workerloop(struct esdm_rpcs *proto)
 			continue;
 		}
 
-		if (setsockopt(rpc_conn->child_fd, SOL_SOCKET, SO_RCVTIMEO,
-			       (const char *)&tv, sizeof(tv)) < 0 ||
-		    setsockopt(rpc_conn->child_fd, SOL_SOCKET, SO_SNDTIMEO,
-			       (const char *)&tv, sizeof(tv)) < 0) {
-			int errsv = errno;
+		if (proto->privileged_only &&
+		    !esdm_rpc_client_is_privileged(rpc_conn)) {
+			esdm_logger(
+				LOGGER_WARN, LOGGER_C_RPC,
+				"Rejecting unprivileged caller on privileged interface\n");
+			esdm_rpcs_release_conn(rpc_conn);
+			rpc_conn = NULL;
+			continue;
+		}
 
-			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
-				    "Error setting timeout on socket: %s\n",
-				    strerror(errsv));
+		if (esdm_rpcs_set_timeout(rpc_conn)) {
 			esdm_rpcs_release_conn(rpc_conn);
 			rpc_conn = NULL;
 			continue;
@@ -689,10 +3907,7 @@ static int esdm_rpcs_workerloop(struct esdm_rpcs *proto)
 		 */
 		esdm_rpcs_handler(rpc_conn);
 #else /* DEBUG */
-		if (thread_start(esdm_rpcs_handler, rpc_conn, 0, NULL)) {
-			esdm_logger(
-				LOGGER_ERR, LOGGER_C_RPC,
-				"Starting new thread for incoming connection failed\n");
+		if (esdm_rpcs_admit(rpc_conn)) {
 			esdm_rpcs_release_conn(rpc_conn);
 			rpc_conn = NULL;
 			continue;
@@ -706,29 +3921,44 @@ out:
 	return ret;
 }
 
+#endif /* ESDM_TINY_FOOTPRINT */
+
 /* Open the socket that we want to use for receiving data. */
 static int esdm_rpcs_start(const char *unix_socket, uint16_t tcp_port,
-			   ProtobufCService *service, struct esdm_rpcs *proto)
+			   uint32_t vsock_port, ProtobufCService *service,
+			   struct esdm_rpcs *proto)
 {
 	struct sockaddr_un addr_un;
 	struct sockaddr_in addr_in;
+#ifdef ESDM_RPCS_VSOCK
+	struct sockaddr_vm addr_vm;
+#endif
 	struct sockaddr *address;
 	int errsv, fd = -1, protocol_family;
 	socklen_t address_len;
 
 	if (unix_socket) {
+		/* Use the socket passed by the service manager */
+		fd = esdm_rpcs_listen_fd(unix_socket);
+		if (fd >= 0) {
+#ifndef ESDM_WORKERLOOP_TERM_ON_SIGNAL
+			set_fd_nonblocking(fd);
+#endif
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+			esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+				    "RPC Server: using activated socket for %s\n",
+				    unix_socket);
+			proto->activated = true;
+			goto out;
+		}
+
 		protocol_family = PF_UNIX;
-		memset(&addr_un, 0, sizeof(addr_un));
-		addr_un.sun_family = AF_UNIX;
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstringop-truncation"
-		strncpy(addr_un.sun_path, unix_socket,
-			sizeof(addr_un.sun_path));
-#pragma GCC diagnostic pop
-		address_len = sizeof(addr_un);
+		address_len = esdm_rpc_unix_addr(&addr_un, unix_socket);
 		address = (struct sockaddr *)(&addr_un);
 
+#ifndef ESDM_RPC_ABSTRACT_SOCKET
 		esdm_rpcs_stale_socket(unix_socket, address, address_len);
+#endif
 	} else if (tcp_port) {
 		protocol_family = PF_INET;
 		memset(&addr_in, 0, sizeof(addr_in));
@@ -736,6 +3966,19 @@ static int esdm_rpcs_start(const char *unix_socket, uint16_t tcp_port,
 		addr_in.sin_port = htons(tcp_port);
 		address_len = sizeof(addr_in);
 		address = (struct sockaddr *)(&addr_in);
+	} else if (vsock_port) {
+#ifdef ESDM_RPCS_VSOCK
+		protocol_family = AF_VSOCK;
+		memset(&addr_vm, 0, sizeof(addr_vm));
+		addr_vm.svm_family = AF_VSOCK;
+		addr_vm.svm_cid = VMADDR_CID_ANY;
+		addr_vm.svm_port = vsock_port;
+		address_len = sizeof(addr_vm);
+		address = (struct sockaddr *)(&addr_vm);
+		proto->remote = true;
+#else
+		return -EOPNOTSUPP;
+#endif
 	} else {
 		return -EINVAL;
 	}
@@ -773,12 +4016,45 @@ static int esdm_rpcs_start(const char *unix_socket, uint16_t tcp_port,
 		return -errsv;
 	}
 
+out:
+	/* The Unix domain sockets are handed over to the next server */
+	if (unix_socket)
+		esdm_rpcs_handover_add_fd(fd);
+
 	proto->server_listening_fd = fd;
 	proto->service = service;
 
 	return 0;
 }
 
+/* Set the file permissions of the Unix domain socket */
+static int esdm_rpcs_set_perm(const struct esdm_rpcs *proto, const char *name,
+			      mode_t mode)
+{
+#ifdef ESDM_RPC_ABSTRACT_SOCKET
+	/* Abstract sockets have no file permissions */
+	(void)proto;
+	(void)name;
+	(void)mode;
+#else
+	/* The service manager defines the permissions of passed sockets */
+	if (proto->activated)
+		return 0;
+
+	if (chmod(name, mode) == -1) {
+		int errsv = errno;
+
+		esdm_logger(
+			LOGGER_ERR, LOGGER_C_ANY,
+			"Failed to set permissions for Unix domain socket %s: %s\n",
+			name, strerror(errsv));
+		return -errsv;
+	}
+#endif
+
+	return 0;
+}
+
 /* Terminating the RPC server. */
 static void eesdm_rpcs_stop(struct esdm_rpcs *proto)
 {
@@ -788,6 +4064,71 @@ static void eesdm_rpcs_stop(struct esdm_rpcs *proto)
 	}
 }
 
+#ifdef ESDM_RPCS_VSOCK
+
+/*
+ * Unprivileged interface for virtual machine guests: the guests obtain random
+ * numbers from the host instead of waiting for their own entropy sources.
+ * Only the unprivileged service is offered to the guests.
+ */
+static struct esdm_rpcs esdm_rpcs_vsock_proto = { .server_listening_fd = -1 };
+
+/* Create the listener - called before the privileges are dropped */
+static void esdm_rpcs_vsock_init(void)
+{
+	if (esdm_rpcs_start(NULL, 0, (uint32_t)ESDM_RPC_VSOCK_PORT,
+			    (ProtobufCService *)&unpriv_access_service,
+			    &esdm_rpcs_vsock_proto)) {
+		/* A host without vsock support still serves local callers */
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "RPC Server: vsock interface on port %u unavailable\n",
+			    (uint32_t)ESDM_RPC_VSOCK_PORT);
+	}
+}
+
+static int esdm_rpcs_vsock_workerloop(void *args)
+{
+	(void)args;
+
+	thread_set_name(rpc_vsock_server, 0);
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Unprivileged server thread for vsock port %u available\n",
+		    (uint32_t)ESDM_RPC_VSOCK_PORT);
+
+#ifdef ESDM_RPCS_REACTOR
+	return esdm_rpcs_workerloop_reactor(&esdm_rpcs_vsock_proto, 1);
+#else
+	return esdm_rpcs_workerloop(&esdm_rpcs_vsock_proto);
+#endif
+}
+
+/* Serve the guests - called after the privileges are dropped */
+static void esdm_rpcs_vsock_start(void)
+{
+	if (esdm_rpcs_vsock_proto.server_listening_fd < 0)
+		return;
+
+	if (thread_start(esdm_rpcs_vsock_workerloop, NULL, 0, NULL)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Starting vsock server thread failed\n");
+		eesdm_rpcs_stop(&esdm_rpcs_vsock_proto);
+	}
+}
+
+#else /* ESDM_RPCS_VSOCK */
+
+static inline void esdm_rpcs_vsock_init(void)
+{
+}
+
+static inline void esdm_rpcs_vsock_start(void)
+{
+}
+
+#endif /* ESDM_RPCS_VSOCK */
+
+#ifndef ESDM_TINY_FOOTPRINT
+
 /* Initialize one thread handling an unprivileged interface instance */
 static int esdm_rpcs_unpriv_init(void *args)
 {
@@ -804,22 +4145,17 @@ static int esdm_rpcs_unpriv_init(void *args)
 	unpriv_proto.server_listening_fd = -1;
 
 	/* Create server handler for privileged interface in main thread */
-	CKINT(esdm_rpcs_start(ESDM_RPC_UNPRIV_SOCKET, 0, unpriv_service,
+	CKINT(esdm_rpcs_start(esdm_rpcs_unpriv_socket, 0, 0, unpriv_service,
 			      &unpriv_proto));
 
 	/* Make unprivileged socket available for all users */
-	if (chmod(ESDM_RPC_UNPRIV_SOCKET,
-		  S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH) ==
-	    -1) {
-		ret = -errno;
-
-		esdm_logger(
-			LOGGER_ERR, LOGGER_C_ANY,
-			"Failed to set permissions for Unix domain socket %s: %s\n",
-			ESDM_RPC_UNPRIV_SOCKET, strerror(errno));
+	CKINT(esdm_rpcs_set_perm(&unpriv_proto, esdm_rpcs_unpriv_socket,
+				 S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP |
+					 S_IROTH | S_IWOTH));
 
-		goto out;
-	}
+	/* Binding privileged vsock and TCP ports requires privileges */
+	esdm_rpcs_vsock_init();
+	esdm_rpcs_metrics_init();
 
 	/* Notify the mother that the unprivileged thread is initialized. */
 	atomic_set(&esdm_rpc_init_state, esdm_rpcs_state_unpriv_init);
@@ -831,10 +4167,23 @@ static int esdm_rpcs_unpriv_init(void *args)
 			   esdm_rpcs_state_perm_dropped));
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
 		    "Unprivileged server thread for %s available\n",
-		    ESDM_RPC_UNPRIV_SOCKET);
+		    esdm_rpcs_unpriv_socket);
+
+	esdm_rpcs_vsock_start();
+	esdm_rpcs_metrics_start();
 
 	/* Server handing unprivileged interface in current thread */
+#ifdef ESDM_RPCS_REACTOR
+#ifdef DEBUG
+	CKINT(esdm_rpcs_workerloop_reactor(&unpriv_proto, 1));
+#else
+	CKINT(esdm_rpcs_workerloop_reactor(
+		&unpriv_proto,
+		min_uint32(ESDM_RPCS_REACTOR_THREADS, thread_max_threads())));
+#endif
+#else
 	CKINT(esdm_rpcs_workerloop(&unpriv_proto));
+#endif
 
 	return 0;
 
@@ -844,6 +4193,19 @@ out:
 	return ret;
 }
 
+#endif /* ESDM_TINY_FOOTPRINT */
+
+/* Log the duration of the startup phases once the server is available */
+static void esdm_rpcs_startup_report(void)
+{
+	char buf[2048];
+
+	esdm_startup_status(buf, sizeof(buf));
+	esdm_logger_status(LOGGER_C_SERVER, "%s", buf);
+}
+
+#ifndef ESDM_TINY_FOOTPRINT
+
 /*
  * Initialize the RPC server interfaces:
  *	* The current thread processes the privileged RPC interface.
@@ -862,20 +4224,19 @@ static int esdm_rpcs_interfaces_init(const char *username)
 	memset(&priv_proto, 0, sizeof(priv_proto));
 
 	/* Create server handler for privileged interface in main thread */
-	CKINT(esdm_rpcs_start(ESDM_RPC_PRIV_SOCKET, 0, priv_service,
+	CKINT(esdm_rpcs_start(esdm_rpcs_priv_socket, 0, 0, priv_service,
 			      &priv_proto));
 
-	/* Make privileged socket available for root only */
-	if (chmod(ESDM_RPC_PRIV_SOCKET, S_IRUSR | S_IWUSR) == -1) {
-		int errsv = errno;
+	/*
+	 * Make privileged socket available for root only - the check of the
+	 * peer credentials also covers sockets without file permissions.
+	 */
+	priv_proto.privileged_only = true;
+	CKINT(esdm_rpcs_set_perm(&priv_proto, esdm_rpcs_priv_socket,
+				 S_IRUSR | S_IWUSR));
 
-		esdm_logger(
-			LOGGER_ERR, LOGGER_C_ANY,
-			"Failed to set permissions for Unix domain socket %s: %s\n",
-			ESDM_RPC_PRIV_SOCKET, strerror(errsv));
-		ret = -errsv;
-		goto out;
-	}
+	/* Idle connections of both interfaces are parked */
+	esdm_rpcs_park_start();
 
 	/* Spawn the thread handling the unprivileged interface */
 	CKINT_LOG(thread_start(esdm_rpcs_unpriv_init, NULL,
@@ -887,15 +4248,25 @@ static int esdm_rpcs_interfaces_init(const char *username)
 			  (atomic_read(&esdm_rpc_init_state) ==
 			   esdm_rpcs_state_unpriv_init));
 
+	/* Binding the hand-over socket before the server is available */
+	esdm_rpcs_handover_init();
+
 	/* Permanently drop all privileges */
+	esdm_startup_begin(esdm_startup_drop_privileges);
 	CKINT(drop_privileges_permanent(username ? username : "nobody"));
+	esdm_startup_end(esdm_startup_drop_privileges);
 
 	/* Notify all unpriv handler threads that they can become active */
 	atomic_set(&esdm_rpc_init_state, esdm_rpcs_state_perm_dropped);
 	thread_wake_all(&esdm_rpc_thread_init_wait);
 	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
 		    "Privileged server thread for %s available\n",
-		    ESDM_RPC_PRIV_SOCKET);
+		    esdm_rpcs_priv_socket);
+
+	esdm_startup_end(esdm_startup_rpc_server);
+	esdm_rpcs_startup_report();
+
+	esdm_rpcs_handover_start();
 
 	/* Server handing privileged interface in current thread */
 	CKINT(esdm_rpcs_workerloop(&priv_proto));
@@ -907,32 +4278,137 @@ out:
 	return ret;
 }
 
-/* Cleanup the RPC server resources - this call needs root privilege. */
-static void esdm_rpcs_cleanup(void)
+#else /* ESDM_TINY_FOOTPRINT */
+
+/* Interval of polling the entropy sources until the ESDM is operational */
+#define ESDM_RPCS_TINY_POLL_NS 500000000L
+
+static void esdm_rpcs_tiny_sleep(void)
 {
-	/* Clean up all unprivileged Unix domain socket */
-	if (unlink(ESDM_RPC_UNPRIV_SOCKET) < 0) {
-		esdm_logger(
-			LOGGER_ERR, LOGGER_C_SERVER,
-			"ESDM Unix domain socket %s cannot be deleted: %s\n",
-			ESDM_RPC_UNPRIV_SOCKET, strerror(errno));
-	} else {
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = ESDM_RPCS_TINY_POLL_NS };
+
+	nanosleep(&ts, NULL);
+}
+
+/* The reactor takes over the duty of the ES monitor thread */
+static void esdm_rpcs_tiny_tick(void)
+{
+	esdm_monitor_poll();
+}
+
+/*
+ * Single-threaded server: the current thread serves both interfaces with one
+ * reactor and polls the entropy sources in between. As no reseeder thread
+ * runs, the DRNG is reseeded in the context of the request. The server only
+ * becomes available once the ESDM is operational as a request waiting for the
+ * seeding would block the only thread.
+ */
+static int esdm_rpcs_tiny_init(const char *username)
+{
+	struct esdm_rpcs priv_proto, unpriv_proto;
+	struct esdm_rpcs_reactor reactor = { .proto = &unpriv_proto,
+					     .priv_proto = &priv_proto,
+					     .tick = esdm_rpcs_tiny_tick,
+					     .epoll_fd = -1,
+					     .id = 0 };
+	int ret;
+
+	memset(&priv_proto, 0, sizeof(priv_proto));
+	memset(&unpriv_proto, 0, sizeof(unpriv_proto));
+	priv_proto.server_listening_fd = -1;
+	unpriv_proto.server_listening_fd = -1;
+
+	/* Complete the privileged initialization of the entropy sources */
+	while (esdm_monitor_poll() == -EAGAIN && !atomic_read(&server_exit))
+		esdm_rpcs_tiny_sleep();
+	atomic_set(&esdm_rpc_init_state, esdm_rpcs_state_priv_init_complete);
+
+	CKINT(esdm_rpcs_start(esdm_rpcs_priv_socket, 0, 0,
+			      (ProtobufCService *)&priv_access_service,
+			      &priv_proto));
+	priv_proto.privileged_only = true;
+	CKINT(esdm_rpcs_set_perm(&priv_proto, esdm_rpcs_priv_socket,
+				 S_IRUSR | S_IWUSR));
+
+	CKINT(esdm_rpcs_start(esdm_rpcs_unpriv_socket, 0, 0,
+			      (ProtobufCService *)&unpriv_access_service,
+			      &unpriv_proto));
+	CKINT(esdm_rpcs_set_perm(&unpriv_proto, esdm_rpcs_unpriv_socket,
+				 S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP |
+					 S_IROTH | S_IWOTH));
+
+	/* Permanently drop all privileges */
+	esdm_startup_begin(esdm_startup_drop_privileges);
+	CKINT(drop_privileges_permanent(username ? username : "nobody"));
+	esdm_startup_end(esdm_startup_drop_privileges);
+	atomic_set(&esdm_rpc_init_state, esdm_rpcs_state_perm_dropped);
+
+	while (!esdm_state_operational() && !atomic_read(&server_exit)) {
+		esdm_monitor_poll();
+		esdm_rpcs_tiny_sleep();
+	}
+
+	esdm_startup_end(esdm_startup_rpc_server);
+	esdm_rpcs_startup_report();
+
+	/* The reactor must never block on accept() */
+	set_fd_nonblocking(priv_proto.server_listening_fd);
+	set_fd_nonblocking(unpriv_proto.server_listening_fd);
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+		    "Single-threaded RPC server for %s and %s available\n",
+		    esdm_rpcs_priv_socket, esdm_rpcs_unpriv_socket);
+
+	CKINT(esdm_rpcs_reactor_loop(&reactor));
+
+out:
+	eesdm_rpcs_stop(&unpriv_proto);
+	eesdm_rpcs_stop(&priv_proto);
+	return ret;
+}
+
+#endif /* ESDM_TINY_FOOTPRINT */
+
+/* Remove a Unix domain socket created by the server */
+static void esdm_rpcs_unlink(const char *name)
+{
+#ifdef ESDM_RPC_ABSTRACT_SOCKET
+	/* Abstract sockets vanish with the closing of the socket */
+	(void)name;
+#else
+	struct sockaddr_un addr;
+	socklen_t addr_len = esdm_rpc_unix_addr(&addr, name);
+
+	/* The service manager owns passed sockets */
+	if (esdm_rpcs_activated_fd(name) >= 0)
+		return;
+
+	/* The socket was handed over to the next server */
+	if (esdm_rpcs_socket_in_use((struct sockaddr *)&addr, addr_len)) {
 		esdm_logger(LOGGER_DEBUG, LOGGER_C_SERVER,
-			    "ESDM Unix domain socket %s deleted\n",
-			    ESDM_RPC_UNPRIV_SOCKET);
+			    "ESDM Unix domain socket %s in use, not deleted\n",
+			    name);
+		return;
 	}
 
-	/* Clean up the privileged Unix domain socket */
-	if (unlink(ESDM_RPC_PRIV_SOCKET) < 0) {
+	if (unlink(name) < 0) {
 		esdm_logger(
 			LOGGER_ERR, LOGGER_C_SERVER,
 			"ESDM Unix domain socket %s cannot be deleted: %s\n",
-			ESDM_RPC_PRIV_SOCKET, strerror(errno));
+			name, strerror(errno));
 	} else {
 		esdm_logger(LOGGER_DEBUG, LOGGER_C_SERVER,
-			    "ESDM Unix domain socket %s deleted\n",
-			    ESDM_RPC_PRIV_SOCKET);
+			    "ESDM Unix domain socket %s deleted\n", name);
 	}
+#endif
+}
+
+/* Cleanup the RPC server resources - this call needs root privilege. */
+static void esdm_rpcs_cleanup(void)
+{
+	/* Clean up all Unix domain sockets */
+	esdm_rpcs_unlink(esdm_rpcs_unpriv_socket);
+	esdm_rpcs_unlink(esdm_rpcs_priv_socket);
 
 	/*
 	 * TODO: we do not clean up the SEM/SHM as there could be a CUSE client
@@ -981,9 +4457,24 @@ static void esdm_rpcs_cleanup_signals(void (*sighandler)(int))
 	signal(SIGTERM, sighandler);
 }
 
+/* Configuration file the server applies again when receiving SIGHUP */
+static const char *esdm_rpcs_config_file = NULL;
+
+void esdm_rpc_server_config_file_set(const char *path)
+{
+	esdm_rpcs_config_file = path;
+}
+
 static void esdm_rpcs_cleanup_term(int sig)
 {
-	(void)sig;
+#ifndef ESDM_TINY_FOOTPRINT
+	/* A reload request is relayed and the cleanup process keeps waiting */
+	if (sig == SIGHUP && esdm_rpcs_config_file) {
+		if (server_pid > 0)
+			kill(server_pid, sig);
+		return;
+	}
+#endif
 
 	esdm_rpcs_cleanup_signals(SIG_DFL);
 
@@ -991,6 +4482,8 @@ static void esdm_rpcs_cleanup_term(int sig)
 		kill(server_pid, sig);
 }
 
+#ifndef ESDM_TINY_FOOTPRINT
+
 static void esdm_rpc_priv_init_complete(void)
 {
 	if (atomic_read(&esdm_rpc_init_state) != esdm_rpcs_state_uninitialized)
@@ -1010,11 +4503,24 @@ static int esdm_rpc_server_es_monitor(void __unused *unused)
 	return esdm_init_monitor(esdm_rpc_priv_init_complete);
 }
 
+static int esdm_rpc_server_reseeder(void __unused *unused)
+{
+	thread_set_name(drng_reseeder, 0);
+
+	return esdm_init_reseeder();
+}
+
+#endif /* ESDM_TINY_FOOTPRINT */
+
 int esdm_rpc_server_init(const char *username)
 {
 	pid_t pid;
 	int ret = 0;
 
+	esdm_startup_begin(esdm_startup_rpc_server);
+
+	esdm_rpcs_socket_names_init();
+
 	/* Enter PID name space */
 	CKINT(linux_isolate_namespace_prefork());
 
@@ -1024,6 +4530,12 @@ int esdm_rpc_server_init(const char *username)
 	/* One thread group */
 	CKINT(thread_init(1));
 
+	/* Both, the server and the cleanup process need the passed sockets */
+	esdm_rpcs_listen_fds_init();
+
+	/* Take over the sockets of a running server if requested */
+	esdm_rpcs_handover_receive();
+
 	pid = fork();
 	if (pid < 0) {
 		esdm_logger(LOGGER_ERR, LOGGER_C_SERVER,
@@ -1032,6 +4544,16 @@ int esdm_rpc_server_init(const char *username)
 	} else if (pid == 0) {
 		pthread_setname_np(pthread_self(), "ESDM master");
 
+		/* Only the server process waits for its termination */
+		esdm_rpcs_exit_event_init();
+
+#ifdef ESDM_TINY_FOOTPRINT
+		/* Serve all interfaces in the current thread */
+		esdm_rpcs_tiny_init(username);
+#else
+		/* Reload the configuration file with SIGHUP */
+		esdm_rpcs_reload_init(esdm_rpcs_config_file);
+
 		/* Create thread for entropy source monitor */
 		if (thread_start(esdm_rpc_server_es_monitor, NULL,
 				 ESDM_THREAD_ES_MONITOR, NULL)) {
@@ -1039,6 +4561,13 @@ int esdm_rpc_server_init(const char *username)
 				    "Starting ES monitor thread failed\n");
 		}
 
+		/* Create thread for reseeding the DRNGs in the background */
+		if (thread_start(esdm_rpc_server_reseeder, NULL,
+				 ESDM_THREAD_DRNG_RESEEDER, NULL)) {
+			esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+				    "Starting DRNG reseeder thread failed\n");
+		}
+
 		/* Wait for the privileged initialization to complete. */
 		thread_wait_event(&esdm_rpc_thread_init_wait,
 				  (atomic_read(&esdm_rpc_init_state) ==
@@ -1046,6 +4575,7 @@ int esdm_rpc_server_init(const char *username)
 
 		/* Fork the server process */
 		esdm_rpcs_interfaces_init(username);
+#endif
 	} else {
 		/*
 		 * This is the cleanup process. It simply waits for the server
@@ -1059,6 +4589,12 @@ int esdm_rpc_server_init(const char *username)
 
 		pthread_setname_np(pthread_self(), "ESDM cleaner");
 
+		/* The server process persists the seed of its DRNGs */
+		esdm_seed_file_release();
+
+		/* Only the server process serves the handed over sockets */
+		esdm_rpcs_handover_release();
+
 		/*
 		 * In case the cleanup process received a signal, relay it to
 		 * the server, but do not process the signal itself.
@@ -1068,6 +4604,7 @@ int esdm_rpc_server_init(const char *username)
 
 		/* Cannot do anything with the return code, ignoring. */
 		esdm_rpcs_linux_init_feeder();
+		esdm_rpcs_kdev_init_feeder();
 
 		/* Now wait for the server to finish. */
 		waitpid(pid, NULL, 0);
@@ -1091,6 +4628,7 @@ void esdm_rpc_server_fini(void)
 
 	atomic_set(&server_exit, 1);
 	thread_wake_all(&esdm_rpc_thread_init_wait);
+	esdm_rpcs_exit_event_signal();
 
 	/* Unblock the accept() in the server loop */
 	thread_send_signal(ESDM_THREAD_RPC_UNPRIV_GROUP, SIGUSR1);
@@ -1103,6 +4641,21 @@ void esdm_rpc_server_fini(void)
 	if (tmp > 1)
 		kill(tmp, SIGTERM);
 
+	/* Release the shared memory random rings */
+	esdm_rpcs_ring_fini();
+
+	/* Insert pending entropy and release the shared memory entropy rings */
+	esdm_rpcs_ent_ring_fini();
+
+	/* Terminate the OpenMetrics exporter */
+	esdm_rpcs_metrics_fini();
+
+	/* Terminate the configuration reload thread */
+	esdm_rpcs_reload_fini();
+
+	/* Terminate the hand-over thread */
+	esdm_rpcs_handover_fini();
+
 	/* Terminate test pertubation support */
 	esdm_test_shm_status_fini();
 
@@ -21,8 +21,11 @@
 #define ESDM_RPC_SERVER_H
 
 #include <protobuf-c/protobuf-c.h>
+#include <sys/types.h>
+#include <time.h>
 
 #include "bool.h"
+#include "esdm_rpc_protocol.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +44,275 @@ extern "C" {
  */
 bool esdm_rpc_client_is_privileged(void *closure_data);
 
+/**
+ * @brief Obtain the UID of the Unix Domain Socket client
+ *
+ * The UID is obtained with getsockopt(SO_PEERCRED).
+ *
+ * @param [in] closure_data Connection of the request
+ * @param [out] uid UID of the peer
+ *
+ * @return 0 on success, < 0 if the peer has no credentials, e.g. a VSOCK peer
+ */
+int esdm_rpc_client_uid(void *closure_data, uid_t *uid);
+
+/**
+ * @brief Pass file descriptors to the RPC client with the next response
+ *
+ * The file descriptors are sent as ancillary data with the response to the
+ * current request. The caller keeps the ownership of the file descriptors and
+ * may close them after the response closure returned.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] fds Array of file descriptors
+ * @param [in] num Number of file descriptors
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpc_server_pass_fds(void *closure_data, const int *fds,
+			     unsigned int num);
+
+/**
+ * @brief Send a successful response carrying random bytes
+ *
+ * The response to a request for random bytes consisting of the return code
+ * and the random bytes (e.g. GetRandomBytesResponse) is sent without copying
+ * the random bytes through protobuf-c: the protobuf data preceding the random
+ * bytes is encoded directly and sent together with the caller's buffer with
+ * one sendmsg call. Random bytes exceeding the first frame are sent with
+ * subsequent frames. The return code of the response is the length of the
+ * random bytes.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] randval Buffer with the random bytes
+ * @param [in] len Length of the random bytes
+ *
+ * @return 0 on success, -EOPNOTSUPP if the response must be sent with the
+ *	   regular response closure, other < 0 on error
+ */
+int esdm_rpc_server_send_randval(void *closure_data, const uint8_t *randval,
+				 size_t len);
+
+/**
+ * @brief Enable the compact wire format on the RPC connection
+ *
+ * All subsequent requests on the connection may use the compact wire format
+ * in addition to the protobuf-c-rpc format.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ *
+ * @return 0 on success, -EOPNOTSUPP if the interface does not offer it
+ */
+int esdm_rpc_server_set_fast_wire(void *closure_data);
+
+/**
+ * @brief Set the CPU hint of the client for all requests of the connection
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] cpu CPU the client runs on
+ *
+ * @return 0 on success, -EOPNOTSUPP if the peer is not on the local system
+ */
+int esdm_rpc_server_set_cpu_hint(void *closure_data, uint32_t cpu);
+
+/**
+ * @brief Check whether the peer of the connection is on the local system
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ *
+ * @return true if the CPU of the peer is meaningful to the server
+ */
+bool esdm_rpc_server_local_peer(void *closure_data);
+
+/**
+ * @brief Send the response to a request in the compact wire format
+ *
+ * The response header and the random bytes are sent with one sendmsg call,
+ * random bytes exceeding the first frame are sent with subsequent frames.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] status Status of the response
+ * @param [in] data Buffer with the random bytes, may be NULL if len is 0
+ * @param [in] len Length of the random bytes
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpc_server_send_fast(void *closure_data, int32_t status,
+			      const uint8_t *data, size_t len);
+
+/**
+ * @brief Name of the RPC method served by a compact wire format method
+ *
+ * @param [in] method Method of the compact request without the magic value
+ *
+ * @return name of the unprivileged RPC method, NULL if the method is unknown
+ */
+const char *esdm_rpc_fast_wire_method(uint32_t method);
+
+/**
+ * @brief Process a request in the compact wire format
+ *
+ * The response is sent with esdm_rpc_server_send_fast.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] request Request header converted to host byte order
+ *
+ * @return 0 on success, < 0 if the connection must be closed
+ */
+int esdm_rpc_fast_wire(void *closure_data,
+		       const struct esdm_rpc_fast_cs *request);
+
+/**
+ * @brief Start a random byte stream on the RPC connection
+ *
+ * The stream is pushed to the client with GetRandomStreamResponse frames once
+ * the RPC handler returned. No further request is processed on the
+ * connection until the stream ended. The stream is terminated with a frame
+ * holding the return code 0 once all requested bytes are sent.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] len Number of bytes to stream, 0 streams until the client
+ *		   closes the connection
+ * @param [in] frame_size Maximum number of bytes per frame, 0 selects the
+ *			  server default
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpc_server_stream_start(void *closure_data, uint64_t len,
+				 uint32_t frame_size);
+
+/**
+ * @brief Wait for the ESDM to become operational without blocking the thread
+ *
+ * The connection is parked after the RPC handler returned until the ESDM is
+ * operational or the timeout expired. Then the request is processed again
+ * with the given length and a zero timeout. The handler must not invoke the
+ * closure if the request is parked.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] len Number of requested random bytes
+ * @param [in] ts Maximum time to wait
+ *
+ * @return 0 if the request is parked, < 0 if the handler must wait itself
+ */
+int esdm_rpc_server_seed_wait(void *closure_data, uint64_t len,
+			      const struct timespec *ts);
+
+/**
+ * @brief Wait for seed states of the ESDM without blocking the thread
+ *
+ * Like esdm_rpc_server_seed_wait, but the connection is parked until all
+ * given seed states are reached or the timeout expired. Then the request is
+ * processed again as a WaitSeedStateRequest with the given states and a zero
+ * timeout.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] states ESDM_SHM_SEED_* flags to wait for
+ * @param [in] ts Maximum time to wait
+ *
+ * @return 0 if the request is parked, < 0 if the handler must wait itself
+ */
+int esdm_rpc_server_seed_state_wait(void *closure_data, uint32_t states,
+				    const struct timespec *ts);
+
+/**
+ * @brief Set the maximum response message size of the RPC connection
+ *
+ * The size applies to all subsequent responses on the connection of the
+ * current request.
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ * @param [in] size Maximum message size between ESDM_RPC_MAX_MSG_SIZE and
+ *		    ESDM_RPC_MAX_NEGOTIATED_MSG_SIZE
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpc_server_set_max_msg_size(void *closure_data, uint32_t size);
+
+/**
+ * @brief Get the maximum amount of data of one response on the RPC connection
+ *
+ * @param [in] closure_data Closure data of the RPC handler
+ *
+ * @return maximum data size
+ */
+size_t esdm_rpc_server_max_data(void *closure_data);
+
+/**
+ * @brief Obtain a buffer for the random bytes of a response
+ *
+ * The buffer is taken from the secure memory pool. If the pool is exhausted,
+ * the caller's stack buffer is used. Random bytes exceeding the stack buffer
+ * are only possible with a negotiated message size, for those, memory is
+ * allocated.
+ *
+ * @param [in] buf Stack buffer of the caller
+ * @param [in] buflen Size of the stack buffer
+ * @param [in] len Number of random bytes to be generated
+ *
+ * @return buffer to be released with esdm_rpc_server_randval_free, NULL on
+ *	   allocation error
+ */
+uint8_t *esdm_rpc_server_randval_alloc(uint8_t *buf, size_t buflen,
+				       size_t len);
+
+/**
+ * @brief Zeroize and release the buffer for the random bytes of a response
+ *
+ * @param [in] randval Buffer obtained with esdm_rpc_server_randval_alloc
+ * @param [in] buf Stack buffer of the caller
+ * @param [in] len Number of random bytes to be generated
+ */
+void esdm_rpc_server_randval_free(uint8_t *randval, uint8_t *buf, size_t len);
+
+/**
+ * @brief Obtain status information about the RPC server
+ *
+ * The status covers the usage of the pool of pre-allocated connection
+ * objects, the RPC latency and the lock contention if enabled.
+ *
+ * @param [out] buf Buffer to be filled with a NULL-terminated string
+ * @param [in] buflen Size of the buffer
+ */
+void esdm_rpc_server_status(char *buf, size_t buflen);
+
+/**
+ * @brief Latency percentiles of the RPC request processing and the DRNG
+ *
+ * @param [out] buf Buffer to be filled with the NUL-terminated information
+ * @param [in] buflen Length of buffer
+ */
+void esdm_rpc_server_latency_status(char *buf, size_t buflen);
+
+/**
+ * @brief Counters of the RPC server and the ESDM in the OpenMetrics format
+ *
+ * The exposition covers the RPC requests per method, the thread pool
+ * occupancy, the latency histograms and the counters of the ESDM library. It
+ * is terminated with the "# EOF" line.
+ *
+ * @param [out] buf Buffer to be filled with the NUL-terminated exposition
+ * @param [in] buflen Length of buffer
+ *
+ * @return length of the exposition
+ */
+size_t esdm_rpc_server_metrics(char *buf, size_t buflen);
+
+/**
+ * @brief Number of open RPC connections
+ */
+unsigned int esdm_rpc_server_connections(void);
+
+/**
+ * @brief Configuration file applied again when the server receives SIGHUP
+ *
+ * Without a configuration file, SIGHUP terminates the server. This call must
+ * be invoked before esdm_rpc_server_init.
+ *
+ * @param [in] path Absolute path of the configuration file
+ */
+void esdm_rpc_server_config_file_set(const char *path);
+
 int esdm_rpc_server_init(const char *username);
 void esdm_rpc_server_fini(void);
 
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "build_bug_on.h"
+#include "config.h"
+#include "esdm.h"
+#include "esdm_logger.h"
+#include "esdm_rpc_server_ent_ring.h"
+#include "memset_secure.h"
+#include "mutex_w.h"
+#include "ret_checkers.h"
+#include "threading_support.h"
+
+/* Maximum number of rings maintained at the same time */
+#define ESDM_RPCS_ENT_RING_MAX 16
+#define ESDM_RPCS_ENT_RING_EVENTS 16
+
+/* Interval in milliseconds in which all rings are drained */
+#define ESDM_RPCS_ENT_RING_INTERVAL 100
+
+struct esdm_rpcs_ent_ring {
+	struct esdm_rpc_ring *ring; /* Shared memory with client */
+	size_t maplen; /* Size of the mapping */
+	uint64_t tail; /* Server-side copy of the tail counter */
+	uint32_t size; /* Size of the data area */
+	int ctrl_fd; /* Server end of the control socket */
+};
+
+static struct esdm_rpcs_ent_ring esdm_rpcs_ent_rings[ESDM_RPCS_ENT_RING_MAX];
+static DEFINE_MUTEX_W_UNLOCKED(esdm_rpcs_ent_ring_lock);
+static int esdm_rpcs_ent_ring_epfd = -1;
+static atomic_t esdm_rpcs_ent_ring_exit = ATOMIC_INIT(0);
+
+/* Caller must hold esdm_rpcs_ent_ring_lock */
+static void esdm_rpcs_ent_ring_release(struct esdm_rpcs_ent_ring *r)
+{
+	if (r->ring) {
+		/* Data not inserted yet must not linger in the memory file */
+		memset_secure(r->ring->data, 0, r->size);
+		munmap(r->ring, r->maplen);
+	}
+	/* Closing the FD implicitly removes it from the epoll set. */
+	if (r->ctrl_fd >= 0)
+		close(r->ctrl_fd);
+
+	r->ring = NULL;
+	r->maplen = 0;
+	r->tail = 0;
+	r->size = 0;
+	r->ctrl_fd = -1;
+}
+
+/*
+ * Insert all records written by the feeder into the auxiliary pool. The head
+ * counter and the record headers are written by the feeder and therefore are
+ * not trusted. The tail counter is only taken from the server-side copy.
+ *
+ * Caller must hold esdm_rpcs_ent_ring_lock.
+ */
+static int esdm_rpcs_ent_ring_drain(struct esdm_rpcs_ent_ring *r)
+{
+	struct esdm_rpc_ring *ring = r->ring;
+	uint64_t head = (uint64_t)atomic_read_64(&ring->head);
+	uint32_t mask = r->size - 1;
+
+	if (head < r->tail || head - r->tail > r->size ||
+	    (head & (ESDM_RPC_ENT_RING_ALIGN - 1)))
+		return -EFAULT;
+
+	while (head > r->tail) {
+		struct esdm_rpc_ent_record rec;
+		uint32_t offset = (uint32_t)(r->tail & mask);
+		uint64_t reclen;
+
+		/* The feeder may modify the ring, only use the copy */
+		memcpy(&rec, ring->data + offset, sizeof(rec));
+
+		if (rec.entropy_bits == ESDM_RPC_ENT_RING_PAD) {
+			reclen = r->size - offset;
+		} else {
+			if (rec.len > r->size - offset - sizeof(rec))
+				return -EFAULT;
+			reclen = (sizeof(rec) + rec.len +
+				  ESDM_RPC_ENT_RING_ALIGN - 1) &
+				 ~(uint64_t)(ESDM_RPC_ENT_RING_ALIGN - 1);
+		}
+		if (reclen > head - r->tail)
+			return -EFAULT;
+
+		if (rec.entropy_bits != ESDM_RPC_ENT_RING_PAD && rec.len) {
+			int ret = esdm_pool_insert_aux(
+				ring->data + offset + sizeof(rec), rec.len,
+				rec.entropy_bits);
+
+			/* Keep the record, the next drain retries */
+			if (ret) {
+				esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+					    "Entropy ring insertion failed: "
+					    "%d\n", ret);
+				break;
+			}
+		}
+
+		/* The data must only be used once */
+		memset_secure(ring->data + offset, 0, (size_t)reclen);
+		r->tail += reclen;
+	}
+
+	/* Hand the consumed space back to the feeder */
+	atomic_set_64(&ring->tail, (long long)r->tail);
+
+	return 0;
+}
+
+static void esdm_rpcs_ent_ring_event(uint32_t idx, uint32_t events)
+{
+	struct esdm_rpcs_ent_ring *r;
+	uint8_t tmp[16];
+
+	if (idx >= ESDM_RPCS_ENT_RING_MAX)
+		return;
+
+	mutex_w_lock(&esdm_rpcs_ent_ring_lock);
+
+	r = &esdm_rpcs_ent_rings[idx];
+	if (!r->ring)
+		goto out;
+
+	/* Drain all drain requests */
+	while (recv(r->ctrl_fd, tmp, sizeof(tmp), MSG_DONTWAIT) > 0)
+		;
+
+	if (esdm_rpcs_ent_ring_drain(r)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Entropy ring %u corrupted by client\n", idx);
+		esdm_rpcs_ent_ring_release(r);
+		goto out;
+	}
+
+	/* Feeder is gone - the data written before is inserted above */
+	if (events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Releasing entropy ring %u\n", idx);
+		esdm_rpcs_ent_ring_release(r);
+	}
+
+out:
+	mutex_w_unlock(&esdm_rpcs_ent_ring_lock);
+}
+
+/* Drain all rings, caller must hold esdm_rpcs_ent_ring_lock */
+static void esdm_rpcs_ent_ring_drain_all(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ESDM_RPCS_ENT_RING_MAX; i++) {
+		struct esdm_rpcs_ent_ring *r = &esdm_rpcs_ent_rings[i];
+
+		if (r->ring && esdm_rpcs_ent_ring_drain(r))
+			esdm_rpcs_ent_ring_release(r);
+	}
+}
+
+static int esdm_rpcs_ent_ring_drainer(void *unused)
+{
+	struct epoll_event events[ESDM_RPCS_ENT_RING_EVENTS];
+	int i, nfds;
+
+	(void)unused;
+
+	thread_set_name(rpc_ent_ring_drain, 0);
+
+	while (!atomic_read(&esdm_rpcs_ent_ring_exit)) {
+		/*
+		 * Feeders which do not request the draining are served in
+		 * batches with the regular wakeup.
+		 */
+		nfds = epoll_wait(esdm_rpcs_ent_ring_epfd, events,
+				  ESDM_RPCS_ENT_RING_EVENTS,
+				  ESDM_RPCS_ENT_RING_INTERVAL);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
+
+			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+				    "Entropy ring drainer: epoll_wait failed: "
+				    "%s\n",
+				    strerror(errno));
+			return -errno;
+		}
+
+		if (!nfds) {
+			mutex_w_lock(&esdm_rpcs_ent_ring_lock);
+			esdm_rpcs_ent_ring_drain_all();
+			mutex_w_unlock(&esdm_rpcs_ent_ring_lock);
+			continue;
+		}
+
+		for (i = 0; i < nfds; i++)
+			esdm_rpcs_ent_ring_event(events[i].data.u32,
+						 events[i].events);
+	}
+
+	return 0;
+}
+
+/* Caller must hold esdm_rpcs_ent_ring_lock */
+static int esdm_rpcs_ent_ring_drainer_start(void)
+{
+	unsigned int i;
+	int ret;
+
+	if (esdm_rpcs_ent_ring_epfd >= 0)
+		return 0;
+
+	for (i = 0; i < ESDM_RPCS_ENT_RING_MAX; i++)
+		esdm_rpcs_ent_rings[i].ctrl_fd = -1;
+
+	esdm_rpcs_ent_ring_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (esdm_rpcs_ent_ring_epfd < 0)
+		return -errno;
+
+	ret = thread_start(esdm_rpcs_ent_ring_drainer, NULL, 0, NULL);
+	if (ret) {
+		close(esdm_rpcs_ent_ring_epfd);
+		esdm_rpcs_ent_ring_epfd = -1;
+	}
+
+	return ret;
+}
+
+/*
+ * Create the memory file of the ring and map it. The client derives the size
+ * of its mapping from the file size.
+ *
+ * Return: memory file descriptor on success, -errno on error
+ */
+static int esdm_rpcs_ent_ring_map(struct esdm_rpcs_ent_ring *r, uint32_t size)
+{
+	size_t maplen = sizeof(struct esdm_rpc_ring) + size;
+	int mfd = memfd_create("esdm_entropy_ring",
+			       MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	int ret;
+
+	if (mfd < 0)
+		return -errno;
+
+	if (ftruncate(mfd, (off_t)maplen) < 0)
+		goto err;
+
+	/*
+	 * Prevent the client from truncating the file which would cause a
+	 * SIGBUS in the server when accessing the mapping.
+	 */
+	if (fcntl(mfd, F_ADD_SEALS,
+		  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+		goto err;
+
+	r->ring = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, mfd,
+		       0);
+	if (r->ring == MAP_FAILED) {
+		r->ring = NULL;
+		goto err;
+	}
+	r->maplen = maplen;
+
+	/* The entropy must not be duplicated into a child */
+	madvise(r->ring, maplen, MADV_DONTFORK);
+
+	return mfd;
+
+err:
+	ret = -errno;
+	close(mfd);
+	return ret;
+}
+
+int esdm_rpcs_ent_ring_alloc(uint32_t size, int *mem_fd, int *ctrl_fd,
+			     uint32_t *ring_size)
+{
+	struct esdm_rpcs_ent_ring *r = NULL;
+	struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP };
+	int sv[2] = { -1, -1 };
+	int mfd = -1, ret;
+	uint32_t i;
+
+	BUILD_BUG_ON(ESDM_RPC_ENT_RING_SIZE & (ESDM_RPC_ENT_RING_SIZE - 1));
+	BUILD_BUG_ON(ESDM_RPC_ENT_RING_SIZE < ESDM_RPC_ENT_RING_MIN_SIZE);
+
+	/* Round the requested size up to the next power of 2 */
+	if (!size || size >= ESDM_RPC_ENT_RING_SIZE) {
+		size = ESDM_RPC_ENT_RING_SIZE;
+	} else {
+		uint32_t s = ESDM_RPC_ENT_RING_MIN_SIZE;
+
+		while (s < size)
+			s <<= 1;
+		size = s;
+	}
+
+	mutex_w_lock(&esdm_rpcs_ent_ring_lock);
+
+	CKINT_LOG(esdm_rpcs_ent_ring_drainer_start(),
+		  "Starting entropy ring drainer failed: %d\n", ret);
+
+	for (i = 0; i < ESDM_RPCS_ENT_RING_MAX; i++) {
+		if (!esdm_rpcs_ent_rings[i].ring) {
+			r = &esdm_rpcs_ent_rings[i];
+			break;
+		}
+	}
+	CKNULL(r, -EBUSY);
+
+	mfd = esdm_rpcs_ent_ring_map(r, size);
+	if (mfd < 0) {
+		ret = mfd;
+		goto out;
+	}
+
+	r->ring->magic = ESDM_RPC_ENT_RING_MAGIC;
+	r->ring->size = size;
+	atomic_set_64(&r->ring->head, 0);
+	atomic_set_64(&r->ring->tail, 0);
+	r->size = size;
+	r->tail = 0;
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+		ret = -errno;
+		goto out;
+	}
+	r->ctrl_fd = sv[0];
+	sv[0] = -1;
+	set_fd_nonblocking(r->ctrl_fd);
+
+	ev.data.u32 = i;
+	if (epoll_ctl(esdm_rpcs_ent_ring_epfd, EPOLL_CTL_ADD, r->ctrl_fd,
+		      &ev) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	*mem_fd = mfd;
+	*ctrl_fd = sv[1];
+	*ring_size = size;
+	mfd = -1;
+	sv[1] = -1;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Entropy ring %u with %u bytes allocated\n", i, size);
+
+out:
+	if (ret && r)
+		esdm_rpcs_ent_ring_release(r);
+	mutex_w_unlock(&esdm_rpcs_ent_ring_lock);
+
+	if (mfd >= 0)
+		close(mfd);
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+	return ret;
+}
+
+void esdm_rpcs_ent_ring_fini(void)
+{
+	unsigned int i;
+
+	atomic_set(&esdm_rpcs_ent_ring_exit, 1);
+
+	mutex_w_lock(&esdm_rpcs_ent_ring_lock);
+	if (esdm_rpcs_ent_ring_epfd >= 0) {
+		/* Do not lose the entropy provided until now */
+		esdm_rpcs_ent_ring_drain_all();
+		for (i = 0; i < ESDM_RPCS_ENT_RING_MAX; i++)
+			esdm_rpcs_ent_ring_release(&esdm_rpcs_ent_rings[i]);
+	}
+	mutex_w_unlock(&esdm_rpcs_ent_ring_lock);
+}
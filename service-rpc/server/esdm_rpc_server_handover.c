@@ -0,0 +1,458 @@
+/* Hand-over of the RPC server to a new server instance
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "config.h"
+#include "esdm.h"
+#include "esdm_config.h"
+#include "esdm_definitions.h"
+#include "esdm_logger.h"
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_server_handover.h"
+#include "esdm_rpc_service.h"
+#include "helper.h"
+#include "memset_secure.h"
+#include "threading_support.h"
+
+/*
+ * The hand-over socket is created in a directory owned by and accessible to
+ * root only. The new server binds its own hand-over socket after it received
+ * the hand-over, replacing the socket file of the running server. Both sides
+ * only accept a peer with UID 0, the new server optionally only accepts the
+ * running server with the expected PID.
+ */
+#define ESDM_RPCS_HANDOVER_FDS_MAX 4
+#define ESDM_RPCS_HANDOVER_VERSION 1
+#define ESDM_RPCS_HANDOVER_SEED_BYTES (2 * ESDM_DRNG_SECURITY_STRENGTH_BYTES)
+/* Grace period for the connections of the running server to be closed */
+#define ESDM_RPCS_HANDOVER_DRAIN_MS 5000
+
+struct esdm_rpcs_handover_msg {
+	uint32_t version;
+	uint32_t seed_len;
+	uint8_t seed[ESDM_RPCS_HANDOVER_SEED_BYTES];
+};
+
+static bool esdm_rpcs_handover_requested = false;
+static pid_t esdm_rpcs_handover_pid = 0;
+
+/* Sockets received from the previous server */
+static int esdm_rpcs_handover_rx_fds[ESDM_RPCS_HANDOVER_FDS_MAX];
+static unsigned int esdm_rpcs_handover_rx_num = 0;
+
+/* Sockets passed to the next server */
+static int esdm_rpcs_handover_tx_fds[ESDM_RPCS_HANDOVER_FDS_MAX];
+static atomic_t esdm_rpcs_handover_tx_num = ATOMIC_INIT(0);
+
+static int esdm_rpcs_handover_sock = -1;
+static atomic_t esdm_rpcs_handover_exit = ATOMIC_INIT(0);
+
+static socklen_t esdm_rpcs_handover_addr(struct sockaddr_un *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	/* Every shard hands over its own sockets */
+	if (esdm_config_shards())
+		esdm_rpc_shard_socket(addr->sun_path, sizeof(addr->sun_path),
+				      ESDM_RPC_HANDOVER_SOCKET,
+				      esdm_config_shard());
+	else
+		snprintf(addr->sun_path, sizeof(addr->sun_path), "%s",
+			 ESDM_RPC_HANDOVER_SOCKET);
+
+	return (socklen_t)(offsetof(struct sockaddr_un, sun_path) +
+			   strlen(addr->sun_path) + 1);
+}
+
+/* Only root must be able to create or reach the hand-over socket */
+static int esdm_rpcs_handover_dir(bool create)
+{
+	struct stat sb;
+
+	if (create && mkdir(ESDM_RPC_HANDOVER_DIR, S_IRWXU) < 0 &&
+	    errno != EEXIST)
+		return -errno;
+
+	if (lstat(ESDM_RPC_HANDOVER_DIR, &sb) < 0)
+		return -errno;
+
+	if (!S_ISDIR(sb.st_mode) || sb.st_uid != 0 ||
+	    (sb.st_mode & (S_IRWXG | S_IRWXO))) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Hand-over directory %s is not accessible by root only\n",
+			    ESDM_RPC_HANDOVER_DIR);
+		return -EPERM;
+	}
+
+	return 0;
+}
+
+/* The peer must have UID 0 and, if expected, the given PID */
+static int esdm_rpcs_handover_peer(int fd, pid_t pid)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+		return -errno;
+
+	if (cred.uid != 0 || (pid && cred.pid != pid))
+		return -EPERM;
+
+	return 0;
+}
+
+/************************** New server instance *******************************/
+
+void esdm_rpcs_handover_request(pid_t pid)
+{
+	esdm_rpcs_handover_requested = true;
+	esdm_rpcs_handover_pid = pid;
+}
+
+void esdm_rpcs_handover_receive(void)
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * ESDM_RPCS_HANDOVER_FDS_MAX)];
+		struct cmsghdr align;
+	} control;
+	struct esdm_rpcs_handover_msg hmsg;
+	struct iovec iov = { .iov_base = &hmsg, .iov_len = sizeof(hmsg) };
+	struct msghdr msg = { 0 };
+	struct sockaddr_un addr;
+	struct timeval tv = { .tv_sec = 5, .tv_usec = 0 };
+	struct cmsghdr *cmsg;
+	socklen_t addr_len = esdm_rpcs_handover_addr(&addr);
+	uint32_t credit = 0;
+	ssize_t ret;
+	int fd;
+
+	if (!esdm_rpcs_handover_requested)
+		return;
+
+	if (esdm_rpcs_handover_dir(false))
+		return;
+
+	fd = socket(PF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	if (connect(fd, (struct sockaddr *)&addr, addr_len) < 0) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "No running server to take over from: %s\n",
+			    strerror(errno));
+		goto out;
+	}
+
+	/* Do not trust any sockets or seed of an unexpected peer */
+	if (esdm_rpcs_handover_peer(fd, esdm_rpcs_handover_pid)) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+			    "Rejecting hand-over from unexpected peer\n");
+		goto out;
+	}
+
+	memset(&control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ret = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+	if (ret < 0) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Receiving hand-over from running server failed: %s\n",
+			    strerror(errno));
+		goto out;
+	}
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		size_t num;
+
+		if (cmsg->cmsg_level != SOL_SOCKET ||
+		    cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		num = min_size(num, ESDM_RPCS_HANDOVER_FDS_MAX -
+					    esdm_rpcs_handover_rx_num);
+		memcpy(esdm_rpcs_handover_rx_fds + esdm_rpcs_handover_rx_num,
+		       CMSG_DATA(cmsg), num * sizeof(int));
+		esdm_rpcs_handover_rx_num += (unsigned int)num;
+	}
+
+	if (ret != (ssize_t)sizeof(hmsg) ||
+	    hmsg.version != ESDM_RPCS_HANDOVER_VERSION ||
+	    hmsg.seed_len > sizeof(hmsg.seed) || (msg.msg_flags & MSG_CTRUNC)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Invalid hand-over from running server\n");
+		esdm_rpcs_handover_release();
+		goto out;
+	}
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+		    "Received %u sockets from running server\n",
+		    esdm_rpcs_handover_rx_num);
+
+	if (!hmsg.seed_len)
+		goto out;
+
+	/*
+	 * The seed is generated by the fully seeded DRNG of the running server
+	 * and received from a peer with UID 0 on the same system. As for the
+	 * seed file, it is only credited if this is configured and never in
+	 * FIPS or SP800-90C mode.
+	 */
+	if (esdm_config_seed_file_credit() && !esdm_config_sp80090c_compliant())
+		credit = min_uint32(hmsg.seed_len << 3,
+				    ESDM_DRNG_SECURITY_STRENGTH_BITS);
+	if (!esdm_pool_insert_aux(hmsg.seed, hmsg.seed_len, credit))
+		esdm_drng_force_reseed();
+
+	esdm_logger(LOGGER_VERBOSE, LOGGER_C_RPC,
+		    "Seed from running server inserted with %u bits of entropy\n",
+		    credit);
+
+out:
+	memset_secure(&hmsg, 0, sizeof(hmsg));
+	close(fd);
+}
+
+int esdm_rpcs_handover_fd(unsigned int idx)
+{
+	if (idx >= esdm_rpcs_handover_rx_num)
+		return -1;
+
+	return esdm_rpcs_handover_rx_fds[idx];
+}
+
+void esdm_rpcs_handover_release(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < esdm_rpcs_handover_rx_num; i++)
+		close(esdm_rpcs_handover_rx_fds[i]);
+	esdm_rpcs_handover_rx_num = 0;
+}
+
+/************************ Running server instance *****************************/
+
+void esdm_rpcs_handover_add_fd(int fd)
+{
+	int idx = atomic_inc(&esdm_rpcs_handover_tx_num) - 1;
+
+	if (idx >= ESDM_RPCS_HANDOVER_FDS_MAX) {
+		atomic_dec(&esdm_rpcs_handover_tx_num);
+		return;
+	}
+
+	esdm_rpcs_handover_tx_fds[idx] = fd;
+}
+
+/* Pass the listening sockets and a seed to the new server */
+static int esdm_rpcs_handover_send(int conn)
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * ESDM_RPCS_HANDOVER_FDS_MAX)];
+		struct cmsghdr align;
+	} control;
+	struct esdm_rpcs_handover_msg hmsg = {
+		.version = ESDM_RPCS_HANDOVER_VERSION,
+		.seed_len = sizeof(hmsg.seed),
+	};
+	struct iovec iov = { .iov_base = &hmsg, .iov_len = sizeof(hmsg) };
+	struct msghdr msg = { 0 };
+	struct cmsghdr *cmsg;
+	size_t fdlen = sizeof(int) *
+		       min_uint32((uint32_t)atomic_read(
+					  &esdm_rpcs_handover_tx_num),
+				  ESDM_RPCS_HANDOVER_FDS_MAX);
+	int ret = 0;
+
+	/* Only seed material of a fully seeded DRNG is handed over */
+	if (esdm_get_random_bytes_full_noblock(hmsg.seed, sizeof(hmsg.seed)) !=
+	    (ssize_t)sizeof(hmsg.seed)) {
+		memset(hmsg.seed, 0, sizeof(hmsg.seed));
+		hmsg.seed_len = 0;
+	}
+
+	memset(&control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (fdlen) {
+		msg.msg_control = control.buf;
+		msg.msg_controllen = CMSG_SPACE(fdlen);
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(fdlen);
+		memcpy(CMSG_DATA(cmsg), esdm_rpcs_handover_tx_fds, fdlen);
+	}
+
+	if (sendmsg(conn, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(hmsg))
+		ret = -errno;
+
+	memset_secure(&hmsg, 0, sizeof(hmsg));
+	return ret;
+}
+
+/* Wait for the connections to be closed by the clients, then terminate */
+static void esdm_rpcs_handover_drain(void)
+{
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = 10 * 1000000L };
+	unsigned int i;
+
+	for (i = 0; i < ESDM_RPCS_HANDOVER_DRAIN_MS / 10; i++) {
+		if (!esdm_rpc_server_connections())
+			break;
+		nanosleep(&ts, NULL);
+	}
+
+	esdm_logger(LOGGER_STATUS, LOGGER_C_RPC,
+		    "Server handed over, %u connections left, terminating\n",
+		    esdm_rpc_server_connections());
+
+	/* Regular termination which does not remove the sockets in use */
+	kill(getpid(), SIGTERM);
+}
+
+static int esdm_rpcs_handover_workerloop(void *args)
+{
+	int fd = esdm_rpcs_handover_sock;
+
+	(void)args;
+
+	thread_set_name(rpc_handover, 0);
+
+	while (!atomic_read(&esdm_rpcs_handover_exit)) {
+		/* Wake up regularly to check for termination */
+		struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+		fd_set fds;
+		int conn, ret;
+
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		ret = select(fd + 1, &fds, NULL, NULL, &tv);
+		if (ret <= 0)
+			continue;
+
+		conn = accept(fd, NULL, NULL);
+		if (conn < 0)
+			continue;
+
+		if (esdm_rpcs_handover_peer(conn, 0)) {
+			esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+				    "Rejecting unprivileged caller of hand-over\n");
+			close(conn);
+			continue;
+		}
+
+		ret = esdm_rpcs_handover_send(conn);
+		close(conn);
+		if (ret) {
+			esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+				    "Hand-over to new server failed: %s\n",
+				    strerror(-ret));
+			continue;
+		}
+
+		/* Release the name of the hand-over socket for the new server */
+		esdm_rpcs_handover_sock = -1;
+		close(fd);
+
+		esdm_rpcs_handover_drain();
+		return 0;
+	}
+
+	esdm_rpcs_handover_sock = -1;
+	close(fd);
+
+	return 0;
+}
+
+void esdm_rpcs_handover_init(void)
+{
+	struct sockaddr_un addr;
+	socklen_t addr_len = esdm_rpcs_handover_addr(&addr);
+	int fd, err;
+
+	err = -esdm_rpcs_handover_dir(true);
+	if (err)
+		goto err;
+
+	fd = socket(PF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		err = errno;
+		goto err;
+	}
+
+	/* Replace the socket file of a previous server */
+	unlink(addr.sun_path);
+
+	if (bind(fd, (struct sockaddr *)&addr, addr_len) < 0 ||
+	    listen(fd, 1) < 0) {
+		err = errno;
+		close(fd);
+		goto err;
+	}
+
+	esdm_rpcs_handover_sock = fd;
+	return;
+
+err:
+	esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+		    "Hand-over socket unavailable: %s\n", strerror(err));
+}
+
+void esdm_rpcs_handover_start(void)
+{
+	int fd = esdm_rpcs_handover_sock;
+
+	if (fd < 0)
+		return;
+
+	if (thread_start(esdm_rpcs_handover_workerloop, NULL, 0, NULL)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Starting hand-over thread failed\n");
+		esdm_rpcs_handover_sock = -1;
+		close(fd);
+	}
+}
+
+void esdm_rpcs_handover_fini(void)
+{
+	atomic_set(&esdm_rpcs_handover_exit, 1);
+}
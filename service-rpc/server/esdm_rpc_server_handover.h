@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#ifndef ESDM_RPC_SERVER_HANDOVER_H
+#define ESDM_RPC_SERVER_HANDOVER_H
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hand-over of a running server to a newly started server: the new server
+ * connects to the hand-over socket of the running server which passes its
+ * listening sockets and seed material generated by its DRNG. The running
+ * server then drains its connections and terminates while the new server
+ * continues to accept connections on the same sockets.
+ */
+
+/**
+ * @brief Request the hand-over from a running server during
+ *	  esdm_rpc_server_init
+ *
+ * @param [in] pid PID of the running server or 0 to accept any running server
+ *		   with UID 0
+ */
+void esdm_rpcs_handover_request(pid_t pid);
+
+/**
+ * @brief Receive the listening sockets and the seed from the running server
+ *
+ * The seed is inserted into the auxiliary pool. Without a running server,
+ * the server starts without hand-over.
+ */
+void esdm_rpcs_handover_receive(void);
+
+/**
+ * @brief Return the received listening socket for the interface
+ *
+ * @param [in] idx Index of the received socket
+ *
+ * @return file descriptor or -1 if there is no socket with this index
+ */
+int esdm_rpcs_handover_fd(unsigned int idx);
+
+/**
+ * @brief Close all received sockets
+ *
+ * Called by the process which does not serve the interfaces.
+ */
+void esdm_rpcs_handover_release(void);
+
+/**
+ * @brief Register a listening socket to be passed to the next server
+ *
+ * @param [in] fd Listening socket
+ */
+void esdm_rpcs_handover_add_fd(int fd);
+
+/**
+ * @brief Bind the hand-over socket
+ *
+ * The function is called before the privileges are dropped. A failure only
+ * disables the hand-over.
+ */
+void esdm_rpcs_handover_init(void);
+
+/**
+ * @brief Start the thread serving the hand-over socket
+ */
+void esdm_rpcs_handover_start(void);
+
+/**
+ * @brief Terminate the hand-over thread and close the hand-over socket
+ */
+void esdm_rpcs_handover_fini(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_RPC_SERVER_HANDOVER_H */
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bool.h"
+#include "esdm.h"
+#include "esdm_kdev_ioctl.h"
+#include "esdm_logger.h"
+#include "esdm_rpc_server_kdev.h"
+#include "helper.h"
+#include "memset_secure.h"
+#include "threading_support.h"
+
+/* Control device of the ESDM kernel device shim */
+#define ESDM_SERVER_KDEV_CTL "/dev/esdm_kdev"
+
+/* Interval in which the presence of the control device is checked */
+#define ESDM_SERVER_KDEV_RETRY_SEC 5
+
+/* Minimum time between two seeds driven by the kernel DRNG demand */
+#define ESDM_SERVER_KDEV_DEMAND_SEC 1
+
+/*
+ * Seed the kernel DRNG. As long as the ESDM is not fully seeded, the kernel
+ * DRNG is seeded by the minimally seeded ESDM which only unblocks the
+ * urandom device.
+ */
+static int esdm_rpcs_kdev_seed(int fd, bool *fully_seeded)
+{
+	struct esdm_kdev_seed seed = { .flags = 0, .len = ESDM_KDEV_SEED_MAX };
+	ssize_t ret;
+
+	*fully_seeded = !!esdm_state_fully_seeded();
+	if (*fully_seeded) {
+		seed.flags = ESDM_KDEV_SEED_FULLY_SEEDED;
+		ret = esdm_get_random_bytes_full_noblock(seed.data, seed.len);
+	} else {
+		ret = esdm_get_random_bytes_min_noblock(seed.data, seed.len);
+	}
+
+	if (ret != (ssize_t)seed.len) {
+		*fully_seeded = false;
+		ret = (ret < 0) ? ret : -EAGAIN;
+		goto out;
+	}
+
+	if (ioctl(fd, ESDM_KDEV_SEED, &seed) < 0) {
+		ret = -errno;
+		esdm_logger(LOGGER_ERR, LOGGER_C_SERVER,
+			    "Seeding the kernel DRNG failed: %s\n",
+			    strerror(errno));
+		goto out;
+	}
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_SERVER,
+		    "Kernel DRNG seeded (fully seeded: %u)\n", *fully_seeded);
+	ret = 0;
+
+out:
+	memset_secure(&seed, 0, sizeof(seed));
+	return (int)ret;
+}
+
+/*
+ * Sleep until the kernel DRNG requests a new seed or the timeout expired.
+ *
+ * @return 0 on request or timeout, < 0 if the control device must be reopened
+ */
+static int esdm_rpcs_kdev_wait(int fd, int timeout_ms)
+{
+	struct timespec ts = { .tv_sec = ESDM_SERVER_KDEV_DEMAND_SEC,
+			       .tv_nsec = 0 };
+	struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+	int ret;
+
+	/* Rate-limit the seeds driven by the kernel DRNG */
+	nanosleep(&ts, NULL);
+
+	do {
+		ret = poll(&pfd, 1, timeout_ms);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_SERVER,
+			    "Polling the kernel DRNG failed\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/*
+ * Thread seeding the kernel DRNG of the ESDM kernel device shim. The kernel
+ * DRNG announces its demand for a new seed with poll(2) on the control
+ * device. In addition, it is reseeded at the Linux reseed interval.
+ */
+static int esdm_rpcs_kdev_feed(void __unused *unused)
+{
+	struct timespec ts = { .tv_sec = ESDM_SERVER_KDEV_RETRY_SEC,
+			       .tv_nsec = 0 };
+	bool fully_seeded = false;
+	int fd = -1, timeout_ms;
+
+	thread_set_name(es_kdev_feeder, 0);
+
+	for (;;) {
+		if (fd < 0) {
+			fd = open(ESDM_SERVER_KDEV_CTL, O_RDWR | O_CLOEXEC);
+			if (fd < 0) {
+				nanosleep(&ts, NULL);
+				continue;
+			}
+
+			esdm_logger(LOGGER_DEBUG, LOGGER_C_SERVER,
+				    "Feeding the kernel DRNG via %s\n",
+				    ESDM_SERVER_KDEV_CTL);
+		}
+
+		esdm_rpcs_kdev_seed(fd, &fully_seeded);
+
+		/* Upgrade the kernel DRNG as soon as the ESDM is fully seeded */
+		timeout_ms = fully_seeded ?
+				     ESDM_LINUX_RESEED_INTERVAL_SEC * 1000 :
+				     ESDM_SERVER_KDEV_RETRY_SEC * 1000;
+
+		if (esdm_rpcs_kdev_wait(fd, timeout_ms)) {
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	return 0;
+}
+
+int esdm_rpcs_kdev_init_feeder(void)
+{
+	int ret = thread_start(esdm_rpcs_kdev_feed, NULL,
+			       ESDM_THREAD_KDEV_FEEDER, NULL);
+
+	if (ret) {
+		esdm_logger(LOGGER_ERR, LOGGER_C_SERVER,
+			    "Starting the kernel DRNG feeder thread failed: %d\n",
+			    ret);
+	}
+
+	return ret;
+}
@@ -20,6 +20,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/random.h>
+#include <poll.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
@@ -30,9 +32,29 @@
 #include "esdm_rpc_server_linux.h"
 #include "helper.h"
 #include "esdm_logger.h"
+#include "math_helper.h"
 #include "memset_secure.h"
 #include "threading_support.h"
 
+/* Amount of data inserted into the kernel RNG at the reseed interval */
+#define ESDM_SERVER_LINUX_ENTROPY_BYTES 32
+
+/* Largest amount of data inserted at once when the kernel RNG asks for it */
+#define ESDM_SERVER_LINUX_ENTROPY_BYTES_MAX 256
+
+/* Minimum time between two insertions driven by the kernel RNG demand */
+#define ESDM_SERVER_LINUX_DEMAND_SEC 1
+
+/* Wakeups without demand after which the kernel RNG is not polled anymore */
+#define ESDM_SERVER_LINUX_SPURIOUS_MAX 3
+
+/* Demand of entropy by the kernel RNG */
+struct esdm_rpcs_linux_demand {
+	int fd;
+	uint32_t write_wakeup_bits;
+	unsigned int spurious;
+};
+
 static int esdm_rpcs_linux_insert_entropy(struct rand_pool_info *rpi)
 {
 	struct stat statfs;
@@ -117,6 +139,131 @@ static int esdm_rpcs_linux_insert_entropy(struct rand_pool_info *rpi)
 	return -errsv;
 }
 
+/*
+ * The kernel RNG can only be watched when it is not shadowed by the CUSE
+ * /dev/random server which also provides its own /proc/sys/kernel/random
+ * files.
+ */
+static void esdm_rpcs_linux_demand_init(struct esdm_rpcs_linux_demand *d)
+{
+	struct stat statfs;
+	FILE *file;
+	int ret;
+
+	d->fd = -1;
+	d->write_wakeup_bits = 0;
+	d->spurious = 0;
+
+	if (stat("/dev/esdm", &statfs) == 0)
+		return;
+
+	file = fopen("/proc/sys/kernel/random/write_wakeup_threshold", "r");
+	if (!file)
+		return;
+	ret = fscanf(file, "%u", &d->write_wakeup_bits);
+	fclose(file);
+	if (ret != 1 || !d->write_wakeup_bits)
+		return;
+
+	d->fd = open("/dev/random", O_RDONLY | O_CLOEXEC);
+	if (d->fd < 0)
+		return;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_SERVER,
+		    "Kernel RNG is fed on demand below %u bits\n",
+		    d->write_wakeup_bits);
+}
+
+static void esdm_rpcs_linux_demand_fini(struct esdm_rpcs_linux_demand *d)
+{
+	if (d->fd >= 0)
+		close(d->fd);
+	d->fd = -1;
+}
+
+/* Bits the kernel RNG is missing to its write wakeup threshold */
+static uint32_t esdm_rpcs_linux_demand(struct esdm_rpcs_linux_demand *d)
+{
+	int ent_count;
+
+	if (d->fd < 0 || ioctl(d->fd, RNDGETENTCNT, &ent_count) < 0 ||
+	    ent_count < 0)
+		return 0;
+
+	if ((uint32_t)ent_count >= d->write_wakeup_bits)
+		return 0;
+
+	return d->write_wakeup_bits - (uint32_t)ent_count;
+}
+
+/*
+ * Sleep until the kernel RNG reports demand of entropy with poll(2) or the
+ * deadline expired. Kernels that report /dev/random as writable without
+ * any demand cannot be watched, in this case only the deadline is used.
+ *
+ * @return missing bits of the kernel RNG or 0 when the deadline expired
+ */
+static uint32_t esdm_rpcs_linux_wait(struct esdm_rpcs_linux_demand *d,
+				     const struct timespec *deadline)
+{
+	struct timespec ts = { .tv_sec = ESDM_SERVER_LINUX_DEMAND_SEC,
+			       .tv_nsec = 0 };
+
+	/* Rate-limit the insertions driven by the kernel RNG */
+	if (d->fd >= 0)
+		nanosleep(&ts, NULL);
+
+	for (;;) {
+		struct pollfd pfd = { .fd = d->fd, .events = POLLOUT };
+		struct timespec now;
+		uint32_t demand;
+		int64_t remaining_ms;
+		int ret;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		remaining_ms = (int64_t)(deadline->tv_sec - now.tv_sec) * 1000 +
+			       (deadline->tv_nsec - now.tv_nsec) / 1000000;
+		if (remaining_ms <= 0)
+			return 0;
+
+		if (d->fd < 0) {
+			ts.tv_sec = (time_t)(remaining_ms / 1000);
+			ts.tv_nsec = (long)(remaining_ms % 1000) * 1000000;
+			nanosleep(&ts, NULL);
+			return 0;
+		}
+
+		ret = poll(&pfd, 1, (int)remaining_ms);
+		if (ret < 0 && errno != EINTR) {
+			esdm_logger(LOGGER_WARN, LOGGER_C_SERVER,
+				    "Polling the kernel RNG failed: %s\n",
+				    strerror(errno));
+			esdm_rpcs_linux_demand_fini(d);
+			continue;
+		}
+		if (ret <= 0 || !(pfd.revents & POLLOUT))
+			continue;
+
+		demand = esdm_rpcs_linux_demand(d);
+		if (demand) {
+			d->spurious = 0;
+			return demand;
+		}
+
+		if (++d->spurious >= ESDM_SERVER_LINUX_SPURIOUS_MAX) {
+			esdm_logger(
+				LOGGER_DEBUG, LOGGER_C_SERVER,
+				"Kernel RNG does not report its demand, feeding it at the reseed interval only\n");
+			esdm_rpcs_linux_demand_fini(d);
+			continue;
+		}
+
+		ts.tv_sec = ESDM_SERVER_LINUX_DEMAND_SEC;
+		ts.tv_nsec = 0;
+		nanosleep(&ts, NULL);
+	}
+}
+
 /*
  * Thread to insert entropy into the kernel RNG occasionally. When the IRQ ES
  * is present, this is required as the kernel RNG is deprived of its main ES.
@@ -126,26 +273,34 @@ static int esdm_rpcs_linux_insert_entropy(struct rand_pool_info *rpi)
  */
 static int esdm_rpcs_linux_feed_kernel(void __unused *unused)
 {
-#define ESDM_SERVER_LINUX_ENTROPY_BYTES 32
-
-	uint8_t rpi_buf
-		[sizeof(struct rand_pool_info) +
-		 ESDM_SERVER_LINUX_ENTROPY_BYTES] __aligned(sizeof(uint32_t));
+	uint8_t rpi_buf[sizeof(struct rand_pool_info) +
+			ESDM_SERVER_LINUX_ENTROPY_BYTES_MAX]
+		__aligned(sizeof(uint32_t));
 	struct rand_pool_info *rpi = (struct rand_pool_info *)rpi_buf;
 	struct esdm_status_st status;
+	struct esdm_rpcs_linux_demand d;
 
 	/* Wake up every 2 minutes by default */
-	struct timespec ts = { .tv_sec = ESDM_LINUX_RESEED_INTERVAL_SEC,
-			       .tv_nsec = 0 };
+	struct timespec deadline;
 	ssize_t ret;
+	uint32_t demand = 0;
 
 	thread_set_name(es_kernel_feeder, 0);
 
-	rpi->buf_size = ESDM_SERVER_LINUX_ENTROPY_BYTES;
+	esdm_rpcs_linux_demand_init(&d);
 
 	for (;;) {
 		esdm_status_machine(&status);
 
+		/* Fill the entire demand of the kernel RNG with one batch */
+		rpi->buf_size = ESDM_SERVER_LINUX_ENTROPY_BYTES;
+		if (demand) {
+			rpi->buf_size = (int)min_uint32(
+				max_uint32((demand + 7) >> 3,
+					   ESDM_SERVER_LINUX_ENTROPY_BYTES),
+				ESDM_SERVER_LINUX_ENTROPY_BYTES_MAX);
+		}
+
 		ret = esdm_get_random_bytes_full((uint8_t *)rpi->buf,
 						 (size_t)rpi->buf_size);
 		if (ret < 0) {
@@ -180,9 +335,12 @@ static int esdm_rpcs_linux_feed_kernel(void __unused *unused)
 		memset_secure(rpi->buf, 0, (size_t)rpi->buf_size);
 		rpi->entropy_count = 0;
 
-		nanosleep(&ts, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += ESDM_LINUX_RESEED_INTERVAL_SEC;
+		demand = esdm_rpcs_linux_wait(&d, &deadline);
 	}
 
+	esdm_rpcs_linux_demand_fini(&d);
 	return 0;
 }
 
@@ -0,0 +1,240 @@
+/* OpenMetrics exporter of the ESDM server
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "config.h"
+#include "esdm_logger.h"
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_server_metrics.h"
+#include "helper.h"
+#include "threading_support.h"
+
+/*
+ * Minimal HTTP/1.0 responder for scrapes by Prometheus or compatible
+ * collectors: one request per connection, answered by one thread. The
+ * listener is bound to the loopback interface only, remote collection is
+ * expected to use an agent or a proxy on the host.
+ */
+
+#define ESDM_RPCS_METRICS_BUFSIZE (256 * 1024)
+#define ESDM_RPCS_METRICS_REQSIZE 1024
+
+static int esdm_rpcs_metrics_fd = -1;
+static atomic_t esdm_rpcs_metrics_exit = ATOMIC_INIT(0);
+
+/* Only used by the exporter thread */
+static char esdm_rpcs_metrics_body[ESDM_RPCS_METRICS_BUFSIZE];
+
+static int esdm_rpcs_metrics_send(int fd, const char *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = send(fd, buf, len, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+/* Read the request header, only the request line is evaluated */
+static int esdm_rpcs_metrics_read_req(int fd, char *req, size_t reqlen)
+{
+	size_t len = 0;
+	ssize_t ret;
+
+	while (len < reqlen - 1) {
+		ret = recv(fd, req + len, reqlen - 1 - len, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (!ret)
+			break;
+
+		len += (size_t)ret;
+		req[len] = '\0';
+		if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n"))
+			return 0;
+	}
+	req[len] = '\0';
+
+	/* A truncated header still carries the request line */
+	return len ? 0 : -EINVAL;
+}
+
+static void esdm_rpcs_metrics_serve(int fd)
+{
+	static const char hdr_ok[] =
+		"HTTP/1.0 200 OK\r\n"
+		"Content-Type: application/openmetrics-text; version=1.0.0; "
+		"charset=utf-8\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n\r\n";
+	static const char resp_notfound[] =
+		"HTTP/1.0 404 Not Found\r\n"
+		"Content-Length: 0\r\n"
+		"Connection: close\r\n\r\n";
+	static const char resp_badreq[] =
+		"HTTP/1.0 405 Method Not Allowed\r\n"
+		"Allow: GET\r\n"
+		"Content-Length: 0\r\n"
+		"Connection: close\r\n\r\n";
+	struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+	char req[ESDM_RPCS_METRICS_REQSIZE], hdr[sizeof(hdr_ok) + 32];
+	size_t len;
+	int ret;
+
+	/* A stalled collector must not block the exporter */
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	if (esdm_rpcs_metrics_read_req(fd, req, sizeof(req)))
+		return;
+
+	if (strncmp(req, "GET ", 4)) {
+		esdm_rpcs_metrics_send(fd, resp_badreq, sizeof(resp_badreq) - 1);
+		return;
+	}
+
+	if (strncmp(req + 4, "/metrics", 8) ||
+	    (req[12] != ' ' && req[12] != '?')) {
+		esdm_rpcs_metrics_send(fd, resp_notfound,
+				       sizeof(resp_notfound) - 1);
+		return;
+	}
+
+	len = esdm_rpc_server_metrics(esdm_rpcs_metrics_body,
+				      sizeof(esdm_rpcs_metrics_body));
+	ret = snprintf(hdr, sizeof(hdr), hdr_ok, len);
+	if (ret < 0 || (size_t)ret >= sizeof(hdr))
+		return;
+
+	if (esdm_rpcs_metrics_send(fd, hdr, (size_t)ret))
+		return;
+	esdm_rpcs_metrics_send(fd, esdm_rpcs_metrics_body, len);
+}
+
+static int esdm_rpcs_metrics_workerloop(void *args)
+{
+	int fd = esdm_rpcs_metrics_fd;
+
+	(void)args;
+
+	thread_set_name(rpc_metrics, 0);
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "OpenMetrics exporter on port %u available\n",
+		    (unsigned int)ESDM_METRICS_PORT);
+
+	while (!atomic_read(&esdm_rpcs_metrics_exit)) {
+		/* Wake up regularly to check for termination */
+		struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+		fd_set fds;
+		int conn, ret;
+
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		ret = select(fd + 1, &fds, NULL, NULL, &tv);
+		if (ret <= 0)
+			continue;
+
+		conn = accept(fd, NULL, NULL);
+		if (conn < 0)
+			continue;
+
+		esdm_rpcs_metrics_serve(conn);
+		close(conn);
+	}
+
+	esdm_rpcs_metrics_fd = -1;
+	close(fd);
+
+	return 0;
+}
+
+void esdm_rpcs_metrics_init(void)
+{
+	struct sockaddr_in addr = { 0 };
+	int fd, one = 1, err;
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		err = errno;
+		goto err;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)ESDM_METRICS_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(fd, 16) < 0) {
+		err = errno;
+		close(fd);
+		goto err;
+	}
+
+	esdm_rpcs_metrics_fd = fd;
+	return;
+
+err:
+	esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+		    "OpenMetrics exporter on port %u unavailable: %s\n",
+		    (unsigned int)ESDM_METRICS_PORT, strerror(err));
+}
+
+void esdm_rpcs_metrics_start(void)
+{
+	int fd = esdm_rpcs_metrics_fd;
+
+	if (fd < 0)
+		return;
+
+	if (thread_start(esdm_rpcs_metrics_workerloop, NULL, 0, NULL)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Starting OpenMetrics exporter thread failed\n");
+		esdm_rpcs_metrics_fd = -1;
+		close(fd);
+	}
+}
+
+void esdm_rpcs_metrics_fini(void)
+{
+	atomic_set(&esdm_rpcs_metrics_exit, 1);
+}
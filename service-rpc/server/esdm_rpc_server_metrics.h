@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef ESDM_RPC_SERVER_METRICS_H
+#define ESDM_RPC_SERVER_METRICS_H
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ESDM_METRICS
+
+/**
+ * @brief Bind the OpenMetrics listener on the loopback interface
+ *
+ * The function is called before the privileges are dropped to allow
+ * configuring a privileged port. A failure only disables the exporter.
+ */
+void esdm_rpcs_metrics_init(void);
+
+/**
+ * @brief Start the thread answering the scrape requests
+ */
+void esdm_rpcs_metrics_start(void);
+
+/**
+ * @brief Terminate the exporter thread and close the listener
+ */
+void esdm_rpcs_metrics_fini(void);
+
+#else /* ESDM_METRICS */
+
+static inline void esdm_rpcs_metrics_init(void)
+{
+}
+
+static inline void esdm_rpcs_metrics_start(void)
+{
+}
+
+static inline void esdm_rpcs_metrics_fini(void)
+{
+}
+
+#endif /* ESDM_METRICS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_RPC_SERVER_METRICS_H */
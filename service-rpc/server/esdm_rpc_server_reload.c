@@ -0,0 +1,143 @@
+/* Configuration reload of the ESDM server with SIGHUP
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "esdm_config.h"
+#include "esdm_logger.h"
+#include "esdm_rpc_server_reload.h"
+#include "threading_support.h"
+
+/*
+ * The SIGHUP handler only writes to a pipe, the reload itself is performed
+ * by a thread as parsing the file is not async-signal-safe.
+ */
+static int esdm_rpcs_reload_fds[2] = { -1, -1 };
+static const char *esdm_rpcs_reload_file = NULL;
+static atomic_t esdm_rpcs_reload_exit = ATOMIC_INIT(0);
+
+static void esdm_rpcs_reload_signal(int sig)
+{
+	int errsv = errno;
+	char c = 0;
+	ssize_t ret;
+
+	(void)sig;
+
+	/* A full pipe means that a reload is pending anyway */
+	ret = write(esdm_rpcs_reload_fds[1], &c, sizeof(c));
+	(void)ret;
+
+	errno = errsv;
+}
+
+static int esdm_rpcs_reload_workerloop(void *args)
+{
+	int fd = esdm_rpcs_reload_fds[0];
+
+	(void)args;
+
+	thread_set_name(rpc_config_reload, 0);
+
+	while (!atomic_read(&esdm_rpcs_reload_exit)) {
+		/* Wake up regularly to check for termination */
+		struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+		char buf[16];
+		fd_set fds;
+
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		if (select(fd + 1, &fds, NULL, NULL, &tv) <= 0)
+			continue;
+
+		/* Multiple pending SIGHUPs cause one reload */
+		if (read(fd, buf, sizeof(buf)) <= 0)
+			continue;
+
+		esdm_logger(LOGGER_VERBOSE, LOGGER_C_SERVER,
+			    "Reloading configuration file %s\n",
+			    esdm_rpcs_reload_file);
+		esdm_config_file_load(esdm_rpcs_reload_file);
+	}
+
+	return 0;
+}
+
+static int esdm_rpcs_reload_nonblock(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return -errno;
+	if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0)
+		return -errno;
+	return 0;
+}
+
+void esdm_rpcs_reload_init(const char *path)
+{
+	int ret;
+
+	if (!path)
+		return;
+
+	if (pipe(esdm_rpcs_reload_fds) < 0) {
+		ret = -errno;
+		goto err;
+	}
+
+	ret = esdm_rpcs_reload_nonblock(esdm_rpcs_reload_fds[0]);
+	if (!ret)
+		ret = esdm_rpcs_reload_nonblock(esdm_rpcs_reload_fds[1]);
+	if (ret)
+		goto err_close;
+
+	esdm_rpcs_reload_file = path;
+	ret = thread_start(esdm_rpcs_reload_workerloop, NULL, 0, NULL);
+	if (ret)
+		goto err_close;
+
+	signal(SIGHUP, esdm_rpcs_reload_signal);
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_SERVER,
+		    "SIGHUP reloads configuration file %s\n", path);
+	return;
+
+err_close:
+	close(esdm_rpcs_reload_fds[0]);
+	close(esdm_rpcs_reload_fds[1]);
+	esdm_rpcs_reload_fds[0] = -1;
+	esdm_rpcs_reload_fds[1] = -1;
+err:
+	esdm_logger(LOGGER_WARN, LOGGER_C_SERVER,
+		    "Configuration reload with SIGHUP unavailable: %s\n",
+		    strerror(-ret));
+}
+
+void esdm_rpcs_reload_fini(void)
+{
+	atomic_set(&esdm_rpcs_reload_exit, 1);
+}
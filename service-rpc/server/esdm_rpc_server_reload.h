@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef ESDM_RPC_SERVER_RELOAD_H
+#define ESDM_RPC_SERVER_RELOAD_H
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ESDM_TINY_FOOTPRINT
+
+/**
+ * @brief Reload the configuration file when the server receives SIGHUP
+ *
+ * The file is applied with esdm_config_file_load by a dedicated thread. As
+ * the server permanently drops its privileges, the file must be readable by
+ * the unprivileged user of the server.
+ *
+ * @param [in] path Configuration file, NULL disables the reload
+ */
+void esdm_rpcs_reload_init(const char *path);
+
+/**
+ * @brief Terminate the reload thread
+ */
+void esdm_rpcs_reload_fini(void);
+
+#else /* ESDM_TINY_FOOTPRINT */
+
+static inline void esdm_rpcs_reload_init(const char *path)
+{
+	(void)path;
+}
+
+static inline void esdm_rpcs_reload_fini(void)
+{
+}
+
+#endif /* ESDM_TINY_FOOTPRINT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_RPC_SERVER_RELOAD_H */
@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "build_bug_on.h"
+#include "config.h"
+#include "esdm.h"
+#include "esdm_cpu_class.h"
+#include "esdm_logger.h"
+#include "esdm_rpc_server_ring.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+#include "mutex_w.h"
+#include "ret_checkers.h"
+#include "threading_support.h"
+
+/* Maximum number of rings maintained at the same time */
+#define ESDM_RPCS_RING_MAX 64
+#define ESDM_RPCS_RING_EVENTS 16
+
+struct esdm_rpcs_ring {
+	struct esdm_rpc_ring *ring; /* Shared memory with client */
+	size_t maplen; /* Size of the mapping */
+	uint64_t head; /* Server-side copy of the head counter */
+	uint32_t size; /* Size of the data area */
+	int ctrl_fd; /* Server end of the control socket */
+};
+
+static struct esdm_rpcs_ring esdm_rpcs_rings[ESDM_RPCS_RING_MAX];
+static DEFINE_MUTEX_W_UNLOCKED(esdm_rpcs_ring_lock);
+static int esdm_rpcs_ring_epfd = -1;
+static atomic_t esdm_rpcs_ring_exit = ATOMIC_INIT(0);
+
+/* Caller must hold esdm_rpcs_ring_lock */
+static void esdm_rpcs_ring_release(struct esdm_rpcs_ring *r)
+{
+	if (r->ring) {
+		/* The client may still hold its mapping - remove our data */
+		memset_secure(r->ring->data, 0, r->size);
+		munmap(r->ring, r->maplen);
+	}
+	/* Closing the FD implicitly removes it from the epoll set. */
+	if (r->ctrl_fd >= 0)
+		close(r->ctrl_fd);
+
+	r->ring = NULL;
+	r->maplen = 0;
+	r->head = 0;
+	r->size = 0;
+	r->ctrl_fd = -1;
+}
+
+/*
+ * Fill the free space of the ring. The tail counter is written by the client
+ * and therefore is not trusted. The head counter is only taken from the
+ * server-side copy.
+ *
+ * Caller must hold esdm_rpcs_ring_lock.
+ */
+static int esdm_rpcs_ring_fill(struct esdm_rpcs_ring *r)
+{
+	struct esdm_rpc_ring *ring = r->ring;
+	uint64_t tail = (uint64_t)atomic_read_64(&ring->tail);
+	uint64_t space;
+	uint32_t mask = r->size - 1;
+
+	if (tail > r->head || r->head - tail > r->size)
+		return -EFAULT;
+
+	space = r->size - (r->head - tail);
+	while (space) {
+		uint32_t offset = (uint32_t)(r->head & mask);
+		ssize_t ret = esdm_get_random_bytes_full_noblock(
+			ring->data + offset,
+			(size_t)min_uint64(space, r->size - offset));
+
+		/* Not yet fully seeded - the next wakeup retries */
+		if (ret <= 0)
+			break;
+
+		r->head += (uint64_t)ret;
+		space -= (uint64_t)ret;
+
+		/* Publish data after it is written */
+		atomic_set_64(&ring->head, (long long)r->head);
+	}
+
+	return 0;
+}
+
+static void esdm_rpcs_ring_event(uint32_t idx, uint32_t events)
+{
+	struct esdm_rpcs_ring *r;
+	uint8_t tmp[16];
+
+	if (idx >= ESDM_RPCS_RING_MAX)
+		return;
+
+	mutex_w_lock(&esdm_rpcs_ring_lock);
+
+	r = &esdm_rpcs_rings[idx];
+	if (!r->ring)
+		goto out;
+
+	/* Client is gone */
+	if (events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Releasing random ring %u\n", idx);
+		esdm_rpcs_ring_release(r);
+		goto out;
+	}
+
+	/* Drain all refill requests */
+	while (recv(r->ctrl_fd, tmp, sizeof(tmp), MSG_DONTWAIT) > 0)
+		;
+
+	if (esdm_rpcs_ring_fill(r)) {
+		esdm_logger(LOGGER_WARN, LOGGER_C_RPC,
+			    "Random ring %u corrupted by client\n", idx);
+		esdm_rpcs_ring_release(r);
+	}
+
+out:
+	mutex_w_unlock(&esdm_rpcs_ring_lock);
+}
+
+/* Refill all rings, e.g. after the DRNG became fully seeded */
+static void esdm_rpcs_ring_fill_all(void)
+{
+	unsigned int i;
+
+	mutex_w_lock(&esdm_rpcs_ring_lock);
+	for (i = 0; i < ESDM_RPCS_RING_MAX; i++) {
+		struct esdm_rpcs_ring *r = &esdm_rpcs_rings[i];
+
+		if (r->ring && esdm_rpcs_ring_fill(r))
+			esdm_rpcs_ring_release(r);
+	}
+	mutex_w_unlock(&esdm_rpcs_ring_lock);
+}
+
+static int esdm_rpcs_ring_filler(void *unused)
+{
+	struct epoll_event events[ESDM_RPCS_RING_EVENTS];
+	int i, nfds;
+
+	(void)unused;
+
+	thread_set_name(rpc_ring_filler, 0);
+	esdm_cpu_class_bind(esdm_cpu_class_performance);
+
+	while (!atomic_read(&esdm_rpcs_ring_exit)) {
+		/* Wake up regularly to check for termination */
+		nfds = epoll_wait(esdm_rpcs_ring_epfd, events,
+				  ESDM_RPCS_RING_EVENTS, 1000);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
+
+			esdm_logger(LOGGER_ERR, LOGGER_C_RPC,
+				    "Random ring filler: epoll_wait failed: %s\n",
+				    strerror(errno));
+			return -errno;
+		}
+
+		if (!nfds) {
+			esdm_rpcs_ring_fill_all();
+			continue;
+		}
+
+		for (i = 0; i < nfds; i++)
+			esdm_rpcs_ring_event(events[i].data.u32,
+					     events[i].events);
+	}
+
+	return 0;
+}
+
+/* Caller must hold esdm_rpcs_ring_lock */
+static int esdm_rpcs_ring_filler_start(void)
+{
+	unsigned int i;
+	int ret;
+
+	if (esdm_rpcs_ring_epfd >= 0)
+		return 0;
+
+	for (i = 0; i < ESDM_RPCS_RING_MAX; i++)
+		esdm_rpcs_rings[i].ctrl_fd = -1;
+
+	esdm_rpcs_ring_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (esdm_rpcs_ring_epfd < 0)
+		return -errno;
+
+	ret = thread_start(esdm_rpcs_ring_filler, NULL, 0, NULL);
+	if (ret) {
+		close(esdm_rpcs_ring_epfd);
+		esdm_rpcs_ring_epfd = -1;
+	}
+
+	return ret;
+}
+
+/*
+ * Create the memory file of the ring and map it. The file size is rounded up
+ * to the page size of the file which is the huge page size when using
+ * MFD_HUGETLB. The client derives the size of its mapping from the file size.
+ *
+ * Return: memory file descriptor on success, -errno on error
+ */
+static int esdm_rpcs_ring_map(struct esdm_rpcs_ring *r, uint32_t size,
+			      unsigned int flags)
+{
+	struct stat sb;
+	size_t maplen = sizeof(struct esdm_rpc_ring) + size;
+	int mfd = memfd_create("esdm_random_ring",
+			       MFD_CLOEXEC | MFD_ALLOW_SEALING | flags);
+	int ret;
+
+	if (mfd < 0)
+		return -errno;
+
+	if (fstat(mfd, &sb) < 0)
+		goto err;
+	if (sb.st_blksize > 0) {
+		size_t pagesize = (size_t)sb.st_blksize;
+
+		maplen = (maplen + pagesize - 1) & ~(pagesize - 1);
+	}
+
+	if (ftruncate(mfd, (off_t)maplen) < 0)
+		goto err;
+
+	/*
+	 * Prevent the client from truncating the file which would cause a
+	 * SIGBUS in the server when accessing the mapping.
+	 */
+	if (fcntl(mfd, F_ADD_SEALS,
+		  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+		goto err;
+
+	r->ring = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, mfd,
+		       0);
+	if (r->ring == MAP_FAILED) {
+		r->ring = NULL;
+		goto err;
+	}
+	r->maplen = maplen;
+
+	return mfd;
+
+err:
+	ret = -errno;
+	close(mfd);
+	return ret;
+}
+
+int esdm_rpcs_ring_alloc(uint32_t size, int *mem_fd, int *ctrl_fd,
+			 uint32_t *ring_size)
+{
+	struct esdm_rpcs_ring *r = NULL;
+	struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP };
+	int sv[2] = { -1, -1 };
+	int mfd = -1, ret;
+	uint32_t i;
+
+	BUILD_BUG_ON(ESDM_RPC_RING_SIZE & (ESDM_RPC_RING_SIZE - 1));
+	BUILD_BUG_ON(ESDM_RPC_RING_SIZE < ESDM_RPC_RING_MIN_SIZE);
+
+	/* Round the requested size up to the next power of 2 */
+	if (!size || size >= ESDM_RPC_RING_SIZE) {
+		size = ESDM_RPC_RING_SIZE;
+	} else {
+		uint32_t s = ESDM_RPC_RING_MIN_SIZE;
+
+		while (s < size)
+			s <<= 1;
+		size = s;
+	}
+
+	mutex_w_lock(&esdm_rpcs_ring_lock);
+
+	CKINT_LOG(esdm_rpcs_ring_filler_start(),
+		  "Starting random ring filler failed: %d\n", ret);
+
+	for (i = 0; i < ESDM_RPCS_RING_MAX; i++) {
+		if (!esdm_rpcs_rings[i].ring) {
+			r = &esdm_rpcs_rings[i];
+			break;
+		}
+	}
+	CKNULL(r, -EBUSY);
+
+#if defined(ESDM_RPC_RING_HUGETLB) && defined(MFD_HUGETLB)
+	mfd = esdm_rpcs_ring_map(r, size, MFD_HUGETLB);
+	if (mfd < 0) {
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "Random ring on huge pages not available: %d\n",
+			    mfd);
+		mfd = esdm_rpcs_ring_map(r, size, 0);
+	}
+#else
+	mfd = esdm_rpcs_ring_map(r, size, 0);
+#endif
+	if (mfd < 0) {
+		ret = mfd;
+		goto out;
+	}
+
+	r->ring->magic = ESDM_RPC_RING_MAGIC;
+	r->ring->size = size;
+	atomic_set_64(&r->ring->head, 0);
+	atomic_set_64(&r->ring->tail, 0);
+	r->size = size;
+	r->head = 0;
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+		ret = -errno;
+		goto out;
+	}
+	r->ctrl_fd = sv[0];
+	sv[0] = -1;
+	set_fd_nonblocking(r->ctrl_fd);
+
+	ev.data.u32 = i;
+	if (epoll_ctl(esdm_rpcs_ring_epfd, EPOLL_CTL_ADD, r->ctrl_fd, &ev) <
+	    0) {
+		ret = -errno;
+		goto out;
+	}
+
+	/* Pre-fill the ring, the filler retries if the DRNG is not ready */
+	CKINT(esdm_rpcs_ring_fill(r));
+
+	*mem_fd = mfd;
+	*ctrl_fd = sv[1];
+	*ring_size = size;
+	mfd = -1;
+	sv[1] = -1;
+
+	esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+		    "Random ring %u with %u bytes allocated\n", i, size);
+
+out:
+	if (ret && r)
+		esdm_rpcs_ring_release(r);
+	mutex_w_unlock(&esdm_rpcs_ring_lock);
+
+	if (mfd >= 0)
+		close(mfd);
+	if (sv[0] >= 0)
+		close(sv[0]);
+	if (sv[1] >= 0)
+		close(sv[1]);
+	return ret;
+}
+
+void esdm_rpcs_ring_fini(void)
+{
+	unsigned int i;
+
+	atomic_set(&esdm_rpcs_ring_exit, 1);
+
+	mutex_w_lock(&esdm_rpcs_ring_lock);
+	if (esdm_rpcs_ring_epfd >= 0) {
+		for (i = 0; i < ESDM_RPCS_RING_MAX; i++)
+			esdm_rpcs_ring_release(&esdm_rpcs_rings[i]);
+	}
+	mutex_w_unlock(&esdm_rpcs_ring_lock);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef ESDM_RPC_SERVER_RING_H
+#define ESDM_RPC_SERVER_RING_H
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "esdm_rpc_service.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ESDM_RPC_RING
+
+/**
+ * @brief Allocate a new shared memory ring filled with random data
+ *
+ * @param [in] size Requested size of the ring (0 selects the default size)
+ * @param [out] mem_fd File descriptor of the memory file holding the ring
+ * @param [out] ctrl_fd Client end of the control socket of the ring
+ * @param [out] ring_size Size of the data area of the ring
+ *
+ * The caller receives the ownership of both file descriptors and must close
+ * them after they were passed to the client.
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_rpcs_ring_alloc(uint32_t size, int *mem_fd, int *ctrl_fd,
+			 uint32_t *ring_size);
+
+/**
+ * @brief Terminate the ring filler and release all rings
+ */
+void esdm_rpcs_ring_fini(void);
+
+#else /* ESDM_RPC_RING */
+
+static inline int esdm_rpcs_ring_alloc(uint32_t size, int *mem_fd,
+				       int *ctrl_fd, uint32_t *ring_size)
+{
+	(void)size;
+	(void)mem_fd;
+	(void)ctrl_fd;
+	(void)ring_size;
+	return -EOPNOTSUPP;
+}
+
+static inline void esdm_rpcs_ring_fini(void)
+{
+}
+
+#endif /* ESDM_RPC_RING */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_RPC_SERVER_RING_H */
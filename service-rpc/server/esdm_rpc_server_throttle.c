@@ -0,0 +1,189 @@
+/* Per-user throttling of the RPC requests
+ *
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "atomic.h"
+#include "esdm_logger.h"
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_server_throttle.h"
+#include "esdm_rpc_service.h"
+#include "math_helper.h"
+#include "mutex_w.h"
+
+/*
+ * The token buckets are kept in a small hash table. A user is looked up in
+ * ESDM_RPCS_THROTTLE_PROBES consecutive slots, if none holds the user, the
+ * least recently used slot is taken over. An evicted user starts with a full
+ * bucket again which is only relevant with more than
+ * ESDM_RPCS_THROTTLE_SLOTS concurrently active users.
+ */
+#define ESDM_RPCS_THROTTLE_SLOTS 64
+#define ESDM_RPCS_THROTTLE_PROBES 4
+
+/* UID of the bucket shared by all peers without credentials */
+#define ESDM_RPCS_THROTTLE_NOCRED ((uid_t)-1)
+
+/* A bucket holds at least one maximum request */
+#define ESDM_RPCS_THROTTLE_BURST                                               \
+	((uint64_t)ESDM_RPCS_THROTTLE_RATE > ESDM_RPC_MAX_DATA ?               \
+		 (uint64_t)ESDM_RPCS_THROTTLE_RATE :                           \
+		 (uint64_t)ESDM_RPC_MAX_DATA)
+
+struct esdm_rpcs_bucket {
+	uid_t uid;
+	bool used;
+	uint64_t tokens; /* Bytes which may be requested */
+	uint64_t last_us; /* Time of the last refill */
+};
+
+static struct esdm_rpcs_bucket esdm_rpcs_buckets[ESDM_RPCS_THROTTLE_SLOTS];
+static DEFINE_MUTEX_W_UNLOCKED(esdm_rpcs_throttle_lock);
+static atomic_t esdm_rpcs_throttled = ATOMIC_INIT(0);
+
+static uint64_t esdm_rpcs_throttle_now(void)
+{
+	struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* Caller must hold esdm_rpcs_throttle_lock */
+static struct esdm_rpcs_bucket *esdm_rpcs_bucket_get(uid_t uid, uint64_t now)
+{
+	struct esdm_rpcs_bucket *b, *victim = NULL;
+	unsigned int i, slot = (unsigned int)uid * 2654435761U;
+
+	for (i = 0; i < ESDM_RPCS_THROTTLE_PROBES; i++) {
+		b = &esdm_rpcs_buckets[(slot + i) &
+				       (ESDM_RPCS_THROTTLE_SLOTS - 1)];
+
+		if (b->used && b->uid == uid)
+			return b;
+		if (!victim || !b->used ||
+		    (victim->used && b->last_us < victim->last_us))
+			victim = b;
+	}
+
+	victim->uid = uid;
+	victim->used = true;
+	victim->tokens = ESDM_RPCS_THROTTLE_BURST;
+	victim->last_us = now;
+
+	return victim;
+}
+
+/* Caller must hold esdm_rpcs_throttle_lock */
+static void esdm_rpcs_bucket_refill(struct esdm_rpcs_bucket *b, uint64_t now)
+{
+	/* Time after which an empty bucket is full again */
+	const uint64_t fill_us =
+		ESDM_RPCS_THROTTLE_BURST * 1000000ULL / ESDM_RPCS_THROTTLE_RATE;
+	uint64_t elapsed, added;
+
+	if (now <= b->last_us)
+		return;
+	elapsed = now - b->last_us;
+
+	if (elapsed >= fill_us) {
+		b->tokens = ESDM_RPCS_THROTTLE_BURST;
+	} else {
+		/* Keep the time base until at least one byte is credited */
+		added = elapsed * ESDM_RPCS_THROTTLE_RATE / 1000000ULL;
+		if (!added)
+			return;
+		b->tokens = min_uint64(b->tokens + added,
+				       ESDM_RPCS_THROTTLE_BURST);
+	}
+	b->last_us = now;
+}
+
+int esdm_rpcs_throttle(void *closure_data, size_t bytes)
+{
+	struct esdm_rpcs_bucket *b;
+	uint64_t now;
+	uid_t uid;
+	int ret = 0;
+
+	if (esdm_rpc_client_uid(closure_data, &uid))
+		uid = ESDM_RPCS_THROTTLE_NOCRED;
+
+	/* Privileged services are never throttled */
+	if (uid == 0)
+		return 0;
+
+	now = esdm_rpcs_throttle_now();
+
+	mutex_w_lock(&esdm_rpcs_throttle_lock);
+	b = esdm_rpcs_bucket_get(uid, now);
+	esdm_rpcs_bucket_refill(b, now);
+	if (b->tokens >= bytes)
+		b->tokens -= bytes;
+	else
+		ret = -EAGAIN;
+	mutex_w_unlock(&esdm_rpcs_throttle_lock);
+
+	if (ret) {
+		atomic_inc(&esdm_rpcs_throttled);
+		esdm_logger(LOGGER_DEBUG, LOGGER_C_RPC,
+			    "request of %zu bytes of UID %u throttled\n", bytes,
+			    (unsigned int)uid);
+	}
+
+	return ret;
+}
+
+void esdm_rpcs_throttle_status(char *buf, size_t buflen)
+{
+	snprintf(buf, buflen,
+		 "RPC throttling: %u bytes/s per user\n"
+		 " Throttled requests: %d\n",
+		 ESDM_RPCS_THROTTLE_RATE, atomic_read(&esdm_rpcs_throttled));
+}
+
+#ifdef ESDM_METRICS
+
+void esdm_rpcs_throttle_metrics(struct esdm_metrics_buf *mb)
+{
+	esdm_metrics_printf(mb,
+			    "# TYPE esdm_rpc_throttled_requests counter\n"
+			    "# HELP esdm_rpc_throttled_requests Requests "
+			    "rejected by the per-user rate limit\n"
+			    "esdm_rpc_throttled_requests_total %d\n",
+			    atomic_read(&esdm_rpcs_throttled));
+}
+
+#else /* ESDM_METRICS */
+
+void esdm_rpcs_throttle_metrics(struct esdm_metrics_buf *mb)
+{
+	(void)mb;
+}
+
+#endif /* ESDM_METRICS */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#ifndef ESDM_RPC_SERVER_THROTTLE_H
+#define ESDM_RPC_SERVER_THROTTLE_H
+
+#include <errno.h>
+#include <stddef.h>
+
+#include "config.h"
+#include "metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ESDM_RPCS_THROTTLE
+
+/**
+ * @brief Charge a request against the token bucket of the calling user
+ *
+ * Every unprivileged user has a token bucket which is refilled with
+ * ESDM_RPCS_THROTTLE_RATE bytes per second. Requests of UID 0 are not
+ * throttled, all peers without credentials share one bucket.
+ *
+ * @param [in] closure_data Connection of the request
+ * @param [in] bytes Number of bytes requested
+ *
+ * @return 0 if the request is served, -EAGAIN if it is throttled
+ */
+int esdm_rpcs_throttle(void *closure_data, size_t bytes);
+
+/**
+ * @brief Print the status of the request throttling
+ *
+ * @param [out] buf Buffer the NUL-terminated status is written to
+ * @param [in] buflen Size of the buffer
+ */
+void esdm_rpcs_throttle_status(char *buf, size_t buflen);
+
+/**
+ * @brief Append the throttling counter in the OpenMetrics text format
+ *
+ * @param [in] mb Buffer to append to
+ */
+void esdm_rpcs_throttle_metrics(struct esdm_metrics_buf *mb);
+
+#else /* ESDM_RPCS_THROTTLE */
+
+static inline int esdm_rpcs_throttle(void *closure_data, size_t bytes)
+{
+	(void)closure_data;
+	(void)bytes;
+	return 0;
+}
+
+static inline void esdm_rpcs_throttle_status(char *buf, size_t buflen)
+{
+	if (buflen)
+		buf[0] = '\0';
+}
+
+static inline void esdm_rpcs_throttle_metrics(struct esdm_metrics_buf *mb)
+{
+	(void)mb;
+}
+
+#endif /* ESDM_RPCS_THROTTLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_RPC_SERVER_THROTTLE_H */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2022 - 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+
+#include "esdm_config.h"
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_service.h"
+#include "priv_access.pb-c.h"
+
+void esdm_rpc_set_config(PrivAccess_Service *service,
+			 const SetConfigRequest *request,
+			 SetConfigResponse_Closure closure, void *closure_data)
+{
+	SetConfigResponse response = SET_CONFIG_RESPONSE__INIT;
+	(void)service;
+
+	if (request == NULL || request->name == NULL) {
+		response.ret = -EFAULT;
+		closure(&response, closure_data);
+	} else if (!esdm_rpc_client_is_privileged(closure_data)) {
+		response.ret = -EPERM;
+		closure(&response, closure_data);
+	} else {
+		response.ret = esdm_config_set(request->name, request->value);
+		closure(&response, closure_data);
+	}
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <string.h>
+
+#include "esdm.h"
+#include "esdm_rpc_service.h"
+#include "math_helper.h"
+#include "unpriv_access.pb-c.h"
+
+void esdm_rpc_status_bin(UnprivAccess_Service *service,
+			 const StatusBinRequest *request,
+			 StatusBinResponse_Closure closure, void *closure_data)
+{
+	StatusBinResponse response = STATUS_BIN_RESPONSE__INIT;
+	struct esdm_status_bin status;
+	(void)service;
+
+	if (request == NULL) {
+		response.ret = -(int32_t)sizeof(status);
+		closure(&response, closure_data);
+		return;
+	}
+
+	response.ret = esdm_status_bin(&status);
+	if (!response.ret) {
+		response.status.data = (uint8_t *)&status;
+		response.status.len = min_size(request->maxlen, sizeof(status));
+	}
+	closure(&response, closure_data);
+}
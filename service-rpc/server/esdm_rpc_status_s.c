@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include "esdm.h"
+#include "esdm_rpc_server.h"
 #include "esdm_rpc_service.h"
 #include "math_helper.h"
 #include "unpriv_access.pb-c.h"
@@ -36,8 +37,13 @@ void esdm_rpc_status(UnprivAccess_Service *service,
 		response.ret = -(int32_t)sizeof(status);
 		closure(&response, closure_data);
 	} else {
-		esdm_status(status,
-			    min_uint32(request->maxlen, ESDM_RPC_MAX_MSG_SIZE));
+		size_t len = min_uint32(request->maxlen, ESDM_RPC_MAX_MSG_SIZE);
+		size_t used;
+
+		esdm_status(status, len);
+		used = strnlen(status, len);
+		if (used + 1 < len)
+			esdm_rpc_server_status(status + used, len - used);
 		response.ret = 0;
 		response.buffer = status;
 		closure(&response, closure_data);
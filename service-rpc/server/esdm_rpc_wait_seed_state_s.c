@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include "esdm_rpc_server.h"
+#include "esdm_rpc_service.h"
+#include "esdm_shm_status.h"
+#include "unpriv_access.pb-c.h"
+
+/* Seed states a client may wait for */
+#define ESDM_RPC_WAIT_SEED_STATES                                              \
+	(ESDM_SHM_SEED_MIN_SEEDED | ESDM_SHM_SEED_FULLY_SEEDED |               \
+	 ESDM_SHM_SEED_ALL_NODES_SEEDED | ESDM_SHM_SEED_OPERATIONAL)
+
+void esdm_rpc_wait_seed_state(UnprivAccess_Service *service,
+			      const WaitSeedStateRequest *request,
+			      WaitSeedStateResponse_Closure closure,
+			      void *closure_data)
+{
+	WaitSeedStateResponse response = WAIT_SEED_STATE_RESPONSE__INIT;
+	struct timespec ts;
+	uint32_t seed_state;
+
+	(void)service;
+
+	if (request == NULL || request->states & ~ESDM_RPC_WAIT_SEED_STATES) {
+		response.ret = -EINVAL;
+		closure(&response, closure_data);
+		return;
+	}
+
+	seed_state = esdm_shm_status_seed_state();
+	if ((seed_state & request->states) != request->states) {
+		ts.tv_sec = (time_t)(request->timeout_ms / 1000);
+		ts.tv_nsec = (long)(request->timeout_ms % 1000) * 1000000L;
+
+		/* Wait without occupying the thread if possible */
+		if (!esdm_rpc_server_seed_state_wait(closure_data,
+						     request->states, &ts))
+			return;
+
+		/* A resumed request or one without timeout does not wait */
+		if (request->timeout_ms)
+			esdm_shm_status_seed_wait(request->states, &ts);
+		seed_state = esdm_shm_status_seed_state();
+	}
+
+	response.states = seed_state & ESDM_RPC_WAIT_SEED_STATES;
+	response.ret = ((seed_state & request->states) == request->states) ?
+			       0 :
+			       -ETIMEDOUT;
+	closure(&response, closure_data);
+}
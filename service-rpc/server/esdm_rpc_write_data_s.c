@@ -43,9 +43,11 @@ void esdm_rpc_write_data(UnprivAccess_Service *service,
 
 		/*
 		 * And now force a reseed to ensure the data is properly
-		 * dispersed into the DRNGs.
+		 * dispersed into the DRNGs. The resume notification of the
+		 * server signal helper reseeds all DRNGs right away.
 		 */
-		esdm_drng_force_reseed();
+		if (!esdm_drng_resume())
+			esdm_drng_force_reseed();
 
 		closure(&response, closure_data);
 	}
@@ -18,9 +18,12 @@
  */
 
 #define _DEFAULT_SOURCE
+#include <ctype.h>
 #include <errno.h>
 #include <grp.h>
 #include <pwd.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -30,6 +33,27 @@
 #include "privileges.h"
 #include "visibility.h"
 
+/*
+ * A numeric user ID allows dropping the privileges without a user database,
+ * e.g. in an initramfs. The group ID is set to the same value.
+ */
+static int drop_privileges_numeric_id(const char *user, uid_t *uid)
+{
+	unsigned long val;
+	char *end;
+
+	if (!isdigit((unsigned char)user[0]))
+		return -ENOENT;
+
+	errno = 0;
+	val = strtoul(user, &end, 10);
+	if (errno || *end || !val || val >= UINT32_MAX)
+		return -ENOENT;
+
+	*uid = (uid_t)val;
+	return 0;
+}
+
 int drop_privileges_permanent(const char *user)
 {
 	const struct passwd *pwd;
@@ -45,15 +69,17 @@ int drop_privileges_permanent(const char *user)
 		return ret;
 
 	pwd = getpwnam(user);
-	if (pwd == NULL) {
+	if (pwd) {
+		uid = pwd->pw_uid;
+		gid = pwd->pw_gid;
+	} else if (!drop_privileges_numeric_id(user, &uid)) {
+		gid = (gid_t)uid;
+	} else {
 		esdm_logger(LOGGER_ERR, LOGGER_C_ANY, "User %s unknown\n",
 			    user);
 		return -ENOENT;
 	}
 
-	uid = pwd->pw_uid;
-	gid = pwd->pw_gid;
-
 	/* Drop all supplemental groups */
 	if (setgroups(0, NULL) == -1) {
 		ret = -errno;
@@ -19,36 +19,187 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "buffer.h"
+#include "config.h"
 #include "esdm_rpc_protocol.h"
+#include "math_helper.h"
+#include "memset_secure.h"
+#include "metrics.h"
 
-/* Allocate 8-byte aligned memory from thread local storage */
-void *esdm_rpc_alloc(void *allocator_data, size_t size)
+/*
+ * Per-thread bump arena used for decoding and encoding RPC messages. The
+ * memory is allocated from the current chunk, if it is exhausted, a new
+ * chunk of at least twice the size is added. Resetting the arena clears all
+ * used memory and merges the chunks into one chunk large enough to serve the
+ * next message of the same size without further allocations.
+ */
+#define ESDM_RPC_ARENA_CHUNK_MIN 4096
+
+struct esdm_rpc_arena_chunk {
+	struct esdm_rpc_arena_chunk *next;
+	size_t len;
+	size_t consumed;
+	uint64_t data[];
+};
+
+struct esdm_rpc_arena {
+	struct esdm_rpc_arena_chunk *chunks; /* Current chunk first */
+};
+
+static __thread struct esdm_rpc_arena *esdm_rpc_arena_thread = NULL;
+static pthread_key_t esdm_rpc_arena_key;
+static pthread_once_t esdm_rpc_arena_once = PTHREAD_ONCE_INIT;
+static int esdm_rpc_arena_key_ret = 0;
+
+static struct esdm_rpc_arena_chunk *esdm_rpc_arena_chunk_alloc(size_t len)
+{
+	struct esdm_rpc_arena_chunk *chunk;
+
+	len = ALIGN(len, sizeof(uint64_t) - 1);
+	chunk = malloc(sizeof(*chunk) + len);
+	if (!chunk)
+		return NULL;
+
+	chunk->next = NULL;
+	chunk->len = len;
+	chunk->consumed = 0;
+	esdm_mem_account(esdm_mem_rpc_buf, (int64_t)(sizeof(*chunk) + len));
+
+	return chunk;
+}
+
+static void esdm_rpc_arena_free(struct esdm_rpc_arena *arena)
+{
+	struct esdm_rpc_arena_chunk *chunk, *next;
+
+	for (chunk = arena->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		memset_secure(chunk->data, 0, chunk->consumed);
+		esdm_mem_account(esdm_mem_rpc_buf,
+				 -(int64_t)(sizeof(*chunk) + chunk->len));
+		free(chunk);
+	}
+	arena->chunks = NULL;
+}
+
+static void esdm_rpc_arena_destructor(void *data)
 {
-	struct buffer *tlh = allocator_data;
-	uint8_t *new = tlh->buf + tlh->consumed;
-	uint8_t *new_aligned = ALIGN_PTR_8(new, 8);
+	struct esdm_rpc_arena *arena = data;
+
+	if (!arena)
+		return;
 
-	/* Add any potential alignment offset to the required size */
-	size += (unsigned long)new_aligned - (unsigned long)new;
+	esdm_rpc_arena_free(arena);
+	free(arena);
+}
+
+static void esdm_rpc_arena_key_init(void)
+{
+	esdm_rpc_arena_key_ret = -pthread_key_create(&esdm_rpc_arena_key,
+						     esdm_rpc_arena_destructor);
+}
 
-	/* If the size request overflows the available memory, return nothing */
-	if (size > (tlh->len - tlh->consumed))
+struct esdm_rpc_arena *esdm_rpc_arena_get(void)
+{
+	struct esdm_rpc_arena *arena = esdm_rpc_arena_thread;
+
+	if (arena)
+		return arena;
+
+	pthread_once(&esdm_rpc_arena_once, esdm_rpc_arena_key_init);
+	if (esdm_rpc_arena_key_ret)
 		return NULL;
 
-	/* Adjust the consumed memory indicator */
-	tlh->consumed += size;
-	memset(new_aligned, 0, size);
+	arena = calloc(1, sizeof(*arena));
+	if (!arena)
+		return NULL;
 
-	/* Return the aligned memory */
-	return new_aligned;
+	if (pthread_setspecific(esdm_rpc_arena_key, arena)) {
+		free(arena);
+		return NULL;
+	}
+
+	esdm_rpc_arena_thread = arena;
+	return arena;
+}
+
+void *esdm_rpc_arena_alloc(struct esdm_rpc_arena *arena, size_t size)
+{
+	struct esdm_rpc_arena_chunk *chunk = arena->chunks;
+	uint8_t *new;
+
+	/* Keep all allocations 8-byte aligned */
+	size = ALIGN(size, sizeof(uint64_t) - 1);
+
+	if (!chunk || size > chunk->len - chunk->consumed) {
+		size_t len = ESDM_RPC_ARENA_CHUNK_MIN;
+
+		if (chunk)
+			len = max_size(len, chunk->len << 1);
+		chunk = esdm_rpc_arena_chunk_alloc(max_size(len, size));
+		if (!chunk)
+			return NULL;
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	new = (uint8_t *)chunk->data + chunk->consumed;
+	chunk->consumed += size;
+	memset(new, 0, size);
+
+	return new;
+}
+
+bool esdm_rpc_arena_empty(const struct esdm_rpc_arena *arena)
+{
+	const struct esdm_rpc_arena_chunk *chunk;
+
+	for (chunk = arena->chunks; chunk; chunk = chunk->next) {
+		if (chunk->consumed)
+			return false;
+	}
+
+	return true;
+}
+
+void esdm_rpc_arena_reset(struct esdm_rpc_arena *arena)
+{
+	struct esdm_rpc_arena_chunk *chunk;
+	size_t len = 0;
+
+	if (!arena->chunks)
+		return;
+
+	/* Common case: the message fit into one chunk */
+	chunk = arena->chunks;
+	if (!chunk->next) {
+		memset_secure(chunk->data, 0, chunk->consumed);
+		chunk->consumed = 0;
+		return;
+	}
+
+	for (chunk = arena->chunks; chunk; chunk = chunk->next)
+		len += chunk->len;
+
+	esdm_rpc_arena_free(arena);
+	arena->chunks = esdm_rpc_arena_chunk_alloc(len);
+}
+
+/* Allocate 8-byte aligned memory from the per-thread arena */
+void *esdm_rpc_alloc(void *allocator_data, size_t size)
+{
+	return esdm_rpc_arena_alloc(allocator_data, size);
 }
 
 /*
- * Do not free the thread local storage - at the end of the whole operation
- * the thread-local storage will be cleared anyway.
+ * Do not free the individual allocations - at the end of the whole operation
+ * the arena will be reset anyway.
  */
 void esdm_rpc_free(void *allocator_data, void *data)
 {
@@ -65,6 +216,23 @@ void set_fd_nonblocking(int fd)
 		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
+socklen_t esdm_rpc_unix_addr(struct sockaddr_un *addr, const char *name)
+{
+	size_t len = min_size(strlen(name), sizeof(addr->sun_path) - 1);
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+#ifdef ESDM_RPC_ABSTRACT_SOCKET
+	/* The leading NUL byte selects the abstract namespace */
+	memcpy(addr->sun_path + 1, name, len);
+	return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + len);
+#else
+	memcpy(addr->sun_path, name, len);
+	return (socklen_t)sizeof(*addr);
+#endif
+}
+
 int esdm_rpc_proto_get_descriptor(const ProtobufCService *service,
 				  const struct esdm_rpc_proto_cs *received_data,
 				  const ProtobufCMessageDescriptor **desc)
@@ -22,6 +22,10 @@
 
 #include <protobuf-c/protobuf-c.h>
 #include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "bool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -64,7 +68,66 @@ struct esdm_rpc_proto_sc {
 	uint8_t data[];
 } __attribute__((packed));
 
-/* Use same error codes as protobuf-c-rpc */
+/*
+ * Compact wire format for the hot methods of the unprivileged interface which
+ * is used on a connection after negotiating ESDM_RPC_PROTO_VERSION_FAST_WIRE.
+ * It bypasses protobuf-c entirely: a request consists of the header only, the
+ * response header is followed by the raw random bytes.
+ *	client issues request with header:
+ *		method		32-bit little-endian (magic value | method)
+ *		flags		32-bit little-endian (ESDM_RPC_FAST_FLAG_*)
+ *		length		32-bit little-endian (requested random bytes)
+ *	server responds with header:
+ *		status		32-bit little-endian (value or negative errno)
+ *		method		32-bit little-endian (as requested)
+ *		flags		32-bit little-endian (reserved, 0)
+ *		length		32-bit little-endian (random bytes following)
+ *
+ * The request has the size of the protobuf-c-rpc request header. The magic
+ * value in the upper bits of the method distinguishes it from a protobuf
+ * request whose method index is small.
+ */
+#define ESDM_RPC_FAST_MAGIC 0x46570000U
+#define ESDM_RPC_FAST_MAGIC_MASK 0xffff0000U
+
+/*
+ * Request flags: the lower bits hold the CPU of the client if
+ * ESDM_RPC_FAST_FLAG_CPU is set, all other bits are reserved and must be 0.
+ * The flag requires ESDM_RPC_PROTO_VERSION_CPU_HINT.
+ */
+#define ESDM_RPC_FAST_FLAG_CPU 0x80000000U
+#define ESDM_RPC_FAST_CPU_MASK 0x0000ffffU
+
+enum esdm_rpc_fast_method {
+	/* status: number of random bytes or error */
+	esdm_rpc_fast_get_random_bytes,
+	/* status: number of random bytes, -EAGAIN if not fully seeded */
+	esdm_rpc_fast_get_random_bytes_full,
+	/* status: 1 if fully seeded, 0 otherwise */
+	esdm_rpc_fast_is_fully_seeded,
+	/* status: available entropy in bits */
+	esdm_rpc_fast_get_ent_lvl,
+	esdm_rpc_fast_method_num,
+};
+
+struct esdm_rpc_fast_cs {
+	uint32_t method;
+	uint32_t flags;
+	uint32_t length;
+} __attribute__((packed));
+
+struct esdm_rpc_fast_sc {
+	uint32_t status;
+	uint32_t method;
+	uint32_t flags;
+	uint32_t length;
+} __attribute__((packed));
+
+/*
+ * Use same error codes as protobuf-c-rpc. TOO_MANY_PENDING is sent by an
+ * overloaded server as the only message of a new connection before closing it,
+ * the header is not bound to any request.
+ */
 typedef enum {
 	PROTOBUF_C_RPC_STATUS_CODE_SUCCESS,
 	PROTOBUF_C_RPC_STATUS_CODE_SERVICE_FAILED,
@@ -73,11 +136,54 @@ typedef enum {
 
 void set_fd_nonblocking(int fd);
 
+/**
+ * @brief Fill the Unix domain socket address of an RPC interface
+ *
+ * If the ESDM is compiled to use the Linux abstract socket namespace, the
+ * name does not refer to a file system object.
+ *
+ * @param [out] addr Socket address to be filled
+ * @param [in] name Name of the RPC interface
+ *
+ * @return: length of the socket address
+ */
+socklen_t esdm_rpc_unix_addr(struct sockaddr_un *addr, const char *name);
+
 int esdm_rpc_proto_get_descriptor(const ProtobufCService *service,
 				  const struct esdm_rpc_proto_cs *received_data,
 				  const ProtobufCMessageDescriptor **desc);
 
-/* Helpers used for protobuf-c allocator */
+struct esdm_rpc_arena;
+
+/**
+ * @brief Get the arena of the calling thread
+ *
+ * The arena serves the memory for unpacking and packing RPC messages. It
+ * grows on demand and must be reset with esdm_rpc_arena_reset after the
+ * message is processed.
+ *
+ * @return arena on success, NULL on allocation failure
+ */
+struct esdm_rpc_arena *esdm_rpc_arena_get(void);
+
+/**
+ * @brief Allocate zeroized 8-byte aligned memory from the arena
+ *
+ * @return pointer to memory, NULL on allocation failure
+ */
+void *esdm_rpc_arena_alloc(struct esdm_rpc_arena *arena, size_t size);
+
+/**
+ * @brief Is no memory allocated from the arena?
+ */
+bool esdm_rpc_arena_empty(const struct esdm_rpc_arena *arena);
+
+/**
+ * @brief Release and clear all memory allocated from the arena
+ */
+void esdm_rpc_arena_reset(struct esdm_rpc_arena *arena);
+
+/* Helpers used for protobuf-c allocator - allocator_data is the arena */
 void *esdm_rpc_alloc(void *allocator_data, size_t size);
 void esdm_rpc_free(void *allocator_data, void *data);
 
@@ -20,8 +20,13 @@
 #ifndef ESDM_RPC_SERVICE_H
 #define ESDM_RPC_SERVICE_H
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
 #include <sys/ipc.h>
 
+#include "atomic.h"
+#include "atomic_64.h"
 #include "atomic_bool.h"
 #include "config.h"
 #include "esdm_rpc_protocol.h"
@@ -43,6 +48,10 @@ extern "C" {
 
 #define ESDM_RPC_PRIV_SOCKET "/tmp/esdm-rpc-priv-testmode.socket"
 
+/* The hand-over socket is created in a directory accessible by root only */
+#define ESDM_RPC_HANDOVER_DIR "/tmp/esdm-rpc-handover-testmode"
+#define ESDM_RPC_HANDOVER_SOCKET ESDM_RPC_HANDOVER_DIR "/esdm-rpc-handover.socket"
+
 #define ESDM_SHM_NAME "/"
 #define ESDM_SHM_STATUS 0x6573646d
 
@@ -56,6 +65,10 @@ extern "C" {
 
 #define ESDM_RPC_PRIV_SOCKET ESDM_SERVER_RPC_BASE_PATH "/esdm-rpc-priv.socket"
 
+/* The hand-over socket is created in a directory accessible by root only */
+#define ESDM_RPC_HANDOVER_DIR ESDM_SERVER_RPC_BASE_PATH "/esdm-rpc-handover"
+#define ESDM_RPC_HANDOVER_SOCKET ESDM_RPC_HANDOVER_DIR "/esdm-rpc-handover.socket"
+
 #define ESDM_SHM_NAME "/"
 #define ESDM_SHM_STATUS 0x6d647365
 
@@ -65,28 +78,310 @@ extern "C" {
 
 #endif /* ESDM_TESTMODE */
 
-#define ESDM_SHM_STATUS_VERSION 1
+/*
+ * Sharded server: shard N of K serves both interfaces on the sockets with the
+ * suffix ".N" and is seeded by the ESDM server on the sockets above. The CPUs
+ * are split into K contiguous blocks, the clients on the CPUs of block N use
+ * shard N.
+ */
+static inline void esdm_rpc_shard_socket(char *buf, size_t buflen,
+					 const char *socketname, uint32_t shard)
+{
+	snprintf(buf, buflen, "%s.%u", socketname, shard);
+}
+
+static inline uint32_t esdm_rpc_shard_of_node(uint32_t node, uint32_t nodes,
+					      uint32_t shards)
+{
+	uint32_t block;
+
+	if (!shards || !nodes)
+		return 0;
+
+	block = (nodes + shards - 1) / shards;
+	node /= block;
+
+	return node < shards ? node : shards - 1;
+}
+
+#define ESDM_SHM_STATUS_VERSION 6
 #define ESDM_SHM_STATUS_INFO_SIZE 1536
 
+/*
+ * Layout of the status segment: the fields written by the server at
+ * different rates are placed on separate cache lines, the status text is
+ * placed on its own page. A reader polling one group of fields therefore
+ * does not see cache line transfers caused by updates of another group.
+ */
+#define ESDM_SHM_CACHELINE 64
+#define ESDM_SHM_PAGE 4096
+
 struct esdm_shm_status {
 	/* Monotonic increasing version */
 	uint32_t version;
 
-	/* String with status information */
-	char info[ESDM_SHM_STATUS_INFO_SIZE];
-	size_t infolen;
-
 	/* Number of threads handling the unprivileged interface */
 	uint32_t unpriv_threads;
 
 	/* Is the ESDM operational? */
-	atomic_bool_t operational;
+	atomic_bool_t operational __attribute__((aligned(ESDM_SHM_CACHELINE)));
 	/* Do we need new entropy? */
 	atomic_bool_t need_entropy;
 	/* Wake up due to suspend/hibernate trigger */
 	atomic_bool_t suspend_trigger;
+
+	/*
+	 * Event words, see esdm_shm_event.h: status_event is signaled when
+	 * one of the flags above changes, need_entropy_event when the ESDM
+	 * starts to need entropy. Both are signaled on suspend and when the
+	 * server terminates.
+	 */
+	atomic_t status_event;
+	atomic_t need_entropy_event;
+
+	/*
+	 * Generation counter of the ESDM DRNG state: it is incremented when
+	 * the DRNGs are reseeded, a reseed is forced or a suspend/resume is
+	 * signaled. Client-side DRNGs must obtain a new seed when the counter
+	 * changes. Seed material is never placed into the shared memory.
+	 */
+	atomic_64_t rng_generation __attribute__((aligned(ESDM_SHM_CACHELINE)));
+
+	/*
+	 * Values of the /proc/sys/kernel/random files. The server increments
+	 * proc_version before and after updating them, i.e. the values are
+	 * consistent if proc_version is even and unchanged while reading
+	 * them. The values change only together with proc_version.
+	 */
+	atomic_t proc_version __attribute__((aligned(ESDM_SHM_CACHELINE)));
+	uint32_t entropy_avail;
+	uint32_t poolsize;
+	uint32_t write_wakeup_thresh;
+	uint32_t min_reseed_secs;
+
+	/*
+	 * Seed state (ESDM_SHM_SEED_* flags) and entropy level of all entropy
+	 * sources as reported by RpcIsMinSeeded, RpcIsFullySeeded and
+	 * RpcGetEntLvl. The values are updated with every seed state change,
+	 * entropy event and run of the entropy source monitor. They are only
+	 * valid while ESDM_SHM_SEED_VALID is set, the server clears it when
+	 * terminating. seed_version is handled like proc_version. The event
+	 * word seed_event is signaled when seed_state changes.
+	 */
+	atomic_t seed_version __attribute__((aligned(ESDM_SHM_CACHELINE)));
+	uint32_t seed_state;
+	uint32_t ent_lvl;
+	atomic_t seed_event;
+
+	/*
+	 * String with status information. It is only refreshed when the
+	 * operational state changes, info_version is handled like
+	 * proc_version.
+	 */
+	atomic_t info_version __attribute__((aligned(ESDM_SHM_PAGE)));
+	size_t infolen;
+	char info[ESDM_SHM_STATUS_INFO_SIZE];
+};
+
+#define ESDM_SHM_SEED_MIN_SEEDED (1U << 0)
+#define ESDM_SHM_SEED_FULLY_SEEDED (1U << 1)
+#define ESDM_SHM_SEED_ALL_NODES_SEEDED (1U << 2)
+#define ESDM_SHM_SEED_OPERATIONAL (1U << 3)
+#define ESDM_SHM_SEED_VALID (1U << 31)
+
+/**
+ * @brief Read the /proc/sys/kernel/random values from the status segment
+ *
+ * @param [in] status Status shared memory segment
+ * @param [out] values Array receiving entropy_avail, poolsize,
+ *		       write_wakeup_thresh and min_reseed_secs in that order
+ *
+ * @return proc_version the values belong to
+ */
+static inline int
+esdm_shm_status_proc_values(const struct esdm_shm_status *status,
+			    uint32_t values[4])
+{
+	int version;
+
+	for (;;) {
+		version = atomic_read(&status->proc_version);
+		if (version & 1)
+			continue;
+
+		values[0] = status->entropy_avail;
+		values[1] = status->poolsize;
+		values[2] = status->write_wakeup_thresh;
+		values[3] = status->min_reseed_secs;
+
+		if (atomic_read(&status->proc_version) == version)
+			return version;
+	}
+}
+
+/* Number of attempts to read consistent values */
+#define ESDM_SHM_READ_TRIES 64
+
+/**
+ * @brief Read the seed state from the status segment
+ *
+ * @param [in] status Status shared memory segment
+ * @param [out] seed_state ESDM_SHM_SEED_* flags
+ * @param [out] ent_lvl Entropy level of all entropy sources
+ *
+ * @return 0 on success, -EAGAIN if no consistent state could be read
+ */
+static inline int
+esdm_shm_status_seed_values(const struct esdm_shm_status *status,
+			    uint32_t *seed_state, uint32_t *ent_lvl)
+{
+	unsigned int i;
+	int version;
+
+	for (i = 0; i < ESDM_SHM_READ_TRIES; i++) {
+		version = atomic_read(&status->seed_version);
+		if (version & 1)
+			continue;
+
+		*seed_state = status->seed_state;
+		*ent_lvl = status->ent_lvl;
+
+		if (atomic_read(&status->seed_version) == version)
+			return 0;
+	}
+
+	return -EAGAIN;
+}
+
+/**
+ * @brief Copy the status text from the status segment
+ *
+ * @param [in] status Status shared memory segment
+ * @param [out] buf Buffer receiving the NUL-terminated text
+ * @param [in] buflen Size of the buffer
+ *
+ * @return length of the text, 0 if no consistent text could be read
+ */
+static inline size_t esdm_shm_status_info(const struct esdm_shm_status *status,
+					  char *buf, size_t buflen)
+{
+	unsigned int i;
+	size_t len;
+	int version;
+
+	if (!buflen)
+		return 0;
+
+	for (i = 0; i < ESDM_SHM_READ_TRIES; i++) {
+		version = atomic_read(&status->info_version);
+		if (version & 1)
+			continue;
+
+		len = status->infolen;
+		if (len >= buflen)
+			len = buflen - 1;
+		if (len > sizeof(status->info))
+			len = sizeof(status->info);
+		memcpy(buf, status->info, len);
+		buf[len] = '\0';
+
+		if (atomic_read(&status->info_version) == version)
+			return len;
+	}
+
+	buf[0] = '\0';
+	return 0;
+}
+
+/*
+ * Shared memory ring with random data for the unprivileged interface
+ *
+ * The server creates one ring per client which is provided as a memory file
+ * together with a control socket in response to RpcGetRandomRing. The server
+ * is the only producer and the client the only consumer: the server writes
+ * random data into the free space and then advances head. The client copies
+ * random data out of the ring, zeroizes the copied bytes and then advances
+ * tail. A client requests a refill by writing one byte into the control
+ * socket. When the client closes the control socket, the server releases the
+ * ring.
+ *
+ * Both counters are monotonic increasing byte counters. The offset into the
+ * data area is the counter modulo the ring size.
+ */
+#if defined(ESDM_LINUX) && (ESDM_RPC_RING_SIZE > 0)
+#define ESDM_RPC_RING
+#endif
+
+#define ESDM_RPC_RING_MAGIC 0x72696e67
+#define ESDM_RPC_RING_MIN_SIZE 4096
+
+struct esdm_rpc_ring {
+	/* Magic value ESDM_RPC_RING_MAGIC */
+	uint32_t magic;
+
+	/* Size of the data area in bytes - it is a power of 2 */
+	uint32_t size;
+
+	/* Number of bytes written by the server */
+	atomic_64_t head __attribute__((aligned(64)));
+
+	/* Number of bytes consumed by the client */
+	atomic_64_t tail __attribute__((aligned(64)));
+
+	/* Random data */
+	uint8_t data[] __attribute__((aligned(64)));
+};
+
+/*
+ * Shared memory ring for the injection of entropy by privileged feeders
+ *
+ * The ring uses the layout of struct esdm_rpc_ring with the roles reversed:
+ * the server creates one ring per feeder in response to RpcGetEntropyRing.
+ * The feeder is the only producer: it writes records into the free space and
+ * then advances head. The server is the only consumer: it inserts the records
+ * into the auxiliary pool, zeroizes them and then advances tail. A feeder
+ * requests the draining of the ring by writing one byte into the control
+ * socket, otherwise the server drains the ring regularly.
+ *
+ * Each record consists of struct esdm_rpc_ent_record followed by the data
+ * and is padded to a multiple of ESDM_RPC_ENT_RING_ALIGN bytes. A record never
+ * wraps around the end of the data area: if the space up to the end is too
+ * small, the feeder fills it with a padding record using
+ * ESDM_RPC_ENT_RING_PAD as entropy_bits and continues at the start.
+ */
+#if defined(ESDM_LINUX) && (ESDM_RPC_ENT_RING_SIZE > 0)
+#define ESDM_RPC_ENT_RING
+#endif
+
+/* Rings are set up by passing file descriptors */
+#if defined(ESDM_RPC_RING) || defined(ESDM_RPC_ENT_RING)
+#define ESDM_RPC_PASS_FDS
+#endif
+
+#define ESDM_RPC_ENT_RING_MAGIC 0x656e7472
+#define ESDM_RPC_ENT_RING_MIN_SIZE 4096
+#define ESDM_RPC_ENT_RING_ALIGN 8
+#define ESDM_RPC_ENT_RING_PAD 0xffffffff
+
+struct esdm_rpc_ent_record {
+	/* Size of the data following the record header in bytes */
+	uint32_t len;
+
+	/* Entropy of the data in bits or ESDM_RPC_ENT_RING_PAD */
+	uint32_t entropy_bits;
 };
 
+/*
+ * Seed for a DRNG lease
+ *
+ * A client obtains a seed from the fully seeded DRNG of the server with
+ * RpcGetLeaseSeed together with the bounds of the lease. The client
+ * instantiates a local DRNG with the seed and must request a new seed once
+ * one of the bounds is reached.
+ */
+#define ESDM_RPC_LEASE_SEED_MIN_LEN 32
+#define ESDM_RPC_LEASE_SEED_MAX_LEN 64
+
 static inline key_t esdm_ftok(const char *pathname, int proj_id)
 {
 	return ftok(pathname, proj_id);
@@ -101,6 +396,13 @@ static inline key_t esdm_ftok(const char *pathname, int proj_id)
 void esdm_rpc_status(UnprivAccess_Service *service,
 		     const StatusRequest *request,
 		     StatusResponse_Closure closure, void *closure_data);
+void esdm_rpc_status_bin(UnprivAccess_Service *service,
+			 const StatusBinRequest *request,
+			 StatusBinResponse_Closure closure, void *closure_data);
+void esdm_rpc_wait_seed_state(UnprivAccess_Service *service,
+			      const WaitSeedStateRequest *request,
+			      WaitSeedStateResponse_Closure closure,
+			      void *closure_data);
 
 void esdm_rpc_is_fully_seeded(UnprivAccess_Service *service,
 			      const IsFullySeededRequest *request,
@@ -127,6 +429,11 @@ void esdm_rpc_get_random_bytes_full_timeout(
 	const GetRandomBytesFullTimeoutRequest *request,
 	GetRandomBytesFullTimeoutResponse_Closure closure, void *closure_data);
 
+void esdm_rpc_get_lease_seed(UnprivAccess_Service *service,
+			     const GetLeaseSeedRequest *request,
+			     GetLeaseSeedResponse_Closure closure,
+			     void *closure_data);
+
 void esdm_rpc_get_random_bytes_min(UnprivAccess_Service *service,
 				   const GetRandomBytesMinRequest *request,
 				   GetRandomBytesMinResponse_Closure closure,
@@ -142,6 +449,20 @@ void esdm_rpc_get_random_bytes(UnprivAccess_Service *service,
 			       GetRandomBytesResponse_Closure closure,
 			       void *closure_data);
 
+void esdm_rpc_get_random_bytes_vec(UnprivAccess_Service *service,
+				   const GetRandomBytesVecRequest *request,
+				   GetRandomBytesVecResponse_Closure closure,
+				   void *closure_data);
+
+void esdm_rpc_get_random_stream(UnprivAccess_Service *service,
+				const GetRandomStreamRequest *request,
+				GetRandomStreamResponse_Closure closure,
+				void *closure_data);
+
+void esdm_rpc_negotiate(UnprivAccess_Service *service,
+			const NegotiateRequest *request,
+			NegotiateResponse_Closure closure, void *closure_data);
+
 void esdm_rpc_get_seed(UnprivAccess_Service *service,
 		       const GetSeedRequest *request,
 		       GetSeedResponse_Closure closure, void *closure_data);
@@ -188,10 +509,25 @@ void esdm_rpc_get_min_reseed_secs(UnprivAccess_Service *service,
 				  const GetMinReseedSecsRequest *request,
 				  GetMinReseedSecsResponse_Closure closure,
 				  void *closure_data);
+void esdm_rpc_get_random_ring(UnprivAccess_Service *service,
+			      const GetRandomRingRequest *request,
+			      GetRandomRingResponse_Closure closure,
+			      void *closure_data);
 void esdm_rpc_set_min_reseed_secs(PrivAccess_Service *service,
 				  const SetMinReseedSecsRequest *request,
 				  SetMinReseedSecsResponse_Closure closure,
 				  void *closure_data);
+void esdm_rpc_latency_stats(PrivAccess_Service *service,
+			    const LatencyStatsRequest *request,
+			    LatencyStatsResponse_Closure closure,
+			    void *closure_data);
+void esdm_rpc_set_config(PrivAccess_Service *service,
+			 const SetConfigRequest *request,
+			 SetConfigResponse_Closure closure, void *closure_data);
+void esdm_rpc_get_entropy_ring(PrivAccess_Service *service,
+			       const GetEntropyRingRequest *request,
+			       GetEntropyRingResponse_Closure closure,
+			       void *closure_data);
 
 /******************************************************************************
  * Definition of Protobuf-C service
@@ -214,6 +550,37 @@ extern PrivAccess_Service priv_access_service;
 #define ESDM_RPC_MAX_DATA                                                      \
 	(ESDM_RPC_MAX_MSG_SIZE - sizeof(struct esdm_rpc_proto_sc_header))
 
+/*
+ * Protocol version and the maximum message size a client may negotiate with
+ * RpcNegotiate. Responses larger than ESDM_RPC_MAX_MSG_SIZE are sent as
+ * multiple frames of at most ESDM_RPC_MAX_MSG_SIZE bytes each which implies
+ * that neither side needs a receive buffer of the negotiated size to read one
+ * frame. Requests are always limited to ESDM_RPC_MAX_MSG_SIZE.
+ *
+ * Version 2 adds the compact wire format for the hot methods of the
+ * unprivileged interface, see struct esdm_rpc_fast_cs.
+ *
+ * Version 3 adds the CPU hint of the client: NegotiateRequest.cpu applies to
+ * all requests of the connection, a compact request may carry the current CPU
+ * with ESDM_RPC_FAST_FLAG_CPU. The server prefers the DRNG instance of that
+ * CPU over the one of the CPU the request handler runs on.
+ */
+#define ESDM_RPC_PROTO_VERSION 3
+#define ESDM_RPC_PROTO_VERSION_FAST_WIRE 2
+#define ESDM_RPC_PROTO_VERSION_CPU_HINT 3
+#define ESDM_RPC_MAX_NEGOTIATED_MSG_SIZE (1 << 20)
+#define ESDM_RPC_MAX_NEGOTIATED_DATA                                           \
+	(ESDM_RPC_MAX_NEGOTIATED_MSG_SIZE -                                    \
+	 sizeof(struct esdm_rpc_proto_sc_header))
+
+/*
+ * Maximum number of entries of one RpcGetRandomBytesVec request and the
+ * maximum amount of random data of all entries - every entry of the response
+ * requires additional meta data.
+ */
+#define ESDM_RPC_VEC_MAX 64
+#define ESDM_RPC_VEC_MAX_DATA (ESDM_RPC_MAX_DATA - ESDM_RPC_VEC_MAX * 8)
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef ESDM_SHM_EVENT_H
+#define ESDM_SHM_EVENT_H
+
+#include <errno.h>
+#include <time.h>
+
+#include "atomic.h"
+#include "config.h"
+
+#ifdef ESDM_LINUX
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Event words of the shared memory status segment
+ *
+ * The server increments an event word when the event occurs and wakes all
+ * processes sleeping on it. A consumer takes a snapshot of the event word
+ * before it evaluates the state the event refers to and then sleeps until the
+ * word differs from the snapshot. An event occurring in between is therefore
+ * never lost, and a consumer is only woken by the event it waits for.
+ *
+ * The futex is shared between processes, i.e. the private futex operations
+ * must not be used.
+ */
+
+#ifdef ESDM_LINUX
+
+/* Not declared by unistd.h with a strict _POSIX_C_SOURCE */
+extern long syscall(long number, ...);
+
+/**
+ * @brief Wait for an event
+ *
+ * @param [in] event Event word in the status segment
+ * @param [in] seen Snapshot of the event word
+ * @param [in] abstime Absolute CLOCK_MONOTONIC timeout, NULL to wait forever
+ *
+ * @return 0 when woken or the event word changed, -ETIMEDOUT if the timeout
+ *	   expired, -EINTR if interrupted by a signal, -EOPNOTSUPP if the
+ *	   caller must use the semaphores
+ */
+static inline int esdm_shm_event_wait(const atomic_t *event, int seen,
+				      const struct timespec *abstime)
+{
+	long ret;
+
+	ret = syscall(SYS_futex, (const int *)&event->counter, FUTEX_WAIT_BITSET,
+		      seen, abstime, NULL, FUTEX_BITSET_MATCH_ANY);
+	if (ret < 0) {
+		if (errno == ETIMEDOUT || errno == EINTR)
+			return -errno;
+		/* EAGAIN: the event word already changed */
+		if (errno != EAGAIN)
+			return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+/* Wake all processes waiting for the event without signaling it. */
+static inline void esdm_shm_event_wake(atomic_t *event)
+{
+	syscall(SYS_futex, (int *)&event->counter, FUTEX_WAKE, INT_MAX, NULL,
+		NULL, 0);
+}
+
+#else /* ESDM_LINUX */
+
+static inline int esdm_shm_event_wait(const atomic_t *event, int seen,
+				      const struct timespec *abstime)
+{
+	(void)event;
+	(void)seen;
+	(void)abstime;
+	return -EOPNOTSUPP;
+}
+
+static inline void esdm_shm_event_wake(atomic_t *event)
+{
+	(void)event;
+}
+
+#endif /* ESDM_LINUX */
+
+/* Signal an event to all processes waiting for it. */
+static inline void esdm_shm_event_signal(atomic_t *event)
+{
+	atomic_inc(event);
+	esdm_shm_event_wake(event);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_SHM_EVENT_H */
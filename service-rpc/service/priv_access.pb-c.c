@@ -563,6 +563,261 @@ void set_min_reseed_secs_response__free_unpacked(
 	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
 					 allocator);
 }
+void latency_stats_request__init(LatencyStatsRequest *message)
+{
+	static const LatencyStatsRequest init_value =
+		LATENCY_STATS_REQUEST__INIT;
+	*message = init_value;
+}
+size_t
+latency_stats_request__get_packed_size(const LatencyStatsRequest *message)
+{
+	assert(message->base.descriptor == &latency_stats_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t latency_stats_request__pack(const LatencyStatsRequest *message,
+				   uint8_t *out)
+{
+	assert(message->base.descriptor == &latency_stats_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t latency_stats_request__pack_to_buffer(const LatencyStatsRequest *message,
+					     ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &latency_stats_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+LatencyStatsRequest *
+latency_stats_request__unpack(ProtobufCAllocator *allocator, size_t len,
+			      const uint8_t *data)
+{
+	return (LatencyStatsRequest *)protobuf_c_message_unpack(
+		&latency_stats_request__descriptor, allocator, len, data);
+}
+void latency_stats_request__free_unpacked(LatencyStatsRequest *message,
+					  ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &latency_stats_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void latency_stats_response__init(LatencyStatsResponse *message)
+{
+	static const LatencyStatsResponse init_value =
+		LATENCY_STATS_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t
+latency_stats_response__get_packed_size(const LatencyStatsResponse *message)
+{
+	assert(message->base.descriptor == &latency_stats_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t latency_stats_response__pack(const LatencyStatsResponse *message,
+				    uint8_t *out)
+{
+	assert(message->base.descriptor == &latency_stats_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+latency_stats_response__pack_to_buffer(const LatencyStatsResponse *message,
+				       ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &latency_stats_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+LatencyStatsResponse *
+latency_stats_response__unpack(ProtobufCAllocator *allocator, size_t len,
+			       const uint8_t *data)
+{
+	return (LatencyStatsResponse *)protobuf_c_message_unpack(
+		&latency_stats_response__descriptor, allocator, len, data);
+}
+void latency_stats_response__free_unpacked(LatencyStatsResponse *message,
+					   ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &latency_stats_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void set_config_request__init(SetConfigRequest *message)
+{
+	static const SetConfigRequest init_value = SET_CONFIG_REQUEST__INIT;
+	*message = init_value;
+}
+size_t set_config_request__get_packed_size(const SetConfigRequest *message)
+{
+	assert(message->base.descriptor == &set_config_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t set_config_request__pack(const SetConfigRequest *message, uint8_t *out)
+{
+	assert(message->base.descriptor == &set_config_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t set_config_request__pack_to_buffer(const SetConfigRequest *message,
+					  ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &set_config_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+SetConfigRequest *set_config_request__unpack(ProtobufCAllocator *allocator,
+					     size_t len, const uint8_t *data)
+{
+	return (SetConfigRequest *)protobuf_c_message_unpack(
+		&set_config_request__descriptor, allocator, len, data);
+}
+void set_config_request__free_unpacked(SetConfigRequest *message,
+				       ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &set_config_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void set_config_response__init(SetConfigResponse *message)
+{
+	static const SetConfigResponse init_value = SET_CONFIG_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t set_config_response__get_packed_size(const SetConfigResponse *message)
+{
+	assert(message->base.descriptor == &set_config_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t set_config_response__pack(const SetConfigResponse *message, uint8_t *out)
+{
+	assert(message->base.descriptor == &set_config_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t set_config_response__pack_to_buffer(const SetConfigResponse *message,
+					   ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &set_config_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+SetConfigResponse *set_config_response__unpack(ProtobufCAllocator *allocator,
+					       size_t len, const uint8_t *data)
+{
+	return (SetConfigResponse *)protobuf_c_message_unpack(
+		&set_config_response__descriptor, allocator, len, data);
+}
+void set_config_response__free_unpacked(SetConfigResponse *message,
+					ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &set_config_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_entropy_ring_request__init(GetEntropyRingRequest *message)
+{
+	static const GetEntropyRingRequest init_value =
+		GET_ENTROPY_RING_REQUEST__INIT;
+	*message = init_value;
+}
+size_t
+get_entropy_ring_request__get_packed_size(const GetEntropyRingRequest *message)
+{
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_entropy_ring_request__pack(const GetEntropyRingRequest *message,
+				     uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+get_entropy_ring_request__pack_to_buffer(const GetEntropyRingRequest *message,
+					ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetEntropyRingRequest *
+get_entropy_ring_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data)
+{
+	return (GetEntropyRingRequest *)protobuf_c_message_unpack(
+		&get_entropy_ring_request__descriptor, allocator, len, data);
+}
+void get_entropy_ring_request__free_unpacked(GetEntropyRingRequest *message,
+					    ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_entropy_ring_response__init(GetEntropyRingResponse *message)
+{
+	static const GetEntropyRingResponse init_value =
+		GET_ENTROPY_RING_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t get_entropy_ring_response__get_packed_size(
+	const GetEntropyRingResponse *message)
+{
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_entropy_ring_response__pack(const GetEntropyRingResponse *message,
+				      uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+get_entropy_ring_response__pack_to_buffer(const GetEntropyRingResponse *message,
+					 ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetEntropyRingResponse *
+get_entropy_ring_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				 const uint8_t *data)
+{
+	return (GetEntropyRingResponse *)protobuf_c_message_unpack(
+		&get_entropy_ring_response__descriptor, allocator, len, data);
+}
+void get_entropy_ring_response__free_unpacked(GetEntropyRingResponse *message,
+					     ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_entropy_ring_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
 static const ProtobufCFieldDescriptor
 	rnd_add_to_ent_cnt_request__field_descriptors[1] = {
 		{
@@ -944,7 +1199,239 @@ const ProtobufCMessageDescriptor set_min_reseed_secs_response__descriptor = {
 	NULL,
 	NULL /* reserved[123] */
 };
-static const ProtobufCMethodDescriptor priv_access__method_descriptors[6] = {
+static const ProtobufCFieldDescriptor
+	latency_stats_request__field_descriptors[1] = {
+		{
+			"maxlen", 1, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
+			offsetof(LatencyStatsRequest, maxlen), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned latency_stats_request__field_indices_by_name[] = {
+	0, /* field[0] = maxlen */
+};
+static const ProtobufCIntRange latency_stats_request__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 1 }
+};
+const ProtobufCMessageDescriptor latency_stats_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"LatencyStatsRequest",
+	"LatencyStatsRequest",
+	"LatencyStatsRequest",
+	"",
+	sizeof(LatencyStatsRequest),
+	1,
+	latency_stats_request__field_descriptors,
+	latency_stats_request__field_indices_by_name,
+	1,
+	latency_stats_request__number_ranges,
+	(ProtobufCMessageInit)latency_stats_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	latency_stats_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			0, /* quantifier_offset */
+			offsetof(LatencyStatsResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"buffer", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_STRING, 0, /* quantifier_offset */
+			offsetof(LatencyStatsResponse, buffer), NULL,
+			&protobuf_c_empty_string, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned latency_stats_response__field_indices_by_name[] = {
+	1, /* field[1] = buffer */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange latency_stats_response__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 2 }
+};
+const ProtobufCMessageDescriptor latency_stats_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"LatencyStatsResponse",
+	"LatencyStatsResponse",
+	"LatencyStatsResponse",
+	"",
+	sizeof(LatencyStatsResponse),
+	2,
+	latency_stats_response__field_descriptors,
+	latency_stats_response__field_indices_by_name,
+	1,
+	latency_stats_response__number_ranges,
+	(ProtobufCMessageInit)latency_stats_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	set_config_request__field_descriptors[2] = {
+		{
+			"name", 1, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_STRING, 0, /* quantifier_offset */
+			offsetof(SetConfigRequest, name), NULL,
+			&protobuf_c_empty_string, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"value", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
+			offsetof(SetConfigRequest, value), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned set_config_request__field_indices_by_name[] = {
+	0, /* field[0] = name */
+	1, /* field[1] = value */
+};
+static const ProtobufCIntRange set_config_request__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 2 }
+};
+const ProtobufCMessageDescriptor set_config_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"SetConfigRequest",
+	"SetConfigRequest",
+	"SetConfigRequest",
+	"",
+	sizeof(SetConfigRequest),
+	2,
+	set_config_request__field_descriptors,
+	set_config_request__field_indices_by_name,
+	1,
+	set_config_request__number_ranges,
+	(ProtobufCMessageInit)set_config_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	set_config_response__field_descriptors[1] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			0, /* quantifier_offset */
+			offsetof(SetConfigResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned set_config_response__field_indices_by_name[] = {
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange set_config_response__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 1 }
+};
+const ProtobufCMessageDescriptor set_config_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"SetConfigResponse",
+	"SetConfigResponse",
+	"SetConfigResponse",
+	"",
+	sizeof(SetConfigResponse),
+	1,
+	set_config_response__field_descriptors,
+	set_config_response__field_indices_by_name,
+	1,
+	set_config_response__number_ranges,
+	(ProtobufCMessageInit)set_config_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_entropy_ring_request__field_descriptors[1] = {
+		{
+			"size", 1, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(GetEntropyRingRequest, size), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_entropy_ring_request__field_indices_by_name[] = {
+	0, /* field[0] = size */
+};
+static const ProtobufCIntRange get_entropy_ring_request__number_ranges[1 +
+	1] = {
+		{ 1, 0 },
+		{ 0, 1 }
+	};
+const ProtobufCMessageDescriptor get_entropy_ring_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetEntropyRingRequest",
+	"GetEntropyRingRequest",
+	"GetEntropyRingRequest",
+	"",
+	sizeof(GetEntropyRingRequest),
+	1,
+	get_entropy_ring_request__field_descriptors,
+	get_entropy_ring_request__field_indices_by_name,
+	1,
+	get_entropy_ring_request__number_ranges,
+	(ProtobufCMessageInit)get_entropy_ring_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_entropy_ring_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			0, /* quantifier_offset */
+			offsetof(GetEntropyRingResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"size", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(GetEntropyRingResponse, size), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_entropy_ring_response__field_indices_by_name[] = {
+	0, /* field[0] = ret */
+	1, /* field[1] = size */
+};
+static const ProtobufCIntRange get_entropy_ring_response__number_ranges[1 +
+	1] = {
+		{ 1, 0 },
+		{ 0, 2 }
+	};
+const ProtobufCMessageDescriptor get_entropy_ring_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetEntropyRingResponse",
+	"GetEntropyRingResponse",
+	"GetEntropyRingResponse",
+	"",
+	sizeof(GetEntropyRingResponse),
+	2,
+	get_entropy_ring_response__field_descriptors,
+	get_entropy_ring_response__field_indices_by_name,
+	1,
+	get_entropy_ring_response__number_ranges,
+	(ProtobufCMessageInit)get_entropy_ring_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCMethodDescriptor priv_access__method_descriptors[9] = {
 	{ "RpcRndAddToEntCnt", &rnd_add_to_ent_cnt_request__descriptor,
 	  &rnd_add_to_ent_cnt_response__descriptor },
 	{ "RpcRndAddEntropy", &rnd_add_entropy_request__descriptor,
@@ -958,12 +1445,21 @@ static const ProtobufCMethodDescriptor priv_access__method_descriptors[6] = {
 	  &set_write_wakeup_thresh_response__descriptor },
 	{ "RpcSetMinReseedSecs", &set_min_reseed_secs_request__descriptor,
 	  &set_min_reseed_secs_response__descriptor },
+	{ "RpcLatencyStats", &latency_stats_request__descriptor,
+	  &latency_stats_response__descriptor },
+	{ "RpcSetConfig", &set_config_request__descriptor,
+	  &set_config_response__descriptor },
+	{ "RpcGetEntropyRing", &get_entropy_ring_request__descriptor,
+	  &get_entropy_ring_response__descriptor },
 };
 const unsigned priv_access__method_indices_by_name[] = {
+	8, /* RpcGetEntropyRing */
+	6, /* RpcLatencyStats */
 	1, /* RpcRndAddEntropy */
 	0, /* RpcRndAddToEntCnt */
 	2, /* RpcRndClearPool */
 	3, /* RpcRndReseedCRNG */
+	7, /* RpcSetConfig */
 	5, /* RpcSetMinReseedSecs */
 	4 /* RpcSetWriteWakeupThresh */
 };
@@ -973,7 +1469,7 @@ const ProtobufCServiceDescriptor priv_access__descriptor = {
 	"PrivAccess",
 	"PrivAccess",
 	"",
-	6,
+	9,
 	priv_access__method_descriptors,
 	priv_access__method_indices_by_name
 };
@@ -1029,6 +1525,33 @@ void priv_access__rpc_set_min_reseed_secs(
 	service->invoke(service, 5, (const ProtobufCMessage *)input,
 			(ProtobufCClosure)closure, closure_data);
 }
+void priv_access__rpc_latency_stats(ProtobufCService *service,
+				    const LatencyStatsRequest *input,
+				    LatencyStatsResponse_Closure closure,
+				    void *closure_data)
+{
+	assert(service->descriptor == &priv_access__descriptor);
+	service->invoke(service, 6, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void priv_access__rpc_set_config(ProtobufCService *service,
+				 const SetConfigRequest *input,
+				 SetConfigResponse_Closure closure,
+				 void *closure_data)
+{
+	assert(service->descriptor == &priv_access__descriptor);
+	service->invoke(service, 7, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void priv_access__rpc_get_entropy_ring(ProtobufCService *service,
+				       const GetEntropyRingRequest *input,
+				       GetEntropyRingResponse_Closure closure,
+				       void *closure_data)
+{
+	assert(service->descriptor == &priv_access__descriptor);
+	service->invoke(service, 8, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
 void priv_access__init(PrivAccess_Service *service,
 		       PrivAccess_ServiceDestroy destroy)
 {
@@ -26,6 +26,12 @@ typedef struct SetWriteWakeupThreshRequest SetWriteWakeupThreshRequest;
 typedef struct SetWriteWakeupThreshResponse SetWriteWakeupThreshResponse;
 typedef struct SetMinReseedSecsRequest SetMinReseedSecsRequest;
 typedef struct SetMinReseedSecsResponse SetMinReseedSecsResponse;
+typedef struct LatencyStatsRequest LatencyStatsRequest;
+typedef struct LatencyStatsResponse LatencyStatsResponse;
+typedef struct SetConfigRequest SetConfigRequest;
+typedef struct SetConfigResponse SetConfigResponse;
+typedef struct GetEntropyRingRequest GetEntropyRingRequest;
+typedef struct GetEntropyRingResponse GetEntropyRingResponse;
 
 /* --- enums --- */
 
@@ -181,6 +187,90 @@ struct SetMinReseedSecsResponse {
 	{ PROTOBUF_C_MESSAGE_INIT(&set_min_reseed_secs_response__descriptor),  \
 	  0 }
 
+/*
+ **
+ * @brief Request the latency statistics of the ESDM server
+ * @param maxlen Maximum size of the buffer the caller can accept
+ */
+struct LatencyStatsRequest {
+	ProtobufCMessage base;
+	uint32_t maxlen;
+};
+#define LATENCY_STATS_REQUEST__INIT                                            \
+	{ PROTOBUF_C_MESSAGE_INIT(&latency_stats_request__descriptor), 0 }
+
+/*
+ **
+ * @brief Response returning the latency statistics
+ * @param ret Return code (0 on success, < 0 on error)
+ * @param buffer Human-readable latency percentiles
+ */
+struct LatencyStatsResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+	char *buffer;
+};
+#define LATENCY_STATS_RESPONSE__INIT                                           \
+	{ PROTOBUF_C_MESSAGE_INIT(&latency_stats_response__descriptor), 0,     \
+	  (char *)protobuf_c_empty_string }
+
+/*
+ **
+ * @brief Request to change a configuration setting at runtime
+ * @param name Name of the setting
+ * @param value New value of the setting
+ */
+struct SetConfigRequest {
+	ProtobufCMessage base;
+	char *name;
+	uint32_t value;
+};
+#define SET_CONFIG_REQUEST__INIT                                               \
+	{ PROTOBUF_C_MESSAGE_INIT(&set_config_request__descriptor),            \
+	  (char *)protobuf_c_empty_string, 0 }
+
+/*
+ **
+ * @brief Response returning the result of the configuration change
+ * @param ret Return code (0 on success, < 0 on error)
+ */
+struct SetConfigResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+};
+#define SET_CONFIG_RESPONSE__INIT                                              \
+	{ PROTOBUF_C_MESSAGE_INIT(&set_config_response__descriptor), 0 }
+
+/*
+ **
+ * @brief Request a shared memory ring for the injection of entropy
+ * The server answers with two file descriptors passed as ancillary data:
+ * the memory file holding the ring and a control socket used to request the
+ * draining of the ring.
+ * @param size Requested ring size in bytes (0 selects the server default)
+ */
+struct GetEntropyRingRequest {
+	ProtobufCMessage base;
+	uint32_t size;
+};
+#define GET_ENTROPY_RING_REQUEST__INIT                                         \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_entropy_ring_request__descriptor), 0 }
+
+/*
+ **
+ * @brief Response to the entropy ring setup
+ * @param ret Return code (0 on success, < 0 on error)
+ * @param size Size of the ring data area in bytes
+ */
+struct GetEntropyRingResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+	uint32_t size;
+};
+#define GET_ENTROPY_RING_RESPONSE__INIT                                        \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_entropy_ring_response__descriptor), 0,  \
+	  0 }
+
 /* RndAddToEntCntRequest methods */
 void rnd_add_to_ent_cnt_request__init(RndAddToEntCntRequest *message);
 size_t rnd_add_to_ent_cnt_request__get_packed_size(
@@ -346,6 +436,82 @@ set_min_reseed_secs_response__unpack(ProtobufCAllocator *allocator, size_t len,
 				     const uint8_t *data);
 void set_min_reseed_secs_response__free_unpacked(
 	SetMinReseedSecsResponse *message, ProtobufCAllocator *allocator);
+/* LatencyStatsRequest methods */
+void latency_stats_request__init(LatencyStatsRequest *message);
+size_t
+latency_stats_request__get_packed_size(const LatencyStatsRequest *message);
+size_t latency_stats_request__pack(const LatencyStatsRequest *message,
+				   uint8_t *out);
+size_t latency_stats_request__pack_to_buffer(const LatencyStatsRequest *message,
+					     ProtobufCBuffer *buffer);
+LatencyStatsRequest *
+latency_stats_request__unpack(ProtobufCAllocator *allocator, size_t len,
+			      const uint8_t *data);
+void latency_stats_request__free_unpacked(LatencyStatsRequest *message,
+					  ProtobufCAllocator *allocator);
+/* LatencyStatsResponse methods */
+void latency_stats_response__init(LatencyStatsResponse *message);
+size_t
+latency_stats_response__get_packed_size(const LatencyStatsResponse *message);
+size_t latency_stats_response__pack(const LatencyStatsResponse *message,
+				    uint8_t *out);
+size_t
+latency_stats_response__pack_to_buffer(const LatencyStatsResponse *message,
+				       ProtobufCBuffer *buffer);
+LatencyStatsResponse *
+latency_stats_response__unpack(ProtobufCAllocator *allocator, size_t len,
+			       const uint8_t *data);
+void latency_stats_response__free_unpacked(LatencyStatsResponse *message,
+					   ProtobufCAllocator *allocator);
+/* SetConfigRequest methods */
+void set_config_request__init(SetConfigRequest *message);
+size_t set_config_request__get_packed_size(const SetConfigRequest *message);
+size_t set_config_request__pack(const SetConfigRequest *message, uint8_t *out);
+size_t set_config_request__pack_to_buffer(const SetConfigRequest *message,
+					  ProtobufCBuffer *buffer);
+SetConfigRequest *set_config_request__unpack(ProtobufCAllocator *allocator,
+					     size_t len, const uint8_t *data);
+void set_config_request__free_unpacked(SetConfigRequest *message,
+				       ProtobufCAllocator *allocator);
+/* SetConfigResponse methods */
+void set_config_response__init(SetConfigResponse *message);
+size_t set_config_response__get_packed_size(const SetConfigResponse *message);
+size_t set_config_response__pack(const SetConfigResponse *message,
+				 uint8_t *out);
+size_t set_config_response__pack_to_buffer(const SetConfigResponse *message,
+					   ProtobufCBuffer *buffer);
+SetConfigResponse *set_config_response__unpack(ProtobufCAllocator *allocator,
+					       size_t len, const uint8_t *data);
+void set_config_response__free_unpacked(SetConfigResponse *message,
+					ProtobufCAllocator *allocator);
+/* GetEntropyRingRequest methods */
+void get_entropy_ring_request__init(GetEntropyRingRequest *message);
+size_t
+get_entropy_ring_request__get_packed_size(const GetEntropyRingRequest *message);
+size_t get_entropy_ring_request__pack(const GetEntropyRingRequest *message,
+				     uint8_t *out);
+size_t
+get_entropy_ring_request__pack_to_buffer(const GetEntropyRingRequest *message,
+					ProtobufCBuffer *buffer);
+GetEntropyRingRequest *
+get_entropy_ring_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data);
+void get_entropy_ring_request__free_unpacked(GetEntropyRingRequest *message,
+					    ProtobufCAllocator *allocator);
+/* GetEntropyRingResponse methods */
+void get_entropy_ring_response__init(GetEntropyRingResponse *message);
+size_t get_entropy_ring_response__get_packed_size(
+	const GetEntropyRingResponse *message);
+size_t get_entropy_ring_response__pack(const GetEntropyRingResponse *message,
+				      uint8_t *out);
+size_t
+get_entropy_ring_response__pack_to_buffer(const GetEntropyRingResponse *message,
+					 ProtobufCBuffer *buffer);
+GetEntropyRingResponse *
+get_entropy_ring_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				 const uint8_t *data);
+void get_entropy_ring_response__free_unpacked(GetEntropyRingResponse *message,
+					     ProtobufCAllocator *allocator);
 /* --- per-message closures --- */
 
 typedef void (*RndAddToEntCntRequest_Closure)(
@@ -372,6 +538,18 @@ typedef void (*SetMinReseedSecsRequest_Closure)(
 	const SetMinReseedSecsRequest *message, void *closure_data);
 typedef void (*SetMinReseedSecsResponse_Closure)(
 	const SetMinReseedSecsResponse *message, void *closure_data);
+typedef void (*LatencyStatsRequest_Closure)(const LatencyStatsRequest *message,
+					    void *closure_data);
+typedef void (*LatencyStatsResponse_Closure)(
+	const LatencyStatsResponse *message, void *closure_data);
+typedef void (*SetConfigRequest_Closure)(const SetConfigRequest *message,
+					 void *closure_data);
+typedef void (*SetConfigResponse_Closure)(const SetConfigResponse *message,
+					  void *closure_data);
+typedef void (*GetEntropyRingRequest_Closure)(
+	const GetEntropyRingRequest *message, void *closure_data);
+typedef void (*GetEntropyRingResponse_Closure)(
+	const GetEntropyRingResponse *message, void *closure_data);
 
 /* --- services --- */
 
@@ -403,6 +581,18 @@ struct PrivAccess_Service {
 					const SetMinReseedSecsRequest *input,
 					SetMinReseedSecsResponse_Closure closure,
 					void *closure_data);
+	void (*rpc_latency_stats)(PrivAccess_Service *service,
+				  const LatencyStatsRequest *input,
+				  LatencyStatsResponse_Closure closure,
+				  void *closure_data);
+	void (*rpc_set_config)(PrivAccess_Service *service,
+			       const SetConfigRequest *input,
+			       SetConfigResponse_Closure closure,
+			       void *closure_data);
+	void (*rpc_get_entropy_ring)(PrivAccess_Service *service,
+				     const GetEntropyRingRequest *input,
+				     GetEntropyRingResponse_Closure closure,
+				     void *closure_data);
 };
 typedef void (*PrivAccess_ServiceDestroy)(PrivAccess_Service *);
 void priv_access__init(PrivAccess_Service *service,
@@ -416,7 +606,10 @@ void priv_access__init(PrivAccess_Service *service,
 	  function_prefix__##rpc_rnd_clear_pool,                               \
 	  function_prefix__##rpc_rnd_reseed_crng,                              \
 	  function_prefix__##rpc_set_write_wakeup_thresh,                      \
-	  function_prefix__##rpc_set_min_reseed_secs }
+	  function_prefix__##rpc_set_min_reseed_secs,                         \
+	  function_prefix__##rpc_latency_stats,                                \
+	  function_prefix__##rpc_set_config,                                   \
+	  function_prefix__##rpc_get_entropy_ring }
 void priv_access__rpc_rnd_add_to_ent_cnt(ProtobufCService *service,
 					 const RndAddToEntCntRequest *input,
 					 RndAddToEntCntResponse_Closure closure,
@@ -439,6 +632,18 @@ void priv_access__rpc_set_write_wakeup_thresh(
 void priv_access__rpc_set_min_reseed_secs(
 	ProtobufCService *service, const SetMinReseedSecsRequest *input,
 	SetMinReseedSecsResponse_Closure closure, void *closure_data);
+void priv_access__rpc_latency_stats(ProtobufCService *service,
+				    const LatencyStatsRequest *input,
+				    LatencyStatsResponse_Closure closure,
+				    void *closure_data);
+void priv_access__rpc_set_config(ProtobufCService *service,
+				 const SetConfigRequest *input,
+				 SetConfigResponse_Closure closure,
+				 void *closure_data);
+void priv_access__rpc_get_entropy_ring(ProtobufCService *service,
+				       const GetEntropyRingRequest *input,
+				       GetEntropyRingResponse_Closure closure,
+				       void *closure_data);
 
 /* --- descriptors --- */
 
@@ -456,6 +661,12 @@ extern const ProtobufCMessageDescriptor
 	set_write_wakeup_thresh_response__descriptor;
 extern const ProtobufCMessageDescriptor set_min_reseed_secs_request__descriptor;
 extern const ProtobufCMessageDescriptor set_min_reseed_secs_response__descriptor;
+extern const ProtobufCMessageDescriptor latency_stats_request__descriptor;
+extern const ProtobufCMessageDescriptor latency_stats_response__descriptor;
+extern const ProtobufCMessageDescriptor set_config_request__descriptor;
+extern const ProtobufCMessageDescriptor set_config_response__descriptor;
+extern const ProtobufCMessageDescriptor get_entropy_ring_request__descriptor;
+extern const ProtobufCMessageDescriptor get_entropy_ring_response__descriptor;
 extern const ProtobufCServiceDescriptor priv_access__descriptor;
 
 PROTOBUF_C__END_DECLS
@@ -1335,1047 +1335,2315 @@ void get_min_reseed_secs_response__free_unpacked(
 	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
 					 allocator);
 }
+void get_random_ring_request__init(GetRandomRingRequest *message)
+{
+	static const GetRandomRingRequest init_value =
+		GET_RANDOM_RING_REQUEST__INIT;
+	*message = init_value;
+}
+size_t
+get_random_ring_request__get_packed_size(const GetRandomRingRequest *message)
+{
+	assert(message->base.descriptor ==
+	       &get_random_ring_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_random_ring_request__pack(const GetRandomRingRequest *message,
+				     uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_random_ring_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+get_random_ring_request__pack_to_buffer(const GetRandomRingRequest *message,
+					ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_random_ring_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetRandomRingRequest *
+get_random_ring_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data)
+{
+	return (GetRandomRingRequest *)protobuf_c_message_unpack(
+		&get_random_ring_request__descriptor, allocator, len, data);
+}
+void get_random_ring_request__free_unpacked(GetRandomRingRequest *message,
+					    ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_random_ring_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_random_ring_response__init(GetRandomRingResponse *message)
+{
+	static const GetRandomRingResponse init_value =
+		GET_RANDOM_RING_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t
+get_random_ring_response__get_packed_size(const GetRandomRingResponse *message)
+{
+	assert(message->base.descriptor ==
+	       &get_random_ring_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_random_ring_response__pack(const GetRandomRingResponse *message,
+				      uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_random_ring_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+get_random_ring_response__pack_to_buffer(const GetRandomRingResponse *message,
+					 ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_random_ring_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetRandomRingResponse *
+get_random_ring_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				 const uint8_t *data)
+{
+	return (GetRandomRingResponse *)protobuf_c_message_unpack(
+		&get_random_ring_response__descriptor, allocator, len, data);
+}
+void get_random_ring_response__free_unpacked(GetRandomRingResponse *message,
+					     ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_random_ring_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_lease_seed_request__init(GetLeaseSeedRequest *message)
+{
+	static const GetLeaseSeedRequest init_value =
+		GET_LEASE_SEED_REQUEST__INIT;
+	*message = init_value;
+}
+size_t
+get_lease_seed_request__get_packed_size(const GetLeaseSeedRequest *message)
+{
+	assert(message->base.descriptor == &get_lease_seed_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_lease_seed_request__pack(const GetLeaseSeedRequest *message,
+				    uint8_t *out)
+{
+	assert(message->base.descriptor == &get_lease_seed_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+get_lease_seed_request__pack_to_buffer(const GetLeaseSeedRequest *message,
+				       ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &get_lease_seed_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetLeaseSeedRequest *
+get_lease_seed_request__unpack(ProtobufCAllocator *allocator, size_t len,
+			       const uint8_t *data)
+{
+	return (GetLeaseSeedRequest *)protobuf_c_message_unpack(
+		&get_lease_seed_request__descriptor, allocator, len, data);
+}
+void get_lease_seed_request__free_unpacked(GetLeaseSeedRequest *message,
+					   ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &get_lease_seed_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_lease_seed_response__init(GetLeaseSeedResponse *message)
+{
+	static const GetLeaseSeedResponse init_value =
+		GET_LEASE_SEED_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t
+get_lease_seed_response__get_packed_size(const GetLeaseSeedResponse *message)
+{
+	assert(message->base.descriptor ==
+	       &get_lease_seed_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_lease_seed_response__pack(const GetLeaseSeedResponse *message,
+				     uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_lease_seed_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+get_lease_seed_response__pack_to_buffer(const GetLeaseSeedResponse *message,
+					ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_lease_seed_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetLeaseSeedResponse *
+get_lease_seed_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data)
+{
+	return (GetLeaseSeedResponse *)protobuf_c_message_unpack(
+		&get_lease_seed_response__descriptor, allocator, len, data);
+}
+void get_lease_seed_response__free_unpacked(GetLeaseSeedResponse *message,
+					    ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_lease_seed_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_random_bytes_vec_request__init(GetRandomBytesVecRequest *message)
+{
+	static const GetRandomBytesVecRequest init_value =
+		GET_RANDOM_BYTES_VEC_REQUEST__INIT;
+	*message = init_value;
+}
+size_t get_random_bytes_vec_request__get_packed_size(
+	const GetRandomBytesVecRequest *message)
+{
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t
+get_random_bytes_vec_request__pack(const GetRandomBytesVecRequest *message,
+				   uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t get_random_bytes_vec_request__pack_to_buffer(
+	const GetRandomBytesVecRequest *message, ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetRandomBytesVecRequest *
+get_random_bytes_vec_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				     const uint8_t *data)
+{
+	return (GetRandomBytesVecRequest *)protobuf_c_message_unpack(
+		&get_random_bytes_vec_request__descriptor, allocator, len,
+		data);
+}
+void
+get_random_bytes_vec_request__free_unpacked(GetRandomBytesVecRequest *message,
+					    ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_random_bytes_vec_response__init(GetRandomBytesVecResponse *message)
+{
+	static const GetRandomBytesVecResponse init_value =
+		GET_RANDOM_BYTES_VEC_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t get_random_bytes_vec_response__get_packed_size(
+	const GetRandomBytesVecResponse *message)
+{
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t
+get_random_bytes_vec_response__pack(const GetRandomBytesVecResponse *message,
+				    uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t get_random_bytes_vec_response__pack_to_buffer(
+	const GetRandomBytesVecResponse *message, ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetRandomBytesVecResponse *
+get_random_bytes_vec_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				      const uint8_t *data)
+{
+	return (GetRandomBytesVecResponse *)protobuf_c_message_unpack(
+		&get_random_bytes_vec_response__descriptor, allocator, len,
+		data);
+}
+void
+get_random_bytes_vec_response__free_unpacked(GetRandomBytesVecResponse *message,
+					     ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_random_bytes_vec_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void negotiate_request__init(NegotiateRequest *message)
+{
+	static const NegotiateRequest init_value = NEGOTIATE_REQUEST__INIT;
+	*message = init_value;
+}
+size_t negotiate_request__get_packed_size(const NegotiateRequest *message)
+{
+	assert(message->base.descriptor == &negotiate_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t negotiate_request__pack(const NegotiateRequest *message, uint8_t *out)
+{
+	assert(message->base.descriptor == &negotiate_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t negotiate_request__pack_to_buffer(const NegotiateRequest *message,
+					 ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &negotiate_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+NegotiateRequest *negotiate_request__unpack(ProtobufCAllocator *allocator,
+					    size_t len, const uint8_t *data)
+{
+	return (NegotiateRequest *)protobuf_c_message_unpack(
+		&negotiate_request__descriptor, allocator, len, data);
+}
+void negotiate_request__free_unpacked(NegotiateRequest *message,
+				      ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &negotiate_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void negotiate_response__init(NegotiateResponse *message)
+{
+	static const NegotiateResponse init_value = NEGOTIATE_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t negotiate_response__get_packed_size(const NegotiateResponse *message)
+{
+	assert(message->base.descriptor == &negotiate_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t negotiate_response__pack(const NegotiateResponse *message, uint8_t *out)
+{
+	assert(message->base.descriptor == &negotiate_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t negotiate_response__pack_to_buffer(const NegotiateResponse *message,
+					  ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &negotiate_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+NegotiateResponse *negotiate_response__unpack(ProtobufCAllocator *allocator,
+					      size_t len, const uint8_t *data)
+{
+	return (NegotiateResponse *)protobuf_c_message_unpack(
+		&negotiate_response__descriptor, allocator, len, data);
+}
+void negotiate_response__free_unpacked(NegotiateResponse *message,
+				       ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &negotiate_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_random_stream_request__init(GetRandomStreamRequest *message)
+{
+	static const GetRandomStreamRequest init_value =
+		GET_RANDOM_STREAM_REQUEST__INIT;
+	*message = init_value;
+}
+size_t get_random_stream_request__get_packed_size(
+	const GetRandomStreamRequest *message)
+{
+	assert(message->base.descriptor ==
+	       &get_random_stream_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_random_stream_request__pack(const GetRandomStreamRequest *message,
+				       uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_random_stream_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+get_random_stream_request__pack_to_buffer(const GetRandomStreamRequest *message,
+					  ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_random_stream_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetRandomStreamRequest *
+get_random_stream_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				  const uint8_t *data)
+{
+	return (GetRandomStreamRequest *)protobuf_c_message_unpack(
+		&get_random_stream_request__descriptor, allocator, len, data);
+}
+void get_random_stream_request__free_unpacked(GetRandomStreamRequest *message,
+					      ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_random_stream_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void get_random_stream_response__init(GetRandomStreamResponse *message)
+{
+	static const GetRandomStreamResponse init_value =
+		GET_RANDOM_STREAM_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t get_random_stream_response__get_packed_size(
+	const GetRandomStreamResponse *message)
+{
+	assert(message->base.descriptor ==
+	       &get_random_stream_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t get_random_stream_response__pack(const GetRandomStreamResponse *message,
+					uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &get_random_stream_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t get_random_stream_response__pack_to_buffer(
+	const GetRandomStreamResponse *message, ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &get_random_stream_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+GetRandomStreamResponse *
+get_random_stream_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				   const uint8_t *data)
+{
+	return (GetRandomStreamResponse *)protobuf_c_message_unpack(
+		&get_random_stream_response__descriptor, allocator, len, data);
+}
+void get_random_stream_response__free_unpacked(GetRandomStreamResponse *message,
+					       ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &get_random_stream_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void status_bin_request__init(StatusBinRequest *message)
+{
+	static const StatusBinRequest init_value = STATUS_BIN_REQUEST__INIT;
+	*message = init_value;
+}
+size_t status_bin_request__get_packed_size(const StatusBinRequest *message)
+{
+	assert(message->base.descriptor == &status_bin_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t status_bin_request__pack(const StatusBinRequest *message, uint8_t *out)
+{
+	assert(message->base.descriptor == &status_bin_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t status_bin_request__pack_to_buffer(const StatusBinRequest *message,
+					  ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &status_bin_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+StatusBinRequest *status_bin_request__unpack(ProtobufCAllocator *allocator,
+					     size_t len, const uint8_t *data)
+{
+	return (StatusBinRequest *)protobuf_c_message_unpack(
+		&status_bin_request__descriptor, allocator, len, data);
+}
+void status_bin_request__free_unpacked(StatusBinRequest *message,
+				       ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &status_bin_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void status_bin_response__init(StatusBinResponse *message)
+{
+	static const StatusBinResponse init_value = STATUS_BIN_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t status_bin_response__get_packed_size(const StatusBinResponse *message)
+{
+	assert(message->base.descriptor == &status_bin_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t status_bin_response__pack(const StatusBinResponse *message, uint8_t *out)
+{
+	assert(message->base.descriptor == &status_bin_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t status_bin_response__pack_to_buffer(const StatusBinResponse *message,
+					   ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor == &status_bin_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+StatusBinResponse *status_bin_response__unpack(ProtobufCAllocator *allocator,
+					       size_t len, const uint8_t *data)
+{
+	return (StatusBinResponse *)protobuf_c_message_unpack(
+		&status_bin_response__descriptor, allocator, len, data);
+}
+void status_bin_response__free_unpacked(StatusBinResponse *message,
+					ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor == &status_bin_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void wait_seed_state_request__init(WaitSeedStateRequest *message)
+{
+	static const WaitSeedStateRequest init_value =
+		WAIT_SEED_STATE_REQUEST__INIT;
+	*message = init_value;
+}
+size_t
+wait_seed_state_request__get_packed_size(const WaitSeedStateRequest *message)
+{
+	assert(message->base.descriptor ==
+	       &wait_seed_state_request__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t wait_seed_state_request__pack(const WaitSeedStateRequest *message,
+				     uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &wait_seed_state_request__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+wait_seed_state_request__pack_to_buffer(const WaitSeedStateRequest *message,
+					ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &wait_seed_state_request__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+WaitSeedStateRequest *
+wait_seed_state_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data)
+{
+	return (WaitSeedStateRequest *)protobuf_c_message_unpack(
+		&wait_seed_state_request__descriptor, allocator, len, data);
+}
+void wait_seed_state_request__free_unpacked(WaitSeedStateRequest *message,
+					    ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &wait_seed_state_request__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
+void wait_seed_state_response__init(WaitSeedStateResponse *message)
+{
+	static const WaitSeedStateResponse init_value =
+		WAIT_SEED_STATE_RESPONSE__INIT;
+	*message = init_value;
+}
+size_t
+wait_seed_state_response__get_packed_size(const WaitSeedStateResponse *message)
+{
+	assert(message->base.descriptor ==
+	       &wait_seed_state_response__descriptor);
+	return protobuf_c_message_get_packed_size(
+		(const ProtobufCMessage *)(message));
+}
+size_t wait_seed_state_response__pack(const WaitSeedStateResponse *message,
+				      uint8_t *out)
+{
+	assert(message->base.descriptor ==
+	       &wait_seed_state_response__descriptor);
+	return protobuf_c_message_pack((const ProtobufCMessage *)message, out);
+}
+size_t
+wait_seed_state_response__pack_to_buffer(const WaitSeedStateResponse *message,
+					 ProtobufCBuffer *buffer)
+{
+	assert(message->base.descriptor ==
+	       &wait_seed_state_response__descriptor);
+	return protobuf_c_message_pack_to_buffer(
+		(const ProtobufCMessage *)message, buffer);
+}
+WaitSeedStateResponse *
+wait_seed_state_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				 const uint8_t *data)
+{
+	return (WaitSeedStateResponse *)protobuf_c_message_unpack(
+		&wait_seed_state_response__descriptor, allocator, len, data);
+}
+void wait_seed_state_response__free_unpacked(WaitSeedStateResponse *message,
+					     ProtobufCAllocator *allocator)
+{
+	if (!message)
+		return;
+	assert(message->base.descriptor ==
+	       &wait_seed_state_response__descriptor);
+	protobuf_c_message_free_unpacked((ProtobufCMessage *)message,
+					 allocator);
+}
 static const ProtobufCFieldDescriptor status_request__field_descriptors[1] = {
 	{
-		"maxlen", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
+		"maxlen", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
+		0, /* quantifier_offset */
+		offsetof(StatusRequest, maxlen), NULL, NULL, 0, /* flags */
+		0, NULL, NULL /* reserved1,reserved2, etc */
+	},
+};
+static const unsigned status_request__field_indices_by_name[] = {
+	0, /* field[0] = maxlen */
+};
+static const ProtobufCIntRange status_request__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 1 }
+};
+const ProtobufCMessageDescriptor status_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"StatusRequest",
+	"StatusRequest",
+	"StatusRequest",
+	"",
+	sizeof(StatusRequest),
+	1,
+	status_request__field_descriptors,
+	status_request__field_indices_by_name,
+	1,
+	status_request__number_ranges,
+	(ProtobufCMessageInit)status_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor status_response__field_descriptors[2] = {
+	{
+		"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+		0, /* quantifier_offset */
+		offsetof(StatusResponse, ret), NULL, NULL, 0, /* flags */
+		0, NULL, NULL /* reserved1,reserved2, etc */
+	},
+	{
+		"buffer", 2, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_STRING,
+		0, /* quantifier_offset */
+		offsetof(StatusResponse, buffer), NULL,
+		&protobuf_c_empty_string, 0, /* flags */
+		0, NULL, NULL /* reserved1,reserved2, etc */
+	},
+};
+static const unsigned status_response__field_indices_by_name[] = {
+	1, /* field[1] = buffer */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange status_response__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 2 }
+};
+const ProtobufCMessageDescriptor status_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"StatusResponse",
+	"StatusResponse",
+	"StatusResponse",
+	"",
+	sizeof(StatusResponse),
+	2,
+	status_response__field_descriptors,
+	status_response__field_indices_by_name,
+	1,
+	status_response__number_ranges,
+	(ProtobufCMessageInit)status_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+#define get_ent_lvl_request__field_descriptors NULL
+#define get_ent_lvl_request__field_indices_by_name NULL
+#define get_ent_lvl_request__number_ranges NULL
+const ProtobufCMessageDescriptor get_ent_lvl_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetEntLvlRequest",
+	"GetEntLvlRequest",
+	"GetEntLvlRequest",
+	"",
+	sizeof(GetEntLvlRequest),
+	0,
+	get_ent_lvl_request__field_descriptors,
+	get_ent_lvl_request__field_indices_by_name,
+	0,
+	get_ent_lvl_request__number_ranges,
+	(ProtobufCMessageInit)get_ent_lvl_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_ent_lvl_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			0, /* quantifier_offset */
+			offsetof(GetEntLvlResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"entlvl", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
+			offsetof(GetEntLvlResponse, entlvl), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_ent_lvl_response__field_indices_by_name[] = {
+	1, /* field[1] = entlvl */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange get_ent_lvl_response__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 2 }
+};
+const ProtobufCMessageDescriptor get_ent_lvl_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetEntLvlResponse",
+	"GetEntLvlResponse",
+	"GetEntLvlResponse",
+	"",
+	sizeof(GetEntLvlResponse),
+	2,
+	get_ent_lvl_response__field_descriptors,
+	get_ent_lvl_response__field_indices_by_name,
+	1,
+	get_ent_lvl_response__number_ranges,
+	(ProtobufCMessageInit)get_ent_lvl_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+#define is_min_seeded_request__field_descriptors NULL
+#define is_min_seeded_request__field_indices_by_name NULL
+#define is_min_seeded_request__number_ranges NULL
+const ProtobufCMessageDescriptor is_min_seeded_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"IsMinSeededRequest",
+	"IsMinSeededRequest",
+	"IsMinSeededRequest",
+	"",
+	sizeof(IsMinSeededRequest),
+	0,
+	is_min_seeded_request__field_descriptors,
+	is_min_seeded_request__field_indices_by_name,
+	0,
+	is_min_seeded_request__number_ranges,
+	(ProtobufCMessageInit)is_min_seeded_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	is_min_seeded_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			0, /* quantifier_offset */
+			offsetof(IsMinSeededResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"min_seeded", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BOOL, 0, /* quantifier_offset */
+			offsetof(IsMinSeededResponse, min_seeded), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned is_min_seeded_response__field_indices_by_name[] = {
+	1, /* field[1] = min_seeded */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange is_min_seeded_response__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 2 }
+};
+const ProtobufCMessageDescriptor is_min_seeded_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"IsMinSeededResponse",
+	"IsMinSeededResponse",
+	"IsMinSeededResponse",
+	"",
+	sizeof(IsMinSeededResponse),
+	2,
+	is_min_seeded_response__field_descriptors,
+	is_min_seeded_response__field_indices_by_name,
+	1,
+	is_min_seeded_response__number_ranges,
+	(ProtobufCMessageInit)is_min_seeded_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+#define is_fully_seeded_request__field_descriptors NULL
+#define is_fully_seeded_request__field_indices_by_name NULL
+#define is_fully_seeded_request__number_ranges NULL
+const ProtobufCMessageDescriptor is_fully_seeded_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"IsFullySeededRequest",
+	"IsFullySeededRequest",
+	"IsFullySeededRequest",
+	"",
+	sizeof(IsFullySeededRequest),
+	0,
+	is_fully_seeded_request__field_descriptors,
+	is_fully_seeded_request__field_indices_by_name,
+	0,
+	is_fully_seeded_request__number_ranges,
+	(ProtobufCMessageInit)is_fully_seeded_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	is_fully_seeded_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			0, /* quantifier_offset */
+			offsetof(IsFullySeededResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"fully_seeded", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BOOL, 0, /* quantifier_offset */
+			offsetof(IsFullySeededResponse, fully_seeded), NULL,
+			NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned is_fully_seeded_response__field_indices_by_name[] = {
+	1, /* field[1] = fully_seeded */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange
+	is_fully_seeded_response__number_ranges[1 + 1] = { { 1, 0 }, { 0, 2 } };
+const ProtobufCMessageDescriptor is_fully_seeded_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"IsFullySeededResponse",
+	"IsFullySeededResponse",
+	"IsFullySeededResponse",
+	"",
+	sizeof(IsFullySeededResponse),
+	2,
+	is_fully_seeded_response__field_descriptors,
+	is_fully_seeded_response__field_indices_by_name,
+	1,
+	is_fully_seeded_response__number_ranges,
+	(ProtobufCMessageInit)is_fully_seeded_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_full_request__field_descriptors[1] = {
+		{
+			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullRequest, len), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_bytes_full_request__field_indices_by_name[] = {
+	0, /* field[0] = len */
+};
+static const ProtobufCIntRange
+	get_random_bytes_full_request__number_ranges[1 + 1] = { { 1, 0 },
+								{ 0, 1 } };
+const ProtobufCMessageDescriptor get_random_bytes_full_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetRandomBytesFullRequest",
+	"GetRandomBytesFullRequest",
+	"GetRandomBytesFullRequest",
+	"",
+	sizeof(GetRandomBytesFullRequest),
+	1,
+	get_random_bytes_full_request__field_descriptors,
+	get_random_bytes_full_request__field_indices_by_name,
+	1,
+	get_random_bytes_full_request__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_full_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_full_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"randval", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullResponse, randval), NULL,
+			NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_bytes_full_response__field_indices_by_name[] = {
+	1, /* field[1] = randval */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange
+	get_random_bytes_full_response__number_ranges[1 + 1] = { { 1, 0 },
+								 { 0, 2 } };
+const ProtobufCMessageDescriptor get_random_bytes_full_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetRandomBytesFullResponse",
+	"GetRandomBytesFullResponse",
+	"GetRandomBytesFullResponse",
+	"",
+	sizeof(GetRandomBytesFullResponse),
+	2,
+	get_random_bytes_full_response__field_descriptors,
+	get_random_bytes_full_response__field_indices_by_name,
+	1,
+	get_random_bytes_full_response__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_full_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_full_timeout_request__field_descriptors[3] = {
+		{
+			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullTimeoutRequest, len), NULL,
+			NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"tv_sec", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT64, 0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullTimeoutRequest, tv_sec),
+			NULL, NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"tv_nsec", 3, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullTimeoutRequest, tv_nsec),
+			NULL, NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned
+	get_random_bytes_full_timeout_request__field_indices_by_name[] = {
+		0, /* field[0] = len */
+		2, /* field[2] = tv_nsec */
+		1, /* field[1] = tv_sec */
+	};
+static const ProtobufCIntRange
+	get_random_bytes_full_timeout_request__number_ranges[1 + 1] = {
+		{ 1, 0 },
+		{ 0, 3 }
+	};
+const ProtobufCMessageDescriptor
+	get_random_bytes_full_timeout_request__descriptor = {
+		PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+		"GetRandomBytesFullTimeoutRequest",
+		"GetRandomBytesFullTimeoutRequest",
+		"GetRandomBytesFullTimeoutRequest",
+		"",
+		sizeof(GetRandomBytesFullTimeoutRequest),
+		3,
+		get_random_bytes_full_timeout_request__field_descriptors,
+		get_random_bytes_full_timeout_request__field_indices_by_name,
+		1,
+		get_random_bytes_full_timeout_request__number_ranges,
+		(ProtobufCMessageInit)
+			get_random_bytes_full_timeout_request__init,
+		NULL,
+		NULL,
+		NULL /* reserved[123] */
+	};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_full_timeout_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullTimeoutResponse, ret), NULL,
+			NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"randval", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
+			offsetof(GetRandomBytesFullTimeoutResponse, randval),
+			NULL, NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned
+	get_random_bytes_full_timeout_response__field_indices_by_name[] = {
+		1, /* field[1] = randval */
+		0, /* field[0] = ret */
+	};
+static const ProtobufCIntRange
+	get_random_bytes_full_timeout_response__number_ranges[1 + 1] = {
+		{ 1, 0 },
+		{ 0, 2 }
+	};
+const ProtobufCMessageDescriptor
+	get_random_bytes_full_timeout_response__descriptor = {
+		PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+		"GetRandomBytesFullTimeoutResponse",
+		"GetRandomBytesFullTimeoutResponse",
+		"GetRandomBytesFullTimeoutResponse",
+		"",
+		sizeof(GetRandomBytesFullTimeoutResponse),
+		2,
+		get_random_bytes_full_timeout_response__field_descriptors,
+		get_random_bytes_full_timeout_response__field_indices_by_name,
+		1,
+		get_random_bytes_full_timeout_response__number_ranges,
+		(ProtobufCMessageInit)
+			get_random_bytes_full_timeout_response__init,
+		NULL,
+		NULL,
+		NULL /* reserved[123] */
+	};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_min_request__field_descriptors[1] = {
+		{
+			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesMinRequest, len), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_bytes_min_request__field_indices_by_name[] = {
+	0, /* field[0] = len */
+};
+static const ProtobufCIntRange
+	get_random_bytes_min_request__number_ranges[1 + 1] = { { 1, 0 },
+							       { 0, 1 } };
+const ProtobufCMessageDescriptor get_random_bytes_min_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetRandomBytesMinRequest",
+	"GetRandomBytesMinRequest",
+	"GetRandomBytesMinRequest",
+	"",
+	sizeof(GetRandomBytesMinRequest),
+	1,
+	get_random_bytes_min_request__field_descriptors,
+	get_random_bytes_min_request__field_indices_by_name,
+	1,
+	get_random_bytes_min_request__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_min_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_min_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesMinResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"randval", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
+			offsetof(GetRandomBytesMinResponse, randval), NULL,
+			NULL, 0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_bytes_min_response__field_indices_by_name[] = {
+	1, /* field[1] = randval */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange
+	get_random_bytes_min_response__number_ranges[1 + 1] = { { 1, 0 },
+								{ 0, 2 } };
+const ProtobufCMessageDescriptor get_random_bytes_min_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetRandomBytesMinResponse",
+	"GetRandomBytesMinResponse",
+	"GetRandomBytesMinResponse",
+	"",
+	sizeof(GetRandomBytesMinResponse),
+	2,
+	get_random_bytes_min_response__field_descriptors,
+	get_random_bytes_min_response__field_indices_by_name,
+	1,
+	get_random_bytes_min_response__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_min_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_pr_request__field_descriptors[1] = {
+		{
+			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesPrRequest, len), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_bytes_pr_request__field_indices_by_name[] = {
+	0, /* field[0] = len */
+};
+static const ProtobufCIntRange
+	get_random_bytes_pr_request__number_ranges[1 + 1] = { { 1, 0 },
+							      { 0, 1 } };
+const ProtobufCMessageDescriptor get_random_bytes_pr_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetRandomBytesPrRequest",
+	"GetRandomBytesPrRequest",
+	"GetRandomBytesPrRequest",
+	"",
+	sizeof(GetRandomBytesPrRequest),
+	1,
+	get_random_bytes_pr_request__field_descriptors,
+	get_random_bytes_pr_request__field_indices_by_name,
+	1,
+	get_random_bytes_pr_request__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_pr_request__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor
+	get_random_bytes_pr_response__field_descriptors[2] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesPrResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"randval", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
+			offsetof(GetRandomBytesPrResponse, randval), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_bytes_pr_response__field_indices_by_name[] = {
+	1, /* field[1] = randval */
+	0, /* field[0] = ret */
+};
+static const ProtobufCIntRange
+	get_random_bytes_pr_response__number_ranges[1 + 1] = { { 1, 0 },
+							       { 0, 2 } };
+const ProtobufCMessageDescriptor get_random_bytes_pr_response__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetRandomBytesPrResponse",
+	"GetRandomBytesPrResponse",
+	"GetRandomBytesPrResponse",
+	"",
+	sizeof(GetRandomBytesPrResponse),
+	2,
+	get_random_bytes_pr_response__field_descriptors,
+	get_random_bytes_pr_response__field_indices_by_name,
+	1,
+	get_random_bytes_pr_response__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_pr_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor get_seed_request__field_descriptors[3] = {
+	{
+		"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
 		0, /* quantifier_offset */
-		offsetof(StatusRequest, maxlen), NULL, NULL, 0, /* flags */
+		offsetof(GetSeedRequest, len), NULL, NULL, 0, /* flags */
+		0, NULL, NULL /* reserved1,reserved2, etc */
+	},
+	{
+		"flags", 2, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
+		0, /* quantifier_offset */
+		offsetof(GetSeedRequest, flags), NULL, NULL, 0, /* flags */
+		0, NULL, NULL /* reserved1,reserved2, etc */
+	},
+	{
+		"num", 3, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
+		0, /* quantifier_offset */
+		offsetof(GetSeedRequest, num), NULL, NULL, 0, /* flags */
 		0, NULL, NULL /* reserved1,reserved2, etc */
 	},
 };
-static const unsigned status_request__field_indices_by_name[] = {
-	0, /* field[0] = maxlen */
+static const unsigned get_seed_request__field_indices_by_name[] = {
+	1, /* field[1] = flags */
+	0, /* field[0] = len */
+	2, /* field[2] = num */
 };
-static const ProtobufCIntRange status_request__number_ranges[1 + 1] = {
+static const ProtobufCIntRange get_seed_request__number_ranges[1 + 1] = {
 	{ 1, 0 },
-	{ 0, 1 }
+	{ 0, 3 }
 };
-const ProtobufCMessageDescriptor status_request__descriptor = {
+const ProtobufCMessageDescriptor get_seed_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"StatusRequest",
-	"StatusRequest",
-	"StatusRequest",
+	"GetSeedRequest",
+	"GetSeedRequest",
+	"GetSeedRequest",
 	"",
-	sizeof(StatusRequest),
-	1,
-	status_request__field_descriptors,
-	status_request__field_indices_by_name,
+	sizeof(GetSeedRequest),
+	3,
+	get_seed_request__field_descriptors,
+	get_seed_request__field_indices_by_name,
 	1,
-	status_request__number_ranges,
-	(ProtobufCMessageInit)status_request__init,
+	get_seed_request__number_ranges,
+	(ProtobufCMessageInit)get_seed_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor status_response__field_descriptors[2] = {
+static const ProtobufCFieldDescriptor get_seed_response__field_descriptors[3] = {
 	{
-		"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+		"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
 		0, /* quantifier_offset */
-		offsetof(StatusResponse, ret), NULL, NULL, 0, /* flags */
+		offsetof(GetSeedResponse, ret), NULL, NULL, 0, /* flags */
 		0, NULL, NULL /* reserved1,reserved2, etc */
 	},
 	{
-		"buffer", 2, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_STRING,
+		"randval", 2, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_BYTES,
 		0, /* quantifier_offset */
-		offsetof(StatusResponse, buffer), NULL,
-		&protobuf_c_empty_string, 0, /* flags */
+		offsetof(GetSeedResponse, randval), NULL, NULL, 0, /* flags */
+		0, NULL, NULL /* reserved1,reserved2, etc */
+	},
+	{
+		"num", 3, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
+		0, /* quantifier_offset */
+		offsetof(GetSeedResponse, num), NULL, NULL, 0, /* flags */
 		0, NULL, NULL /* reserved1,reserved2, etc */
 	},
 };
-static const unsigned status_response__field_indices_by_name[] = {
-	1, /* field[1] = buffer */
+static const unsigned get_seed_response__field_indices_by_name[] = {
+	2, /* field[2] = num */
+	1, /* field[1] = randval */
 	0, /* field[0] = ret */
 };
-static const ProtobufCIntRange status_response__number_ranges[1 + 1] = {
+static const ProtobufCIntRange get_seed_response__number_ranges[1 + 1] = {
 	{ 1, 0 },
-	{ 0, 2 }
+	{ 0, 3 }
 };
-const ProtobufCMessageDescriptor status_response__descriptor = {
+const ProtobufCMessageDescriptor get_seed_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"StatusResponse",
-	"StatusResponse",
-	"StatusResponse",
+	"GetSeedResponse",
+	"GetSeedResponse",
+	"GetSeedResponse",
 	"",
-	sizeof(StatusResponse),
-	2,
-	status_response__field_descriptors,
-	status_response__field_indices_by_name,
+	sizeof(GetSeedResponse),
+	3,
+	get_seed_response__field_descriptors,
+	get_seed_response__field_indices_by_name,
 	1,
-	status_response__number_ranges,
-	(ProtobufCMessageInit)status_response__init,
+	get_seed_response__number_ranges,
+	(ProtobufCMessageInit)get_seed_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-#define get_ent_lvl_request__field_descriptors NULL
-#define get_ent_lvl_request__field_indices_by_name NULL
-#define get_ent_lvl_request__number_ranges NULL
-const ProtobufCMessageDescriptor get_ent_lvl_request__descriptor = {
+static const ProtobufCFieldDescriptor
+	get_random_bytes_request__field_descriptors[1] = {
+		{
+			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomBytesRequest, len), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_bytes_request__field_indices_by_name[] = {
+	0, /* field[0] = len */
+};
+static const ProtobufCIntRange
+	get_random_bytes_request__number_ranges[1 + 1] = { { 1, 0 }, { 0, 1 } };
+const ProtobufCMessageDescriptor get_random_bytes_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetEntLvlRequest",
-	"GetEntLvlRequest",
-	"GetEntLvlRequest",
+	"GetRandomBytesRequest",
+	"GetRandomBytesRequest",
+	"GetRandomBytesRequest",
 	"",
-	sizeof(GetEntLvlRequest),
-	0,
-	get_ent_lvl_request__field_descriptors,
-	get_ent_lvl_request__field_indices_by_name,
-	0,
-	get_ent_lvl_request__number_ranges,
-	(ProtobufCMessageInit)get_ent_lvl_request__init,
+	sizeof(GetRandomBytesRequest),
+	1,
+	get_random_bytes_request__field_descriptors,
+	get_random_bytes_request__field_indices_by_name,
+	1,
+	get_random_bytes_request__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_ent_lvl_response__field_descriptors[2] = {
+	get_random_bytes_response__field_descriptors[2] = {
 		{
-			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
 			0, /* quantifier_offset */
-			offsetof(GetEntLvlResponse, ret), NULL, NULL,
+			offsetof(GetRandomBytesResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"entlvl", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
-			offsetof(GetEntLvlResponse, entlvl), NULL, NULL,
+			"randval", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
+			offsetof(GetRandomBytesResponse, randval), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_ent_lvl_response__field_indices_by_name[] = {
-	1, /* field[1] = entlvl */
+static const unsigned get_random_bytes_response__field_indices_by_name[] = {
+	1, /* field[1] = randval */
 	0, /* field[0] = ret */
 };
-static const ProtobufCIntRange get_ent_lvl_response__number_ranges[1 + 1] = {
-	{ 1, 0 },
-	{ 0, 2 }
-};
-const ProtobufCMessageDescriptor get_ent_lvl_response__descriptor = {
+static const ProtobufCIntRange
+	get_random_bytes_response__number_ranges[1 + 1] = { { 1, 0 },
+							    { 0, 2 } };
+const ProtobufCMessageDescriptor get_random_bytes_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetEntLvlResponse",
-	"GetEntLvlResponse",
-	"GetEntLvlResponse",
+	"GetRandomBytesResponse",
+	"GetRandomBytesResponse",
+	"GetRandomBytesResponse",
 	"",
-	sizeof(GetEntLvlResponse),
+	sizeof(GetRandomBytesResponse),
 	2,
-	get_ent_lvl_response__field_descriptors,
-	get_ent_lvl_response__field_indices_by_name,
+	get_random_bytes_response__field_descriptors,
+	get_random_bytes_response__field_indices_by_name,
 	1,
-	get_ent_lvl_response__number_ranges,
-	(ProtobufCMessageInit)get_ent_lvl_response__init,
+	get_random_bytes_response__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-#define is_min_seeded_request__field_descriptors NULL
-#define is_min_seeded_request__field_indices_by_name NULL
-#define is_min_seeded_request__number_ranges NULL
-const ProtobufCMessageDescriptor is_min_seeded_request__descriptor = {
+static const ProtobufCFieldDescriptor write_data_request__field_descriptors[1] = {
+	{
+		"data", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_BYTES,
+		0, /* quantifier_offset */
+		offsetof(WriteDataRequest, data), NULL, NULL, 0, /* flags */
+		0, NULL, NULL /* reserved1,reserved2, etc */
+	},
+};
+static const unsigned write_data_request__field_indices_by_name[] = {
+	0, /* field[0] = data */
+};
+static const ProtobufCIntRange write_data_request__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 1 }
+};
+const ProtobufCMessageDescriptor write_data_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"IsMinSeededRequest",
-	"IsMinSeededRequest",
-	"IsMinSeededRequest",
+	"WriteDataRequest",
+	"WriteDataRequest",
+	"WriteDataRequest",
 	"",
-	sizeof(IsMinSeededRequest),
-	0,
-	is_min_seeded_request__field_descriptors,
-	is_min_seeded_request__field_indices_by_name,
-	0,
-	is_min_seeded_request__number_ranges,
-	(ProtobufCMessageInit)is_min_seeded_request__init,
+	sizeof(WriteDataRequest),
+	1,
+	write_data_request__field_descriptors,
+	write_data_request__field_indices_by_name,
+	1,
+	write_data_request__number_ranges,
+	(ProtobufCMessageInit)write_data_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	is_min_seeded_response__field_descriptors[2] = {
+	write_data_response__field_descriptors[1] = {
 		{
 			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(IsMinSeededResponse, ret), NULL, NULL,
-			0, /* flags */
-			0, NULL, NULL /* reserved1,reserved2, etc */
-		},
-		{
-			"min_seeded", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_BOOL, 0, /* quantifier_offset */
-			offsetof(IsMinSeededResponse, min_seeded), NULL, NULL,
+			offsetof(WriteDataResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned is_min_seeded_response__field_indices_by_name[] = {
-	1, /* field[1] = min_seeded */
+static const unsigned write_data_response__field_indices_by_name[] = {
 	0, /* field[0] = ret */
 };
-static const ProtobufCIntRange is_min_seeded_response__number_ranges[1 + 1] = {
+static const ProtobufCIntRange write_data_response__number_ranges[1 + 1] = {
 	{ 1, 0 },
-	{ 0, 2 }
+	{ 0, 1 }
 };
-const ProtobufCMessageDescriptor is_min_seeded_response__descriptor = {
+const ProtobufCMessageDescriptor write_data_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"IsMinSeededResponse",
-	"IsMinSeededResponse",
-	"IsMinSeededResponse",
+	"WriteDataResponse",
+	"WriteDataResponse",
+	"WriteDataResponse",
 	"",
-	sizeof(IsMinSeededResponse),
-	2,
-	is_min_seeded_response__field_descriptors,
-	is_min_seeded_response__field_indices_by_name,
+	sizeof(WriteDataResponse),
 	1,
-	is_min_seeded_response__number_ranges,
-	(ProtobufCMessageInit)is_min_seeded_response__init,
+	write_data_response__field_descriptors,
+	write_data_response__field_indices_by_name,
+	1,
+	write_data_response__number_ranges,
+	(ProtobufCMessageInit)write_data_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-#define is_fully_seeded_request__field_descriptors NULL
-#define is_fully_seeded_request__field_indices_by_name NULL
-#define is_fully_seeded_request__number_ranges NULL
-const ProtobufCMessageDescriptor is_fully_seeded_request__descriptor = {
+#define rnd_get_ent_cnt_request__field_descriptors NULL
+#define rnd_get_ent_cnt_request__field_indices_by_name NULL
+#define rnd_get_ent_cnt_request__number_ranges NULL
+const ProtobufCMessageDescriptor rnd_get_ent_cnt_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"IsFullySeededRequest",
-	"IsFullySeededRequest",
-	"IsFullySeededRequest",
+	"RndGetEntCntRequest",
+	"RndGetEntCntRequest",
+	"RndGetEntCntRequest",
 	"",
-	sizeof(IsFullySeededRequest),
+	sizeof(RndGetEntCntRequest),
 	0,
-	is_fully_seeded_request__field_descriptors,
-	is_fully_seeded_request__field_indices_by_name,
+	rnd_get_ent_cnt_request__field_descriptors,
+	rnd_get_ent_cnt_request__field_indices_by_name,
 	0,
-	is_fully_seeded_request__number_ranges,
-	(ProtobufCMessageInit)is_fully_seeded_request__init,
+	rnd_get_ent_cnt_request__number_ranges,
+	(ProtobufCMessageInit)rnd_get_ent_cnt_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	is_fully_seeded_response__field_descriptors[2] = {
+	rnd_get_ent_cnt_response__field_descriptors[2] = {
 		{
 			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(IsFullySeededResponse, ret), NULL, NULL,
+			offsetof(RndGetEntCntResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"fully_seeded", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_BOOL, 0, /* quantifier_offset */
-			offsetof(IsFullySeededResponse, fully_seeded), NULL,
-			NULL, 0, /* flags */
+			"entcnt", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
+			offsetof(RndGetEntCntResponse, entcnt), NULL, NULL,
+			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned is_fully_seeded_response__field_indices_by_name[] = {
-	1, /* field[1] = fully_seeded */
+static const unsigned rnd_get_ent_cnt_response__field_indices_by_name[] = {
+	1, /* field[1] = entcnt */
 	0, /* field[0] = ret */
 };
 static const ProtobufCIntRange
-	is_fully_seeded_response__number_ranges[1 + 1] = { { 1, 0 }, { 0, 2 } };
-const ProtobufCMessageDescriptor is_fully_seeded_response__descriptor = {
+	rnd_get_ent_cnt_response__number_ranges[1 + 1] = { { 1, 0 }, { 0, 2 } };
+const ProtobufCMessageDescriptor rnd_get_ent_cnt_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"IsFullySeededResponse",
-	"IsFullySeededResponse",
-	"IsFullySeededResponse",
+	"RndGetEntCntResponse",
+	"RndGetEntCntResponse",
+	"RndGetEntCntResponse",
 	"",
-	sizeof(IsFullySeededResponse),
+	sizeof(RndGetEntCntResponse),
 	2,
-	is_fully_seeded_response__field_descriptors,
-	is_fully_seeded_response__field_indices_by_name,
-	1,
-	is_fully_seeded_response__number_ranges,
-	(ProtobufCMessageInit)is_fully_seeded_response__init,
-	NULL,
-	NULL,
-	NULL /* reserved[123] */
-};
-static const ProtobufCFieldDescriptor
-	get_random_bytes_full_request__field_descriptors[1] = {
-		{
-			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
-			0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullRequest, len), NULL, NULL,
-			0, /* flags */
-			0, NULL, NULL /* reserved1,reserved2, etc */
-		},
-	};
-static const unsigned get_random_bytes_full_request__field_indices_by_name[] = {
-	0, /* field[0] = len */
+	rnd_get_ent_cnt_response__field_descriptors,
+	rnd_get_ent_cnt_response__field_indices_by_name,
+	1,
+	rnd_get_ent_cnt_response__number_ranges,
+	(ProtobufCMessageInit)rnd_get_ent_cnt_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
 };
-static const ProtobufCIntRange
-	get_random_bytes_full_request__number_ranges[1 + 1] = { { 1, 0 },
-								{ 0, 1 } };
-const ProtobufCMessageDescriptor get_random_bytes_full_request__descriptor = {
+#define get_poolsize_request__field_descriptors NULL
+#define get_poolsize_request__field_indices_by_name NULL
+#define get_poolsize_request__number_ranges NULL
+const ProtobufCMessageDescriptor get_poolsize_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesFullRequest",
-	"GetRandomBytesFullRequest",
-	"GetRandomBytesFullRequest",
+	"GetPoolsizeRequest",
+	"GetPoolsizeRequest",
+	"GetPoolsizeRequest",
 	"",
-	sizeof(GetRandomBytesFullRequest),
-	1,
-	get_random_bytes_full_request__field_descriptors,
-	get_random_bytes_full_request__field_indices_by_name,
-	1,
-	get_random_bytes_full_request__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_full_request__init,
+	sizeof(GetPoolsizeRequest),
+	0,
+	get_poolsize_request__field_descriptors,
+	get_poolsize_request__field_indices_by_name,
+	0,
+	get_poolsize_request__number_ranges,
+	(ProtobufCMessageInit)get_poolsize_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_random_bytes_full_response__field_descriptors[2] = {
+	get_poolsize_response__field_descriptors[2] = {
 		{
-			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullResponse, ret), NULL, NULL,
+			offsetof(GetPoolsizeResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"randval", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullResponse, randval), NULL,
-			NULL, 0, /* flags */
+			"poolsize", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
+			offsetof(GetPoolsizeResponse, poolsize), NULL, NULL,
+			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_random_bytes_full_response__field_indices_by_name[] = {
-	1, /* field[1] = randval */
+static const unsigned get_poolsize_response__field_indices_by_name[] = {
+	1, /* field[1] = poolsize */
 	0, /* field[0] = ret */
 };
-static const ProtobufCIntRange
-	get_random_bytes_full_response__number_ranges[1 + 1] = { { 1, 0 },
-								 { 0, 2 } };
-const ProtobufCMessageDescriptor get_random_bytes_full_response__descriptor = {
+static const ProtobufCIntRange get_poolsize_response__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 2 }
+};
+const ProtobufCMessageDescriptor get_poolsize_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesFullResponse",
-	"GetRandomBytesFullResponse",
-	"GetRandomBytesFullResponse",
+	"GetPoolsizeResponse",
+	"GetPoolsizeResponse",
+	"GetPoolsizeResponse",
 	"",
-	sizeof(GetRandomBytesFullResponse),
+	sizeof(GetPoolsizeResponse),
 	2,
-	get_random_bytes_full_response__field_descriptors,
-	get_random_bytes_full_response__field_indices_by_name,
+	get_poolsize_response__field_descriptors,
+	get_poolsize_response__field_indices_by_name,
 	1,
-	get_random_bytes_full_response__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_full_response__init,
+	get_poolsize_response__number_ranges,
+	(ProtobufCMessageInit)get_poolsize_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+#define get_write_wakeup_thresh_request__field_descriptors NULL
+#define get_write_wakeup_thresh_request__field_indices_by_name NULL
+#define get_write_wakeup_thresh_request__number_ranges NULL
+const ProtobufCMessageDescriptor get_write_wakeup_thresh_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetWriteWakeupThreshRequest",
+	"GetWriteWakeupThreshRequest",
+	"GetWriteWakeupThreshRequest",
+	"",
+	sizeof(GetWriteWakeupThreshRequest),
+	0,
+	get_write_wakeup_thresh_request__field_descriptors,
+	get_write_wakeup_thresh_request__field_indices_by_name,
+	0,
+	get_write_wakeup_thresh_request__number_ranges,
+	(ProtobufCMessageInit)get_write_wakeup_thresh_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_random_bytes_full_timeout_request__field_descriptors[3] = {
+	get_write_wakeup_thresh_response__field_descriptors[2] = {
 		{
-			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullTimeoutRequest, len), NULL,
-			NULL, 0, /* flags */
-			0, NULL, NULL /* reserved1,reserved2, etc */
-		},
-		{
-			"tv_sec", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_UINT64, 0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullTimeoutRequest, tv_sec),
-			NULL, NULL, 0, /* flags */
+			offsetof(GetWriteWakeupThreshResponse, ret), NULL, NULL,
+			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"tv_nsec", 3, PROTOBUF_C_LABEL_NONE,
+			"wakeup", 2, PROTOBUF_C_LABEL_NONE,
 			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullTimeoutRequest, tv_nsec),
-			NULL, NULL, 0, /* flags */
-			0, NULL, NULL /* reserved1,reserved2, etc */
-		},
-	};
-static const unsigned
-	get_random_bytes_full_timeout_request__field_indices_by_name[] = {
-		0, /* field[0] = len */
-		2, /* field[2] = tv_nsec */
-		1, /* field[1] = tv_sec */
-	};
-static const ProtobufCIntRange
-	get_random_bytes_full_timeout_request__number_ranges[1 + 1] = {
-		{ 1, 0 },
-		{ 0, 3 }
-	};
-const ProtobufCMessageDescriptor
-	get_random_bytes_full_timeout_request__descriptor = {
-		PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-		"GetRandomBytesFullTimeoutRequest",
-		"GetRandomBytesFullTimeoutRequest",
-		"GetRandomBytesFullTimeoutRequest",
-		"",
-		sizeof(GetRandomBytesFullTimeoutRequest),
-		3,
-		get_random_bytes_full_timeout_request__field_descriptors,
-		get_random_bytes_full_timeout_request__field_indices_by_name,
-		1,
-		get_random_bytes_full_timeout_request__number_ranges,
-		(ProtobufCMessageInit)
-			get_random_bytes_full_timeout_request__init,
-		NULL,
-		NULL,
-		NULL /* reserved[123] */
-	};
-static const ProtobufCFieldDescriptor
-	get_random_bytes_full_timeout_response__field_descriptors[2] = {
-		{
-			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
-			0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullTimeoutResponse, ret), NULL,
+			offsetof(GetWriteWakeupThreshResponse, wakeup), NULL,
 			NULL, 0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
-		{
-			"randval", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
-			offsetof(GetRandomBytesFullTimeoutResponse, randval),
-			NULL, NULL, 0, /* flags */
-			0, NULL, NULL /* reserved1,reserved2, etc */
-		},
 	};
 static const unsigned
-	get_random_bytes_full_timeout_response__field_indices_by_name[] = {
-		1, /* field[1] = randval */
+	get_write_wakeup_thresh_response__field_indices_by_name[] = {
 		0, /* field[0] = ret */
+		1, /* field[1] = wakeup */
 	};
 static const ProtobufCIntRange
-	get_random_bytes_full_timeout_response__number_ranges[1 + 1] = {
-		{ 1, 0 },
-		{ 0, 2 }
-	};
-const ProtobufCMessageDescriptor
-	get_random_bytes_full_timeout_response__descriptor = {
-		PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-		"GetRandomBytesFullTimeoutResponse",
-		"GetRandomBytesFullTimeoutResponse",
-		"GetRandomBytesFullTimeoutResponse",
-		"",
-		sizeof(GetRandomBytesFullTimeoutResponse),
-		2,
-		get_random_bytes_full_timeout_response__field_descriptors,
-		get_random_bytes_full_timeout_response__field_indices_by_name,
-		1,
-		get_random_bytes_full_timeout_response__number_ranges,
-		(ProtobufCMessageInit)
-			get_random_bytes_full_timeout_response__init,
-		NULL,
-		NULL,
-		NULL /* reserved[123] */
-	};
-static const ProtobufCFieldDescriptor
-	get_random_bytes_min_request__field_descriptors[1] = {
-		{
-			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
-			0, /* quantifier_offset */
-			offsetof(GetRandomBytesMinRequest, len), NULL, NULL,
-			0, /* flags */
-			0, NULL, NULL /* reserved1,reserved2, etc */
-		},
-	};
-static const unsigned get_random_bytes_min_request__field_indices_by_name[] = {
-	0, /* field[0] = len */
-};
-static const ProtobufCIntRange
-	get_random_bytes_min_request__number_ranges[1 + 1] = { { 1, 0 },
-							       { 0, 1 } };
-const ProtobufCMessageDescriptor get_random_bytes_min_request__descriptor = {
+	get_write_wakeup_thresh_response__number_ranges[1 + 1] = { { 1, 0 },
+								   { 0, 2 } };
+const ProtobufCMessageDescriptor get_write_wakeup_thresh_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesMinRequest",
-	"GetRandomBytesMinRequest",
-	"GetRandomBytesMinRequest",
+	"GetWriteWakeupThreshResponse",
+	"GetWriteWakeupThreshResponse",
+	"GetWriteWakeupThreshResponse",
 	"",
-	sizeof(GetRandomBytesMinRequest),
-	1,
-	get_random_bytes_min_request__field_descriptors,
-	get_random_bytes_min_request__field_indices_by_name,
+	sizeof(GetWriteWakeupThreshResponse),
+	2,
+	get_write_wakeup_thresh_response__field_descriptors,
+	get_write_wakeup_thresh_response__field_indices_by_name,
 	1,
-	get_random_bytes_min_request__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_min_request__init,
+	get_write_wakeup_thresh_response__number_ranges,
+	(ProtobufCMessageInit)get_write_wakeup_thresh_response__init,
+	NULL,
+	NULL,
+	NULL /* reserved[123] */
+};
+#define get_min_reseed_secs_request__field_descriptors NULL
+#define get_min_reseed_secs_request__field_indices_by_name NULL
+#define get_min_reseed_secs_request__number_ranges NULL
+const ProtobufCMessageDescriptor get_min_reseed_secs_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"GetMinReseedSecsRequest",
+	"GetMinReseedSecsRequest",
+	"GetMinReseedSecsRequest",
+	"",
+	sizeof(GetMinReseedSecsRequest),
+	0,
+	get_min_reseed_secs_request__field_descriptors,
+	get_min_reseed_secs_request__field_indices_by_name,
+	0,
+	get_min_reseed_secs_request__number_ranges,
+	(ProtobufCMessageInit)get_min_reseed_secs_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_random_bytes_min_response__field_descriptors[2] = {
+	get_min_reseed_secs_response__field_descriptors[2] = {
 		{
-			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(GetRandomBytesMinResponse, ret), NULL, NULL,
+			offsetof(GetMinReseedSecsResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"randval", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
-			offsetof(GetRandomBytesMinResponse, randval), NULL,
-			NULL, 0, /* flags */
+			"seconds", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
+			offsetof(GetMinReseedSecsResponse, seconds), NULL, NULL,
+			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_random_bytes_min_response__field_indices_by_name[] = {
-	1, /* field[1] = randval */
+static const unsigned get_min_reseed_secs_response__field_indices_by_name[] = {
 	0, /* field[0] = ret */
+	1, /* field[1] = seconds */
 };
 static const ProtobufCIntRange
-	get_random_bytes_min_response__number_ranges[1 + 1] = { { 1, 0 },
-								{ 0, 2 } };
-const ProtobufCMessageDescriptor get_random_bytes_min_response__descriptor = {
+	get_min_reseed_secs_response__number_ranges[1 + 1] = { { 1, 0 },
+							       { 0, 2 } };
+const ProtobufCMessageDescriptor get_min_reseed_secs_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesMinResponse",
-	"GetRandomBytesMinResponse",
-	"GetRandomBytesMinResponse",
+	"GetMinReseedSecsResponse",
+	"GetMinReseedSecsResponse",
+	"GetMinReseedSecsResponse",
 	"",
-	sizeof(GetRandomBytesMinResponse),
+	sizeof(GetMinReseedSecsResponse),
 	2,
-	get_random_bytes_min_response__field_descriptors,
-	get_random_bytes_min_response__field_indices_by_name,
+	get_min_reseed_secs_response__field_descriptors,
+	get_min_reseed_secs_response__field_indices_by_name,
 	1,
-	get_random_bytes_min_response__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_min_response__init,
+	get_min_reseed_secs_response__number_ranges,
+	(ProtobufCMessageInit)get_min_reseed_secs_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_random_bytes_pr_request__field_descriptors[1] = {
+	get_random_ring_request__field_descriptors[1] = {
 		{
-			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			"size", 1, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
 			0, /* quantifier_offset */
-			offsetof(GetRandomBytesPrRequest, len), NULL, NULL,
+			offsetof(GetRandomRingRequest, size), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_random_bytes_pr_request__field_indices_by_name[] = {
-	0, /* field[0] = len */
+static const unsigned get_random_ring_request__field_indices_by_name[] = {
+	0, /* field[0] = size */
 };
-static const ProtobufCIntRange
-	get_random_bytes_pr_request__number_ranges[1 + 1] = { { 1, 0 },
-							      { 0, 1 } };
-const ProtobufCMessageDescriptor get_random_bytes_pr_request__descriptor = {
+static const ProtobufCIntRange get_random_ring_request__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 1 }
+};
+const ProtobufCMessageDescriptor get_random_ring_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesPrRequest",
-	"GetRandomBytesPrRequest",
-	"GetRandomBytesPrRequest",
+	"GetRandomRingRequest",
+	"GetRandomRingRequest",
+	"GetRandomRingRequest",
 	"",
-	sizeof(GetRandomBytesPrRequest),
+	sizeof(GetRandomRingRequest),
 	1,
-	get_random_bytes_pr_request__field_descriptors,
-	get_random_bytes_pr_request__field_indices_by_name,
+	get_random_ring_request__field_descriptors,
+	get_random_ring_request__field_indices_by_name,
 	1,
-	get_random_bytes_pr_request__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_pr_request__init,
+	get_random_ring_request__number_ranges,
+	(ProtobufCMessageInit)get_random_ring_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_random_bytes_pr_response__field_descriptors[2] = {
+	get_random_ring_response__field_descriptors[2] = {
 		{
-			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(GetRandomBytesPrResponse, ret), NULL, NULL,
+			offsetof(GetRandomRingResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"randval", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
-			offsetof(GetRandomBytesPrResponse, randval), NULL, NULL,
+			"size", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(GetRandomRingResponse, size), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_random_bytes_pr_response__field_indices_by_name[] = {
-	1, /* field[1] = randval */
+static const unsigned get_random_ring_response__field_indices_by_name[] = {
 	0, /* field[0] = ret */
+	1, /* field[1] = size */
 };
-static const ProtobufCIntRange
-	get_random_bytes_pr_response__number_ranges[1 + 1] = { { 1, 0 },
-							       { 0, 2 } };
-const ProtobufCMessageDescriptor get_random_bytes_pr_response__descriptor = {
+static const ProtobufCIntRange get_random_ring_response__number_ranges[1 +
+	1] = {
+		{ 1, 0 },
+		{ 0, 2 }
+	};
+const ProtobufCMessageDescriptor get_random_ring_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesPrResponse",
-	"GetRandomBytesPrResponse",
-	"GetRandomBytesPrResponse",
+	"GetRandomRingResponse",
+	"GetRandomRingResponse",
+	"GetRandomRingResponse",
 	"",
-	sizeof(GetRandomBytesPrResponse),
+	sizeof(GetRandomRingResponse),
 	2,
-	get_random_bytes_pr_response__field_descriptors,
-	get_random_bytes_pr_response__field_indices_by_name,
+	get_random_ring_response__field_descriptors,
+	get_random_ring_response__field_indices_by_name,
 	1,
-	get_random_bytes_pr_response__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_pr_response__init,
+	get_random_ring_response__number_ranges,
+	(ProtobufCMessageInit)get_random_ring_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor get_seed_request__field_descriptors[2] = {
-	{
-		"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
-		0, /* quantifier_offset */
-		offsetof(GetSeedRequest, len), NULL, NULL, 0, /* flags */
-		0, NULL, NULL /* reserved1,reserved2, etc */
-	},
-	{
-		"flags", 2, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
-		0, /* quantifier_offset */
-		offsetof(GetSeedRequest, flags), NULL, NULL, 0, /* flags */
-		0, NULL, NULL /* reserved1,reserved2, etc */
-	},
-};
-static const unsigned get_seed_request__field_indices_by_name[] = {
-	1, /* field[1] = flags */
+static const ProtobufCFieldDescriptor
+	get_lease_seed_request__field_descriptors[1] = {
+		{
+			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(GetLeaseSeedRequest, len), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_lease_seed_request__field_indices_by_name[] = {
 	0, /* field[0] = len */
 };
-static const ProtobufCIntRange get_seed_request__number_ranges[1 + 1] = {
+static const ProtobufCIntRange get_lease_seed_request__number_ranges[1 + 1] = {
 	{ 1, 0 },
-	{ 0, 2 }
+	{ 0, 1 }
 };
-const ProtobufCMessageDescriptor get_seed_request__descriptor = {
+const ProtobufCMessageDescriptor get_lease_seed_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetSeedRequest",
-	"GetSeedRequest",
-	"GetSeedRequest",
+	"GetLeaseSeedRequest",
+	"GetLeaseSeedRequest",
+	"GetLeaseSeedRequest",
 	"",
-	sizeof(GetSeedRequest),
-	2,
-	get_seed_request__field_descriptors,
-	get_seed_request__field_indices_by_name,
+	sizeof(GetLeaseSeedRequest),
 	1,
-	get_seed_request__number_ranges,
-	(ProtobufCMessageInit)get_seed_request__init,
+	get_lease_seed_request__field_descriptors,
+	get_lease_seed_request__field_indices_by_name,
+	1,
+	get_lease_seed_request__number_ranges,
+	(ProtobufCMessageInit)get_lease_seed_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor get_seed_response__field_descriptors[2] = {
-	{
-		"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
-		0, /* quantifier_offset */
-		offsetof(GetSeedResponse, ret), NULL, NULL, 0, /* flags */
-		0, NULL, NULL /* reserved1,reserved2, etc */
-	},
-	{
-		"randval", 2, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_BYTES,
-		0, /* quantifier_offset */
-		offsetof(GetSeedResponse, randval), NULL, NULL, 0, /* flags */
-		0, NULL, NULL /* reserved1,reserved2, etc */
-	},
-};
-static const unsigned get_seed_response__field_indices_by_name[] = {
-	1, /* field[1] = randval */
+static const ProtobufCFieldDescriptor
+	get_lease_seed_response__field_descriptors[5] = {
+		{
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			0, /* quantifier_offset */
+			offsetof(GetLeaseSeedResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"seed", 2, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_BYTES,
+			0, /* quantifier_offset */
+			offsetof(GetLeaseSeedResponse, seed), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"max_requests", 3, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(GetLeaseSeedResponse, max_requests), NULL,
+			NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"max_bytes", 4, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT64,
+			0, /* quantifier_offset */
+			offsetof(GetLeaseSeedResponse, max_bytes), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"max_secs", 5, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(GetLeaseSeedResponse, max_secs), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_lease_seed_response__field_indices_by_name[] = {
+	3, /* field[3] = max_bytes */
+	2, /* field[2] = max_requests */
+	4, /* field[4] = max_secs */
 	0, /* field[0] = ret */
+	1, /* field[1] = seed */
 };
-static const ProtobufCIntRange get_seed_response__number_ranges[1 + 1] = {
+static const ProtobufCIntRange get_lease_seed_response__number_ranges[1 + 1] = {
 	{ 1, 0 },
-	{ 0, 2 }
+	{ 0, 5 }
 };
-const ProtobufCMessageDescriptor get_seed_response__descriptor = {
+const ProtobufCMessageDescriptor get_lease_seed_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetSeedResponse",
-	"GetSeedResponse",
-	"GetSeedResponse",
+	"GetLeaseSeedResponse",
+	"GetLeaseSeedResponse",
+	"GetLeaseSeedResponse",
 	"",
-	sizeof(GetSeedResponse),
-	2,
-	get_seed_response__field_descriptors,
-	get_seed_response__field_indices_by_name,
+	sizeof(GetLeaseSeedResponse),
+	5,
+	get_lease_seed_response__field_descriptors,
+	get_lease_seed_response__field_indices_by_name,
 	1,
-	get_seed_response__number_ranges,
-	(ProtobufCMessageInit)get_seed_response__init,
+	get_lease_seed_response__number_ranges,
+	(ProtobufCMessageInit)get_lease_seed_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_random_bytes_request__field_descriptors[1] = {
+	get_random_bytes_vec_request__field_descriptors[2] = {
 		{
-			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
-			0, /* quantifier_offset */
-			offsetof(GetRandomBytesRequest, len), NULL, NULL,
-			0, /* flags */
+			"len", 1, PROTOBUF_C_LABEL_REPEATED,
+			PROTOBUF_C_TYPE_UINT32,
+			offsetof(GetRandomBytesVecRequest, n_len),
+			/* quantifier_offset */
+			offsetof(GetRandomBytesVecRequest, len), NULL, NULL,
+			PROTOBUF_C_FIELD_FLAG_PACKED, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"flags", 2, PROTOBUF_C_LABEL_REPEATED,
+			PROTOBUF_C_TYPE_UINT32,
+			offsetof(GetRandomBytesVecRequest, n_flags),
+			/* quantifier_offset */
+			offsetof(GetRandomBytesVecRequest, flags), NULL, NULL,
+			PROTOBUF_C_FIELD_FLAG_PACKED, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_random_bytes_request__field_indices_by_name[] = {
+static const unsigned get_random_bytes_vec_request__field_indices_by_name[] = {
+	1, /* field[1] = flags */
 	0, /* field[0] = len */
 };
-static const ProtobufCIntRange
-	get_random_bytes_request__number_ranges[1 + 1] = { { 1, 0 }, { 0, 1 } };
-const ProtobufCMessageDescriptor get_random_bytes_request__descriptor = {
+static const ProtobufCIntRange get_random_bytes_vec_request__number_ranges[1 +
+	1] = {
+		{ 1, 0 },
+		{ 0, 2 }
+	};
+const ProtobufCMessageDescriptor get_random_bytes_vec_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesRequest",
-	"GetRandomBytesRequest",
-	"GetRandomBytesRequest",
+	"GetRandomBytesVecRequest",
+	"GetRandomBytesVecRequest",
+	"GetRandomBytesVecRequest",
 	"",
-	sizeof(GetRandomBytesRequest),
-	1,
-	get_random_bytes_request__field_descriptors,
-	get_random_bytes_request__field_indices_by_name,
+	sizeof(GetRandomBytesVecRequest),
+	2,
+	get_random_bytes_vec_request__field_descriptors,
+	get_random_bytes_vec_request__field_indices_by_name,
 	1,
-	get_random_bytes_request__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_request__init,
+	get_random_bytes_vec_request__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_vec_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_random_bytes_response__field_descriptors[2] = {
+	get_random_bytes_vec_response__field_descriptors[2] = {
 		{
 			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
 			0, /* quantifier_offset */
-			offsetof(GetRandomBytesResponse, ret), NULL, NULL,
+			offsetof(GetRandomBytesVecResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"randval", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_BYTES, 0, /* quantifier_offset */
-			offsetof(GetRandomBytesResponse, randval), NULL, NULL,
+			"randval", 2, PROTOBUF_C_LABEL_REPEATED,
+			PROTOBUF_C_TYPE_BYTES,
+			offsetof(GetRandomBytesVecResponse, n_randval),
+			/* quantifier_offset */
+			offsetof(GetRandomBytesVecResponse, randval), NULL,
+			NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_random_bytes_response__field_indices_by_name[] = {
+static const unsigned get_random_bytes_vec_response__field_indices_by_name[] = {
 	1, /* field[1] = randval */
 	0, /* field[0] = ret */
 };
-static const ProtobufCIntRange
-	get_random_bytes_response__number_ranges[1 + 1] = { { 1, 0 },
-							    { 0, 2 } };
-const ProtobufCMessageDescriptor get_random_bytes_response__descriptor = {
+static const ProtobufCIntRange get_random_bytes_vec_response__number_ranges[1 +
+	1] = {
+		{ 1, 0 },
+		{ 0, 2 }
+	};
+const ProtobufCMessageDescriptor get_random_bytes_vec_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetRandomBytesResponse",
-	"GetRandomBytesResponse",
-	"GetRandomBytesResponse",
+	"GetRandomBytesVecResponse",
+	"GetRandomBytesVecResponse",
+	"GetRandomBytesVecResponse",
 	"",
-	sizeof(GetRandomBytesResponse),
+	sizeof(GetRandomBytesVecResponse),
 	2,
-	get_random_bytes_response__field_descriptors,
-	get_random_bytes_response__field_indices_by_name,
+	get_random_bytes_vec_response__field_descriptors,
+	get_random_bytes_vec_response__field_indices_by_name,
 	1,
-	get_random_bytes_response__number_ranges,
-	(ProtobufCMessageInit)get_random_bytes_response__init,
+	get_random_bytes_vec_response__number_ranges,
+	(ProtobufCMessageInit)get_random_bytes_vec_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor write_data_request__field_descriptors[1] = {
-	{
-		"data", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_BYTES,
-		0, /* quantifier_offset */
-		offsetof(WriteDataRequest, data), NULL, NULL, 0, /* flags */
-		0, NULL, NULL /* reserved1,reserved2, etc */
-	},
-};
-static const unsigned write_data_request__field_indices_by_name[] = {
-	0, /* field[0] = data */
+static const ProtobufCFieldDescriptor
+	negotiate_request__field_descriptors[3] = {
+		{
+			"version", 1, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(NegotiateRequest, version), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"max_msg_size", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(NegotiateRequest, max_msg_size), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"cpu", 3, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(NegotiateRequest, cpu), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned negotiate_request__field_indices_by_name[] = {
+	2, /* field[2] = cpu */
+	1, /* field[1] = max_msg_size */
+	0, /* field[0] = version */
 };
-static const ProtobufCIntRange write_data_request__number_ranges[1 + 1] = {
+static const ProtobufCIntRange negotiate_request__number_ranges[1 + 1] = {
 	{ 1, 0 },
-	{ 0, 1 }
+	{ 0, 3 }
 };
-const ProtobufCMessageDescriptor write_data_request__descriptor = {
-	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"WriteDataRequest",
-	"WriteDataRequest",
-	"WriteDataRequest",
-	"",
-	sizeof(WriteDataRequest),
-	1,
-	write_data_request__field_descriptors,
-	write_data_request__field_indices_by_name,
+const ProtobufCMessageDescriptor negotiate_request__descriptor = {
+	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+	"NegotiateRequest",
+	"NegotiateRequest",
+	"NegotiateRequest",
+	"",
+	sizeof(NegotiateRequest),
+	3,
+	negotiate_request__field_descriptors,
+	negotiate_request__field_indices_by_name,
 	1,
-	write_data_request__number_ranges,
-	(ProtobufCMessageInit)write_data_request__init,
+	negotiate_request__number_ranges,
+	(ProtobufCMessageInit)negotiate_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	write_data_response__field_descriptors[1] = {
+	negotiate_response__field_descriptors[3] = {
 		{
 			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(WriteDataResponse, ret), NULL, NULL,
+			offsetof(NegotiateResponse, ret), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"version", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(NegotiateResponse, version), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"max_msg_size", 3, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(NegotiateResponse, max_msg_size), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned write_data_response__field_indices_by_name[] = {
+static const unsigned negotiate_response__field_indices_by_name[] = {
+	2, /* field[2] = max_msg_size */
 	0, /* field[0] = ret */
+	1, /* field[1] = version */
 };
-static const ProtobufCIntRange write_data_response__number_ranges[1 + 1] = {
+static const ProtobufCIntRange negotiate_response__number_ranges[1 + 1] = {
 	{ 1, 0 },
-	{ 0, 1 }
+	{ 0, 3 }
 };
-const ProtobufCMessageDescriptor write_data_response__descriptor = {
+const ProtobufCMessageDescriptor negotiate_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"WriteDataResponse",
-	"WriteDataResponse",
-	"WriteDataResponse",
+	"NegotiateResponse",
+	"NegotiateResponse",
+	"NegotiateResponse",
 	"",
-	sizeof(WriteDataResponse),
+	sizeof(NegotiateResponse),
+	3,
+	negotiate_response__field_descriptors,
+	negotiate_response__field_indices_by_name,
 	1,
-	write_data_response__field_descriptors,
-	write_data_response__field_indices_by_name,
-	1,
-	write_data_response__number_ranges,
-	(ProtobufCMessageInit)write_data_response__init,
+	negotiate_response__number_ranges,
+	(ProtobufCMessageInit)negotiate_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-#define rnd_get_ent_cnt_request__field_descriptors NULL
-#define rnd_get_ent_cnt_request__field_indices_by_name NULL
-#define rnd_get_ent_cnt_request__number_ranges NULL
-const ProtobufCMessageDescriptor rnd_get_ent_cnt_request__descriptor = {
+static const ProtobufCFieldDescriptor
+	get_random_stream_request__field_descriptors[2] = {
+		{
+			"len", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_UINT64,
+			0, /* quantifier_offset */
+			offsetof(GetRandomStreamRequest, len), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+		{
+			"frame_size", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(GetRandomStreamRequest, frame_size), NULL,
+			NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned get_random_stream_request__field_indices_by_name[] = {
+	1, /* field[1] = frame_size */
+	0, /* field[0] = len */
+};
+static const ProtobufCIntRange get_random_stream_request__number_ranges[1 +
+	1] = {
+		{ 1, 0 },
+		{ 0, 2 }
+	};
+const ProtobufCMessageDescriptor get_random_stream_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"RndGetEntCntRequest",
-	"RndGetEntCntRequest",
-	"RndGetEntCntRequest",
+	"GetRandomStreamRequest",
+	"GetRandomStreamRequest",
+	"GetRandomStreamRequest",
 	"",
-	sizeof(RndGetEntCntRequest),
-	0,
-	rnd_get_ent_cnt_request__field_descriptors,
-	rnd_get_ent_cnt_request__field_indices_by_name,
-	0,
-	rnd_get_ent_cnt_request__number_ranges,
-	(ProtobufCMessageInit)rnd_get_ent_cnt_request__init,
+	sizeof(GetRandomStreamRequest),
+	2,
+	get_random_stream_request__field_descriptors,
+	get_random_stream_request__field_indices_by_name,
+	1,
+	get_random_stream_request__number_ranges,
+	(ProtobufCMessageInit)get_random_stream_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	rnd_get_ent_cnt_response__field_descriptors[2] = {
+	get_random_stream_response__field_descriptors[2] = {
 		{
-			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT64,
 			0, /* quantifier_offset */
-			offsetof(RndGetEntCntResponse, ret), NULL, NULL,
+			offsetof(GetRandomStreamResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"entcnt", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
-			offsetof(RndGetEntCntResponse, entcnt), NULL, NULL,
+			"randval", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BYTES,
+			0, /* quantifier_offset */
+			offsetof(GetRandomStreamResponse, randval), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned rnd_get_ent_cnt_response__field_indices_by_name[] = {
-	1, /* field[1] = entcnt */
+static const unsigned get_random_stream_response__field_indices_by_name[] = {
+	1, /* field[1] = randval */
 	0, /* field[0] = ret */
 };
-static const ProtobufCIntRange
-	rnd_get_ent_cnt_response__number_ranges[1 + 1] = { { 1, 0 }, { 0, 2 } };
-const ProtobufCMessageDescriptor rnd_get_ent_cnt_response__descriptor = {
+static const ProtobufCIntRange get_random_stream_response__number_ranges[1 +
+	1] = {
+		{ 1, 0 },
+		{ 0, 2 }
+	};
+const ProtobufCMessageDescriptor get_random_stream_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"RndGetEntCntResponse",
-	"RndGetEntCntResponse",
-	"RndGetEntCntResponse",
+	"GetRandomStreamResponse",
+	"GetRandomStreamResponse",
+	"GetRandomStreamResponse",
 	"",
-	sizeof(RndGetEntCntResponse),
+	sizeof(GetRandomStreamResponse),
 	2,
-	rnd_get_ent_cnt_response__field_descriptors,
-	rnd_get_ent_cnt_response__field_indices_by_name,
+	get_random_stream_response__field_descriptors,
+	get_random_stream_response__field_indices_by_name,
 	1,
-	rnd_get_ent_cnt_response__number_ranges,
-	(ProtobufCMessageInit)rnd_get_ent_cnt_response__init,
+	get_random_stream_response__number_ranges,
+	(ProtobufCMessageInit)get_random_stream_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-#define get_poolsize_request__field_descriptors NULL
-#define get_poolsize_request__field_indices_by_name NULL
-#define get_poolsize_request__number_ranges NULL
-const ProtobufCMessageDescriptor get_poolsize_request__descriptor = {
+static const ProtobufCFieldDescriptor
+	status_bin_request__field_descriptors[1] = {
+		{
+			"maxlen", 1, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(StatusBinRequest, maxlen), NULL, NULL,
+			0, /* flags */
+			0, NULL, NULL /* reserved1,reserved2, etc */
+		},
+	};
+static const unsigned status_bin_request__field_indices_by_name[] = {
+	0, /* field[0] = maxlen */
+};
+static const ProtobufCIntRange status_bin_request__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 1 }
+};
+const ProtobufCMessageDescriptor status_bin_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetPoolsizeRequest",
-	"GetPoolsizeRequest",
-	"GetPoolsizeRequest",
+	"StatusBinRequest",
+	"StatusBinRequest",
+	"StatusBinRequest",
 	"",
-	sizeof(GetPoolsizeRequest),
-	0,
-	get_poolsize_request__field_descriptors,
-	get_poolsize_request__field_indices_by_name,
-	0,
-	get_poolsize_request__number_ranges,
-	(ProtobufCMessageInit)get_poolsize_request__init,
+	sizeof(StatusBinRequest),
+	1,
+	status_bin_request__field_descriptors,
+	status_bin_request__field_indices_by_name,
+	1,
+	status_bin_request__number_ranges,
+	(ProtobufCMessageInit)status_bin_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_poolsize_response__field_descriptors[2] = {
+	status_bin_response__field_descriptors[2] = {
 		{
 			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(GetPoolsizeResponse, ret), NULL, NULL,
+			offsetof(StatusBinResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"poolsize", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
-			offsetof(GetPoolsizeResponse, poolsize), NULL, NULL,
+			"status", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_BYTES,
+			0, /* quantifier_offset */
+			offsetof(StatusBinResponse, status), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_poolsize_response__field_indices_by_name[] = {
-	1, /* field[1] = poolsize */
+static const unsigned status_bin_response__field_indices_by_name[] = {
 	0, /* field[0] = ret */
+	1, /* field[1] = status */
 };
-static const ProtobufCIntRange get_poolsize_response__number_ranges[1 + 1] = {
+static const ProtobufCIntRange status_bin_response__number_ranges[1 + 1] = {
 	{ 1, 0 },
 	{ 0, 2 }
 };
-const ProtobufCMessageDescriptor get_poolsize_response__descriptor = {
+const ProtobufCMessageDescriptor status_bin_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetPoolsizeResponse",
-	"GetPoolsizeResponse",
-	"GetPoolsizeResponse",
+	"StatusBinResponse",
+	"StatusBinResponse",
+	"StatusBinResponse",
 	"",
-	sizeof(GetPoolsizeResponse),
+	sizeof(StatusBinResponse),
 	2,
-	get_poolsize_response__field_descriptors,
-	get_poolsize_response__field_indices_by_name,
+	status_bin_response__field_descriptors,
+	status_bin_response__field_indices_by_name,
 	1,
-	get_poolsize_response__number_ranges,
-	(ProtobufCMessageInit)get_poolsize_response__init,
-	NULL,
-	NULL,
-	NULL /* reserved[123] */
-};
-#define get_write_wakeup_thresh_request__field_descriptors NULL
-#define get_write_wakeup_thresh_request__field_indices_by_name NULL
-#define get_write_wakeup_thresh_request__number_ranges NULL
-const ProtobufCMessageDescriptor get_write_wakeup_thresh_request__descriptor = {
-	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetWriteWakeupThreshRequest",
-	"GetWriteWakeupThreshRequest",
-	"GetWriteWakeupThreshRequest",
-	"",
-	sizeof(GetWriteWakeupThreshRequest),
-	0,
-	get_write_wakeup_thresh_request__field_descriptors,
-	get_write_wakeup_thresh_request__field_indices_by_name,
-	0,
-	get_write_wakeup_thresh_request__number_ranges,
-	(ProtobufCMessageInit)get_write_wakeup_thresh_request__init,
+	status_bin_response__number_ranges,
+	(ProtobufCMessageInit)status_bin_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_write_wakeup_thresh_response__field_descriptors[2] = {
+	wait_seed_state_request__field_descriptors[2] = {
 		{
-			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
+			"states", 1, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
 			0, /* quantifier_offset */
-			offsetof(GetWriteWakeupThreshResponse, ret), NULL, NULL,
+			offsetof(WaitSeedStateRequest, states), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"wakeup", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
-			offsetof(GetWriteWakeupThreshResponse, wakeup), NULL,
-			NULL, 0, /* flags */
+			"timeout_ms", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(WaitSeedStateRequest, timeout_ms), NULL, NULL,
+			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned
-	get_write_wakeup_thresh_response__field_indices_by_name[] = {
-		0, /* field[0] = ret */
-		1, /* field[1] = wakeup */
-	};
-static const ProtobufCIntRange
-	get_write_wakeup_thresh_response__number_ranges[1 + 1] = { { 1, 0 },
-								   { 0, 2 } };
-const ProtobufCMessageDescriptor get_write_wakeup_thresh_response__descriptor = {
+static const unsigned wait_seed_state_request__field_indices_by_name[] = {
+	0, /* field[0] = states */
+	1, /* field[1] = timeout_ms */
+};
+static const ProtobufCIntRange wait_seed_state_request__number_ranges[1 + 1] = {
+	{ 1, 0 },
+	{ 0, 2 }
+};
+const ProtobufCMessageDescriptor wait_seed_state_request__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetWriteWakeupThreshResponse",
-	"GetWriteWakeupThreshResponse",
-	"GetWriteWakeupThreshResponse",
+	"WaitSeedStateRequest",
+	"WaitSeedStateRequest",
+	"WaitSeedStateRequest",
 	"",
-	sizeof(GetWriteWakeupThreshResponse),
+	sizeof(WaitSeedStateRequest),
 	2,
-	get_write_wakeup_thresh_response__field_descriptors,
-	get_write_wakeup_thresh_response__field_indices_by_name,
+	wait_seed_state_request__field_descriptors,
+	wait_seed_state_request__field_indices_by_name,
 	1,
-	get_write_wakeup_thresh_response__number_ranges,
-	(ProtobufCMessageInit)get_write_wakeup_thresh_response__init,
-	NULL,
-	NULL,
-	NULL /* reserved[123] */
-};
-#define get_min_reseed_secs_request__field_descriptors NULL
-#define get_min_reseed_secs_request__field_indices_by_name NULL
-#define get_min_reseed_secs_request__number_ranges NULL
-const ProtobufCMessageDescriptor get_min_reseed_secs_request__descriptor = {
-	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetMinReseedSecsRequest",
-	"GetMinReseedSecsRequest",
-	"GetMinReseedSecsRequest",
-	"",
-	sizeof(GetMinReseedSecsRequest),
-	0,
-	get_min_reseed_secs_request__field_descriptors,
-	get_min_reseed_secs_request__field_indices_by_name,
-	0,
-	get_min_reseed_secs_request__number_ranges,
-	(ProtobufCMessageInit)get_min_reseed_secs_request__init,
+	wait_seed_state_request__number_ranges,
+	(ProtobufCMessageInit)wait_seed_state_request__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
 static const ProtobufCFieldDescriptor
-	get_min_reseed_secs_response__field_descriptors[2] = {
+	wait_seed_state_response__field_descriptors[2] = {
 		{
 			"ret", 1, PROTOBUF_C_LABEL_NONE, PROTOBUF_C_TYPE_INT32,
 			0, /* quantifier_offset */
-			offsetof(GetMinReseedSecsResponse, ret), NULL, NULL,
+			offsetof(WaitSeedStateResponse, ret), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 		{
-			"seconds", 2, PROTOBUF_C_LABEL_NONE,
-			PROTOBUF_C_TYPE_UINT32, 0, /* quantifier_offset */
-			offsetof(GetMinReseedSecsResponse, seconds), NULL, NULL,
+			"states", 2, PROTOBUF_C_LABEL_NONE,
+			PROTOBUF_C_TYPE_UINT32,
+			0, /* quantifier_offset */
+			offsetof(WaitSeedStateResponse, states), NULL, NULL,
 			0, /* flags */
 			0, NULL, NULL /* reserved1,reserved2, etc */
 		},
 	};
-static const unsigned get_min_reseed_secs_response__field_indices_by_name[] = {
+static const unsigned wait_seed_state_response__field_indices_by_name[] = {
 	0, /* field[0] = ret */
-	1, /* field[1] = seconds */
+	1, /* field[1] = states */
 };
 static const ProtobufCIntRange
-	get_min_reseed_secs_response__number_ranges[1 + 1] = { { 1, 0 },
-							       { 0, 2 } };
-const ProtobufCMessageDescriptor get_min_reseed_secs_response__descriptor = {
+	wait_seed_state_response__number_ranges[1 + 1] = { { 1, 0 },
+							   { 0, 2 } };
+const ProtobufCMessageDescriptor wait_seed_state_response__descriptor = {
 	PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
-	"GetMinReseedSecsResponse",
-	"GetMinReseedSecsResponse",
-	"GetMinReseedSecsResponse",
+	"WaitSeedStateResponse",
+	"WaitSeedStateResponse",
+	"WaitSeedStateResponse",
 	"",
-	sizeof(GetMinReseedSecsResponse),
+	sizeof(WaitSeedStateResponse),
 	2,
-	get_min_reseed_secs_response__field_descriptors,
-	get_min_reseed_secs_response__field_indices_by_name,
+	wait_seed_state_response__field_descriptors,
+	wait_seed_state_response__field_indices_by_name,
 	1,
-	get_min_reseed_secs_response__number_ranges,
-	(ProtobufCMessageInit)get_min_reseed_secs_response__init,
+	wait_seed_state_response__number_ranges,
+	(ProtobufCMessageInit)wait_seed_state_response__init,
 	NULL,
 	NULL,
 	NULL /* reserved[123] */
 };
-static const ProtobufCMethodDescriptor unpriv_access__method_descriptors[15] = {
+static const ProtobufCMethodDescriptor unpriv_access__method_descriptors[22] = {
 	{ "RpcStatus", &status_request__descriptor,
 	  &status_response__descriptor },
 	{ "RpcGetEntLvl", &get_ent_lvl_request__descriptor,
@@ -2408,9 +3676,24 @@ static const ProtobufCMethodDescriptor unpriv_access__method_descriptors[15] = {
 	  &get_write_wakeup_thresh_response__descriptor },
 	{ "RpcGetMinReseedSecs", &get_min_reseed_secs_request__descriptor,
 	  &get_min_reseed_secs_response__descriptor },
+	{ "RpcGetRandomRing", &get_random_ring_request__descriptor,
+	  &get_random_ring_response__descriptor },
+	{ "RpcGetLeaseSeed", &get_lease_seed_request__descriptor,
+	  &get_lease_seed_response__descriptor },
+	{ "RpcGetRandomBytesVec", &get_random_bytes_vec_request__descriptor,
+	  &get_random_bytes_vec_response__descriptor },
+	{ "RpcNegotiate", &negotiate_request__descriptor,
+	  &negotiate_response__descriptor },
+	{ "RpcGetRandomStream", &get_random_stream_request__descriptor,
+	  &get_random_stream_response__descriptor },
+	{ "RpcStatusBin", &status_bin_request__descriptor,
+	  &status_bin_response__descriptor },
+	{ "RpcWaitSeedState", &wait_seed_state_request__descriptor,
+	  &wait_seed_state_response__descriptor },
 };
 const unsigned unpriv_access__method_indices_by_name[] = {
 	1, /* RpcGetEntLvl */
+	16, /* RpcGetLeaseSeed */
 	14, /* RpcGetMinReseedSecs */
 	12, /* RpcGetPoolsize */
 	8, /* RpcGetRandomBytes */
@@ -2418,12 +3701,18 @@ const unsigned unpriv_access__method_indices_by_name[] = {
 	5, /* RpcGetRandomBytesFullTimeout */
 	6, /* RpcGetRandomBytesMin */
 	7, /* RpcGetRandomBytesPr */
+	17, /* RpcGetRandomBytesVec */
+	15, /* RpcGetRandomRing */
+	19, /* RpcGetRandomStream */
 	9, /* RpcGetSeed */
 	13, /* RpcGetWriteWakeupThresh */
 	3, /* RpcIsFullySeeded */
 	2, /* RpcIsMinSeeded */
+	18, /* RpcNegotiate */
 	11, /* RpcRndGetEntCnt */
 	0, /* RpcStatus */
+	20, /* RpcStatusBin */
+	21, /* RpcWaitSeedState */
 	10 /* RpcWriteData */
 };
 const ProtobufCServiceDescriptor unpriv_access__descriptor = {
@@ -2432,7 +3721,7 @@ const ProtobufCServiceDescriptor unpriv_access__descriptor = {
 	"UnprivAccess",
 	"UnprivAccess",
 	"",
-	15,
+	22,
 	unpriv_access__method_descriptors,
 	unpriv_access__method_indices_by_name
 };
@@ -2566,6 +3855,69 @@ void unpriv_access__rpc_get_min_reseed_secs(
 	service->invoke(service, 14, (const ProtobufCMessage *)input,
 			(ProtobufCClosure)closure, closure_data);
 }
+void unpriv_access__rpc_get_random_ring(ProtobufCService *service,
+					const GetRandomRingRequest *input,
+					GetRandomRingResponse_Closure closure,
+					void *closure_data)
+{
+	assert(service->descriptor == &unpriv_access__descriptor);
+	service->invoke(service, 15, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void unpriv_access__rpc_get_lease_seed(ProtobufCService *service,
+				       const GetLeaseSeedRequest *input,
+				       GetLeaseSeedResponse_Closure closure,
+				       void *closure_data)
+{
+	assert(service->descriptor == &unpriv_access__descriptor);
+	service->invoke(service, 16, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void unpriv_access__rpc_get_random_bytes_vec(
+	ProtobufCService *service, const GetRandomBytesVecRequest *input,
+	GetRandomBytesVecResponse_Closure closure, void *closure_data)
+{
+	assert(service->descriptor == &unpriv_access__descriptor);
+	service->invoke(service, 17, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void unpriv_access__rpc_negotiate(ProtobufCService *service,
+				  const NegotiateRequest *input,
+				  NegotiateResponse_Closure closure,
+				  void *closure_data)
+{
+	assert(service->descriptor == &unpriv_access__descriptor);
+	service->invoke(service, 18, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void
+unpriv_access__rpc_get_random_stream(ProtobufCService *service,
+				     const GetRandomStreamRequest *input,
+				     GetRandomStreamResponse_Closure closure,
+				     void *closure_data)
+{
+	assert(service->descriptor == &unpriv_access__descriptor);
+	service->invoke(service, 19, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void unpriv_access__rpc_status_bin(ProtobufCService *service,
+				   const StatusBinRequest *input,
+				   StatusBinResponse_Closure closure,
+				   void *closure_data)
+{
+	assert(service->descriptor == &unpriv_access__descriptor);
+	service->invoke(service, 20, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
+void unpriv_access__rpc_wait_seed_state(ProtobufCService *service,
+					const WaitSeedStateRequest *input,
+					WaitSeedStateResponse_Closure closure,
+					void *closure_data)
+{
+	assert(service->descriptor == &unpriv_access__descriptor);
+	service->invoke(service, 21, (const ProtobufCMessage *)input,
+			(ProtobufCClosure)closure, closure_data);
+}
 void unpriv_access__init(UnprivAccess_Service *service,
 			 UnprivAccess_ServiceDestroy destroy)
 {
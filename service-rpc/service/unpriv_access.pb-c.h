@@ -45,6 +45,20 @@ typedef struct GetWriteWakeupThreshRequest GetWriteWakeupThreshRequest;
 typedef struct GetWriteWakeupThreshResponse GetWriteWakeupThreshResponse;
 typedef struct GetMinReseedSecsRequest GetMinReseedSecsRequest;
 typedef struct GetMinReseedSecsResponse GetMinReseedSecsResponse;
+typedef struct GetRandomRingRequest GetRandomRingRequest;
+typedef struct GetRandomRingResponse GetRandomRingResponse;
+typedef struct GetLeaseSeedRequest GetLeaseSeedRequest;
+typedef struct GetLeaseSeedResponse GetLeaseSeedResponse;
+typedef struct GetRandomBytesVecRequest GetRandomBytesVecRequest;
+typedef struct GetRandomBytesVecResponse GetRandomBytesVecResponse;
+typedef struct NegotiateRequest NegotiateRequest;
+typedef struct NegotiateResponse NegotiateResponse;
+typedef struct GetRandomStreamRequest GetRandomStreamRequest;
+typedef struct GetRandomStreamResponse GetRandomStreamResponse;
+typedef struct StatusBinRequest StatusBinRequest;
+typedef struct StatusBinResponse StatusBinResponse;
+typedef struct WaitSeedStateRequest WaitSeedStateRequest;
+typedef struct WaitSeedStateResponse WaitSeedStateResponse;
 
 /* --- enums --- */
 
@@ -310,25 +324,30 @@ struct GetRandomBytesPrResponse {
  * @brief Request to get seed from entropy sources
  * @param len buffer size provided by caller
  * @param flags the flags field - see esdm_get_seed documentation
+ * @param num Number of independent seed blocks of len bytes, 0 for one block
  */
 struct GetSeedRequest {
 	ProtobufCMessage base;
 	uint64_t len;
 	uint32_t flags;
+	uint32_t num;
 };
 #define GET_SEED_REQUEST__INIT                                                 \
-	{ PROTOBUF_C_MESSAGE_INIT(&get_seed_request__descriptor), 0, 0 }
+	{ PROTOBUF_C_MESSAGE_INIT(&get_seed_request__descriptor), 0, 0, 0 }
 
 /*
  **
  * @brief Response providing seed data from entropy sources.
  * @param ret Return code of generation request as documented for esdm_get_seed
  * @param randval seed data
+ * @param num Number of seed blocks in randval if more than one block was
+ *	      requested, the blocks are of equal size
  */
 struct GetSeedResponse {
 	ProtobufCMessage base;
 	int64_t ret;
 	ProtobufCBinaryData randval;
+	uint32_t num;
 };
 #define GET_SEED_RESPONSE__INIT                                                \
 	{                                                                      \
@@ -336,7 +355,8 @@ struct GetSeedResponse {
 		, 0,                                                           \
 		{                                                              \
 			0, NULL                                                \
-		}                                                              \
+		},                                                             \
+		0                                                              \
 	}
 
 /*
@@ -509,6 +529,232 @@ struct GetMinReseedSecsResponse {
 	{ PROTOBUF_C_MESSAGE_INIT(&get_min_reseed_secs_response__descriptor),  \
 	  0, 0 }
 
+/*
+ **
+ * @brief Request to set up a shared memory ring with random data
+ * The server answers with two file descriptors passed as ancillary data:
+ * the memory file holding the ring and a control socket used to request the
+ * refill of the ring.
+ * @param size Requested ring size in bytes (0 selects the server default)
+ */
+struct GetRandomRingRequest {
+	ProtobufCMessage base;
+	uint32_t size;
+};
+#define GET_RANDOM_RING_REQUEST__INIT                                          \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_random_ring_request__descriptor), 0 }
+
+/*
+ **
+ * @brief Response to the ring setup
+ * @param ret Return code (0 on success, < 0 on error)
+ * @param size Size of the ring data area in bytes
+ */
+struct GetRandomRingResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+	uint32_t size;
+};
+#define GET_RANDOM_RING_RESPONSE__INIT                                         \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_random_ring_response__descriptor), 0, 0 }
+
+/*
+ **
+ * @brief Request to obtain a seed for a DRNG operated by the client
+ * @param len Size of the seed in bytes
+ */
+struct GetLeaseSeedRequest {
+	ProtobufCMessage base;
+	uint32_t len;
+};
+#define GET_LEASE_SEED_REQUEST__INIT                                           \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_lease_seed_request__descriptor), 0 }
+
+/*
+ **
+ * @brief Response providing a seed from the fully seeded DRNG
+ * The client must obtain a new seed when one of the limits is reached.
+ * @param ret Return code (0 on success, < 0 on error)
+ * @param seed Seed data
+ * @param max_requests Maximum number of generate requests
+ * @param max_bytes Maximum number of bytes generated
+ * @param max_secs Maximum lifetime of the seed in seconds
+ */
+struct GetLeaseSeedResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+	ProtobufCBinaryData seed;
+	uint32_t max_requests;
+	uint64_t max_bytes;
+	uint32_t max_secs;
+};
+#define GET_LEASE_SEED_RESPONSE__INIT                                          \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_lease_seed_response__descriptor), 0,    \
+	  { 0, NULL }, 0, 0, 0 }
+
+/*
+ **
+ * @brief Request to get random bytes for a batch of requests.
+ * @param len number of random bytes that are requested for each entry
+ * @param flags type of each entry: 0 for get_random_bytes, 1 for
+ *		get_random_bytes_full, 2 for get_random_bytes_min, 3 for
+ *		get_random_bytes_pr
+ */
+struct GetRandomBytesVecRequest {
+	ProtobufCMessage base;
+	size_t n_len;
+	uint32_t *len;
+	size_t n_flags;
+	uint32_t *flags;
+};
+#define GET_RANDOM_BYTES_VEC_REQUEST__INIT                                     \
+	{ PROTOBUF_C_MESSAGE_INIT(                                             \
+		  &get_random_bytes_vec_request__descriptor),                  \
+	  0, NULL, 0, NULL }
+
+/*
+ **
+ * @brief Response providing random bytes for a batch of requests.
+ * @param ret Return code of generation request (>= 0 on success with the
+ *	      value indicating the generated number of random bytes of all
+ *	      entries, < 0 on error)
+ * @param randval Random bytes for each entry - entries for
+ *		  get_random_bytes_pr may be shorter than requested
+ */
+struct GetRandomBytesVecResponse {
+	ProtobufCMessage base;
+	int64_t ret;
+	size_t n_randval;
+	ProtobufCBinaryData *randval;
+};
+#define GET_RANDOM_BYTES_VEC_RESPONSE__INIT                                    \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_random_bytes_vec_response__descriptor), \
+	  0, 0, NULL }
+
+/*
+ **
+ * @brief Request to negotiate the protocol parameters of the connection
+ * @param version Highest protocol version supported by the client
+ * @param max_msg_size Maximum message size the client is able to receive
+ * @param cpu CPU the client runs on plus one, 0 if unknown (version 3)
+ */
+struct NegotiateRequest {
+	ProtobufCMessage base;
+	uint32_t version;
+	uint32_t max_msg_size;
+	uint32_t cpu;
+};
+#define NEGOTIATE_REQUEST__INIT                                                \
+	{ PROTOBUF_C_MESSAGE_INIT(&negotiate_request__descriptor), 0, 0, 0 }
+
+/*
+ **
+ * @brief Response with the protocol parameters applied to the connection
+ * @param ret Return code (0 on success, < 0 on error)
+ * @param version Protocol version used by the server
+ * @param max_msg_size Maximum message size used by the server for responses
+ */
+struct NegotiateResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+	uint32_t version;
+	uint32_t max_msg_size;
+};
+#define NEGOTIATE_RESPONSE__INIT                                               \
+	{ PROTOBUF_C_MESSAGE_INIT(&negotiate_response__descriptor), 0, 0, 0 }
+
+/*
+ **
+ * @brief Request to stream random bytes
+ * @param len Number of random bytes to stream (0 streams until the client
+ *	      closes the connection)
+ * @param frame_size Maximum number of random bytes per frame (0 selects the
+ *		     server default)
+ */
+struct GetRandomStreamRequest {
+	ProtobufCMessage base;
+	uint64_t len;
+	uint32_t frame_size;
+};
+#define GET_RANDOM_STREAM_REQUEST__INIT                                        \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_random_stream_request__descriptor), 0,  \
+	  0 }
+
+/*
+ **
+ * @brief One frame of a random byte stream
+ * @param ret Return code (> 0 on success with the value indicating the number
+ *	      of random bytes in this frame, 0 marking the end of the stream,
+ *	      < 0 on error which terminates the stream)
+ * @param randval Random bytes
+ */
+struct GetRandomStreamResponse {
+	ProtobufCMessage base;
+	int64_t ret;
+	ProtobufCBinaryData randval;
+};
+#define GET_RANDOM_STREAM_RESPONSE__INIT                                       \
+	{ PROTOBUF_C_MESSAGE_INIT(&get_random_stream_response__descriptor), 0, \
+	  { 0, NULL } }
+
+/*
+ **
+ * @brief Request to get the binary status
+ * @param maxlen Maximum size of the status structure the caller can accept
+ */
+struct StatusBinRequest {
+	ProtobufCMessage base;
+	uint32_t maxlen;
+};
+#define STATUS_BIN_REQUEST__INIT                                               \
+	{ PROTOBUF_C_MESSAGE_INIT(&status_bin_request__descriptor), 0 }
+
+/*
+ **
+ * @brief Response to get the binary status
+ * @param ret Return code (0 on success, < 0 on error)
+ * @param status Binary status as struct esdm_status_bin
+ */
+struct StatusBinResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+	ProtobufCBinaryData status;
+};
+#define STATUS_BIN_RESPONSE__INIT                                              \
+	{ PROTOBUF_C_MESSAGE_INIT(&status_bin_response__descriptor), 0,        \
+	  { 0, NULL } }
+
+/*
+ **
+ * @brief Request to wait for a seed state of the ESDM
+ * @param states Seed states to wait for (ESDM_RPCC_SEED_* flags), all of them
+ *		 must be reached
+ * @param timeout_ms Maximum time in milliseconds the server waits
+ */
+struct WaitSeedStateRequest {
+	ProtobufCMessage base;
+	uint32_t states;
+	uint32_t timeout_ms;
+};
+#define WAIT_SEED_STATE_REQUEST__INIT                                          \
+	{ PROTOBUF_C_MESSAGE_INIT(&wait_seed_state_request__descriptor), 0, 0 }
+
+/*
+ **
+ * @brief Response to wait for a seed state
+ * @param ret Return code (0 if the states are reached, -ETIMEDOUT if the
+ *	      timeout expired, < 0 on other errors)
+ * @param states Current seed states of the ESDM
+ */
+struct WaitSeedStateResponse {
+	ProtobufCMessage base;
+	int32_t ret;
+	uint32_t states;
+};
+#define WAIT_SEED_STATE_RESPONSE__INIT                                         \
+	{ PROTOBUF_C_MESSAGE_INIT(&wait_seed_state_response__descriptor), 0,   \
+	  0 }
+
 /* StatusRequest methods */
 void status_request__init(StatusRequest *message);
 size_t status_request__get_packed_size(const StatusRequest *message);
@@ -897,6 +1143,188 @@ get_min_reseed_secs_response__unpack(ProtobufCAllocator *allocator, size_t len,
 				     const uint8_t *data);
 void get_min_reseed_secs_response__free_unpacked(
 	GetMinReseedSecsResponse *message, ProtobufCAllocator *allocator);
+/* GetRandomRingRequest methods */
+void get_random_ring_request__init(GetRandomRingRequest *message);
+size_t
+get_random_ring_request__get_packed_size(const GetRandomRingRequest *message);
+size_t get_random_ring_request__pack(const GetRandomRingRequest *message,
+				     uint8_t *out);
+size_t
+get_random_ring_request__pack_to_buffer(const GetRandomRingRequest *message,
+					ProtobufCBuffer *buffer);
+GetRandomRingRequest *
+get_random_ring_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data);
+void get_random_ring_request__free_unpacked(GetRandomRingRequest *message,
+					    ProtobufCAllocator *allocator);
+/* GetRandomRingResponse methods */
+void get_random_ring_response__init(GetRandomRingResponse *message);
+size_t
+get_random_ring_response__get_packed_size(const GetRandomRingResponse *message);
+size_t get_random_ring_response__pack(const GetRandomRingResponse *message,
+				      uint8_t *out);
+size_t
+get_random_ring_response__pack_to_buffer(const GetRandomRingResponse *message,
+					 ProtobufCBuffer *buffer);
+GetRandomRingResponse *
+get_random_ring_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				 const uint8_t *data);
+void get_random_ring_response__free_unpacked(GetRandomRingResponse *message,
+					     ProtobufCAllocator *allocator);
+/* GetLeaseSeedRequest methods */
+void get_lease_seed_request__init(GetLeaseSeedRequest *message);
+size_t
+get_lease_seed_request__get_packed_size(const GetLeaseSeedRequest *message);
+size_t get_lease_seed_request__pack(const GetLeaseSeedRequest *message,
+				    uint8_t *out);
+size_t
+get_lease_seed_request__pack_to_buffer(const GetLeaseSeedRequest *message,
+				       ProtobufCBuffer *buffer);
+GetLeaseSeedRequest *
+get_lease_seed_request__unpack(ProtobufCAllocator *allocator, size_t len,
+			       const uint8_t *data);
+void get_lease_seed_request__free_unpacked(GetLeaseSeedRequest *message,
+					   ProtobufCAllocator *allocator);
+/* GetLeaseSeedResponse methods */
+void get_lease_seed_response__init(GetLeaseSeedResponse *message);
+size_t
+get_lease_seed_response__get_packed_size(const GetLeaseSeedResponse *message);
+size_t get_lease_seed_response__pack(const GetLeaseSeedResponse *message,
+				     uint8_t *out);
+size_t
+get_lease_seed_response__pack_to_buffer(const GetLeaseSeedResponse *message,
+					ProtobufCBuffer *buffer);
+GetLeaseSeedResponse *
+get_lease_seed_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data);
+void get_lease_seed_response__free_unpacked(GetLeaseSeedResponse *message,
+					    ProtobufCAllocator *allocator);
+/* GetRandomBytesVecRequest methods */
+void get_random_bytes_vec_request__init(GetRandomBytesVecRequest *message);
+size_t get_random_bytes_vec_request__get_packed_size(
+	const GetRandomBytesVecRequest *message);
+size_t
+get_random_bytes_vec_request__pack(const GetRandomBytesVecRequest *message,
+				   uint8_t *out);
+size_t get_random_bytes_vec_request__pack_to_buffer(
+	const GetRandomBytesVecRequest *message, ProtobufCBuffer *buffer);
+GetRandomBytesVecRequest *
+get_random_bytes_vec_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				     const uint8_t *data);
+void
+get_random_bytes_vec_request__free_unpacked(GetRandomBytesVecRequest *message,
+					    ProtobufCAllocator *allocator);
+/* GetRandomBytesVecResponse methods */
+void get_random_bytes_vec_response__init(GetRandomBytesVecResponse *message);
+size_t get_random_bytes_vec_response__get_packed_size(
+	const GetRandomBytesVecResponse *message);
+size_t
+get_random_bytes_vec_response__pack(const GetRandomBytesVecResponse *message,
+				    uint8_t *out);
+size_t get_random_bytes_vec_response__pack_to_buffer(
+	const GetRandomBytesVecResponse *message, ProtobufCBuffer *buffer);
+GetRandomBytesVecResponse *
+get_random_bytes_vec_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				      const uint8_t *data);
+void
+get_random_bytes_vec_response__free_unpacked(GetRandomBytesVecResponse *message,
+					     ProtobufCAllocator *allocator);
+/* NegotiateRequest methods */
+void negotiate_request__init(NegotiateRequest *message);
+size_t negotiate_request__get_packed_size(const NegotiateRequest *message);
+size_t negotiate_request__pack(const NegotiateRequest *message, uint8_t *out);
+size_t negotiate_request__pack_to_buffer(const NegotiateRequest *message,
+					 ProtobufCBuffer *buffer);
+NegotiateRequest *negotiate_request__unpack(ProtobufCAllocator *allocator,
+					    size_t len, const uint8_t *data);
+void negotiate_request__free_unpacked(NegotiateRequest *message,
+				      ProtobufCAllocator *allocator);
+/* NegotiateResponse methods */
+void negotiate_response__init(NegotiateResponse *message);
+size_t negotiate_response__get_packed_size(const NegotiateResponse *message);
+size_t negotiate_response__pack(const NegotiateResponse *message, uint8_t *out);
+size_t negotiate_response__pack_to_buffer(const NegotiateResponse *message,
+					  ProtobufCBuffer *buffer);
+NegotiateResponse *negotiate_response__unpack(ProtobufCAllocator *allocator,
+					      size_t len, const uint8_t *data);
+void negotiate_response__free_unpacked(NegotiateResponse *message,
+				       ProtobufCAllocator *allocator);
+/* GetRandomStreamRequest methods */
+void get_random_stream_request__init(GetRandomStreamRequest *message);
+size_t get_random_stream_request__get_packed_size(
+	const GetRandomStreamRequest *message);
+size_t get_random_stream_request__pack(const GetRandomStreamRequest *message,
+				       uint8_t *out);
+size_t
+get_random_stream_request__pack_to_buffer(const GetRandomStreamRequest *message,
+					  ProtobufCBuffer *buffer);
+GetRandomStreamRequest *
+get_random_stream_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				  const uint8_t *data);
+void get_random_stream_request__free_unpacked(GetRandomStreamRequest *message,
+					      ProtobufCAllocator *allocator);
+/* GetRandomStreamResponse methods */
+void get_random_stream_response__init(GetRandomStreamResponse *message);
+size_t get_random_stream_response__get_packed_size(
+	const GetRandomStreamResponse *message);
+size_t get_random_stream_response__pack(const GetRandomStreamResponse *message,
+					uint8_t *out);
+size_t get_random_stream_response__pack_to_buffer(
+	const GetRandomStreamResponse *message, ProtobufCBuffer *buffer);
+GetRandomStreamResponse *
+get_random_stream_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				   const uint8_t *data);
+void get_random_stream_response__free_unpacked(GetRandomStreamResponse *message,
+					       ProtobufCAllocator *allocator);
+/* StatusBinRequest methods */
+void status_bin_request__init(StatusBinRequest *message);
+size_t status_bin_request__get_packed_size(const StatusBinRequest *message);
+size_t status_bin_request__pack(const StatusBinRequest *message, uint8_t *out);
+size_t status_bin_request__pack_to_buffer(const StatusBinRequest *message,
+					  ProtobufCBuffer *buffer);
+StatusBinRequest *status_bin_request__unpack(ProtobufCAllocator *allocator,
+					     size_t len, const uint8_t *data);
+void status_bin_request__free_unpacked(StatusBinRequest *message,
+				       ProtobufCAllocator *allocator);
+/* StatusBinResponse methods */
+void status_bin_response__init(StatusBinResponse *message);
+size_t status_bin_response__get_packed_size(const StatusBinResponse *message);
+size_t status_bin_response__pack(const StatusBinResponse *message,
+				 uint8_t *out);
+size_t status_bin_response__pack_to_buffer(const StatusBinResponse *message,
+					   ProtobufCBuffer *buffer);
+StatusBinResponse *status_bin_response__unpack(ProtobufCAllocator *allocator,
+					       size_t len, const uint8_t *data);
+void status_bin_response__free_unpacked(StatusBinResponse *message,
+					ProtobufCAllocator *allocator);
+/* WaitSeedStateRequest methods */
+void wait_seed_state_request__init(WaitSeedStateRequest *message);
+size_t
+wait_seed_state_request__get_packed_size(const WaitSeedStateRequest *message);
+size_t wait_seed_state_request__pack(const WaitSeedStateRequest *message,
+				     uint8_t *out);
+size_t
+wait_seed_state_request__pack_to_buffer(const WaitSeedStateRequest *message,
+					ProtobufCBuffer *buffer);
+WaitSeedStateRequest *
+wait_seed_state_request__unpack(ProtobufCAllocator *allocator, size_t len,
+				const uint8_t *data);
+void wait_seed_state_request__free_unpacked(WaitSeedStateRequest *message,
+					    ProtobufCAllocator *allocator);
+/* WaitSeedStateResponse methods */
+void wait_seed_state_response__init(WaitSeedStateResponse *message);
+size_t
+wait_seed_state_response__get_packed_size(const WaitSeedStateResponse *message);
+size_t wait_seed_state_response__pack(const WaitSeedStateResponse *message,
+				      uint8_t *out);
+size_t
+wait_seed_state_response__pack_to_buffer(const WaitSeedStateResponse *message,
+					 ProtobufCBuffer *buffer);
+WaitSeedStateResponse *
+wait_seed_state_response__unpack(ProtobufCAllocator *allocator, size_t len,
+				 const uint8_t *data);
+void wait_seed_state_response__free_unpacked(WaitSeedStateResponse *message,
+					     ProtobufCAllocator *allocator);
 /* --- per-message closures --- */
 
 typedef void (*StatusRequest_Closure)(const StatusRequest *message,
@@ -959,6 +1387,34 @@ typedef void (*GetMinReseedSecsRequest_Closure)(
 	const GetMinReseedSecsRequest *message, void *closure_data);
 typedef void (*GetMinReseedSecsResponse_Closure)(
 	const GetMinReseedSecsResponse *message, void *closure_data);
+typedef void (*GetRandomRingRequest_Closure)(
+	const GetRandomRingRequest *message, void *closure_data);
+typedef void (*GetRandomRingResponse_Closure)(
+	const GetRandomRingResponse *message, void *closure_data);
+typedef void (*GetLeaseSeedRequest_Closure)(const GetLeaseSeedRequest *message,
+					    void *closure_data);
+typedef void (*GetLeaseSeedResponse_Closure)(
+	const GetLeaseSeedResponse *message, void *closure_data);
+typedef void (*GetRandomBytesVecRequest_Closure)(
+	const GetRandomBytesVecRequest *message, void *closure_data);
+typedef void (*GetRandomBytesVecResponse_Closure)(
+	const GetRandomBytesVecResponse *message, void *closure_data);
+typedef void (*NegotiateRequest_Closure)(const NegotiateRequest *message,
+					 void *closure_data);
+typedef void (*NegotiateResponse_Closure)(const NegotiateResponse *message,
+					  void *closure_data);
+typedef void (*GetRandomStreamRequest_Closure)(
+	const GetRandomStreamRequest *message, void *closure_data);
+typedef void (*GetRandomStreamResponse_Closure)(
+	const GetRandomStreamResponse *message, void *closure_data);
+typedef void (*StatusBinRequest_Closure)(const StatusBinRequest *message,
+					 void *closure_data);
+typedef void (*StatusBinResponse_Closure)(const StatusBinResponse *message,
+					  void *closure_data);
+typedef void (*WaitSeedStateRequest_Closure)(
+	const WaitSeedStateRequest *message, void *closure_data);
+typedef void (*WaitSeedStateResponse_Closure)(
+	const WaitSeedStateResponse *message, void *closure_data);
 
 /* --- services --- */
 
@@ -1026,6 +1482,34 @@ struct UnprivAccess_Service {
 					const GetMinReseedSecsRequest *input,
 					GetMinReseedSecsResponse_Closure closure,
 					void *closure_data);
+	void (*rpc_get_random_ring)(UnprivAccess_Service *service,
+				    const GetRandomRingRequest *input,
+				    GetRandomRingResponse_Closure closure,
+				    void *closure_data);
+	void (*rpc_get_lease_seed)(UnprivAccess_Service *service,
+				   const GetLeaseSeedRequest *input,
+				   GetLeaseSeedResponse_Closure closure,
+				   void *closure_data);
+	void (*rpc_get_random_bytes_vec)(
+		UnprivAccess_Service *service,
+		const GetRandomBytesVecRequest *input,
+		GetRandomBytesVecResponse_Closure closure, void *closure_data);
+	void (*rpc_negotiate)(UnprivAccess_Service *service,
+			      const NegotiateRequest *input,
+			      NegotiateResponse_Closure closure,
+			      void *closure_data);
+	void (*rpc_get_random_stream)(UnprivAccess_Service *service,
+				      const GetRandomStreamRequest *input,
+				      GetRandomStreamResponse_Closure closure,
+				      void *closure_data);
+	void (*rpc_status_bin)(UnprivAccess_Service *service,
+			       const StatusBinRequest *input,
+			       StatusBinResponse_Closure closure,
+			       void *closure_data);
+	void (*rpc_wait_seed_state)(UnprivAccess_Service *service,
+				    const WaitSeedStateRequest *input,
+				    WaitSeedStateResponse_Closure closure,
+				    void *closure_data);
 };
 typedef void (*UnprivAccess_ServiceDestroy)(UnprivAccess_Service *);
 void unpriv_access__init(UnprivAccess_Service *service,
@@ -1048,7 +1532,14 @@ void unpriv_access__init(UnprivAccess_Service *service,
 	  function_prefix__##rpc_rnd_get_ent_cnt,                              \
 	  function_prefix__##rpc_get_poolsize,                                 \
 	  function_prefix__##rpc_get_write_wakeup_thresh,                      \
-	  function_prefix__##rpc_get_min_reseed_secs }
+	  function_prefix__##rpc_get_min_reseed_secs,                          \
+	  function_prefix__##rpc_get_random_ring,                              \
+	  function_prefix__##rpc_get_lease_seed,                               \
+	  function_prefix__##rpc_get_random_bytes_vec,                         \
+	  function_prefix__##rpc_negotiate,                                    \
+	  function_prefix__##rpc_get_random_stream,                            \
+	  function_prefix__##rpc_status_bin,                                   \
+	  function_prefix__##rpc_wait_seed_state }
 void unpriv_access__rpc_status(ProtobufCService *service,
 			       const StatusRequest *input,
 			       StatusResponse_Closure closure,
@@ -1104,6 +1595,34 @@ void unpriv_access__rpc_get_write_wakeup_thresh(
 void unpriv_access__rpc_get_min_reseed_secs(
 	ProtobufCService *service, const GetMinReseedSecsRequest *input,
 	GetMinReseedSecsResponse_Closure closure, void *closure_data);
+void unpriv_access__rpc_get_random_ring(ProtobufCService *service,
+					const GetRandomRingRequest *input,
+					GetRandomRingResponse_Closure closure,
+					void *closure_data);
+void unpriv_access__rpc_get_lease_seed(ProtobufCService *service,
+				       const GetLeaseSeedRequest *input,
+				       GetLeaseSeedResponse_Closure closure,
+				       void *closure_data);
+void unpriv_access__rpc_get_random_bytes_vec(
+	ProtobufCService *service, const GetRandomBytesVecRequest *input,
+	GetRandomBytesVecResponse_Closure closure, void *closure_data);
+void unpriv_access__rpc_negotiate(ProtobufCService *service,
+				  const NegotiateRequest *input,
+				  NegotiateResponse_Closure closure,
+				  void *closure_data);
+void
+unpriv_access__rpc_get_random_stream(ProtobufCService *service,
+				     const GetRandomStreamRequest *input,
+				     GetRandomStreamResponse_Closure closure,
+				     void *closure_data);
+void unpriv_access__rpc_status_bin(ProtobufCService *service,
+				   const StatusBinRequest *input,
+				   StatusBinResponse_Closure closure,
+				   void *closure_data);
+void unpriv_access__rpc_wait_seed_state(ProtobufCService *service,
+					const WaitSeedStateRequest *input,
+					WaitSeedStateResponse_Closure closure,
+					void *closure_data);
 
 /* --- descriptors --- */
 
@@ -1144,6 +1663,22 @@ extern const ProtobufCMessageDescriptor
 	get_write_wakeup_thresh_response__descriptor;
 extern const ProtobufCMessageDescriptor get_min_reseed_secs_request__descriptor;
 extern const ProtobufCMessageDescriptor get_min_reseed_secs_response__descriptor;
+extern const ProtobufCMessageDescriptor get_random_ring_request__descriptor;
+extern const ProtobufCMessageDescriptor get_random_ring_response__descriptor;
+extern const ProtobufCMessageDescriptor get_lease_seed_request__descriptor;
+extern const ProtobufCMessageDescriptor get_lease_seed_response__descriptor;
+extern const ProtobufCMessageDescriptor
+	get_random_bytes_vec_request__descriptor;
+extern const ProtobufCMessageDescriptor
+	get_random_bytes_vec_response__descriptor;
+extern const ProtobufCMessageDescriptor negotiate_request__descriptor;
+extern const ProtobufCMessageDescriptor negotiate_response__descriptor;
+extern const ProtobufCMessageDescriptor get_random_stream_request__descriptor;
+extern const ProtobufCMessageDescriptor get_random_stream_response__descriptor;
+extern const ProtobufCMessageDescriptor status_bin_request__descriptor;
+extern const ProtobufCMessageDescriptor status_bin_response__descriptor;
+extern const ProtobufCMessageDescriptor wait_seed_state_request__descriptor;
+extern const ProtobufCMessageDescriptor wait_seed_state_response__descriptor;
 extern const ProtobufCServiceDescriptor unpriv_access__descriptor;
 
 PROTOBUF_C__END_DECLS
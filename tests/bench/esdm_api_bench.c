@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "esdm.h"
+#include "esdm_bench.h"
+
+/* In-process ESDM API including the DRNG manager */
+
+static int esdm_api_bench_generate(void *ctx, uint8_t *buf, size_t len)
+{
+	(void)ctx;
+
+	while (len) {
+		ssize_t ret = esdm_get_random_bytes(buf, len);
+
+		if (ret <= 0)
+			return ret < 0 ? (int)ret : -EFAULT;
+
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct esdm_bench_layer layer = {
+		.name = "esdm_get_random_bytes",
+		.generate = esdm_api_bench_generate,
+	};
+	uint8_t buf[32];
+	int ret;
+
+#ifndef ESDM_TESTMODE
+	if (getuid()) {
+		printf("Program must be started as root\n");
+		return 77;
+	}
+#endif
+
+	ret = esdm_init();
+	if (ret)
+		return 1;
+
+	/* Measure the fully seeded operation only */
+	if (esdm_get_random_bytes_full(buf, sizeof(buf)) < 0) {
+		ret = 1;
+		goto out;
+	}
+
+	ret = esdm_bench_run(&layer, argc, argv) ? 1 : 0;
+
+out:
+	esdm_fini();
+	return ret;
+}
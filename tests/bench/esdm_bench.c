@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esdm_bench.h"
+#include "helper.h"
+
+/*
+ * Every measurement runs the given number of threads for a fixed duration.
+ * All threads are released together and stop at the same time, the result is
+ * the aggregate over all threads.
+ */
+
+#define ESDM_BENCH_MAX_SIZE (1UL << 20)
+#define ESDM_BENCH_MAX_THREADS 64
+
+static const size_t esdm_bench_sizes[] = {
+	8, 64, 512, 4096, 32768, 262144, ESDM_BENCH_MAX_SIZE
+};
+
+struct esdm_bench_sync {
+	unsigned int ready;
+	int go;
+	int stop;
+};
+
+struct esdm_bench_thread {
+	const struct esdm_bench_layer *layer;
+	struct esdm_bench_sync *sync;
+	size_t reqsize;
+	uint64_t requests;
+	int ret;
+};
+
+static uint64_t esdm_bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *esdm_bench_thread(void *arg)
+{
+	struct esdm_bench_thread *t = arg;
+	const struct esdm_bench_layer *layer = t->layer;
+	void *ctx = NULL;
+	uint8_t *buf;
+	int init = 0;
+
+	buf = malloc(t->reqsize);
+	if (!buf)
+		t->ret = -ENOMEM;
+	else if (layer->thread_init)
+		t->ret = layer->thread_init(&ctx);
+	init = !t->ret;
+
+	/* Wait until all threads are set up */
+	__atomic_add_fetch(&t->sync->ready, 1, __ATOMIC_RELEASE);
+	while (!__atomic_load_n(&t->sync->go, __ATOMIC_ACQUIRE))
+		sched_yield();
+
+	while (!t->ret && !__atomic_load_n(&t->sync->stop, __ATOMIC_RELAXED)) {
+		t->ret = layer->generate(ctx, buf, t->reqsize);
+		if (!t->ret)
+			t->requests++;
+	}
+
+	if (init && layer->thread_fini)
+		layer->thread_fini(ctx);
+	free(buf);
+
+	return NULL;
+}
+
+static int esdm_bench_one(const struct esdm_bench_layer *layer,
+			  size_t reqsize, unsigned int threads,
+			  unsigned long duration_ms, int first)
+{
+	struct esdm_bench_thread t[ESDM_BENCH_MAX_THREADS];
+	pthread_t tid[ESDM_BENCH_MAX_THREADS];
+	struct timespec ts = { .tv_sec = (time_t)(duration_ms / 1000),
+			       .tv_nsec = (long)(duration_ms % 1000) *
+					  1000000L };
+	struct esdm_bench_sync sync = { 0 };
+	uint64_t start, ns, requests = 0;
+	unsigned int i, started = 0;
+	int ret = 0;
+
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < threads; i++) {
+		t[i].layer = layer;
+		t[i].sync = &sync;
+		t[i].reqsize = reqsize;
+		if (pthread_create(&tid[i], NULL, esdm_bench_thread, &t[i])) {
+			ret = -EFAULT;
+			break;
+		}
+		started++;
+	}
+
+	while (__atomic_load_n(&sync.ready, __ATOMIC_ACQUIRE) < started)
+		sched_yield();
+
+	/* Do not measure if not all threads could be started */
+	if (ret)
+		__atomic_store_n(&sync.stop, 1, __ATOMIC_RELAXED);
+
+	start = esdm_bench_ns();
+	__atomic_store_n(&sync.go, 1, __ATOMIC_RELEASE);
+	if (!ret)
+		nanosleep(&ts, NULL);
+	__atomic_store_n(&sync.stop, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < started; i++)
+		pthread_join(tid[i], NULL);
+	ns = esdm_bench_ns() - start;
+
+	for (i = 0; i < started; i++) {
+		if (t[i].ret && !ret)
+			ret = t[i].ret;
+		requests += t[i].requests;
+	}
+
+	if (ret) {
+		fprintf(stderr, "%s: %zu bytes, %u threads failed: %d\n",
+			layer->name, reqsize, threads, ret);
+		return ret;
+	}
+	if (!ns)
+		ns = 1;
+
+	printf("%s\n    { \"size\": %zu, \"threads\": %u, \"requests\": %llu, "
+	       "\"bytes\": %llu, \"ns\": %llu, \"ns_per_request\": %llu, "
+	       "\"mib_per_sec\": %.2f }",
+	       first ? "" : ",", reqsize, threads,
+	       (unsigned long long)requests,
+	       (unsigned long long)(requests * reqsize),
+	       (unsigned long long)ns,
+	       (unsigned long long)(requests ? ns * threads / requests : 0),
+	       ((double)requests * (double)reqsize * 1e9) /
+		       ((double)ns * 1048576.0));
+	fflush(stdout);
+
+	fprintf(stderr, "%s: %7zu bytes, %2u threads: %llu requests\n",
+		layer->name, reqsize, threads, (unsigned long long)requests);
+
+	return 0;
+}
+
+int esdm_bench_run(const struct esdm_bench_layer *layer, int argc,
+		   char *argv[])
+{
+	unsigned long max_threads = 8, duration_ms = 250;
+	size_t max_size = ESDM_BENCH_MAX_SIZE, i;
+	unsigned int threads;
+	int first = 1, opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "t:m:d:")) != -1) {
+		switch (opt) {
+		case 't':
+			max_threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'm':
+			max_size = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			duration_ms = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-t threads] [-m size] [-d msec]\n",
+				argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	if (!max_threads || max_threads > ESDM_BENCH_MAX_THREADS ||
+	    max_size < esdm_bench_sizes[0] || !duration_ms)
+		return -EINVAL;
+
+	printf("{\n  \"benchmark\": \"%s\",\n  \"duration_ms\": %lu,\n"
+	       "  \"results\": [",
+	       layer->name, duration_ms);
+
+	for (i = 0; i < ARRAY_SIZE(esdm_bench_sizes); i++) {
+		if (esdm_bench_sizes[i] > max_size)
+			break;
+
+		for (threads = 1; threads <= max_threads; threads <<= 1) {
+			ret = esdm_bench_one(layer, esdm_bench_sizes[i],
+					     threads, duration_ms, first);
+			if (ret)
+				goto out;
+			first = 0;
+		}
+	}
+
+out:
+	printf("\n  ],\n  \"status\": %d\n}\n", ret);
+	return ret;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#ifndef ESDM_BENCH_H
+#define ESDM_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * One layer of the ESDM to be benchmarked. The thread_init and thread_fini
+ * callbacks are optional and allow a per-thread state, e.g. a DRNG instance
+ * or an open file descriptor.
+ */
+struct esdm_bench_layer {
+	const char *name;
+	int (*thread_init)(void **ctx);
+	void (*thread_fini)(void *ctx);
+
+	/* Fill the entire buffer, return 0 on success or -errno */
+	int (*generate)(void *ctx, uint8_t *buf, size_t len);
+};
+
+/**
+ * @brief Benchmark the layer for all request sizes and thread counts
+ *
+ * The results are written as a JSON document to stdout, progress and errors
+ * are written to stderr. The following options are supported:
+ *
+ *	-t <num>	maximum number of threads (default 8)
+ *	-m <bytes>	maximum request size (default 1 MiB)
+ *	-d <msec>	duration of each measurement (default 250)
+ *
+ * @param [in] layer Layer to benchmark
+ * @param [in] argc Argument count of the benchmark program
+ * @param [in] argv Arguments of the benchmark program
+ *
+ * @return 0 on success, < 0 on error
+ */
+int esdm_bench_run(const struct esdm_bench_layer *layer, int argc,
+		   char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDM_BENCH_H */
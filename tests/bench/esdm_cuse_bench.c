@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "env.h"
+#include "esdm_bench.h"
+
+/* CUSE device file /dev/urandom provided by the ESDM */
+
+static char esdm_cuse_bench_devfile[20];
+
+static int esdm_cuse_bench_init(void **ctx)
+{
+	int *fd = malloc(sizeof(*fd));
+
+	if (!fd)
+		return -ENOMEM;
+
+	*fd = open(esdm_cuse_bench_devfile, O_RDONLY | O_CLOEXEC);
+	if (*fd < 0) {
+		int ret = -errno;
+
+		free(fd);
+		return ret;
+	}
+
+	*ctx = fd;
+	return 0;
+}
+
+static void esdm_cuse_bench_fini(void *ctx)
+{
+	int *fd = ctx;
+
+	close(*fd);
+	free(fd);
+}
+
+static int esdm_cuse_bench_generate(void *ctx, uint8_t *buf, size_t len)
+{
+	int *fd = ctx;
+
+	while (len) {
+		ssize_t ret = read(*fd, buf, len);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (!ret)
+			return -EFAULT;
+
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct esdm_bench_layer layer = {
+		.name = "cuse_urandom",
+		.thread_init = esdm_cuse_bench_init,
+		.thread_fini = esdm_cuse_bench_fini,
+		.generate = esdm_cuse_bench_generate,
+	};
+	int ret;
+
+	esdm_cuse_dev_file(esdm_cuse_bench_devfile,
+			   sizeof(esdm_cuse_bench_devfile), "urandom");
+
+	ret = env_init(1);
+	if (ret)
+		return ret;
+
+	ret = esdm_bench_run(&layer, argc, argv) ? 1 : 0;
+
+	env_fini();
+	return ret;
+}
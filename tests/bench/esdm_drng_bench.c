@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "esdm_bench.h"
+#include "esdm_crypto.h"
+#include "esdm_definitions.h"
+#include "esdm_drng_mgr.h"
+#include "math_helper.h"
+
+/*
+ * Raw DRNG of the selected crypto backend without the DRNG manager. Every
+ * thread uses its own DRNG instance seeded with a static seed, requests are
+ * split into chunks of the default maximum request size of the DRNG manager.
+ */
+
+static int esdm_drng_bench_init(void **ctx)
+{
+	const struct esdm_drng_cb *drng_cb = esdm_default_drng_cb;
+	uint8_t seed[ESDM_DRNG_SECURITY_STRENGTH_BYTES * 2];
+	void *drng = NULL;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < sizeof(seed); i++)
+		seed[i] = (uint8_t)i;
+
+	ret = drng_cb->drng_alloc(&drng, ESDM_DRNG_SECURITY_STRENGTH_BITS);
+	if (ret)
+		return ret;
+
+	ret = drng_cb->drng_seed(drng, seed, sizeof(seed));
+	if (ret) {
+		drng_cb->drng_dealloc(drng);
+		return ret;
+	}
+
+	*ctx = drng;
+	return 0;
+}
+
+static void esdm_drng_bench_fini(void *ctx)
+{
+	esdm_default_drng_cb->drng_dealloc(ctx);
+}
+
+static int esdm_drng_bench_generate(void *ctx, uint8_t *buf, size_t len)
+{
+	const struct esdm_drng_cb *drng_cb = esdm_default_drng_cb;
+
+	while (len) {
+		size_t todo = min_size(len, ESDM_DRNG_MAX_REQSIZE);
+		ssize_t ret = drng_cb->drng_generate(ctx, buf, todo);
+
+		if (ret != (ssize_t)todo)
+			return ret < 0 ? (int)ret : -EFAULT;
+
+		buf += todo;
+		len -= todo;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static struct esdm_bench_layer layer = {
+		.thread_init = esdm_drng_bench_init,
+		.thread_fini = esdm_drng_bench_fini,
+		.generate = esdm_drng_bench_generate,
+	};
+
+	layer.name = esdm_default_drng_cb->drng_name();
+
+	return esdm_bench_run(&layer, argc, argv) ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+
+#include "env.h"
+#include "esdm_bench.h"
+#include "getrandom.h"
+
+/*
+ * getrandom system call which is redirected to the ESDM with the preloaded
+ * libesdm_getrandom.
+ */
+
+static int esdm_getrandom_bench_generate(void *ctx, uint8_t *buf, size_t len)
+{
+	(void)ctx;
+
+	while (len) {
+		ssize_t ret = getrandom_urandom(buf, len);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (!ret)
+			return -EFAULT;
+
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct esdm_bench_layer layer = {
+		.name = "libesdm_getrandom",
+		.generate = esdm_getrandom_bench_generate,
+	};
+	int ret;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	ret = esdm_bench_run(&layer, argc, argv) ? 1 : 0;
+
+	env_fini();
+	return ret;
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "env.h"
+#include "esdm_rpc_client.h"
+
+/*
+ * Tail latency of ordinary requests while reseeds are forced
+ *
+ * The load threads issue esdm_rpcc_get_random_bytes_full requests back to
+ * back. Every scenario runs for the same duration:
+ *
+ *	baseline	load only
+ *	reseed		esdm_rpcc_rnd_reseed_crng is called at a fixed interval
+ *	reseed_pr	additionally, one thread issues prediction resistance
+ *			requests which each require a seed from the ES
+ *
+ * Only the latency of the load threads is reported. The scenarios are most
+ * telling for a server built with a slow entropy source, e.g. the synthetic
+ * ES of the test mode (-Des_synth=enabled -Des_synth_latency_us=<usec>), and
+ * a low reseed threshold (-Ddrng_reseed_threshold_bits=<bits>) which lets
+ * the ordinary requests trigger reseeds as well. The results are written as a
+ * JSON document to stdout. The following options are supported:
+ *
+ *	-t <num>	number of load threads (default 4)
+ *	-s <bytes>	request size (default 32)
+ *	-d <msec>	duration of each scenario (default 2000)
+ *	-r <msec>	interval of the forced reseeds (default 10)
+ */
+
+#define ESDM_RESEED_BENCH_MAX_THREADS 64
+#define ESDM_RESEED_BENCH_MAX_SIZE 4096
+
+/*
+ * Log-linear latency histogram in nanoseconds: 16 buckets per power of two,
+ * i.e. the relative error of a reported value is at most 6.25%
+ */
+#define RB_SUB_BITS 4
+#define RB_SUB (1U << RB_SUB_BITS)
+#define RB_MAX_EXP 36
+#define RB_BUCKETS ((RB_MAX_EXP - RB_SUB_BITS + 2) * RB_SUB)
+
+struct rb_hist {
+	uint64_t count[RB_BUCKETS];
+	uint64_t max;
+};
+
+enum rb_scenario {
+	rb_baseline,
+	rb_reseed,
+	rb_reseed_pr,
+	rb_scenarios,
+};
+
+static const char *const rb_names[rb_scenarios] = {
+	[rb_baseline] = "baseline",
+	[rb_reseed] = "reseed",
+	[rb_reseed_pr] = "reseed_pr",
+};
+
+struct rb_sync {
+	unsigned int ready;
+	int go;
+	int stop;
+};
+
+struct rb_thread {
+	struct rb_sync *sync;
+	struct rb_hist hist;
+	size_t reqsize;
+	uint64_t requests;
+	unsigned long interval_ms;
+	int ret;
+};
+
+static uint64_t rb_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned int rb_bucket(uint64_t ns)
+{
+	unsigned int e;
+
+	if (ns < RB_SUB)
+		return (unsigned int)ns;
+
+	e = 63 - (unsigned int)__builtin_clzll(ns);
+	if (e > RB_MAX_EXP)
+		return RB_BUCKETS - 1;
+
+	return (e - RB_SUB_BITS + 1) * RB_SUB +
+	       (unsigned int)((ns >> (e - RB_SUB_BITS)) & (RB_SUB - 1));
+}
+
+/* Largest value accounted to the bucket */
+static uint64_t rb_bucket_value(unsigned int idx)
+{
+	unsigned int shift;
+
+	if (idx < RB_SUB)
+		return idx;
+
+	shift = idx / RB_SUB - 1;
+	return ((uint64_t)(RB_SUB + idx % RB_SUB + 1) << shift) - 1;
+}
+
+static void rb_hist_merge(struct rb_hist *dst, const struct rb_hist *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < RB_BUCKETS; i++)
+		dst->count[i] += src->count[i];
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+static uint64_t rb_hist_quantile(const struct rb_hist *hist, uint64_t total,
+				 unsigned int permille)
+{
+	uint64_t rank, sum = 0, val;
+	unsigned int i;
+
+	if (!total)
+		return 0;
+
+	rank = (total * permille + 999) / 1000;
+	if (!rank)
+		rank = 1;
+
+	for (i = 0; i < RB_BUCKETS - 1; i++) {
+		sum += hist->count[i];
+		if (sum >= rank)
+			break;
+	}
+
+	val = rb_bucket_value(i);
+	return val < hist->max ? val : hist->max;
+}
+
+static void rb_wait_go(struct rb_sync *sync)
+{
+	__atomic_add_fetch(&sync->ready, 1, __ATOMIC_RELEASE);
+	while (!__atomic_load_n(&sync->go, __ATOMIC_ACQUIRE))
+		sched_yield();
+}
+
+static void *rb_load_thread(void *arg)
+{
+	struct rb_thread *t = arg;
+	uint8_t buf[ESDM_RESEED_BENCH_MAX_SIZE];
+
+	rb_wait_go(t->sync);
+
+	while (!__atomic_load_n(&t->sync->stop, __ATOMIC_RELAXED)) {
+		uint64_t start = rb_now(), ns;
+		ssize_t ret = esdm_rpcc_get_random_bytes_full(buf, t->reqsize);
+
+		if (ret != (ssize_t)t->reqsize) {
+			t->ret = ret < 0 ? (int)ret : -EFAULT;
+			break;
+		}
+
+		ns = rb_now() - start;
+		t->hist.count[rb_bucket(ns)]++;
+		if (ns > t->hist.max)
+			t->hist.max = ns;
+		t->requests++;
+	}
+
+	return NULL;
+}
+
+static void *rb_reseed_thread(void *arg)
+{
+	struct rb_thread *t = arg;
+	struct timespec ts = { .tv_sec = (time_t)(t->interval_ms / 1000),
+			       .tv_nsec = (long)(t->interval_ms % 1000) *
+					  1000000L };
+
+	rb_wait_go(t->sync);
+
+	while (!__atomic_load_n(&t->sync->stop, __ATOMIC_RELAXED)) {
+		t->ret = esdm_rpcc_rnd_reseed_crng();
+		if (t->ret)
+			break;
+		t->requests++;
+		nanosleep(&ts, NULL);
+	}
+
+	return NULL;
+}
+
+static void *rb_pr_thread(void *arg)
+{
+	struct rb_thread *t = arg;
+	uint8_t buf[ESDM_RESEED_BENCH_MAX_SIZE];
+
+	rb_wait_go(t->sync);
+
+	while (!__atomic_load_n(&t->sync->stop, __ATOMIC_RELAXED)) {
+		ssize_t ret = esdm_rpcc_get_random_bytes_pr(buf, t->reqsize);
+
+		/* A PR request may deliver less data than requested */
+		if (ret < 0) {
+			t->ret = (int)ret;
+			break;
+		}
+		t->requests++;
+	}
+
+	return NULL;
+}
+
+static int rb_run(enum rb_scenario scenario, unsigned int threads,
+		  size_t reqsize, unsigned long duration_ms,
+		  unsigned long interval_ms)
+{
+	struct rb_thread t[ESDM_RESEED_BENCH_MAX_THREADS + 2];
+	pthread_t tid[ESDM_RESEED_BENCH_MAX_THREADS + 2];
+	struct timespec ts = { .tv_sec = (time_t)(duration_ms / 1000),
+			       .tv_nsec = (long)(duration_ms % 1000) *
+					  1000000L };
+	struct rb_sync sync = { 0 };
+	struct rb_hist hist;
+	uint64_t requests = 0, reseeds = 0, pr_requests = 0;
+	unsigned int i, started = 0, helpers = 0;
+	int ret = 0;
+
+	memset(t, 0, sizeof(t));
+	memset(&hist, 0, sizeof(hist));
+
+	if (scenario >= rb_reseed)
+		helpers++;
+	if (scenario >= rb_reseed_pr)
+		helpers++;
+
+	for (i = 0; i < threads + helpers; i++) {
+		void *(*fn)(void *) = rb_load_thread;
+
+		if (i == threads)
+			fn = rb_reseed_thread;
+		else if (i > threads)
+			fn = rb_pr_thread;
+
+		t[i].sync = &sync;
+		t[i].reqsize = reqsize;
+		t[i].interval_ms = interval_ms;
+		if (pthread_create(&tid[i], NULL, fn, &t[i])) {
+			ret = -EFAULT;
+			break;
+		}
+		started++;
+	}
+
+	while (__atomic_load_n(&sync.ready, __ATOMIC_ACQUIRE) < started)
+		sched_yield();
+
+	__atomic_store_n(&sync.go, 1, __ATOMIC_RELEASE);
+	if (!ret)
+		nanosleep(&ts, NULL);
+	__atomic_store_n(&sync.stop, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < started; i++)
+		pthread_join(tid[i], NULL);
+
+	for (i = 0; i < started; i++) {
+		if (t[i].ret && !ret)
+			ret = t[i].ret;
+
+		if (i < threads) {
+			rb_hist_merge(&hist, &t[i].hist);
+			requests += t[i].requests;
+		} else if (i == threads) {
+			reseeds = t[i].requests;
+		} else {
+			pr_requests = t[i].requests;
+		}
+	}
+
+	if (ret) {
+		fprintf(stderr, "%s: %u threads failed: %d\n",
+			rb_names[scenario], threads, ret);
+		return ret;
+	}
+
+	printf("%s\n    { \"scenario\": \"%s\", \"requests\": %llu, "
+	       "\"reseeds\": %llu, \"pr_requests\": %llu, "
+	       "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, "
+	       "\"max_ns\": %llu }",
+	       scenario == rb_baseline ? "" : ",", rb_names[scenario],
+	       (unsigned long long)requests, (unsigned long long)reseeds,
+	       (unsigned long long)pr_requests,
+	       (unsigned long long)rb_hist_quantile(&hist, requests, 500),
+	       (unsigned long long)rb_hist_quantile(&hist, requests, 990),
+	       (unsigned long long)rb_hist_quantile(&hist, requests, 999),
+	       (unsigned long long)hist.max);
+	fflush(stdout);
+
+	fprintf(stderr, "%s: %llu requests, %llu reseeds\n",
+		rb_names[scenario], (unsigned long long)requests,
+		(unsigned long long)reseeds);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long threads = 4, duration_ms = 2000, interval_ms = 10;
+	size_t reqsize = 32;
+	unsigned int i;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "t:s:d:r:")) != -1) {
+		switch (opt) {
+		case 't':
+			threads = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			reqsize = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			duration_ms = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			interval_ms = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-t threads] [-s size] [-d msec] [-r msec]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (!threads || threads > ESDM_RESEED_BENCH_MAX_THREADS || !reqsize ||
+	    reqsize > ESDM_RESEED_BENCH_MAX_SIZE || !duration_ms)
+		return 1;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	if (esdm_rpcc_init_unpriv_service(NULL)) {
+		ret = 1;
+		goto out;
+	}
+	if (esdm_rpcc_init_priv_service(NULL)) {
+		ret = 1;
+		goto out_unpriv;
+	}
+
+	printf("{\n  \"benchmark\": \"reseed tail latency\",\n"
+	       "  \"threads\": %lu,\n  \"size\": %zu,\n"
+	       "  \"duration_ms\": %lu,\n  \"reseed_interval_ms\": %lu,\n"
+	       "  \"results\": [",
+	       threads, reqsize, duration_ms, interval_ms);
+
+	for (i = 0; i < rb_scenarios; i++) {
+		ret = rb_run((enum rb_scenario)i, (unsigned int)threads,
+			     reqsize, duration_ms, interval_ms);
+		if (ret)
+			break;
+	}
+
+	printf("\n  ],\n  \"status\": %d\n}\n", ret);
+	ret = ret ? 1 : 0;
+
+	esdm_rpcc_fini_priv_service();
+out_unpriv:
+	esdm_rpcc_fini_unpriv_service();
+out:
+	env_fini();
+	return ret;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "env.h"
+#include "esdm_bench.h"
+#include "esdm_rpc_client.h"
+
+/* Unprivileged RPC interface of the ESDM server */
+
+static int esdm_rpc_bench_generate(void *ctx, uint8_t *buf, size_t len)
+{
+	ssize_t ret;
+
+	(void)ctx;
+
+	ret = esdm_rpcc_get_random_bytes_full(buf, len);
+	if (ret != (ssize_t)len)
+		return ret < 0 ? (int)ret : -EFAULT;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct esdm_bench_layer layer = {
+		.name = "esdm_rpcc_get_random_bytes_full",
+		.generate = esdm_rpc_bench_generate,
+	};
+	int ret;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret) {
+		ret = 1;
+		goto out;
+	}
+
+	ret = esdm_bench_run(&layer, argc, argv) ? 1 : 0;
+
+	esdm_rpcc_fini_unpriv_service();
+
+out:
+	env_fini();
+	return ret;
+}
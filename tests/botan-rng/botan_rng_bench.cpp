@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2023 - 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "botan-rng.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "env.h"
+
+// number and size of the requests, typical for Botan's nonce generation
+static constexpr size_t bench_rounds = 20000;
+static constexpr size_t bench_reqsize = 32;
+static constexpr size_t bench_threads = 4;
+
+static bool bench_run(Botan::RandomNumberGenerator &rng, double &seconds)
+{
+	std::vector<uint8_t> bytes(bench_reqsize);
+	const std::vector<uint8_t> input = { 0x01, 0x02, 0x03, 0x04 };
+	auto start = std::chrono::steady_clock::now();
+
+	try {
+		for (size_t i = 0; i < bench_rounds; i++) {
+			if (i % 16)
+				rng.randomize(bytes);
+			else
+				rng.randomize_with_input(bytes, input);
+		}
+	} catch (const Botan::System_Error &err) {
+		std::cerr << "Got Botan error: " << err.what() << std::endl;
+		return false;
+	}
+
+	seconds = std::chrono::duration<double>(
+			  std::chrono::steady_clock::now() - start)
+			  .count();
+	return true;
+}
+
+static void bench_print(const std::string &name, size_t threads,
+			double seconds)
+{
+	std::cout << name << " (" << threads << " thread(s)): "
+		  << static_cast<double>(bench_rounds * threads) / seconds
+		  << " requests/s of " << bench_reqsize << " bytes"
+		  << std::endl;
+}
+
+static bool bench_threaded(ESDM_RNG &rng, double &seconds)
+{
+	std::vector<std::thread> threads;
+	// no std::vector<bool>: its elements must be written concurrently
+	std::vector<int> results(bench_threads, 0);
+	std::vector<double> tmp(bench_threads, 0);
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < bench_threads; i++)
+		threads.emplace_back(
+			[&, i]() { results[i] = bench_run(rng, tmp[i]); });
+	for (auto &t : threads)
+		t.join();
+
+	seconds = std::chrono::duration<double>(
+			  std::chrono::steady_clock::now() - start)
+			  .count();
+
+	for (size_t i = 0; i < bench_threads; i++) {
+		if (!results[i])
+			return false;
+	}
+	return true;
+}
+
+int main(void)
+{
+	double direct, derived, direct_mt, derived_mt;
+	int ret = env_init();
+	if (ret)
+		return ret;
+
+	try {
+		ESDM_RNG rng_direct(false);
+		ESDM_RNG rng_derived(false, true);
+		std::vector<uint8_t> a(bench_reqsize), b(bench_reqsize);
+
+		if (rng_derived.name() != "esdm_derived")
+			goto out_err;
+
+		// consecutive outputs of the derived mode must differ
+		rng_derived.randomize(a);
+		rng_derived.randomize(b);
+		if (a == b)
+			goto out_err;
+
+		if (!bench_run(rng_direct, direct) ||
+		    !bench_run(rng_derived, derived) ||
+		    !bench_threaded(rng_direct, direct_mt) ||
+		    !bench_threaded(rng_derived, derived_mt))
+			goto out_err;
+	} catch (const Botan::System_Error &err) {
+		std::cerr << "Cannot initialize ESDM connection" << std::endl;
+		goto out_err;
+	}
+
+	bench_print("direct", 1, direct);
+	bench_print("derived", 1, derived);
+	bench_print("direct", bench_threads, direct_mt);
+	bench_print("derived", bench_threads, derived_mt);
+	std::cout << "derived speedup: " << direct / derived << std::endl;
+
+	env_fini();
+	return EXIT_SUCCESS;
+
+out_err:
+	env_fini();
+	return EXIT_FAILURE;
+}
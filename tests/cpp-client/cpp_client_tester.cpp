@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sys/wait.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#include "env.h"
+#include "esdm-cpp.hpp"
+
+static bool all_zero(const uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (buf[i])
+			return false;
+	}
+
+	return true;
+}
+
+static bool test_distribution(void)
+{
+	std::uniform_int_distribution<unsigned int> dist(0, 5);
+	esdm::engine &e = esdm::engine::instance();
+	unsigned int hits[6] = { 0 };
+
+	for (unsigned int i = 0; i < 60000; i++)
+		hits[dist(e)]++;
+
+	for (unsigned int i = 0; i < 6; i++) {
+		if (hits[i] < 9000 || hits[i] > 11000) {
+			std::cerr << "Unexpected distribution: " << i << ": "
+				  << hits[i] << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_fill(void)
+{
+	std::vector<uint8_t> small(100), large(3 * esdm::engine::buffer_size);
+	esdm::engine e;
+	auto fixed = e.fill<32>();
+
+	e.fill(small);
+	e.fill(large);
+	esdm::fill(small);
+	esdm::fill_pr(small);
+
+	if (all_zero(fixed.data(), fixed.size()) ||
+	    all_zero(small.data(), small.size()) ||
+	    all_zero(large.data(), large.size())) {
+		std::cerr << "Buffer not filled" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// the child must not obtain the buffered bytes of its parent
+static bool test_fork(void)
+{
+	esdm::engine &e = esdm::engine::instance();
+	std::array<uint8_t, 16> parent, child;
+	int fds[2], status;
+	pid_t pid;
+
+	/* Make sure the buffer holds data */
+	(void)e();
+
+	if (pipe(fds))
+		return false;
+
+	pid = fork();
+	if (pid < 0)
+		return false;
+
+	if (pid == 0) {
+		child = e.fill<16>();
+		if (write(fds[1], child.data(), child.size()) !=
+		    static_cast<ssize_t>(child.size()))
+			_exit(EXIT_FAILURE);
+		_exit(EXIT_SUCCESS);
+	}
+
+	parent = e.fill<16>();
+	if (read(fds[0], child.data(), child.size()) !=
+	    static_cast<ssize_t>(child.size()))
+		return false;
+	close(fds[0]);
+	close(fds[1]);
+
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != EXIT_SUCCESS)
+		return false;
+
+	if (!memcmp(parent.data(), child.data(), parent.size())) {
+		std::cerr << "Child obtained the data of its parent"
+			  << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	int ret = env_init();
+	if (ret)
+		return ret;
+
+	try {
+		if (!test_distribution() || !test_fill() || !test_fork())
+			goto out_err;
+	} catch (const std::system_error &err) {
+		std::cerr << "ESDM did not deliver random bits: " << err.what()
+			  << std::endl;
+		goto out_err;
+	}
+
+	env_fini();
+	return EXIT_SUCCESS;
+
+out_err:
+	env_fini();
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lc_chacha20.h"
+#include "lc_chacha20_drng.h"
+#include "lc_chacha20_private.h"
+
+#define CC20_TEST_BLOCKS 67
+
+/* ChaCha20 block function test vector from RFC 7539 section 2.3.2 */
+static void cc20_tester_state(struct lc_sym_state *state)
+{
+	unsigned int i;
+
+	state->constants[0] = 0x61707865;
+	state->constants[1] = 0x3320646e;
+	state->constants[2] = 0x79622d32;
+	state->constants[3] = 0x6b206574;
+	for (i = 0; i < LC_CC20_KEY_SIZE_WORDS; i++) {
+		state->key.u[i] = (4 * i) | ((4 * i + 1) << 8) |
+				  ((4 * i + 2) << 16) | ((4 * i + 3) << 24);
+	}
+	state->counter = 1;
+	state->nonce[0] = 0x09000000;
+	state->nonce[1] = 0x4a000000;
+	state->nonce[2] = 0x00000000;
+}
+
+static int cc20_block_tester(void)
+{
+	static const uint8_t exp[] = {
+		0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f,
+		0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4, 0xc7, 0xd1, 0xf4, 0xc7,
+		0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4,
+		0x6c, 0x4e, 0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+		0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2, 0xb5, 0x12,
+		0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8,
+		0xa2, 0x50, 0x3c, 0x4e
+	};
+	struct lc_sym_state state;
+	uint32_t act[LC_CC20_BLOCK_SIZE_WORDS];
+
+	cc20_tester_state(&state);
+	cc20_block(&state, act);
+
+	return memcmp(act, exp, sizeof(exp)) ? 1 : 0;
+}
+
+/*
+ * The multi-block function must produce the identical key stream as the
+ * block function for any number of blocks and any output alignment.
+ */
+static int cc20_blocks_tester(void)
+{
+	static uint8_t exp[CC20_TEST_BLOCKS * LC_CC20_BLOCK_SIZE];
+	static uint8_t act[CC20_TEST_BLOCKS * LC_CC20_BLOCK_SIZE + 1];
+	struct lc_sym_state ref, state;
+	uint32_t block[LC_CC20_BLOCK_SIZE_WORDS];
+	unsigned int i, blocks;
+	int ret = 0;
+
+	for (blocks = 0; blocks <= CC20_TEST_BLOCKS; blocks++) {
+		cc20_tester_state(&ref);
+		/* Verify the wrap of the 32 bit counter */
+		ref.counter = 0xfffffff8;
+		state = ref;
+
+		for (i = 0; i < blocks; i++) {
+			cc20_block(&ref, block);
+			memcpy(exp + i * LC_CC20_BLOCK_SIZE, block,
+			       LC_CC20_BLOCK_SIZE);
+		}
+
+		cc20_blocks(&state, act + (blocks & 1), blocks);
+
+		if (memcmp(act + (blocks & 1), exp,
+			   blocks * LC_CC20_BLOCK_SIZE) ||
+		    memcmp(&state, &ref, sizeof(state))) {
+			printf("ChaCha20 multi-block failure for %u blocks\n",
+			       blocks);
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * The buffered generate function must hand out the key stream of one buffer
+ * epoch after its first 32 bytes which replaced the key.
+ */
+static int cc20_drng_buffered_tester(void)
+{
+	static const uint8_t seed[] = { 0x00, 0x01, 0x02, 0x03 };
+	uint8_t exp[LC_CC20_DRNG_BUF_SIZE], act[LC_CC20_DRNG_BUF_SIZE];
+	LC_CC20_DRNG_CTX_ON_STACK(cc20_ctx);
+	struct lc_sym_state state;
+	unsigned int i;
+	int ret = 0;
+
+	lc_cc20_drng_seed(cc20_ctx, seed, sizeof(seed));
+	state = *cc20_ctx->cc20.sym_state;
+	cc20_blocks(&state, exp, LC_CC20_DRNG_BUF_BLOCKS);
+
+	/* Serve the epoch with requests crossing the block boundaries */
+	for (i = 0; i < LC_CC20_DRNG_BUF_SIZE - LC_CC20_KEY_SIZE; i += 24)
+		lc_cc20_drng_generate_buffered(cc20_ctx, act + i, 24);
+
+	if (memcmp(act, exp + LC_CC20_KEY_SIZE,
+		   LC_CC20_DRNG_BUF_SIZE - LC_CC20_KEY_SIZE)) {
+		printf("ChaCha20 DRNG buffered generation failure\n");
+		ret++;
+	}
+
+	/* The key must have been replaced */
+	for (i = 0; i < LC_CC20_KEY_SIZE; i++)
+		state.key.b[i] ^= exp[i];
+	if (memcmp(state.key.b, cc20_ctx->cc20.sym_state->key.b,
+		   LC_CC20_KEY_SIZE)) {
+		printf("ChaCha20 DRNG buffered key erasure failure\n");
+		ret++;
+	}
+
+	lc_cc20_drng_zero(cc20_ctx);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = cc20_block_tester();
+	ret += cc20_blocks_tester();
+	ret += cc20_drng_buffered_tester();
+
+	return ret;
+}
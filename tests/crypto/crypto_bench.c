@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "config.h"
+#include "cpufeatures.h"
+#include "helper.h"
+#include "lc_sha256.h"
+#include "lc_sha512.h"
+#include "sha2_accel.h"
+
+#ifdef ESDM_HASH_SHA3_512
+#include "lc_sha3.h"
+#endif
+
+#ifdef ESDM_DRNG_CHACHA20
+#include "lc_chacha20.h"
+#include "lc_chacha20_drng.h"
+#include "lc_chacha20_private.h"
+#endif
+
+#ifdef ESDM_DRNG_HASH_DRBG
+#include "lc_hash_drbg_sha512.h"
+#endif
+
+/*
+ * Throughput of the cryptographic kernels for several buffer sizes and every
+ * implementation the dispatcher may select on this CPU. A variant is forced
+ * by resetting the dispatch pointers of the SHA-2 implementations or by
+ * masking the CPU features checked by the ChaCha20 dispatcher.
+ *
+ * Every measurement processes at least CRYPTO_BENCH_BYTES and is repeated
+ * CRYPTO_BENCH_RUNS times, the fastest run is reported. Cycles are read from
+ * the time stamp counter and therefore only reported on x86, they count
+ * reference cycles which differ from core cycles with frequency scaling. The
+ * results are written as a JSON document to stdout.
+ */
+
+#define CRYPTO_BENCH_BYTES (1UL << 20)
+#define CRYPTO_BENCH_RUNS 5
+#define CRYPTO_BENCH_MAX_SIZE 65536
+
+static const size_t crypto_bench_sizes[] = { 16,   64,    256,  1024,
+					     4096, 16384, CRYPTO_BENCH_MAX_SIZE };
+
+static uint8_t crypto_bench_in[CRYPTO_BENCH_MAX_SIZE];
+static uint8_t crypto_bench_out[CRYPTO_BENCH_MAX_SIZE];
+
+/* Dispatch settings found at startup */
+static void (*crypto_bench_sha256_orig)(uint32_t H[8], const uint8_t *in,
+					size_t blocks);
+static void (*crypto_bench_sha512_orig)(uint64_t H[8], const uint8_t *in,
+					size_t blocks);
+static void (*crypto_bench_sha512_mb_orig)(const uint8_t *in,
+					   uint8_t *digests, size_t num);
+static unsigned int crypto_bench_features_orig;
+
+static void crypto_bench_restore(void)
+{
+	sha256_accel_blocks = crypto_bench_sha256_orig;
+	sha512_accel_blocks = crypto_bench_sha512_orig;
+	sha512_mb_blocks = crypto_bench_sha512_mb_orig;
+	esdm_cpu_features = crypto_bench_features_orig;
+}
+
+/*
+ * One implementation of a kernel: apply forces the implementation based on
+ * the restored dispatch settings and returns 0 if it is not available.
+ */
+struct crypto_bench_variant {
+	const char *name;
+	int (*apply)(void);
+};
+
+struct crypto_bench_kernel {
+	const char *name;
+	const struct crypto_bench_variant *variants;
+	void (*op)(size_t len);
+};
+
+static int crypto_bench_sha256_accel(void)
+{
+	return !!sha256_accel_blocks;
+}
+
+static int crypto_bench_sha256_c(void)
+{
+	sha256_accel_blocks = NULL;
+	return 1;
+}
+
+static int crypto_bench_sha512_accel(void)
+{
+	sha512_mb_blocks = NULL;
+	return !!sha512_accel_blocks;
+}
+
+static int crypto_bench_sha512_mb(void)
+{
+	return !!sha512_mb_blocks;
+}
+
+static int crypto_bench_sha512_c(void)
+{
+	sha512_accel_blocks = NULL;
+	sha512_mb_blocks = NULL;
+	return 1;
+}
+
+static const struct crypto_bench_variant crypto_bench_sha256_variants[] = {
+	{ "accel", crypto_bench_sha256_accel },
+	{ "c", crypto_bench_sha256_c },
+	{ NULL, NULL }
+};
+
+static const struct crypto_bench_variant crypto_bench_sha512_variants[] = {
+	{ "accel", crypto_bench_sha512_accel },
+	{ "c", crypto_bench_sha512_c },
+	{ NULL, NULL }
+};
+
+static void crypto_bench_sha256(size_t len)
+{
+	lc_hash(lc_sha256, crypto_bench_in, len, crypto_bench_out);
+}
+
+static void crypto_bench_sha512(size_t len)
+{
+	lc_hash(lc_sha512, crypto_bench_in, len, crypto_bench_out);
+}
+
+#ifdef ESDM_HASH_SHA3_512
+static int crypto_bench_generic(void)
+{
+	return 1;
+}
+
+static const struct crypto_bench_variant crypto_bench_c_variants[] = {
+	{ "c", crypto_bench_generic },
+	{ NULL, NULL }
+};
+
+static void crypto_bench_sha3_512(size_t len)
+{
+	lc_hash(lc_sha3_512, crypto_bench_in, len, crypto_bench_out);
+}
+#endif
+
+#ifdef ESDM_DRNG_CHACHA20
+static int crypto_bench_cc20_avx512(void)
+{
+	return esdm_cpu_has(ESDM_CPU_FEATURE_AVX512F);
+}
+
+static int crypto_bench_cc20_avx2(void)
+{
+	esdm_cpu_features &= ~ESDM_CPU_FEATURE_AVX512F;
+	return esdm_cpu_has(ESDM_CPU_FEATURE_AVX2);
+}
+
+/* 4-way SIMD where available, otherwise the C implementation */
+static int crypto_bench_cc20_4way(void)
+{
+	esdm_cpu_features &=
+		~(ESDM_CPU_FEATURE_AVX512F | ESDM_CPU_FEATURE_AVX2);
+	return 1;
+}
+
+static const struct crypto_bench_variant crypto_bench_cc20_variants[] = {
+	{ "avx512", crypto_bench_cc20_avx512 },
+	{ "avx2", crypto_bench_cc20_avx2 },
+	{ "4way", crypto_bench_cc20_4way },
+	{ NULL, NULL }
+};
+
+static struct lc_sym_state crypto_bench_cc20_state;
+static struct lc_chacha20_drng_ctx *crypto_bench_cc20_drng;
+
+static void crypto_bench_cc20_blocks(size_t len)
+{
+	cc20_blocks(&crypto_bench_cc20_state, crypto_bench_out,
+		    (len + LC_CC20_BLOCK_SIZE - 1) / LC_CC20_BLOCK_SIZE);
+}
+
+static void crypto_bench_cc20_drng_generate(size_t len)
+{
+	lc_cc20_drng_generate(crypto_bench_cc20_drng, crypto_bench_out, len);
+}
+#endif
+
+#ifdef ESDM_DRNG_HASH_DRBG
+static const struct crypto_bench_variant crypto_bench_drbg_variants[] = {
+	{ "mb", crypto_bench_sha512_mb },
+	{ "accel", crypto_bench_sha512_accel },
+	{ "c", crypto_bench_sha512_c },
+	{ NULL, NULL }
+};
+
+static struct lc_drbg_state *crypto_bench_drbg;
+
+static void crypto_bench_drbg_hash_generate(size_t len)
+{
+	lc_drbg_generate(crypto_bench_drbg, crypto_bench_out, len, NULL, 0);
+}
+#endif
+
+static const struct crypto_bench_kernel crypto_bench_kernels[] = {
+	{ "sha256", crypto_bench_sha256_variants, crypto_bench_sha256 },
+	{ "sha512", crypto_bench_sha512_variants, crypto_bench_sha512 },
+#ifdef ESDM_HASH_SHA3_512
+	{ "sha3_512", crypto_bench_c_variants, crypto_bench_sha3_512 },
+#endif
+#ifdef ESDM_DRNG_CHACHA20
+	{ "chacha20_blocks", crypto_bench_cc20_variants,
+	  crypto_bench_cc20_blocks },
+	{ "lc_cc20_drng_generate", crypto_bench_cc20_variants,
+	  crypto_bench_cc20_drng_generate },
+#endif
+#ifdef ESDM_DRNG_HASH_DRBG
+	{ "lc_drbg_hash_generate", crypto_bench_drbg_variants,
+	  crypto_bench_drbg_hash_generate },
+#endif
+};
+
+static uint64_t crypto_bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t crypto_bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void crypto_bench_one(const struct crypto_bench_kernel *kernel,
+			     const char *variant, size_t len, int first)
+{
+	unsigned long i, iterations = CRYPTO_BENCH_BYTES / len;
+	uint64_t ns, cycles, best_ns = UINT64_MAX, best_cycles = UINT64_MAX;
+	unsigned int run;
+
+	if (!iterations)
+		iterations = 1;
+
+	/* Warm up the caches */
+	kernel->op(len);
+
+	for (run = 0; run < CRYPTO_BENCH_RUNS; run++) {
+		ns = crypto_bench_ns();
+		cycles = crypto_bench_cycles();
+		for (i = 0; i < iterations; i++)
+			kernel->op(len);
+		cycles = crypto_bench_cycles() - cycles;
+		ns = crypto_bench_ns() - ns;
+
+		if (ns < best_ns)
+			best_ns = ns;
+		if (cycles < best_cycles)
+			best_cycles = cycles;
+	}
+
+	printf("%s\n    { \"kernel\": \"%s\", \"variant\": \"%s\", "
+	       "\"size\": %zu, \"iterations\": %lu, \"ns_per_byte\": %.3f, "
+	       "\"cycles_per_byte\": %.3f, \"mib_per_sec\": %.2f }",
+	       first ? "" : ",", kernel->name, variant, len, iterations,
+	       (double)best_ns / ((double)iterations * (double)len),
+	       (double)best_cycles / ((double)iterations * (double)len),
+	       ((double)iterations * (double)len * 1e9) /
+		       ((double)(best_ns ? best_ns : 1) * 1048576.0));
+	fflush(stdout);
+}
+
+static int crypto_bench_init(void)
+{
+	static const uint8_t seed[64] = { 0 };
+	unsigned int i;
+
+	for (i = 0; i < sizeof(crypto_bench_in); i++)
+		crypto_bench_in[i] = (uint8_t)i;
+
+	esdm_cpufeatures_init();
+	crypto_bench_sha256_orig = sha256_accel_blocks;
+	crypto_bench_sha512_orig = sha512_accel_blocks;
+	crypto_bench_sha512_mb_orig = sha512_mb_blocks;
+	crypto_bench_features_orig = esdm_cpu_features;
+
+#ifdef ESDM_DRNG_CHACHA20
+	crypto_bench_cc20_state.constants[0] = 0x61707865;
+	crypto_bench_cc20_state.constants[1] = 0x3320646e;
+	crypto_bench_cc20_state.constants[2] = 0x79622d32;
+	crypto_bench_cc20_state.constants[3] = 0x6b206574;
+
+	if (lc_cc20_drng_alloc(&crypto_bench_cc20_drng))
+		return 1;
+	lc_cc20_drng_seed(crypto_bench_cc20_drng, seed, sizeof(seed));
+#endif
+
+#ifdef ESDM_DRNG_HASH_DRBG
+	if (lc_drbg_hash_alloc(&crypto_bench_drbg))
+		return 1;
+	if (lc_drbg_seed(crypto_bench_drbg, seed, sizeof(seed), NULL, 0))
+		return 1;
+#endif
+
+	(void)seed;
+
+	return 0;
+}
+
+static void crypto_bench_fini(void)
+{
+#ifdef ESDM_DRNG_CHACHA20
+	lc_cc20_drng_zero_free(crypto_bench_cc20_drng);
+#endif
+#ifdef ESDM_DRNG_HASH_DRBG
+	lc_drbg_zero_free(crypto_bench_drbg);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+	const struct crypto_bench_variant *variant;
+	unsigned int i, j;
+	int first = 1, ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = crypto_bench_init();
+	if (ret)
+		goto out;
+
+	printf("{\n  \"benchmark\": \"crypto kernels\",\n"
+	       "  \"cycle_counter\": %d,\n  \"results\": [",
+	       crypto_bench_cycles() ? 1 : 0);
+
+	for (i = 0; i < ARRAY_SIZE(crypto_bench_kernels); i++) {
+		for (variant = crypto_bench_kernels[i].variants; variant->name;
+		     variant++) {
+			crypto_bench_restore();
+			if (!variant->apply()) {
+				fprintf(stderr, "%s: variant %s unavailable\n",
+					crypto_bench_kernels[i].name,
+					variant->name);
+				continue;
+			}
+
+			for (j = 0; j < ARRAY_SIZE(crypto_bench_sizes); j++) {
+				crypto_bench_one(&crypto_bench_kernels[i],
+						 variant->name,
+						 crypto_bench_sizes[j], first);
+				first = 0;
+			}
+
+			fprintf(stderr, "%s: variant %s measured\n",
+				crypto_bench_kernels[i].name, variant->name);
+		}
+	}
+
+	crypto_bench_restore();
+	printf("\n  ]\n}\n");
+
+out:
+	crypto_bench_fini();
+	return ret;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see COPYING file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lc_ctr_drbg.h"
+
+static int ctr_drbg_tester(void)
+{
+	static const uint8_t ent_nonce[] = {
+		0x9E, 0x28, 0x52, 0xF1, 0xD8, 0xB2, 0x3C, 0x1A, 0x80, 0xCA,
+		0x75, 0x29, 0x37, 0xAC, 0x58, 0x54, 0x61, 0x98, 0xDB, 0x72,
+		0x81, 0xB7, 0x43, 0xDB, 0x37, 0x21, 0x8E, 0x86, 0x40, 0x3B,
+		0x74, 0xF9, 0x88, 0x45, 0x49, 0xDC, 0x49, 0x26, 0xBB, 0xAA,
+		0x83, 0x3E, 0x50, 0x42, 0xA9, 0x52, 0xAE, 0x97
+	};
+	static const uint8_t pers[] = { 0x12, 0x6B, 0xE1, 0x49, 0x3F, 0x41,
+					0x28, 0x9A, 0xDC, 0x5C, 0x7F, 0x00,
+					0x43, 0x40, 0xFF, 0x21, 0xA7, 0xEC,
+					0x4D, 0xAD, 0xFF, 0xDA, 0x64, 0x2D,
+					0xE4, 0x65, 0xAB, 0x2E, 0x98, 0x54,
+					0x19, 0x1A };
+	static const uint8_t addtl1[] = { 0x89, 0x18, 0x8A, 0xB5, 0x82, 0x0B,
+					  0x05, 0x98, 0xF9, 0x81, 0xB3, 0x34,
+					  0x44, 0x6D, 0xD4, 0x38, 0x29, 0xCD,
+					  0x50, 0x4E, 0x06, 0xFE, 0x11, 0xF2,
+					  0x3C, 0x70, 0x0D, 0xAC, 0xA8, 0x28,
+					  0x0E, 0x40 };
+	static const uint8_t addtl2[] = { 0x67, 0x87, 0xEE, 0x02, 0xA6, 0x0F,
+					  0x2F, 0x8D, 0x8D, 0xF3, 0x4A, 0xBF,
+					  0xA3, 0x61, 0x7E, 0xD6, 0xB2, 0xB1,
+					  0x37, 0x61, 0xA5, 0x41, 0xB3, 0x8C,
+					  0x2A, 0xF9, 0x01, 0x08, 0x3F, 0xC9,
+					  0x0D, 0xCA };
+	static const uint8_t exp[] = {
+		0xf6, 0x25, 0xc5, 0x34, 0x90, 0x20, 0x0d, 0x14, 0x8d, 0x89,
+		0x93, 0xb2, 0xc1, 0x0a, 0x91, 0xbc, 0x54, 0x7e, 0x04, 0x37,
+		0xf3, 0xea, 0xb2, 0x51, 0x32, 0x96, 0x33, 0x88, 0x9a, 0x05,
+		0xcb, 0xfa, 0xce, 0xcf, 0x1b, 0x42, 0xc9, 0x44, 0x61, 0x4b,
+		0x66, 0x94, 0x5b, 0x69, 0xf0, 0xf3, 0xeb, 0x9f, 0x74, 0x29,
+		0x08, 0x47, 0x12, 0xde, 0x7e, 0x41, 0x17, 0xdb, 0x9d, 0x30,
+		0x64, 0x66, 0x5d, 0x8e, 0x89, 0xb0, 0x82, 0x98, 0x0f, 0xc0,
+		0xe4, 0x75, 0x65, 0x49, 0x70, 0x2b, 0x7c, 0xab, 0x2a, 0x54,
+		0xc2, 0x01, 0x90, 0x0c, 0xab, 0xc5, 0xfe, 0x4d, 0x8c, 0x32,
+		0x82, 0xe3, 0xc9, 0x96, 0xae, 0x3a, 0x6c, 0x99, 0x2e, 0xbc,
+		0xee, 0xe0, 0x46, 0x55, 0x77, 0xef, 0x86, 0x14, 0x86, 0xd1,
+		0x7a, 0xb1, 0x54, 0xac, 0xdb, 0xfa, 0x11, 0x80, 0xd1, 0xc4,
+		0x19, 0x5e, 0x69, 0xc1, 0x38, 0x6c, 0xf8, 0xf9, 0x16, 0xaa,
+		0x3e, 0x07, 0x7e, 0xef, 0xf9, 0xa8, 0x3b, 0xd6, 0xec, 0x69,
+		0xcc, 0x88, 0x89, 0x9b, 0xf9, 0x1c, 0xa5, 0xe1, 0xe5, 0x38,
+		0x37, 0xec, 0x58, 0x96, 0xe5, 0x3c, 0xea, 0xde, 0xe6, 0xcd,
+		0x7a, 0x9e, 0xcd, 0x34, 0x2c, 0x61, 0xf9, 0xe8, 0x00, 0x09,
+		0xc0, 0xfc, 0xa9, 0x42, 0x44, 0x6b, 0xca, 0x38, 0x36, 0x70,
+		0x66, 0xd2, 0xd4, 0xc9, 0x61, 0x4d, 0x5d, 0x9a, 0x1d, 0x2c,
+		0x03, 0x5c, 0xe8, 0x2d, 0xae, 0xe2, 0x8c, 0x78, 0x68, 0xd8,
+		0x00, 0xfc, 0xc8, 0x45, 0x58, 0x77, 0x62, 0x65, 0xfd, 0x59,
+		0x13, 0x16, 0xb2, 0xeb, 0x2a, 0xb5, 0x40, 0xfd, 0x9f, 0x57,
+		0xd9, 0x81, 0x6c, 0xd3, 0x40, 0x81, 0x69, 0x27, 0xe0, 0x4a,
+		0xc0, 0xda, 0xf0, 0x29, 0x9b, 0xe6, 0x31, 0x65, 0x7f, 0x74,
+		0xbe, 0x3d, 0x97, 0xf9, 0xc8, 0xa4, 0x88, 0x53, 0x24, 0xa2,
+		0xb7, 0xae, 0xad, 0x1a, 0xfa, 0x6c
+	};
+	/* Reseed with the trailing entropy data and addtl1, then 77 bytes */
+	static const uint8_t exp_reseed[] = {
+		0x09, 0x63, 0x30, 0xc1, 0xba, 0x0c, 0x88, 0xb7, 0x7b, 0xb1,
+		0xce, 0x58, 0xc1, 0x54, 0xa8, 0x04, 0xc3, 0xb8, 0x87, 0x8f,
+		0x1c, 0xe1, 0x69, 0x19, 0x79, 0xe6, 0x8c, 0xd3, 0xed, 0x10,
+		0xf4, 0x5e, 0xb7, 0x7b, 0xe5, 0xce, 0x7e, 0x32, 0xba, 0x99,
+		0xd4, 0xf0, 0x15, 0x1e, 0xd4, 0xaf, 0x0c, 0xf9, 0xf4, 0x59,
+		0xd9, 0x4c, 0x2b, 0x94, 0xbf, 0xfd, 0x20, 0x2f, 0x08, 0x56,
+		0x46, 0xa6, 0x6b, 0xa7, 0x27, 0xfb, 0xa5, 0x01, 0x14, 0xc1,
+		0x95, 0xc1, 0xd8, 0x42, 0xec, 0xff, 0xc4
+	};
+	uint8_t act[sizeof(exp)];
+	LC_DRBG_CTR_CTX_ON_STACK(drbg_stack);
+	struct lc_drbg_state *drbg = NULL;
+	int ret = 0;
+
+	printf("CTR DRBG ctx len %lu\n",
+	       (unsigned long)sizeof(struct lc_drbg_ctr_state));
+	if (lc_drbg_healthcheck_sanity(drbg_stack))
+		return 1;
+
+	if (lc_drbg_seed(drbg_stack, ent_nonce, 48, pers, 32))
+		goto out;
+
+	if (lc_drbg_generate(drbg_stack, act, sizeof(exp), addtl1, 32) < 0)
+		goto out;
+
+	if (lc_drbg_generate(drbg_stack, act, sizeof(exp), addtl2, 32) < 0)
+		goto out;
+
+	ret += memcmp(act, exp, sizeof(exp)) ? 1 : 0;
+
+	/* Reseed and partial block */
+	if (lc_drbg_seed(drbg_stack, ent_nonce + 16, 32, addtl1, 32))
+		goto out;
+
+	if (lc_drbg_generate(drbg_stack, act, sizeof(exp_reseed), NULL, 0) < 0)
+		goto out;
+
+	ret += memcmp(act, exp_reseed, sizeof(exp_reseed)) ? 1 : 0;
+
+	lc_drbg_zero(drbg_stack);
+
+	/* Rerun to verify that drbg_zero works properly */
+	if (lc_drbg_seed(drbg_stack, ent_nonce, 48, pers, 32))
+		goto out;
+
+	if (lc_drbg_generate(drbg_stack, act, sizeof(exp), addtl1, 32) < 0)
+		goto out;
+
+	if (lc_drbg_generate(drbg_stack, act, sizeof(exp), addtl2, 32) < 0)
+		goto out;
+
+	ret += memcmp(act, exp, sizeof(exp)) ? 1 : 0;
+
+	lc_drbg_zero(drbg_stack);
+
+	if (lc_drbg_ctr_alloc(&drbg))
+		goto out;
+
+	if (lc_drbg_seed(drbg, ent_nonce, 48, pers, 32))
+		goto out;
+
+	if (lc_drbg_generate(drbg, act, sizeof(exp), addtl1, 32) < 0)
+		goto out;
+
+	if (lc_drbg_generate(drbg, act, sizeof(exp), addtl2, 32) < 0)
+		goto out;
+
+	ret += memcmp(act, exp, sizeof(exp)) ? 1 : 0;
+
+out:
+	lc_drbg_zero_free(drbg);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+	return ctr_drbg_tester();
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esdm_config.h"
+#include "esdm_definitions.h"
+#include "esdm_es_aux.h"
+#include "esdm_es_mgr.h"
+#include "esdm_logger.h"
+#include "helper.h"
+
+/*
+ * Latency of the get_ent callback of every active entropy source as invoked
+ * by esdm_fill_seed_buffer. Each entropy source is measured for the requested
+ * bit levels used for the initial seed, a reseed and a minimally seeded ESDM,
+ * both with and without SP800-90C oversampling. The Jitter RNG is additionally
+ * measured with the asynchronous slots, which are refilled through the ES
+ * monitor outside of the measured time.
+ *
+ * Every configuration is sampled until the sample count or the duration is
+ * reached, whichever comes first. The results are written as a JSON document
+ * to stdout.
+ */
+
+struct es_bench_cfg {
+	unsigned long samples;
+	unsigned long duration_ms;
+};
+
+struct es_bench_run {
+	const char *mode;
+	uint32_t requested_bits;
+	bool fully_seeded;
+	bool refill;
+};
+
+static uint64_t es_bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int es_bench_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint64_t es_bench_quantile(const uint64_t *sorted, unsigned long n,
+				  unsigned int permille)
+{
+	unsigned long rank = (n * permille + 999) / 1000;
+
+	return sorted[rank ? rank - 1 : 0];
+}
+
+/* Data multiplier reported by the state of the CPU ES, or 0 */
+static unsigned long es_bench_cpu_multiplier(const struct esdm_es_cb *es)
+{
+	char buf[500] = { 0 };
+	const char *p;
+
+	if (!es->state || strcmp(es->name, "CPU"))
+		return 0;
+
+	es->state(buf, sizeof(buf));
+	p = strstr(buf, "Data multiplier: ");
+	if (!p)
+		return 0;
+
+	return strtoul(p + strlen("Data multiplier: "), NULL, 10);
+}
+
+static int es_bench_one(const struct esdm_es_cb *es,
+			const struct es_bench_run *run,
+			const struct es_bench_cfg *cfg, uint64_t *ns, int first)
+{
+	struct entropy_es eb_es;
+	uint64_t start, end, deadline, bits = 0;
+	unsigned long i;
+
+	deadline = es_bench_ns() + (uint64_t)cfg->duration_ms * 1000000ULL;
+
+	for (i = 0; i < cfg->samples; i++) {
+		/* Fill the asynchronous slots without measuring it */
+		if (run->refill && es->monitor_es)
+			es->monitor_es();
+
+		memset(&eb_es, 0, sizeof(eb_es));
+		start = es_bench_ns();
+		es->get_ent(&eb_es, run->requested_bits, run->fully_seeded);
+		end = es_bench_ns();
+
+		ns[i] = end - start;
+		bits += eb_es.e_bits;
+
+		if (end >= deadline) {
+			i++;
+			break;
+		}
+	}
+
+	qsort(ns, i, sizeof(uint64_t), es_bench_cmp);
+
+	printf("%s\n    { \"es\": \"%s\", \"mode\": \"%s\", "
+	       "\"sp80090c\": %d, \"fully_seeded\": %d, "
+	       "\"requested_bits\": %u, \"multiplier\": %lu, "
+	       "\"samples\": %lu, \"delivered_bits\": %.1f, "
+	       "\"min_ns\": %llu, \"p50_ns\": %llu, \"p90_ns\": %llu, "
+	       "\"p99_ns\": %llu, \"max_ns\": %llu }",
+	       first ? "" : ",", es->name, run->mode, esdm_sp80090c_compliant(),
+	       run->fully_seeded, run->requested_bits,
+	       es_bench_cpu_multiplier(es), i, (double)bits / (double)i,
+	       (unsigned long long)ns[0],
+	       (unsigned long long)es_bench_quantile(ns, i, 500),
+	       (unsigned long long)es_bench_quantile(ns, i, 900),
+	       (unsigned long long)es_bench_quantile(ns, i, 990),
+	       (unsigned long long)ns[i - 1]);
+	fflush(stdout);
+
+	fprintf(stderr, "%s (%s): %u bits, fully seeded %d: %lu samples\n",
+		es->name, run->mode, run->requested_bits, run->fully_seeded, i);
+
+	return 0;
+}
+
+static int es_bench_es(unsigned int idx, const struct es_bench_cfg *cfg,
+		       uint64_t *ns, int *first)
+{
+	const struct esdm_es_cb *es = esdm_es[idx];
+	struct es_bench_run runs[4];
+	unsigned int i, nruns = 0;
+	int ret;
+
+	if (!es->get_ent || (es->active && !es->active())) {
+		fprintf(stderr, "%s: entropy source inactive, skipped\n",
+			es->name);
+		return 0;
+	}
+
+	/* Initial seed: oversampled if not fully seeded */
+	runs[nruns++] = (struct es_bench_run){
+		.mode = "sync",
+		.requested_bits = esdm_get_seed_entropy_osr(false),
+		.fully_seeded = false,
+	};
+	/* Reseed of the fully seeded ESDM */
+	runs[nruns++] = (struct es_bench_run){
+		.mode = "sync",
+		.requested_bits = esdm_get_seed_entropy_osr(true),
+		.fully_seeded = true,
+	};
+	/* Minimally seeded level */
+	runs[nruns++] = (struct es_bench_run){
+		.mode = "sync",
+		.requested_bits = ESDM_MIN_SEED_ENTROPY_BITS,
+		.fully_seeded = false,
+	};
+
+#if defined(ESDM_ES_JENT) && (ESDM_JENT_ENTROPY_BLOCKS != 0)
+	/* Jitter RNG: only the reseed level is served from the slots */
+	if (idx == esdm_ext_es_jitter) {
+		runs[nruns++] = (struct es_bench_run){
+			.mode = "async",
+			.requested_bits = esdm_get_seed_entropy_osr(true),
+			.fully_seeded = true,
+			.refill = true,
+		};
+	}
+#endif
+
+	for (i = 0; i < nruns; i++) {
+#ifdef ESDM_ES_JENT
+		if (idx == esdm_ext_es_jitter)
+			esdm_config_es_jent_async_enabled_set(runs[i].refill);
+#endif
+		ret = es_bench_one(es, &runs[i], cfg, ns, *first);
+		if (ret)
+			return ret;
+		*first = 0;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const enum esdm_config_force_fips osr[] = {
+		esdm_config_force_fips_disabled,
+		esdm_config_force_sp80090c_enabled,
+	};
+	struct es_bench_cfg cfg = { .samples = 200, .duration_ms = 2000 };
+	uint64_t *ns = NULL;
+	unsigned int i, j;
+	int first = 1, opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "n:d:")) != -1) {
+		switch (opt) {
+		case 'n':
+			cfg.samples = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			cfg.duration_ms = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n samples] [-d msec]\n",
+				argv[0]);
+			return EINVAL;
+		}
+	}
+
+	if (!cfg.samples || !cfg.duration_ms)
+		return EINVAL;
+
+	ns = calloc(cfg.samples, sizeof(uint64_t));
+	if (!ns)
+		return ENOMEM;
+
+	esdm_logger_set_verbosity(LOGGER_ERR);
+
+	for_each_esdm_es (i) {
+		if (!esdm_es[i]->init)
+			continue;
+
+		ret = esdm_es[i]->init();
+		if (ret) {
+			fprintf(stderr, "%s: initialization failed: %d\n",
+				esdm_es[i]->name, ret);
+			goto out;
+		}
+	}
+
+	printf("{\n  \"benchmark\": \"ES collection latency\",\n"
+	       "  \"samples\": %lu,\n  \"duration_ms\": %lu,\n"
+	       "  \"results\": [",
+	       cfg.samples, cfg.duration_ms);
+
+	/*
+	 * Oversampling can only be enabled with the SP800-90C compile-time
+	 * option, otherwise both passes measure the same configuration.
+	 */
+	for (j = 0; j < ARRAY_SIZE(osr); j++) {
+		esdm_config_force_fips_set(osr[j]);
+
+		for_each_esdm_es (i) {
+			ret = es_bench_es(i, &cfg, ns, &first);
+			if (ret)
+				goto print;
+		}
+	}
+
+print:
+	printf("\n  ],\n  \"status\": %d\n}\n", ret);
+
+out:
+	for_each_esdm_es (i) {
+		if (esdm_es[i]->fini)
+			esdm_es[i]->fini();
+	}
+	free(ns);
+
+	return -ret;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "esdm_config.h"
+#include "esdm_definitions.h"
+#include "esdm_es_aux.h"
+#include "esdm_es_mgr.h"
+#include "esdm_logger.h"
+
+#define SYNTH_LATENCY_US 20000
+
+static void es_synth_get(struct entropy_es *eb_es)
+{
+	memset(eb_es, 0, sizeof(*eb_es));
+	esdm_es[esdm_ext_es_synth]->get_ent(eb_es,
+					    ESDM_DRNG_INIT_SEED_SIZE_BITS, true);
+}
+
+static int es_synth_determinism(void)
+{
+	struct entropy_es a, b, c;
+
+	esdm_config_es_synth_seed_set(1);
+	es_synth_get(&a);
+	es_synth_get(&b);
+
+	/* The stream continues with the next collection */
+	if (!memcmp(a.e, b.e, ESDM_DRNG_INIT_SEED_SIZE_BYTES)) {
+		printf("ES Synthetic - fail: data stream does not advance\n");
+		return 1;
+	}
+
+	/* A new seed restarts the stream */
+	esdm_config_es_synth_seed_set(2);
+	es_synth_get(&c);
+	if (!memcmp(a.e, c.e, ESDM_DRNG_INIT_SEED_SIZE_BYTES)) {
+		printf("ES Synthetic - fail: data stream independent of seed\n");
+		return 1;
+	}
+
+	esdm_config_es_synth_seed_set(1);
+	es_synth_get(&c);
+	if (memcmp(a.e, c.e, ESDM_DRNG_INIT_SEED_SIZE_BYTES)) {
+		printf("ES Synthetic - fail: data stream not reproducible\n");
+		return 1;
+	}
+
+	printf("ES Synthetic - pass: determinism test passed\n");
+
+	return 0;
+}
+
+static int es_synth_entropy(uint32_t expected_ent_level)
+{
+	struct entropy_es eb_es;
+	uint32_t expected;
+
+	esdm_config_es_synth_entropy_rate_set(expected_ent_level);
+	expected = esdm_fast_noise_entropylevel(
+		esdm_config_es_synth_entropy_rate(),
+		ESDM_DRNG_INIT_SEED_SIZE_BITS);
+
+	es_synth_get(&eb_es);
+	if (eb_es.e_bits != expected) {
+		printf("ES Synthetic - fail: get_ent claims %u bits instead of %u bits\n",
+		       eb_es.e_bits, expected);
+		return 1;
+	}
+
+	if (esdm_es[esdm_ext_es_synth]->curr_entropy(
+		    esdm_security_strength()) !=
+	    esdm_es[esdm_ext_es_synth]->max_entropy()) {
+		printf("ES Synthetic - fail: max_entropy inconsistent with curr_entropy\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static int es_synth_latency(void)
+{
+	struct entropy_es eb_es;
+	struct timespec start, end;
+	uint64_t elapsed_us;
+
+	esdm_config_es_synth_latency_us_set(SYNTH_LATENCY_US);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	es_synth_get(&eb_es);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	esdm_config_es_synth_latency_us_set(0);
+
+	elapsed_us = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000 +
+		     (uint64_t)(end.tv_nsec - start.tv_nsec) / 1000;
+	if (end.tv_nsec < start.tv_nsec)
+		elapsed_us = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000 -
+			     (uint64_t)(start.tv_nsec - end.tv_nsec) / 1000;
+
+	if (elapsed_us < SYNTH_LATENCY_US) {
+		printf("ES Synthetic - fail: collection took %llu us instead of at least %u us\n",
+		       (unsigned long long)elapsed_us, SYNTH_LATENCY_US);
+		return 1;
+	}
+
+	printf("ES Synthetic - pass: latency test passed (%llu us)\n",
+	       (unsigned long long)elapsed_us);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int i;
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	esdm_logger_set_verbosity(LOGGER_DEBUG);
+
+	ret = esdm_es[esdm_ext_es_synth]->init();
+	if (ret)
+		return ret;
+
+	ret += es_synth_determinism();
+
+	for (i = 0; i <= ESDM_DRNG_SECURITY_STRENGTH_BITS; i++)
+		ret += es_synth_entropy(i);
+
+	ret += es_synth_latency();
+
+	return ret;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "esdm_crypto.h"
+#include "esdm_drng_mgr.h"
+#include "ret_checkers.h"
+
+/*
+ * Benchmark of the cryptographic primitives the selected crypto backend
+ * provides to the ESDM core. The test only fails if an operation fails, the
+ * numbers are printed for comparing backends and build options.
+ */
+
+#define ESDM_BENCH_BYTES (8UL << 20)
+#define ESDM_BENCH_MAX_REQ 65536
+
+static uint64_t esdm_bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void esdm_bench_print(const char *name, size_t reqsize, size_t iter,
+			     uint64_t ns)
+{
+	if (!ns)
+		ns = 1;
+
+	printf("%s: %6zu bytes per request: %8llu ns per request, %6llu MB/s\n",
+	       name, reqsize, (unsigned long long)(ns / iter),
+	       (unsigned long long)((reqsize * iter * 1000ULL) / ns));
+}
+
+static int esdm_bench_drng(void)
+{
+	static const size_t reqsizes[] = { 32, 4096, ESDM_BENCH_MAX_REQ };
+	const struct esdm_drng_cb *drng_cb = esdm_default_drng_cb;
+	uint8_t seed[ESDM_DRNG_SECURITY_STRENGTH_BYTES * 2];
+	uint8_t *buf = NULL;
+	void *drng = NULL;
+	size_t i, j, iter;
+	uint64_t start;
+	int ret;
+
+	buf = malloc(ESDM_BENCH_MAX_REQ);
+	CKNULL(buf, -ENOMEM);
+
+	for (i = 0; i < sizeof(seed); i++)
+		seed[i] = (uint8_t)i;
+
+	CKINT(drng_cb->drng_alloc(&drng, ESDM_DRNG_SECURITY_STRENGTH_BITS));
+	CKINT(drng_cb->drng_seed(drng, seed, sizeof(seed)));
+
+	for (i = 0; i < ARRAY_SIZE(reqsizes); i++) {
+		iter = ESDM_BENCH_BYTES / reqsizes[i];
+		start = esdm_bench_ns();
+		for (j = 0; j < iter; j++) {
+			if (drng_cb->drng_generate(drng, buf, reqsizes[i]) !=
+			    (ssize_t)reqsizes[i]) {
+				printf("DRNG generate operation failed\n");
+				ret = -EFAULT;
+				goto out;
+			}
+		}
+		esdm_bench_print(drng_cb->drng_name(), reqsizes[i], iter,
+				 esdm_bench_ns() - start);
+	}
+
+out:
+	if (drng)
+		drng_cb->drng_dealloc(drng);
+	free(buf);
+	return ret;
+}
+
+static int esdm_bench_hash(void)
+{
+#if defined(ESDM_HASH_SHA512)
+	LC_HASH_CTX_ON_STACK(shash, lc_sha512);
+	bool shash_free = false;
+#elif defined(ESDM_HASH_SHA3_512)
+	LC_HASH_CTX_ON_STACK(shash, lc_sha3_512);
+	bool shash_free = false;
+#else
+	void *shash = NULL;
+	bool shash_free = true;
+#endif
+	static const size_t reqsizes[] = { 64, 4096 };
+	const struct esdm_hash_cb *hash_cb = esdm_default_hash_cb;
+	uint8_t digest[ESDM_MAX_DIGESTSIZE];
+	uint8_t *buf = NULL;
+	size_t i, j, iter;
+	uint64_t start;
+	int ret = 0;
+
+	if (shash_free)
+		CKINT(esdm_hash_ctx_get(hash_cb, (void **)&shash));
+
+	if (hash_cb->hash_digestsize(shash) > sizeof(digest)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	buf = calloc(1, 4096);
+	CKNULL(buf, -ENOMEM);
+
+	/* Conditioning-style operations: one digest per request */
+	for (i = 0; i < ARRAY_SIZE(reqsizes); i++) {
+		iter = ESDM_BENCH_BYTES / reqsizes[i];
+		start = esdm_bench_ns();
+		for (j = 0; j < iter; j++) {
+			CKINT(hash_cb->hash_init(shash));
+			CKINT(hash_cb->hash_update(shash, buf, reqsizes[i]));
+			CKINT(hash_cb->hash_final(shash, digest));
+		}
+		esdm_bench_print(hash_cb->hash_name(), reqsizes[i], iter,
+				 esdm_bench_ns() - start);
+	}
+
+out:
+	if (shash_free)
+		esdm_hash_ctx_put(hash_cb, shash);
+	else
+		hash_cb->hash_desc_zero(shash);
+	free(buf);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	CKINT(esdm_bench_drng());
+	CKINT(esdm_bench_hash());
+
+out:
+	return ret ? 1 : 0;
+}
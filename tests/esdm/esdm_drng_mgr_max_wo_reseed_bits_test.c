@@ -74,6 +74,8 @@ static int esdm_drng_mgr_max_wo_reseed_bits_test(bool success)
 	esdm_config_es_irq_entropy_rate_set(0);
 	esdm_config_es_sched_entropy_rate_set(0);
 	esdm_config_es_jent_kernel_entropy_rate_set(0);
+	esdm_config_es_upstream_entropy_rate_set(0);
+	esdm_config_es_synth_entropy_rate_set(0);
 
 	if (!esdm_state_operational()) {
 		printf("failed to remain in operational mode\n");
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "arch.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "esdm.h"
+#include "esdm_definitions.h"
+#include "helper.h"
+
+/*
+ * Scaling benchmark of the DRNG manager: 1 to N threads, each bound to its own
+ * CPU, call esdm_get_random_bytes in a loop while background threads insert
+ * data into the aux pool, request data with prediction resistance or obtain
+ * the status. The ESDM library is used directly, i.e. the numbers do not
+ * contain any transport overhead. The test only fails if a request fails,
+ * the numbers are printed for comparison.
+ *
+ * The optional argument limits the number of calling threads, by default all
+ * online CPUs are used.
+ */
+
+#define ESDM_BENCH_MAX_THREADS 64
+#define ESDM_BENCH_DURATION_MS 200
+#define ESDM_BENCH_REQSIZE 32
+#define ESDM_BENCH_STATUS_SIZE 4096
+
+/* Background load running alongside the calling threads */
+enum esdm_bench_load {
+	esdm_bench_load_aux = (1 << 0),
+	esdm_bench_load_pr = (1 << 1),
+	esdm_bench_load_status = (1 << 2),
+};
+
+static const struct esdm_bench_mix {
+	const char *name;
+	unsigned int load;
+} esdm_bench_mixes[] = {
+	{ "plain", 0 },
+	{ "aux writer", esdm_bench_load_aux },
+	{ "PR caller", esdm_bench_load_pr },
+	{ "status caller", esdm_bench_load_status },
+	{ "all", esdm_bench_load_aux | esdm_bench_load_pr |
+			 esdm_bench_load_status },
+};
+
+struct esdm_bench_thread {
+	pthread_t tid;
+	uint32_t cpu;
+	unsigned int load;
+	uint64_t ops;
+	int ret;
+} __aligned(ESDM_CACHELINE_SIZE);
+
+static struct esdm_bench_thread esdm_bench_callers[ESDM_BENCH_MAX_THREADS];
+static struct esdm_bench_thread esdm_bench_background[3];
+static pthread_barrier_t esdm_bench_barrier;
+static atomic_t esdm_bench_stop = ATOMIC_INIT(0);
+
+static uint64_t esdm_bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *esdm_bench_caller(void *arg)
+{
+	struct esdm_bench_thread *t = arg;
+	struct esdm_arch_cpu_affinity prev;
+	uint8_t buf[ESDM_BENCH_REQSIZE];
+
+	/* Without the binding, the scheduler places the thread */
+	esdm_arch_cpu_pin(t->cpu, &prev);
+
+	pthread_barrier_wait(&esdm_bench_barrier);
+	while (!atomic_read(&esdm_bench_stop)) {
+		ssize_t rc = esdm_get_random_bytes(buf, sizeof(buf));
+
+		if (rc != (ssize_t)sizeof(buf)) {
+			t->ret = (rc < 0) ? (int)rc : -EFAULT;
+			break;
+		}
+		t->ops++;
+	}
+
+	return NULL;
+}
+
+static void *esdm_bench_load(void *arg)
+{
+	struct esdm_bench_thread *t = arg;
+	char status[ESDM_BENCH_STATUS_SIZE];
+	uint8_t buf[ESDM_BENCH_REQSIZE];
+
+	memset(buf, 0x5a, sizeof(buf));
+
+	pthread_barrier_wait(&esdm_bench_barrier);
+	while (!atomic_read(&esdm_bench_stop)) {
+		switch (t->load) {
+		case esdm_bench_load_aux:
+			/* Data without entropy does not alter the seed level */
+			t->ret = esdm_pool_insert_aux(buf, sizeof(buf), 0);
+			break;
+		case esdm_bench_load_pr:
+			/* The PR DRNG delivers data only with new entropy */
+			if (esdm_get_random_bytes_pr_noblock(buf, sizeof(buf)) <
+			    0)
+				sched_yield();
+			break;
+		case esdm_bench_load_status:
+			esdm_status(status, sizeof(status));
+			break;
+		default:
+			t->ret = -EINVAL;
+			break;
+		}
+
+		if (t->ret)
+			break;
+		t->ops++;
+	}
+
+	return NULL;
+}
+
+static int esdm_bench_start(struct esdm_bench_thread *t,
+			    void *(*fn)(void *))
+{
+	t->ops = 0;
+	t->ret = 0;
+	return pthread_create(&t->tid, NULL, fn, t) ? -EFAULT : 0;
+}
+
+static void esdm_bench_print(const char *mix, uint32_t threads, uint64_t ns,
+			     double base)
+{
+	double sum = 0, sum_sq = 0, min = 0, max = 0, ops_s, fairness;
+	unsigned int i;
+
+	if (!ns)
+		ns = 1;
+
+	for (i = 0; i < threads; i++) {
+		double rate = (double)esdm_bench_callers[i].ops * 1e9 /
+			      (double)ns;
+
+		sum += rate;
+		sum_sq += rate * rate;
+		if (!i || rate < min)
+			min = rate;
+		if (rate > max)
+			max = rate;
+	}
+
+	ops_s = sum;
+	/* Jain's fairness index: 1 if all threads were served equally */
+	fairness = sum_sq ? (sum * sum) / ((double)threads * sum_sq) : 0;
+
+	printf("%-13s %3u threads: %10.0f ops/s (%5.2fx), per thread min %9.0f max %9.0f, fairness %.3f",
+	       mix, threads, ops_s, base ? ops_s / base : 1.0, min, max,
+	       fairness);
+
+	for (i = 0; i < ARRAY_SIZE(esdm_bench_background); i++) {
+		struct esdm_bench_thread *t = &esdm_bench_background[i];
+
+		if (!t->load)
+			continue;
+		printf(", %s %.0f ops/s",
+		       (t->load == esdm_bench_load_aux) ? "aux" :
+		       (t->load == esdm_bench_load_pr)	? "PR" :
+							  "status",
+		       (double)t->ops * 1e9 / (double)ns);
+	}
+	printf("\n");
+}
+
+/*
+ * Run one configuration - base is the rate of the single calling thread of the
+ * mix which is obtained with the first run of the mix
+ */
+static int esdm_bench_run(const struct esdm_bench_mix *mix, uint32_t threads,
+			  uint32_t cpus, double *base)
+{
+	struct timespec duration = { .tv_sec = 0,
+				     .tv_nsec =
+					     ESDM_BENCH_DURATION_MS * 1000000L };
+	uint32_t background = 0, i;
+	uint64_t start, ns;
+	int ret = 0;
+
+	for (i = 0; i < ARRAY_SIZE(esdm_bench_background); i++) {
+		unsigned int load = 1U << i;
+
+		esdm_bench_background[i].load = (mix->load & load) ? load : 0;
+		if (esdm_bench_background[i].load)
+			background++;
+	}
+
+	if (pthread_barrier_init(&esdm_bench_barrier, NULL,
+				 threads + background + 1))
+		return -EFAULT;
+	atomic_set(&esdm_bench_stop, 0);
+
+	/* The barrier is only passed once all threads are started */
+	for (i = 0; i < threads; i++) {
+		esdm_bench_callers[i].cpu = i % cpus;
+		if (esdm_bench_start(&esdm_bench_callers[i],
+				     esdm_bench_caller)) {
+			printf("Starting calling thread failed\n");
+			exit(1);
+		}
+	}
+	for (i = 0; i < ARRAY_SIZE(esdm_bench_background); i++) {
+		if (!esdm_bench_background[i].load)
+			continue;
+		if (esdm_bench_start(&esdm_bench_background[i],
+				     esdm_bench_load)) {
+			printf("Starting background thread failed\n");
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&esdm_bench_barrier);
+	start = esdm_bench_ns();
+	nanosleep(&duration, NULL);
+	atomic_set(&esdm_bench_stop, 1);
+
+	for (i = 0; i < threads; i++) {
+		pthread_join(esdm_bench_callers[i].tid, NULL);
+		if (esdm_bench_callers[i].ret)
+			ret = esdm_bench_callers[i].ret;
+	}
+	ns = esdm_bench_ns() - start;
+	for (i = 0; i < ARRAY_SIZE(esdm_bench_background); i++) {
+		if (!esdm_bench_background[i].load)
+			continue;
+		pthread_join(esdm_bench_background[i].tid, NULL);
+		if (esdm_bench_background[i].ret)
+			ret = esdm_bench_background[i].ret;
+	}
+
+	pthread_barrier_destroy(&esdm_bench_barrier);
+
+	if (ret) {
+		printf("%s with %u threads: request failed: %d\n", mix->name,
+		       threads, ret);
+		return ret;
+	}
+
+	esdm_bench_print(mix->name, threads, ns, *base);
+
+	/* The single calling thread is the reference of the mix */
+	if (threads == 1) {
+		uint64_t ops = esdm_bench_callers[0].ops;
+
+		*base = (double)ops * 1e9 / (double)(ns ? ns : 1);
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t buf[ESDM_BENCH_REQSIZE];
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t cpus = (online > 0) ? (uint32_t)online : 1;
+	uint32_t max_threads = cpus, threads, i;
+	int ret;
+
+#ifndef ESDM_TESTMODE
+	if (getuid()) {
+		printf("Program must be started as root\n");
+		return 77;
+	}
+#endif
+
+	if (argc > 1) {
+		unsigned long val = strtoul(argv[1], NULL, 10);
+
+		if (!val) {
+			printf("Provide the maximum number of threads\n");
+			return 1;
+		}
+		max_threads = (uint32_t)min_size(val, ESDM_BENCH_MAX_THREADS);
+	}
+	max_threads = min_uint32(max_threads, ESDM_BENCH_MAX_THREADS);
+
+	ret = esdm_init();
+	if (ret)
+		return 1;
+
+	/* Measure the fully seeded DRNGs only */
+	if (esdm_get_random_bytes_full(buf, sizeof(buf)) < 0) {
+		ret = 1;
+		goto out;
+	}
+
+	printf("%u online CPUs, %u bytes per request, %u ms per run\n", cpus,
+	       ESDM_BENCH_REQSIZE, ESDM_BENCH_DURATION_MS);
+
+	for (i = 0; i < ARRAY_SIZE(esdm_bench_mixes); i++) {
+		double base = 0;
+
+		/* 1, 2, 4, ... threads and finally the maximum */
+		for (threads = 1; threads <= max_threads;) {
+			if (esdm_bench_run(&esdm_bench_mixes[i], threads, cpus,
+					   &base)) {
+				ret = 1;
+				goto out;
+			}
+
+			if (threads == max_threads)
+				break;
+			threads = min_uint32(threads * 2, max_threads);
+		}
+	}
+
+out:
+	esdm_fini();
+	return ret;
+}
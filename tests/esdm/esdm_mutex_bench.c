@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "mutex_w.h"
+
+/*
+ * Benchmark of the plain and adaptive mutex_w_t under contention. Every
+ * thread repeatedly takes the lock for a short critical section resembling a
+ * small DRNG generate operation. The test only fails if the lock does not
+ * provide mutual exclusion, the numbers are printed for comparison.
+ */
+
+#define ESDM_BENCH_THREADS 4
+#define ESDM_BENCH_ITER 200000
+#define ESDM_BENCH_WORK 64
+
+static mutex_w_t esdm_bench_lock;
+static volatile uint64_t esdm_bench_counter;
+static volatile uint64_t esdm_bench_state;
+
+static uint64_t esdm_bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *esdm_bench_thread(void *unused)
+{
+	unsigned int i, j;
+
+	(void)unused;
+
+	for (i = 0; i < ESDM_BENCH_ITER; i++) {
+		mutex_w_lock(&esdm_bench_lock);
+		for (j = 0; j < ESDM_BENCH_WORK; j++) {
+			esdm_bench_state = esdm_bench_state *
+						   6364136223846793005ULL +
+					   1442695040888963407ULL;
+		}
+		esdm_bench_counter++;
+		mutex_w_unlock(&esdm_bench_lock);
+	}
+
+	return NULL;
+}
+
+static int esdm_bench_mutex(const char *name, int adaptive)
+{
+	pthread_t threads[ESDM_BENCH_THREADS];
+	unsigned int i, started = 0;
+	uint64_t start, ns;
+	int ret = 0;
+
+	if (adaptive)
+		mutex_w_init_adaptive(&esdm_bench_lock, 0, 1);
+	else
+		mutex_w_init(&esdm_bench_lock, 0, 1);
+	esdm_bench_counter = 0;
+
+	start = esdm_bench_ns();
+	for (i = 0; i < ESDM_BENCH_THREADS; i++) {
+		if (pthread_create(&threads[i], NULL, esdm_bench_thread,
+				   NULL)) {
+			ret = -EFAULT;
+			break;
+		}
+		started++;
+	}
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	ns = esdm_bench_ns() - start;
+
+	mutex_w_destroy(&esdm_bench_lock);
+
+	if (ret)
+		return ret;
+
+	if (esdm_bench_counter !=
+	    (uint64_t)ESDM_BENCH_THREADS * ESDM_BENCH_ITER) {
+		printf("%s: lost updates detected\n", name);
+		return -EFAULT;
+	}
+
+	printf("%s: %u threads: %6llu ns per critical section\n", name,
+	       ESDM_BENCH_THREADS,
+	       (unsigned long long)(ns / esdm_bench_counter));
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = esdm_bench_mutex("plain mutex", 0);
+	if (ret)
+		return -ret;
+
+	ret = esdm_bench_mutex("adaptive mutex", 1);
+
+	return -ret;
+}
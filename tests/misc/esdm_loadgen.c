@@ -0,0 +1,641 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/*
+ * Load generator for the ESDM RPC and CUSE interfaces
+ *
+ * M processes with N threads each issue a mix of requests. In open-loop mode
+ * (--qps) every thread issues its requests at fixed points in time
+ * irrespective of the completion of previous requests. The latency of a
+ * request is measured from its scheduled start time: if the server stalls,
+ * the requests which should have been sent during the stall account the
+ * stall as well (coordinated omission correction). Without --qps, the
+ * threads issue their requests back to back (closed loop).
+ *
+ * Compile:
+ * gcc -Wall -pedantic -Wextra -O2 -o esdm_loadgen esdm_loadgen.c \
+ *	-I<path to esdm_rpc_client.h> -lesdm_rpc_client -lpthread
+ *
+ * Example: 70% get_random_bytes_full, 20% /dev/urandom reads, 10% status
+ * at 5000 requests per second from 4 processes with 8 threads each:
+ * esdm_loadgen -p 4 -t 8 -q 5000 -m full=70,dev=20,status=10
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esdm_rpc_client.h"
+
+enum lg_type {
+	lg_full,
+	lg_min,
+	lg_pr,
+	lg_seed,
+	lg_write,
+	lg_status,
+	lg_dev,
+	lg_types,
+};
+
+static const char *const lg_names[lg_types] = {
+	[lg_full] = "full",	  [lg_min] = "min",	  [lg_pr] = "pr",
+	[lg_seed] = "seed",	  [lg_write] = "write_data",
+	[lg_status] = "status", [lg_dev] = "dev",
+};
+
+#define LG_MAX_PROCS 256
+#define LG_MAX_THREADS 256
+#define LG_MAX_REQSIZE (1U << 20)
+#define LG_SEED_SIZE 1024
+#define LG_STATUS_SIZE 8192
+
+/*
+ * Log-linear latency histogram in nanoseconds: 16 buckets per power of two,
+ * i.e. the relative error of a reported value is at most 6.25%
+ */
+#define LG_SUB_BITS 4
+#define LG_SUB (1U << LG_SUB_BITS)
+#define LG_MAX_EXP 36
+#define LG_BUCKETS ((LG_MAX_EXP - LG_SUB_BITS + 2) * LG_SUB)
+
+struct lg_hist {
+	uint64_t count[LG_BUCKETS];
+	uint64_t max;
+};
+
+/* Results of one process, located in memory shared with the parent */
+struct lg_result {
+	uint64_t requests[lg_types];
+	uint64_t errors[lg_types];
+	uint64_t bytes;
+	uint64_t late;
+	struct lg_hist hist[lg_types];
+};
+
+struct lg_opts {
+	unsigned int procs;
+	unsigned int threads;
+	uint64_t duration_ns;
+	double qps;
+	size_t reqsize;
+	unsigned int weight[lg_types];
+	unsigned int weight_sum;
+	const char *device;
+};
+
+struct lg_thread {
+	const struct lg_opts *opts;
+	struct lg_result result;
+	uint64_t start_ns;
+	unsigned int id;
+	int ret;
+};
+
+static uint64_t lg_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void lg_sleep_until(uint64_t ns)
+{
+	struct timespec ts = { .tv_sec = (time_t)(ns / 1000000000ULL),
+			       .tv_nsec = (long)(ns % 1000000000ULL) };
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+	       EINTR)
+		;
+}
+
+static unsigned int lg_bucket(uint64_t ns)
+{
+	unsigned int e;
+
+	if (ns < LG_SUB)
+		return (unsigned int)ns;
+
+	e = 63 - (unsigned int)__builtin_clzll(ns);
+	if (e > LG_MAX_EXP)
+		return LG_BUCKETS - 1;
+
+	return (e - LG_SUB_BITS + 1) * LG_SUB +
+	       (unsigned int)((ns >> (e - LG_SUB_BITS)) & (LG_SUB - 1));
+}
+
+/* Largest value accounted to the bucket */
+static uint64_t lg_bucket_value(unsigned int idx)
+{
+	unsigned int shift;
+
+	if (idx < LG_SUB)
+		return idx;
+
+	shift = idx / LG_SUB - 1;
+	return ((uint64_t)(LG_SUB + idx % LG_SUB + 1) << shift) - 1;
+}
+
+static void lg_hist_record(struct lg_hist *hist, uint64_t ns)
+{
+	hist->count[lg_bucket(ns)]++;
+	if (ns > hist->max)
+		hist->max = ns;
+}
+
+static void lg_hist_merge(struct lg_hist *dst, const struct lg_hist *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < LG_BUCKETS; i++)
+		dst->count[i] += src->count[i];
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+static uint64_t lg_hist_total(const struct lg_hist *hist)
+{
+	uint64_t total = 0;
+	unsigned int i;
+
+	for (i = 0; i < LG_BUCKETS; i++)
+		total += hist->count[i];
+
+	return total;
+}
+
+static uint64_t lg_hist_quantile(const struct lg_hist *hist,
+				 unsigned int permille)
+{
+	uint64_t total = lg_hist_total(hist), rank, sum = 0, val;
+	unsigned int i;
+
+	if (!total)
+		return 0;
+
+	rank = (total * permille + 999) / 1000;
+	if (!rank)
+		rank = 1;
+
+	for (i = 0; i < LG_BUCKETS - 1; i++) {
+		sum += hist->count[i];
+		if (sum >= rank)
+			break;
+	}
+
+	val = lg_bucket_value(i);
+	return val < hist->max ? val : hist->max;
+}
+
+static void lg_result_merge(struct lg_result *dst, const struct lg_result *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < lg_types; i++) {
+		dst->requests[i] += src->requests[i];
+		dst->errors[i] += src->errors[i];
+		lg_hist_merge(&dst->hist[i], &src->hist[i]);
+	}
+	dst->bytes += src->bytes;
+	dst->late += src->late;
+}
+
+/* xorshift64* - only used to pick the request types */
+static uint64_t lg_rand(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static enum lg_type lg_pick(const struct lg_opts *opts, uint64_t *state)
+{
+	unsigned int i, r = (unsigned int)(lg_rand(state) >> 32) %
+			    opts->weight_sum;
+
+	for (i = 0; i < lg_types - 1; i++) {
+		if (r < opts->weight[i])
+			break;
+		r -= opts->weight[i];
+	}
+
+	return (enum lg_type)i;
+}
+
+static ssize_t lg_request(enum lg_type type, const struct lg_opts *opts,
+			  uint8_t *buf, char *status, int fd)
+{
+	ssize_t ret;
+
+	switch (type) {
+	case lg_full:
+		return esdm_rpcc_get_random_bytes_full(buf, opts->reqsize);
+	case lg_min:
+		return esdm_rpcc_get_random_bytes_min(buf, opts->reqsize);
+	case lg_pr:
+		return esdm_rpcc_get_random_bytes_pr(buf, opts->reqsize);
+	case lg_seed:
+		return esdm_rpcc_get_seed(buf, LG_SEED_SIZE,
+					  ESDM_GET_SEED_NONBLOCK);
+	case lg_write:
+		ret = esdm_rpcc_write_data(buf, opts->reqsize);
+		return ret ? ret : (ssize_t)opts->reqsize;
+	case lg_status:
+		return esdm_rpcc_status(status, LG_STATUS_SIZE);
+	case lg_dev:
+		ret = read(fd, buf, opts->reqsize);
+		return ret < 0 ? -errno : ret;
+	case lg_types:
+	default:
+		return -EINVAL;
+	}
+}
+
+static void *lg_thread(void *arg)
+{
+	struct lg_thread *t = arg;
+	const struct lg_opts *opts = t->opts;
+	struct lg_result *res = &t->result;
+	uint64_t interval = 0, next, end, now, done;
+	uint64_t state = lg_now() ^ ((uint64_t)getpid() << 32) ^ t->id;
+	uint8_t *buf;
+	char *status;
+	int fd = -1;
+
+	buf = calloc(1, opts->reqsize > LG_SEED_SIZE ? opts->reqsize :
+						       LG_SEED_SIZE);
+	status = malloc(LG_STATUS_SIZE);
+	if (!buf || !status) {
+		t->ret = -ENOMEM;
+		goto out;
+	}
+
+	if (opts->weight[lg_dev]) {
+		fd = open(opts->device, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			t->ret = -errno;
+			fprintf(stderr, "Cannot open %s: %s\n", opts->device,
+				strerror(errno));
+			goto out;
+		}
+	}
+
+	/* Spread the schedules of all threads over one interval */
+	next = t->start_ns;
+	if (opts->qps > 0) {
+		interval = (uint64_t)(1e9 * opts->procs * opts->threads /
+				      opts->qps);
+		if (!interval)
+			interval = 1;
+		next += interval * t->id / (opts->procs * opts->threads);
+	}
+	end = t->start_ns + opts->duration_ns;
+
+	lg_sleep_until(next);
+	for (;;) {
+		enum lg_type type = lg_pick(opts, &state);
+		ssize_t ret;
+
+		now = lg_now();
+		if (interval) {
+			if (next >= end)
+				break;
+			if (now < next)
+				lg_sleep_until(next);
+			else if (now - next > interval)
+				res->late++;
+		} else {
+			if (now >= end)
+				break;
+			next = now;
+		}
+
+		ret = lg_request(type, opts, buf, status, fd);
+		done = lg_now();
+
+		res->requests[type]++;
+		if (ret < 0)
+			res->errors[type]++;
+		else if (type != lg_write)
+			res->bytes += (uint64_t)ret;
+
+		/* Open loop: measured from the scheduled start */
+		lg_hist_record(&res->hist[type], done - next);
+
+		next += interval;
+	}
+
+out:
+	if (fd >= 0)
+		close(fd);
+	free(status);
+	free(buf);
+	return NULL;
+}
+
+/* Body of one client process */
+static int lg_process(const struct lg_opts *opts, unsigned int proc,
+		      uint64_t start_ns, struct lg_result *result)
+{
+	struct lg_thread *t;
+	pthread_t *tid;
+	unsigned int i, started = 0;
+	int ret = 0;
+
+	t = calloc(opts->threads, sizeof(*t));
+	tid = calloc(opts->threads, sizeof(*tid));
+	if (!t || !tid) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < opts->threads; i++) {
+		t[i].opts = opts;
+		t[i].start_ns = start_ns;
+		t[i].id = proc * opts->threads + i;
+		if (pthread_create(&tid[i], NULL, lg_thread, &t[i])) {
+			ret = -EFAULT;
+			break;
+		}
+		started++;
+	}
+
+	for (i = 0; i < started; i++) {
+		pthread_join(tid[i], NULL);
+		lg_result_merge(result, &t[i].result);
+		if (t[i].ret && !ret)
+			ret = t[i].ret;
+	}
+
+	esdm_rpcc_fini_unpriv_service();
+
+out:
+	free(tid);
+	free(t);
+	return ret;
+}
+
+static void lg_print_line(const char *name, const struct lg_hist *hist,
+			  uint64_t requests, uint64_t errors, double seconds)
+{
+	printf("%-10s %10llu %8llu %10.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+	       name, (unsigned long long)requests, (unsigned long long)errors,
+	       (double)requests / seconds,
+	       (double)lg_hist_quantile(hist, 500) / 1000.0,
+	       (double)lg_hist_quantile(hist, 900) / 1000.0,
+	       (double)lg_hist_quantile(hist, 990) / 1000.0,
+	       (double)lg_hist_quantile(hist, 999) / 1000.0,
+	       (double)hist->max / 1000.0);
+}
+
+/* The throughput refers to the elapsed time including the backlog */
+static void lg_report(const struct lg_opts *opts,
+		      const struct lg_result *res, uint64_t elapsed_ns)
+{
+	double seconds = (double)elapsed_ns / 1e9;
+	struct lg_hist all;
+	uint64_t requests = 0, errors = 0;
+	unsigned int i;
+
+	memset(&all, 0, sizeof(all));
+
+	if (opts->qps > 0) {
+		printf("Open loop at %.1f requests/s, latency measured from the scheduled start\n",
+		       opts->qps);
+	} else {
+		printf("Closed loop, latency measured from the request start\n");
+	}
+	printf("%u processes x %u threads, %.1f s (elapsed %.1f s), request size %zu bytes\n\n",
+	       opts->procs, opts->threads, (double)opts->duration_ns / 1e9,
+	       seconds, opts->reqsize);
+
+	printf("%-10s %10s %8s %10s %9s %9s %9s %9s %9s\n", "type",
+	       "requests", "errors", "req/s", "p50 us", "p90 us", "p99 us",
+	       "p999 us", "max us");
+	for (i = 0; i < lg_types; i++) {
+		if (!opts->weight[i])
+			continue;
+
+		lg_print_line(lg_names[i], &res->hist[i], res->requests[i],
+			      res->errors[i], seconds);
+		lg_hist_merge(&all, &res->hist[i]);
+		requests += res->requests[i];
+		errors += res->errors[i];
+	}
+	lg_print_line("total", &all, requests, errors, seconds);
+
+	printf("\nRandom data: %.2f MiB/s\n",
+	       (double)res->bytes / seconds / 1048576.0);
+	if (opts->qps > 0) {
+		printf("Requests started more than one interval late: %llu\n",
+		       (unsigned long long)res->late);
+	}
+}
+
+static int lg_parse_mix(struct lg_opts *opts, const char *arg)
+{
+	char *copy = strdup(arg), *tok, *save = NULL;
+	unsigned int i;
+	int ret = 0;
+
+	if (!copy)
+		return -ENOMEM;
+
+	memset(opts->weight, 0, sizeof(opts->weight));
+	opts->weight_sum = 0;
+
+	for (tok = strtok_r(copy, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		char *val = strchr(tok, '=');
+		unsigned long w;
+
+		if (!val) {
+			ret = -EINVAL;
+			goto out;
+		}
+		*val++ = '\0';
+
+		for (i = 0; i < lg_types; i++) {
+			if (!strcmp(tok, lg_names[i]))
+				break;
+		}
+		w = strtoul(val, NULL, 10);
+		if (i == lg_types || w > 1000000) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		opts->weight[i] = (unsigned int)w;
+		opts->weight_sum += (unsigned int)w;
+	}
+
+	if (!opts->weight_sum)
+		ret = -EINVAL;
+
+out:
+	if (ret)
+		fprintf(stderr, "Invalid request mix: %s\n", arg);
+	free(copy);
+	return ret;
+}
+
+static void lg_usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"\t-p --procs <num>\tnumber of client processes (default 1)\n"
+		"\t-t --threads <num>\tthreads per process (default 1)\n"
+		"\t-d --duration <sec>\tduration of the test (default 10)\n"
+		"\t-q --qps <num>\t\ttotal target requests per second, open loop\n"
+		"\t\t\t\t(default 0: closed loop)\n"
+		"\t-s --size <bytes>\trandom bytes per request (default 32)\n"
+		"\t-m --mix <type=weight,...>\trequest mix (default full=1)\n"
+		"\t\t\t\ttypes: full, min, pr, seed, write_data, status, dev\n"
+		"\t-D --device <path>\tdevice read by the dev type\n"
+		"\t\t\t\t(default /dev/urandom)\n",
+		name);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "procs", 1, 0, 'p' },	   { "threads", 1, 0, 't' },
+		{ "duration", 1, 0, 'd' }, { "qps", 1, 0, 'q' },
+		{ "size", 1, 0, 's' },	   { "mix", 1, 0, 'm' },
+		{ "device", 1, 0, 'D' },   { 0, 0, 0, 0 }
+	};
+	struct lg_opts opts = { .procs = 1,
+				.threads = 1,
+				.duration_ns = 10000000000ULL,
+				.reqsize = 32,
+				.device = "/dev/urandom" };
+	struct lg_result *results, total;
+	uint64_t start_ns;
+	unsigned int i;
+	pid_t *pids;
+	int c, ret = 0;
+
+	opts.weight[lg_full] = 1;
+	opts.weight_sum = 1;
+
+	while ((c = getopt_long(argc, argv, "p:t:d:q:s:m:D:", options,
+				NULL)) != -1) {
+		switch (c) {
+		case 'p':
+			opts.procs = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			opts.threads = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			opts.duration_ns = strtoull(optarg, NULL, 10) *
+					   1000000000ULL;
+			break;
+		case 'q':
+			opts.qps = strtod(optarg, NULL);
+			break;
+		case 's':
+			opts.reqsize = strtoul(optarg, NULL, 10);
+			break;
+		case 'm':
+			if (lg_parse_mix(&opts, optarg))
+				return EXIT_FAILURE;
+			break;
+		case 'D':
+			opts.device = optarg;
+			break;
+		default:
+			lg_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!opts.procs || opts.procs > LG_MAX_PROCS || !opts.threads ||
+	    opts.threads > LG_MAX_THREADS || !opts.duration_ns ||
+	    opts.qps < 0 || !opts.reqsize || opts.reqsize > LG_MAX_REQSIZE) {
+		lg_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* The children report their results through shared memory */
+	results = mmap(NULL, opts.procs * sizeof(*results),
+		       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1,
+		       0);
+	pids = calloc(opts.procs, sizeof(*pids));
+	if (results == MAP_FAILED || !pids) {
+		fprintf(stderr, "Memory allocation failed\n");
+		return EXIT_FAILURE;
+	}
+	memset(results, 0, opts.procs * sizeof(*results));
+
+	/* All processes start at the same time after setting up */
+	start_ns = lg_now() + 200000000ULL;
+
+	for (i = 0; i < opts.procs; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			fprintf(stderr, "fork failed: %s\n", strerror(errno));
+			ret = -errno;
+			break;
+		}
+		if (!pids[i]) {
+			ret = lg_process(&opts, i, start_ns, &results[i]);
+			_exit(ret ? EXIT_FAILURE : EXIT_SUCCESS);
+		}
+	}
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < opts.procs; i++) {
+		int wstatus;
+
+		if (pids[i] <= 0)
+			continue;
+
+		if (waitpid(pids[i], &wstatus, 0) < 0 || !WIFEXITED(wstatus) ||
+		    WEXITSTATUS(wstatus) != EXIT_SUCCESS) {
+			fprintf(stderr, "Client process %u failed\n", i);
+			ret = -EFAULT;
+		}
+		lg_result_merge(&total, &results[i]);
+	}
+
+	lg_report(&opts, &total, lg_now() - start_ns);
+
+	munmap(results, opts.procs * sizeof(*results));
+	free(pids);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
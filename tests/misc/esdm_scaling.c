@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/*
+ * Scaling harness comparing the ESDM paths with the kernel getrandom
+ *
+ * For every path and thread count, the threads are pinned to the given CPUs
+ * (round robin), released together and generate random numbers for a fixed
+ * duration. Around the loop, every thread reads its perf_event_open counters
+ * for cycles, instructions, cache misses and context switches. The counters
+ * cover the calling threads only, not the ESDM server. If the kernel does
+ * not permit counting kernel space, only user space is counted which is
+ * marked in the report.
+ *
+ * Paths:
+ *	kernel		getrandom system call (baseline)
+ *	interposer	getrandom of libesdm_getrandom, loaded with dlopen
+ *	rpc		esdm_rpcc_get_random_bytes_full of libesdm_rpc_client
+ *	cuse		read of the device served by esdm-cuse-urandom
+ *
+ * The ESDM libraries are loaded at runtime, the tool therefore does not need
+ * the ESDM header files.
+ *
+ * Compile:
+ * gcc -Wall -pedantic -Wextra -O2 -o esdm_scaling esdm_scaling.c \
+ *	-lpthread -ldl
+ *
+ * Example: compare all paths with 32 byte requests on CPUs 0 to 7 with 1, 2,
+ * 4 and 8 threads:
+ * esdm_scaling -s 32 -c 0-7 -t 1,2,4,8
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+enum sc_path {
+	sc_kernel,
+	sc_interposer,
+	sc_rpc,
+	sc_cuse,
+	sc_paths,
+};
+
+static const char *const sc_path_names[sc_paths] = {
+	[sc_kernel] = "kernel",
+	[sc_interposer] = "interposer",
+	[sc_rpc] = "rpc",
+	[sc_cuse] = "cuse",
+};
+
+enum sc_counter {
+	sc_cycles,
+	sc_instructions,
+	sc_cache_misses,
+	sc_ctx_switches,
+	sc_counters,
+};
+
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} sc_counter_def[sc_counters] = {
+	[sc_cycles] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	[sc_instructions] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	[sc_cache_misses] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	[sc_ctx_switches] = { PERF_TYPE_SOFTWARE,
+			      PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+#define SC_MAX_THREADS 256
+#define SC_MAX_CPUS 1024
+#define SC_MAX_REQSIZE (1U << 20)
+
+struct sc_opts {
+	uint64_t duration_ns;
+	size_t reqsize;
+	unsigned int threads[SC_MAX_THREADS];
+	unsigned int nthreads;
+	unsigned int cpus[SC_MAX_CPUS];
+	unsigned int ncpus;
+	int paths[sc_paths];
+	const char *interposer_lib;
+	const char *rpc_lib;
+	const char *device;
+};
+
+/* Functions of the ESDM libraries */
+static ssize_t (*sc_interposer_getrandom)(void *buf, size_t len,
+					  unsigned int flags);
+static ssize_t (*sc_rpc_get_random_bytes_full)(uint8_t *buf, size_t len);
+
+/* Set if a counter could only be opened for user space */
+static int sc_user_only = 0;
+
+struct sc_sync {
+	unsigned int ready;
+	int go;
+	int stop;
+};
+
+struct sc_thread {
+	const struct sc_opts *opts;
+	struct sc_sync *sync;
+	enum sc_path path;
+	unsigned int cpu;
+	uint64_t requests;
+	uint64_t counter[sc_counters];
+	int counter_valid[sc_counters];
+	int ret;
+};
+
+static uint64_t sc_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int sc_perf_open(enum sc_counter counter)
+{
+	struct perf_event_attr attr;
+	int fd;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = sc_counter_def[counter].type;
+	attr.config = sc_counter_def[counter].config;
+	attr.disabled = 1;
+	attr.exclude_hv = 1;
+
+	fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+			  PERF_FLAG_FD_CLOEXEC);
+	if (fd >= 0 || (errno != EACCES && errno != EPERM))
+		return fd;
+
+	/* perf_event_paranoid may only permit counting user space */
+	attr.exclude_kernel = 1;
+	fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+			  PERF_FLAG_FD_CLOEXEC);
+	if (fd >= 0)
+		__atomic_store_n(&sc_user_only, 1, __ATOMIC_RELAXED);
+	return fd;
+}
+
+/* Fill the entire buffer with the given path */
+static int sc_generate(enum sc_path path, int devfd, uint8_t *buf, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t ret;
+
+		switch (path) {
+		case sc_kernel:
+			ret = syscall(SYS_getrandom, buf + done, len - done, 0);
+			break;
+		case sc_interposer:
+			ret = sc_interposer_getrandom(buf + done, len - done,
+						      0);
+			break;
+		case sc_rpc:
+			ret = sc_rpc_get_random_bytes_full(buf + done,
+							   len - done);
+			/* The RPC call reports its error as return code */
+			if (ret < 0)
+				return (int)ret;
+			break;
+		case sc_cuse:
+			ret = read(devfd, buf + done, len - done);
+			break;
+		case sc_paths:
+		default:
+			return -EINVAL;
+		}
+
+		if (ret < 0)
+			return errno == EINTR ? 0 : -errno;
+		if (!ret)
+			return -EIO;
+		done += (size_t)ret;
+	}
+
+	return 0;
+}
+
+static void *sc_thread(void *arg)
+{
+	struct sc_thread *t = arg;
+	int fds[sc_counters];
+	cpu_set_t set;
+	uint8_t *buf;
+	int devfd = -1;
+	unsigned int i;
+
+	CPU_ZERO(&set);
+	CPU_SET(t->cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+		t->ret = -EINVAL;
+
+	buf = malloc(t->opts->reqsize);
+	if (!buf)
+		t->ret = -ENOMEM;
+
+	if (!t->ret && t->path == sc_cuse) {
+		devfd = open(t->opts->device, O_RDONLY | O_CLOEXEC);
+		if (devfd < 0)
+			t->ret = -errno;
+	}
+
+	for (i = 0; i < sc_counters; i++)
+		fds[i] = sc_perf_open((enum sc_counter)i);
+
+	/* Wait until all threads are set up */
+	__atomic_add_fetch(&t->sync->ready, 1, __ATOMIC_RELEASE);
+	while (!__atomic_load_n(&t->sync->go, __ATOMIC_ACQUIRE))
+		sched_yield();
+
+	for (i = 0; i < sc_counters; i++) {
+		if (fds[i] < 0)
+			continue;
+		ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	while (!t->ret && !__atomic_load_n(&t->sync->stop, __ATOMIC_RELAXED)) {
+		t->ret = sc_generate(t->path, devfd, buf, t->opts->reqsize);
+		if (!t->ret)
+			t->requests++;
+	}
+
+	for (i = 0; i < sc_counters; i++) {
+		if (fds[i] < 0)
+			continue;
+		ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		if (read(fds[i], &t->counter[i], sizeof(t->counter[i])) ==
+		    (ssize_t)sizeof(t->counter[i]))
+			t->counter_valid[i] = 1;
+		close(fds[i]);
+	}
+
+	if (devfd >= 0)
+		close(devfd);
+	free(buf);
+
+	return NULL;
+}
+
+static void sc_print_counter(const struct sc_thread *t, unsigned int threads,
+			     enum sc_counter counter, uint64_t requests)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < threads; i++) {
+		if (!t[i].counter_valid[counter]) {
+			printf(" %10s", "n/a");
+			return;
+		}
+		sum += t[i].counter[counter];
+	}
+
+	/* Context switches are reported in total, all others per request */
+	if (counter == sc_ctx_switches)
+		printf(" %10llu", (unsigned long long)sum);
+	else
+		printf(" %10.1f",
+		       requests ? (double)sum / (double)requests : 0.0);
+}
+
+/*
+ * Run one measurement and print its line.
+ *
+ * @return throughput in bytes per second, 0 on error
+ */
+static double sc_measure(const struct sc_opts *opts, enum sc_path path,
+			 unsigned int threads, double baseline)
+{
+	static struct sc_thread t[SC_MAX_THREADS];
+	pthread_t tid[SC_MAX_THREADS];
+	struct timespec ts = {
+		.tv_sec = (time_t)(opts->duration_ns / 1000000000ULL),
+		.tv_nsec = (long)(opts->duration_ns % 1000000000ULL)
+	};
+	struct sc_sync sync = { 0 };
+	uint64_t start, ns, requests = 0;
+	unsigned int i, started = 0;
+	double bps;
+	int ret = 0;
+
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < threads; i++) {
+		t[i].opts = opts;
+		t[i].sync = &sync;
+		t[i].path = path;
+		t[i].cpu = opts->cpus[i % opts->ncpus];
+		if (pthread_create(&tid[i], NULL, sc_thread, &t[i])) {
+			ret = -EFAULT;
+			break;
+		}
+		started++;
+	}
+
+	while (__atomic_load_n(&sync.ready, __ATOMIC_ACQUIRE) < started)
+		sched_yield();
+
+	/* Do not measure if not all threads could be started */
+	if (ret)
+		__atomic_store_n(&sync.stop, 1, __ATOMIC_RELAXED);
+
+	start = sc_now();
+	__atomic_store_n(&sync.go, 1, __ATOMIC_RELEASE);
+	if (!ret)
+		nanosleep(&ts, NULL);
+	__atomic_store_n(&sync.stop, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < started; i++)
+		pthread_join(tid[i], NULL);
+	ns = sc_now() - start;
+
+	for (i = 0; i < started; i++) {
+		if (t[i].ret && !ret)
+			ret = t[i].ret;
+		requests += t[i].requests;
+	}
+
+	if (ret) {
+		printf("%-10s %7u  failed: %s\n", sc_path_names[path], threads,
+		       strerror(-ret));
+		return 0;
+	}
+	if (!ns)
+		ns = 1;
+
+	bps = ((double)requests * (double)opts->reqsize * 1e9) / (double)ns;
+	printf("%-10s %7u %10.2f %10llu", sc_path_names[path], threads,
+	       bps / 1048576.0,
+	       (unsigned long long)(requests ? ns * threads / requests : 0));
+	for (i = 0; i < sc_counters; i++)
+		sc_print_counter(t, threads, (enum sc_counter)i, requests);
+	if (baseline > 0)
+		printf(" %7.2f\n", bps / baseline);
+	else
+		printf(" %7s\n", "-");
+	fflush(stdout);
+
+	return bps;
+}
+
+/* Parse a list of numbers and ranges, e.g. "0-3,8" */
+static int sc_parse_list(const char *arg, unsigned int *list, unsigned int max,
+			 unsigned int *num)
+{
+	const char *p = arg;
+
+	*num = 0;
+	while (*p) {
+		unsigned long first, last;
+		char *end;
+
+		first = strtoul(p, &end, 10);
+		if (end == p)
+			return -EINVAL;
+		last = first;
+		p = end;
+		if (*p == '-') {
+			last = strtoul(p + 1, &end, 10);
+			if (end == p + 1 || last < first)
+				return -EINVAL;
+			p = end;
+		}
+
+		for (; first <= last; first++) {
+			if (*num >= max || first > UINT32_MAX)
+				return -EINVAL;
+			list[(*num)++] = (unsigned int)first;
+		}
+
+		if (*p == ',')
+			p++;
+		else if (*p)
+			return -EINVAL;
+	}
+
+	return *num ? 0 : -EINVAL;
+}
+
+static int sc_parse_paths(struct sc_opts *opts, const char *arg)
+{
+	char *copy = strdup(arg), *tok, *save = NULL;
+	int ret = 0;
+
+	if (!copy)
+		return -ENOMEM;
+
+	memset(opts->paths, 0, sizeof(opts->paths));
+	for (tok = strtok_r(copy, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		unsigned int i;
+
+		for (i = 0; i < sc_paths; i++) {
+			if (!strcmp(tok, sc_path_names[i]))
+				break;
+		}
+		if (i == sc_paths) {
+			fprintf(stderr, "Unknown path %s\n", tok);
+			ret = -EINVAL;
+			break;
+		}
+		opts->paths[i] = 1;
+	}
+
+	free(copy);
+	return ret;
+}
+
+/* All CPUs the process may run on */
+static void sc_default_cpus(struct sc_opts *opts)
+{
+	cpu_set_t set;
+	unsigned int i;
+
+	opts->ncpus = 0;
+	if (sched_getaffinity(0, sizeof(set), &set)) {
+		opts->cpus[opts->ncpus++] = 0;
+		return;
+	}
+
+	for (i = 0; i < CPU_SETSIZE && opts->ncpus < SC_MAX_CPUS; i++) {
+		if (CPU_ISSET(i, &set))
+			opts->cpus[opts->ncpus++] = i;
+	}
+}
+
+/* Powers of two up to the number of CPUs */
+static void sc_default_threads(struct sc_opts *opts)
+{
+	unsigned int threads;
+
+	opts->nthreads = 0;
+	for (threads = 1; threads <= opts->ncpus && threads <= SC_MAX_THREADS;
+	     threads <<= 1)
+		opts->threads[opts->nthreads++] = threads;
+	if (opts->threads[opts->nthreads - 1] != opts->ncpus &&
+	    opts->ncpus <= SC_MAX_THREADS)
+		opts->threads[opts->nthreads++] = opts->ncpus;
+}
+
+static int sc_load(struct sc_opts *opts)
+{
+	int (*rpc_init)(void *interrupt_func);
+	void *handle;
+
+	if (opts->paths[sc_interposer]) {
+		handle = dlopen(opts->interposer_lib, RTLD_NOW | RTLD_LOCAL);
+		if (handle)
+			*(void **)&sc_interposer_getrandom =
+				dlsym(handle, "getrandom");
+		if (!sc_interposer_getrandom) {
+			fprintf(stderr, "Skipping interposer: %s\n", dlerror());
+			opts->paths[sc_interposer] = 0;
+		}
+	}
+
+	if (opts->paths[sc_rpc]) {
+		rpc_init = NULL;
+		handle = dlopen(opts->rpc_lib, RTLD_NOW | RTLD_LOCAL);
+		if (handle) {
+			*(void **)&rpc_init =
+				dlsym(handle, "esdm_rpcc_init_unpriv_service");
+			*(void **)&sc_rpc_get_random_bytes_full =
+				dlsym(handle,
+				      "esdm_rpcc_get_random_bytes_full");
+		}
+		if (!rpc_init || !sc_rpc_get_random_bytes_full) {
+			fprintf(stderr, "Skipping rpc: %s\n", dlerror());
+			opts->paths[sc_rpc] = 0;
+		} else if (rpc_init(NULL)) {
+			fprintf(stderr,
+				"Skipping rpc: initialization failed\n");
+			opts->paths[sc_rpc] = 0;
+		}
+	}
+
+	if (opts->paths[sc_cuse] && access(opts->device, R_OK)) {
+		fprintf(stderr, "Skipping cuse: %s: %s\n", opts->device,
+			strerror(errno));
+		opts->paths[sc_cuse] = 0;
+	}
+
+	return 0;
+}
+
+static void sc_usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"\t-d --duration <msec>\tduration of each measurement\n"
+		"\t\t\t\t(default 1000)\n"
+		"\t-s --size <bytes>\trandom bytes per request (default 32)\n"
+		"\t-t --threads <list>\tthread counts, e.g. 1,2,4-6\n"
+		"\t\t\t\t(default powers of 2 up to the CPUs)\n"
+		"\t-c --cpus <list>\tCPUs the threads are pinned to, e.g. 0-7\n"
+		"\t\t\t\t(default all CPUs of the process)\n"
+		"\t-p --paths <list>\tpaths to compare with the baseline:\n"
+		"\t\t\t\tkernel, interposer, rpc, cuse (default all)\n"
+		"\t-I --interposer <lib>\tlibrary for the interposer path\n"
+		"\t\t\t\t(default libesdm_getrandom.so)\n"
+		"\t-R --rpc-lib <lib>\tlibrary for the rpc path\n"
+		"\t\t\t\t(default libesdm_rpc_client.so)\n"
+		"\t-D --device <path>\tdevice read by the cuse path\n"
+		"\t\t\t\t(default /dev/urandom)\n",
+		name);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option options[] = {
+		{ "duration", 1, 0, 'd' },   { "size", 1, 0, 's' },
+		{ "threads", 1, 0, 't' },    { "cpus", 1, 0, 'c' },
+		{ "paths", 1, 0, 'p' },	     { "interposer", 1, 0, 'I' },
+		{ "rpc-lib", 1, 0, 'R' },    { "device", 1, 0, 'D' },
+		{ 0, 0, 0, 0 }
+	};
+	static struct sc_opts opts = {
+		.duration_ns = 1000000000ULL,
+		.reqsize = 32,
+		.paths = { 1, 1, 1, 1 },
+		.interposer_lib = "libesdm_getrandom.so",
+		.rpc_lib = "libesdm_rpc_client.so",
+		.device = "/dev/urandom",
+	};
+	double baseline[SC_MAX_THREADS];
+	unsigned int i, p;
+	int c;
+
+	sc_default_cpus(&opts);
+
+	while ((c = getopt_long(argc, argv, "d:s:t:c:p:I:R:D:", options,
+				NULL)) != -1) {
+		switch (c) {
+		case 'd':
+			opts.duration_ns = strtoull(optarg, NULL, 10) *
+					   1000000ULL;
+			break;
+		case 's':
+			opts.reqsize = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			if (sc_parse_list(optarg, opts.threads, SC_MAX_THREADS,
+					  &opts.nthreads))
+				goto usage;
+			break;
+		case 'c':
+			if (sc_parse_list(optarg, opts.cpus, SC_MAX_CPUS,
+					  &opts.ncpus))
+				goto usage;
+			break;
+		case 'p':
+			if (sc_parse_paths(&opts, optarg))
+				goto usage;
+			break;
+		case 'I':
+			opts.interposer_lib = optarg;
+			break;
+		case 'R':
+			opts.rpc_lib = optarg;
+			break;
+		case 'D':
+			opts.device = optarg;
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (!opts.duration_ns || !opts.reqsize ||
+	    opts.reqsize > SC_MAX_REQSIZE)
+		goto usage;
+	if (!opts.nthreads)
+		sc_default_threads(&opts);
+	for (i = 0; i < opts.nthreads; i++) {
+		if (!opts.threads[i] || opts.threads[i] > SC_MAX_THREADS)
+			goto usage;
+	}
+
+	/* The baseline is always measured */
+	opts.paths[sc_kernel] = 1;
+	sc_load(&opts);
+
+	printf("# request size %zu bytes, %llu ms per measurement, CPUs",
+	       opts.reqsize, (unsigned long long)(opts.duration_ns / 1000000));
+	for (i = 0; i < opts.ncpus; i++)
+		printf("%s%u", i ? "," : " ", opts.cpus[i]);
+	printf("\n# counters per request except ctxsw (total), rel: "
+	       "throughput relative to kernel\n");
+	printf("%-10s %7s %10s %10s %10s %10s %10s %10s %7s\n", "path",
+	       "threads", "MiB/s", "ns/req", "cycles", "instr", "cmiss",
+	       "ctxsw", "rel");
+
+	for (p = 0; p < sc_paths; p++) {
+		if (!opts.paths[p])
+			continue;
+
+		for (i = 0; i < opts.nthreads; i++) {
+			double bps = sc_measure(&opts, (enum sc_path)p,
+						opts.threads[i],
+						p == sc_kernel ? 0 :
+								 baseline[i]);
+
+			if (p == sc_kernel)
+				baseline[i] = bps;
+		}
+	}
+
+	if (sc_user_only)
+		printf("# kernel space not counted (perf_event_paranoid)\n");
+
+	return EXIT_SUCCESS;
+
+usage:
+	sc_usage(argv[0]);
+	return EXIT_FAILURE;
+}
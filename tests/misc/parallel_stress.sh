@@ -18,8 +18,14 @@
 # DAMAGE.
 #
 # Stress test for parallel reads.
+#
+# When setting ESDM_STRESS_PERF, the cache behavior of the ESDM server is
+# recorded with perf during the stress test. Comparing the cache misses
+# between two builds shows the impact of, e.g., false sharing.
 
 SPEED="./speedtest"
+PERF_OUT="./parallel_stress.perf"
+PERF_EVENTS="cache-references,cache-misses,L1-dcache-load-misses,LLC-load-misses"
 
 # Count the available CPUs nodes
 CPUS=$(lscpu -b -p | grep -v "#" | wc -l)
@@ -45,9 +51,47 @@ cleanup() {
 		i=$(($i+1))
 	done
 
+	perf_stop
+
 	rm -f $SPEED
 }
 
+perf_start() {
+	if [ -z "$ESDM_STRESS_PERF" ]
+	then
+		return
+	fi
+
+	local pid=$(pidof esdm-server)
+
+	if [ -z "$pid" ] || ! (type perf > /dev/null 2>&1)
+	then
+		echo "Performance counters unavailable - perf or esdm-server missing"
+		return
+	fi
+
+	# Not started as a job of this shell as the stress test waits for all
+	perf_pid=$(perf stat -e $PERF_EVENTS -p $pid -o $PERF_OUT \
+		   > /dev/null 2>&1 & echo $!)
+}
+
+perf_stop() {
+	if [ -z "$perf_pid" ]
+	then
+		return
+	fi
+
+	kill -INT $perf_pid > /dev/null 2>&1
+	while kill -0 $perf_pid > /dev/null 2>&1
+	do
+		sleep 1
+	done
+	perf_pid=""
+
+	cat $PERF_OUT
+	rm -f $PERF_OUT
+}
+
 init() {
 	trap "cleanup; exit $?" 0 1 2 3 15
 	gcc -Wall -pedantic -Wextra -Wl,--wrap=getrandom,--wrap=getentropy -lesdm-getrandom -L../../build/frontents/getrandom -o $SPEED ${SPEED}.c
@@ -82,6 +126,7 @@ then
 	exit 77
 fi
 
+perf_start
 
 # Start reading on all CPUs
 while [ $urandom -lt $CPUS ]
@@ -133,6 +178,8 @@ done
 
 wait
 
+perf_stop
+
 ret=0
 
 if ! (ps -efa | grep -v grep | grep -q esdm-cuse-random)
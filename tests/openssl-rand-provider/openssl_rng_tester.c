@@ -23,6 +23,7 @@
 #include <openssl/provider.h>
 #include <openssl/rand.h>
 #include <openssl/rsa.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -48,6 +49,47 @@ static bool test_random(void)
 	return true;
 }
 
+#define TEST_THREADS 8
+
+static void *test_random_thread(void *arg)
+{
+	unsigned char bytes[64];
+	unsigned int i;
+
+	(void)arg;
+
+	/* All threads share the public DRBG of OpenSSL */
+	for (i = 0; i < 1000; i++) {
+		if (RAND_bytes(bytes, sizeof(bytes)) != 1)
+			return (void *)1;
+	}
+
+	return NULL;
+}
+
+static bool test_random_threads(void)
+{
+	pthread_t threads[TEST_THREADS];
+	unsigned int i, started;
+	bool success = true;
+	void *res;
+
+	for (started = 0; started < TEST_THREADS; started++) {
+		if (pthread_create(&threads[started], NULL, test_random_thread,
+				   NULL)) {
+			success = false;
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		if (pthread_join(threads[i], &res) || res)
+			success = false;
+	}
+
+	return success;
+}
+
 static bool test_instantiate(bool prediction_resistance)
 {
 	const size_t buffer_size = 100;
@@ -127,6 +169,8 @@ static bool performTest(char *test, char *type)
 			return false;
 	}
 
+	if (strncmp(test, "random_threads", strlen("random_threads")) == 0)
+		return test_random_threads();
 	if (strncmp(test, "random", strlen("random")) == 0)
 		return test_random();
 	if (strncmp(test, "instantiate_pr", strlen("instantiate_pr")) == 0)
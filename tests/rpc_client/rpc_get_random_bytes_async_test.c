@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "env.h"
+#include "esdm_rpc_client.h"
+#include "helper.h"
+
+#define RPC_ASYNC_REQUESTS 4
+#define RPC_ASYNC_ROUNDS 8
+
+struct rpc_async_test_req {
+	uint8_t buf[32];
+	ssize_t ret;
+	unsigned int completed;
+};
+
+static void rpc_async_test_cb(ssize_t ret, uint8_t *buf, void *cb_data)
+{
+	struct rpc_async_test_req *req = cb_data;
+
+	(void)buf;
+	req->ret = ret;
+	req->completed++;
+}
+
+static int rpc_async_test_round(struct esdm_rpcc_async *async)
+{
+	static const uint8_t zero[32];
+	struct rpc_async_test_req reqs[RPC_ASYNC_REQUESTS];
+	struct pollfd pfd;
+	unsigned int i, completed = 0;
+	int ret;
+
+	memset(reqs, 0, sizeof(reqs));
+
+	for (i = 0; i < ARRAY_SIZE(reqs); i++) {
+		ret = esdm_rpcc_get_random_bytes_async(async, reqs[i].buf,
+						       sizeof(reqs[i].buf),
+						       rpc_async_test_cb,
+						       &reqs[i]);
+		if (ret) {
+			printf("ERROR: submission of request %u failed: %d\n",
+			       i, ret);
+			return 1;
+		}
+	}
+
+	pfd.fd = esdm_rpcc_async_fd(async);
+	pfd.events = POLLIN;
+
+	while (completed < ARRAY_SIZE(reqs)) {
+		pfd.revents = 0;
+		ret = poll(&pfd, 1, 5000);
+		if (ret <= 0) {
+			printf("ERROR: no response received\n");
+			return 1;
+		}
+
+		ret = esdm_rpcc_process(async);
+		if (ret < 0) {
+			printf("ERROR: processing responses failed: %d\n", ret);
+			return 1;
+		}
+		completed += (unsigned int)ret;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(reqs); i++) {
+		if (reqs[i].completed != 1 ||
+		    reqs[i].ret != (ssize_t)sizeof(reqs[i].buf) ||
+		    !memcmp(reqs[i].buf, zero, sizeof(zero))) {
+			printf("ERROR: request %u not completed: %zd\n", i,
+			       reqs[i].ret);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct esdm_rpcc_async *async = NULL;
+	unsigned int i;
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	ret = esdm_rpcc_async_alloc(&async);
+	if (ret) {
+		printf("ERROR: allocation of asynchronous context failed: %d\n",
+		       ret);
+		ret = 1;
+		goto out;
+	}
+
+	for (i = 0; i < RPC_ASYNC_ROUNDS; i++) {
+		ret = rpc_async_test_round(async);
+		if (ret)
+			goto out;
+	}
+
+	printf("PASS: asynchronous get_random_bytes requests\n");
+
+out:
+	esdm_rpcc_async_free(async);
+	env_fini();
+	return ret;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "env.h"
+#include "esdm_rpc_client.h"
+#include "helper.h"
+
+int main(int argc, char *argv[])
+{
+	static const size_t lens[] = { 16, 32, 48, 4096, 65536, 16, 70000 };
+	static const enum esdm_rpcc_rnd_flags flags[] = {
+		ESDM_RPCC_RND_NORMAL, ESDM_RPCC_RND_FULL, ESDM_RPCC_RND_MIN,
+		ESDM_RPCC_RND_FULL,   ESDM_RPCC_RND_NORMAL, ESDM_RPCC_RND_PR,
+		ESDM_RPCC_RND_MIN
+	};
+	struct esdm_rpcc_rnd_iovec iov[ARRAY_SIZE(lens)];
+	static uint8_t buf[16 + 32 + 48 + 4096 + 65536 + 16 + 70000];
+	static uint8_t zero[70000];
+	size_t i, offset = 0;
+	ssize_t rc;
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret) {
+		ret = 1;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		iov[i].iov_base = buf + offset;
+		iov[i].iov_len = lens[i];
+		iov[i].flags = flags[i];
+		offset += lens[i];
+	}
+
+	rc = esdm_rpcc_get_random_bytes_vec(iov, ARRAY_SIZE(lens));
+	if (rc != (ssize_t)sizeof(buf)) {
+		printf("ERROR: batched request returned %zd instead of %zu\n",
+		       rc, sizeof(buf));
+		ret = 1;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		if (!memcmp(zero, iov[i].iov_base, iov[i].iov_len)) {
+			printf("output buffer %zu is zero!\n", i);
+			ret = 1;
+			goto out;
+		}
+	}
+
+	printf("PASS: batched request for random bytes\n");
+
+out:
+	esdm_rpcc_fini_unpriv_service();
+	env_fini();
+	return ret;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "env.h"
+#include "esdm_rpc_client.h"
+
+#define RPC_STREAM_TEST_LEN (1024 * 1024 + 123)
+
+int main(int argc, char *argv[])
+{
+	struct esdm_rpcc_random_stream *stream = NULL;
+	uint8_t buf[5000];
+	uint8_t zero[sizeof(buf)];
+	size_t total = 0;
+	ssize_t rc;
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret) {
+		ret = 1;
+		goto out;
+	}
+
+	memset(zero, 0, sizeof(zero));
+
+	/* Bounded stream: the exact amount must be delivered */
+	ret = esdm_rpcc_random_stream_open(&stream, RPC_STREAM_TEST_LEN);
+	if (ret) {
+		printf("ERROR: opening random stream failed: %d\n", ret);
+		ret = 1;
+		goto out;
+	}
+
+	do {
+		memset(buf, 0, sizeof(buf));
+
+		rc = esdm_rpcc_random_stream_read(stream, buf, sizeof(buf));
+		if (rc < 0) {
+			printf("ERROR: reading random stream failed: %zd\n",
+			       rc);
+			ret = 1;
+			goto out;
+		}
+
+		if (rc && !memcmp(zero, buf, (size_t)rc)) {
+			printf("output buffer is zero!\n");
+			ret = 1;
+			goto out;
+		}
+
+		total += (size_t)rc;
+	} while (rc);
+
+	if (total != RPC_STREAM_TEST_LEN) {
+		printf("ERROR: random stream delivered %zu bytes instead of %d bytes\n",
+		       total, RPC_STREAM_TEST_LEN);
+		ret = 1;
+		goto out;
+	}
+	printf("PASS: random stream delivered %zu bytes\n", total);
+
+	esdm_rpcc_random_stream_close(stream);
+	stream = NULL;
+
+	/* Unbounded stream: terminated by closing it */
+	ret = esdm_rpcc_random_stream_open(&stream, 0);
+	if (ret) {
+		printf("ERROR: opening unbounded random stream failed: %d\n",
+		       ret);
+		ret = 1;
+		goto out;
+	}
+
+	for (total = 0; total < RPC_STREAM_TEST_LEN; total += (size_t)rc) {
+		rc = esdm_rpcc_random_stream_read(stream, buf, sizeof(buf));
+		if (rc != sizeof(buf)) {
+			printf("ERROR: reading unbounded random stream failed: %zd\n",
+			       rc);
+			ret = 1;
+			goto out;
+		}
+	}
+	printf("PASS: unbounded random stream delivered %zu bytes\n", total);
+
+out:
+	esdm_rpcc_random_stream_close(stream);
+	esdm_rpcc_fini_unpriv_service();
+	env_fini();
+	return ret;
+}
@@ -31,11 +31,12 @@
 
 int main(int argc, char *argv[])
 {
+	static uint64_t blocks[4][512 / sizeof(uint64_t)];
 	uint64_t buf[512 / sizeof(uint64_t)];
 	uint8_t buf2;
 	uint64_t size;
 	int ret;
-	ssize_t rc;
+	ssize_t rc, i;
 
 	(void)argc;
 	(void)argv;
@@ -141,6 +142,26 @@ int main(int argc, char *argv[])
 		       buf[0], buf[1]);
 	}
 
+	rc = esdm_rpcc_get_seed_blocks((uint8_t *)blocks, sizeof(blocks[0]), 4,
+				       ESDM_GET_SEED_NONBLOCK);
+	if (rc <= 0 || rc > 4) {
+		printf("esdm_get_seed_blocks returned %zd\n", rc);
+		ret = 1;
+		goto out;
+	}
+
+	/* Only the first block may lack entropy */
+	for (i = 0; i < rc; i++) {
+		if (blocks[i][0] != buf[0] || (i && !blocks[i][1])) {
+			printf("esdm_get_seed_blocks returned a strange block %zd: size %" PRIu64
+			       " entropy %" PRIu64 "\n",
+			       i, blocks[i][0], blocks[i][1]);
+			ret = 1;
+			goto out;
+		}
+	}
+	printf("esdm_get_seed_blocks returned %zd blocks\n", rc);
+
 out:
 	esdm_rpcc_fini_unpriv_service();
 	env_fini();
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "env.h"
+#include "esdm_rpc_client.h"
+
+#define REQUESTS 64
+
+/*
+ * Upper bounds of the average number of allocations and system calls of one
+ * request. The response of a request is sent with one system call.
+ */
+static const struct {
+	const char *method;
+	unsigned long long allocs;
+	unsigned long long syscalls;
+} bounds[] = {
+	{ "RpcGetRandomBytesFull", 1, 2 },
+	{ "RpcGetEntLvl", 1, 2 },
+};
+
+static int check_method(const char *status, unsigned int i)
+{
+	unsigned long long calls, allocs, allocs_dec, allocs_max, frees,
+		frees_dec, syscalls, syscalls_dec, syscalls_max;
+	char name[64];
+	const char *line;
+
+	snprintf(name, sizeof(name), " %s: ", bounds[i].method);
+	line = strstr(status, name);
+	if (!line) {
+		printf("No audit of %s\n", bounds[i].method);
+		return 1;
+	}
+
+	if (sscanf(line + strlen(name),
+		   "calls %llu allocs %llu.%llu (max %llu) frees %llu.%llu syscalls %llu.%llu (max %llu)",
+		   &calls, &allocs, &allocs_dec, &allocs_max, &frees,
+		   &frees_dec, &syscalls, &syscalls_dec,
+		   &syscalls_max) != 9) {
+		printf("Unexpected audit of %s\n", bounds[i].method);
+		return 1;
+	}
+
+	printf("%s: calls %llu allocs %llu.%02llu (max %llu) syscalls %llu.%02llu (max %llu)\n",
+	       bounds[i].method, calls, allocs, allocs_dec, allocs_max,
+	       syscalls, syscalls_dec, syscalls_max);
+
+	if (calls < REQUESTS) {
+		printf("Requests of %s not accounted\n", bounds[i].method);
+		return 1;
+	}
+
+	if (allocs * 100 + allocs_dec > bounds[i].allocs * 100) {
+		printf("FAIL: %s exceeds %llu allocations per request\n",
+		       bounds[i].method, bounds[i].allocs);
+		return 1;
+	}
+
+	if (syscalls * 100 + syscalls_dec > bounds[i].syscalls * 100) {
+		printf("FAIL: %s exceeds %llu system calls per request\n",
+		       bounds[i].method, bounds[i].syscalls);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static char status[65536];
+	uint8_t buf[32];
+	unsigned int i, entlvl;
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret) {
+		ret = 1;
+		goto out;
+	}
+
+	for (i = 0; i < REQUESTS; i++) {
+		if (esdm_rpcc_get_random_bytes_full(buf, sizeof(buf)) !=
+		    sizeof(buf)) {
+			printf("Generate request failed\n");
+			ret = 1;
+			goto out;
+		}
+
+		ret = esdm_rpcc_get_ent_lvl(&entlvl);
+		if (ret) {
+			printf("Entropy level request failed: %d\n", ret);
+			ret = 1;
+			goto out;
+		}
+	}
+
+	ret = esdm_rpcc_status(status, sizeof(status));
+	if (ret < 0) {
+		printf("RPC status returned error %d\n", ret);
+		ret = 1;
+		goto out;
+	}
+
+	if (!strstr(status, "RPC hot path audit:")) {
+		printf("No hot path audit in status: %s\n", status);
+		ret = 1;
+		goto out;
+	}
+
+	for (i = 0; i < sizeof(bounds) / sizeof(bounds[0]); i++)
+		ret |= check_method(status, i);
+
+out:
+	esdm_rpcc_fini_unpriv_service();
+	env_fini();
+	return ret;
+}
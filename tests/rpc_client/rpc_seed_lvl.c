@@ -25,6 +25,7 @@
 
 int main(int argc, char *argv[])
 {
+	struct timespec ts = { .tv_sec = 1, .tv_nsec = 0 };
 	int ret;
 	bool is_seeded;
 
@@ -67,6 +68,16 @@ int main(int argc, char *argv[])
 		goto out;
 	}
 
+	/* A reached state is reported without waiting */
+	ret = esdm_rpcc_wait_seed_state(ESDM_RPCC_SEED_MIN_SEEDED |
+						ESDM_RPCC_SEED_FULLY_SEEDED,
+					&ts);
+	if (ret) {
+		printf("RPC wait_seed_state returned error %d\n", ret);
+		ret = 1;
+		goto out;
+	}
+
 out:
 	esdm_rpcc_fini_unpriv_service();
 	env_fini();
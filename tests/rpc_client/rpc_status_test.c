@@ -25,6 +25,7 @@
 
 int main(int argc, char *argv[])
 {
+	struct esdm_status_bin status;
 	char buf[2048];
 	int ret;
 
@@ -59,6 +60,22 @@ int main(int argc, char *argv[])
 		goto out;
 	}
 
+	ret = esdm_rpcc_status_bin(&status);
+	if (ret < 0) {
+		printf("RPC binary status returned error %d\n", ret);
+		ret = 1;
+		goto out;
+	}
+
+	if (status.version < ESDM_STATUS_BIN_VERSION || !status.es_num ||
+	    !status.drng_num || !status.security_strength ||
+	    status.drng[0].node != ESDM_STATUS_BIN_NODE_INIT ||
+	    !status.drng_name[0] || !strstr(buf, status.drng_name)) {
+		printf("Unexpected binary status\n");
+		ret = 1;
+		goto out;
+	}
+
 out:
 	esdm_rpcc_fini_unpriv_service();
 	env_fini();
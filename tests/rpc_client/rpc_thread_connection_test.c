@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024, Stephan Mueller <smueller@chronox.de>
+ *
+ * License: see LICENSE file in root directory
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE, ALL OF
+ * WHICH ARE HEREBY DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF NOT ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "env.h"
+#include "esdm_rpc_client.h"
+#include "helper.h"
+
+#define RPC_THREAD_CONNECTION_THREADS 4
+#define RPC_THREAD_CONNECTION_ROUNDS 16
+
+static void *rpc_thread_connection_worker(void *arg)
+{
+	static const uint8_t zero[32];
+	uint8_t buf[32];
+	int *ret = arg;
+	unsigned int i;
+	ssize_t rc;
+
+	for (i = 0; i < RPC_THREAD_CONNECTION_ROUNDS; i++) {
+		rc = esdm_rpcc_get_random_bytes(buf, sizeof(buf));
+		if (rc != (ssize_t)sizeof(buf) ||
+		    !memcmp(buf, zero, sizeof(buf))) {
+			printf("ERROR: request %u on thread-bound connection failed: %zd\n",
+			       i, rc);
+			*ret = 1;
+			return NULL;
+		}
+	}
+
+	*ret = 0;
+	return NULL;
+}
+
+static int rpc_thread_connection_run(void)
+{
+	pthread_t threads[RPC_THREAD_CONNECTION_THREADS];
+	int rets[RPC_THREAD_CONNECTION_THREADS];
+	unsigned int i, started;
+	int ret = 0;
+
+	for (started = 0; started < ARRAY_SIZE(threads); started++) {
+		if (pthread_create(&threads[started], NULL,
+				   rpc_thread_connection_worker,
+				   &rets[started])) {
+			ret = 1;
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+		ret |= rets[i];
+	}
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t buf[32];
+	ssize_t rc;
+	int ret;
+
+	(void)argc;
+	(void)argv;
+
+	ret = env_init();
+	if (ret)
+		return ret;
+
+	/* One shared connection, all threads must use their own one */
+	esdm_rpcc_set_connection_pool_size(1);
+	esdm_rpcc_set_thread_bound_connections(true);
+
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret) {
+		ret = 1;
+		goto out;
+	}
+
+	ret = rpc_thread_connection_run();
+	if (ret)
+		goto out;
+
+	/* The main thread obtains its own connection as well */
+	rc = esdm_rpcc_get_random_bytes(buf, sizeof(buf));
+	if (rc != (ssize_t)sizeof(buf)) {
+		printf("ERROR: request on main thread failed: %zd\n", rc);
+		ret = 1;
+		goto out;
+	}
+
+	/* A terminated thread-bound connection is replaced */
+	esdm_rpcc_fini_unpriv_service();
+	ret = esdm_rpcc_init_unpriv_service(NULL);
+	if (ret) {
+		ret = 1;
+		goto out;
+	}
+
+	rc = esdm_rpcc_get_random_bytes(buf, sizeof(buf));
+	if (rc != (ssize_t)sizeof(buf)) {
+		printf("ERROR: request after re-initialization failed: %zd\n",
+		       rc);
+		ret = 1;
+		goto out;
+	}
+
+	printf("PASS: requests on thread-bound connections\n");
+
+out:
+	esdm_rpcc_fini_unpriv_service();
+	env_fini();
+	return ret;
+}